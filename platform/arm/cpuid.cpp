@@ -0,0 +1,125 @@
+//******************************************************************************
+///
+/// @file platform/arm/cpuid.cpp
+///
+/// This file contains code for probing the capabilities of the CPU.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+// Unit header file must be the first file included within POV-Ray *.cpp files (pulls in config)
+#include "cpuid.h"
+
+// C++ variants of C standard header files
+#include <cstdio>
+
+// C++ standard header files
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/auxv.h>
+#endif
+
+// Masks for relevant hardware capability bits, as reported by the Linux kernel
+// in the `AT_HWCAP` auxiliary vector entry on AArch64.
+#define HWCAP_ASIMD_MASK    (0x1UL <<  1)
+#define HWCAP_SVE_MASK      (0x1UL << 22)
+
+struct CPUInfo::Data final
+{
+    unsigned long   hwcap;
+    bool            hwcapKnown  : 1;
+    bool            neon        : 1;
+    bool            sve         : 1;
+    Data();
+};
+
+CPUInfo::Data::Data() :
+    hwcap(0),
+    hwcapKnown(false),
+    neon(false),
+    sve(false)
+{
+#if defined(__aarch64__) || defined(_M_ARM64)
+    // NEON (Advanced SIMD) is a mandatory part of the AArch64 architecture.
+    neon = true;
+#endif
+#if defined(__linux__) && defined(AT_HWCAP)
+    hwcap = getauxval(AT_HWCAP);
+    hwcapKnown = true;
+    neon = ((hwcap & HWCAP_ASIMD_MASK) != 0);
+    sve  = ((hwcap & HWCAP_SVE_MASK)   != 0);
+#endif
+    // On other operating systems we have no portable way of asking whether SVE
+    // registers are saved on context switches, so we play it safe.
+}
+
+bool CPUInfo::SupportsNEON()
+{
+    return gpData->neon;
+}
+
+bool CPUInfo::SupportsSVE()
+{
+    return gpData->sve;
+}
+
+std::string CPUInfo::GetFeatures()
+{
+    std::vector<const char*> features;
+
+    if (SupportsNEON())
+        features.push_back("NEON");
+    if (SupportsSVE())
+        features.push_back("SVE");
+
+    std::string result;
+    for (std::vector<const char*>::const_iterator i = features.begin(); i != features.end(); ++i)
+    {
+        if (!result.empty())
+            result.append(",");
+        result.append(*i);
+    }
+
+    return result;
+}
+
+#if POV_CPUINFO_DEBUG
+std::string CPUInfo::GetDetails()
+{
+    if (!gpData->hwcapKnown)
+        return "HWCAP:unknown";
+
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "HWCAP:0x%lx", gpData->hwcap);
+    return buffer;
+}
+#endif
+
+const CPUInfo::Data* CPUInfo::gpData(new CPUInfo::Data);
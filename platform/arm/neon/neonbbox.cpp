@@ -0,0 +1,164 @@
+//******************************************************************************
+///
+/// @file platform/arm/neon/neonbbox.cpp
+///
+/// This file contains implementations of the ray/box intersection test
+/// optimized for the NEON (Advanced SIMD) instruction set.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+// Unit header file must be the first file included within POV-Ray *.cpp files (pulls in config)
+#include "neonbbox.h"
+
+#if defined(TRY_OPTIMIZED_BBOX_NEON) && !defined(DISABLE_OPTIMIZED_BBOX_NEON)
+#include <arm_neon.h>
+#endif
+
+#include <cmath>
+#include <limits>
+
+#include "base/povassert.h"
+
+/// @file
+/// @attention
+///     This file **must not** contain any code that might get called before CPU
+///     support for this optimized implementation has been confirmed. Most
+///     notably, the function to detect support itself must not reside in this
+///     file.
+
+/*****************************************************************************/
+
+
+#ifdef TRY_OPTIMIZED_BBOX_NEON
+
+namespace pov
+{
+
+#ifndef DISABLE_OPTIMIZED_BBOX_NEON
+
+const bool kNEONBBoxEnabled = true;
+
+static_assert(kMaxOptimizedBBoxes == 8, "NEONIntersectBBoxes() is hard-wired for 8 boxes per test");
+
+/// @note
+///     This is a straight port of @ref AVX2FMA3IntersectBBoxes(), processing the 8 boxes as two
+///     groups of 4. To give the exact same results as @ref Intersect_BBox_Slabs() (and the x86
+///     implementation), min/max are computed via explicit compare-and-select rather than
+///     `vminq_f32()`/`vmaxq_f32()`, which would differ in their handling of NaNs, and no fused
+///     multiply-add is used.
+///
+unsigned int NEONIntersectBBoxes(const BoundingBox* const boxes[], unsigned int count, const Rayinfo& rayinfo, DBL dmin[])
+{
+    // Smallest single-precision value not less than EPSILON, so that comparing a single-precision
+    // value against it is equivalent to comparing against EPSILON in double precision.
+    static const float kEpsilon = ((DBL)(float)EPSILON < EPSILON) ? std::nextafter((float)EPSILON, std::numeric_limits<float>::infinity())
+                                                                      : (float)EPSILON;
+
+    alignas(16) float lo[3][8];
+    alignas(16) float hi[3][8];
+    alignas(16) float near[8];
+    alignas(16) uint32_t missed[8];
+
+    POV_ASSERT((count > 0) && (count <= 8));
+
+    // Transpose the boxes into structure-of-arrays layout; unused lanes duplicate the first box.
+    for (unsigned int i = 0; i < 8; ++i)
+    {
+        const BoundingBox& box = *boxes[(i < count) ? i : 0];
+        for (int dim = X; dim <= Z; ++dim)
+        {
+            lo[dim][i] = box.lowerLeft[dim];
+            hi[dim][i] = box.lowerLeft[dim] + box.size[dim];
+        }
+    }
+
+    const float32x4_t epsilon = vdupq_n_f32(kEpsilon);
+
+    for (unsigned int half = 0; half < 8; half += 4)
+    {
+        float32x4_t dminv = vdupq_n_f32(float(-BOUND_HUGE));
+        float32x4_t dmaxv = vdupq_n_f32(float(BOUND_HUGE));
+        uint32x4_t  miss  = vdupq_n_u32(0);
+
+        for (int dim = X; dim <= Z; ++dim)
+        {
+            const float32x4_t l = vld1q_f32(lo[dim] + half);
+            const float32x4_t h = vld1q_f32(hi[dim] + half);
+            const float32x4_t o = vdupq_n_f32(rayinfo.origin[dim]);
+
+            if (rayinfo.nonzero[dim])
+            {
+                const float32x4_t inv  = vdupq_n_f32(rayinfo.invDirection[dim]);
+                const float32x4_t tl   = vmulq_f32(vsubq_f32(l, o), inv);
+                const float32x4_t th   = vmulq_f32(vsubq_f32(h, o), inv);
+                const float32x4_t tmin = rayinfo.positive[dim] ? tl : th;
+                const float32x4_t tmax = rayinfo.positive[dim] ? th : tl;
+
+                miss  = vorrq_u32(miss, vcltq_f32(tmax, epsilon));
+                dminv = vbslq_f32(vcgtq_f32(dminv, tmin), dminv, tmin);
+                dmaxv = vbslq_f32(vcltq_f32(dmaxv, tmax), dmaxv, tmax);
+            }
+            else
+            {
+                // The ray runs parallel to this slab, so it misses unless its origin is inside.
+                miss = vorrq_u32(miss, vcltq_f32(o, l));
+                miss = vorrq_u32(miss, vcgtq_f32(o, h));
+            }
+        }
+
+        miss = vorrq_u32(miss, vcgtq_f32(dminv, dmaxv));
+        vst1q_f32(near + half, dminv);
+        vst1q_u32(missed + half, miss);
+    }
+
+    unsigned int hits = 0;
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        if (!missed[i])
+        {
+            hits |= (1u << i);
+            dmin[i] = near[i];
+        }
+    }
+
+    return hits;
+}
+
+#else // DISABLE_OPTIMIZED_BBOX_NEON
+
+const bool kNEONBBoxEnabled = false;
+unsigned int NEONIntersectBBoxes(const BoundingBox* const boxes[], unsigned int count, const Rayinfo& rayinfo, DBL dmin[]) { POV_ASSERT(false); return 0; }
+
+#endif // DISABLE_OPTIMIZED_BBOX_NEON
+
+}
+// end of namespace pov
+
+#endif // TRY_OPTIMIZED_BBOX_NEON
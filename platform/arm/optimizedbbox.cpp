@@ -0,0 +1,77 @@
+//******************************************************************************
+///
+/// @file platform/arm/optimizedbbox.cpp
+///
+/// Definitions related to the dynamic dispatch of the optimized ray/box
+/// intersection test implementations for the ARM family of CPUs.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+// Unit header file must be the first file included within POV-Ray *.cpp files (pulls in config)
+#include "optimizedbbox.h"
+
+#include "core/bounding/boundingbox.h"
+
+#ifdef TRY_OPTIMIZED_BBOX_NEON
+#include "neon/neonbbox.h"
+#endif
+
+#include "cpuid.h"
+
+#ifdef TRY_OPTIMIZED_BBOX
+
+namespace pov
+{
+
+static bool NEONSupported() { return CPUInfo::SupportsNEON(); }
+
+/// List of optimized ray/box intersection test implementations.
+///
+/// @note
+///     Entries must be listed in descending order of preference.
+///
+OptimizedBBoxInfo gaOptimizedBBoxInfo[] = {
+#ifdef TRY_OPTIMIZED_BBOX_NEON
+    {
+        "neon-generic",             // name,
+        "8 boxes per test",         // info,
+        NEONIntersectBBoxes,        // intersect,
+        &kNEONBBoxEnabled,          // enabled,
+        NEONSupported               // supported
+    },
+#endif
+    // End-of-list entry.
+    { nullptr }
+};
+
+}
+// end of namespace pov
+
+#endif // TRY_OPTIMIZED_BBOX
@@ -0,0 +1,82 @@
+//******************************************************************************
+///
+/// @file platform/arm/optimizednoise.cpp
+///
+/// Implementations related to the dynamic dispatch of the optimized noise
+/// generator implementations for the ARM family of CPUs.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+// Unit header file must be the first file included within POV-Ray *.cpp files (pulls in config)
+#include "optimizednoise.h"
+
+#include "core/material/noise.h"
+
+#ifdef TRY_OPTIMIZED_NOISE_SVE_PORTABLE
+#include "sve/sveportablenoise.h"
+#endif
+
+#include "cpuid.h"
+
+#ifdef TRY_OPTIMIZED_NOISE
+
+namespace pov
+{
+
+static bool SVESupported() { return CPUInfo::SupportsSVE(); }
+
+/// List of optimized noise implementations.
+///
+/// @note
+///     Entries must be listed in descending order of preference.
+///
+OptimizedNoiseInfo gaOptimizedNoiseInfo[] = {
+#ifdef TRY_OPTIMIZED_NOISE_SVE_PORTABLE
+    {
+        "sve-generic",              // name,
+        "compiler-optimized",       // info,
+        SVEPortableNoise,           // noise,
+        SVEPortableDNoise,          // dNoise,
+        nullptr,                    // multiNoise,
+        nullptr,                    // multiDNoise,
+        &kSVEPortableNoiseEnabled,  // enabled,
+        SVESupported,               // supported,
+        nullptr,                    // recommended,
+        nullptr                     // init
+    },
+#endif
+    // End-of-list entry.
+    { nullptr }
+};
+
+}
+// end of namespace pov
+
+#endif // TRY_OPTIMIZED_NOISE
@@ -38,14 +38,18 @@
 #include "syspovfilesystem.h"
 
 // C++ variants of C standard header files
-//  (none at the moment)
+#include <cstdint>
+#include <cstdlib>
 
 // C++ standard header files
 #include <limits>
+#include <string>
 
 // POSIX standard header files
 #include <fcntl.h>
 #include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 // POV-Ray header files (base module)
 #include "base/stringutilities.h"
@@ -144,6 +148,87 @@ void LargeFile::Close()
 
 //******************************************************************************
 
+#if !POV_USE_DEFAULT_MAPPEDFILE
+
+struct MappedFile::Data final
+{
+    void* address;
+    std::size_t size;
+    Data() : address(nullptr), size(0) {}
+};
+
+MappedFile::MappedFile() :
+    mpData(new Data)
+{}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+bool MappedFile::Open(const UCS2String& fileName)
+{
+    Close();
+
+    int handle = open(UCS2toSysString(fileName).c_str(), O_RDONLY);
+    if (handle == -1)
+        return false;
+
+    struct stat info;
+    void* address = MAP_FAILED;
+    if ((fstat(handle, &info) == 0) && (info.st_size > 0) &&
+        (std::uintmax_t(info.st_size) <= std::numeric_limits<std::size_t>::max()))
+        address = mmap(nullptr, std::size_t(info.st_size), PROT_READ, MAP_SHARED, handle, 0);
+
+    // The mapping remains valid after the file has been closed.
+    close(handle);
+
+    if (address == MAP_FAILED)
+        return false;
+
+    mpData->address = address;
+    mpData->size = std::size_t(info.st_size);
+    return true;
+}
+
+const void* MappedFile::GetData() const
+{
+    return mpData->address;
+}
+
+std::size_t MappedFile::GetSize() const
+{
+    return mpData->size;
+}
+
+void MappedFile::Prefetch() const
+{
+    if (mpData->address != nullptr)
+        (void)madvise(mpData->address, mpData->size, MADV_WILLNEED);
+}
+
+void MappedFile::Evict() const
+{
+    // The mapping is read-only and shared, so the pages can be dropped at any
+    // time; they are simply read from the file again when next accessed.
+    if (mpData->address != nullptr)
+        (void)madvise(mpData->address, mpData->size, MADV_DONTNEED);
+}
+
+void MappedFile::Close()
+{
+    if (mpData->address != nullptr)
+    {
+        munmap(mpData->address, mpData->size);
+        mpData->address = nullptr;
+        mpData->size = 0;
+    }
+}
+
+#endif // POV_USE_DEFAULT_MAPPEDFILE
+
+//******************************************************************************
+
 #if !POV_USE_DEFAULT_TEMPORARYFILE
 
 static UCS2String gTempPath;
@@ -168,6 +253,52 @@ UCS2String TemporaryFile::SuggestName()
 
 //******************************************************************************
 
+#if !POV_USE_DEFAULT_MAPPEDFILE
+
+void* AllocateFileBackedMemory(std::size_t size)
+{
+    if (size == 0)
+        return nullptr;
+
+#if !POV_USE_DEFAULT_TEMPORARYFILE
+    std::string path = (gTempPath.empty() ? std::string("/tmp/") : UCS2toSysString(gTempPath));
+#else
+    std::string path("/tmp/");
+#endif
+    path += "povmemXXXXXX";
+
+    int handle = mkstemp(&path[0]);
+    if (handle == -1)
+        return nullptr;
+
+    // The file remains in existence (but invisible) until both the handle is closed
+    // and the mapping is released.
+    unlink(path.c_str());
+
+    // Growing the file via ftruncate() leaves it sparse, so disk space is only claimed
+    // for pages actually written to; they read as zero until then.
+    void* address = MAP_FAILED;
+    if ((std::uintmax_t(size) <= std::uintmax_t(std::numeric_limits<off_t>::max())) &&
+        (ftruncate(handle, off_t(size)) == 0))
+        address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, handle, 0);
+
+    close(handle);
+
+    if (address == MAP_FAILED)
+        return nullptr;
+    return address;
+}
+
+void FreeFileBackedMemory(void* data, std::size_t size)
+{
+    if (data != nullptr)
+        munmap(data, size);
+}
+
+#endif // POV_USE_DEFAULT_MAPPEDFILE
+
+//******************************************************************************
+
 }
 // end of namespace Filesystem
 
@@ -0,0 +1,183 @@
+//******************************************************************************
+///
+/// @file platform/unix/syspovtask.cpp
+///
+/// Unix-specific implementation of the @ref pov::Task::Initialize() and
+/// @ref pov::Task::Cleanup() methods.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+#include "syspovtask.h"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+// this must be the last file included
+#include "base/povdebug.h"
+
+namespace pov
+{
+
+//******************************************************************************
+
+#if defined(__linux__)
+
+/// Processors available to POV-Ray, grouped by NUMA node.
+struct NumaTopology final
+{
+    std::vector<std::vector<int>> nodes;    ///< Processors of each node that has any.
+    cpu_set_t allowed;                      ///< Processors POV-Ray was allowed to run on at startup.
+};
+
+/// Parse a Linux sysfs list of numbers, such as `0-3,8-11`.
+static std::vector<int> ParseSysfsList(const std::string& text)
+{
+    std::vector<int> result;
+    std::istringstream list(text);
+    std::string range;
+    while (std::getline(list, range, ','))
+    {
+        int first, last;
+        char dash;
+        std::istringstream item(range);
+        if (!(item >> first))
+            continue;
+        if (!(item >> dash >> last) || (dash != '-'))
+            last = first;
+        for (int i = first; i <= last; ++i)
+            result.push_back(i);
+    }
+    return result;
+}
+
+/// Read the first line of a Linux sysfs file.
+static std::string ReadSysfsFile(const std::string& name)
+{
+    std::ifstream file(name.c_str());
+    std::string line;
+    std::getline(file, line);
+    return line;
+}
+
+static const NumaTopology& GetNumaTopology()
+{
+    static const NumaTopology topology = []()
+    {
+        NumaTopology result;
+        CPU_ZERO(&result.allowed);
+        if (sched_getaffinity(0, sizeof(result.allowed), &result.allowed) != 0)
+            return result;
+
+        for (int node : ParseSysfsList(ReadSysfsFile("/sys/devices/system/node/online")))
+        {
+            std::vector<int> cpus;
+            for (int cpu : ParseSysfsList(ReadSysfsFile("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist")))
+            {
+                if ((cpu < CPU_SETSIZE) && CPU_ISSET(cpu, &result.allowed))
+                    cpus.push_back(cpu);
+            }
+            // nodes without processors (e.g. memory-only nodes) are of no interest here
+            if (!cpus.empty())
+                result.nodes.push_back(cpus);
+        }
+
+        if (result.nodes.empty())
+        {
+            // no NUMA information available; treat the system as a single node
+            std::vector<int> cpus;
+            for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+            {
+                if (CPU_ISSET(cpu, &result.allowed))
+                    cpus.push_back(cpu);
+            }
+            if (!cpus.empty())
+                result.nodes.push_back(cpus);
+        }
+
+        return result;
+    }();
+    return topology;
+}
+
+#endif // __linux__
+
+//******************************************************************************
+
+#if !POV_USE_DEFAULT_TASK_INITIALIZE
+
+void Task::Initialize ()
+{
+#if defined(__linux__)
+    if ((placementIndex < 0) || (placementCount == 0))
+        return;
+
+    const NumaTopology& topology = GetNumaTopology();
+    if (topology.nodes.empty())
+        return;
+
+    // Consecutive tasks go to the same node, and within a node to distinct processors.
+    unsigned int index = unsigned(placementIndex);
+    unsigned int nodeCount = unsigned(topology.nodes.size());
+    unsigned int node = (index * nodeCount) / placementCount;
+    unsigned int firstIndex = (node * placementCount + nodeCount - 1) / nodeCount;
+    const std::vector<int>& cpus = topology.nodes[node];
+
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(cpus[(index - firstIndex) % cpus.size()], &cpuSet);
+    (void)sched_setaffinity(0, sizeof(cpuSet), &cpuSet);
+#endif
+}
+
+#endif // !POV_USE_DEFAULT_TASK_INITIALIZE
+
+#if !POV_USE_DEFAULT_TASK_CLEANUP
+
+void Task::Cleanup ()
+{
+#if defined(__linux__)
+    // The thread will be re-used for other tasks, so make it free to roam again.
+    if ((placementIndex >= 0) && (placementCount > 0))
+        (void)sched_setaffinity(0, sizeof(cpu_set_t), &GetNumaTopology().allowed);
+#endif
+}
+
+#endif // !POV_USE_DEFAULT_TASK_CLEANUP
+
+//******************************************************************************
+
+}
+// end of namespace pov
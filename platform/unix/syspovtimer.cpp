@@ -51,6 +51,13 @@
 #include <sys/time.h>
 #endif
 
+#if !POV_USE_DEFAULT_PERFORMANCE_COUNTERS
+#include <cstdint>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
 #include "base/povassert.h"
 #include "base/types.h"
 
@@ -344,5 +351,61 @@ bool Timer::HasValidThreadCPUTime () const
 
 //******************************************************************************
 
+#if !POV_USE_DEFAULT_PERFORMANCE_COUNTERS
+
+PerformanceCounters::PerformanceCounters()
+{
+    static const std::uint64_t kEventConfig[PerformanceCounts::kMaxEvent] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES
+    };
+
+    for (int i = 0; i < PerformanceCounts::kMaxEvent; ++i)
+    {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.type           = PERF_TYPE_HARDWARE;
+        attr.size           = sizeof(attr);
+        attr.config         = kEventConfig[i];
+        attr.exclude_kernel = 1;
+        attr.exclude_hv     = 1;
+        // Count the calling thread only, on whichever processor it happens to run; counting starts right away.
+        mFd[i] = int(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+}
+
+PerformanceCounters::~PerformanceCounters()
+{
+    for (int i = 0; i < PerformanceCounts::kMaxEvent; ++i)
+        if (mFd[i] >= 0)
+            close(mFd[i]);
+}
+
+PerformanceCounts PerformanceCounters::Elapsed() const
+{
+    PerformanceCounts counts;
+    for (int i = 0; i < PerformanceCounts::kMaxEvent; ++i)
+    {
+        std::uint64_t value;
+        if ((mFd[i] >= 0) && (read(mFd[i], &value, sizeof(value)) == sizeof(value)))
+            counts.count[i] = static_cast<POV_LONG>(value);
+    }
+    return counts;
+}
+
+bool PerformanceCounters::IsValid() const
+{
+    for (int i = 0; i < PerformanceCounts::kMaxEvent; ++i)
+        if (mFd[i] >= 0)
+            return true;
+    return false;
+}
+
+#endif // !POV_USE_DEFAULT_PERFORMANCE_COUNTERS
+
+//******************************************************************************
+
 }
 // end of namespace pov_base
@@ -118,6 +118,35 @@ class Timer final
 
 #endif // !POV_USE_DEFAULT_TIMER
 
+#if !POV_USE_DEFAULT_PERFORMANCE_COUNTERS
+
+/// Hardware performance counters.
+///
+/// This is the Linux-specific implementation of the hardware performance counters, based on the
+/// `perf_event_open()` system call. Events the kernel does not let us count (e.g. due to the
+/// `perf_event_paranoid` setting, or in virtual machines) are reported as not counted.
+///
+class PerformanceCounters final
+{
+    public:
+
+        PerformanceCounters();
+        ~PerformanceCounters();
+
+        PerformanceCounts Elapsed() const;
+
+        bool IsValid() const;
+
+    private:
+
+        int mFd[PerformanceCounts::kMaxEvent];  ///< File descriptor of each counter, or -1 if not available.
+
+        PerformanceCounters(const PerformanceCounters&) = delete;
+        PerformanceCounters& operator=(const PerformanceCounters&) = delete;
+};
+
+#endif // !POV_USE_DEFAULT_PERFORMANCE_COUNTERS
+
 }
 // end of namespace pov_base
 
@@ -84,6 +84,21 @@ bool DeleteFile(const UCS2String& fileName)
 
 //******************************************************************************
 
+#if !POV_USE_DEFAULT_RENAMEFILE
+
+bool RenameFile(const UCS2String& oldName, const UCS2String& newName)
+{
+    // `rename()` refuses to replace an existing file on Windows, but `MoveFileExW()` will,
+    // atomically as far as the file system permits.
+    return (MoveFileExW(reinterpret_cast<const wchar_t*>(oldName.c_str()),
+                        reinterpret_cast<const wchar_t*>(newName.c_str()),
+                        MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0);
+}
+
+#endif // POV_USE_DEFAULT_RENAMEFILE
+
+//******************************************************************************
+
 #if !POV_USE_DEFAULT_LARGEFILE
 
 using Offset = decltype(_lseeki64(0,0,0));
@@ -35,6 +35,8 @@
 
 #include "syspovtask.h"
 
+#include <vector>
+
 #include <windows.h>
 
 // this must be the last file included
@@ -75,6 +77,28 @@ static unsigned int GetNumberofCPUs (void)
     return result;
 }
 
+/// Processor masks of the NUMA nodes that have any processors.
+/// @note Only processors in the current processor group are considered.
+static const std::vector<ULONGLONG>& GetNumaNodeMasks (void)
+{
+    static const std::vector<ULONGLONG> result = []()
+    {
+        std::vector<ULONGLONG> masks;
+        ULONG highestNode = 0;
+        if (GetNumaHighestNodeNumber (&highestNode))
+        {
+            for (ULONG node = 0; node <= highestNode; node++)
+            {
+                ULONGLONG mask = 0;
+                if (GetNumaNodeProcessorMask ((UCHAR)node, &mask) && (mask != 0))
+                    masks.push_back (mask);
+            }
+        }
+        return masks;
+    }();
+    return result;
+}
+
 }
 // end of namespace vfeplatform
 
@@ -91,12 +115,32 @@ using namespace vfePlatform;
 
 void Task::Initialize ()
 {
-    // NB This is not thread-safe, but we currently don't care.
-    static volatile unsigned int count = 0;
-    unsigned int numCPUs = GetNumberofCPUs();
-    // TODO - if numCPUs > 64, we need to do more than this
-    if (numCPUs > 1)
-        SetThreadIdealProcessor (GetCurrentThread(), (count++) % numCPUs);
+    const std::vector<ULONGLONG>& nodeMasks = GetNumaNodeMasks();
+    if ((placementIndex >= 0) && (placementCount > 0) && !nodeMasks.empty())
+    {
+        // Consecutive tasks go to the same node, and within a node to distinct processors.
+        unsigned int index = unsigned(placementIndex);
+        unsigned int nodeCount = unsigned(nodeMasks.size());
+        unsigned int node = (index * nodeCount) / placementCount;
+        unsigned int firstIndex = (node * placementCount + nodeCount - 1) / nodeCount;
+        ULONGLONG mask = nodeMasks[node];
+        unsigned int cpuCount = 0;
+        for (ULONGLONG m = mask; m != 0; m &= m - 1)
+            cpuCount++;
+        unsigned int n = (index - firstIndex) % cpuCount;
+        for (unsigned int i = 0; i < n; i++)
+            mask &= mask - 1;
+        SetThreadAffinityMask (GetCurrentThread(), (DWORD_PTR)(mask & (~mask + 1)));
+    }
+    else
+    {
+        // NB This is not thread-safe, but we currently don't care.
+        static volatile unsigned int count = 0;
+        unsigned int numCPUs = GetNumberofCPUs();
+        // TODO - if numCPUs > 64, we need to do more than this
+        if (numCPUs > 1)
+            SetThreadIdealProcessor (GetCurrentThread(), (count++) % numCPUs);
+    }
 #ifndef _CONSOLE
     povwin::WinMemThreadStartup();
 #endif
@@ -108,6 +152,13 @@ void Task::Initialize ()
 
 void Task::Cleanup ()
 {
+    // The thread will be re-used for other tasks, so make it free to roam again.
+    if ((placementIndex >= 0) && (placementCount > 0))
+    {
+        DWORD_PTR processMask, systemMask;
+        if (GetProcessAffinityMask (GetCurrentProcess(), &processMask, &systemMask))
+            SetThreadAffinityMask (GetCurrentThread(), processMask);
+    }
 #ifndef _CONSOLE
     povwin::WinMemThreadCleanup();
 #endif
@@ -188,5 +188,34 @@ bool Timer::HasValidProcessCPUTime () const
 
 //******************************************************************************
 
+#if !POV_USE_DEFAULT_PERFORMANCE_COUNTERS
+
+PerformanceCounters::PerformanceCounters () :
+    mCyclesStart (0)
+{
+    ULONG64 cycles;
+    mCyclesSupported = (QueryThreadCycleTime (GetCurrentThread (), &cycles) != FALSE);
+    if (mCyclesSupported)
+        mCyclesStart = cycles;
+}
+
+PerformanceCounts PerformanceCounters::Elapsed () const
+{
+    PerformanceCounts counts;
+    ULONG64 cycles;
+    if (mCyclesSupported && QueryThreadCycleTime (GetCurrentThread (), &cycles))
+        counts.count[PerformanceCounts::kCycles] = static_cast<POV_LONG>(cycles - mCyclesStart);
+    return counts;
+}
+
+bool PerformanceCounters::IsValid () const
+{
+    return mCyclesSupported;
+}
+
+#endif // POV_USE_DEFAULT_PERFORMANCE_COUNTERS
+
+//******************************************************************************
+
 }
 // end of namespace pov_base
@@ -74,6 +74,31 @@ class Timer final
 
 #endif // POV_USE_DEFAULT_TIMER
 
+#if !POV_USE_DEFAULT_PERFORMANCE_COUNTERS
+
+/// Hardware performance counters.
+///
+/// This is the Windows-specific implementation of the hardware performance counters. It is based
+/// on `QueryThreadCycleTime()`, and therefore counts CPU cycles only.
+///
+class PerformanceCounters final
+{
+    public:
+        PerformanceCounters();
+        ~PerformanceCounters() = default;
+
+        PerformanceCounts Elapsed() const;
+
+        bool IsValid() const;
+
+    private:
+
+        POV_ULONG   mCyclesStart;
+        bool        mCyclesSupported;
+};
+
+#endif // POV_USE_DEFAULT_PERFORMANCE_COUNTERS
+
 }
 // end of namespace pov_base
 
@@ -0,0 +1,157 @@
+//******************************************************************************
+///
+/// @file platform/x86/avx2fma3/avx2fma3bbox.cpp
+///
+/// This file contains implementations of the ray/box intersection test
+/// optimized for the AVX2 instruction set.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+// Unit header file must be the first file included within POV-Ray *.cpp files (pulls in config)
+#include "avx2fma3bbox.h"
+
+#ifdef MACHINE_INTRINSICS_H
+#include MACHINE_INTRINSICS_H
+#endif
+
+#include <cmath>
+#include <limits>
+
+#include "base/povassert.h"
+
+/// @file
+/// @attention
+///     This file **must not** contain any code that might get called before CPU
+///     support for this optimized implementation has been confirmed. Most
+///     notably, the function to detect support itself must not reside in this
+///     file.
+
+/*****************************************************************************/
+
+
+#ifdef TRY_OPTIMIZED_BBOX_AVX2FMA3
+
+namespace pov
+{
+
+#ifndef DISABLE_OPTIMIZED_BBOX_AVX2FMA3
+
+const bool kAVX2FMA3BBoxEnabled = true;
+
+static_assert(kMaxOptimizedBBoxes == 8, "AVX2FMA3IntersectBBoxes() is hard-wired for 8 boxes per test");
+
+/// @note
+///     To give the exact same results as @ref Intersect_BBox_Slabs(), all arithmetic is done in
+///     single precision in the same order of operations, and no fused multiply-add is used.
+///     The portable implementation shortcuts the slab tests in various ways, but effectively
+///     computes the intersection of the per-slab intervals, starting from
+///     [-@ref BOUND_HUGE, @ref BOUND_HUGE] (both of which are exactly representable in single
+///     precision), and rejects the box if any slab's far plane is closer than @ref EPSILON.
+///
+unsigned int AVX2FMA3IntersectBBoxes(const BoundingBox* const boxes[], unsigned int count, const Rayinfo& rayinfo, DBL dmin[])
+{
+    // Smallest single-precision value not less than EPSILON, so that comparing a single-precision
+    // value against it is equivalent to comparing against EPSILON in double precision.
+    static const float kEpsilon = ((DBL)(float)EPSILON < EPSILON) ? std::nextafter((float)EPSILON, std::numeric_limits<float>::infinity())
+                                                                      : (float)EPSILON;
+
+    alignas(32) float lo[3][8];
+    alignas(32) float hi[3][8];
+    alignas(32) float near[8];
+
+    POV_ASSERT((count > 0) && (count <= 8));
+
+    // Transpose the boxes into structure-of-arrays layout; unused lanes duplicate the first box.
+    for (unsigned int i = 0; i < 8; ++i)
+    {
+        const BoundingBox& box = *boxes[(i < count) ? i : 0];
+        for (int dim = X; dim <= Z; ++dim)
+        {
+            lo[dim][i] = box.lowerLeft[dim];
+            hi[dim][i] = box.lowerLeft[dim] + box.size[dim];
+        }
+    }
+
+    __m256 dminv = _mm256_set1_ps(float(-BOUND_HUGE));
+    __m256 dmaxv = _mm256_set1_ps(float(BOUND_HUGE));
+    __m256 miss  = _mm256_setzero_ps();
+    const __m256 epsilon = _mm256_set1_ps(kEpsilon);
+
+    for (int dim = X; dim <= Z; ++dim)
+    {
+        const __m256 l = _mm256_load_ps(lo[dim]);
+        const __m256 h = _mm256_load_ps(hi[dim]);
+        const __m256 o = _mm256_set1_ps(rayinfo.origin[dim]);
+
+        if (rayinfo.nonzero[dim])
+        {
+            const __m256 inv = _mm256_set1_ps(rayinfo.invDirection[dim]);
+            const __m256 tl  = _mm256_mul_ps(_mm256_sub_ps(l, o), inv);
+            const __m256 th  = _mm256_mul_ps(_mm256_sub_ps(h, o), inv);
+            const __m256 tmin = rayinfo.positive[dim] ? tl : th;
+            const __m256 tmax = rayinfo.positive[dim] ? th : tl;
+
+            miss  = _mm256_or_ps(miss, _mm256_cmp_ps(tmax, epsilon, _CMP_LT_OQ));
+            dminv = _mm256_max_ps(dminv, tmin);
+            dmaxv = _mm256_min_ps(dmaxv, tmax);
+        }
+        else
+        {
+            // The ray runs parallel to this slab, so it misses unless its origin is inside.
+            miss = _mm256_or_ps(miss, _mm256_cmp_ps(o, l, _CMP_LT_OQ));
+            miss = _mm256_or_ps(miss, _mm256_cmp_ps(o, h, _CMP_GT_OQ));
+        }
+    }
+
+    miss = _mm256_or_ps(miss, _mm256_cmp_ps(dminv, dmaxv, _CMP_GT_OQ));
+    _mm256_store_ps(near, dminv);
+
+    unsigned int hits = ~(unsigned int)_mm256_movemask_ps(miss) & ((1u << count) - 1);
+
+    _mm256_zeroupper();
+
+    for (unsigned int i = 0; i < count; ++i)
+        if (hits & (1u << i))
+            dmin[i] = near[i];
+
+    return hits;
+}
+
+#else // DISABLE_OPTIMIZED_BBOX_AVX2FMA3
+
+const bool kAVX2FMA3BBoxEnabled = false;
+unsigned int AVX2FMA3IntersectBBoxes(const BoundingBox* const boxes[], unsigned int count, const Rayinfo& rayinfo, DBL dmin[]) { POV_ASSERT(false); return 0; }
+
+#endif // DISABLE_OPTIMIZED_BBOX_AVX2FMA3
+
+}
+// end of namespace pov
+
+#endif // TRY_OPTIMIZED_BBOX_AVX2FMA3
@@ -0,0 +1,61 @@
+//******************************************************************************
+///
+/// @file platform/x86/avx2fma3/avx2fma3bbox.h
+///
+/// This file contains declarations related to implementations of the ray/box
+/// intersection test optimized for the AVX2 instruction set.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+#ifndef POVRAY_AVX2FMA3BBOX_H
+#define POVRAY_AVX2FMA3BBOX_H
+
+#include "core/configcore.h"
+#include "core/bounding/boundingbox.h"
+
+#ifdef TRY_OPTIMIZED_BBOX_AVX2FMA3
+
+namespace pov
+{
+
+extern const bool kAVX2FMA3BBoxEnabled;
+
+/// Optimized ray/box intersection test using AVX2 instructions.
+///
+/// Tests a ray against up to 8 boxes at once; see @ref IntersectBBoxesFunction.
+///
+unsigned int AVX2FMA3IntersectBBoxes(const BoundingBox* const boxes[], unsigned int count, const Rayinfo& rayinfo, DBL dmin[]);
+
+}
+// end of namespace pov
+
+#endif // TRY_OPTIMIZED_BBOX_AVX2FMA3
+
+#endif // POVRAY_AVX2FMA3BBOX_H
@@ -48,6 +48,8 @@
 #include MACHINE_INTRINSICS_H
 #endif
 
+#include <algorithm>
+
 #include "base/povassert.h"
 
 #include "core/material/noise.h"
@@ -508,12 +510,216 @@ void AVX2FMA3DNoise(Vector3d& result, const Vector3d& EPoint)
 
 }
 
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   AVX2FMA3MultiNoise, AVX2FMA3MultiDNoise
+*
+* INPUT
+*
+*   EPoints -- 3-D points at which noise is evaluated
+*   count   -- number of points
+*
+* OUTPUT
+*
+*   results -- noise values
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*   Multi-point versions of AVX2FMA3Noise and AVX2FMA3DNoise. Rather than spreading
+*   the lattice corners of a single point across the vector lanes, these process
+*   four points at a time, one per lane, gathering the table entries for each of the
+*   eight lattice corners.
+*
+* CHANGES
+*
+******************************************************************************/
+
+#ifndef NO_SPLITS
+
+/// Lattice data of four points, one per vector lane.
+struct AVX2FMA3NoiseLattice
+{
+    __m256d i[3];       ///< Offsets from the lower lattice corner, per axis.
+    __m256d j[3];       ///< Offsets from the upper lattice corner, per axis.
+    __m256d s[3];       ///< Weights of the upper lattice corner, per axis.
+    __m256d t[3];       ///< Weights of the lower lattice corner, per axis.
+    __m128i index[8];   ///< AVX2RTable indices of the lattice corners.
+};
+
+static inline void AVX2FMA3ComputeNoiseLattice(AVX2FMA3NoiseLattice& lattice, const Vector3d* EPoints)
+{
+    const __m256d ONE_PD = _mm256_set1_pd(1.0);
+    const __m256d epsy = _mm256_set1_pd(1.0 - EPSILON);
+    const int noise_min[3] = { NOISE_MINX, NOISE_MINY, NOISE_MINZ };
+
+    alignas(16) int ints[3][4];
+    for (int axis = X; axis <= Z; axis++)
+    {
+        const __m256d v = _mm256_setr_pd(EPoints[0][axis], EPoints[1][axis], EPoints[2][axis], EPoints[3][axis]);
+        const __m128i tmp = _mm256_cvttpd_epi32(_mm256_blendv_pd(v, _mm256_sub_pd(v, epsy), v));
+        const __m256d ii = _mm256_sub_pd(v, _mm256_cvtepi32_pd(tmp));
+        lattice.i[axis] = ii;
+        lattice.j[axis] = _mm256_sub_pd(ii, ONE_PD);
+        lattice.s[axis] = _mm256_mul_pd(ii, _mm256_mul_pd(ii, _mm256_sub_pd(_mm256_set1_pd(3.0), _mm256_add_pd(ii, ii))));
+        lattice.t[axis] = _mm256_sub_pd(ONE_PD, lattice.s[axis]);
+        _mm_store_si128((__m128i*)(ints[axis]), _mm_and_si128(_mm_sub_epi32(tmp, _mm_set1_epi32(noise_min[axis])), _mm_set1_epi32(0xfff)));
+    }
+
+    // The hash table holds 16-bit entries, which do not lend themselves to gathering.
+    alignas(16) int index[8][4];
+    for (int k = 0; k < 4; k++)
+    {
+        const int ix = ints[X][k];
+        const int iy = ints[Y][k];
+        const int iz = ints[Z][k];
+
+        const int ixiy_hash = Hash2d(ix,     iy);
+        const int jxiy_hash = Hash2d(ix + 1, iy);
+        const int ixjy_hash = Hash2d(ix,     iy + 1);
+        const int jxjy_hash = Hash2d(ix + 1, iy + 1);
+
+        index[0][k] = Hash1dRTableIndexAVX(ixiy_hash, iz);
+        index[1][k] = Hash1dRTableIndexAVX(jxiy_hash, iz);
+        index[2][k] = Hash1dRTableIndexAVX(ixjy_hash, iz);
+        index[3][k] = Hash1dRTableIndexAVX(jxjy_hash, iz);
+        index[4][k] = Hash1dRTableIndexAVX(ixiy_hash, iz + 1);
+        index[5][k] = Hash1dRTableIndexAVX(jxiy_hash, iz + 1);
+        index[6][k] = Hash1dRTableIndexAVX(ixjy_hash, iz + 1);
+        index[7][k] = Hash1dRTableIndexAVX(jxjy_hash, iz + 1);
+    }
+    for (int corner = 0; corner < 8; corner++)
+        lattice.index[corner] = _mm_load_si128((const __m128i*)(index[corner]));
+}
+
+/// Sum the contributions of the lattice corners; `offset` selects the set of table entries.
+static inline __m256d AVX2FMA3NoiseLatticeSum(const AVX2FMA3NoiseLattice& lattice, int offset)
+{
+    const __m256d HALF_PD = _mm256_set1_pd(0.5);
+    const DBL *table = AVX2RTable + offset;
+    __m256d sum = _mm256_setzero_pd();
+
+    // corner bits 0, 1 and 2 select the upper lattice corner along X, Y and Z, respectively
+    for (int corner = 0; corner < 8; corner++)
+    {
+        const __m256d dx = (corner & 1) ? lattice.j[X] : lattice.i[X];
+        const __m256d dy = (corner & 2) ? lattice.j[Y] : lattice.i[Y];
+        const __m256d dz = (corner & 4) ? lattice.j[Z] : lattice.i[Z];
+        const __m256d weight = _mm256_mul_pd(_mm256_mul_pd((corner & 1) ? lattice.s[X] : lattice.t[X],
+                                                           (corner & 2) ? lattice.s[Y] : lattice.t[Y]),
+                                             (corner & 4) ? lattice.s[Z] : lattice.t[Z]);
+        const __m128i idx = lattice.index[corner];
+
+        __m256d value = _mm256_mul_pd(_mm256_i32gather_pd(table, idx, 8), HALF_PD);
+        value = FMA_PD(_mm256_i32gather_pd(table + 1, idx, 8), dx, value);
+        value = FMA_PD(_mm256_i32gather_pd(table + 2, idx, 8), dy, value);
+        value = FMA_PD(_mm256_i32gather_pd(table + 3, idx, 8), dz, value);
+        sum = FMA_PD(weight, value, sum);
+    }
+
+    return sum;
+}
+
+void AVX2FMA3MultiNoise(DBL* results, const Vector3d* EPoints, size_t count, int noise_generator)
+{
+    if (noise_generator == kNoiseGen_Perlin)
+    {
+        for (size_t n = 0; n < count; n++)
+            results[n] = AVX2FMA3Noise(EPoints[n], noise_generator);
+        return;
+    }
+
+    const __m256d ZERO_PD = _mm256_setzero_pd();
+    const __m256d ONE_PD = _mm256_set1_pd(1.0);
+
+    for (size_t n = 0; n < count; n += 4)
+    {
+        // pad an incomplete batch by repeating the last point
+        Vector3d points[4];
+        const Vector3d *p = EPoints + n;
+        const size_t batch = std::min<size_t>(4, count - n);
+        if (batch < 4)
+        {
+            for (size_t k = 0; k < 4; k++)
+                points[k] = EPoints[n + std::min(k, batch - 1)];
+            p = points;
+        }
+
+        AVX2FMA3NoiseLattice lattice;
+        AVX2FMA3ComputeNoiseLattice(lattice, p);
+        __m256d sum = AVX2FMA3NoiseLatticeSum(lattice, 0);
+
+        if (noise_generator == kNoiseGen_RangeCorrected)
+            sum = _mm256_mul_pd(_mm256_add_pd(sum, _mm256_set1_pd(1.05242)), _mm256_set1_pd(0.48985582));
+        else
+            sum = _mm256_add_pd(sum, _mm256_set1_pd(0.5));
+        sum = _mm256_min_pd(_mm256_max_pd(sum, ZERO_PD), ONE_PD);
+
+        alignas(32) DBL sums[4];
+        _mm256_store_pd(sums, sum);
+        for (size_t k = 0; k < batch; k++)
+            results[n + k] = sums[k];
+    }
+
+    _mm256_zeroupper();
+}
+
+void AVX2FMA3MultiDNoise(Vector3d* results, const Vector3d* EPoints, size_t count)
+{
+    for (size_t n = 0; n < count; n += 4)
+    {
+        // pad an incomplete batch by repeating the last point
+        Vector3d points[4];
+        const Vector3d *p = EPoints + n;
+        const size_t batch = std::min<size_t>(4, count - n);
+        if (batch < 4)
+        {
+            for (size_t k = 0; k < 4; k++)
+                points[k] = EPoints[n + std::min(k, batch - 1)];
+            p = points;
+        }
+
+        AVX2FMA3NoiseLattice lattice;
+        AVX2FMA3ComputeNoiseLattice(lattice, p);
+
+        alignas(32) DBL sums[3][4];
+        for (int axis = X; axis <= Z; axis++)
+            _mm256_store_pd(sums[axis], AVX2FMA3NoiseLatticeSum(lattice, 4 * axis));
+        for (size_t k = 0; k < batch; k++)
+            results[n + k] = Vector3d(sums[X][k], sums[Y][k], sums[Z][k]);
+    }
+
+    _mm256_zeroupper();
+}
+
+#else // NO_SPLITS
+
+void AVX2FMA3MultiNoise(DBL* results, const Vector3d* EPoints, size_t count, int noise_generator)
+{
+    for (size_t n = 0; n < count; n++)
+        results[n] = AVX2FMA3Noise(EPoints[n], noise_generator);
+}
+
+void AVX2FMA3MultiDNoise(Vector3d* results, const Vector3d* EPoints, size_t count)
+{
+    for (size_t n = 0; n < count; n++)
+        AVX2FMA3DNoise(results[n], EPoints[n]);
+}
+
+#endif // NO_SPLITS
+
 #else // DISABLE_OPTIMIZED_NOISE_AVX2FMA3
 
 const bool kAVX2FMA3NoiseEnabled = false;
 void AVX2FMA3NoiseInit() { POV_ASSERT(false); }
 DBL AVX2FMA3Noise(const Vector3d& EPoint, int noise_generator) { POV_ASSERT(false); return 0.0; }
 void AVX2FMA3DNoise(Vector3d& result, const Vector3d& EPoint) { POV_ASSERT(false); }
+void AVX2FMA3MultiNoise(DBL* results, const Vector3d* EPoints, size_t count, int noise_generator) { POV_ASSERT(false); }
+void AVX2FMA3MultiDNoise(Vector3d* results, const Vector3d* EPoints, size_t count) { POV_ASSERT(false); }
 
 #endif // DISABLE_OPTIMIZED_NOISE_AVX2FMA3
 
@@ -57,6 +57,14 @@ DBL AVX2FMA3Noise(const Vector3d& EPoint, int noise_generator);
 /// @author Optimized by Intel
 void AVX2FMA3DNoise(Vector3d& result, const Vector3d& EPoint);
 
+/// Optimized multi-point Noise function using AVX2 and FMA3 instructions.
+/// Evaluates four points at a time, one per vector lane.
+void AVX2FMA3MultiNoise(DBL* results, const Vector3d* EPoints, size_t count, int noise_generator);
+
+/// Optimized multi-point DNoise function using AVX2 and FMA3 instructions.
+/// Evaluates four points at a time, one per vector lane.
+void AVX2FMA3MultiDNoise(Vector3d* results, const Vector3d* EPoints, size_t count);
+
 }
 // end of namespace pov
 
@@ -0,0 +1,163 @@
+//******************************************************************************
+///
+/// @file platform/x86/avx2fma3/avx2fma3transform.cpp
+///
+/// This file contains implementations of the vector transformations optimized
+/// for the AVX2 and FMA3 instruction sets.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+// Unit header file must be the first file included within POV-Ray *.cpp files (pulls in config)
+#include "avx2fma3transform.h"
+
+#ifdef MACHINE_INTRINSICS_H
+#include MACHINE_INTRINSICS_H
+#endif
+
+#include "base/povassert.h"
+
+/// @file
+/// @attention
+///     This file **must not** contain any code that might get called before CPU
+///     support for this optimized implementation has been confirmed. Most
+///     notably, the function to detect support itself must not reside in this
+///     file.
+
+/*****************************************************************************/
+
+
+#ifdef TRY_OPTIMIZED_TRANSFORM_AVX2FMA3
+
+namespace pov
+{
+
+#ifndef DISABLE_OPTIMIZED_TRANSFORM_AVX2FMA3
+
+const bool kAVX2FMA3TransformEnabled = true;
+
+// Each row of a MATRIX holds 4 doubles, i.e. exactly one AVX register. The vector to transform is
+// broadcast component by component, so that the result builds up in the lower three lanes of a
+// register as a linear combination of the rows; the fourth lane is ignored.
+
+/// Store the lower three lanes of a register to a vector.
+static inline void StoreVector(Vector3d& v, __m256d r)
+{
+    _mm_storeu_pd(&v[X], _mm256_castpd256_pd128(r));
+    _mm_store_sd(&v[Z], _mm256_extractf128_pd(r, 1));
+}
+
+/// Transform a vector by the upper left 3x3 part of a matrix, given as its first three rows.
+static inline __m256d TransformDirection(const Vector3d& v, __m256d row0, __m256d row1, __m256d row2)
+{
+    __m256d r = _mm256_mul_pd(_mm256_set1_pd(v[X]), row0);
+    r = _mm256_fmadd_pd(_mm256_set1_pd(v[Y]), row1, r);
+    r = _mm256_fmadd_pd(_mm256_set1_pd(v[Z]), row2, r);
+    return r;
+}
+
+void AVX2FMA3TransformPoints(Vector3d result[], const Vector3d vectors[], size_t count, const MATRIX *matrix)
+{
+    const __m256d row0 = _mm256_loadu_pd((*matrix)[0]);
+    const __m256d row1 = _mm256_loadu_pd((*matrix)[1]);
+    const __m256d row2 = _mm256_loadu_pd((*matrix)[2]);
+    const __m256d row3 = _mm256_loadu_pd((*matrix)[3]);
+
+    for (size_t i = 0; i < count; ++i)
+        StoreVector(result[i], _mm256_add_pd(TransformDirection(vectors[i], row0, row1, row2), row3));
+
+    _mm256_zeroupper();
+}
+
+void AVX2FMA3TransformDirections(Vector3d result[], const Vector3d vectors[], size_t count, const MATRIX *matrix)
+{
+    const __m256d row0 = _mm256_loadu_pd((*matrix)[0]);
+    const __m256d row1 = _mm256_loadu_pd((*matrix)[1]);
+    const __m256d row2 = _mm256_loadu_pd((*matrix)[2]);
+
+    for (size_t i = 0; i < count; ++i)
+        StoreVector(result[i], TransformDirection(vectors[i], row0, row1, row2));
+
+    _mm256_zeroupper();
+}
+
+void AVX2FMA3InvTransformNormals(Vector3d result[], const Vector3d vectors[], size_t count, const MATRIX *matrix)
+{
+    const __m256d row0 = _mm256_loadu_pd((*matrix)[0]);
+    const __m256d row1 = _mm256_loadu_pd((*matrix)[1]);
+    const __m256d row2 = _mm256_loadu_pd((*matrix)[2]);
+    const __m256d row3 = _mm256_loadu_pd((*matrix)[3]);
+
+    // Normals are transformed by the transpose, so transpose the matrix once up front.
+    const __m256d t0 = _mm256_unpacklo_pd(row0, row1);
+    const __m256d t1 = _mm256_unpackhi_pd(row0, row1);
+    const __m256d t2 = _mm256_unpacklo_pd(row2, row3);
+    const __m256d t3 = _mm256_unpackhi_pd(row2, row3);
+    const __m256d col0 = _mm256_permute2f128_pd(t0, t2, 0x20);
+    const __m256d col1 = _mm256_permute2f128_pd(t1, t3, 0x20);
+    const __m256d col2 = _mm256_permute2f128_pd(t0, t2, 0x31);
+
+    for (size_t i = 0; i < count; ++i)
+        StoreVector(result[i], TransformDirection(vectors[i], col0, col1, col2));
+
+    _mm256_zeroupper();
+}
+
+void AVX2FMA3TransformRays(BasicRay result[], const BasicRay rays[], size_t count, const MATRIX *matrix)
+{
+    const __m256d row0 = _mm256_loadu_pd((*matrix)[0]);
+    const __m256d row1 = _mm256_loadu_pd((*matrix)[1]);
+    const __m256d row2 = _mm256_loadu_pd((*matrix)[2]);
+    const __m256d row3 = _mm256_loadu_pd((*matrix)[3]);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const __m256d origin    = _mm256_add_pd(TransformDirection(rays[i].Origin, row0, row1, row2), row3);
+        const __m256d direction = TransformDirection(rays[i].Direction, row0, row1, row2);
+        StoreVector(result[i].Origin, origin);
+        StoreVector(result[i].Direction, direction);
+    }
+
+    _mm256_zeroupper();
+}
+
+#else // DISABLE_OPTIMIZED_TRANSFORM_AVX2FMA3
+
+const bool kAVX2FMA3TransformEnabled = false;
+void AVX2FMA3TransformPoints(Vector3d result[], const Vector3d vectors[], size_t count, const MATRIX *matrix) { POV_ASSERT(false); }
+void AVX2FMA3TransformDirections(Vector3d result[], const Vector3d vectors[], size_t count, const MATRIX *matrix) { POV_ASSERT(false); }
+void AVX2FMA3InvTransformNormals(Vector3d result[], const Vector3d vectors[], size_t count, const MATRIX *matrix) { POV_ASSERT(false); }
+void AVX2FMA3TransformRays(BasicRay result[], const BasicRay rays[], size_t count, const MATRIX *matrix) { POV_ASSERT(false); }
+
+#endif // DISABLE_OPTIMIZED_TRANSFORM_AVX2FMA3
+
+}
+// end of namespace pov
+
+#endif // TRY_OPTIMIZED_TRANSFORM_AVX2FMA3
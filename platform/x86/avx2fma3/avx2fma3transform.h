@@ -0,0 +1,66 @@
+//******************************************************************************
+///
+/// @file platform/x86/avx2fma3/avx2fma3transform.h
+///
+/// This file contains declarations related to implementations of the vector
+/// transformations optimized for the AVX2 and FMA3 instruction sets.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+#ifndef POVRAY_AVX2FMA3TRANSFORM_H
+#define POVRAY_AVX2FMA3TRANSFORM_H
+
+#include "core/configcore.h"
+#include "core/math/matrix.h"
+
+#ifdef TRY_OPTIMIZED_TRANSFORM_AVX2FMA3
+
+namespace pov
+{
+
+extern const bool kAVX2FMA3TransformEnabled;
+
+/// @name Optimized vector transformations using AVX2 and FMA3 instructions.
+/// See @ref TransformVectorsFunction and @ref TransformRaysFunction.
+/// @{
+
+void AVX2FMA3TransformPoints(Vector3d result[], const Vector3d vectors[], size_t count, const MATRIX *matrix);
+void AVX2FMA3TransformDirections(Vector3d result[], const Vector3d vectors[], size_t count, const MATRIX *matrix);
+void AVX2FMA3InvTransformNormals(Vector3d result[], const Vector3d vectors[], size_t count, const MATRIX *matrix);
+void AVX2FMA3TransformRays(BasicRay result[], const BasicRay rays[], size_t count, const MATRIX *matrix);
+
+/// @}
+
+}
+// end of namespace pov
+
+#endif // TRY_OPTIMIZED_TRANSFORM_AVX2FMA3
+
+#endif // POVRAY_AVX2FMA3TRANSFORM_H
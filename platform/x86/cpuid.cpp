@@ -75,7 +75,7 @@ static void cpuid(int *out, int in)
                           movl %%edx, 0xc(%%edi);   \
                           popl %%ebx;"              \
                           : : "D" (out), "S" (in)   \
-                          : "%eax", "%ecx", "%edx");
+                          : "%eax", "%ecx", "%edx", "memory");
 #elif defined(__x86_64__) // Architecture: x86-64 (64 bit)
     __asm__ __volatile__("pushq %%rbx;              \
                           xorq %%rax, %%rax;        \
@@ -88,7 +88,7 @@ static void cpuid(int *out, int in)
                           movl %%edx, 0xc(%%rdi);   \
                           popq %%rbx;"              \
                           : : "D" (out), "S" (in)   \
-                          : "%rax", "%rcx", "%rdx");
+                          : "%rax", "%rcx", "%rdx", "memory");
 #else // Architecture
 #error "Don't know how to invoke CPUID on this target architecture."
 #endif // Architecture
@@ -119,11 +119,13 @@ static unsigned long long getXCR0()
 #define CPUID_00000001_ECX_AVX_MASK     (0x1 << 28)
 #define CPUID_00000001_EDX_SSE2_MASK    (0x1 << 26)
 #define CPUID_00000007_EBX_AVX2_MASK    (0x1 <<  5)
+#define CPUID_00000007_EBX_AVX512F_MASK (0x1 << 16)
 #define CPUID_80000001_ECX_FMA4_MASK    (0x1 << 16)
 
 // Masks for relevant XCR0 register bits.
 #define XCR0_SSE_MASK (0x1 << 1)
 #define XCR0_AVX_MASK (0x1 << 2)
+#define XCR0_AVX512_MASK (0x7 << 5) // opmask, upper halves of ZMM0-15, and ZMM16-31
 
 static bool OSSavesSSERegisters()
 {
@@ -177,6 +179,7 @@ struct CPUIDInfo final
     bool        avx2   : 1;
     bool        fma3   : 1;
     bool        fma4   : 1;
+    bool        avx512f: 1;
 #if POV_CPUINFO_DEBUG
     char        vendor[13];
 #endif
@@ -191,6 +194,7 @@ CPUIDInfo::CPUIDInfo() :
     avx2(false),
     fma3(false),
     fma4(false),
+    avx512f(false),
     vendorId(kCPUVendor_Unrecognized)
 {
     int info[4];
@@ -224,6 +228,7 @@ CPUIDInfo::CPUIDInfo() :
     {
         CPUID(info, 0x7);
         avx2    = ((info[CPUID_EBX] & CPUID_00000007_EBX_AVX2_MASK)    != 0);
+        avx512f = ((info[CPUID_EBX] & CPUID_00000007_EBX_AVX512F_MASK) != 0);
     }
     CPUID(info, 0x80000000);
     int maxLeafExt = info[CPUID_EAX];
@@ -238,18 +243,21 @@ struct OSInfo final
 {
     bool xcr0_sse : 1;
     bool xcr0_avx : 1;
+    bool xcr0_avx512 : 1;
     OSInfo(const CPUIDInfo& cpuinfo);
 };
 
 OSInfo::OSInfo(const CPUIDInfo& cpuinfo) :
     xcr0_sse(false),
-    xcr0_avx(false)
+    xcr0_avx(false),
+    xcr0_avx512(false)
 {
     if (cpuinfo.xsave && cpuinfo.osxsave)
     {
         unsigned long long xcrFeatureMask = GET_XCR0();
         xcr0_sse = ((xcrFeatureMask & XCR0_SSE_MASK) != 0);
         xcr0_avx = ((xcrFeatureMask & XCR0_AVX_MASK) != 0);
+        xcr0_avx512 = ((xcrFeatureMask & XCR0_AVX512_MASK) == XCR0_AVX512_MASK);
     }
 }
 
@@ -302,6 +310,16 @@ bool CPUInfo::SupportsFMA4()
     return gpData->cpuidInfo.fma4;
 }
 
+bool CPUInfo::SupportsAVX512F()
+{
+    return gpData->cpuidInfo.osxsave
+        && gpData->cpuidInfo.avx
+        && gpData->cpuidInfo.avx512f
+        && gpData->osInfo.xcr0_sse
+        && gpData->osInfo.xcr0_avx
+        && gpData->osInfo.xcr0_avx512;
+}
+
 bool CPUInfo::IsIntel()
 {
     return gpData->cpuidInfo.vendorId == kCPUVendor_Intel;
@@ -338,6 +356,8 @@ std::string CPUInfo::GetFeatures()
         features.push_back("FMA3");
     if (SupportsFMA4())
         features.push_back("FMA4");
+    if (SupportsAVX512F())
+        features.push_back("AVX512F");
 
     std::string result;
     for (std::vector<const char*>::const_iterator i = features.begin(); i != features.end(); ++i)
@@ -361,6 +381,8 @@ std::string CPUInfo::GetDetails()
         cpuidFeatures.push_back("AVX");
     if (gpData->cpuidInfo.avx2)
         cpuidFeatures.push_back("AVX2");
+    if (gpData->cpuidInfo.avx512f)
+        cpuidFeatures.push_back("AVX512F");
     if (gpData->cpuidInfo.fma3)
         cpuidFeatures.push_back("FMA");
     if (gpData->cpuidInfo.fma4)
@@ -376,6 +398,8 @@ std::string CPUInfo::GetDetails()
 
     if (gpData->osInfo.xcr0_avx)
         xcr0Features.push_back("AVX");
+    if (gpData->osInfo.xcr0_avx512)
+        xcr0Features.push_back("AVX512");
     if (gpData->osInfo.xcr0_sse)
         xcr0Features.push_back("SSE");
 
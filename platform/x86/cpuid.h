@@ -53,6 +53,7 @@ public:
     static bool SupportsAVX2();             ///< Test whether CPU and OS support AVX2.
     static bool SupportsFMA3();             ///< Test whether CPU and OS support FMA3.
     static bool SupportsFMA4();             ///< Test whether CPU and OS support FMA4.
+    static bool SupportsAVX512F();          ///< Test whether CPU and OS support AVX-512 Foundation.
     static bool IsIntel();                  ///< Test whether CPU is genuine Intel product.
     static bool IsAMD();                    ///< Test whether CPU is genuine AMD product.
     static bool IsVM();                     ///< Test whether CPU cannot be detected reliably due to running in a VM.
@@ -0,0 +1,848 @@
+//******************************************************************************
+///
+/// @file platform/x86/optimizedfunctions.cpp
+///
+/// Implementation of the native code compiler for user-defined
+/// functions on x86-64 CPUs.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+// Unit header file must be the first file included within POV-Ray *.cpp files (pulls in config)
+#include "optimizedfunctions.h"
+
+#ifdef TRY_OPTIMIZED_FUNCTIONS
+
+// C++ variants of C standard header files
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// C++ standard header files
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+// POV-Ray header files (VM module)
+#include "vm/fnintern.h"
+#include "vm/fnpovfpu.h"
+
+namespace pov
+{
+
+/// Native code compiled from a function.
+///
+/// The structure sits at the start of a block of executable memory, followed by the entry stub,
+/// the function body and its constant pool.
+///
+struct FunctionNativeCode final
+{
+    const void *body;   ///< Function body, called by native code of other functions.
+    const void *entry;  ///< Entry stub, called by @ref POVFPU_RunNative().
+    std::size_t size;   ///< Size of the memory block.
+};
+
+namespace
+{
+
+typedef DBL (*NativeEntry)(FunctionNativeState *state);
+
+/// x86-64 general purpose registers.
+enum Reg
+{
+    RAX = 0, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+    R8, R9, R10, R11, R12, R13, R14, R15
+};
+
+/// x86 condition codes.
+enum Cond
+{
+    CC_B = 2, CC_AE = 3, CC_E = 4, CC_NE = 5, CC_BE = 6, CC_A = 7, CC_P = 10, CC_NP = 11
+};
+
+// Registers holding the VM state; they are callee-saved in both the System V and Windows ABI.
+// VM registers r0-r7 are held in xmm0-xmm7, and xmm8 is used as scratch register.
+const int kRegState     = RBX;  // FunctionNativeState*
+const int kRegStack     = R12;  // data stack base
+const int kRegSP        = R13;  // data stack pointer
+const int kRegCCR       = R14;  // condition code register
+const int kRegDepth     = R15;  // call depth
+const int kRegScratch   = 8;    // xmm8
+
+#ifdef _WIN64
+const int kRegArg[4] = { RCX, RDX, R8, R9 };
+const int kShadowSpace = 32;
+#else
+const int kRegArg[4] = { RDI, RSI, RDX, RCX };
+const int kShadowSpace = 0;
+#endif
+
+// Stack frame of a function body: shadow space for helper calls, spill slots for xmm0-xmm7,
+// and padding to keep the stack 16-byte aligned.
+const int kSpillOffset = kShadowSpace;
+const int kFrameSize   = ((kSpillOffset + 8 * 8) | 15) - 7;
+
+/// Memory operand.
+struct Mem
+{
+    int base;
+    int index;
+    int scale;
+    std::int32_t disp;
+    int literal;        // if not negative, RIP-relative reference to the literal pool
+
+    Mem(int b, std::int32_t d) : base(b), index(-1), scale(1), disp(d), literal(-1) {}
+    Mem(int b, int i, int s, std::int32_t d) : base(b), index(i), scale(s), disp(d), literal(-1) {}
+    static Mem Literal(int n) { Mem m(RAX, 0); m.literal = n; return m; }
+};
+
+/// Minimal x86-64 assembler and translator from function VM code.
+class NativeCompiler
+{
+    public:
+
+        NativeCompiler(const FunctionCode& f, FUNCTION fn, const std::vector<DBL>& consts,
+                       const std::vector<FunctionEntry>& functions);
+
+        bool Compile();
+
+        std::vector<unsigned char> code;
+        std::size_t bodyOffset;
+
+    private:
+
+        struct Fixup
+        {
+            std::size_t pos;
+            int target;
+        };
+
+        const FunctionCode& mFunction;
+        FUNCTION mFn;
+        const std::vector<DBL>& mConsts;
+        const std::vector<FunctionEntry>& mFunctions;
+
+        std::vector<std::size_t> mLabels;
+        std::vector<Fixup> mLabelFixups;
+        std::vector<DBL> mLiterals;
+        std::vector<Fixup> mLiteralFixups;
+        int mExitLabel;
+        int mBailLabel;
+        int mLiteralSignMask;
+        int mLiteralAbsMask;
+
+        bool Supported(Instruction w) const;
+
+        int NewLabel() { mLabels.push_back(SIZE_MAX); return int(mLabels.size()) - 1; }
+        void Bind(int label) { mLabels[label] = code.size(); }
+        int Literal(DBL v) { mLiterals.push_back(v); return int(mLiterals.size()) - 1; }
+
+        void Byte(unsigned int b) { code.push_back((unsigned char)b); }
+        void Dword(std::uint32_t v) { for (int i = 0; i < 32; i += 8) Byte(v >> i); }
+        void Qword(std::uint64_t v) { for (int i = 0; i < 64; i += 8) Byte((unsigned int)(v >> i)); }
+
+        void Rex(bool w, int reg, int index, int base);
+        void ModRM(int reg, const Mem& m);
+        void ModRR(int reg, int rm) { Byte(0xC0 | ((reg & 7) << 3) | (rm & 7)); }
+
+        void OpRM(unsigned int prefix, bool w, unsigned int op, int reg, const Mem& m);
+        void OpRR(unsigned int prefix, bool w, unsigned int op, int reg, int rm);
+
+        // general purpose register instructions
+        void Push(int r)                { if (r >= 8) Byte(0x41); Byte(0x50 | (r & 7)); }
+        void Pop(int r)                 { if (r >= 8) Byte(0x41); Byte(0x58 | (r & 7)); }
+        void Ret()                      { Byte(0xC3); }
+        void MovRR64(int d, int s)      { OpRR(0, true, 0x8B, d, s); }
+        void MovRR32(int d, int s)      { OpRR(0, false, 0x8B, d, s); }
+        void MovRM64(int d, const Mem& m) { OpRM(0, true, 0x8B, d, m); }
+        void MovMR64(const Mem& m, int s) { OpRM(0, true, 0x89, s, m); }
+        void MovRI32(int d, std::uint32_t v) { Rex(false, 0, 0, d); Byte(0xB8 | (d & 7)); Dword(v); }
+        void MovRI64(int d, std::uint64_t v) { Rex(true, 0, 0, d); Byte(0xB8 | (d & 7)); Qword(v); }
+        void XorRR32(int d, int s)      { OpRR(0, false, 0x33, d, s); }
+        void Lea32(int d, const Mem& m) { OpRM(0, false, 0x8D, d, m); }
+        void CmpRM32(int r, const Mem& m) { OpRM(0, false, 0x3B, r, m); }
+        void CmpRI32(int r, std::uint32_t v) { OpRR(0, false, 0x81, 7, r); Dword(v); }
+        void SubRI32(int r, std::uint32_t v) { OpRR(0, false, 0x81, 5, r); Dword(v); }
+        void AddRI64(int r, std::uint32_t v) { OpRR(0, true, 0x81, 0, r); Dword(v); }
+        void SubRI64(int r, std::uint32_t v) { OpRR(0, true, 0x81, 5, r); Dword(v); }
+        void Inc32(int r)               { OpRR(0, false, 0xFF, 0, r); }
+        void Dec32(int r)               { OpRR(0, false, 0xFF, 1, r); }
+        void MovMI8(const Mem& m, unsigned int v) { OpRM(0, false, 0xC6, 0, m); Byte(v); }
+        void CmpMI8(const Mem& m, unsigned int v) { OpRM(0, false, 0x80, 7, m); Byte(v); }
+        void Setcc(int cc, int r8)      { OpRR(0, false, 0x0F90 | cc, 0, r8); }
+        void Movzx8(int d, int r8)      { OpRR(0, false, 0x0FB6, d, r8); }
+        void CallR(int r)               { OpRR(0, false, 0xFF, 2, r); }
+        void CallM(const Mem& m)        { OpRM(0, false, 0xFF, 2, m); }
+        void Jcc(int cc, int label);
+        void Jmp(int label);
+        void Call(int label);
+
+        // SSE2 instructions
+        void Movapd(int d, int s)       { if (d != s) OpRR(0x66, false, 0x0F28, d, s); }
+        void MovsdRM(int d, const Mem& m) { OpRM(0xF2, false, 0x0F10, d, m); }
+        void MovsdMR(const Mem& m, int s) { OpRM(0xF2, false, 0x0F11, s, m); }
+        void MovupdRM(int d, const Mem& m) { OpRM(0x66, false, 0x0F10, d, m); }
+        void MovupdMR(const Mem& m, int s) { OpRM(0x66, false, 0x0F11, s, m); }
+        void ArithRR(unsigned int op, int d, int s) { OpRR(0xF2, false, op, d, s); }
+        void ArithRM(unsigned int op, int d, const Mem& m) { OpRM(0xF2, false, op, d, m); }
+        void Ucomisd(int a, int b)      { OpRR(0x66, false, 0x0F2E, a, b); }
+        void AndpdRM(int d, const Mem& m) { OpRM(0x66, false, 0x0F54, d, m); }
+        void XorpdRM(int d, const Mem& m) { OpRM(0x66, false, 0x0F57, d, m); }
+        void Xorpd(int d, int s)        { OpRR(0x66, false, 0x0F57, d, s); }
+        void Cvtsi2sd(int d, int r)     { OpRR(0xF2, false, 0x0F2A, d, r); }
+
+        // translation helpers
+        Mem Spill(int r) const          { return Mem(RSP, kSpillOffset + 8 * r); }
+        void SpillRegs(int first)       { for (int r = first; r < 8; r++) MovsdMR(Spill(r), r); }
+        void ReloadRegs(int first)      { for (int r = first; r < 8; r++) MovsdRM(r, Spill(r)); }
+        void CallHelper(const void *fn) { MovRI64(RAX, (std::uint64_t)(std::uintptr_t)fn); CallR(RAX); }
+        void CheckBail();
+        void SetCCR();
+        void SetBool(int d);
+        void EmitMod(int d, const Mem *c, int s);
+        void EmitStub();
+        void EmitInstruction(unsigned int pc, Instruction w);
+        void Finish();
+};
+
+NativeCompiler::NativeCompiler(const FunctionCode& f, FUNCTION fn, const std::vector<DBL>& consts,
+                               const std::vector<FunctionEntry>& functions) :
+    bodyOffset(0),
+    mFunction(f),
+    mFn(fn),
+    mConsts(consts),
+    mFunctions(functions),
+    mExitLabel(-1),
+    mBailLabel(-1),
+    mLiteralSignMask(-1),
+    mLiteralAbsMask(-1)
+{}
+
+void NativeCompiler::Rex(bool w, int reg, int index, int base)
+{
+    unsigned int rex = (w ? 8 : 0) | ((reg & 8) ? 4 : 0) | ((index & 8) ? 2 : 0) | ((base & 8) ? 1 : 0);
+    if (rex != 0)
+        Byte(0x40 | rex);
+}
+
+void NativeCompiler::ModRM(int reg, const Mem& m)
+{
+    if (m.literal >= 0)
+    {
+        // RIP-relative; the displacement is fixed up once the literal pool is placed
+        Byte(0x05 | ((reg & 7) << 3));
+        mLiteralFixups.push_back({ code.size(), m.literal });
+        Dword(0);
+        return;
+    }
+
+    bool sib = (m.index >= 0) || ((m.base & 7) == RSP);
+    int mod = 2;
+    if ((m.disp == 0) && ((m.base & 7) != RBP))
+        mod = 0;
+    else if ((m.disp >= -128) && (m.disp <= 127))
+        mod = 1;
+
+    Byte((mod << 6) | ((reg & 7) << 3) | (sib ? 4 : (m.base & 7)));
+    if (sib)
+    {
+        int scale = (m.scale == 8 ? 3 : m.scale == 4 ? 2 : m.scale == 2 ? 1 : 0);
+        Byte((scale << 6) | (((m.index >= 0 ? m.index : RSP) & 7) << 3) | (m.base & 7));
+    }
+    if (mod == 1)
+        Byte((unsigned int)m.disp & 0xFF);
+    else if (mod == 2)
+        Dword((std::uint32_t)m.disp);
+}
+
+void NativeCompiler::OpRM(unsigned int prefix, bool w, unsigned int op, int reg, const Mem& m)
+{
+    if (prefix != 0)
+        Byte(prefix);
+    Rex(w, reg, (m.literal < 0 && m.index >= 0) ? m.index : 0, (m.literal < 0) ? m.base : 0);
+    if (op > 0xFF)
+        Byte(op >> 8);
+    Byte(op & 0xFF);
+    ModRM(reg, m);
+}
+
+void NativeCompiler::OpRR(unsigned int prefix, bool w, unsigned int op, int reg, int rm)
+{
+    if (prefix != 0)
+        Byte(prefix);
+    Rex(w, reg, 0, rm);
+    if (op > 0xFF)
+        Byte(op >> 8);
+    Byte(op & 0xFF);
+    ModRR(reg, rm);
+}
+
+void NativeCompiler::Jcc(int cc, int label)
+{
+    Byte(0x0F);
+    Byte(0x80 | cc);
+    mLabelFixups.push_back({ code.size(), label });
+    Dword(0);
+}
+
+void NativeCompiler::Jmp(int label)
+{
+    Byte(0xE9);
+    mLabelFixups.push_back({ code.size(), label });
+    Dword(0);
+}
+
+void NativeCompiler::Call(int label)
+{
+    Byte(0xE8);
+    mLabelFixups.push_back({ code.size(), label });
+    Dword(0);
+}
+
+/// Check whether the native code generator supports an instruction.
+bool NativeCompiler::Supported(Instruction w) const
+{
+    unsigned int op = GET_OP(w);
+    unsigned int k = GET_K(w);
+    unsigned int i = op >> 6;
+    unsigned int s = (op >> 3) & 7;
+    unsigned int d = op & 7;
+
+    switch (i)
+    {
+        case 0: case 1: case 2: case 3: case 4:     // add, sub, mul, div, mod
+        case 5: case 6: case 7: case 8:             // move, cmp, neg, abs
+        case 10:                                    // seq, sne, slt, sle, sgt, sge, teq, tne
+            return true;
+        case 9:                                     // addi, subi, muli, divi, modi, loadi, cmpi
+            return (s <= 6) && (k < mConsts.size());
+        case 11: case 12:                           // load, store
+            return (s <= 1);
+        case 13:                                    // beq, bne, blt, ble, bgt, bge
+            return (s <= 5) && (d == 0) && (k < mFunction.program_size);
+        case 14:                                    // xeq, xne, xlt, xle, xgt, xge, xdz
+            return (s <= 6);
+        case 15:
+            if (s == 0)
+            {
+                switch (d)
+                {
+                    case 1:  return (k < mFunction.program_size);   // jmp
+                    case 2:  return true;                           // rts
+                    case 3:                                         // call
+                        return (k < mFunctions.size()) && (mFunctions[k].reference_count > 0) &&
+                               (mFunctions[k].native != nullptr) &&
+                               (std::uint64_t(k) * sizeof(FunctionEntry) + sizeof(FunctionEntry) <= INT32_MAX);
+                    case 4:  return (k < POVFPU_Sys1TableSize);     // sys1
+                    case 5:  return (k < POVFPU_Sys2TableSize);     // sys2
+                    case 6:  return (k < POVFPU_TrapTableSize);     // trap
+                    case 7:  return (k < POVFPU_TrapSTableSize);    // traps
+                    default: return false;                          // jsr
+                }
+            }
+            else if (s == 1)
+                return (d <= 2) || (d == 5);                        // grow, push, pop, debug
+            else
+                return (s == 3) && (d == 7);                        // nop
+        default:
+            return false;
+    }
+}
+
+/// Check whether a helper asked to bail out.
+void NativeCompiler::CheckBail()
+{
+    CmpMI8(Mem(kRegState, offsetof(FunctionNativeState, bail)), 0);
+    Jcc(CC_NE, mBailLabel);
+}
+
+/// Set the condition code register from the flags of a preceding `ucomisd s, d`.
+void NativeCompiler::SetCCR()
+{
+    // ccr = ((s > d) << 1) | (s == d), with unordered operands comparing neither greater nor equal
+    Setcc(CC_A, RAX);
+    Setcc(CC_E, RCX);
+    Setcc(CC_NP, RDX);
+    Byte(0x20); ModRR(RDX, RCX);    // and cl, dl
+    Byte(0x00); ModRR(RAX, RAX);    // add al, al
+    Byte(0x08); ModRR(RCX, RAX);    // or al, cl
+    Movzx8(kRegCCR, RAX);
+}
+
+/// Convert the boolean in `al` to 0.0 or 1.0 in register `d`.
+void NativeCompiler::SetBool(int d)
+{
+    Movzx8(RAX, RAX);
+    Xorpd(d, d);
+    Cvtsi2sd(d, RAX);
+}
+
+/// Compute `fmod(rd, c)`, with `c` either a literal or register `s`.
+void NativeCompiler::EmitMod(int d, const Mem *c, int s)
+{
+    SpillRegs(0);
+    MovsdRM(0, Spill(d));
+    if (c != nullptr)
+        MovsdRM(1, *c);
+    else
+        MovsdRM(1, Spill(s));
+    CallHelper(reinterpret_cast<const void *>(POVFPU_Sys2Table[TRAP_SYS2_MOD]));
+    MovsdMR(Spill(d), 0);
+    ReloadRegs(0);
+}
+
+/// Emit the entry stub, which is called with the System V or Windows ABI.
+void NativeCompiler::EmitStub()
+{
+    int body = NewLabel();
+
+    Push(RBX);
+    Push(R12);
+    Push(R13);
+    Push(R14);
+    Push(R15);
+#ifdef _WIN64
+    // xmm6-xmm8 are callee-saved on Windows; this also re-aligns the stack
+    SubRI64(RSP, 48);
+    MovupdMR(Mem(RSP, 0), 6);
+    MovupdMR(Mem(RSP, 16), 7);
+    MovupdMR(Mem(RSP, 32), 8);
+#endif
+    MovRR64(kRegState, kRegArg[0]);
+    MovMR64(Mem(kRegState, offsetof(FunctionNativeState, hostStack)), RSP);
+    MovRM64(kRegStack, Mem(kRegState, offsetof(FunctionNativeState, dblstack)));
+    XorRR32(kRegSP, kRegSP);
+    XorRR32(kRegCCR, kRegCCR);
+    XorRR32(kRegDepth, kRegDepth);
+    for (int r = 0; r < 8; r++)
+        Xorpd(r, r);
+    Call(body);
+
+    Bind(mExitLabel);
+#ifdef _WIN64
+    MovupdRM(6, Mem(RSP, 0));
+    MovupdRM(7, Mem(RSP, 16));
+    MovupdRM(8, Mem(RSP, 32));
+    AddRI64(RSP, 48);
+#endif
+    Pop(R15);
+    Pop(R14);
+    Pop(R13);
+    Pop(R12);
+    Pop(RBX);
+    Ret();
+
+    // native code bails out by discarding all native frames
+    Bind(mBailLabel);
+    MovRM64(RSP, Mem(kRegState, offsetof(FunctionNativeState, hostStack)));
+    MovMI8(Mem(kRegState, offsetof(FunctionNativeState, bail)), 1);
+    Jmp(mExitLabel);
+
+    while (code.size() % 16 != 0)
+        Byte(0xCC);
+    bodyOffset = code.size();
+    Bind(body);
+    SubRI64(RSP, kFrameSize);
+}
+
+void NativeCompiler::EmitInstruction(unsigned int pc, Instruction w)
+{
+    unsigned int op = GET_OP(w);
+    unsigned int k = GET_K(w);
+    unsigned int i = op >> 6;
+    unsigned int s = (op >> 3) & 7;
+    unsigned int d = op & 7;
+    static const unsigned int kArith[4] = { 0x0F58, 0x0F5C, 0x0F59, 0x0F5E }; // addsd, subsd, mulsd, divsd
+
+    switch (i)
+    {
+        case 0: case 1: case 2: case 3:             // add/sub/mul/div Rs, Rd
+            ArithRR(kArith[i], d, s);
+            break;
+        case 4:                                     // mod   Rs, Rd
+            EmitMod(d, nullptr, s);
+            break;
+        case 5:                                     // move  Rs, Rd
+            Movapd(d, s);
+            break;
+        case 6:                                     // cmp   Rs, Rd
+            Ucomisd(s, d);
+            SetCCR();
+            break;
+        case 7:                                     // neg   Rs, Rd
+            Movapd(d, s);
+            XorpdRM(d, Mem::Literal(mLiteralSignMask));
+            break;
+        case 8:                                     // abs   Rs, Rd
+            Movapd(d, s);
+            AndpdRM(d, Mem::Literal(mLiteralAbsMask));
+            break;
+        case 9:
+        {
+            Mem c = Mem::Literal(Literal(mConsts[k]));
+            switch (s)
+            {
+                case 0: case 1: case 2: case 3:     // addi/subi/muli/divi k, Rd
+                    ArithRM(kArith[s], d, c);
+                    break;
+                case 4:                             // modi  k, Rd
+                    EmitMod(d, &c, 0);
+                    break;
+                case 5:                             // loadi k, Rd
+                    MovsdRM(d, c);
+                    break;
+                case 6:                             // cmpi  k, Rd
+                    MovsdRM(kRegScratch, c);
+                    Ucomisd(kRegScratch, d);
+                    SetCCR();
+                    break;
+            }
+            break;
+        }
+        case 10:
+            switch (s)
+            {
+                case 0: CmpRI32(kRegCCR, 1); Setcc(CC_E, RAX); break;   // seq   Rd
+                case 1: CmpRI32(kRegCCR, 1); Setcc(CC_NE, RAX); break;  // sne   Rd
+                case 2: CmpRI32(kRegCCR, 2); Setcc(CC_E, RAX); break;   // slt   Rd
+                case 3: CmpRI32(kRegCCR, 1); Setcc(CC_AE, RAX); break;  // sle   Rd
+                case 4: CmpRI32(kRegCCR, 0); Setcc(CC_E, RAX); break;   // sgt   Rd
+                case 5: CmpRI32(kRegCCR, 1); Setcc(CC_BE, RAX); break;  // sge   Rd
+                case 6:                                                 // teq   Rd
+                    Xorpd(kRegScratch, kRegScratch);
+                    Ucomisd(d, kRegScratch);
+                    Setcc(CC_E, RAX);
+                    Setcc(CC_NP, RCX);
+                    Byte(0x20); ModRR(RCX, RAX);    // and al, cl
+                    break;
+                case 7:                                                 // tne   Rd
+                    Xorpd(kRegScratch, kRegScratch);
+                    Ucomisd(d, kRegScratch);
+                    Setcc(CC_NE, RAX);
+                    Setcc(CC_P, RCX);
+                    Byte(0x08); ModRR(RCX, RAX);    // or al, cl
+                    break;
+            }
+            SetBool(d);
+            break;
+        case 11:                                    // load  0(k), Rd / load SP(k), Rd
+            if (s == 0)
+            {
+                MovRM64(RAX, Mem(kRegState, offsetof(FunctionNativeState, globals)));
+                MovsdRM(d, Mem(RAX, 8 * k));
+            }
+            else
+                MovsdRM(d, Mem(kRegStack, kRegSP, 8, 8 * k));
+            break;
+        case 12:                                    // store Rs, 0(k) / store Rs, SP(k)
+            if (s == 0)
+            {
+                MovRM64(RAX, Mem(kRegState, offsetof(FunctionNativeState, globals)));
+                MovsdMR(Mem(RAX, 8 * k), d);
+            }
+            else
+                MovsdMR(Mem(kRegStack, kRegSP, 8, 8 * k), d);
+            break;
+        case 13:
+            switch (s)
+            {
+                case 0: CmpRI32(kRegCCR, 1); Jcc(CC_E, k); break;       // beq   k
+                case 1: CmpRI32(kRegCCR, 1); Jcc(CC_NE, k); break;      // bne   k
+                case 2: CmpRI32(kRegCCR, 2); Jcc(CC_E, k); break;       // blt   k
+                case 3: CmpRI32(kRegCCR, 1); Jcc(CC_AE, k); break;      // ble   k
+                case 4: CmpRI32(kRegCCR, 0); Jcc(CC_E, k); break;       // bgt   k
+                case 5: CmpRI32(kRegCCR, 1); Jcc(CC_BE, k); break;      // bge   k
+            }
+            break;
+        case 14:
+        {
+            // the interpreter reports an exception; leave it to the interpreter to do so
+            int skip = NewLabel();
+            Xorpd(kRegScratch, kRegScratch);
+            switch (s)
+            {
+                case 0:                                                 // xeq   Rd
+                    Ucomisd(d, kRegScratch);
+                    Jcc(CC_P, skip);
+                    Jcc(CC_E, mBailLabel);
+                    break;
+                case 1:                                                 // xne   Rd
+                    Ucomisd(d, kRegScratch);
+                    Jcc(CC_P, mBailLabel);
+                    Jcc(CC_NE, mBailLabel);
+                    break;
+                case 2: Ucomisd(kRegScratch, d); Jcc(CC_A, mBailLabel); break;  // xlt   Rd
+                case 3: Ucomisd(kRegScratch, d); Jcc(CC_AE, mBailLabel); break; // xle   Rd
+                case 4: Ucomisd(d, kRegScratch); Jcc(CC_A, mBailLabel); break;  // xgt   Rd
+                case 5: Ucomisd(d, kRegScratch); Jcc(CC_AE, mBailLabel); break; // xge   Rd
+                case 6:                                                 // xdz   R0, Rd
+                    Ucomisd(0, kRegScratch);
+                    Jcc(CC_P, skip);
+                    Jcc(CC_NE, skip);
+                    Ucomisd(d, kRegScratch);
+                    Jcc(CC_P, skip);
+                    Jcc(CC_E, mBailLabel);
+                    break;
+            }
+            Bind(skip);
+            break;
+        }
+        case 15:
+            if (s == 0)
+            {
+                switch (d)
+                {
+                    case 1:                                                 // jmp   k
+                        Jmp(k);
+                        break;
+                    case 2:                                                 // rts
+                        AddRI64(RSP, kFrameSize);
+                        Ret();
+                        break;
+                    case 3:                                                 // call  k
+                    {
+                        const char *entry = reinterpret_cast<const char *>(&mFunctions[0]);
+                        const char *native = reinterpret_cast<const char *>(&mFunctions[0].native);
+                        Inc32(kRegDepth);
+                        CmpRI32(kRegDepth, MAX_CALL_STACK_SIZE);
+                        Jcc(CC_AE, mBailLabel);
+                        MovRM64(RAX, Mem(kRegState, offsetof(FunctionNativeState, functions)));
+                        MovRM64(RAX, Mem(RAX, std::int32_t(k * sizeof(FunctionEntry) + (native - entry))));
+                        CallM(Mem(RAX, offsetof(FunctionNativeCode, body)));
+                        Dec32(kRegDepth);
+                        break;
+                    }
+                    case 4:                                                 // sys1  k
+                        SpillRegs(1);
+                        CallHelper(reinterpret_cast<const void *>(POVFPU_Sys1Table[k]));
+                        ReloadRegs(1);
+                        break;
+                    case 5:                                                 // sys2  k
+                        SpillRegs(1);
+                        CallHelper(reinterpret_cast<const void *>(POVFPU_Sys2Table[k]));
+                        ReloadRegs(1);
+                        break;
+                    case 6:                                                 // trap  k
+                    case 7:                                                 // traps k
+                        SpillRegs(d == 6 ? 1 : 0);
+                        MovRR64(kRegArg[0], kRegState);
+                        MovRI32(kRegArg[1], k);
+                        MovRR32(kRegArg[2], kRegSP);
+                        MovRI32(kRegArg[3], mFn);
+                        if (d == 6)
+                            CallHelper(reinterpret_cast<const void *>(POVFPU_NativeTrap));
+                        else
+                            CallHelper(reinterpret_cast<const void *>(POVFPU_NativeTrapS));
+                        ReloadRegs(d == 6 ? 1 : 0);
+                        MovRM64(kRegStack, Mem(kRegState, offsetof(FunctionNativeState, dblstack)));
+                        CheckBail();
+                        break;
+                }
+            }
+            else if (s == 1)
+            {
+                switch (d)
+                {
+                    case 0:                                                 // grow  k
+                    {
+                        int skip = NewLabel();
+                        Lea32(RAX, Mem(kRegSP, std::int32_t(k)));
+                        CmpRI32(RAX, MAX_K);
+                        Jcc(CC_AE, mBailLabel);
+                        CmpRM32(RAX, Mem(kRegState, offsetof(FunctionNativeState, maxdblstacksize)));
+                        Jcc(CC_B, skip);
+                        SpillRegs(0);
+                        MovRR64(kRegArg[0], kRegState);
+                        MovRI32(kRegArg[1], k);
+                        CallHelper(reinterpret_cast<const void *>(POVFPU_NativeGrow));
+                        ReloadRegs(0);
+                        MovRM64(kRegStack, Mem(kRegState, offsetof(FunctionNativeState, dblstack)));
+                        CheckBail();
+                        Bind(skip);
+                        break;
+                    }
+                    case 1:                                                 // push  k
+                        Lea32(RAX, Mem(kRegSP, std::int32_t(k)));
+                        CmpRM32(RAX, Mem(kRegState, offsetof(FunctionNativeState, maxdblstacksize)));
+                        Jcc(CC_AE, mBailLabel);
+                        MovRR32(kRegSP, RAX);
+                        break;
+                    case 2:                                                 // pop   k
+                        CmpRI32(kRegSP, k);
+                        Jcc(CC_B, mBailLabel);
+                        SubRI32(kRegSP, k);
+                        break;
+                }
+            }
+            break;
+    }
+}
+
+/// Place the literal pool and resolve all references.
+void NativeCompiler::Finish()
+{
+    while (code.size() % 16 != 0)
+        Byte(0xCC);
+
+    std::size_t pool = code.size();
+    for (std::vector<DBL>::const_iterator i = mLiterals.begin(); i != mLiterals.end(); i++)
+    {
+        std::uint64_t bits;
+        std::memcpy(&bits, &(*i), sizeof(bits));
+        Qword(bits);
+    }
+
+    for (std::vector<Fixup>::const_iterator i = mLiteralFixups.begin(); i != mLiteralFixups.end(); i++)
+    {
+        std::int32_t rel = std::int32_t(pool + 8 * i->target - (i->pos + 4));
+        std::memcpy(&code[i->pos], &rel, sizeof(rel));
+    }
+
+    for (std::vector<Fixup>::const_iterator i = mLabelFixups.begin(); i != mLabelFixups.end(); i++)
+    {
+        std::int32_t rel = std::int32_t(mLabels[i->target] - (i->pos + 4));
+        std::memcpy(&code[i->pos], &rel, sizeof(rel));
+    }
+}
+
+bool NativeCompiler::Compile()
+{
+    if ((mFunction.program == nullptr) || (mFunction.program_size == 0))
+        return false;
+    for (unsigned int pc = 0; pc < mFunction.program_size; pc++)
+    {
+        if (!Supported(mFunction.program[pc]))
+            return false;
+    }
+
+    // labels 0 to program_size-1 are the VM instructions
+    for (unsigned int pc = 0; pc < mFunction.program_size; pc++)
+        (void)NewLabel();
+    mExitLabel = NewLabel();
+    mBailLabel = NewLabel();
+
+    // sign and absolute value masks come first, as they need to be 16-byte aligned
+    mLiteralSignMask = Literal(-0.0);
+    (void)Literal(0.0);
+    std::uint64_t absMask = 0x7FFFFFFFFFFFFFFFull;
+    DBL absMaskValue;
+    std::memcpy(&absMaskValue, &absMask, sizeof(absMaskValue));
+    mLiteralAbsMask = Literal(absMaskValue);
+    (void)Literal(0.0);
+
+    EmitStub();
+
+    for (unsigned int pc = 0; pc < mFunction.program_size; pc++)
+    {
+        Bind(pc);
+        EmitInstruction(pc, mFunction.program[pc]);
+    }
+
+    // the interpreter would run off the end of the program here
+    Jmp(mBailLabel);
+
+    Finish();
+    return true;
+}
+
+}
+// end of anonymous namespace
+
+FunctionNativeCode *POVFPU_CompileNative(const FunctionCode& f, FUNCTION fn,
+                                         const std::vector<DBL>& consts,
+                                         const std::vector<FunctionEntry>& functions)
+{
+    NativeCompiler compiler(f, fn, consts, functions);
+    if (!compiler.Compile())
+        return nullptr;
+
+    std::size_t header = (sizeof(FunctionNativeCode) + 15) & ~std::size_t(15);
+    std::size_t size = header + compiler.code.size();
+
+#ifdef _WIN32
+    void *block = VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    if (block == nullptr)
+        return nullptr;
+#else
+    void *block = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (block == MAP_FAILED)
+        return nullptr;
+#endif
+
+    unsigned char *base = reinterpret_cast<unsigned char *>(block);
+    FunctionNativeCode *code = reinterpret_cast<FunctionNativeCode *>(block);
+    code->entry = base + header;
+    code->body = base + header + compiler.bodyOffset;
+    code->size = size;
+    std::memcpy(base + header, compiler.code.data(), compiler.code.size());
+
+    // never map memory writable and executable at the same time
+#ifdef _WIN32
+    DWORD oldProtect;
+    if (!VirtualProtect(block, size, PAGE_EXECUTE_READ, &oldProtect))
+    {
+        VirtualFree(block, 0, MEM_RELEASE);
+        return nullptr;
+    }
+    FlushInstructionCache(GetCurrentProcess(), block, size);
+#else
+    if (mprotect(block, size, PROT_READ | PROT_EXEC) != 0)
+    {
+        munmap(block, size);
+        return nullptr;
+    }
+#endif
+
+    return code;
+}
+
+void POVFPU_ReleaseNative(FunctionNativeCode *code)
+{
+    if (code == nullptr)
+        return;
+#ifdef _WIN32
+    VirtualFree(code, 0, MEM_RELEASE);
+#else
+    munmap(code, code->size);
+#endif
+}
+
+DBL POVFPU_RunNative(const FunctionNativeCode *code, FunctionNativeState& state)
+{
+    return reinterpret_cast<NativeEntry>(const_cast<void *>(code->entry))(&state);
+}
+
+}
+// end of namespace pov
+
+#endif // TRY_OPTIMIZED_FUNCTIONS
@@ -55,6 +55,10 @@
 #include "avx/avxportablenoise.h"
 #endif
 
+#ifdef TRY_OPTIMIZED_NOISE_AVX512F_PORTABLE
+#include "avx512f/avx512fportablenoise.h"
+#endif
+
 #include "cpuid.h"
 
 #ifdef TRY_OPTIMIZED_NOISE
@@ -65,6 +69,7 @@ namespace pov
 static bool AVXSupported()      { return CPUInfo::SupportsAVX(); }
 static bool AVXFMA4Supported()  { return CPUInfo::SupportsAVX() && CPUInfo::SupportsFMA4(); }
 static bool AVX2FMA3Supported() { return CPUInfo::SupportsAVX2() && CPUInfo::SupportsFMA3(); }
+static bool AVX512FSupported()  { return CPUInfo::SupportsAVX2() && CPUInfo::SupportsAVX512F(); }
 
 /// List of optimized noise implementations.
 ///
@@ -78,6 +83,8 @@ OptimizedNoiseInfo gaOptimizedNoiseInfo[] = {
         "hand-optimized by Intel",  // info,
         AVX2FMA3Noise,              // noise,
         AVX2FMA3DNoise,             // dNoise,
+        AVX2FMA3MultiNoise,         // multiNoise,
+        AVX2FMA3MultiDNoise,        // multiDNoise,
         &kAVX2FMA3NoiseEnabled,     // enabled,
         AVX2FMA3Supported,          // supported,
         CPUInfo::IsIntel,           // recommended,
@@ -90,6 +97,8 @@ OptimizedNoiseInfo gaOptimizedNoiseInfo[] = {
         "hand-optimized by AMD, 2017-04 update", // info,
         AVXFMA4Noise,               // noise,
         AVXFMA4DNoise,              // dNoise,
+        nullptr,                    // multiNoise,
+        nullptr,                    // multiDNoise,
         &kAVXFMA4NoiseEnabled,      // enabled,
         AVXFMA4Supported,           // supported,
         nullptr,                    // recommended,
@@ -102,18 +111,36 @@ OptimizedNoiseInfo gaOptimizedNoiseInfo[] = {
         "hand-optimized by Intel",  // info,
         AVXNoise,                   // noise,
         AVXDNoise,                  // dNoise,
+        nullptr,                    // multiNoise,
+        nullptr,                    // multiDNoise,
         &kAVXNoiseEnabled,          // enabled,
         AVXSupported,               // supported,
         CPUInfo::IsIntel,           // recommended,
         AVXNoiseInit                // init
     },
 #endif
+#ifdef TRY_OPTIMIZED_NOISE_AVX512F_PORTABLE
+    {
+        "avx512f-generic",          // name,
+        "compiler-optimized",       // info,
+        AVX512FPortableNoise,       // noise,
+        AVX512FPortableDNoise,      // dNoise,
+        nullptr,                    // multiNoise,
+        nullptr,                    // multiDNoise,
+        &kAVX512FPortableNoiseEnabled, // enabled,
+        AVX512FSupported,           // supported,
+        nullptr,                    // recommended,
+        nullptr                     // init
+    },
+#endif
 #ifdef TRY_OPTIMIZED_NOISE_AVX_PORTABLE
     {
         "avx-generic",              // name,
         "compiler-optimized",       // info,
         AVXPortableNoise,           // noise,
         AVXPortableDNoise,          // dNoise,
+        nullptr,                    // multiNoise,
+        nullptr,                    // multiDNoise,
         &kAVXPortableNoiseEnabled,  // enabled,
         AVXSupported,               // supported,
         nullptr,                    // recommended,
@@ -0,0 +1,80 @@
+//******************************************************************************
+///
+/// @file platform/x86/optimizedtransform.cpp
+///
+/// Definitions related to the dynamic dispatch of the optimized vector
+/// transformation implementations for the x86 family of CPUs.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+// Unit header file must be the first file included within POV-Ray *.cpp files (pulls in config)
+#include "optimizedtransform.h"
+
+#include "core/math/matrix.h"
+
+#ifdef TRY_OPTIMIZED_TRANSFORM_AVX2FMA3
+#include "avx2fma3/avx2fma3transform.h"
+#endif
+
+#include "cpuid.h"
+
+#ifdef TRY_OPTIMIZED_TRANSFORM
+
+namespace pov
+{
+
+static bool AVX2FMA3Supported() { return CPUInfo::SupportsAVX2() && CPUInfo::SupportsFMA3(); }
+
+/// List of optimized vector transformation implementations.
+///
+/// @note
+///     Entries must be listed in descending order of preference.
+///
+OptimizedTransformInfo gaOptimizedTransformInfo[] = {
+#ifdef TRY_OPTIMIZED_TRANSFORM_AVX2FMA3
+    {
+        "avx2fma3-generic",                     // name,
+        "4x4 matrix rows, fused multiply-add",  // info,
+        AVX2FMA3TransformPoints,                // transformPoints,
+        AVX2FMA3TransformDirections,            // transformDirections,
+        AVX2FMA3InvTransformNormals,            // invTransformNormals,
+        AVX2FMA3TransformRays,                  // transformRays,
+        &kAVX2FMA3TransformEnabled,             // enabled,
+        AVX2FMA3Supported                       // supported
+    },
+#endif
+    // End-of-list entry.
+    { nullptr }
+};
+
+}
+// end of namespace pov
+
+#endif // TRY_OPTIMIZED_TRANSFORM
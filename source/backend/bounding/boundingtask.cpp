@@ -40,25 +40,41 @@
 //  (none at the moment)
 
 // C++ standard header files
+#include <algorithm>
+#include <map>
+#include <memory>
 #include <set>
+#include <string>
 #include <vector>
 
 // Boost header files
 #include <boost/bind.hpp>
 
 // POV-Ray header files (base module)
-//  (none at the moment)
+#include "base/fileinputoutput.h"
+#include "base/filesystem.h"
+#include "base/path.h"
+#include "base/stringutilities.h"
 
 // POV-Ray header files (core module)
 #include "core/bounding/bsptree.h"
+#include "core/bounding/bvhtree.h"
+#include "core/bounding/compactbboxtree.h"
+#include "core/lighting/lightsource.h"
+#include "core/lighting/lighttree.h"
 #include "core/math/matrix.h"
+#include "core/scene/atmosphere.h"
 #include "core/scene/object.h"
 #include "core/scene/tracethreaddata.h"
+#include "core/shape/box.h"
+#include "core/shape/csg.h"
+#include "core/shape/plane.h"
 
 // POV-Ray header files (POVMS module)
 #include "povms/povmsid.h"
 
 // POV-Ray header files (backend module)
+#include "backend/control/messagefactory.h"
 #include "backend/scene/backendscenedata.h"
 #include "backend/support/task.h"
 
@@ -70,6 +86,144 @@ namespace pov
 
 using std::vector;
 
+/// Bounding cache file signature.
+const POV_UINT32 kBoundingCacheMagic = 0x43425650; // "PVBC" in little-endian byte order
+/// Bounding cache file format version; must be changed whenever the format of the stored data changes.
+const POV_UINT32 kBoundingCacheVersion = 2;
+
+/// Bounding cache file header.
+struct BoundingCacheHeader final
+{
+    POV_UINT32 magic;
+    POV_UINT32 version;
+    POV_UINT32 method;
+    POV_UINT32 objects;
+    /// hash of everything the hierarchy depends on
+    POV_UINT64 key;
+    /// hash of everything except the object bounds; if only this matches, the hierarchy may still be refit
+    POV_UINT64 topologyKey;
+    /// cost of the hierarchy as originally built (wide BVH only)
+    float cost;
+    POV_UINT32 reserved;
+};
+
+/// Bounding statistics stored alongside the BSP tree in the bounding cache file.
+struct BoundingCacheBSPStatistics final
+{
+    POV_UINT32 nodes, splitNodes, objectNodes, emptyNodes, maxObjects, maxDepth, aborts;
+    float averageObjects, averageDepth, averageAborts, averageAbortObjects;
+};
+
+/// Bounding statistics stored alongside the wide BVH in the bounding cache file.
+struct BoundingCacheBVHStatistics final
+{
+    POV_UINT32 nodes, leafNodes, maxObjects, maxDepth;
+    float averageObjects, averageDepth;
+};
+
+/// Compute 64-bit FNV-1a hash.
+static POV_UINT64 HashData(POV_UINT64 hash, const void *data, size_t size)
+{
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(data);
+
+    for(size_t i = 0; i < size; i++)
+        hash = (hash ^ p[i]) * 0x100000001B3ull;
+
+    return hash;
+}
+
+/// Maximum number of objects or nodes listed individually by the bounding analysis.
+const size_t kBoundingAnalysisMaxListed = 5;
+
+/// Describe an object by the place it was defined at in the scene.
+static std::string DescribeObject(ConstObjectPtr object, const vector<UCS2String>& sourceFiles)
+{
+    if ((object->sourceLine > 0) && (object->sourceFile < sourceFiles.size()))
+        return UCS2toSysString(Path(sourceFiles[object->sourceFile]).GetFile()) + ":" + std::to_string(object->sourceLine);
+    return "(unknown)";
+}
+
+static DBL SurfaceArea(const BoundingBox& box)
+{
+    return 2.0 * (DBL(box.size[X]) * box.size[Y] + DBL(box.size[Y]) * box.size[Z] + DBL(box.size[Z]) * box.size[X]);
+}
+
+static DBL Volume(const BoundingBox& box)
+{
+    return DBL(box.size[X]) * box.size[Y] * box.size[Z];
+}
+
+static DBL OverlapVolume(const BoundingBox& a, const BoundingBox& b)
+{
+    DBL volume = 1.0;
+    for (int axis = X; axis <= Z; axis++)
+    {
+        DBL lo = std::max(a.lowerLeft[axis], b.lowerLeft[axis]);
+        DBL hi = std::min(a.lowerLeft[axis] + a.size[axis], b.lowerLeft[axis] + b.size[axis]);
+        if (hi <= lo)
+            return 0.0;
+        volume *= hi - lo;
+    }
+    return volume;
+}
+
+/// Test whether an object's manual bounds cannot rule out any ray that its bounding box doesn't already.
+///
+/// This is the case if the bounds are plain boxes containing the bounding box. As inside tests
+/// ignore the bounds, such bounds only cost time.
+///
+static bool BoundIsUseless(ConstObjectPtr object)
+{
+    BBoxVector3d mins, maxs;
+
+    if (object->Bound.empty())
+        return false;
+
+    Make_min_max_from_BBox(mins, maxs, object->BBox);
+
+    for (vector<ObjectPtr>::const_iterator i(object->Bound.begin()); i != object->Bound.end(); i++)
+    {
+        const Box *box = dynamic_cast<const Box *>(*i);
+        if ((box == nullptr) || (box->Trans != nullptr) || Test_Flag(box, INVERTED_FLAG))
+            return false;
+        for (int axis = X; axis <= Z; axis++)
+            if ((box->bounds[0][axis] > mins[axis]) || (box->bounds[1][axis] < maxs[axis]))
+                return false;
+    }
+
+    return true;
+}
+
+/// Test whether an object is a union that can be replaced by its children.
+///
+/// This mirrors the conditions under which the parser splits unions, so that unions are only
+/// flattened here if the parser refrained from splitting them because of their manual bounds.
+///
+static bool CanFlatten(ConstObjectPtr object)
+{
+    const CSG *csg = dynamic_cast<const CSGUnion *>(object);
+
+    return (csg != nullptr) && (dynamic_cast<const CSGMerge *>(object) == nullptr) &&
+           object->Bound.empty() && object->Clip.empty() && csg->do_split &&
+           ((object->Type & LIGHT_GROUP_OBJECT) != LIGHT_GROUP_OBJECT);
+}
+
+/// Find the object with the largest bounding box in a bounding box subtree.
+static ConstObjectPtr LargestObject(const BBOX_TREE *node)
+{
+    if (node->Entries == 0)
+        return reinterpret_cast<ConstObjectPtr>(node->Node);
+
+    ConstObjectPtr largest = nullptr;
+    for (short i = 0; i < node->Entries; i++)
+    {
+        ConstObjectPtr candidate = LargestObject(node->Node[i]);
+        if ((largest == nullptr) || (SurfaceArea(candidate->BBox) > SurfaceArea(largest->BBox)))
+            largest = candidate;
+    }
+    return largest;
+}
+
 class SceneObjects final : public BSPTree::Objects
 {
     public:
@@ -149,10 +303,11 @@ class BSPProgress final : public BSPTree::Progress
         BSPProgress() = delete;
 };
 
-BoundingTask::BoundingTask(std::shared_ptr<BackendSceneData> sd, unsigned int bt, size_t seed) :
+BoundingTask::BoundingTask(std::shared_ptr<BackendSceneData> sd, unsigned int bt, unsigned int threads, size_t seed) :
     SceneTask(new TraceThreadData(std::dynamic_pointer_cast<SceneData>(sd), seed), boost::bind(&BoundingTask::SendFatalError, this, _1), "Bounding", sd),
     sceneData(sd),
-    boundingThreshold(bt)
+    boundingThreshold(bt),
+    buildThreads(threads)
 {
 }
 
@@ -167,6 +322,17 @@ void BoundingTask::AppendObject(ObjectPtr p)
 
 void BoundingTask::Run()
 {
+    MessageFactory messages(sceneData->warningLevel, "Bounding", sceneData->backendAddress, sceneData->frontendAddress, sceneData->sceneId, 0);
+    bool analyze = sceneData->boundingAnalysis && (sceneData->boundingMethod != 0);
+
+    // this changes the objects, so it must come first
+    if(analyze)
+        OptimizeObjects(messages);
+
+    BuildLightTree();
+    BuildLightReach();
+    BakeSkysphere();
+
     if((sceneData->objects.size() < boundingThreshold) || (sceneData->boundingMethod == 0))
     {
         SceneObjects objects(sceneData->objects);
@@ -176,8 +342,50 @@ void BoundingTask::Run()
         return;
     }
 
+    bool useCache = !sceneData->boundingCacheFile.empty() || (sceneData->sceneBundle != nullptr);
+    POV_UINT64 cacheKey = 0;
+    POV_UINT64 topologyKey = 0;
+
+    if(useCache)
+    {
+        // the keys must be computed before the objects are re-ordered below
+        cacheKey = ComputeCacheKey(true);
+        topologyKey = ComputeCacheKey(false);
+        if(ReadCache(cacheKey, topologyKey) == true)
+        {
+            if(analyze)
+                ReportHierarchy(messages);
+            CompactBoundingSlabs();
+            BuildPlaneSet();
+            return;
+        }
+    }
+
     switch(sceneData->boundingMethod)
     {
+        case 3:
+        {
+            // wide BVH code
+            SceneObjects objects(sceneData->objects);
+            BSPProgress progress(sceneData->sceneId, sceneData->frontendAddress, *this);
+            BVHTree::Statistics stats;
+
+            sceneData->objects.clear();
+            sceneData->objects.insert(sceneData->objects.end(), objects.finite.begin(), objects.finite.end());
+            sceneData->objects.insert(sceneData->objects.end(), objects.infinite.begin(), objects.infinite.end());
+            sceneData->numberOfFiniteObjects = objects.finite.size();
+            sceneData->numberOfInfiniteObjects = objects.infinite.size() - objects.numLights;
+            sceneData->bvhTree = BVHTree::Create(sceneData->bvhWidth);
+            sceneData->bvhTree->build(progress, objects, stats);
+
+            sceneData->nodes = stats.nodes;
+            sceneData->objectNodes = stats.leafNodes;
+            sceneData->maxObjects = stats.maxObjects;
+            sceneData->averageObjects = stats.averageObjects;
+            sceneData->maxDepth = stats.maxDepth;
+            sceneData->averageDepth = stats.averageDepth;
+            break;
+        }
         case 2:
         {
             // new BSP tree code
@@ -193,7 +401,8 @@ void BoundingTask::Run()
             sceneData->tree->build(progress, objects,
                                    sceneData->nodes, sceneData->splitNodes, sceneData->objectNodes, sceneData->emptyNodes,
                                    sceneData->maxObjects, sceneData->averageObjects, sceneData->maxDepth, sceneData->averageDepth,
-                                   sceneData->aborts, sceneData->averageAborts, sceneData->averageAbortObjects, sceneData->inputFile);
+                                   sceneData->aborts, sceneData->averageAborts, sceneData->averageAbortObjects, sceneData->inputFile,
+                                   buildThreads, sceneData->bspDepthTimes);
             break;
         }
         case 1:
@@ -206,6 +415,556 @@ void BoundingTask::Run()
             break;
         }
     }
+
+    if(useCache)
+        WriteCache(cacheKey, topologyKey);
+
+    if(analyze)
+        ReportHierarchy(messages);
+
+    CompactBoundingSlabs();
+    BuildPlaneSet();
+}
+
+// The BSP and BVH trees only hold the finite objects, so the planes among the infinite objects
+// can be re-ordered freely.
+void BoundingTask::BuildPlaneSet()
+{
+    if(sceneData->planeSet != nullptr)
+    {
+        delete sceneData->planeSet;
+        sceneData->planeSet = nullptr;
+    }
+
+    if((sceneData->boundingMethod != 2) && (sceneData->boundingMethod != 3))
+        return;
+
+    sceneData->planeSet = PlaneSet::Create(sceneData->objects.begin() + sceneData->numberOfFiniteObjects, sceneData->objects.end());
+}
+
+void BoundingTask::BuildLightTree()
+{
+    if(sceneData->lightTree != nullptr)
+    {
+        delete sceneData->lightTree;
+        sceneData->lightTree = nullptr;
+    }
+
+    if((sceneData->lightThreshold <= 0.0) || sceneData->lightSources.empty())
+        return;
+
+    std::unique_ptr<LightTree> tree(new LightTree(sceneData->lightSources, sceneData->lightThreshold));
+
+    // without any light sources to cull the hierarchy would only cost time
+    if(tree->BoundedCount() > 0)
+        sceneData->lightTree = tree.release();
+}
+
+// Each object gets the list of global light sources that may reach its bounding box, so that
+// shading need not consider the others; identical lists are shared, and objects reached by all
+// light sources (including all infinite objects) get none at all.
+void BoundingTask::BuildLightReach()
+{
+    typedef std::map<std::vector<size_t>, std::shared_ptr<const std::vector<size_t>>> ReachListMap;
+
+    const std::vector<LightSource*>& lights = sceneData->lightSources;
+    ReachListMap lists;
+    std::vector<size_t> indices;
+    std::vector<ObjectPtr> pending(sceneData->objects);
+
+    while (!pending.empty())
+    {
+        ObjectPtr object = pending.back();
+        pending.pop_back();
+
+        object->ReachingLights.reset();
+
+        if (object->Type & IS_COMPOUND_OBJECT)
+        {
+            const std::vector<ObjectPtr>& children = static_cast<CSG *>(object)->children;
+            pending.insert(pending.end(), children.begin(), children.end());
+        }
+
+        if (lights.empty() || Test_Flag(object, INFINITE_FLAG) || Test_Flag(object, NO_GLOBAL_LIGHTS_FLAG) ||
+            (object->Type & LIGHT_SOURCE_OBJECT) || (object->BBox.size[X] >= BOUND_HUGE / 2) ||
+            (object->BBox.size[Y] >= BOUND_HUGE / 2) || (object->BBox.size[Z] >= BOUND_HUGE / 2))
+            continue;
+
+        Compute_Light_Reach(lights, sceneData->lightThreshold, object->BBox, indices);
+
+        // no need for a list if it does not rule out anything
+        if (indices.size() == lights.size())
+        {
+            bool all = true;
+            for (size_t i : indices)
+                all = all && !(i & LIGHT_REACH_PROJECTED_ONLY);
+            if (all)
+                continue;
+        }
+
+        std::shared_ptr<const std::vector<size_t>>& list = lists[indices];
+        if (list == nullptr)
+            list = std::make_shared<const std::vector<size_t>>(indices);
+        object->ReachingLights = list;
+    }
+}
+
+void BoundingTask::BakeSkysphere()
+{
+    SKYSPHERE *skysphere = sceneData->skysphere;
+
+    if((skysphere == nullptr) || (skysphere->CacheResolution == 0) || (sceneData->EffectiveLanguageVersion() < 370))
+        return;
+
+    std::shared_ptr<SkysphereCache> cache(new SkysphereCache(skysphere->CacheResolution));
+    cache->Bake(skysphere, GetSceneDataPtr());
+    skysphere->Cache = cache;
+}
+
+// Manual bounds that cannot rule out any ray are removed, and unions that the parser kept
+// together only because of such bounds are replaced by their children, so that the
+// children go into the top-level hierarchy on their own.
+void BoundingTask::OptimizeObjects(GenericMessenger& messages)
+{
+    vector<ObjectPtr> objects;
+    vector<ObjectPtr> pending(sceneData->objects.rbegin(), sceneData->objects.rend());
+    size_t boundsRemoved = 0, unionsFlattened = 0;
+
+    objects.reserve(sceneData->objects.size());
+
+    while(!pending.empty())
+    {
+        ObjectPtr object = pending.back();
+        pending.pop_back();
+
+        if(BoundIsUseless(object))
+        {
+            if(++boundsRemoved <= kBoundingAnalysisMaxListed)
+                messages.Info("Bounding object of object at %s removed, as it is no tighter than the automatic bounds.",
+                              DescribeObject(object, sceneData->sourceFiles).c_str());
+
+            // the bounding object may double as the clipping object
+            if(object->Bound != object->Clip)
+                Destroy_Object(object->Bound);
+            object->Bound.clear();
+        }
+
+        if(CanFlatten(object))
+        {
+            CSG *csg = static_cast<CSG *>(object);
+
+            if(++unionsFlattened <= kBoundingAnalysisMaxListed)
+                messages.Info("Union at %s split into %u objects.",
+                              DescribeObject(object, sceneData->sourceFiles).c_str(), unsigned(csg->children.size()));
+
+            // the children are examined in turn, in their original order
+            for(vector<ObjectPtr>::reverse_iterator i(csg->children.rbegin()); i != csg->children.rend(); i++)
+            {
+                (*i)->Type &= ~IS_CHILD_OBJECT;
+                pending.push_back(*i);
+            }
+
+            // the children stem from the same input as the union, for the purpose of incremental rendering
+            std::map<ConstObjectPtr, SceneData::ObjectFingerprint>::iterator fingerprint = sceneData->objectFingerprints.find(object);
+            if(fingerprint != sceneData->objectFingerprints.end())
+            {
+                SceneData::ObjectFingerprint entry = fingerprint->second;
+                sceneData->objectFingerprints.erase(fingerprint);
+                for(vector<ObjectPtr>::iterator i(csg->children.begin()); i != csg->children.end(); i++)
+                    sceneData->objectFingerprints[*i] = entry;
+            }
+
+            csg->children.clear();
+            Destroy_Object(object);
+            continue;
+        }
+
+        objects.push_back(object);
+    }
+
+    if((boundsRemoved > 0) || (unionsFlattened > 0))
+        messages.Info("%u useless bounding objects removed, %u unions split.", unsigned(boundsRemoved), unsigned(unionsFlattened));
+
+    sceneData->objects.swap(objects);
+}
+
+void BoundingTask::ReportHierarchy(GenericMessenger& messages)
+{
+    const vector<UCS2String>& sourceFiles = sceneData->sourceFiles;
+    vector<ConstObjectPtr> infinite, finite;
+    BBoxVector3d sceneMin(BOUND_HUGE), sceneMax(-BOUND_HUGE);
+
+    for(vector<ObjectPtr>::const_iterator i(sceneData->objects.begin()); i != sceneData->objects.end(); i++)
+    {
+        if(((*i)->Type & LIGHT_SOURCE_OBJECT) != 0)
+            continue;
+
+        if(Test_Flag((*i), INFINITE_FLAG))
+            infinite.push_back(*i);
+        else
+        {
+            BBoxVector3d mins, maxs;
+            Make_min_max_from_BBox(mins, maxs, (*i)->BBox);
+            for(int axis = X; axis <= Z; axis++)
+            {
+                sceneMin[axis] = std::min(sceneMin[axis], mins[axis]);
+                sceneMax[axis] = std::max(sceneMax[axis], maxs[axis]);
+            }
+            finite.push_back(*i);
+        }
+    }
+
+    messages.Info("%u finite and %u infinite objects (not counting light sources).", unsigned(finite.size()), unsigned(infinite.size()));
+
+    // every ray is tested against every infinite object
+    for(size_t i = 0; i < std::min(infinite.size(), kBoundingAnalysisMaxListed); i++)
+        messages.Info("Infinite object at %s is tested for every ray.", DescribeObject(infinite[i], sourceFiles).c_str());
+
+    if(finite.empty())
+        return;
+
+    BoundingBox sceneBox;
+    Make_BBox_from_min_max(sceneBox, sceneMin, sceneMax);
+    DBL sceneArea = SurfaceArea(sceneBox);
+
+    // objects spanning much of the scene are hit by many rays, and spoil the hierarchy for everything around them
+    if((finite.size() > kBoundingAnalysisMaxListed) && (sceneArea > 0.0))
+    {
+        std::sort(finite.begin(), finite.end(), [](ConstObjectPtr a, ConstObjectPtr b) { return SurfaceArea(a->BBox) > SurfaceArea(b->BBox); });
+        for(size_t i = 0; (i < kBoundingAnalysisMaxListed) && (SurfaceArea(finite[i]->BBox) >= 0.5 * sceneArea); i++)
+            messages.Info("Object at %s spans %.0f%% of the scene's surface area.",
+                          DescribeObject(finite[i], sourceFiles).c_str(), 100.0 * SurfaceArea(finite[i]->BBox) / sceneArea);
+    }
+
+    switch(sceneData->boundingMethod)
+    {
+        case 3:
+            messages.Info("Wide BVH: %u nodes, maximum depth %u, average depth %.1f, SAH cost %.2f times that of testing every object's box.",
+                          sceneData->nodes, sceneData->maxDepth, sceneData->averageDepth,
+                          sceneData->bvhTree->ComputeCost(SceneObjects(sceneData->objects)));
+            break;
+
+        case 2:
+            messages.Info("BSP tree: %u nodes, maximum depth %u, average depth %.1f, %.1f objects per leaf on average.",
+                          sceneData->nodes, sceneData->maxDepth, sceneData->averageDepth, sceneData->averageObjects);
+            break;
+
+        case 1:
+        {
+            if(sceneData->boundingSlabs == nullptr)
+                break;
+
+            // The cost is the expected number of box and object tests for a ray hitting the scene, assuming the
+            // chance of hitting each node is proportional to its surface area. The overlap ratio is the part of
+            // the nodes' volume covered by more than one of their children (counting multiple overlaps repeatedly).
+            typedef std::pair<const BBOX_TREE *, unsigned int> NodeEntry;
+            typedef std::pair<DBL, const BBOX_TREE *> NodeOverlap;
+            vector<NodeEntry> stack(1, NodeEntry(sceneData->boundingSlabs, 0));
+            vector<NodeOverlap> overlaps;
+            DBL cost = 0.0, depthSum = 0.0, overlapVolume = 0.0, nodeVolume = 0.0;
+            unsigned int maxDepth = 0, leaves = 0;
+
+            while(!stack.empty())
+            {
+                const BBOX_TREE *node = stack.back().first;
+                unsigned int depth = stack.back().second;
+                stack.pop_back();
+
+                DBL chance = (node->Infinite || (sceneArea <= 0.0)) ? 1.0 : std::min(1.0, SurfaceArea(node->BBox) / sceneArea);
+
+                if(node->Entries == 0)
+                {
+                    cost += chance;
+                    depthSum += depth;
+                    maxDepth = std::max(maxDepth, depth);
+                    leaves++;
+                    continue;
+                }
+
+                cost += chance * node->Entries;
+
+                if(!node->Infinite)
+                {
+                    DBL overlap = 0.0;
+                    for(short i = 0; i < node->Entries; i++)
+                        for(short j = i + 1; j < node->Entries; j++)
+                            overlap += OverlapVolume(node->Node[i]->BBox, node->Node[j]->BBox);
+                    overlapVolume += overlap;
+                    nodeVolume += Volume(node->BBox);
+                    if(overlap > 0.0)
+                        overlaps.push_back(NodeOverlap(overlap, node));
+                }
+
+                for(short i = 0; i < node->Entries; i++)
+                    stack.push_back(NodeEntry(node->Node[i], depth + 1));
+            }
+
+            messages.Info("Bounding slabs: SAH cost %.1f tests per ray, maximum depth %u, average depth %.1f, overlap ratio %.2f.",
+                          cost, maxDepth, (leaves > 0) ? depthSum / leaves : 0.0, (nodeVolume > 0.0) ? overlapVolume / nodeVolume : 0.0);
+
+            // report the nodes with the most overlap, along with the largest objects in their most overlapping children
+            size_t count = std::min(overlaps.size(), kBoundingAnalysisMaxListed);
+            std::partial_sort(overlaps.begin(), overlaps.begin() + count, overlaps.end(),
+                              [](const NodeOverlap& a, const NodeOverlap& b) { return a.first > b.first; });
+            DBL sceneVolume = Volume(sceneBox);
+            for(size_t n = 0; n < count; n++)
+            {
+                const BBOX_TREE *node = overlaps[n].second;
+                short first = 0, second = 1;
+                DBL worst = -1.0;
+                for(short i = 0; i < node->Entries; i++)
+                    for(short j = i + 1; j < node->Entries; j++)
+                    {
+                        DBL overlap = OverlapVolume(node->Node[i]->BBox, node->Node[j]->BBox);
+                        if(overlap > worst)
+                        {
+                            worst = overlap;
+                            first = i;
+                            second = j;
+                        }
+                    }
+                messages.Info("Node overlap of %.1f%% of the scene's volume, largely due to objects at %s and %s.",
+                              (sceneVolume > 0.0) ? 100.0 * overlaps[n].first / sceneVolume : 0.0,
+                              DescribeObject(LargestObject(node->Node[first]), sourceFiles).c_str(),
+                              DescribeObject(LargestObject(node->Node[second]), sourceFiles).c_str());
+            }
+            break;
+        }
+    }
+}
+
+void BoundingTask::CompactBoundingSlabs()
+{
+    if((sceneData->boundingMethod != 1) || (sceneData->boundingSlabsCompact == 0) || (sceneData->boundingSlabs == nullptr))
+        return;
+
+    // The cache file (if any) has already been written from the original tree, which is no longer needed now.
+    sceneData->compactSlabs = CompactBBoxTree::Create(sceneData->boundingSlabs, sceneData->boundingSlabsCompact);
+    Destroy_BBox_Tree(sceneData->boundingSlabs);
+    sceneData->boundingSlabs = nullptr;
+}
+
+POV_UINT64 BoundingTask::ComputeCacheKey(bool withBounds) const
+{
+    // The tree builders only look at the objects' bounding boxes (which already account for all transformations)
+    // and their infinite and light source flags, so this is all that needs to go into the key; any other change
+    // to the objects does not invalidate the cached hierarchy.
+    POV_UINT64 hash = 0xCBF29CE484222325ull;
+    POV_UINT32 params[] = { kBoundingCacheVersion, sceneData->boundingMethod, POV_UINT32(sizeof(BoundingBox)), POV_UINT32(sceneData->objects.size()) };
+
+    hash = HashData(hash, params, sizeof(params));
+
+    if(sceneData->boundingMethod == 2)
+    {
+        float costs[] = { sceneData->bspObjectIsectCost, sceneData->bspBaseAccessCost, sceneData->bspChildAccessCost, sceneData->bspMissChance };
+
+        hash = HashData(hash, &sceneData->bspMaxDepth, sizeof(sceneData->bspMaxDepth));
+        hash = HashData(hash, costs, sizeof(costs));
+    }
+    else if(sceneData->boundingMethod == 3)
+        hash = HashData(hash, &sceneData->bvhWidth, sizeof(sceneData->bvhWidth));
+
+    for(vector<ObjectPtr>::const_iterator i(sceneData->objects.begin()); i != sceneData->objects.end(); i++)
+    {
+        ConstObjectPtr object = *i;
+
+        for(int k = 0; k < 2; k++)
+        {
+            POV_UINT32 flags[] = { POV_UINT32((object->Type & LIGHT_SOURCE_OBJECT) != 0), POV_UINT32(Test_Flag(object, INFINITE_FLAG) != 0) };
+
+            hash = HashData(hash, flags, sizeof(flags));
+            if(withBounds)
+                hash = HashData(hash, &object->BBox, sizeof(BoundingBox));
+
+            // the bounding box tree uses the light source's first child instead of the light source itself
+            if(((object->Type & LIGHT_SOURCE_OBJECT) == 0) || (reinterpret_cast<const LightSource *>(object)->children.empty()))
+                break;
+            object = reinterpret_cast<const LightSource *>(object)->children[0];
+        }
+    }
+
+    return hash;
+}
+
+bool BoundingTask::ReadCache(POV_UINT64 key, POV_UINT64 topologyKey)
+{
+    Path cacheFile(sceneData->boundingCacheFile);
+    std::unique_ptr<IStream> is;
+    const unsigned char *bundleData;
+    POV_UINT64 bundleOffset, bundleSize;
+
+    // a scene bundle takes precedence over the cache file
+    if((sceneData->sceneBundle != nullptr) &&
+       sceneData->sceneBundle->GetSection(SceneBundle::kBoundingSection, bundleData, bundleOffset, bundleSize))
+        is.reset(new IMemStream(bundleData, size_t(bundleSize), sceneData->sceneBundle->GetFileName(), POV_OFF_T(bundleOffset)));
+    else if(!sceneData->boundingCacheFile.empty() && CheckIfFileExists(cacheFile))
+        is.reset(NewIStream(cacheFile, POV_File_Data_PBC));
+    else
+        return false;
+
+    BoundingCacheHeader header;
+
+    if((is == nullptr) || !is->read(&header, sizeof(header)))
+        return false;
+
+    if((header.magic != kBoundingCacheMagic) || (header.version != kBoundingCacheVersion) ||
+       (header.method != sceneData->boundingMethod) || (header.objects != sceneData->objects.size()))
+        return false;
+
+    // if only the object bounds have changed (e.g. in the next frame of an animation), the wide BVH can be refit
+    bool refit = (header.key != key);
+
+    if(refit && ((sceneData->boundingMethod != 3) || (sceneData->bvhRefitThreshold <= 0.0f) || (header.topologyKey != topologyKey)))
+        return false;
+
+    if(sceneData->boundingMethod == 3)
+    {
+        SceneObjects objects(sceneData->objects);
+        BoundingCacheBVHStatistics stats;
+
+        if(!is->read(&stats, sizeof(stats)))
+            return false;
+
+        std::unique_ptr<BVHTree> tree(BVHTree::Create(sceneData->bvhWidth));
+
+        if(tree->Load(*is, objects.finite.size()) == false)
+            return false;
+
+        if(refit)
+        {
+            tree->Refit(objects);
+
+            // the cost is compared to the originally built tree rather than the previous frame,
+            // so that slow but steady degradation is detected as well
+            if(tree->ComputeCost(objects) > header.cost * (1.0f + sceneData->bvhRefitThreshold))
+                return false;
+        }
+
+        // the tree references the objects by index, so the objects have to be in the same order as when it was built
+        sceneData->objects.clear();
+        sceneData->objects.insert(sceneData->objects.end(), objects.finite.begin(), objects.finite.end());
+        sceneData->objects.insert(sceneData->objects.end(), objects.infinite.begin(), objects.infinite.end());
+        sceneData->numberOfFiniteObjects = objects.finite.size();
+        sceneData->numberOfInfiniteObjects = objects.infinite.size() - objects.numLights;
+        sceneData->bvhTree = tree.release();
+
+        sceneData->nodes = stats.nodes;
+        sceneData->objectNodes = stats.leafNodes;
+        sceneData->maxObjects = stats.maxObjects;
+        sceneData->averageObjects = stats.averageObjects;
+        sceneData->maxDepth = stats.maxDepth;
+        sceneData->averageDepth = stats.averageDepth;
+    }
+    else if(sceneData->boundingMethod == 2)
+    {
+        SceneObjects objects(sceneData->objects);
+        BoundingCacheBSPStatistics stats;
+
+        if(!is->read(&stats, sizeof(stats)))
+            return false;
+
+        // the tree references the objects by index, so the objects have to be in the same order as when it was built
+        sceneData->objects.clear();
+        sceneData->objects.insert(sceneData->objects.end(), objects.finite.begin(), objects.finite.end());
+        sceneData->objects.insert(sceneData->objects.end(), objects.infinite.begin(), objects.infinite.end());
+        sceneData->numberOfFiniteObjects = objects.finite.size();
+        sceneData->numberOfInfiniteObjects = objects.infinite.size() - objects.numLights;
+        sceneData->tree = new BSPTree(sceneData->bspMaxDepth, sceneData->bspObjectIsectCost, sceneData->bspBaseAccessCost, sceneData->bspChildAccessCost, sceneData->bspMissChance);
+
+        if(sceneData->tree->Load(*is, objects.finite.size()) == false)
+        {
+            delete sceneData->tree;
+            sceneData->tree = nullptr;
+            return false;
+        }
+
+        sceneData->nodes = stats.nodes;
+        sceneData->splitNodes = stats.splitNodes;
+        sceneData->objectNodes = stats.objectNodes;
+        sceneData->emptyNodes = stats.emptyNodes;
+        sceneData->maxObjects = stats.maxObjects;
+        sceneData->averageObjects = stats.averageObjects;
+        sceneData->maxDepth = stats.maxDepth;
+        sceneData->averageDepth = stats.averageDepth;
+        sceneData->aborts = stats.aborts;
+        sceneData->averageAborts = stats.averageAborts;
+        sceneData->averageAbortObjects = stats.averageAbortObjects;
+    }
+    else
+    {
+        POV_UINT32 counts[2];
+
+        if(!is->read(counts, sizeof(counts)))
+            return false;
+
+        if(Load_Bounding_Slabs(*is, &(sceneData->boundingSlabs), sceneData->objects) == false)
+        {
+            sceneData->boundingSlabs = nullptr;
+            return false;
+        }
+
+        sceneData->numberOfFiniteObjects = counts[0];
+        sceneData->numberOfInfiniteObjects = counts[1];
+    }
+
+    if(refit)
+        sceneData->boundingCacheRefit = true;
+    else
+        sceneData->boundingCacheHit = true;
+
+    return true;
+}
+
+void BoundingTask::WriteCache(POV_UINT64 key, POV_UINT64 topologyKey)
+{
+    if(sceneData->boundingCacheFile.empty())
+        return;
+
+    Path cacheFile(sceneData->boundingCacheFile);
+    std::unique_ptr<OStream> os(NewOStream(cacheFile, POV_File_Data_PBC, false));
+    BoundingCacheHeader header = { kBoundingCacheMagic, kBoundingCacheVersion, sceneData->boundingMethod, POV_UINT32(sceneData->objects.size()), key, topologyKey, 0.0f, 0 };
+    bool ok;
+
+    // failing to write the cache is not an error, the hierarchy will simply be rebuilt next time
+    if(os == nullptr)
+        return;
+
+    if(sceneData->boundingMethod == 3)
+        header.cost = sceneData->bvhTree->ComputeCost(SceneObjects(sceneData->objects));
+
+    ok = os->write(&header, sizeof(header));
+
+    if(sceneData->boundingMethod == 3)
+    {
+        BoundingCacheBVHStatistics stats = {
+            sceneData->nodes, sceneData->objectNodes, sceneData->maxObjects, sceneData->maxDepth,
+            sceneData->averageObjects, sceneData->averageDepth
+        };
+
+        ok = ok && os->write(&stats, sizeof(stats)) && sceneData->bvhTree->Save(*os);
+    }
+    else if(sceneData->boundingMethod == 2)
+    {
+        BoundingCacheBSPStatistics stats = {
+            sceneData->nodes, sceneData->splitNodes, sceneData->objectNodes, sceneData->emptyNodes,
+            sceneData->maxObjects, sceneData->maxDepth, sceneData->aborts,
+            sceneData->averageObjects, sceneData->averageDepth, sceneData->averageAborts, sceneData->averageAbortObjects
+        };
+
+        ok = ok && os->write(&stats, sizeof(stats)) && sceneData->tree->Save(*os);
+    }
+    else
+    {
+        POV_UINT32 counts[2] = { sceneData->numberOfFiniteObjects, sceneData->numberOfInfiniteObjects };
+
+        ok = ok && os->write(counts, sizeof(counts)) && Save_Bounding_Slabs(*os, sceneData->boundingSlabs, sceneData->objects);
+    }
+
+    os.reset();
+
+    // don't leave a truncated file behind
+    if(!ok)
+        (void)pov_base::Filesystem::DeleteFile(sceneData->boundingCacheFile);
 }
 
 void BoundingTask::Stopped()
@@ -217,6 +976,7 @@ void BoundingTask::Finish()
     GetSceneDataPtr()->timeType = TraceThreadData::kBoundingTime;
     GetSceneDataPtr()->realTime = ConsumedRealTime();
     GetSceneDataPtr()->cpuTime = ConsumedCPUTime();
+    GetSceneDataPtr()->eventCounts = ConsumedEvents();
 }
 
 void BoundingTask::SendFatalError(Exception& e)
@@ -47,6 +47,7 @@
 
 // POV-Ray header files (base module)
 #include "base/base_fwd.h"
+#include "base/messenger_fwd.h"
 
 // POV-Ray header files (core module)
 #include "core/core_fwd.h"
@@ -61,7 +62,7 @@ namespace pov
 class BoundingTask final : public SceneTask
 {
     public:
-        BoundingTask(std::shared_ptr<BackendSceneData> sd, unsigned int bt, size_t seed);
+        BoundingTask(std::shared_ptr<BackendSceneData> sd, unsigned int bt, unsigned int threads, size_t seed);
         virtual ~BoundingTask() override;
 
         virtual void Run() override;
@@ -74,6 +75,18 @@ class BoundingTask final : public SceneTask
     private:
         std::shared_ptr<BackendSceneData> sceneData;
         unsigned int boundingThreshold;
+        unsigned int buildThreads;
+
+        POV_UINT64 ComputeCacheKey(bool withBounds) const;
+        bool ReadCache(POV_UINT64 key, POV_UINT64 topologyKey);
+        void WriteCache(POV_UINT64 key, POV_UINT64 topologyKey);
+        void CompactBoundingSlabs();
+        void BuildPlaneSet();
+        void BuildLightTree();
+        void BuildLightReach();
+        void BakeSkysphere();
+        void OptimizeObjects(pov_base::GenericMessenger& messages);
+        void ReportHierarchy(pov_base::GenericMessenger& messages);
 
         void SendFatalError(pov_base::Exception& e);
 };
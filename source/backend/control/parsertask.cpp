@@ -43,6 +43,7 @@
 #include <boost/bind.hpp>
 
 // POV-Ray header files (base module)
+#include "base/pov_mem.h"
 #include "base/types.h"
 
 // POV-Ray header files (core module)
@@ -94,6 +95,7 @@ void ParserTask::Finish()
         mpParser->GetParserDataPtr()->timeType  = TraceThreadData::kParseTime;
         mpParser->GetParserDataPtr()->realTime  = ConsumedRealTime();
         mpParser->GetParserDataPtr()->cpuTime   = ConsumedCPUTime();
+        mpParser->GetParserDataPtr()->eventCounts = ConsumedEvents();
         mpParser->Finish();
         mpParser.reset();
     }
@@ -128,6 +130,7 @@ void ParserTask::ReportProgress(POV_LONG tokenCount)
         POVMS_Object obj(kPOVObjectClass_ParserProgress);
         obj.SetLong(kPOVAttrib_RealTime, elapsedTime);
         obj.SetLong(kPOVAttrib_CurrentTokenCount, tokenCount);
+        obj.SetLong(kPOVAttrib_CurrentMemoryUsage, static_cast<POVMSLong>(pov_base::pov_mem_accounted_total()));
         RenderBackend::SendSceneOutput(mpBackendSceneData->sceneId, mpBackendSceneData->frontendAddress, kPOVMsgIdent_Progress, obj);
         Cooperate();
         mLastProgressElapsedTime = ElapsedRealTime();
@@ -106,14 +106,18 @@ void RenderBackend::SendSceneOutput(SceneId sid, POVMSAddress addr, POVMSType id
     POVMS_SendMessage(RenderBackend::context, msg, nullptr, kPOVMSSendMode_NoReply); // POVMS context provide for source address access only!
 }
 
-void RenderBackend::SendViewOutput(ViewId vid, POVMSAddress addr, POVMSType ident, POVMS_Object& obj)
+void RenderBackend::SendViewOutput(ViewId vid, POVMSAddress addr, POVMSType ident, POVMS_Object& obj, bool batched)
 {
     POVMS_Message msg(obj, kPOVMsgClass_ViewOutput, ident);
 
     msg.SetInt(kPOVAttrib_ViewId, vid);
     msg.SetDestinationAddress(addr);
 
-    POVMS_SendMessage(RenderBackend::context, msg, nullptr, kPOVMSSendMode_NoReply); // POVMS context provide for source address access only!
+    // POVMS context provide for source address access only!
+    if (batched)
+        POVMS_SendMessageBatched(RenderBackend::context, msg);
+    else
+        POVMS_SendMessage(RenderBackend::context, msg, nullptr, kPOVMSSendMode_NoReply);
 }
 
 void RenderBackend::SendFindFile(POVMSContext ctx, SceneId sid, POVMSAddress addr, const std::vector<POVMSUCS2String>& filenames, POVMSUCS2String& filename)
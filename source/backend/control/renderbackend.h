@@ -79,7 +79,7 @@ class RenderBackend final : public POVMS_MessageReceiver
         virtual ~RenderBackend() override;
 
         static void SendSceneOutput(SceneId sid, POVMSAddress addr, POVMSType ident, POVMS_Object& obj);
-        static void SendViewOutput(ViewId vid, POVMSAddress addr, POVMSType ident, POVMS_Object& obj);
+        static void SendViewOutput(ViewId vid, POVMSAddress addr, POVMSType ident, POVMS_Object& obj, bool batched = false);
 
         static void SendFindFile(POVMSContext ctx, SceneId sid, POVMSAddress addr, const std::vector<UCS2String>& filenames, UCS2String& filename);
         static void SendReadFile(POVMSContext ctx, SceneId sid, POVMSAddress addr, const UCS2String& filename, UCS2String& localfile, UCS2String& fileurl);
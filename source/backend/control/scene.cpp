@@ -47,10 +47,14 @@
 #include <boost/bind.hpp>
 
 // POV-Ray header files (base module)
+#include "base/pov_mem.h"
 #include "base/image/colourspace.h"
+#include "base/image/image.h"
+#include "base/image/imagecache.h"
 
 // POV-Ray header files (core module)
 #include "core/scene/tracethreaddata.h"
+#include "core/shape/meshpager.h"
 
 // POV-Ray header files (POVMS module)
 #include "povms/povmscpp.h"
@@ -80,6 +84,7 @@ Scene::Scene(POVMSAddress backendAddr, POVMSAddress frontendAddr, RenderBackend:
     parserControlThread(nullptr)
 {
     sceneData->tree = nullptr;
+    sceneData->bvhTree = nullptr;
     sceneData->sceneId = sid;
     sceneData->backendAddress = backendAddr;
     sceneData->frontendAddress = frontendAddr;
@@ -126,10 +131,12 @@ void Scene::StartParser(POVMS_Object& parseOptions)
 
     sceneData->defaultFileType = parseOptions.TryGetInt(kPOVAttrib_OutputFileType, DEFAULT_OUTPUT_FORMAT); // TODO - should get DEFAULT_OUTPUT_FORMAT from the front-end
     sceneData->clocklessAnimation = parseOptions.TryGetBool(kPOVAttrib_ClocklessAnimation, false); // TODO - experimental code
+    sceneData->multiCamera = !sceneData->clocklessAnimation && parseOptions.TryGetBool(kPOVAttrib_MultiCamera, false);
 
     sceneData->splitUnions = parseOptions.TryGetBool(kPOVAttrib_SplitUnions, false);
     sceneData->removeBounds = parseOptions.TryGetBool(kPOVAttrib_RemoveBounds, true);
-    sceneData->boundingMethod = clip<int>(parseOptions.TryGetInt(kPOVAttrib_BoundingMethod, 1), 1, 2);
+    sceneData->mergeTriangles = parseOptions.TryGetBool(kPOVAttrib_MergeTriangles, true);
+    sceneData->boundingMethod = clip<int>(parseOptions.TryGetInt(kPOVAttrib_BoundingMethod, 1), 1, 3);
     if(parseOptions.TryGetBool(kPOVAttrib_Bounding, true) == false)
         sceneData->boundingMethod = 0;
 
@@ -145,6 +152,52 @@ void Scene::StartParser(POVMS_Object& parseOptions)
     sceneData->bspBaseAccessCost = clip<float>(parseOptions.TryGetFloat(kPOVAttrib_BSP_BaseAccessCost, 0.0f), 0.0f, HUGE_VAL);
     sceneData->bspChildAccessCost = clip<float>(parseOptions.TryGetFloat(kPOVAttrib_BSP_ChildAccessCost, 0.0f), 0.0f, HUGE_VAL);
     sceneData->bspMissChance = clip<float>(parseOptions.TryGetFloat(kPOVAttrib_BSP_MissChance, 0.0f), 0.0f, 1.0f - EPSILON);
+    sceneData->bvhWidth = (parseOptions.TryGetInt(kPOVAttrib_BVH_Width, 4) > 4) ? 8 : 4;
+    int bvhPacketSize = parseOptions.TryGetInt(kPOVAttrib_BVH_PacketSize, 16);
+    sceneData->bvhPacketSize = (bvhPacketSize >= 16) ? 16 : (bvhPacketSize >= 8) ? 8 : (bvhPacketSize >= 4) ? 4 : 0;
+    sceneData->bvhRefitThreshold = clip<float>(parseOptions.TryGetFloat(kPOVAttrib_BVH_RefitThreshold, 0.0f), 0.0f, HUGE_VAL);
+    sceneData->lightThreshold = clip<DBL>(parseOptions.TryGetFloat(kPOVAttrib_LightThreshold, 0.0), 0.0, HUGE_VAL);
+    int compactBits = parseOptions.TryGetInt(kPOVAttrib_BoundingSlabsCompact, 0);
+    sceneData->boundingSlabsCompact = (compactBits > 8) ? 16 : (compactBits > 0) ? 8 : 0;
+    sceneData->boundingCacheFile = parseOptions.TryGetUCS2String(kPOVAttrib_BoundingCacheFile, "");
+    sceneData->boundingAnalysis = parseOptions.TryGetBool(kPOVAttrib_BoundingAnalysis, false);
+
+    // render farm nodes may take the data shared by all of them from a scene bundle prepared in advance
+    UCS2String bundleFile = parseOptions.TryGetUCS2String(kPOVAttrib_RenderFromBundle, "");
+    sceneData->sceneBundlePrepareFile = parseOptions.TryGetUCS2String(kPOVAttrib_PrepareBundle, "");
+    if (!bundleFile.empty() && !sceneData->sceneBundlePrepareFile.empty())
+        throw POV_EXCEPTION(kParamErr, "Prepare_Bundle cannot be combined with Render_From_Bundle.");
+    if (!bundleFile.empty())
+    {
+        sceneData->sceneBundle = std::make_shared<SceneBundle>();
+        if (!sceneData->sceneBundle->Open(bundleFile))
+            throw POV_EXCEPTION(kFileDataErr, "Cannot read scene bundle file.");
+    }
+    else if (!sceneData->sceneBundlePrepareFile.empty() && sceneData->boundingCacheFile.empty())
+        sceneData->boundingCacheFile = SceneBundle::GetSectionFileName(sceneData->sceneBundlePrepareFile, SceneBundle::kBoundingSection);
+
+    UCS2String timelineFile = parseOptions.TryGetUCS2String(kPOVAttrib_TimelineFile, "");
+    if (!timelineFile.empty())
+    {
+        sceneData->timeline = std::make_shared<TaskTimeline>(timelineFile);
+        parserTasks.SetTimeline(sceneData->timeline);
+    }
+    sceneData->incrementalRenderFile = parseOptions.TryGetUCS2String(kPOVAttrib_IncrementalRenderFile, "");
+    sceneData->meshCachePath = parseOptions.TryGetUCS2String(kPOVAttrib_MeshCachePath, "");
+    sceneData->parseProfileFile = parseOptions.TryGetUCS2String(kPOVAttrib_ParseProfileFile, "");
+
+    // number is megabytes; image maps larger than this are placed in file-backed memory
+    Image::SetFileBackingThreshold(static_cast<POV_ULONG>(max(0, parseOptions.TryGetInt(kPOVAttrib_MaxImageMapMem, 0))) * 1048576);
+
+    // number is megabytes; parsing or rendering fails once the accounted memory would exceed this
+    pov_base::pov_mem_set_limit(static_cast<POV_ULONG>(max(0, parseOptions.TryGetInt(kPOVAttrib_MemoryLimit, 0))) * 1048576);
+
+    // number is megabytes; memory-mapped meshes used least recently are evicted once those in memory exceed this
+    MeshPager::SetBudget(static_cast<POV_ULONG>(max(0, parseOptions.TryGetInt(kPOVAttrib_MeshMemoryBudget, 0))) * 1048576);
+    pov_base::pov_mem_reset_peaks();
+
+    // number is megabytes; decoded image maps are kept for later parses up to this size
+    pov_base::SetImageCacheSize(static_cast<POV_ULONG>(max(0, parseOptions.TryGetInt(kPOVAttrib_ImageCacheSize, 0))) * 1048576);
 
     sceneData->realTimeRaytracing = parseOptions.TryGetBool(kPOVAttrib_RealTimeRaytracing, false);
 
@@ -181,20 +234,30 @@ void Scene::StartParser(POVMS_Object& parseOptions)
     }
 
     // do parsing
-    sceneThreadData.push_back(dynamic_cast<TraceThreadData *>(parserTasks.AppendTask(new ParserTask(
-        sceneData, pov_parser::ParserOptions(bool(parseOptions.Exist(kPOVAttrib_Clock)), parseOptions.TryGetFloat(kPOVAttrib_Clock, 0.0), seed)
-        ))));
+    bool eventCounting = parseOptions.TryGetBool(kPOVAttrib_PerformanceCounters, false);
+
+    Task *parserTask = new ParserTask(
+        sceneData, pov_parser::ParserOptions(bool(parseOptions.Exist(kPOVAttrib_Clock)), parseOptions.TryGetFloat(kPOVAttrib_Clock, 0.0), seed,
+                                             clip<int>(parseOptions.TryGetInt(kPOVAttrib_MaxRenderThreads, 1), 1, 512),
+                                             parseOptions.TryGetBool(kPOVAttrib_ReuseDeclarations, false),
+                                             parseOptions.TryGetBool(kPOVAttrib_DeferImageDecoding, false))
+        );
+    parserTask->SetEventCounting(eventCounting);
+    sceneThreadData.push_back(dynamic_cast<TraceThreadData *>(parserTasks.AppendTask(parserTask)));
 
     // wait for parsing
     parserTasks.AppendSync();
 
     // do bounding - we always call this even if the bounding is turned off
     // because it also generates object statistics
-    sceneThreadData.push_back(dynamic_cast<TraceThreadData *>(parserTasks.AppendTask(new BoundingTask(
+    Task *boundingTask = new BoundingTask(
         sceneData,
         clip<int>(parseOptions.TryGetInt(kPOVAttrib_BoundingThreshold, DEFAULT_AUTO_BOUNDINGTHRESHOLD),1,SIGNED16_MAX),
+        clip<int>(parseOptions.TryGetInt(kPOVAttrib_MaxRenderThreads, 1), 1, 512),
         seed
-        ))));
+        );
+    boundingTask->SetEventCounting(eventCounting);
+    sceneThreadData.push_back(dynamic_cast<TraceThreadData *>(parserTasks.AppendTask(boundingTask)));
 
     // wait for bounding
     parserTasks.AppendSync();
@@ -264,6 +327,8 @@ void Scene::GetStatistics(POVMS_Object& parserStats)
         POV_LONG cpuTime;
         POV_LONG realTime;
         size_t samples;
+        PerformanceCounts events;
+        POVMS_List threadEvents;
 
         TimeData() : cpuTime(0), realTime(0), samples(0) { }
     };
@@ -278,6 +343,13 @@ void Scene::GetStatistics(POVMS_Object& parserStats)
         else
             timeData[(*i)->timeType].cpuTime = -1;
         timeData[(*i)->timeType].samples++;
+        if ((*i)->eventCounts.IsValid())
+        {
+            POVMS_Object threadEvents(kPOVObjectClass_EventCounts);
+            SetEventCounts(threadEvents, (*i)->eventCounts);
+            timeData[(*i)->timeType].threadEvents.Append(threadEvents);
+            timeData[(*i)->timeType].events += (*i)->eventCounts;
+        }
     }
 
     for(size_t i = TraceThreadData::kUnknownTime; i < TraceThreadData::kMaxTimeType; i++)
@@ -290,6 +362,11 @@ void Scene::GetStatistics(POVMS_Object& parserStats)
             if (timeData[i].cpuTime >= 0)
                 elapsedTime.SetLong(kPOVAttrib_CPUTime, timeData[i].cpuTime);
             elapsedTime.SetInt(kPOVAttrib_TimeSamples, POVMSInt(timeData[i].samples));
+            if (timeData[i].events.IsValid())
+            {
+                SetEventCounts(elapsedTime, timeData[i].events);
+                elapsedTime.Set(kPOVAttrib_ThreadEvents, timeData[i].threadEvents);
+            }
 
             switch(i)
             {
@@ -307,6 +384,35 @@ void Scene::GetStatistics(POVMS_Object& parserStats)
     parserStats.SetInt(kPOVAttrib_InfiniteObjects, sceneData->numberOfInfiniteObjects);
     parserStats.SetInt(kPOVAttrib_LightSources, POVMSInt(sceneData->lightSources.size()));
     parserStats.SetInt(kPOVAttrib_Cameras, POVMSInt(sceneData->cameras.size()));
+    if(sceneData->meshImportTriangles > 0)
+    {
+        parserStats.SetLong(kPOVAttrib_MeshImportTriangles, sceneData->meshImportTriangles);
+        parserStats.SetLong(kPOVAttrib_MeshImportTime, sceneData->meshImportTime);
+    }
+    if(sceneData->heightFieldPoints > 0)
+    {
+        parserStats.SetLong(kPOVAttrib_HeightFieldPoints, sceneData->heightFieldPoints);
+        parserStats.SetLong(kPOVAttrib_HeightFieldTime, sceneData->heightFieldTime);
+    }
+    if(sceneData->symbolLookups > 0)
+    {
+        parserStats.SetLong(kPOVAttrib_SymbolLookups, sceneData->symbolLookups);
+        parserStats.SetLong(kPOVAttrib_SymbolProbes, sceneData->symbolProbes);
+    }
+    if((sceneData->declarationsReused > 0) || (sceneData->declarationsEvaluated > 0))
+    {
+        parserStats.SetLong(kPOVAttrib_DeclarationsReused, sceneData->declarationsReused);
+        parserStats.SetLong(kPOVAttrib_DeclarationsEvaluated, sceneData->declarationsEvaluated);
+    }
+    if((sceneData->meshCacheHits > 0) || (sceneData->meshCacheWrites > 0))
+    {
+        parserStats.SetLong(kPOVAttrib_MeshCacheHits, sceneData->meshCacheHits);
+        parserStats.SetLong(kPOVAttrib_MeshCacheWrites, sceneData->meshCacheWrites);
+    }
+    if(sceneData->boundingCacheHit)
+        parserStats.SetBool(kPOVAttrib_BoundingCacheHit, true);
+    if(sceneData->boundingCacheRefit)
+        parserStats.SetBool(kPOVAttrib_BoundingCacheRefit, true);
 
     if(sceneData->boundingMethod == 2)
     {
@@ -321,6 +427,21 @@ void Scene::GetStatistics(POVMS_Object& parserStats)
         parserStats.SetInt(kPOVAttrib_BSPAborts, sceneData->aborts);
         parserStats.SetFloat(kPOVAttrib_BSPAverageAborts, sceneData->averageAborts);
         parserStats.SetFloat(kPOVAttrib_BSPAverageAbortObjects, sceneData->averageAbortObjects);
+        if (!sceneData->bspDepthTimes.empty())
+        {
+            std::vector<POVMSLong> depthTimes(sceneData->bspDepthTimes.begin(), sceneData->bspDepthTimes.end());
+            parserStats.SetLongVector(kPOVAttrib_BSPDepthTimes, depthTimes);
+        }
+    }
+    else if(sceneData->boundingMethod == 3)
+    {
+        parserStats.SetInt(kPOVAttrib_BVH_Width, sceneData->bvhWidth);
+        parserStats.SetInt(kPOVAttrib_BVHNodes, sceneData->nodes);
+        parserStats.SetInt(kPOVAttrib_BVHLeafNodes, sceneData->objectNodes);
+        parserStats.SetInt(kPOVAttrib_BVHMaxObjects, sceneData->maxObjects);
+        parserStats.SetFloat(kPOVAttrib_BVHAverageObjects, sceneData->averageObjects);
+        parserStats.SetInt(kPOVAttrib_BVHMaxDepth, sceneData->maxDepth);
+        parserStats.SetFloat(kPOVAttrib_BVHAverageDepth, sceneData->averageDepth);
     }
 }
 
@@ -353,6 +474,8 @@ void Scene::SendDoneMessage(TaskQueue&)
         doneMessage.SetInt(kPOVAttrib_WorkingGammaType, sceneData->workingGamma->GetTypeId());
         doneMessage.SetFloat(kPOVAttrib_WorkingGamma, sceneData->workingGamma->GetParam());
     }
+    if (sceneData->multiCamera)
+        doneMessage.SetInt(kPOVAttrib_Cameras, POVMSInt(sceneData->cameras.size()));
     POVMS_SendMessage(doneMessage);
 }
 
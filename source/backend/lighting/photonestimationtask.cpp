@@ -78,6 +78,7 @@ PhotonEstimationTask::PhotonEstimationTask(ViewData *vd, size_t seed) :
     RenderTask(vd, seed, "Photon"),
     cooperate(*this)
 {
+    SetTimelineName("Photon estimation");
     photonCountEstimate = 0;
 }
 
@@ -140,6 +141,7 @@ void PhotonEstimationTask::Finish()
     GetViewDataPtr()->timeType = TraceThreadData::kPhotonTime;
     GetViewDataPtr()->realTime = ConsumedRealTime();
     GetViewDataPtr()->cpuTime = ConsumedCPUTime();
+    GetViewDataPtr()->eventCounts = ConsumedEvents();
 }
 
 
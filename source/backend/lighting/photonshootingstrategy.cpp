@@ -39,9 +39,12 @@
 #include "backend/lighting/photonshootingstrategy.h"
 
 // C++ variants of C standard header files
-// C++ standard header files
 //  (none at the moment)
 
+// C++ standard header files
+#include <algorithm>
+#include <vector>
+
 // POV-Ray header files (base module)
 //  (none at the moment)
 
@@ -68,26 +71,123 @@
 namespace pov
 {
 
-void PhotonShootingStrategy::start()
+/// Approximate number of photon directions per work unit.
+const DBL PHOTON_SHOOTING_UNIT_SIZE = 4096.0;
+
+/// Maximum distance, in grid cells, to which a point seen by the camera marks its surroundings.
+const long PHOTON_IMPORTANCE_MAX_SPREAD = 3;
+
+// The cell size is chosen from the median camera ray footprint, so that typical regions are
+// resolved at about the size of a coarse pixel; every point also marks the neighbouring cells,
+// so that photons landing just outside a visible cell, but within gather range, still count.
+void PhotonImportanceGrid::build(const std::vector<Vector3d>& points, const std::vector<DBL>& footprints)
 {
-    iter = units.begin();
+    cells.clear();
+    cellSize = 0.0;
+
+    if (points.empty())
+        return;
+
+    std::vector<DBL> sorted(footprints);
+    std::nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2, sorted.end());
+    cellSize = sorted[sorted.size() / 2];
+    if (cellSize <= EPSILON)
+        cellSize = EPSILON;
+
+    for (size_t i = 0; i < points.size(); i++)
+    {
+        long spread = 1 + long(std::min(ceil(footprints[i] / cellSize), DBL(PHOTON_IMPORTANCE_MAX_SPREAD - 1)));
+        long x = long(floor(points[i].x() / cellSize));
+        long y = long(floor(points[i].y() / cellSize));
+        long z = long(floor(points[i].z() / cellSize));
+        for (long dx = -spread; dx <= spread; dx++)
+            for (long dy = -spread; dy <= spread; dy++)
+                for (long dz = -spread; dz <= spread; dz++)
+                    cells.insert(cellKey(x + dx, y + dy, z + dz));
+    }
+}
+
+bool PhotonImportanceGrid::isVisible(const Vector3d& point) const
+{
+    if (cells.empty())
+        return false;
+    return (cells.find(cellKey(long(floor(point.x() / cellSize)),
+                               long(floor(point.y() / cellSize)),
+                               long(floor(point.z() / cellSize)))) != cells.end());
+}
+
+// Cell coordinates wrap around after 2^21 cells; the resulting aliasing can only make
+// regions appear visible that are not, which costs some photons but introduces no bias.
+POV_UINT64 PhotonImportanceGrid::cellKey(long x, long y, long z)
+{
+    return ((POV_UINT64(x) & 0x1FFFFF) << 42) | ((POV_UINT64(y) & 0x1FFFFF) << 21) | (POV_UINT64(z) & 0x1FFFFF);
+}
+
+void PhotonShootingStrategy::start(int slice, int sliceCount)
+{
+    if (sliceCount > 1)
+    {
+        // keep every sliceCount-th unit, so that all slices get a similar mix of work
+        std::vector<PhotonShootingUnit*> sliceUnits;
+        for (std::vector<PhotonShootingUnit*>::iterator i = units.begin(); i != units.end(); i++)
+        {
+            if ((*i)->index % sliceCount == size_t(slice - 1))
+                sliceUnits.push_back(*i);
+            else
+                delete (*i);
+        }
+        units.swap(sliceUnits);
+    }
+
+    nextUnit = 0;
+}
+
+// Queue all units again for the next progressive photon mapping pass.
+void PhotonShootingStrategy::restart()
+{
+    pass++;
+    nextUnit = 0;
 }
 
 PhotonShootingUnit* PhotonShootingStrategy::getNextUnit()
 {
-    std::lock_guard<std::mutex> lock(nextUnitMutex);
-    if (iter == units.end())
+    size_t i = nextUnit++;
+    if (i >= units.size())
         return nullptr;
-    PhotonShootingUnit* unit = *iter;
-    iter++;
-    return unit;
+    return units[i];
 }
 
+// Each unit of each pass gets an index of its own, so that every progressive pass
+// shoots a different set of photons.
+size_t PhotonShootingStrategy::getSeedIndex(const PhotonShootingUnit* unit) const
+{
+    return pass * units.size() + unit->index;
+}
+
+// Each light/target combo is split into bands of theta steps holding roughly the same
+// number of photons, so that a single large target keeps all threads busy rather than
+// just the one that happens to pick it up. The bands are queued in ascending theta
+// order, so that autostop can take effect early.
 void PhotonShootingStrategy::createUnitsForCombo(ObjectPtr obj, LightSource* light, std::shared_ptr<SceneData> sceneData)
 {
-    PhotonShootingUnit* unit = new PhotonShootingUnit(light, obj);
-    unit->lightAndObject.computeAnglesAndDeltas(sceneData);
-    units.push_back(unit);
+    LightTargetCombo* combo = new LightTargetCombo(light, obj);
+    combo->computeAnglesAndDeltas(sceneData);
+    combos.push_back(combo);
+
+    int steps = combo->numThetaSteps();
+    int first = 0;
+    DBL photons = 0.0;
+
+    for (int step = 0; step < steps; step++)
+    {
+        photons += combo->estimatePhotonsInStep(step);
+        if ((photons >= PHOTON_SHOOTING_UNIT_SIZE) || (step == steps - 1))
+        {
+            units.push_back(new PhotonShootingUnit(combo, first, step + 1, units.size()));
+            first = step + 1;
+            photons = 0.0;
+        }
+    }
 }
 
 PhotonShootingStrategy::~PhotonShootingStrategy()
@@ -98,6 +198,10 @@ PhotonShootingStrategy::~PhotonShootingStrategy()
         delete (*delIter);
     }
     units.clear();
+
+    for (std::vector<LightTargetCombo*>::iterator i = combos.begin(); i != combos.end(); i++)
+        delete (*i);
+    combos.clear();
 }
 
 }
@@ -44,15 +44,18 @@
 //  (none at the moment)
 
 // C++ standard header files
+#include <atomic>
 #include <memory>
-#include <mutex>
+#include <unordered_set>
 #include <vector>
 
 // POV-Ray header files (base module)
-//  (none at the moment)
+#include "base/colour.h"
 
 // POV-Ray header files (core module)
 #include "core/core_fwd.h"
+#include "core/lighting/photons_fwd.h"
+#include "core/math/vector.h"
 
 // POV-Ray header files (backend module)
 //  (none at the moment)
@@ -60,23 +63,70 @@
 namespace pov
 {
 
+/// Progressive photon mapping state of one surface photon of the first pass.
+struct ProgressivePhotonPoint final
+{
+    DBL                         radiusSqr;      ///< Current squared gather radius.
+    DBL                         count;          ///< Accumulated photon count, reduced by the shrinking radius.
+    pov_base::PreciseRGBColour  flux;           ///< Accumulated flux, scaled to the current radius.
+    int                         initialCount;   ///< Number of first-pass photons within the initial radius.
+};
+
+/// Regions of the scene seen by the camera, for visual-importance-guided photon shooting.
+///
+/// The regions are the cells of a uniform grid hit by a coarse grid of camera rays, widened by
+/// the footprint of each ray; only the cells marked are stored, hashed into a set.
+class PhotonImportanceGrid final
+{
+    public:
+        PhotonImportanceGrid() : cellSize(0.0) {}
+
+        /// Mark the regions around a set of points.
+        /// @param[in]  points      Points seen by the camera.
+        /// @param[in]  footprints  Size of the area covered by the camera ray to each point.
+        void build(const std::vector<Vector3d>& points, const std::vector<DBL>& footprints);
+
+        /// Determine whether a point lies in a region seen by the camera.
+        bool isVisible(const Vector3d& point) const;
+
+        /// Determine whether any regions are marked at all.
+        bool isEmpty() const { return cells.empty(); }
+
+    private:
+        DBL cellSize;
+        std::unordered_set<POV_UINT64> cells;
+
+        static POV_UINT64 cellKey(long x, long y, long z);
+};
+
 class PhotonShootingStrategy final
 {
     public:
         ObjectPtr obj;
         LightSource *light;
 
+        std::vector<LightTargetCombo*> combos;
         std::vector<PhotonShootingUnit*> units;
 
+        // progressive photon mapping state, carried from one pass to the next
+        unsigned int pass;
+        std::vector<ProgressivePhotonPoint> points;
+
+        // regions seen by the camera, if photon shooting is guided by visual importance
+        PhotonImportanceGrid visibleRegions;
+
+        PhotonShootingStrategy() : pass(0), nextUnit(0) {}
+
         void createUnitsForCombo(ObjectPtr obj, LightSource* light, std::shared_ptr<SceneData> sceneData);
-        void start();
+        void start(int slice = 1, int sliceCount = 1);
+        void restart();
         PhotonShootingUnit* getNextUnit();
+        size_t getSeedIndex(const PhotonShootingUnit* unit) const;
 
         virtual ~PhotonShootingStrategy();
 
     private:
-        std::vector<PhotonShootingUnit*>::iterator iter;
-        std::mutex nextUnitMutex;
+        std::atomic<size_t> nextUnit;
 
 };
 
@@ -73,6 +73,12 @@
 namespace pov
 {
 
+/// Offset into the random number sequence between consecutive work units.
+const size_t PHOTON_UNIT_SEED_STRIDE = 7919;
+
+/// Number of phi sectors for which visual importance is tracked while shooting.
+const int PHOTON_IMPORTANCE_SECTORS = 64;
+
 PhotonShootingTask::PhotonShootingTask(ViewData *vd, PhotonShootingStrategy* strategy, size_t seed) :
     RenderTask(vd, seed, "Photon"),
     trace(vd->GetSceneData(), GetViewDataPtr(), vd->GetQualityFeatureFlags(), cooperate),
@@ -83,6 +89,7 @@ PhotonShootingTask::PhotonShootingTask(ViewData *vd, PhotonShootingStrategy* str
     maxTraceLevel(vd->GetSceneData()->photonSettings.Max_Trace_Level),
     adcBailout(vd->GetSceneData()->photonSettings.adcBailout)
 {
+    SetTimelineName("Photon shooting");
 }
 
 PhotonShootingTask::~PhotonShootingTask()
@@ -127,8 +134,10 @@ void PhotonShootingTask::Run()
     PhotonShootingUnit* unit = strategy->getNextUnit();
     while(unit)
     {
+        // seed the jitter per unit, so that the photons do not depend on which thread shoots them
+        randgen.SetSeed(strategy->getSeedIndex(unit) * PHOTON_UNIT_SEED_STRIDE);
         //ShootPhotonsAtObject(unit->lightAndObject.target, unit->lightAndObject.light);
-        ShootPhotonsAtObject(unit->lightAndObject);
+        ShootPhotonsAtObject(*unit->lightAndObject, unit->firstStep, unit->endStep);
         unit = strategy->getNextUnit();
     }
 
@@ -148,6 +157,7 @@ void PhotonShootingTask::Finish()
     GetViewDataPtr()->timeType = TraceThreadData::kPhotonTime;
     GetViewDataPtr()->realTime = ConsumedRealTime();
     GetViewDataPtr()->cpuTime = ConsumedCPUTime();
+    GetViewDataPtr()->eventCounts = ConsumedEvents();
 }
 
 
@@ -155,7 +165,7 @@ void PhotonShootingTask::Finish()
 
 
 
-void PhotonShootingTask::ShootPhotonsAtObject(LightTargetCombo& combo)
+void PhotonShootingTask::ShootPhotonsAtObject(LightTargetCombo& combo, int firstStep, int endStep)
 {
     MathColour colour;             /* light color */
     MathColour photonColour;       /* photon color */
@@ -171,9 +181,23 @@ void PhotonShootingTask::ShootPhotonsAtObject(LightTargetCombo& combo)
     TRANSFORM Trans;               /* transformation for rotation */
     int mergedFlags=0;             /* merged flags to see if we should shoot photons */
     int notComputed=true;          /* have the ray containers been computed for this point yet?*/
-    int hitAtLeastOnce = false;    /* have we hit the object at least once - for autostop stuff */
+    int step;                      /* theta step */
     ViewThreadData *renderDataPtr = GetViewDataPtr();
 
+    // Visual importance: Photons are shot at full density in phi sectors where the previous
+    // theta step deposited photons in (or next to) a region seen by the camera, or where no
+    // photon of the previous step has been traced; elsewhere they are shot only with the
+    // minimum probability, and with correspondingly more power. As the probability of each
+    // photon only depends on photons shot before it, this does not bias the result.
+    const PhotonImportanceGrid& visibleRegions = strategy->visibleRegions;
+    DBL minProbability = GetSceneData()->photonSettings.importance;
+    bool useImportance = (minProbability < 1.0) && !visibleRegions.isEmpty();
+    bool importantSector[PHOTON_IMPORTANCE_SECTORS];
+    bool tracedSector[PHOTON_IMPORTANCE_SECTORS];
+    bool visibleSector[PHOTON_IMPORTANCE_SECTORS];
+    for (int sector = 0; sector < PHOTON_IMPORTANCE_SECTORS; sector++)
+        importantSector[sector] = true;
+
     /* get the light source colour */
     colour = combo.light->colour;
 
@@ -196,12 +220,25 @@ void PhotonShootingTask::ShootPhotonsAtObject(LightTargetCombo& combo)
        --------------------------------------------- */
     i = 0;
     notComputed = true;
-    for(theta=combo.mintheta; theta<combo.maxtheta; theta+=combo.dtheta)
+    for(step=firstStep; step<endStep; step++)
     {
+        /* another thread may have triggered autostop at a lower theta */
+        if (step >= combo.stopStep)
+            break;
+
+        theta = combo.mintheta + step*combo.dtheta;
+        if (theta >= combo.maxtheta)
+            break;
+
         Cooperate();
         SendProgress();
         renderDataPtr->hitObject = false;
 
+        bool skippedAny = false;
+        bool tracedAny = false;
+        for (int sector = 0; sector < PHOTON_IMPORTANCE_SECTORS; sector++)
+            tracedSector[sector] = visibleSector[sector] = false;
+
         if (theta<EPSILON)
         {
             dphi=2*M_PI;
@@ -235,6 +272,25 @@ void PhotonShootingTask::ShootPhotonsAtObject(LightTargetCombo& combo)
             jitphi = phi + (dphi)*(randgen() - 0.5)*1.0*GetSceneData()->photonSettings.jitter;
             jittheta = theta + (combo.dtheta)*(randgen() - 0.5)*1.0*GetSceneData()->photonSettings.jitter;
 
+            /* decide whether to shoot this photon at all, based on visual importance */
+            int sector = 0;
+            DBL emissionWeight = 1.0;
+            if (useImportance)
+            {
+                sector = int(floor((jitphi + M_PI) * (PHOTON_IMPORTANCE_SECTORS / (2.0 * M_PI))));
+                sector = ((sector % PHOTON_IMPORTANCE_SECTORS) + PHOTON_IMPORTANCE_SECTORS) % PHOTON_IMPORTANCE_SECTORS;
+                if (!importantSector[sector])
+                {
+                    if (randgen() >= minProbability)
+                    {
+                        skippedAny = true;
+                        continue;
+                    }
+                    emissionWeight = 1.0 / minProbability;
+                }
+                tracedSector[sector] = true;
+            }
+
             /* actually, shoot multiple samples for area light */
             if(combo.light->Area_Light && combo.light->Photon_Area_Light && !combo.light->Parallel)
             {
@@ -329,7 +385,7 @@ void PhotonShootingTask::ShootPhotonsAtObject(LightTargetCombo& combo)
 
                     /* compute photon color from light source & attenuation */
 
-                    photonColour = colour * Attenuation;
+                    photonColour = colour * (Attenuation * emissionWeight);
 
                     if (Attenuation<0.00001) continue;
 
@@ -378,7 +434,19 @@ void PhotonShootingTask::ShootPhotonsAtObject(LightTargetCombo& combo)
                     //disp_nelems = 0; /* for dispersion */
 
                     ray.SetFlags(Ray::PrimaryRay, false, true);
+                    int firstSurfacePhoton = renderDataPtr->surfacePhotonMap->numPhotons;
+                    int firstMediaPhoton = renderDataPtr->mediaPhotonMap->numPhotons;
                     trace.TraceRay(ray, photonColour, dummyTransm, 1.0, false);
+                    tracedAny = true;
+
+                    /* check whether the photon has landed anywhere the camera sees */
+                    if (useImportance && !visibleSector[sector])
+                    {
+                        for (int p = firstSurfacePhoton; (p < renderDataPtr->surfacePhotonMap->numPhotons) && !visibleSector[sector]; p++)
+                            visibleSector[sector] = visibleRegions.isVisible(Vector3d(renderDataPtr->surfacePhotonMap->GetPhoton(p).Loc));
+                        for (int p = firstMediaPhoton; (p < renderDataPtr->mediaPhotonMap->numPhotons) && !visibleSector[sector]; p++)
+                            visibleSector[sector] = visibleRegions.isVisible(Vector3d(renderDataPtr->mediaPhotonMap->GetPhoton(p).Loc));
+                    }
 
                     /* display here */
                     if ((i++%100) == 0)
@@ -398,11 +466,28 @@ void PhotonShootingTask::ShootPhotonsAtObject(LightTargetCombo& combo)
              of the object's bounding sphere. */
 
         /* suggested by Pabs, we only use autostop if we have it it once */
-        if (renderDataPtr->hitObject) hitAtLeastOnce=true;
+        /* (the combo may be shot by several threads in bands of theta, so this is tracked per combo) */
+        if (renderDataPtr->hitObject) combo.hitAtLeastOnce=true;
 
-        if (hitAtLeastOnce && !renderDataPtr->hitObject && renderDataPtr->photonTargetObject)
+        /* update the visual importance of the sectors from this step, including their neighbours */
+        if (useImportance)
+        {
+            for (int sector = 0; sector < PHOTON_IMPORTANCE_SECTORS; sector++)
+            {
+                int prev = (sector + PHOTON_IMPORTANCE_SECTORS - 1) % PHOTON_IMPORTANCE_SECTORS;
+                int next = (sector + 1) % PHOTON_IMPORTANCE_SECTORS;
+                if (tracedSector[prev] || tracedSector[sector] || tracedSector[next])
+                    importantSector[sector] = visibleSector[prev] || visibleSector[sector] || visibleSector[next];
+            }
+        }
+
+        /* (a step in which visual importance has skipped every photon tells nothing about hits) */
+        if (combo.hitAtLeastOnce && !renderDataPtr->hitObject && renderDataPtr->photonTargetObject && !(skippedAny && !tracedAny))
             if (theta > GetSceneData()->photonSettings.autoStopPercent*combo.maxtheta)
+            {
+                combo.stopAtStep(step);
                 break;
+            }
     } /* end of rays loop */
 }
 
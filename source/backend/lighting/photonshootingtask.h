@@ -78,7 +78,7 @@ class PhotonShootingTask final : public RenderTask
 
         void SendProgress();
 
-        void ShootPhotonsAtObject(LightTargetCombo& combo);
+        void ShootPhotonsAtObject(LightTargetCombo& combo, int firstStep, int endStep);
         DBL computeAttenuation(const LightSource* Light, const Ray& ray, DBL dist_of_initial_from_center);
 
         PhotonMap* getMediaPhotonMap();
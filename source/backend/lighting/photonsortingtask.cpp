@@ -37,11 +37,19 @@
 #include "backend/lighting/photonsortingtask.h"
 
 // C++ variants of C standard header files
+#include <cstdio>
+#include <cstring>
+
 // C++ standard header files
-//  (none at the moment)
+#include <algorithm>
+#include <exception>
+#include <memory>
+#include <string>
+#include <thread>
 
 // POV-Ray header files (base module)
-//  (none at the moment)
+#include "base/filesystem.h"
+#include "base/stringutilities.h"
 
 // POV-Ray header files (core module)
 #include "core/bounding/boundingbox.h"
@@ -75,19 +83,22 @@ namespace pov
     load the photon map from a file.
     Otherwise, it will:
       1) merge
-      2) sort
+      2) sort (using up to "threads" threads)
       3) compute gather options
       4) clean up memory (delete the non-merged maps and delete the strategy)
+    In progressive mode, there is one such task per pass instead, see refinePass().
 */
 PhotonSortingTask::PhotonSortingTask(ViewData *vd, const std::vector<PhotonMap*>& surfaceMaps,
                                      const std::vector<PhotonMap*>& mediaMaps, PhotonShootingStrategy* strategy,
-                                     size_t seed) :
+                                     size_t seed, unsigned int threads) :
     RenderTask(vd, seed, "Photon"),
     surfaceMaps(surfaceMaps),
     mediaMaps(mediaMaps),
     strategy(strategy),
+    threads(threads),
     cooperate(*this)
 {
+    SetTimelineName("Photon sorting");
 }
 
 PhotonSortingTask::~PhotonSortingTask()
@@ -117,21 +128,55 @@ void PhotonSortingTask::Run()
 
     Cooperate();
 
-    if (strategy != nullptr)
+    if ((strategy != nullptr) && (GetSceneData()->photonSettings.progressivePasses > 1))
+    {
+        refinePass();
+    }
+    else if (strategy != nullptr)
     {
         delete strategy;
+        strategy = nullptr;
         sortPhotonMap();
     }
+    else if (GetSceneData()->photonSettings.mergeSliceCount > 0)
+    {
+        mergeSlices();
+    }
     else
     {
-        if (!this->load())
+        const unsigned char *bundleData;
+        POV_UINT64 bundleOffset, bundleSize;
+
+        // photon maps are taken from the scene bundle if there is one
+        if ((GetSceneData()->sceneBundle != nullptr) &&
+            GetSceneData()->sceneBundle->GetSection(SceneBundle::kPhotonSection, bundleData, bundleOffset, bundleSize))
+        {
+            if (!this->loadMapped(GetSceneData()->sceneBundle->GetFile(), bundleOffset, bundleSize, GetSceneData()->surfacePhotonMap, GetSceneData()->mediaPhotonMap, true))
+                mpMessageFactory->Error(POV_EXCEPTION_STRING("Failed to load photon map from scene bundle"), "Could not load photon map from scene bundle");
+        }
+        else if (!this->load(GetSceneData()->photonSettings.fileName, GetSceneData()->surfacePhotonMap, GetSceneData()->mediaPhotonMap, true))
             mpMessageFactory->Error(POV_EXCEPTION_STRING("Failed to load photon map from disk"), "Could not load photon map (%s)",GetSceneData()->photonSettings.fileName.c_str());
 
         // set photon options automatically
         if (GetSceneData()->surfacePhotonMap.numPhotons>0)
+        {
+            if (!GetSceneData()->surfacePhotonMap.hasPositionArrays())
+                GetSceneData()->surfacePhotonMap.buildPositionArrays();
             GetSceneData()->surfacePhotonMap.setGatherOptions(GetSceneData()->photonSettings,false);
+        }
         if (GetSceneData()->mediaPhotonMap.numPhotons>0)
+        {
+            if (!GetSceneData()->mediaPhotonMap.hasPositionArrays())
+                GetSceneData()->mediaPhotonMap.buildPositionArrays();
             GetSceneData()->mediaPhotonMap.setGatherOptions(GetSceneData()->photonSettings,true);
+        }
+    }
+
+    // the irradiance estimates are computed once the maps are complete
+    if ((strategy == nullptr) && (GetSceneData()->photonSettings.precomputeStride > 0))
+    {
+        precomputeIrradiance(GetSceneData()->surfacePhotonMap, GetSceneData()->surfaceIrradianceMap, false);
+        precomputeIrradiance(GetSceneData()->mediaPhotonMap, GetSceneData()->mediaIrradianceMap, true);
     }
 
     // good idea to make sure all warnings and errors arrive frontend now [trf]
@@ -149,10 +194,11 @@ void PhotonSortingTask::Finish()
     GetViewDataPtr()->timeType = TraceThreadData::kPhotonTime;
     GetViewDataPtr()->realTime = ConsumedRealTime();
     GetViewDataPtr()->cpuTime = ConsumedCPUTime();
+    GetViewDataPtr()->eventCounts = ConsumedEvents();
 }
 
 
-void PhotonSortingTask::sortPhotonMap()
+void PhotonSortingTask::sortPhotonMap(bool saveMap)
 {
     std::vector<PhotonMap*>::iterator mapIter;
     for(mapIter = surfaceMaps.begin(); mapIter != surfaceMaps.end(); mapIter++)
@@ -171,7 +217,9 @@ void PhotonSortingTask::sortPhotonMap()
     {
     //povwin::WIN32_DEBUG_FILE_OUTPUT("\n\nsurfacePhotonMap.buildTree about to be called\n");
 
-        GetSceneData()->surfacePhotonMap.buildTree();
+        Timer buildTimer;
+        GetSceneData()->surfacePhotonMap.buildTree(threads);
+        GetSceneData()->surfacePhotonBuildTime = buildTimer.ElapsedRealTime();
         GetSceneData()->surfacePhotonMap.setGatherOptions(GetSceneData()->photonSettings,false);
 //      povwin::WIN32_DEBUG_FILE_OUTPUT("gatherNumSteps: %d\n",GetSceneData()->surfacePhotonMap.gatherNumSteps);
 //      povwin::WIN32_DEBUG_FILE_OUTPUT("gatherRadStep: %lf\n",GetSceneData()->surfacePhotonMap.gatherRadStep);
@@ -193,10 +241,18 @@ void PhotonSortingTask::sortPhotonMap()
     /* ----------- media photons ------------- */
     if (GetSceneData()->mediaPhotonMap.numPhotons>0)
     {
-        GetSceneData()->mediaPhotonMap.buildTree();
+        Timer buildTimer;
+        GetSceneData()->mediaPhotonMap.buildTree(threads);
+        GetSceneData()->mediaPhotonBuildTime = buildTimer.ElapsedRealTime();
         GetSceneData()->mediaPhotonMap.setGatherOptions(GetSceneData()->photonSettings,true);
     }
 
+    if (saveMap)
+        savePhotonMap();
+}
+
+void PhotonSortingTask::savePhotonMap()
+{
     if (GetSceneData()->surfacePhotonMap.numPhotons+
 #ifdef GLOBAL_PHOTONS
         globalPhotonMap.numPhotons+
@@ -208,7 +264,11 @@ void PhotonSortingTask::sortPhotonMap()
         {
             /* status bar for user */
 //          Send_Progress("Saving Photon Maps", PROGRESS_SAVING_PHOTON_MAPS);
-            if (!this->save())
+            /* a slice of a distributed photon map goes to a file of its own */
+            std::string fileName = GetSceneData()->photonSettings.fileName;
+            if (GetSceneData()->photonSettings.sliceCount > 1)
+                fileName = sliceFileName(GetSceneData()->photonSettings.slice);
+            if (!this->save(fileName))
                 mpMessageFactory->Warning(kWarningGeneral,"Could not save photon map.");
         }
     }
@@ -220,121 +280,578 @@ void PhotonSortingTask::sortPhotonMap()
 }
 
 
-/* savePhotonMap()
+/* refinePass()
+
+  Performs one pass of progressive photon mapping.
+
+  The surface photons of the first pass are kept in the scene's photon map
+  as the points at which the photons of all passes are gathered, and are
+  each given a gather radius, a photon count and an accumulated flux.  The
+  photons of every pass (including the first) are added up within each
+  point's radius, after which the radius is reduced so that only a fraction
+  (alpha) of the new photons is retained, as in progressive photon mapping.
+  Later passes are then discarded, so that memory does not grow with the
+  number of passes.
 
-  Saves the caustic photon map to a file.
+  After the last pass, the points are given the flux that makes the usual
+  photon gathering reproduce the refined irradiance estimate, and the map is
+  saved if requested.
+
+  Media photons are taken from the first pass only.
 
   Preconditions:
-    InitBacktraceEverything was called
-    the photon map has been built and balanced
-    photonSettings.fileName contains the filename to save
+    strategy is not nullptr
+    photonSettings.progressivePasses > 1
+    surfaceMaps and mediaMaps hold the photons shot in this pass
 
   Postconditions:
-    Returns true if success, false if failure.
-    If success, the photon map has been written to the file.
+    the strategy is restarted for the next pass, or deleted after the last one
+
 */
-bool PhotonSortingTask::save()
+
+void PhotonSortingTask::refinePass()
 {
-    Photon *ph;
-    FILE *f;
-    int i;
-    size_t err;
-    int numph;
+    ScenePhotonSettings& photonSettings = GetSceneData()->photonSettings;
+    PhotonMap& pointMap = GetSceneData()->surfacePhotonMap;
+    PhotonMap passMap;
+    const PhotonMap* gatherMap = &pointMap;
 
-    f = fopen(GetSceneData()->photonSettings.fileName.c_str(), "wb");
-    if (!f)
-        return false;
+    if (strategy->pass == 0)
+    {
+        sortPhotonMap(false);
+
+        ProgressivePhotonPoint initialPoint;
+        initialPoint.radiusSqr = Sqr(pointMap.minGatherRad);
+        initialPoint.count = 0.0;
+        initialPoint.flux.Clear();
+        initialPoint.initialCount = 0;
+        strategy->points.assign(pointMap.numPhotons, initialPoint);
+    }
+    else
+    {
+        for (std::vector<PhotonMap*>::iterator i = surfaceMaps.begin(); i != surfaceMaps.end(); i++)
+            passMap.mergeMap(*i);
+        for (std::vector<PhotonMap*>::iterator i = mediaMaps.begin(); i != mediaMaps.end(); i++)
+            (*i)->clear();
+
+        if (passMap.numPhotons > 0)
+            passMap.buildTree(threads);
+        gatherMap = &passMap;
+    }
 
-    /* caustic photons */
-    numph = GetSceneData()->surfacePhotonMap.numPhotons;
-    fwrite(&numph, sizeof(numph),1,f);
-    if ((numph > 0) && !GetSceneData()->surfacePhotonMap.mBlockList.empty())
+    Cooperate();
+
+    int numPoints = int(strategy->points.size());
+    unsigned int numThreads = std::max(1u, std::min(threads, unsigned(numPoints / 1024)));
+    std::vector<std::thread> workers;
+    std::vector<std::exception_ptr> errors(numThreads);
+    for (unsigned int t = 0; t < numThreads; t++)
     {
-        for(i=0; i<numph; i++)
+        int first = int(POV_LONG(numPoints) * t / numThreads);
+        int end = int(POV_LONG(numPoints) * (t + 1) / numThreads);
+        auto work = [this, gatherMap, first, end, &errors, t]()
         {
-            ph = &GetSceneData()->surfacePhotonMap.GetPhoton(i);
-            err = fwrite(ph, sizeof(Photon), 1, f);
-
-            if (err<=0)
+            try
             {
-                /* fwrite returned an error! */
-                fclose(f);
-                return false;
+                accumulatePhotons(*gatherMap, first, end);
             }
-        }
+            catch (...)
+            {
+                errors[t] = std::current_exception();
+            }
+        };
+        if (t + 1 < numThreads)
+            workers.emplace_back(work);
+        else
+            work();
+    }
+    for (auto&& worker : workers)
+        worker.join();
+    for (auto&& error : errors)
+    {
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    passMap.clear();
+
+    if (strategy->pass + 1 < photonSettings.progressivePasses)
+    {
+        strategy->restart();
     }
     else
     {
-        mpMessageFactory->PossibleError("Photon map for surface is empty.");
+        finishProgressive();
+        delete strategy;
+        strategy = nullptr;
+        savePhotonMap();
     }
+}
 
-#ifdef GLOBAL_PHOTONS
-    /* global photons */
-    numph = globalPhotonMap.numPhotons;
-    fwrite(&numph, sizeof(numph),1,f);
-    if ((numph > 0) && !globalPhotonMap.mBlockList.empty())
+/* accumulatePhotons()
+
+  Adds the photons of one progressive pass to the points first..end-1, and
+  shrinks their radii.
+
+*/
+
+void PhotonSortingTask::accumulatePhotons(const PhotonMap& passMap, int first, int end)
+{
+    const PhotonMap& pointMap = GetSceneData()->surfacePhotonMap;
+    DBL alpha = GetSceneData()->photonSettings.progressiveAlpha;
+    bool firstPass = (strategy->pass == 0);
+
+    for (int i = first; i < end; i++)
     {
-        for(i=0; i<numph; i++)
+        ProgressivePhotonPoint& point = strategy->points[i];
+        const Photon& photon = pointMap.GetPhoton(i);
+        Vector3d direction = photon.GetDirection();
+        PreciseRGBColour flux;
+        int count;
+
+        // only count photons arriving at the same side of the surface as the point's own photon
+        passMap.sumPhotons(Vector3d(photon.Loc), point.radiusSqr, &direction, flux, count);
+
+        if (firstPass)
+            point.initialCount = count;
+
+        if (count > 0)
         {
-            ph = &globalPhotonMap.GetPhoton(i);
-            err = fwrite(ph, sizeof(Photon), 1, f);
+            DBL ratio = (point.count + alpha * count) / (point.count + count);
+            point.count += alpha * count;
+            point.radiusSqr *= ratio;
+            point.flux = (point.flux + flux) * ratio;
+        }
+    }
+}
 
-            if (err<=0)
+/* precomputeIrradiance()
+
+  Estimates the irradiance at every photonSettings.precomputeStride-th photon
+  of a map, and builds a kd-tree of these estimates, so that radiosity and
+  media photon lookups can take the nearest estimate instead of gathering and
+  summing up the photons around each point.
+
+  The estimates are independent of each other, and are computed on up to
+  "threads" threads.
+
+  Preconditions:
+    the kd-tree of the map has been built and its gather options set
+
+*/
+
+void PhotonSortingTask::precomputeIrradiance(PhotonMap& map, PhotonMap& estimates, bool mediaMap)
+{
+    ScenePhotonSettings& photonSettings = GetSceneData()->photonSettings;
+    int stride = photonSettings.precomputeStride;
+
+    estimates.clear();
+    if (map.numPhotons <= 0)
+        return;
+
+    // each estimate starts out as a copy of its photon, so that it has its location and direction
+    int numEstimates = (map.numPhotons + stride - 1) / stride;
+    for (int i = 0; i < numEstimates; i++)
+        *estimates.AllocatePhoton() = map.GetPhoton(i * stride);
+
+    Cooperate();
+
+    unsigned int numThreads = std::max(1u, std::min(threads, unsigned(numEstimates / 1024)));
+    std::vector<std::thread> workers;
+    std::vector<std::exception_ptr> errors(numThreads);
+    for (unsigned int t = 0; t < numThreads; t++)
+    {
+        int first = int(POV_LONG(numEstimates) * t / numThreads);
+        int end = int(POV_LONG(numEstimates) * (t + 1) / numThreads);
+        auto work = [&map, &estimates, &photonSettings, mediaMap, first, end, &errors, t]()
+        {
+            try
             {
-                /* fwrite returned an error! */
-                fclose(f);
-                return false;
+                PhotonGatherer gatherer(&map, photonSettings);
+                for (int i = first; i < end; i++)
+                {
+                    Photon& estimate = estimates.GetPhoton(i);
+                    gatherer.estimateIrradiance(Vector3d(estimate.Loc), mediaMap, estimate);
+                }
             }
-        }
+            catch (...)
+            {
+                errors[t] = std::current_exception();
+            }
+        };
+        if (t + 1 < numThreads)
+            workers.emplace_back(work);
+        else
+            work();
     }
-    else
+    for (auto&& worker : workers)
+        worker.join();
+    for (auto&& error : errors)
     {
-        mpMessageFactory->PossibleError("Global photon map is empty.");
+        if (error)
+            std::rethrow_exception(error);
     }
-#endif
 
-    /* media photons */
-    numph = GetSceneData()->mediaPhotonMap.numPhotons;
-    fwrite(&numph, sizeof(numph),1,f);
-    if ((numph > 0) && !GetSceneData()->mediaPhotonMap.mBlockList.empty())
+    Cooperate();
+
+    estimates.buildTree(threads);
+}
+
+/* finishProgressive()
+
+  Converts the points' accumulated flux back to photons.
+
+  The refined irradiance at a point is flux/(pi*r^2*passes), where r is its
+  final radius.  The render gathers photons over roughly the density of the
+  first pass, i.e. initialCount photons per pi*r0^2, so each point's photon
+  is given its share of the irradiance within the initial radius r0.
+
+*/
+
+void PhotonSortingTask::finishProgressive()
+{
+    PhotonMap& pointMap = GetSceneData()->surfacePhotonMap;
+    DBL initialRadiusSqr = Sqr(pointMap.minGatherRad);
+    DBL passes = GetSceneData()->photonSettings.progressivePasses;
+
+    for (int i = 0; i < int(strategy->points.size()); i++)
     {
-        for(i=0; i<numph; i++)
-        {
-            ph = &GetSceneData()->mediaPhotonMap.GetPhoton(i);
-            err = fwrite(ph, sizeof(Photon), 1, f);
+        const ProgressivePhotonPoint& point = strategy->points[i];
+        PreciseRGBColour flux;
+        if ((point.radiusSqr > 0.0) && (point.initialCount > 0))
+            flux = point.flux * (initialRadiusSqr / (point.radiusSqr * passes * point.initialCount));
+        pointMap.GetPhoton(i).colour = PhotonColour(RGBColour(flux));
+    }
 
-            if (err<=0)
-            {
-                /* fwrite returned an error! */
-                fclose(f);
-                return false;
-            }
-        }
+    std::vector<ProgressivePhotonPoint>().swap(strategy->points);
+}
+
+
+/* mergeSlices()
+
+  Loads the partial photon maps shot by distributed renders with the
+  Photon_Slices option, and merges them into a single map, which is then
+  sorted and saved to the photon map file just like a map shot locally.
+
+  Preconditions:
+    photonSettings.mergeSliceCount is the number of slices
+    photonSettings.fileName contains the filename to save
+
+  Postconditions:
+    the photon map has been merged, built and saved
+*/
+void PhotonSortingTask::mergeSlices()
+{
+    std::vector<std::unique_ptr<PhotonMap>> sliceMaps;
+
+    for (int slice = 1; slice <= GetSceneData()->photonSettings.mergeSliceCount; slice++)
+    {
+        std::string fileName = sliceFileName(slice);
+        PhotonMap *surfaceMap = new PhotonMap;
+        PhotonMap *mediaMap = new PhotonMap;
+
+        sliceMaps.emplace_back(surfaceMap);
+        sliceMaps.emplace_back(mediaMap);
+
+        // the photons are copied, as merging transfers the blocks
+        if (!load(fileName, *surfaceMap, *mediaMap, false))
+            mpMessageFactory->Error(POV_EXCEPTION_STRING("Failed to load photon map slice from disk"), "Could not load photon map slice (%s)", fileName.c_str());
+
+        surfaceMaps.push_back(surfaceMap);
+        mediaMaps.push_back(mediaMap);
+
+        Cooperate();
     }
-    else
+
+    sortPhotonMap();
+
+    surfaceMaps.clear();
+    mediaMaps.clear();
+}
+
+/* sliceFileName()
+
+  Returns the name of the file holding the given slice of a distributed
+  photon map.
+*/
+std::string PhotonSortingTask::sliceFileName(int slice)
+{
+    return GetSceneData()->photonSettings.fileName + "." + std::to_string(slice);
+}
+
+
+/* Binary photon map files
+
+  The file starts with a PhotonFileHeader, followed by the surface photons,
+  the surface photon position arrays (all X, then all Y, then all Z), the
+  media photons and the media photon position arrays, each aligned to
+  PHOTON_FILE_ALIGNMENT bytes.  The photons are stored in kd-tree order in
+  native layout and byte order, so that the file can be memory-mapped and
+  used in place; the element sizes serve to reject files written by an
+  incompatible build.
+
+  Files without the header are read in the old format, which holds just the
+  photon counts and photons.
+*/
+
+/// Identification of binary photon map files.
+const char PHOTON_FILE_MAGIC[8] = { 'P', 'O', 'V', 'P', 'H', 'O', 'T', 0x1A };
+
+/// Version of the binary photon map file format.
+const POV_UINT32 PHOTON_FILE_VERSION = 1;
+
+/// Value identifying the byte order of binary photon map files.
+const POV_UINT32 PHOTON_FILE_BYTE_ORDER = 0x01020304;
+
+/// Alignment of the arrays in binary photon map files.
+const POV_UINT64 PHOTON_FILE_ALIGNMENT = 16;
+
+/// Header of binary photon map files.
+struct PhotonFileHeader final
+{
+    char magic[8];
+    POV_UINT32 version;
+    POV_UINT32 byteOrder;
+    POV_UINT32 photonSize;
+    POV_UINT32 scalarSize;
+    POV_INT32 numberOfSurfacePhotons;
+    POV_INT32 numberOfMediaPhotons;
+    POV_UINT64 surfacePhotonOffset;
+    POV_UINT64 surfacePositionOffset;
+    POV_UINT64 mediaPhotonOffset;
+    POV_UINT64 mediaPositionOffset;
+};
+
+static POV_UINT64 AlignPhotonFileOffset(POV_UINT64 offset)
+{
+    return (offset + PHOTON_FILE_ALIGNMENT - 1) & ~(PHOTON_FILE_ALIGNMENT - 1);
+}
+
+static bool WritePhotonFilePadding(FILE *f, POV_UINT64& pos, POV_UINT64 offset)
+{
+    static const char padding[PHOTON_FILE_ALIGNMENT] = { 0 };
+
+    POV_ASSERT((offset >= pos) && (offset - pos < PHOTON_FILE_ALIGNMENT));
+
+    if ((offset > pos) && (fwrite(padding, size_t(offset - pos), 1, f) != 1))
+        return false;
+
+    pos = offset;
+    return true;
+}
+
+static bool WritePhotonFileMap(FILE *f, POV_UINT64& pos, const PhotonMap& map, POV_UINT64 photonOffset, POV_UINT64 positionOffset)
+{
+    if (!WritePhotonFilePadding(f, pos, photonOffset))
+        return false;
+
+    for (int i = 0; i < map.numPhotons; i++)
     {
-        mpMessageFactory->PossibleError("Photon map for media is empty.");
+        if (fwrite(&map.GetPhoton(i), sizeof(Photon), 1, f) != 1)
+            return false;
     }
+    pos += POV_UINT64(map.numPhotons) * sizeof(Photon);
+
+    if (!WritePhotonFilePadding(f, pos, positionOffset))
+        return false;
+
+    if (map.numPhotons > 0)
+    {
+        if ((fwrite(map.positionX, sizeof(PhotonScalar), map.numPhotons, f) != size_t(map.numPhotons)) ||
+            (fwrite(map.positionY, sizeof(PhotonScalar), map.numPhotons, f) != size_t(map.numPhotons)) ||
+            (fwrite(map.positionZ, sizeof(PhotonScalar), map.numPhotons, f) != size_t(map.numPhotons)))
+            return false;
+    }
+    pos += POV_UINT64(map.numPhotons) * 3 * sizeof(PhotonScalar);
 
-    fclose(f);
     return true;
 }
 
+static bool PhotonFileArrayValid(POV_UINT64 offset, POV_INT32 count, size_t elementSize, size_t fileSize)
+{
+    return (offset >= sizeof(PhotonFileHeader)) && (offset % PHOTON_FILE_ALIGNMENT == 0) && (count >= 0) &&
+           (offset <= fileSize) && (POV_UINT64(count) * elementSize <= fileSize - offset);
+}
+
+static bool MapPhotonFileMap(PhotonMap& map, const std::shared_ptr<pov_base::Filesystem::MappedFile>& file, POV_UINT64 fileOffset, POV_UINT64 size,
+                             POV_UINT64 photonOffset, POV_UINT64 positionOffset, POV_INT32 count, bool inPlace)
+{
+    const unsigned char *base = reinterpret_cast<const unsigned char *>(file->GetData()) + fileOffset;
+
+    if (!PhotonFileArrayValid(photonOffset, count, sizeof(Photon), size) ||
+        !PhotonFileArrayValid(positionOffset, count, 3 * sizeof(PhotonScalar), size))
+        return false;
+
+    if (count == 0)
+        return true;
+
+    const Photon *photons = reinterpret_cast<const Photon *>(base + photonOffset);
+
+    // the kd-tree split axis is used as an index, so make sure a damaged file cannot cause harm
+    for (POV_INT32 i = 0; i < count; i++)
+    {
+        if (photons[i].info > Z)
+            return false;
+    }
+
+    if (inPlace)
+        map.mapPhotons(file, photons, reinterpret_cast<const PhotonScalar *>(base + positionOffset), count);
+    else
+    {
+        for (POV_INT32 i = 0; i < count; i++)
+            *map.AllocatePhoton() = photons[i];
+    }
+    return true;
+}
+
+
+/* savePhotonMap()
+
+  Saves the surface and media photon maps to a binary photon map file.
+
+  Preconditions:
+    InitBacktraceEverything was called
+    the photon map has been built and balanced
+    'fileName' is the filename to save
+
+  Postconditions:
+    Returns true if success, false if failure.
+    If success, the photon map has been written to the file.
+*/
+bool PhotonSortingTask::save(const std::string& fileName)
+{
+    PhotonMap& surfaceMap = GetSceneData()->surfacePhotonMap;
+    PhotonMap& mediaMap = GetSceneData()->mediaPhotonMap;
+    PhotonFileHeader header;
+    POV_UINT64 pos = 0;
+    FILE *f;
+    bool ok;
+
+    if (surfaceMap.numPhotons <= 0)
+        mpMessageFactory->PossibleError("Photon map for surface is empty.");
+    if (mediaMap.numPhotons <= 0)
+        mpMessageFactory->PossibleError("Photon map for media is empty.");
+
+    if ((surfaceMap.numPhotons > 0) && !surfaceMap.hasPositionArrays())
+        surfaceMap.buildPositionArrays();
+    if ((mediaMap.numPhotons > 0) && !mediaMap.hasPositionArrays())
+        mediaMap.buildPositionArrays();
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, PHOTON_FILE_MAGIC, sizeof(header.magic));
+    header.version                = PHOTON_FILE_VERSION;
+    header.byteOrder              = PHOTON_FILE_BYTE_ORDER;
+    header.photonSize             = sizeof(Photon);
+    header.scalarSize             = sizeof(PhotonScalar);
+    header.numberOfSurfacePhotons = std::max(surfaceMap.numPhotons, 0);
+    header.numberOfMediaPhotons   = std::max(mediaMap.numPhotons, 0);
+
+    header.surfacePhotonOffset   = AlignPhotonFileOffset(sizeof(header));
+    header.surfacePositionOffset = AlignPhotonFileOffset(header.surfacePhotonOffset   + POV_UINT64(header.numberOfSurfacePhotons) * sizeof(Photon));
+    header.mediaPhotonOffset     = AlignPhotonFileOffset(header.surfacePositionOffset + POV_UINT64(header.numberOfSurfacePhotons) * 3 * sizeof(PhotonScalar));
+    header.mediaPositionOffset   = AlignPhotonFileOffset(header.mediaPhotonOffset     + POV_UINT64(header.numberOfMediaPhotons)   * sizeof(Photon));
+
+    f = fopen(fileName.c_str(), "wb");
+    if (!f)
+        return false;
+
+    ok = (fwrite(&header, sizeof(header), 1, f) == 1);
+    pos = sizeof(header);
+    ok = ok && WritePhotonFileMap(f, pos, surfaceMap, header.surfacePhotonOffset, header.surfacePositionOffset);
+    ok = ok && WritePhotonFileMap(f, pos, mediaMap, header.mediaPhotonOffset, header.mediaPositionOffset);
+
+    if (fclose(f) != 0)
+        ok = false;
+
+    return ok;
+}
+
 /* loadPhotonMap()
 
-  Loads the caustic photon map from a file.
+  Loads the surface and media photon maps from a file.
+
+  Binary photon map files are memory-mapped and, if 'inPlace' is set, used
+  in place; otherwise the photons are copied.  Files in the old format are
+  read by loadLegacy().
 
   Preconditions:
     InitBacktraceEverything was called
-    the photon map is empty
-    renderer->sceneData->photonSettings.fileName contains the filename to load
+    'surfaceMap' and 'mediaMap' are empty
+    'fileName' is the filename to load
 
   Postconditions:
     Returns true if success, false if failure.
     If success, the photon map has been loaded from the file.
     If failure then the render should stop with an error
 */
-bool PhotonSortingTask::load()
+bool PhotonSortingTask::load(const std::string& fileName, PhotonMap& surfaceMap, PhotonMap& mediaMap, bool inPlace)
+{
+    std::shared_ptr<pov_base::Filesystem::MappedFile> file(new pov_base::Filesystem::MappedFile);
+    PhotonFileHeader header;
+
+    if (!GetSceneData()->photonSettings.photonsEnabled) return false;
+
+    mpMessageFactory->Warning(kWarningGeneral,"Starting the load of photon file %s\n",fileName.c_str());
+
+    if (!file->Open(SysToUCS2String(fileName)))
+        return false;
+
+    if ((file->GetSize() < sizeof(header.magic)) ||
+        (memcmp(file->GetData(), PHOTON_FILE_MAGIC, sizeof(header.magic)) != 0))
+    {
+        file.reset();
+        return loadLegacy(fileName, surfaceMap, mediaMap);
+    }
+
+    return loadMapped(file, 0, file->GetSize(), surfaceMap, mediaMap, inPlace);
+}
+
+/* loadMapped()
+
+  Loads the photon maps from a binary photon map file embedded in a
+  memory-mapped file at the given offset, e.g. as a section of a scene
+  bundle.
+
+  Preconditions:
+    same as load()
+    'offset' is aligned to PHOTON_FILE_ALIGNMENT
+
+  Postconditions:
+    same as load()
+*/
+bool PhotonSortingTask::loadMapped(const std::shared_ptr<pov_base::Filesystem::MappedFile>& file, POV_UINT64 offset, POV_UINT64 size,
+                                   PhotonMap& surfaceMap, PhotonMap& mediaMap, bool inPlace)
+{
+    PhotonFileHeader header;
+
+    if ((offset % PHOTON_FILE_ALIGNMENT != 0) || (size < sizeof(header)))
+        return false;
+
+    memcpy(&header, reinterpret_cast<const unsigned char *>(file->GetData()) + offset, sizeof(header));
+
+    if ((memcmp(header.magic, PHOTON_FILE_MAGIC, sizeof(header.magic)) != 0) ||
+        (header.version != PHOTON_FILE_VERSION) ||
+        (header.byteOrder != PHOTON_FILE_BYTE_ORDER) ||
+        (header.photonSize != sizeof(Photon)) ||
+        (header.scalarSize != sizeof(PhotonScalar)))
+        return false;
+
+    return MapPhotonFileMap(surfaceMap, file, offset, size, header.surfacePhotonOffset, header.surfacePositionOffset, header.numberOfSurfacePhotons, inPlace) &&
+           MapPhotonFileMap(mediaMap, file, offset, size, header.mediaPhotonOffset, header.mediaPositionOffset, header.numberOfMediaPhotons, inPlace);
+}
+
+/* loadLegacy()
+
+  Loads the photon maps from a file in the old format, which is just the
+  number of photons and the photons themselves for each map.
+
+  Preconditions:
+    same as load()
+
+  Postconditions:
+    same as load()
+*/
+bool PhotonSortingTask::loadLegacy(const std::string& fileName, PhotonMap& surfaceMap, PhotonMap& mediaMap)
 {
     int i;
     size_t err;
@@ -342,11 +859,7 @@ bool PhotonSortingTask::load()
     FILE *f;
     int numph;
 
-    if (!GetSceneData()->photonSettings.photonsEnabled) return false;
-
-    mpMessageFactory->Warning(kWarningGeneral,"Starting the load of photon file %s\n",GetSceneData()->photonSettings.fileName.c_str());
-
-    f = fopen(GetSceneData()->photonSettings.fileName.c_str(), "rb");
+    f = fopen(fileName.c_str(), "rb");
     if (!f)
         return false;
 
@@ -354,7 +867,7 @@ bool PhotonSortingTask::load()
 
     for(i=0; i<numph; i++)
     {
-        ph = GetSceneData()->surfacePhotonMap.AllocatePhoton();
+        ph = surfaceMap.AllocatePhoton();
         err = fread(ph, sizeof(Photon), 1, f);
 
         if (err<=0)
@@ -389,7 +902,7 @@ bool PhotonSortingTask::load()
         fread(&numph, sizeof(numph),1,f);
         for(i=0; i<numph; i++)
         {
-            ph = GetSceneData()->mediaPhotonMap.AllocatePhoton();
+            ph = mediaMap.AllocatePhoton();
             err = fread(ph, sizeof(Photon), 1, f);
 
             if (err<=0)
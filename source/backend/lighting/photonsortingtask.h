@@ -43,9 +43,14 @@
 //  (none at the moment)
 
 // C++ standard header files
+#include <memory>
+#include <string>
 #include <vector>
 
 // POV-Ray header files (base module)
+#include "base/filesystem_fwd.h"
+
+// POV-Ray header files (core module)
 #include "core/lighting/photons_fwd.h"
 
 // POV-Ray header files (core module)
@@ -66,9 +71,10 @@ class PhotonSortingTask final : public RenderTask
         std::vector<PhotonMap*> surfaceMaps;
         std::vector<PhotonMap*> mediaMaps;
         PhotonShootingStrategy* strategy;
+        unsigned int threads;
 
         PhotonSortingTask(ViewData *vd, const std::vector<PhotonMap*>& surfaceMaps, const std::vector<PhotonMap*>& mediaMaps,
-                          PhotonShootingStrategy* strategy, size_t seed);
+                          PhotonShootingStrategy* strategy, size_t seed, unsigned int threads = 1);
         virtual ~PhotonSortingTask() override;
 
         virtual void Run() override;
@@ -77,9 +83,19 @@ class PhotonSortingTask final : public RenderTask
 
         void SendProgress();
 
-        void sortPhotonMap();
-        bool save();
-        bool load();
+        void sortPhotonMap(bool saveMap = true);
+        void savePhotonMap();
+        void refinePass();
+        void accumulatePhotons(const PhotonMap& passMap, int first, int end);
+        void finishProgressive();
+        void precomputeIrradiance(PhotonMap& map, PhotonMap& estimates, bool mediaMap);
+        void mergeSlices();
+        std::string sliceFileName(int slice);
+        bool save(const std::string& fileName);
+        bool load(const std::string& fileName, PhotonMap& surfaceMap, PhotonMap& mediaMap, bool inPlace);
+        bool loadMapped(const std::shared_ptr<pov_base::Filesystem::MappedFile>& file, POV_UINT64 offset, POV_UINT64 size,
+                        PhotonMap& surfaceMap, PhotonMap& mediaMap, bool inPlace);
+        bool loadLegacy(const std::string& fileName, PhotonMap& surfaceMap, PhotonMap& mediaMap);
     private:
         class CooperateFunction final : public Trace::CooperateFunctor
         {
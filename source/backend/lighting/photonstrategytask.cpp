@@ -49,7 +49,10 @@
 #include "core/bounding/boundingbox.h"
 #include "core/lighting/lightgroup.h"
 #include "core/lighting/lightsource.h"
+#include "core/lighting/photons.h"
 #include "core/math/matrix.h"
+#include "core/render/ray.h"
+#include "core/scene/camera.h"
 #include "core/scene/object.h"
 #include "core/shape/csg.h"
 #include "core/support/octree.h"
@@ -74,12 +77,15 @@ namespace pov
 
 using std::vector;
 
+/// Number of camera rays across the image width used to determine visual importance.
+const int PHOTON_IMPORTANCE_RAYS = 128;
+
 PhotonStrategyTask::PhotonStrategyTask(ViewData *vd, PhotonShootingStrategy* strategy, size_t seed) :
     RenderTask(vd, seed, "Photon"),
     strategy(strategy),
     cooperate(*this)
 {
-    // do nothing
+    SetTimelineName("Photon strategy");
 }
 
 PhotonStrategyTask::~PhotonStrategyTask()
@@ -105,6 +111,9 @@ void PhotonStrategyTask::Run()
 
     Cooperate();
 
+    if (GetSceneData()->photonSettings.importance < 1.0)
+        ComputeVisualImportance();
+
     /*  loop through global light sources  */
     GetViewDataPtr()->Light_Is_Global = true;
     for(vector<LightSource *>::iterator Light = GetSceneData()->lightSources.begin(); Light != GetSceneData()->lightSources.end(); Light++)
@@ -142,7 +151,7 @@ void PhotonStrategyTask::Run()
     // good idea to make sure all warnings and errors arrive frontend now [trf]
     Cooperate();
 
-    strategy->start();
+    strategy->start(GetSceneData()->photonSettings.slice, GetSceneData()->photonSettings.sliceCount);
 }
 
 void PhotonStrategyTask::Stopped()
@@ -155,9 +164,89 @@ void PhotonStrategyTask::Finish()
     GetViewDataPtr()->timeType = TraceThreadData::kPhotonTime;
     GetViewDataPtr()->realTime = ConsumedRealTime();
     GetViewDataPtr()->cpuTime = ConsumedCPUTime();
+    GetViewDataPtr()->eventCounts = ConsumedEvents();
 }
 
 
+/*****************************************************************************
+
+ FUNCTION
+
+  ComputeVisualImportance()
+
+  Traces a coarse grid of camera rays, and marks the regions around the
+  surfaces they hit as seen by the camera. Only the first intersection of
+  each ray is considered, so surfaces seen only via reflection or refraction
+  are not marked; photons landing there are still shot, just more sparsely.
+
+  Preconditions:
+    Visual importance enabled (photonSettings.importance < 1)
+
+  Postconditions:
+    The strategy's visibleRegions have been built; if the camera type is
+    not supported, they remain empty and photon shooting is unguided.
+
+******************************************************************************/
+
+void PhotonStrategyTask::ComputeVisualImportance()
+{
+    std::shared_ptr<SceneData> sceneData = GetSceneData();
+    const Camera& camera = GetViewData()->GetCamera();
+
+    if ((camera.Type != PERSPECTIVE_CAMERA) && (camera.Type != ORTHOGRAPHIC_CAMERA))
+    {
+        mpMessageFactory->Warning(kWarningGeneral, "Photon importance requires a perspective or orthographic camera; "
+                                                   "photons will be shot without it.");
+        return;
+    }
+
+    PhotonTrace trace(sceneData, GetViewDataPtr(), GetViewData()->GetQualityFeatureFlags(), cooperate);
+
+    int width = PHOTON_IMPORTANCE_RAYS;
+    int height = std::max(1, int(PHOTON_IMPORTANCE_RAYS * DBL(GetViewData()->GetHeight()) / DBL(GetViewData()->GetWidth()) + 0.5));
+    DBL rayWidth = camera.Right.length() / width;
+
+    vector<Vector3d> points;
+    vector<DBL> footprints;
+
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            DBL x0 = (x + 0.5) / width - 0.5;
+            DBL y0 = 0.5 - (y + 0.5) / height;
+
+            TraceTicket ticket(1, 0.0);
+            Ray ray(ticket);
+            DBL footprintPerDepth = 0.0;
+
+            if (camera.Type == PERSPECTIVE_CAMERA)
+            {
+                ray.Origin = camera.Location;
+                ray.Direction = camera.Direction + x0 * camera.Right + y0 * camera.Up;
+                footprintPerDepth = rayWidth / ray.Direction.length();
+            }
+            else
+            {
+                ray.Origin = camera.Location + x0 * camera.Right + y0 * camera.Up;
+                ray.Direction = camera.Direction;
+            }
+            ray.Direction.normalize();
+
+            Intersection isect;
+            if (trace.FindIntersection(isect, ray))
+            {
+                points.push_back(isect.IPoint);
+                footprints.push_back((camera.Type == PERSPECTIVE_CAMERA) ? footprintPerDepth * isect.Depth : rayWidth);
+            }
+        }
+
+        Cooperate();
+    }
+
+    strategy->visibleRegions.build(points, footprints);
+}
+
 /*****************************************************************************
 
  FUNCTION
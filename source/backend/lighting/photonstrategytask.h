@@ -75,6 +75,9 @@ class PhotonStrategyTask final : public RenderTask
         void SendProgress();
 
         void SearchThroughObjectsCreateUnits(std::vector<ObjectPtr>& Objects, LightSource *Light);
+
+        /// Mark the regions of the scene seen by the camera, using a coarse grid of camera rays.
+        void ComputeVisualImportance();
     private:
         class CooperateFunction final : public Trace::CooperateFunctor
         {
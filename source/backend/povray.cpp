@@ -53,8 +53,10 @@
 #include "base/types.h"
 
 // POV-Ray header files (core module)
+#include "core/bounding/boundingbox.h"
 #include "core/material/noise.h"
 #include "core/material/pattern.h"
+#include "core/math/matrix.h"
 
 // POV-Ray header files (POVMS module)
 #include "povms/povmscpp.h"
@@ -526,6 +528,34 @@ void BuildInitInfo(POVMSObjectPtr msg)
             else
                 err = POVMSAttr_Delete(&attr);
         }
+#endif
+#ifdef TRY_OPTIMIZED_BBOX
+        const OptimizedBBoxInfo* pBBox = GetRecommendedOptimizedBBox();
+        std::string bboxInfo = "Bounding box test: " + std::string(pBBox->name) + " (" + std::string(pBBox->info) + ")";
+        if (err == kNoErr)
+            err = POVMSAttr_New(&attr);
+        if (err == kNoErr)
+        {
+            err = POVMSAttr_Set(&attr, kPOVMSType_CString, reinterpret_cast<const void *>(bboxInfo.c_str()), bboxInfo.length() + 1);
+            if (err == kNoErr)
+                err = POVMSAttrList_Append(&attrlist, &attr);
+            else
+                err = POVMSAttr_Delete(&attr);
+        }
+#endif
+#ifdef TRY_OPTIMIZED_TRANSFORM
+        const OptimizedTransformInfo* pTransform = GetRecommendedOptimizedTransform();
+        std::string transformInfo = "Vector transformation: " + std::string(pTransform->name) + " (" + std::string(pTransform->info) + ")";
+        if (err == kNoErr)
+            err = POVMSAttr_New(&attr);
+        if (err == kNoErr)
+        {
+            err = POVMSAttr_Set(&attr, kPOVMSType_CString, reinterpret_cast<const void *>(transformInfo.c_str()), transformInfo.length() + 1);
+            if (err == kNoErr)
+                err = POVMSAttrList_Append(&attrlist, &attr);
+            else
+                err = POVMSAttr_Delete(&attr);
+        }
 #endif
     }
     if (err == kNoErr)
@@ -69,11 +69,14 @@ using namespace pov_base;
 using std::min;
 using std::max;
 
-RadiosityTask::RadiosityTask(ViewData *vd, DBL ptsz, DBL ptesz, unsigned int pts, unsigned int ptsc, unsigned int nt,
-                             size_t seed) :
+RadiosityTask::RadiosityTask(ViewData *vd, DBL ptsz, DBL ptesz, unsigned int pts, unsigned int ptsc, bool hr,
+                             size_t seed, unsigned int rg, unsigned int rgc) :
     RenderTask(vd, seed, "Radiosity", vd->GetViewId()),
     trace(vd->GetSceneData(), &vd->GetCamera(), GetViewDataPtr(), vd->GetSceneData()->parsedMaxTraceLevel, vd->GetSceneData()->parsedAdcBailout,
           vd->GetQualityFeatureFlags(), cooperate, media, radiosity, !vd->GetSceneData()->radiositySettings.vainPretrace),
+    pretraceStartSize(ptsz),
+    pretraceEndSize(ptesz),
+    pretraceCoverage(vd->GetSceneData()->radiositySettings.nearestCountAPT),
     cooperate(*this),
     media(GetViewDataPtr(), &trace, &photonGatherer),
     radiosity(vd->GetSceneData(), GetViewDataPtr(),
@@ -81,10 +84,9 @@ RadiosityTask::RadiosityTask(ViewData *vd, DBL ptsz, DBL ptesz, unsigned int pts
     photonGatherer(&vd->GetSceneData()->surfacePhotonMap, vd->GetSceneData()->photonSettings),
     pretraceStep(pts),
     pretraceStepCount(ptsc),
-    pretraceStartSize(ptsz),
-    pretraceEndSize(ptesz),
-    pretraceCoverage(vd->GetSceneData()->radiositySettings.nearestCountAPT),
-    nominalThreads(nt)
+    highReproducibility(hr),
+    region(rg),
+    regionCount(rgc)
 {
 }
 
@@ -111,7 +113,7 @@ void RadiosityTask::Run()
 
     ViewData::BlockInfo* pInfo;
 
-    while(GetViewData()->GetNextRectangle(rect, serial, pInfo, nominalThreads) == true)
+    while(GetViewData()->GetNextRectangle(rect, serial, pInfo, 0, region, regionCount) == true)
     {
         RadiosityBlockInfo* pBlockInfo = dynamic_cast<RadiosityBlockInfo*>(pInfo);
         if (!pBlockInfo)
@@ -128,8 +130,10 @@ void RadiosityTask::Run()
         double pretraceSize     = max(pretraceStartSize * pow(0.5f, (float)pBlockInfo->pass),     pretraceEndSize);
         double nextPretraceSize = max(pretraceStartSize * pow(0.5f, (float)pBlockInfo->pass + 1), pretraceEndSize);
 
-        radiosity.BeforeTile((nominalThreads? serial % nominalThreads : 0), pretraceStep + pBlockInfo->pass);
+        radiosity.BeforeTile((highReproducibility? serial : 0), pretraceStep + pBlockInfo->pass);
         randgen.SetSeed((pretraceStep + pBlockInfo->pass) * 17 + serial * 13); // make sure our jitter is different (but reproducible) for each pass and tile
+        if (highReproducibility)
+            trace.SeedStreams((pretraceStep + pBlockInfo->pass) * 17 + serial * 13);
 
         unsigned int px = (rect.GetWidth()  + pretraceSize - 1) / pretraceSize;
         unsigned int py = (rect.GetHeight() + pretraceSize - 1) / pretraceSize;
@@ -272,6 +276,7 @@ void RadiosityTask::Finish()
     GetViewDataPtr()->timeType = TraceThreadData::kRadiosityTime;
     GetViewDataPtr()->realTime = ConsumedRealTime();
     GetViewDataPtr()->cpuTime = ConsumedCPUTime();
+    GetViewDataPtr()->eventCounts = ConsumedEvents();
 }
 
 }
@@ -62,8 +62,8 @@ namespace pov
 class RadiosityTask final : public RenderTask
 {
     public:
-        RadiosityTask(ViewData *vd, DBL ptsz, DBL ptesz, unsigned int pts, unsigned int ptsc, unsigned int nt,
-                      size_t seed);
+        RadiosityTask(ViewData *vd, DBL ptsz, DBL ptesz, unsigned int pts, unsigned int ptsc, bool hr,
+                      size_t seed, unsigned int rg = 0, unsigned int rgc = 0);
         virtual ~RadiosityTask() override;
 
         virtual void Run() override;
@@ -113,7 +113,12 @@ class RadiosityTask final : public RenderTask
 
         unsigned int pretraceStep;
         unsigned int pretraceStepCount;
-        int nominalThreads;
+        /// whether to key tiles and random number streams by tile rather than by thread
+        bool highReproducibility;
+        /// screen region this task prefers to work on, for locality-aware dispatching
+        unsigned int region;
+        /// number of screen regions, or 0 to dispatch blocks in render pattern order
+        unsigned int regionCount;
 };
 
 }
@@ -41,6 +41,7 @@
 
 // C++ standard header files
 #include <algorithm>
+#include <chrono>
 #include <limits>
 
 // POV-Ray header files (base module)
@@ -54,7 +55,10 @@
 #include "core/math/chi2.h"
 #include "core/math/jitter.h"
 #include "core/math/matrix.h"
+#include "core/math/samplesequence.h"
 #include "core/render/trace.h"
+#include "core/scene/camera.h"
+#include "core/scene/object.h"
 #include "core/support/statistics.h"
 
 // POV-Ray header files (POVMS module)
@@ -62,6 +66,7 @@
 
 // POV-Ray header files (backend module)
 #include "backend/scene/backendscenedata.h"
+#include "backend/scene/incrementalrender.h"
 #include "backend/scene/view.h"
 #include "backend/scene/viewthreaddata.h"
 
@@ -75,6 +80,10 @@ using std::min;
 using std::max;
 using std::vector;
 
+/// Maximum number of bounding boxes to test each block against for being empty;
+/// beyond this, the bounding boxes of consecutive objects are merged.
+static const size_t kMaxEmptyBlockBounds = 256;
+
 #ifdef PROFILE_INTERSECTIONS
     bool gDoneBSP;
     bool gDoneBVH;
@@ -232,9 +241,111 @@ void TraceTask::SubdivisionBuffer::Clear()
     sampled.assign(sampled.size(), false);
 }
 
+EdgeSampleStore::EdgeSampleStore(unsigned int w, unsigned int h) :
+    width(w),
+    height(h),
+    rows(new std::atomic<Sample*>[h + 1]),
+    columns(new std::atomic<Sample*>[w + 1])
+{
+    for (unsigned int y = 0; y <= height; y++)
+        rows[y].store(nullptr, std::memory_order_relaxed);
+    for (unsigned int x = 0; x <= width; x++)
+        columns[x].store(nullptr, std::memory_order_relaxed);
+}
+
+EdgeSampleStore::~EdgeSampleStore()
+{
+    for (unsigned int y = 0; y <= height; y++)
+        delete[] rows[y].load(std::memory_order_relaxed);
+    for (unsigned int x = 0; x <= width; x++)
+        delete[] columns[x].load(std::memory_order_relaxed);
+}
+
+bool EdgeSampleStore::Get(int x, int y, RGBTColour& colour) const
+{
+    if ((x < 0) || (y < 0) || (x > int(width)) || (y > int(height)))
+        return false;
+
+    // a corner may have been stored along either of the edges meeting there
+    return Get(rows[y], x, colour) || Get(columns[x], y, colour);
+}
+
+void EdgeSampleStore::Put(int x, int y, bool horizontal, const RGBTColour& colour)
+{
+    if ((x < 0) || (y < 0) || (x > int(width)) || (y > int(height)))
+        return;
+
+    if (horizontal)
+        Put(rows[y], width + 1, x, colour);
+    else
+        Put(columns[x], height + 1, y, colour);
+}
+
+bool EdgeSampleStore::Get(const std::atomic<Sample*>& line, unsigned int i, RGBTColour& colour)
+{
+    const Sample* samples = line.load(std::memory_order_acquire);
+    if ((samples == nullptr) || (samples[i].state.load(std::memory_order_acquire) != 2))
+        return false;
+
+    colour = samples[i].colour;
+    return true;
+}
+
+void EdgeSampleStore::Put(std::atomic<Sample*>& line, unsigned int size, unsigned int i, const RGBTColour& colour)
+{
+    Sample* samples = line.load(std::memory_order_acquire);
+    if (samples == nullptr)
+    {
+        Sample* newSamples = new Sample[size]();
+        if (line.compare_exchange_strong(samples, newSamples, std::memory_order_acq_rel, std::memory_order_acquire))
+            samples = newSamples;
+        else
+            delete[] newSamples;
+    }
+
+    unsigned char missing = 0;
+    if (samples[i].state.compare_exchange_strong(missing, 1, std::memory_order_acquire, std::memory_order_relaxed))
+    {
+        samples[i].colour = colour;
+        samples[i].state.store(2, std::memory_order_release);
+    }
+}
+
+PreviewSampleStore::PreviewSampleStore(const POVRect& a) :
+    area(a),
+    samples(a.GetArea())
+{
+    for (Sample& sample : samples)
+        sample.valid = false;
+}
+
+bool PreviewSampleStore::Get(int x, int y, RGBTColour& colour) const
+{
+    if ((x < int(area.left)) || (y < int(area.top)) || (x > int(area.right)) || (y > int(area.bottom)))
+        return false;
+
+    const Sample& sample = samples[(x - area.left) + (y - area.top) * area.GetWidth()];
+    if (!sample.valid)
+        return false;
+
+    colour = sample.colour;
+    return true;
+}
+
+void PreviewSampleStore::Put(int x, int y, const RGBTColour& colour)
+{
+    if ((x < int(area.left)) || (y < int(area.top)) || (x > int(area.right)) || (y > int(area.bottom)))
+        return;
+
+    Sample& sample = samples[(x - area.left) + (y - area.top) * area.GetWidth()];
+    sample.colour = colour;
+    sample.valid = true;
+}
+
 TraceTask::TraceTask(ViewData *vd, unsigned int tm, DBL js,
                      DBL aat, DBL aac, unsigned int aad, pov_base::GammaCurvePtr& aag,
-                     unsigned int ps, bool psc, bool contributesToImage, bool hr, size_t seed) :
+                     unsigned int ps, bool psc, bool contributesToImage, bool hr, size_t seed,
+                     unsigned int w, unsigned int wc, bool prog) :
     RenderTask(vd, seed, "Trace"),
     trace(vd->GetSceneData(), &vd->GetCamera(), GetViewDataPtr(), vd->GetSceneData()->parsedMaxTraceLevel, vd->GetSceneData()->parsedAdcBailout,
           vd->GetQualityFeatureFlags(), cooperate, media, radiosity),
@@ -250,6 +361,15 @@ TraceTask::TraceTask(ViewData *vd, unsigned int tm, DBL js,
     passContributesToImage(contributesToImage),
     passCompletesImage((ps == 0) || ((ps == 1) && contributesToImage)),
     highReproducibility(hr),
+    worker(w),
+    workerCount(wc),
+    // Mosaic preview relies on blocks being aligned to the preview grid, high reproducibility
+    // on the pixels of a block being rendered in one go, and progressive rendering on the blocks
+    // being the same in each pass (as continue-trace restores the accumulated samples block by block).
+    // Anti-aliasing treats the row above and the column left of a block as already supersampled,
+    // which does not hold along the edges of split pieces.
+    blockSplitting((ps == 0) && !hr && !prog && (tm == 0)),
+    progressive(prog),
     media(GetViewDataPtr(), &trace, &photonGatherer),
     radiosity(vd->GetSceneData(), GetViewDataPtr(),
               vd->GetSceneData()->radiositySettings, vd->GetRadiosityCache(), cooperate, true, vd->GetCamera().Location),
@@ -278,6 +398,22 @@ TraceTask::TraceTask(ViewData *vd, unsigned int tm, DBL js,
 #endif
     // TODO: this could be initialised someplace more suitable
     GetViewDataPtr()->qualityFlags = vd->GetQualityFeatureFlags();
+
+    trace.SetProjectionTable(vd->GetProjectionTable());
+    trace.SetAdaptiveFocalBlur(vd->GetAdaptiveFocalBlur());
+    trace.SetRussianRoulette(vd->GetRussianRoulette());
+    trace.SetSecondaryRayBudget(vd->GetSecondaryRayBudget());
+
+    if ((tracingMethod == 1) || (tracingMethod == 2))
+        edgeSamples = vd->GetEdgeSamples();
+    // only preview passes and methods tracing pixel centres can share samples with each other
+    if (!progressive && ((previewSize > 0) || (tracingMethod <= 1)))
+        previewSamples = vd->GetPreviewSamples();
+
+    if (vd->GetIncrementalRender() != nullptr)
+        GetViewDataPtr()->footprint.reset(vd->GetIncrementalRender()->CreateFootprint());
+
+    SetupEmptyBlockTest();
 }
 
 TraceTask::~TraceTask()
@@ -291,7 +427,9 @@ void TraceTask::Run()
     do
     {
 #endif
-        switch(tracingMethod)
+        if (progressive)
+            ProgressiveSamplingM3();
+        else switch(tracingMethod)
         {
             case 0:
                 if(previewSize > 0)
@@ -334,6 +472,7 @@ void TraceTask::Finish()
     GetViewDataPtr()->timeType = TraceThreadData::kRenderTime;
     GetViewDataPtr()->realTime = ConsumedRealTime();
     GetViewDataPtr()->cpuTime = ConsumedCPUTime();
+    GetViewDataPtr()->eventCounts = ConsumedEvents();
 
 #ifdef PROFILE_INTERSECTIONS
     if (gDoneBSP && gDoneBVH)
@@ -405,54 +544,150 @@ void TraceTask::SimpleSamplingM0()
     POVRect rect;
     vector<RGBTColour> pixels;
     unsigned int serial;
+#ifdef PROFILE_INTERSECTIONS
+    unsigned int packetSize = 0;
+    bool wavefront = false;
+#else
+    unsigned int packetSize = trace.GetPacketSize();
+    bool wavefront = GetViewData()->GetWavefrontShading() && trace.CanTraceWavefront();
+#endif
 
-    while(GetViewData()->GetNextRectangle(rect, serial) == true)
+    while(GetViewData()->GetNextRectangle(rect, serial, worker, workerCount, blockSplitting) == true)
     {
         radiosity.BeforeTile(highReproducibility? serial : 0);
+        if (highReproducibility)
+            trace.SeedStreams(serial);
 
         pixels.clear();
         pixels.reserve(rect.GetArea());
+        BeginPixelCosts(rect);
 
-        for(DBL y = DBL(rect.top); y <= DBL(rect.bottom); y++)
+        if(wavefront)
+            SimpleSamplingM0Wavefront(rect, pixels);
+        else if(packetSize > 0)
+            SimpleSamplingM0Packets(rect, packetSize, pixels);
+        else
         {
-            for(DBL x = DBL(rect.left); x <= DBL(rect.right); x++)
+            for(DBL y = DBL(rect.top); y <= DBL(rect.bottom); y++)
             {
-#ifdef PROFILE_INTERSECTIONS
-                POV_LONG it = std::numeric_limits<POV_ULONG>::max();
-                for (int i = 0 ; i < 3 ; i++)
+                for(DBL x = DBL(rect.left); x <= DBL(rect.right); x++)
                 {
-                    TransColour c;
-                    gIntersectionTime = 0;
-                    trace(x+0.5, y+0.5, GetViewData()->GetWidth(), GetViewData()->GetHeight(), c);
-                    if (gIntersectionTime < it)
-                        it = gIntersectionTime;
-                }
-                (*gIntersectionTimes)[(int) y] [(int) x] = it;
-                if (it < gMinVal)
-                    gMinVal = it;
-                if (it > gMaxVal)
-                    gMaxVal = it;
+#ifdef PROFILE_INTERSECTIONS
+                    POV_LONG it = std::numeric_limits<POV_ULONG>::max();
+                    for (int i = 0 ; i < 3 ; i++)
+                    {
+                        TransColour c;
+                        gIntersectionTime = 0;
+                        trace(x+0.5, y+0.5, GetViewData()->GetWidth(), GetViewData()->GetHeight(), c);
+                        if (gIntersectionTime < it)
+                            it = gIntersectionTime;
+                    }
+                    (*gIntersectionTimes)[(int) y] [(int) x] = it;
+                    if (it < gMinVal)
+                        gMinVal = it;
+                    if (it > gMaxVal)
+                        gMaxVal = it;
 #endif
-                RGBTColour col;
+                    RGBTColour col;
 
-                trace(x+0.5, y+0.5, GetViewData()->GetWidth(), GetViewData()->GetHeight(), col);
-                GetViewDataPtr()->Stats()[Number_Of_Pixels]++;
+                    TracePixelCentre(int(x), int(y), col);
+                    ChargePixel(int(x), int(y));
 
-                pixels.push_back(col);
+                    pixels.push_back(col);
 
-                Cooperate();
+                    Cooperate();
+                }
             }
         }
 
         radiosity.AfterTile();
 
         GetViewDataPtr()->AfterTile();
-        GetViewData()->CompletedRectangle(rect, serial, pixels, 1, passContributesToImage, passCompletesImage);
+        CompletedFootprint(rect);
+        GetViewData()->CompletedRectangle(rect, serial, pixels, 1, passContributesToImage, passCompletesImage, 1.0, nullptr,
+                                          ComputeFeatures(rect, passCompletesImage), GetPixelCosts(passCompletesImage));
 
         Cooperate();
     }
 }
 
+void TraceTask::SimpleSamplingM0Packets(const POVRect& rect, unsigned int packetSize, vector<RGBTColour>& pixels)
+{
+    // group pixels into (roughly) square tiles for best ray coherence
+    unsigned int packetWidth = (packetSize >= 8) ? 4 : 2;
+    unsigned int packetHeight = packetSize / packetWidth;
+    vector<Vector2d> positions(packetSize);
+    vector<RGBTColour> colours(packetSize);
+    vector<unsigned int> indices(packetSize);
+
+    pixels.resize(rect.GetArea());
+
+    for(unsigned int y0 = rect.top; y0 <= rect.bottom; y0 += packetHeight)
+    {
+        for(unsigned int x0 = rect.left; x0 <= rect.right; x0 += packetWidth)
+        {
+            unsigned int count = 0;
+
+            for(unsigned int y = y0; (y < y0 + packetHeight) && (y <= rect.bottom); y++)
+            {
+                for(unsigned int x = x0; (x < x0 + packetWidth) && (x <= rect.right); x++)
+                {
+                    positions[count] = Vector2d(DBL(x) + 0.5, DBL(y) + 0.5);
+                    indices[count] = (y - rect.top) * rect.GetWidth() + (x - rect.left);
+                    count++;
+                }
+            }
+
+            trace.TracePacket(positions.data(), count, GetViewData()->GetWidth(), GetViewData()->GetHeight(), colours.data());
+            GetViewDataPtr()->Stats()[Number_Of_Pixels] += count;
+            ChargePixels(x0, y0, min(x0 + packetWidth - 1, rect.right), min(y0 + packetHeight - 1, rect.bottom));
+
+            for(unsigned int i = 0; i < count; i++)
+                pixels[indices[i]] = colours[i];
+
+            Cooperate();
+        }
+    }
+}
+
+void TraceTask::SimpleSamplingM0Wavefront(const POVRect& rect, vector<RGBTColour>& pixels)
+{
+    // order the pixels in 4x4 tiles, so that each packet of primary rays is coherent
+    const unsigned int tileSize = 4;
+    vector<Vector2d> positions;
+    vector<unsigned int> indices;
+    vector<RGBTColour> colours(rect.GetArea());
+
+    positions.reserve(rect.GetArea());
+    indices.reserve(rect.GetArea());
+
+    for(unsigned int y0 = rect.top; y0 <= rect.bottom; y0 += tileSize)
+    {
+        for(unsigned int x0 = rect.left; x0 <= rect.right; x0 += tileSize)
+        {
+            for(unsigned int y = y0; (y < y0 + tileSize) && (y <= rect.bottom); y++)
+            {
+                for(unsigned int x = x0; (x < x0 + tileSize) && (x <= rect.right); x++)
+                {
+                    positions.push_back(Vector2d(DBL(x) + 0.5, DBL(y) + 0.5));
+                    indices.push_back((y - rect.top) * rect.GetWidth() + (x - rect.left));
+                }
+            }
+        }
+    }
+
+    trace.TraceWavefront(positions.data(), (unsigned int)positions.size(), GetViewData()->GetWidth(), GetViewData()->GetHeight(), colours.data());
+    GetViewDataPtr()->Stats()[Number_Of_Pixels] += positions.size();
+    // the stages are shared by the whole block, so its time can only be spread evenly
+    ChargePixels(rect.left, rect.top, rect.right, rect.bottom);
+
+    pixels.resize(rect.GetArea());
+    for(size_t i = 0; i < indices.size(); i++)
+        pixels[indices[i]] = colours[i];
+
+    Cooperate();
+}
+
 void TraceTask::SimpleSamplingM0P()
 {
     DBL stepsize(previewSize);
@@ -461,9 +696,11 @@ void TraceTask::SimpleSamplingM0P()
     vector<RGBTColour> pixelcolors;
     unsigned int serial;
 
-    while(GetViewData()->GetNextRectangle(rect, serial) == true)
+    while(GetViewData()->GetNextRectangle(rect, serial, worker, workerCount, blockSplitting) == true)
     {
         radiosity.BeforeTile(highReproducibility? serial : 0);
+        if (highReproducibility)
+            trace.SeedStreams(serial);
 
         unsigned int px = (rect.GetWidth() + previewSize - 1) / previewSize;
         unsigned int py = (rect.GetHeight() + previewSize - 1) / previewSize;
@@ -501,6 +738,9 @@ void TraceTask::SimpleSamplingM0P()
                 trace(x+0.5, y+0.5, GetViewData()->GetWidth(), GetViewData()->GetHeight(), col);
                 GetViewDataPtr()->Stats()[Number_Of_Pixels]++;
 
+                if (previewSamples != nullptr)
+                    previewSamples->Put(int(x), int(y), col);
+
                 pixelpositions.push_back(Vector2d(x, y));
                 pixelcolors.push_back(col);
 
@@ -511,6 +751,7 @@ void TraceTask::SimpleSamplingM0P()
         radiosity.AfterTile();
 
         GetViewDataPtr()->AfterTile();
+        CompletedFootprint(rect);
         if(pixelpositions.size() > 0)
             GetViewData()->CompletedRectangle(rect, serial, pixelpositions, pixelcolors, previewSize, passContributesToImage, passCompletesImage);
 
@@ -525,17 +766,23 @@ void TraceTask::NonAdaptiveSupersamplingM1()
 
     jitterScale = jitterScale / DBL(aaDepth);
 
-    while(GetViewData()->GetNextRectangle(rect, serial) == true)
+    while(GetViewData()->GetNextRectangle(rect, serial, worker, workerCount, blockSplitting) == true)
     {
         radiosity.BeforeTile(highReproducibility? serial : 0);
+        if (highReproducibility)
+            trace.SeedStreams(serial);
+
+        if (TraceEmptyBlock(rect, serial))
+            continue;
 
         SmartBlock pixels(rect.left, rect.top, rect.GetWidth(), rect.GetHeight());
+        BeginPixelCosts(rect);
 
         // sample line above current block
         for(int x = rect.left; x <= rect.right; x++)
         {
-            trace(x+0.5, rect.top-0.5, GetViewData()->GetWidth(), GetViewData()->GetHeight(), pixels(x, rect.top - 1));
-            GetViewDataPtr()->Stats()[Number_Of_Pixels]++;
+            TraceEdgeSample(x, rect.top - 1, true, x+0.5, rect.top-0.5, pixels(x, rect.top - 1));
+            ChargePixel(x, rect.top - 1);
 
             // Cannot supersample this pixel, so just claim it was already supersampled! [trf]
             // [CJC] see comment for leftmost pixels below; similar situation applies here
@@ -546,8 +793,8 @@ void TraceTask::NonAdaptiveSupersamplingM1()
 
         for(int y = rect.top; y <= rect.bottom; y++)
         {
-            trace(rect.left-0.5, y+0.5, GetViewData()->GetWidth(), GetViewData()->GetHeight(), pixels(rect.left - 1, y)); // sample pixel left of current line in block
-            GetViewDataPtr()->Stats()[Number_Of_Pixels]++;
+            TraceEdgeSample(rect.left - 1, y, false, rect.left-0.5, y+0.5, pixels(rect.left - 1, y)); // sample pixel left of current line in block
+            ChargePixel(rect.left - 1, y);
 
             // Cannot supersample this pixel, so just claim it was already supersampled! [trf]
 
@@ -569,9 +816,11 @@ void TraceTask::NonAdaptiveSupersamplingM1()
 
             for(int x = rect.left; x <= rect.right; x++)
             {
-                // trace current pixel
-                trace(x+0.5, y+0.5, GetViewData()->GetWidth(), GetViewData()->GetHeight(), pixels(x, y));
-                GetViewDataPtr()->Stats()[Number_Of_Pixels]++;
+                // trace current pixel; the bottom row and right column are also needed by the adjacent blocks
+                if((y == rect.bottom) || (x == rect.right))
+                    TraceEdgeSample(x, y, (y == rect.bottom), x+0.5, y+0.5, pixels(x, y));
+                else
+                    TracePixelCentre(x, y, pixels(x, y));
 
                 Cooperate();
 
@@ -589,13 +838,17 @@ void TraceTask::NonAdaptiveSupersamplingM1()
                     pixels.SetFlag(x, y - 1, true);
                 if(samplecurrent == true)
                     pixels.SetFlag(x, y, true);
+
+                ChargePixel(x, y);
             }
         }
 
         radiosity.AfterTile();
 
         GetViewDataPtr()->AfterTile();
-        GetViewData()->CompletedRectangle(rect, serial, pixels.GetPixels(), 1, passContributesToImage, passCompletesImage);
+        CompletedFootprint(rect);
+        GetViewData()->CompletedRectangle(rect, serial, pixels.GetPixels(), 1, passContributesToImage, passCompletesImage, 1.0, nullptr,
+                                          ComputeFeatures(rect, passCompletesImage), GetPixelCosts(passCompletesImage));
 
         Cooperate();
     }
@@ -610,19 +863,32 @@ void TraceTask::AdaptiveSupersamplingM2()
 
     jitterScale = jitterScale / DBL((1 << aaDepth) + 1);
 
-    while(GetViewData()->GetNextRectangle(rect, serial) == true)
+    while(GetViewData()->GetNextRectangle(rect, serial, worker, workerCount, blockSplitting) == true)
     {
         radiosity.BeforeTile(highReproducibility? serial : 0);
+        if (highReproducibility)
+            trace.SeedStreams(serial);
+
+        if (TraceEmptyBlock(rect, serial))
+            continue;
 
         SmartBlock pixels(rect.left, rect.top, rect.GetWidth(), rect.GetHeight());
+        BeginPixelCosts(rect);
 
         for(int y = rect.top; y <= rect.bottom + 1; y++)
         {
             for(int x = rect.left; x <= rect.right + 1; x++)
             {
-                // trace upper-left corners of all pixels
-                trace(x, y, GetViewData()->GetWidth(), GetViewData()->GetHeight(), pixels(x, y));
-                GetViewDataPtr()->Stats()[Number_Of_Pixels]++;
+                // trace upper-left corners of all pixels; those on the edges are shared with the adjacent blocks
+                bool horizontal = (y == rect.top) || (y == rect.bottom + 1);
+                if(horizontal || (x == rect.left) || (x == rect.right + 1))
+                    TraceEdgeSample(x, y, horizontal, x, y, pixels(x, y));
+                else
+                {
+                    trace(x, y, GetViewData()->GetWidth(), GetViewData()->GetHeight(), pixels(x, y));
+                    GetViewDataPtr()->Stats()[Number_Of_Pixels]++;
+                }
+                ChargePixel(x, y);
 
                 Cooperate();
             }
@@ -642,6 +908,7 @@ void TraceTask::AdaptiveSupersamplingM2()
                 buffer.SetSample(subsize, subsize, pixels(x + 1, y + 1));
 
                 SubdivideOnePixel(DBL(x), DBL(y), 0.5, 0, 0, subsize, buffer, pixels(x, y), aaDepth - 1);
+                ChargePixel(x, y);
 
                 Cooperate();
             }
@@ -650,7 +917,9 @@ void TraceTask::AdaptiveSupersamplingM2()
         radiosity.AfterTile();
 
         GetViewDataPtr()->AfterTile();
-        GetViewData()->CompletedRectangle(rect, serial, pixels.GetPixels(), 1, passContributesToImage, passCompletesImage);
+        CompletedFootprint(rect);
+        GetViewData()->CompletedRectangle(rect, serial, pixels.GetPixels(), 1, passContributesToImage, passCompletesImage, 1.0, nullptr,
+                                          ComputeFeatures(rect, passCompletesImage), GetPixelCosts(passCompletesImage));
 
         Cooperate();
     }
@@ -682,11 +951,14 @@ void TraceTask::StochasticSupersamplingM3()
     else
         confidenceFactor.push_back(0.0);
 
-    while(GetViewData()->GetNextRectangle(rect, serial) == true)
+    while(GetViewData()->GetNextRectangle(rect, serial, worker, workerCount, blockSplitting) == true)
     {
-        GetViewDataPtr()->stochasticRandomGenerator->Seed(GetViewDataPtr()->stochasticRandomSeedBase + serial);
-
         radiosity.BeforeTile(highReproducibility? serial : 0);
+        if (highReproducibility)
+            trace.SeedStreams(serial);
+
+        if (TraceEmptyBlock(rect, serial))
+            continue;
 
         pixels.clear();
         pixelsSum.clear();
@@ -696,6 +968,7 @@ void TraceTask::StochasticSupersamplingM3()
         pixelsSum.reserve(rect.GetArea());
         pixelsSumSqr.reserve(rect.GetArea());
         pixelsSamples.reserve(rect.GetArea());
+        BeginPixelCosts(rect);
 
         do
         {
@@ -770,8 +1043,11 @@ void TraceTask::StochasticSupersamplingM3()
                         RGBTColour colTemp;
                         PreciseRGBTColour col, colSqr;
 
-                        Vector2d jitter = Uniform2dOnSquare(GetViewDataPtr()->stochasticRandomGenerator) - 0.5;
+                        SampleSequence::Context& context = GetViewDataPtr()->sampleContext;
+                        context = SampleSequence::Context(x, y, samples);
+                        Vector2d jitter = GetViewDataPtr()->sampleSequence.Get2d(x, y, samples, SampleSequence::kPixelDimension) - 0.5;
                         trace(x+0.5 + jitter.x(), y+0.5 + jitter.y(), GetViewData()->GetWidth(), GetViewData()->GetHeight(), colTemp);
+                        context.valid = false;
 
                         col = PreciseRGBTColour(GammaCurve::Encode(aaGamma, colTemp));
                         colSqr = Sqr(col);
@@ -807,6 +1083,7 @@ void TraceTask::StochasticSupersamplingM3()
                         if (samples >= minSamples) // TODO
                             break;
                     }
+                    ChargePixel(x, y);
 
                     index ++;
                 }
@@ -829,12 +1106,370 @@ void TraceTask::StochasticSupersamplingM3()
         radiosity.AfterTile();
 
         GetViewDataPtr()->AfterTile();
-        GetViewData()->CompletedRectangle(rect, serial, pixels, 1, passContributesToImage, passCompletesImage);
+        CompletedFootprint(rect);
+        GetViewData()->CompletedRectangle(rect, serial, pixels, 1, passContributesToImage, passCompletesImage, 1.0, nullptr,
+                                          ComputeFeatures(rect, passCompletesImage), GetPixelCosts(passCompletesImage));
 
         Cooperate();
     }
 }
 
+void TraceTask::ProgressiveSamplingM3()
+{
+    POVRect rect;
+    vector<RGBTColour> pixels;
+    unsigned int serial;
+    unsigned int pass = GetViewData()->GetProgressivePass();
+
+    // The initial pass must cover the whole image; refinement passes stop fetching blocks once the time budget is used up.
+    while(((pass == 0) || !GetViewData()->ProgressiveBudgetExpired()) &&
+          (GetViewData()->GetNextRectangle(rect, serial, worker, workerCount, blockSplitting) == true))
+    {
+        // The initial pass samples each pixel once; the pixels to refine in later passes,
+        // and by how much, have been chosen for the whole image beforehand.
+        bool sampleBlock = (pass == 0);
+        for(unsigned int y = rect.top; (y <= rect.bottom) && !sampleBlock; y++)
+        {
+            for(unsigned int x = rect.left; (x <= rect.right) && !sampleBlock; x++)
+                sampleBlock = (GetViewData()->GetProgressivePixel(x, y).pending > 0);
+        }
+        if (!sampleBlock)
+        {
+            GetViewData()->CompletedRectangle(rect, serial);
+            continue;
+        }
+
+        radiosity.BeforeTile(highReproducibility? serial : 0);
+        if (highReproducibility)
+            trace.SeedStreams(serial);
+
+        pixels.clear();
+        pixels.reserve(rect.GetArea());
+        BeginPixelCosts(rect);
+
+        for(unsigned int y = rect.top; y <= rect.bottom; y++)
+        {
+            for(unsigned int x = rect.left; x <= rect.right; x++)
+            {
+                ViewData::ProgressivePixel& pixel = GetViewData()->GetProgressivePixel(x, y);
+
+                if (pass == 0)
+                {
+                    pixel.pending = 1;
+                    GetViewDataPtr()->Stats()[Number_Of_Pixels]++;
+                }
+
+                for(; pixel.pending > 0; pixel.pending--)
+                {
+                    RGBTColour colTemp;
+                    SampleSequence::Context& context = GetViewDataPtr()->sampleContext;
+                    context = SampleSequence::Context(x, y, pixel.samples);
+                    Vector2d jitter = GetViewDataPtr()->sampleSequence.Get2d(x, y, pixel.samples, SampleSequence::kPixelDimension) - 0.5;
+                    trace(x+0.5 + jitter.x(), y+0.5 + jitter.y(), GetViewData()->GetWidth(), GetViewData()->GetHeight(), colTemp);
+                    context.valid = false;
+
+                    PreciseRGBTColour col(GammaCurve::Encode(aaGamma, colTemp));
+                    pixel.sum           += colTemp;
+                    pixel.encodedSum    += col;
+                    pixel.encodedSumSqr += Sqr(col);
+                    pixel.samples       ++;
+
+                    Cooperate();
+                }
+                ChargePixel(x, y);
+
+                if (pixel.samples > 0)
+                    pixels.push_back(pixel.sum / pixel.samples);
+                else
+                    pixels.push_back(RGBTColour());
+            }
+        }
+
+        radiosity.AfterTile();
+
+        GetViewDataPtr()->AfterTile();
+        CompletedFootprint(rect);
+        // Only the initial pass identifies blocks as complete, as that is what continue-trace cares about.
+        // The cost map on the other hand accumulates the time spent in all passes.
+        GetViewData()->CompletedRectangle(rect, serial, pixels, 1, true, (pass == 0), 1.0, nullptr, ComputeFeatures(rect, (pass == 0)),
+                                          GetPixelCosts(true));
+
+        Cooperate();
+    }
+}
+
+vector<POVMSFloat>* TraceTask::ComputeFeatures(const POVRect& rect, bool relevant)
+{
+    if (!relevant || !GetViewData()->GetPixelFeatures())
+        return nullptr;
+
+    features.clear();
+    features.reserve(rect.GetArea() * ViewData::kPixelFeatureSize);
+
+    for(unsigned int y = rect.top; y <= rect.bottom; y++)
+    {
+        for(unsigned int x = rect.left; x <= rect.right; x++)
+        {
+            RGBColour albedo;
+            Vector3d normal;
+            DBL depth;
+
+            trace.TraceFeatures(x+0.5, y+0.5, GetViewData()->GetWidth(), GetViewData()->GetHeight(), albedo, normal, depth);
+
+            features.push_back(albedo.red());
+            features.push_back(albedo.green());
+            features.push_back(albedo.blue());
+            features.push_back(normal.x());
+            features.push_back(normal.y());
+            features.push_back(normal.z());
+            features.push_back(depth);
+        }
+
+        Cooperate();
+    }
+
+    return &features;
+}
+
+void TraceTask::BeginPixelCosts(const POVRect& rect)
+{
+    if (!GetViewData()->GetPixelCosts())
+        return;
+
+    costRect = rect;
+    pixelCosts.assign(rect.GetArea(), 0.0);
+    costLap = std::chrono::steady_clock::now();
+}
+
+void TraceTask::ChargePixels(int left, int top, int right, int bottom)
+{
+    if (pixelCosts.empty())
+        return;
+
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    POVMSFloat elapsed = std::chrono::duration<POVMSFloat>(now - costLap).count();
+    costLap = now;
+
+    left   = clip<int>(left,   costRect.left, costRect.right);
+    right  = clip<int>(right,  costRect.left, costRect.right);
+    top    = clip<int>(top,    costRect.top,  costRect.bottom);
+    bottom = clip<int>(bottom, costRect.top,  costRect.bottom);
+
+    POVMSFloat share = elapsed / POVMSFloat((right - left + 1) * (bottom - top + 1));
+    for(int y = top; y <= bottom; y++)
+    {
+        for(int x = left; x <= right; x++)
+            pixelCosts[(y - costRect.top) * costRect.GetWidth() + (x - costRect.left)] += share;
+    }
+}
+
+vector<POVMSFloat>* TraceTask::GetPixelCosts(bool relevant)
+{
+    if (!relevant || pixelCosts.empty())
+        return nullptr;
+
+    return &pixelCosts;
+}
+
+void TraceTask::CompletedFootprint(const POVRect& rect)
+{
+    if (GetViewDataPtr()->footprint != nullptr)
+        GetViewData()->GetIncrementalRender()->CompletedFootprint(rect, *GetViewDataPtr()->footprint);
+}
+
+void TraceTask::SetupEmptyBlockTest()
+{
+    const SceneData& scene = *GetViewData()->GetSceneData();
+
+    emptyBlockTest = false;
+    emptyBlockBounds.clear();
+
+    // only methods that anti-alias can save anything
+    if (progressive || (tracingMethod < 1) || (tracingMethod > 3) || GetViewData()->GetRealTimeRaytracing())
+        return;
+
+    if ((trace.camera.Type != PERSPECTIVE_CAMERA) || trace.useFocalBlur || (trace.camera.Tnormal != nullptr))
+        return;
+
+    if (!scene.atmosphere.empty() || (scene.fog != nullptr) || (scene.rainbow != nullptr))
+        return;
+
+    vector<MinMaxBoundingBox> bounds;
+
+    for (vector<ObjectPtr>::const_iterator i = scene.objects.begin(); i != scene.objects.end(); i++)
+    {
+        // light sources are invisible, unless they have a shape attached
+        if (((*i)->Type & LIGHT_SOURCE_OBJECT) && reinterpret_cast<const LightSource *>(*i)->children.empty())
+            continue;
+
+        if (Test_Flag((*i), INFINITE_FLAG))
+            return;
+
+        Vector3d lo, hi;
+        Make_min_max_from_BBox(lo, hi, (*i)->BBox);
+        for (int axis = X; axis <= Z; axis++)
+        {
+            // make up for the single precision of the boxes
+            lo[axis] -= 1.0e-4 * (1.0 + fabs(lo[axis]));
+            hi[axis] += 1.0e-4 * (1.0 + fabs(hi[axis]));
+        }
+        bounds.push_back(MinMaxBoundingBox{ BBoxVector3d(lo), BBoxVector3d(hi) });
+    }
+
+    // Objects declared one after the other tend to be close to each other, so merging the bounds
+    // of consecutive objects still leaves most of the empty space uncovered.
+    size_t group = (bounds.size() + kMaxEmptyBlockBounds - 1) / kMaxEmptyBlockBounds;
+    for (size_t first = 0; first < bounds.size(); first += group)
+    {
+        MinMaxBoundingBox box = bounds[first];
+        for (size_t i = first + 1; (i < first + group) && (i < bounds.size()); i++)
+        {
+            box.pmin = min(box.pmin, bounds[i].pmin);
+            box.pmax = max(box.pmax, bounds[i].pmax);
+        }
+        emptyBlockBounds.push_back(box);
+    }
+
+    emptyBlockTest = true;
+}
+
+bool TraceTask::BlockIsEmpty(const POVRect& rect)
+{
+    DBL width = GetViewData()->GetWidth();
+    DBL height = GetViewData()->GetHeight();
+
+    // The primary rays of a perspective camera are an affine function of the image coordinates (see
+    // TracePixelCameraData::CreateCameraRay()), so those of the block lie within the pyramid spanned
+    // by the rays through its corners. A margin of one pixel all around accounts for jitter and for
+    // the samples anti-aliasing takes on the pixel edges.
+    DBL x0 = (rect.left - 1.0) / width - 0.5;
+    DBL x1 = (rect.right + 2.0) / width - 0.5;
+    DBL y0 = 0.5 - (rect.top - 1.0) / height;
+    DBL y1 = 0.5 - (rect.bottom + 2.0) / height;
+
+    Vector3d corner[4] = {
+        trace.cameraDirection + x0 * trace.cameraRight + y0 * trace.cameraUp,
+        trace.cameraDirection + x1 * trace.cameraRight + y0 * trace.cameraUp,
+        trace.cameraDirection + x1 * trace.cameraRight + y1 * trace.cameraUp,
+        trace.cameraDirection + x0 * trace.cameraRight + y1 * trace.cameraUp
+    };
+    Vector3d centre = corner[0] + corner[1] + corner[2] + corner[3];
+    Vector3d normal[4];
+
+    // normals of the side planes of the pyramid, pointing inwards
+    for (int i = 0; i < 4; i++)
+    {
+        normal[i] = cross(corner[i], corner[(i + 1) % 4]);
+        if (dot(normal[i], centre) < 0.0)
+            normal[i].invert();
+        if (normal[i].lengthSqr() == 0.0)
+            return false;
+    }
+
+    for (vector<MinMaxBoundingBox>::const_iterator box = emptyBlockBounds.begin(); box != emptyBlockBounds.end(); box++)
+    {
+        bool outside = false;
+
+        // the box is outside the pyramid if its corner farthest inwards is outside any one side plane
+        for (int i = 0; (i < 4) && !outside; i++)
+        {
+            Vector3d p((normal[i][X] >= 0.0) ? box->pmax[X] : box->pmin[X],
+                       (normal[i][Y] >= 0.0) ? box->pmax[Y] : box->pmin[Y],
+                       (normal[i][Z] >= 0.0) ? box->pmax[Z] : box->pmin[Z]);
+            outside = (dot(normal[i], p - trace.cameraLocation) < 0.0);
+        }
+
+        if (!outside)
+            return false;
+    }
+
+    return true;
+}
+
+bool TraceTask::TraceEmptyBlock(const POVRect& rect, unsigned int serial)
+{
+    if (!emptyBlockTest || !BlockIsEmpty(rect))
+        return false;
+
+    vector<RGBTColour> pixels;
+    vector<RGBTColour> encoded;
+    unsigned int traced = 0;
+
+    pixels.reserve(rect.GetArea());
+    encoded.reserve(rect.GetArea());
+    BeginPixelCosts(rect);
+
+    for (int y = rect.top; y <= rect.bottom; y++)
+    {
+        for (int x = rect.left; x <= rect.right; x++)
+        {
+            RGBTColour col;
+
+            if ((previewSamples == nullptr) || !previewSamples->Get(x, y, col))
+            {
+                trace(x+0.5, y+0.5, GetViewData()->GetWidth(), GetViewData()->GetHeight(), col);
+                traced++;
+            }
+            ChargePixel(x, y);
+
+            // the background must be smooth enough for anti-aliasing not to kick in, by the same
+            // criterion as used by NonAdaptiveSupersamplingForOnePixel()
+            RGBTColour gc = GammaCurve::Encode(aaGamma, col);
+            if (((x > int(rect.left)) && (ColourDistanceRGBT(encoded.back(), gc) >= aaThreshold)) ||
+                ((y > int(rect.top)) && (ColourDistanceRGBT(encoded[encoded.size() - rect.GetWidth()], gc) >= aaThreshold)))
+            {
+                // start over, using the same random numbers as if we hadn't been here
+                if (highReproducibility)
+                    trace.SeedStreams(serial);
+                return false;
+            }
+
+            pixels.push_back(col);
+            encoded.push_back(gc);
+
+            Cooperate();
+        }
+    }
+
+    GetViewDataPtr()->Stats()[Number_Of_Pixels] += traced;
+
+    radiosity.AfterTile();
+
+    GetViewDataPtr()->AfterTile();
+    CompletedFootprint(rect);
+    GetViewData()->CompletedRectangle(rect, serial, pixels, 1, passContributesToImage, passCompletesImage, 1.0, nullptr,
+                                      ComputeFeatures(rect, passCompletesImage), GetPixelCosts(passCompletesImage));
+
+    Cooperate();
+
+    return true;
+}
+
+void TraceTask::TracePixelCentre(int x, int y, RGBTColour& col)
+{
+    if ((previewSamples != nullptr) && previewSamples->Get(x, y, col))
+        return;
+
+    trace(x+0.5, y+0.5, GetViewData()->GetWidth(), GetViewData()->GetHeight(), col);
+    GetViewDataPtr()->Stats()[Number_Of_Pixels]++;
+}
+
+void TraceTask::TraceEdgeSample(int x, int y, bool horizontal, DBL px, DBL py, RGBTColour& col)
+{
+    // preview samples are only available to methods sampling edges at pixel centres
+    if ((previewSamples != nullptr) && previewSamples->Get(x, y, col))
+        return;
+
+    if ((edgeSamples != nullptr) && edgeSamples->Get(x, y, col))
+        return;
+
+    trace(px, py, GetViewData()->GetWidth(), GetViewData()->GetHeight(), col);
+    GetViewDataPtr()->Stats()[Number_Of_Pixels]++;
+
+    if (edgeSamples != nullptr)
+        edgeSamples->Put(x, y, horizontal, col);
+}
+
 void TraceTask::NonAdaptiveSupersamplingForOnePixel(DBL x, DBL y, RGBTColour& leftcol, RGBTColour& topcol, RGBTColour& curcol, bool& sampleleft, bool& sampletop, bool& samplecurrent)
 {
     RGBTColour gcLeft = GammaCurve::Encode(aaGamma, leftcol);
@@ -43,12 +43,17 @@
 //  (none at the moment)
 
 // C++ standard header files
+#include <atomic>
+#include <chrono>
+#include <memory>
 #include <vector>
 
 // POV-Ray header files (base module)
 #include "base/image/colourspace_fwd.h"
+#include "base/types.h"
 
 // POV-Ray header files (core module)
+#include "core/bounding/boundingbox.h"
 #include "core/lighting/radiosity.h"
 #include "core/material/media.h"
 #include "core/render/tracepixel.h"
@@ -67,12 +72,88 @@ namespace pov
     extern std::vector<std::vector<POV_ULONG>> *gIntersectionTimes;
 #endif
 
+/// Samples traced on the edges of blocks, shared by the render threads of an anti-aliasing pass.
+///
+/// Adjacent blocks both need the samples on their common edge: the adaptive method traces the
+/// corners of all pixels of a block, including those on its bottom and right edges, and the
+/// non-adaptive method traces the row above and the column left of a block to compare its pixels
+/// with. Whichever block gets to such a sample first stores it here for the other one to use.
+///
+/// Samples are addressed by integer coordinates on the grid of pixel corners (adaptive method) or
+/// pixels (non-adaptive method), and kept per horizontal or vertical block edge, so that memory is
+/// only allocated for lines actually shared.
+///
+/// @note   This class is thread-safe. A sample being stored by another thread at the same time is
+///         reported as missing, and the caller simply traces it again.
+///
+class EdgeSampleStore final
+{
+    public:
+        EdgeSampleStore(unsigned int width, unsigned int height);
+        ~EdgeSampleStore();
+
+        EdgeSampleStore(const EdgeSampleStore&) = delete;
+        EdgeSampleStore& operator=(const EdgeSampleStore&) = delete;
+
+        /// Get a sample stored by another block, if any.
+        bool Get(int x, int y, RGBTColour& colour) const;
+
+        /// Store a sample on a horizontal or vertical block edge.
+        void Put(int x, int y, bool horizontal, const RGBTColour& colour);
+
+    private:
+        struct Sample final
+        {
+            std::atomic<unsigned char> state; ///< 0 = missing, 1 = being stored, 2 = stored
+            RGBTColour colour;
+        };
+
+        unsigned int width;
+        unsigned int height;
+        std::unique_ptr<std::atomic<Sample*>[]> rows;
+        std::unique_ptr<std::atomic<Sample*>[]> columns;
+
+        static bool Get(const std::atomic<Sample*>& line, unsigned int i, RGBTColour& colour);
+        static void Put(std::atomic<Sample*>& line, unsigned int size, unsigned int i, const RGBTColour& colour);
+};
+
+/// Pixel samples traced by mosaic preview passes, for the final pass to use again.
+///
+/// Preview passes trace the centres of every n-th pixel, which is exactly where the final pass
+/// traces its (first) sample for these pixels if it uses no or non-adaptive anti-aliasing.
+///
+/// @note   Each pixel is stored by only one render thread, and the final pass only starts after all
+///         preview passes are done, so no further synchronisation is needed.
+///
+class PreviewSampleStore final
+{
+    public:
+        PreviewSampleStore(const POVRect& area);
+
+        /// Get the sample traced at the centre of a pixel by a preview pass, if any.
+        bool Get(int x, int y, RGBTColour& colour) const;
+
+        /// Store the sample traced at the centre of a pixel by a preview pass.
+        void Put(int x, int y, const RGBTColour& colour);
+
+    private:
+        struct Sample final
+        {
+            RGBTColour colour;
+            bool valid;
+        };
+
+        POVRect area;
+        std::vector<Sample> samples;
+};
+
 class TraceTask final : public RenderTask
 {
     public:
         TraceTask(ViewData *vd, unsigned int tm, DBL js,
                   DBL aat, DBL aac, unsigned int aad, pov_base::GammaCurvePtr& aag,
-                  unsigned int ps, bool psc, bool contributesToImage, bool hr, size_t seed);
+                  unsigned int ps, bool psc, bool contributesToImage, bool hr, size_t seed,
+                  unsigned int w = 0, unsigned int wc = 1, bool prog = false);
         virtual ~TraceTask() override;
 
         virtual void Run() override;
@@ -115,11 +196,39 @@ class TraceTask final : public RenderTask
         bool passContributesToImage;    ///< Pass computes pixels for the final image.
         bool passCompletesImage;        ///< Pass is the last one computing pixels for the final image.
         bool highReproducibility;
+        unsigned int worker;            ///< Index of this render thread in the pass.
+        unsigned int workerCount;       ///< Number of render threads in the pass.
+        bool blockSplitting;            ///< Whether blocks may be split into smaller pieces.
+        bool progressive;               ///< Whether this is a pass of a progressive render.
         pov_base::GammaCurvePtr aaGamma;
 
         /// tracing core
         TracePixel trace;
 
+        /// samples on block edges shared with the other render threads, or `nullptr` if not enabled
+        std::shared_ptr<EdgeSampleStore> edgeSamples;
+
+        /// samples traced by mosaic preview passes for the final pass to use, or `nullptr` if not enabled
+        std::shared_ptr<PreviewSampleStore> previewSamples;
+
+        /// denoising features of the current block
+        std::vector<POVMSFloat> features;
+
+        /// time spent on each pixel of the current block, for the cost map
+        std::vector<POVMSFloat> pixelCosts;
+
+        /// current block, as far as the cost map is concerned
+        POVRect costRect;
+
+        /// time at which the pixels charged last were completed
+        std::chrono::steady_clock::time_point costLap;
+
+        /// whether blocks are tested for being empty; see @ref SetupEmptyBlockTest()
+        bool emptyBlockTest;
+
+        /// bounds of the finite objects (or groups thereof) to test blocks against
+        std::vector<MinMaxBoundingBox> emptyBlockBounds;
+
         CooperateFunction cooperate;
         MediaFunction media;
         RadiosityFunction radiosity;
@@ -127,9 +236,59 @@ class TraceTask final : public RenderTask
 
         void SimpleSamplingM0();
         void SimpleSamplingM0P();
+        void SimpleSamplingM0Packets(const POVRect& rect, unsigned int packetSize, std::vector<RGBTColour>& pixels);
+        void SimpleSamplingM0Wavefront(const POVRect& rect, std::vector<RGBTColour>& pixels);
         void NonAdaptiveSupersamplingM1();
         void AdaptiveSupersamplingM2();
         void StochasticSupersamplingM3();
+        void ProgressiveSamplingM3();
+
+        /// Compute the denoising features of a block, if requested and relevant.
+        /// @return     Features to pass to @ref ViewData::CompletedRectangle(), or `nullptr`.
+        std::vector<POVMSFloat>* ComputeFeatures(const POVRect& rect, bool relevant);
+
+        /// Start measuring the time spent on the pixels of a block, if requested.
+        void BeginPixelCosts(const POVRect& rect);
+
+        /// Charge the time elapsed since the previous call to a group of pixels, shared evenly.
+        /// Pixels outside the current block are charged to the nearest pixel inside it.
+        void ChargePixels(int left, int top, int right, int bottom);
+
+        /// Charge the time elapsed since the previous call to a single pixel.
+        void ChargePixel(int x, int y) { ChargePixels(x, y, x, y); }
+
+        /// Get the time spent on the pixels of a block, if requested and relevant.
+        /// @return     Costs to pass to @ref ViewData::CompletedRectangle(), or `nullptr`.
+        std::vector<POVMSFloat>* GetPixelCosts(bool relevant);
+
+        /// Pass the parts of the scene visited while rendering a block on to the record for incremental re-rendering, if enabled.
+        void CompletedFootprint(const POVRect& rect);
+
+        /// Decide whether blocks can be tested for being empty, and gather the bounds to test them against.
+        ///
+        /// This requires a perspective camera without focal blur or camera normal, so that the primary rays
+        /// of a block are confined to a pyramid, and a scene without infinite objects (other than light
+        /// sources), atmospheric media, fog or rainbow.
+        ///
+        void SetupEmptyBlockTest();
+
+        /// Test whether no finite object can possibly be seen in a block, judging by its bounds.
+        bool BlockIsEmpty(const POVRect& rect);
+
+        /// Render a block showing nothing but the background at one sample per pixel, if applicable.
+        ///
+        /// The block is only completed this way if it is empty, and if no two adjacent pixels differ enough to
+        /// call for anti-aliasing; otherwise nothing is changed, and the block must be rendered as usual.
+        ///
+        /// @return     `true` if the block has been completed.
+        ///
+        bool TraceEmptyBlock(const POVRect& rect, unsigned int serial);
+
+        /// Trace the centre of a pixel, or take the sample from a preview pass if that has already traced it.
+        void TracePixelCentre(int x, int y, RGBTColour& col);
+
+        /// Trace a sample on the edge of a block, or take it from the neighbouring block if that has already traced it.
+        void TraceEdgeSample(int x, int y, bool horizontal, DBL px, DBL py, RGBTColour& col);
 
         void NonAdaptiveSupersamplingForOnePixel(DBL x, DBL y, RGBTColour& leftcol, RGBTColour& topcol, RGBTColour& curcol, bool& sampleleft, bool& sampletop, bool& samplecurrent);
         void SupersampleOnePixel(DBL x, DBL y, RGBTColour& col);
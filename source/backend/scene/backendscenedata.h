@@ -45,6 +45,7 @@
 
 // C++ standard header files
 #include <map>
+#include <memory>
 
 // POV-Ray header files (base module)
 #include "base/stringtypes.h"
@@ -54,6 +55,8 @@
 
 // POV-Ray header files (backend module)
 #include "backend/control/renderbackend.h"
+#include "backend/scene/scenebundle.h"
+#include "backend/support/tasktimeline.h"
 
 namespace pov
 {
@@ -73,6 +76,12 @@ class BackendSceneData final : public SceneData
         POVMSAddress backendAddress;
         /// frontend address
         POVMSAddress frontendAddress;
+        /// timeline of the task activity, or `nullptr` if not recorded
+        std::shared_ptr<TaskTimeline> timeline;
+        /// scene bundle to take the bounding hierarchy, photon maps and radiosity samples from, or `nullptr` if none
+        std::shared_ptr<SceneBundle> sceneBundle;
+        /// scene bundle file to prepare instead of rendering the image (empty if not preparing a bundle)
+        UCS2String sceneBundlePrepareFile;
 
         /**
          *  Find a file for reading.
@@ -0,0 +1,546 @@
+//******************************************************************************
+///
+/// @file backend/scene/incrementalrender.cpp
+///
+/// Implementations related to incremental re-rendering of edited scenes.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+// Unit header file must be the first file included within POV-Ray *.cpp files (pulls in config)
+#include "backend/scene/incrementalrender.h"
+
+// C++ variants of C standard header files
+//  (none at the moment)
+
+// C++ standard header files
+#include <algorithm>
+#include <unordered_map>
+
+// POV-Ray header files (base module)
+#include "base/fileinputoutput.h"
+#include "base/filesystem.h"
+#include "base/path.h"
+
+// POV-Ray header files (core module)
+#include "core/scene/object.h"
+
+// POV-Ray header files (backend module)
+#include "backend/scene/backendscenedata.h"
+
+// this must be the last file included
+#include "base/povdebug.h"
+
+namespace pov
+{
+
+/// Incremental render file signature.
+const POV_UINT32 kIncrementalRenderMagic = 0x52495650; // "PVIR" in little-endian byte order
+/// Incremental render file format version; must be changed whenever the format of the stored data changes.
+const POV_UINT32 kIncrementalRenderVersion = 1;
+
+/// Incremental render file header.
+struct IncrementalRenderHeader final
+{
+    POV_UINT32 magic;
+    POV_UINT32 version;
+    POV_UINT32 left, top, right, bottom;
+    POV_UINT32 blockSize;
+    POV_UINT32 objects;
+    /// fingerprint of the scene other than the top-level objects
+    POV_UINT64 environment;
+    /// hash of the render options
+    POV_UINT64 options;
+    double gridMin[3];
+    double gridMax[3];
+    /// whether @ref environment covers everything the image depends on
+    POV_UINT32 environmentStable;
+    POV_UINT32 reserved;
+};
+
+/// Top-level object as stored in the incremental render file.
+struct IncrementalRenderObject final
+{
+    POV_UINT64 fingerprint;
+    POV_UINT32 flags;
+    POV_UINT32 reserved;
+};
+
+/// Fingerprint covers everything the object depends on.
+const POV_UINT32 kObjectStable = 0x01;
+/// Object may affect any part of the image.
+const POV_UINT32 kObjectGlobal = 0x02;
+
+/// Block as stored in the incremental render file.
+struct IncrementalRenderBlock final
+{
+    POV_UINT32 flags;
+    POV_UINT32 reserved;
+    POV_UINT64 bloom[8];
+    POV_UINT64 cells[RenderFootprint::kCellWords];
+};
+
+/// Block has been completed.
+const POV_UINT32 kBlockComplete = 0x01;
+/// Block has hit objects without a fingerprint.
+const POV_UINT32 kBlockUnknown  = 0x02;
+
+/// Get the record of a top-level object to compare between renders.
+static IncrementalRenderObject GetObjectRecord(const SceneData& sceneData, ConstObjectPtr object)
+{
+    IncrementalRenderObject record = { 0, 0, 0 };
+
+    auto i = sceneData.objectFingerprints.find(object);
+    if (i != sceneData.objectFingerprints.end())
+    {
+        record.fingerprint = i->second.fingerprint;
+        if (i->second.stable)
+            record.flags |= kObjectStable;
+        if (i->second.global)
+            record.flags |= kObjectGlobal;
+    }
+
+    // objects too large for the grid can't be tracked either
+    if (Test_Flag(object, INFINITE_FLAG) ||
+        (object->BBox.size[X] >= CRITICAL_LENGTH) || (object->BBox.size[Y] >= CRITICAL_LENGTH) || (object->BBox.size[Z] >= CRITICAL_LENGTH))
+        record.flags |= kObjectGlobal;
+
+    return record;
+}
+
+constexpr POV_UINT64 IncrementalRender::kHashSeed;
+constexpr unsigned int IncrementalRender::kBloomWords;
+
+IncrementalRender::IncrementalRender(std::shared_ptr<BackendSceneData> sd, const POVRect& area, unsigned int bs, POV_UINT64 options) :
+    sceneData(sd),
+    renderArea(area),
+    blockSize(bs),
+    blockWidth((area.GetWidth() + bs - 1) / bs),
+    blockHeight((area.GetHeight() + bs - 1) / bs),
+    optionsHash(options),
+    blocks(blockWidth * blockHeight),
+    reusable(blockWidth * blockHeight, false),
+    pixels(area.GetArea())
+{
+    // fit the grid to the finite objects, leaving some room for them to move around in later versions of the scene
+    bool empty = true;
+    Vector3d lo(-1.0), hi(1.0);
+
+    for (ConstObjectPtr object : sceneData->objects)
+    {
+        if (GetObjectRecord(*sceneData, object).flags & kObjectGlobal)
+            continue;
+
+        BBoxVector3d mins, maxs;
+        Make_min_max_from_BBox(mins, maxs, object->BBox);
+        if (empty)
+        {
+            lo = Vector3d(mins);
+            hi = Vector3d(maxs);
+            empty = false;
+        }
+        else
+        {
+            lo = min(lo, Vector3d(mins));
+            hi = max(hi, Vector3d(maxs));
+        }
+    }
+
+    Vector3d margin = (hi - lo) * 0.125 + Vector3d(EPSILON);
+    SetGrid(lo - margin, hi + margin);
+
+    for (Block& block : blocks)
+    {
+        block.rendered = false;
+        block.unknown = false;
+        std::fill(block.bloom, block.bloom + kBloomWords, 0);
+        std::fill(block.cells, block.cells + RenderFootprint::kCellWords, 0);
+    }
+}
+
+unsigned int IncrementalRender::Load()
+{
+    Path file(sceneData->incrementalRenderFile);
+
+    if (CheckIfFileExists(file) == false)
+        return 0;
+
+    std::unique_ptr<IStream> is(NewIStream(file, POV_File_Data_IRF));
+    IncrementalRenderHeader header;
+
+    if ((is == nullptr) || !is->read(&header, sizeof(header)))
+        return 0;
+
+    if ((header.magic != kIncrementalRenderMagic) || (header.version != kIncrementalRenderVersion) ||
+        (header.left != renderArea.left) || (header.top != renderArea.top) ||
+        (header.right != renderArea.right) || (header.bottom != renderArea.bottom) ||
+        (header.blockSize != blockSize) || (header.options != optionsHash))
+        return 0;
+
+    // anything that may affect the whole image must not have changed at all
+    if (!header.environmentStable || !sceneData->environmentFingerprintStable ||
+        (header.environment != sceneData->environmentFingerprint))
+        return 0;
+
+    std::vector<IncrementalRenderObject> oldObjects(header.objects);
+
+    if ((header.objects > 0) && !is->read(oldObjects.data(), sizeof(IncrementalRenderObject) * header.objects))
+        return 0;
+
+    // pair up the objects by fingerprint; whatever is left over has been removed, added or changed
+    struct Unmatched final { unsigned int count; bool global; };
+    std::unordered_map<POV_UINT64, Unmatched> unmatched;
+    std::vector<POV_UINT64> removed;
+    std::vector<ConstObjectPtr> added;
+
+    for (const IncrementalRenderObject& record : oldObjects)
+    {
+        if (record.flags & kObjectStable)
+        {
+            Unmatched& entry = unmatched.emplace(record.fingerprint, Unmatched{ 0, false }).first->second;
+            ++entry.count;
+            entry.global = entry.global || (record.flags & kObjectGlobal);
+        }
+        else if (record.flags & kObjectGlobal)
+            return 0;
+        else
+            removed.push_back(record.fingerprint);
+    }
+
+    for (ConstObjectPtr object : sceneData->objects)
+    {
+        IncrementalRenderObject record = GetObjectRecord(*sceneData, object);
+
+        if (record.flags & kObjectStable)
+        {
+            auto i = unmatched.find(record.fingerprint);
+            if ((i != unmatched.end()) && (i->second.count > 0))
+            {
+                --i->second.count;
+                continue;
+            }
+        }
+
+        if (record.flags & kObjectGlobal)
+            return 0;
+
+        added.push_back(object);
+    }
+
+    for (const auto& entry : unmatched)
+    {
+        if (entry.second.count == 0)
+            continue;
+        if (entry.second.global)
+            return 0;
+        removed.push_back(entry.first);
+    }
+
+    // objects added outside the old grid can't be tested against the blocks
+    Vector3d oldGridMin(header.gridMin[X], header.gridMin[Y], header.gridMin[Z]);
+    Vector3d oldGridMax(header.gridMax[X], header.gridMax[Y], header.gridMax[Z]);
+
+    for (ConstObjectPtr object : added)
+    {
+        BBoxVector3d mins, maxs;
+        Make_min_max_from_BBox(mins, maxs, object->BBox);
+        for (int i = 0; i < 3; ++i)
+        {
+            if ((mins[i] < oldGridMin[i]) || (maxs[i] > oldGridMax[i]))
+                return 0;
+        }
+    }
+
+    std::vector<IncrementalRenderBlock> oldBlocks(blocks.size());
+    std::vector<float> oldPixels(size_t(renderArea.GetArea()) * 4);
+
+    if (!is->read(oldBlocks.data(), sizeof(IncrementalRenderBlock) * oldBlocks.size()) ||
+        !is->read(oldPixels.data(), sizeof(float) * oldPixels.size()))
+        return 0;
+
+    is.reset();
+
+    // from here on, the blocks rendered must use the old grid, to be comparable with those taken over
+    SetGrid(oldGridMin, oldGridMax);
+
+    POV_UINT64 addedCells[RenderFootprint::kCellWords] = {};
+    for (ConstObjectPtr object : added)
+        MarkCells(object->BBox, addedCells);
+
+    bool changed = !removed.empty() || !added.empty();
+    unsigned int count = 0;
+
+    for (size_t i = 0; i < oldBlocks.size(); ++i)
+    {
+        const IncrementalRenderBlock& record = oldBlocks[i];
+
+        if (!(record.flags & kBlockComplete) || (changed && (record.flags & kBlockUnknown)))
+            continue;
+
+        bool affected = false;
+        for (POV_UINT64 fingerprint : removed)
+            affected = affected || TestBloom(record.bloom, fingerprint);
+        for (unsigned int word = 0; word < RenderFootprint::kCellWords; ++word)
+            affected = affected || ((record.cells[word] & addedCells[word]) != 0);
+        if (affected)
+            continue;
+
+        Block& block = blocks[i];
+        block.unknown = ((record.flags & kBlockUnknown) != 0);
+        std::copy(record.bloom, record.bloom + kBloomWords, block.bloom);
+        std::copy(record.cells, record.cells + RenderFootprint::kCellWords, block.cells);
+        reusable[i] = true;
+        ++count;
+    }
+
+    for (size_t i = 0; i < pixels.size(); ++i)
+        pixels[i] = RGBTColour(oldPixels[i * 4], oldPixels[i * 4 + 1], oldPixels[i * 4 + 2], oldPixels[i * 4 + 3]);
+
+    return count;
+}
+
+void IncrementalRender::Save()
+{
+    Path file(sceneData->incrementalRenderFile);
+    std::unique_ptr<OStream> os(NewOStream(file, POV_File_Data_IRF, false));
+
+    // failing to write the file is not an error, the whole image will simply be rendered again next time
+    if (os == nullptr)
+        return;
+
+    IncrementalRenderHeader header;
+    header.magic             = kIncrementalRenderMagic;
+    header.version           = kIncrementalRenderVersion;
+    header.left              = renderArea.left;
+    header.top               = renderArea.top;
+    header.right             = renderArea.right;
+    header.bottom            = renderArea.bottom;
+    header.blockSize         = blockSize;
+    header.objects           = POV_UINT32(sceneData->objects.size());
+    header.environment       = sceneData->environmentFingerprint;
+    header.options           = optionsHash;
+    header.environmentStable = (sceneData->environmentFingerprintStable ? 1 : 0);
+    header.reserved          = 0;
+    for (int i = 0; i < 3; ++i)
+    {
+        header.gridMin[i] = gridMin[i];
+        header.gridMax[i] = gridMax[i];
+    }
+
+    std::vector<IncrementalRenderObject> objectRecords;
+    objectRecords.reserve(sceneData->objects.size());
+    for (ConstObjectPtr object : sceneData->objects)
+        objectRecords.push_back(GetObjectRecord(*sceneData, object));
+
+    std::vector<IncrementalRenderBlock> blockRecords(blocks.size());
+    std::vector<float> pixelRecords;
+    pixelRecords.reserve(pixels.size() * 4);
+
+    {
+        std::lock_guard<std::mutex> lock(dataMutex);
+
+        for (size_t i = 0; i < blocks.size(); ++i)
+        {
+            IncrementalRenderBlock& record = blockRecords[i];
+            record.flags    = ((blocks[i].rendered || reusable[i]) ? kBlockComplete : 0) | (blocks[i].unknown ? kBlockUnknown : 0);
+            record.reserved = 0;
+            std::copy(blocks[i].bloom, blocks[i].bloom + kBloomWords, record.bloom);
+            std::copy(blocks[i].cells, blocks[i].cells + RenderFootprint::kCellWords, record.cells);
+        }
+
+        for (const RGBTColour& pixel : pixels)
+        {
+            pixelRecords.push_back(pixel.red());
+            pixelRecords.push_back(pixel.green());
+            pixelRecords.push_back(pixel.blue());
+            pixelRecords.push_back(pixel.transm());
+        }
+    }
+
+    bool ok = os->write(&header, sizeof(header)) &&
+              (objectRecords.empty() || os->write(objectRecords.data(), sizeof(IncrementalRenderObject) * objectRecords.size())) &&
+              os->write(blockRecords.data(), sizeof(IncrementalRenderBlock) * blockRecords.size()) &&
+              os->write(pixelRecords.data(), sizeof(float) * pixelRecords.size());
+
+    os.reset();
+
+    // don't leave a truncated file behind
+    if (!ok)
+        (void)pov_base::Filesystem::DeleteFile(sceneData->incrementalRenderFile);
+}
+
+bool IncrementalRender::IsReusable(const POVRect& rect) const
+{
+    return reusable[GetBlockCell(rect)];
+}
+
+void IncrementalRender::GetPixels(const POVRect& rect, std::vector<RGBTColour>& rectPixels) const
+{
+    rectPixels.clear();
+    rectPixels.reserve(rect.GetArea());
+
+    for (unsigned int y = rect.top; y <= rect.bottom; ++y)
+    {
+        for (unsigned int x = rect.left; x <= rect.right; ++x)
+            rectPixels.push_back(pixels[size_t(y - renderArea.top) * renderArea.GetWidth() + (x - renderArea.left)]);
+    }
+}
+
+RenderFootprint *IncrementalRender::CreateFootprint() const
+{
+    return new RenderFootprint(gridMin, gridMax);
+}
+
+void IncrementalRender::CompletedFootprint(const POVRect& rect, RenderFootprint& footprint)
+{
+    {
+        std::lock_guard<std::mutex> lock(dataMutex);
+
+        Block& block = blocks[GetBlockCell(rect)];
+
+        // the first piece or pass rendered replaces whatever was taken over from the previous render
+        if (!block.rendered)
+        {
+            block.rendered = true;
+            block.unknown = false;
+            std::fill(block.bloom, block.bloom + kBloomWords, 0);
+            std::fill(block.cells, block.cells + RenderFootprint::kCellWords, 0);
+        }
+
+        for (ConstObjectPtr object : footprint.objects)
+        {
+            auto i = sceneData->objectFingerprints.find(object);
+            if (i == sceneData->objectFingerprints.end())
+                block.unknown = true;
+            else
+                MarkBloom(block.bloom, i->second.fingerprint);
+        }
+
+        for (unsigned int word = 0; word < RenderFootprint::kCellWords; ++word)
+            block.cells[word] |= footprint.cells[word];
+    }
+
+    footprint.Clear();
+}
+
+void IncrementalRender::CompletedPixels(const POVRect& rect, const std::vector<RGBTColour>& rectPixels)
+{
+    std::lock_guard<std::mutex> lock(dataMutex);
+
+    std::vector<RGBTColour>::const_iterator i(rectPixels.begin());
+    for (unsigned int y = rect.top; y <= rect.bottom; ++y)
+    {
+        for (unsigned int x = rect.left; (x <= rect.right) && (i != rectPixels.end()); ++x, ++i)
+            pixels[size_t(y - renderArea.top) * renderArea.GetWidth() + (x - renderArea.left)] = *i;
+    }
+}
+
+void IncrementalRender::CompletedPixels(const std::vector<Vector2d>& positions, const std::vector<RGBTColour>& colors)
+{
+    std::lock_guard<std::mutex> lock(dataMutex);
+
+    for (size_t i = 0; i < positions.size(); ++i)
+    {
+        unsigned int x = (unsigned int)positions[i].x();
+        unsigned int y = (unsigned int)positions[i].y();
+        if ((x >= renderArea.left) && (x <= renderArea.right) && (y >= renderArea.top) && (y <= renderArea.bottom))
+            pixels[size_t(y - renderArea.top) * renderArea.GetWidth() + (x - renderArea.left)] = colors[i];
+    }
+}
+
+POV_UINT64 IncrementalRender::HashData(POV_UINT64 hash, const void *data, size_t size)
+{
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(data);
+
+    for (size_t i = 0; i < size; i++)
+        hash = (hash ^ p[i]) * 0x100000001B3ull;
+
+    return hash;
+}
+
+unsigned int IncrementalRender::GetBlockCell(const POVRect& rect) const
+{
+    return ((rect.top - renderArea.top) / blockSize) * blockWidth + ((rect.left - renderArea.left) / blockSize);
+}
+
+void IncrementalRender::SetGrid(const Vector3d& lo, const Vector3d& hi)
+{
+    gridMin = lo;
+    gridMax = hi;
+    grid.reset(CreateFootprint());
+}
+
+void IncrementalRender::MarkCells(const BoundingBox& bbox, POV_UINT64 *cells) const
+{
+    BBoxVector3d mins, maxs;
+    Make_min_max_from_BBox(mins, maxs, bbox);
+
+    // rays are recorded only up to the surfaces they hit, so allow for some slack
+    int lo[3], hi[3];
+    for (int i = 0; i < 3; ++i)
+    {
+        lo[i] = clip(int(floor((mins[i] - grid->gridOrigin[i]) / grid->cellSize[i])) - 1, 0, int(RenderFootprint::kGridSize) - 1);
+        hi[i] = clip(int(floor((maxs[i] - grid->gridOrigin[i]) / grid->cellSize[i])) + 1, 0, int(RenderFootprint::kGridSize) - 1);
+    }
+
+    for (int z = lo[Z]; z <= hi[Z]; ++z)
+    {
+        for (int y = lo[Y]; y <= hi[Y]; ++y)
+        {
+            for (int x = lo[X]; x <= hi[X]; ++x)
+            {
+                unsigned int cell = RenderFootprint::CellIndex(x, y, z);
+                cells[cell / 64] |= (POV_UINT64(1) << (cell % 64));
+            }
+        }
+    }
+}
+
+void IncrementalRender::MarkBloom(POV_UINT64 *bloom, POV_UINT64 fingerprint)
+{
+    for (int k = 0; k < 3; ++k)
+    {
+        unsigned int bit = (unsigned int)(fingerprint >> (k * 21)) % (kBloomWords * 64);
+        bloom[bit / 64] |= (POV_UINT64(1) << (bit % 64));
+    }
+}
+
+bool IncrementalRender::TestBloom(const POV_UINT64 *bloom, POV_UINT64 fingerprint)
+{
+    for (int k = 0; k < 3; ++k)
+    {
+        unsigned int bit = (unsigned int)(fingerprint >> (k * 21)) % (kBloomWords * 64);
+        if (!(bloom[bit / 64] & (POV_UINT64(1) << (bit % 64))))
+            return false;
+    }
+    return true;
+}
+
+}
+// end of namespace pov
@@ -0,0 +1,210 @@
+//******************************************************************************
+///
+/// @file backend/scene/incrementalrender.h
+///
+/// Declarations related to incremental re-rendering of edited scenes.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+#ifndef POVRAY_BACKEND_INCREMENTALRENDER_H
+#define POVRAY_BACKEND_INCREMENTALRENDER_H
+
+// Module config header file must be the first file included within POV-Ray unit header files
+#include "backend/configbackend.h"
+
+// C++ variants of C standard header files
+//  (none at the moment)
+
+// C++ standard header files
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// POV-Ray header files (base module)
+#include "base/colour.h"
+#include "base/types.h"
+
+// POV-Ray header files (core module)
+#include "core/core_fwd.h"
+#include "core/bounding/boundingbox.h"
+#include "core/math/vector.h"
+#include "core/scene/tracethreaddata.h"
+
+// POV-Ray header files (backend module)
+#include "backend/scene/backendscenedata_fwd.h"
+
+namespace pov
+{
+
+/**
+ *  Record of the previous render of a view, allowing blocks not affected by edits of the scene
+ *  to be taken over instead of being rendered again.
+ *
+ *  For each block, the record holds the final pixels, a Bloom filter of the fingerprints of the
+ *  top-level objects hit by any ray traced for the block, and the cells of a coarse grid over
+ *  the scene passed through by those rays. A block needs to be rendered again if any object it
+ *  hit has been changed or removed, or if an object has been added (or changed) whose bounding
+ *  box overlaps any of the cells. Changes to anything other than the finite top-level objects
+ *  (e.g. the camera, light sources, global settings or render options) cause all blocks to be
+ *  rendered again.
+ */
+class IncrementalRender final
+{
+    public:
+
+        /**
+         *  Create an empty record for the current render.
+         *  @param  sd              Scene data of the view.
+         *  @param  area            Area of the view to be rendered.
+         *  @param  bs              Width and height of a block.
+         *  @param  options         Hash of the render options the pixels depend on.
+         */
+        IncrementalRender(std::shared_ptr<BackendSceneData> sd, const POVRect& area, unsigned int bs, POV_UINT64 options);
+
+        /**
+         *  Read the record of the previous render from the file, and determine which of its
+         *  blocks can be taken over.
+         *  @return                 Number of blocks that can be taken over.
+         */
+        unsigned int Load();
+
+        /**
+         *  Write the record of the current render to the file.
+         *  @note   All blocks must have been completed, either by rendering or by taking them over.
+         */
+        void Save();
+
+        /**
+         *  Determine whether a block of the previous render can be taken over.
+         *  @param  rect            Rectangle covered by the block.
+         *  @return                 True if the block need not be rendered again.
+         */
+        bool IsReusable(const POVRect& rect) const;
+
+        /**
+         *  Get the pixels of a block of the previous render.
+         *  @param  rect            Rectangle covered by the block.
+         *  @param  pixels          Pixels of the rectangle, row by row.
+         */
+        void GetPixels(const POVRect& rect, std::vector<RGBTColour>& pixels) const;
+
+        /**
+         *  Create a footprint for a render thread to record the parts of the scene visited in.
+         *  @return                 New footprint, to be owned by the caller.
+         */
+        RenderFootprint *CreateFootprint() const;
+
+        /**
+         *  Merge the parts of the scene visited while rendering a block (or piece of a block)
+         *  into the record of the block.
+         *  @param  rect            Rectangle just rendered.
+         *  @param  footprint       Parts of the scene visited; cleared on return.
+         */
+        void CompletedFootprint(const POVRect& rect, RenderFootprint& footprint);
+
+        /**
+         *  Record final pixels of the current render.
+         *  @param  rect            Rectangle the pixels cover.
+         *  @param  pixels          Pixels of the rectangle, row by row.
+         */
+        void CompletedPixels(const POVRect& rect, const std::vector<RGBTColour>& pixels);
+
+        /**
+         *  Record final pixels of the current render.
+         *  @param  positions       Pixel positions.
+         *  @param  colors          Pixel colors for each pixel position.
+         */
+        void CompletedPixels(const std::vector<Vector2d>& positions, const std::vector<RGBTColour>& colors);
+
+        /// Compute 64-bit FNV-1a hash.
+        static POV_UINT64 HashData(POV_UINT64 hash, const void *data, size_t size);
+
+        /// Initial value for @ref HashData().
+        static constexpr POV_UINT64 kHashSeed = 0xCBF29CE484222325ull;
+
+    private:
+
+        /// Number of 64-bit words in the Bloom filter of object fingerprints per block.
+        static constexpr unsigned int kBloomWords = 8;
+
+        /// Record of one block.
+        struct Block final
+        {
+            bool rendered;                                  ///< Whether the block has been rendered in the current render.
+            bool unknown;                                   ///< Whether any object hit had no fingerprint.
+            POV_UINT64 bloom[kBloomWords];                  ///< Fingerprints of the objects hit.
+            POV_UINT64 cells[RenderFootprint::kCellWords];  ///< Grid cells passed through.
+        };
+
+        std::shared_ptr<BackendSceneData> sceneData;
+        POVRect renderArea;
+        unsigned int blockSize;
+        unsigned int blockWidth;
+        unsigned int blockHeight;
+        POV_UINT64 optionsHash;
+        /// Low corner of the grid over the scene.
+        Vector3d gridMin;
+        /// High corner of the grid over the scene.
+        Vector3d gridMax;
+        /// Empty footprint defining the grid cells.
+        std::unique_ptr<RenderFootprint> grid;
+        /// Record of each block, by position in the block grid.
+        std::vector<Block> blocks;
+        /// Whether each block can be taken over from the previous render, by position in the block grid.
+        std::vector<bool> reusable;
+        /// Final pixels of the render area.
+        std::vector<RGBTColour> pixels;
+        /// Mutex guarding @ref blocks and @ref pixels.
+        std::mutex dataMutex;
+
+        /// Compute the position of a block in the block grid.
+        unsigned int GetBlockCell(const POVRect& rect) const;
+
+        /// Set the grid over the scene.
+        void SetGrid(const Vector3d& lo, const Vector3d& hi);
+
+        /// Mark the grid cells overlapped by a bounding box, expanded by one cell in each direction.
+        void MarkCells(const BoundingBox& bbox, POV_UINT64 *cells) const;
+
+        /// Mark a fingerprint in a Bloom filter.
+        static void MarkBloom(POV_UINT64 *bloom, POV_UINT64 fingerprint);
+
+        /// Test whether a fingerprint may have been marked in a Bloom filter.
+        static bool TestBloom(const POV_UINT64 *bloom, POV_UINT64 fingerprint);
+
+        IncrementalRender() = delete;
+        IncrementalRender(const IncrementalRender&) = delete;
+        IncrementalRender& operator=(const IncrementalRender&) = delete;
+};
+
+}
+// end of namespace pov
+
+#endif // POVRAY_BACKEND_INCREMENTALRENDER_H
@@ -0,0 +1,231 @@
+//******************************************************************************
+///
+/// @file backend/scene/scenebundle.cpp
+///
+/// Implementations related to scene bundles shared by render farm nodes.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+// Unit header file must be the first file included within POV-Ray *.cpp files (pulls in config)
+#include "backend/scene/scenebundle.h"
+
+// C++ variants of C standard header files
+#include <cstring>
+
+// C++ standard header files
+#include <algorithm>
+
+// POV-Ray header files (base module)
+#include "base/fileinputoutput.h"
+#include "base/filesystem.h"
+
+// this must be the last file included
+#include "base/povdebug.h"
+
+namespace pov
+{
+
+using namespace pov_base;
+
+/// Scene bundle file signature.
+const char kSceneBundleMagic[8] = { 'P', 'O', 'V', 'B', 'N', 'D', 'L', 0x1A };
+/// Scene bundle file format version; must be changed whenever the format of the stored data changes.
+const POV_UINT32 kSceneBundleVersion = 1;
+/// Value to identify the byte order the file was written in.
+const POV_UINT32 kSceneBundleByteOrder = 0x01020304;
+/// Alignment of the sections within the file; must be at least that of the binary formats held in them.
+const POV_UINT64 kSceneBundleAlignment = 64;
+
+/// Scene bundle file header, followed by the section table.
+struct SceneBundleHeader final
+{
+    char magic[8];
+    POV_UINT32 version;
+    POV_UINT32 byteOrder;
+    POV_UINT32 width;
+    POV_UINT32 height;
+    POV_UINT32 sectionCount;
+    POV_UINT32 reserved;
+};
+
+static POV_UINT64 AlignSceneBundleOffset(POV_UINT64 offset)
+{
+    return (offset + kSceneBundleAlignment - 1) & ~(kSceneBundleAlignment - 1);
+}
+
+SceneBundle::SceneBundle() :
+    width(0),
+    height(0)
+{
+}
+
+SceneBundle::~SceneBundle()
+{
+}
+
+bool SceneBundle::Open(const UCS2String& name)
+{
+    std::shared_ptr<Filesystem::MappedFile> f(new Filesystem::MappedFile);
+    SceneBundleHeader header;
+
+    if (!f->Open(name) || (f->GetSize() < sizeof(header)))
+        return false;
+
+    const unsigned char *base = reinterpret_cast<const unsigned char *>(f->GetData());
+    size_t size = f->GetSize();
+
+    std::memcpy(&header, base, sizeof(header));
+    if ((std::memcmp(header.magic, kSceneBundleMagic, sizeof(header.magic)) != 0) ||
+        (header.version != kSceneBundleVersion) || (header.byteOrder != kSceneBundleByteOrder) ||
+        (POV_UINT64(header.sectionCount) * sizeof(Section) > size - sizeof(header)))
+        return false;
+
+    std::vector<Section> table(header.sectionCount);
+    if (!table.empty())
+        std::memcpy(table.data(), base + sizeof(header), table.size() * sizeof(Section));
+
+    // make sure a damaged file cannot cause out-of-bounds accesses
+    for (std::vector<Section>::const_iterator i(table.begin()); i != table.end(); ++i)
+    {
+        if ((i->offset % kSceneBundleAlignment != 0) || (i->offset > size) || (i->size > size - i->offset))
+            return false;
+    }
+
+    file = f;
+    fileName = name;
+    width = header.width;
+    height = header.height;
+    sections.swap(table);
+    return true;
+}
+
+bool SceneBundle::GetSection(SectionId id, const unsigned char*& data, POV_UINT64& offset, POV_UINT64& size) const
+{
+    for (std::vector<Section>::const_iterator i(sections.begin()); i != sections.end(); ++i)
+    {
+        if ((i->id == id) && (i->size > 0))
+        {
+            data = reinterpret_cast<const unsigned char *>(file->GetData()) + i->offset;
+            offset = i->offset;
+            size = i->size;
+            return true;
+        }
+    }
+    return false;
+}
+
+UCS2String SceneBundle::GetSectionFileName(const UCS2String& name, SectionId id)
+{
+    switch (id)
+    {
+        case kBoundingSection:  return name + u".bounding.tmp";
+        case kPhotonSection:    return name + u".photons.tmp";
+        case kRadiositySection: return name + u".radiosity.tmp";
+    }
+    return name + u".tmp";
+}
+
+bool SceneBundle::Write(const UCS2String& name, unsigned int w, unsigned int h, const std::vector<SectionFile>& sectionFiles)
+{
+    std::vector<Section> table;
+    std::vector<const SectionFile*> sources;
+    SceneBundleHeader header;
+    bool ok;
+
+    // sections are only known to exist once their files have been written
+    for (std::vector<SectionFile>::const_iterator i(sectionFiles.begin()); i != sectionFiles.end(); ++i)
+    {
+        IFileStream in(i->fileName);
+        if (!in)
+            continue;
+        in.seekg(0, IOBase::seek_end);
+        Section section = { i->id, 0, 0, POV_UINT64(in.tellg()) };
+        table.push_back(section);
+        sources.push_back(&*i);
+    }
+
+    POV_UINT64 offset = sizeof(header) + table.size() * sizeof(Section);
+    for (std::vector<Section>::iterator i(table.begin()); i != table.end(); ++i)
+    {
+        i->offset = AlignSceneBundleOffset(offset);
+        offset = i->offset + i->size;
+    }
+
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kSceneBundleMagic, sizeof(header.magic));
+    header.version      = kSceneBundleVersion;
+    header.byteOrder    = kSceneBundleByteOrder;
+    header.width        = w;
+    header.height       = h;
+    header.sectionCount = POV_UINT32(table.size());
+
+    {
+        OStream out(name);
+        if (!out)
+            return false;
+
+        ok = out.write(&header, sizeof(header));
+        ok = ok && (table.empty() || out.write(table.data(), table.size() * sizeof(Section)));
+
+        POV_UINT64 pos = sizeof(header) + table.size() * sizeof(Section);
+        std::vector<unsigned char> buffer(1024 * 1024);
+        for (size_t k = 0; ok && (k < table.size()); ++k)
+        {
+            static const unsigned char padding[kSceneBundleAlignment] = { 0 };
+            ok = (table[k].offset == pos) || out.write(padding, size_t(table[k].offset - pos));
+            pos = table[k].offset;
+
+            IFileStream in(sources[k]->fileName);
+            POV_UINT64 remaining = table[k].size;
+            while (ok && (remaining > 0))
+            {
+                size_t count = in.readUpTo(buffer.data(), size_t(std::min<POV_UINT64>(remaining, buffer.size())));
+                ok = (count > 0) && out.write(buffer.data(), count);
+                remaining -= count;
+            }
+            pos += table[k].size;
+        }
+        ok = ok && !!out.flush();
+    }
+
+    for (std::vector<SectionFile>::const_iterator i(sectionFiles.begin()); i != sectionFiles.end(); ++i)
+    {
+        if (i->temporary)
+            (void)Filesystem::DeleteFile(i->fileName);
+    }
+
+    // don't leave a truncated bundle behind
+    if (!ok)
+        (void)Filesystem::DeleteFile(name);
+    return ok;
+}
+
+}
+// end of namespace pov
@@ -0,0 +1,157 @@
+//******************************************************************************
+///
+/// @file backend/scene/scenebundle.h
+///
+/// Declarations related to scene bundles shared by render farm nodes.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+#ifndef POVRAY_BACKEND_SCENEBUNDLE_H
+#define POVRAY_BACKEND_SCENEBUNDLE_H
+
+// Module config header file must be the first file included within POV-Ray unit header files
+#include "backend/configbackend.h"
+
+// C++ variants of C standard header files
+//  (none at the moment)
+
+// C++ standard header files
+#include <memory>
+#include <vector>
+
+// POV-Ray header files (base module)
+#include "base/filesystem_fwd.h"
+#include "base/stringtypes.h"
+#include "base/types.h"
+
+namespace pov
+{
+
+/**
+ *  Scene bundle, holding the data a render farm node would otherwise compute on its own before
+ *  tracing its part of the image: the bounding hierarchy, the photon maps and the radiosity
+ *  samples of the pretrace.
+ *
+ *  A bundle is prepared by a render of the whole image that stops after the radiosity pretrace.
+ *  It consists of a table of sections, each holding one of the binary files of the bounding
+ *  cache, the photon maps and the radiosity cache, aligned so that the photon maps and radiosity
+ *  samples can be used in place from the memory-mapped bundle.
+ */
+class SceneBundle final
+{
+    public:
+
+        /// Section identifiers.
+        enum SectionId : POV_UINT32
+        {
+            kBoundingSection    = 1,    ///< Bounding cache file (see @ref BoundingTask).
+            kPhotonSection      = 2,    ///< Binary photon map file (see @ref PhotonSortingTask).
+            kRadiositySection   = 3,    ///< Binary radiosity cache file (see @ref RadiosityCache).
+        };
+
+        /// File a section is to be taken from when writing a bundle.
+        struct SectionFile final
+        {
+            SectionId id;
+            pov_base::UCS2String fileName;
+            bool temporary;             ///< Whether the file is to be deleted once it has been copied.
+        };
+
+        SceneBundle();
+        ~SceneBundle();
+
+        /**
+         *  Open and map a bundle for reading.
+         *  @param  fileName        Name of the bundle file.
+         *  @return                 False if the file cannot be read or is not a valid bundle.
+         */
+        bool Open(const pov_base::UCS2String& fileName);
+
+        /**
+         *  Find a section of the bundle.
+         *  @param  id              Section to find.
+         *  @param  data            Start of the section in memory.
+         *  @param  offset          Offset of the section within the file.
+         *  @param  size            Size of the section.
+         *  @return                 False if the bundle has no such section.
+         */
+        bool GetSection(SectionId id, const unsigned char*& data, POV_UINT64& offset, POV_UINT64& size) const;
+
+        /// Get the memory-mapped bundle file.
+        inline const std::shared_ptr<pov_base::Filesystem::MappedFile>& GetFile() const { return file; }
+
+        /// Get the name of the bundle file.
+        inline const pov_base::UCS2String& GetFileName() const { return fileName; }
+
+        /// Get the width of the image the bundle was prepared for.
+        inline unsigned int GetWidth() const { return width; }
+
+        /// Get the height of the image the bundle was prepared for.
+        inline unsigned int GetHeight() const { return height; }
+
+        /**
+         *  Get the name of a temporary file to write a section to before it is copied into the bundle.
+         *  @param  fileName        Name of the bundle file.
+         *  @param  id              Section to be written.
+         */
+        static pov_base::UCS2String GetSectionFileName(const pov_base::UCS2String& fileName, SectionId id);
+
+        /**
+         *  Write a bundle, copying the sections from the given files. Missing files are skipped;
+         *  temporary files are deleted.
+         *  @param  fileName        Name of the bundle file.
+         *  @param  width           Width of the image the bundle is prepared for.
+         *  @param  height          Height of the image the bundle is prepared for.
+         *  @param  sections        Files to take the sections from.
+         *  @return                 False if the bundle could not be written.
+         */
+        static bool Write(const pov_base::UCS2String& fileName, unsigned int width, unsigned int height, const std::vector<SectionFile>& sections);
+
+    private:
+
+        struct Section final
+        {
+            POV_UINT32 id;
+            POV_UINT32 reserved;
+            POV_UINT64 offset;
+            POV_UINT64 size;
+        };
+
+        std::shared_ptr<pov_base::Filesystem::MappedFile> file;
+        pov_base::UCS2String fileName;
+        unsigned int width;
+        unsigned int height;
+        std::vector<Section> sections;
+};
+
+}
+// end of namespace pov
+
+#endif // POVRAY_BACKEND_SCENEBUNDLE_H
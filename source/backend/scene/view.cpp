@@ -42,21 +42,32 @@
 // C++ standard header files
 #include <algorithm>
 #include <chrono>
+#include <limits>
+#include <mutex>
+#include <unordered_map>
 
 // Boost header files
 #include <boost/bind.hpp>
 #include <boost/math/common_factor.hpp>
 
 // POV-Ray header files (base module)
+#include "base/filesystem.h"
 #include "base/path.h"
+#include "base/pov_mem.h"
 #include "base/povassert.h"
+#include "base/stringutilities.h"
 #include "base/timer.h"
 #include "base/image/colourspace.h"
 
 // POV-Ray header files (core module)
+#include "core/bounding/bvhtree.h"
+#include "core/bounding/compactbboxtree.h"
 #include "core/lighting/photons.h"
 #include "core/lighting/radiosity.h"
+#include "core/material/noise.h"
+#include "core/math/chi2.h"
 #include "core/math/matrix.h"
+#include "core/render/tracepixel.h"
 #include "core/support/octree.h"
 
 // POV-Ray header files (POVMS module)
@@ -74,13 +85,22 @@
 #include "backend/render/radiositytask.h"
 #include "backend/render/tracetask.h"
 #include "backend/scene/backendscenedata.h"
+#include "backend/scene/incrementalrender.h"
+#include "backend/scene/scenebundle.h"
 #include "backend/scene/viewthreaddata.h"
 
+#ifdef POV_CPUINFO_H
+#include POV_CPUINFO_H
+#endif
+
 // this must be the last file included
 #include "base/povdebug.h"
 
 #define DEFAULT_BLOCK_SIZE 32
 
+/// Smallest width or height of a piece when splitting blocks.
+const unsigned int MIN_BLOCK_PIECE_SIZE = 8;
+
 namespace pov
 {
 
@@ -99,6 +119,10 @@ inline unsigned int MakePowerOfTwo(unsigned int i)
     return 1 << ii;
 }
 
+constexpr unsigned int ViewData::kSplitBlockFlag;
+constexpr unsigned int ViewData::kProgressiveStatisticsSize;
+constexpr unsigned int ViewData::kPixelFeatureSize;
+
 ViewData::ViewData(shared_ptr<BackendSceneData> sd) :
     nextBlock(0),
     completedFirstPass(false),
@@ -108,21 +132,159 @@ ViewData::ViewData(shared_ptr<BackendSceneData> sd) :
     blockWidth(10),
     blockHeight(8),
     blockSize(DEFAULT_BLOCK_SIZE),
-    realTimeRaytracing(false),
-    rtrData(nullptr),
+    blockQueuesReady(false),
+    blocksQueued(0),
+    antialiasing(false),
     renderArea(0, 0, 159, 119),
     radiosityCache(sd->radiositySettings),
     sceneData(sd),
+    realTimeRaytracing(false),
+    rtrData(nullptr),
+    functionProfiling(false),
+    objectProfile(0),
+    threadAffinity(false),
+    eventCounting(false),
+    pixelFeatures(false),
+    pixelCosts(false),
+    wavefrontShading(false),
+    adaptiveFocalBlur(false),
+    russianRoulette(0.0),
+    secondaryRayBudget(0),
+    progressivePass(0),
+    progressivePassOffset(0),
     qualityFlags(9)
 {
 }
 
+/// Block cost map most recently measured, for the next frame of an animation.
+static struct
+{
+    POVRect renderArea;
+    unsigned int blockSize = 0;
+    std::vector<double> costs;
+} gLastBlockCostMap;
+
+/// Mutex guarding @ref gLastBlockCostMap.
+static std::mutex gLastBlockCostMapMutex;
+
 ViewData::~ViewData()
 {
+    updateBlockCostMap();
+
     if (rtrData != nullptr)
         delete rtrData;
 }
 
+/// Append the blocks of a region to a generalized Hilbert curve.
+///
+/// The region is spanned by the major axis (ax,ay) and minor axis (bx,by), of which exactly one
+/// component each is non-zero. Regions of any size are covered, at the cost of an occasional
+/// diagonal step where a side has odd length.
+///
+static void AppendHilbertBlocks(int x, int y, int ax, int ay, int bx, int by, unsigned int blockWidth,
+                                std::vector<unsigned int>& order)
+{
+    // division rounding towards negative infinity
+    auto half = [](int v) { return (v >= 0) ? v / 2 : -((1 - v) / 2); };
+    auto sign = [](int v) { return (v > 0) - (v < 0); };
+
+    int w = std::abs(ax + ay);
+    int h = std::abs(bx + by);
+    int dax = sign(ax), day = sign(ay);
+    int dbx = sign(bx), dby = sign(by);
+
+    if (h == 1)
+    {
+        for (int i = 0; i < w; ++i, x += dax, y += day)
+            order.push_back(y * blockWidth + x);
+        return;
+    }
+    if (w == 1)
+    {
+        for (int i = 0; i < h; ++i, x += dbx, y += dby)
+            order.push_back(y * blockWidth + x);
+        return;
+    }
+
+    int ax2 = half(ax), ay2 = half(ay);
+    int bx2 = half(bx), by2 = half(by);
+
+    if (2 * w > 3 * h)
+    {
+        // long region; split in two along the major axis
+        if ((std::abs(ax2 + ay2) & 1) && (w > 2))
+        {
+            ax2 += dax;
+            ay2 += day;
+        }
+        AppendHilbertBlocks(x, y, ax2, ay2, bx, by, blockWidth, order);
+        AppendHilbertBlocks(x + ax2, y + ay2, ax - ax2, ay - ay2, bx, by, blockWidth, order);
+    }
+    else
+    {
+        // split in three: up along the minor axis, across, and back down
+        if ((std::abs(bx2 + by2) & 1) && (h > 2))
+        {
+            bx2 += dbx;
+            by2 += dby;
+        }
+        AppendHilbertBlocks(x, y, bx2, by2, ax2, ay2, blockWidth, order);
+        AppendHilbertBlocks(x + bx2, y + by2, ax, ay, bx - bx2, by - by2, blockWidth, order);
+        AppendHilbertBlocks(x + (ax - dax) + (bx2 - dbx), y + (ay - day) + (by2 - dby),
+                            -bx2, -by2, -(ax - ax2), -(ay - ay2), blockWidth, order);
+    }
+}
+
+void GetHilbertBlockOrder(unsigned int width, unsigned int height, std::vector<unsigned int>& order)
+{
+    order.clear();
+    order.reserve(width * height);
+    if (width >= height)
+        AppendHilbertBlocks(0, 0, width, 0, 0, height, width, order);
+    else
+        AppendHilbertBlocks(0, 0, 0, height, width, 0, width, order);
+}
+
+void GetMortonBlockOrder(unsigned int width, unsigned int height, std::vector<unsigned int>& order)
+{
+    // skip positions outside the grid
+    unsigned int side = 1;
+    while ((side < width) || (side < height))
+        side <<= 1;
+    order.clear();
+    order.reserve(width * height);
+    for (unsigned long d = 0; d < (unsigned long)side * side; ++d)
+    {
+        unsigned int x = 0;
+        unsigned int y = 0;
+        for (unsigned int bit = 0; (1u << bit) < side; ++bit)
+        {
+            x |= ((d >> (2 * bit))     & 1) << bit;
+            y |= ((d >> (2 * bit + 1)) & 1) << bit;
+        }
+        if ((x < width) && (y < height))
+            order.push_back(y * width + x);
+    }
+}
+
+void ViewData::buildBlockPatternOrder()
+{
+    switch (renderPattern)
+    {
+        case 8:
+            /* hilbert curve */
+            GetHilbertBlockOrder(blockWidth, blockHeight, blockPatternOrder);
+            break;
+        case 9:
+            /* morton (z-order) curve */
+            GetMortonBlockOrder(blockWidth, blockHeight, blockPatternOrder);
+            break;
+        default:
+            blockPatternOrder.clear();
+            break;
+    }
+}
+
 void ViewData::getBlockXY(const unsigned int nb, unsigned int &x, unsigned int &y)
 {
     unsigned long neo_nb = nb; /* must be larger, if possible */
@@ -140,6 +302,12 @@ void ViewData::getBlockXY(const unsigned int nb, unsigned int &x, unsigned int &
         neo_nb *= renderBlockStep;
         neo_nb %= sz;
     }
+    if (!blockPatternOrder.empty())
+    {
+        x = blockPatternOrder[neo_nb] % blockWidth;
+        y = blockPatternOrder[neo_nb] / blockWidth;
+        return;
+    }
     switch(renderPattern)
     {
          case 1:
@@ -308,44 +476,409 @@ void ViewData::getBlockXY(const unsigned int nb, unsigned int &x, unsigned int &
      }/* all values are covered */
 }
 
-bool ViewData::GetNextRectangle(POVRect& rect, unsigned int& serial)
+void ViewData::getBlockRect(unsigned int serial, POVRect& rect)
 {
-    std::lock_guard<std::mutex> lock(nextBlockMutex);
+    unsigned int blockX;
+    unsigned int blockY;
+    getBlockXY(serial,blockX,blockY);
+
+    rect.left = renderArea.left + (blockX * blockSize);
+    rect.right = min(renderArea.left + ((blockX + 1) * blockSize) - 1, renderArea.right);
+    rect.top = renderArea.top + (blockY * blockSize);
+    rect.bottom = min(renderArea.top + ((blockY + 1) * blockSize) - 1, renderArea.bottom);
+}
+
+unsigned int ViewData::getBlockCell(const POVRect& rect) const
+{
+    return ((rect.top - renderArea.top) / blockSize) * blockWidth + ((rect.left - renderArea.left) / blockSize);
+}
+
+void ViewData::updateBlockCostMap()
+{
+    // NB: This is called between passes, while no blocks are being dispatched.
+
+    size_t cells = size_t(blockWidth) * blockHeight;
+    std::vector<double> seconds(cells, 0.0);
+    std::vector<double> pixels(cells, 0.0);
+    bool measured = false;
+
+    for (auto& state : workerStates)
+    {
+        for (auto& cost : state.costs)
+        {
+            unsigned int cell = getBlockCell(cost.rect);
+            seconds[cell] += cost.seconds;
+            pixels[cell]  += cost.rect.GetArea();
+            measured = true;
+        }
+        state.costs.clear();
+        state.busy = false;
+    }
+
+    if (!measured)
+        return;
+
+    // Cells not covered by the latest pass keep their previous estimate.
+    if (blockCostMap.size() != cells)
+        blockCostMap.assign(cells, 0.0);
+    for (size_t i = 0; i < cells; i++)
+    {
+        if (pixels[i] > 0.0)
+            blockCostMap[i] = std::max(seconds[i] / pixels[i], std::numeric_limits<double>::min());
+    }
+
+    std::lock_guard<std::mutex> lock(gLastBlockCostMapMutex);
+    gLastBlockCostMap.renderArea = renderArea;
+    gLastBlockCostMap.blockSize  = blockSize;
+    gLastBlockCostMap.costs      = blockCostMap;
+}
+
+void ViewData::fillBlockQueues(unsigned int workerCount, bool splittable)
+{
+    // NB: This is called with nextBlockMutex held, before any blocks are dispatched.
 
-    while(true)
+    size_t cells = size_t(blockWidth) * blockHeight;
+
+    if (blockCostMap.empty())
+    {
+        // Try to make use of the costs measured in the previous frame of an animation.
+        std::lock_guard<std::mutex> lock(gLastBlockCostMapMutex);
+        if ((gLastBlockCostMap.blockSize == blockSize) && (gLastBlockCostMap.costs.size() == cells) &&
+            (gLastBlockCostMap.renderArea.left  == renderArea.left)  && (gLastBlockCostMap.renderArea.top    == renderArea.top) &&
+            (gLastBlockCostMap.renderArea.right == renderArea.right) && (gLastBlockCostMap.renderArea.bottom == renderArea.bottom))
+            blockCostMap = gLastBlockCostMap.costs;
+    }
+
+    // Use the median cost for blocks not measured yet, and as the yardstick for expensive blocks.
+    double typicalCost = 1.0;
+    if (!blockCostMap.empty())
+    {
+        std::vector<double> known;
+        known.reserve(cells);
+        for (double cost : blockCostMap)
+        {
+            if (cost > 0.0)
+                known.push_back(cost);
+        }
+        if (!known.empty())
+        {
+            std::nth_element(known.begin(), known.begin() + known.size() / 2, known.end());
+            typicalCost = known[known.size() / 2];
+        }
+    }
+
+    blockPieces.reset(new std::atomic<unsigned int>[cells]);
+    for (size_t i = 0; i < cells; i++)
+        blockPieces[i] = 0;
+
+    std::vector<QueuedBlock> blocks;
+    std::vector<double> blockCosts;
+    blocks.reserve(cells);
+    blockCosts.reserve(cells);
+    double totalCost = 0.0;
+
+    for (unsigned int i = nextBlock; i < blockWidth * blockHeight; i++)
+    {
+        if (blockSkipList.find(i) != blockSkipList.end())
+            continue;
+
+        QueuedBlock block;
+        block.serial = i;
+        getBlockRect(i, block.rect);
+
+        double cost = typicalCost;
+        if (!blockCostMap.empty() && (blockCostMap[getBlockCell(block.rect)] > 0.0))
+            cost = blockCostMap[getBlockCell(block.rect)];
+
+        // Split expensive blocks right away: into 2x2 pieces if they're 4 times as expensive as a
+        // typical block, or into 4x4 pieces if 16 times as expensive. Not while anti-aliasing though,
+        // which treats the pixels along the top and left edges of a block as already supersampled.
+        unsigned int split = 1;
+        if (splittable && !antialiasing)
+        {
+            if (cost >= 16.0 * typicalCost)
+                split = 4;
+            else if (cost >= 4.0 * typicalCost)
+                split = 2;
+        }
+        unsigned int splitX = max(1u, min(split, block.rect.GetWidth()  / MIN_BLOCK_PIECE_SIZE));
+        unsigned int splitY = max(1u, min(split, block.rect.GetHeight() / MIN_BLOCK_PIECE_SIZE));
+
+        if (splitX * splitY > 1)
+        {
+            blockPieces[i] = splitX * splitY;
+            const POVRect& r = block.rect;
+            for (unsigned int y = 0; y < splitY; y++)
+            {
+                for (unsigned int x = 0; x < splitX; x++)
+                {
+                    QueuedBlock piece;
+                    piece.serial = i | kSplitBlockFlag;
+                    piece.rect = POVRect(r.left + r.GetWidth()  * x / splitX,       r.top + r.GetHeight() * y / splitY,
+                                         r.left + r.GetWidth()  * (x + 1) / splitX - 1, r.top + r.GetHeight() * (y + 1) / splitY - 1);
+                    blocks.push_back(piece);
+                    blockCosts.push_back(cost * piece.rect.GetArea());
+                    totalCost += blockCosts.back();
+                }
+            }
+        }
+        else
+        {
+            blocks.push_back(block);
+            blockCosts.push_back(cost * block.rect.GetArea());
+            totalCost += blockCosts.back();
+        }
+    }
+    blockSkipList.clear();
+    nextBlock = blockWidth * blockHeight;
+
+    // Give each render thread a contiguous run of blocks of roughly equal total cost.
+    blockQueues.clear();
+    for (unsigned int w = 0; w < workerCount; w++)
+        blockQueues.emplace_back(new BlockQueue());
+    double cumulativeCost = 0.0;
+    for (size_t i = 0; i < blocks.size(); i++)
     {
-        if(nextBlock >= (blockWidth * blockHeight))
+        unsigned int w = min(workerCount - 1, (unsigned int)((cumulativeCost + 0.5 * blockCosts[i]) / totalCost * workerCount));
+        blockQueues[w]->blocks.push_back(blocks[i]);
+        cumulativeCost += blockCosts[i];
+    }
+    for (auto& queue : blockQueues)
+        queue->count = (unsigned int)queue->blocks.size();
+    blocksQueued = (unsigned int)blocks.size();
+
+    workerStates.clear();
+    workerStates.resize(workerCount);
+}
+
+bool ViewData::stealBlock(unsigned int worker, bool splittable, QueuedBlock& block)
+{
+    while (blocksQueued > 0)
+    {
+        // Pick the victim with the most blocks left, as it is the most likely to hold up the end of the pass.
+        unsigned int victim = worker;
+        unsigned int victimCount = 0;
+        for (unsigned int i = 1; i < blockQueues.size(); i++)
+        {
+            unsigned int candidate = (worker + i) % blockQueues.size();
+            unsigned int count = blockQueues[candidate]->count;
+            if (count > victimCount)
+            {
+                victim = candidate;
+                victimCount = count;
+            }
+        }
+        if (victimCount == 0)
             return false;
 
-        unsigned int tempNextBlock = nextBlock; // TODO FIXME - works around nasty gcc (found using 4.0.1) bug failing to honor casting away of volatile on pass by value on template argument lookup [trf]
+        BlockQueue& queue = *blockQueues[victim];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.blocks.empty())
+            continue; // someone else was faster; try again
+
+        // Take the block farthest from where the victim is working.
+        block = queue.blocks.back();
+        queue.blocks.pop_back();
+
+        // Once there's not enough work left to keep everyone busy, split the block, leaving the other
+        // pieces for whoever comes along next.
+        size_t left = queue.blocks.size();
+        POVRect& r = block.rect;
+        bool splitX = (r.GetWidth()  >= 2 * MIN_BLOCK_PIECE_SIZE);
+        bool splitY = (r.GetHeight() >= 2 * MIN_BLOCK_PIECE_SIZE);
+        if (splittable && (splitX || splitY) && (blocksQueued <= blockQueues.size()))
+        {
+            unsigned int midX = splitX ? r.left + r.GetWidth()  / 2 : r.right + 1;
+            unsigned int midY = splitY ? r.top  + r.GetHeight() / 2 : r.bottom + 1;
+            QueuedBlock piece;
+            piece.serial = block.serial | kSplitBlockFlag;
+            if (splitX && splitY)
+            {
+                piece.rect = POVRect(midX, midY, r.right, r.bottom);
+                queue.blocks.push_back(piece);
+            }
+            if (splitY)
+            {
+                piece.rect = POVRect(r.left, midY, midX - 1, r.bottom);
+                queue.blocks.push_back(piece);
+            }
+            if (splitX)
+            {
+                piece.rect = POVRect(midX, r.top, r.right, midY - 1);
+                queue.blocks.push_back(piece);
+            }
+            unsigned int added = (unsigned int)(queue.blocks.size() - left);
+            // the piece we keep replaces the stolen one, unless that was a whole block
+            blockPieces[block.serial & ~kSplitBlockFlag] += ((block.serial & kSplitBlockFlag) ? added : added + 1);
+            block.serial = piece.serial;
+            block.rect = POVRect(r.left, r.top, midX - 1, midY - 1);
+            blocksQueued += added;
+        }
+        queue.count = (unsigned int)queue.blocks.size();
+        --blocksQueued;
+        return true;
+    }
+
+    return false;
+}
+
+bool ViewData::completedPiece(unsigned int serial)
+{
+    if (!(serial & kSplitBlockFlag))
+        return true;
+    return (--blockPieces[serial & ~kSplitBlockFlag] == 0);
+}
 
-        if((blockSkipList.empty() == true) || (blockSkipList.find((unsigned int)tempNextBlock) == blockSkipList.end()))
-            break;
+bool ViewData::GetNextRectangle(POVRect& rect, unsigned int& serial, unsigned int worker, unsigned int workerCount, bool splittable)
+{
+    workerCount = max(workerCount, 1u);
 
-        blockSkipList.erase((unsigned int)tempNextBlock);
-        nextBlock++;
+    if (!blockQueuesReady.load(std::memory_order_acquire))
+    {
+        std::lock_guard<std::mutex> lock(nextBlockMutex);
+        if (!blockQueuesReady.load(std::memory_order_relaxed))
+        {
+            fillBlockQueues(workerCount, splittable);
+            blockQueuesReady.store(true, std::memory_order_release);
+        }
     }
 
-    unsigned int blockX;
-    unsigned int blockY;
-    getBlockXY(nextBlock,blockX,blockY);
+    // The caller is done with the previous block, so we know how long it took.
+    WorkerState* state = (worker < workerStates.size() ? &workerStates[worker] : nullptr);
+    if ((state != nullptr) && state->busy)
+    {
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - state->start;
+        state->costs.push_back(BlockCost{ state->rect, elapsed.count() });
+        state->busy = false;
+    }
 
-    rect.left = renderArea.left + (blockX * blockSize);
-    rect.right = min(renderArea.left + ((blockX + 1) * blockSize) - 1, renderArea.right);
-    rect.top = renderArea.top + (blockY * blockSize);
-    rect.bottom = min(renderArea.top + ((blockY + 1) * blockSize) - 1, renderArea.bottom);
+    QueuedBlock block;
+    bool found = false;
+
+    if (worker < blockQueues.size())
+    {
+        BlockQueue& queue = *blockQueues[worker];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.blocks.empty())
+        {
+            block = queue.blocks.front();
+            queue.blocks.pop_front();
+            queue.count = (unsigned int)queue.blocks.size();
+            --blocksQueued;
+            found = true;
+        }
+    }
+
+    if (!found && !stealBlock(worker, splittable, block))
+        return false;
+
+    rect = block.rect;
+    serial = block.serial;
 
     pixelsPending += rect.GetArea();
 
-    serial = nextBlock;
-    nextBlock++;
+    if (state != nullptr)
+    {
+        state->rect  = rect;
+        state->start = std::chrono::steady_clock::now();
+        state->busy  = true;
+    }
 
-    blockBusyList.insert(serial);
+    if (sceneData->timeline != nullptr)
+        TaskTimeline::BeginBlock();
 
     return true;
 }
 
-bool ViewData::GetNextRectangle(POVRect& rect, unsigned int& serial, BlockInfo*& blockInfo, unsigned int stride)
+// Map a position along a Hilbert curve to coordinates in a square of size n (a power of 2).
+static void HilbertCurveXY(unsigned int n, unsigned int d, unsigned int& x, unsigned int& y)
+{
+    x = 0;
+    y = 0;
+    for (unsigned int s = 1; s < n; s *= 2)
+    {
+        unsigned int rx = 1 & (d / 2);
+        unsigned int ry = 1 & (d ^ rx);
+        if (ry == 0)
+        {
+            if (rx == 1)
+            {
+                x = s - 1 - x;
+                y = s - 1 - y;
+            }
+            std::swap(x, y);
+        }
+        x += s * rx;
+        y += s * ry;
+        d /= 4;
+    }
+}
+
+bool ViewData::getNextLocalityBlock(unsigned int region, unsigned int regionCount, unsigned int& serial)
+{
+    size_t blocks = size_t(blockWidth) * blockHeight;
+
+    if (localityOrder.empty())
+    {
+        // walk the smallest enclosing power-of-2 square along a Hilbert curve, skipping the blocks outside the view
+        std::vector<unsigned int> serialAt(blocks);
+        for (unsigned int i = 0; i < blocks; i++)
+        {
+            unsigned int x, y;
+            getBlockXY(i, x, y);
+            serialAt[y * blockWidth + x] = i;
+        }
+        unsigned int n = 1;
+        while ((n < blockWidth) || (n < blockHeight))
+            n *= 2;
+        localityOrder.reserve(blocks);
+        for (size_t d = 0; d < size_t(n) * n; d++)
+        {
+            unsigned int x, y;
+            HilbertCurveXY(n, (unsigned int)d, x, y);
+            if ((x < blockWidth) && (y < blockHeight))
+                localityOrder.push_back(serialAt[y * blockWidth + x]);
+        }
+    }
+
+    if (localityNext.size() != regionCount)
+    {
+        localityNext.resize(regionCount);
+        for (unsigned int r = 0; r < regionCount; r++)
+            localityNext[r] = (unsigned int)(blocks * r / regionCount);
+    }
+
+    // check the caller's region first, then help out in the others
+    for (unsigned int i = 0; i < regionCount; i++)
+    {
+        unsigned int r = (region + i) % regionCount;
+        unsigned int first = (unsigned int)(blocks * r / regionCount);
+        unsigned int last  = (unsigned int)(blocks * (r + 1) / regionCount);
+        unsigned int pos   = localityNext[r];
+
+        for (unsigned int k = first; k < last; k++)
+        {
+            unsigned int candidate = localityOrder[pos];
+            if (++pos >= last)
+                pos = first;
+
+            if((localityDispatched[candidate] && !blockInfoList[candidate]) ||
+               ((blockSkipList.empty() == false) && (blockSkipList.find(candidate) != blockSkipList.end())) ||
+               ((blockBusyList.empty() == false) && (blockBusyList.find(candidate) != blockBusyList.end())))
+                continue;
+
+            localityNext[r] = pos;
+            localityDispatched[candidate] = true;
+            serial = candidate;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool ViewData::GetNextRectangle(POVRect& rect, unsigned int& serial, BlockInfo*& blockInfo, unsigned int stride,
+                                unsigned int region, unsigned int regionCount)
 {
     std::lock_guard<std::mutex> lock(nextBlockMutex);
 
@@ -419,6 +952,11 @@ bool ViewData::GetNextRectangle(POVRect& rect, unsigned int& serial, BlockInfo*&
             }
         }
     }
+    else if (regionCount != 0)
+    {
+        if (!getNextLocalityBlock(region, regionCount, serial))
+            return false;
+    }
     else
     {
         unsigned int oldNextBlock = nextBlock;
@@ -474,10 +1012,13 @@ bool ViewData::GetNextRectangle(POVRect& rect, unsigned int& serial, BlockInfo*&
 
     blockInfo = blockInfoList[serial];
 
+    if (sceneData->timeline != nullptr)
+        TaskTimeline::BeginBlock();
+
     return true;
 }
 
-void ViewData::CompletedRectangle(const POVRect& rect, unsigned int serial, const vector<RGBTColour>& pixels, unsigned int size, bool relevant, bool complete, float completion, BlockInfo* blockInfo)
+void ViewData::CompletedRectangle(const POVRect& rect, unsigned int serial, const vector<RGBTColour>& pixels, unsigned int size, bool relevant, bool complete, float completion, BlockInfo* blockInfo, vector<POVMSFloat>* features, vector<POVMSFloat>* costs)
 {
     if (realTimeRaytracing == true)
     {
@@ -502,28 +1043,86 @@ void ViewData::CompletedRectangle(const POVRect& rect, unsigned int serial, cons
         try
         {
             POVMS_Message pixelblockmsg(kPOVObjectClass_PixelData, kPOVMsgClass_ViewImage, kPOVMsgIdent_PixelBlockSet);
-            vector<POVMSFloat> pixelvector;
-
-            pixelvector.reserve(pixels.size() * 5);
 
-            for(vector<RGBTColour>::const_iterator i(pixels.begin()); i != pixels.end(); i++)
+            // final full-resolution pixels are only ever written once per render, so they can be
+            // stored in the shared framebuffer with just a notification sent to the frontend;
+            // preview and progressive passes overwrite pixels the frontend may not have read yet
+            if ((sharedFramebuffer != nullptr) && relevant && (size == 1) && progressivePixels.empty() && (pixels.size() == rect.GetArea()))
             {
-                pixelvector.push_back(i->red());
-                pixelvector.push_back(i->green());
-                pixelvector.push_back(i->blue());
-                pixelvector.push_back(0.0); // unused component
-                pixelvector.push_back(i->transm());
+                sharedFramebuffer->SetBlock(rect, pixels);
+                pixelblockmsg.SetInt(kPOVAttrib_SharedFramebufferId, sharedFramebuffer->GetId());
             }
+            else
+            {
+                vector<POVMSFloat> pixelvector;
+
+                pixelvector.reserve(pixels.size() * 5);
 
-            POVMS_Attribute pixelattr(pixelvector);
+                for(vector<RGBTColour>::const_iterator i(pixels.begin()); i != pixels.end(); i++)
+                {
+                    pixelvector.push_back(i->red());
+                    pixelvector.push_back(i->green());
+                    pixelvector.push_back(i->blue());
+                    pixelvector.push_back(0.0); // unused component
+                    pixelvector.push_back(i->transm());
+                }
 
-            pixelblockmsg.Set(kPOVAttrib_PixelBlock, pixelattr);
+                POVMS_Attribute pixelattr(pixelvector);
+
+                pixelblockmsg.Set(kPOVAttrib_PixelBlock, pixelattr);
+            }
             if (relevant)
                 pixelblockmsg.SetVoid(kPOVAttrib_PixelFinal);
-            if (complete)
+            if (completedPiece(serial) && complete)
                 // only completely rendered blocks get a block id
-                // (used by continue-trace to identify blocks that do not need to be rendered again)
-                pixelblockmsg.SetInt(kPOVAttrib_PixelId, serial);
+                // (used by continue-trace to identify blocks that do not need to be rendered again;
+                // for split blocks, that's the last piece to be completed)
+                pixelblockmsg.SetInt(kPOVAttrib_PixelId, serial & ~kSplitBlockFlag);
+            if (!progressivePixels.empty())
+            {
+                // samples accumulated so far, for a continued render to pick up from
+                vector<POVMSFloat> statsvector;
+
+                statsvector.reserve(rect.GetArea() * kProgressiveStatisticsSize);
+
+                for(unsigned int y = rect.top; y <= rect.bottom; y++)
+                {
+                    for(unsigned int x = rect.left; x <= rect.right; x++)
+                    {
+                        const ProgressivePixel& pixel = GetProgressivePixel(x, y);
+                        statsvector.push_back(pixel.sum.red());
+                        statsvector.push_back(pixel.sum.green());
+                        statsvector.push_back(pixel.sum.blue());
+                        statsvector.push_back(pixel.sum.transm());
+                        statsvector.push_back(pixel.encodedSum.red());
+                        statsvector.push_back(pixel.encodedSum.green());
+                        statsvector.push_back(pixel.encodedSum.blue());
+                        statsvector.push_back(pixel.encodedSum.transm());
+                        statsvector.push_back(pixel.encodedSumSqr.red());
+                        statsvector.push_back(pixel.encodedSumSqr.green());
+                        statsvector.push_back(pixel.encodedSumSqr.blue());
+                        statsvector.push_back(pixel.encodedSumSqr.transm());
+                        statsvector.push_back(pixel.samples);
+                    }
+                }
+
+                POVMS_Attribute statsattr(statsvector);
+
+                pixelblockmsg.Set(kPOVAttrib_SampleStatistics, statsattr);
+                pixelblockmsg.SetInt(kPOVAttrib_SamplePass, progressivePassOffset + progressivePass);
+            }
+            if (features != nullptr)
+            {
+                POVMS_Attribute featureattr(*features);
+
+                pixelblockmsg.Set(kPOVAttrib_PixelFeatures, featureattr);
+            }
+            if (costs != nullptr)
+            {
+                POVMS_Attribute costattr(*costs);
+
+                pixelblockmsg.Set(kPOVAttrib_PixelCosts, costattr);
+            }
             pixelblockmsg.SetInt(kPOVAttrib_PixelSize, size);
             pixelblockmsg.SetInt(kPOVAttrib_Left, rect.left);
             pixelblockmsg.SetInt(kPOVAttrib_Top, rect.top);
@@ -534,7 +1133,7 @@ void ViewData::CompletedRectangle(const POVRect& rect, unsigned int serial, cons
             pixelblockmsg.SetSourceAddress(sceneData->backendAddress);
             pixelblockmsg.SetDestinationAddress(sceneData->frontendAddress);
 
-            POVMS_SendMessage(pixelblockmsg);
+            POVMS_SendMessageBatched(nullptr, pixelblockmsg);
         }
         catch(pov_base::Exception&)
         {
@@ -543,6 +1142,10 @@ void ViewData::CompletedRectangle(const POVRect& rect, unsigned int serial, cons
         }
     }
 
+    // keep the final pixels for incremental re-rendering
+    if ((incrementalRender != nullptr) && relevant)
+        incrementalRender->CompletedPixels(rect, pixels);
+
     // update render progress information
     CompletedRectangle(rect, serial, completion, blockInfo);
 }
@@ -583,17 +1186,18 @@ void ViewData::CompletedRectangle(const POVRect& rect, unsigned int serial, cons
         pixelblockmsg.Set(kPOVAttrib_PixelColors, pixelcolattr);
         if (relevant)
             pixelblockmsg.SetVoid(kPOVAttrib_PixelFinal);
-        if (complete)
+        if (completedPiece(serial) && complete)
             // only completely rendered blocks get a block id
-            // (used by continue-trace to identify blocks that do not need to be rendered again)
-            pixelblockmsg.SetInt(kPOVAttrib_PixelId, serial);
+            // (used by continue-trace to identify blocks that do not need to be rendered again;
+            // for split blocks, that's the last piece to be completed)
+            pixelblockmsg.SetInt(kPOVAttrib_PixelId, serial & ~kSplitBlockFlag);
         pixelblockmsg.SetInt(kPOVAttrib_PixelSize, size);
 
         pixelblockmsg.SetInt(kPOVAttrib_ViewId, viewId);
         pixelblockmsg.SetSourceAddress(sceneData->backendAddress);
         pixelblockmsg.SetDestinationAddress(sceneData->frontendAddress);
 
-        POVMS_SendMessage(pixelblockmsg);
+        POVMS_SendMessageBatched(nullptr, pixelblockmsg);
     }
     catch(pov_base::Exception&)
     {
@@ -601,16 +1205,25 @@ void ViewData::CompletedRectangle(const POVRect& rect, unsigned int serial, cons
         throw;
     }
 
+    // keep the final pixels for incremental re-rendering
+    if ((incrementalRender != nullptr) && relevant)
+        incrementalRender->CompletedPixels(positions, colors);
+
     // update render progress information
     CompletedRectangle(rect, serial, completion, blockInfo);
 }
 
 void ViewData::CompletedRectangle(const POVRect& rect, unsigned int serial, float completion, BlockInfo* blockInfo)
 {
+    if (sceneData->timeline != nullptr)
+        sceneData->timeline->EndBlock(serial & ~kSplitBlockFlag);
+
+    // blocks dispatched by work-stealing are neither tracked as busy nor carry additional information
+    if (!blockQueuesReady.load(std::memory_order_acquire) || (blockInfo != nullptr))
     {
         std::lock_guard<std::mutex> lock(nextBlockMutex);
         blockBusyList.erase(serial);
-        blockInfoList[serial] = blockInfo;
+        blockInfoList[serial & ~kSplitBlockFlag] = blockInfo;
     }
 
     if (realTimeRaytracing == true)
@@ -628,7 +1241,8 @@ void ViewData::CompletedRectangle(const POVRect& rect, unsigned int serial, floa
             obj.SetInt(kPOVAttrib_Pixels, renderArea.GetArea());
             obj.SetInt(kPOVAttrib_PixelsPending, pixelsPending - pixelsCompleted + rect.GetArea());
             obj.SetInt(kPOVAttrib_PixelsCompleted, pixelsCompleted);
-            RenderBackend::SendViewOutput(viewId, sceneData->frontendAddress, kPOVMsgIdent_Progress, obj);
+            obj.SetLong(kPOVAttrib_CurrentMemoryUsage, static_cast<POVMSLong>(pov_base::pov_mem_accounted_total()));
+            RenderBackend::SendViewOutput(viewId, sceneData->frontendAddress, kPOVMsgIdent_Progress, obj, true);
         }
 
         catch(pov_base::Exception&)
@@ -644,11 +1258,125 @@ void ViewData::SetNextRectangle(const BlockIdSet& bsl, unsigned int fs)
     blockSkipList = bsl;
     blockBusyList.clear(); // safety catch; shouldn't be necessary
     blockPostponedList.clear(); // safety catch; shouldn't be necessary
+    updateBlockCostMap();
     nextBlock = fs;
+    blockQueuesReady = false;
     completedFirstPass = false; // TODO
+    localityOrder.clear();
+    localityNext.clear();
+    localityDispatched.assign(blockWidth * blockHeight, false);
+    for (unsigned int i = 0; (i < fs) && (i < localityDispatched.size()); i++)
+        localityDispatched[i] = true; // already rendered in a previous aborted render now being continued
     pixelsCompleted = 0; // TODO
 }
 
+void ViewData::loadProgressiveStatistics(POVMS_List& stats)
+{
+    for(int i = 1; i <= stats.GetListSize(); i++)
+    {
+        POVMS_Object block;
+
+        stats.GetNth(i, block);
+
+        POVRect rect(block.GetInt(kPOVAttrib_Left), block.GetInt(kPOVAttrib_Top), block.GetInt(kPOVAttrib_Right), block.GetInt(kPOVAttrib_Bottom));
+        vector<POVMSFloat> statsvector(block.GetFloatVector(kPOVAttrib_SampleStatistics));
+
+        // silently ignore anything not matching the current render, e.g. after a change of the render area
+        if ((rect.left < renderArea.left) || (rect.right > renderArea.right) || (rect.left > rect.right) ||
+            (rect.top < renderArea.top) || (rect.bottom > renderArea.bottom) || (rect.top > rect.bottom) ||
+            (statsvector.size() != rect.GetArea() * kProgressiveStatisticsSize))
+            continue;
+
+        vector<POVMSFloat>::const_iterator v(statsvector.begin());
+        for(unsigned int y = rect.top; y <= rect.bottom; y++)
+        {
+            for(unsigned int x = rect.left; x <= rect.right; x++, v += kProgressiveStatisticsSize)
+            {
+                ProgressivePixel& pixel = GetProgressivePixel(x, y);
+                pixel.sum           = RGBTColour(v[0], v[1], v[2], v[3]);
+                pixel.encodedSum    = PreciseRGBTColour(v[4], v[5], v[6], v[7]);
+                pixel.encodedSumSqr = PreciseRGBTColour(v[8], v[9], v[10], v[11]);
+                pixel.samples       = (unsigned int)v[12];
+                pixel.pending       = 0;
+            }
+        }
+
+        progressivePassOffset = max(progressivePassOffset, (unsigned int)block.TryGetInt(kPOVAttrib_SamplePass, 0) + 1);
+    }
+}
+
+unsigned int ViewData::planProgressivePass(DBL threshold, DBL confidence, unsigned int depth)
+{
+    unsigned int maxSamples = 1u << (depth*2);
+    unsigned int areaWidth = renderArea.GetWidth();
+    unsigned int areaHeight = renderArea.GetHeight();
+    vector<std::pair<double, unsigned int>> candidates;
+    unsigned int budget = 0;
+
+    // Create list of thresholds for confidence test.
+    vector<double> confidenceFactor;
+    confidenceFactor.reserve(maxSamples*5);
+    for(unsigned int n = 1; n <= maxSamples*5; n++)
+        confidenceFactor.push_back(ndtri((1+confidence)/2) / sqrt((double)n));
+
+    // Estimate the error of each pixel from the variance of its own samples and those of its neighbours,
+    // regardless of block boundaries, as in sampling method 3.
+    for(unsigned int y = 0; y < areaHeight; y++)
+    {
+        for(unsigned int x = 0; x < areaWidth; x++)
+        {
+            unsigned int index = y * areaWidth + x;
+            ProgressivePixel& pixel = progressivePixels[index];
+
+            pixel.pending = 0;
+            if (pixel.samples == 0)
+                continue; // not rendered by this instance
+            budget ++;
+            if (pixel.samples >= maxSamples)
+                continue;
+
+            PreciseRGBTColour neighborSum    = pixel.encodedSum;
+            PreciseRGBTColour neighborSumSqr = pixel.encodedSumSqr;
+            unsigned int neighborSamples     = pixel.samples;
+            const unsigned int neighbors[] = { index - 1, index + 1, index - areaWidth, index + areaWidth };
+            const bool neighborValid[] = { x > 0, x + 1 < areaWidth, y > 0, y + 1 < areaHeight };
+            for(int n = 0; n < 4; n++)
+            {
+                if (!neighborValid[n])
+                    continue;
+                const ProgressivePixel& neighbor = progressivePixels[neighbors[n]];
+                neighborSum     += neighbor.encodedSum;
+                neighborSumSqr  += neighbor.encodedSumSqr;
+                neighborSamples += neighbor.samples;
+            }
+
+            PreciseRGBTColour variance = (neighborSumSqr - Sqr(neighborSum)/neighborSamples) / (neighborSamples-1);
+            double cf = confidenceFactor[min(neighborSamples, (unsigned int)confidenceFactor.size())-1];
+            PreciseRGBTColour confidenceDelta = Sqrt(variance) * cf;
+            double error = confidenceDelta.red() + confidenceDelta.green() + confidenceDelta.blue() + confidenceDelta.transm();
+            if (error > threshold)
+                candidates.push_back(std::make_pair(error, index));
+        }
+    }
+
+    // Double the samples of the noisiest pixels of the whole image first, adding no more samples
+    // in one pass than there are pixels, so that passes (and updates of the image) remain frequent.
+    std::sort(candidates.begin(), candidates.end(),
+              [](const std::pair<double, unsigned int>& a, const std::pair<double, unsigned int>& b)
+              { return (a.first != b.first) ? (a.first > b.first) : (a.second < b.second); });
+
+    unsigned int chosen = 0;
+    for(vector<std::pair<double, unsigned int>>::const_iterator i(candidates.begin()); (i != candidates.end()) && (budget > 0); i++)
+    {
+        ProgressivePixel& pixel = progressivePixels[i->second];
+        pixel.pending = min(pixel.samples, maxSamples - pixel.samples);
+        budget -= min(budget, pixel.pending);
+        chosen ++;
+    }
+
+    return chosen;
+}
+
 void ViewData::SetHighestTraceLevel(unsigned int htl)
 {
     std::lock_guard<std::mutex> lock(setDataMutex);
@@ -669,7 +1397,6 @@ RadiosityCache& ViewData::GetRadiosityCache()
 View::View(shared_ptr<BackendSceneData> sd, unsigned int width, unsigned int height, RenderBackend::ViewId vid) :
     viewData(sd),
     stopRequsted(false),
-    mailbox(0),
     renderControlThread(nullptr)
 {
     viewData.viewId = vid;
@@ -677,9 +1404,6 @@ View::View(shared_ptr<BackendSceneData> sd, unsigned int width, unsigned int hei
     viewData.height = height;
 
     POV_MEM_STATS_RENDER_BEGIN();
-
-    if(sd->boundingMethod == 2)
-        mailbox = BSPTree::Mailbox(sd->numberOfFiniteObjects);
 }
 
 View::~View()
@@ -732,22 +1456,39 @@ bool View::CheckCameraHollowObject(const Vector3d& point)
     size_t seed = 0; // TODO
     shared_ptr<BackendSceneData>& sd = viewData.GetSceneData();
 
-    if(sd->boundingMethod == 2)
+    if((sd->boundingMethod == 2) || (sd->boundingMethod == 3))
     {
         HasInteriorPointObjectCondition precond;
         TruePointObjectCondition postcond;
         TraceThreadData threadData(sd, seed); // TODO: avoid the need to construct threadData
         BSPInsideCondFunctor ifn(point, sd->objects, &threadData, precond, postcond);
 
-        mailbox.clear();
-        if ((*sd->tree)(point, ifn, mailbox, true))
-            return true;
+        if(sd->boundingMethod == 3)
+        {
+            if ((*sd->bvhTree)(point, ifn, true))
+                return true;
+        }
+        else
+        {
+            threadData.GetMailbox().resize(sd->numberOfFiniteObjects);
+            threadData.GetMailbox().clear();
+            if ((*sd->tree)(point, ifn, threadData.GetMailbox(), true))
+                return true;
+        }
 
         // test infinite objects
         for(vector<ObjectPtr>::iterator object = sd->objects.begin() + sd->numberOfFiniteObjects; object != sd->objects.end(); object++)
             if (((*object)->interior != nullptr) && Inside_BBox(point, (*object)->BBox) && (*object)->Inside(point, &threadData))
                 return true;
     }
+    else if ((sd->boundingMethod == 1) && (sd->compactSlabs != nullptr))
+    {
+        HasInteriorPointObjectCondition precond;
+        TruePointObjectCondition postcond;
+        TraceThreadData threadData(sd, seed); // TODO: avoid the need to construct threadData
+
+        return sd->compactSlabs->FindInside(point, precond, postcond, true, &threadData);
+    }
     else if ((sd->boundingMethod == 0) || (sd->boundingSlabs == nullptr))
     {
         TraceThreadData threadData(sd, seed); // TODO: avoid the need to construct threadData
@@ -788,6 +1529,7 @@ void View::StartRender(POVMS_Object& renderOptions)
 
     if(renderOptions.TryGetBool(kPOVAttrib_Antialias, false) == true)
         tracingmethod = clip(renderOptions.TryGetInt(kPOVAttrib_SamplingMethod, 1), 0, 3); // TODO FIXME - magic number in clip
+    viewData.antialiasing = (tracingmethod != 0);
 
     aadepth = clip((unsigned int)renderOptions.TryGetInt(kPOVAttrib_AntialiasDepth, 3), 1u, 9u);
     aathreshold = clip(renderOptions.TryGetFloat(kPOVAttrib_AntialiasThreshold, 0.3f), 0.0f, 1.0f);
@@ -809,6 +1551,38 @@ void View::StartRender(POVMS_Object& renderOptions)
 
     highReproducibility = renderOptions.TryGetBool(kPOVAttrib_HighReproducibility, false);
 
+    viewData.functionProfiling = renderOptions.TryGetBool(kPOVAttrib_FunctionProfile, false);
+    viewData.objectProfile = max(renderOptions.TryGetInt(kPOVAttrib_ObjectProfile, 0), 0);
+    viewData.threadAffinity = renderOptions.TryGetBool(kPOVAttrib_ThreadAffinity, false);
+    viewData.eventCounting = renderOptions.TryGetBool(kPOVAttrib_PerformanceCounters, false);
+    viewData.pixelFeatures = renderOptions.TryGetBool(kPOVAttrib_Denoise, false);
+    viewData.pixelCosts = renderOptions.TryGetBool(kPOVAttrib_CostMap, false);
+
+    // the framebuffer is only found if the frontend lives in the same process
+    viewData.sharedFramebuffer = SharedFramebuffer::Find(renderOptions.TryGetInt(kPOVAttrib_SharedFramebufferId, 0));
+    if ((viewData.sharedFramebuffer != nullptr) &&
+        ((viewData.sharedFramebuffer->GetWidth() != viewData.GetWidth()) || (viewData.sharedFramebuffer->GetHeight() != viewData.GetHeight())))
+        viewData.sharedFramebuffer.reset();
+
+    // the timeline, if any, was set up by the scene and is shared by all its views
+    renderTasks.SetTimeline(viewData.sceneData->timeline);
+
+    viewData.wavefrontShading = renderOptions.TryGetBool(kPOVAttrib_WavefrontShading, false);
+    viewData.adaptiveFocalBlur = renderOptions.TryGetBool(kPOVAttrib_AdaptiveFocalBlur, false);
+    viewData.russianRoulette = clip(renderOptions.TryGetFloat(kPOVAttrib_RussianRoulette, 0.0f), 0.0f, 1.0f);
+    viewData.secondaryRayBudget = max(renderOptions.TryGetInt(kPOVAttrib_SecondaryRayBudget, 0), 0);
+
+    // with high reproducibility, each block traces its edges itself so that they don't depend on which block gets there first
+    viewData.edgeSamples.reset();
+    viewData.previewSamples.reset();
+    if (((tracingmethod == 1) || (tracingmethod == 2)) && !highReproducibility)
+        viewData.edgeSamples = std::make_shared<EdgeSampleStore>(viewData.GetWidth(), viewData.GetHeight());
+
+    viewData.projectionTable.reset();
+    unsigned int projectionTableSpacing = clip(renderOptions.TryGetInt(kPOVAttrib_ProjectionTable, 0), 0, 64);
+    if ((projectionTableSpacing > 0) && TracePixelCameraData::IsProjectionCamera(viewData.GetCamera().Type))
+        viewData.projectionTable = std::make_shared<ProjectionTable>(viewData.GetWidth(), viewData.GetHeight(), projectionTableSpacing);
+
     seed = renderOptions.TryGetInt(kPOVAttrib_StochasticSeed, 0);
     if (seed == 0)
         // The following expression returns the number of _ticks_ elapsed since
@@ -821,18 +1595,64 @@ void View::StartRender(POVMS_Object& renderOptions)
     // TODO FIXME - [CLi] if high reproducibility is a demand, timing of writing samples to disk is an issue regarding abort & continue
     bool loadRadiosityCache = renderOptions.TryGetBool(kPOVAttrib_RadiosityFromFile, false);
     bool saveRadiosityCache = renderOptions.TryGetBool(kPOVAttrib_RadiosityToFile, false);
-    if (loadRadiosityCache || saveRadiosityCache)
+    // a scene bundle being prepared needs all samples in the octree, so binary cache files must not be used in place
+    bool prepareSceneBundle = !viewData.GetSceneData()->sceneBundlePrepareFile.empty();
+    bool binaryRadiosityCache = renderOptions.TryGetBool(kPOVAttrib_RadiosityFileBinary, false);
+    int incrementalRadiosityFrames = renderOptions.TryGetInt(kPOVAttrib_RadiosityIncremental, 0);
+    if (incrementalRadiosityFrames < 0)
+        throw POV_EXCEPTION(kParamErr, "Radiosity_Incremental must not be negative.");
+    if ((incrementalRadiosityFrames > 0) && binaryRadiosityCache)
+        throw POV_EXCEPTION(kParamErr, "Radiosity_Incremental cannot be combined with Radiosity_File_Binary.");
+    if ((incrementalRadiosityFrames > 0) && viewData.GetSceneData()->radiositySettings.radiosityEnabled)
+    {
+        // carry the samples over from the previous frame, discarding those affected by changes to the scene,
+        // and pass them on to the next frame along with the new ones
+        Path radiosityFile = Path(renderOptions.TryGetUCS2String(kPOVAttrib_RadiosityFileName, "object.rca"));
+        int frame = renderOptions.TryGetInt(kPOVAttrib_FrameNumber, 0);
+        viewData.radiosityCache.LoadIncremental(radiosityFile, *viewData.GetSceneData(), frame, incrementalRadiosityFrames);
+        viewData.radiosityCache.InitIncrementalAutosave(radiosityFile, *viewData.GetSceneData());
+    }
+    else if (loadRadiosityCache || saveRadiosityCache)
     {
         // TODO FIXME - [CLi] I guess the radiosity file name needs more attention than this; probably a frontend job
         Path radiosityFile = Path(renderOptions.TryGetUCS2String(kPOVAttrib_RadiosityFileName, "object.rca"));
+        // binary cache files are used in place unless we need to add to them
         if(loadRadiosityCache)
-            loadRadiosityCache = viewData.radiosityCache.Load(radiosityFile);
-        if(saveRadiosityCache)
+            loadRadiosityCache = viewData.radiosityCache.Load(radiosityFile, !saveRadiosityCache && !prepareSceneBundle);
+        if(saveRadiosityCache && binaryRadiosityCache)
+            viewData.radiosityCache.InitBinarySave(radiosityFile); // loaded data is included, as it has been copied
+        else if(saveRadiosityCache)
             viewData.radiosityCache.InitAutosave(radiosityFile, loadRadiosityCache); // if we loaded the file, add to existing data
     }
 
     viewData.GetSceneData()->radiositySettings.vainPretrace = renderOptions.TryGetBool(kPOVAttrib_RadiosityVainPretrace, true);
 
+    // distributed photon shooting
+    ScenePhotonSettings& photonSettings = viewData.GetSceneData()->photonSettings;
+    photonSettings.sliceCount = renderOptions.TryGetInt(kPOVAttrib_PhotonSlices, 1);
+    photonSettings.slice = renderOptions.TryGetInt(kPOVAttrib_PhotonSlice, 1);
+    photonSettings.mergeSliceCount = renderOptions.TryGetInt(kPOVAttrib_PhotonMergeSlices, 0);
+    if ((photonSettings.sliceCount < 1) || (photonSettings.slice < 1) || (photonSettings.slice > photonSettings.sliceCount))
+        throw POV_EXCEPTION(kParamErr, "Invalid photon slice");
+    if (photonSettings.mergeSliceCount < 0)
+        throw POV_EXCEPTION(kParamErr, "Invalid photon merge slice count");
+    if (photonSettings.photonsEnabled && ((photonSettings.sliceCount > 1) || (photonSettings.mergeSliceCount > 0)) &&
+        (photonSettings.fileName.empty() || photonSettings.loadFile))
+        throw POV_EXCEPTION(kParamErr, "Distributed photon shooting requires a photon map save_file");
+
+    // scene bundles for render farm nodes
+    const std::shared_ptr<SceneBundle>& sceneBundle = viewData.GetSceneData()->sceneBundle;
+    if ((sceneBundle != nullptr) && ((sceneBundle->GetWidth() != viewData.GetWidth()) || (sceneBundle->GetHeight() != viewData.GetHeight())))
+        throw POV_EXCEPTION(kParamErr, "Scene bundle was prepared for a different image size.");
+    if (prepareSceneBundle && photonSettings.photonsEnabled)
+    {
+        if (photonSettings.sliceCount > 1)
+            throw POV_EXCEPTION(kParamErr, "Prepare_Bundle cannot be combined with distributed photon shooting.");
+        // the photon maps go into the bundle via their binary file
+        if (photonSettings.fileName.empty())
+            photonSettings.fileName = UCS2toSysString(SceneBundle::GetSectionFileName(viewData.GetSceneData()->sceneBundlePrepareFile, SceneBundle::kPhotonSection));
+    }
+
 
      // TODO FIXME - all below is not implemented properly and not threadsafe [trf]
 
@@ -909,6 +1729,7 @@ void View::StartRender(POVMS_Object& renderOptions)
         while(boost::math::gcd((long)viewData.renderBlockStep,(long)(viewData.blockWidth*viewData.blockHeight))>1)
             viewData.renderBlockStep--;
     }
+    viewData.buildBlockPatternOrder();
 
     viewData.blockInfoList.resize(viewData.blockWidth * viewData.blockHeight);
 
@@ -926,8 +1747,68 @@ void View::StartRender(POVMS_Object& renderOptions)
             blockskiplist->insert(*i);
     }
 
+    // distributed rendering; leave all blocks but every n-th (in render pattern order) to other instances
+    int blockWorkers = renderOptions.TryGetInt(kPOVAttrib_RenderBlockWorkers, 1);
+    int blockWorker = renderOptions.TryGetInt(kPOVAttrib_RenderBlockWorker, 0);
+    if (blockWorkers > 1)
+    {
+        if ((blockWorker < 0) || (blockWorker >= blockWorkers))
+            throw POV_EXCEPTION(kParamErr, "Render_Block_Worker must be between 0 and Render_Block_Workers-1");
+
+        for (unsigned int serial = 0; serial < viewData.blockWidth * viewData.blockHeight; serial++)
+        {
+            if (serial % (unsigned int)blockWorkers != (unsigned int)blockWorker)
+                blockskiplist->insert(serial);
+        }
+    }
+
+    // incremental re-rendering; take over the blocks of the previous render not affected by edits of the scene
+    // (not supported for features whose results in one block depend on other parts of the image)
+    shared_ptr<vector<unsigned int>> reusedBlocks;
+    if (!viewData.GetSceneData()->incrementalRenderFile.empty() &&
+        !viewData.GetSceneData()->radiositySettings.radiosityEnabled &&
+        !viewData.GetSceneData()->photonSettings.photonsEnabled &&
+        !viewData.GetSceneData()->useSubsurface &&
+        blockskiplist->empty() && (nextblock == 0) &&
+        !renderOptions.TryGetBool(kPOVAttrib_RealTimeRaytracing, false) &&
+        !renderOptions.Exist(kPOVAttrib_SceneCamera) &&
+        (renderOptions.TryGetFloat(kPOVAttrib_ProgressiveTimeBudget, 0.0f) <= 0.0) &&
+        !((tracingmethod == 3) && renderOptions.TryGetBool(kPOVAttrib_AntialiasGlobal, false)))
+    {
+        // everything the pixels depend on other than the scene itself
+        const DBL options[] = {
+            DBL(viewData.width), DBL(viewData.height), DBL(tracingmethod), jitterscale, aathreshold, aaconfidence,
+            DBL(aadepth), aaGammaValue, DBL(previewstartsize), DBL(previewendsize),
+            DBL(renderOptions.TryGetInt(kPOVAttrib_Quality, 9))
+        };
+        // a seed chosen at random affects the pixels no more than the render before did
+        POV_UINT64 explicitSeed = renderOptions.TryGetInt(kPOVAttrib_StochasticSeed, 0);
+        POV_UINT64 optionsHash = IncrementalRender::HashData(IncrementalRender::kHashSeed, options, sizeof(options));
+        optionsHash = IncrementalRender::HashData(optionsHash, &explicitSeed, sizeof(explicitSeed));
+
+        viewData.incrementalRender.reset(new IncrementalRender(viewData.GetSceneData(), viewData.renderArea, viewData.blockSize, optionsHash));
+        if (viewData.incrementalRender->Load() > 0)
+        {
+            reusedBlocks = std::make_shared<vector<unsigned int>>();
+            for (unsigned int serial = 0; serial < viewData.blockWidth * viewData.blockHeight; serial++)
+            {
+                POVRect rect;
+                viewData.getBlockRect(serial, rect);
+                if (viewData.incrementalRender->IsReusable(rect))
+                {
+                    blockskiplist->insert(serial);
+                    reusedBlocks->push_back(serial);
+                }
+            }
+        }
+    }
+
     viewData.SetNextRectangle(*blockskiplist, nextblock);
 
+    // send the blocks taken over from the previous render first
+    if (reusedBlocks != nullptr)
+        renderTasks.AppendFunction(boost::bind(&View::SendReusedBlocks, this, _1, reusedBlocks));
+
     // render thread count
     int maxRenderThreads = renderOptions.TryGetInt(kPOVAttrib_MaxRenderThreads, 1);
 
@@ -937,7 +1818,15 @@ void View::StartRender(POVMS_Object& renderOptions)
 
     // camera changes without parsing
     if(renderOptions.Exist(kPOVAttrib_SceneCamera) == false)
-        viewData.camera = viewData.GetSceneData()->parsedCamera;
+    {
+        // with multiple cameras, each view of the scene may render a different one of them
+        const vector<Camera>& cameras = viewData.GetSceneData()->cameras;
+        POVMSInt cameraIndex = renderOptions.TryGetInt(kPOVAttrib_CameraIndex, -1);
+        if (viewData.GetSceneData()->multiCamera && (cameraIndex >= 0) && (cameraIndex < POVMSInt(cameras.size())))
+            viewData.camera = cameras[cameraIndex];
+        else
+            viewData.camera = viewData.GetSceneData()->parsedCamera;
+    }
     else // INCOMPLETE EXPERIMENTAL [trf]
     {
         POVMS_Object camera;
@@ -1076,16 +1965,21 @@ void View::StartRender(POVMS_Object& renderOptions)
     */
     if(viewData.GetSceneData()->photonSettings.photonsEnabled)
     {
-        if (!viewData.GetSceneData()->photonSettings.fileName.empty() && viewData.GetSceneData()->photonSettings.loadFile)
+        const unsigned char *bundleData;
+        POV_UINT64 bundleOffset, bundleSize;
+
+        if ((!viewData.GetSceneData()->photonSettings.fileName.empty() && viewData.GetSceneData()->photonSettings.loadFile) ||
+            (viewData.GetSceneData()->photonSettings.mergeSliceCount > 0) ||
+            ((sceneBundle != nullptr) && sceneBundle->GetSection(SceneBundle::kPhotonSection, bundleData, bundleOffset, bundleSize)))
         {
             vector<PhotonMap*> surfaceMaps;
             vector<PhotonMap*> mediaMaps;
 
             // when we pass a null parameter for the "strategy" (last parameter),
-            // then this will LOAD the photon map
-            viewThreadData.push_back(dynamic_cast<ViewThreadData *>(renderTasks.AppendTask(new PhotonSortingTask(
+            // then this will LOAD the photon map (or merge the slices of a distributed one)
+            AppendRenderTask(new PhotonSortingTask(
                 &viewData, surfaceMaps, mediaMaps, nullptr, seed
-                ))));
+                ));
             // wait for photons to finish
             renderTasks.AppendSync();
         }
@@ -1093,43 +1987,74 @@ void View::StartRender(POVMS_Object& renderOptions)
         {
             PhotonShootingStrategy* strategy = new PhotonShootingStrategy();
 
-            viewThreadData.push_back(dynamic_cast<ViewThreadData *>(renderTasks.AppendTask(new PhotonEstimationTask(
+            AppendRenderTask(new PhotonEstimationTask(
                 &viewData, seed
-                ))));
+                ));
             // wait for photons to finish
             renderTasks.AppendSync();
 
-            viewThreadData.push_back(dynamic_cast<ViewThreadData *>(renderTasks.AppendTask(new PhotonStrategyTask(
+            AppendRenderTask(new PhotonStrategyTask(
                 &viewData, strategy, seed
-                ))));
+                ));
             // wait for photons to finish
             renderTasks.AppendSync();
 
-            vector<PhotonMap*> surfaceMaps;
-            vector<PhotonMap*> mediaMaps;
+            // progressive photon mapping shoots and refines the photons several times
+            // (not supported for distributed shooting)
+            int passes = 1;
+            if (viewData.GetSceneData()->photonSettings.sliceCount > 1)
+                viewData.GetSceneData()->photonSettings.progressivePasses = 1;
+            else
+                passes = max(viewData.GetSceneData()->photonSettings.progressivePasses, 1);
 
-            for(int i = 0; i < maxRenderThreads; i++)
+            for(int pass = 0; pass < passes; pass++)
             {
-                PhotonShootingTask* task = new PhotonShootingTask(&viewData, strategy, seed);
-                surfaceMaps.push_back(task->getSurfacePhotonMap());
-                mediaMaps.push_back(task->getMediaPhotonMap());
-                viewThreadData.push_back(dynamic_cast<ViewThreadData *>(renderTasks.AppendTask(task)));
+                vector<PhotonMap*> surfaceMaps;
+                vector<PhotonMap*> mediaMaps;
+
+                vector<Task*> tasks;
+                for(int i = 0; i < maxRenderThreads; i++)
+                {
+                    PhotonShootingTask* task = new PhotonShootingTask(&viewData, strategy, seed);
+                    surfaceMaps.push_back(task->getSurfacePhotonMap());
+                    mediaMaps.push_back(task->getMediaPhotonMap());
+                    tasks.push_back(task);
+                }
+                AppendRenderTasks(tasks);
+                // wait for photons to finish
+                renderTasks.AppendSync();
+
+                // this merges the maps, sorts, computes gather options, and then cleans up memory
+                // (or, in progressive mode, refines the first pass' photons with those of this pass)
+                AppendRenderTask(new PhotonSortingTask(
+                    &viewData, surfaceMaps, mediaMaps, strategy, seed, maxRenderThreads
+                    ));
+                // wait for photons to finish
+                renderTasks.AppendSync();
             }
-            // wait for photons to finish
-            renderTasks.AppendSync();
 
-            // this merges the maps, sorts, computes gather options, and then cleans up memory
-            viewThreadData.push_back(dynamic_cast<ViewThreadData *>(renderTasks.AppendTask(new PhotonSortingTask(
-                &viewData, surfaceMaps, mediaMaps, strategy, seed
-                ))));
-            // wait for photons to finish
-            renderTasks.AppendSync();
+        }
+    }
+
+    // take the samples of the radiosity pretrace from the scene bundle, so that all render farm nodes share them
+    bool radiosityFromBundle = false;
+    if ((sceneBundle != nullptr) && viewData.GetSceneData()->radiositySettings.radiosityEnabled)
+    {
+        const unsigned char *bundleData;
+        POV_UINT64 bundleOffset, bundleSize;
 
+        if (sceneBundle->GetSection(SceneBundle::kRadiositySection, bundleData, bundleOffset, bundleSize))
+        {
+            if (!viewData.radiosityCache.Load(sceneBundle->GetFile(), bundleOffset, bundleSize, !saveRadiosityCache))
+                throw POV_EXCEPTION(kFileDataErr, "Cannot read radiosity samples from scene bundle.");
+            // samples taken by the final trace would differ between nodes, causing seams
+            viewData.GetSceneData()->radiositySettings.alwaysSample = false;
+            radiosityFromBundle = true;
         }
     }
 
     // do radiosity pretrace
-    if(viewData.GetSceneData()->radiositySettings.radiosityEnabled)
+    if(viewData.GetSceneData()->radiositySettings.radiosityEnabled && !radiosityFromBundle)
     {
         // TODO load radiosity data (if applicable)?
 
@@ -1153,48 +2078,56 @@ void View::StartRender(POVMS_Object& renderOptions)
             //         "To avoid this warning, decrease pretrace_start or increase pretrace_end.", endSize / maxWidthHeight);
         }
 
+        viewData.GetRadiosityCache().SetHighReproducibility(highReproducibility);
+
         if (highReproducibility)
         {
-            int nominalThreads = 1;
-            int actualThreads;
+            // Each tile only re-uses samples from previous pretrace steps and from itself, and the samples
+            // of each step are brought into a canonical order once the step is complete, so all threads
+            // can work on a step at once without the result depending on which thread did what.
             DBL stepSize = startSize;
             DBL actualSize;
             for(int step = RadiosityFunction::PRETRACE_FIRST; step < RadiosityFunction::PRETRACE_FIRST + steps; step ++)
             {
-                actualThreads = min(nominalThreads, maxRenderThreads);
                 actualSize = max(stepSize, endSize);
 
                 // do render one pretrace step with current pretrace size
-                for(int i = 0; i < actualThreads; i++)
-                    viewThreadData.push_back(dynamic_cast<ViewThreadData *>(renderTasks.AppendTask(new RadiosityTask(
-                        &viewData, actualSize, actualSize, step, 1, nominalThreads, seed
-                        ))));
+                vector<Task*> tasks;
+                for(int i = 0; i < maxRenderThreads; i++)
+                    tasks.push_back(new RadiosityTask(
+                        &viewData, actualSize, actualSize, step, 1, true, seed
+                        ));
+                AppendRenderTasks(tasks);
 
                 // wait for previous pretrace step to finish
                 renderTasks.AppendSync();
 
-                // reset block size counter and block skip list for next pretrace step
+                // merge the samples of this pretrace step, and reset block size counter and block skip list for next pretrace step
+                renderTasks.AppendFunction(boost::bind(&View::MergeRadiosityPass, this, _1));
+                renderTasks.AppendFunction(boost::bind(&View::FlushRadiosityAutosave, this, _1));
                 renderTasks.AppendFunction(boost::bind(&View::SetNextRectangle, this, _1, blockskiplist, nextblock));
 
                 // wait for block size counter and block skip list reset to finish
                 renderTasks.AppendSync();
 
                 stepSize *= 0.5;
-                nominalThreads *= 2;
             }
         }
         else if (steps > 0)
         {
-            // do render all pretrace steps
+            // do render all pretrace steps, with each thread sticking to a region of the view for better sample re-use
+            vector<Task*> tasks;
             for(int i = 0; i < maxRenderThreads; i++)
-                viewThreadData.push_back(dynamic_cast<ViewThreadData *>(renderTasks.AppendTask(new RadiosityTask(
-                    &viewData, startSize, endSize, RadiosityFunction::PRETRACE_FIRST, steps, 0, seed
-                    ))));
+                tasks.push_back(new RadiosityTask(
+                    &viewData, startSize, endSize, RadiosityFunction::PRETRACE_FIRST, steps, false, seed, i, maxRenderThreads
+                    ));
+            AppendRenderTasks(tasks);
 
             // wait for pretrace to finish
             renderTasks.AppendSync();
 
             // reset block size counter and block skip list for main render
+            renderTasks.AppendFunction(boost::bind(&View::FlushRadiosityAutosave, this, _1));
             renderTasks.AppendFunction(boost::bind(&View::SetNextRectangle, this, _1, blockskiplist, nextblock));
 
             // wait for block size counter and block skip list reset to finish
@@ -1204,19 +2137,77 @@ void View::StartRender(POVMS_Object& renderOptions)
         // TODO store radiosity data (if applicable)?
     }
 
+    // when preparing a scene bundle, the image itself is not needed
+    if (prepareSceneBundle)
+    {
+        renderTasks.AppendSync();
+        renderTasks.AppendFunction(boost::bind(&View::WriteSceneBundle, this, _1));
+        AppendRenderCompletion();
+        return;
+    }
+
+    // time budget for progressive rendering mode
+    DBL progressiveBudget = renderOptions.TryGetFloat(kPOVAttrib_ProgressiveTimeBudget, 0.0f);
+    if (progressiveBudget < 0.0)
+        throw POV_EXCEPTION(kParamErr, "Progressive_Time_Budget must not be negative.");
+
+    // sampling method 3 with samples allocated across the whole image works the same way, just without a time limit
+    bool globalSampling = (tracingmethod == 3) && renderOptions.TryGetBool(kPOVAttrib_AntialiasGlobal, false);
+
+    // do render in progressive mode
+    if (((progressiveBudget > 0.0) || globalSampling) && !viewData.realTimeRaytracing)
+    {
+        // The budget includes any photon shooting and radiosity pretrace queued above.
+        if (progressiveBudget > 0.0)
+            viewData.progressiveDeadline = std::chrono::steady_clock::now() +
+                std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<DBL>(progressiveBudget));
+        else
+            viewData.progressiveDeadline = std::chrono::steady_clock::time_point::max();
+        viewData.progressivePixels.assign(viewData.renderArea.GetArea(), ViewData::ProgressivePixel());
+        viewData.progressivePass = 0;
+        viewData.progressivePassOffset = 0;
+
+        // continue trace; pick up the samples accumulated by the previous render
+        if (renderOptions.Exist(kPOVAttrib_SampleStatistics) == true)
+        {
+            POVMS_List stats;
+
+            renderOptions.Get(kPOVAttrib_SampleStatistics, stats);
+            viewData.loadProgressiveStatistics(stats);
+        }
+
+        progressiveSettings.jitterScale = jitterscale;
+        progressiveSettings.aaThreshold = aathreshold;
+        progressiveSettings.aaConfidence = aaconfidence;
+        progressiveSettings.aaDepth = aadepth;
+        progressiveSettings.aaGamma = aaGammaCurve;
+        progressiveSettings.highReproducibility = highReproducibility;
+        progressiveSettings.seed = seed;
+        progressiveSettings.threads = maxRenderThreads;
+
+        // the remaining passes and the completion of the render are appended as the passes finish
+        AppendProgressivePass();
+        return;
+    }
     // do render with mosaic preview
-    if(previewstartsize > 1)
+    else if(previewstartsize > 1)
     {
         // If the mosaic preview goes all the way down to single-pixel size and no anti-aliasing is required,
         // we don't need a dedicated final render pass.
         bool previewIsFinalPass = (previewendsize == 1) && (tracingmethod == 0);
 
+        // the final pass can use the pixels traced by the preview passes again if it samples pixel centres
+        if (!previewIsFinalPass && (tracingmethod <= 1) && !highReproducibility)
+            viewData.previewSamples = std::make_shared<PreviewSampleStore>(viewData.renderArea);
+
         // do render with mosaic preview start size
+        vector<Task*> tasks;
         for(int i = 0; i < maxRenderThreads; i++)
-            viewThreadData.push_back(dynamic_cast<ViewThreadData *>(renderTasks.AppendTask(new TraceTask(
+            tasks.push_back(new TraceTask(
                 &viewData, 0, jitterscale, aathreshold, aaconfidence, aadepth, aaGammaCurve,
-                previewstartsize, false, previewIsFinalPass, highReproducibility, seed
-                ))));
+                previewstartsize, false, previewIsFinalPass, highReproducibility, seed, i, maxRenderThreads
+                ));
+        AppendRenderTasks(tasks);
 
         for(unsigned int step = (previewstartsize >> 1); step >= previewendsize; step >>= 1)
         {
@@ -1230,11 +2221,13 @@ void View::StartRender(POVMS_Object& renderOptions)
             renderTasks.AppendSync();
 
             // do render with current mosaic preview size
+            tasks.clear();
             for(int i = 0; i < maxRenderThreads; i++)
-                viewThreadData.push_back(dynamic_cast<ViewThreadData *>(renderTasks.AppendTask(new TraceTask(
+                tasks.push_back(new TraceTask(
                     &viewData, 0, jitterscale, aathreshold, aaconfidence, aadepth, aaGammaCurve,
-                    step, true, previewIsFinalPass, highReproducibility, seed
-                    ))));
+                    step, true, previewIsFinalPass, highReproducibility, seed, i, maxRenderThreads
+                    ));
+            AppendRenderTasks(tasks);
         }
 
         if (!previewIsFinalPass)
@@ -1248,26 +2241,45 @@ void View::StartRender(POVMS_Object& renderOptions)
             // wait for block size counter and block skip list reset to finish
             renderTasks.AppendSync();
 
+            tasks.clear();
             for(int i = 0; i < maxRenderThreads; i++)
-                viewThreadData.push_back(dynamic_cast<ViewThreadData *>(renderTasks.AppendTask(new TraceTask(
+                tasks.push_back(new TraceTask(
                     &viewData, tracingmethod, jitterscale, aathreshold, aaconfidence, aadepth, aaGammaCurve,
-                    0, false, true, highReproducibility, seed
-                    ))));
+                    0, false, true, highReproducibility, seed, i, maxRenderThreads
+                    ));
+            AppendRenderTasks(tasks);
         }
     }
     // do render without mosaic preview
     else
     {
+        vector<Task*> tasks;
         for(int i = 0; i < maxRenderThreads; i++)
-            viewThreadData.push_back(dynamic_cast<ViewThreadData *>(renderTasks.AppendTask(new TraceTask(
+            tasks.push_back(new TraceTask(
                 &viewData, tracingmethod, jitterscale, aathreshold, aaconfidence, aadepth, aaGammaCurve,
-                0, false, true, highReproducibility, seed
-                ))));
+                0, false, true, highReproducibility, seed, i, maxRenderThreads
+                ));
+        AppendRenderTasks(tasks);
     }
 
+    AppendRenderCompletion();
+}
+
+void View::AppendRenderCompletion()
+{
     // wait for render to finish
     renderTasks.AppendSync();
 
+    // write out the radiosity samples of the final trace
+    renderTasks.AppendFunction(boost::bind(&View::FlushRadiosityAutosave, this, _1));
+
+    // keep the render for incremental re-rendering of the next version of the scene
+    if (viewData.incrementalRender != nullptr)
+    {
+        renderTasks.AppendFunction(boost::bind(&View::SaveIncrementalRender, this, _1));
+        renderTasks.AppendSync();
+    }
+
     // send shutdown messages
     renderTasks.AppendFunction(boost::bind(&View::DispatchShutdownMessages, this, _1));
 
@@ -1295,10 +2307,94 @@ void View::StopRender()
 void View::GetStatistics(POVMS_Object& renderStats)
 {
     RenderStatistics    stats;
+    vector<FunctionProfileData> functionProfile;
+    std::unordered_map<ConstObjectPtr, ObjectProfileData> objectProfile;
 
     for(vector<ViewThreadData *>::iterator i(viewThreadData.begin()); i != viewThreadData.end(); i++)
+    {
         stats += (*i)->Stats();
 
+        const vector<FunctionProfileData>& threadProfile = (*i)->functionProfile;
+        if (functionProfile.size() < threadProfile.size())
+            functionProfile.resize(threadProfile.size());
+        for (size_t fn = 0; fn < threadProfile.size(); fn++)
+        {
+            if (threadProfile[fn].calls == 0)
+                continue;
+            functionProfile[fn].name = threadProfile[fn].name;
+            functionProfile[fn].calls += threadProfile[fn].calls;
+            functionProfile[fn].instructions += threadProfile[fn].instructions;
+            functionProfile[fn].time += threadProfile[fn].time;
+        }
+
+        for (const auto& entry : (*i)->objectProfile)
+        {
+            ObjectProfileData& data = objectProfile[entry.first];
+            data.tests += entry.second.tests;
+            data.hits += entry.second.hits;
+            data.timedTests += entry.second.timedTests;
+            data.time += entry.second.time;
+        }
+    }
+
+    // function profile, most expensive functions first
+    functionProfile.erase(std::remove_if(functionProfile.begin(), functionProfile.end(),
+                                         [](const FunctionProfileData& f) { return f.calls == 0; }),
+                          functionProfile.end());
+    if (!functionProfile.empty())
+    {
+        POVMS_List functionStats;
+
+        std::sort(functionProfile.begin(), functionProfile.end(),
+                  [](const FunctionProfileData& a, const FunctionProfileData& b) { return a.time > b.time; });
+        for (vector<FunctionProfileData>::const_iterator i(functionProfile.begin()); i != functionProfile.end(); i++)
+        {
+            POVMS_Object functionStat(kPOVObjectClass_FunctionStat);
+
+            functionStat.SetString(kPOVAttrib_ObjectName, i->name.c_str());
+            functionStat.SetLong(kPOVAttrib_FunctionCalls, i->calls);
+            functionStat.SetLong(kPOVAttrib_FunctionInstructions, i->instructions);
+            functionStat.SetLong(kPOVAttrib_FunctionTime, i->time);
+
+            functionStats.Append(functionStat);
+        }
+
+        renderStats.Set(kPOVAttrib_FunctionProfileStats, functionStats);
+    }
+
+    // object profile, most expensive objects first
+    if (!objectProfile.empty() && (viewData.objectProfile > 0))
+    {
+        typedef std::pair<ConstObjectPtr, ObjectProfileData> ObjectProfileEntry;
+        vector<ObjectProfileEntry> objects(objectProfile.begin(), objectProfile.end());
+        size_t count = min(objects.size(), size_t(viewData.objectProfile));
+        POVMS_List objectStats;
+
+        std::partial_sort(objects.begin(), objects.begin() + count, objects.end(),
+                          [](const ObjectProfileEntry& a, const ObjectProfileEntry& b) { return a.second.EstimatedTime() > b.second.EstimatedTime(); });
+        const vector<UCS2String>& sourceFiles = viewData.GetSceneData()->sourceFiles;
+        for (size_t n = 0; n < count; n++)
+        {
+            POVMS_Object objectStat(kPOVObjectClass_ObjectProfileStat);
+            ConstObjectPtr object = objects[n].first;
+            std::string name;
+
+            if ((object->sourceLine > 0) && (object->sourceFile < sourceFiles.size()))
+                name = UCS2toSysString(Path(sourceFiles[object->sourceFile]).GetFile()) + ":" + std::to_string(object->sourceLine);
+            else
+                name = "(unknown)";
+
+            objectStat.SetString(kPOVAttrib_ObjectName, name.c_str());
+            objectStat.SetLong(kPOVAttrib_ISectsTests, objects[n].second.tests);
+            objectStat.SetLong(kPOVAttrib_ISectsSucceeded, objects[n].second.hits);
+            objectStat.SetLong(kPOVAttrib_ObjectProfileTime, objects[n].second.EstimatedTime());
+
+            objectStats.Append(objectStat);
+        }
+
+        renderStats.Set(kPOVAttrib_ObjectProfileStats, objectStats);
+    }
+
     // object intersection stats
     POVMS_List isectStats;
 
@@ -1316,6 +2412,13 @@ void View::GetStatistics(POVMS_Object& renderStats)
 
     renderStats.Set(kPOVAttrib_ObjectIStats, isectStats);
 
+    // task queue stats
+    TaskQueue::Statistics queueStats = renderTasks.GetStatistics();
+    renderStats.SetLong(kPOVAttrib_TaskQueueTasks, queueStats.tasksStarted);
+    renderStats.SetLong(kPOVAttrib_TaskQueueLatency, queueStats.queueLatency);
+    renderStats.SetLong(kPOVAttrib_TaskQueueSyncWaits, queueStats.syncWaits);
+    renderStats.SetLong(kPOVAttrib_TaskQueueSyncWaitTime, queueStats.syncWaitTime);
+
     // general stats
     renderStats.SetInt(kPOVAttrib_Height, viewData.GetHeight());
     renderStats.SetInt(kPOVAttrib_Width, viewData.GetWidth());
@@ -1330,6 +2433,16 @@ void View::GetStatistics(POVMS_Object& renderStats)
     renderStats.SetLong(kPOVAttrib_ShadowTest, stats[Shadow_Ray_Tests]);
     renderStats.SetLong(kPOVAttrib_ShadowTestSuc, stats[Shadow_Rays_Succeeded]);
     renderStats.SetLong(kPOVAttrib_ShadowCacheHits, stats[Shadow_Cache_Hits]);
+    renderStats.SetLong(kPOVAttrib_ShadowCacheTests, stats[Shadow_Cache_Tests]);
+    renderStats.SetLong(kPOVAttrib_RouletteTerminated1, stats[Roulette_Terminated_L1]);
+    renderStats.SetLong(kPOVAttrib_RouletteTerminated2, stats[Roulette_Terminated_L2]);
+    renderStats.SetLong(kPOVAttrib_RouletteTerminated3, stats[Roulette_Terminated_L3]);
+    renderStats.SetLong(kPOVAttrib_RouletteTerminated4, stats[Roulette_Terminated_L4]);
+    renderStats.SetLong(kPOVAttrib_RouletteTerminated5, stats[Roulette_Terminated_L5ff]);
+    renderStats.SetLong(kPOVAttrib_RayBudgetExhausted, stats[Ray_Budget_Exhausted]);
+    renderStats.SetLong(kPOVAttrib_MeshPageIns, stats[Mesh_Page_Ins]);
+    renderStats.SetLong(kPOVAttrib_MeshPageInTime, stats[Mesh_Page_In_Time]);
+    renderStats.SetLong(kPOVAttrib_MeshPageEvictions, stats[Mesh_Page_Evictions]);
     renderStats.SetLong(kPOVAttrib_MediaSamples, stats[Media_Samples]);
     renderStats.SetLong(kPOVAttrib_MediaIntervals, stats[Media_Intervals]);
     renderStats.SetLong(kPOVAttrib_ReflectedRays, stats[Reflected_Rays_Traced]);
@@ -1340,6 +2453,8 @@ void View::GetStatistics(POVMS_Object& renderStats)
     // other tracing-related stats
     renderStats.SetLong(kPOVAttrib_IsoFindRoot, stats[Ray_IsoSurface_Find_Root]);
     renderStats.SetLong(kPOVAttrib_FunctionVMCalls, stats[Ray_Function_VM_Calls]);
+    renderStats.SetLong(kPOVAttrib_FunctionVMNativeCalls, stats[Ray_Function_VM_Native_Calls]);
+    renderStats.SetLong(kPOVAttrib_FunctionVMBatchCalls, stats[Ray_Function_VM_Batch_Calls]);
     renderStats.SetLong(kPOVAttrib_FunctionVMInstrEst, stats[Ray_Function_VM_Instruction_Est]);
     renderStats.SetLong(kPOVAttrib_PolynomTest, stats[Polynomials_Tested]);
     renderStats.SetLong(kPOVAttrib_RootsEliminated, stats[Roots_Eliminated]);
@@ -1348,6 +2463,10 @@ void View::GetStatistics(POVMS_Object& renderStats)
 
     renderStats.SetLong(kPOVAttrib_CrackleCacheTest, stats[CrackleCache_Tests]);
     renderStats.SetLong(kPOVAttrib_CrackleCacheTestSuc, stats[CrackleCache_Tests_Succeeded]);
+    renderStats.SetLong(kPOVAttrib_CrackleCacheEvict, stats[CrackleCache_Evictions]);
+
+    renderStats.SetLong(kPOVAttrib_WarpChains, stats[Warp_Chains_Evaluated]);
+    renderStats.SetLong(kPOVAttrib_WarpTime, stats[Warp_Time]);
 
     POV_LONG current;
     POV_ULONG allocs(0), frees(0), peak(0), smallest(0), largest(0);
@@ -1366,6 +2485,31 @@ void View::GetStatistics(POVMS_Object& renderStats)
             renderStats.SetLong(kPOVAttrib_MaxAlloc, largest);
     }
 
+    // memory accounted per subsystem
+    POVMS_List memoryStats;
+
+    for (int subsystem = 0; subsystem < pov_base::kMemory_SubsystemCount; subsystem++)
+    {
+        POVMS_Object memoryStat(kPOVObjectClass_MemoryStat);
+        pov_base::MemorySubsystem id = static_cast<pov_base::MemorySubsystem>(subsystem);
+
+        memoryStat.SetString(kPOVAttrib_ObjectName, pov_base::pov_mem_subsystem_name(id));
+        memoryStat.SetLong(kPOVAttrib_CurrentMemoryUsage, static_cast<POVMSLong>(pov_base::pov_mem_accounted(id)));
+        memoryStat.SetLong(kPOVAttrib_PeakMemoryUsage, static_cast<POVMSLong>(pov_base::pov_mem_accounted_peak(id)));
+
+        memoryStats.Append(memoryStat);
+    }
+
+    renderStats.Set(kPOVAttrib_SubsystemMemory, memoryStats);
+
+    // CPU features in use, for machine-readable results
+#ifdef POV_CPUINFO
+    renderStats.SetString(kPOVAttrib_CPUInfo, std::string(POV_CPUINFO).c_str());
+#endif
+#ifdef TRY_OPTIMIZED_NOISE
+    renderStats.SetString(kPOVAttrib_NoiseGenerator, GetRecommendedOptimizedNoise()->name);
+#endif
+
     renderStats.SetInt(kPOVAttrib_TraceLevel, viewData.highestTraceLevel);
     renderStats.SetInt(kPOVAttrib_MaxTraceLevel, viewData.sceneData->parsedMaxTraceLevel);
 
@@ -1373,12 +2517,15 @@ void View::GetStatistics(POVMS_Object& renderStats)
     renderStats.SetLong(kPOVAttrib_RadUnsavedCount, stats[Radiosity_UnsavedCount]);
     renderStats.SetLong(kPOVAttrib_RadReuseCount, stats[Radiosity_ReuseCount]);
     renderStats.SetLong(kPOVAttrib_RadRayCount, stats[Radiosity_RayCount]);
+    renderStats.SetLong(kPOVAttrib_RadRaysSaved, stats[Radiosity_RaysSaved]);
     renderStats.SetLong(kPOVAttrib_RadTopLevelGatherCount, stats[Radiosity_TopLevel_GatherCount]);
     renderStats.SetLong(kPOVAttrib_RadTopLevelReuseCount, stats[Radiosity_TopLevel_ReuseCount]);
     renderStats.SetLong(kPOVAttrib_RadTopLevelRayCount, stats[Radiosity_TopLevel_RayCount]);
+    renderStats.SetLong(kPOVAttrib_RadTopLevelRaysSaved, stats[Radiosity_TopLevel_RaysSaved]);
     renderStats.SetLong(kPOVAttrib_RadFinalGatherCount, stats[Radiosity_Final_GatherCount]);
     renderStats.SetLong(kPOVAttrib_RadFinalReuseCount, stats[Radiosity_Final_ReuseCount]);
     renderStats.SetLong(kPOVAttrib_RadFinalRayCount, stats[Radiosity_Final_RayCount]);
+    renderStats.SetLong(kPOVAttrib_RadFinalRaysSaved, stats[Radiosity_Final_RaysSaved]);
     renderStats.SetLong(kPOVAttrib_RadOctreeNodes, stats[Radiosity_OctreeNodes]);
     renderStats.SetLong(kPOVAttrib_RadOctreeLookups, stats[Radiosity_OctreeLookups]);
     renderStats.SetLong(kPOVAttrib_RadOctreeAccepts0, stats[Radiosity_OctreeAccepts0]);
@@ -1387,6 +2534,11 @@ void View::GetStatistics(POVMS_Object& renderStats)
     renderStats.SetLong(kPOVAttrib_RadOctreeAccepts3, stats[Radiosity_OctreeAccepts3]);
     renderStats.SetLong(kPOVAttrib_RadOctreeAccepts4, stats[Radiosity_OctreeAccepts4]);
     renderStats.SetLong(kPOVAttrib_RadOctreeAccepts5, stats[Radiosity_OctreeAccepts5]);
+    renderStats.SetLong(kPOVAttrib_RadOctreeRetries, stats[Radiosity_OctreeRetries]);
+    renderStats.SetLong(kPOVAttrib_RadLockWaitTime, stats[Radiosity_LockWaitTime]);
+    renderStats.SetLong(kPOVAttrib_RadRecentHits, stats[Radiosity_RecentHits]);
+    renderStats.SetLong(kPOVAttrib_RadIncrementalReused, viewData.radiosityCache.incrementalReused);
+    renderStats.SetLong(kPOVAttrib_RadIncrementalDiscarded, viewData.radiosityCache.incrementalDiscarded);
 
     for (int recursion = 0; recursion < 5; recursion ++)
     {
@@ -1408,6 +2560,14 @@ void View::GetStatistics(POVMS_Object& renderStats)
             renderStats.SetFloat(id, 0.0);
     }
 
+    for (int pass = 1; pass <= 5; pass ++)
+    {
+        renderStats.SetLong(kPOVAttrib_RadRayCountP1 + (pass-1)*256, stats[IntStatsIndex(Radiosity_RayCount_PTS1 + (pass-1))]);
+        renderStats.SetLong(kPOVAttrib_RadRaysSavedP1 + (pass-1)*256, stats[IntStatsIndex(Radiosity_RaysSaved_PTS1 + (pass-1))]);
+    }
+    renderStats.SetLong(kPOVAttrib_RadRayCountF, stats[Radiosity_RayCount_Final]);
+    renderStats.SetLong(kPOVAttrib_RadRaysSavedF, stats[Radiosity_RaysSaved_Final]);
+
     // photon stats // TODO FIXME - move to photon pass? [trf]
     renderStats.SetLong(kPOVAttrib_PhotonsShot, stats[Number_Of_Photons_Shot]);
     renderStats.SetLong(kPOVAttrib_PhotonsStored, stats[Number_Of_Photons_Stored]);
@@ -1417,23 +2577,38 @@ void View::GetStatistics(POVMS_Object& renderStats)
     renderStats.SetLong(kPOVAttrib_PhotonsPriQRemove, stats[Priority_Queue_Remove]);
     renderStats.SetLong(kPOVAttrib_GatherPerformedCnt, stats[Gather_Performed_Count]);
     renderStats.SetLong(kPOVAttrib_GatherExpandedCnt, stats[Gather_Expanded_Count]);
+    renderStats.SetLong(kPOVAttrib_SurfacePhotonBuildTime, viewData.GetSceneData()->surfacePhotonBuildTime);
+    renderStats.SetLong(kPOVAttrib_MediaPhotonBuildTime, viewData.GetSceneData()->mediaPhotonBuildTime);
+    renderStats.SetInt(kPOVAttrib_RenderBlockSize, viewData.blockSize);
 
     struct TimeData final
     {
         POV_LONG cpuTime;
         POV_LONG realTime;
+        POV_LONG minRealTime;
         size_t samples;
+        PerformanceCounts events;
+        POVMS_List threadEvents;
 
-        TimeData() : cpuTime(0), realTime(0), samples(0) { }
+        TimeData() : cpuTime(0), realTime(0), minRealTime(0), samples(0) { }
     };
 
     TimeData timeData[TraceThreadData::kMaxTimeType];
 
     for(vector<ViewThreadData *>::iterator i(viewThreadData.begin()); i != viewThreadData.end(); i++)
     {
+        timeData[(*i)->timeType].minRealTime = (timeData[(*i)->timeType].samples == 0 ? (*i)->realTime
+                                                                                      : min(timeData[(*i)->timeType].minRealTime, (*i)->realTime));
         timeData[(*i)->timeType].realTime = max(timeData[(*i)->timeType].realTime, (*i)->realTime);
         timeData[(*i)->timeType].cpuTime += (*i)->cpuTime;
         timeData[(*i)->timeType].samples++;
+        if ((*i)->eventCounts.IsValid())
+        {
+            POVMS_Object threadEvents(kPOVObjectClass_EventCounts);
+            SetEventCounts(threadEvents, (*i)->eventCounts);
+            timeData[(*i)->timeType].threadEvents.Append(threadEvents);
+            timeData[(*i)->timeType].events += (*i)->eventCounts;
+        }
     }
 
     for(size_t i = TraceThreadData::kUnknownTime; i < TraceThreadData::kMaxTimeType; i++)
@@ -1445,6 +2620,13 @@ void View::GetStatistics(POVMS_Object& renderStats)
             elapsedTime.SetLong(kPOVAttrib_RealTime, timeData[i].realTime);
             elapsedTime.SetLong(kPOVAttrib_CPUTime, timeData[i].cpuTime);
             elapsedTime.SetInt(kPOVAttrib_TimeSamples, (int) timeData[i].samples);
+            // time the other threads spent waiting for the slowest one, e.g. for the last blocks to be rendered
+            elapsedTime.SetLong(kPOVAttrib_TailTime, timeData[i].realTime - timeData[i].minRealTime);
+            if (timeData[i].events.IsValid())
+            {
+                SetEventCounts(elapsedTime, timeData[i].events);
+                elapsedTime.Set(kPOVAttrib_ThreadEvents, timeData[i].threadEvents);
+            }
 
             switch(i)
             {
@@ -1512,6 +2694,32 @@ void View::SendStatistics(TaskQueue&)
     for(vector<ViewThreadData *>::iterator i(viewThreadData.begin()); i != viewThreadData.end(); i++)
         delete (*i);
     viewThreadData.clear();
+
+    // the render is complete, so this is the last opportunity to write the timeline
+    if (viewData.sceneData->timeline != nullptr)
+        viewData.sceneData->timeline->Write();
+}
+
+void View::AppendRenderTask(Task* task)
+{
+    task->SetEventCounting(viewData.eventCounting);
+
+    viewThreadData.push_back(dynamic_cast<ViewThreadData *>(renderTasks.AppendTask(task)));
+}
+
+void View::AppendRenderTasks(const vector<Task*>& tasks)
+{
+    if (viewData.threadAffinity)
+    {
+        for (size_t i = 0; i < tasks.size(); i++)
+            tasks[i]->SetThreadPlacement((unsigned int)i, (unsigned int)tasks.size());
+    }
+
+    for (Task *task : tasks)
+        task->SetEventCounting(viewData.eventCounting);
+
+    for(ThreadData *td : renderTasks.AppendTasks(tasks))
+        viewThreadData.push_back(dynamic_cast<ViewThreadData *>(td));
 }
 
 void View::SetNextRectangle(TaskQueue&, shared_ptr<ViewData::BlockIdSet> bsl, unsigned int fs)
@@ -1519,6 +2727,114 @@ void View::SetNextRectangle(TaskQueue&, shared_ptr<ViewData::BlockIdSet> bsl, un
     viewData.SetNextRectangle(*bsl, fs);
 }
 
+void View::MergeRadiosityPass(TaskQueue&)
+{
+    viewData.GetRadiosityCache().MergePass();
+}
+
+void View::FlushRadiosityAutosave(TaskQueue&)
+{
+    viewData.GetRadiosityCache().FlushAutosave();
+}
+
+void View::SendReusedBlocks(TaskQueue&, shared_ptr<vector<unsigned int>> blocks)
+{
+    vector<RGBTColour> pixels;
+
+    for (unsigned int serial : *blocks)
+    {
+        POVRect rect;
+        viewData.getBlockRect(serial, rect);
+        viewData.incrementalRender->GetPixels(rect, pixels);
+        viewData.pixelsPending += rect.GetArea();
+        viewData.CompletedRectangle(rect, serial, pixels, 1, true, true);
+    }
+}
+
+void View::SaveIncrementalRender(TaskQueue&)
+{
+    viewData.incrementalRender->Save();
+}
+
+void View::WriteSceneBundle(TaskQueue&)
+{
+    std::shared_ptr<BackendSceneData>& sceneData = viewData.GetSceneData();
+    const UCS2String& bundleFile = sceneData->sceneBundlePrepareFile;
+    std::vector<SceneBundle::SectionFile> sections;
+
+    // files written only for the bundle are deleted once copied, others are left alone
+    if (!sceneData->boundingCacheFile.empty())
+    {
+        UCS2String tempFile = SceneBundle::GetSectionFileName(bundleFile, SceneBundle::kBoundingSection);
+        sections.push_back({ SceneBundle::kBoundingSection, sceneData->boundingCacheFile, sceneData->boundingCacheFile == tempFile });
+    }
+
+    if (sceneData->photonSettings.photonsEnabled && !sceneData->photonSettings.fileName.empty())
+    {
+        UCS2String photonFile = SysToUCS2String(sceneData->photonSettings.fileName);
+        UCS2String tempFile = SceneBundle::GetSectionFileName(bundleFile, SceneBundle::kPhotonSection);
+        sections.push_back({ SceneBundle::kPhotonSection, photonFile, photonFile == tempFile });
+    }
+
+    if (sceneData->radiositySettings.radiosityEnabled)
+    {
+        UCS2String tempFile = SceneBundle::GetSectionFileName(bundleFile, SceneBundle::kRadiositySection);
+        if (viewData.radiosityCache.SaveBinary(Path(tempFile)))
+            sections.push_back({ SceneBundle::kRadiositySection, tempFile, true });
+        else
+            (void)pov_base::Filesystem::DeleteFile(tempFile);
+    }
+
+    if (!SceneBundle::Write(bundleFile, viewData.GetWidth(), viewData.GetHeight(), sections))
+    {
+        // the bundle is the only output of this render, so failing to write it fails the render
+        MessageFactory messageFactory(viewData.GetSceneData()->warningLevel, "Scene Bundle",
+                                      viewData.sceneData->backendAddress, viewData.sceneData->frontendAddress,
+                                      viewData.sceneData->sceneId, viewData.viewId);
+        messageFactory.Error(POV_EXCEPTION(kCannotOpenFileErr, "Cannot write scene bundle"),
+                             "Cannot write scene bundle '%s'.", UCS2toSysString(bundleFile).c_str());
+    }
+}
+
+void View::AppendProgressivePass()
+{
+    vector<Task*> tasks;
+    for(int i = 0; i < progressiveSettings.threads; i++)
+        tasks.push_back(new TraceTask(
+            &viewData, 3, progressiveSettings.jitterScale, progressiveSettings.aaThreshold, progressiveSettings.aaConfidence,
+            progressiveSettings.aaDepth, progressiveSettings.aaGamma, 0, false, true, progressiveSettings.highReproducibility,
+            progressiveSettings.seed, i, progressiveSettings.threads, true
+            ));
+    AppendRenderTasks(tasks);
+
+    // wait for pass to finish
+    renderTasks.AppendSync();
+
+    // decide whether to refine the image further
+    renderTasks.AppendFunction(boost::bind(&View::ContinueProgressiveRender, this, _1));
+}
+
+void View::ContinueProgressiveRender(TaskQueue&)
+{
+    // The first pass must always cover the whole image; after that, stop as soon as the budget is used up
+    // or all pixels are within the anti-aliasing threshold.
+    if (!stopRequsted && !viewData.ProgressiveBudgetExpired() &&
+        (viewData.planProgressivePass(progressiveSettings.aaThreshold, progressiveSettings.aaConfidence, progressiveSettings.aaDepth) > 0))
+    {
+        // Refinement passes visit all blocks, including any rendered by a previous aborted render now being continued;
+        // blocks without pixels to refine are skipped quickly.
+        viewData.SetNextRectangle(ViewData::BlockIdSet(), 0);
+        viewData.progressivePass++;
+        AppendProgressivePass();
+    }
+    else
+    {
+        viewData.progressivePixels.clear();
+        viewData.progressivePixels.shrink_to_fit();
+        AppendRenderCompletion();
+    }
+}
+
 void View::RenderControlThread()
 {
     bool sentFailedResult = false;
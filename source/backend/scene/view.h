@@ -44,14 +44,20 @@
 //  (none at the moment)
 
 // C++ standard header files
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <deque>
 #include <memory>
 #include <mutex>
 #include <thread>
 #include <vector>
 
 // POV-Ray header files (base module)
+#include "base/colour.h"
 #include "base/types.h" // TODO - only appears to be pulled in for POVRect - can we avoid this?
+#include "base/image/colourspace_fwd.h"
+#include "base/image/framebuffer.h"
 
 // POV-Ray header files (core module)
 #include "core/core_fwd.h"
@@ -69,6 +75,11 @@ namespace pov
 
 using namespace pov_base;
 
+class IncrementalRender;
+class EdgeSampleStore;
+class PreviewSampleStore;
+class ProjectionTable;
+
 class RTRData final
 {
     public:
@@ -96,6 +107,22 @@ class RTRData final
         unsigned int numPixelsCompleted;
 };
 
+/// Compute the order in which a generalized Hilbert curve visits the blocks of a grid.
+///
+/// @param[in]  width   Width of the grid, in blocks.
+/// @param[in]  height  Height of the grid, in blocks.
+/// @param[out] order   Position (x + y * width) of each block, in the order visited.
+///
+void GetHilbertBlockOrder(unsigned int width, unsigned int height, std::vector<unsigned int>& order);
+
+/// Compute the order in which a Morton (z-order) curve visits the blocks of a grid.
+///
+/// @param[in]  width   Width of the grid, in blocks.
+/// @param[in]  height  Height of the grid, in blocks.
+/// @param[out] order   Position (x + y * width) of each block, in the order visited.
+///
+void GetMortonBlockOrder(unsigned int width, unsigned int height, std::vector<unsigned int>& order);
+
 /**
  *  ViewData class representing holding view specific data.
  *  For private use by View and Renderer classes only!
@@ -113,6 +140,13 @@ class ViewData final
 
         typedef std::set<unsigned int> BlockIdSet;
 
+        /// Number of values per pixel in the sample statistics sent along with pixel blocks in progressive rendering mode.
+        static constexpr unsigned int kProgressiveStatisticsSize = 13;
+
+        /// Number of values per pixel in the denoising features sent along with pixel blocks:
+        /// albedo (RGB), normal (XYZ) and depth (-1 where no object was hit).
+        static constexpr unsigned int kPixelFeatureSize = 7;
+
         /**
          *  Container for information about a rectangle to be retained between passes.
          *  To be subclasses by trace tasks.
@@ -123,16 +157,43 @@ class ViewData final
                 virtual ~BlockInfo() {}
         };
 
+        /**
+         *  Samples accumulated for a pixel in progressive rendering mode.
+         */
+        struct ProgressivePixel final
+        {
+            RGBTColour sum;                     ///< Sum of the samples.
+            PreciseRGBTColour encodedSum;       ///< Sum of the samples, encoded with the anti-aliasing gamma.
+            PreciseRGBTColour encodedSumSqr;    ///< Sum of the squares of the encoded samples.
+            unsigned int samples;               ///< Number of samples taken.
+            unsigned int pending;               ///< Number of samples to add in the current pass.
+            ProgressivePixel() : samples(0), pending(0) {}
+        };
+
         /**
          *  Get the next sub-rectangle of the view to render (if any).
          *  This method is called by the render threads when they have
          *  completed rendering one block and are ready to start rendering
          *  the next block.
+         *  The blocks are distributed among the render threads up front, each thread getting a contiguous
+         *  run of blocks in render pattern order of roughly equal cost, as measured in earlier passes or
+         *  frames; threads that have run out of blocks steal from the end of the run of whichever thread
+         *  has the most blocks left. Blocks known to be expensive, and towards the end of the pass stolen
+         *  blocks, may be split into smaller pieces, which are reported with @ref kSplitBlockFlag set in
+         *  the serial number.
+         *  Calling this method also marks the end of the caller's previous block for the cost measurements.
          *  @param  rect            Rectangle to render.
          *  @param  serial          Rectangle serial number.
+         *  @param  worker          Index of the calling render thread.
+         *  @param  workerCount     Total number of render threads in this pass.
+         *  @param  splittable      Whether the caller can handle blocks split into smaller pieces.
          *  @return                 True if there is another rectangle to be dispatched, false otherwise.
          */
-        bool GetNextRectangle(POVRect& rect, unsigned int& serial);
+        bool GetNextRectangle(POVRect& rect, unsigned int& serial, unsigned int worker = 0, unsigned int workerCount = 1,
+                              bool splittable = false);
+
+        /// Flag set in the serial number of a piece of a split block.
+        static constexpr unsigned int kSplitBlockFlag = 0x80000000u;
 
         /**
          *  Get the next sub-rectangle of the view to render (if any).
@@ -147,9 +208,14 @@ class ViewData final
          *  @param  stride          Avoid-Busy stride. If this value is non-zero, any blocks following a busy block
          *                          with an offset of a multiple of this value will not be dispatched until the busy block
          *                          has been completed.
+         *  @param  region          Region of the view the calling thread prefers to work on (see `regionCount`).
+         *  @param  regionCount     If this value is non-zero (and `stride` is zero), the blocks are dispatched along a
+         *                          Hilbert curve split into this many contiguous regions, rather than in render pattern
+         *                          order; each thread works through its own region before helping out in others.
          *  @return                 True if there is another rectangle ready to be dispatched, false otherwise.
          */
-        bool GetNextRectangle(POVRect& rect, unsigned int& serial, BlockInfo*& blockInfo, unsigned int stride);
+        bool GetNextRectangle(POVRect& rect, unsigned int& serial, BlockInfo*& blockInfo, unsigned int stride,
+                              unsigned int region = 0, unsigned int regionCount = 0);
 
         /**
          *  Called to (fully or partially) complete rendering of a specific sub-rectangle of the view.
@@ -166,10 +232,13 @@ class ViewData final
          *                          the rectangle will be scheduled to be re-dispatched for another pass, and the
          *                          data passed to whichever rendering thread the rectangle will be re-dispatched to.
          *                          If this value is `nullptr`, the rectangle will not be re-dispatched.
+         *  @param  features        Pointer to denoising features of the pixels (see @ref kPixelFeatureSize), or `nullptr`.
+         *  @param  costs           Pointer to the wall time in seconds spent on each pixel, or `nullptr`.
          */
         void CompletedRectangle(const POVRect& rect, unsigned int serial, const std::vector<RGBTColour>& pixels,
                                 unsigned int size, bool relevant, bool complete, float completion = 1.0,
-                                BlockInfo* blockInfo = nullptr);
+                                BlockInfo* blockInfo = nullptr, std::vector<POVMSFloat>* features = nullptr,
+                                std::vector<POVMSFloat>* costs = nullptr);
 
         /**
          *  Called to (fully or partially) complete rendering of a specific sub-rectangle of the view.
@@ -279,12 +348,114 @@ class ViewData final
          */
         bool GetRealTimeRaytracing() { return realTimeRaytracing; }
 
+        /**
+         *  Get the value of the function profiling option
+         *  @return                 true if the render threads are to profile user-defined functions
+         */
+        bool GetFunctionProfiling() const { return functionProfiling; }
+
+        /**
+         *  Get the value of the object profiling option
+         *  @return                 number of most expensive objects to report, or 0 if objects are not to be profiled
+         */
+        unsigned int GetObjectProfile() const { return objectProfile; }
+
+        /**
+         *  Get the value of the denoising option
+         *  @return                 true if the render threads are to compute auxiliary features guiding the denoising filter
+         */
+        bool GetPixelFeatures() const { return pixelFeatures; }
+
+        /**
+         *  Get the value of the cost map option
+         *  @return                 true if the render threads are to measure the time spent on each pixel
+         */
+        bool GetPixelCosts() const { return pixelCosts; }
+
+        /**
+         *  Get the value of the wavefront shading option
+         *  @return                 true if the render threads are to intersect and shade the primary rays of a block in separate stages
+         */
+        bool GetWavefrontShading() const { return wavefrontShading; }
+
+        /**
+         *  Get the table of primary rays shared by the render threads
+         *  @return                 table, or `nullptr` if the rays are to be computed exactly
+         */
+        std::shared_ptr<ProjectionTable> GetProjectionTable() const { return projectionTable; }
+
+        /**
+         *  Determine whether the number of focal blur samples is to be adapted to the circle of confusion.
+         *  @return                 true if adaptive focal blur is enabled
+         */
+        bool GetAdaptiveFocalBlur() const { return adaptiveFocalBlur; }
+
+        /**
+         *  Get the weight below which secondary rays are subject to Russian roulette
+         *  @return                 threshold, or 0 if disabled
+         */
+        DBL GetRussianRoulette() const { return russianRoulette; }
+
+        /**
+         *  Get the maximum number of secondary rays to trace per primary ray
+         *  @return                 budget, or 0 for no limit
+         */
+        unsigned int GetSecondaryRayBudget() const { return secondaryRayBudget; }
+
+        /**
+         *  Get the samples on block edges shared by the render threads of an anti-aliasing pass
+         *  @return                 store, or `nullptr` if every block traces its edges itself
+         */
+        std::shared_ptr<EdgeSampleStore> GetEdgeSamples() const { return edgeSamples; }
+
+        /**
+         *  Get the samples traced by mosaic preview passes, for the final pass to use again
+         *  @return                 store, or `nullptr` if the final pass traces all pixels itself
+         */
+        std::shared_ptr<PreviewSampleStore> GetPreviewSamples() const { return previewSamples; }
+
         /**
          *  Return a pointer to the real-time raytracing data
          *  @return                 pointer to instance of class RTRData, or `nullptr` if RTR is not enabled
          */
         RTRData *GetRTRData() { return rtrData; }
 
+        /**
+         *  Get the samples accumulated for a pixel in progressive rendering mode.
+         *  @param  x               Column of the pixel; must be within the render area.
+         *  @param  y               Row of the pixel; must be within the render area.
+         *  @return                 Samples accumulated so far.
+         */
+        inline ProgressivePixel& GetProgressivePixel(unsigned int x, unsigned int y)
+        {
+            return progressivePixels[(y - renderArea.top) * renderArea.GetWidth() + (x - renderArea.left)];
+        }
+
+        /**
+         *  Get the current pass in progressive rendering mode.
+         *  @return                 Pass number, 0 for the initial pass sampling each pixel once.
+         */
+        inline unsigned int GetProgressivePass() const { return progressivePass; }
+
+        /**
+         *  Get the number of passes completed by a previous aborted render now being continued.
+         *  @return                 Number of passes to add to @ref GetProgressivePass() to identify the pass uniquely.
+         */
+        inline unsigned int GetProgressivePassOffset() const { return progressivePassOffset; }
+
+        /**
+         *  Determine whether the time budget in progressive rendering mode has been used up.
+         *  @return                 True if no further refinement should be started.
+         */
+        inline bool ProgressiveBudgetExpired() const { return std::chrono::steady_clock::now() >= progressiveDeadline; }
+
+        /**
+         *  Get the record of the previous render for incremental re-rendering.
+         *  @return                 Pointer to the record, or `nullptr` if incremental re-rendering is not enabled.
+         */
+        inline IncrementalRender *GetIncrementalRender() { return incrementalRender.get(); }
+
+
     private:
 
         struct BlockPostponedEntry final
@@ -294,10 +465,43 @@ class ViewData final
             BlockPostponedEntry(unsigned int id, unsigned int p) : blockId(id), pass(p) {}
         };
 
+        /// Block (or piece of a block) waiting to be rendered.
+        struct QueuedBlock final
+        {
+            unsigned int serial;
+            POVRect rect;
+        };
+
+        /// Time spent rendering a block (or piece of a block).
+        struct BlockCost final
+        {
+            POVRect rect;
+            double seconds;
+        };
+
+        /// Dispatching state of one render thread.
+        struct WorkerState final
+        {
+            std::chrono::steady_clock::time_point start;    ///< When the current block was dispatched.
+            POVRect rect;                                   ///< Current block.
+            bool busy;                                      ///< Whether a block is currently dispatched.
+            std::vector<BlockCost> costs;                   ///< Blocks completed in this pass.
+            WorkerState() : busy(false) {}
+        };
+
+        /// Blocks assigned to one render thread.
+        struct BlockQueue final
+        {
+            std::mutex mutex;
+            std::deque<QueuedBlock> blocks;
+            std::atomic<unsigned int> count; ///< Number of blocks, readable without locking.
+            BlockQueue() : count(0) {}
+        };
+
         /// pixels pending
-        volatile unsigned int pixelsPending;
+        std::atomic<unsigned int> pixelsPending;
         /// pixels completed
-        volatile unsigned int pixelsCompleted;
+        std::atomic<unsigned int> pixelsCompleted;
         /// Next block counter for algorithm to distribute parts of the scene to render threads.
         /// @note   Blocks with higher serial numbers may be dispatched out-of-order for certain reasons;
         ///         in that case, the dispatched block must be entered into @ref blockSkipList instead of
@@ -334,6 +538,27 @@ class ViewData final
         BlockIdSet blockPostponedList;
         /// list of additional block information
         std::vector<BlockInfo*> blockInfoList;
+        /// Serial numbers of all blocks in the order of a Hilbert curve, for locality-aware dispatching.
+        std::vector<unsigned int> localityOrder;
+        /// Next position in @ref localityOrder to check, for each region.
+        std::vector<unsigned int> localityNext;
+        /// Whether each block has been dispatched at least once, for locality-aware dispatching.
+        std::vector<bool> localityDispatched;
+        /// Blocks assigned to each render thread, for work-stealing dispatching.
+        std::vector<std::unique_ptr<BlockQueue>> blockQueues;
+        /// Whether @ref blockQueues have been filled for the current pass.
+        std::atomic<bool> blockQueuesReady;
+        /// Total number of blocks in @ref blockQueues.
+        std::atomic<unsigned int> blocksQueued;
+        /// Whether the final pass is anti-aliased, in which case @ref fillBlockQueues does not split blocks.
+        bool antialiasing;
+        /// Number of pieces of each split block yet to be completed, by serial number.
+        std::unique_ptr<std::atomic<unsigned int>[]> blockPieces;
+        /// Dispatching state of each render thread, for work-stealing dispatching.
+        std::vector<WorkerState> workerStates;
+        /// Measured render time per pixel of each block, in seconds, by position in the block grid
+        /// (not by serial number); 0 where not measured yet, or empty if nothing has been measured.
+        std::vector<double> blockCostMap;
         /// area of view to be rendered
         POVRect renderArea;
         /// camera of this view
@@ -350,12 +575,100 @@ class ViewData final
         /// data specifically associated with the RTR feature
         RTRData *rtrData;
 
+        /// true if user-defined functions are to be profiled
+        bool functionProfiling;
+
+        /// number of most expensive objects to report, or 0 if objects are not to be profiled
+        unsigned int objectProfile;
+
+        /// true if render threads are to be pinned to processors, grouped by NUMA node
+        bool threadAffinity;
+
+        /// true if hardware events are to be counted in each render thread
+        bool eventCounting;
+
+        /// true if auxiliary features guiding the frontend's denoising filter are to be computed
+        bool pixelFeatures;
+
+        /// true if the time spent on each pixel is to be measured for the frontend's cost map
+        bool pixelCosts;
+
+        /// true if the primary rays of a block are to be intersected and shaded in separate stages, sorted by material
+        bool wavefrontShading;
+
+        /// table of primary rays for map projection cameras, or `nullptr` if not enabled
+        std::shared_ptr<ProjectionTable> projectionTable;
+
+        /// true if the number of focal blur samples per pixel is to be estimated from the circle of confusion
+        bool adaptiveFocalBlur;
+
+        /// weight below which secondary rays are terminated at random in proportion to their weight, or 0 if disabled
+        DBL russianRoulette;
+
+        /// maximum number of secondary rays per primary ray, or 0 for no limit
+        unsigned int secondaryRayBudget;
+
+        /// samples on block edges shared between adjacent blocks in anti-aliasing passes, or `nullptr` if not enabled
+        std::shared_ptr<EdgeSampleStore> edgeSamples;
+
+        /// samples traced by mosaic preview passes at pixel centres, or `nullptr` if not enabled
+        std::shared_ptr<PreviewSampleStore> previewSamples;
+
+        /// samples accumulated per pixel of the render area in progressive rendering mode (empty otherwise)
+        std::vector<ProgressivePixel> progressivePixels;
+        /// end of the time budget in progressive rendering mode
+        std::chrono::steady_clock::time_point progressiveDeadline;
+        /// current pass in progressive rendering mode
+        unsigned int progressivePass;
+        /// passes completed by a previous aborted render now being continued, in progressive rendering mode
+        unsigned int progressivePassOffset;
+
+        /// record of the previous render, for incremental re-rendering (`nullptr` if disabled)
+        std::unique_ptr<IncrementalRender> incrementalRender;
+
+        /// framebuffer shared with the frontend to store final pixels in, or `nullptr` if pixels are to be sent
+        std::shared_ptr<SharedFramebuffer> sharedFramebuffer;
+
         /// functions to compute the X & Y block
         void getBlockXY(const unsigned int nb, unsigned int &x, unsigned int &y);
 
+        /// function to precompute the block order for render patterns not computed on the fly
+        void buildBlockPatternOrder();
+
+        /// function to pick the next block for locality-aware dispatching
+        bool getNextLocalityBlock(unsigned int region, unsigned int regionCount, unsigned int& serial);
+
+        /// function to compute the rectangle covered by a block
+        void getBlockRect(unsigned int serial, POVRect& rect);
+
+        /// function to compute the index of a block in @ref blockCostMap
+        unsigned int getBlockCell(const POVRect& rect) const;
+
+        /// function to merge the block render times measured in the last pass into @ref blockCostMap
+        void updateBlockCostMap();
+
+        /// function to distribute the blocks among the render threads for work-stealing dispatching;
+        /// expensive blocks are split up front only if `splittable` is set and @ref antialiasing is not
+        void fillBlockQueues(unsigned int workerCount, bool splittable);
+
+        /// function to account for a completed block or piece; returns whether the whole block is now done
+        bool completedPiece(unsigned int serial);
+
+        /// function to restore the samples accumulated by a previous aborted render now being continued
+        void loadProgressiveStatistics(POVMS_List& stats);
+
+        /// function to choose the pixels to refine in the next progressive pass; returns the number of pixels chosen
+        unsigned int planProgressivePass(DBL threshold, DBL confidence, unsigned int depth);
+
+        /// function to steal a block from the render thread with the most blocks left
+        bool stealBlock(unsigned int worker, bool splittable, QueuedBlock& block);
+
         /// pattern number to use for rendering
         unsigned int renderPattern;
 
+        /// block positions (x + y * blockWidth) in order, for render patterns not computed on the fly
+        std::vector<unsigned int> blockPatternOrder;
+
         /// adjusted step size for renderering (using clock arithmetic)
         unsigned int renderBlockStep;
 
@@ -463,8 +776,21 @@ class View final
         bool stopRequsted;
         /// render control thread
         std::thread *renderControlThread;
-        /// BSP tree mailbox
-        BSPTree::Mailbox mailbox;
+
+        /// Trace settings shared by all passes in progressive rendering mode.
+        struct ProgressiveSettings final
+        {
+            DBL jitterScale;
+            DBL aaThreshold;
+            DBL aaConfidence;
+            unsigned int aaDepth;
+            GammaCurvePtr aaGamma;
+            bool highReproducibility;
+            size_t seed;
+            int threads;
+        };
+        /// trace settings in progressive rendering mode
+        ProgressiveSettings progressiveSettings;
 
         View() = delete;
         View(const View&) = delete;
@@ -493,6 +819,18 @@ class View final
          */
         void SendStatistics(TaskQueue& taskq);
 
+        /**
+         *  Append a single render task to the task queue.
+         *  @param  task            Task to append; ownership passes to the task queue.
+         */
+        void AppendRenderTask(Task* task);
+
+        /**
+         *  Append a batch of render tasks to the task queue, to be started together.
+         *  @param  tasks           Tasks to append; ownership passes to the task queue.
+         */
+        void AppendRenderTasks(const std::vector<Task*>& tasks);
+
         /**
          *  Set the blocks not to generate with GetNextRectangle because they have
          *  already been rendered.
@@ -502,6 +840,58 @@ class View final
          */
         void SetNextRectangle(TaskQueue& taskq, std::shared_ptr<ViewData::BlockIdSet> bsl, unsigned int fs);
 
+        /**
+         *  Merge the radiosity samples of a completed pretrace step into the cache
+         *  (see @ref RadiosityCache::MergePass()).
+         *  @param  taskq           The task queue that executed this method.
+         */
+        void MergeRadiosityPass(TaskQueue& taskq);
+
+        /**
+         *  Write the radiosity samples of a completed pass to the autosave file
+         *  (see @ref RadiosityCache::FlushAutosave()).
+         *  @param  taskq           The task queue that executed this method.
+         */
+        void FlushRadiosityAutosave(TaskQueue& taskq);
+
+        /**
+         *  Send the blocks taken over from the previous render in incremental re-rendering mode.
+         *  @param  taskq           The task queue that executed this method.
+         *  @param  blocks          Serial numbers of the blocks to send.
+         */
+        void SendReusedBlocks(TaskQueue& taskq, std::shared_ptr<std::vector<unsigned int>> blocks);
+
+        /**
+         *  Write the record of the render for incremental re-rendering.
+         *  @param  taskq           The task queue that executed this method.
+         */
+        void SaveIncrementalRender(TaskQueue& taskq);
+
+        /**
+         *  Write the scene bundle being prepared, from the bounding cache, photon map and radiosity data
+         *  computed so far.
+         *  @param  taskq           The task queue that executed this method.
+         */
+        void WriteSceneBundle(TaskQueue& taskq);
+
+        /**
+         *  Append the tasks of the current pass in progressive rendering mode, followed by
+         *  a call to @ref ContinueProgressiveRender() once they have finished.
+         */
+        void AppendProgressivePass();
+
+        /**
+         *  Start another pass in progressive rendering mode, unless the time budget has been
+         *  used up or no pixel needs further refinement; finish the render otherwise.
+         *  @param  taskq           The task queue that executed this method.
+         */
+        void ContinueProgressiveRender(TaskQueue& taskq);
+
+        /**
+         *  Append the tasks concluding a render once all passes have been appended.
+         */
+        void AppendRenderCompletion();
+
         /**
          *  Thread controlling the render task queue.
          */
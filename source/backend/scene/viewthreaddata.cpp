@@ -40,6 +40,7 @@
 //  (none at the moment)
 
 // C++ standard header files
+#include <algorithm>
 #include <limits>
 #include <memory>
 
@@ -62,6 +63,17 @@ ViewThreadData::ViewThreadData(ViewData *vd, size_t seed) :
     TraceThreadData(std::dynamic_pointer_cast<SceneData>(vd->GetSceneData()), seed),
     viewData(vd)
 {
+    functionProfiling = vd->GetFunctionProfiling();
+    objectProfiling = (vd->GetObjectProfile() > 0);
+
+    // Approximate the footprint of a pixel by that of a perspective or orthographic camera;
+    // this only serves to choose the level of detail of image maps.
+    const Camera& camera = vd->GetCamera();
+    DBL pixelRadius = 0.5 * camera.Right.length() / std::max(1u, vd->GetWidth());
+    if (camera.Type == ORTHOGRAPHIC_CAMERA)
+        pixelFootprintBase = pixelRadius;
+    else if (camera.Direction.length() > 0.0)
+        pixelFootprintSlope = pixelRadius / camera.Direction.length();
 }
 
 ViewThreadData::~ViewThreadData()
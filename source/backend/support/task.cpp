@@ -40,7 +40,9 @@
 //  (none at the moment)
 
 // C++ standard header files
+#include <memory>
 #include <stdexcept>
+#include <thread>
 
 // Boost header files
 #include <boost/bind.hpp>
@@ -52,11 +54,13 @@
 
 // POV-Ray header files (core module)
 // POV-Ray header files (POVMS module)
-//  (none at the moment)
+#include "povms/povmscpp.h"
+#include "povms/povmsid.h"
 
 // POV-Ray header files (backend module)
 #include "backend/control/messagefactory.h"
 #include "backend/scene/backendscenedata.h"
+#include "backend/support/taskthreadpool.h"
 
 // this must be the last file included
 #include "base/povdebug.h"
@@ -76,8 +80,13 @@ Task::Task(ThreadData *td, const boost::function1<void, Exception&>& f) :
     timer(nullptr),
     realTime(-1),
     cpuTime(-1),
-    taskThread(nullptr),
-    povmsContext(nullptr)
+    countEvents(false),
+    timelineName("Task"),
+    started(false),
+    running(false),
+    povmsContext(nullptr),
+    placementIndex(-1),
+    placementCount(0)
 {
     if (td == nullptr)
         throw POV_EXCEPTION_STRING("Internal error: TaskData is NULL in Task constructor");
@@ -109,10 +118,31 @@ POV_LONG Task::ConsumedCPUTime() const
     return cpuTime;
 }
 
+PerformanceCounts Task::ConsumedEvents() const
+{
+    return eventCounts;
+}
+
 void Task::Start(const boost::function0<void>& completion)
 {
-    if ((done == false) && (taskThread == nullptr))
-        taskThread = new std::thread(boost::bind(&Task::TaskThread, this, completion));
+    if ((done == false) && (started == false))
+    {
+        started = true;
+        running = true;
+        TaskThreadPool::GetInstance().Submit([this, completion]()
+        {
+            TaskThread(completion);
+            std::lock_guard<std::mutex> lock(runningMutex);
+            running = false;
+            runningCondition.notify_all();
+        });
+    }
+}
+
+void Task::SetThreadPlacement(unsigned int index, unsigned int count)
+{
+    placementIndex = int(index);
+    placementCount = count;
 }
 
 void Task::RequestStop()
@@ -124,12 +154,9 @@ void Task::Stop()
 {
     stopRequested = true;
 
-    if (taskThread != nullptr)
-    {
-        taskThread->join();
-        delete taskThread;
-        taskThread = nullptr;
-    }
+    std::unique_lock<std::mutex> lock(runningMutex);
+    while (running)
+        runningCondition.wait(lock);
 }
 
 void Task::Pause()
@@ -185,8 +212,15 @@ void Task::TaskThread(const boost::function0<void>& completion)
     Initialize();
 
     Timer tasktime;
+    std::unique_ptr<PerformanceCounters> taskevents;
 
     timer = &tasktime;
+    if (countEvents)
+        taskevents.reset(new PerformanceCounters());
+
+    TaskTimeline::Clock::time_point timelineStart;
+    if (timeline != nullptr)
+        timelineStart = TaskTimeline::Clock::now();
 
     try
     {
@@ -247,6 +281,12 @@ void Task::TaskThread(const boost::function0<void>& completion)
         cpuTime = tasktime.ElapsedThreadCPUTime();
     else
         cpuTime = -1;
+    if (taskevents != nullptr)
+        eventCounts = taskevents->Elapsed();
+    else
+        eventCounts = PerformanceCounts();
+    if (timeline != nullptr)
+        timeline->Span(timelineName, "task", timelineStart);
 
     try
     {
@@ -295,10 +335,24 @@ void Task::Cleanup ()
 #endif // POV_USE_DEFAULT_TASK_CLEANUP
 
 
+void SetEventCounts(POVMS_Object& obj, const PerformanceCounts& counts)
+{
+    if (counts.count[PerformanceCounts::kCycles] >= 0)
+        obj.SetLong(kPOVAttrib_Cycles, counts.count[PerformanceCounts::kCycles]);
+    if (counts.count[PerformanceCounts::kInstructions] >= 0)
+        obj.SetLong(kPOVAttrib_Instructions, counts.count[PerformanceCounts::kInstructions]);
+    if (counts.count[PerformanceCounts::kCacheMisses] >= 0)
+        obj.SetLong(kPOVAttrib_CacheMisses, counts.count[PerformanceCounts::kCacheMisses]);
+    if (counts.count[PerformanceCounts::kBranchMisses] >= 0)
+        obj.SetLong(kPOVAttrib_BranchMisses, counts.count[PerformanceCounts::kBranchMisses]);
+}
+
 SceneTask::SceneTask(ThreadData *td, const boost::function1<void, Exception&>& f, const char* sn, std::shared_ptr<BackendSceneData> sd, RenderBackend::ViewId vid) :
     Task(td, f),
     mpMessageFactory(new MessageFactory(sd->warningLevel, sn, sd->backendAddress, sd->frontendAddress, sd->sceneId, vid))
-{}
+{
+    SetTimeline(sd->timeline, sn);
+}
 
 SceneTask::~SceneTask()
 {
@@ -43,9 +43,10 @@
 //  (none at the moment)
 
 // C++ standard header files
+#include <condition_variable>
 #include <memory>
+#include <mutex>
 #include <queue>
-#include <thread>
 
 // Boost header files
 #include <boost/function.hpp>
@@ -58,6 +59,7 @@
 #include "backend/control/messagefactory_fwd.h"
 #include "backend/control/renderbackend.h"
 #include "backend/scene/backendscenedata_fwd.h"
+#include "backend/support/tasktimeline.h"
 
 namespace pov
 {
@@ -72,7 +74,7 @@ class Task
         virtual ~Task();
 
         inline bool IsPaused() { return !done && paused; }
-        inline bool IsRunning() { return !done && !paused && !stopRequested && (taskThread != nullptr); }
+        inline bool IsRunning() { return !done && !paused && !stopRequested && started; }
         inline bool IsDone() { return done; }
         inline bool Failed() { return done && (failed != kNoError); }
 
@@ -81,6 +83,10 @@ class Task
         POV_LONG ConsumedRealTime() const;
         POV_LONG ConsumedCPUTime() const;
 
+        /// Get the hardware events counted while the task was running.
+        /// @return     Event counts, with events that were not counted reported as -1.
+        PerformanceCounts ConsumedEvents() const;
+
         void Start(const boost::function0<void>& completion);
         void RequestStop();
         void Stop();
@@ -90,6 +96,32 @@ class Task
 
         inline ThreadData *GetDataPtr() { return taskData; }
 
+        /// Request the task to be run on a processor chosen by its position within a group of tasks.
+        ///
+        /// Platforms supporting thread placement (see @ref Initialize()) distribute the tasks of a group evenly
+        /// among the NUMA nodes, with consecutive tasks on the same node, and pin each to a processor.
+        ///
+        /// @param[in]  index   Position of the task within the group.
+        /// @param[in]  count   Number of tasks in the group.
+        ///
+        void SetThreadPlacement(unsigned int index, unsigned int count);
+
+        /// Request hardware events, such as CPU cycles and cache misses, to be counted while the task is running.
+        ///
+        /// Counting events requires a few system calls at the start and end of the task, and is therefore off by default.
+        ///
+        void SetEventCounting(bool enable) { countEvents = enable; }
+
+        /// Record the time the task is running on a timeline.
+        ///
+        /// @param[in]  tl      Timeline to record on, or `nullptr` to not record the task.
+        /// @param[in]  name    Name of the task on the timeline; must remain valid for the lifetime of the timeline.
+        ///
+        void SetTimeline(const std::shared_ptr<TaskTimeline>& tl, const char *name) { timeline = tl; timelineName = name; }
+
+        /// Change the name of the task on the timeline, to tell apart tasks that share a common name.
+        void SetTimelineName(const char *name) { timelineName = name; }
+
         inline POVMSContext GetPOVMSContext() { return povmsContext; }
 
     protected:
@@ -123,10 +155,28 @@ class Task
         POV_LONG realTime;
         // CPU time spend in task
         POV_LONG cpuTime;
-        /// task thread
-        std::thread *taskThread;
+        /// whether hardware events are to be counted
+        bool countEvents;
+        /// hardware events counted while the task was running
+        PerformanceCounts eventCounts;
+        /// timeline to record the task on, or `nullptr`
+        std::shared_ptr<TaskTimeline> timeline;
+        /// name of the task on the timeline
+        const char *timelineName;
+        /// whether the task has been handed to the @ref TaskThreadPool
+        bool started;
+        /// whether the task is still running on a pool thread
+        bool running;
+        /// mutex guarding @ref running
+        std::mutex runningMutex;
+        /// condition signalled when the task has stopped running on a pool thread
+        std::condition_variable runningCondition;
         /// POVMS message receiving context
         POVMSContext povmsContext;
+        /// position of the task within its group for thread placement, or -1 for no particular placement
+        int placementIndex;
+        /// number of tasks in the group for thread placement
+        unsigned int placementCount;
 
         inline void FatalErrorHandler(const Exception& e)
         {
@@ -140,7 +190,7 @@ class Task
         Task(const Task&) = delete;
         Task& operator=(const Task&) = delete;
 
-        /// Execute the thread.
+        /// Execute the task on a thread of the @ref TaskThreadPool.
         void TaskThread(const boost::function0<void>& completion);
 
         /// Called by @ref TaskThread() before Run() is invoked.
@@ -149,6 +199,9 @@ class Task
         /// task at thread startup. To make use of this mechanism, set @ref POV_USE_DEFAULT_TASK_INITIALIZE to zero to
         /// knock out the default implementation and provide a platform-specific implementation somewhere else.
         ///
+        /// Implementations should also honor any placement requested via @ref SetThreadPlacement(); since threads are
+        /// re-used for subsequent tasks, any placement must be undone again in @ref Cleanup().
+        ///
         void Initialize();
 
         /// Called by @ref TaskThread() after Run() returns.
@@ -161,6 +214,10 @@ class Task
 };
 
 
+/// Store hardware event counts in a POVMS object, as far as the events have been counted.
+void SetEventCounts(POVMS_Object& obj, const PerformanceCounts& counts);
+
+
 class SceneTask : public Task
 {
     public:
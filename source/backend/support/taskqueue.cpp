@@ -59,7 +59,10 @@ namespace pov
 using std::list;
 using std::shared_ptr;
 
-TaskQueue::TaskQueue() : failed(kNoError)
+TaskQueue::TaskQueue() :
+    failed(kNoError),
+    notifications(0),
+    stats{ 0, 0, 0, 0 }
 {
 }
 
@@ -172,6 +175,26 @@ ThreadData *TaskQueue::AppendTask(Task *task)
     return task->GetDataPtr();
 }
 
+std::vector<ThreadData*> TaskQueue::AppendTasks(const std::vector<Task*>& tasks)
+{
+    std::vector<ThreadData*> threadData;
+    threadData.reserve(tasks.size());
+
+    std::lock_guard<std::recursive_mutex> lock(queueMutex);
+
+    failed = false;
+
+    for (auto task : tasks)
+    {
+        queuedTasks.push(TaskEntry(shared_ptr<Task>(task)));
+        threadData.push_back(task->GetDataPtr());
+    }
+
+    Notify();
+
+    return threadData;
+}
+
 void TaskQueue::AppendSync()
 {
     std::lock_guard<std::recursive_mutex> lock(queueMutex);
@@ -201,72 +224,137 @@ void TaskQueue::AppendFunction(const boost::function1<void, TaskQueue&>& fn)
 
 bool TaskQueue::Process()
 {
-    std::unique_lock<std::recursive_mutex> lock(queueMutex);
+    // Take note of the notifications so far before looking at anything, so that we can't miss any
+    // notification while we're busy.
+    POV_ULONG seen = GetNotificationCount();
+    bool blocked = false;
 
-    for(list<TaskEntry>::iterator i(activeTasks.begin()); i != activeTasks.end();)
     {
-        if(failed == kNoError)
-            failed = i->GetTask()->FailureCode();
+        std::lock_guard<std::recursive_mutex> lock(queueMutex);
 
-        if(i->GetTask()->IsDone() == true)
+        for(list<TaskEntry>::iterator i(activeTasks.begin()); i != activeTasks.end();)
         {
-            list<TaskEntry>::iterator e(i);
-            i++;
-            activeTasks.erase(e);
+            if(failed == kNoError)
+                failed = i->GetTask()->FailureCode();
+
+            if(i->GetTask()->IsDone() == true)
+            {
+                list<TaskEntry>::iterator e(i);
+                i++;
+                activeTasks.erase(e);
+            }
+            else
+                i++;
         }
-        else
-            i++;
-    }
 
-    if(failed != kNoError)
-    {
-        Stop();
-        return false;
-    }
+        if(failed != kNoError)
+        {
+            Stop();
+            return false;
+        }
 
-    if(queuedTasks.empty() == false)
-    {
-        switch(queuedTasks.front().GetEntryType())
+        // process as many entries as we can right away
+        while((queuedTasks.empty() == false) && (blocked == false))
         {
-            case TaskEntry::kTask:
-            {
-                activeTasks.push_back(queuedTasks.front());
-                queuedTasks.front().GetTask()->Start(boost::bind(&TaskQueue::Notify, this));
-                queuedTasks.pop();
-                break;
-            }
-            case TaskEntry::kSync:
+            switch(queuedTasks.front().GetEntryType())
             {
-                if(activeTasks.empty() == true)
+                case TaskEntry::kTask:
+                {
+                    stats.tasksStarted++;
+                    stats.queueLatency += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - queuedTasks.front().GetQueuedTime()).count();
+                    activeTasks.push_back(queuedTasks.front());
+                    queuedTasks.front().GetTask()->Start(boost::bind(&TaskQueue::Notify, this));
                     queuedTasks.pop();
-                else
-                    return false;
-                break;
-            }
-            case TaskEntry::kMessage:
-            {
-                try { POVMS_SendMessage(queuedTasks.front().GetMessage()); } catch(pov_base::Exception&) { }
-                queuedTasks.pop();
-                break;
-            }
-            case TaskEntry::kFunction:
-            {
-                try { queuedTasks.front().GetFunction()(*this); } catch(pov_base::Exception&) { }
-                queuedTasks.pop();
-                break;
+                    break;
+                }
+                case TaskEntry::kSync:
+                {
+                    if(activeTasks.empty() == true)
+                        queuedTasks.pop();
+                    else
+                        blocked = true;
+                    break;
+                }
+                case TaskEntry::kMessage:
+                {
+                    try { POVMS_SendMessage(queuedTasks.front().GetMessage()); } catch(pov_base::Exception&) { }
+                    queuedTasks.pop();
+                    break;
+                }
+                case TaskEntry::kFunction:
+                {
+                    TaskTimelineScope span(timeline.get(), "Function", "queue");
+                    try { queuedTasks.front().GetFunction()(*this); } catch(pov_base::Exception& e) { failed = e.code(kUncategorizedError); }
+                    queuedTasks.pop();
+                    if(failed != kNoError)
+                    {
+                        Stop();
+                        return false;
+                    }
+                    break;
+                }
             }
         }
     }
 
-    if(queuedTasks.empty() == true)
-        processCondition.wait(lock);
+    // Wait for a task to finish (if blocked at a sync point) or for new entries (if the queue is empty).
+    if(blocked == true)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        WaitForNotification(seen);
+        if (timeline != nullptr)
+            timeline->Span("Sync wait", "queue", start);
+
+        std::lock_guard<std::recursive_mutex> lock(queueMutex);
+        stats.syncWaits++;
+        stats.syncWaitTime += std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        return true;
+    }
+
+    WaitForNotification(seen);
 
+    std::lock_guard<std::recursive_mutex> lock(queueMutex);
     return (queuedTasks.empty() == false);
 }
 
 void TaskQueue::Notify()
 {
-    processCondition.notify_one();
+    {
+        std::lock_guard<std::mutex> lock(notifyMutex);
+        notifications++;
+    }
+    processCondition.notify_all();
+}
+
+void TaskQueue::SetTimeline(const std::shared_ptr<TaskTimeline>& tl)
+{
+    std::lock_guard<std::recursive_mutex> lock(queueMutex);
+
+    timeline = tl;
+}
+
+TaskQueue::Statistics TaskQueue::GetStatistics()
+{
+    std::lock_guard<std::recursive_mutex> lock(queueMutex);
+
+    return stats;
+}
+
+POV_ULONG TaskQueue::GetNotificationCount()
+{
+    std::lock_guard<std::mutex> lock(notifyMutex);
+
+    return notifications;
+}
+
+void TaskQueue::WaitForNotification(POV_ULONG seen)
+{
+    std::unique_lock<std::mutex> lock(notifyMutex);
+
+    while(notifications == seen)
+        processCondition.wait(lock);
 }
 
 }
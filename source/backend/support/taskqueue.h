@@ -43,11 +43,13 @@
 //  (none at the moment)
 
 // C++ standard header files
+#include <chrono>
 #include <condition_variable>
 #include <list>
 #include <memory>
 #include <mutex>
 #include <queue>
+#include <vector>
 
 // Boost header files
 #include <boost/function.hpp>
@@ -77,15 +79,16 @@ class TaskQueue final
                     kFunction,
                 };
 
-                TaskEntry(EntryType et) : entryType(et) { }
-                TaskEntry(std::shared_ptr<Task> rt) : entryType(kTask), task(rt) { }
-                TaskEntry(POVMS_Message& m) : entryType(kMessage), msg(m) { }
-                TaskEntry(const boost::function1<void, TaskQueue&>& f) : entryType(kFunction), fn(f) { }
+                TaskEntry(EntryType et) : entryType(et), queued(std::chrono::steady_clock::now()) { }
+                TaskEntry(std::shared_ptr<Task> rt) : entryType(kTask), task(rt), queued(std::chrono::steady_clock::now()) { }
+                TaskEntry(POVMS_Message& m) : entryType(kMessage), msg(m), queued(std::chrono::steady_clock::now()) { }
+                TaskEntry(const boost::function1<void, TaskQueue&>& f) : entryType(kFunction), fn(f), queued(std::chrono::steady_clock::now()) { }
                 ~TaskEntry() { }
 
                 std::shared_ptr<Task> GetTask() { return task; }
                 POVMS_Message& GetMessage() { return msg; }
                 boost::function1<void, TaskQueue&>& GetFunction() { return fn; }
+                std::chrono::steady_clock::time_point GetQueuedTime() { return queued; }
 
                 EntryType GetEntryType() { return entryType; }
             private:
@@ -93,8 +96,19 @@ class TaskQueue final
                 std::shared_ptr<Task> task;
                 POVMS_Message msg;
                 boost::function1<void, TaskQueue&> fn;
+                std::chrono::steady_clock::time_point queued;
         };
     public:
+
+        /// Queue performance figures.
+        struct Statistics final
+        {
+            POV_LONG tasksStarted;  ///< Number of tasks started.
+            POV_LONG queueLatency;  ///< Total time tasks spent in the queue before being started, in nanoseconds.
+            POV_LONG syncWaits;     ///< Number of times processing had to wait for tasks to finish at a sync point.
+            POV_LONG syncWaitTime;  ///< Total time spent waiting at sync points, in nanoseconds.
+        };
+
         TaskQueue();
         ~TaskQueue();
 
@@ -110,6 +124,8 @@ class TaskQueue final
         int FailureCode(int defval = kNoError);
 
         ThreadData *AppendTask(Task *task);
+        /// Append multiple tasks at once, so that they are started together.
+        std::vector<ThreadData*> AppendTasks(const std::vector<Task*>& tasks);
         void AppendSync();
         void AppendMessage(POVMS_Message& msg);
         void AppendFunction(const boost::function1<void, TaskQueue&>& fn);
@@ -117,6 +133,12 @@ class TaskQueue final
         bool Process();
 
         void Notify();
+
+        Statistics GetStatistics();
+
+        /// Record the functions run and the waits at sync points on a timeline.
+        /// @param  tl              Timeline to record on, or `nullptr` to not record anything.
+        void SetTimeline(const std::shared_ptr<TaskTimeline>& tl);
     private:
         /// queued task list
         std::queue<TaskEntry> queuedTasks;
@@ -126,8 +148,23 @@ class TaskQueue final
         std::recursive_mutex queueMutex;
         /// failed code
         int failed;
+        /// mutex guarding @ref notifications
+        /// @note   This is deliberately separate from @ref queueMutex, as tasks notify the queue upon completion,
+        ///         which may happen while @ref Stop() holds @ref queueMutex and waits for them.
+        std::mutex notifyMutex;
+        /// number of notifications so far
+        POV_ULONG notifications;
         /// wait for data in queue or related operation to be processed
-        std::condition_variable_any processCondition;
+        std::condition_variable processCondition;
+        /// performance figures
+        Statistics stats;
+        /// timeline to record on, or `nullptr`
+        std::shared_ptr<TaskTimeline> timeline;
+
+        /// Get the number of notifications so far.
+        POV_ULONG GetNotificationCount();
+        /// Wait for a notification after the specified number of notifications.
+        void WaitForNotification(POV_ULONG seen);
 
         TaskQueue(const TaskQueue&) = delete;
         TaskQueue& operator=(const TaskQueue&) = delete;
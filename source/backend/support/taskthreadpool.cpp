@@ -0,0 +1,124 @@
+//******************************************************************************
+///
+/// @file backend/support/taskthreadpool.cpp
+///
+/// Implementation of the pool of threads running backend tasks.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+
+// Unit header file must be the first file included within POV-Ray *.cpp files (pulls in config)
+#include "backend/support/taskthreadpool.h"
+
+// C++ variants of C standard header files
+//  (none at the moment)
+
+// C++ standard header files
+#include <utility>
+
+// POV-Ray header files (base module)
+//  (none at the moment)
+
+// POV-Ray header files (backend module)
+//  (none at the moment)
+
+// this must be the last file included
+#include "base/povdebug.h"
+
+namespace pov
+{
+
+TaskThreadPool& TaskThreadPool::GetInstance()
+{
+    static TaskThreadPool pool;
+    return pool;
+}
+
+TaskThreadPool::TaskThreadPool() :
+    mIdleThreads(0),
+    mShutdown(false)
+{}
+
+TaskThreadPool::~TaskThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mShutdown = true;
+    }
+    mCondition.notify_all();
+
+    for (auto& thread : maThreads)
+        thread.join();
+}
+
+void TaskThreadPool::Submit(Job&& job)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mJobs.push_back(std::move(job));
+    // Idle threads that have been notified but not woken up yet are still counted as idle,
+    // so that they are not promised more than one job each.
+    if (mIdleThreads >= mJobs.size())
+        mCondition.notify_one();
+    else
+        maThreads.emplace_back(&TaskThreadPool::WorkerThread, this);
+}
+
+std::size_t TaskThreadPool::GetThreadCount()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return maThreads.size();
+}
+
+void TaskThreadPool::WorkerThread()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    for (;;)
+    {
+        while (mJobs.empty() && !mShutdown)
+        {
+            ++mIdleThreads;
+            mCondition.wait(lock);
+            --mIdleThreads;
+        }
+        if (mJobs.empty())
+            return;
+
+        Job job(std::move(mJobs.front()));
+        mJobs.pop_front();
+
+        lock.unlock();
+        job();
+        job = nullptr;
+        lock.lock();
+    }
+}
+
+}
+// end of namespace pov
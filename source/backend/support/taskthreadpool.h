@@ -0,0 +1,111 @@
+//******************************************************************************
+///
+/// @file backend/support/taskthreadpool.h
+///
+/// Declarations for the pool of threads running backend tasks.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+
+#ifndef POVRAY_BACKEND_TASKTHREADPOOL_H
+#define POVRAY_BACKEND_TASKTHREADPOOL_H
+
+// Module config header file must be the first file included within POV-Ray unit header files
+#include "backend/configbackend.h"
+
+// C++ variants of C standard header files
+#include <cstddef>
+
+// C++ standard header files
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// POV-Ray header files (base module)
+//  (none at the moment)
+
+// POV-Ray header files (backend module)
+//  (none at the moment)
+
+namespace pov
+{
+
+/// Pool of long-lived threads running backend tasks.
+///
+/// Rather than each @ref Task spawning and tearing down a thread of its own, tasks are handed to
+/// this pool, which keeps finished threads around for subsequent tasks (e.g. those of the next
+/// frame of an animation). This saves the cost of thread creation, and allows thread-local
+/// scratch data to be recycled.
+///
+/// @note
+///     Since tasks may wait for one another, every job submitted is guaranteed a thread of its own
+///     right away: If no idle thread is available, a new one is created. The number of threads is
+///     thus bounded only by the number of tasks running concurrently.
+///
+class TaskThreadPool final
+{
+public:
+
+    typedef std::function<void()> Job;
+
+    /// Get the pool shared by all tasks of the backend.
+    static TaskThreadPool& GetInstance();
+
+    TaskThreadPool();
+    ~TaskThreadPool();
+
+    TaskThreadPool(const TaskThreadPool&) = delete;
+    TaskThreadPool& operator=(const TaskThreadPool&) = delete;
+
+    /// Run a job on an idle thread, or on a new thread if none is idle.
+    void Submit(Job&& job);
+
+    /// Get the number of threads currently in the pool.
+    std::size_t GetThreadCount();
+
+private:
+
+    std::mutex                  mMutex;
+    std::condition_variable     mCondition;
+    std::deque<Job>             mJobs;          ///< Jobs not picked up by a thread yet.
+    std::vector<std::thread>    maThreads;
+    std::size_t                 mIdleThreads;   ///< Threads waiting for a job.
+    bool                        mShutdown;
+
+    void WorkerThread();
+};
+
+}
+// end of namespace pov
+
+#endif // POVRAY_BACKEND_TASKTHREADPOOL_H
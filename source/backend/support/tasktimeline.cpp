@@ -0,0 +1,132 @@
+//******************************************************************************
+///
+/// @file backend/support/tasktimeline.cpp
+///
+/// Implementations related to recording the backend's task activity over time.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+// Unit header file must be the first file included within POV-Ray *.cpp files (pulls in config)
+#include "backend/support/tasktimeline.h"
+
+// C++ variants of C standard header files
+//  (none at the moment)
+
+// C++ standard header files
+#include <memory>
+
+// POV-Ray header files (base module)
+#include "base/fileinputoutput.h"
+#include "base/path.h"
+
+// this must be the last file included
+#include "base/povdebug.h"
+
+namespace pov
+{
+
+/// Start of the render block the current thread is working on.
+static thread_local TaskTimeline::Clock::time_point gBlockStart;
+
+TaskTimeline::TaskTimeline(const UCS2String& fn) :
+    filename(fn),
+    origin(Clock::now())
+{
+    events.reserve(4096);
+}
+
+void TaskTimeline::Span(const char *name, const char *category, Clock::time_point start, int serial)
+{
+    Record(name, category, start, std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count(), serial);
+}
+
+void TaskTimeline::Instant(const char *name, const char *category)
+{
+    Record(name, category, Clock::now(), -1, -1);
+}
+
+void TaskTimeline::BeginBlock()
+{
+    gBlockStart = Clock::now();
+}
+
+void TaskTimeline::EndBlock(unsigned int serial)
+{
+    Span("Block", "block", gBlockStart, int(serial));
+}
+
+void TaskTimeline::Record(const char *name, const char *category, Clock::time_point start, POV_LONG duration, int serial)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto thread = threads.insert(std::make_pair(std::this_thread::get_id(), int(threads.size()))).first;
+
+    Event event;
+    event.name     = name;
+    event.category = category;
+    event.start    = std::chrono::duration_cast<std::chrono::nanoseconds>(start - origin).count();
+    event.duration = duration;
+    event.thread   = thread->second;
+    event.serial   = serial;
+    events.push_back(event);
+}
+
+void TaskTimeline::Write()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // failing to write the timeline is not an error, as it does not affect the render
+    std::unique_ptr<OStream> os(NewOStream(Path(filename), POV_File_Text_User, false));
+    if (os == nullptr)
+        return;
+
+    // Timestamps are in microseconds; all events belong to a single process.
+    os->printf("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for (int i = 0; i < int(threads.size()); i++)
+        os->printf("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"Thread %d\"}},\n", i, i);
+    for (const Event& event : events)
+    {
+        if (event.duration < 0)
+            os->printf("{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":%d},\n",
+                       event.name, event.category, event.start * 1.0e-3, event.thread);
+        else if (event.serial < 0)
+            os->printf("{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d},\n",
+                       event.name, event.category, event.start * 1.0e-3, event.duration * 1.0e-3, event.thread);
+        else
+            os->printf("{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d,\"args\":{\"serial\":%d}},\n",
+                       event.name, event.category, event.start * 1.0e-3, event.duration * 1.0e-3, event.thread, event.serial);
+    }
+    // the trace-event format tolerates neither a trailing comma nor an empty object, so close with a proper event
+    os->printf("{\"name\":\"Timeline written\",\"cat\":\"timeline\",\"ph\":\"i\",\"s\":\"g\",\"ts\":%.3f,\"pid\":1,\"tid\":0}\n]}\n",
+               std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - origin).count() * 1.0e-3);
+}
+
+}
+// end of namespace pov
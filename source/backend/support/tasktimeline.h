@@ -0,0 +1,159 @@
+//******************************************************************************
+///
+/// @file backend/support/tasktimeline.h
+///
+/// Declarations related to recording the backend's task activity over time.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+#ifndef POVRAY_BACKEND_TASKTIMELINE_H
+#define POVRAY_BACKEND_TASKTIMELINE_H
+
+// Module config header file must be the first file included within POV-Ray unit header files
+#include "backend/configbackend.h"
+
+// C++ variants of C standard header files
+//  (none at the moment)
+
+// C++ standard header files
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// POV-Ray header files (base module)
+#include "base/stringtypes.h"
+#include "base/types.h"
+
+namespace pov
+{
+
+using namespace pov_base;
+
+/// Recorder of the backend's task activity over time.
+///
+/// The tasks, the task queues and the render block dispatcher report what they are doing while
+/// a timeline is attached to the scene; at the end of the render the recorded events are written
+/// as a Chrome trace-event JSON file, which can be viewed in `chrome://tracing` or the Perfetto
+/// UI, with one row per thread.
+///
+/// Only coarse-grained activities (tasks, queue functions, sync waits and render blocks) are
+/// recorded, so that the overhead of a mutex-protected append per event is negligible.
+///
+class TaskTimeline final
+{
+    public:
+
+        typedef std::chrono::steady_clock Clock;
+
+        /// Create a timeline, starting the clock.
+        /// @param  fn              Name of the file to write the timeline to.
+        TaskTimeline(const UCS2String& fn);
+
+        /// Record a span of activity on the current thread, ending now.
+        /// @param  name            Name of the activity; must remain valid for the lifetime of the timeline.
+        /// @param  category        Category of the activity; must remain valid for the lifetime of the timeline.
+        /// @param  start           Time at which the activity started.
+        /// @param  serial          Serial number of the render block concerned, or -1 if none.
+        void Span(const char *name, const char *category, Clock::time_point start, int serial = -1);
+
+        /// Record an instantaneous event on the current thread.
+        /// @param  name            Name of the event; must remain valid for the lifetime of the timeline.
+        /// @param  category        Category of the event; must remain valid for the lifetime of the timeline.
+        void Instant(const char *name, const char *category);
+
+        /// Note that the current thread starts working on a render block.
+        static void BeginBlock();
+
+        /// Record the render block the current thread started working on last, ending now.
+        /// @param  serial          Serial number of the block.
+        void EndBlock(unsigned int serial);
+
+        /// Write the events recorded so far, in Chrome trace-event JSON format.
+        void Write();
+
+    private:
+
+        struct Event final
+        {
+            const char *name;
+            const char *category;
+            POV_LONG    start;      ///< Start time since the creation of the timeline, in nanoseconds.
+            POV_LONG    duration;   ///< Duration in nanoseconds, or -1 for an instantaneous event.
+            int         thread;     ///< Index of the thread, in order of first appearance.
+            int         serial;     ///< Serial number of the render block concerned, or -1 if none.
+        };
+
+        UCS2String filename;
+        Clock::time_point origin;
+        std::mutex mutex;
+        std::vector<Event> events;
+        std::unordered_map<std::thread::id, int> threads;
+
+        void Record(const char *name, const char *category, Clock::time_point start, POV_LONG duration, int serial);
+
+        TaskTimeline(const TaskTimeline&) = delete;
+        TaskTimeline& operator=(const TaskTimeline&) = delete;
+};
+
+/// Record the time spent in a scope as a span on a @ref TaskTimeline, if there is one.
+class TaskTimelineScope final
+{
+    public:
+
+        TaskTimelineScope(TaskTimeline *tl, const char *n, const char *c) :
+            timeline(tl), name(n), category(c)
+        {
+            if (timeline != nullptr)
+                start = TaskTimeline::Clock::now();
+        }
+
+        ~TaskTimelineScope()
+        {
+            if (timeline != nullptr)
+                timeline->Span(name, category, start);
+        }
+
+    private:
+
+        TaskTimeline *timeline;
+        const char *name;
+        const char *category;
+        TaskTimeline::Clock::time_point start;
+
+        TaskTimelineScope(const TaskTimelineScope&) = delete;
+        TaskTimelineScope& operator=(const TaskTimelineScope&) = delete;
+};
+
+}
+// end of namespace pov
+
+#endif // POVRAY_BACKEND_TASKTIMELINE_H
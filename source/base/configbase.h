@@ -749,6 +749,19 @@
     #define POV_USE_DEFAULT_TIMER 1
 #endif
 
+/// @def POV_USE_DEFAULT_PERFORMANCE_COUNTERS
+/// Whether to use a default implementation for the hardware performance counters.
+///
+/// Define as non-zero to use a default implementation for the @ref pov_base::PerformanceCounters class,
+/// or zero if the platform provides its own implementation.
+///
+/// @note
+///     The default implementation does not count any events.
+///
+#ifndef POV_USE_DEFAULT_PERFORMANCE_COUNTERS
+    #define POV_USE_DEFAULT_PERFORMANCE_COUNTERS 1
+#endif
+
 /// @def POV_USE_DEFAULT_PATH_PARSER
 /// Whether to use a default implementation for the path string parser.
 ///
@@ -776,6 +789,21 @@
     #define POV_USE_DEFAULT_DELETEFILE 1
 #endif
 
+/// @def POV_USE_DEFAULT_RENAMEFILE
+/// Whether to use a default implementation to rename a file.
+///
+/// Define as non-zero to use a default implementation for the @ref pov_base::Filesystem::RenameFile() method,
+/// or zero if the platform provides its own implementation.
+///
+/// @note
+///     The default implementation relies on `std::rename` replacing an existing file, as it does
+///     (atomically) on POSIX systems. Platforms where this is not the case must provide their own
+///     implementation.
+///
+#ifndef POV_USE_DEFAULT_RENAMEFILE
+    #define POV_USE_DEFAULT_RENAMEFILE 1
+#endif
+
 /// @def POV_USE_DEFAULT_LARGEFILE
 /// Whether to use a default implementation for large file handling.
 ///
@@ -790,6 +818,21 @@
     #define POV_USE_DEFAULT_LARGEFILE 1
 #endif
 
+/// @def POV_USE_DEFAULT_MAPPEDFILE
+/// Whether to use a default implementation for memory-mapped file handling.
+///
+/// Define as non-zero to use a default implementation for the @ref pov_base::Filesystem::MappedFile class
+/// and the @ref pov_base::Filesystem::AllocateFileBackedMemory() function, or zero if the platform provides
+/// its own implementation.
+///
+/// @note
+///     The default implementation reads the entire file into memory, rather
+///     than actually mapping it, and allocates file-backed memory from the heap.
+///
+#ifndef POV_USE_DEFAULT_MAPPEDFILE
+    #define POV_USE_DEFAULT_MAPPEDFILE 1
+#endif
+
 /// @def POV_OFF_T
 /// Type representing a particular absolute or relative location in a (large) file.
 ///
@@ -43,9 +43,12 @@
 
 // C++ standard header files
 #include <algorithm>
+#include <map>
+#include <mutex>
 #include <string>
 
 // POV-Ray header files (base module)
+#include "base/filesystem.h"
 #include "base/path.h"
 #include "base/platformbase.h"
 #include "base/povassert.h"
@@ -208,6 +211,26 @@ IMemStream::~IMemStream()
 {
 }
 
+IMappedFileStream::IMappedFileStream(const UCS2String& name) :
+    IMemStream(nullptr, 0, name),
+    mpFile(new Filesystem::MappedFile)
+{
+    // Special files need to be read via the regular file I/O.
+    if (pov_stricmp(UCS2toSysString(name).c_str(), "stdin") != 0)
+        fail = !mpFile->Open(name);
+    else
+        fail = true;
+    if (!fail)
+    {
+        start = reinterpret_cast<const unsigned char*>(mpFile->GetData());
+        size = mpFile->GetSize();
+    }
+}
+
+IMappedFileStream::~IMappedFileStream()
+{
+}
+
 OStream::OStream(const UCS2String& name, unsigned int Flags) : IOBase(name), f(nullptr)
 {
     const char* mode;
@@ -326,8 +349,51 @@ void OStream::printf(const char *format, ...)
     write(reinterpret_cast<const void *>(buffer), strlen(buffer));
 }
 
+/// Input stream reading an in-memory file, keeping its contents alive.
+class IMemoryFileStream final : public IMemStream
+{
+    public:
+        IMemoryFileStream(const MemoryFileData& data, const UCS2String& name) :
+            IMemStream(reinterpret_cast<const unsigned char*>(data->data()), data->size(), name),
+            mpData(data)
+        {}
+
+    private:
+        MemoryFileData mpData;
+};
+
+static std::mutex gMemoryFilesMutex;
+static std::map<UCS2String, MemoryFileData> gMemoryFiles;
+
+void RegisterMemoryFile(const UCS2String& name, const MemoryFileData& data)
+{
+    std::lock_guard<std::mutex> lock(gMemoryFilesMutex);
+    gMemoryFiles[name] = data;
+}
+
+void UnregisterMemoryFile(const UCS2String& name)
+{
+    std::lock_guard<std::mutex> lock(gMemoryFilesMutex);
+    gMemoryFiles.erase(name);
+}
+
+MemoryFileData FindMemoryFile(const UCS2String& name)
+{
+    std::lock_guard<std::mutex> lock(gMemoryFilesMutex);
+    if (gMemoryFiles.empty())
+        return nullptr;
+    std::map<UCS2String, MemoryFileData>::const_iterator i = gMemoryFiles.find(name);
+    if (i == gMemoryFiles.end())
+        return nullptr;
+    return i->second;
+}
+
 IStream *NewIStream(const Path& p, unsigned int stype)
 {
+    MemoryFileData memoryFile = FindMemoryFile(p());
+    if (memoryFile != nullptr)
+        return new IMemoryFileStream(memoryFile, p());
+
     if (!PlatformBase::GetInstance().AllowLocalFileAccess(p(), stype, false))
     {
         std::string str ("IO Restrictions prohibit read access to '") ;
@@ -336,6 +402,25 @@ IStream *NewIStream(const Path& p, unsigned int stype)
         throw POV_EXCEPTION(kCannotOpenFileErr, str);
     }
 
+    switch (stype)
+    {
+        case POV_File_Text_POV:
+        case POV_File_Text_INC:
+        case POV_File_Text_User:
+            // Scene and data files are consumed by the parser in bulk, so we prefer to map them
+            // into memory, falling back to regular file I/O if that fails.
+            {
+                IStream* pStream = new IMappedFileStream(p().c_str());
+                if (*pStream)
+                    return pStream;
+                delete pStream;
+            }
+            break;
+
+        default:
+            break;
+    }
+
     return new IFileStream(p().c_str());
 }
 
@@ -379,6 +464,9 @@ UCS2String GetFileName(const Path& p)
 
 bool CheckIfFileExists(const Path& p)
 {
+    if (FindMemoryFile(p()) != nullptr)
+        return true;
+
     FILE *tempf = PlatformBase::GetInstance().OpenLocalFile (p(), "r");
 
     if (tempf != nullptr)
@@ -391,6 +479,10 @@ bool CheckIfFileExists(const Path& p)
 
 POV_OFF_T GetFileLength(const Path& p)
 {
+    MemoryFileData memoryFile = FindMemoryFile(p());
+    if (memoryFile != nullptr)
+        return POV_OFF_T(memoryFile->size());
+
     FILE *tempf = PlatformBase::GetInstance().OpenLocalFile (p(), "rb");
     POV_OFF_T result = -1;
 
@@ -516,6 +608,31 @@ POV_OFF_T IMemStream::tellg() const
     return formalStart + physicalPos;
 }
 
+const unsigned char* IMemStream::readSpan(size_t& count)
+{
+    count = 0;
+
+    if (fail)
+        return nullptr;
+
+    if (mUngetBuffer != EOF)
+    {
+        // The unget buffer should hold the last octet read, in which case we can simply step back;
+        // otherwise leave it to the caller to fall back to regular reading.
+        if ((pos == 0) || (start[pos-1] != (unsigned char)mUngetBuffer))
+            return nullptr;
+        --pos;
+        mUngetBuffer = EOF;
+    }
+
+    const unsigned char* p = &(start[pos]);
+    count = size - pos;
+    pos = size;
+
+    fail = (count == 0);
+    return p;
+}
+
 bool IMemStream::seekg(POV_OFF_T posi, unsigned int whence)
 {
     // Any seek operation renders the end-of-file status and unget buffer's content obsolete.
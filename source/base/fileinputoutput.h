@@ -45,9 +45,11 @@
 #include <cstring>
 
 // C++ standard header files
-//  (none at the moment)
+#include <memory>
+#include <string>
 
 // POV-Ray header files (base module)
+#include "base/filesystem_fwd.h"
 #include "base/path_fwd.h"
 #include "base/stringtypes.h"
 
@@ -92,6 +94,10 @@ enum
     POV_File_Font_TTF,
     POV_File_Data_GTS,
     POV_File_Data_STL,
+    POV_File_Data_PBC,
+    POV_File_Data_PMB,
+    POV_File_Data_PLY,
+    POV_File_Data_IRF,
     POV_File_Count
 };
 
@@ -143,6 +149,17 @@ class IStream : public IOBase
 
         virtual bool getline(char *s, size_t buflen) = 0;
         inline bool ignore(POV_OFF_T count) { return seekg(count, seek_cur); }
+
+        /// Read all remaining data without copying.
+        ///
+        /// Streams backed by contiguous memory may implement this function to give direct access
+        /// to their data. The stream position is advanced to the end of the stream, and the data
+        /// remains valid for the lifetime of the stream object.
+        ///
+        /// @param[out] count   Number of octets available.
+        /// @return Pointer to the data, or `nullptr` if the stream does not support this access.
+        ///
+        virtual const unsigned char* readSpan(size_t& count) { count = 0; return nullptr; }
 };
 
 /// File-backed input stream.
@@ -178,7 +195,7 @@ class IFileStream final : public IStream
 ///
 /// This class is used to support in-built fonts and cached macros.
 ///
-class IMemStream final : public IStream
+class IMemStream : public IStream
 {
     public:
         IMemStream(const unsigned char* data, size_t size, const char* formalName, POV_OFF_T formalStart = 0);
@@ -193,6 +210,7 @@ class IMemStream final : public IStream
         virtual size_t readUpTo(void *buffer, size_t count) override;
         virtual bool seekg(POV_OFF_T pos, unsigned int whence = seek_set) override;
         virtual bool clearstate() override { fail = false; return true; }
+        virtual const unsigned char* readSpan(size_t& count) override;
 
         virtual bool eof() const override { return fail; }
 
@@ -205,6 +223,26 @@ class IMemStream final : public IStream
         int mUngetBuffer;
 };
 
+/// Memory-mapped input stream.
+///
+/// This class provides file read access by mapping the entire file into memory, allowing the
+/// data to be consumed in bulk via @ref readSpan(). On platforms without memory mapping support,
+/// the file is instead read into a single buffer when opened.
+///
+/// @note
+///     Empty files cannot be mapped, and are reported as failure.
+///
+class IMappedFileStream final : public IMemStream
+{
+    public:
+        IMappedFileStream(const UCS2String& name);
+        virtual ~IMappedFileStream() override;
+
+    protected:
+
+        std::unique_ptr<Filesystem::MappedFile> mpFile;
+};
+
 class OStream : public IOBase
 {
     public:
@@ -229,6 +267,28 @@ class OStream : public IOBase
 IStream *NewIStream(const Path&, unsigned int);
 OStream *NewOStream(const Path&, unsigned int, bool);
 
+/// Contents of an in-memory file; see @ref RegisterMemoryFile().
+typedef std::shared_ptr<const std::string> MemoryFileData;
+
+/// Make data available to be read in place of a file.
+///
+/// This allows the renderer to be embedded in-process and fed scenes (and include files) without
+/// touching the filesystem: until the name is unregistered, @ref NewIStream(),
+/// @ref CheckIfFileExists() and @ref GetFileLength() treat it as a file with the given contents,
+/// regardless of whether a file of that name exists on disk. As no filesystem access is involved,
+/// I/O restrictions do not apply to in-memory files.
+///
+/// @param  name    Name of the file, exactly as it will be looked up (e.g. `scene.pov`).
+/// @param  data    Contents of the file; the data is kept alive while any stream reads from it.
+///
+void RegisterMemoryFile(const UCS2String& name, const MemoryFileData& data);
+
+/// Withdraw data previously made available via @ref RegisterMemoryFile().
+void UnregisterMemoryFile(const UCS2String& name);
+
+/// Get the contents of an in-memory file, or `nullptr` if no such file is registered.
+MemoryFileData FindMemoryFile(const UCS2String& name);
+
 UCS2String GetFileExtension(const Path& p); ///< @todo Move this to the @ref Path class.
 UCS2String GetFileName(const Path& p);      ///< @todo Move this to the @ref Path class.
 
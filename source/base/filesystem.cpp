@@ -41,9 +41,7 @@
 #include "base/filesystem.h"
 
 // C++ variants of C standard header files
-#if POV_USE_DEFAULT_DELETEFILE
 #include <cstdio>
-#endif
 
 // C++ standard header files
 #if POV_USE_DEFAULT_LARGEFILE
@@ -51,14 +49,18 @@
 #include <ios>
 #include <limits>
 #endif
+#if POV_USE_DEFAULT_MAPPEDFILE
+#include <cstdlib>
+#include <fstream>
+#include <ios>
+#include <memory>
+#endif
 #if POV_USE_DEFAULT_TEMPORARYFILE
 #include <atomic>
 #endif
 
 // POV-Ray header files (base module)
-#if POV_USE_DEFAULT_DELETEFILE || POV_USE_DEFAULT_LARGEFILE || POV_USE_DEFAULT_TEMPORARYFILE
 #include "base/stringutilities.h"
-#endif
 
 // this must be the last file included
 #include "base/povdebug.h"
@@ -85,6 +87,20 @@ bool DeleteFile(const UCS2String& fileName)
 
 //******************************************************************************
 
+#if POV_USE_DEFAULT_RENAMEFILE
+
+bool RenameFile(const UCS2String& oldName, const UCS2String& newName)
+{
+    // Note: The C++ standard does not specify whether `rename` will replace
+    // an existing file. On POSIX systems it will, atomically; platforms that
+    // refuse to do so must provide their own implementation.
+    return (std::rename(UCS2toSysString(oldName).c_str(), UCS2toSysString(newName).c_str()) == 0);
+}
+
+#endif // POV_USE_DEFAULT_RENAMEFILE
+
+//******************************************************************************
+
 #if POV_USE_DEFAULT_LARGEFILE
 
 using Offset = std::streamoff;
@@ -152,6 +168,87 @@ void LargeFile::Close()
 
 //******************************************************************************
 
+#if POV_USE_DEFAULT_MAPPEDFILE
+
+struct MappedFile::Data final
+{
+    std::unique_ptr<char[]> buffer;
+    std::size_t size;
+    Data() : size(0) {}
+};
+
+MappedFile::MappedFile() :
+    mpData(new Data)
+{}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+bool MappedFile::Open(const UCS2String& fileName)
+{
+    Close();
+
+    std::ifstream stream(UCS2toSysString(fileName), std::ios_base::binary | std::ios_base::in | std::ios_base::ate);
+    if (!stream.is_open())
+        return false;
+    std::streamoff size = stream.tellg();
+    if (size <= 0)
+        return false;
+
+    mpData->buffer.reset(new char[std::size_t(size)]);
+    if (!stream.seekg(0).read(mpData->buffer.get(), size))
+    {
+        mpData->buffer.reset();
+        return false;
+    }
+    mpData->size = std::size_t(size);
+    return true;
+}
+
+const void* MappedFile::GetData() const
+{
+    return mpData->buffer.get();
+}
+
+std::size_t MappedFile::GetSize() const
+{
+    return mpData->size;
+}
+
+void MappedFile::Prefetch() const
+{
+    // The contents are always in memory.
+}
+
+void MappedFile::Evict() const
+{
+    // The contents cannot be dropped from the buffer without losing them.
+}
+
+void MappedFile::Close()
+{
+    mpData->buffer.reset();
+    mpData->size = 0;
+}
+
+void* AllocateFileBackedMemory(std::size_t size)
+{
+    if (size == 0)
+        return nullptr;
+    return std::calloc(size, 1);
+}
+
+void FreeFileBackedMemory(void* data, std::size_t size)
+{
+    std::free(data);
+}
+
+#endif // POV_USE_DEFAULT_MAPPEDFILE
+
+//******************************************************************************
+
 TemporaryFile::TemporaryFile() :
     mFileName(SuggestName())
 {}
@@ -86,6 +86,23 @@ namespace Filesystem
 ///
 bool DeleteFile(const UCS2String& fileName);
 
+/// Rename file.
+///
+/// This function shall try to give the specified file a new name, replacing
+/// any file that already goes by that name. On platforms where the file
+/// system allows it, the replacement is atomic, i.e. other processes will see
+/// either the old or the new file, but never a missing or incomplete one.
+///
+/// @note
+///     The default implementation only supports file names comprised of the
+///     _narrow execution character set_.
+///
+/// @param  oldName     Name of the file to rename.
+/// @param  newName     New name of the file.
+/// @return             `true` if the file was renamed, `false` otherwise.
+///
+bool RenameFile(const UCS2String& oldName, const UCS2String& newName);
+
 /// Large file handling.
 ///
 /// This class provides basic random access to large (>2 GiB) files.
@@ -130,6 +147,83 @@ private:
     std::unique_ptr<Data> mpData;
 };
 
+/// Read-only memory-mapped file.
+///
+/// This class provides read-only access to the entire contents of a file as a
+/// single contiguous block of memory. The file is mapped into the address space
+/// rather than read, so that pages are only loaded as they are accessed, and
+/// are shared with any other process mapping the same file.
+///
+/// @note
+///     The default implementation reads the entire file into memory instead.
+///     Platforms are encouraged to provide their own implementation.
+///
+class MappedFile final
+{
+public:
+
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /// Open and map file for read-only access.
+    /// @note
+    ///     Empty files cannot be mapped, and are reported as failure.
+    bool Open(const UCS2String& fileName);
+
+    /// Get start of the file contents, or `nullptr` if no file is mapped.
+    /// @note
+    ///     The memory is aligned at least as strictly as any fundamental type.
+    const void* GetData() const;
+
+    /// Get size of the file contents.
+    std::size_t GetSize() const;
+
+    /// Advise that the file contents will be accessed soon.
+    /// @note
+    ///     This only initiates reading the file; it does not wait for it to complete.
+    void Prefetch() const;
+
+    /// Release the memory currently holding the file contents.
+    /// @note
+    ///     The contents remain accessible, and are read from the file again as they are accessed.
+    ///     The default implementation, which holds the contents in a buffer, does nothing.
+    void Evict() const;
+
+    /// Unmap and close file.
+    void Close();
+
+private:
+
+    struct Data;
+    std::unique_ptr<Data> mpData;
+};
+
+/// Allocate memory backed by a temporary file.
+///
+/// This function provides a block of zero-initialized read/write memory that is
+/// backed by a sparse temporary file rather than by RAM and swap space, so that
+/// the operating system may page it out to disk as it sees fit. The temporary
+/// file is deleted automatically.
+///
+/// @note
+///     The default implementation allocates regular memory instead.
+///     Platforms are encouraged to provide their own implementation.
+///
+/// @param  size    Size of the block.
+/// @return         Start of the block, or `nullptr` if it could not be allocated.
+///
+void* AllocateFileBackedMemory(std::size_t size);
+
+/// Release memory allocated via @ref AllocateFileBackedMemory().
+///
+/// @param  data    Start of the block.
+/// @param  size    Size of the block, as passed to @ref AllocateFileBackedMemory().
+///
+void FreeFileBackedMemory(void* data, std::size_t size);
+
 /// Temporary file tracker.
 ///
 /// This class can be used to make sure that a given file is automatically
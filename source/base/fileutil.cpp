@@ -142,7 +142,11 @@ POV_File_Extensions gPOV_File_Extensions[POV_File_Count] =
     {{ ".bak",  ".BAK",  "",      ""      }}, // POV_File_Data_Backup
     {{ ".ttf",  ".TTF",  "",      ""      }}, // POV_File_Font_TTF
     {{ ".gts",  ".GTS",  "",      ""      }}, // POV_File_Data_GTS
-    {{ ".stl",  ".STL",  "",      ""      }}  // POV_File_Data_STL
+    {{ ".stl",  ".STL",  "",      ""      }}, // POV_File_Data_STL
+    {{ ".pbc",  ".PBC",  "",      ""      }}, // POV_File_Data_PBC
+    {{ ".pmb",  ".PMB",  "",      ""      }}, // POV_File_Data_PMB
+    {{ ".ply",  ".PLY",  "",      ""      }}, // POV_File_Data_PLY
+    {{ ".irf",  ".IRF",  "",      ""      }}  // POV_File_Data_IRF
 
 };
 
@@ -175,7 +179,11 @@ const int gFile_Type_To_Mask [POV_File_Count] =
     NO_FILE,   // POV_File_Data_Backup
     NO_FILE,   // POV_File_Font_TTF
     NO_FILE,   // POV_File_Data_GTS
-    NO_FILE    // POV_File_Data_STL
+    NO_FILE,   // POV_File_Data_STL
+    NO_FILE,   // POV_File_Data_PBC
+    NO_FILE,   // POV_File_Data_PMB
+    NO_FILE,   // POV_File_Data_PLY
+    NO_FILE    // POV_File_Data_IRF
 };
 
 int InferFileTypeFromExt(const UCS2String& ext)
@@ -37,9 +37,11 @@
 #include "base/image/dither.h"
 
 // C++ variants of C standard header files
-// C++ standard header files
 //  (none at the moment)
 
+// C++ standard header files
+#include <algorithm>
+
 // POV-Ray header files (base module)
 #include "base/povassert.h"
 #include "base/data/bluenoise64a.h"
@@ -52,12 +54,26 @@ namespace pov_base
 
 //*******************************************************************************
 
+void DitherStrategy::GetRowOffsets(unsigned int y, unsigned int width, ColourOffset* offQnt) const
+{
+    for (unsigned int x = 0; x < width; ++x)
+        offQnt[x].clear();
+}
+
+//*******************************************************************************
+
 void NoDither::GetOffset(unsigned int x, unsigned int y, ColourOffset& offLin, ColourOffset& offQnt)
 {
     offLin.clear();
     offQnt.clear();
 }
 
+void NoDither::GetRowOffsets(unsigned int y, unsigned int width, ColourOffset* offQnt) const
+{
+    for (unsigned int x = 0; x < width; ++x)
+        offQnt[x].clear();
+}
+
 //*******************************************************************************
 
 class OrderedDither::Pattern final
@@ -145,6 +161,22 @@ void OrderedDither::GetOffset(unsigned int x, unsigned int y, ColourOffset& offL
     offQnt.alpha = off;
 }
 
+void OrderedDither::GetRowOffsets(unsigned int y, unsigned int width, ColourOffset* offQnt) const
+{
+    // Compute one period of the pattern row, then repeat it across the image.
+    unsigned int period = std::min(width, mPattern.Size());
+    for (unsigned int x = 0; x < period; ++x)
+    {
+        ColourChannel off = mPattern(x, y);
+        offQnt[x].red   = (mInvertRB ? -off : off);
+        offQnt[x].green = off;
+        offQnt[x].blue  = (mInvertRB ? -off : off);
+        offQnt[x].alpha = off;
+    }
+    for (unsigned int x = period; x < width; ++x)
+        offQnt[x] = offQnt[x - period];
+}
+
 //*******************************************************************************
 
 void DiffusionDither1D::GetOffset(unsigned int x, unsigned int y, ColourOffset& offLin, ColourOffset& offQnt)
@@ -161,6 +193,12 @@ void DiffusionDither1D::SetError(unsigned int x, unsigned int y, const ColourOff
     lastErr = err;
 }
 
+bool DiffusionDither1D::GetDiffusionTaps(std::vector<DiffusionTap>& taps) const
+{
+    taps = { { 1, 0, 1.0f } };
+    return true;
+}
+
 //*******************************************************************************
 
 SierraLiteDither::SierraLiteDither(unsigned int width) :
@@ -206,6 +244,12 @@ void SierraLiteDither::SetError(unsigned int x, unsigned int y, const ColourOffs
     maErr[x+1]  = err * (1/4.0); // pixel below (overwritten instead of added to)
 }
 
+bool SierraLiteDither::GetDiffusionTaps(std::vector<DiffusionTap>& taps) const
+{
+    taps = { { 1, 0, 2/4.0f }, { -1, 1, 1/4.0f }, { 0, 1, 1/4.0f } };
+    return true;
+}
+
 //*******************************************************************************
 
 FloydSteinbergDither::FloydSteinbergDither(unsigned int width) :
@@ -256,6 +300,12 @@ void FloydSteinbergDither::SetError(unsigned int x, unsigned int y, const Colour
     mErrX       = err * (1/16.0); // pixel below right (overwritten instead of added to)
 }
 
+bool FloydSteinbergDither::GetDiffusionTaps(std::vector<DiffusionTap>& taps) const
+{
+    taps = { { 1, 0, 7/16.0f }, { -1, 1, 3/16.0f }, { 0, 1, 5/16.0f }, { 1, 1, 1/16.0f } };
+    return true;
+}
+
 //*******************************************************************************
 
 class DiffusionDither::Filter final
@@ -343,6 +393,16 @@ void DiffusionDither::SetError(unsigned int x, unsigned int y, const ColourOffse
             maaErrorBuffer[iy][x + ix] += err * mMatrix[im++];
 }
 
+bool DiffusionDither::GetDiffusionTaps(std::vector<DiffusionTap>& taps) const
+{
+    taps.clear();
+    unsigned int im = 0;
+    for (unsigned int iy = 0; iy < mMatrix.Rows(); ++iy)
+        for (unsigned int ix = (iy == 0 ? mMatrix.ColX() + 1 : 0); ix < mMatrix.Cols(); ++ix)
+            taps.push_back({ int(ix) - mMatrix.ColX(), iy, mMatrix[im++] });
+    return true;
+}
+
 //-------------------------------------------------------------------------------
 
 extern const OrderedDither::Pattern BayerMatrix2({
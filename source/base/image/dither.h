@@ -45,6 +45,7 @@
 
 // C++ standard header files
 #include <memory>
+#include <vector>
 
 // POV-Ray header files (base module)
 #include "base/colour.h"
@@ -129,6 +130,47 @@ class DitherStrategy
         /// @param[in]  err     Linear quantization error (may or may not be relevant to the algorithm).
         ///
         virtual void SetError(unsigned int x, unsigned int y, const ColourOffset& err) {}
+
+        /// Represents a single coefficient of an error diffusion filter.
+        struct DiffusionTap final
+        {
+            int             dx;     ///< Column offset of the pixel receiving the error.
+            unsigned int    dy;     ///< Row offset of the pixel receiving the error.
+            ColourChannel   weight; ///< Fraction of the error to propagate to the pixel.
+        };
+
+        /// Queries whether the algorithm is stateless.
+        ///
+        /// Stateless algorithms compute the offsets solely from the pixel location, never carrying
+        /// over quantization errors, so that pixels may be processed in any order.
+        ///
+        virtual bool IsStateless() const { return false; }
+
+        /// Queries the colour offsets for an entire row from a stateless algorithm.
+        ///
+        /// This function is equivalent to calling @ref GetOffset() for each pixel of the row,
+        /// except that it may also be called concurrently for different rows. The linear offsets
+        /// of a stateless algorithm are always zero, and are therefore not reported.
+        ///
+        /// @note   This function must only be called if @ref IsStateless() reports `true`.
+        ///
+        /// @param[in]  y       Y coordinate of the row.
+        /// @param[in]  width   Number of pixels in the row.
+        /// @param[out] offQnt  Offsets to add right before quantization, one per pixel.
+        ///
+        virtual void GetRowOffsets(unsigned int y, unsigned int width, ColourOffset* offQnt) const;
+
+        /// Queries the error diffusion filter implemented by a stateful algorithm.
+        ///
+        /// Algorithms that do nothing but distribute the quantization error of each pixel to
+        /// neighbouring pixels to the right and below, and do not add any offsets right before
+        /// quantization, can report the distribution here, allowing callers to process multiple
+        /// rows in a pipelined fashion rather than strictly pixel by pixel.
+        ///
+        /// @param[out] taps    Coefficients of the filter.
+        /// @return             `true` if the algorithm is a pure error diffusion filter.
+        ///
+        virtual bool GetDiffusionTaps(std::vector<DiffusionTap>& taps) const { return false; }
 };
 
 struct DitherStrategy::ColourOffset final
@@ -180,6 +222,8 @@ class NoDither final : public DitherStrategy
 {
 public:
     virtual void GetOffset(unsigned int x, unsigned int y, ColourOffset& offLin, ColourOffset& offQnt) override;
+    virtual bool IsStateless() const override { return true; }
+    virtual void GetRowOffsets(unsigned int y, unsigned int width, ColourOffset* offQnt) const override;
 };
 
 //-------------------------------------------------------------------------------
@@ -195,6 +239,8 @@ public:
     class Pattern;
     OrderedDither(const Pattern& matrix, unsigned int width, bool invertRB = false);
     virtual void GetOffset(unsigned int x, unsigned int y, ColourOffset& offLin, ColourOffset& offQnt) override;
+    virtual bool IsStateless() const override { return true; }
+    virtual void GetRowOffsets(unsigned int y, unsigned int width, ColourOffset* offQnt) const override;
 protected:
     const Pattern& mPattern;
     unsigned int mImageWidth;
@@ -242,6 +288,7 @@ class DiffusionDither1D final : public DitherStrategy
 public:
     virtual void GetOffset(unsigned int x, unsigned int y, ColourOffset& offLin, ColourOffset& offQnt) override;
     virtual void SetError(unsigned int x, unsigned int y, const ColourOffset& err) override;
+    virtual bool GetDiffusionTaps(std::vector<DiffusionTap>& taps) const override;
 protected:
     ColourOffset lastErr;
 };
@@ -270,6 +317,7 @@ public:
     virtual ~SierraLiteDither() override;
     virtual void GetOffset(unsigned int x, unsigned int y, ColourOffset& offLin, ColourOffset& offQnt) override;
     virtual void SetError(unsigned int x, unsigned int y, const ColourOffset& err) override;
+    virtual bool GetDiffusionTaps(std::vector<DiffusionTap>& taps) const override;
 protected:
     unsigned int imageWidth;
     ColourOffset* maErr;
@@ -300,6 +348,7 @@ public:
     virtual ~FloydSteinbergDither() override;
     virtual void GetOffset(unsigned int x, unsigned int y, ColourOffset& offLin, ColourOffset& offQnt) override;
     virtual void SetError(unsigned int x, unsigned int y, const ColourOffset& err) override;
+    virtual bool GetDiffusionTaps(std::vector<DiffusionTap>& taps) const override;
 protected:
     unsigned int imageWidth;
     ColourOffset* maErr;
@@ -323,6 +372,7 @@ public:
     virtual ~DiffusionDither() override;
     virtual void GetOffset(unsigned int x, unsigned int y, ColourOffset& offLin, ColourOffset& offQnt) override;
     virtual void SetError(unsigned int x, unsigned int y, const ColourOffset& err) override;
+    virtual bool GetDiffusionTaps(std::vector<DiffusionTap>& taps) const override;
 protected:
     const Filter& mMatrix;
     unsigned int mImageWidth;
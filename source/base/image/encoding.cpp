@@ -42,8 +42,13 @@
 
 // C++ standard header files
 #include <algorithm>
+#include <atomic>
+#include <system_error>
+#include <thread>
+#include <vector>
 
 // POV-Ray header files (base module)
+#include "base/povassert.h"
 #include "base/image/colourspace.h"
 #include "base/image/dither.h"
 #include "base/image/image.h"
@@ -247,9 +252,9 @@ void SetEncodedRGBValue(Image* img, unsigned int x, unsigned int y, const GammaC
     img->SetRGBValue(x, y, GammaCurve::Decode(g,col.red()), GammaCurve::Decode(g,col.green()), GammaCurve::Decode(g,col.blue()));
 }
 
-unsigned int GetEncodedGrayValue(const Image* img, unsigned int x, unsigned int y, const GammaCurvePtr& g, unsigned int max, DitherStrategy& dh)
+/// Fetch a pixel to be encoded as grayscale without alpha.
+static inline void GetGrayForEncoding(const Image* img, unsigned int x, unsigned int y, float& fGray)
 {
-    float fGray;
     if (!img->IsPremultiplied() && img->HasTransparency())
     {
         // data has transparency and is stored non-premultiplied; precompose against a black background
@@ -262,17 +267,12 @@ unsigned int GetEncodedGrayValue(const Image* img, unsigned int x, unsigned int
         // no need to worry about premultiplication
         fGray = img->GetGrayValue(x, y);
     }
-    DitherStrategy::ColourOffset linOff, encOff;
-    dh.GetOffset(x,y,linOff,encOff);
-    unsigned int iGray = IntEncode(g, fGray, max, encOff.gray, linOff.gray);
-    dh.SetError(x,y,linOff);
-    return iGray;
 }
-void GetEncodedGrayAValue(const Image* img, unsigned int x, unsigned int y, const GammaCurvePtr& g, unsigned int max, unsigned int& gray, unsigned int& alpha, DitherStrategy& dh, bool premul)
+/// Fetch a pixel to be encoded as grayscale with alpha.
+static inline void GetGrayAForEncoding(const Image* img, unsigned int x, unsigned int y, float& fGray, float& fAlpha, bool premul)
 {
     bool doPremultiply   = premul && !img->IsPremultiplied() && img->HasTransparency(); // need to apply premultiplication if encoded data should be premul'ed but container content isn't
     bool doUnPremultiply = !premul && img->IsPremultiplied() && img->HasTransparency(); // need to undo premultiplication if other way round
-    float fGray, fAlpha;
     img->GetGrayAValue(x, y, fGray, fAlpha);
     if (doPremultiply)
     {
@@ -307,15 +307,10 @@ void GetEncodedGrayAValue(const Image* img, unsigned int x, unsigned int y, cons
         // No need for converting between premultiplied and un-premultiplied encoding.
     }
     // else no need to worry about premultiplication
-    DitherStrategy::ColourOffset linOff, encOff;
-    dh.GetOffset(x,y,linOff,encOff);
-    gray  = IntEncode(g, fGray,  max, encOff.gray,  linOff.gray);
-    alpha = IntEncode(   fAlpha, max, encOff.alpha, linOff.alpha);
-    dh.SetError(x,y,linOff);
 }
-void GetEncodedRGBValue(const Image* img, unsigned int x, unsigned int y, const GammaCurvePtr& g, unsigned int max, unsigned int& red, unsigned int& green, unsigned int& blue, DitherStrategy& dh)
+/// Fetch a pixel to be encoded as RGB without alpha.
+static inline void GetRGBForEncoding(const Image* img, unsigned int x, unsigned int y, float& fRed, float& fGreen, float& fBlue)
 {
-    float fRed, fGreen, fBlue;
     if (!img->IsPremultiplied() && img->HasTransparency())
     {
         float fAlpha;
@@ -328,18 +323,12 @@ void GetEncodedRGBValue(const Image* img, unsigned int x, unsigned int y, const
         // no need to worry about premultiplication
         img->GetRGBValue(x, y, fRed, fGreen, fBlue);
     }
-    DitherStrategy::ColourOffset linOff, encOff;
-    dh.GetOffset(x,y,linOff,encOff);
-    red   = IntEncode(g, fRed,   max, encOff.red,   linOff.red);
-    green = IntEncode(g, fGreen, max, encOff.green, linOff.green);
-    blue  = IntEncode(g, fBlue,  max, encOff.blue,  linOff.blue);
-    dh.SetError(x,y,linOff);
 }
-void GetEncodedRGBAValue(const Image* img, unsigned int x, unsigned int y, const GammaCurvePtr& g, unsigned int max, unsigned int& red, unsigned int& green, unsigned int& blue, unsigned int& alpha, DitherStrategy& dh, bool premul)
+/// Fetch a pixel to be encoded as RGB with alpha.
+static inline void GetRGBAForEncoding(const Image* img, unsigned int x, unsigned int y, float& fRed, float& fGreen, float& fBlue, float& fAlpha, bool premul)
 {
     bool doPremultiply   = premul && !img->IsPremultiplied() && img->HasTransparency(); // need to apply premultiplication if encoded data should be premul'ed but container content isn't
     bool doUnPremultiply = !premul && img->IsPremultiplied() && img->HasTransparency(); // need to undo premultiplication if other way round
-    float fRed, fGreen, fBlue, fAlpha;
     img->GetRGBAValue(x, y, fRed, fGreen, fBlue, fAlpha);
     if (doPremultiply)
     {
@@ -381,6 +370,43 @@ void GetEncodedRGBAValue(const Image* img, unsigned int x, unsigned int y, const
         // No need for converting between premultiplied and un-premultiplied encoding.
     }
     // else no need to worry about premultiplication
+}
+
+unsigned int GetEncodedGrayValue(const Image* img, unsigned int x, unsigned int y, const GammaCurvePtr& g, unsigned int max, DitherStrategy& dh)
+{
+    float fGray;
+    GetGrayForEncoding(img, x, y, fGray);
+    DitherStrategy::ColourOffset linOff, encOff;
+    dh.GetOffset(x,y,linOff,encOff);
+    unsigned int iGray = IntEncode(g, fGray, max, encOff.gray, linOff.gray);
+    dh.SetError(x,y,linOff);
+    return iGray;
+}
+void GetEncodedGrayAValue(const Image* img, unsigned int x, unsigned int y, const GammaCurvePtr& g, unsigned int max, unsigned int& gray, unsigned int& alpha, DitherStrategy& dh, bool premul)
+{
+    float fGray, fAlpha;
+    GetGrayAForEncoding(img, x, y, fGray, fAlpha, premul);
+    DitherStrategy::ColourOffset linOff, encOff;
+    dh.GetOffset(x,y,linOff,encOff);
+    gray  = IntEncode(g, fGray,  max, encOff.gray,  linOff.gray);
+    alpha = IntEncode(   fAlpha, max, encOff.alpha, linOff.alpha);
+    dh.SetError(x,y,linOff);
+}
+void GetEncodedRGBValue(const Image* img, unsigned int x, unsigned int y, const GammaCurvePtr& g, unsigned int max, unsigned int& red, unsigned int& green, unsigned int& blue, DitherStrategy& dh)
+{
+    float fRed, fGreen, fBlue;
+    GetRGBForEncoding(img, x, y, fRed, fGreen, fBlue);
+    DitherStrategy::ColourOffset linOff, encOff;
+    dh.GetOffset(x,y,linOff,encOff);
+    red   = IntEncode(g, fRed,   max, encOff.red,   linOff.red);
+    green = IntEncode(g, fGreen, max, encOff.green, linOff.green);
+    blue  = IntEncode(g, fBlue,  max, encOff.blue,  linOff.blue);
+    dh.SetError(x,y,linOff);
+}
+void GetEncodedRGBAValue(const Image* img, unsigned int x, unsigned int y, const GammaCurvePtr& g, unsigned int max, unsigned int& red, unsigned int& green, unsigned int& blue, unsigned int& alpha, DitherStrategy& dh, bool premul)
+{
+    float fRed, fGreen, fBlue, fAlpha;
+    GetRGBAForEncoding(img, x, y, fRed, fGreen, fBlue, fAlpha, premul);
     DitherStrategy::ColourOffset linOff, encOff;
     dh.GetOffset(x,y,linOff,encOff);
     red   = IntEncode(g, fRed,   max, encOff.red,   linOff.red);
@@ -470,5 +496,315 @@ void GetEncodedRGBValue(const Image* img, unsigned int x, unsigned int y, const
     col.blue()  = GammaCurve::Encode(g,col.blue());
 }
 
+//*****************************************************************************
+
+GammaIntEncoder::GammaIntEncoder(const GammaCurvePtr& g, unsigned int max) :
+    mMax(max),
+    mNeutral(GammaCurve::IsNeutral(g))
+{
+    if (mNeutral)
+        return;
+
+    mDecoded.resize(std::size_t(max) + 1);
+    for (unsigned int v = 0; v <= max; ++v)
+        mDecoded[v] = IntDecode(g, v, max);
+
+    mIndex.resize(kIndexBins + 1);
+    unsigned int v = 0;
+    for (unsigned int bin = 0; bin <= kIndexBins; ++bin)
+    {
+        float x = float(bin) / float(kIndexBins);
+        while ((v < max) && (mDecoded[v + 1] <= x))
+            ++v;
+        mIndex[bin] = v;
+    }
+}
+
+//*****************************************************************************
+
+/// Number of pixels after which a thread encoding a row with error diffusion publishes its progress.
+#define ROW_ENCODER_PROGRESS_INTERVAL 32
+
+struct ImageRowEncoder::Implementation final
+{
+    typedef DitherStrategy::ColourOffset ColourOffset;
+    typedef DitherStrategy::DiffusionTap DiffusionTap;
+
+    /// Per-thread working memory for error diffusion.
+    struct Scratch final
+    {
+        std::vector<ColourOffset>   sameRow;    ///< Errors diffused to the right within the current row.
+        std::vector<ColourOffset*>  targets;    ///< Error buffer for each diffusion tap, pre-offset by the tap's column offset.
+    };
+
+    const Image*        image;
+    GammaIntEncoder     encoder;
+    unsigned int        max;
+    unsigned int        width;
+    bool                colour;
+    bool                alpha;
+    bool                premul;
+    DitherStrategy&     dither;
+    unsigned int        threads;
+    bool                stateless;
+    bool                diffusion;
+
+    std::vector<DiffusionTap>   taps;
+    unsigned int                maxLeft;    ///< Largest distance by which errors are diffused to the left.
+    unsigned int                maxRight;   ///< Largest distance by which errors are diffused to the right.
+    unsigned int                maxDy;      ///< Largest distance by which errors are diffused downward.
+    unsigned int                slots;      ///< Number of rows for which diffusion state is kept.
+    std::size_t                 stride;     ///< Number of entries per error buffer.
+    std::vector<ColourOffset>   errors;     ///< Errors diffused downward, per row slot and row distance.
+    std::unique_ptr<std::atomic<POV_ULONG>[]> progress; ///< Progress per row slot, as `row * (width + 1) + pixels done`.
+
+    Implementation(const Image* img, const GammaCurvePtr& g, unsigned int m, bool c, bool a, bool p, DitherStrategy& dh, unsigned int t);
+
+    /// Get the errors diffused to a given row from the row a given distance above.
+    inline ColourOffset* ErrorBuffer(unsigned int y, unsigned int dy)
+    {
+        return &errors[(std::size_t(y % slots) * maxDy + dy - 1) * stride];
+    }
+
+    void GetPixel(unsigned int x, unsigned int y, ColourOffset& value) const;
+    void EncodePixel(const ColourOffset& value, const ColourOffset& offQnt, ColourOffset& err, unsigned int*& data) const;
+    void EncodeStatelessRow(unsigned int y, unsigned int* data, ColourOffset* offQnt) const;
+    void EncodeSerialRow(unsigned int y, unsigned int* data);
+    void EncodeDiffusionRow(unsigned int y, unsigned int* data, Scratch& scratch);
+
+    /// Call `fn(worker, i)` for each i in 0..count-1, in increasing order of i but in parallel.
+    template<typename FN>
+    void RunParallel(unsigned int count, const FN& fn) const;
+};
+
+ImageRowEncoder::Implementation::Implementation(const Image* img, const GammaCurvePtr& g, unsigned int m, bool c, bool a, bool p, DitherStrategy& dh, unsigned int t) :
+    image(img),
+    encoder(g, m),
+    max(m),
+    width(img->GetWidth()),
+    colour(c),
+    alpha(a),
+    premul(p),
+    dither(dh),
+    threads(std::max(1u, t)),
+    stateless(dh.IsStateless()),
+    diffusion(false),
+    maxLeft(0),
+    maxRight(0),
+    maxDy(0),
+    slots(0),
+    stride(0)
+{
+    if (stateless)
+        return;
+
+    diffusion = dh.GetDiffusionTaps(taps);
+    if (!diffusion)
+    {
+        // Other stateful strategies need to see the pixels strictly in order.
+        threads = 1;
+        return;
+    }
+
+    for (auto&& tap : taps)
+    {
+        POV_ASSERT((tap.dy > 0) || (tap.dx > 0));
+        if (tap.dx < 0)
+            maxLeft = std::max(maxLeft, (unsigned int)(-tap.dx));
+        else
+            maxRight = std::max(maxRight, (unsigned int)(tap.dx));
+        maxDy = std::max(maxDy, tap.dy);
+    }
+
+    // A row slot is re-used only after both the row it was last used for and any rows below
+    // still receiving errors from there have been completed; as rows are completed in order,
+    // and each thread works on a single row at a time, the following number suffices.
+    slots  = threads + maxDy;
+    stride = std::size_t(maxLeft) + width + maxRight;
+    errors.resize(std::size_t(slots) * maxDy * stride);
+    progress.reset(new std::atomic<POV_ULONG>[slots]);
+    for (unsigned int i = 0; i < slots; ++i)
+        progress[i].store(0);
+}
+
+void ImageRowEncoder::Implementation::GetPixel(unsigned int x, unsigned int y, ColourOffset& value) const
+{
+    if (colour && alpha)
+        GetRGBAForEncoding(image, x, y, value.red, value.green, value.blue, value.alpha, premul);
+    else if (colour)
+        GetRGBForEncoding(image, x, y, value.red, value.green, value.blue);
+    else if (alpha)
+        GetGrayAForEncoding(image, x, y, value.gray, value.alpha, premul);
+    else
+        GetGrayForEncoding(image, x, y, value.gray);
+}
+
+void ImageRowEncoder::Implementation::EncodePixel(const ColourOffset& value, const ColourOffset& offQnt, ColourOffset& err, unsigned int*& data) const
+{
+    if (colour)
+    {
+        *(data++) = encoder.Encode(value.red,   offQnt.red,   err.red);
+        *(data++) = encoder.Encode(value.green, offQnt.green, err.green);
+        *(data++) = encoder.Encode(value.blue,  offQnt.blue,  err.blue);
+    }
+    else
+        *(data++) = encoder.Encode(value.gray,  offQnt.gray,  err.gray);
+    if (alpha)
+        *(data++) = IntEncode(value.alpha, max, offQnt.alpha, err.alpha);
+}
+
+void ImageRowEncoder::Implementation::EncodeStatelessRow(unsigned int y, unsigned int* data, ColourOffset* offQnt) const
+{
+    ColourOffset value, err;
+    dither.GetRowOffsets(y, width, offQnt);
+    for (unsigned int x = 0; x < width; ++x)
+    {
+        GetPixel(x, y, value);
+        err.clear();
+        EncodePixel(value, offQnt[x], err, data);
+    }
+}
+
+void ImageRowEncoder::Implementation::EncodeSerialRow(unsigned int y, unsigned int* data)
+{
+    ColourOffset value, linOff, encOff;
+    for (unsigned int x = 0; x < width; ++x)
+    {
+        GetPixel(x, y, value);
+        dither.GetOffset(x, y, linOff, encOff);
+        EncodePixel(value, encOff, linOff, data);
+        dither.SetError(x, y, linOff);
+    }
+}
+
+void ImageRowEncoder::Implementation::EncodeDiffusionRow(unsigned int y, unsigned int* data, Scratch& scratch)
+{
+    ColourOffset value, err;
+    const ColourOffset noOffset;
+
+    // Set up the buffers receiving errors from this row. Nobody else is using them at this time.
+    std::fill(scratch.sameRow.begin(), scratch.sameRow.end(), ColourOffset());
+    for (unsigned int dy = 1; dy <= maxDy; ++dy)
+        std::fill_n(ErrorBuffer(y + dy, dy), stride, ColourOffset());
+    for (std::size_t i = 0; i < taps.size(); ++i)
+    {
+        if (taps[i].dy == 0)
+            scratch.targets[i] = scratch.sameRow.data() + taps[i].dx;
+        else
+            scratch.targets[i] = ErrorBuffer(y + taps[i].dy, taps[i].dy) + maxLeft + taps[i].dx;
+    }
+
+    // Errors diffused to this row from above are complete once the row directly above has
+    // progressed far enough; the first row, as well as any row not receiving errors from above,
+    // can go right ahead.
+    const ColourOffset* incoming = ((maxDy > 0) ? ErrorBuffer(y, 1) + maxLeft : nullptr);
+    const std::atomic<POV_ULONG>& above = progress[(y + slots - 1) % slots];
+    std::atomic<POV_ULONG>& current = progress[y % slots];
+    POV_ULONG aboveBase = (POV_ULONG)(y - 1) * (width + 1);
+    POV_ULONG currentBase = (POV_ULONG)y * (width + 1);
+    unsigned int aboveDone = (((maxDy > 0) && (y > 0)) ? 0 : width);
+
+    for (unsigned int x = 0; x < width; ++x)
+    {
+        unsigned int needed = std::min(width, x + maxLeft + 1);
+        while (aboveDone < needed)
+        {
+            POV_ULONG done = above.load(std::memory_order_acquire);
+            if (done >= aboveBase + needed)
+                aboveDone = (unsigned int)(done - aboveBase);
+            else
+                std::this_thread::yield();
+        }
+
+        err = scratch.sameRow[x];
+        for (unsigned int dy = maxDy; dy > 0; --dy)
+            err += incoming[(dy - 1) * stride + x];
+
+        GetPixel(x, y, value);
+        EncodePixel(value, noOffset, err, data);
+
+        for (std::size_t i = 0; i < taps.size(); ++i)
+            scratch.targets[i][x] += err * taps[i].weight;
+
+        if (((x + 1) % ROW_ENCODER_PROGRESS_INTERVAL == 0) || (x + 1 == width))
+            current.store(currentBase + x + 1, std::memory_order_release);
+    }
+}
+
+template<typename FN>
+void ImageRowEncoder::Implementation::RunParallel(unsigned int count, const FN& fn) const
+{
+    std::atomic<unsigned int> next(0);
+
+    auto work = [&](unsigned int worker)
+    {
+        for (unsigned int i = next++; i < count; i = next++)
+            fn(worker, i);
+    };
+
+    std::vector<std::thread> helpers;
+    for (unsigned int t = 1; t < std::min(threads, count); ++t)
+    {
+        try
+        {
+            helpers.emplace_back(work, t);
+        }
+        catch (std::system_error&)
+        {
+            break; // no more threads available; the others will pick up the work
+        }
+    }
+    work(0);
+
+    for (auto& helper : helpers)
+        helper.join();
+}
+
+//------------------------------------------------------------------------------
+
+ImageRowEncoder::ImageRowEncoder(const Image* img, const GammaCurvePtr& g, unsigned int max, bool colour, bool alpha, bool premul,
+                                 DitherStrategy& dh, unsigned int threads) :
+    mChannels((colour ? 3 : 1) + (alpha ? 1 : 0)),
+    mpImpl(new Implementation(img, g, max, colour, alpha, premul, dh, threads))
+{}
+
+ImageRowEncoder::~ImageRowEncoder()
+{}
+
+void ImageRowEncoder::EncodeRows(unsigned int first, unsigned int count, unsigned int* data)
+{
+    typedef Implementation::ColourOffset ColourOffset;
+
+    Implementation& impl = *mpImpl;
+    std::size_t rowValues = std::size_t(impl.width) * mChannels;
+
+    if (impl.stateless)
+    {
+        std::vector<std::vector<ColourOffset>> offsets(std::min(impl.threads, count), std::vector<ColourOffset>(impl.width));
+        impl.RunParallel(count, [&](unsigned int worker, unsigned int i)
+        {
+            impl.EncodeStatelessRow(first + i, data + i * rowValues, offsets[worker].data());
+        });
+    }
+    else if (impl.diffusion)
+    {
+        std::vector<Implementation::Scratch> scratch(std::min(impl.threads, count));
+        for (auto& s : scratch)
+        {
+            s.sameRow.resize(std::size_t(impl.width) + impl.maxRight);
+            s.targets.resize(impl.taps.size());
+        }
+        impl.RunParallel(count, [&](unsigned int worker, unsigned int i)
+        {
+            impl.EncodeDiffusionRow(first + i, data + i * rowValues, scratch[worker]);
+        });
+    }
+    else
+    {
+        for (unsigned int i = 0; i < count; ++i)
+            impl.EncodeSerialRow(first + i, data + i * rowValues);
+    }
+}
+
 }
 // end of namespace pov_base
@@ -44,7 +44,8 @@
 #include <cmath>
 
 // C++ standard header files
-//  (none at the moment)
+#include <memory>
+#include <vector>
 
 // POV-Ray header files (base module)
 #include "base/colour.h"
@@ -294,6 +295,153 @@ void GetEncodedRGBValue(const Image* img, unsigned int x, unsigned int y, const
 void GetEncodedRGBAValue(const Image* img, unsigned int x, unsigned int y, const GammaCurvePtr&, float& red, float& green, float& blue, float& alpha, bool premul = false);
 void GetEncodedRGBValue(const Image* img, unsigned int x, unsigned int y, const GammaCurvePtr&, RGBColour& rgb);
 
+/// @}
+///
+//*****************************************************************************
+///
+/// @name Bulk Encoding (Quantization)
+///
+/// The following types are provided for encoding (quantizing) large amounts of data.
+///
+/// @{
+
+/// Table-driven generic encoder.
+///
+/// This class provides the same quantization as
+/// @ref IntEncode(const GammaCurvePtr&,float,unsigned int,float,float&), but looks up the
+/// decoded values of the integer levels in a pre-computed table instead of evaluating the transfer
+/// function (and its inverse) for each value.
+///
+/// @note
+///     The transfer function is presumed to be monotonic.
+///
+class GammaIntEncoder final
+{
+    public:
+
+        /// Construct an encoder for a given transfer function and bit depth.
+        ///
+        /// @param[in]  g       Transfer function (gamma curve) to use.
+        /// @param[in]  max     Encoded value representing 1.0.
+        ///
+        GammaIntEncoder(const GammaCurvePtr& g, unsigned int max);
+
+        /// Encode a value.
+        ///
+        /// @param[in]      x       Value to encode.
+        /// @param[in]      qOff    Offset to add before quantization.
+        /// @param[in,out]  err     Quantization error (including effects due to adding qOff).
+        ///
+        inline unsigned int Encode(float x, float qOff, float& err) const
+        {
+            if (mNeutral)
+                return IntEncode(x, mMax, qOff, err);
+
+            float xEff = clip(x, 0.0f, 1.0f) + err;
+            unsigned int v = EncodeDown(xEff);
+            float decoded = mDecoded[v];
+            if (v < mMax)
+            {
+                float decodedUp = mDecoded[v + 1];
+                float threshold = (0.5 - qOff) * decoded + (0.5 + qOff) * decodedUp;
+                if (xEff > threshold)
+                {
+                    decoded = decodedUp;
+                    ++v;
+                }
+            }
+            err = xEff - decoded;
+            return v;
+        }
+
+    private:
+
+        /// Number of bins into which the index divides the range 0..1.
+        static const unsigned int kIndexBins = 4096;
+
+        unsigned int                mMax;
+        bool                        mNeutral;
+        std::vector<float>          mDecoded;   ///< Decoded value of each integer level.
+        std::vector<unsigned int>   mIndex;     ///< Highest level decoding to no more than the lower bound of each bin.
+
+        /// Find the highest level decoding to no more than a given value.
+        inline unsigned int EncodeDown(float x) const
+        {
+            if (!(x > 0.0f))
+                return 0;
+            if (x >= 1.0f)
+                return mMax;
+            unsigned int bin = (unsigned int)(x * kIndexBins);
+            unsigned int lo = mIndex[bin];
+            unsigned int hi = mIndex[bin + 1];
+            while (lo < hi)
+            {
+                unsigned int mid = (lo + hi + 1) / 2;
+                if (mDecoded[mid] <= x)
+                    lo = mid;
+                else
+                    hi = mid - 1;
+            }
+            return lo;
+        }
+};
+
+/// Encoder for entire rows of an image.
+///
+/// This class provides the same functionality as the @ref GetEncodedRGBAValue() family of
+/// functions with a dithering strategy, but processes entire rows at a time, and can spread the
+/// work across multiple threads.
+///
+/// Stateless dithering strategies are applied to entire rows, and rows are encoded in parallel.
+/// Error diffusion strategies are applied in a pipelined fashion instead: Each thread encodes a
+/// row of its own, trailing the thread encoding the row above just far enough to have received
+/// all the quantization errors diffused from there. Either way, the result does not depend on the
+/// number of threads.
+///
+/// @note
+///     Rows must be encoded in top-to-bottom order, each exactly once.
+///
+class ImageRowEncoder final
+{
+    public:
+
+        /// Construct an encoder for a given image.
+        ///
+        /// @param[in]  img         Image to encode.
+        /// @param[in]  g           Transfer function (gamma curve) to use.
+        /// @param[in]  max         Encoded value representing 1.0.
+        /// @param[in]  colour      Whether to encode RGB (rather than grayscale) values.
+        /// @param[in]  alpha       Whether to encode alpha values.
+        /// @param[in]  premul      Whether to encode premultiplied (rather than straight) alpha.
+        /// @param[in]  dh          Dithering strategy to use.
+        /// @param[in]  threads     Maximum number of threads to use.
+        ///
+        ImageRowEncoder(const Image* img, const GammaCurvePtr& g, unsigned int max, bool colour, bool alpha, bool premul,
+                        DitherStrategy& dh, unsigned int threads = 1);
+        ~ImageRowEncoder();
+
+        /// Number of values encoded per pixel.
+        inline unsigned int Channels() const { return mChannels; }
+
+        /// Encode a block of rows.
+        ///
+        /// The values are stored in row order, pixel by pixel, with the gray or red, green and
+        /// blue values followed by the alpha value.
+        ///
+        /// @param[in]  first   First row to encode.
+        /// @param[in]  count   Number of rows to encode.
+        /// @param[out] data    Buffer to receive the encoded values.
+        ///
+        void EncodeRows(unsigned int first, unsigned int count, unsigned int* data);
+
+    private:
+
+        struct Implementation;
+
+        unsigned int                    mChannels;
+        std::unique_ptr<Implementation> mpImpl;
+};
+
 /// @}
 ///
 //*****************************************************************************
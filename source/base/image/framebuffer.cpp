@@ -0,0 +1,119 @@
+//******************************************************************************
+///
+/// @file base/image/framebuffer.cpp
+///
+/// Framebuffer shared between render back-end and front-end.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+// Unit header file must be the first file included within POV-Ray *.cpp files (pulls in config)
+#include "base/image/framebuffer.h"
+
+// C++ variants of C standard header files
+//  (none at the moment)
+
+// C++ standard header files
+#include <algorithm>
+#include <map>
+#include <mutex>
+
+// POV-Ray header files (base module)
+//  (none at the moment)
+
+// this must be the last file included
+#include "base/povdebug.h"
+
+namespace pov_base
+{
+
+/// Registry of all live shared framebuffers.
+struct FramebufferRegistry final
+{
+    std::mutex                                      mutex;
+    std::map<int, std::weak_ptr<SharedFramebuffer>> framebuffers;
+    int                                             lastId = 0;
+};
+
+// Never destroyed, so that framebuffers outliving static destruction can still unregister.
+static FramebufferRegistry& gFramebufferRegistry = *(new FramebufferRegistry);
+
+SharedFramebuffer::SharedFramebuffer(unsigned int width, unsigned int height, int id) :
+    mId(id),
+    mWidth(width),
+    mHeight(height),
+    mPixels(size_t(width) * height)
+{}
+
+SharedFramebuffer::~SharedFramebuffer()
+{
+    std::lock_guard<std::mutex> lock(gFramebufferRegistry.mutex);
+    gFramebufferRegistry.framebuffers.erase(mId);
+}
+
+std::shared_ptr<SharedFramebuffer> SharedFramebuffer::Create(unsigned int width, unsigned int height)
+{
+    std::lock_guard<std::mutex> lock(gFramebufferRegistry.mutex);
+    do
+    {
+        // skip 0 (reserved for "none") as well as IDs still in use after wrapping around
+        if (++gFramebufferRegistry.lastId <= 0)
+            gFramebufferRegistry.lastId = 1;
+    }
+    while (gFramebufferRegistry.framebuffers.count(gFramebufferRegistry.lastId) != 0);
+
+    std::shared_ptr<SharedFramebuffer> framebuffer(new SharedFramebuffer(width, height, gFramebufferRegistry.lastId));
+    gFramebufferRegistry.framebuffers[framebuffer->mId] = framebuffer;
+    return framebuffer;
+}
+
+std::shared_ptr<SharedFramebuffer> SharedFramebuffer::Find(int id)
+{
+    std::lock_guard<std::mutex> lock(gFramebufferRegistry.mutex);
+    auto i = gFramebufferRegistry.framebuffers.find(id);
+    if (i == gFramebufferRegistry.framebuffers.end())
+        return nullptr;
+    return i->second.lock();
+}
+
+void SharedFramebuffer::SetBlock(const POVRect& rect, const std::vector<RGBTColour>& pixels)
+{
+    POV_ASSERT((rect.right < mWidth) && (rect.bottom < mHeight));
+    POV_ASSERT(pixels.size() == rect.GetArea());
+
+    std::vector<RGBTColour>::const_iterator source = pixels.begin();
+    for (unsigned int y = rect.top; y <= rect.bottom; ++y)
+    {
+        std::copy(source, source + rect.GetWidth(), mPixels.begin() + size_t(y) * mWidth + rect.left);
+        source += rect.GetWidth();
+    }
+}
+
+}
+// end of namespace pov_base
@@ -0,0 +1,121 @@
+//******************************************************************************
+///
+/// @file base/image/framebuffer.h
+///
+/// Framebuffer shared between render back-end and front-end.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+#ifndef POVRAY_BASE_FRAMEBUFFER_H
+#define POVRAY_BASE_FRAMEBUFFER_H
+
+// Module config header file must be the first file included within POV-Ray unit header files
+#include "base/configbase.h"
+
+// C++ variants of C standard header files
+//  (none at the moment)
+
+// C++ standard header files
+#include <memory>
+#include <vector>
+
+// POV-Ray header files (base module)
+#include "base/colour.h"
+#include "base/types.h"
+
+namespace pov_base
+{
+
+//##############################################################################
+///
+/// @addtogroup PovBaseImage
+///
+/// @{
+
+/// Framebuffer shared between the render back-end and front-end of the same process.
+///
+/// The front-end creates the framebuffer and passes its ID to the back-end with the render
+/// options. The back-end then writes completed blocks of pixels directly into the framebuffer,
+/// and only notifies the front-end that a block is complete, rather than streaming the pixel
+/// data through a POVMS message.
+///
+/// Framebuffers are looked up by ID, so that a back-end that does not share the front-end's
+/// address space simply won't find it, and falls back to sending the pixel data.
+///
+/// @note
+///     Nothing guards against concurrent access to the pixels; the back-end must write each
+///     pixel only once per render, before sending the notification, and the front-end must only
+///     read pixels it has been notified of.
+///
+class SharedFramebuffer final
+{
+public:
+
+    ~SharedFramebuffer();
+
+    SharedFramebuffer(const SharedFramebuffer&) = delete;
+    SharedFramebuffer& operator=(const SharedFramebuffer&) = delete;
+
+    /// Create and register a new framebuffer.
+    static std::shared_ptr<SharedFramebuffer> Create(unsigned int width, unsigned int height);
+
+    /// Find a registered framebuffer by ID.
+    /// @return     The framebuffer, or `nullptr` if no such framebuffer exists.
+    static std::shared_ptr<SharedFramebuffer> Find(int id);
+
+    /// ID by which the framebuffer can be found; never 0.
+    int GetId() const { return mId; }
+
+    unsigned int GetWidth() const { return mWidth; }
+    unsigned int GetHeight() const { return mHeight; }
+
+    /// Store a block of pixels, given in rows from top to bottom.
+    void SetBlock(const POVRect& rect, const std::vector<RGBTColour>& pixels);
+
+    const RGBTColour& GetPixel(unsigned int x, unsigned int y) const { return mPixels[size_t(y) * mWidth + x]; }
+
+private:
+
+    SharedFramebuffer(unsigned int width, unsigned int height, int id);
+
+    int                     mId;
+    unsigned int            mWidth;
+    unsigned int            mHeight;
+    std::vector<RGBTColour> mPixels;
+};
+
+/// @}
+///
+//##############################################################################
+
+}
+// end of namespace pov_base
+
+#endif // POVRAY_BASE_FRAMEBUFFER_H
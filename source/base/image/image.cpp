@@ -37,10 +37,13 @@
 #include "base/image/image.h"
 
 // C++ variants of C standard header files
+#include <cstddef>
 #include <cstdint>
 
 // C++ standard header files
-//  (none at the moment)
+#include <atomic>
+#include <new>
+#include <utility>
 
 // POSIX standard header files
 // TODO FIXME - Any POSIX-specific stuff should be considered platform-specific.
@@ -48,6 +51,11 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 
+// Other 3rd party header files
+#ifndef OPENEXR_MISSING
+#include <half.h>
+#endif
+
 // POV-Ray header files (base module)
 #include "base/filesystem.h"
 #include "base/platformbase.h"
@@ -97,6 +105,7 @@ ImageWriteOptions::ImageWriteOptions() :
     alphaMode(ImageAlphaMode::None),
     bitsPerChannel(8),
     compression(-1),
+    threads(1),
     grayscale(false)
 {}
 
@@ -108,6 +117,39 @@ GammaCurvePtr ImageWriteOptions::GetTranscodingGammaCurve(GammaCurvePtr defaultE
         return TranscodingGammaCurve::Get(workingGamma, defaultEncodingGamma);
 }
 
+/// Allocator placing image data in memory backed by a temporary file.
+///
+/// Image data allocated this way can be paged out by the operating system without consuming RAM
+/// or swap space, at the cost of disk I/O on access. See @ref Filesystem::AllocateFileBackedMemory().
+///
+template<typename T>
+class FileMappedAllocator
+{
+    public:
+        typedef T value_type;
+
+        FileMappedAllocator() {}
+        template<typename U> FileMappedAllocator(const FileMappedAllocator<U>&) {}
+
+        T* allocate(std::size_t n)
+        {
+            void* data = Filesystem::AllocateFileBackedMemory(SafeUnsignedProduct<std::size_t>(n, sizeof(T)));
+            if (data == nullptr)
+                throw std::bad_alloc();
+            return static_cast<T*>(data);
+        }
+
+        void deallocate(T* data, std::size_t n)
+        {
+            Filesystem::FreeFileBackedMemory(data, n * sizeof(T));
+        }
+};
+
+template<typename T, typename U>
+inline bool operator==(const FileMappedAllocator<T>&, const FileMappedAllocator<U>&) { return true; }
+template<typename T, typename U>
+inline bool operator!=(const FileMappedAllocator<T>&, const FileMappedAllocator<U>&) { return false; }
+
 template<class Allocator = allocator<bool>>
 class BitMapImage final : public Image
 {
@@ -326,6 +368,7 @@ class BitMapImage final : public Image
 };
 
 typedef BitMapImage<> MemoryBitMapImage;
+typedef BitMapImage<FileMappedAllocator<bool>> FileMappedBitMapImage;
 
 template<class Allocator = allocator<unsigned char>>
 class ColourMapImage final : public Image
@@ -829,6 +872,7 @@ class ColourMapImage final : public Image
 };
 
 typedef ColourMapImage<> MemoryColourMapImage;
+typedef ColourMapImage<FileMappedAllocator<unsigned char>> FileMappedColourMapImage;
 
 template<typename T, unsigned int TMAX, ImageDataType IDT, class Allocator = allocator<T>>
 class GrayImage final : public Image
@@ -1042,8 +1086,10 @@ class GrayImage final : public Image
 };
 
 typedef GrayImage<unsigned char, 255, ImageDataType::Gray_Int8> MemoryGray8Image;
+typedef GrayImage<unsigned char, 255, ImageDataType::Gray_Int8, FileMappedAllocator<unsigned char>> FileMappedGray8Image;
 
 typedef GrayImage<unsigned short, 65535, ImageDataType::Gray_Int16> MemoryGray16Image;
+typedef GrayImage<unsigned short, 65535, ImageDataType::Gray_Int16, FileMappedAllocator<unsigned short>> FileMappedGray16Image;
 
 template<typename T, unsigned int TMAX, ImageDataType IDT, class Allocator = allocator<T>>
 class GrayAImage final : public Image
@@ -1277,8 +1323,10 @@ class GrayAImage final : public Image
 };
 
 typedef GrayAImage<unsigned char, 255, ImageDataType::GrayA_Int8> MemoryGrayA8Image;
+typedef GrayAImage<unsigned char, 255, ImageDataType::GrayA_Int8, FileMappedAllocator<unsigned char>> FileMappedGrayA8Image;
 
 typedef GrayAImage<unsigned short, 65535, ImageDataType::GrayA_Int16> MemoryGrayA16Image;
+typedef GrayAImage<unsigned short, 65535, ImageDataType::GrayA_Int16, FileMappedAllocator<unsigned short>> FileMappedGrayA16Image;
 
 template<typename T, unsigned int TMAX, ImageDataType IDT, class Allocator = allocator<T>>
 class RGBImage final : public Image
@@ -1518,8 +1566,10 @@ class RGBImage final : public Image
 };
 
 typedef RGBImage<unsigned char, 255, ImageDataType::RGB_Int8> MemoryRGB8Image;
+typedef RGBImage<unsigned char, 255, ImageDataType::RGB_Int8, FileMappedAllocator<unsigned char>> FileMappedRGB8Image;
 
 typedef RGBImage<unsigned short, 65535, ImageDataType::RGB_Int16> MemoryRGB16Image;
+typedef RGBImage<unsigned short, 65535, ImageDataType::RGB_Int16, FileMappedAllocator<unsigned short>> FileMappedRGB16Image;
 
 template<typename T, unsigned int TMAX, ImageDataType IDT, class Allocator = allocator<T>>
 class RGBAImage final : public Image
@@ -1775,21 +1825,23 @@ class RGBAImage final : public Image
 };
 
 typedef RGBAImage<unsigned char, 255, ImageDataType::RGBA_Int8> MemoryRGBA8Image;
+typedef RGBAImage<unsigned char, 255, ImageDataType::RGBA_Int8, FileMappedAllocator<unsigned char>> FileMappedRGBA8Image;
 
 typedef RGBAImage<unsigned short, 65535, ImageDataType::RGBA_Int16> MemoryRGBA16Image;
+typedef RGBAImage<unsigned short, 65535, ImageDataType::RGBA_Int16, FileMappedAllocator<unsigned short>> FileMappedRGBA16Image;
 
-template<class PixelContainer = vector<float, allocator<float>>>
+template<class PixelContainer = vector<float, allocator<float>>, ImageDataType IDT = ImageDataType::RGBFT_Float>
 class RGBFTImage final : public Image
 {
     public:
         RGBFTImage(unsigned int w, unsigned int h) :
-            Image(w, h, ImageDataType::RGBFT_Float) { pixels.resize(SafeUnsignedProduct<size_t>(w, h, 5u)); FillBitValue(false); }
+            Image(w, h, IDT) { pixels.resize(SafeUnsignedProduct<size_t>(w, h, 5u)); FillBitValue(false); }
         RGBFTImage(unsigned int w, unsigned int h, const vector<RGBMapEntry>& m) :
-            Image(w, h, ImageDataType::RGBFT_Float, m) { pixels.resize(SafeUnsignedProduct<size_t>(w, h, 5u)); FillBitValue(false); }
+            Image(w, h, IDT, m) { pixels.resize(SafeUnsignedProduct<size_t>(w, h, 5u)); FillBitValue(false); }
         RGBFTImage(unsigned int w, unsigned int h, const vector<RGBAMapEntry>& m) :
-            Image(w, h, ImageDataType::RGBFT_Float, m) { pixels.resize(SafeUnsignedProduct<size_t>(w, h, 5u)); FillBitValue(false); }
+            Image(w, h, IDT, m) { pixels.resize(SafeUnsignedProduct<size_t>(w, h, 5u)); FillBitValue(false); }
         RGBFTImage(unsigned int w, unsigned int h, const vector<RGBFTMapEntry>& m) :
-            Image(w, h, ImageDataType::RGBFT_Float, m) { pixels.resize(SafeUnsignedProduct<size_t>(w, h, 5u)); FillBitValue(false); }
+            Image(w, h, IDT, m) { pixels.resize(SafeUnsignedProduct<size_t>(w, h, 5u)); FillBitValue(false); }
         virtual ~RGBFTImage() override { }
 
         virtual bool IsOpaque() const override
@@ -2033,6 +2085,12 @@ class RGBFTImage final : public Image
 };
 
 typedef RGBFTImage<> MemoryRGBFTImage;
+typedef RGBFTImage<vector<float, FileMappedAllocator<float>>> FileMappedRGBFTImage;
+
+#ifndef OPENEXR_MISSING
+typedef RGBFTImage<vector<half, allocator<half>>, ImageDataType::RGBFT_Half> MemoryRGBFTHalfImage;
+typedef RGBFTImage<vector<half, FileMappedAllocator<half>>, ImageDataType::RGBFT_Half> FileMappedRGBFTHalfImage;
+#endif
 
 template<typename T, unsigned int TMAX, ImageDataType IDT, class Allocator = allocator<T>>
 class NonlinearGrayImage final : public Image
@@ -2252,8 +2310,10 @@ class NonlinearGrayImage final : public Image
 };
 
 typedef NonlinearGrayImage<unsigned char, 255, ImageDataType::Gray_Gamma8> MemoryNonlinearGray8Image;
+typedef NonlinearGrayImage<unsigned char, 255, ImageDataType::Gray_Gamma8, FileMappedAllocator<unsigned char>> FileMappedNonlinearGray8Image;
 
 typedef NonlinearGrayImage<unsigned short, 65535, ImageDataType::Gray_Gamma16> MemoryNonlinearGray16Image;
+typedef NonlinearGrayImage<unsigned short, 65535, ImageDataType::Gray_Gamma16, FileMappedAllocator<unsigned short>> FileMappedNonlinearGray16Image;
 
 template<typename T, unsigned int TMAX, ImageDataType IDT, class Allocator = allocator<T>>
 class NonlinearGrayAImage final : public Image
@@ -2497,8 +2557,10 @@ class NonlinearGrayAImage final : public Image
 };
 
 typedef NonlinearGrayAImage<unsigned char, 255, ImageDataType::GrayA_Gamma8> MemoryNonlinearGrayA8Image;
+typedef NonlinearGrayAImage<unsigned char, 255, ImageDataType::GrayA_Gamma8, FileMappedAllocator<unsigned char>> FileMappedNonlinearGrayA8Image;
 
 typedef NonlinearGrayAImage<unsigned short, 65535, ImageDataType::GrayA_Gamma16> MemoryNonlinearGrayA16Image;
+typedef NonlinearGrayAImage<unsigned short, 65535, ImageDataType::GrayA_Gamma16, FileMappedAllocator<unsigned short>> FileMappedNonlinearGrayA16Image;
 
 template<typename T, unsigned int TMAX, ImageDataType IDT, class Allocator = allocator<T>>
 class NonlinearRGBImage final : public Image
@@ -2744,8 +2806,10 @@ class NonlinearRGBImage final : public Image
 };
 
 typedef NonlinearRGBImage<unsigned char, 255, ImageDataType::RGB_Gamma8> MemoryNonlinearRGB8Image;
+typedef NonlinearRGBImage<unsigned char, 255, ImageDataType::RGB_Gamma8, FileMappedAllocator<unsigned char>> FileMappedNonlinearRGB8Image;
 
 typedef NonlinearRGBImage<unsigned short, 65535, ImageDataType::RGB_Gamma16> MemoryNonlinearRGB16Image;
+typedef NonlinearRGBImage<unsigned short, 65535, ImageDataType::RGB_Gamma16, FileMappedAllocator<unsigned short>> FileMappedNonlinearRGB16Image;
 
 template<typename T, unsigned int TMAX, ImageDataType IDT, class Allocator = allocator<T>>
 class NonlinearRGBAImage final : public Image
@@ -3007,8 +3071,10 @@ class NonlinearRGBAImage final : public Image
 };
 
 typedef NonlinearRGBAImage<unsigned char, 255, ImageDataType::RGBA_Gamma8> MemoryNonlinearRGBA8Image;
+typedef NonlinearRGBAImage<unsigned char, 255, ImageDataType::RGBA_Gamma8, FileMappedAllocator<unsigned char>> FileMappedNonlinearRGBA8Image;
 
 typedef NonlinearRGBAImage<unsigned short, 65535, ImageDataType::RGBA_Gamma16> MemoryNonlinearRGBA16Image;
+typedef NonlinearRGBAImage<unsigned short, 65535, ImageDataType::RGBA_Gamma16, FileMappedAllocator<unsigned short>> FileMappedNonlinearRGBA16Image;
 
 // sample basic file-based pixel container. not very efficient.
 // it is expected that for performance reasons, platforms will provide their own specific
@@ -3618,6 +3684,61 @@ ImageDataType Image::GetImageDataType(int bitsPerChannel, int colourChannels, bo
     return GetImageDataType(bitsPerChannel, colourChannels, (alpha ? 1 : 0), GammaCurve::IsNeutral(gamma));
 }
 
+/// Size above which image data is placed in file-backed memory, in octets (0 = never).
+static std::atomic<POV_ULONG> gFileBackingThreshold(0);
+
+void Image::SetFileBackingThreshold(POV_ULONG bytes)
+{
+    gFileBackingThreshold = bytes;
+}
+
+/// Get the approximate storage size per pixel of an image data container, in bits.
+static unsigned int GetBitsPerPixel(ImageDataType t)
+{
+    switch (t)
+    {
+        case ImageDataType::Bit_Map:        return 1;
+        case ImageDataType::Colour_Map:     return 8;
+        case ImageDataType::Gray_Int8:
+        case ImageDataType::Gray_Gamma8:    return 8;
+        case ImageDataType::Gray_Int16:
+        case ImageDataType::Gray_Gamma16:
+        case ImageDataType::GrayA_Int8:
+        case ImageDataType::GrayA_Gamma8:   return 16;
+        case ImageDataType::RGB_Int8:
+        case ImageDataType::RGB_Gamma8:     return 24;
+        case ImageDataType::GrayA_Int16:
+        case ImageDataType::GrayA_Gamma16:
+        case ImageDataType::RGBA_Int8:
+        case ImageDataType::RGBA_Gamma8:    return 32;
+        case ImageDataType::RGB_Int16:
+        case ImageDataType::RGB_Gamma16:    return 48;
+        case ImageDataType::RGBA_Int16:
+        case ImageDataType::RGBA_Gamma16:   return 64;
+        case ImageDataType::RGBFT_Float:    return 5 * 32;
+        case ImageDataType::RGBFT_Half:     return 5 * 16;
+        default:                            return 0;
+    }
+}
+
+/// Decide whether to place the data of an image in file-backed memory.
+static bool UseFileBacking(unsigned int w, unsigned int h, ImageDataType t, bool allowFileBacking)
+{
+    POV_ULONG threshold = gFileBackingThreshold;
+    if (!allowFileBacking || (threshold == 0))
+        return false;
+    return (SafeUnsignedProduct<POV_ULONG>(w, h, GetBitsPerPixel(t)) / 8 > threshold);
+}
+
+/// Create an image with its data in either regular or file-backed memory.
+template<class MemoryImage, class FileMappedImage, typename... Args>
+static Image *NewImage(bool fileBacked, Args&&... args)
+{
+    if (fileBacked)
+        return new FileMappedImage(std::forward<Args>(args)...);
+    return new MemoryImage(std::forward<Args>(args)...);
+}
+
 Image *Image::Create(unsigned int w, unsigned int h, ImageDataType t, unsigned int maxRAMmbHint, unsigned int pixelsPerBlockHint)
 {
     try
@@ -3642,10 +3763,26 @@ Image *Image::Create(unsigned int w, unsigned int h, ImageDataType t, unsigned i
                 return new MemoryRGBA8Image (w, h);
             case ImageDataType::RGBA_Int16:
                 return new MemoryRGBA16Image(w, h);
+            case ImageDataType::RGBFT_Half:
+#ifndef OPENEXR_MISSING
+                if (maxRAMmbHint > 0)
+                    if (SafeUnsignedProduct<POV_ULONG>(w, h, 5 * sizeof(half)) / 1048576 > maxRAMmbHint)
+#if !POV_USE_DEFAULT_MAPPEDFILE
+                        return new FileMappedRGBFTHalfImage(w, h);
+#else
+                        return new FileRGBFTImage(w, h, pixelsPerBlockHint);
+#endif
+                return new MemoryRGBFTHalfImage(w, h);
+#endif
+                // without OpenEXR support, fall back to single precision
             case ImageDataType::RGBFT_Float:
                 if (maxRAMmbHint > 0)
                     if (SafeUnsignedProduct<POV_ULONG>(w, h, sizeof(FileRGBFTImage::pixel_type)) / 1048576 > maxRAMmbHint)
+#if !POV_USE_DEFAULT_MAPPEDFILE
+                        return new FileMappedRGBFTImage(w, h);
+#else
                         return new FileRGBFTImage(w, h, pixelsPerBlockHint);
+#endif
                 return new MemoryRGBFTImage(w, h);
             case ImageDataType::RGB_Gamma8:
                 return new MemoryNonlinearRGB8Image(w, h);
@@ -3675,50 +3812,53 @@ Image *Image::Create(unsigned int w, unsigned int h, ImageDataType t, unsigned i
 
 Image *Image::Create(unsigned int w, unsigned int h, ImageDataType t, bool allowFileBacking)
 {
+    bool fileBacked = UseFileBacking(w, h, t, allowFileBacking);
+
     try
     {
         switch(t)
         {
             case ImageDataType::Bit_Map:
-                return new MemoryBitMapImage(w, h);
+                return NewImage<MemoryBitMapImage, FileMappedBitMapImage>(fileBacked, w, h);
             case ImageDataType::Gray_Int8:
-                return new MemoryGray8Image(w, h);
+                return NewImage<MemoryGray8Image, FileMappedGray8Image>(fileBacked, w, h);
             case ImageDataType::Gray_Int16:
-                return new MemoryGray16Image(w, h);
+                return NewImage<MemoryGray16Image, FileMappedGray16Image>(fileBacked, w, h);
             case ImageDataType::GrayA_Int8:
-                return new MemoryGrayA8Image(w, h);
+                return NewImage<MemoryGrayA8Image, FileMappedGrayA8Image>(fileBacked, w, h);
             case ImageDataType::GrayA_Int16:
-                return new MemoryGrayA16Image(w, h);
+                return NewImage<MemoryGrayA16Image, FileMappedGrayA16Image>(fileBacked, w, h);
             case ImageDataType::RGB_Int8:
-                return new MemoryRGB8Image(w, h);
+                return NewImage<MemoryRGB8Image, FileMappedRGB8Image>(fileBacked, w, h);
             case ImageDataType::RGB_Int16:
-                return new MemoryRGB16Image(w, h);
+                return NewImage<MemoryRGB16Image, FileMappedRGB16Image>(fileBacked, w, h);
             case ImageDataType::RGBA_Int8:
-                return new MemoryRGBA8Image (w, h);
+                return NewImage<MemoryRGBA8Image, FileMappedRGBA8Image>(fileBacked, w, h);
             case ImageDataType::RGBA_Int16:
-                return new MemoryRGBA16Image(w, h);
-            case ImageDataType::RGBFT_Float:
-#ifdef FILE_MAPPED_IMAGE_ALLOCATOR
-                if (allowFileBacking)
-                    return new RGBFTImage<FILE_MAPPED_IMAGE_ALLOCATOR<float>>(w, h);
+                return NewImage<MemoryRGBA16Image, FileMappedRGBA16Image>(fileBacked, w, h);
+            case ImageDataType::RGBFT_Half:
+#ifndef OPENEXR_MISSING
+                return NewImage<MemoryRGBFTHalfImage, FileMappedRGBFTHalfImage>(fileBacked, w, h);
 #endif
-                return new MemoryRGBFTImage(w, h);
+                // without OpenEXR support, fall back to single precision
+            case ImageDataType::RGBFT_Float:
+                return NewImage<MemoryRGBFTImage, FileMappedRGBFTImage>(fileBacked, w, h);
             case ImageDataType::RGB_Gamma8:
-                return new MemoryNonlinearRGB8Image(w, h);
+                return NewImage<MemoryNonlinearRGB8Image, FileMappedNonlinearRGB8Image>(fileBacked, w, h);
             case ImageDataType::RGB_Gamma16:
-                return new MemoryNonlinearRGB16Image(w, h);
+                return NewImage<MemoryNonlinearRGB16Image, FileMappedNonlinearRGB16Image>(fileBacked, w, h);
             case ImageDataType::RGBA_Gamma8:
-                return new MemoryNonlinearRGBA8Image (w, h);
+                return NewImage<MemoryNonlinearRGBA8Image, FileMappedNonlinearRGBA8Image>(fileBacked, w, h);
             case ImageDataType::RGBA_Gamma16:
-                return new MemoryNonlinearRGBA16Image(w, h);
+                return NewImage<MemoryNonlinearRGBA16Image, FileMappedNonlinearRGBA16Image>(fileBacked, w, h);
             case ImageDataType::Gray_Gamma8:
-                return new MemoryNonlinearGray8Image(w, h);
+                return NewImage<MemoryNonlinearGray8Image, FileMappedNonlinearGray8Image>(fileBacked, w, h);
             case ImageDataType::Gray_Gamma16:
-                return new MemoryNonlinearGray16Image(w, h);
+                return NewImage<MemoryNonlinearGray16Image, FileMappedNonlinearGray16Image>(fileBacked, w, h);
             case ImageDataType::GrayA_Gamma8:
-                return new MemoryNonlinearGrayA8Image(w, h);
+                return NewImage<MemoryNonlinearGrayA8Image, FileMappedNonlinearGrayA8Image>(fileBacked, w, h);
             case ImageDataType::GrayA_Gamma16:
-                return new MemoryNonlinearGrayA16Image(w, h);
+                return NewImage<MemoryNonlinearGrayA16Image, FileMappedNonlinearGrayA16Image>(fileBacked, w, h);
             default:
                 throw POV_EXCEPTION_STRING("Undefined image format in Image::Create");
         }
@@ -3731,52 +3871,55 @@ Image *Image::Create(unsigned int w, unsigned int h, ImageDataType t, bool allow
 
 Image *Image::Create(unsigned int w, unsigned int h, ImageDataType t, const vector<RGBMapEntry>& m, bool allowFileBacking)
 {
+    bool fileBacked = UseFileBacking(w, h, t, allowFileBacking);
+
     try
     {
         switch(t)
         {
             case ImageDataType::Bit_Map:
-                return new MemoryBitMapImage(w, h, m);
+                return NewImage<MemoryBitMapImage, FileMappedBitMapImage>(fileBacked, w, h, m);
             case ImageDataType::Colour_Map:
-                return new MemoryColourMapImage(w, h, m);
+                return NewImage<MemoryColourMapImage, FileMappedColourMapImage>(fileBacked, w, h, m);
             case ImageDataType::Gray_Int8:
-                return new MemoryGray8Image(w, h, m);
+                return NewImage<MemoryGray8Image, FileMappedGray8Image>(fileBacked, w, h, m);
             case ImageDataType::Gray_Int16:
-                return new MemoryGray16Image(w, h, m);
+                return NewImage<MemoryGray16Image, FileMappedGray16Image>(fileBacked, w, h, m);
             case ImageDataType::GrayA_Int8:
-                return new MemoryGrayA8Image(w, h, m);
+                return NewImage<MemoryGrayA8Image, FileMappedGrayA8Image>(fileBacked, w, h, m);
             case ImageDataType::GrayA_Int16:
-                return new MemoryGrayA16Image(w, h, m);
+                return NewImage<MemoryGrayA16Image, FileMappedGrayA16Image>(fileBacked, w, h, m);
             case ImageDataType::RGB_Int8:
-                return new MemoryRGB8Image(w, h, m);
+                return NewImage<MemoryRGB8Image, FileMappedRGB8Image>(fileBacked, w, h, m);
             case ImageDataType::RGB_Int16:
-                return new MemoryRGB16Image(w, h, m);
+                return NewImage<MemoryRGB16Image, FileMappedRGB16Image>(fileBacked, w, h, m);
             case ImageDataType::RGBA_Int8:
-                return new MemoryRGBA8Image (w, h, m);
+                return NewImage<MemoryRGBA8Image, FileMappedRGBA8Image>(fileBacked, w, h, m);
             case ImageDataType::RGBA_Int16:
-                return new MemoryRGBA16Image(w, h, m);
-            case ImageDataType::RGBFT_Float:
-#ifdef FILE_MAPPED_IMAGE_ALLOCATOR
-                if (allowFileBacking)
-                    return new RGBFTImage<FILE_MAPPED_IMAGE_ALLOCATOR<float>>(w, h, m);
+                return NewImage<MemoryRGBA16Image, FileMappedRGBA16Image>(fileBacked, w, h, m);
+            case ImageDataType::RGBFT_Half:
+#ifndef OPENEXR_MISSING
+                return NewImage<MemoryRGBFTHalfImage, FileMappedRGBFTHalfImage>(fileBacked, w, h, m);
 #endif
-                return new MemoryRGBFTImage(w, h, m);
+                // without OpenEXR support, fall back to single precision
+            case ImageDataType::RGBFT_Float:
+                return NewImage<MemoryRGBFTImage, FileMappedRGBFTImage>(fileBacked, w, h, m);
             case ImageDataType::RGB_Gamma8:
-                return new MemoryNonlinearRGB8Image(w, h, m);
+                return NewImage<MemoryNonlinearRGB8Image, FileMappedNonlinearRGB8Image>(fileBacked, w, h, m);
             case ImageDataType::RGB_Gamma16:
-                return new MemoryNonlinearRGB16Image(w, h, m);
+                return NewImage<MemoryNonlinearRGB16Image, FileMappedNonlinearRGB16Image>(fileBacked, w, h, m);
             case ImageDataType::RGBA_Gamma8:
-                return new MemoryNonlinearRGBA8Image (w, h, m);
+                return NewImage<MemoryNonlinearRGBA8Image, FileMappedNonlinearRGBA8Image>(fileBacked, w, h, m);
             case ImageDataType::RGBA_Gamma16:
-                return new MemoryNonlinearRGBA16Image(w, h, m);
+                return NewImage<MemoryNonlinearRGBA16Image, FileMappedNonlinearRGBA16Image>(fileBacked, w, h, m);
             case ImageDataType::Gray_Gamma8:
-                return new MemoryNonlinearGray8Image(w, h, m);
+                return NewImage<MemoryNonlinearGray8Image, FileMappedNonlinearGray8Image>(fileBacked, w, h, m);
             case ImageDataType::Gray_Gamma16:
-                return new MemoryNonlinearGray16Image(w, h, m);
+                return NewImage<MemoryNonlinearGray16Image, FileMappedNonlinearGray16Image>(fileBacked, w, h, m);
             case ImageDataType::GrayA_Gamma8:
-                return new MemoryNonlinearGrayA8Image(w, h, m);
+                return NewImage<MemoryNonlinearGrayA8Image, FileMappedNonlinearGrayA8Image>(fileBacked, w, h, m);
             case ImageDataType::GrayA_Gamma16:
-                return new MemoryNonlinearGrayA16Image(w, h, m);
+                return NewImage<MemoryNonlinearGrayA16Image, FileMappedNonlinearGrayA16Image>(fileBacked, w, h, m);
             default:
                 throw POV_EXCEPTION_STRING("Image::Create Exception TODO"); // TODO FIXME WIP
         }
@@ -3789,52 +3932,55 @@ Image *Image::Create(unsigned int w, unsigned int h, ImageDataType t, const vect
 
 Image *Image::Create(unsigned int w, unsigned int h, ImageDataType t, const vector<RGBAMapEntry>& m, bool allowFileBacking)
 {
+    bool fileBacked = UseFileBacking(w, h, t, allowFileBacking);
+
     try
     {
         switch(t)
         {
             case ImageDataType::Bit_Map:
-                return new MemoryBitMapImage(w, h, m);
+                return NewImage<MemoryBitMapImage, FileMappedBitMapImage>(fileBacked, w, h, m);
             case ImageDataType::Colour_Map:
-                return new MemoryColourMapImage(w, h, m);
+                return NewImage<MemoryColourMapImage, FileMappedColourMapImage>(fileBacked, w, h, m);
             case ImageDataType::Gray_Int8:
-                return new MemoryGray8Image(w, h, m);
+                return NewImage<MemoryGray8Image, FileMappedGray8Image>(fileBacked, w, h, m);
             case ImageDataType::Gray_Int16:
-                return new MemoryGray16Image(w, h, m);
+                return NewImage<MemoryGray16Image, FileMappedGray16Image>(fileBacked, w, h, m);
             case ImageDataType::GrayA_Int8:
-                return new MemoryGrayA8Image(w, h, m);
+                return NewImage<MemoryGrayA8Image, FileMappedGrayA8Image>(fileBacked, w, h, m);
             case ImageDataType::GrayA_Int16:
-                return new MemoryGrayA16Image(w, h, m);
+                return NewImage<MemoryGrayA16Image, FileMappedGrayA16Image>(fileBacked, w, h, m);
             case ImageDataType::RGB_Int8:
-                return new MemoryRGB8Image(w, h, m);
+                return NewImage<MemoryRGB8Image, FileMappedRGB8Image>(fileBacked, w, h, m);
             case ImageDataType::RGB_Int16:
-                return new MemoryRGB16Image(w, h, m);
+                return NewImage<MemoryRGB16Image, FileMappedRGB16Image>(fileBacked, w, h, m);
             case ImageDataType::RGBA_Int8:
-                return new MemoryRGBA8Image (w, h, m);
+                return NewImage<MemoryRGBA8Image, FileMappedRGBA8Image>(fileBacked, w, h, m);
             case ImageDataType::RGBA_Int16:
-                return new MemoryRGBA16Image(w, h, m);
-            case ImageDataType::RGBFT_Float:
-#ifdef FILE_MAPPED_IMAGE_ALLOCATOR
-                if (allowFileBacking)
-                    return new RGBFTImage<FILE_MAPPED_RGBFT_IMAGE_ALLOCATOR<float>>(w, h, m);
+                return NewImage<MemoryRGBA16Image, FileMappedRGBA16Image>(fileBacked, w, h, m);
+            case ImageDataType::RGBFT_Half:
+#ifndef OPENEXR_MISSING
+                return NewImage<MemoryRGBFTHalfImage, FileMappedRGBFTHalfImage>(fileBacked, w, h, m);
 #endif
-                return new MemoryRGBFTImage(w, h, m);
+                // without OpenEXR support, fall back to single precision
+            case ImageDataType::RGBFT_Float:
+                return NewImage<MemoryRGBFTImage, FileMappedRGBFTImage>(fileBacked, w, h, m);
             case ImageDataType::RGB_Gamma8:
-                return new MemoryNonlinearRGB8Image(w, h, m);
+                return NewImage<MemoryNonlinearRGB8Image, FileMappedNonlinearRGB8Image>(fileBacked, w, h, m);
             case ImageDataType::RGB_Gamma16:
-                return new MemoryNonlinearRGB16Image(w, h, m);
+                return NewImage<MemoryNonlinearRGB16Image, FileMappedNonlinearRGB16Image>(fileBacked, w, h, m);
             case ImageDataType::RGBA_Gamma8:
-                return new MemoryNonlinearRGBA8Image (w, h, m);
+                return NewImage<MemoryNonlinearRGBA8Image, FileMappedNonlinearRGBA8Image>(fileBacked, w, h, m);
             case ImageDataType::RGBA_Gamma16:
-                return new MemoryNonlinearRGBA16Image(w, h, m);
+                return NewImage<MemoryNonlinearRGBA16Image, FileMappedNonlinearRGBA16Image>(fileBacked, w, h, m);
             case ImageDataType::Gray_Gamma8:
-                return new MemoryNonlinearGray8Image(w, h, m);
+                return NewImage<MemoryNonlinearGray8Image, FileMappedNonlinearGray8Image>(fileBacked, w, h, m);
             case ImageDataType::Gray_Gamma16:
-                return new MemoryNonlinearGray16Image(w, h, m);
+                return NewImage<MemoryNonlinearGray16Image, FileMappedNonlinearGray16Image>(fileBacked, w, h, m);
             case ImageDataType::GrayA_Gamma8:
-                return new MemoryNonlinearGrayA8Image(w, h, m);
+                return NewImage<MemoryNonlinearGrayA8Image, FileMappedNonlinearGrayA8Image>(fileBacked, w, h, m);
             case ImageDataType::GrayA_Gamma16:
-                return new MemoryNonlinearGrayA16Image(w, h, m);
+                return NewImage<MemoryNonlinearGrayA16Image, FileMappedNonlinearGrayA16Image>(fileBacked, w, h, m);
             default:
                 throw POV_EXCEPTION_STRING("Image::Create Exception TODO"); // TODO FIXME WIP
         }
@@ -3847,52 +3993,55 @@ Image *Image::Create(unsigned int w, unsigned int h, ImageDataType t, const vect
 
 Image *Image::Create(unsigned int w, unsigned int h, ImageDataType t, const vector<RGBFTMapEntry>& m, bool allowFileBacking)
 {
+    bool fileBacked = UseFileBacking(w, h, t, allowFileBacking);
+
     try
     {
         switch(t)
         {
             case ImageDataType::Bit_Map:
-                return new MemoryBitMapImage(w, h, m);
+                return NewImage<MemoryBitMapImage, FileMappedBitMapImage>(fileBacked, w, h, m);
             case ImageDataType::Colour_Map:
-                return new MemoryColourMapImage(w, h, m);
+                return NewImage<MemoryColourMapImage, FileMappedColourMapImage>(fileBacked, w, h, m);
             case ImageDataType::Gray_Int8:
-                return new MemoryGray8Image(w, h, m);
+                return NewImage<MemoryGray8Image, FileMappedGray8Image>(fileBacked, w, h, m);
             case ImageDataType::Gray_Int16:
-                return new MemoryGray16Image(w, h, m);
+                return NewImage<MemoryGray16Image, FileMappedGray16Image>(fileBacked, w, h, m);
             case ImageDataType::GrayA_Int8:
-                return new MemoryGrayA8Image(w, h, m);
+                return NewImage<MemoryGrayA8Image, FileMappedGrayA8Image>(fileBacked, w, h, m);
             case ImageDataType::GrayA_Int16:
-                return new MemoryGrayA16Image(w, h, m);
+                return NewImage<MemoryGrayA16Image, FileMappedGrayA16Image>(fileBacked, w, h, m);
             case ImageDataType::RGB_Int8:
-                return new MemoryRGB8Image(w, h, m);
+                return NewImage<MemoryRGB8Image, FileMappedRGB8Image>(fileBacked, w, h, m);
             case ImageDataType::RGB_Int16:
-                return new MemoryRGB16Image(w, h, m);
+                return NewImage<MemoryRGB16Image, FileMappedRGB16Image>(fileBacked, w, h, m);
             case ImageDataType::RGBA_Int8:
-                return new MemoryRGBA8Image (w, h, m);
+                return NewImage<MemoryRGBA8Image, FileMappedRGBA8Image>(fileBacked, w, h, m);
             case ImageDataType::RGBA_Int16:
-                return new MemoryRGBA16Image(w, h, m);
-            case ImageDataType::RGBFT_Float:
-#ifdef FILE_MAPPED_IMAGE_ALLOCATOR
-                if (allowFileBacking)
-                    return new RGBFTImage<FILE_MAPPED_IMAGE_ALLOCATOR<float>>(w, h, m);
+                return NewImage<MemoryRGBA16Image, FileMappedRGBA16Image>(fileBacked, w, h, m);
+            case ImageDataType::RGBFT_Half:
+#ifndef OPENEXR_MISSING
+                return NewImage<MemoryRGBFTHalfImage, FileMappedRGBFTHalfImage>(fileBacked, w, h, m);
 #endif
-                return new MemoryRGBFTImage(w, h, m);
+                // without OpenEXR support, fall back to single precision
+            case ImageDataType::RGBFT_Float:
+                return NewImage<MemoryRGBFTImage, FileMappedRGBFTImage>(fileBacked, w, h, m);
             case ImageDataType::RGB_Gamma8:
-                return new MemoryNonlinearRGB8Image(w, h, m);
+                return NewImage<MemoryNonlinearRGB8Image, FileMappedNonlinearRGB8Image>(fileBacked, w, h, m);
             case ImageDataType::RGB_Gamma16:
-                return new MemoryNonlinearRGB16Image(w, h, m);
+                return NewImage<MemoryNonlinearRGB16Image, FileMappedNonlinearRGB16Image>(fileBacked, w, h, m);
             case ImageDataType::RGBA_Gamma8:
-                return new MemoryNonlinearRGBA8Image (w, h, m);
+                return NewImage<MemoryNonlinearRGBA8Image, FileMappedNonlinearRGBA8Image>(fileBacked, w, h, m);
             case ImageDataType::RGBA_Gamma16:
-                return new MemoryNonlinearRGBA16Image(w, h, m);
+                return NewImage<MemoryNonlinearRGBA16Image, FileMappedNonlinearRGBA16Image>(fileBacked, w, h, m);
             case ImageDataType::Gray_Gamma8:
-                return new MemoryNonlinearGray8Image(w, h, m);
+                return NewImage<MemoryNonlinearGray8Image, FileMappedNonlinearGray8Image>(fileBacked, w, h, m);
             case ImageDataType::Gray_Gamma16:
-                return new MemoryNonlinearGray16Image(w, h, m);
+                return NewImage<MemoryNonlinearGray16Image, FileMappedNonlinearGray16Image>(fileBacked, w, h, m);
             case ImageDataType::GrayA_Gamma8:
-                return new MemoryNonlinearGrayA8Image(w, h, m);
+                return NewImage<MemoryNonlinearGrayA8Image, FileMappedNonlinearGrayA8Image>(fileBacked, w, h, m);
             case ImageDataType::GrayA_Gamma16:
-                return new MemoryNonlinearGrayA16Image(w, h, m);
+                return NewImage<MemoryNonlinearGrayA16Image, FileMappedNonlinearGrayA16Image>(fileBacked, w, h, m);
             default:
                 throw POV_EXCEPTION_STRING("Image::Create Exception TODO"); // TODO FIXME WIP
         }
@@ -4086,6 +4235,41 @@ following built-in formats: TGA, PPM, BMP.");
     }
 }
 
+ImageStreamWriter *Image::CreateStreamWriter(ImageFileType type, OStream *file, const Image *image, const ImageWriteOptions& options)
+{
+    if (image->GetWidth() == 0 || image->GetHeight() == 0)
+        throw POV_EXCEPTION(kParamErr, "Invalid image size for output");
+
+    if (file == nullptr)
+        throw POV_EXCEPTION(kCannotOpenFileErr, "Invalid image file");
+
+#ifdef POV_SYS_IMAGE_TYPE
+    if (type == SYS)
+        type = POV_SYS_IMAGE_TYPE;
+#endif
+
+    switch (type)
+    {
+        case EXR:
+#ifndef OPENEXR_MISSING
+            return OpenEXR::CreateStreamWriter(file, image, options);
+#else
+            return nullptr;
+#endif
+
+        case PNG:
+#ifndef LIBPNG_MISSING
+            return Png::CreateStreamWriter(file, image, options);
+#else
+            return nullptr;
+#endif
+
+        default:
+            // File format has no progressive writer (yet); caller needs to fall back to Write().
+            return nullptr;
+    }
+}
+
 void Image::GetRGBIndexedValue(unsigned char index, float& red, float& green, float& blue) const
 {
     switch(colormaptype)
@@ -87,6 +87,8 @@ enum class ImageDataType : int
     Gray_Gamma16,   ///< Single-channel (grayscale) image using 16-bit gamma encoding.
     GrayA_Gamma8,   ///< Dual-channel (grayscale and alpha) image using 8-bit gamma greyscale encoding and 8-bit linear alpha encoding.
     GrayA_Gamma16,  ///< Dual-channel (grayscale and alpha) image using 16-bit gamma greyscale encoding and 16-bit linear alpha encoding.
+    RGBFT_Half,     ///< 5-channel (colour, filter and transmit) image using half-precision floating-point encoding.
+                    ///< @note Falls back to @ref RGBFT_Float if OpenEXR support is not compiled in.
 };
 
 /// The mode to use for alpha handling.
@@ -181,6 +183,12 @@ struct ImageWriteOptions final
     ///     use compression, or for which POV-Ray's implementation leaves no choice.
     signed short compression;
 
+    /// Maximum number of threads to use for encoding.
+    /// @note
+    ///     This setting is ignored with file formats for which POV-Ray's implementation
+    ///     does not support parallel encoding.
+    unsigned int threads;
+
     /// Whether to write a greyscale image.
     /// @note
     ///     This setting is ignored with file formats that do not support a dedicated
@@ -316,16 +324,35 @@ class Image
         static ImageDataType GetImageDataType(int minBitsPerChannel, int colourChannels, bool alpha, GammaCurvePtr gamma);
 
         static Image *Create(unsigned int w, unsigned int h, ImageDataType t, unsigned int maxRAMmbHint, unsigned int pixelsPerBlockHint);
-        static Image *Create(unsigned int w, unsigned int h, ImageDataType t, bool allowFileBacking = false);
-        static Image *Create(unsigned int w, unsigned int h, ImageDataType t, const std::vector<RGBMapEntry>& m, bool allowFileBacking = false);
-        static Image *Create(unsigned int w, unsigned int h, ImageDataType t, const std::vector<RGBAMapEntry>& m, bool allowFileBacking = false);
-        static Image *Create(unsigned int w, unsigned int h, ImageDataType t, const std::vector<RGBFTMapEntry>& m, bool allowFileBacking = false);
+        static Image *Create(unsigned int w, unsigned int h, ImageDataType t, bool allowFileBacking = true);
+        static Image *Create(unsigned int w, unsigned int h, ImageDataType t, const std::vector<RGBMapEntry>& m, bool allowFileBacking = true);
+        static Image *Create(unsigned int w, unsigned int h, ImageDataType t, const std::vector<RGBAMapEntry>& m, bool allowFileBacking = true);
+        static Image *Create(unsigned int w, unsigned int h, ImageDataType t, const std::vector<RGBFTMapEntry>& m, bool allowFileBacking = true);
+
+        /// Set the size above which image data is placed in file-backed memory.
+        ///
+        /// This setting affects all images subsequently created with `allowFileBacking` set.
+        /// Such images are backed by sparse temporary files, so that the operating system can page
+        /// them out without consuming RAM or swap space.
+        ///
+        /// @param  bytes   Minimum size of image data to place in file-backed memory, or 0 to disable.
+        ///
+        static void SetFileBackingThreshold(POV_ULONG bytes);
 
         // ftype = use this image type, if "Undefined" use best match
         static Image *Read(ImageFileType ftype, IStream *file, const ImageReadOptions& options = ImageReadOptions());
 
         static void Write(ImageFileType ftype, OStream *file, const Image *image, const ImageWriteOptions& options = ImageWriteOptions());
 
+        /// Create a writer to output an image file progressively.
+        ///
+        /// @param  ftype   Image file type.
+        /// @param  file    File to write to; must remain valid until the writer is destroyed.
+        /// @param  image   Image providing the dimensions and data type of the data to write.
+        /// @param  options Image write options.
+        /// @return         A new writer, or `nullptr` if the file type cannot be written progressively.
+        static ImageStreamWriter *CreateStreamWriter(ImageFileType ftype, OStream *file, const Image *image, const ImageWriteOptions& options = ImageWriteOptions());
+
         unsigned int GetWidth() const { return width; }
         unsigned int GetHeight() const { return height; }
         ImageDataType GetImageDataType() const { return type; }
@@ -491,6 +518,27 @@ class Image
         Image& operator=(Image&) = delete;
 };
 
+/// Abstract class representing an image file being written progressively.
+///
+/// Rows must be supplied in top-to-bottom order, each exactly once. The image passed to
+/// @ref WriteRows() only needs to hold valid data for the rows specified.
+///
+class ImageStreamWriter
+{
+    public:
+
+        virtual ~ImageStreamWriter() {}
+
+        /// Encode and write a range of rows.
+        /// @param  image       Image to read the data from.
+        /// @param  firstRow    First row to write.
+        /// @param  rowCount    Number of rows to write.
+        virtual void WriteRows(const Image *image, unsigned int firstRow, unsigned int rowCount) = 0;
+
+        /// Complete the file once all rows have been written.
+        virtual void Finish() = 0;
+};
+
 /// @}
 ///
 //##############################################################################
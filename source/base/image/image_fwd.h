@@ -43,7 +43,9 @@
 namespace pov_base
 {
 
+enum class ImageDataType : int;
 class Image;
+class ImageStreamWriter;
 struct ImageReadOptions;
 struct ImageWriteOptions;
 
@@ -0,0 +1,214 @@
+//******************************************************************************
+///
+/// @file base/image/imagecache.cpp
+///
+/// Process-wide cache of decoded image files.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+// Unit header file must be the first file included within POV-Ray *.cpp files (pulls in config)
+#include "base/image/imagecache.h"
+
+// C++ variants of C standard header files
+//  (none at the moment)
+
+// C++ standard header files
+#include <list>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// POV-Ray header files (base module)
+#include "base/fileinputoutput.h"
+
+// this must be the last file included
+#include "base/povdebug.h"
+
+namespace pov_base
+{
+
+/// Decoded image along with everything that determined its content.
+struct ImageCacheEntry final
+{
+    POV_UINT64                  hash;
+    size_t                      size;
+    Image::ImageFileType        type;
+    ImageReadOptions            options;    ///< Options decoded with; `warnings` is not used.
+    std::vector<std::string>    warnings;   ///< Warnings issued when decoding.
+    std::shared_ptr<Image>      image;
+    POV_ULONG                   memory;
+};
+
+/// Process-wide cache of decoded images, most recently used first.
+struct ImageCache final
+{
+    std::mutex                  mutex;
+    std::list<ImageCacheEntry>  entries;
+    POV_ULONG                   memory;
+    POV_ULONG                   limit;
+
+    ImageCache() : memory(0), limit(0) {}
+
+    void Trim();
+};
+
+/// The cache is intentionally never destroyed, as the images it holds may still be referenced
+/// by scenes during static de-initialization.
+static ImageCache& gImageCache = *(new ImageCache); // GLOBAL VARIABLE
+
+/// Discard least recently used images until the cache fits its limit; the mutex must be held.
+void ImageCache::Trim()
+{
+    while ((memory > limit) && !entries.empty())
+    {
+        memory -= entries.back().memory;
+        entries.pop_back();
+    }
+}
+
+/// Check whether two sets of read options give identical decoding results.
+static bool SameOptions(const ImageReadOptions& a, const ImageReadOptions& b)
+{
+    // Gamma curves are compared by identity; equivalent curves are normally the same instance anyway.
+    return (a.itype                 == b.itype) &&
+           (a.defaultGamma          == b.defaultGamma) &&
+           (a.workingGamma          == b.workingGamma) &&
+           (a.gammaOverride         == b.gammaOverride) &&
+           (a.gammacorrect          == b.gammacorrect) &&
+           (a.premultipliedOverride == b.premultipliedOverride) &&
+           (a.premultiplied         == b.premultiplied);
+}
+
+/// Compute a 64-bit FNV-1a hash of a file's contents.
+static POV_UINT64 HashImageData(const std::vector<unsigned char>& data)
+{
+    POV_UINT64 hash = 0xCBF29CE484222325ull;
+    for (unsigned char c : data)
+    {
+        hash ^= c;
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+std::shared_ptr<Image> ReadCachedImage(Image::ImageFileType type, IStream *file, const ImageReadOptions& options)
+{
+    {
+        std::lock_guard<std::mutex> lock(gImageCache.mutex);
+        if (gImageCache.limit == 0)
+            return std::shared_ptr<Image>(Image::Read(type, file, options));
+    }
+
+    std::vector<unsigned char> data;
+    unsigned char buffer[65536];
+    size_t count;
+    while ((count = file->readUpTo(buffer, sizeof(buffer))) > 0)
+        data.insert(data.end(), buffer, buffer + count);
+
+    POV_UINT64 hash = HashImageData(data);
+
+    {
+        std::lock_guard<std::mutex> lock(gImageCache.mutex);
+        for (auto i = gImageCache.entries.begin(); i != gImageCache.entries.end(); ++i)
+        {
+            if ((i->hash == hash) && (i->size == data.size()) && (i->type == type) && SameOptions(i->options, options))
+            {
+                gImageCache.entries.splice(gImageCache.entries.begin(), gImageCache.entries, i);
+                options.warnings.insert(options.warnings.end(), i->warnings.begin(), i->warnings.end());
+                return i->image;
+            }
+        }
+    }
+
+    // Decode outside the lock; should another thread be decoding the same file, we just end up
+    // with two copies, only one of which is kept.
+    size_t warningCount = options.warnings.size();
+    IMemStream memStream(data.data(), data.size(), file->Name());
+    std::shared_ptr<Image> image(Image::Read(type, &memStream, options));
+
+    if ((image == nullptr) || image->IsIndexed())
+        return image;
+
+    ImageCacheEntry entry;
+    entry.hash      = hash;
+    entry.size      = data.size();
+    entry.type      = type;
+    entry.options   = options;
+    entry.options.warnings.clear();
+    entry.warnings.assign(options.warnings.begin() + warningCount, options.warnings.end());
+    entry.image     = image;
+    entry.memory    = EstimateImageMemory(image.get());
+
+    std::lock_guard<std::mutex> lock(gImageCache.mutex);
+    if (entry.memory <= gImageCache.limit)
+    {
+        gImageCache.memory += entry.memory;
+        gImageCache.entries.push_front(std::move(entry));
+        gImageCache.Trim();
+    }
+
+    return image;
+}
+
+void SetImageCacheSize(POV_ULONG bytes)
+{
+    std::lock_guard<std::mutex> lock(gImageCache.mutex);
+    gImageCache.limit = bytes;
+    gImageCache.Trim();
+}
+
+POV_ULONG EstimateImageMemory(const Image *image)
+{
+    unsigned int bytesPerChannel;
+    unsigned int channels;
+
+    if (image->IsFloat())
+        bytesPerChannel = sizeof(float);
+    else if (image->GetMaxIntValue() > 255)
+        bytesPerChannel = 2;
+    else
+        bytesPerChannel = 1;
+
+    if (image->IsIndexed())
+        channels = 1;
+    else
+    {
+        channels = image->IsColour() ? 3 : 1;
+        if (image->HasFilterTransmit())
+            channels += 2;
+        else if (image->HasAlphaChannel())
+            channels += 1;
+    }
+
+    return static_cast<POV_ULONG>(image->GetWidth()) * image->GetHeight() * channels * bytesPerChannel;
+}
+
+}
+// end of namespace pov_base
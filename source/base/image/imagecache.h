@@ -0,0 +1,102 @@
+//******************************************************************************
+///
+/// @file base/image/imagecache.h
+///
+/// Process-wide cache of decoded image files.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+#ifndef POVRAY_BASE_IMAGECACHE_H
+#define POVRAY_BASE_IMAGECACHE_H
+
+// Module config header file must be the first file included within POV-Ray unit header files
+#include "base/configbase.h"
+
+// C++ variants of C standard header files
+//  (none at the moment)
+
+// C++ standard header files
+#include <memory>
+
+// POV-Ray header files (base module)
+#include "base/fileinputoutput_fwd.h"
+#include "base/image/image.h"
+
+namespace pov_base
+{
+
+//##############################################################################
+///
+/// @addtogroup PovBaseImage
+///
+/// @{
+
+/// Read an image file, sharing decoded images via a process-wide cache.
+///
+/// While the cache is enabled, the whole file is read and hashed first, and only decoded if
+/// no image decoded from identical file content with identical options is cached. Warnings
+/// issued when the image was first decoded are reported again on each cache hit.
+///
+/// Indexed images are never cached, as the parser modifies their colour maps.
+///
+/// @note
+///     Images obtained from the cache may be shared with other scenes, and must not be
+///     modified.
+///
+/// @param[in]  type        Image file format.
+/// @param[in]  file        Stream to read from.
+/// @param[in]  options     Options to decode with; warnings are appended.
+/// @return                 The decoded image.
+///
+std::shared_ptr<Image> ReadCachedImage(Image::ImageFileType type, IStream *file, const ImageReadOptions& options);
+
+/// Set the maximum memory held by the image cache, in bytes.
+///
+/// Least recently used images are discarded to honour the limit. A limit of 0 disables the
+/// cache and discards all cached images. Images still in use by a scene are only freed once
+/// the scene lets go of them.
+///
+void SetImageCacheSize(POV_ULONG bytes);
+
+/// Estimate the memory occupied by the pixel data of an image, in bytes.
+///
+/// The image classes do not track their allocations, so the size is estimated from the pixel
+/// format.
+///
+POV_ULONG EstimateImageMemory(const Image *image);
+
+/// @}
+///
+//##############################################################################
+
+}
+// end of namespace pov_base
+
+#endif // POVRAY_BASE_IMAGECACHE_H
@@ -39,17 +39,20 @@
 #ifndef OPENEXR_MISSING
 
 // C++ variants of C standard header files
-//  (none at the moment)
+#include <cstddef>
 
 // C++ standard header files
+#include <algorithm>
 #include <memory>
 #include <string>
+#include <vector>
 
 // Other 3rd party header files
 #include <ImfRgbaFile.h>
 #include <ImfStringAttribute.h>
 #include <ImfMatrixAttribute.h>
 #include <ImfArray.h>
+#include <ImfThreading.h>
 
 // POV-Ray header files (base module)
 #include "base/fileinputoutput.h"
@@ -219,34 +222,49 @@ Image *Read(IStream *file, const ImageReadOptions& options)
     return image;
 }
 
-void Write(OStream *file, const Image *image, const ImageWriteOptions& options)
+/// Writer for OpenEXR output files.
+///
+/// Scanlines are converted and handed to the OpenEXR library in top-to-bottom order as they are
+/// supplied, so that the image can be written in one go as well as progressively while it is being
+/// rendered.
+///
+class StreamWriter final : public ImageStreamWriter
+{
+    public:
+
+        StreamWriter(OStream *file, const Image *image, const ImageWriteOptions& options);
+        virtual ~StreamWriter() override;
+
+        virtual void WriteRows(const Image *image, unsigned int firstRow, unsigned int rowCount) override;
+        virtual void Finish() override;
+
+    private:
+
+        POV_EXR_OStream                 os;
+        std::unique_ptr<RgbaOutputFile> rof;
+        std::vector<Rgba>               pixels;
+        GammaCurvePtr                   gamma;
+        int                             width;
+        bool                            use_alpha;
+        bool                            premul;
+};
+
+StreamWriter::StreamWriter(OStream *file, const Image *image, const ImageWriteOptions& options) :
+    os(*file),
+    width(image->GetWidth()),
+    use_alpha(image->HasTransparency() && options.AlphaIsEnabled())
 {
-    int width = image->GetWidth();
     int height = image->GetHeight();
-    bool use_alpha = image->HasTransparency() && options.AlphaIsEnabled();
     float pixelAspect = 1.0;
     Header hdr(width, height, pixelAspect, Imath::V2f(0, 0), 1.0, INCREASING_Y, ZIP_COMPRESSION);
-    std::unique_ptr<Rgba[]> pixels(new Rgba[width * height]);
-    Rgba *p = pixels.get();
 
     // OpenEXR format mandates that colours are encoded linearly.
-    GammaCurvePtr gamma = TranscodingGammaCurve::Get(options.workingGamma, NeutralGammaCurve::Get());
+    gamma = TranscodingGammaCurve::Get(options.workingGamma, NeutralGammaCurve::Get());
 
     // OpenEXR officially uses premultiplied alpha, so that's the way we do it unless the user overrides
     // (e.g. to handle a non-compliant file).
-    bool premul = options.AlphaIsPremultiplied(true);
-
-    for(int row = 0; row < height; row++)
-    {
-        for(int col = 0; col < width; col++)
-        {
-            float r, g, b, a;
-            GetEncodedRGBAValue(image, col, row, gamma, r, g, b, a, premul);
-            *p++ = Rgba(r, g, b, use_alpha ? a : 1.0f);
-        }
-    }
+    premul = options.AlphaIsPremultiplied(true);
 
-    POV_EXR_OStream os(*file);
     try
     {
         Imf::RgbaChannels channels;
@@ -280,9 +298,13 @@ void Write(OStream *file, const Image *image, const ImageWriteOptions& options)
         hdr.insert("software",StringAttribute(software));
         hdr.insert("creation",StringAttribute(datetime));
 
-        RgbaOutputFile rof(os, hdr, channels);
-        rof.setFrameBuffer(pixels.get(), 1, width);
-        rof.writePixels(height);
+        // Have OpenEXR compress line buffers in parallel. The worker pool is shared by the whole
+        // process, so we only ever grow it.
+        int threads = int(std::max(options.threads, 1u));
+        if ((threads > 1) && (globalThreadCount() < threads))
+            setGlobalThreadCount(threads);
+
+        rof.reset(new RgbaOutputFile(os, hdr, channels, threads));
     }
     catch(const std::exception& e)
     {
@@ -290,6 +312,69 @@ void Write(OStream *file, const Image *image, const ImageWriteOptions& options)
     }
 }
 
+StreamWriter::~StreamWriter()
+{
+    try
+    {
+        rof.reset();
+    }
+    catch(const std::exception&)
+    {
+        // Nothing we can do about it at this point; Finish() would have reported the error.
+    }
+}
+
+void StreamWriter::WriteRows(const Image *image, unsigned int firstRow, unsigned int rowCount)
+{
+    pixels.resize(width * rowCount);
+    Rgba *p = pixels.data();
+
+    for(unsigned int row = firstRow; row < firstRow + rowCount; row++)
+    {
+        for(int col = 0; col < width; col++)
+        {
+            float r, g, b, a;
+            GetEncodedRGBAValue(image, col, row, gamma, r, g, b, a, premul);
+            *p++ = Rgba(r, g, b, use_alpha ? a : 1.0f);
+        }
+    }
+
+    try
+    {
+        // The frame buffer is addressed in image coordinates, so we need to offset its origin accordingly.
+        rof->setFrameBuffer(pixels.data() - std::ptrdiff_t(firstRow) * width, 1, width);
+        rof->writePixels(rowCount);
+    }
+    catch(const std::exception& e)
+    {
+        throw POV_EXCEPTION(kFileDataErr, e.what());
+    }
+}
+
+void StreamWriter::Finish()
+{
+    try
+    {
+        rof.reset();
+    }
+    catch(const std::exception& e)
+    {
+        throw POV_EXCEPTION(kFileDataErr, e.what());
+    }
+}
+
+void Write(OStream *file, const Image *image, const ImageWriteOptions& options)
+{
+    StreamWriter writer(file, image, options);
+    writer.WriteRows(image, 0, image->GetHeight());
+    writer.Finish();
+}
+
+ImageStreamWriter *CreateStreamWriter(OStream *file, const Image *image, const ImageWriteOptions& options)
+{
+    return new StreamWriter(file, image, options);
+}
+
 }
 // end of namespace OpenEXR
 
@@ -61,6 +61,7 @@ namespace OpenEXR
 /// @{
 
 void Write(OStream *file, const Image *image, const ImageWriteOptions& options);
+ImageStreamWriter *CreateStreamWriter(OStream *file, const Image *image, const ImageWriteOptions& options);
 Image *Read(IStream *file, const ImageReadOptions& options);
 
 /// @}
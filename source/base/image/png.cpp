@@ -44,15 +44,19 @@
 #ifndef LIBPNG_MISSING
 
 // C++ variants of C standard header files
-//  (none at the moment)
+#include <cstddef>
+#include <cstdlib>
 
 // C++ standard header files
+#include <algorithm>
 #include <string>
 #include <memory>
+#include <thread>
 #include <vector>
 
 // other 3rd party library header files
 #include <png.h>
+#include <zlib.h>
 
 // POV-Ray header files (base module)
 #include "base/fileinputoutput.h"
@@ -85,6 +89,12 @@ const int FLUSH_DIST = 16; // Set to 16 and removed complicated math [trf]
 const int NTEXT = 15;      // Maximum number of tEXt comment blocks
 const int MAXTEXT = 1024;  // Maximum length of a tEXt message
 
+/* Approximate size of the strips of image data that are filtered and compressed
+ * independently when encoding in parallel.  Each strip restarts compression with
+ * an empty dictionary, so making it much smaller will degrade compression.
+ */
+const std::size_t PARALLEL_STRIP_SIZE = 1024 * 1024;
+
 
 /*****************************************************************************
 * Local typedefs
@@ -649,41 +659,76 @@ void SetChannelValue(png_bytep& p, unsigned int v, unsigned int bpcc)
     *(p++) = (v & 0xFF);
 }
 
-void Write (OStream *file, const Image *image, const ImageWriteOptions& options)
+/// Writer for PNG output files.
+///
+/// Rows are encoded and handed to libpng in top-to-bottom order as they are supplied, so that the
+/// image can be written in one go as well as progressively while it is being rendered.
+///
+class StreamWriter final : public ImageStreamWriter
+{
+    public:
+
+        StreamWriter(OStream *file, const Image *image, const ImageWriteOptions& options, bool progressive);
+        virtual ~StreamWriter() override;
+
+        virtual void WriteRows(const Image *image, unsigned int firstRow, unsigned int rowCount) override;
+        virtual void Finish() override;
+
+        /// Write the entire image and finish the file, filtering and compressing the
+        /// image data in parallel.
+        void WriteParallel(const Image *image, unsigned int threads);
+
+    private:
+
+        void EncodeRows(unsigned int firstRow, unsigned int rowCount, png_byte *p, std::size_t rowBytes);
+        void WriteChunk(const char *name, const png_byte *data, std::size_t size);
+
+        ImageWriteOptions           mOptions;
+        png_info                    *info_ptr;
+        png_struct                  *png_ptr;
+        Messages                    messages;
+        GammaCurvePtr               gamma;
+        int                         width;
+        int                         bpcc;
+        bool                        use_alpha;
+        bool                        use_color;
+        bool                        premul;
+        unsigned int                maxValue;
+        unsigned int                mult;
+        unsigned int                shift;
+        int                         png_stride;
+        std::unique_ptr<png_byte[]> row_ptr;
+        std::unique_ptr<ImageRowEncoder> encoder;
+        std::vector<unsigned int>   encoded;
+};
+
+StreamWriter::StreamWriter(OStream *file, const Image *image, const ImageWriteOptions& options, bool progressive) :
+    mOptions(options),
+    info_ptr(nullptr),
+    png_ptr(nullptr),
+    width(image->GetWidth()),
+    bpcc(options.bitsPerChannel),
+    use_alpha(image->HasTransparency() && options.AlphaIsEnabled())
 {
-    int             png_stride;
-    int             width = image->GetWidth() ;
     int             height = image->GetHeight() ;
-    int             bpcc = options.bitsPerChannel;
-    bool            use_alpha = image->HasTransparency() && options.AlphaIsEnabled();
-    unsigned int    octetDepth = ((bpcc + 7) / 8);
-    unsigned int    bitDepth = 8 * octetDepth;
-    unsigned int    alpha;
-    unsigned int    r;
-    unsigned int    g;
-    unsigned int    b;
-    unsigned int    maxValue;
-    unsigned int    mult;
-    unsigned int    shift;
-    png_info        *info_ptr = nullptr;
-    png_struct      *png_ptr  = nullptr;
-    Messages        messages;
-    GammaCurvePtr   gamma;
+    unsigned int    octetDepth;
+    unsigned int    bitDepth;
     Metadata        meta;
-    DitherStrategy& dither = *options.ditherStrategy;
 
     // PNG/W3C recommends to use sRGB color space
     gamma = options.GetTranscodingGammaCurve(SRGBGammaCurve::Get());
 
     // PNG is specified to use non-premultiplied alpha, so that's the way we do it unless the user overrides
     // (e.g. to handle a non-compliant file).
-    bool premul = options.AlphaIsPremultiplied(false);
+    premul = options.AlphaIsPremultiplied(false);
 
     if (bpcc <= 0)
         bpcc = image->GetMaxIntValue() == 65535 ? 16 : 8 ;
     else if (bpcc > 16)
         bpcc = 16 ;
 
+    octetDepth = ((bpcc + 7) / 8);
+    bitDepth = 8 * octetDepth;
     maxValue = (1<<bpcc)-1;
 
     if ((png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, (png_voidp)(&messages), png_pov_err, png_pov_warn)) == nullptr)
@@ -701,7 +746,11 @@ void Write (OStream *file, const Image *image, const ImageWriteOptions& options)
     // Set up the compression structure
     png_set_write_fn (png_ptr, file, png_pov_write_data, png_pov_flush_data);
 
-    bool use_color = !(image->IsGrayscale() | options.grayscale);
+    // When writing progressively, make sure an interrupted render leaves a usable partial file.
+    if (progressive)
+        png_set_flush(png_ptr, FLUSH_DIST);
+
+    use_color = !(image->IsGrayscale() | options.grayscale);
 
     // Fill in the relevant image information
     png_set_IHDR(png_ptr, info_ptr,
@@ -775,7 +824,7 @@ void Write (OStream *file, const Image *image, const ImageWriteOptions& options)
         png_stride++;
     png_stride *= octetDepth;
 
-    std::unique_ptr<png_byte[]> row_ptr(new png_byte[width*png_stride]);
+    row_ptr.reset(new png_byte[width*png_stride]);
 
     int repeat = (bitDepth + bpcc - 1) / bpcc;
     shift = (bpcc * repeat) - bitDepth;
@@ -783,34 +832,36 @@ void Write (OStream *file, const Image *image, const ImageWriteOptions& options)
     for (int i = 1; i < repeat; ++i)
         mult = (mult << bpcc) | 0x01;
 
-    for (int row = 0 ; row < height ; row++)
-    {
-        auto p = row_ptr.get();
-        for (int col = 0; col < width; ++col)
-        {
-            if (use_color && use_alpha)
-                GetEncodedRGBAValue(image, col, row, gamma, maxValue, r, g, b, alpha, dither, premul);
-            else if (use_color)
-                GetEncodedRGBValue(image, col, row, gamma, maxValue, r, g, b, dither);
-            else if (use_alpha)
-                GetEncodedGrayAValue(image, col, row, gamma, maxValue, g, alpha, dither, premul);
-            else
-                g = GetEncodedGrayValue(image, col, row, gamma, maxValue, dither);
+    encoder.reset(new ImageRowEncoder(image, gamma, maxValue, use_color, use_alpha, premul, *options.ditherStrategy, options.threads));
+}
 
-            if (use_color)
-            {
-                SetChannelValue(p, (r * mult) >> shift, bpcc);
-                SetChannelValue(p, (g * mult) >> shift, bpcc);
-                SetChannelValue(p, (b * mult) >> shift, bpcc);
-            }
-            else
-            {
-                SetChannelValue(p, (g * mult) >> shift, bpcc);
-            }
+StreamWriter::~StreamWriter()
+{
+    if (png_ptr != nullptr)
+        png_destroy_write_struct(&png_ptr, &info_ptr);
+}
 
-            if (use_alpha)
-                SetChannelValue(p, (alpha * mult) >> shift, bpcc);
-        }
+void StreamWriter::EncodeRows(unsigned int firstRow, unsigned int rowCount, png_byte *p, std::size_t rowBytes)
+{
+    std::size_t rowValues = std::size_t(width) * encoder->Channels();
+    encoded.resize(rowValues * rowCount);
+    encoder->EncodeRows(firstRow, rowCount, encoded.data());
+
+    const unsigned int *v = encoded.data();
+    for (unsigned int row = 0; row < rowCount; ++row)
+    {
+        png_byte *q = p + row * rowBytes;
+        for (std::size_t i = 0; i < rowValues; ++i)
+            SetChannelValue(q, (v[i] * mult) >> shift, bpcc);
+        v += rowValues;
+    }
+}
+
+void StreamWriter::WriteRows(const Image *image, unsigned int firstRow, unsigned int rowCount)
+{
+    for (unsigned int row = firstRow; row < firstRow + rowCount; row++)
+    {
+        EncodeRows(row, 1, row_ptr.get(), std::size_t(width) * png_stride);
 
         if (setjmp(png_jmpbuf(png_ptr)))
         {
@@ -824,12 +875,223 @@ void Write (OStream *file, const Image *image, const ImageWriteOptions& options)
         // Write out a scanline
         png_write_row (png_ptr, row_ptr.get());
     }
+}
 
+void StreamWriter::Finish()
+{
     if (messages.error.length() > 0)
         throw messages.error.c_str();
 
     png_write_end(png_ptr, info_ptr);
     png_destroy_write_struct(&png_ptr, &info_ptr);
+    png_ptr = nullptr;
+}
+
+/// Strip of image data filtered and compressed independently during parallel encoding.
+struct ParallelStrip final
+{
+    const png_byte          *prior;     ///< Unfiltered row preceding the strip, or `nullptr` if none.
+    const png_byte          *rows;      ///< Unfiltered rows of the strip.
+    std::size_t             rowCount;
+    std::vector<png_byte>   filtered;
+    std::vector<png_byte>   compressed;
+    uLong                   adler;      ///< Adler-32 checksum of the filtered data.
+    bool                    last;       ///< Whether this is the last strip of the image.
+    bool                    ok;
+};
+
+/// Filter a row, choosing the filter type the same way libpng does by default: The one
+/// minimizing the sum of absolute differences, with the filtered octets taken as signed.
+static void FilterRow(const png_byte *row, const png_byte *prior, std::size_t rowBytes, std::size_t bpp,
+                      png_byte *out, std::vector<png_byte>& candidates)
+{
+    candidates.resize(5 * rowBytes);
+    png_byte *f[5];
+    for (int type = 0; type < 5; ++type)
+        f[type] = &candidates[type * rowBytes];
+
+    for (std::size_t i = 0; i < rowBytes; ++i)
+    {
+        int x = row[i];
+        int a = (i >= bpp) ? row[i - bpp] : 0;
+        int b = (prior != nullptr) ? prior[i] : 0;
+        int c = ((i >= bpp) && (prior != nullptr)) ? prior[i - bpp] : 0;
+
+        int pa = std::abs(b - c);
+        int pb = std::abs(a - c);
+        int pc = std::abs(a + b - 2 * c);
+        int paeth = ((pa <= pb) && (pa <= pc)) ? a : (pb <= pc) ? b : c;
+
+        f[0][i] = png_byte(x);
+        f[1][i] = png_byte(x - a);
+        f[2][i] = png_byte(x - b);
+        f[3][i] = png_byte(x - ((a + b) >> 1));
+        f[4][i] = png_byte(x - paeth);
+    }
+
+    int best = 0;
+    std::size_t bestSum = 0;
+    for (int type = 0; type < 5; ++type)
+    {
+        std::size_t sum = 0;
+        for (std::size_t i = 0; i < rowBytes; ++i)
+            sum += (f[type][i] < 128) ? f[type][i] : 256 - f[type][i];
+        if ((type == 0) || (sum < bestSum))
+        {
+            best = type;
+            bestSum = sum;
+        }
+    }
+
+    out[0] = png_byte(best);
+    std::copy(f[best], f[best] + rowBytes, out + 1);
+}
+
+/// Filter and compress a strip of image data as a fragment of a raw deflate stream.
+static void CompressStrip(ParallelStrip& strip, std::size_t rowBytes, std::size_t bpp)
+{
+    std::vector<png_byte> candidates;
+    strip.filtered.resize(strip.rowCount * (rowBytes + 1));
+    const png_byte *prior = strip.prior;
+    for (std::size_t i = 0; i < strip.rowCount; ++i)
+    {
+        const png_byte *row = strip.rows + i * rowBytes;
+        FilterRow(row, prior, rowBytes, bpp, &strip.filtered[i * (rowBytes + 1)], candidates);
+        prior = row;
+    }
+
+    strip.adler = adler32(adler32(0L, Z_NULL, 0), strip.filtered.data(), uInt(strip.filtered.size()));
+
+    z_stream zs;
+    zs.zalloc = Z_NULL;
+    zs.zfree  = Z_NULL;
+    zs.opaque = Z_NULL;
+    strip.ok = false;
+    if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_FILTERED) != Z_OK)
+        return;
+
+    // Leave room for the empty stored block appended by a sync flush.
+    strip.compressed.resize(deflateBound(&zs, uLong(strip.filtered.size())) + 16);
+    zs.next_in   = strip.filtered.data();
+    zs.avail_in  = uInt(strip.filtered.size());
+    zs.next_out  = strip.compressed.data();
+    zs.avail_out = uInt(strip.compressed.size());
+
+    // All but the last strip end on a byte boundary without terminating the stream,
+    // so that the fragments can simply be concatenated.
+    int result = deflate(&zs, strip.last ? Z_FINISH : Z_SYNC_FLUSH);
+    strip.ok = (strip.last ? (result == Z_STREAM_END) : (result == Z_OK)) && (zs.avail_in == 0);
+    strip.compressed.resize(zs.total_out);
+    deflateEnd(&zs);
+}
+
+void StreamWriter::WriteChunk(const char *name, const png_byte *data, std::size_t size)
+{
+    if (setjmp(png_jmpbuf(png_ptr)))
+    {
+        if (messages.error.length() > 0)
+            throw POV_EXCEPTION(kFileDataErr, messages.error.c_str());
+
+        // If we get here, we had a problem writing the file
+        throw POV_EXCEPTION(kFileDataErr, "Cannot write PNG output data");
+    }
+
+    png_write_chunk(png_ptr, reinterpret_cast<png_const_bytep>(name), const_cast<png_bytep>(data), size);
+}
+
+void StreamWriter::WriteParallel(const Image *image, unsigned int threads)
+{
+    std::size_t rowBytes = std::size_t(width) * png_stride;
+    std::size_t bpp = png_stride;
+    unsigned int height = image->GetHeight();
+    std::size_t rowsPerStrip = std::max<std::size_t>(1, PARALLEL_STRIP_SIZE / rowBytes);
+    std::size_t rowsPerBatch = rowsPerStrip * threads;
+
+    // Unfiltered rows of the current batch, preceded by the last row of the previous batch.
+    std::vector<png_byte> raw((std::min<std::size_t>(rowsPerBatch, height) + 1) * rowBytes);
+    std::vector<ParallelStrip> strips;
+    std::vector<std::thread> workers;
+
+    // zlib stream header for a 32k window and default compression level.
+    static const png_byte zlibHeader[2] = { 0x78, 0x9C };
+    bool first = true;
+    uLong adler = adler32(0L, Z_NULL, 0);
+
+    for (unsigned int batchStart = 0; batchStart < height; batchStart += rowsPerBatch)
+    {
+        std::size_t batchRows = std::min<std::size_t>(rowsPerBatch, height - batchStart);
+
+        // Dithering may carry state from one row to the next, so the rows of the batch are
+        // encoded together, leaving it to the encoder to pipeline them across threads.
+        EncodeRows(batchStart, batchRows, &raw[rowBytes], rowBytes);
+
+        strips.clear();
+        for (std::size_t i = 0; i < batchRows; i += rowsPerStrip)
+        {
+            ParallelStrip strip;
+            strip.prior    = ((batchStart + i) > 0) ? &raw[i * rowBytes] : nullptr;
+            strip.rows     = &raw[(i + 1) * rowBytes];
+            strip.rowCount = std::min(rowsPerStrip, batchRows - i);
+            strip.last     = (batchStart + i + strip.rowCount == height);
+            strip.ok       = false;
+            strips.push_back(std::move(strip));
+        }
+
+        workers.clear();
+        for (auto& strip : strips)
+            workers.emplace_back(CompressStrip, std::ref(strip), rowBytes, bpp);
+        for (auto& worker : workers)
+            worker.join();
+
+        for (auto& strip : strips)
+        {
+            if (!strip.ok)
+                throw POV_EXCEPTION(kFileDataErr, "Cannot compress PNG output data");
+
+            adler = adler32_combine(adler, strip.adler, z_off_t(strip.filtered.size()));
+
+            if (first)
+                strip.compressed.insert(strip.compressed.begin(), zlibHeader, zlibHeader + 2);
+            first = false;
+
+            if (strip.last)
+            {
+                for (int shift = 24; shift >= 0; shift -= 8)
+                    strip.compressed.push_back(png_byte((adler >> shift) & 0xFF));
+            }
+
+            WriteChunk("IDAT", strip.compressed.data(), strip.compressed.size());
+        }
+
+        // Keep the last row as the predecessor of the next batch.
+        std::copy(&raw[batchRows * rowBytes], &raw[(batchRows + 1) * rowBytes], raw.begin());
+    }
+
+    if (messages.error.length() > 0)
+        throw POV_EXCEPTION(kFileDataErr, messages.error.c_str());
+
+    // Any ancillary chunks have already been written by png_write_info(), and png_write_end()
+    // would insist on the image data having been written via libpng, so finish the file manually.
+    WriteChunk("IEND", nullptr, 0);
+    png_destroy_write_struct(&png_ptr, &info_ptr);
+    png_ptr = nullptr;
+}
+
+void Write (OStream *file, const Image *image, const ImageWriteOptions& options)
+{
+    StreamWriter writer(file, image, options, false);
+    if (options.threads > 1)
+    {
+        writer.WriteParallel(image, options.threads);
+        return;
+    }
+    writer.WriteRows(image, 0, image->GetHeight());
+    writer.Finish();
+}
+
+ImageStreamWriter *CreateStreamWriter(OStream *file, const Image *image, const ImageWriteOptions& options)
+{
+    return new StreamWriter(file, image, options, true);
 }
 
 }
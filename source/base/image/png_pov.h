@@ -60,6 +60,7 @@ namespace Png
 /// @{
 
 void Write(OStream *file, const Image *image, const ImageWriteOptions& options);
+ImageStreamWriter *CreateStreamWriter(OStream *file, const Image *image, const ImageWriteOptions& options);
 Image *Read(IStream *file, const ImageReadOptions& options);
 
 /// @}
@@ -49,7 +49,8 @@
 #include <cstring>
 
 // C++ standard header files
-//  (none at the moment)
+#include <atomic>
+#include <string>
 
 // POV-Ray header files (base module)
 #include "base/pov_err.h"
@@ -248,6 +249,9 @@ number of calls to malloc/free and some other statistics.
 
 static int leak_msg = false; // GLOBAL VARIABLE
 
+// Bytes allocated or reallocated by the current thread, for profiling purposes.
+static thread_local POV_ULONG allocated_bytes = 0;
+
 
 #ifdef MEM_HEADER
     const int NODESIZE = (((sizeof(MEMNODE) + (MEM_HEADER_ALIGNMENT - 1)) / MEM_HEADER_ALIGNMENT) * MEM_HEADER_ALIGNMENT);
@@ -337,6 +341,8 @@ void *pov_malloc(size_t size, const char *file, int line, const char *msg)
     if (block == nullptr)
         throw std::bad_alloc();; // TODO FIXME !!! // Parser::MAError(msg, (int)size);
 
+    allocated_bytes += size;
+
 #if defined(MEM_HEADER)
     node = reinterpret_cast<MEMNODE *>(block);
 #endif
@@ -461,6 +467,8 @@ void *pov_realloc(void *ptr, size_t size, const char *file, int line, const char
     if (block == nullptr)
         throw std::bad_alloc(); // TODO FIXME !!! // Parser::MAError(msg, (int)size);
 
+    allocated_bytes += size;
+
 #if defined(MEM_PREFILL)
     memptr = reinterpret_cast<char *>(block) + NODESIZE + MEM_GUARD_SIZE;
     for(i = oldsize - NODESIZE - (MEM_GUARD_SIZE * 2); i < size; i++)
@@ -724,6 +732,90 @@ char *pov_strdup(const char *s)
     return (New);
 }
 
+/****************************************************************************/
+/* Total number of bytes allocated or reallocated by the current thread    */
+/****************************************************************************/
+POV_ULONG pov_mem_allocated_bytes()
+{
+    return allocated_bytes;
+}
+
+/****************************************************************************/
+/* Memory accounting by subsystem                                           */
+/****************************************************************************/
+
+static const char *memory_subsystem_names[kMemory_SubsystemCount] =
+{
+    "Bounding hierarchies",
+    "Mesh data",
+    "Image maps",
+    "Photon maps",
+    "Radiosity cache",
+    "Parser symbols",
+};
+
+static std::atomic<POV_ULONG> memory_accounted[kMemory_SubsystemCount]; // GLOBAL VARIABLE
+static std::atomic<POV_ULONG> memory_accounted_peak[kMemory_SubsystemCount]; // GLOBAL VARIABLE
+static std::atomic<POV_ULONG> memory_accounted_total(0); // GLOBAL VARIABLE
+static std::atomic<POV_ULONG> memory_limit(0); // GLOBAL VARIABLE
+
+const char *pov_mem_subsystem_name(MemorySubsystem subsystem)
+{
+    return memory_subsystem_names[subsystem];
+}
+
+void pov_mem_account(MemorySubsystem subsystem, POV_ULONG bytes)
+{
+    POV_ULONG total = memory_accounted_total.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    POV_ULONG limit = memory_limit.load(std::memory_order_relaxed);
+    if ((limit != 0) && (total > limit))
+    {
+        memory_accounted_total.fetch_sub(bytes, std::memory_order_relaxed);
+        throw POV_EXCEPTION(kOutOfMemoryErr,
+                            "Memory limit of " + std::to_string(limit / (1024 * 1024)) + " MB exceeded while allocating " +
+                            std::to_string((bytes + 1024 * 1024 - 1) / (1024 * 1024)) + " MB of " +
+                            memory_subsystem_names[subsystem] + " (" + std::to_string((total - bytes) / (1024 * 1024)) +
+                            " MB in use). Increase or remove Memory_Limit, or simplify the scene.");
+    }
+
+    POV_ULONG current = memory_accounted[subsystem].fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    POV_ULONG peak = memory_accounted_peak[subsystem].load(std::memory_order_relaxed);
+    while ((current > peak) && !memory_accounted_peak[subsystem].compare_exchange_weak(peak, current, std::memory_order_relaxed))
+        ;
+}
+
+void pov_mem_unaccount(MemorySubsystem subsystem, POV_ULONG bytes) noexcept
+{
+    memory_accounted[subsystem].fetch_sub(bytes, std::memory_order_relaxed);
+    memory_accounted_total.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+POV_ULONG pov_mem_accounted(MemorySubsystem subsystem)
+{
+    return memory_accounted[subsystem].load(std::memory_order_relaxed);
+}
+
+POV_ULONG pov_mem_accounted_peak(MemorySubsystem subsystem)
+{
+    return memory_accounted_peak[subsystem].load(std::memory_order_relaxed);
+}
+
+POV_ULONG pov_mem_accounted_total()
+{
+    return memory_accounted_total.load(std::memory_order_relaxed);
+}
+
+void pov_mem_reset_peaks()
+{
+    for (int i = 0; i < kMemory_SubsystemCount; ++i)
+        memory_accounted_peak[i].store(memory_accounted[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+void pov_mem_set_limit(POV_ULONG bytes)
+{
+    memory_limit.store(bytes, std::memory_order_relaxed);
+}
+
 /****************************************************************************/
 /* A memmove routine for those systems that don't have one                  */
 /****************************************************************************/
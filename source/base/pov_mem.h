@@ -71,6 +71,92 @@ void pov_free (void *ptr, const char *file, int line);
 char *pov_strdup (const char *s);
 void *pov_memmove (void *dest, const void *src, std::size_t length);
 
+/// Get the total number of bytes allocated via @ref pov_malloc or @ref pov_realloc by the current thread.
+/// @note
+///     The value only ever increases; it is intended for profiling purposes.
+POV_ULONG pov_mem_allocated_bytes();
+
+/// Subsystems whose memory use is accounted separately.
+///
+/// Unlike the `POV_MEM_STATS` statistics, which cover all allocations via @ref pov_malloc but
+/// are compiled out by default, subsystem accounting is always on. It is kept cheap by
+/// accounting only whole data structures, or blocks of their elements, at the points where
+/// they are built and destroyed.
+///
+enum MemorySubsystem
+{
+    kMemory_Bounding,   ///< Bounding hierarchies, including those of meshes.
+    kMemory_Mesh,       ///< Mesh vertex, normal, uv and triangle arrays.
+    kMemory_ImageMap,   ///< Decoded image maps.
+    kMemory_Photons,    ///< Photon maps.
+    kMemory_Radiosity,  ///< Radiosity sample cache.
+    kMemory_Parser,     ///< Parser symbol table entries.
+    kMemory_SubsystemCount
+};
+
+/// Get a human-readable name of a subsystem.
+const char *pov_mem_subsystem_name(MemorySubsystem subsystem);
+
+/// Account memory to a subsystem.
+/// @note
+///     Throws an exception with error code @ref kOutOfMemoryErr if the memory accounted to all
+///     subsystems would exceed the limit set via @ref pov_mem_set_limit(); nothing is accounted
+///     in that case.
+void pov_mem_account(MemorySubsystem subsystem, POV_ULONG bytes);
+
+/// Remove memory from the amount accounted to a subsystem.
+void pov_mem_unaccount(MemorySubsystem subsystem, POV_ULONG bytes) noexcept;
+
+/// Get the memory currently accounted to a subsystem, in bytes.
+POV_ULONG pov_mem_accounted(MemorySubsystem subsystem);
+
+/// Get the peak memory accounted to a subsystem since the last call to @ref pov_mem_reset_peaks(), in bytes.
+POV_ULONG pov_mem_accounted_peak(MemorySubsystem subsystem);
+
+/// Get the memory currently accounted to all subsystems, in bytes.
+POV_ULONG pov_mem_accounted_total();
+
+/// Restart peak tracking from the current values.
+void pov_mem_reset_peaks();
+
+/// Set the limit on the memory accounted to all subsystems, in bytes, or 0 for no limit.
+void pov_mem_set_limit(POV_ULONG bytes);
+
+/// Memory accounted to a subsystem for the lifetime of a data structure.
+///
+/// Embed this in a data structure and update it whenever the structure's storage changes
+/// substantially; the memory is returned when the structure is destroyed.
+///
+class MemoryAccount final
+{
+    public:
+
+        explicit MemoryAccount(MemorySubsystem s) : subsystem(s), bytes(0) {}
+        ~MemoryAccount() { pov_mem_unaccount(subsystem, bytes); }
+
+        MemoryAccount(const MemoryAccount&) = delete;
+        MemoryAccount& operator=(const MemoryAccount&) = delete;
+
+        /// Set the memory accounted, in bytes.
+        /// @note
+        ///     Throws an exception if the memory limit would be exceeded; see @ref pov_mem_account().
+        void Set(POV_ULONG newBytes)
+        {
+            if (newBytes > bytes)
+                pov_mem_account(subsystem, newBytes - bytes);
+            else
+                pov_mem_unaccount(subsystem, bytes - newBytes);
+            bytes = newBytes;
+        }
+
+        POV_ULONG Get() const { return bytes; }
+
+    private:
+
+        MemorySubsystem subsystem;
+        POV_ULONG bytes;
+};
+
 /// @}
 ///
 //##############################################################################
@@ -223,6 +223,101 @@ class Timer final
 
 #endif // POV_USE_DEFAULT_TIMER
 
+/// Hardware event counts.
+///
+/// This structure holds the number of hardware events counted by a @ref PerformanceCounters
+/// object, or accumulated from several of them.
+///
+struct PerformanceCounts final
+{
+    enum Event
+    {
+        kCycles,            ///< CPU cycles.
+        kInstructions,      ///< Instructions retired.
+        kCacheMisses,       ///< Last level cache misses.
+        kBranchMisses,      ///< Mispredicted branches.
+        kMaxEvent
+    };
+
+    /// Number of events of each type, or -1 if not counted.
+    POV_LONG count[kMaxEvent];
+
+    /// Create a set of counts with no events counted.
+    PerformanceCounts() { for (int i = 0; i < kMaxEvent; ++i) count[i] = -1; }
+
+    /// Report whether any events have been counted.
+    bool IsValid() const
+    {
+        for (int i = 0; i < kMaxEvent; ++i)
+            if (count[i] >= 0)
+                return true;
+        return false;
+    }
+
+    /// Accumulate counts.
+    ///
+    /// Events counted by either set of counts are included in the result.
+    ///
+    PerformanceCounts& operator+=(const PerformanceCounts& o)
+    {
+        for (int i = 0; i < kMaxEvent; ++i)
+        {
+            if (count[i] < 0)
+                count[i] = o.count[i];
+            else if (o.count[i] >= 0)
+                count[i] += o.count[i];
+        }
+        return *this;
+    }
+};
+
+#if POV_USE_DEFAULT_PERFORMANCE_COUNTERS
+
+/// Hardware performance counters.
+///
+/// This class provides facilities to count hardware events, such as CPU cycles or cache misses,
+/// caused by the current thread since the object was created.
+///
+/// It is intended that platforms provide their own implementations, by setting
+/// @ref POV_USE_DEFAULT_PERFORMANCE_COUNTERS to zero, providing their own declaration in
+/// `syspovtimer.h`, and providing their own definition.
+///
+/// @note
+///     The default implementation does not count any events.
+///
+class PerformanceCounters final
+{
+    public:
+
+        /// Create the counters and start counting the events of the current thread.
+        ///
+        PerformanceCounters() = default;
+
+        /// Destroy the counters.
+        ///
+        ~PerformanceCounters() = default;
+
+        /// Report the events counted.
+        ///
+        /// This method reports the events caused by the current thread since the counters'
+        /// creation. Events that cannot be counted are reported as -1.
+        ///
+        /// @note
+        ///     If the counters were created from a different thread, the result is undefined.
+        ///
+        /// @return     Event counts.
+        ///
+        inline PerformanceCounts Elapsed() const { return PerformanceCounts(); }
+
+        /// Report whether any events are counted.
+        ///
+        /// @return     `true` if @ref Elapsed() reports at least one type of event.
+        ///
+        inline bool IsValid() const { return false; }
+};
+
+#endif // POV_USE_DEFAULT_PERFORMANCE_COUNTERS
+
 /// @}
 ///
 //##############################################################################
@@ -231,7 +326,7 @@ class Timer final
 // end of namespace pov_base
 
 // Need to include this last because it may require definitions from this file.
-#if !POV_USE_DEFAULT_TIMER
+#if !POV_USE_DEFAULT_TIMER || !POV_USE_DEFAULT_PERFORMANCE_COUNTERS
 #include "syspovtimer.h"
 #endif
 
@@ -0,0 +1,113 @@
+//******************************************************************************
+///
+/// @file core/bounding/bandindex.cpp
+///
+/// Implementations related to the band index for point-in-outline tests.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+// Unit header file must be the first file included within POV-Ray *.cpp files (pulls in config)
+#include "core/bounding/bandindex.h"
+
+// C++ variants of C standard header files
+//  (none at the moment)
+
+// C++ standard header files
+#include <algorithm>
+
+// POV-Ray header files (base module)
+//  (none at the moment)
+
+// POV-Ray header files (core module)
+//  (none at the moment)
+
+// this must be the last file included
+#include "base/povdebug.h"
+
+namespace pov
+{
+
+/// Maximum number of bands.
+static const unsigned int kMaxBands = 1u << 20;
+
+/// Maximum average number of bands an item may be listed in before the number of bands is reduced.
+static const unsigned int kMaxBandsPerItem = 8;
+
+BandIndex::BandIndex(const DBL *lo, const DBL *hi, unsigned int count) :
+    mMin(BOUND_HUGE),
+    mMax(-BOUND_HUGE),
+    mScale(0.0),
+    mBands(1)
+{
+    unsigned int i, band;
+
+    for (i = 0; i < count; ++i)
+    {
+        mMin = std::min(mMin, lo[i]);
+        mMax = std::max(mMax, hi[i]);
+    }
+
+    // Aim for about two items per band, but make sure that long items (e.g. the long sides of
+    // a thin outline) do not end up listed in too many bands.
+    mBands = std::max(std::min(count / 2, kMaxBands), 1u);
+    while (true)
+    {
+        mScale = (mMax > mMin) ? (DBL(mBands) / (mMax - mMin)) : 0.0;
+        if (mBands == 1)
+            break;
+        POV_ULONG entries = 0;
+        for (i = 0; i < count; ++i)
+            entries += Band(hi[i]) - Band(lo[i]) + 1;
+        if (entries <= (POV_ULONG)kMaxBandsPerItem * count)
+            break;
+        mBands /= 2;
+    }
+
+    // Count the items per band, then fill in the lists.
+    mStart.assign(mBands + 1, 0);
+    for (i = 0; i < count; ++i)
+    {
+        for (band = Band(lo[i]); band <= Band(hi[i]); ++band)
+            ++mStart[band + 1];
+    }
+    for (band = 0; band < mBands; ++band)
+        mStart[band + 1] += mStart[band];
+
+    mItems.resize(mStart[mBands]);
+    std::vector<unsigned int> fill(mStart.begin(), mStart.end() - 1);
+    for (i = 0; i < count; ++i)
+    {
+        for (band = Band(lo[i]); band <= Band(hi[i]); ++band)
+            mItems[fill[band]++] = i;
+    }
+}
+
+}
+// end of namespace pov
@@ -0,0 +1,136 @@
+//******************************************************************************
+///
+/// @file core/bounding/bandindex.h
+///
+/// Declarations related to the band index for point-in-outline tests.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+#ifndef POVRAY_CORE_BANDINDEX_H
+#define POVRAY_CORE_BANDINDEX_H
+
+// Module config header file must be the first file included within POV-Ray unit header files
+#include "core/configcore.h"
+
+// C++ variants of C standard header files
+//  (none at the moment)
+
+// C++ standard header files
+#include <vector>
+
+// POV-Ray header files (base module)
+//  (none at the moment)
+
+// POV-Ray header files (core module)
+//  (none at the moment)
+
+namespace pov
+{
+
+//##############################################################################
+///
+/// @addtogroup PovCoreBounding
+///
+/// @{
+
+/// Index of items spanning ranges of a single coordinate.
+///
+/// The overall range of the items is divided into bands of equal width, and each band lists the
+/// items overlapping it. This is used to find the edges of a polygon or the spline segments of a
+/// prism that may cross a test ray parallel to the other axis, so that point-in-outline tests of
+/// outlines with many thousands of points only look at a handful of them.
+///
+/// @note
+///     A query may return items whose range does not actually contain the coordinate, but never
+///     misses an item whose range does.
+///
+class BandIndex final
+{
+    public:
+
+        /// Build the index.
+        ///
+        /// @param  lo      Lower ends of the item ranges.
+        /// @param  hi      Upper ends of the item ranges.
+        /// @param  count   Number of items.
+        ///
+        BandIndex(const DBL *lo, const DBL *hi, unsigned int count);
+
+        /// Find the items whose range may contain a coordinate.
+        ///
+        /// @param[in]  v       Coordinate to look up.
+        /// @param[out] begin   Start of the list of item indices.
+        /// @param[out] end     End of the list of item indices.
+        /// @return             `false` if no item can contain the coordinate.
+        ///
+        bool Find(DBL v, const unsigned int*& begin, const unsigned int*& end) const
+        {
+            if (!((v >= mMin) && (v <= mMax)))
+                return false;
+            unsigned int band = Band(v);
+            begin = mItems.data() + mStart[band];
+            end   = mItems.data() + mStart[band + 1];
+            return (begin != end);
+        }
+
+    private:
+
+        DBL mMin;
+        DBL mMax;
+        DBL mScale;
+        unsigned int mBands;
+        std::vector<unsigned int> mStart;   ///< Offset of each band's list in @ref mItems, plus end marker.
+        std::vector<unsigned int> mItems;   ///< Item indices, grouped by band.
+
+        /// Get the band a coordinate falls into.
+        ///
+        /// @note
+        ///     This is monotonic in the coordinate, so an item's range maps to a contiguous
+        ///     run of bands including those of all coordinates within the range.
+        ///
+        unsigned int Band(DBL v) const
+        {
+            DBL t = (v - mMin) * mScale;
+            if (!(t > 0.0))
+                return 0;
+            if (t >= DBL(mBands - 1))
+                return mBands - 1;
+            return (unsigned int)t;
+        }
+};
+
+/// @}
+///
+//##############################################################################
+
+}
+// end of namespace pov
+
+#endif // POVRAY_CORE_BANDINDEX_H
@@ -41,14 +41,18 @@
 #include "core/bounding/boundingbox.h"
 
 // C++ variants of C standard header files
+#include <climits>
 #include <cstdlib>
 #include <cstring>
 
 // C++ standard header files
-//  (none at the moment)
+#include <algorithm>
+#include <map>
 
 // POV-Ray header files (base module)
+#include "base/fileinputoutput.h"
 #include "base/pov_err.h"
+#include "base/pov_mem.h"
 
 // POV-Ray header files (core module)
 #include "core/math/matrix.h"
@@ -71,14 +75,21 @@ const int INITIAL_PRIORITY_QUEUE_SIZE = 256;
 const int BBQ_FIRST_ELEMENT = 1;
 
 BBOX_TREE *create_bbox_node(int size);
+bool intersect_bbox_node(const BBOX_TREE *Node, const BoundingBox *BBox, const Rayinfo *rayinfo, DBL& dmin, RenderStatistics& Stats);
+unsigned int intersect_bbox_children(const BBOX_TREE *Node, int first, unsigned int count, const Rayinfo *rayinfo, DBL *dmin, RenderStatistics& Stats);
 
 int find_axis(BBOX_TREE **Finite, ptrdiff_t first, ptrdiff_t last);
 void calc_bbox(BoundingBox *BBox, BBOX_TREE **Finite, ptrdiff_t first, ptrdiff_t last);
 void build_area_table(BBOX_TREE **Finite, ptrdiff_t a, ptrdiff_t b, BBoxScalar *areas);
 bool sort_and_split(BBOX_TREE **Root, BBOX_TREE **&Finite, size_t *numOfFiniteObjects, ptrdiff_t first, ptrdiff_t last, size_t& maxfinitecount, BBoxScalar **areaCache);
+void get_leaf_objects(const vector<ObjectPtr>& objects, vector<ObjectPtr>& leaves);
+bool save_bbox_node(OStream& os, const BBOX_TREE *Node, const std::map<ConstObjectPtr, POV_UINT32>& index);
+BBOX_TREE *load_bbox_node(IStream& is, const vector<ObjectPtr>& leaves, unsigned int level);
 
 BBoxPriorityQueue::BBoxPriorityQueue()
 {
+    // Reserve enough space up front so that we (almost) never need to reallocate during traversal.
+    mQueue.reserve(INITIAL_PRIORITY_QUEUE_SIZE);
     mQueue.resize(BBQ_FIRST_ELEMENT); // element 0 is reserved
 }
 
@@ -156,19 +167,21 @@ void Destroy_BBox_Tree(BBOX_TREE *Node)
                 Destroy_BBox_Tree(Node->Node[i]);
 
             POV_FREE(Node->Node);
+            pov_mem_unaccount(kMemory_Bounding, Node->Entries * sizeof(BBOX_TREE *));
 
             Node->Entries = 0;
             Node->Node = nullptr;
         }
 
         POV_FREE(Node);
+        pov_mem_unaccount(kMemory_Bounding, sizeof(BBOX_TREE));
     }
 }
 
 void Recompute_BBox(BoundingBox *bbox, const TRANSFORM *trans)
 {
     int i;
-    Vector3d lower_left, lengths, corner;
+    Vector3d lower_left, lengths, corners[8];
     Vector3d mins, maxs;
 
     if (trans == nullptr)
@@ -182,13 +195,20 @@ void Recompute_BBox(BoundingBox *bbox, const TRANSFORM *trans)
 
     for(i = 1; i <= 8; i++)
     {
+        Vector3d& corner = corners[i - 1];
+
         corner = lower_left;
 
         corner[X] += ((i & 1) ? lengths[X] : 0.0);
         corner[Y] += ((i & 2) ? lengths[Y] : 0.0);
         corner[Z] += ((i & 4) ? lengths[Z] : 0.0);
+    }
+
+    MTransPoints(corners, corners, 8, trans);
 
-        MTransPoint(corner, corner, trans);
+    for(i = 0; i < 8; i++)
+    {
+        const Vector3d& corner = corners[i];
 
         if(corner[X] < mins[X]) { mins[X] = corner[X]; }
         if(corner[X] > maxs[X]) { maxs[X] = corner[X]; }
@@ -212,7 +232,7 @@ void Recompute_BBox(BoundingBox *bbox, const TRANSFORM *trans)
 void Recompute_Inverse_BBox(BoundingBox *bbox, const TRANSFORM *trans)
 {
     int i;
-    Vector3d lower_left, lengths, corner;
+    Vector3d lower_left, lengths, corners[8];
     Vector3d mins, maxs;
 
     if (trans == nullptr)
@@ -226,13 +246,20 @@ void Recompute_Inverse_BBox(BoundingBox *bbox, const TRANSFORM *trans)
 
     for(i = 1; i <= 8; i++)
     {
+        Vector3d& corner = corners[i - 1];
+
         corner = lower_left;
 
         corner[X] += ((i & 1) ? lengths[X] : 0.0);
         corner[Y] += ((i & 2) ? lengths[Y] : 0.0);
         corner[Z] += ((i & 4) ? lengths[Z] : 0.0);
+    }
 
-        MInvTransPoint(corner, corner, trans);
+    MInvTransPoints(corners, corners, 8, trans);
+
+    for(i = 0; i < 8; i++)
+    {
+        const Vector3d& corner = corners[i];
 
         if(corner[X] < mins[X]) { mins[X] = corner[X]; }
         if(corner[X] > maxs[X]) { maxs[X] = corner[X]; }
@@ -289,6 +316,7 @@ void Build_BBox_Tree(BBOX_TREE **Root, size_t numOfFiniteObjects, BBOX_TREE **&F
         if(numOfInfiniteObjects > 0)
         {
             root = *Root;
+            pov_mem_account(kMemory_Bounding, sizeof(BBOX_TREE *));
             root->Node = reinterpret_cast<BBOX_TREE **>(POV_REALLOC(root->Node, (root->Entries + 1) * sizeof(BBOX_TREE *), "composite"));
             std::memmove(&(root->Node[1]), &(root->Node[0]), root->Entries * sizeof(BBOX_TREE *));
             root->Entries++;
@@ -429,19 +457,170 @@ void Build_Bounding_Slabs(BBOX_TREE **Root, vector<ObjectPtr>& objects, unsigned
         delete[] Infinite;
 }
 
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Save_Bounding_Slabs
+*
+* DESCRIPTION
+*
+*   Write a bounding box tree built by Build_Bounding_Slabs() to a binary
+*   stream. Leaves are stored as indices into the list of objects the tree
+*   was built from, so the tree can only be restored for the same list.
+*
+******************************************************************************/
+
+bool Save_Bounding_Slabs(OStream& os, const BBOX_TREE *Root, const vector<ObjectPtr>& objects)
+{
+    vector<ObjectPtr> leaves;
+    std::map<ConstObjectPtr, POV_UINT32> index;
+    POV_UINT32 present = (Root != nullptr);
+
+    get_leaf_objects(objects, leaves);
+
+    for(size_t i = 0; i < leaves.size(); i++)
+        index[leaves[i]] = POV_UINT32(i);
+
+    if(!os.write(&present, sizeof(present)))
+        return false;
+
+    return (Root == nullptr) || save_bbox_node(os, Root, index);
+}
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Load_Bounding_Slabs
+*
+* DESCRIPTION
+*
+*   Read a bounding box tree written by Save_Bounding_Slabs(). Returns false
+*   if the data is incomplete or does not match the object list.
+*
+******************************************************************************/
+
+bool Load_Bounding_Slabs(IStream& is, BBOX_TREE **Root, const vector<ObjectPtr>& objects)
+{
+    vector<ObjectPtr> leaves;
+    POV_UINT32 present;
+
+    *Root = nullptr;
+
+    get_leaf_objects(objects, leaves);
+
+    if(!is.read(&present, sizeof(present)))
+        return false;
+
+    if(present == 0)
+        return true;
+
+    *Root = load_bbox_node(is, leaves, 0);
+
+    return (*Root != nullptr);
+}
+
+void get_leaf_objects(const vector<ObjectPtr>& objects, vector<ObjectPtr>& leaves)
+{
+    // same selection as in Build_Bounding_Slabs
+    for(vector<ObjectPtr>::const_iterator i(objects.begin()); i != objects.end(); i++)
+    {
+        if((*i)->Type & LIGHT_SOURCE_OBJECT)
+        {
+            if((reinterpret_cast<LightSource *>(*i))->children.size() > 0)
+                leaves.push_back((reinterpret_cast<LightSource *>(*i))->children[0]);
+        }
+        else
+            leaves.push_back(*i);
+    }
+}
+
+bool save_bbox_node(OStream& os, const BBOX_TREE *Node, const std::map<ConstObjectPtr, POV_UINT32>& index)
+{
+    POV_UINT32 data[2] = { POV_UINT32(Node->Entries), POV_UINT32(Node->Infinite) };
+
+    if(!os.write(data, sizeof(data)) || !os.write(&Node->BBox, sizeof(BoundingBox)))
+        return false;
+
+    if(Node->Entries == 0)
+    {
+        std::map<ConstObjectPtr, POV_UINT32>::const_iterator i = index.find(reinterpret_cast<ConstObjectPtr>(Node->Node));
+
+        if(i == index.end())
+            return false;
+
+        return os.write(&i->second, sizeof(POV_UINT32));
+    }
+
+    for(short i = 0; i < Node->Entries; i++)
+    {
+        if(!save_bbox_node(os, Node->Node[i], index))
+            return false;
+    }
+
+    return true;
+}
+
+BBOX_TREE *load_bbox_node(IStream& is, const vector<ObjectPtr>& leaves, unsigned int level)
+{
+    BBOX_TREE *Node;
+    BoundingBox bbox;
+    POV_UINT32 data[2];
+
+    // the level limit merely guards against runaway recursion on corrupt data
+    if(!is.read(data, sizeof(data)) || !is.read(&bbox, sizeof(BoundingBox)) || (data[0] > SHRT_MAX) || (level > 10000))
+        return nullptr;
+
+    Node = create_bbox_node(int(data[0]));
+    Node->BBox = bbox;
+    Node->Infinite = (data[1] != 0);
+
+    if(Node->Entries == 0)
+    {
+        POV_UINT32 i;
+
+        if(!is.read(&i, sizeof(i)) || (i >= leaves.size()))
+        {
+            Destroy_BBox_Tree(Node);
+            return nullptr;
+        }
+
+        Node->Node = reinterpret_cast<BBOX_TREE **>(leaves[i]);
+        return Node;
+    }
+
+    for(short i = 0; i < Node->Entries; i++)
+    {
+        Node->Node[i] = load_bbox_node(is, leaves, level + 1);
+
+        if(Node->Node[i] == nullptr)
+        {
+            // only destroy the children read so far
+            for(short j = 0; j < i; j++)
+                Destroy_BBox_Tree(Node->Node[j]);
+
+            pov_mem_unaccount(kMemory_Bounding, sizeof(BBOX_TREE) + Node->Entries * sizeof(BBOX_TREE *));
+            POV_FREE(Node->Node);
+            POV_FREE(Node);
+            return nullptr;
+        }
+    }
+
+    return Node;
+}
+
 bool Intersect_BBox_Tree(BBoxPriorityQueue& pqueue, const BBOX_TREE *Root, const Ray& ray, Intersection *Best_Intersection, TraceThreadData *Thread)
 {
-    int i, found;
+    int found;
     DBL Depth;
     const BBOX_TREE *Node;
-    Intersection New_Intersection;
 
     // Create the direction vectors for this ray.
     Rayinfo rayinfo(ray);
 
     // Start with an empty priority queue.
     pqueue.Clear();
-    New_Intersection.Object = nullptr;
     found = false;
 
     // Check top node.
@@ -462,20 +641,13 @@ bool Intersect_BBox_Tree(BBoxPriorityQueue& pqueue, const BBOX_TREE *Root, const
         if(Node->Entries)
         {
             // This is a node containing leaves to be checked.
-            for (i = 0; i < Node->Entries; i++)
-                Check_And_Enqueue(pqueue, Node->Node[i], &Node->Node[i]->BBox, &rayinfo, Thread->Stats());
+            Check_And_Enqueue_Children(pqueue, Node, &rayinfo, Thread->Stats());
         }
         else
         {
             // This is a leaf so test contained object.
-            if(Find_Intersection(&New_Intersection, reinterpret_cast<ObjectPtr>(Node->Node), ray, Thread))
-            {
-                if(New_Intersection.Depth < Best_Intersection->Depth)
-                {
-                    *Best_Intersection = New_Intersection;
-                    found = true;
-                }
-            }
+            if(Find_Intersection(Best_Intersection, reinterpret_cast<ObjectPtr>(Node->Node), ray, Thread, Best_Intersection->Depth))
+                found = true;
         }
     }
 
@@ -484,17 +656,15 @@ bool Intersect_BBox_Tree(BBoxPriorityQueue& pqueue, const BBOX_TREE *Root, const
 
 bool Intersect_BBox_Tree(BBoxPriorityQueue& pqueue, const BBOX_TREE *Root, const Ray& ray, Intersection *Best_Intersection, const RayObjectCondition& precondition, const RayObjectCondition& postcondition, TraceThreadData *Thread)
 {
-    int i, found;
+    int found;
     DBL Depth;
     const BBOX_TREE *Node;
-    Intersection New_Intersection;
 
     // Create the direction vectors for this ray.
     Rayinfo rayinfo(ray);
 
     // Start with an empty priority queue.
     pqueue.Clear();
-    New_Intersection.Object = nullptr;
     found = false;
 
     // Check top node.
@@ -515,22 +685,15 @@ bool Intersect_BBox_Tree(BBoxPriorityQueue& pqueue, const BBOX_TREE *Root, const
         if(Node->Entries)
         {
             // This is a node containing leaves to be checked.
-            for (i = 0; i < Node->Entries; i++)
-                Check_And_Enqueue(pqueue, Node->Node[i], &Node->Node[i]->BBox, &rayinfo, Thread->Stats());
+            Check_And_Enqueue_Children(pqueue, Node, &rayinfo, Thread->Stats());
         }
         else
         {
             if(precondition(ray, reinterpret_cast<ObjectPtr>(Node->Node), 0.0) == true)
             {
                 // This is a leaf so test contained object.
-                if(Find_Intersection(&New_Intersection, reinterpret_cast<ObjectPtr>(Node->Node), ray, postcondition, Thread))
-                {
-                    if(New_Intersection.Depth < Best_Intersection->Depth)
-                    {
-                        *Best_Intersection = New_Intersection;
-                        found = true;
-                    }
-                }
+                if(Find_Intersection(Best_Intersection, reinterpret_cast<ObjectPtr>(Node->Node), ray, postcondition, Thread, Best_Intersection->Depth))
+                    found = true;
             }
         }
     }
@@ -538,119 +701,278 @@ bool Intersect_BBox_Tree(BBoxPriorityQueue& pqueue, const BBOX_TREE *Root, const
     return (found);
 }
 
-void Check_And_Enqueue(BBoxPriorityQueue& Queue, const BBOX_TREE *Node, const BoundingBox *BBox, const Rayinfo *rayinfo, RenderStatistics& Stats)
+bool Occlude_BBox_Tree(BBoxTreeStack& stack, const BBOX_TREE *Root, const Ray& ray, DBL maxDepth, Intersection *Occluder, bool& otherHits, const RayObjectCondition& precondition, const RayObjectCondition& postcondition, const IntersectionCondition& occlusion, TraceThreadData *Thread)
 {
-    DBL dmin, dmax;
+    const BBOX_TREE *Node;
+    Intersection New_Intersection;
+    DBL Depth;
+    DBL depths[kMaxOptimizedBBoxes];
 
-    if(Node->Infinite == false)
+    // Create the direction vectors for this ray.
+    Rayinfo rayinfo(ray);
+
+    // Unlike Intersect_BBox_Tree(), we're not looking for the closest intersection, so there is no need to
+    // keep the nodes sorted by distance; a plain stack will do, and we can stop at the first occluder.
+    stack.clear();
+    otherHits = false;
+
+    if(intersect_bbox_node(Root, &Root->BBox, &rayinfo, Depth, Thread->Stats()) && (Depth < maxDepth))
+        stack.push_back(Root);
+
+    while(!stack.empty())
     {
-        Stats[nChecked]++;
+        Node = stack.back();
+        stack.pop_back();
 
-        // Test whether the bounding box is being hit.
+        if(Node->Entries)
+        {
+            // This is a node containing leaves to be checked.
+            for (int first = 0; first < Node->Entries; first += kMaxOptimizedBBoxes)
+            {
+                unsigned int count = std::min<unsigned int>(Node->Entries - first, kMaxOptimizedBBoxes);
+                unsigned int hits = intersect_bbox_children(Node, first, count, &rayinfo, depths, Thread->Stats());
+
+                for (unsigned int i = 0; i < count; i++)
+                    if((hits & (1u << i)) && (depths[i] < maxDepth))
+                        stack.push_back(Node->Node[first + i]);
+            }
+        }
+        else if(precondition(ray, reinterpret_cast<ObjectPtr>(Node->Node), 0.0) == true)
+        {
+            // This is a leaf so test contained object.
+            if(Find_Intersection(&New_Intersection, reinterpret_cast<ObjectPtr>(Node->Node), ray, postcondition, Thread) &&
+               (New_Intersection.Depth < maxDepth))
+            {
+                if(occlusion(New_Intersection))
+                {
+                    *Occluder = New_Intersection;
+                    return true;
+                }
+                otherHits = true;
+            }
+        }
+    }
+
+    return false;
+}
+
+bool intersect_bbox_node(const BBOX_TREE *Node, const BoundingBox *BBox, const Rayinfo *rayinfo, DBL& dmin, RenderStatistics& Stats)
+{
+    if(Node->Infinite == false)
+        return Intersect_BBox_Slabs(BBox, rayinfo, dmin, Stats);
+
+    // Set intersection depth to -Max_Distance.
+    dmin = -MAX_DISTANCE;
+
+    return true;
+}
+
+bool Intersect_BBox_Slabs(const BoundingBox *BBox, const Rayinfo *rayinfo, DBL& dmin, RenderStatistics& Stats)
+{
+    DBL dmax;
 
-        // The bounding box can be thought of as an intersection of three "slabs", by which we mean slices of 3D space
-        // bounded by parallel axis-aligned planes; we have an "X slab" bounding the box in the X dimension, an
-        // "Y slab", and a "Z slab".
+    Stats[nChecked]++;
 
-        // With a few exceptions that we need to test for, any ray will intersect all three slabs, defining an interval
-        // along the ray in which the ray is inside the slab.
+    // Test whether the bounding box is being hit.
 
-        // Where the intervals for the individual slabs overlap, the ray is inside bounding box.
+    // The bounding box can be thought of as an intersection of three "slabs", by which we mean slices of 3D space
+    // bounded by parallel axis-aligned planes; we have an "X slab" bounding the box in the X dimension, an
+    // "Y slab", and a "Z slab".
 
-        // We proceed one dimension at a time.
+    // With a few exceptions that we need to test for, any ray will intersect all three slabs, defining an interval
+    // along the ray in which the ray is inside the slab.
 
-        // These will keep track of the overlap between the intervals.
-        dmin = -BOUND_HUGE;
-        dmax =  BOUND_HUGE;
+    // Where the intervals for the individual slabs overlap, the ray is inside bounding box.
 
-        for (int dim = X; dim <= Z; ++dim)
+    // We proceed one dimension at a time.
+
+    // These will keep track of the overlap between the intervals.
+    dmin = -BOUND_HUGE;
+    dmax =  BOUND_HUGE;
+
+    for (int dim = X; dim <= Z; ++dim)
+    {
+        if(rayinfo->nonzero[dim])
         {
-            if(rayinfo->nonzero[dim])
-            {
-                // These will hold the distance to the near and far plane, respectively, for this slab.
-                DBL tmin, tmax;
+            // These will hold the distance to the near and far plane, respectively, for this slab.
+            DBL tmin, tmax;
 
-                if (rayinfo->positive[dim])
-                {
-                    // Far plane is "upper" plane, near plane is the "lower" one.
-                    tmax = (BBox->lowerLeft[dim] + BBox->size[dim] - rayinfo->origin[dim]) * rayinfo->invDirection[dim];
-                    if(tmax < EPSILON)
-                        // The far plane is (at least almost) behind the observer,
-                        // so the ray is heading away from the box and can't possibly intersect it.
-                        return;
-                    tmin = (BBox->lowerLeft[dim] - rayinfo->origin[dim]) * rayinfo->invDirection[dim];
-                }
-                else
-                {
-                    // Far plane is "lower" plane, near plane is the "upper" one.
-                    tmax = (BBox->lowerLeft[dim] - rayinfo->origin[dim]) * rayinfo->invDirection[dim];
-                    if(tmax < EPSILON)
-                        // The far plane is (at least almost) behind the observer,
-                        // so the ray is heading away from the box and can't possibly intersect it.
-                        return;
-                    tmin = (BBox->lowerLeft[dim] + BBox->size[dim] - rayinfo->origin[dim]) * rayinfo->invDirection[dim];
-                }
+            if (rayinfo->positive[dim])
+            {
+                // Far plane is "upper" plane, near plane is the "lower" one.
+                tmax = (BBox->lowerLeft[dim] + BBox->size[dim] - rayinfo->origin[dim]) * rayinfo->invDirection[dim];
+                if(tmax < EPSILON)
+                    // The far plane is (at least almost) behind the observer,
+                    // so the ray is heading away from the box and can't possibly intersect it.
+                    return false;
+                tmin = (BBox->lowerLeft[dim] - rayinfo->origin[dim]) * rayinfo->invDirection[dim];
+            }
+            else
+            {
+                // Far plane is "lower" plane, near plane is the "upper" one.
+                tmax = (BBox->lowerLeft[dim] - rayinfo->origin[dim]) * rayinfo->invDirection[dim];
+                if(tmax < EPSILON)
+                    // The far plane is (at least almost) behind the observer,
+                    // so the ray is heading away from the box and can't possibly intersect it.
+                    return false;
+                tmin = (BBox->lowerLeft[dim] + BBox->size[dim] - rayinfo->origin[dim]) * rayinfo->invDirection[dim];
+            }
 
-                // The next portion of code is essentially the same as the following
-                // (presuming dmin <= dmax initially), with a lot of shortcuts to bail out early:
-                //
-                //  if (tmax < dmax) dmax = tmax;   // update the overlap lower bound
-                //  if (tmin > dmin) dmin = tmin;   // update the overlap upper bound
-                //  if (dmin > dmax) return;        // detect whether there is no overlap
+            // The next portion of code is essentially the same as the following
+            // (presuming dmin <= dmax initially), with a lot of shortcuts to bail out early:
+            //
+            //  if (tmax < dmax) dmax = tmax;   // update the overlap lower bound
+            //  if (tmin > dmin) dmin = tmin;   // update the overlap upper bound
+            //  if (dmin > dmax) return;        // detect whether there is no overlap
 
-                if (tmax < dmax)
+            if (tmax < dmax)
+            {
+                if (tmin > dmin)
                 {
-                    if (tmin > dmin)
-                    {
-                        if(tmin > tmax)
-                            return;
-                        dmin = tmin;
-                    }
-                    else
-                    {
-                        if(dmin > tmax)
-                            return;
-                    }
-                    dmax = tmax;
+                    if(tmin > tmax)
+                        return false;
+                    dmin = tmin;
                 }
                 else
                 {
-                    if(tmin > dmin)
-                    {
-                        if(tmin > dmax)
-                            return;
-                        dmin = tmin;
-                    }
+                    if(dmin > tmax)
+                        return false;
                 }
+                dmax = tmax;
             }
             else
             {
-                // Special case: The ray runs parallel to this slab; there ray is either entirely inside the slab,
-                // or it is entirely outside; we can easily check this by testing the ray origin.
+                if(tmin > dmin)
+                {
+                    if(tmin > dmax)
+                        return false;
+                    dmin = tmin;
+                }
+            }
+        }
+        else
+        {
+            // Special case: The ray runs parallel to this slab; there ray is either entirely inside the slab,
+            // or it is entirely outside; we can easily check this by testing the ray origin.
 
-                if (!IsInRange (rayinfo->origin[dim], BBox->lowerLeft[dim], BBox->lowerLeft[dim] + BBox->size[dim]))
-                    // The ray is entirely outside the slab, so it can't possibly hit the bounding box.
-                    return;
+            if (!IsInRange (rayinfo->origin[dim], BBox->lowerLeft[dim], BBox->lowerLeft[dim] + BBox->size[dim]))
+                // The ray is entirely outside the slab, so it can't possibly hit the bounding box.
+                return false;
 
-                // The ray is entirely inside the slab, so this slab has no effect on the end result.
-            }
+            // The ray is entirely inside the slab, so this slab has no effect on the end result.
         }
+    }
+
+    // If we've made it through to here, the ray does hit the box.
+
+    Stats[nEnqueued]++;
+
+    return true;
+}
+
+void Check_And_Enqueue(BBoxPriorityQueue& Queue, const BBOX_TREE *Node, const BoundingBox *BBox, const Rayinfo *rayinfo, RenderStatistics& Stats)
+{
+    DBL dmin;
 
-        // If we've made it through to here, the ray does hit the box.
+    if(intersect_bbox_node(Node, BBox, rayinfo, dmin, Stats))
+        Queue.Insert (dmin, Node);
+}
 
-        Stats[nEnqueued]++;
+void Check_And_Enqueue_Children(BBoxPriorityQueue& Queue, const BBOX_TREE *Node, const Rayinfo *rayinfo, RenderStatistics& Stats)
+{
+    DBL dmin[kMaxOptimizedBBoxes];
+
+    for (int first = 0; first < Node->Entries; first += kMaxOptimizedBBoxes)
+    {
+        unsigned int count = std::min<unsigned int>(Node->Entries - first, kMaxOptimizedBBoxes);
+        unsigned int hits = intersect_bbox_children(Node, first, count, rayinfo, dmin, Stats);
+
+        // Insert in the same order as Check_And_Enqueue() would, so that ties are resolved identically.
+        for (unsigned int i = 0; i < count; i++)
+            if (hits & (1u << i))
+                Queue.Insert(dmin[i], Node->Node[first + i]);
+    }
+}
+
+#ifdef TRY_OPTIMIZED_BBOX
+
+const OptimizedBBoxInfo gPortableBBoxInfo = {
+    "generic",      // name,
+    "portable",     // info,
+    nullptr,        // intersect,
+    nullptr,        // enabled,
+    nullptr         // supported
+};
+
+const OptimizedBBoxInfo* GetRecommendedOptimizedBBox()
+{
+    for (const OptimizedBBoxInfo* p = gaOptimizedBBoxInfo; p->name != nullptr; ++p)
+    {
+        if ((p->enabled == nullptr) || *p->enabled)
+        {
+            POV_CORE_ASSERT(p->supported);
+            if (p->supported())
+                return p;
+        }
     }
-    else
-        // Set intersection depth to -Max_Distance.
-        dmin = -MAX_DISTANCE;
 
-    Queue.Insert (dmin, Node);
+    // No optimized implementation found; go for the portable implementation.
+    return &gPortableBBoxInfo;
+}
+
+#endif // TRY_OPTIMIZED_BBOX
+
+unsigned int intersect_bbox_children(const BBOX_TREE *Node, int first, unsigned int count, const Rayinfo *rayinfo, DBL *dmin, RenderStatistics& Stats)
+{
+    unsigned int hits = 0;
+
+#ifdef TRY_OPTIMIZED_BBOX
+    static const IntersectBBoxesFunction intersect = GetRecommendedOptimizedBBox()->intersect;
+
+    if (intersect != nullptr)
+    {
+        const BoundingBox *boxes[kMaxOptimizedBBoxes];
+        unsigned int infinite = 0;
+        unsigned int finite = 0;
+
+        for (unsigned int i = 0; i < count; i++)
+        {
+            boxes[i] = &Node->Node[first + i]->BBox;
+            if (Node->Node[first + i]->Infinite)
+                infinite |= (1u << i);
+            else
+                finite++;
+        }
+
+        hits = intersect(boxes, count, *rayinfo, dmin) & ~infinite;
+
+        Stats[nChecked] += finite;
+        for (unsigned int i = 0; i < count; i++)
+        {
+            if (infinite & (1u << i))
+                // Set intersection depth to -Max_Distance.
+                dmin[i] = -MAX_DISTANCE;
+            else if (hits & (1u << i))
+                Stats[nEnqueued]++;
+        }
+
+        return (hits | infinite);
+    }
+#endif
+
+    for (unsigned int i = 0; i < count; i++)
+        if (intersect_bbox_node(Node->Node[first + i], &Node->Node[first + i]->BBox, rayinfo, dmin[i], Stats))
+            hits |= (1u << i);
+
+    return hits;
 }
 
 BBOX_TREE *create_bbox_node(int size)
 {
     BBOX_TREE *New;
 
+    pov_mem_account(kMemory_Bounding, sizeof(BBOX_TREE) + size * sizeof(BBOX_TREE *));
+
     New = reinterpret_cast<BBOX_TREE *>(POV_MALLOC(sizeof(BBOX_TREE), "bounding box node"));
 
     New->Infinite = false;
@@ -47,7 +47,7 @@
 #include <vector>
 
 // POV-Ray header files (base module)
-//  (none at the moment)
+#include "base/fileinputoutput_fwd.h"
 
 // POV-Ray header files (core module)
 #include "core/coretypes.h"
@@ -228,6 +228,53 @@ enum BBoxDirection
 };
 
 
+/// Maximum number of boxes tested by a single call to an @ref IntersectBBoxesFunction.
+const unsigned int kMaxOptimizedBBoxes = 8;
+
+#ifdef TRY_OPTIMIZED_BBOX
+
+/// Optimized test of a ray against several (finite) boxes at once.
+///
+/// Implementations must give exactly the same results as calling @ref Intersect_BBox_Slabs()
+/// for each box, except that they do not update any statistics.
+///
+/// @param[in]  boxes       Boxes to test.
+/// @param[in]  count       Number of boxes (1 to @ref kMaxOptimizedBBoxes).
+/// @param[in]  rayinfo     Ray to test.
+/// @param[out] dmin        Distance to each box hit (left unchanged for boxes missed).
+/// @return                 Bit mask of the boxes hit.
+///
+typedef unsigned int (*IntersectBBoxesFunction)(const BoundingBox* const boxes[], unsigned int count, const Rayinfo& rayinfo, DBL dmin[]);
+
+/// Optimized ray/box test dispatch information.
+///
+/// See @ref OptimizedNoiseInfo for the meaning of the fields.
+///
+struct OptimizedBBoxInfo final
+{
+    const char* name;
+    const char* info;
+    IntersectBBoxesFunction intersect;
+    const bool* enabled;
+    bool(*supported)();
+};
+
+/// Optimized ray/box test dispatch table.
+///
+/// This table contains a list of all available optimized implementations, sorted by descending
+/// order of preference. The end of the table is indicated by an entry with the `name` field set
+/// to `nullptr`.
+///
+/// @note
+///     This table must be implemented by platform-specific code.
+///
+extern OptimizedBBoxInfo gaOptimizedBBoxInfo[];
+
+/// Get the recommended ray/box test implementation for the current runtime environment.
+const OptimizedBBoxInfo* GetRecommendedOptimizedBBox();
+
+#endif // TRY_OPTIMIZED_BBOX
+
 /// Container for BBox subtrees prioritized by depth (distance to ray origin).
 ///
 /// The current implementation is based on a so-called _min heap_ stored in a
@@ -269,6 +316,9 @@ class BBoxPriorityQueue final
         std::vector<Qelem> mQueue;
 };
 
+/// Container for BBox subtrees yet to be visited in any-hit queries.
+using BBoxTreeStack = std::vector<ConstBBoxTreePtr>;
+
 
 /*****************************************************************************
 * Global functions
@@ -276,11 +326,16 @@ class BBoxPriorityQueue final
 
 void Build_BBox_Tree(BBOX_TREE **Root, size_t numOfFiniteObjects, BBOX_TREE **&Finite, size_t numOfInfiniteObjects, BBOX_TREE **Infinite, size_t& maxfinitecount);
 void Build_Bounding_Slabs(BBOX_TREE **Root, std::vector<ObjectPtr>& objects, unsigned int& numberOfFiniteObjects, unsigned int& numberOfInfiniteObjects, unsigned int& numberOfLightSources);
+bool Save_Bounding_Slabs(OStream& os, const BBOX_TREE *Root, const std::vector<ObjectPtr>& objects);
+bool Load_Bounding_Slabs(IStream& is, BBOX_TREE **Root, const std::vector<ObjectPtr>& objects);
 
 void Recompute_BBox(BoundingBox *bbox, const TRANSFORM *trans);
 bool Intersect_BBox_Tree(BBoxPriorityQueue& pqueue, const BBOX_TREE *Root, const Ray& ray, Intersection *Best_Intersection, TraceThreadData *Thread);
 bool Intersect_BBox_Tree(BBoxPriorityQueue& pqueue, const BBOX_TREE *Root, const Ray& ray, Intersection *Best_Intersection, const RayObjectCondition& precondition, const RayObjectCondition& postcondition, TraceThreadData *Thread);
+bool Occlude_BBox_Tree(BBoxTreeStack& stack, const BBOX_TREE *Root, const Ray& ray, DBL maxDepth, Intersection *Occluder, bool& otherHits, const RayObjectCondition& precondition, const RayObjectCondition& postcondition, const IntersectionCondition& occlusion, TraceThreadData *Thread);
 void Check_And_Enqueue(BBoxPriorityQueue& Queue, const BBOX_TREE *Node, const BoundingBox *BBox, const Rayinfo *rayinfo, RenderStatistics& Stats);
+void Check_And_Enqueue_Children(BBoxPriorityQueue& Queue, const BBOX_TREE *Node, const Rayinfo *rayinfo, RenderStatistics& Stats);
+bool Intersect_BBox_Slabs(const BoundingBox *BBox, const Rayinfo *rayinfo, DBL& dmin, RenderStatistics& Stats);
 void Destroy_BBox_Tree(BBOX_TREE *Node);
 
 
@@ -38,7 +38,7 @@
 
 // C++ variants of C standard header files
 // C++ standard header files
-//  (none at the moment)
+#include <algorithm>
 
 // POV-Ray header files (base module)
 //  (none at the moment)
@@ -58,6 +58,18 @@ using std::vector;
 * Local preprocessor defines
 ******************************************************************************/
 
+/* Minimum number of segments to build a segment tree for. */
+
+const int BCyl_Tree_Threshold = 32;
+
+/* Maximum number of segments in a leaf of the segment tree. */
+
+const int BCyl_Tree_Leaf_Size = 8;
+
+/* Relative tolerance the bounds of segment tree nodes are padded with. */
+
+const DBL BCyl_Tree_Tolerance = 1.0e-6;
+
 
 
 /*****************************************************************************
@@ -71,8 +83,12 @@ using std::vector;
 ******************************************************************************/
 
 static int  intersect_thick_cylinder (const BCYL *BCyl, const vector<BCYL_INT>& rint, const vector<BCYL_INT>& hint, const BCYL_ENTRY *Entry, DBL *dist);
-static void insert_hit (const BCYL_INT *Element, vector<BCYL_INT>& intervals);
+static void insert_hit (int n, int count, const DBL *dist, vector<BCYL_INT>& intervals);
+static bool compare_hits (const BCYL_INT& a, const BCYL_INT& b);
 static void intersect_bound_elements (const BCYL *BCyl, vector<BCYL_INT>& rint, vector<BCYL_INT>& hint, const Vector3d& P, const Vector3d& D);
+static void intersect_bound_tree (const BCYL *BCyl, vector<BCYL_INT>& intervals, vector<BCYL_INT>& rint, vector<BCYL_INT>& hint, const Vector3d& P, const Vector3d& D);
+static bool intersect_bound_node (const BCyl_Node_Struct *Node, const Vector3d& P, const Vector3d& D, DBL a, DBL b, DBL c);
+static int  build_bound_tree (BCYL *BCyl, int first, int count, int index);
 
 
 /*****************************************************************************
@@ -211,6 +227,83 @@ static int intersect_thick_cylinder(const BCYL *BCyl, const vector<BCYL_INT>& ri
 
 
 
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   intersect_bound_height, intersect_bound_radius
+*
+* INPUT
+*
+*   height, radius - Bound-height or squared bound-radius to intersect
+*   P, D           - Current ray
+*   a, b, bb, b2, c - Ray constants set up by the caller
+*
+* OUTPUT
+*
+*   hint, rint - Intersection(s) found
+*
+* RETURNS
+*
+* AUTHOR
+*
+*   Dieter Bayer
+*
+* DESCRIPTION
+*
+*   Intersect the ray with a single bounding disc or cylinder. The
+*   results are selected rather than branched on, so that loops over
+*   all discs and cylinders can be vectorized.
+*
+* CHANGES
+*
+*   Split off from intersect_bound_elements().
+*
+******************************************************************************/
+
+static inline void intersect_bound_height(DBL height, BCYL_INT& hint, const Vector3d& P, const Vector3d& D, bool planes, DBL a, DBL b2, DBL c)
+{
+    DBL k = (height - P[Y]) / (planes ? D[Y] : 1.0);
+
+    hint.n = planes ? 1 : 0;
+
+    hint.d[0] = k;
+
+    hint.w[0] = k * (a * k + b2) + c;
+}
+
+static inline void intersect_bound_radius(DBL radius, BCYL_INT& rint, const Vector3d& P, const Vector3d& D, DBL a, DBL b, DBL bb, DBL c)
+{
+    DBL d, k;
+    bool hit;
+
+    d = bb - a * (c - radius);
+
+    hit = (radius > EPSILON) && (d > 0.0);
+
+    /* A hit implies a > 0, as b = 0 for rays parallel to the axis. */
+
+    d = sqrt(hit ? d : 0.0);
+
+    a = hit ? a : 1.0;
+
+    rint.n = hit ? 2 : 0;
+
+    k = (-b + d) / a;
+
+    rint.d[0] = k;
+
+    rint.w[0] = P[Y] + k * D[Y];
+
+    k = (-b - d) / a;
+
+    rint.d[1] = k;
+
+    rint.w[1] = P[Y] + k * D[Y];
+}
+
+
+
 /*****************************************************************************
 *
 * FUNCTION
@@ -249,7 +342,8 @@ static int intersect_thick_cylinder(const BCYL *BCyl, const vector<BCYL_INT>& ri
 static void intersect_bound_elements(const BCYL *BCyl, vector<BCYL_INT>& rint, vector<BCYL_INT>& hint, const Vector3d& P, const Vector3d& D)
 {
     int i;
-    DBL a, b, bb, b2, c, d, k;
+    DBL a, b, bb, b2, c;
+    bool planes;
 
     /* Init constants. */
 
@@ -263,102 +357,301 @@ static void intersect_bound_elements(const BCYL *BCyl, vector<BCYL_INT>& rint, v
 
     c = P[X] * P[X] + P[Z] * P[Z];
 
-    /* Intersect all rings. */
+    planes = ((D[Y] < -EPSILON) || (D[Y] > EPSILON));
+
+    /*
+     * Intersect all rings and cylinders. The loops are kept free of branches
+     * so that the compiler is able to vectorize them.
+     */
 
-    if ((D[Y] < -EPSILON) || (D[Y] > EPSILON))
+    for (i = 0; i < BCyl->nheight; i++)
     {
-        for (i = 0; i < BCyl->nheight; i++)
-        {
-            k = (BCyl->height[i] - P[Y]) / D[Y];
+        intersect_bound_height(BCyl->height[i], hint[i], P, D, planes, a, b2, c);
+    }
+
+    for (i = 0; i < BCyl->nradius; i++)
+    {
+        intersect_bound_radius(BCyl->radius[i], rint[i], P, D, a, b, bb, c);
+    }
+}
 
-            hint[i].n = 1;
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   insert_hit
+*
+* INPUT
+*
+*   n         - Segment whose bounding cylinder was intersected
+*   count     - Number of intersections found
+*   dist      - List of sorted intersection depths
+*   intervals - List of intervals
+*
+* OUTPUT
+*
+*   intervals
+*
+* RETURNS
+*
+* AUTHOR
+*
+*   Dieter Bayer
+*
+* DESCRIPTION
+*
+*   Append the interval where the ray is inside the bounding cylinder of
+*   a segment to the intersection list. The list is sorted by depth once
+*   all segments have been intersected.
+*
+* CHANGES
+*
+*   Oct 1996 : Creation.
+*
+******************************************************************************/
 
-            hint[i].d[0] = k;
+static void insert_hit(int n, int count, const DBL *dist, vector<BCYL_INT>& intervals)
+{
+    BCYL_INT Inter;
 
-            hint[i].w[0] = k * (a * k + b2) + c;
-        }
-    }
-    else
+    Inter.n    = n;
+    Inter.d[1] = 0.0;
+
+    switch (count)
     {
-        for (i = 0; i < BCyl->nheight; i++)
-        {
-            hint[i].n = 0;
-        }
+        case 0:
+            return;
+
+        case 2:
+
+            if (dist[0] > EPSILON)
+                Inter.d[0] = dist[0];
+            else if (dist[1] > EPSILON)
+                Inter.d[0] = 0.0;
+            else
+                return;
+
+            break;
+
+        case 4:
+
+            if (dist[0] > EPSILON)
+                Inter.d[0] = dist[0];
+            else if (dist[1] > EPSILON)
+                Inter.d[0] = 0.0;
+            else if (dist[2] > EPSILON)
+                Inter.d[0] = dist[2];
+            else if (dist[3] > EPSILON)
+                Inter.d[0] = 0.0;
+            else
+                return;
+
+            break;
+
+        default:
+
+            /*
+             * We weren't able to find an even number of intersections. Thus
+             * we can't tell where the ray enters and leaves the bounding
+             * cylinder. To avoid problems we assume that the ray is always
+             * inside the cylinder in that case.
+             */
+
+            Inter.d[0] = dist[0];
+
+            break;
     }
 
-    /* Intersect all cylinders. */
+    intervals.push_back(Inter);
+}
 
-    for (i = 0; i < BCyl->nradius; i++)
-    {
-        rint[i].n = 0;
+/* Order intervals by depth; of equal depths, the later segment comes first. */
 
-        if (BCyl->radius[i] > EPSILON)
-        {
-            d = bb - a * (c - BCyl->radius[i]);
+static bool compare_hits(const BCYL_INT& a, const BCYL_INT& b)
+{
+    return (a.d[0] < b.d[0]) || ((a.d[0] == b.d[0]) && (a.n > b.n));
+}
 
-            if (d > 0.0)
-            {
-                d = sqrt(d);
 
-                k = (-b + d) / a;
 
-                rint[i].n = 2;
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   intersect_bound_node
+*
+* INPUT
+*
+*   Node     - Segment tree node
+*   P, D     - Current ray
+*   a, b, c  - Ray constants set up by the caller
+*
+* OUTPUT
+*
+* RETURNS
+*
+*   bool - false if the ray misses all segments covered by the node
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Conservatively test the ray against the solid cylinder enclosing the
+*   bounding cylinders of all segments covered by a segment tree node.
+*   Hits behind the ray origin are not rejected, as the segment tests
+*   themselves do not reject all of them either.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+static bool intersect_bound_node(const BCyl_Node_Struct *Node, const Vector3d& P, const Vector3d& D, DBL a, DBL b, DBL c)
+{
+    DBL d, k1, k2;
+    DBL kmin = -BOUND_HUGE;
+    DBL kmax =  BOUND_HUGE;
+
+    /* Depths where the ray is within the largest radius. */
 
-                rint[i].d[0] = k;
+    if (a > 0.0)
+    {
+        d = b * b - a * (c - Node->rmax);
 
-                rint[i].w[0] = P[Y] + k * D[Y];
+        if (d < 0.0)
+            return false;
 
-                k = (-b - d) / a;
+        d = sqrt(d);
 
-                rint[i].d[1] = k;
+        kmin = (-b - d) / a;
+        kmax = (-b + d) / a;
+    }
+    else if (c > Node->rmax)
+        return false;
 
-                rint[i].w[1] = P[Y] + k * D[Y];
-            }
-        }
+    /* Depths where the ray is within the height range. */
+
+    if (D[Y] != 0.0)
+    {
+        k1 = (Node->hmin - P[Y]) / D[Y];
+        k2 = (Node->hmax - P[Y]) / D[Y];
+
+        if (k1 > k2)
+            std::swap(k1, k2);
+
+        kmin = std::max(kmin, k1);
+        kmax = std::min(kmax, k2);
     }
+    else if ((P[Y] < Node->hmin) || (P[Y] > Node->hmax))
+        return false;
+
+    return (kmin <= kmax);
 }
 
+
+
 /*****************************************************************************
 *
 * FUNCTION
 *
-*   insert_hit
+*   intersect_bound_tree
 *
 * INPUT
 *
-*   element   - Intersection to insert
+*   BCyl      - Pointer to lathe structure
 *   intervals - List of intervals
-*   cnt       - Number of elements in the list
+*   P, D      - Current ray
 *
 * OUTPUT
 *
-*   intervals, cnt
+*   intervals
 *
 * RETURNS
 *
 * AUTHOR
 *
-*   Dieter Bayer
-*
 * DESCRIPTION
 *
-*   Insert an intersection into the depth sorted intersection list.
+*   Intersect the bounding cylinders of all segments using the segment
+*   tree, skipping groups of segments whose enclosing cylinder is missed.
+*   The bounding discs and cylinders are only intersected once they are
+*   needed by a segment.
 *
 * CHANGES
 *
-*   Oct 1996 : Creation.
+*   -
 *
 ******************************************************************************/
 
-static void insert_hit(const BCYL_INT *element, vector<BCYL_INT>& intervals)
+static void intersect_bound_tree(const BCYL *BCyl, vector<BCYL_INT>& intervals, vector<BCYL_INT>& rint, vector<BCYL_INT>& hint, const Vector3d& P, const Vector3d& D)
 {
-    // TODO - a heap-based priority queue might be faster
+    int i, index;
+    DBL a, b, bb, b2, c;
+    DBL dist[8];
+    bool planes;
+    const BCYL_ENTRY *Entry;
+    const BCyl_Node_Struct *Node;
+
+    a = D[X] * D[X] + D[Z] * D[Z];
+
+    b = P[X] * D[X] + P[Z] * D[Z];
+
+    bb = b * b;
+
+    b2 = 2.0 * b;
+
+    c = P[X] * P[X] + P[Z] * P[Z];
+
+    planes = ((D[Y] < -EPSILON) || (D[Y] > EPSILON));
+
+    /* Mark all discs and cylinders as not intersected yet. */
+
+    for (i = 0; i < BCyl->nheight; i++)
+        hint[i].n = -1;
+
+    for (i = 0; i < BCyl->nradius; i++)
+        rint[i].n = -1;
+
+    index = 0;
+
+    while (index < BCyl->nnodes)
+    {
+        Node = &BCyl->node[index];
+
+        if (!intersect_bound_node(Node, P, D, a, b, c))
+        {
+            index = Node->skip;
+            continue;
+        }
+
+        if (Node->count == 0)
+        {
+            index++;
+            continue;
+        }
+
+        for (i = Node->first; i < Node->first + Node->count; i++)
+        {
+            Entry = &BCyl->entry[i];
+
+            if (hint[Entry->h1].n < 0)
+                intersect_bound_height(BCyl->height[Entry->h1], hint[Entry->h1], P, D, planes, a, b2, c);
 
-    vector<BCYL_INT>::iterator k = intervals.begin();
-    while ((k != intervals.end()) && (element->d[0] > k->d[0]))
-        k ++;
+            if (hint[Entry->h2].n < 0)
+                intersect_bound_height(BCyl->height[Entry->h2], hint[Entry->h2], P, D, planes, a, b2, c);
 
-    intervals.insert(k, *element);
+            if (rint[Entry->r1].n < 0)
+                intersect_bound_radius(BCyl->radius[Entry->r1], rint[Entry->r1], P, D, a, b, bb, c);
+
+            if (rint[Entry->r2].n < 0)
+                intersect_bound_radius(BCyl->radius[Entry->r2], rint[Entry->r2], P, D, a, b, bb, c);
+
+            insert_hit(i, intersect_thick_cylinder(BCyl, rint, hint, Entry, dist), dist, intervals);
+        }
+
+        index = Node->skip;
+    }
 }
 
 
@@ -401,98 +694,118 @@ int Intersect_BCyl(const BCYL *BCyl, vector<BCYL_INT>& intervals, vector<BCYL_IN
 {
     int i;
     DBL dist[8];
-    BCYL_INT Inter;
-    BCYL_ENTRY *Entry;
 
     intervals.clear();
 
-    Inter.d[1] = 0.0;
-
-    /* Intersect all cylinder and plane elements. */
+    if (rint.size() < (size_t)BCyl->nradius)
+        rint.resize(BCyl->nradius);
 
-    intersect_bound_elements(BCyl, rint, hint, P, D);
+    if (hint.size() < (size_t)BCyl->nheight)
+        hint.resize(BCyl->nheight);
 
-    /* Intersect all spline segments. */
-    for (i = 0; i < BCyl->number; i++)
+    if (BCyl->node != nullptr)
     {
-        Entry = &BCyl->entry[i];
+        intersect_bound_tree(BCyl, intervals, rint, hint, P, D);
+    }
+    else
+    {
+        /* Intersect all cylinder and plane elements. */
 
-        switch (intersect_thick_cylinder(BCyl, rint, hint, Entry, dist))
-        {
-            case 0:
-                break;
+        intersect_bound_elements(BCyl, rint, hint, P, D);
 
-            case 2:
+        /* Intersect all spline segments. */
 
-                if (dist[0] > EPSILON)
-                {
-                    Inter.d[0] = dist[0];
-                    Inter.n    = i;
+        for (i = 0; i < BCyl->number; i++)
+        {
+            insert_hit(i, intersect_thick_cylinder(BCyl, rint, hint, &BCyl->entry[i], dist), dist, intervals);
+        }
+    }
 
-                    insert_hit(&Inter, intervals);
-                }
-                else if (dist[1] > EPSILON)
-                {
-                    Inter.d[0] = 0.0;
-                    Inter.n    = i;
+    std::sort(intervals.begin(), intervals.end(), compare_hits);
 
-                    insert_hit(&Inter, intervals);
-                }
+    return(intervals.size());
+}
 
-                break;
 
-            case 4:
-
-                if (dist[0] > EPSILON)
-                {
-                    Inter.d[0] = dist[0];
-                    Inter.n    = i;
-
-                    insert_hit(&Inter, intervals);
-                }
-                else if (dist[1] > EPSILON)
-                {
-                    Inter.d[0] = 0.0;
-                    Inter.n    = i;
-
-                    insert_hit(&Inter, intervals);
-                }
-                else if (dist[2] > EPSILON)
-                {
-                    Inter.d[0] = dist[2];
-                    Inter.n    = i;
-
-                    insert_hit(&Inter, intervals);
-                }
-                else if (dist[3] > EPSILON)
-                {
-                    Inter.d[0] = 0.0;
-                    Inter.n    = i;
-
-                    insert_hit(&Inter, intervals);
-                }
 
-                break;
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   build_bound_tree
+*
+* INPUT
+*
+*   BCyl  - Bounding cylinder whose segments to arrange
+*   first - Index of first segment to cover
+*   count - Number of segments to cover
+*   index - Index of node to create
+*
+* OUTPUT
+*
+*   BCyl
+*
+* RETURNS
+*
+*   int - index of the node following the created subtree
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Create the segment tree node covering a range of segments, and
+*   recursively its subtree. Consecutive segments of a spline are close
+*   to each other, so the ranges are simply split in halves. Nodes are
+*   stored in depth-first order, and each node records where to continue
+*   if the ray misses it, so that the tree can be traversed without a
+*   stack.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
 
-            default:
+static int build_bound_tree(BCYL *BCyl, int first, int count, int index)
+{
+    int i, next;
+    DBL rmax, hmin, hmax;
+    BCyl_Node_Struct *Node = &BCyl->node[index];
 
-                /*
-                 * We weren't able to find an even number of intersections. Thus
-                 * we can't tell where the ray enters and leaves the bounding
-                 * cylinder. To avoid problems we assume that the ray is always
-                 * inside the cylinder in that case.
-                 */
+    rmax = 0.0;
+    hmin =  BOUND_HUGE;
+    hmax = -BOUND_HUGE;
 
-                Inter.d[0] = dist[0];
-                Inter.n    = i;
+    for (i = first; i < first + count; i++)
+    {
+        rmax = std::max(rmax, BCyl->radius[BCyl->entry[i].r2]);
+        hmin = std::min(hmin, BCyl->height[BCyl->entry[i].h1]);
+        hmax = std::max(hmax, BCyl->height[BCyl->entry[i].h2]);
+    }
 
-                insert_hit(&Inter, intervals);
+    Node->rmax  = rmax + BCyl_Tree_Tolerance * (rmax + 1.0);
+    Node->hmin  = hmin - BCyl_Tree_Tolerance * (fabs(hmin) + 1.0);
+    Node->hmax  = hmax + BCyl_Tree_Tolerance * (fabs(hmax) + 1.0);
+    Node->first = first;
 
-                break;
-        }
+    if (count <= BCyl_Tree_Leaf_Size)
+    {
+        Node->count = count;
+        Node->skip  = index + 1;
+
+        return(index + 1);
     }
 
-    return(intervals.size());
+    Node->count = 0;
+
+    next = build_bound_tree(BCyl, first, count / 2, index + 1);
+    next = build_bound_tree(BCyl, first + count / 2, count - count / 2, next);
+
+    /* The recursion does not move the nodes, so Node is still valid. */
+
+    Node->skip = next;
+
+    return(next);
 }
 
 
@@ -662,6 +975,18 @@ BCYL *Create_BCyl(int number, const DBL *tmp_r1, const DBL *tmp_r2, const DBL *t
         bcyl->entry[i].h2 = tmp_h2_index[i];
     }
 
+    /* Build a segment tree for splines with many segments. */
+
+    bcyl->nnodes = 0;
+    bcyl->node = nullptr;
+
+    if (bcyl->number >= BCyl_Tree_Threshold)
+    {
+        bcyl->node = new BCyl_Node_Struct[2 * bcyl->number];
+
+        bcyl->nnodes = build_bound_tree(bcyl, 0, bcyl->number, 0);
+    }
+
 /*
     fprintf(stderr, "number of different radii   = %d\n", nr);
     fprintf(stderr, "number of different heights = %d\n", nh);
@@ -711,6 +1036,8 @@ BCYL *Create_BCyl(int number, const DBL *tmp_r1, const DBL *tmp_r2, const DBL *t
 
 void Destroy_BCyl(BCYL *BCyl)
 {
+    delete[] BCyl->node;
+
     delete[] BCyl->entry;
 
     delete[] BCyl->radius;
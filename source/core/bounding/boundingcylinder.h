@@ -90,6 +90,15 @@ struct BCyl_Entry_Struct final
 };
 using BCYL_ENTRY = BCyl_Entry_Struct; ///< @deprecated
 
+struct BCyl_Node_Struct final
+{
+    DBL rmax;            /* Largest squared bound-radius of the segments.     */
+    DBL hmin, hmax;      /* Smallest and largest bound-height of the segments. */
+    int first;           /* Index of first segment covered.                   */
+    int count;           /* Number of segments covered, 0 for inner nodes.    */
+    int skip;            /* Node to continue with if this one is missed.      */
+};
+
 struct BCyl_Struct final
 {
     int number;          /* Number of bounding cylinders.       */
@@ -98,6 +107,8 @@ struct BCyl_Struct final
     DBL *radius;         /* List of different bound-radii.      */
     DBL *height;         /* List of different bound-heights.    */
     BCYL_ENTRY *entry;   /* BCyl elements.                      */
+    int nnodes;          /* Number of segment tree nodes.       */
+    BCyl_Node_Struct *node; /* Segment tree in depth-first order, or nullptr for few segments. */
 };
 
 
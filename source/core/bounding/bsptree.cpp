@@ -43,12 +43,16 @@
 
 // C++ standard header files
 #include <algorithm>
+#include <chrono>
+#include <exception>
 #include <list>
+#include <thread>
 #if BSP_WRITEBOUNDS || BSP_READNODES || BSP_WRITETREE
 #include <string>
 #endif
 
 // POV-Ray header files (base module)
+#include "base/fileinputoutput.h"
 #include "base/stringutilities.h"
 #include "base/pov_err.h"
 
@@ -87,13 +91,32 @@ using std::vector;
 
 const unsigned int NODE_PROGRESS_INTERVAL = 1000;
 
+/// Minimum number of objects for a node to have its children built concurrently.
+const unsigned int PARALLEL_BUILD_THRESHOLD = 4096;
+
+/// Progress callback used by the helper threads of a parallel build.
+class BSPNoProgress final : public BSPTree::Progress
+{
+    public:
+        virtual void operator()(unsigned int) const override { }
+};
+
 //******************************************************************************
 
-void BSPTree::Mailbox::clear()
+void BSPTree::Mailbox::resize(unsigned int range)
+{
+    if (stamps.size() < range)
+    {
+        stamps.resize(range);
+        reset();
+    }
+}
+
+void BSPTree::Mailbox::reset()
 {
-    count = 0;
+    stamp = 1;
     // using memset here as std::fill may not be fast with every standard libaray [trf]
-    std::memset(objects.data(), 0, objects.size() * sizeof(unsigned int));
+    std::memset(stamps.data(), 0, stamps.size() * sizeof(POV_UINT32));
 }
 
 //******************************************************************************
@@ -127,7 +150,7 @@ BSPTree::~BSPTree()
 static FILE *gFile = nullptr;
 #endif
 
-bool BSPTree::operator()(const BasicRay& ray, Intersect& isect, Mailbox& mailbox, double maxdist)
+bool BSPTree::operator()(const BasicRay& ray, Intersect& isect, Mailbox& mailbox, double maxdist, bool earlyExit)
 {
     TraceStack tstack[MAX_BSP_TREE_LEVEL];
     Vector3d rayorigin(ray.GetOrigin());
@@ -203,6 +226,9 @@ bool BSPTree::operator()(const BasicRay& ray, Intersect& isect, Mailbox& mailbox
                     break;
             }
 
+            if (earlyExit && isect())
+                return true;
+
             // see if there is another node to process
             if(tstackpos > 0)
             {
@@ -276,19 +302,12 @@ bool BSPTree::operator()(const Vector3d& origin, Inside& inside, Mailbox& mailbo
 void BSPTree::build(const Progress& progress, const Objects& objects,
                     unsigned int& totalnodes, unsigned int& splitnodes, unsigned int& objectnodes, unsigned int& emptynodes,
                     unsigned int& maxobjects, float& averageobjects, unsigned int& maxdepth, float& averagedepth,
-                    unsigned int& aborts, float& averageaborts, float& averageabortobjects, const UCS2String& inputFile)
+                    unsigned int& aborts, float& averageaborts, float& averageabortobjects, const UCS2String& inputFile,
+                    unsigned int threads, vector<POV_LONG>& depthTimes)
 {
     MinMaxBoundingBox bbox;
 
-    lastProgressNodeCounter = 0;
-    maxObjectsInNode = 0;
-    maxTreeDepth = 0;
-    maxTreeDepthNodes = 0;
-    emptyNodeCounter = 0;
-    objectNodeCounter = 0;
-    objectsInTreeCounter = 0;
-    objectsAtMaxDepthCounter = 0;
-    treeDepthCounter = 0;
+    ResetCounters();
 
     progress(0);
 
@@ -408,7 +427,10 @@ void BSPTree::build(const Progress& progress, const Objects& objects,
     ReadRecursive(progress, infile, 0, 0, objects.size() - 1);
     fclose(infile);
 #else
-    BuildRecursive(progress, objects, 0, 0, (unsigned int) indices.size(), bbox, maxDepth);
+#if BSP_WRITETREE
+    threads = 1; // tree output is written while building, so we need to build in order
+#endif
+    BuildRecursive(progress, objects, 0, 0, (unsigned int) indices.size(), bbox, maxDepth, max(threads, 1u));
 #endif
 
 #if BSP_WRITETREE
@@ -458,6 +480,23 @@ void BSPTree::build(const Progress& progress, const Objects& objects,
     nodes = tmpnodes;
 
     indices.clear();
+
+    depthTimes.assign(depthTimeCounter.begin(), depthTimeCounter.begin() + min(maxTreeDepth + 1, (unsigned int) depthTimeCounter.size()));
+    depthTimeCounter.clear();
+}
+
+void BSPTree::ResetCounters()
+{
+    lastProgressNodeCounter = 0;
+    maxObjectsInNode = 0;
+    maxTreeDepth = 0;
+    maxTreeDepthNodes = 0;
+    emptyNodeCounter = 0;
+    objectNodeCounter = 0;
+    objectsInTreeCounter = 0;
+    objectsAtMaxDepthCounter = 0;
+    treeDepthCounter = 0;
+    depthTimeCounter.assign(maxDepth + 1, 0);
 }
 
 void BSPTree::clear()
@@ -466,7 +505,7 @@ void BSPTree::clear()
     lists.clear();
 }
 
-void BSPTree::BuildRecursive(const Progress& progress, const Objects& objects, unsigned int inode, unsigned int indexbegin, unsigned int indexend, MinMaxBoundingBox& cell, unsigned int maxlevel)
+void BSPTree::BuildRecursive(const Progress& progress, const Objects& objects, unsigned int inode, unsigned int indexbegin, unsigned int indexend, MinMaxBoundingBox& cell, unsigned int maxlevel, unsigned int threads)
 {
     maxTreeDepth = max(maxTreeDepth, maxDepth - maxlevel);
 
@@ -525,6 +564,8 @@ void BSPTree::BuildRecursive(const Progress& progress, const Objects& objects, u
     // set bestcost to estimated time for processing unsplit node
     float bestcost = baseAccessCost + (cnt * objectIsectCost);
 
+    std::chrono::steady_clock::time_point splitStartTime = std::chrono::steady_clock::now();
+
     // find best split axis and plane
     {
         float cellsize[5];
@@ -627,6 +668,8 @@ void BSPTree::BuildRecursive(const Progress& progress, const Objects& objects, u
         }
     }
 
+    depthTimeCounter[maxDepth - maxlevel] += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - splitStartTime).count();
+
     if(bestaxis == Node::NoAxis) // no better split found, so stop at this node
     {
         SetObjectNode(inode, indexbegin, indexend);
@@ -688,17 +731,24 @@ void BSPTree::BuildRecursive(const Progress& progress, const Objects& objects, u
         }
         unsigned int end = (unsigned int) indices.size();
 
-        // split left cell
-        ptemp = cell.pmax[bestaxis];
-        cell.pmax[bestaxis] = bestplane;
-        BuildRecursive(progress, objects, ichild, begin, middle, cell, maxlevel - 1);
-        cell.pmax[bestaxis] = ptemp;
-
-        // split right cell
-        ptemp = cell.pmin[bestaxis];
-        cell.pmin[bestaxis] = bestplane;
-        BuildRecursive(progress, objects, ichild + 1, middle, end, cell, maxlevel - 1);
-        cell.pmin[bestaxis] = ptemp;
+        if((threads > 1) && (cnt >= PARALLEL_BUILD_THRESHOLD))
+        {
+            BuildChildrenParallel(progress, objects, ichild, begin, middle, end, cell, bestaxis, bestplane, maxlevel - 1, threads);
+        }
+        else
+        {
+            // split left cell
+            ptemp = cell.pmax[bestaxis];
+            cell.pmax[bestaxis] = bestplane;
+            BuildRecursive(progress, objects, ichild, begin, middle, cell, maxlevel - 1, threads);
+            cell.pmax[bestaxis] = ptemp;
+
+            // split right cell
+            ptemp = cell.pmin[bestaxis];
+            cell.pmin[bestaxis] = bestplane;
+            BuildRecursive(progress, objects, ichild + 1, middle, end, cell, maxlevel - 1, threads);
+            cell.pmin[bestaxis] = ptemp;
+        }
 
         // the efficiency of this code depends on the assumption that resize() does not
         // de-allocate memory when truncating a vector.
@@ -706,6 +756,194 @@ void BSPTree::BuildRecursive(const Progress& progress, const Objects& objects, u
     }
 }
 
+// The left child is built into a separate tree by a helper thread, while the right child is built
+// by the current thread as usual. Once both are done, the separate tree is merged into this one.
+// As both children are built from exactly the same data as in the single-threaded case, only the
+// order of the nodes and object lists differs; since the merge always happens after the right
+// child has been completed, that order is deterministic as well.
+void BSPTree::BuildChildrenParallel(const Progress& progress, const Objects& objects, unsigned int ichild, unsigned int begin, unsigned int middle, unsigned int end,
+                                    MinMaxBoundingBox& cell, unsigned int axis, float plane, unsigned int maxlevel, unsigned int threads)
+{
+    // NB: missChance has had 1.0f added to it, which the constructor will do again
+    BSPTree left(maxDepth, objectIsectCost, baseAccessCost, childAccessCost, missChance - 1.0f);
+    MinMaxBoundingBox leftcell = cell;
+    unsigned int leftcnt = middle - begin;
+    unsigned int leftthreads = threads / 2;
+    std::exception_ptr leftexception;
+
+    leftcell.pmax[axis] = plane;
+
+    left.ResetCounters();
+    left.indices.reserve(leftcnt * 4);
+    left.indices.assign(indices.begin() + begin, indices.begin() + middle);
+    left.splits[X].resize(leftcnt * 2);
+    left.splits[Y].resize(leftcnt * 2);
+    left.splits[Z].resize(leftcnt * 2);
+    left.nodes.push_back(Node());
+
+    std::thread leftthread([&]()
+    {
+        try
+        {
+            BSPNoProgress noprogress;
+            left.BuildRecursive(noprogress, objects, 0, 0, leftcnt, leftcell, maxlevel, leftthreads);
+        }
+        catch(...)
+        {
+            leftexception = std::current_exception();
+        }
+    });
+
+    try
+    {
+        float ptemp = cell.pmin[axis];
+        cell.pmin[axis] = plane;
+        BuildRecursive(progress, objects, ichild + 1, middle, end, cell, maxlevel, threads - leftthreads);
+        cell.pmin[axis] = ptemp;
+    }
+    catch(...)
+    {
+        leftthread.join();
+        throw;
+    }
+
+    leftthread.join();
+    if(leftexception)
+        std::rethrow_exception(leftexception);
+
+    Merge(left, ichild);
+}
+
+void BSPTree::Merge(const BSPTree& subtree, unsigned int inode)
+{
+    // subtree node 0 replaces node inode; all others are appended
+    unsigned int nodeoffset = (unsigned int) nodes.size() - 1;
+    unsigned int listoffset = (unsigned int) lists.size();
+
+    for(unsigned int i = 0; i < subtree.nodes.size(); i++)
+    {
+        Node node = subtree.nodes[i];
+
+        if(node.type == Node::Split)
+            node.index += nodeoffset;
+        else if(node.data == Node::ObjectList)
+            node.index2 += listoffset;
+
+        if(i == 0)
+            nodes[inode] = node;
+        else
+            nodes.push_back(node);
+    }
+
+    lists.insert(lists.end(), subtree.lists.begin(), subtree.lists.end());
+
+    maxObjectsInNode = max(maxObjectsInNode, subtree.maxObjectsInNode);
+    maxTreeDepth = max(maxTreeDepth, subtree.maxTreeDepth);
+    maxTreeDepthNodes += subtree.maxTreeDepthNodes;
+    emptyNodeCounter += subtree.emptyNodeCounter;
+    objectNodeCounter += subtree.objectNodeCounter;
+    objectsInTreeCounter += subtree.objectsInTreeCounter;
+    objectsAtMaxDepthCounter += subtree.objectsAtMaxDepthCounter;
+    treeDepthCounter += subtree.treeDepthCounter;
+    for(size_t i = 0; i < depthTimeCounter.size(); i++)
+        depthTimeCounter[i] += subtree.depthTimeCounter[i];
+}
+
+bool BSPTree::Save(OStream& os) const
+{
+    POV_UINT32 header[2] = { POV_UINT32(nodes.size()), POV_UINT32(lists.size()) };
+    double bounds[6] = { bmin[X], bmin[Y], bmin[Z], bmax[X], bmax[Y], bmax[Z] };
+
+    if(!os.write(header, sizeof(header)) || !os.write(bounds, sizeof(bounds)))
+        return false;
+
+    // nodes are stored as pairs of 32 bit words to not depend on the compiler's bit field layout
+    for(vector<Node>::const_iterator i(nodes.begin()); i != nodes.end(); i++)
+    {
+        POV_UINT32 data[2] = { POV_UINT32(i->type) | (POV_UINT32(i->data) << 1) | (POV_UINT32(i->index) << 3), i->index2 };
+
+        if(!os.write(data, sizeof(data)))
+            return false;
+    }
+
+    return lists.empty() || os.write(lists.data(), lists.size() * sizeof(unsigned int));
+}
+
+bool BSPTree::Load(IStream& is, unsigned int objectCount)
+{
+    POV_UINT32 header[2];
+    double bounds[6];
+
+    clear();
+
+    if(!is.read(header, sizeof(header)) || !is.read(bounds, sizeof(bounds)) || (header[0] == 0))
+        return false;
+
+    nodes.resize(header[0]);
+    lists.resize(header[1]);
+
+    for(vector<Node>::iterator i(nodes.begin()); i != nodes.end(); i++)
+    {
+        POV_UINT32 data[2];
+
+        if(!is.read(data, sizeof(data)))
+        {
+            clear();
+            return false;
+        }
+
+        i->type = data[0] & 1;
+        i->data = (data[0] >> 1) & 3;
+        i->index = data[0] >> 3;
+        i->index2 = data[1];
+    }
+
+    if(!lists.empty() && !is.read(lists.data(), lists.size() * sizeof(unsigned int)))
+    {
+        clear();
+        return false;
+    }
+
+    // make sure traversal can neither leave the arrays nor overflow the trace stack
+    vector<unsigned int> level(nodes.size(), 0);
+    bool valid = true;
+
+    for(unsigned int i = 0; (i < nodes.size()) && valid; i++)
+    {
+        const Node& node = nodes[i];
+
+        if(node.type == Node::Split)
+        {
+            valid = (node.data != Node::NoAxis) && (node.index > i) && (node.index + 1 < nodes.size()) && (level[i] < MAX_BSP_TREE_LEVEL - 1);
+            if(valid)
+            {
+                level[node.index] = max(level[node.index], level[i] + 1);
+                level[node.index + 1] = max(level[node.index + 1], level[i] + 1);
+            }
+        }
+        else if(node.data == Node::SingleObject)
+            valid = (node.index < objectCount);
+        else if(node.data == Node::DoubleObject)
+            valid = (node.index < objectCount) && (node.index2 < objectCount);
+        else if(node.data == Node::ObjectList)
+            valid = (node.index2 <= lists.size()) && (node.index <= lists.size() - node.index2);
+    }
+
+    for(vector<unsigned int>::const_iterator i(lists.begin()); (i != lists.end()) && valid; i++)
+        valid = (*i < objectCount);
+
+    if(!valid)
+    {
+        clear();
+        return false;
+    }
+
+    bmin = Vector3d(bounds[0], bounds[1], bounds[2]);
+    bmax = Vector3d(bounds[3], bounds[4], bounds[5]);
+
+    return true;
+}
+
 void BSPTree::SetObjectNode(unsigned int inode, unsigned int indexbegin, unsigned int indexend)
 {
     unsigned int count = indexend - indexbegin;
@@ -941,16 +1179,11 @@ BSPIntersectFunctor::BSPIntersectFunctor(Intersection& bi, const Ray& r, vector<
 bool BSPIntersectFunctor::operator()(unsigned int index, double& maxdist)
 {
     ObjectPtr object = objects[index];
-    Intersection isect;
 
-    if(Find_Intersection(&isect, object, ray, variant, origin, invdir, traceThreadData) && (isect.Depth <= maxdist))
+    if(Find_Intersection(&bestisect, object, ray, variant, origin, invdir, traceThreadData, min(maxdist, bestisect.Depth)))
     {
-        if(isect.Depth < bestisect.Depth)
-        {
-            bestisect = isect;
-            found = true;
-            maxdist = bestisect.Depth;
-        }
+        found = true;
+        maxdist = bestisect.Depth;
     }
 
     return found;
@@ -984,24 +1217,66 @@ bool BSPIntersectCondFunctor::operator()(unsigned int index, double& maxdist)
     ObjectPtr object = objects[index];
 
     if(precondition(ray, object, 0.0) == true)
+    {
+        if(Find_Intersection(&bestisect, object, ray, variant, origin, invdir, postcondition, traceThreadData, min(maxdist, bestisect.Depth)))
+        {
+            found = true;
+            maxdist = bestisect.Depth;
+        }
+    }
+
+    return found;
+}
+
+bool BSPIntersectCondFunctor::operator()() const
+{
+    return found;
+}
+
+//******************************************************************************
+
+BSPOcclusionCondFunctor::BSPOcclusionCondFunctor(Intersection& oi, const Ray& r, vector<ObjectPtr>& objs, TraceThreadData *t,
+                                                 const RayObjectCondition& prec, const RayObjectCondition& postc, const IntersectionCondition& occc) :
+    found(false),
+    otherHits(false),
+    objects(objs),
+    occluder(oi),
+    ray(r),
+    traceThreadData(t),
+    precondition(prec),
+    postcondition(postc),
+    occlusion(occc)
+{
+    Vector3d tmp(1.0 / ray.GetDirection()[X], 1.0 / ray.GetDirection()[Y], 1.0 /ray.GetDirection()[Z]);
+    origin = BBoxVector3d(ray.Origin);
+    invdir = BBoxVector3d(tmp);
+    variant = (BBoxDirection)((int(invdir[X] < 0.0) << 2) | (int(invdir[Y] < 0.0) << 1) | int(invdir[Z] < 0.0));
+}
+
+bool BSPOcclusionCondFunctor::operator()(unsigned int index, double& maxdist)
+{
+    ObjectPtr object = objects[index];
+
+    if((found == false) && (precondition(ray, object, 0.0) == true))
     {
         Intersection isect;
 
-        if(Find_Intersection(&isect, object, ray, variant, origin, invdir, postcondition, traceThreadData) && (isect.Depth <= maxdist))
+        if(Find_Intersection(&isect, object, ray, variant, origin, invdir, postcondition, traceThreadData) && (isect.Depth < maxdist))
         {
-            if(isect.Depth < bestisect.Depth)
+            if(occlusion(isect))
             {
-                bestisect = isect;
+                occluder = isect;
                 found = true;
-                maxdist = bestisect.Depth;
             }
+            else
+                otherHits = true;
         }
     }
 
     return found;
 }
 
-bool BSPIntersectCondFunctor::operator()() const
+bool BSPOcclusionCondFunctor::operator()() const
 {
     return found;
 }
@@ -46,10 +46,11 @@
 #include <vector>
 
 // POV-Ray header files (base module)
-//  (none at the moment)
+#include "base/fileinputoutput_fwd.h"
 
 // POV-Ray header files (core module)
 #include "core/bounding/boundingbox.h"
+#include "core/support/statistics.h"
 
 namespace pov
 {
@@ -65,31 +66,61 @@ class BSPTree final
 {
     public:
 
+        /// Set of objects already tested during a single tree query.
+        ///
+        /// Rather than clearing a bit per object before each query, every object is stamped with
+        /// the current query's generation number when inserted; starting a new query merely bumps
+        /// that number, and only when it wraps around are the stamps actually reset. This allows
+        /// a single mailbox to be kept per thread (see @ref TraceThreadData) and reused for all
+        /// queries at virtually no cost, regardless of the number of objects in the scene.
+        ///
         class Mailbox final
         {
                 friend class BSPTree;
             public:
-                inline Mailbox(unsigned int range) : objects((range >> 5) + 1), count(0) { }
-                void clear();
+                inline Mailbox(RenderStatistics& stats) : stamp(1), count(0), stats(stats) { }
+
+                /// Make sure the mailbox can hold objects with indices in the range [0,range).
+                void resize(unsigned int range);
+
+                /// Start a new query, forgetting all objects inserted so far.
+                inline void clear()
+                {
+                    count = 0;
+                    if (++stamp == 0)
+                        reset();
+                }
+
                 inline unsigned int size() const { return count; }
 
                 inline bool insert(unsigned int i)
                 {
-                    if((objects[i >> 5] & (1 << (i & 31))) == 0)
+                    stats[BSP_Mailbox_Tests]++;
+                    if (stamps[i] != stamp)
                     {
-                        objects[i >> 5] |= (1 << (i & 31));
+                        stamps[i] = stamp;
                         count++;
                         return true;
                     }
+                    stats[BSP_Mailbox_Hits]++;
                     return false;
                 }
             private:
-                /// bit marking object (by index) in mailbox
-                std::vector<unsigned int> objects;
+                /// generation number of the last query each object (by index) was inserted in
+                std::vector<POV_UINT32> stamps;
+                /// generation number of the current query
+                POV_UINT32 stamp;
                 /// number of objects in mailbox
                 unsigned int count;
+                /// statistics to report mailbox lookups to
+                RenderStatistics& stats;
+
+                /// Invalidate all stamps.
+                void reset();
 
                 Mailbox() = delete;
+                Mailbox(const Mailbox&) = delete;
+                Mailbox& operator=(const Mailbox&) = delete;
         };
 
         class Objects
@@ -135,16 +166,55 @@ class BSPTree final
         BSPTree(unsigned int md = 0, float oic = 0.0f, float bac = 0.0f, float cac = 0.0f, float mc = 0.0f);
         virtual ~BSPTree();
 
-        bool operator()(const BasicRay& ray, Intersect& isect, Mailbox& mailbox, double maxdist);
+        /// Find intersections along a ray.
+        ///
+        /// @param[in]      ray         Ray to trace.
+        /// @param[in]      isect       Intersection functor; see @ref Intersect.
+        /// @param[in]      mailbox     Mailbox to keep track of the objects already tested.
+        /// @param[in]      maxdist     Maximum distance.
+        /// @param[in]      earlyExit   Stop as soon as the functor reports a hit, rather than continuing
+        ///                             to look for a closer one (any-hit query).
+        ///
+        bool operator()(const BasicRay& ray, Intersect& isect, Mailbox& mailbox, double maxdist, bool earlyExit = false);
         bool operator()(const Vector3d& origin, Inside& inside, Mailbox& mailbox, bool earlyExit = false);
 
+        /// Build the tree.
+        ///
+        /// @note   When `threads` is greater than 1, subtrees containing a sufficient number of objects are
+        ///         built concurrently. The resulting tree differs from a single-threaded build only in the
+        ///         order in which nodes and object lists are stored, and is identical for any given
+        ///         number of threads.
+        ///
+        /// @param[in]  progress        Progress callback. Only invoked from the calling thread.
+        /// @param[in]  objects         Objects to build the tree for.
+        /// @param[in]  threads         Maximum number of threads to use.
+        /// @param[out] depthTimes      Time (in microseconds) spent choosing split planes, summed per tree depth.
+        ///
         void build(const Progress& progress, const Objects& objects,
                    unsigned int& nodes, unsigned int& splitNodes, unsigned int& objectNodes, unsigned int& emptyNodes,
                    unsigned int& maxObjects, float& averageObjects, unsigned int& maxDepth, float& averageDepth,
-                   unsigned int& aborts, float& averageAborts, float& averageAbortObjects, const UCS2String& inputFile);
+                   unsigned int& aborts, float& averageAborts, float& averageAbortObjects, const UCS2String& inputFile,
+                   unsigned int threads, std::vector<POV_LONG>& depthTimes);
 
         void clear();
 
+        /// Write the finished tree to a binary stream.
+        ///
+        /// @note   The data is written in native byte order and is only intended to be read back by
+        ///         @ref Load() on the same machine.
+        ///
+        /// @return `true` if the tree was written successfully.
+        ///
+        bool Save(OStream& os) const;
+
+        /// Read a tree previously written by @ref Save().
+        ///
+        /// @param[in]  is              Stream to read from.
+        /// @param[in]  objectCount     Number of objects the tree is expected to reference.
+        /// @return                     `true` if a valid tree was read; otherwise the tree is left empty.
+        ///
+        bool Load(IStream& is, unsigned int objectCount);
+
     private:
 
         struct Node final
@@ -259,8 +329,14 @@ class BSPTree final
         POV_LONG treeDepthCounter;
         /// object index list (only used while building tree)
         std::vector<unsigned int> indices;
-
-        void BuildRecursive(const Progress& progress, const Objects& objects, unsigned int inode, unsigned int indexbegin, unsigned int indexend, MinMaxBoundingBox& cell, unsigned int maxlevel);
+        /// split plane selection time per tree depth in microseconds (only used while building tree)
+        std::vector<POV_LONG> depthTimeCounter;
+
+        void BuildRecursive(const Progress& progress, const Objects& objects, unsigned int inode, unsigned int indexbegin, unsigned int indexend, MinMaxBoundingBox& cell, unsigned int maxlevel, unsigned int threads);
+        void BuildChildrenParallel(const Progress& progress, const Objects& objects, unsigned int ichild, unsigned int begin, unsigned int middle, unsigned int end,
+                                   MinMaxBoundingBox& cell, unsigned int axis, float plane, unsigned int maxlevel, unsigned int threads);
+        void ResetCounters();
+        void Merge(const BSPTree& subtree, unsigned int inode);
         void SetObjectNode(unsigned int inode, unsigned int indexbegin, unsigned int indexend);
 
         void ReadRecursive(const Progress& progress, FILE *infile, unsigned int inode, unsigned int level, unsigned int maxIndex);
@@ -312,6 +388,40 @@ class BSPIntersectCondFunctor final : public BSPTree::Intersect
         const RayObjectCondition& postcondition;
 };
 
+/// Intersection functor for any-hit queries.
+///
+/// Reports a hit only for intersections meeting an additional occlusion condition, and does not
+/// shrink the search distance, so that the traversal can stop at the first such intersection
+/// regardless of whether it is the closest one.
+///
+class BSPOcclusionCondFunctor final : public BSPTree::Intersect
+{
+    public:
+
+        BSPOcclusionCondFunctor(Intersection& oi, const Ray& r, std::vector<ObjectPtr>& objs, TraceThreadData *t,
+                                const RayObjectCondition& prec, const RayObjectCondition& postc, const IntersectionCondition& occc);
+        virtual bool operator()(unsigned int index, double& maxdist) override;
+        virtual bool operator()() const override;
+
+        /// Whether any intersections not meeting the occlusion condition were found.
+        inline bool OtherHits() const { return otherHits; }
+
+    private:
+
+        bool found;
+        bool otherHits;
+        std::vector<ObjectPtr>& objects;
+        Intersection& occluder;
+        const Ray& ray;
+        BBoxVector3d origin;
+        BBoxVector3d invdir;
+        BBoxDirection variant;
+        TraceThreadData *traceThreadData;
+        const RayObjectCondition& precondition;
+        const RayObjectCondition& postcondition;
+        const IntersectionCondition& occlusion;
+};
+
 class BSPInsideCondFunctor final : public BSPTree::Inside
 {
     public:
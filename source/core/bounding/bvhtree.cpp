@@ -0,0 +1,1117 @@
+//******************************************************************************
+///
+/// @file core/bounding/bvhtree.cpp
+///
+/// Implementations related to the wide bounding volume hierarchy.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+// Unit header file must be the first file included within POV-Ray *.cpp files (pulls in config)
+#include "core/bounding/bvhtree.h"
+
+// C++ variants of C standard header files
+#include <cmath>
+
+// C++ standard header files
+#include <algorithm>
+#include <limits>
+
+// POV-Ray header files (base module)
+#include "base/fileinputoutput.h"
+#include "base/pov_err.h"
+
+// POV-Ray header files (core module)
+//  (none at the moment)
+
+// this must be the last file included
+#include "base/povdebug.h"
+
+namespace pov
+{
+
+using std::min;
+using std::max;
+using std::vector;
+
+#define BVH_MAX_LEAF_OBJECTS    4
+#define BVH_SAH_BINS            16
+#define BVH_NODE_COST           1.0f    // cost of testing a ray against all boxes of a node
+#define BVH_OBJECT_COST         4.0f    // cost of testing a ray against an object
+#define BVH_TOLERANCE           0.00001f
+#define BVH_MIN_DIRECTION       1.0e-20
+
+const unsigned int BVH_NODE_PROGRESS_INTERVAL = 1000;
+
+//******************************************************************************
+
+static inline float SurfaceArea(const MinMaxBoundingBox& box)
+{
+    float dx = box.pmax[X] - box.pmin[X];
+    float dy = box.pmax[Y] - box.pmin[Y];
+    float dz = box.pmax[Z] - box.pmin[Z];
+    if ((dx < 0.0f) || (dy < 0.0f) || (dz < 0.0f))
+        return 0.0f;
+    return dx * dy + dx * dz + dy * dz;
+}
+
+static inline void MakeEmpty(MinMaxBoundingBox& box)
+{
+    box.pmin = BBoxVector3d(BOUND_HUGE);
+    box.pmax = BBoxVector3d(-BOUND_HUGE);
+}
+
+static inline void Extend(MinMaxBoundingBox& box, const MinMaxBoundingBox& other)
+{
+    for (unsigned int axis = 0; axis < 3; axis++)
+    {
+        box.pmin[axis] = min(box.pmin[axis], other.pmin[axis]);
+        box.pmax[axis] = max(box.pmax[axis], other.pmax[axis]);
+    }
+}
+
+//******************************************************************************
+
+/// Wide bounding volume hierarchy with a fixed number of children per node.
+///
+/// @tparam WIDTH   Number of children per node.
+///
+template<unsigned int WIDTH>
+class WideBVHTree final : public BVHTree
+{
+    public:
+
+        WideBVHTree(unsigned int mlo) : BVHTree(WIDTH, mlo) { }
+        virtual ~WideBVHTree() override { }
+
+        virtual bool operator()(const BasicRay& ray, BSPTree::Intersect& isect, double maxdist, bool earlyExit) const override;
+        virtual bool operator()(const BasicRay& ray, LeafIntersect& isect, double maxdist, bool earlyExit) const override;
+        virtual void operator()(const BasicRay* const rays[], BSPTree::Intersect* const isect[], double maxdist[], unsigned int count) const override;
+        virtual bool operator()(const Vector3d& origin, BSPTree::Inside& inside, bool earlyExit) const override;
+        virtual bool operator()(const Vector3d& origin, LeafIntersect& inside, bool earlyExit) const override;
+
+        virtual void Refit(const BSPTree::Objects& objects) override;
+        virtual float ComputeCost(const BSPTree::Objects& objects) const override;
+        virtual bool Save(OStream& os) const override;
+        virtual bool Load(IStream& is, unsigned int objectCount) override;
+
+        virtual void clear() override;
+
+    protected:
+
+        virtual void Pack(const vector<BuildNode>& buildNodes) override;
+
+    private:
+
+        /// Node in structure-of-arrays layout.
+        ///
+        /// Unused child slots have an inverted (empty) box, so they never pass
+        /// the ray or point tests and need no special handling. They can be
+        /// told apart from tree nodes by a reference of 0, as the root node
+        /// is never referenced by any other node.
+        ///
+        struct Node final
+        {
+            float bmin[3][WIDTH];
+            float bmax[3][WIDTH];
+            /// index of child node, or offset into object list for leaf children
+            unsigned int ref[WIDTH];
+            /// number of objects for leaf children, 0 for inner node children
+            unsigned int count[WIDTH];
+        };
+
+        struct TraceStack final
+        {
+            unsigned int ref;
+            unsigned int count;
+            float dist;
+        };
+
+        struct PacketStack final
+        {
+            unsigned int ref;
+            unsigned int count;
+            /// rays that hit the node
+            unsigned int mask;
+            /// entry distance of each ray
+            float tnear[kMaxPacketSize];
+        };
+
+        /// array of all nodes
+        vector<Node> nodes;
+
+        /// Adapter to test the objects of a leaf one by one.
+        class ObjectLeafIntersect final
+        {
+            public:
+                ObjectLeafIntersect(BSPTree::Intersect& i, const vector<unsigned int>& l) : isect(i), lists(l) { }
+                inline void operator()(unsigned int first, unsigned int count, double& maxdist)
+                {
+                    for (unsigned int i = first, e = first + count; i < e; i++)
+                        isect(lists[i], maxdist);
+                }
+                inline bool operator()() const { return isect(); }
+            private:
+                BSPTree::Intersect& isect;
+                const vector<unsigned int>& lists;
+        };
+
+        /// Adapter to test the objects of a leaf one by one for containing a point.
+        class ObjectLeafInside final
+        {
+            public:
+                ObjectLeafInside(BSPTree::Inside& i, const vector<unsigned int>& l) : inside(i), lists(l) { }
+                inline void operator()(unsigned int first, unsigned int count, double&)
+                {
+                    for (unsigned int i = first, e = first + count; i < e; i++)
+                        inside(lists[i]);
+                }
+                inline bool operator()() const { return inside(); }
+            private:
+                BSPTree::Inside& inside;
+                const vector<unsigned int>& lists;
+        };
+
+        /// Find the closest intersection along a ray, using the given leaf functor.
+        template<typename LEAF>
+        bool Traverse(const BasicRay& ray, LEAF& leaf, double maxdist, bool earlyExit) const;
+
+        /// Find the objects containing a point, using the given leaf functor.
+        template<typename LEAF>
+        bool Locate(const Vector3d& origin, LEAF& leaf, bool earlyExit) const;
+
+        static inline bool IsUnused(const Node& node, unsigned int i) { return (node.count[i] == 0) && (node.ref[i] == 0); }
+        static inline float SurfaceArea(const Node& node, unsigned int i);
+        static void GetNodeBox(const Node& node, MinMaxBoundingBox& box);
+};
+
+template<unsigned int WIDTH>
+inline float WideBVHTree<WIDTH>::SurfaceArea(const Node& node, unsigned int i)
+{
+    MinMaxBoundingBox box;
+    for (unsigned int axis = 0; axis < 3; axis++)
+    {
+        box.pmin[axis] = node.bmin[axis][i];
+        box.pmax[axis] = node.bmax[axis][i];
+    }
+    return pov::SurfaceArea(box);
+}
+
+template<unsigned int WIDTH>
+void WideBVHTree<WIDTH>::GetNodeBox(const Node& node, MinMaxBoundingBox& box)
+{
+    MakeEmpty(box);
+    for (unsigned int i = 0; i < WIDTH; i++)
+    {
+        if (IsUnused(node, i))
+            continue;
+        for (unsigned int axis = 0; axis < 3; axis++)
+        {
+            box.pmin[axis] = min(box.pmin[axis], node.bmin[axis][i]);
+            box.pmax[axis] = max(box.pmax[axis], node.bmax[axis][i]);
+        }
+    }
+}
+
+template<unsigned int WIDTH>
+void WideBVHTree<WIDTH>::Refit(const BSPTree::Objects& objects)
+{
+    // children are always stored after their parent, so processing the nodes
+    // in reverse order guarantees that all children have been refit already
+    for (size_t inode = nodes.size(); inode-- > 0; )
+    {
+        Node& node = nodes[inode];
+
+        for (unsigned int i = 0; i < WIDTH; i++)
+        {
+            MinMaxBoundingBox box;
+
+            if (IsUnused(node, i))
+                continue;
+
+            if (node.count[i] > 0)
+            {
+                MakeEmpty(box);
+                for (unsigned int k = node.ref[i], e = node.ref[i] + node.count[i]; k < e; k++)
+                {
+                    MinMaxBoundingBox objectBox;
+                    GetObjectBox(objects, lists[k], objectBox);
+                    Extend(box, objectBox);
+                }
+            }
+            else
+                GetNodeBox(nodes[node.ref[i]], box);
+
+            for (unsigned int axis = 0; axis < 3; axis++)
+            {
+                node.bmin[axis][i] = box.pmin[axis];
+                node.bmax[axis][i] = box.pmax[axis];
+            }
+        }
+    }
+}
+
+template<unsigned int WIDTH>
+float WideBVHTree<WIDTH>::ComputeCost(const BSPTree::Objects& objects) const
+{
+    if (nodes.empty())
+        return 0.0f;
+
+    // the cost of testing every object's own box serves as the reference, which makes the
+    // result independent of the overall extent of the scene (which changes as objects move)
+    double reference = 0.0;
+    for (unsigned int i = 0; i < objects.size(); i++)
+    {
+        MinMaxBoundingBox box;
+        GetObjectBox(objects, i, box);
+        reference += pov::SurfaceArea(box) * BVH_OBJECT_COST;
+    }
+    if (reference <= 0.0)
+        return 0.0f;
+
+    // every node and object is hit with a probability proportional to its surface area
+    MinMaxBoundingBox rootBox;
+    GetNodeBox(nodes[0], rootBox);
+    double cost = BVH_NODE_COST * pov::SurfaceArea(rootBox);
+    for (typename vector<Node>::const_iterator node = nodes.begin(); node != nodes.end(); node++)
+    {
+        for (unsigned int i = 0; i < WIDTH; i++)
+        {
+            if (IsUnused(*node, i))
+                continue;
+            if (node->count[i] > 0)
+                cost += SurfaceArea(*node, i) * node->count[i] * BVH_OBJECT_COST;
+            else
+                cost += SurfaceArea(*node, i) * BVH_NODE_COST;
+        }
+    }
+
+    return float(cost / reference);
+}
+
+template<unsigned int WIDTH>
+bool WideBVHTree<WIDTH>::Save(OStream& os) const
+{
+    POV_UINT32 header[3] = { WIDTH, POV_UINT32(nodes.size()), POV_UINT32(lists.size()) };
+
+    return os.write(header, sizeof(header)) &&
+           (nodes.empty() || os.write(nodes.data(), nodes.size() * sizeof(Node))) &&
+           (lists.empty() || os.write(lists.data(), lists.size() * sizeof(unsigned int)));
+}
+
+template<unsigned int WIDTH>
+bool WideBVHTree<WIDTH>::Load(IStream& is, unsigned int objectCount)
+{
+    POV_UINT32 header[3];
+
+    clear();
+
+    if (!is.read(header, sizeof(header)) || (header[0] != WIDTH))
+        return false;
+
+    nodes.resize(header[1]);
+    lists.resize(header[2]);
+
+    if ((!nodes.empty() && !is.read(nodes.data(), nodes.size() * sizeof(Node))) ||
+        (!lists.empty() && !is.read(lists.data(), lists.size() * sizeof(unsigned int))))
+    {
+        clear();
+        return false;
+    }
+
+    // make sure traversal can neither leave the arrays nor overflow the trace stack
+    vector<unsigned int> level(nodes.size(), 0);
+    bool valid = true;
+
+    if (!nodes.empty())
+        level[0] = 1;
+
+    for (unsigned int inode = 0; (inode < nodes.size()) && valid; inode++)
+    {
+        const Node& node = nodes[inode];
+
+        for (unsigned int i = 0; (i < WIDTH) && valid; i++)
+        {
+            if (IsUnused(node, i))
+                continue;
+            if (node.count[i] > 0)
+                valid = (node.count[i] <= lists.size()) && (node.ref[i] <= lists.size() - node.count[i]);
+            else
+            {
+                valid = (node.ref[i] > inode) && (node.ref[i] < nodes.size()) && (level[inode] < kMaxDepth);
+                if (valid)
+                    level[node.ref[i]] = max(level[node.ref[i]], level[inode] + 1);
+            }
+        }
+    }
+
+    for (vector<unsigned int>::const_iterator i(lists.begin()); (i != lists.end()) && valid; i++)
+        valid = (*i < objectCount);
+
+    if (!valid)
+    {
+        clear();
+        return false;
+    }
+
+    memory.Set(nodes.size() * sizeof(Node) + lists.size() * sizeof(unsigned int));
+    return true;
+}
+
+template<unsigned int WIDTH>
+void WideBVHTree<WIDTH>::clear()
+{
+    BVHTree::clear();
+    nodes.clear();
+    memory.Set(0);
+}
+
+template<unsigned int WIDTH>
+void WideBVHTree<WIDTH>::Pack(const vector<BuildNode>& buildNodes)
+{
+    nodes.resize(buildNodes.size());
+
+    for (size_t inode = 0; inode < buildNodes.size(); inode++)
+    {
+        const BuildNode& source = buildNodes[inode];
+        Node& target = nodes[inode];
+
+        for (unsigned int i = 0; i < WIDTH; i++)
+        {
+            if (i < source.children)
+            {
+                for (unsigned int axis = 0; axis < 3; axis++)
+                {
+                    target.bmin[axis][i] = source.child[i].box.pmin[axis];
+                    target.bmax[axis][i] = source.child[i].box.pmax[axis];
+                }
+                target.ref[i] = source.child[i].ref;
+                target.count[i] = source.child[i].count;
+            }
+            else
+            {
+                for (unsigned int axis = 0; axis < 3; axis++)
+                {
+                    target.bmin[axis][i] = std::numeric_limits<float>::max();
+                    target.bmax[axis][i] = -std::numeric_limits<float>::max();
+                }
+                target.ref[i] = 0;
+                target.count[i] = 0;
+            }
+        }
+    }
+
+    memory.Set(nodes.size() * sizeof(Node) + lists.size() * sizeof(unsigned int));
+}
+
+template<unsigned int WIDTH>
+bool WideBVHTree<WIDTH>::operator()(const BasicRay& ray, BSPTree::Intersect& isect, double maxdist, bool earlyExit) const
+{
+    ObjectLeafIntersect leaf(isect, lists);
+    return Traverse(ray, leaf, maxdist, earlyExit);
+}
+
+template<unsigned int WIDTH>
+bool WideBVHTree<WIDTH>::operator()(const BasicRay& ray, LeafIntersect& isect, double maxdist, bool earlyExit) const
+{
+    return Traverse(ray, isect, maxdist, earlyExit);
+}
+
+template<unsigned int WIDTH>
+template<typename LEAF>
+bool WideBVHTree<WIDTH>::Traverse(const BasicRay& ray, LEAF& leaf, double maxdist, bool earlyExit) const
+{
+    if (nodes.empty())
+        return false;
+
+    TraceStack tstack[kMaxDepth * (WIDTH - 1) + 1];
+    unsigned int tstackpos = 0;
+    float origin[3];
+    float invdir[3];
+
+    for (unsigned int axis = 0; axis < 3; axis++)
+    {
+        DBL d = ray.Direction[axis];
+        // avoid infinities (and thus NaNs in the slab test) for axis-parallel rays
+        if (fabs(d) < BVH_MIN_DIRECTION)
+            d = (d < 0.0) ? -BVH_MIN_DIRECTION : BVH_MIN_DIRECTION;
+        origin[axis] = float(ray.Origin[axis]);
+        invdir[axis] = float(1.0 / d);
+    }
+
+    tstack[tstackpos].ref = 0;
+    tstack[tstackpos].count = 0;
+    tstack[tstackpos].dist = 0.0f;
+    tstackpos++;
+
+    while (tstackpos > 0)
+    {
+        tstackpos--;
+        const TraceStack& entry = tstack[tstackpos];
+
+        if (entry.dist > maxdist)
+            continue;
+
+        if (entry.count > 0)
+        {
+            // leaf child; test objects
+            leaf(entry.ref, entry.count, maxdist);
+            if (earlyExit && leaf())
+                return true;
+            continue;
+        }
+
+        const Node& node = nodes[entry.ref];
+        float tnear[WIDTH];
+        float tfar[WIDTH];
+        float tmax = float(min(maxdist, double(std::numeric_limits<float>::max())));
+
+        // slab test against all child boxes at once; written as plain loops
+        // over the structure-of-arrays data so that it can be vectorized
+        for (unsigned int i = 0; i < WIDTH; i++)
+        {
+            tnear[i] = 0.0f;
+            tfar[i] = tmax;
+        }
+        for (unsigned int axis = 0; axis < 3; axis++)
+        {
+            // choosing the near and far planes by direction sign (rather than
+            // sorting the distances) makes empty slots reliably miss
+            const float* nearPlane = (invdir[axis] >= 0.0f) ? node.bmin[axis] : node.bmax[axis];
+            const float* farPlane  = (invdir[axis] >= 0.0f) ? node.bmax[axis] : node.bmin[axis];
+            for (unsigned int i = 0; i < WIDTH; i++)
+            {
+                tnear[i] = max(tnear[i], (nearPlane[i] - origin[axis]) * invdir[axis]);
+                tfar[i]  = min(tfar[i],  (farPlane[i]  - origin[axis]) * invdir[axis]);
+            }
+        }
+
+        // for any-hit queries the order doesn't matter
+        if (earlyExit)
+        {
+            for (unsigned int i = 0; i < WIDTH; i++)
+            {
+                if (tnear[i] <= tfar[i])
+                {
+                    tstack[tstackpos].ref = node.ref[i];
+                    tstack[tstackpos].count = node.count[i];
+                    tstack[tstackpos].dist = tnear[i];
+                    tstackpos++;
+                }
+            }
+            continue;
+        }
+
+        // push children that are hit, farthest first so the nearest is popped next
+        unsigned int first = tstackpos;
+        for (unsigned int i = 0; i < WIDTH; i++)
+        {
+            if (tnear[i] <= tfar[i])
+            {
+                unsigned int j = tstackpos++;
+                while ((j > first) && (tstack[j - 1].dist < tnear[i]))
+                {
+                    tstack[j] = tstack[j - 1];
+                    j--;
+                }
+                tstack[j].ref = node.ref[i];
+                tstack[j].count = node.count[i];
+                tstack[j].dist = tnear[i];
+            }
+        }
+    }
+
+    return leaf(); // see if any objects were hit
+}
+
+template<unsigned int WIDTH>
+void WideBVHTree<WIDTH>::operator()(const BasicRay* const rays[], BSPTree::Intersect* const isect[], double maxdist[], unsigned int count) const
+{
+    if (nodes.empty() || (count == 0))
+        return;
+
+    // all per-ray loops run over the full packet size so that they can be vectorized;
+    // unused slots are disabled by a negative maximum distance
+    PacketStack tstack[kMaxDepth * (WIDTH - 1) + 1];
+    unsigned int tstackpos = 0;
+    float origin[3][kMaxPacketSize];
+    float invdir[3][kMaxPacketSize];
+    float tmax[kMaxPacketSize];
+    // bounds of the ray origins and inverse directions, for the interval test
+    float originLo[3], originHi[3];
+    float invdirLo[3], invdirHi[3];
+    // the interval test (and the shared choice of near and far planes) requires all rays to have the same direction signs
+    bool coherent = true;
+
+    if (count > kMaxPacketSize)
+        count = kMaxPacketSize;
+
+    for (unsigned int axis = 0; axis < 3; axis++)
+    {
+        for (unsigned int r = 0; r < kMaxPacketSize; r++)
+        {
+            const BasicRay& ray = *rays[min(r, count - 1)];
+            DBL d = ray.Direction[axis];
+            if (fabs(d) < BVH_MIN_DIRECTION)
+                d = (d < 0.0) ? -BVH_MIN_DIRECTION : BVH_MIN_DIRECTION;
+            origin[axis][r] = float(ray.Origin[axis]);
+            invdir[axis][r] = float(1.0 / d);
+        }
+
+        originLo[axis] = originHi[axis] = origin[axis][0];
+        invdirLo[axis] = invdirHi[axis] = invdir[axis][0];
+        for (unsigned int r = 1; r < count; r++)
+        {
+            originLo[axis] = min(originLo[axis], origin[axis][r]);
+            originHi[axis] = max(originHi[axis], origin[axis][r]);
+            invdirLo[axis] = min(invdirLo[axis], invdir[axis][r]);
+            invdirHi[axis] = max(invdirHi[axis], invdir[axis][r]);
+        }
+
+        coherent = coherent && ((invdirLo[axis] > 0.0f) || (invdirHi[axis] < 0.0f));
+    }
+
+    tstack[tstackpos].ref = 0;
+    tstack[tstackpos].count = 0;
+    tstack[tstackpos].mask = (1u << count) - 1;
+    for (unsigned int r = 0; r < kMaxPacketSize; r++)
+        tstack[tstackpos].tnear[r] = 0.0f;
+    tstackpos++;
+
+    while (tstackpos > 0)
+    {
+        tstackpos--;
+        const PacketStack& entry = tstack[tstackpos];
+        unsigned int mask = 0;
+        float packetTmax = -1.0f;
+
+        // drop rays that have found a closer intersection in the meantime
+        for (unsigned int r = 0; r < kMaxPacketSize; r++)
+        {
+            tmax[r] = -1.0f;
+            if (((entry.mask >> r) & 1) && (entry.tnear[r] <= maxdist[r]))
+            {
+                tmax[r] = float(min(maxdist[r], double(std::numeric_limits<float>::max())));
+                packetTmax = max(packetTmax, tmax[r]);
+                mask |= (1u << r);
+            }
+        }
+
+        if (mask == 0)
+            continue;
+
+        if (entry.count > 0)
+        {
+            // leaf child; test objects
+            for (unsigned int r = 0; r < count; r++)
+            {
+                if ((mask >> r) & 1)
+                {
+                    for (unsigned int i = entry.ref, e = entry.ref + entry.count; i < e; i++)
+                        (*isect[r])(lists[i], maxdist[r]);
+                }
+            }
+            continue;
+        }
+
+        const Node& node = nodes[entry.ref];
+        bool candidate[WIDTH];
+
+        if (coherent)
+        {
+            // conservative slab test of the whole packet, using interval arithmetic
+            float lo[WIDTH];
+            float hi[WIDTH];
+
+            for (unsigned int i = 0; i < WIDTH; i++)
+            {
+                lo[i] = 0.0f;
+                hi[i] = packetTmax;
+            }
+            for (unsigned int axis = 0; axis < 3; axis++)
+            {
+                const float* nearPlane = (invdirLo[axis] > 0.0f) ? node.bmin[axis] : node.bmax[axis];
+                const float* farPlane  = (invdirLo[axis] > 0.0f) ? node.bmax[axis] : node.bmin[axis];
+                for (unsigned int i = 0; i < WIDTH; i++)
+                {
+                    float n0 = (nearPlane[i] - originHi[axis]), n1 = (nearPlane[i] - originLo[axis]);
+                    float f0 = (farPlane[i]  - originHi[axis]), f1 = (farPlane[i]  - originLo[axis]);
+                    lo[i] = max(lo[i], min(min(n0 * invdirLo[axis], n0 * invdirHi[axis]), min(n1 * invdirLo[axis], n1 * invdirHi[axis])));
+                    hi[i] = min(hi[i], max(max(f0 * invdirLo[axis], f0 * invdirHi[axis]), max(f1 * invdirLo[axis], f1 * invdirHi[axis])));
+                }
+            }
+            for (unsigned int i = 0; i < WIDTH; i++)
+                candidate[i] = (lo[i] <= hi[i]);
+        }
+        else
+        {
+            for (unsigned int i = 0; i < WIDTH; i++)
+                candidate[i] = true;
+        }
+
+        // test the individual rays against the remaining children
+        PacketStack children[WIDTH];
+        float dist[WIDTH];
+        unsigned int order[WIDTH];
+        unsigned int hits = 0;
+
+        for (unsigned int i = 0; i < WIDTH; i++)
+        {
+            if (!candidate[i])
+                continue;
+
+            PacketStack& child = children[hits];
+            float tfar[kMaxPacketSize];
+
+            for (unsigned int r = 0; r < kMaxPacketSize; r++)
+            {
+                child.tnear[r] = 0.0f;
+                tfar[r] = tmax[r];
+            }
+            for (unsigned int axis = 0; axis < 3; axis++)
+            {
+                if (coherent)
+                {
+                    float nearPlane = (invdirLo[axis] > 0.0f) ? node.bmin[axis][i] : node.bmax[axis][i];
+                    float farPlane  = (invdirLo[axis] > 0.0f) ? node.bmax[axis][i] : node.bmin[axis][i];
+                    for (unsigned int r = 0; r < kMaxPacketSize; r++)
+                    {
+                        child.tnear[r] = max(child.tnear[r], (nearPlane - origin[axis][r]) * invdir[axis][r]);
+                        tfar[r]        = min(tfar[r],        (farPlane  - origin[axis][r]) * invdir[axis][r]);
+                    }
+                }
+                else
+                {
+                    for (unsigned int r = 0; r < kMaxPacketSize; r++)
+                    {
+                        float nearPlane = (invdir[axis][r] >= 0.0f) ? node.bmin[axis][i] : node.bmax[axis][i];
+                        float farPlane  = (invdir[axis][r] >= 0.0f) ? node.bmax[axis][i] : node.bmin[axis][i];
+                        child.tnear[r] = max(child.tnear[r], (nearPlane - origin[axis][r]) * invdir[axis][r]);
+                        tfar[r]        = min(tfar[r],        (farPlane  - origin[axis][r]) * invdir[axis][r]);
+                    }
+                }
+            }
+
+            unsigned int m = 0;
+            float d = std::numeric_limits<float>::max();
+            for (unsigned int r = 0; r < kMaxPacketSize; r++)
+            {
+                if (child.tnear[r] <= tfar[r])
+                {
+                    m |= (1u << r);
+                    d = min(d, child.tnear[r]);
+                }
+            }
+
+            if (m == 0)
+                continue;
+
+            child.ref = node.ref[i];
+            child.count = node.count[i];
+            child.mask = m;
+            dist[hits] = d;
+
+            // sort by nearest entry of any ray, farthest first
+            unsigned int j = hits++;
+            while ((j > 0) && (dist[order[j - 1]] < d))
+            {
+                order[j] = order[j - 1];
+                j--;
+            }
+            order[j] = hits - 1;
+        }
+
+        // push children, so that the nearest is popped next
+        // (this overwrites `entry`)
+        for (unsigned int i = 0; i < hits; i++)
+            tstack[tstackpos++] = children[order[i]];
+    }
+}
+
+template<unsigned int WIDTH>
+bool WideBVHTree<WIDTH>::operator()(const Vector3d& origin, BSPTree::Inside& inside, bool earlyExit) const
+{
+    ObjectLeafInside leaf(inside, lists);
+    return Locate(origin, leaf, earlyExit);
+}
+
+template<unsigned int WIDTH>
+bool WideBVHTree<WIDTH>::operator()(const Vector3d& origin, LeafIntersect& inside, bool earlyExit) const
+{
+    return Locate(origin, inside, earlyExit);
+}
+
+template<unsigned int WIDTH>
+template<typename LEAF>
+bool WideBVHTree<WIDTH>::Locate(const Vector3d& origin, LEAF& leaf, bool earlyExit) const
+{
+    if (nodes.empty())
+        return false;
+
+    unsigned int tstack[kMaxDepth * (WIDTH - 1) + 1];
+    unsigned int tstackpos = 0;
+    float point[3] = { float(origin[X]), float(origin[Y]), float(origin[Z]) };
+
+    tstack[tstackpos++] = 0;
+    while (tstackpos > 0)
+    {
+        const Node& node = nodes[tstack[--tstackpos]];
+        bool hit[WIDTH];
+
+        for (unsigned int i = 0; i < WIDTH; i++)
+            hit[i] = true;
+        for (unsigned int axis = 0; axis < 3; axis++)
+            for (unsigned int i = 0; i < WIDTH; i++)
+                hit[i] = hit[i] && (point[axis] >= node.bmin[axis][i]) && (point[axis] <= node.bmax[axis][i]);
+
+        for (unsigned int i = 0; i < WIDTH; i++)
+        {
+            if (!hit[i])
+                continue;
+
+            if (node.count[i] > 0)
+            {
+                double maxdist = BOUND_HUGE;
+                leaf(node.ref[i], node.count[i], maxdist);
+                if (earlyExit && leaf())
+                    return true;
+            }
+            else
+                tstack[tstackpos++] = node.ref[i];
+        }
+    }
+
+    return leaf();
+}
+
+//******************************************************************************
+
+BVHTree* BVHTree::Create(unsigned int width, unsigned int maxLeafObjects)
+{
+    if (width > 4)
+        return new WideBVHTree<8>(maxLeafObjects);
+    else
+        return new WideBVHTree<4>(maxLeafObjects);
+}
+
+BVHTree::BVHTree(unsigned int w, unsigned int mlo) :
+    memory(pov_base::kMemory_Bounding),
+    width(w),
+    maxLeafObjects((mlo == 0) ? BVH_MAX_LEAF_OBJECTS : mlo)
+{
+}
+
+BVHTree::~BVHTree()
+{
+}
+
+void BVHTree::clear()
+{
+    lists.clear();
+}
+
+void BVHTree::build(const BSPTree::Progress& progress, const BSPTree::Objects& objects, Statistics& stats)
+{
+    Cluster root;
+
+    lastProgressNodeCounter = 0;
+    leafCounter = 0;
+    maxObjectsInLeaf = 0;
+    maxTreeDepth = 0;
+    objectsInTreeCounter = 0;
+    treeDepthCounter = 0;
+
+    progress(0);
+
+    // gather object bounds and centroids; the bounds are padded slightly, as
+    // traversal is done in single precision
+    boxes.resize(objects.size());
+    centroids.resize(objects.size());
+    indices.resize(objects.size());
+    for (unsigned int i = 0; i < objects.size(); i++)
+    {
+        GetObjectBox(objects, i, boxes[i]);
+        for (unsigned int axis = 0; axis < 3; axis++)
+            centroids[i][axis] = 0.5f * (objects.GetMin(axis, i) + objects.GetMax(axis, i));
+        indices[i] = i;
+    }
+
+    lists.clear();
+    lists.reserve(objects.size());
+    buildNodes.clear();
+    buildNodes.reserve(max(size_t(1), size_t((objects.size() * 2) / (width * maxLeafObjects))));
+
+    root.begin = 0;
+    root.end = (unsigned int)indices.size();
+    root.box = ComputeBounds(root.begin, root.end);
+    root.leaf = false;
+
+    if (objects.size() > 0)
+    {
+        (void)BuildRecursive(progress, root, 0);
+        Pack(buildNodes);
+    }
+
+    progress((unsigned int)buildNodes.size());
+
+    stats.nodes = (unsigned int)buildNodes.size();
+    stats.leafNodes = leafCounter;
+    stats.maxObjects = maxObjectsInLeaf;
+    stats.averageObjects = (leafCounter > 0) ? float(double(objectsInTreeCounter) / double(leafCounter)) : 0.0f;
+    stats.maxDepth = maxTreeDepth;
+    stats.averageDepth = (leafCounter > 0) ? float(double(treeDepthCounter) / double(leafCounter)) : 0.0f;
+
+    // memory was only needed for building
+    vector<MinMaxBoundingBox>().swap(boxes);
+    vector<BBoxVector3d>().swap(centroids);
+    vector<unsigned int>().swap(indices);
+    vector<BuildNode>().swap(buildNodes);
+    vector<unsigned int>(lists).swap(lists);
+}
+
+void BVHTree::GetObjectBox(const BSPTree::Objects& objects, unsigned int i, MinMaxBoundingBox& box)
+{
+    for (unsigned int axis = 0; axis < 3; axis++)
+    {
+        float lo = objects.GetMin(axis, i);
+        float hi = objects.GetMax(axis, i);
+        box.pmin[axis] = lo - BVH_TOLERANCE * max(1.0f, float(fabs(lo)));
+        box.pmax[axis] = hi + BVH_TOLERANCE * max(1.0f, float(fabs(hi)));
+    }
+}
+
+MinMaxBoundingBox BVHTree::ComputeBounds(unsigned int begin, unsigned int end) const
+{
+    MinMaxBoundingBox box;
+    MakeEmpty(box);
+    for (unsigned int i = begin; i < end; i++)
+        Extend(box, boxes[indices[i]]);
+    return box;
+}
+
+void BVHTree::MakeLeaf(BuildNode::Child& child, const Cluster& cluster, unsigned int depth)
+{
+    unsigned int count = cluster.end - cluster.begin;
+
+    child.box = cluster.box;
+    child.ref = (unsigned int)lists.size();
+    child.count = count;
+    lists.insert(lists.end(), indices.begin() + cluster.begin, indices.begin() + cluster.end);
+
+    leafCounter++;
+    maxObjectsInLeaf = max(maxObjectsInLeaf, count);
+    objectsInTreeCounter += count;
+    treeDepthCounter += depth;
+}
+
+unsigned int BVHTree::BuildRecursive(const BSPTree::Progress& progress, const Cluster& cluster, unsigned int depth)
+{
+    unsigned int inode = (unsigned int)buildNodes.size();
+    Cluster clusters[kMaxWidth];
+    unsigned int numClusters = 1;
+
+    maxTreeDepth = max(maxTreeDepth, depth + 1);
+
+    if ((buildNodes.size() - lastProgressNodeCounter) > BVH_NODE_PROGRESS_INTERVAL)
+    {
+        lastProgressNodeCounter = (unsigned int)buildNodes.size();
+        progress(lastProgressNodeCounter);
+    }
+
+    buildNodes.push_back(BuildNode());
+
+    // repeatedly split the largest child cluster until the node is full
+    // or no child can be split beneficially any more
+    clusters[0] = cluster;
+    clusters[0].leaf = (depth + 1 >= kMaxDepth);
+    while (numClusters < width)
+    {
+        int best = -1;
+        float bestArea = -1.0f;
+        for (unsigned int i = 0; i < numClusters; i++)
+        {
+            float area = SurfaceArea(clusters[i].box);
+            if (!clusters[i].leaf && (area > bestArea))
+            {
+                best = i;
+                bestArea = area;
+            }
+        }
+        if (best < 0)
+            break;
+
+        Cluster left, right;
+        if (SplitCluster(clusters[best], left, right))
+        {
+            clusters[best] = left;
+            clusters[numClusters++] = right;
+        }
+        else
+            clusters[best].leaf = true;
+    }
+
+    // a node with a single child only happens if the whole tree is one leaf
+    BuildNode::Child child[kMaxWidth];
+    for (unsigned int i = 0; i < numClusters; i++)
+    {
+        if (clusters[i].leaf || (clusters[i].end - clusters[i].begin <= 1))
+            MakeLeaf(child[i], clusters[i], depth + 1);
+        else
+        {
+            child[i].box = clusters[i].box;
+            child[i].count = 0;
+            child[i].ref = BuildRecursive(progress, clusters[i], depth + 1);
+        }
+    }
+
+    // NB: buildNodes may have been reallocated during recursion
+    buildNodes[inode].children = numClusters;
+    for (unsigned int i = 0; i < numClusters; i++)
+        buildNodes[inode].child[i] = child[i];
+
+    return inode;
+}
+
+bool BVHTree::SplitCluster(const Cluster& cluster, Cluster& left, Cluster& right)
+{
+    unsigned int count = cluster.end - cluster.begin;
+
+    if (count <= 1)
+        return false;
+
+    // compute bounds of centroids to choose bins
+    BBoxVector3d cmin(BOUND_HUGE), cmax(-BOUND_HUGE);
+    for (unsigned int i = cluster.begin; i < cluster.end; i++)
+    {
+        const BBoxVector3d& c = centroids[indices[i]];
+        for (unsigned int axis = 0; axis < 3; axis++)
+        {
+            cmin[axis] = min(cmin[axis], c[axis]);
+            cmax[axis] = max(cmax[axis], c[axis]);
+        }
+    }
+
+    float parentArea = SurfaceArea(cluster.box);
+    float leafCost = count * BVH_OBJECT_COST;
+    float bestCost = std::numeric_limits<float>::max();
+    unsigned int bestAxis = 0;
+    unsigned int bestBin = 0;
+
+    for (unsigned int axis = 0; axis < 3; axis++)
+    {
+        float extent = cmax[axis] - cmin[axis];
+        if (extent <= 0.0f)
+            continue;
+
+        MinMaxBoundingBox binBox[BVH_SAH_BINS];
+        unsigned int binCount[BVH_SAH_BINS];
+        float binScale = BVH_SAH_BINS / extent;
+
+        for (unsigned int b = 0; b < BVH_SAH_BINS; b++)
+        {
+            MakeEmpty(binBox[b]);
+            binCount[b] = 0;
+        }
+
+        for (unsigned int i = cluster.begin; i < cluster.end; i++)
+        {
+            unsigned int b = min((unsigned int)((centroids[indices[i]][axis] - cmin[axis]) * binScale), (unsigned int)(BVH_SAH_BINS - 1));
+            Extend(binBox[b], boxes[indices[i]]);
+            binCount[b]++;
+        }
+
+        // sweep from the right to get the area and count of all right-hand partitions
+        float rightArea[BVH_SAH_BINS];
+        unsigned int rightCount[BVH_SAH_BINS];
+        MinMaxBoundingBox acc;
+        unsigned int n = 0;
+        MakeEmpty(acc);
+        for (unsigned int b = BVH_SAH_BINS - 1; b > 0; b--)
+        {
+            Extend(acc, binBox[b]);
+            n += binCount[b];
+            rightArea[b] = SurfaceArea(acc);
+            rightCount[b] = n;
+        }
+
+        // sweep from the left and evaluate each split position
+        MakeEmpty(acc);
+        n = 0;
+        for (unsigned int b = 1; b < BVH_SAH_BINS; b++)
+        {
+            Extend(acc, binBox[b - 1]);
+            n += binCount[b - 1];
+            if ((n == 0) || (rightCount[b] == 0))
+                continue;
+
+            float cost = SurfaceArea(acc) * n + rightArea[b] * rightCount[b];
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestAxis = axis;
+                bestBin = b;
+            }
+        }
+    }
+
+    if (bestCost == std::numeric_limits<float>::max())
+        return false; // all centroids coincide
+
+    // surface area heuristic: only split if it is expected to be cheaper than a leaf
+    float splitCost = BVH_NODE_COST + ((parentArea > 0.0f) ? (bestCost / parentArea) * BVH_OBJECT_COST : leafCost);
+    if ((count <= maxLeafObjects) && (splitCost >= leafCost))
+        return false;
+
+    float extent = cmax[bestAxis] - cmin[bestAxis];
+    float binScale = BVH_SAH_BINS / extent;
+    vector<unsigned int>::iterator mid = std::partition(indices.begin() + cluster.begin, indices.begin() + cluster.end,
+        [&](unsigned int index)
+        {
+            return min((unsigned int)((centroids[index][bestAxis] - cmin[bestAxis]) * binScale), (unsigned int)(BVH_SAH_BINS - 1)) < bestBin;
+        });
+    unsigned int middle = (unsigned int)(mid - indices.begin());
+
+    if ((middle == cluster.begin) || (middle == cluster.end))
+        return false;
+
+    left.begin = cluster.begin;
+    left.end = middle;
+    left.box = ComputeBounds(left.begin, left.end);
+    left.leaf = false;
+
+    right.begin = middle;
+    right.end = cluster.end;
+    right.box = ComputeBounds(right.begin, right.end);
+    right.leaf = false;
+
+    return true;
+}
+
+}
+// end of namespace pov
@@ -0,0 +1,301 @@
+//******************************************************************************
+///
+/// @file core/bounding/bvhtree.h
+///
+/// Declarations related to the wide bounding volume hierarchy.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+#ifndef POVRAY_CORE_BVHTREE_H
+#define POVRAY_CORE_BVHTREE_H
+
+// Module config header file must be the first file included within POV-Ray unit header files
+#include "core/configcore.h"
+
+// C++ variants of C standard header files
+//  (none at the moment)
+
+// C++ standard header files
+#include <vector>
+
+// POV-Ray header files (base module)
+#include "base/fileinputoutput_fwd.h"
+#include "base/pov_mem.h"
+
+// POV-Ray header files (core module)
+#include "core/bounding/boundingbox.h"
+#include "core/bounding/bsptree.h"
+
+namespace pov
+{
+
+//##############################################################################
+///
+/// @defgroup PovCoreBoundingBVHTree Wide Bounding Volume Hierarchy
+/// @ingroup PovCoreBounding
+///
+/// @{
+
+/// Wide bounding volume hierarchy built using the surface area heuristic.
+///
+/// This is an alternative to @ref BSPTree (selected via `Bounding_Method=3`).
+/// Each inner node holds the bounding boxes of up to 4 or 8 children in
+/// structure-of-arrays layout, so that a ray can be tested against all child
+/// boxes of a node in a single tight loop the compiler is able to vectorize.
+///
+/// Since every object is referenced by exactly one leaf, no mailbox is needed
+/// during traversal. To allow for a fair comparison, the tree uses the same
+/// @ref BSPTree::Objects, @ref BSPTree::Intersect and @ref BSPTree::Inside
+/// interfaces as the BSP tree.
+///
+class BVHTree
+{
+    public:
+
+        /// Maximum number of children per node.
+        static const unsigned int kMaxWidth = 8;
+
+        /// Maximum tree depth.
+        static const unsigned int kMaxDepth = 64;
+
+        /// Maximum number of rays per packet.
+        static const unsigned int kMaxPacketSize = 16;
+
+        /// Build statistics.
+        struct Statistics final
+        {
+            unsigned int nodes;
+            unsigned int leafNodes;
+            unsigned int maxObjects;
+            float averageObjects;
+            unsigned int maxDepth;
+            float averageDepth;
+        };
+
+        /// Intersection functor testing all objects of a leaf at once.
+        ///
+        /// This allows the objects of a leaf to be tested in a single tight loop, e.g. the
+        /// triangles of a mesh; see @ref GetObjectList() for how to identify the objects.
+        ///
+        class LeafIntersect
+        {
+            public:
+                LeafIntersect() { }
+                virtual ~LeafIntersect() { }
+
+                /// Test the objects of a leaf.
+                ///
+                /// @param[in]      first       Offset of the leaf's first object in @ref GetObjectList().
+                /// @param[in]      count       Number of objects in the leaf.
+                /// @param[in,out]  maxdist     Maximum distance, to be reduced by the functor as it sees fit.
+                ///
+                virtual void operator()(unsigned int first, unsigned int count, double& maxdist) = 0;
+                virtual bool operator()() const = 0;
+        };
+
+        /// Create a new tree.
+        ///
+        /// @param  width           Desired number of children per node (4 or 8; other values are rounded).
+        /// @param  maxLeafObjects  Maximum number of objects per leaf, or 0 to use the default.
+        ///
+        static BVHTree* Create(unsigned int width, unsigned int maxLeafObjects = 0);
+
+        virtual ~BVHTree();
+
+        /// Find the closest intersection along a ray.
+        ///
+        /// @param[in]      ray         Ray to trace.
+        /// @param[in]      isect       Intersection functor.
+        /// @param[in]      maxdist     Maximum distance.
+        /// @param[in]      earlyExit   Stop as soon as the functor reports a hit, rather than continuing
+        ///                             to look for a closer one (any-hit query); children are then
+        ///                             visited without sorting them by distance.
+        ///
+        virtual bool operator()(const BasicRay& ray, BSPTree::Intersect& isect, double maxdist, bool earlyExit = false) const = 0;
+
+        /// Find the closest intersection along a ray, testing the objects leaf by leaf.
+        ///
+        /// Other than invoking the functor once per leaf rather than once per object, this is
+        /// identical to the per-object variant.
+        ///
+        virtual bool operator()(const BasicRay& ray, LeafIntersect& isect, double maxdist, bool earlyExit = false) const = 0;
+
+        /// Find the closest intersections along a packet of rays.
+        ///
+        /// Before the individual rays are tested against a node's children, the packet as a whole is
+        /// tested using interval arithmetic, so that subtrees missed by all rays are culled at the
+        /// cost of a single ray. This pays off for coherent rays, such as the primary rays of
+        /// adjacent pixels.
+        ///
+        /// @param[in]      rays        Rays to trace.
+        /// @param[in]      isect       Intersection functor for each ray.
+        /// @param[in,out]  maxdist     Maximum distance for each ray, updated by the functors.
+        /// @param[in]      count       Number of rays (at most @ref kMaxPacketSize).
+        ///
+        virtual void operator()(const BasicRay* const rays[], BSPTree::Intersect* const isect[], double maxdist[], unsigned int count) const = 0;
+
+        /// Find the objects containing a point.
+        virtual bool operator()(const Vector3d& origin, BSPTree::Inside& inside, bool earlyExit = false) const = 0;
+
+        /// Find the objects containing a point, testing the objects leaf by leaf.
+        ///
+        /// The functor is invoked for each leaf whose bounds contain the point; the maximum
+        /// distance passed to it is meaningless.
+        ///
+        virtual bool operator()(const Vector3d& origin, LeafIntersect& inside, bool earlyExit = false) const = 0;
+
+        void build(const BSPTree::Progress& progress, const BSPTree::Objects& objects, Statistics& stats);
+
+        /// Update the bounding boxes of all nodes to the current object bounds, keeping the topology.
+        ///
+        /// This is much faster than rebuilding the tree, but the quality of the tree degrades as the
+        /// objects move away from the positions the tree was built for; use @ref ComputeCost() to
+        /// decide whether the tree should be rebuilt instead.
+        ///
+        /// @param[in]  objects     Objects the tree was built for, in the same order.
+        ///
+        virtual void Refit(const BSPTree::Objects& objects) = 0;
+
+        /// Compute the expected cost of tracing a ray through the tree, according to the surface area heuristic.
+        ///
+        /// The value is relative to the cost of testing a ray against each object's bounding box directly,
+        /// and only meaningful for comparing different trees over the same set of objects.
+        ///
+        /// @param[in]  objects     Objects the tree was built for, in the same order.
+        ///
+        virtual float ComputeCost(const BSPTree::Objects& objects) const = 0;
+
+        /// Write the finished tree to a binary stream.
+        ///
+        /// @note   The data is written in native byte order and is only intended to be read back by
+        ///         @ref Load() on the same machine.
+        ///
+        /// @return `true` if the tree was written successfully.
+        ///
+        virtual bool Save(OStream& os) const = 0;
+
+        /// Read a tree previously written by @ref Save().
+        ///
+        /// @param[in]  is              Stream to read from.
+        /// @param[in]  objectCount     Number of objects the tree is expected to reference.
+        /// @return                     `true` if a valid tree was read; otherwise the tree is left empty.
+        ///
+        virtual bool Load(IStream& is, unsigned int objectCount) = 0;
+
+        virtual void clear();
+
+        inline unsigned int GetWidth() const { return width; }
+
+        /// Get the index list of all objects referenced by the leaves.
+        ///
+        /// The objects of each leaf occupy a contiguous range of the list, which does not change
+        /// once the tree has been built (or loaded).
+        ///
+        inline const std::vector<unsigned int>& GetObjectList() const { return lists; }
+
+    protected:
+
+        /// Generic (array-of-structures) node used only while building the tree.
+        struct BuildNode final
+        {
+            struct Child final
+            {
+                MinMaxBoundingBox box;
+                /// index of child node, or offset into object list for leaf children
+                unsigned int ref;
+                /// number of objects for leaf children, 0 for inner node children
+                unsigned int count;
+            };
+
+            unsigned int children;
+            Child child[kMaxWidth];
+        };
+
+        /// Index list of all objects referenced by leaves.
+        std::vector<unsigned int> lists;
+
+        /// Memory accounted for the packed nodes and object list.
+        pov_base::MemoryAccount memory;
+
+        BVHTree(unsigned int w, unsigned int mlo);
+
+        /// Get an object's bounding box, padded to account for single precision traversal.
+        static void GetObjectBox(const BSPTree::Objects& objects, unsigned int i, MinMaxBoundingBox& box);
+
+        /// Convert the generic nodes into the actual node format.
+        virtual void Pack(const std::vector<BuildNode>& buildNodes) = 0;
+
+    private:
+
+        struct Cluster final
+        {
+            unsigned int begin;
+            unsigned int end;
+            MinMaxBoundingBox box;
+            bool leaf;
+        };
+
+        /// number of children per node
+        const unsigned int width;
+        /// maximum number of objects per leaf
+        const unsigned int maxLeafObjects;
+
+        /// object bounding boxes (only used while building tree)
+        std::vector<MinMaxBoundingBox> boxes;
+        /// object centroids (only used while building tree)
+        std::vector<BBoxVector3d> centroids;
+        /// object index list (only used while building tree)
+        std::vector<unsigned int> indices;
+        /// nodes (only used while building tree)
+        std::vector<BuildNode> buildNodes;
+
+        unsigned int lastProgressNodeCounter;
+        unsigned int leafCounter;
+        unsigned int maxObjectsInLeaf;
+        unsigned int maxTreeDepth;
+        POV_LONG objectsInTreeCounter;
+        POV_LONG treeDepthCounter;
+
+        unsigned int BuildRecursive(const BSPTree::Progress& progress, const Cluster& cluster, unsigned int depth);
+        bool SplitCluster(const Cluster& cluster, Cluster& left, Cluster& right);
+        MinMaxBoundingBox ComputeBounds(unsigned int begin, unsigned int end) const;
+        void MakeLeaf(BuildNode::Child& child, const Cluster& cluster, unsigned int depth);
+
+        BVHTree() = delete;
+};
+
+/// @}
+///
+//##############################################################################
+
+}
+// end of namespace pov
+
+#endif // POVRAY_CORE_BVHTREE_H
@@ -0,0 +1,601 @@
+//******************************************************************************
+///
+/// @file core/bounding/compactbboxtree.cpp
+///
+/// Implementations related to the compact (quantized) bounding box tree.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+// Unit header file must be the first file included within POV-Ray *.cpp files (pulls in config)
+#include "core/bounding/compactbboxtree.h"
+
+// C++ variants of C standard header files
+#include <cmath>
+
+// C++ standard header files
+#include <algorithm>
+#include <limits>
+
+// POV-Ray header files (base module)
+#include "base/pov_mem.h"
+
+// POV-Ray header files (core module)
+#include "core/render/ray.h"
+#include "core/scene/object.h"
+#include "core/scene/tracethreaddata.h"
+
+// this must be the last file included
+#include "base/povdebug.h"
+
+namespace pov
+{
+
+using std::vector;
+
+/// Relative amount by which decoded boxes are padded, to guard against rounding errors.
+#define CBBOX_TOLERANCE 1.0e-6f
+
+//******************************************************************************
+
+CompactBBoxTree::Queue::Queue()
+{
+    mQueue.resize(1); // element 0 is reserved
+}
+
+void CompactBBoxTree::Queue::Insert(DBL depth, unsigned int node, const BoundingBox& box)
+{
+    vector<Qelem>::size_type size;
+    vector<Qelem>::size_type i;
+
+    size = mQueue.size();
+    mQueue.resize(size+1);
+
+    i = size;
+    while((i > 1) && (depth < mQueue[i/2].depth))
+    {
+        mQueue[i] = mQueue[i/2];
+        i /= 2;
+    }
+    mQueue[i].depth = depth;
+    mQueue[i].node  = node;
+    mQueue[i].box   = box;
+}
+
+bool CompactBBoxTree::Queue::RemoveMin(DBL& depth, unsigned int& node, BoundingBox& box)
+{
+    vector<Qelem>::size_type size = mQueue.size() - 1;
+    vector<Qelem>::size_type i, j;
+
+    if (size == 0)
+        return false;
+
+    depth = mQueue[1].depth;
+    node  = mQueue[1].node;
+    box   = mQueue[1].box;
+
+    i = 1;
+
+    while (i <= size/2) // equivalent to 2*i <= size, but more robust
+    {
+        if ((2*i == size) || (mQueue[2*i].depth < mQueue[2*i+1].depth))
+            j = 2*i;
+        else
+            j = 2*i+1;
+
+        if (mQueue[size].depth <= mQueue[j].depth)
+            break;
+
+        mQueue[i] = mQueue[j];
+        i = j;
+    }
+    if (i != size)
+        mQueue[i] = mQueue[size];
+    mQueue.pop_back();
+
+    return true;
+}
+
+bool CompactBBoxTree::Queue::IsEmpty() const
+{
+    return (mQueue.size() == 1);
+}
+
+void CompactBBoxTree::Queue::Clear()
+{
+    mQueue.resize(1);
+}
+
+void CompactBBoxTree::Queue::Push(unsigned int node, const BoundingBox& box)
+{
+    mQueue.resize(mQueue.size() + 1);
+    mQueue.back().depth = 0.0;
+    mQueue.back().node  = node;
+    mQueue.back().box   = box;
+}
+
+bool CompactBBoxTree::Queue::Pop(unsigned int& node, BoundingBox& box)
+{
+    if (mQueue.size() == 1)
+        return false;
+
+    node = mQueue.back().node;
+    box  = mQueue.back().box;
+    mQueue.pop_back();
+
+    return true;
+}
+
+//******************************************************************************
+
+template<typename QUANT>
+class CompactBBoxTreeImpl final : public CompactBBoxTree
+{
+    public:
+
+        explicit CompactBBoxTreeImpl(const BBOX_TREE *root);
+        virtual ~CompactBBoxTreeImpl() override { }
+
+        virtual bool Intersect(Queue& queue, const Ray& ray, Intersection *bestIntersection, TraceThreadData *thread) const override;
+        virtual bool Intersect(Queue& queue, const Ray& ray, Intersection *bestIntersection,
+                               const RayObjectCondition& precondition, const RayObjectCondition& postcondition,
+                               TraceThreadData *thread) const override;
+        virtual bool Occlude(Queue& queue, const Ray& ray, DBL maxDepth, Intersection *occluder, bool& otherHits,
+                             const RayObjectCondition& precondition, const RayObjectCondition& postcondition,
+                             const IntersectionCondition& occlusion, TraceThreadData *thread) const override;
+        virtual bool FindInside(const Vector3d& point, const PointObjectCondition& precondition, const PointObjectCondition& postcondition,
+                                bool earlyExit, TraceThreadData *thread) const override;
+
+        virtual unsigned int GetNodeCount() const override { return (unsigned int)nodes.size(); }
+        virtual size_t GetNodeMemory() const override { return nodes.size() * sizeof(Node); }
+
+    private:
+
+        /// Largest quantized value, representing the upper bound of the parent box.
+        static const unsigned int kQMax = std::numeric_limits<QUANT>::max();
+        /// Flag in @ref Node::entries marking an infinite node.
+        static const POV_UINT16 kInfinite = 0x8000;
+
+        struct Node final
+        {
+            /// quantized lower bounds, relative to the parent box
+            QUANT qmin[3];
+            /// quantized upper bounds, relative to the parent box
+            QUANT qmax[3];
+            /// number of children (0 for leaves), plus @ref kInfinite flag
+            POV_UINT16 entries;
+            /// index of first child node, or index of object for leaves
+            POV_UINT32 ref;
+        };
+
+        /// nodes; the root is node 0, and the children of each node are stored consecutively
+        vector<Node> nodes;
+        /// objects referenced by the leaves
+        vector<ObjectPtr> objects;
+        /// box relative to which the root and the children of infinite nodes are quantized
+        BoundingBox finiteBox;
+        /// memory accounted for the nodes and object references
+        pov_base::MemoryAccount memory;
+
+        static inline BBoxScalar Pad(BBoxScalar x)
+        {
+            return CBBOX_TOLERANCE * std::max(BBoxScalar(1.0), BBoxScalar(std::fabs(x)));
+        }
+
+        static inline void DecodeAxis(BBoxScalar lo, BBoxScalar size, unsigned int qlo, unsigned int qhi, BBoxScalar& a, BBoxScalar& s)
+        {
+            BBoxScalar step = size / BBoxScalar(kQMax);
+            BBoxScalar b;
+
+            a = lo + BBoxScalar(qlo) * step;
+            b = (qhi == kQMax) ? (lo + size) : (lo + BBoxScalar(qhi) * step);
+            a -= Pad(a);
+            b += Pad(b);
+            s = b - a;
+        }
+
+        static inline void Decode(const Node& node, const BoundingBox& parent, BoundingBox& box)
+        {
+            for (int dim = X; dim <= Z; ++dim)
+                DecodeAxis(parent.lowerLeft[dim], parent.size[dim], node.qmin[dim], node.qmax[dim], box.lowerLeft[dim], box.size[dim]);
+        }
+
+        static void Encode(const BoundingBox& parent, const BoundingBox& source, Node& node, BoundingBox& box);
+        static void GetFiniteBounds(const BBOX_TREE *node, BBoxVector3d& mins, BBoxVector3d& maxs, bool& any);
+
+        inline const BoundingBox& GetReferenceBox(const Node& node, const BoundingBox& box) const
+        {
+            return ((node.entries & kInfinite) ? finiteBox : box);
+        }
+
+        inline bool IntersectNode(const Node& node, const BoundingBox& parent, const Rayinfo& rayinfo, DBL& dmin, BoundingBox& box,
+                                  RenderStatistics& stats) const
+        {
+            if (node.entries & kInfinite)
+            {
+                // Set intersection depth to -Max_Distance.
+                dmin = -MAX_DISTANCE;
+                return true;
+            }
+
+            Decode(node, parent, box);
+            return Intersect_BBox_Slabs(&box, &rayinfo, dmin, stats);
+        }
+
+        bool FindInside(unsigned int index, const BoundingBox& parent, const Vector3d& point,
+                        const PointObjectCondition& precondition, const PointObjectCondition& postcondition,
+                        bool earlyExit, TraceThreadData *thread) const;
+};
+
+template<typename QUANT>
+CompactBBoxTreeImpl<QUANT>::CompactBBoxTreeImpl(const BBOX_TREE *root) :
+    memory(pov_base::kMemory_Bounding)
+{
+    struct Pending final
+    {
+        const BBOX_TREE *source;
+        unsigned int index;
+        BoundingBox box;
+    };
+
+    BBoxVector3d mins, maxs;
+    bool any = false;
+    vector<Pending> pending;
+    BoundingBox box;
+
+    GetFiniteBounds(root, mins, maxs, any);
+    if (any)
+        Make_BBox_from_min_max(finiteBox, mins, maxs);
+    else
+        Make_BBox(finiteBox, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0);
+
+    box = finiteBox;
+    nodes.push_back(Node());
+    if (root->Infinite)
+        nodes[0].entries = kInfinite;
+    else
+        Encode(finiteBox, root->BBox, nodes[0], box);
+    pending.push_back(Pending{ root, 0, box });
+
+    // Lay out the nodes in breadth-first order, so that the children of each node end up next to each other.
+    for (size_t next = 0; next < pending.size(); ++next)
+    {
+        const Pending p = pending[next];
+        unsigned int first = (unsigned int)nodes.size();
+
+        if (p.source->Entries == 0)
+        {
+            nodes[p.index].ref = POV_UINT32(objects.size());
+            objects.push_back(reinterpret_cast<ObjectPtr>(p.source->Node));
+            continue;
+        }
+
+        nodes[p.index].entries |= POV_UINT16(p.source->Entries);
+        nodes[p.index].ref = POV_UINT32(first);
+        nodes.resize(first + p.source->Entries, Node());
+
+        const BoundingBox& parent = GetReferenceBox(nodes[p.index], p.box);
+
+        for (short i = 0; i < p.source->Entries; i++)
+        {
+            const BBOX_TREE *child = p.source->Node[i];
+
+            box = finiteBox;
+            if (child->Infinite)
+                nodes[first + i].entries = kInfinite;
+            else
+                Encode(parent, child->BBox, nodes[first + i], box);
+            pending.push_back(Pending{ child, first + i, box });
+        }
+    }
+
+    memory.Set(nodes.capacity() * sizeof(Node) + objects.capacity() * sizeof(ObjectPtr));
+}
+
+template<typename QUANT>
+void CompactBBoxTreeImpl<QUANT>::Encode(const BoundingBox& parent, const BoundingBox& source, Node& node, BoundingBox& box)
+{
+    for (int dim = X; dim <= Z; ++dim)
+    {
+        BBoxScalar lo   = parent.lowerLeft[dim];
+        BBoxScalar size = parent.size[dim];
+        BBoxScalar slo  = source.lowerLeft[dim];
+        BBoxScalar shi  = source.lowerLeft[dim] + source.size[dim];
+        DBL step = DBL(size) / DBL(kQMax);
+        DBL t;
+        unsigned int qlo = 0;
+        unsigned int qhi = kQMax;
+
+        // Start with the nearest quantized values...
+        if (step > 0.0)
+        {
+            t = floor((DBL(slo) - DBL(lo)) / step);
+            qlo = (t > 0.0) ? ((t < DBL(kQMax)) ? (unsigned int)t : kQMax) : 0;
+            t = ceil((DBL(shi) - DBL(lo)) / step);
+            qhi = (t < DBL(kQMax)) ? ((t > 0.0) ? (unsigned int)t : 0) : kQMax;
+            if (qhi < qlo)
+                qhi = qlo;
+        }
+
+        // ... and widen the interval until the decoded box (evaluated exactly as during traversal) encloses the original.
+        for (;;)
+        {
+            DecodeAxis(lo, size, qlo, qhi, box.lowerLeft[dim], box.size[dim]);
+            if ((box.lowerLeft[dim] > slo) && (qlo > 0))
+                --qlo;
+            else if ((box.lowerLeft[dim] + box.size[dim] < shi) && (qhi < kQMax))
+                ++qhi;
+            else
+                break;
+        }
+
+        node.qmin[dim] = QUANT(qlo);
+        node.qmax[dim] = QUANT(qhi);
+    }
+}
+
+template<typename QUANT>
+void CompactBBoxTreeImpl<QUANT>::GetFiniteBounds(const BBOX_TREE *node, BBoxVector3d& mins, BBoxVector3d& maxs, bool& any)
+{
+    if (node->Infinite == false)
+    {
+        BBoxVector3d nodeMins, nodeMaxs;
+        Make_min_max_from_BBox(nodeMins, nodeMaxs, node->BBox);
+        if (any)
+        {
+            mins = min(mins, nodeMins);
+            maxs = max(maxs, nodeMaxs);
+        }
+        else
+        {
+            mins = nodeMins;
+            maxs = nodeMaxs;
+            any = true;
+        }
+        return;
+    }
+
+    for (short i = 0; i < node->Entries; i++)
+        GetFiniteBounds(node->Node[i], mins, maxs, any);
+}
+
+template<typename QUANT>
+bool CompactBBoxTreeImpl<QUANT>::Intersect(Queue& queue, const Ray& ray, Intersection *bestIntersection, TraceThreadData *thread) const
+{
+    bool found = false;
+    DBL depth;
+    unsigned int index;
+    BoundingBox box, childBox;
+
+    // Create the direction vectors for this ray.
+    Rayinfo rayinfo(ray);
+
+    // Start with an empty priority queue.
+    queue.Clear();
+
+    // Check top node.
+    if (IntersectNode(nodes[0], finiteBox, rayinfo, depth, box, thread->Stats()))
+        queue.Insert(depth, 0, box);
+
+    // Check elements in the priority queue.
+    while (queue.RemoveMin(depth, index, box))
+    {
+        // If current intersection is larger than the best intersection found
+        // so far our task is finished, because all other bounding boxes in
+        // the priority queue are further away.
+        if (depth > bestIntersection->Depth)
+            break;
+
+        const Node& node = nodes[index];
+        unsigned int entries = node.entries & ~kInfinite;
+
+        if (entries)
+        {
+            // This is a node containing leaves to be checked.
+            const BoundingBox& parent = GetReferenceBox(node, box);
+            for (unsigned int i = node.ref; i < node.ref + entries; i++)
+                if (IntersectNode(nodes[i], parent, rayinfo, depth, childBox, thread->Stats()))
+                    queue.Insert(depth, i, childBox);
+        }
+        else
+        {
+            // This is a leaf so test contained object.
+            if (Find_Intersection(bestIntersection, objects[node.ref], ray, thread, bestIntersection->Depth))
+                found = true;
+        }
+    }
+
+    return found;
+}
+
+template<typename QUANT>
+bool CompactBBoxTreeImpl<QUANT>::Intersect(Queue& queue, const Ray& ray, Intersection *bestIntersection,
+                                           const RayObjectCondition& precondition, const RayObjectCondition& postcondition,
+                                           TraceThreadData *thread) const
+{
+    bool found = false;
+    DBL depth;
+    unsigned int index;
+    BoundingBox box, childBox;
+
+    // Create the direction vectors for this ray.
+    Rayinfo rayinfo(ray);
+
+    // Start with an empty priority queue.
+    queue.Clear();
+
+    // Check top node.
+    if (IntersectNode(nodes[0], finiteBox, rayinfo, depth, box, thread->Stats()))
+        queue.Insert(depth, 0, box);
+
+    // Check elements in the priority queue.
+    while (queue.RemoveMin(depth, index, box))
+    {
+        // If current intersection is larger than the best intersection found
+        // so far our task is finished, because all other bounding boxes in
+        // the priority queue are further away.
+        if (depth > bestIntersection->Depth)
+            break;
+
+        const Node& node = nodes[index];
+        unsigned int entries = node.entries & ~kInfinite;
+
+        if (entries)
+        {
+            // This is a node containing leaves to be checked.
+            const BoundingBox& parent = GetReferenceBox(node, box);
+            for (unsigned int i = node.ref; i < node.ref + entries; i++)
+                if (IntersectNode(nodes[i], parent, rayinfo, depth, childBox, thread->Stats()))
+                    queue.Insert(depth, i, childBox);
+        }
+        else if (precondition(ray, objects[node.ref], 0.0) == true)
+        {
+            // This is a leaf so test contained object.
+            if (Find_Intersection(bestIntersection, objects[node.ref], ray, postcondition, thread, bestIntersection->Depth))
+                found = true;
+        }
+    }
+
+    return found;
+}
+
+template<typename QUANT>
+bool CompactBBoxTreeImpl<QUANT>::Occlude(Queue& queue, const Ray& ray, DBL maxDepth, Intersection *occluder, bool& otherHits,
+                                         const RayObjectCondition& precondition, const RayObjectCondition& postcondition,
+                                         const IntersectionCondition& occlusion, TraceThreadData *thread) const
+{
+    DBL depth;
+    unsigned int index;
+    BoundingBox box, childBox;
+    Intersection newIntersection;
+
+    // Create the direction vectors for this ray.
+    Rayinfo rayinfo(ray);
+
+    queue.Clear();
+    otherHits = false;
+
+    if (IntersectNode(nodes[0], finiteBox, rayinfo, depth, box, thread->Stats()) && (depth < maxDepth))
+        queue.Push(0, box);
+
+    while (queue.Pop(index, box))
+    {
+        const Node& node = nodes[index];
+        unsigned int entries = node.entries & ~kInfinite;
+
+        if (entries)
+        {
+            // This is a node containing leaves to be checked.
+            const BoundingBox& parent = GetReferenceBox(node, box);
+            for (unsigned int i = node.ref; i < node.ref + entries; i++)
+                if (IntersectNode(nodes[i], parent, rayinfo, depth, childBox, thread->Stats()) && (depth < maxDepth))
+                    queue.Push(i, childBox);
+        }
+        else if (precondition(ray, objects[node.ref], 0.0) == true)
+        {
+            // This is a leaf so test contained object.
+            if (Find_Intersection(&newIntersection, objects[node.ref], ray, postcondition, thread) &&
+                (newIntersection.Depth < maxDepth))
+            {
+                if (occlusion(newIntersection))
+                {
+                    *occluder = newIntersection;
+                    return true;
+                }
+                otherHits = true;
+            }
+        }
+    }
+
+    return false;
+}
+
+template<typename QUANT>
+bool CompactBBoxTreeImpl<QUANT>::FindInside(const Vector3d& point, const PointObjectCondition& precondition, const PointObjectCondition& postcondition,
+                                            bool earlyExit, TraceThreadData *thread) const
+{
+    return FindInside(0, finiteBox, point, precondition, postcondition, earlyExit, thread);
+}
+
+template<typename QUANT>
+bool CompactBBoxTreeImpl<QUANT>::FindInside(unsigned int index, const BoundingBox& parent, const Vector3d& point,
+                                            const PointObjectCondition& precondition, const PointObjectCondition& postcondition,
+                                            bool earlyExit, TraceThreadData *thread) const
+{
+    const Node& node = nodes[index];
+    unsigned int entries = node.entries & ~kInfinite;
+    BoundingBox box;
+    bool found = false;
+
+    // Check current node.
+    if ((node.entries & kInfinite) == 0)
+    {
+        Decode(node, parent, box);
+        if (!Inside_BBox(point, box))
+            return false;
+    }
+
+    if (entries == 0)
+    {
+        // This is a leaf so test contained object.
+        ObjectPtr object = objects[node.ref];
+        if (precondition(point, object))
+            if (Inside_BBox(point, object->BBox) && object->Inside(point, thread))
+                if (postcondition(point, object))
+                    found = true;
+        return found;
+    }
+
+    // This is a node containing leaves to be checked.
+    const BoundingBox& childParent = GetReferenceBox(node, box);
+    for (unsigned int i = node.ref; i < node.ref + entries; i++)
+    {
+        if (FindInside(i, childParent, point, precondition, postcondition, earlyExit, thread))
+        {
+            found = true;
+            if (earlyExit)
+                break;
+        }
+    }
+
+    return found;
+}
+
+//******************************************************************************
+
+CompactBBoxTree* CompactBBoxTree::Create(const BBOX_TREE *root, unsigned int bits)
+{
+    if (bits > 8)
+        return new CompactBBoxTreeImpl<POV_UINT16>(root);
+    else
+        return new CompactBBoxTreeImpl<POV_UINT8>(root);
+}
+
+}
+// end of namespace pov
@@ -0,0 +1,170 @@
+//******************************************************************************
+///
+/// @file core/bounding/compactbboxtree.h
+///
+/// Declarations related to the compact (quantized) bounding box tree.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+#ifndef POVRAY_CORE_COMPACTBBOXTREE_H
+#define POVRAY_CORE_COMPACTBBOXTREE_H
+
+// Module config header file must be the first file included within POV-Ray unit header files
+#include "core/configcore.h"
+
+// C++ variants of C standard header files
+//  (none at the moment)
+
+// C++ standard header files
+#include <vector>
+
+// POV-Ray header files (base module)
+//  (none at the moment)
+
+// POV-Ray header files (core module)
+#include "core/coretypes.h"
+#include "core/bounding/boundingbox.h"
+
+namespace pov
+{
+
+//##############################################################################
+///
+/// @defgroup PovCoreBoundingCompactBBoxTree Compact Bounding Box Tree
+/// @ingroup PovCoreBounding
+///
+/// @{
+
+/// Compact representation of a bounding box tree built by @ref Build_Bounding_Slabs().
+///
+/// All nodes are stored in a single array, with the children of each node occupying consecutive
+/// entries, so that a node only needs to store the index of its first child (or, for leaves, the
+/// index of its object) instead of a pointer array. Each child's bounding box is quantized to
+/// 8 or 16 bits per coordinate, relative to the (decoded) bounding box of its parent; rounding is
+/// always towards the outside, so that a decoded box is never smaller than the original one.
+///
+/// Boxes are decoded on the fly during traversal. This trades a few arithmetic operations per
+/// box for a much smaller memory footprint (12 or 20 bytes per node, compared to more than 40
+/// bytes plus the child pointer array for the original tree), which pays off for scenes whose
+/// bounding hierarchy does not fit into the processor caches.
+///
+/// The tree is selected via `Bounding_Slabs_Compact=8` or `Bounding_Slabs_Compact=16`, and
+/// replaces the original tree after it has been built (or read from the cache).
+///
+class CompactBBoxTree
+{
+    public:
+
+        /// Traversal state for @ref Intersect() and @ref Occlude(); one instance per thread.
+        ///
+        /// This is a min heap like @ref BBoxPriorityQueue, except that each element also carries the
+        /// decoded bounding box of its node, which is needed to decode the node's children.
+        ///
+        class Queue final
+        {
+            public:
+
+                Queue();
+
+                void Insert(DBL depth, unsigned int node, const BoundingBox& box);
+                bool RemoveMin(DBL& depth, unsigned int& node, BoundingBox& box);
+                bool IsEmpty() const;
+                void Clear();
+
+                /// Add an element to the end, ignoring its depth (only for use as a stack).
+                void Push(unsigned int node, const BoundingBox& box);
+                /// Remove the last element (only for use as a stack).
+                bool Pop(unsigned int& node, BoundingBox& box);
+
+            private:
+
+                struct Qelem final
+                {
+                    DBL depth;
+                    unsigned int node;
+                    BoundingBox box;
+                };
+
+                std::vector<Qelem> mQueue;
+        };
+
+        /// Create a compact copy of a bounding box tree.
+        ///
+        /// @param  root    Tree to copy.
+        /// @param  bits    Number of bits per coordinate (8 or 16; other values are rounded).
+        ///
+        static CompactBBoxTree* Create(const BBOX_TREE *root, unsigned int bits);
+
+        virtual ~CompactBBoxTree() { }
+
+        /// Find the closest intersection along a ray; see @ref Intersect_BBox_Tree().
+        virtual bool Intersect(Queue& queue, const Ray& ray, Intersection *bestIntersection, TraceThreadData *thread) const = 0;
+
+        /// Find the closest intersection along a ray; see @ref Intersect_BBox_Tree().
+        virtual bool Intersect(Queue& queue, const Ray& ray, Intersection *bestIntersection,
+                               const RayObjectCondition& precondition, const RayObjectCondition& postcondition,
+                               TraceThreadData *thread) const = 0;
+
+        /// Find any occluding intersection along a ray; see @ref Occlude_BBox_Tree().
+        ///
+        /// @note   The queue is used as a plain stack here, since the nodes need not be visited in
+        ///         order of distance.
+        ///
+        virtual bool Occlude(Queue& queue, const Ray& ray, DBL maxDepth, Intersection *occluder, bool& otherHits,
+                             const RayObjectCondition& precondition, const RayObjectCondition& postcondition,
+                             const IntersectionCondition& occlusion, TraceThreadData *thread) const = 0;
+
+        /// Find the objects containing a point; see @ref BSPInsideCondFunctor.
+        ///
+        /// @param[in]  point           Point to test.
+        /// @param[in]  precondition    Condition an object must meet to be tested at all.
+        /// @param[in]  postcondition   Condition evaluated for each object containing the point.
+        /// @param[in]  earlyExit       Stop at the first object found.
+        /// @param[in]  thread          Thread data.
+        /// @return                     `true` if an object containing the point was found.
+        ///
+        virtual bool FindInside(const Vector3d& point, const PointObjectCondition& precondition, const PointObjectCondition& postcondition,
+                                bool earlyExit, TraceThreadData *thread) const = 0;
+
+        /// Get the number of nodes.
+        virtual unsigned int GetNodeCount() const = 0;
+
+        /// Get the memory occupied by the nodes, in bytes.
+        virtual size_t GetNodeMemory() const = 0;
+};
+
+/// @}
+///
+//##############################################################################
+
+}
+// end of namespace pov
+
+#endif // POVRAY_CORE_COMPACTBBOXTREE_H
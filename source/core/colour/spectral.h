@@ -88,6 +88,18 @@ class SpectralBand final
             bandwidth   ( super.bandwidth/(float)subBands )
         {}
 
+        /// Construct by range of abstract band indices (ranging from 0 to N-1).
+        SpectralBand(unsigned int firstBand, unsigned int bandCount, unsigned int bands):
+            wavelength  ( SPECTRAL_VIOLET + SPECTRAL_BANDWIDTH*( ((float)firstBand+0.5*(float)bandCount)/(float)bands ) ),
+            bandwidth   ( SPECTRAL_BANDWIDTH*(float)bandCount/(float)bands )
+        {}
+
+        /// Construct by spectral band and range of sub-band indices (ranging from 0 to N-1).
+        SpectralBand(const SpectralBand& super, unsigned int firstSubBand, unsigned int subBandCount, unsigned int subBands):
+            wavelength  ( super.wavelength + super.bandwidth*( ((float)firstSubBand+0.5*(float)subBandCount)/(float)subBands - 0.5 ) ),
+            bandwidth   ( super.bandwidth*(float)subBandCount/(float)subBands )
+        {}
+
         /// Construct by physical parameters.
         SpectralBand(float wl, float bw):
             wavelength(wl),
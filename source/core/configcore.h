@@ -220,6 +220,44 @@
     #endif
 #endif
 
+/// @def TRY_OPTIMIZED_BBOX
+/// Whether the platform provides dynamic optimized ray/box intersection tests.
+///
+/// Define if the platform provides one or more alternative optimized implementations of the
+/// ray/box intersection test used by the bounding box tree, to be dispatched dynamically at
+/// run-time. Leave undefined otherwise.
+///
+/// @note
+///     If this macro is defined, the platform must implement the table
+///     @ref pov::gaOptimizedBBoxInfo as declared in @ref core/bounding/boundingbox.h.
+///
+#ifndef TRY_OPTIMIZED_BBOX
+    // leave undefined
+    #ifdef DOXYGEN
+        // Doxygen cannot document undefined macros.
+        #define TRY_OPTIMIZED_BBOX
+    #endif
+#endif
+
+/// @def TRY_OPTIMIZED_TRANSFORM
+/// Whether the platform provides dynamic optimized vector transformations.
+///
+/// Define if the platform provides one or more alternative optimized implementations of the
+/// transformation of points, directions, normals and rays by a matrix, to be dispatched
+/// dynamically at run-time. Leave undefined otherwise.
+///
+/// @note
+///     If this macro is defined, the platform must implement the table
+///     @ref pov::gaOptimizedTransformInfo as declared in @ref core/math/matrix.h.
+///
+#ifndef TRY_OPTIMIZED_TRANSFORM
+    // leave undefined
+    #ifdef DOXYGEN
+        // Doxygen cannot document undefined macros.
+        #define TRY_OPTIMIZED_TRANSFORM
+    #endif
+#endif
+
 /// @def C99_COMPATIBLE_RADIOSITY
 /// @deprecated
 ///     This is effectively a legacy alias for @ref POV_PORTABLE_RADIOSITY,
@@ -267,6 +305,21 @@
     #define POV_PORTABLE_RADIOSITY C99_COMPATIBLE_RADIOSITY
 #endif
 
+/// @def POV_SHAPE_STATISTICS
+/// Whether to count the ray-object tests of the individual shape types.
+///
+/// Define as non-zero integer to enable, or zero to disable.
+///
+/// The per-shape counters are incremented in the innermost intersection loops; disabling them
+/// removes the respective code entirely, at the cost of leaving the corresponding lines of the
+/// render statistics empty.
+///
+/// If left undefined by system-specific configurations, this setting defaults to `1`.
+///
+#ifndef POV_SHAPE_STATISTICS
+    #define POV_SHAPE_STATISTICS 1
+#endif
+
 //******************************************************************************
 ///
 /// @name Debug Settings.
@@ -41,12 +41,16 @@
 #include "core/core_fwd.h"
 
 // C++ variants of C standard header files
-//  (none at the moment)
+#include <climits>
 
 // C++ standard header files
+#include <algorithm>
 #include <memory>
+#include <new>
 #include <stack>
 #include <string>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 // Boost header files
@@ -138,6 +142,9 @@ typedef TEXTURE* TexturePtr;
 ///
 /// @{
 
+class MediaGrid;
+struct MediaGridCache;
+
 class Media final
 {
     public:
@@ -170,6 +177,12 @@ class Media final
 
         std::vector<PIGMENT*> Density;
 
+        DBL Grid_Spacing;   ///< Cell size of the baked density grid, or 0 to evaluate the density directly.
+        DBL Grid_Memory;    ///< Memory cap for the baked density grid, in MiB.
+        std::shared_ptr<MediaGrid> Grid;
+
+        DBL Density_Bound;  ///< Upper bound of the density's magnitude, or negative if no bound is known.
+
         Media();
         Media(const Media&);
         ~Media();
@@ -257,13 +270,20 @@ template<typename T>
 class RefPool final
 {
     public:
-        RefPool() { }
+        RefPool() : allocations(0) { }
         ~RefPool() { for(typename std::vector<T*>::iterator i(pool.begin()); i != pool.end(); i++) delete *i; pool.clear(); }
 
-        T *alloc() { if(pool.empty()) return new T(); T *ptr(pool.back()); pool.pop_back(); return ptr; }
+        /// Get an object from the pool, constructing a new one from the given arguments only if the pool has run dry.
+        template<typename... ARGS>
+        T *alloc(ARGS&&... args) { if(pool.empty()) { allocations++; return new T(std::forward<ARGS>(args)...); } T *ptr(pool.back()); pool.pop_back(); return ptr; }
         void release(T *ptr) { pool.push_back(ptr); }
+
+        /// Number of objects the pool has had to allocate from the heap so far.
+        /// Once a render has warmed up, this should no longer change.
+        size_t GetAllocationCount() const { return allocations; }
     private:
         std::vector<T*> pool;
+        size_t allocations;
 
         RefPool(const RefPool&) = delete;
         RefPool& operator=(RefPool&) = delete;
@@ -455,9 +475,272 @@ class Intersection final
         ~Intersection() { }
 };
 
-typedef std::stack<Intersection, std::vector<Intersection>> IStackData;
-typedef RefPool<IStackData> IStackPool;
-typedef Ref<IStackData> IStack;
+class IntersectionStack;
+
+/// Per-thread arena holding the intersections found by @ref ObjectBase::All_Intersections().
+///
+/// Intersection stacks (@ref IStack) are bump-allocated from a list of chunks that is retained
+/// when they are released, so that in the steady state no memory needs to be allocated from the
+/// general-purpose heap, and stacks never need to be relocated when they grow.
+///
+/// Since intersection stacks are always local variables, they are released strictly in reverse
+/// order of their creation, each resetting the arena to the position at which it was created.
+/// The only exception is a stack that is still in use by an older stack growing past it (e.g.
+/// while a CSG object transfers the intersections of a child into its own stack), in which case
+/// the memory is reclaimed only when the older stack is released.
+///
+/// @note
+///     The arena must only ever be used by a single thread.
+///
+class IntersectionArena final
+{
+    public:
+
+        IntersectionArena() : mChunk(0), mDepth(0), mPinned(kNotPinned)
+        {
+            maChunks.push_back(Chunk(kChunkSize));
+            mTop   = maChunks[0].Begin();
+            mLimit = maChunks[0].End();
+        }
+
+        /// Allocate uninitialized memory for a contiguous array of intersections.
+        Intersection *Allocate(size_t count)
+        {
+            if (size_t(mLimit - mTop) < count)
+            {
+                // Current chunk exhausted; move on to the next one, or insert a new one if that is too small.
+                size_t next = mChunk + 1;
+                if ((next >= maChunks.size()) || (maChunks[next].size < count))
+                    maChunks.insert(maChunks.begin() + next, Chunk(std::max(count, size_t(kChunkSize))));
+                mChunk = next;
+                mTop   = maChunks[next].Begin();
+                mLimit = maChunks[next].End();
+            }
+            Intersection *block = mTop;
+            mTop += count;
+            return block;
+        }
+
+        /// Grow an array in place if it is the most recent allocation and the chunk has room.
+        bool Extend(const Intersection *end, size_t count)
+        {
+            if ((end != mTop) || (size_t(mLimit - mTop) < count))
+                return false;
+            mTop += count;
+            return true;
+        }
+
+    private:
+
+        friend class IntersectionStack;
+
+        /// Position in the arena to release stacks back to.
+        struct Mark final
+        {
+            size_t chunk;
+            Intersection *top;
+        };
+
+        typedef std::aligned_storage<sizeof(Intersection), alignof(Intersection)>::type Slot;
+
+        struct Chunk final
+        {
+            std::unique_ptr<Slot[]> data;
+            size_t size;
+
+            explicit Chunk(size_t n) : data(new Slot[n]), size(n) { }
+            Intersection *Begin() const { return reinterpret_cast<Intersection*>(data.get()); }
+            Intersection *End() const { return Begin() + size; }
+        };
+
+        static constexpr size_t kChunkSize = 256;
+        static constexpr unsigned int kNotPinned = UINT_MAX;
+
+        std::vector<Chunk> maChunks;    ///< Chunks, including unused ones retained for later use.
+        size_t mChunk;                  ///< Index of the chunk currently allocated from.
+        Intersection *mTop;             ///< Next free slot in the current chunk.
+        Intersection *mLimit;           ///< End of the current chunk.
+        unsigned int mDepth;            ///< Number of live stacks.
+        unsigned int mPinned;           ///< Depth from which live stacks must not release their memory.
+
+        Mark GetMark() const { return Mark{ mChunk, mTop }; }
+
+        void Release(const Mark& mark)
+        {
+            mChunk = mark.chunk;
+            mTop   = mark.top;
+            mLimit = maChunks[mark.chunk].End();
+        }
+
+        /// Note that the stack at the specified depth has allocated memory.
+        void Allocated(unsigned int depth)
+        {
+            // Memory handed to an older stack may lie above the marks of younger ones,
+            // which must therefore leave it to the older stack to reset the arena.
+            if (depth + 1 < mDepth)
+                mPinned = std::min(mPinned, depth + 1);
+        }
+
+        IntersectionArena(const IntersectionArena&) = delete;
+        IntersectionArena& operator=(const IntersectionArena&) = delete;
+};
+
+/// Stack of intersections allocated from an @ref IntersectionArena.
+///
+/// Storage is a chain of contiguous segments, each preceded by a link to its neighbours; the
+/// topmost segment is extended in place as long as no other stack has allocated memory after it.
+/// Segments emptied by popping are kept for re-use until the stack is released.
+///
+class IntersectionStack final
+{
+    public:
+
+        IntersectionStack(IntersectionArena& arena) :
+            mArena(arena), mMark(arena.GetMark()), mDepth(arena.mDepth++), mSegment(nullptr), mTop(nullptr), mSize(0)
+        { }
+
+        ~IntersectionStack()
+        {
+            // Intersections are trivially destructible in all but name, so remaining elements
+            // (if any) are simply dropped along with the memory.
+            POV_REFPOOL_ASSERT(mArena.mDepth == mDepth + 1);
+            mArena.mDepth = mDepth;
+            if (mDepth < mArena.mPinned)
+                mArena.Release(mMark);
+            else if (mDepth == mArena.mPinned)
+                mArena.mPinned = IntersectionArena::kNotPinned;
+        }
+
+        void push(const Intersection& i)
+        {
+            if ((mSegment == nullptr) || (mTop == mSegment->limit))
+                Grow();
+            new (mTop++) Intersection(i);
+            ++mSize;
+        }
+
+        void pop()
+        {
+            POV_REFPOOL_ASSERT(mSize > 0);
+            (--mTop)->~Intersection();
+            --mSize;
+            if ((mTop == Base(mSegment)) && (mSegment->prev != nullptr))
+            {
+                mSegment = mSegment->prev;
+                mTop = mSegment->limit;
+            }
+        }
+
+        Intersection& top() { POV_REFPOOL_ASSERT(mSize > 0); return mTop[-1]; }
+        const Intersection& top() const { POV_REFPOOL_ASSERT(mSize > 0); return mTop[-1]; }
+
+        size_t size() const { return mSize; }
+        bool empty() const { return (mSize == 0); }
+
+        /// Find the closest intersection meeting a condition, without copying or popping any.
+        /// Intersections are examined from top to bottom, so that of several equally close ones
+        /// the same is chosen as when popping them one by one.
+        /// @param  limit   Depth the intersection must be closer than.
+        /// @param  cond    Condition the intersection must meet, evaluated only if closer than
+        ///                 any matching intersection examined so far.
+        /// @return         Pointer to the intersection, or `nullptr` if none qualifies.
+        template<typename C>
+        const Intersection *closest(DBL limit, const C& cond) const
+        {
+            const Intersection *best = nullptr;
+            const Intersection *p = mTop;
+            for (const Segment *seg = mSegment; seg != nullptr; seg = seg->prev)
+            {
+                if (seg != mSegment)
+                    p = seg->limit;
+                for (const Intersection *base = Base(seg); p != base; )
+                {
+                    --p;
+                    if ((p->Depth < limit) && cond(*p))
+                    {
+                        best = p;
+                        limit = p->Depth;
+                    }
+                }
+            }
+            return best;
+        }
+
+    private:
+
+        /// Header preceding each segment, occupying the first slot.
+        struct Segment final
+        {
+            Segment *prev;
+            Segment *next;
+            Intersection *limit;
+        };
+
+        static_assert(sizeof(Segment) <= sizeof(Intersection), "segment header must fit into a slot");
+
+        static constexpr size_t kSegmentSize = 16;
+
+        IntersectionArena& mArena;
+        IntersectionArena::Mark mMark;
+        unsigned int mDepth;
+        Segment *mSegment;
+        Intersection *mTop;
+        size_t mSize;
+
+        static Intersection *Base(Segment *seg) { return reinterpret_cast<Intersection*>(seg) + 1; }
+        static const Intersection *Base(const Segment *seg) { return reinterpret_cast<const Intersection*>(seg) + 1; }
+
+        void Grow()
+        {
+            if (mSegment != nullptr)
+            {
+                if (mSegment->next != nullptr)
+                {
+                    mSegment = mSegment->next;
+                    mTop = Base(mSegment);
+                    return;
+                }
+                if (mArena.Extend(mSegment->limit, kSegmentSize))
+                {
+                    mSegment->limit += kSegmentSize;
+                    mArena.Allocated(mDepth);
+                    return;
+                }
+            }
+            Segment *seg = new (mArena.Allocate(kSegmentSize + 1)) Segment{ mSegment, nullptr, nullptr };
+            seg->limit = Base(seg) + kSegmentSize;
+            mArena.Allocated(mDepth);
+            if (mSegment != nullptr)
+                mSegment->next = seg;
+            mSegment = seg;
+            mTop = Base(seg);
+        }
+
+        IntersectionStack() = delete;
+        IntersectionStack(const IntersectionStack&) = delete;
+        IntersectionStack& operator=(const IntersectionStack&) = delete;
+};
+
+/// Scoped handle to an intersection stack, for use via `->` as with other pooled data.
+class IStack final
+{
+    public:
+        IStack(IntersectionArena& arena) : stack(arena) { }
+
+        IntersectionStack& operator*() { return stack; }
+        const IntersectionStack& operator*() const { return stack; }
+
+        IntersectionStack *operator->() { return &stack; }
+        const IntersectionStack *operator->() const { return &stack; }
+    private:
+        IntersectionStack stack;
+
+        IStack() = delete;
+        IStack(const IStack&) = delete;
+        IStack& operator=(IStack&) = delete;
+};
+
+typedef IntersectionArena IStackPool;
 
 struct BasicRay
 {
@@ -493,6 +776,13 @@ struct TrueRayObjectCondition final : public RayObjectCondition
     virtual bool operator()(const Ray&, ConstObjectPtr, DBL) const override { return true; }
 };
 
+/// Condition an intersection must meet to terminate an any-hit query.
+struct IntersectionCondition
+{
+    virtual ~IntersectionCondition() {}
+    virtual bool operator()(const Intersection& isect) const = 0;
+};
+
 struct PointObjectCondition
 {
     virtual ~PointObjectCondition() {}
@@ -551,6 +841,28 @@ class FractalRules
         virtual bool Iterate (const Vector3d&, const Fractal *, DBL **) const = 0;
         virtual bool Iterate (const Vector3d&, const Fractal *, const Vector3d&, DBL *, DBL **) const = 0;
         virtual bool Bound (const BasicRay&, const Fractal *, DBL *, DBL *) const = 0;
+
+        /// Maximum number of points tested by a single call to @ref Iterate(const Vector3d*,unsigned int,const Fractal*,DBL**,bool*) const.
+        static const unsigned int kMaxBatchSize = 4;
+
+        /// Test several points at once for being inside the set.
+        ///
+        /// Unlike the single-point variants, this does not leave the iteration sequence of any
+        /// of the points in the iteration stack. The default implementation tests the points one
+        /// by one; rules with a simple iteration formula override it to iterate all points in
+        /// lock-step, in loops the compiler is able to vectorize.
+        ///
+        /// @param[in]  points      Points to test.
+        /// @param[in]  count       Number of points, at most @ref kMaxBatchSize.
+        /// @param[in]  fractal     Fractal to test against.
+        /// @param      IterStack   Scratch space for the iteration sequence.
+        /// @param[out] inside      Results of the tests.
+        ///
+        virtual void Iterate (const Vector3d *points, unsigned int count, const Fractal *fractal, DBL **IterStack, bool *inside) const
+        {
+            for (unsigned int i = 0; i < count; ++i)
+                inside[i] = Iterate(points[i], fractal, IterStack);
+        }
 };
 
 typedef std::shared_ptr<FractalRules> FractalRulesPtr;
@@ -648,6 +960,20 @@ struct CustomFunctionSourceInfo : SourceInfo
     CustomFunctionSourceInfo(const UTF8String& n, const MessageContext& o) : name(n), SourceInfo(o) {}
 };
 
+/// Closed interval of real numbers.
+///
+/// Used to describe a range of function arguments, and conservative bounds of the function's
+/// value over that range.
+///
+struct FunctionInterval final
+{
+    DBL lower;
+    DBL upper;
+    FunctionInterval() : lower(0.0), upper(0.0) {}
+    FunctionInterval(DBL v) : lower(v), upper(v) {}
+    FunctionInterval(DBL l, DBL u) : lower(l), upper(u) {}
+};
+
 template<typename RETURN_T, typename ARG_T>
 class GenericCustomFunction
 {
@@ -658,8 +984,30 @@ public:
     virtual void InitArguments(GenericFunctionContextPtr pContext) = 0;
     virtual void PushArgument(GenericFunctionContextPtr pContext, ARG_T arg) = 0;
     virtual RETURN_T Execute(GenericFunctionContextPtr pContext) = 0;
+    /// Compute conservative bounds of the function's value for all arguments within the given ranges.
+    /// @return `false` if no bounds can be computed, e.g. because the function uses features
+    ///         not supported in this mode.
+    virtual bool ExecuteBounds(GenericFunctionContextPtr pContext, const FunctionInterval* args, unsigned int argCount, FunctionInterval& result) { return false; }
+    /// Evaluate the function for a number of argument sets at once.
+    /// @param[in]  args    `count` consecutive sets of `argCount` arguments each.
+    /// @param[out] results One result per argument set.
+    /// The default implementation simply evaluates one argument set after the other.
+    virtual void ExecuteBatch(GenericFunctionContextPtr pContext, const ARG_T* args, unsigned int argCount, unsigned int count, RETURN_T* results)
+    {
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            InitArguments(pContext);
+            for (unsigned int j = 0; j < argCount; ++j)
+                PushArgument(pContext, args[i * argCount + j]);
+            results[i] = Execute(pContext);
+        }
+    }
     virtual GenericCustomFunction* Clone() const = 0;
     virtual const CustomFunctionSourceInfo* GetSourceInfo() const { return nullptr; }
+    /// Compute a fingerprint identifying the function's definition, e.g. to key data derived
+    /// from the function in a cache that outlives the current parse.
+    /// @return `false` if the function can't be fingerprinted.
+    virtual bool GetFingerprint(POV_UINT64& fingerprint) const { return false; }
 };
 
 typedef GenericCustomFunction<double, double> GenericScalarFunction;
@@ -732,6 +1080,39 @@ public:
         return Evaluate(argV.x(), argV.y(), argV.z());
     }
 
+    /// Compute conservative bounds of the function's value within an axis-aligned box.
+    /// @return `false` if no bounds can be computed.
+    inline bool EvaluateBounds(const Vector3d& lower, const Vector3d& upper, FunctionInterval& result)
+    {
+        const FunctionInterval args[3] =
+        {
+            FunctionInterval(lower.x(), upper.x()),
+            FunctionInterval(lower.y(), upper.y()),
+            FunctionInterval(lower.z(), upper.z())
+        };
+        return mpFunction->ExecuteBounds(mpContext, args, 3, result);
+    }
+
+    /// Evaluate the function at a number of points at once.
+    /// This is faster than evaluating the points one by one where the function supports it.
+    inline void EvaluateBatch(const Vector3d* points, unsigned int count, RETURN_T* results)
+    {
+        static const unsigned int kChunkSize = 16;
+        ARG_T args[3 * kChunkSize];
+        for (unsigned int i = 0; i < count; i += kChunkSize)
+        {
+            unsigned int n = std::min(count - i, kChunkSize);
+            for (unsigned int j = 0; j < n; ++j)
+            {
+                args[3 * j]     = points[i + j].x();
+                args[3 * j + 1] = points[i + j].y();
+                args[3 * j + 2] = points[i + j].z();
+            }
+            mpFunction->ExecuteBatch(mpContext, args, 3, n, results + i);
+        }
+        mReInit = true;
+    }
+
 protected:
     GenericCustomFunction<RETURN_T,ARG_T>*  mpFunction;
     GenericFunctionContextPtr               mpContext;
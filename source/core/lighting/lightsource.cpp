@@ -390,9 +390,13 @@ LightSource::LightSource() : CompoundObject(LIGHT_OBJECT)
     Area_Size2 = 0;
 
     Adaptive_Level = 100;
+    Sample_Variance = 0.0;
 
     Media_Attenuation = false;
     Media_Interaction = true;
+
+    Media_Grid_Spacing = 0.0;
+    Media_Grid_Memory = 256.0;
 }
 
 
@@ -0,0 +1,404 @@
+//******************************************************************************
+///
+/// @file core/lighting/lighttree.cpp
+///
+/// Implementations related to the light source hierarchy.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+// Unit header file must be the first file included within POV-Ray *.cpp files (pulls in config)
+#include "core/lighting/lighttree.h"
+
+// C++ variants of C standard header files
+#include <cmath>
+
+// C++ standard header files
+#include <algorithm>
+
+// POV-Ray header files (base module)
+//  (none at the moment)
+
+// POV-Ray header files (core module)
+#include "core/lighting/lightsource.h"
+#include "core/scene/object.h"
+
+// this must be the last file included
+#include "base/povdebug.h"
+
+namespace pov
+{
+
+/// Maximum number of light sources in a leaf node.
+const size_t LIGHT_TREE_LEAF_SIZE = 4;
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Light_Influence_Radius
+*
+* INPUT
+*
+*   Light     - light source
+*   Threshold - light intensity below which the light source may be ignored
+*
+* OUTPUT
+*
+*   Radius    - distance from the light source's center beyond which its
+*               attenuated colour cannot exceed the threshold
+*
+* RETURNS
+*
+*   bool - false if the influence of the light source is not bounded
+*
+* AUTHOR
+*
+*   -
+*
+* DESCRIPTION
+*
+*   Inverts the distance fading applied by Attenuate_Light(). Spotlight
+*   attenuation never exceeds 1 and is therefore ignored. Cylindrical and
+*   parallel light sources measure the distance along their axis rather than
+*   from their center, so they are never bounded.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+static bool Light_Influence_Radius(const LightSource *Light, DBL Threshold, DBL& Radius)
+{
+    DBL power = Light->colour.MaxAbs();
+
+    if ((Light->Light_Type == CYLINDER_SOURCE) || Light->Parallel)
+        return false;
+
+    if (Light->Fade_Power <= 0.0)
+        return false;
+
+    if (fabs(Light->Fade_Distance) >= EPSILON)
+    {
+        // a negative fade distance does not yield a monotonic falloff
+        if (Light->Fade_Distance < 0.0)
+            return false;
+
+        // 2 / (1 + (d / fade_distance) ^ fade_power) * power = threshold
+        if (2.0 * power > Threshold)
+            Radius = Light->Fade_Distance * pow(2.0 * power / Threshold - 1.0, 1.0 / Light->Fade_Power);
+        else
+            Radius = 0.0;
+    }
+    else
+    {
+        // d ^ -fade_power * power = threshold
+        Radius = pow(power / Threshold, 1.0 / Light->Fade_Power);
+    }
+
+    // area light samples may be anywhere within the area spanned by the axes
+    // (and a little beyond when jittered), so be generous
+    if (Light->Area_Light)
+        Radius += Light->Axis1.length() + Light->Axis2.length();
+
+    return std::isfinite(Radius);
+}
+
+LightTree::LightTree(const std::vector<LightSource*>& lights, DBL threshold)
+{
+    for (size_t i = 0; i < lights.size(); i++)
+    {
+        DBL radius;
+
+        if ((threshold > 0.0) && Light_Influence_Radius(lights[i], threshold, radius))
+        {
+            Entry entry;
+            entry.center = lights[i]->Center;
+            entry.radiusSqr = Sqr(radius);
+            entry.index = i;
+            bounded.push_back(entry);
+        }
+        else
+            unbounded.push_back(i);
+    }
+
+    if (!bounded.empty())
+    {
+        nodes.reserve(2 * (bounded.size() / LIGHT_TREE_LEAF_SIZE + 1));
+        Build(0, bounded.size());
+    }
+}
+
+void LightTree::Build(size_t first, size_t last)
+{
+    size_t nodeIndex = nodes.size();
+    Vector3d centerMin, centerMax;
+
+    nodes.push_back(Node());
+
+    Node& node = nodes.back();
+
+    node.lowerLeft = centerMin = Vector3d(BOUND_HUGE);
+    node.upperRight = centerMax = Vector3d(-BOUND_HUGE);
+
+    for (size_t i = first; i < last; i++)
+    {
+        DBL radius = sqrt(bounded[i].radiusSqr);
+
+        for (int axis = X; axis <= Z; axis++)
+        {
+            node.lowerLeft[axis] = std::min(node.lowerLeft[axis], bounded[i].center[axis] - radius);
+            node.upperRight[axis] = std::max(node.upperRight[axis], bounded[i].center[axis] + radius);
+            centerMin[axis] = std::min(centerMin[axis], bounded[i].center[axis]);
+            centerMax[axis] = std::max(centerMax[axis], bounded[i].center[axis]);
+        }
+    }
+
+    if (last - first <= LIGHT_TREE_LEAF_SIZE)
+    {
+        node.first = first;
+        node.count = last - first;
+        return;
+    }
+
+    // split at the median along the axis with the widest spread of light positions
+    Vector3d extent = centerMax - centerMin;
+    int axis = (extent[X] > extent[Y]) ? ((extent[X] > extent[Z]) ? X : Z) : ((extent[Y] > extent[Z]) ? Y : Z);
+    size_t middle = (first + last) / 2;
+
+    std::nth_element(bounded.begin() + first, bounded.begin() + middle, bounded.begin() + last,
+                     [axis](const Entry& a, const Entry& b) { return a.center[axis] < b.center[axis]; });
+
+    nodes[nodeIndex].count = 0;
+
+    Build(first, middle);
+    nodes[nodeIndex].first = nodes.size();
+    Build(middle, last);
+}
+
+void LightTree::Gather(const Vector3d& point, std::vector<size_t>& indices) const
+{
+    size_t stack[64];
+    size_t depth = 0;
+
+    indices.assign(unbounded.begin(), unbounded.end());
+
+    if (nodes.empty())
+        return;
+
+    stack[depth++] = 0;
+
+    while (depth > 0)
+    {
+        const Node& node = nodes[stack[--depth]];
+
+        if ((point[X] < node.lowerLeft[X]) || (point[X] > node.upperRight[X]) ||
+            (point[Y] < node.lowerLeft[Y]) || (point[Y] > node.upperRight[Y]) ||
+            (point[Z] < node.lowerLeft[Z]) || (point[Z] > node.upperRight[Z]))
+            continue;
+
+        if (node.count > 0)
+        {
+            for (size_t i = node.first; i < node.first + node.count; i++)
+            {
+                if ((point - bounded[i].center).lengthSqr() <= bounded[i].radiusSqr)
+                    indices.push_back(bounded[i].index);
+            }
+        }
+        else
+        {
+            stack[depth++] = node.first;
+            stack[depth++] = &node - &nodes[0] + 1;
+        }
+    }
+
+    std::sort(indices.begin(), indices.end());
+}
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Sphere_In_Cone
+*
+* INPUT
+*
+*   Center, Radius - sphere to test
+*   Apex, Axis     - apex and (normalized) axis of the cone
+*   CosAngle       - cosine of the half opening angle of the cone
+*
+* OUTPUT
+*
+* RETURNS
+*
+*   bool - false if the sphere lies entirely outside the cone
+*
+* AUTHOR
+*
+*   -
+*
+* DESCRIPTION
+*
+*   The sphere is inside if the angle between the axis and the direction to
+*   its center, less the angle the sphere subtends, is within the cone.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+static bool Sphere_In_Cone(const Vector3d& Center, DBL Radius, const Vector3d& Apex, const Vector3d& Axis, DBL CosAngle)
+{
+    Vector3d v = Center - Apex;
+    DBL dist = v.length();
+
+    if (dist <= Radius)
+        return true;
+
+    DBL angle = acos(clip(dot(v, Axis) / dist, -1.0, 1.0)) - asin(Radius / dist);
+
+    return (angle <= acos(clip(CosAngle, -1.0, 1.0)));
+}
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Sphere_Near_Line
+*
+* INPUT
+*
+*   Center, Radius - sphere to test
+*   Origin, Axis   - point on and (normalized) direction of the line
+*   Distance       - maximum distance from the line
+*
+* OUTPUT
+*
+* RETURNS
+*
+*   bool - false if the sphere lies entirely beyond the distance
+*
+* AUTHOR
+*
+*   -
+*
+* DESCRIPTION
+*
+*   -
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+static bool Sphere_Near_Line(const Vector3d& Center, DBL Radius, const Vector3d& Origin, const Vector3d& Axis, DBL Distance)
+{
+    Vector3d v = Center - Origin;
+
+    return ((v - dot(v, Axis) * Axis).length() - Radius < Distance);
+}
+
+void Compute_Light_Reach(const std::vector<LightSource*>& lights, DBL threshold, const BoundingBox& bbox, std::vector<size_t>& indices)
+{
+    Vector3d lowerLeft(bbox.lowerLeft);
+    Vector3d upperRight(Vector3d(bbox.lowerLeft) + Vector3d(bbox.size));
+    Vector3d center = (lowerLeft + upperRight) * 0.5;
+    DBL radius = (upperRight - lowerLeft).length() * 0.5;
+
+    indices.clear();
+
+    for (size_t i = 0; i < lights.size(); i++)
+    {
+        const LightSource *light = lights[i];
+
+        // area light samples may be anywhere within the area spanned by the axes
+        // (and a little beyond when jittered), so be generous
+        DBL areaRadius = 0.0;
+        if (light->Area_Light)
+            areaRadius = light->Axis1.length() + light->Axis2.length();
+
+        DBL influence;
+        if ((threshold > 0.0) && Light_Influence_Radius(light, threshold, influence))
+        {
+            // distance from the light source to the nearest point of the box
+            Vector3d nearest;
+            for (int axis = X; axis <= Z; axis++)
+                nearest[axis] = clip(light->Center[axis], lowerLeft[axis], upperRight[axis]);
+            if ((nearest - light->Center).length() > influence)
+                continue;
+        }
+
+        if ((light->Light_Type == SPOT_SOURCE) && !light->Parallel)
+        {
+            // beyond the falloff angle (or behind the light if there is none) a spotlight is black
+            DBL cosAngle = ((light->Radius > 0.0) ? light->Falloff : 0.0);
+            if (!Sphere_In_Cone(center, radius + areaRadius, light->Center, light->Direction, cosAngle))
+                continue;
+        }
+        else if (light->Light_Type == CYLINDER_SOURCE)
+        {
+            // beyond the falloff radius or behind the light a cylindrical light is black
+            if ((dot(center - light->Center, light->Direction) + radius <= 0.0) ||
+                !Sphere_Near_Line(center, radius, light->Center, light->Direction, light->Falloff))
+                continue;
+        }
+
+        size_t entry = i;
+
+        const ObjectPtr projector = light->Projected_Through_Object;
+        if ((projector != nullptr) && !Test_Flag(projector, INFINITE_FLAG))
+        {
+            Vector3d projectorLowerLeft(projector->BBox.lowerLeft);
+            Vector3d projectorUpperRight(Vector3d(projector->BBox.lowerLeft) + Vector3d(projector->BBox.size));
+            Vector3d projectorCenter = (projectorLowerLeft + projectorUpperRight) * 0.5;
+            DBL projectorRadius = (projectorUpperRight - projectorLowerLeft).length() * 0.5 + areaRadius;
+
+            bool reached;
+            if (light->Parallel)
+                reached = Sphere_Near_Line(center, radius, projectorCenter, light->Direction, projectorRadius);
+            else
+            {
+                Vector3d toProjector = projectorCenter - light->Center;
+                DBL dist = toProjector.length();
+                reached = (dist <= projectorRadius) ||
+                          Sphere_In_Cone(center, radius, light->Center, toProjector / dist, cos(asin(projectorRadius / dist)));
+            }
+            if (!reached)
+                entry |= LIGHT_REACH_PROJECTED_ONLY;
+        }
+
+        indices.push_back(entry);
+    }
+}
+
+}
+// end of namespace pov
@@ -0,0 +1,152 @@
+//******************************************************************************
+///
+/// @file core/lighting/lighttree.h
+///
+/// Declarations related to the light source hierarchy.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+#ifndef POVRAY_CORE_LIGHTTREE_H
+#define POVRAY_CORE_LIGHTTREE_H
+
+// Module config header file must be the first file included within POV-Ray unit header files
+#include "core/configcore.h"
+
+// C++ variants of C standard header files
+#include <cstddef>
+
+// C++ standard header files
+#include <vector>
+
+// POV-Ray header files (base module)
+//  (none at the moment)
+
+// POV-Ray header files (core module)
+#include "core/bounding/boundingbox.h"
+#include "core/coretypes.h"
+#include "core/math/vector.h"
+
+namespace pov
+{
+
+//##############################################################################
+///
+/// @addtogroup PovCoreLighting
+///
+/// @{
+
+/// Bounding volume hierarchy over the global light sources.
+///
+/// Each light source whose attenuation falls off with distance is bounded by the sphere
+/// outside of which its colour, scaled by the spotlight and fading attenuation, can no
+/// longer exceed a given threshold. A shading point then only needs to consider the light
+/// sources whose sphere it lies in, plus all light sources that cannot be bounded this way
+/// (no fading, parallel and cylindrical light sources).
+///
+/// The tree refers to the light sources by their index, so that it can be shared between
+/// all render threads even though each of them works on its own copies of the light sources.
+///
+class LightTree final
+{
+    public:
+
+        /// Build the hierarchy.
+        ///
+        /// @param[in]  lights      Global light sources of the scene.
+        /// @param[in]  threshold   Light intensity below which a light source is ignored.
+        ///
+        LightTree(const std::vector<LightSource*>& lights, DBL threshold);
+
+        /// Collect the light sources that may illuminate a point.
+        ///
+        /// The indices are returned in ascending order, so that the remaining light sources
+        /// are evaluated in the same order as without the hierarchy.
+        ///
+        /// @param[in]  point       Point to be illuminated.
+        /// @param[out] indices     Indices of the light sources to evaluate.
+        ///
+        void Gather(const Vector3d& point, std::vector<size_t>& indices) const;
+
+        /// Number of light sources that are subject to culling.
+        size_t BoundedCount() const { return bounded.size(); }
+
+    private:
+
+        struct Node final
+        {
+            Vector3d lowerLeft;     ///< Minimum corner of the bounding box.
+            Vector3d upperRight;    ///< Maximum corner of the bounding box.
+            size_t first;           ///< Leaf: first entry in @ref bounded; inner node: index of the second child.
+            size_t count;           ///< Leaf: number of entries; 0 for an inner node, whose first child follows immediately.
+        };
+
+        struct Entry final
+        {
+            Vector3d center;        ///< Centre of the sphere of influence.
+            DBL radiusSqr;          ///< Squared radius of the sphere of influence.
+            size_t index;           ///< Index of the light source.
+        };
+
+        std::vector<Node> nodes;
+        std::vector<Entry> bounded;
+        std::vector<size_t> unbounded;
+
+        void Build(size_t first, size_t last);
+};
+
+/// Flag marking an entry of a light reach list as kept out only by the light source's `projected_through` object.
+///
+/// As the `projected_through` test is part of the shadow test, such light sources still reach
+/// the object when shadows are turned off.
+///
+const size_t LIGHT_REACH_PROJECTED_ONLY = ~(~size_t(0) >> 1);
+
+/// Determine the global light sources that may reach any point within a bounding box.
+///
+/// A light source is ruled out if the box lies entirely outside its spotlight cone, its
+/// cylinder, the sphere of influence used by @ref LightTree, or the shadow cast through its
+/// `projected_through` object; the tests are conservative, using the box's bounding sphere.
+///
+/// @param[in]  lights      Global light sources of the scene.
+/// @param[in]  threshold   Light intensity below which a light source is ignored.
+/// @param[in]  bbox        Bounding box to test; must be finite.
+/// @param[out] indices     Indices of the light sources that may reach the box, in ascending order,
+///                         with @ref LIGHT_REACH_PROJECTED_ONLY set where applicable.
+///
+void Compute_Light_Reach(const std::vector<LightSource*>& lights, DBL threshold, const BoundingBox& bbox, std::vector<size_t>& indices);
+
+/// @}
+///
+//##############################################################################
+
+}
+// end of namespace pov
+
+#endif // POVRAY_CORE_LIGHTTREE_H
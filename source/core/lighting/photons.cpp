@@ -37,11 +37,15 @@
 #include "core/lighting/photons.h"
 
 // C++ variants of C standard header files
+#include <cstddef>
 #include <cstdlib>
 
 // C++ standard header files
 #include <algorithm>
+#include <exception>
+#include <iterator>
 #include <limits>
+#include <thread>
 
 // POV-Ray header files (base module)
 #include "base/povassert.h"
@@ -1231,7 +1235,8 @@ void PhotonMediaFunction::DepositMediaPhotons(MathColour& colour, MediaVector& m
         nothing is done
 
 ******************************************************************************/
-PhotonMap::PhotonMap()
+PhotonMap::PhotonMap() :
+    mMemory(kMemory_Photons)
 {
     minGatherRad = 0.0;
 
@@ -1241,6 +1246,8 @@ PhotonMap::PhotonMap()
     gatherNumSteps=2;
 
     numPhotons = 0;
+
+    positionX = positionY = positionZ = nullptr;
 }
 
 SinCosOptimizations::SinCosOptimizations()
@@ -1270,6 +1277,41 @@ SinCosOptimizations::~SinCosOptimizations()
 }
 
 
+// Convert the photon's incoming direction from its two-byte representation
+// back to a unit vector (pointing towards the light).
+Vector3d Photon::GetDirection() const
+{
+    Vector3d direction;
+    int t = theta + 127;
+    int p = phi + 127;
+
+    direction[Y] = sinCosData.sinTheta[t];
+    direction[X] = sinCosData.cosTheta[t];
+
+    direction[Z] = direction[X] * sinCosData.sinTheta[p];
+    direction[X] = direction[X] * sinCosData.cosTheta[p];
+
+    return direction;
+}
+
+// Convert a unit vector (pointing towards the light) to the photon's two-byte
+// representation of its incoming direction.
+void Photon::SetDirection(const Vector3d& direction)
+{
+    DBL d_len = sqrt(direction[X]*direction[X]+direction[Z]*direction[Z]);
+
+    DBL p = (d_len > 0.0 ? acos(clip(direction[X]/d_len, -1.0, 1.0)) : 0.0);
+    if (direction[Z]<0) p = -p;
+
+    DBL t = acos(clip(d_len, 0.0, 1.0));
+    if (direction[Y]<0) t = -t;
+
+    // cram these rotation angles into two signed bytes
+    theta = (signed char)(t*127.0/M_PI);
+    phi = (signed char)(p*127.0/M_PI);
+}
+
+
 /*****************************************************************************
 
  FUNCTION
@@ -1309,8 +1351,11 @@ Photon* PhotonMap::AllocatePhoton()
     numPhotons++;
 
     if (j >= mBlockList.size())
+    {
         // allocate a new block of photons
         mBlockList.push_back(new PhotonBlock);
+        updateMemory();
+    }
 
     return &GetPhoton(j, i);
 }
@@ -1375,6 +1420,44 @@ void PhotonMap::mergeMap(PhotonMap* map)
         mBlockList.push_back(mapPartialBlock);
 
     numPhotons += map->numPhotons;
+
+    map->updateMemory();
+    updateMemory();
+}
+
+
+
+/*
+Discard all photons, freeing their memory, so that the map
+can be filled again.
+*/
+void PhotonMap::clear()
+{
+    if (mpStorage == nullptr)
+    {
+        for (auto&& block : mBlockList)
+        {
+            if (block != nullptr)
+                delete block;
+        }
+    }
+    mBlockList.clear();
+    mpStorage.reset();
+
+    std::vector<PhotonScalar>().swap(mPositions);
+    positionX = positionY = positionZ = nullptr;
+
+    numPhotons = 0;
+
+    updateMemory();
+}
+
+void PhotonMap::updateMemory()
+{
+    if (isMapped())
+        mMemory.Set(0);
+    else
+        mMemory.Set(mBlockList.size() * sizeof(PhotonBlock) + mPositions.capacity() * sizeof(PhotonScalar));
 }
 
 
@@ -1392,6 +1475,10 @@ void PhotonMap::mergeMap(PhotonMap* map)
 
 PhotonMap::~PhotonMap()
 {
+    // blocks of a memory-mapped map are owned by the file
+    if (mpStorage != nullptr)
+        return;
+
     // free all non-nullptr blocks
     for (auto&& block : mBlockList)
     {
@@ -1550,158 +1637,58 @@ void PhotonMap::swapPhotons(int a, int b)
 
 /*****************************************************************************
 
-  FUNCTION
-
-  insertSort
-  (modified from Data Structures textbook)
-
-  Preconditions:
-    photon memory initialized
-    'start' is the index of the first photon
-    'end' is the index of the last photon
-    'd' is the dimension to sort on (X, Y, or Z)
-
-  Postconditions:
-    photons from 'start' to 'end' in the map are sorted in
-    ascending order on dimension d
-******************************************************************************/
-void PhotonMap::insertSort(int start, int end, int d)
-{
-    int j,k;
-    Photon tmp;
-
-    for(k=end-1; k>=start; k--)
-    {
-        j=k+1;
-        tmp = GetPhoton(k);
-        while (tmp.Loc[d] > GetPhoton(j).Loc[d])
-        {
-            GetPhoton(j-1) = GetPhoton(j);
-            j++;
-            if (j>end) break;
-        }
-        GetPhoton(j-1) = tmp;
-    }
-}
-
-/*****************************************************************************
-
-  FUNCTION
+  CLASS
 
-  quickSortRec
-  (modified from Data Structures textbook)
+  PhotonMapIterator
 
-  Recursive part of the quicksort routine
-  This does not sort all the way.  once this is done, insertSort
-  should be called to finish the sorting process!
-
-  Preconditions:
-    photon memory initialized
-    'left' is the index of the first photon
-    'right' is the index of the last photon
-    'd' is the dimension to sort on (X, Y, or Z)
+  Random access iterator over the photons of a photon map, so that the
+  standard library algorithms can work on the block structure in place.
 
-  Postconditions:
-    photons from 'left' to 'right' in the map are MOSTLY sorted in
-    ascending order on dimension d
 ******************************************************************************/
-void PhotonMap::quickSortRec(int left, int right, int d)
+class PhotonMapIterator final
 {
-    int j,k;
-    if(left<right)
-    {
-        swapPhotons(((left+right)>>1), left+1);
-        if (GetPhoton(left+1).Loc[d] > GetPhoton(right).Loc[d])
-            swapPhotons(left+1,right);
-        if (GetPhoton(left).Loc[d] > GetPhoton(right).Loc[d])
-            swapPhotons(left,right);
-        if (GetPhoton(left+1).Loc[d] > GetPhoton(left).Loc[d])
-            swapPhotons(left+1,left);
-
-        j=left+1; k=right;
-        while(j<=k)
-        {
-            for (j++; (j <= right) && (GetPhoton(j).Loc[d] < GetPhoton(left).Loc[d]); j++) { }
-            for (k--; (k >= left) && (GetPhoton(k).Loc[d] > GetPhoton(left).Loc[d]); k--) { }
-
-            if(j<k)
-                swapPhotons(j,k);
-        }
-
-        swapPhotons(left,k);
-        if(k-left > 10)
-        {
-            quickSortRec(left,k-1,d);
-        }
-        if(right-k > 10)
-        {
-            quickSortRec(k+1,right,d);
-        }
-        // leave the rest for insertSort
-    }
-}
-
-/*****************************************************************************
-
-  FUNCTION
-
-  halfSortRec
-  (modified quicksort algorithm)
-
-  Recursive part of the quicksort routine, but it only does half
-  the quicksort.  It only recurses one branch - the branch that contains
-  the midpoint (median).
-
-  Preconditions:
-    photon memory initialized
-    'left' is the index of the first photon
-    'right' is the index of the last photon
-    'd' is the dimension to sort on (X, Y, or Z)
-    'mid' is the index where the median will end up
-
-  Postconditions:
-    the photon at the midpoint (mid) is the median of the photons
-    when sorted on dimension d.
-******************************************************************************/
-void PhotonMap::halfSortRec(int left, int right, int d, int mid)
-{
-    int j,k;
-    if(left<right)
-    {
-        swapPhotons(((left+right)>>1), left+1);
-        if (GetPhoton(left+1).Loc[d] > GetPhoton(right).Loc[d])
-            swapPhotons(left+1,right);
-        if (GetPhoton(left).Loc[d] > GetPhoton(right).Loc[d])
-            swapPhotons(left,right);
-        if (GetPhoton(left+1).Loc[d] > GetPhoton(left).Loc[d])
-            swapPhotons(left+1,left);
-
-        j=left+1; k=right;
-        while(j<=k)
-        {
-            for (j++; (j <= right) && (GetPhoton(j).Loc[d] < GetPhoton(left).Loc[d]); j++) { }
-            for (k--; (k >= left) && (GetPhoton(k).Loc[d] > GetPhoton(left).Loc[d]); k--) { }
+public:
+    typedef std::random_access_iterator_tag iterator_category;
+    typedef Photon value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef Photon* pointer;
+    typedef Photon& reference;
+
+    PhotonMapIterator() : mMap(nullptr), mIndex(0) {}
+    PhotonMapIterator(PhotonMap* map, difference_type index) : mMap(map), mIndex(index) {}
+
+    reference operator*() const { return mMap->GetPhoton((unsigned int)mIndex); }
+    pointer operator->() const { return &mMap->GetPhoton((unsigned int)mIndex); }
+    reference operator[](difference_type n) const { return mMap->GetPhoton((unsigned int)(mIndex + n)); }
+
+    PhotonMapIterator& operator++() { ++mIndex; return *this; }
+    PhotonMapIterator& operator--() { --mIndex; return *this; }
+    PhotonMapIterator operator++(int) { PhotonMapIterator tmp(*this); ++mIndex; return tmp; }
+    PhotonMapIterator operator--(int) { PhotonMapIterator tmp(*this); --mIndex; return tmp; }
+    PhotonMapIterator& operator+=(difference_type n) { mIndex += n; return *this; }
+    PhotonMapIterator& operator-=(difference_type n) { mIndex -= n; return *this; }
+    PhotonMapIterator operator+(difference_type n) const { return PhotonMapIterator(mMap, mIndex + n); }
+    PhotonMapIterator operator-(difference_type n) const { return PhotonMapIterator(mMap, mIndex - n); }
+    friend PhotonMapIterator operator+(difference_type n, const PhotonMapIterator& it) { return it + n; }
+    difference_type operator-(const PhotonMapIterator& other) const { return mIndex - other.mIndex; }
+
+    bool operator==(const PhotonMapIterator& other) const { return mIndex == other.mIndex; }
+    bool operator!=(const PhotonMapIterator& other) const { return mIndex != other.mIndex; }
+    bool operator<(const PhotonMapIterator& other) const { return mIndex < other.mIndex; }
+    bool operator>(const PhotonMapIterator& other) const { return mIndex > other.mIndex; }
+    bool operator<=(const PhotonMapIterator& other) const { return mIndex <= other.mIndex; }
+    bool operator>=(const PhotonMapIterator& other) const { return mIndex >= other.mIndex; }
 
-            if(j<k)
-                swapPhotons(j,k);
-        }
+private:
+    PhotonMap* mMap;
+    difference_type mIndex;
+};
 
-        // put the pivot into its position
-        swapPhotons(left,k);
+/// Minimum number of photons in a subtree for it to be split across threads.
+constexpr int PHOTON_PARALLEL_BUILD_THRESHOLD = 1 << 16;
 
-        // only go down the side that contains the midpoint
-        // don't do anything if the midpoint=k (the pivot, which is
-        // now in the correct position
-        if(k-left > 0 && (mid>=left) && (mid<k))
-        {
-            halfSortRec(left,k-1,d,mid);
-        }
-        else if(right-k > 0 && (mid>k) && (mid<=right))
-        {
-            halfSortRec(k+1,right,d,mid);
-        }
-    }
-}
+/// Maximum number of photons in a subtree for the gatherer to test them all at once.
+constexpr int PHOTON_GATHER_LEAF_SIZE = 16;
 
 /*****************************************************************************
 
@@ -1709,26 +1696,31 @@ void PhotonMap::halfSortRec(int left, int right, int d, int mid)
 
   sortAndSubdivide
 
-  Finds the dimension with the greatest range, sorts the photons on that
-  dimension.  Then it recurses on the left and right halves (keeping
-  the median photon as a pivot).  This produces a balanced kd-tree.
+  Finds the dimension with the greatest range, and partitions the photons
+  around the median on that dimension.  Then it recurses on the left and
+  right halves (keeping the median photon as a pivot).  This produces a
+  balanced kd-tree.
+
+  If more than one thread is available and the range is large enough, the
+  left half is built by a helper thread while the current thread builds the
+  right half.  As the two halves do not overlap, the resulting layout is the
+  same as in the single-threaded case.
 
   Preconditions:
     photon memory initialized
     'start' is the index of the first photon
     'end' is the index of the last photon
-    'sorted' is the dimension that was last sorted (so we don't sort again)
+    'threads' is the maximum number of threads to use
 
   Postconditions:
     photons from 'start' to 'end' in the map are in a valid kd-tree format
 ******************************************************************************/
-void PhotonMap::sortAndSubdivide(int start, int end, int /*sorted*/)
+void PhotonMap::sortAndSubdivide(int start, int end, unsigned int threads)
 {
     int i,j;             // counters
     PhotonVector3d min,max; // min/max vectors for finding range
     int DimToUse;        // which dimension has the greatest range
     int mid;             // index of median (middle)
-    int len;             // length of the array we're sorting
 
     if (end==start)
     {
@@ -1740,19 +1732,19 @@ void PhotonMap::sortAndSubdivide(int start, int end, int /*sorted*/)
 
     // loop and find greatest range
 
-    min = PhotonVector3d(1/EPSILON);  // TODO - should probably use  std::numeric_limits<PhotonScalar>::max() instead of  1/EPSILON
-    max = PhotonVector3d(-1/EPSILON); // TODO - should probably use -std::numeric_limits<PhotonScalar>::max() instead of -1/EPSILON
+    min = PhotonVector3d(std::numeric_limits<PhotonScalar>::max());
+    max = PhotonVector3d(-std::numeric_limits<PhotonScalar>::max());
 
     for(i=start; i<=end; i++)
     {
+        const Photon& ph = GetPhoton(i);
+
         for(j=X; j<=Z; j++)
         {
-            Photon *ph = &GetPhoton(i);
-
-            if (ph->Loc[j] < min[j])
-                min[j]=ph->Loc[j];
-            if (ph->Loc[j] > max[j])
-                max[j]=ph->Loc[j];
+            if (ph.Loc[j] < min[j])
+                min[j]=ph.Loc[j];
+            if (ph.Loc[j] > max[j])
+                max[j]=ph.Loc[j];
         }
     }
 
@@ -1766,26 +1758,55 @@ void PhotonMap::sortAndSubdivide(int start, int end, int /*sorted*/)
     // find midpoint
     mid = (end+start)>>1;
 
-    // use half of a quicksort to find the median
-    len = end-start;
-    if (len>=2)
+    // partition around the median
+    if (end-start >= 2)
     {
-        // only display status every so often
-        if(len > 1000)
-        {
-//          Send_ProgressUpdate(PROGRESS_SORTING_PHOTONS);
-        }
-
-        halfSortRec(start, end, DimToUse, mid);
-        //don't do this - but why? quickSortRec(start, end, DimToUse);
+        std::nth_element(PhotonMapIterator(this, start), PhotonMapIterator(this, mid), PhotonMapIterator(this, end + 1),
+                         [DimToUse](const Photon& a, const Photon& b) { return a.Loc[DimToUse] < b.Loc[DimToUse]; });
     }
+    else if (GetPhoton(start).Loc[DimToUse] > GetPhoton(end).Loc[DimToUse])
+        swapPhotons(start, end);
 
     // set DimToUse for the midpoint
     GetPhoton(mid).info = DimToUse;
 
     // now recurse to continue building the kd-tree
-    sortAndSubdivide(start, mid - 1, DimToUse);
-    sortAndSubdivide(mid + 1, end, DimToUse);
+    if ((threads > 1) && (end - start >= PHOTON_PARALLEL_BUILD_THRESHOLD))
+    {
+        unsigned int leftThreads = threads / 2;
+        std::exception_ptr leftException;
+
+        std::thread leftThread([&]()
+        {
+            try
+            {
+                sortAndSubdivide(start, mid - 1, leftThreads);
+            }
+            catch(...)
+            {
+                leftException = std::current_exception();
+            }
+        });
+
+        try
+        {
+            sortAndSubdivide(mid + 1, end, threads - leftThreads);
+        }
+        catch(...)
+        {
+            leftThread.join();
+            throw;
+        }
+
+        leftThread.join();
+        if (leftException)
+            std::rethrow_exception(leftException);
+    }
+    else
+    {
+        sortAndSubdivide(start, mid - 1, 1);
+        sortAndSubdivide(mid + 1, end, 1);
+    }
 }
 
 /*****************************************************************************
@@ -1798,16 +1819,99 @@ void PhotonMap::sortAndSubdivide(int start, int end, int /*sorted*/)
 
   Preconditions:
     photon memory initialized
-    'map' is a pointer to a photon map containing an array of unsorted
-         photons
+    'threads' is the maximum number of threads to use
 
   Postconditions:
     photons are in a valid kd-tree format
 ******************************************************************************/
-void PhotonMap::buildTree()
+void PhotonMap::buildTree(unsigned int threads)
 {
 //  Send_Progress("Sorting photons", PROGRESS_SORTING_PHOTONS);
-    sortAndSubdivide(0, numPhotons-1, X+Y+Z /* this is not X, Y, or Z */);
+    sortAndSubdivide(0, numPhotons-1, std::max(threads, 1u));
+    buildPositionArrays();
+}
+
+/*****************************************************************************
+
+  FUNCTION
+
+  buildPositionArrays
+
+  Copies the photon locations into separate arrays per dimension, so that
+  the gatherer can test the photons of small subtrees in bulk.
+
+  Preconditions:
+    photon memory initialized
+    photons are in a valid kd-tree format
+
+  Postconditions:
+    positionX, positionY and positionZ hold the photon locations
+******************************************************************************/
+void PhotonMap::buildPositionArrays()
+{
+    mPositions.resize(3 * size_t(numPhotons));
+
+    PhotonScalar *x = mPositions.data();
+    PhotonScalar *y = x + numPhotons;
+    PhotonScalar *z = y + numPhotons;
+
+    for (int i = 0; i < numPhotons; i++)
+    {
+        const Photon& ph = GetPhoton(i);
+        x[i] = ph.Loc[X];
+        y[i] = ph.Loc[Y];
+        z[i] = ph.Loc[Z];
+    }
+
+    positionX = x;
+    positionY = y;
+    positionZ = z;
+
+    updateMemory();
+}
+
+/*****************************************************************************
+
+  FUNCTION
+
+  mapPhotons
+
+  Uses photons and position arrays held in a memory-mapped file in place,
+  rather than copying them into blocks of their own.
+
+  Preconditions:
+    the photon map is empty
+    'photons' points to 'count' photons in valid kd-tree format, within
+        the memory mapped by 'storage'
+    'positions' points to the X, Y and Z position arrays of these photons,
+        one after the other, within the memory mapped by 'storage'
+
+  Postconditions:
+    the photon map uses the mapped photons, and keeps the file mapped
+    for as long as it exists
+******************************************************************************/
+void PhotonMap::mapPhotons(const std::shared_ptr<pov_base::Filesystem::MappedFile>& storage, const Photon *photons,
+                           const PhotonScalar *positions, int count)
+{
+    static_assert(sizeof(PhotonBlock) == PHOTON_BLOCK_SIZE * sizeof(Photon), "PhotonBlock must not be padded");
+
+    POV_PHOTONS_ASSERT((numPhotons == 0) && mBlockList.empty());
+
+    mpStorage = storage;
+
+    // The photons are never modified once the map has been built, so the read-only
+    // mapping may stand in for the (non-const) blocks.
+    Photon *data = const_cast<Photon *>(photons);
+    for (int i = 0; i < count; i += PHOTON_BLOCK_SIZE)
+        mBlockList.push_back(reinterpret_cast<PhotonBlock *>(data + i));
+
+    numPhotons = count;
+
+    positionX = positions;
+    positionY = positions + count;
+    positionZ = positions + 2 * size_t(count);
+
+    updateMemory();
 }
 
 /*****************************************************************************
@@ -2025,6 +2129,124 @@ const Photon& PhotonMap::GetPhoton(unsigned int blockId, unsigned int indexInBlo
 }
 
 
+/*****************************************************************************
+
+  FUNCTION
+
+  sumPhotons()
+
+  Adds up the flux of all photons within a sphere, rather than gathering the
+  nearest ones like PhotonGatherer does.  This is used by the progressive
+  photon mapping passes, where the number of photons within the radius is
+  not bounded.
+
+  Parameters:
+    pt        - center of the sphere
+    radiusSqr - squared radius of the sphere
+    direction - if not nullptr, photons arriving from the opposite
+                hemisphere are ignored
+    flux      - receives the sum of the photons' flux
+    count     - receives the number of photons found
+
+  Preconditions:
+    the kd-tree has been built
+
+******************************************************************************/
+
+void PhotonMap::sumPhotons(const Vector3d& pt, DBL radiusSqr, const Vector3d* direction, PreciseRGBColour& flux, int& count) const
+{
+    flux.Clear();
+    count = 0;
+    if (numPhotons > 0)
+        sumPhotonsRec(0, numPhotons - 1, pt, radiusSqr, sqrt(radiusSqr), direction, flux, count);
+}
+
+void PhotonMap::sumPhotonsRec(int start, int end, const Vector3d& pt, DBL radiusSqr, DBL radius, const Vector3d* direction,
+                              PreciseRGBColour& flux, int& count) const
+{
+    int mid = (end+start)>>1;
+    const Photon& photon = GetPhoton(mid);
+    int DimToUse = photon.info;
+
+    if ((Vector3d(photon.Loc) - pt).lengthSqr() < radiusSqr)
+    {
+        if ((direction == nullptr) || (dot(*direction, photon.GetDirection()) > 0.0))
+        {
+            flux += PreciseRGBColour(photon.colour);
+            count++;
+        }
+    }
+
+    if ((mid-1 >= start) && (pt[DimToUse] - radius < photon.Loc[DimToUse]))
+        sumPhotonsRec(start, mid - 1, pt, radiusSqr, radius, direction, flux, count);
+    if ((end >= mid+1) && (pt[DimToUse] + radius > photon.Loc[DimToUse]))
+        sumPhotonsRec(mid + 1, end, pt, radiusSqr, radius, direction, flux, count);
+}
+
+
+/*****************************************************************************
+
+  FUNCTION
+
+  findNearestPhoton()
+
+  Finds the photon closest to a point.  This is used to look up the
+  precomputed irradiance estimates, where a single photon stands for all the
+  photons around it.
+
+  Parameters:
+    pt     - point to search around
+    radius - maximum distance of the photon from the point
+
+  Returns:
+    the nearest photon, or nullptr if there is none within the radius
+
+  Preconditions:
+    the kd-tree has been built
+
+******************************************************************************/
+
+const Photon* PhotonMap::findNearestPhoton(const Vector3d& pt, DBL radius) const
+{
+    const Photon* nearest = nullptr;
+    DBL radiusSqr = Sqr(radius);
+    if (numPhotons > 0)
+        findNearestPhotonRec(0, numPhotons - 1, pt, radiusSqr, nearest);
+    return nearest;
+}
+
+void PhotonMap::findNearestPhotonRec(int start, int end, const Vector3d& pt, DBL& radiusSqr, const Photon*& nearest) const
+{
+    int mid = (end+start)>>1;
+    const Photon& photon = GetPhoton(mid);
+    int DimToUse = photon.info;
+    DBL d = pt[DimToUse] - photon.Loc[DimToUse];
+
+    DBL distSqr = (Vector3d(photon.Loc) - pt).lengthSqr();
+    if (distSqr < radiusSqr)
+    {
+        radiusSqr = distSqr;
+        nearest = &photon;
+    }
+
+    // search the half the point is in first, so that the radius shrinks as fast as possible
+    if (d < 0.0)
+    {
+        if (mid-1 >= start)
+            findNearestPhotonRec(start, mid - 1, pt, radiusSqr, nearest);
+        if ((end >= mid+1) && (Sqr(d) < radiusSqr))
+            findNearestPhotonRec(mid + 1, end, pt, radiusSqr, nearest);
+    }
+    else
+    {
+        if (end >= mid+1)
+            findNearestPhotonRec(mid + 1, end, pt, radiusSqr, nearest);
+        if ((mid-1 >= start) && (Sqr(d) < radiusSqr))
+            findNearestPhotonRec(start, mid - 1, pt, radiusSqr, nearest);
+    }
+}
+
+
 /**************************************************************
 
   =========== PRIORITY QUEUES ===============
@@ -2241,11 +2463,15 @@ void PhotonGatherer::gatherPhotonsRec(int start, int end)
 {
     DBL delta;
     int DimToUse;
-    DBL dSqr;
     int mid;
     Photon *photon;
-    Vector3d ptToPhoton;
-    DBL discFix;   // use disc(ellipsoid) for gathering instead of sphere
+
+    // small subtrees are contiguous, so test all of their photons at once
+    if (useLeafTest && (end - start < PHOTON_GATHER_LEAF_SIZE))
+    {
+        gatherPhotonsLeaf(start, end);
+        return;
+    }
 
     // find midpoint
     mid = (end+start)>>1;
@@ -2257,47 +2483,11 @@ void PhotonGatherer::gatherPhotonsRec(int start, int end)
 
     // find distance in DimToUse (largest of the photon's dimensions) from pt
     delta=(*pt_s)[DimToUse]-photon->Loc[DimToUse];
-    dSqr = Sqr(delta);
 
-    if (dSqr<dmax_s)
+    if (Sqr(delta)<dmax_s)
     {
         // it fits DimToUse distance - maybe we can use this photon
-
-        ptToPhoton = Vector3d(photon->Loc) - *pt_s;
-
-        // find euclidean distance (squared)
-        dSqr = ptToPhoton.lengthSqr();
-
-        // now fix this distance so that we gather using an ellipsoid
-        // aligned with the surface normal instead of a sphere.  This
-        // minimizes false bleeding of photons at sharp corners
-
-        // dmax_s is square of radius of major axis
-        // dmax_s/16 is  "   "   "     " minor  "    (1/6 of major axis)
-        /*
-        discFix = dot(*norm_s,ptToPhoton);
-        discFix*=discFix*(dmax_s/1000.0-dmax_s); // TODO FIXME - magic number
-        */
-
-        if (flattenFactor!=0.0)
-        {
-            discFix = dot(*norm_s,ptToPhoton);
-            discFix = fabs(discFix);
-            dSqr += flattenFactor*(discFix)*dSqr*16;
-        }
-        // this [the above? - CLi] will add zero if on the plane, and will double distance from
-        // point to photon if ptToPhoton is perpendicular to the surface
-
-        if(dSqr < dmax_s)
-        {
-            if (gatheredPhotons.numFound+1>TargetNum_s)
-            {
-                FullPQInsert(photon, dSqr);
-                sqrt_dmax_s = sqrt(dmax_s);
-            }
-            else
-                PQInsert(photon, dSqr);
-        }
+        gatherPhoton(photon);
     }
 
     // now go left & right if appropriate - if going left or right goes out
@@ -2346,6 +2536,128 @@ void PhotonGatherer::gatherPhotonsRec(int start, int end)
     }
 }
 
+/*****************************************************************************
+
+  FUNCTION
+
+  gatherPhoton()
+
+  Adds a single photon to the priority queue if it is within the current
+  search radius.
+
+  Preconditions:
+    same preconditions as gatherPhotonsRec
+
+  Postconditions:
+    the photon is added to the priority queue if it is close enough
+    (photons may be deleted from the queue to make room for it)
+
+******************************************************************************/
+
+void PhotonGatherer::gatherPhoton(Photon *photon)
+{
+    DBL dSqr;
+    Vector3d ptToPhoton;
+    DBL discFix;   // use disc(ellipsoid) for gathering instead of sphere
+
+    ptToPhoton = Vector3d(photon->Loc) - *pt_s;
+
+    // find euclidean distance (squared)
+    dSqr = ptToPhoton.lengthSqr();
+
+    // now fix this distance so that we gather using an ellipsoid
+    // aligned with the surface normal instead of a sphere.  This
+    // minimizes false bleeding of photons at sharp corners
+
+    // dmax_s is square of radius of major axis
+    // dmax_s/16 is  "   "   "     " minor  "    (1/6 of major axis)
+    /*
+    discFix = dot(*norm_s,ptToPhoton);
+    discFix*=discFix*(dmax_s/1000.0-dmax_s); // TODO FIXME - magic number
+    */
+
+    if (flattenFactor!=0.0)
+    {
+        discFix = dot(*norm_s,ptToPhoton);
+        discFix = fabs(discFix);
+        dSqr += flattenFactor*(discFix)*dSqr*16;
+    }
+    // this [the above? - CLi] will add zero if on the plane, and will double distance from
+    // point to photon if ptToPhoton is perpendicular to the surface
+
+    if(dSqr < dmax_s)
+    {
+        if (gatheredPhotons.numFound+1>TargetNum_s)
+        {
+            FullPQInsert(photon, dSqr);
+            sqrt_dmax_s = sqrt(dmax_s);
+        }
+        else
+            PQInsert(photon, dSqr);
+    }
+}
+
+/*****************************************************************************
+
+  FUNCTION
+
+  gatherPhotonsLeaf()
+
+  Tests all photons in the range start..end, which must be a subtree of at
+  most PHOTON_GATHER_LEAF_SIZE photons.
+
+  The squared distances are first computed in single precision from the
+  position arrays of the map, in a loop simple enough for the compiler to
+  vectorize.  Only photons that pass this test (with some slack to account
+  for rounding) are then checked exactly by gatherPhoton(), so the result
+  is the same as that of the recursive search.
+
+  Preconditions:
+    same preconditions as gatherPhotonsRec
+    the position arrays of the map are valid
+
+  Postconditions:
+    photons within the range of start..end are added to the priority
+    queue (photons may be deleted from the queue to make room for photons
+    of lower priority)
+
+******************************************************************************/
+
+void PhotonGatherer::gatherPhotonsLeaf(int start, int end)
+{
+    PhotonScalar dSqr[PHOTON_GATHER_LEAF_SIZE];
+    const PhotonScalar* posX = map->positionX + start;
+    const PhotonScalar* posY = map->positionY + start;
+    const PhotonScalar* posZ = map->positionZ + start;
+    const PhotonScalar ptX = PhotonScalar((*pt_s)[X]);
+    const PhotonScalar ptY = PhotonScalar((*pt_s)[Y]);
+    const PhotonScalar ptZ = PhotonScalar((*pt_s)[Z]);
+    int count = end - start + 1;
+
+    POV_PHOTONS_ASSERT(count <= PHOTON_GATHER_LEAF_SIZE);
+
+    for (int i = 0; i < count; i++)
+    {
+        PhotonScalar dx = posX[i] - ptX;
+        PhotonScalar dy = posY[i] - ptY;
+        PhotonScalar dz = posZ[i] - ptZ;
+        dSqr[i] = dx * dx + dy * dy + dz * dz;
+    }
+
+    // The flattening applied by gatherPhoton() can only increase the distance, so testing
+    // against the unflattened distance is conservative. The slack covers the rounding
+    // error of the single precision differences.
+    DBL scale = max3(fabs((*pt_s)[X]), fabs((*pt_s)[Y]), fabs((*pt_s)[Z])) + sqrt_dmax_s;
+    DBL slack = 8.0 * std::numeric_limits<PhotonScalar>::epsilon() * scale;
+
+    for (int i = 0; i < count; i++)
+    {
+        // the radius may have shrunk in the meantime
+        if (dSqr[i] < Sqr(sqrt_dmax_s + slack))
+            gatherPhoton(&map->GetPhoton(start + i));
+    }
+}
+
 /*****************************************************************************
 
   FUNCTION
@@ -2396,6 +2708,7 @@ int PhotonGatherer::gatherPhotons(const Vector3d* pt, DBL Size, DBL *r, const Ve
     Size_s = Size;
     TargetNum_s = photonSettings.maxGatherCount;
     pt_s = pt;
+    useLeafTest = map->hasPositionArrays();
 
     // now search the kd-tree recursively
     gatherPhotonsRec(0, map->numPhotons-1);
@@ -2416,6 +2729,7 @@ int PhotonGatherer::gatherPhotons(const Vector3d* pt, DBL Size, DBL *r, const Ve
 PhotonGatherer::PhotonGatherer(PhotonMap *map, ScenePhotonSettings& photonSettings): map(map),photonSettings(photonSettings),gatheredPhotons(photonSettings.maxGatherCount)
 {
     gathered = false;
+    useLeafTest = false;
 }
 
 DBL PhotonGatherer::gatherPhotonsAdaptive(const Vector3d* pt, const Vector3d* norm, bool flatten)
@@ -2505,6 +2819,59 @@ DBL PhotonGatherer::gatherPhotonsAdaptive(const Vector3d* pt, const Vector3d* no
     return radius;
 }
 
+/*****************************************************************************
+
+  FUNCTION
+
+  estimateIrradiance()
+
+  Gathers the photons around a point and condenses them into a single photon
+  carrying their irradiance, as used by the precomputed irradiance estimates.
+  The estimate's colour is the gathered flux divided by the area (or, for
+  media photons, the volume) it was gathered from, and its direction is the
+  flux-weighted average of the photons' directions.
+
+  For surface photons, only photons arriving from the same side of the surface
+  as the estimate's own photon are counted.
+
+  Parameters:
+    pt        - point to estimate the irradiance at
+    mediaMap  - whether the map holds media photons
+    estimate  - receives the estimate; its direction must be set on entry for
+                surface photons, and its location and kd-tree info are left
+                untouched
+
+******************************************************************************/
+
+void PhotonGatherer::estimateIrradiance(const Vector3d& pt, bool mediaMap, Photon& estimate)
+{
+    Vector3d ownDirection = estimate.GetDirection();
+    Vector3d direction(0.0);
+    PreciseRGBColour flux;
+
+    DBL r = gatherPhotonsAdaptive(&pt, nullptr, false);
+
+    for (int j = 0; j < gatheredPhotons.numFound; j++)
+    {
+        const Photon& photon = *gatheredPhotons.photonGatherList[j];
+        Vector3d photonDirection = photon.GetDirection();
+        if (!mediaMap && (dot(ownDirection, photonDirection) <= 0.0))
+            continue;
+        PreciseRGBColour photonFlux(photon.colour);
+        flux += photonFlux;
+        direction += photonDirection * DBL(photonFlux.Greyscale());
+    }
+
+    if (mediaMap)
+        flux *= 3.0 / (M_PI * r*r*r * 4.0);
+    else
+        flux /= M_PI * r*r;
+
+    estimate.colour = PhotonColour(RGBColour(flux));
+    if (direction.lengthSqr() > 0.0)
+        estimate.SetDirection(direction.normalized());
+}
+
 /******************************************************************
 stuff grabbed from radiosit.h & radiosit.c
 ******************************************************************/
@@ -2692,5 +3059,33 @@ void LightTargetCombo::computeAnglesAndDeltas(std::shared_ptr<SceneData> sceneDa
     }
 }
 
+int LightTargetCombo::numThetaSteps() const
+{
+    if ((photonSpread <= 0.0) || (dtheta <= 0.0) || (maxtheta <= mintheta))
+        return 0;
+
+    return int(ceil((maxtheta - mintheta) / dtheta));
+}
+
+// Estimate the number of directions shot in a theta step; this mirrors the phi step
+// computation in PhotonShootingTask::ShootPhotonsAtObject().
+DBL LightTargetCombo::estimatePhotonsInStep(int step) const
+{
+    DBL theta = mintheta + step * dtheta;
+
+    if (theta < EPSILON)
+        return 1.0;
+    else if (light->Parallel)
+        return 2.0 * M_PI * theta / dtheta;
+    else
+        return 2.0 * M_PI * sin(theta) / dtheta;
+}
+
+void LightTargetCombo::stopAtStep(int step)
+{
+    int current = stopStep.load();
+    while ((step < current) && !stopStep.compare_exchange_weak(current, step)) { }
+}
+
 }
 // end of namespace pov
@@ -44,12 +44,15 @@
 //  (none at the moment)
 
 // C++ standard header files
+#include <atomic>
+#include <limits>
 #include <memory>
 #include <string>
 #include <vector>
 
 // POV-Ray header files (base module)
-//  (none at the moment)
+#include "base/filesystem_fwd.h"
+#include "base/pov_mem.h"
 
 // POV-Ray header files (core module)
 #include "core/material/media.h"
@@ -99,6 +102,21 @@ class ScenePhotonSettings final
             // save is indicated by a non-empty fileName with loadFile set to false.
             loadFile = false;
 
+            // distributed shooting is disabled by default
+            slice = 1;
+            sliceCount = 1;
+            mergeSliceCount = 0;
+
+            // progressive photon mapping is disabled by default
+            progressivePasses = 1;
+            progressiveAlpha = 0.7;
+
+            // visual importance is disabled by default
+            importance = 1.0;
+
+            // irradiance precomputation is disabled by default
+            precomputeStride = 0;
+
             #ifdef GLOBAL_PHOTONS
             // ---------- global photon map ----------
             int globalCount = 0;  // disabled by default
@@ -142,6 +160,32 @@ class ScenePhotonSettings final
         std::string fileName;
         bool loadFile;
 
+        // these are used for distributed shooting (set from the render options, not the scene);
+        // with sliceCount > 1, only slice 'slice' (1-based) of the work units is shot and saved
+        // to fileName plus ".<slice>"; with mergeSliceCount > 0, that many such files are loaded,
+        // merged and saved to fileName instead of shooting any photons.
+        int slice;
+        int sliceCount;
+        int mergeSliceCount;
+
+        // these are used for progressive photon mapping; with progressivePasses > 1, the photons
+        // are shot that many times, and each pass refines the surface photons of the first one
+        // (see PhotonSortingTask::refinePass()), with progressiveAlpha controlling how fast the
+        // gather radii shrink.
+        int progressivePasses;
+        DBL progressiveAlpha;
+
+        // this is used for visual-importance-guided shooting; with importance < 1, a coarse pass of
+        // camera rays marks the regions seen in the image, and photons whose neighbours did not land
+        // in any such region are shot only with this probability (and correspondingly more power).
+        DBL importance;
+
+        // this is used for precomputed irradiance estimates; with precomputeStride > 0, the irradiance
+        // is estimated at every precomputeStride-th photon once the maps are built (see
+        // PhotonSortingTask::precomputeIrradiance()), and radiosity and media photon lookups take the
+        // nearest such estimate instead of gathering the photons themselves.
+        int precomputeStride;
+
         #ifdef GLOBAL_PHOTONS
         // ---------- global photon map ----------
         int globalPhotonsToShoot;      // number of global photons to shoot
@@ -176,6 +220,9 @@ struct Photon final
     PhotonColour colour;    /* color & intensity (flux) */
     unsigned char info;     /* info byte for kd-tree */
     signed char theta, phi; /* incoming direction */
+
+    Vector3d GetDirection() const;
+    void SetDirection(const Vector3d& direction);
 };
 
 /* ------------------------------------------------------ */
@@ -189,6 +236,16 @@ class PhotonMap final
 
         class PhotonBlock;
 
+        /// Memory-mapped photon map file holding the photons and positions, if any.
+        std::shared_ptr<pov_base::Filesystem::MappedFile> mpStorage;
+        /// Storage for the position arrays, unless memory-mapped.
+        std::vector<PhotonScalar> mPositions;
+        /// Memory accounted for the photon blocks and position arrays.
+        pov_base::MemoryAccount mMemory;
+
+        /// Report the memory currently held by the map to the memory accounting.
+        void updateMemory();
+
     public:
 
         std::vector<PhotonBlock*> mBlockList;
@@ -199,21 +256,31 @@ class PhotonMap final
         DBL gatherRadStep;      /* step size for gather expansion */
         int gatherNumSteps;     /* maximum times to perform 'gather' */
 
+        /// Photon locations in structure-of-arrays form, indexed like the photons.
+        /// These are `nullptr` until @ref buildTree(), @ref buildPositionArrays() or @ref mapPhotons() has been called.
+        const PhotonScalar *positionX, *positionY, *positionZ;
+
         PhotonMap();
         ~PhotonMap();
 
         void swapPhotons(int a, int b);
-        void insertSort(int start, int end, int d);
-        void quickSortRec(int left, int right, int d);
-        void halfSortRec(int left, int right, int d, int mid);
-        void sortAndSubdivide(int start, int end, int /*sorted*/);
-        void buildTree();
+        void sortAndSubdivide(int start, int end, unsigned int threads);
+        void buildTree(unsigned int threads = 1);
+        void buildPositionArrays();
+        bool hasPositionArrays() const { return (positionX != nullptr); }
+        void mapPhotons(const std::shared_ptr<pov_base::Filesystem::MappedFile>& storage, const Photon *photons,
+                        const PhotonScalar *positions, int count);
+        bool isMapped() const { return (mpStorage != nullptr); }
 
         void setGatherOptions(ScenePhotonSettings& photonSettings, bool mediaMap);
 
         Photon* AllocatePhoton();
 
         void mergeMap(PhotonMap* map);
+        void clear();
+
+        void sumPhotons(const Vector3d& pt, DBL radiusSqr, const Vector3d* direction, PreciseRGBColour& flux, int& count) const;
+        const Photon* findNearestPhoton(const Vector3d& pt, DBL radius) const;
 
         Photon& GetPhoton(unsigned int photonId);
         const Photon& GetPhoton(unsigned int photonId) const;
@@ -257,6 +324,10 @@ class PhotonMap final
 
         Photon& GetPhoton(unsigned int blockId, unsigned int indexInBlock);
         const Photon& GetPhoton(unsigned int blockId, unsigned int indexInBlock) const;
+
+        void sumPhotonsRec(int start, int end, const Vector3d& pt, DBL radiusSqr, DBL radius, const Vector3d* direction,
+                           PreciseRGBColour& flux, int& count) const;
+        void findNearestPhotonRec(int start, int end, const Vector3d& pt, DBL& radiusSqr, const Photon*& nearest) const;
 };
 
 
@@ -297,14 +368,18 @@ class PhotonGatherer final
                            // zero = no flatten, one = regular
         bool gathered;
         DBL alreadyGatheredRadius;
+        bool useLeafTest; // whether the map provides position arrays for gatherPhotonsLeaf()
 
         GatheredPhotons gatheredPhotons;
 
         PhotonGatherer(PhotonMap *map, ScenePhotonSettings& photonSettings);
 
         void gatherPhotonsRec(int start, int end);
+        void gatherPhotonsLeaf(int start, int end);
+        void gatherPhoton(Photon *photon);
         int gatherPhotons(const Vector3d* pt, DBL Size, DBL *r, const Vector3d* norm, bool flatten);
         DBL gatherPhotonsAdaptive(const Vector3d* pt, const Vector3d* norm, bool flatten);
+        void estimateIrradiance(const Vector3d& pt, bool mediaMap, Photon& estimate);
 
         void PQInsert(Photon *photon, DBL d);
         void FullPQInsert(Photon *photon, DBL d);
@@ -366,7 +441,8 @@ class ShootingDirection final
 class LightTargetCombo final
 {
     public:
-        LightTargetCombo(LightSource *light, ObjectPtr target):light(light),target(target),shootingDirection(light,target) {}
+        LightTargetCombo(LightSource *light, ObjectPtr target):light(light),target(target),mintheta(0),maxtheta(0),dtheta(0),photonSpread(0),
+                                                               shootingDirection(light,target),hitAtLeastOnce(false),stopStep(std::numeric_limits<int>::max()) {}
         LightSource *light;
         ObjectPtr target;
         int estimate;
@@ -376,16 +452,27 @@ class LightTargetCombo final
         DBL photonSpread;
         ShootingDirection shootingDirection;
 
+        // autostop state, shared by all threads shooting at this combo
+        std::atomic<bool> hitAtLeastOnce;   // whether the target has been hit at all
+        std::atomic<int> stopStep;          // theta step at which shooting has been stopped
+
         int computeMergedFlags();
         void computeAnglesAndDeltas(std::shared_ptr<SceneData> sceneData);
+        int numThetaSteps() const;
+        DBL estimatePhotonsInStep(int step) const;
+        void stopAtStep(int step);
 };
 
 
+/// Range of theta steps of a light/target combo, to be shot by a single thread.
 class PhotonShootingUnit final
 {
     public:
-        PhotonShootingUnit(LightSource* light, ObjectPtr target):lightAndObject(light,target) {}
-        LightTargetCombo lightAndObject;
+        PhotonShootingUnit(LightTargetCombo* combo, int firstStep, int endStep, size_t index):lightAndObject(combo),firstStep(firstStep),endStep(endStep),index(index) {}
+        LightTargetCombo *lightAndObject;
+        int firstStep;  // first theta step
+        int endStep;    // theta step following the last one
+        size_t index;   // position in the sequence of all units (seeds the jitter)
 };
 
 
@@ -68,14 +68,20 @@
 
 // C++ standard header files
 #include <algorithm>
+#include <chrono>
+#include <map>
 
 // POV-Ray header files (base module)
 #include "base/fileinputoutput.h"
+#include "base/filesystem.h"
+#include "base/path.h"
+#include "base/pov_mem.h"
 #include "base/povassert.h"
 
 // POV-Ray header files (core module)
 #include "core/lighting/photons.h"
 #include "core/render/ray.h"
+#include "core/scene/object.h"
 #include "core/scene/scenedata.h"
 #include "core/scene/tracethreaddata.h"
 #include "core/support/octree.h"
@@ -92,13 +98,19 @@ using namespace pov_base;
 using std::min;
 using std::max;
 
-// #define RAD_GRADIENT 1 // [CLi] gradient seems to provide no gain at best, and may actually cause artifacts
+#define RAD_GRADIENT_MIN_COS 0.1 // limits the weight of grazing sample rays in the rotational gradient
+#define RAD_ADAPTIVE_MIN_RAYS 16 // minimum number of rays to shoot per sample before adaptive sampling may stop
+#define RAD_ADAPTIVE_MIN_BATCH 8 // minimum number of rays to shoot between adaptive sampling convergence tests
 // #define SAW_METHOD 1
 // #define SAW_METHOD_ROOT 2
 // #define SIGMOID_METHOD 1
 #define PSEUDO_SIGMOID_METHOD 1
 #define IN_FRONT_LIMIT (-0.05)
 
+/// Maximum time the autosave writer sleeps before checking for queued pools, in milliseconds.
+/// Render threads wake it whenever they queue a pool, but may occasionally miss it going to sleep.
+const unsigned int AUTOSAVE_POLL_INTERVAL = 50;
+
 // #define SHOW_SAMPLE_SPOTS 1 // try this!  bright spots at sample pts
 // #define LOW_COUNT_BRIGHT 1  // this will highlight areas of low density if no extra samples are taken in the final pass
 
@@ -306,6 +318,8 @@ RadiosityFunction::RadiosityFunction(std::shared_ptr<SceneData> sd, TraceThreadD
     cameraPosition(camera),
     pretraceStep(PRETRACE_INVALID),
     recursionParameters(new RecursionParameters[rs.recursionLimit]),
+    rayCountStatsId(Radiosity_RayCount_Final),
+    raysSavedStatsId(Radiosity_RaysSaved_Final),
     topLevelQueryCount(0),
     topLevelReuse(0.0),
     tileId(0),
@@ -321,7 +335,7 @@ RadiosityFunction::~RadiosityFunction()
 {
     if (cacheBlockPool != nullptr) // shouldn't happen normally, but does happen when render is aborted
     {
-        radiosityCache.ReleaseBlockPool(cacheBlockPool);
+        radiosityCache.ReleaseBlockPool(cacheBlockPool, &(threadData->Stats()));
         cacheBlockPool = nullptr;
     }
 
@@ -351,6 +365,8 @@ void RadiosityFunction::BeforeTile(int id, unsigned int pts)
     // different pretrace step than last tile
     if (pts != pretraceStep)
     {
+        rayCountStatsId  = (isFinalTrace ? Radiosity_RayCount_Final  : (IntStatsIndex)(Radiosity_RayCount_PTS1  + min(4u,pts-PRETRACE_FIRST)));
+        raysSavedStatsId = (isFinalTrace ? Radiosity_RaysSaved_Final : (IntStatsIndex)(Radiosity_RaysSaved_PTS1 + min(4u,pts-PRETRACE_FIRST)));
         // Recursion Level 0
         recursionParameters[0].statsId              = (isFinalTrace ? Radiosity_SamplesTaken_Final_R0 : (IntStatsIndex)(Radiosity_SamplesTaken_PTS1_R0 + min(4u,pts-PRETRACE_FIRST)*5));
         recursionParameters[0].queryCountStatsId    = Radiosity_QueryCount_R0;
@@ -369,16 +385,16 @@ void RadiosityFunction::BeforeTile(int id, unsigned int pts)
 
     // next tile, so we start the sample direction pattern all over again
     for (unsigned int depth = 0; depth < settings.recursionLimit; depth ++)
-        recursionParameters[depth].directionGenerator.Reset(settings.directionPoolSize);
+        recursionParameters[depth].directionGenerator.Reset(settings.directionPoolSize, recursionSettings[depth].raysPerSample, settings.jitter);
 
     POV_RADIOSITY_ASSERT(cacheBlockPool == nullptr);
-    cacheBlockPool = radiosityCache.AcquireBlockPool();
+    cacheBlockPool = radiosityCache.AcquireBlockPool(&(threadData->Stats()));
 }
 
 void RadiosityFunction::AfterTile()
 {
     // release block pool, just in case this happens to be the last tile for this thread
-    radiosityCache.ReleaseBlockPool(cacheBlockPool);
+    radiosityCache.ReleaseBlockPool(cacheBlockPool, &(threadData->Stats()));
     cacheBlockPool = nullptr;
 }
 
@@ -399,7 +415,10 @@ void RadiosityFunction::ComputeAmbient(const Vector3d& ipoint, const Vector3d& r
     if(weight < WEIGHT_ERROR_BOUND_OFFSET)
         temp_error_bound += (WEIGHT_ERROR_BOUND_OFFSET - weight);
 
-    reuse = radiosityCache.FindReusableBlock(threadData->Stats(), temp_error_bound * recSettings.errorBoundFactor, ipoint, effectiveNormal, tmpBrilliance, ambient_colour, ticket.radiosityRecursionDepth, pretraceStep, tileId);
+    // during the pretrace, the samples just taken by this thread for the current tile are checked first,
+    // and the octree lookup is skipped if they alone already meet the criterion for re-use tested below
+    reuse = radiosityCache.FindReusableBlock(threadData->Stats(), temp_error_bound * recSettings.errorBoundFactor, ipoint, effectiveNormal, tmpBrilliance, ambient_colour, ticket.radiosityRecursionDepth, pretraceStep, tileId,
+                                             (isFinalTrace ? nullptr : cacheBlockPool), recSettings.reuseCount / 4.0);
 
     if (ticket.radiosityRecursionDepth == 0)
     {
@@ -512,11 +531,10 @@ double RadiosityFunction::GatherLight(const Vector3d& ipoint, const Vector3d& ra
 
     Vector3d direction, up, min_dist_vec;
     int save_Max_Trace_Level;
-    MathColour dxs, dys, dzs;
+    MathColour dxs, dys, dzs, rxs, rys, rzs;
     MathColour colour_sums, temp_colour;
     DBL inverse_distance_sum, mean_dist,
-        smallest_dist,
-        sum_of_inverse_dist, sum_of_dist, gradient_count;
+        smallest_dist;
     DBL save_adc_bailout;
     DBL save_radiosityQuality;
     unsigned int save_trace_level;
@@ -551,22 +569,44 @@ double RadiosityFunction::GatherLight(const Vector3d& ipoint, const Vector3d& ra
 
     DBL weight = max(ticket.adcBailout + EPSILON, recSettings.weight);
 
-    // Initialized the accumulators for the integrals which will be come the rad gradient
-    sum_of_inverse_dist = sum_of_dist = gradient_count = 0.0;
-
     unsigned int okCount = 0;
     unsigned int okCountRaw = 0;
     bool use_raw_normal = similar(raw_normal, layer_normal); // if the normal isn't pertubed, go for the raw normal right away because it makes life easier
     double qualitySum = 0.0;
-    param.directionGenerator.InitSequence(cur_sample_count, raw_normal, layer_normal, use_raw_normal, brilliance);
+    param.directionGenerator.InitSequence(cur_sample_count, raw_normal, layer_normal, use_raw_normal, brilliance, ipoint);
+
+    // Adaptive sampling: Shoot the rays in batches, and after each batch estimate the standard error of the
+    // illuminance from the spread of the individual rays' contributions; stop as soon as it is within the
+    // allowed fraction of the illuminance. As any leading subset of the sample directions is well distributed
+    // over the hemisphere, stopping early still gives an evenly sampled (if noisier) result.
+    // The tolerance is relaxed with recursion depth just like the error bound.
+    DBL adaptiveTolerance = settings.adaptive * recSettings.errorBoundFactor;
+    unsigned int adaptiveBatch = max(RAD_ADAPTIVE_MIN_BATCH, (int)cur_sample_count / 8);
+    unsigned int adaptiveMinRays = max(RAD_ADAPTIVE_MIN_RAYS, (int)cur_sample_count / 4);
+    unsigned int adaptiveCount = 0;
+    DBL adaptiveSum = 0.0;
+    DBL adaptiveSumSqr = 0.0;
+    unsigned int raysSaved = 0;
+
     for(unsigned int i = 0, hit = 0; i < cur_sample_count; i++)
     {
+        if ((adaptiveTolerance > 0.0) && (i >= adaptiveMinRays) && ((i - adaptiveMinRays) % adaptiveBatch == 0) && (adaptiveCount > 1))
+        {
+            DBL mean = adaptiveSum / adaptiveCount;
+            DBL variance = max(0.0, (adaptiveSumSqr - adaptiveSum * mean) / (adaptiveCount - 1));
+            if (variance <= Sqr(adaptiveTolerance * mean) * adaptiveCount)
+            {
+                raysSaved = cur_sample_count - i;
+                break;
+            }
+        }
+
         bool ray_ok = param.directionGenerator.GetDirection(direction);
         if (!ray_ok && !use_raw_normal)
         {
             // out of good sample directions, but we may still re-try with the raw normal
             use_raw_normal = true;
-            param.directionGenerator.InitSequence(cur_sample_count, raw_normal, layer_normal, use_raw_normal, brilliance);
+            param.directionGenerator.InitSequence(cur_sample_count, raw_normal, layer_normal, use_raw_normal, brilliance, ipoint);
             ray_ok = param.directionGenerator.GetDirection(direction);
         }
         if (!ray_ok)
@@ -613,22 +653,41 @@ double RadiosityFunction::GatherLight(const Vector3d& ipoint, const Vector3d& ra
             qualitySum += quality;
             temp_colour *= quality;
 
-#ifdef RAD_GRADIENT
-            // Add into illumination gradient integrals
-            double deemed_depth = depth;
-            if(deemed_depth < maximum_distance * 10.0)
+            if (adaptiveTolerance > 0.0)
             {
-                DBL depth_weight_for_this_gradient = 1.0 / deemed_depth;
-
-                sum_of_inverse_dist += 1.0 / deemed_depth;
-                sum_of_dist += deemed_depth;
-                gradient_count++;
+                DBL grey = temp_colour.WeightGreyscale();
+                adaptiveCount ++;
+                adaptiveSum += grey;
+                adaptiveSumSqr += Sqr(grey);
+            }
 
-                dxs += (temp_colour * depth_weight_for_this_gradient * direction[X] * fabs(direction[X]));
-                dys += (temp_colour * depth_weight_for_this_gradient * direction[Y] * fabs(direction[Y]));
-                dzs += (temp_colour * depth_weight_for_this_gradient * direction[Z] * fabs(direction[Z]));
+            if (settings.gradient)
+            {
+                // Add into illumination gradient integrals, after Ward & Heckbert, "Irradiance Gradients";
+                // as our sample directions are not stratified in a regular theta/phi grid, we use the
+                // equivalent Monte Carlo estimators for a cosine-weighted sample distribution instead.
+                const Vector3d& sample_normal = (use_raw_normal ? raw_normal : layer_normal);
+                DBL cos_theta = max(dot(direction, sample_normal), RAD_GRADIENT_MIN_COS);
+
+                // Rotational gradient: change in irradiance as the normal tilts towards each sample,
+                // i.e. the radiance weighted by tan(theta) in the direction perpendicular to the sample.
+                Vector3d rotation = cross(sample_normal, direction) / cos_theta;
+                rxs += temp_colour * rotation[X];
+                rys += temp_colour * rotation[Y];
+                rzs += temp_colour * rotation[Z];
+
+                // Translational gradient: change in irradiance as the point moves towards each sample,
+                // treating the surface hit as a patch facing the point (occlusion changes are ignored);
+                // distant samples contribute little, and the sky nothing at all.
+                if (depth < HUGE_VAL)
+                {
+                    Vector3d tangent = direction - sample_normal * dot(direction, sample_normal);
+                    tangent *= 3.0 / max(depth, reuse_dist_min);
+                    dxs += temp_colour * tangent[X];
+                    dys += temp_colour * tangent[Y];
+                    dzs += temp_colour * tangent[Z];
+                }
             }
-#endif
 
             // Add into total illumination integral
             colour_sums += temp_colour;
@@ -654,10 +713,19 @@ double RadiosityFunction::GatherLight(const Vector3d& ipoint, const Vector3d& ra
     } // end ray sampling loop
 
     threadData->Stats()[Radiosity_RayCount] += okCount;
+    threadData->Stats()[Radiosity_RaysSaved] += raysSaved;
+    threadData->Stats()[rayCountStatsId] += okCount;
+    threadData->Stats()[raysSavedStatsId] += raysSaved;
     if (ticket.radiosityRecursionDepth == 0)
+    {
         threadData->Stats()[Radiosity_TopLevel_RayCount] += okCount;
+        threadData->Stats()[Radiosity_TopLevel_RaysSaved] += raysSaved;
+    }
     if (isFinalTrace)
+    {
         threadData->Stats()[Radiosity_Final_RayCount] += okCount;
+        threadData->Stats()[Radiosity_Final_RaysSaved] += raysSaved;
+    }
 
     // Use the accumulated values to calculate the averages needed. The sphere
     // of influence of this primary-method sample point is based on the
@@ -699,24 +767,31 @@ double RadiosityFunction::GatherLight(const Vector3d& ipoint, const Vector3d& ra
         ot_blockcount++; // TODO FIXME - I guess this is duplicate
 #endif
 
-#ifdef RAD_GRADIENT
-        // beta
-        // TODO FIXME - this has gradient kick in abruptly
-        if(gradient_count > 10)
+        if (settings.gradient && (qualitySum > 0))
         {
-            DBL constant_term = gradient_count / (sum_of_inverse_dist * sum_of_dist); // TODO - check validity of this change [trf]
+            dxs /= qualitySum; dys /= qualitySum; dzs /= qualitySum;
+            rxs /= qualitySum; rys /= qualitySum; rzs /= qualitySum;
 
-            dxs *= constant_term;
-            dys *= constant_term;
-            dzs *= constant_term;
-        }
-        else
-        {
-            dxs = 0;
-            dys = 0;
-            dzs = 0;
+            // Limit the gradients so that extrapolation across the sample's sphere of influence
+            // (or a full radian of rotation) cannot change any channel by more than its own value;
+            // this keeps noisy gradient estimates from a low sample count from causing artifacts.
+            for (int i = 0; i < MathColour::channels; i++)
+            {
+                DBL limit = fabs(illuminance[i]);
+                DBL translation = sqrt(Sqr(dxs[i]) + Sqr(dys[i]) + Sqr(dzs[i])) * mean_dist;
+                if (translation > limit)
+                {
+                    DBL scale = limit / translation;
+                    dxs[i] *= scale; dys[i] *= scale; dzs[i] *= scale;
+                }
+                DBL rotation = sqrt(Sqr(rxs[i]) + Sqr(rys[i]) + Sqr(rzs[i]));
+                if (rotation > limit)
+                {
+                    DBL scale = limit / rotation;
+                    rxs[i] *= scale; rys[i] *= scale; rzs[i] *= scale;
+                }
+            }
         }
-#endif
 
         // After end of ray loop, we've decided that this point is worth storing
         // Allocate a block, and fill it with values for reuse in cacheing later
@@ -725,7 +800,7 @@ double RadiosityFunction::GatherLight(const Vector3d& ipoint, const Vector3d& ra
         unsigned int okCountNonRaw = okCount - okCountRaw;
         bool fileUnderRawNormal = (okCountRaw > okCountNonRaw);
         radiosityCache.AddBlock(cacheBlockPool, &(threadData->Stats()), ipoint, (fileUnderRawNormal ? raw_normal : layer_normal), brilliance, min_dist_vec,
-                                dxs, dys, dzs, illuminance, mean_dist, smallest_dist, qualitySum/okCount,
+                                dxs, dys, dzs, rxs, rys, rzs, illuminance, mean_dist, smallest_dist, qualitySum/okCount,
                                 ticket.radiosityRecursionDepth, pretraceStep, tileId);
     }
     else
@@ -755,23 +830,95 @@ double RadiosityFunction::GatherLight(const Vector3d& ipoint, const Vector3d& ra
 *
 ******************************************************************************/
 
+/// Stratified set of cosine-weighted sampling directions.
+///
+/// The directions are the first points of the Halton sequence in bases 2 and 3, mapped to the hemisphere
+/// around the Y axis, so that any leading subset of them is well distributed as well; this matters because
+/// rays may be skipped towards the end of the set based on importance. The co-ordinates are stored as
+/// separate arrays for cache efficiency.
+///
+struct RadiosityFunction::SampleDirectionGenerator::DirectionTable final
+{
+    std::vector<float> x, y, z;
+
+    DirectionTable(unsigned int count) : x(count), y(count), z(count)
+    {
+        for (unsigned int i = 0; i < count; i++)
+        {
+            DBL u = 0.0, v = 0.0;
+            DBL f = 0.5;
+            for (unsigned int n = i + 1; n > 0; n /= 2, f *= 0.5)
+                u += f * (n % 2);
+            f = 1.0 / 3.0;
+            for (unsigned int n = i + 1; n > 0; n /= 3, f /= 3.0)
+                v += f * (n % 3);
+            DBL r = sqrt(u);
+            x[i] = float(r * cos(TWO_M_PI * v));
+            y[i] = float(sqrt(1.0 - u));
+            z[i] = float(r * sin(TWO_M_PI * v));
+        }
+    }
+
+    /// Get the (shared) table for a given number of directions.
+    static std::shared_ptr<const DirectionTable> Get(unsigned int count)
+    {
+        static std::mutex mutex;
+        static std::map<unsigned int, std::weak_ptr<const DirectionTable>> tables;
+        std::lock_guard<std::mutex> lock(mutex);
+        std::shared_ptr<const DirectionTable> table = tables[count].lock();
+        if (!table)
+        {
+            table = std::make_shared<const DirectionTable>(count);
+            tables[count] = table;
+        }
+        return table;
+    }
+};
+
 RadiosityFunction::SampleDirectionGenerator::SampleDirectionGenerator() :
     rawNormalMode(false),
     rawNormal(0,1,0),
     frameX(1,0,0),
     frameY(0,1,0),
-    frameZ(0,0,1)
+    frameZ(0,0,1),
+    tableIndex(0),
+    rotation(0.0)
 {}
 
-void RadiosityFunction::SampleDirectionGenerator::Reset(unsigned int samplePoolCount)
+void RadiosityFunction::SampleDirectionGenerator::Reset(unsigned int samplePoolCount, unsigned int sampleCount, bool jitter)
 {
-    if (!sampleDirections)
+    if (jitter)
+    {
+        if (!directionTable || (directionTable->x.size() != sampleCount))
+            directionTable = DirectionTable::Get(max(sampleCount, 1u));
+    }
+    else if (!sampleDirections)
         sampleDirections = GetSubRandomCosWeightedDirectionGenerator(0, samplePoolCount);
 }
 
-void RadiosityFunction::SampleDirectionGenerator::InitSequence(unsigned int& sample_count, const Vector3d& raw_normal, const Vector3d& layer_normal, bool use_raw_normal, DBL br)
+void RadiosityFunction::SampleDirectionGenerator::SetFrame(DBL angle)
 {
-    size_t sequenceSize = sampleDirections->CycleLength();
+    // we choose "frameX" and "frameZ" as follows:
+    // - "frameX" to be perpendicular to layer_normal and Z axis
+    // - "frameZ" to be perpendicular to layer_normal and "frameX"
+    // in case layer_normal and Z axis are uncomfortably close, we fallback to the following choice:
+    // - "frameX" to be perpendicular to layer_normal and Y axis
+    // - "frameZ" to be perpendicular to layer_normal and "frameX"
+    // and then rotate both about "frameY" by the given angle
+    Vector3d offY;
+    if(fabs(frameY[Z]) > 0.9)
+        offY = Vector3d(0,1,0); // too close to "Z" for comfort
+    else
+        offY = Vector3d(0,0,1);
+    frameX = cross(frameY, offY).normalized();
+    if (angle != 0.0)
+        frameX = (frameX * cos(angle)) + (cross(frameX, frameY).normalized() * sin(angle));
+    frameZ = cross(frameX, frameY).normalized();
+}
+
+void RadiosityFunction::SampleDirectionGenerator::InitSequence(unsigned int& sample_count, const Vector3d& raw_normal, const Vector3d& layer_normal, bool use_raw_normal, DBL br, const Vector3d& ipoint)
+{
+    size_t sequenceSize = (directionTable ? directionTable->x.size() : sampleDirections->CycleLength());
     sample_count = (unsigned int)min((size_t)sample_count, sequenceSize);
 
     if (use_raw_normal)
@@ -784,7 +931,7 @@ void RadiosityFunction::SampleDirectionGenerator::InitSequence(unsigned int& sam
         //  Is it really possible that we find less than (sample_count) "good" directions among (sample_count*5) directions?
         //  By how much can raw_normal and layer_normal differ? Even at 90 degree tilt, we could expect to find (sample_count)
         //  "good" directions among (sample_count*2).
-        remainingDirections = min(((size_t)sample_count) * 5, sequenceSize);
+        remainingDirections = (directionTable ? ((size_t)sample_count) * 5 : min(((size_t)sample_count) * 5, sequenceSize));
 
     rawNormalMode = use_raw_normal;
     rawNormal = raw_normal;
@@ -793,21 +940,29 @@ void RadiosityFunction::SampleDirectionGenerator::InitSequence(unsigned int& sam
     // - pre-computed "X" will be mapped to some direction we'll call "frameX"
     // - pre-computed "Y" will be mapped to layer_normal ("frameY")
     // - pre-computed "Z" will be mapped to some direction we'll call "frameZ"
-    // we choose "frameX" and "frameZ" as follows:
-    // - "frameX" to be perpendicular to layer_normal and Z axis
-    // - "frameZ" to be perpendicular to layer_normal and "frameX"
-    // in case layer_normal and Z axis are uncomfortably close, we fallback to the following choice:
-    // - "frameX" to be perpendicular to layer_normal and Y axis
-    // - "frameZ" to be perpendicular to layer_normal and "frameX"
 
     frameY = (use_raw_normal ? raw_normal : layer_normal);
-    Vector3d offY;
-    if(fabs(frameY[Z]) > 0.9)
-        offY = Vector3d(0,1,0); // too close to "Z" for comfort
+
+    if (directionTable)
+    {
+        // Start the direction set afresh for each sample, but rotate it about the normal by an angle derived from the
+        // sample location (a Cranley-Patterson rotation of the azimuth), so that neighbouring samples are uncorrelated
+        // while the result remains reproducible.
+        POV_UINT64 hash = 0xCBF29CE484222325ull;
+        for (unsigned int axis = X; axis <= Z; axis++)
+        {
+            POV_UINT64 bits;
+            DBL coord = ipoint[axis];
+            memcpy(&bits, &coord, sizeof(bits));
+            hash = (hash ^ bits) * 0x100000001B3ull;
+            hash ^= (hash >> 29);
+        }
+        tableIndex = 0;
+        rotation = DBL(hash >> 11) * (TWO_M_PI / 9007199254740992.0);
+        SetFrame(rotation);
+    }
     else
-        offY = Vector3d(0,0,1);
-    frameX = cross(frameY, offY).normalized();
-    frameZ = cross(frameX, frameY).normalized();
+        SetFrame(0.0);
 
     brilliance = br;
 }
@@ -829,7 +984,21 @@ bool RadiosityFunction::SampleDirectionGenerator::GetDirection(Vector3d& directi
     do
     {
         //Increase_Counter(stats[Gather_Performed_Count]);
-        random_vec = (*sampleDirections)();
+        if (directionTable)
+        {
+            if (tableIndex >= directionTable->x.size())
+            {
+                // used up the set (because some directions were behind the surface), so go through it again,
+                // rotated by the golden angle to get different directions
+                tableIndex = 0;
+                rotation += 2.39996322972865332;
+                SetFrame(rotation);
+            }
+            random_vec = Vector3d(directionTable->x[tableIndex], directionTable->y[tableIndex], directionTable->z[tableIndex]);
+            tableIndex++;
+        }
+        else
+            random_vec = (*sampleDirections)();
 
         // Tweak the direction vector according to the brilliance specified.
         random_vec.y() = fabs(random_vec.y());
@@ -846,14 +1015,14 @@ bool RadiosityFunction::SampleDirectionGenerator::GetDirection(Vector3d& directi
             random_vec.y()  =  sqrt(yNewSqr);
         }
 
-        if(frameY[Y] > 1.0 - RAD_EPSILON)
+        if(!directionTable && (frameY[Y] > 1.0 - RAD_EPSILON))
             // within 2.56 degree of Y, so we'll cheat a bit by using precomputed vectors as-is
             direction = random_vec;
-        else if(frameY[Y] < -1.0 + RAD_EPSILON)
+        else if(!directionTable && (frameY[Y] < -1.0 + RAD_EPSILON))
             // within 2.56 degree of -Y, so we'll cheat a bit by using precomputed vectors simply inverted
             direction = -random_vec;
         else
-            // somewhere else, we need to do some math
+            // somewhere else (or rotating the directions), we need to do some math
             direction = ((frameX * random_vec[X]) + (frameY * random_vec[Y]) + (frameZ * random_vec[Z]));
 
         if (rawNormalMode)
@@ -892,9 +1061,20 @@ bool RadiosityFunction::SampleDirectionGenerator::GetDirection(Vector3d& directi
 RadiosityCache::RadiosityCache(const SceneRadiositySettings& radset) :
     ra_reuse_count(0),
     ra_gather_count(0),
-    ot_fd(nullptr),
     Gather_Total_Count(0),
-    recursionSettings(radset.GetRecursionSettings(true)) // be prepared for the main render
+    incrementalReused(0),
+    incrementalDiscarded(0),
+    ot_fd(nullptr),
+#if POV_MULTITHREADED
+    autosaveQueue(nullptr),
+    autosavePending(0),
+    autosaveStop(false),
+#endif
+    ot_binary_fd(nullptr),
+    loadedBinary(false),
+    recursionSettings(radset.GetRecursionSettings(true)), // be prepared for the main render
+    currentFrame(0),
+    highReproducibility(false)
 {
     #ifdef RADSTATS
         ot_seenodecount = 0;
@@ -906,7 +1086,138 @@ RadiosityCache::RadiosityCache(const SceneRadiositySettings& radset) :
     #endif
 }
 
-bool RadiosityCache::Load(const Path& inputFile)
+/// State for filtering the samples of a cache file carried over from a previous animation frame.
+///
+/// The file starts with a description of the scene it was rendered from: the bounding box of each
+/// top-level object (`O` lines) and the position and colour of each light source (`L` lines).
+/// Once these have been read, they are compared with the current scene: If any light source or
+/// the number of objects has changed, all samples are discarded; otherwise, samples are discarded
+/// if they are near the old or new bounding box of any object that has changed (where "near"
+/// means within the sample's harmonic mean distance, which governs how far it is re-used).
+/// Samples that are more than `maxFrameAge` frames old are discarded as well, so that errors
+/// from changes not covered by this test do not persist indefinitely.
+///
+struct RadiosityCache::IncrementalLoad final
+{
+    const SceneData& sceneData;
+    int frame;
+    int maxFrameAge;
+    std::vector<BoundingBox> fileObjects;
+    size_t fileLights;
+    bool lightsChanged;
+    bool prepared;
+    bool discardAll;
+    std::vector<BoundingBox> changedRegions;
+
+    template<typename T>
+    static bool Same(const GenericVector3d<T>& a, const GenericVector3d<T>& b)
+    {
+        return (a[X] == b[X]) && (a[Y] == b[Y]) && (a[Z] == b[Z]);
+    }
+
+    IncrementalLoad(const SceneData& sd, int f, int age) :
+        sceneData(sd), frame(f), maxFrameAge(age), fileLights(0), lightsChanged(false), prepared(false), discardAll(false)
+    {}
+
+    void Prepare()
+    {
+        prepared = true;
+        if (lightsChanged || (fileLights != sceneData.lightSources.size()) || (fileObjects.size() != sceneData.objects.size()))
+        {
+            discardAll = true;
+            return;
+        }
+        for (size_t i = 0; i < fileObjects.size(); i++)
+        {
+            const BoundingBox& oldBox = fileObjects[i];
+            const BoundingBox& newBox = sceneData.objects[i]->BBox;
+            if (!Same(oldBox.lowerLeft, newBox.lowerLeft) || !Same(oldBox.size, newBox.size))
+            {
+                changedRegions.push_back(oldBox);
+                changedRegions.push_back(newBox);
+            }
+        }
+    }
+
+    bool Keep(const Vector3d& point, DBL harmonicMeanDistance, int sampleFrame)
+    {
+        if (!prepared)
+            Prepare();
+        if (discardAll || (sampleFrame < 0) || (OT_FRAME(frame - sampleFrame) > maxFrameAge))
+            return false;
+        for (auto&& box : changedRegions)
+        {
+            if ((point[X] > box.GetMinX() - harmonicMeanDistance) && (point[X] < box.GetMaxX() + harmonicMeanDistance) &&
+                (point[Y] > box.GetMinY() - harmonicMeanDistance) && (point[Y] < box.GetMaxY() + harmonicMeanDistance) &&
+                (point[Z] > box.GetMinZ() - harmonicMeanDistance) && (point[Z] < box.GetMaxZ() + harmonicMeanDistance))
+                return false;
+        }
+        return true;
+    }
+};
+
+// Load a cache file in either format. Binary cache files are memory-mapped and, if `inPlace` is set,
+// used in place rather than copied into the octree; this is only possible if no samples will be saved.
+bool RadiosityCache::Load(const Path& inputFile, bool inPlace)
+{
+    std::shared_ptr<pov_base::Filesystem::MappedFile> file(new pov_base::Filesystem::MappedFile);
+    if (file->Open(Path(inputFile)()) && ot_is_binary_file(*file))
+        return LoadBinary(file, 0, 0, inPlace);
+    file.reset();
+    return LoadFile(inputFile, nullptr);
+}
+
+// Load a binary cache file embedded in a memory-mapped file, e.g. a scene bundle.
+bool RadiosityCache::Load(const std::shared_ptr<pov_base::Filesystem::MappedFile>& file, POV_UINT64 offset, POV_UINT64 size, bool inPlace)
+{
+    return LoadBinary(file, offset, size, inPlace);
+}
+
+bool RadiosityCache::LoadBinary(const std::shared_ptr<pov_base::Filesystem::MappedFile>& file, POV_UINT64 offset, POV_UINT64 size, bool inPlace)
+{
+    std::unique_ptr<ot_mapped_tree_struct> tree(new ot_mapped_tree_struct);
+    if (!ot_map_file(tree.get(), file, offset, size))
+        return false;
+
+    loadedBinary = true;
+    if (inPlace)
+    {
+        mappedOctree = std::move(tree);
+        return true;
+    }
+
+    BlockPool* pool = AcquireBlockPool();
+    for (POV_UINT32 i = 0; i < tree->NodeCount; i++)
+    {
+        const ot_file_node_struct& fileNode = tree->Nodes[i];
+        if (fileNode.BlockCount == 0)
+            continue;
+        ot_id_struct id;
+        id.x = fileNode.x;
+        id.y = fileNode.y;
+        id.z = fileNode.z;
+        id.Size = fileNode.Size;
+        ot_node_struct* node = GetNode(nullptr, id);
+        for (POV_UINT32 k = 0; k < fileNode.BlockCount; k++)
+        {
+            ot_block_struct* block = pool->NewBlock();
+            *block = tree->Blocks[fileNode.FirstBlock + k];
+            block->next = nullptr;
+            InsertBlock(nullptr, node, block);
+        }
+    }
+    ReleaseBlockPool(pool);
+    return true;
+}
+
+bool RadiosityCache::LoadIncremental(const Path& inputFile, const SceneData& sceneData, int frame, int maxFrameAge)
+{
+    currentFrame = frame;
+    IncrementalLoad incremental(sceneData, frame, maxFrameAge);
+    return LoadFile(inputFile, &incremental);
+}
+
+bool RadiosityCache::LoadFile(const Path& inputFile, IncrementalLoad* incremental)
 {
     bool ok = false;
     IStream* fd = NewIStream(inputFile, POV_File_Data_RCA);
@@ -921,23 +1232,59 @@ bool RadiosityCache::Load(const Path& inputFile)
         Vector3d point;
         Vector3d normal;
         Vector3d to_nearest;
-        MathColour dx, dy, dz;
+        MathColour dx, dy, dz, rx, ry, rz; // gradients are not stored in the file
         MathColour illuminance;
         double harmonic_mean;
         double nearest;
         int goodreads = 0;
         int count;
+        int frame;
         DBL brightness;
         char normal_string[30], to_nearest_string[30];
-        char line[101];
+        char line[257];
 
         //info->Gather_Total.clear();
         //info->Gather_Total_Count = 0;
 
-        while (!(got_eof = !fd->getline (line, 99)))
+        while (!(got_eof = !fd->getline (line, 255)))
         {
             switch ( line[0] )
             {
+                case 'O':    // bounding box of a top-level object in the scene the file was rendered from
+                {
+                    int index;
+                    float llx, lly, llz, sx, sy, sz;
+                    if ((incremental != nullptr) &&
+                        (sscanf(line, "O%d %f %f %f %f %f %f\n", &index, &llx, &lly, &llz, &sx, &sy, &sz) == 7) && (index >= 0))
+                    {
+                        if (size_t(index) >= incremental->fileObjects.size())
+                            incremental->fileObjects.resize(index + 1);
+                        Make_BBox(incremental->fileObjects[index], llx, lly, llz, sx, sy, sz);
+                    }
+                    break;
+                }
+                case 'L':    // light source in the scene the file was rendered from
+                {
+                    int index;
+                    Vector3d center, pointsAt;
+                    float r, g, b;
+                    if ((incremental != nullptr) &&
+                        (sscanf(line, "L%d %lf %lf %lf %lf %lf %lf %f %f %f\n", &index,
+                                &center[X], &center[Y], &center[Z], &pointsAt[X], &pointsAt[Y], &pointsAt[Z], &r, &g, &b) == 10))
+                    {
+                        incremental->fileLights++;
+                        if ((index < 0) || (size_t(index) >= incremental->sceneData.lightSources.size()))
+                            incremental->lightsChanged = true;
+                        else
+                        {
+                            const LightSource* light = incremental->sceneData.lightSources[index];
+                            if (!IncrementalLoad::Same(light->Center, center) || !IncrementalLoad::Same(light->Points_At, pointsAt) ||
+                                (float(light->colour.Red()) != r) || (float(light->colour.Green()) != g) || (float(light->colour.Blue()) != b))
+                                incremental->lightsChanged = true;
+                        }
+                    }
+                    break;
+                }
                 case 'B':    // the file contains the old radiosity_brightness value
                 {
                     if ( sscanf(line, "B%lf\n", &brightness) == 1 )
@@ -955,19 +1302,26 @@ bool RadiosityCache::Load(const Path& inputFile)
                 {
 #if (NUM_COLOUR_CHANNELS == 3)
                     RGBColour tempCol;
-                    count = sscanf(line, "C%d %lf %lf %lf %s %f %f %f %lf %lf %s\n", // tw
+                    count = sscanf(line, "C%d %lf %lf %lf %s %f %f %f %lf %lf %s %d\n", // tw
                         &depth,
                         &point[X], &point[Y], &point[Z],
                         normal_string,
                         &tempCol.red(), &tempCol.green(), &tempCol.blue(),
                         &harmonic_mean,
-                        &nearest, to_nearest_string
+                        &nearest, to_nearest_string,
+                        &frame
                     );
                     illuminance = ToMathColour(tempCol);
 #else
                     #error "TODO!"
 #endif
-                    if ( count == 11 )
+                    if (count < 12)
+                        frame = -1; // written by an older version
+                    if ((count >= 11) && (incremental != nullptr) && !incremental->Keep(point, harmonic_mean, frame))
+                    {
+                        incrementalDiscarded++;
+                    }
+                    else if (count >= 11)
                     {
                         depth = depth - 1; // file format still uses 1-based bounce depth counting
 
@@ -986,8 +1340,10 @@ bool RadiosityCache::Load(const Path& inputFile)
 
                         line_num++;
 
-                        AddBlock(pool, nullptr, point, normal, 1.0 /* TODO FIXME - brilliance */, to_nearest, dx, dy, dz, illuminance, harmonic_mean, nearest, 1.0 /* TODO FIXME - quality */, depth, PRETRACE_STEP_LOADED, 0);
+                        AddBlock(pool, nullptr, point, normal, 1.0 /* TODO FIXME - brilliance */, to_nearest, dx, dy, dz, rx, ry, rz, illuminance, harmonic_mean, nearest, 1.0 /* TODO FIXME - quality */, depth, PRETRACE_STEP_LOADED, 0, max(frame, 0));
                         goodreads++;
+                        if (incremental != nullptr)
+                            incrementalReused++;
                     }
                     break;
                 }
@@ -1014,7 +1370,61 @@ bool RadiosityCache::Load(const Path& inputFile)
 
 void RadiosityCache::InitAutosave(const Path& outputFile, bool append)
 {
-    ot_fd = NewOStream(outputFile, POV_File_Data_RCA, append);
+    // a binary cache file cannot be appended to, so start over with the samples loaded from it
+    ot_fd = NewOStream(outputFile, POV_File_Data_RCA, append && !loadedBinary);
+    ot_node_struct *root = octree.root;
+    if ((ot_fd != nullptr) && loadedBinary && (root != nullptr))
+        ot_save_tree(root, ot_fd);
+#if POV_MULTITHREADED
+    if (ot_fd != nullptr)
+        StartAutosaveWriter();
+#endif
+}
+
+// The binary cache file format holds the complete octree, so it is written on destruction
+// rather than sample by sample as the samples are computed.
+void RadiosityCache::InitBinarySave(const Path& outputFile)
+{
+    ot_binary_fd = NewOStream(outputFile, POV_File_Data_RCA, false);
+}
+
+// Write the samples gathered so far to a binary cache file right away, e.g. for a scene bundle.
+bool RadiosityCache::SaveBinary(const Path& outputFile)
+{
+    std::unique_ptr<OStream> fd(NewOStream(outputFile, POV_File_Data_RCA, false));
+    ot_node_struct *root = octree.root;
+    return (fd != nullptr) && (root != nullptr) && ot_save_binary(root, fd.get());
+}
+
+// Start a new cache file for the next animation frame, describing the current scene
+// (see IncrementalLoad) and holding the samples retained by LoadIncremental().
+void RadiosityCache::InitIncrementalAutosave(const Path& outputFile, const SceneData& sceneData)
+{
+    ot_fd = NewOStream(outputFile, POV_File_Data_RCA, false);
+    if (ot_fd == nullptr)
+        return;
+
+    for (size_t i = 0; i < sceneData.objects.size(); i++)
+    {
+        const BoundingBox& box = sceneData.objects[i]->BBox;
+        ot_fd->printf("O%d\t%.9g\t%.9g\t%.9g\t%.9g\t%.9g\t%.9g\n", int(i),
+                      box.lowerLeft.x(), box.lowerLeft.y(), box.lowerLeft.z(), box.size.x(), box.size.y(), box.size.z());
+    }
+    for (size_t i = 0; i < sceneData.lightSources.size(); i++)
+    {
+        const LightSource* light = sceneData.lightSources[i];
+        ot_fd->printf("L%d\t%.17g\t%.17g\t%.17g\t%.17g\t%.17g\t%.17g\t%.9g\t%.9g\t%.9g\n", int(i),
+                      light->Center[X], light->Center[Y], light->Center[Z],
+                      light->Points_At[X], light->Points_At[Y], light->Points_At[Z],
+                      light->colour.Red(), light->colour.Green(), light->colour.Blue());
+    }
+
+    ot_node_struct *root = octree.root;
+    if (root != nullptr)
+        ot_save_tree(root, ot_fd);
+#if POV_MULTITHREADED
+    StartAutosaveWriter();
+#endif
 }
 
 /*****************************************************************************
@@ -1042,6 +1452,11 @@ void RadiosityCache::InitAutosave(const Path& outputFile, bool append)
 
 RadiosityCache::~RadiosityCache()
 {
+#if POV_MULTITHREADED
+    // save whatever the render threads have left for the writer
+    StopAutosaveWriter();
+#endif
+
     // TODO FIXME - I guess the mutexing shouldn't be necessary here
 
     { // mutex scope
@@ -1057,13 +1472,17 @@ RadiosityCache::~RadiosityCache()
         }
     }
 
-    { // mutex scope
-#if POV_MULTITHREADED
-        std::lock_guard<std::mutex> lockTree(octree.treeMutex);
-        std::lock_guard<std::mutex> lockBlock(octree.blockMutex);
-#endif
-        if (octree.root != nullptr)
-            ot_free_tree(&octree.root);
+    if (ot_binary_fd != nullptr)
+    {
+        ot_save_binary(octree.root, ot_binary_fd); // TODO MESSAGE - report failure
+        delete ot_binary_fd;
+        ot_binary_fd = nullptr;
+    }
+
+    {
+        ot_node_struct *root = octree.root.exchange(nullptr);
+        if (root != nullptr)
+            ot_free_tree(&root);
     }
 
     { // mutex scope
@@ -1081,10 +1500,24 @@ RadiosityCache::~RadiosityCache()
 }
 
 
-RadiosityCache::BlockPool* RadiosityCache::AcquireBlockPool()
+#if POV_MULTITHREADED
+// Lock a mutex, adding the time spent waiting for it (if any) to the statistics.
+static void LockMeasured(std::unique_lock<std::mutex>& lock, RenderStatistics* stats)
+{
+    if (lock.try_lock())
+        return;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    lock.lock();
+    if (stats != nullptr)
+        (*stats)[Radiosity_LockWaitTime] += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+#endif
+
+RadiosityCache::BlockPool* RadiosityCache::AcquireBlockPool(RenderStatistics* stats)
 {
 #if POV_MULTITHREADED
-    std::lock_guard<std::mutex> lock(blockPoolsMutex);
+    std::unique_lock<std::mutex> lock(blockPoolsMutex, std::defer_lock);
+    LockMeasured(lock, stats);
 #endif
     if (blockPools.empty())
         return new BlockPool();
@@ -1096,29 +1529,141 @@ RadiosityCache::BlockPool* RadiosityCache::AcquireBlockPool()
     }
 }
 
-void RadiosityCache::ReleaseBlockPool(RadiosityCache::BlockPool* pool)
+void RadiosityCache::ReleaseBlockPool(RadiosityCache::BlockPool* pool, RenderStatistics* stats)
 {
+#if POV_MULTITHREADED
+    if (autosaveThread.joinable())
+    {
+        // leave the pool to the autosave writer, which returns it for re-use once it has been saved
+        autosavePending++;
+        BlockPool* next = autosaveQueue.load(std::memory_order_relaxed);
+        do
+            pool->nextQueued = next;
+        while (!autosaveQueue.compare_exchange_weak(next, pool, std::memory_order_release, std::memory_order_relaxed));
+        autosaveWakeup.notify_one();
+        return;
+    }
+#endif
+
+    if (ot_fd == nullptr)
+        // nothing to write, just mark the blocks as saved
+        pool->Save(nullptr);
+    else
     { // mutex scope
 #if POV_MULTITHREADED
-        std::lock_guard<std::mutex> lock(fileMutex);
+        std::unique_lock<std::mutex> lock(fileMutex, std::defer_lock);
+        LockMeasured(lock, stats);
 #endif
         pool->Save(ot_fd);
     }
 
-    { // mutex scope
+    RecycleBlockPool(pool, stats);
+}
+
+void RadiosityCache::RecycleBlockPool(RadiosityCache::BlockPool* pool, RenderStatistics* stats)
+{
 #if POV_MULTITHREADED
-        std::lock_guard<std::mutex> lock(blockPoolsMutex);
+    std::unique_lock<std::mutex> lock(blockPoolsMutex, std::defer_lock);
+    LockMeasured(lock, stats);
 #endif
-        blockPools.push_back(pool);
+    blockPools.push_back(pool);
+}
+
+#if POV_MULTITHREADED
+
+void RadiosityCache::StartAutosaveWriter()
+{
+    if (!autosaveThread.joinable())
+    {
+        autosaveStop = false;
+        autosaveThread = std::thread(&RadiosityCache::AutosaveWriter, this);
+    }
+}
+
+void RadiosityCache::StopAutosaveWriter()
+{
+    if (autosaveThread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(autosaveMutex);
+            autosaveStop = true;
+        }
+        autosaveWakeup.notify_one();
+        autosaveThread.join();
+    }
+}
+
+void RadiosityCache::AutosaveWriter()
+{
+    std::unique_lock<std::mutex> lock(autosaveMutex);
+
+    for (;;)
+    {
+        BlockPool* queued = autosaveQueue.exchange(nullptr, std::memory_order_acquire);
+
+        if (queued == nullptr)
+        {
+            if (autosaveStop)
+                break;
+            autosaveIdle.notify_all();
+            autosaveWakeup.wait_for(lock, std::chrono::milliseconds(AUTOSAVE_POLL_INTERVAL));
+            continue;
+        }
+
+        lock.unlock();
+
+        // the queue holds the most recently released pool first; save them in the order they were released
+        BlockPool* pool = nullptr;
+        while (queued != nullptr)
+        {
+            BlockPool* next = queued->nextQueued;
+            queued->nextQueued = pool;
+            pool = queued;
+            queued = next;
+        }
+
+        while (pool != nullptr)
+        {
+            BlockPool* next = pool->nextQueued;
+            {
+                std::lock_guard<std::mutex> fileLock(fileMutex);
+                pool->Save(ot_fd);
+            }
+            pool->nextQueued = nullptr;
+            RecycleBlockPool(pool, nullptr);
+            autosavePending--;
+            pool = next;
+        }
+
+        lock.lock();
     }
 }
 
+#endif // POV_MULTITHREADED
+
+void RadiosityCache::FlushAutosave()
+{
+#if POV_MULTITHREADED
+    if (autosaveThread.joinable())
+    {
+        std::unique_lock<std::mutex> lock(autosaveMutex);
+        autosaveWakeup.notify_one();
+        autosaveIdle.wait(lock, [this]{ return autosavePending.load() == 0; });
+    }
+
+    std::lock_guard<std::mutex> lock(fileMutex);
+#endif
+    if (ot_fd != nullptr)
+        ot_fd->flush();
+}
+
 ot_block_struct *RadiosityCache::BlockPool::NewBlock()
 {
     ot_block_struct *block = nullptr;
 
     if (head == nullptr || nextFreeBlock >= BLOCK_POOL_UNIT_SIZE)
     {
+        pov_base::pov_mem_account(pov_base::kMemory_Radiosity, sizeof(PoolUnit));
         head = new PoolUnit(head);
         nextFreeBlock = 0;
     }
@@ -1134,7 +1679,8 @@ RadiosityCache::BlockPool::BlockPool() :
     head(nullptr),
     savedHead(nullptr),
     nextFreeBlock(0),
-    nextUnsavedBlock(0)
+    nextUnsavedBlock(0),
+    nextQueued(nullptr)
 {
     // nothing else to do
 }
@@ -1177,6 +1723,23 @@ void RadiosityCache::BlockPool::Save(OStream* fd)
     }
 }
 
+// Get the blocks added since the pool was last saved, i.e. since it was acquired for the current tile,
+// as far as they are in the newest pool unit.
+const ot_block_struct* RadiosityCache::BlockPool::GetRecentBlocks(unsigned int& count) const
+{
+    if (head == nullptr)
+    {
+        count = 0;
+        return nullptr;
+    }
+    unsigned int from = 0;
+    if (head->next == savedHead)
+        // pool unit that was partially filled when last saved
+        from = nextUnsavedBlock;
+    count = nextFreeBlock - from;
+    return &(head->blocks[from]);
+}
+
 RadiosityCache::BlockPool::~BlockPool()
 {
     // require that block has been saved by now
@@ -1187,13 +1750,15 @@ RadiosityCache::BlockPool::~BlockPool()
         PoolUnit *b = head;
         head = head->next;
         delete b;
+        pov_base::pov_mem_unaccount(pov_base::kMemory_Radiosity, sizeof(PoolUnit));
     }
 }
 
 
 void RadiosityCache::AddBlock(BlockPool* pool, RenderStatistics* stats, const Vector3d& point, const Vector3d& normal, DBL brilliance, const Vector3d& toNearestSurface,
-                              const MathColour& dx, const MathColour& dy, const MathColour& dz, const MathColour& illuminance,
-                              DBL harmonicMeanDistance, DBL nearestDistance, DBL quality, int bounceDepth, int pretraceStep, int tileId)
+                              const MathColour& dx, const MathColour& dy, const MathColour& dz,
+                              const MathColour& rx, const MathColour& ry, const MathColour& rz, const MathColour& illuminance,
+                              DBL harmonicMeanDistance, DBL nearestDistance, DBL quality, int bounceDepth, int pretraceStep, int tileId, int frame)
 {
     ot_block_struct*    block = pool->NewBlock();
     ot_id_struct        id;
@@ -1206,11 +1771,12 @@ void RadiosityCache::AddBlock(BlockPool* pool, RenderStatistics* stats, const Ve
 
     block->Illuminance = illuminance;
     block->To_Nearest_Surface = toNearestSurface;
-#ifdef RAD_GRADIENT
     block->dx = dx;
     block->dy = dy;
     block->dz = dz;
-#endif
+    block->rx = rx;
+    block->ry = ry;
+    block->rz = rz;
     block->Brilliance = SNGL(brilliance);
     block->Harmonic_Mean_Distance = SNGL(harmonicMeanDistance);
     block->Nearest_Distance = SNGL(nearestDistance);
@@ -1218,6 +1784,7 @@ void RadiosityCache::AddBlock(BlockPool* pool, RenderStatistics* stats, const Ve
     block->Bounce_Depth = OT_DEPTH(bounceDepth);
     block->Pass = OT_PASS(pretraceStep);
     block->TileId = OT_TILE(tileId);
+    block->Frame = OT_FRAME(frame < 0 ? currentFrame : frame);
     block->Point = point;
     block->S_Normal = normal;
     block->next = nullptr;
@@ -1229,36 +1796,36 @@ void RadiosityCache::AddBlock(BlockPool* pool, RenderStatistics* stats, const Ve
     node = RadiosityCache::GetNode(stats, id);
 
     // add the info block
-    InsertBlock(node, block);
+    InsertBlock(stats, node, block);
 }
 
+// Nodes are created and hooked into the tree without any locking: each new node is fully
+// built before a compare-and-swap publishes it, so readers traversing the tree concurrently
+// only ever see valid nodes. If another thread wins the race for a particular slot, our node
+// is discarded and we continue with theirs; such retries are counted in the statistics.
 ot_node_struct *RadiosityCache::GetNode(RenderStatistics* stats, const ot_id_struct& id)
 {
     int target_size, dx, dy, dz, index;
     ot_node_struct *temp_node, *this_node, *temp_root;
     ot_id_struct temp_id;
-
-#if POV_MULTITHREADED
-    std::unique_lock<std::mutex> treeLock(octree.treeMutex, std::defer_lock); // we may need to lock this mutex - but not now.
-#endif
+    POV_LONG retries = 0;
 
 #ifdef RADSTATS
     ot_inscount++;
 #endif
 
+    temp_root = octree.root.load(std::memory_order_acquire);
+
     // If there is no root yet, create one.  This is a first-time-through
-    if (octree.root == nullptr)
+    if (temp_root == nullptr)
     {
-        // now is the time to lock the tree for modification
-#if POV_MULTITHREADED
-        treeLock.lock();
-#endif
+        // Might as well make it the right size for our first data block
+        temp_node = new ot_node_struct;
+        temp_node->Id = id;
 
-        // Now that we have exclusive write access, make sure we REALLY don't have a root
-        // (some other thread might have created it just as we were waiting to get the lock)
-        if (octree.root == nullptr)
+        // Some other thread might have created a root just now
+        if (octree.root.compare_exchange_strong(temp_root, temp_node, std::memory_order_acq_rel, std::memory_order_acquire))
         {
-            octree.root = new ot_node_struct;
 #ifdef OCTREE_PERFORMANCE_DEBUG
             if (stats != nullptr)
                 (*stats)[Radiosity_OctreeNodes]++;
@@ -1268,86 +1835,63 @@ ot_node_struct *RadiosityCache::GetNode(RenderStatistics* stats, const ot_id_str
             ot_nodecount = 1;
 #endif
 
-            // Might as well make it the right size for our first data block
-            octree.root->Id = id;
-
             // Having constructed the node to match our needs, we're already in the right place;
             // let's take the shortest route out of here
-            return octree.root;
+            return temp_node;
         }
-        // no else
 
-        // Still here? Well, fooled by the pitfalls of multithreading, are we!
-        // The root is there now, but we didn't create it ourselves, so we need to go the long way
-
-        // As this is an exceptional case (happens at most once per task), we pay the price of releasing
-        // and possibly re-acquiring the lock, for the sake of code simplicity
+        // Still here? The root is there now, but we didn't create it ourselves, so we need to go the long way
+        delete temp_node;
+        retries++;
     }
     // no else
 
     // What if the thing we're inserting is bigger than the biggest node in the
-    // existing tree?  Add a new top to the tree till it's big enough.
+    // existing tree, or for an area of space which does not overlap with the
+    // current tree?  Add a new top to the tree till it's big enough and the
+    // areas overlap.
 
-    if (octree.root->Id.Size < id.Size)
+    for (;;)
     {
-        // now is the time to lock the tree for modification, in case we haven't yet
-#if POV_MULTITHREADED
-        if (!treeLock.owns_lock())
-            treeLock.lock();
-#endif
-
-        // (Note that the following can't be a do...while() loop because we may not have had a lock when we first tested,
-        // and some other task may have modified the root while we were not looking)
-        while (octree.root->Id.Size < id.Size)
+        // Build a temp id, like a cursor to move around with, and find the parent
+        // of our new node which is as big as root
+        temp_id = id;
+        while (temp_id.Size < temp_root->Id.Size)
         {
-            // root too small
-            ot_newroot(&octree.root);
+            ot_parent(&temp_id, &temp_id);
         }
-    }
-
-    // What if the new block is the right size, but for an area of space which
-    // does not overlap with the current tree?  New bigger root, until the
-    // areas overlap.
-
-    // Build a temp id, like a cursor to move around with
-    temp_id = id;
 
-    // make sure we're using a stable root to work with
-    temp_root = octree.root;
+        if ((temp_id.Size == temp_root->Id.Size) &&
+            (temp_id.x == temp_root->Id.x) &&
+            (temp_id.y == temp_root->Id.y) &&
+            (temp_id.z == temp_root->Id.z))
+            break;
 
-    // First, find the parent of our new node which is as big as root
-    while (temp_id.Size < temp_root->Id.Size)
-    {
-        ot_parent(&temp_id, &temp_id);
-    }
+        // create bigger root (see ot_newroot())
+        temp_node = new ot_node_struct;
+        ot_parent(&temp_node->Id, &temp_root->Id);
+        dx = (temp_root->Id.x & 1) * 4;
+        dy = (temp_root->Id.y & 1) * 2;
+        dz = (temp_root->Id.z & 1);
+        temp_node->Kids[dx + dy + dz].store(temp_root, std::memory_order_relaxed);
 
-    if((temp_id.x != temp_root->Id.x) ||
-       (temp_id.y != temp_root->Id.y) ||
-       (temp_id.z != temp_root->Id.z))
-    {
-#if POV_MULTITHREADED
-        // now is the time to lock the tree for modification, in case we haven't yet
-        if (!treeLock.owns_lock())
+        if (octree.root.compare_exchange_weak(temp_root, temp_node, std::memory_order_acq_rel, std::memory_order_acquire))
         {
-            treeLock.lock();
-
-            // Acquired the lock just now, so some other task may have changed the root since last time we looked
-            while (temp_id.Size < octree.root->Id.Size)
-            {
-                ot_parent(&temp_id, &temp_id);
-            }
-        }
+            temp_root = temp_node;
+#ifdef OCTREE_PERFORMANCE_DEBUG
+            if (stats != nullptr)
+                (*stats)[Radiosity_OctreeNodes]++;
 #endif
 
-        // (Note that the following can't be a do...while() loop because we may not have had a lock when we first tested,
-        // and some other task may have modified the root while we were not looking)
-        while((temp_id.x != octree.root->Id.x) ||
-              (temp_id.y != octree.root->Id.y) ||
-              (temp_id.z != octree.root->Id.z))
+#ifdef RADSTATS
+            ot_nodecount++;
+#endif
+        }
+        else
         {
-            // while separate subtrees...
-            ot_newroot(&octree.root);           // create bigger root
-            ot_parent(&temp_id, &temp_id);  // and move cursor up one, too
+            // some other thread has changed the root; temp_root now holds the new one, so start over
+            delete temp_node;
+            retries++;
         }
     }
 
@@ -1355,7 +1899,7 @@ ot_node_struct *RadiosityCache::GetNode(RenderStatistics* stats, const ot_id_str
     // somewhere.  Go back down the tree to the right level, making new nodes
     // as you go.
 
-    this_node = octree.root; // start at the root
+    this_node = temp_root; // start at the root
 
     while (this_node->Id.Size > id.Size)
     {
@@ -1378,20 +1922,20 @@ ot_node_struct *RadiosityCache::GetNode(RenderStatistics* stats, const ot_id_str
 
         index = dx + dy + dz;
 
-        if (this_node->Kids[index] == nullptr)
+        ot_node_struct* kid = this_node->Kids[index].load(std::memory_order_acquire);
+        if (kid == nullptr)
         {
             // Next level down doesn't exist yet, so create it
+            temp_node = new ot_node_struct;
 
-#if POV_MULTITHREADED
-            // now is the time to lock the tree for modification, in case we haven't yet
-            if (!treeLock.owns_lock())
-                treeLock.lock();
-#endif
+            // Fill in the data
+            temp_node->Id = temp_id;
+            // (all other data fields are automatically zeroed by the constructor)
 
-            // We may have acquired the lock just now, so some other task may have changed the root since last time we looked
-            if (this_node->Kids[index] == nullptr)
+            // Add it onto the tree, unless some other thread has beaten us to it
+            if (this_node->Kids[index].compare_exchange_strong(kid, temp_node, std::memory_order_acq_rel, std::memory_order_acquire))
             {
-                temp_node = new ot_node_struct;
+                kid = temp_node;
 #ifdef OCTREE_PERFORMANCE_DEBUG
                 if (stats!= nullptr)
                     (*stats)[Radiosity_OctreeNodes]++;
@@ -1400,32 +1944,41 @@ ot_node_struct *RadiosityCache::GetNode(RenderStatistics* stats, const ot_id_str
 #ifdef RADSTATS
                 ot_nodecount++;
 #endif
-
-                // Fill in the data
-                temp_node->Id = temp_id;
-                // (all other data fields are automatically zeroed by the allocation function)
-
-                // Add it onto the tree
-                this_node->Kids[index] = temp_node;
+            }
+            else
+            {
+                delete temp_node;
+                retries++;
             }
         }
 
         // Now follow it down and repeat
-        this_node = this_node->Kids[index];
+        this_node = kid;
     }
 
+    if ((stats != nullptr) && (retries > 0))
+        (*stats)[Radiosity_OctreeRetries] += retries;
+
     // Finally, we're in the right place, so return a pointer to the block
     return this_node;
 }
 
-void RadiosityCache::InsertBlock(ot_node_struct *node, ot_block_struct *block)
+void RadiosityCache::InsertBlock(RenderStatistics* stats, ot_node_struct *node, ot_block_struct *block)
 {
-#if POV_MULTITHREADED
-    std::lock_guard<std::mutex> lock(octree.blockMutex);
-#endif
+    POV_LONG retries = ot_list_insert(&(node->Values), block);
 
-    block->next = node->Values;
-    node->Values = block;
+    if ((stats != nullptr) && (retries > 0))
+        (*stats)[Radiosity_OctreeRetries] += retries;
+}
+
+void RadiosityCache::MergePass()
+{
+    if (!highReproducibility)
+        return;
+
+    ot_node_struct *root = octree.root.load(std::memory_order_acquire);
+    if (root != nullptr)
+        ot_sort_lists(root);
 }
 
 /*****************************************************************************
@@ -1455,9 +2008,11 @@ void RadiosityCache::InsertBlock(ot_node_struct *node, ot_block_struct *block)
 *
 ******************************************************************************/
 
-DBL RadiosityCache::FindReusableBlock(RenderStatistics& stats, DBL errorbound, const Vector3d& ipoint, const Vector3d& snormal, DBL brilliance, MathColour& illuminance, int recursionDepth, int pretraceStep, int tileId)
+DBL RadiosityCache::FindReusableBlock(RenderStatistics& stats, DBL errorbound, const Vector3d& ipoint, const Vector3d& snormal, DBL brilliance, MathColour& illuminance, int recursionDepth, int pretraceStep, int tileId,
+                                      const BlockPool* recentPool, DBL sufficientWeight)
 {
-    if (octree.root != nullptr)
+    ot_node_struct *root = octree.root;
+    if ((root != nullptr) || (mappedOctree != nullptr))
     {
         WT_AVG gather;
 
@@ -1483,10 +2038,38 @@ DBL RadiosityCache::FindReusableBlock(RenderStatistics& stats, DBL errorbound, c
         gather.AcceptEpsilon_Count = 0;
 #endif
 
+        // Samples recently taken by the same thread are likely to be close by, so try them first.
+        // If they are sufficient on their own, the tree can be skipped; otherwise, start over,
+        // as the tree holds them as well.
+        if ((recentPool != nullptr) && (sufficientWeight > 0.0) && !highReproducibility)
+        {
+            unsigned int recentCount;
+            const ot_block_struct* recent = recentPool->GetRecentBlocks(recentCount);
+            for (unsigned int i = 0; i < recentCount; i++)
+            {
+                if ((int)recent[i].Bounce_Depth == recursionDepth)
+                    AverageNearBlock(const_cast<ot_block_struct*>(&recent[i]), reinterpret_cast<void *>(&gather));
+            }
+            if (gather.Weights >= sufficientWeight)
+            {
+                stats[Radiosity_RecentHits]++;
+                illuminance = gather.Weights_Times_Illuminances / gather.Weights;
+                return gather.Weights;
+            }
+            gather.Weights = 0.0;
+            gather.Weights_Times_Illuminances.Clear();
+            gather.Weights_Count = 0;
+            gather.Good_Count = 0;
+        }
+
         // Go through the tree calculating a weighted average of all of the usable points near this one
         // [CLi] inspection of octree.cpp tree code indicates that tree traversal is perfectly safe
         // regarding insertions by other threads, so no locking is needed
-        ot_dist_traverse(octree.root, ipoint, recursionDepth, AverageNearBlock, reinterpret_cast<void *>(&gather));
+        if (root != nullptr)
+            ot_dist_traverse(root, ipoint, recursionDepth, AverageNearBlock, reinterpret_cast<void *>(&gather));
+        // samples used in place from a binary cache file are kept in a tree of their own
+        if ((mappedOctree != nullptr) && (mappedOctree->NodeCount > 0))
+            ot_mapped_dist_traverse(mappedOctree.get(), 0, ipoint, recursionDepth, AverageNearBlock, reinterpret_cast<void *>(&gather));
 
 #ifdef OCTREE_PERFORMANCE_DEBUG
         stats[Radiosity_OctreeLookups]  += gather.Lookup_Count;
@@ -1718,28 +2301,24 @@ bool RadiosityCache::AverageNearBlock(ot_block_struct *block, void *void_info)
                         info->AcceptEpsilon_Count ++;
 #endif
 
-                        // This is the block where we use the gradient to improve the prediction
-#ifdef RAD_GRADIENT
-                        MathColour d((block->dx * delta[X]) + (block->dy * delta[Y]) + (block->dz * delta[Z]));
+                        // This is the block where we use the gradients to improve the prediction
+                        // (both are zero unless enabled via the radiosity `gradient` setting)
+                        Vector3d tilt(cross(block->S_Normal, info->N));
+                        MathColour d((block->dx * delta[X]) + (block->dy * delta[Y]) + (block->dz * delta[Z]) +
+                                     (block->rx * tilt[X])  + (block->ry * tilt[Y])  + (block->rz * tilt[Z]));
 
                         // NK 6-May-2003 removed clipping - not sure why it was here in the
                         // first place, but it sure causes problems for HDR scenes, and removing
                         // it doesn't seem to cause problems for non-HRD scenes.
                         // But we want to make sure that our deltas don't cause a positive illumination
                         // to go below zero, while allowing negative illuminations to stay negative.
-                        if((d.red() + block->Illuminance.red() < 0.0) && (block->Illuminance.red()>  0.0))
-                            d.red() = -block->Illuminance.red();
-
-                        if((d.green() + block->Illuminance.green() < 0.0) && (block->Illuminance.green() > 0.0))
-                            d.green() = -block->Illuminance.green();
-
-                        if((d.blue() + block->Illuminance.blue() < 0.0) && (block->Illuminance.blue() > 0.0))
-                            d.blue() = -block->Illuminance.blue();
+                        for (int i = 0; i < MathColour::channels; i++)
+                        {
+                            if ((d[i] + block->Illuminance[i] < 0.0) && (block->Illuminance[i] > 0.0))
+                                d[i] = -block->Illuminance[i];
+                        }
 
                         MathColour prediction = block->Illuminance + d;
-#else
-                        MathColour prediction = block->Illuminance;
-#endif
 
 #ifdef SHOW_SAMPLE_SPOTS
                         // TODO FIXME - distance_maximum no longer exists
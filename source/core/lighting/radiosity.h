@@ -43,12 +43,16 @@
 //  (none at the moment)
 
 // C++ standard header files
+#include <atomic>
+#include <condition_variable>
 #include <memory>
 #include <mutex>
+#include <thread>
 #include <vector>
 
 // POV-Ray header files (base module)
 #include "base/fileinputoutput_fwd.h"
+#include "base/filesystem_fwd.h"
 #include "base/path_fwd.h"
 
 // POV-Ray header files (core module)
@@ -72,6 +76,7 @@ namespace pov
 struct ot_block_struct;
 struct ot_node_struct;
 struct ot_id_struct;
+struct ot_mapped_tree_struct;
 
 #define RADIOSITY_CACHE_EXTENSION ".rca"
 
@@ -136,6 +141,9 @@ class SceneRadiositySettings final
         float   defaultImportance;
         bool    subsurface;                 // whether to use subsurface scattering for radiosity sampling rays
         bool    brilliance;                 // whether to respect brilliance in radiosity computations
+        bool    jitter;                     // whether to use a stratified direction set per sample, randomly rotated about the normal
+        bool    gradient;                   // whether to compute irradiance gradients and use them to extrapolate cached samples
+        double  adaptive;                   // relative error at which to stop shooting sample rays early (0 = always shoot all rays)
 
         SceneRadiositySettings() {
             radiosityEnabled    = false;
@@ -163,6 +171,9 @@ class SceneRadiositySettings final
             defaultImportance   = 1.0;
             subsurface          = false;
             brilliance          = false;
+            jitter              = false;
+            gradient            = false;
+            adaptive            = 0.0;
         }
 
         RadiosityRecursionSettings* GetRecursionSettings (bool final) const;
@@ -182,12 +193,14 @@ class RadiosityCache final
             protected:
                 ot_block_struct* NewBlock();
                 void Save(OStream *fd);
+                const ot_block_struct* GetRecentBlocks(unsigned int& count) const;
             private:
                 struct PoolUnit;
                 PoolUnit *head;                 // newest pool unit
                 PoolUnit *savedHead;            // newest block that has been saved completely
                 unsigned int nextFreeBlock;     // next free block (in *head)
                 unsigned int nextUnsavedBlock;  // next unsaved block (in *savedHead predecessor)
+                BlockPool *nextQueued;          // next pool queued for the autosave writer
         };
 
         int firstRadiosityPass;
@@ -211,25 +224,56 @@ class RadiosityCache final
         RadiosityCache(const SceneRadiositySettings& radset);
         ~RadiosityCache();
 
-        bool Load(const Path& inputFile);
-        void InitAutosave(const Path& outputFile, bool append);
+        // incremental mode: samples carried over from previous animation frames
+        POV_LONG incrementalReused;     // samples loaded and kept
+        POV_LONG incrementalDiscarded;  // samples loaded but discarded as outdated
 
-        DBL FindReusableBlock(RenderStatistics& stats, DBL errorbound, const Vector3d& ipoint, const Vector3d& snormal, DBL brilliance, MathColour& illuminance, int recursionDepth, int pretraceStep, int tileId);
-        BlockPool* AcquireBlockPool();
+        bool Load(const Path& inputFile, bool inPlace = false);
+        bool Load(const std::shared_ptr<pov_base::Filesystem::MappedFile>& file, POV_UINT64 offset, POV_UINT64 size, bool inPlace);
+        void InitAutosave(const Path& outputFile, bool append);
+        void InitBinarySave(const Path& outputFile);
+        bool SaveBinary(const Path& outputFile);
+        bool LoadIncremental(const Path& inputFile, const SceneData& sceneData, int frame, int maxFrameAge);
+        void InitIncrementalAutosave(const Path& outputFile, const SceneData& sceneData);
+
+        DBL FindReusableBlock(RenderStatistics& stats, DBL errorbound, const Vector3d& ipoint, const Vector3d& snormal, DBL brilliance, MathColour& illuminance, int recursionDepth, int pretraceStep, int tileId,
+                              const BlockPool* recentPool = nullptr, DBL sufficientWeight = 0.0);
+        BlockPool* AcquireBlockPool(RenderStatistics* stats = nullptr);
         void AddBlock(BlockPool* pool, RenderStatistics* stats, const Vector3d& Point, const Vector3d& S_Normal, DBL brilliance, const Vector3d& To_Nearest_Surface,
-                      const MathColour& dx, const MathColour& dy, const MathColour& dz, const MathColour& Illuminance,
-                      DBL Harmonic_Mean_Distance, DBL Nearest_Distance, DBL Quality, int Bounce_Depth, int pretraceStep, int tileId);
-        void ReleaseBlockPool(BlockPool* pool);
+                      const MathColour& dx, const MathColour& dy, const MathColour& dz,
+                      const MathColour& rx, const MathColour& ry, const MathColour& rz, const MathColour& Illuminance,
+                      DBL Harmonic_Mean_Distance, DBL Nearest_Distance, DBL Quality, int Bounce_Depth, int pretraceStep, int tileId, int frame = -1);
+        void ReleaseBlockPool(BlockPool* pool, RenderStatistics* stats = nullptr);
+
+        /// Wait until all samples released so far have been written to the autosave file, and flush it.
+        ///
+        /// With autosave enabled, samples are written by a dedicated thread, so that render threads
+        /// never wait for file I/O. This is intended to be called at the end of each pass, so that
+        /// the file is complete up to that point should the render be interrupted.
+        void FlushAutosave();
+
+        /// Enable or disable high reproducibility mode.
+        ///
+        /// In this mode, lookups ignore samples from other tiles of the current pass (as always),
+        /// and also skip the shortcut via the samples recently taken by the same thread, as the
+        /// latter depend on which tiles the thread happened to render before.
+        /// @ref MergePass() must then be called whenever a pass is complete.
+        void SetHighReproducibility(bool enabled) { highReproducibility = enabled; }
+
+        /// Merge the samples taken during the pass just completed into the cache.
+        ///
+        /// The samples of each tile are inserted as they are computed, so the order in which they
+        /// end up in the cache, and hence the order in which they are summed up during lookups,
+        /// depends on thread timing. In high reproducibility mode, this re-orders them by pass and
+        /// tile instead, so that subsequent passes give the same results regardless of the number
+        /// of threads. Must not be called while any other thread is accessing the cache.
+        void MergePass();
 
     private:
 
         struct Octree final
         {
-            ot_node_struct *root;
-#if POV_MULTITHREADED
-            std::mutex treeMutex;   // lock this when adding nodes to the tree
-            std::mutex blockMutex;  // lock this when adding blocks to any node of the tree
-#endif
+            std::atomic<ot_node_struct*> root; // nodes and blocks are added lock-free, see GetNode()
 
             Octree() : root(nullptr) {}
         };
@@ -241,14 +285,43 @@ class RadiosityCache final
 
         Octree octree;
 
+        std::unique_ptr<ot_mapped_tree_struct> mappedOctree; // samples used in place from a binary cache file, if any
+
         OStream *ot_fd;
 #if POV_MULTITHREADED
         std::mutex fileMutex;         // lock this when accessing ot_fd
+
+        // Autosave writer thread; render threads merely push the block pools they release onto a
+        // lock-free queue, and the writer saves them and returns them to the pools ready for re-use.
+        std::thread autosaveThread;
+        std::atomic<BlockPool*> autosaveQueue;      // pools waiting to be saved, most recently queued first
+        std::atomic<unsigned int> autosavePending;  // pools queued or being saved
+        std::mutex autosaveMutex;                   // lock this when accessing autosaveStop or waiting for the writer
+        std::condition_variable autosaveWakeup;     // signalled when pools have been queued, or the writer is to stop
+        std::condition_variable autosaveIdle;       // signalled when the writer has run out of pools to save
+        bool autosaveStop;                          // whether the writer is to stop once the queue is empty
 #endif
+        OStream *ot_binary_fd;        // binary cache file to write on destruction, if any
+        bool loadedBinary;            // whether the samples were loaded from a binary cache file
 
         RadiosityRecursionSettings* recursionSettings; // dynamically allocated array; use recursion depth as index
 
-        void InsertBlock(ot_node_struct* node, ot_block_struct *block);
+        int currentFrame;   // animation frame being rendered, for tagging new samples
+
+        bool highReproducibility;   // whether lookups must not depend on thread timing
+
+        struct IncrementalLoad;
+        bool LoadFile(const Path& inputFile, IncrementalLoad* incremental);
+        bool LoadBinary(const std::shared_ptr<pov_base::Filesystem::MappedFile>& file, POV_UINT64 offset, POV_UINT64 size, bool inPlace);
+
+        void RecycleBlockPool(BlockPool* pool, RenderStatistics* stats);
+#if POV_MULTITHREADED
+        void StartAutosaveWriter();
+        void StopAutosaveWriter();
+        void AutosaveWriter();
+#endif
+
+        void InsertBlock(RenderStatistics* stats, ot_node_struct* node, ot_block_struct *block);
         ot_node_struct *GetNode(RenderStatistics* stats, const ot_id_struct& id);
 
         static bool AverageNearBlock(ot_block_struct *block, void *void_info);
@@ -303,12 +376,15 @@ class RadiosityFunction final : public Trace::RadiosityFunctor
                 /// constructor
                 SampleDirectionGenerator();
                 /// Called before each tile
-                void Reset(unsigned int samplePoolCount);
+                void Reset(unsigned int samplePoolCount, unsigned int sampleCount, bool jitter);
                 /// Called before each sample
-                void InitSequence(unsigned int& sample_count, const Vector3d& raw_normal, const Vector3d& layer_normal, bool use_raw_normal, DBL brilliance);
+                void InitSequence(unsigned int& sample_count, const Vector3d& raw_normal, const Vector3d& layer_normal, bool use_raw_normal, DBL brilliance, const Vector3d& ipoint);
                 /// Called to get the next sampling ray direction
                 bool GetDirection(Vector3d& direction);
             protected:
+                struct DirectionTable;
+                /// Set up @ref frameX and @ref frameZ, rotated about @ref frameY by the given angle
+                void SetFrame(DBL angle);
                 /// number of remaining directions to try
                 size_t remainingDirections;
                 /// whether we're using the raw surface normal instead of the pertubed normal
@@ -325,6 +401,12 @@ class RadiosityFunction final : public Trace::RadiosityFunctor
                 Vector3d frameZ;
                 /// Generator for sampling directions
                 SequentialVectorGeneratorPtr sampleDirections;
+                /// Stratified set of sampling directions used instead of @ref sampleDirections (if jittering)
+                std::shared_ptr<const DirectionTable> directionTable;
+                /// next direction to use from @ref directionTable
+                size_t tableIndex;
+                /// angle by which the directions from @ref directionTable are currently rotated about the normal
+                DBL rotation;
         };
 
         // structure to store precomputed effective parameters for each recursion depth
@@ -355,6 +437,8 @@ class RadiosityFunction final : public Trace::RadiosityFunctor
         const SceneRadiositySettings&       settings;
         const RadiosityRecursionSettings*   recursionSettings;      // dynamically allocated array; use recursion depth as index
         RecursionParameters*                recursionParameters;    // dynamically allocated array; use recursion depth as index
+        IntStatsIndex rayCountStatsId;      // statistics id for rays shot in the current pass
+        IntStatsIndex raysSavedStatsId;     // statistics id for rays saved by adaptive sampling in the current pass
         long topLevelQueryCount;
         float topLevelReuse;
         int tileId;
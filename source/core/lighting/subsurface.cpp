@@ -37,9 +37,11 @@
 #include "core/lighting/subsurface.h"
 
 // C++ variants of C standard header files
-// C++ standard header files
 //  (none at the moment)
 
+// C++ standard header files
+#include <algorithm>
+
 // POV-Ray header files (base module)
 #include "base/mathutil.h"
 
@@ -119,5 +121,112 @@ PreciseMathColour SubsurfaceInterior::GetReducedAlbedo(const MathColour& diffuse
     return result;
 }
 
+SubsurfaceIrradianceCloud::SubsurfaceIrradianceCloud(std::vector<SubsurfaceIrradianceSample>& s, double area) :
+    sampleArea(area)
+{
+    samples.swap(s);
+    if (!samples.empty())
+        Build(0, samples.size(), 0);
+}
+
+int SubsurfaceIrradianceCloud::Build(unsigned int first, unsigned int count, unsigned int depth)
+{
+    int index = nodes.size();
+    nodes.push_back(Node());
+
+    Node node;
+    node.first = first;
+    node.count = count;
+    node.area  = count * sampleArea;
+    for (int i = 0; i < 8; i ++)
+        node.kids[i] = -1;
+
+    // compute bounds and the power-weighted centroid of the samples
+    node.lowerLeft  = samples[first].position;
+    node.upperRight = samples[first].position;
+    Vector3d centroid;
+    double weightSum = 0.0;
+    for (unsigned int i = first; i < first + count; i ++)
+    {
+        const SubsurfaceIrradianceSample& sample = samples[i];
+        for (int axis = X; axis <= Z; axis ++)
+        {
+            node.lowerLeft[axis]  = std::min(node.lowerLeft[axis],  sample.position[axis]);
+            node.upperRight[axis] = std::max(node.upperRight[axis], sample.position[axis]);
+        }
+        node.aggregate.power += sample.power;
+        double weight = sample.power.Greyscale();
+        centroid += sample.position * weight;
+        weightSum += weight;
+    }
+    if (weightSum > 0.0)
+        node.aggregate.position = centroid / weightSum;
+    else
+        node.aggregate.position = (node.lowerLeft + node.upperRight) * 0.5;
+
+    if ((count > LeafSamples) && (depth < MaxDepth))
+    {
+        // split the samples into octants around the center of the bounds
+        Vector3d center = (node.lowerLeft + node.upperRight) * 0.5;
+        std::vector<SubsurfaceIrradianceSample>::iterator bounds[9];
+        bounds[0] = samples.begin() + first;
+        bounds[8] = samples.begin() + first + count;
+        for (int axis = X, step = 4; axis <= Z; axis ++, step /= 2)
+        {
+            for (int i = 0; i < 8; i += 2 * step)
+                bounds[i + step] = std::partition(bounds[i], bounds[i + 2 * step],
+                                                  [&](const SubsurfaceIrradianceSample& sample) { return sample.position[axis] < center[axis]; });
+        }
+        for (int i = 0; i < 8; i ++)
+        {
+            unsigned int kidFirst = bounds[i] - samples.begin();
+            unsigned int kidCount = bounds[i + 1] - bounds[i];
+            if (kidCount == count)
+                break; // all samples coincide; no point in subdividing
+            if (kidCount > 0)
+                node.kids[i] = Build(kidFirst, kidCount, depth + 1);
+        }
+    }
+
+    nodes[index] = node;
+    return index;
+}
+
+void SubsurfaceIrradianceCloud::Gather(std::vector<SubsurfaceIrradianceSample>& result, const Vector3d& point, double maxSolidAngle) const
+{
+    if (nodes.empty())
+        return;
+
+    int stack[MaxDepth * 8 + 1];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize > 0)
+    {
+        const Node& node = nodes[stack[--stackSize]];
+
+        bool leaf = true;
+        for (int i = 0; i < 8; i ++)
+            leaf = leaf && (node.kids[i] < 0);
+        if (leaf)
+        {
+            result.insert(result.end(), samples.begin() + node.first, samples.begin() + node.first + node.count);
+            continue;
+        }
+
+        bool inside = (point.x() >= node.lowerLeft.x()) && (point.x() <= node.upperRight.x()) &&
+                      (point.y() >= node.lowerLeft.y()) && (point.y() <= node.upperRight.y()) &&
+                      (point.z() >= node.lowerLeft.z()) && (point.z() <= node.upperRight.z());
+        if (!inside && (node.area < maxSolidAngle * (node.aggregate.position - point).lengthSqr()))
+        {
+            result.push_back(node.aggregate);
+            continue;
+        }
+
+        for (int i = 0; i < 8; i ++)
+            if (node.kids[i] >= 0)
+                stack[stackSize++] = node.kids[i];
+    }
+}
+
 }
 // end of namespace pov
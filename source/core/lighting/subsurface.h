@@ -40,9 +40,11 @@
 #include "core/configcore.h"
 
 // C++ variants of C standard header files
-// C++ standard header files
 //  (none at the moment)
 
+// C++ standard header files
+#include <vector>
+
 // Boost header files
 #include <boost/flyweight.hpp>
 #include <boost/flyweight/key_value.hpp>
@@ -107,6 +109,61 @@ inline double FresnelDiffuseReflectance(double eta)
 #endif
 }
 
+/// Irradiance sample on the surface of an SSLT object.
+struct SubsurfaceIrradianceSample final
+{
+    Vector3d    position;   ///< Location of the sample.
+    MathColour  power;      ///< Irradiance (including Fresnel transmittance) times surface area represented, in mm^2.
+};
+
+/// Irradiance point cloud covering the surface of an SSLT object.
+///
+/// The samples are organized in an octree, each node of which also holds the accumulated
+/// power of all samples it contains, so that distant groups of samples can be evaluated as
+/// a single sample as proposed by Jensen and Buhler in their 2002 paper
+/// "A Rapid Hierarchical Rendering Technique for Translucent Materials".
+///
+class SubsurfaceIrradianceCloud final
+{
+    public:
+
+        /// Create a point cloud from a set of samples.
+        /// @param[in,out]  samples     Samples to take over; the vector is left empty.
+        /// @param[in]      sampleArea  Surface area represented by each sample, in scene units.
+        SubsurfaceIrradianceCloud(std::vector<SubsurfaceIrradianceSample>& samples, double sampleArea);
+
+        bool empty() const { return samples.empty(); }
+
+        /// Collect the samples and sample groups relevant for a given point.
+        /// @param[out]     result          Samples to evaluate; existing content is preserved.
+        /// @param[in]      point           Point to evaluate the cloud for.
+        /// @param[in]      maxSolidAngle   Maximum solid angle a group of samples may subtend as seen
+        ///                                 from `point` to be treated as a single sample.
+        void Gather(std::vector<SubsurfaceIrradianceSample>& result, const Vector3d& point, double maxSolidAngle) const;
+
+    protected:
+
+        static const unsigned int LeafSamples = 8;
+        static const unsigned int MaxDepth = 20;
+
+        struct Node final
+        {
+            Vector3d                    lowerLeft;  ///< Bounds of the samples contained.
+            Vector3d                    upperRight; ///< Bounds of the samples contained.
+            SubsurfaceIrradianceSample  aggregate;  ///< Power-weighted centroid and total power.
+            double                      area;       ///< Total area represented, in scene units.
+            unsigned int                first;      ///< Index of the first sample contained.
+            unsigned int                count;      ///< Number of samples contained.
+            int                         kids[8];    ///< Child node indices, or -1.
+        };
+
+        std::vector<SubsurfaceIrradianceSample> samples;
+        std::vector<Node>                       nodes;
+        double                                  sampleArea;
+
+        int Build(unsigned int first, unsigned int count, unsigned int depth);
+};
+
 /// @}
 ///
 //##############################################################################
@@ -205,7 +205,7 @@ template TextureBlendMapPtr         Copy_Blend_Map (const TextureBlendMapPtr& Ol
 ******************************************************************************/
 
 template<typename DATA_T>
-BlendMap<DATA_T>::BlendMap(BlendMapTypeId type) : Type(type) {}
+BlendMap<DATA_T>::BlendMap(BlendMapTypeId type) : Type(type), Sorted(false) {}
 
 template BlendMap<ColourBlendMapData>::BlendMap(BlendMapTypeId type);
 template BlendMap<PigmentBlendMapData>::BlendMap(BlendMapTypeId type);
@@ -218,6 +218,16 @@ void BlendMap<DATA_T>::Set(const Vector& data)
 {
     Blend_Map_Entries.reserve(data.size());
     Blend_Map_Entries.assign(data.begin(), data.end());
+
+    Sorted = true;
+    for (size_t i = 1; i < Blend_Map_Entries.size(); ++i)
+    {
+        if (Blend_Map_Entries[i].value < Blend_Map_Entries[i-1].value)
+        {
+            Sorted = false;
+            break;
+        }
+    }
 }
 
 template void BlendMap<ColourBlendMapData>::Set(const Vector& data);
@@ -101,6 +101,7 @@ class BlendMap
 
         BlendMapTypeId  Type;
         Vector          Blend_Map_Entries;
+        bool            Sorted; ///< Whether @ref Set() found the entries in ascending order, allowing for a binary search.
 };
 
 /*****************************************************************************
@@ -53,6 +53,7 @@
 #include "core/math/chi2.h"
 #include "core/render/ray.h"
 #include "core/scene/object.h"
+#include "core/scene/scenedata.h"
 #include "core/scene/tracethreaddata.h"
 #include "core/support/statistics.h"
 
@@ -100,6 +101,11 @@ Media::Media()
     AA_Threshold = 0.1;
     AA_Level = 3;
     Jitter = 0.0;
+
+    Grid_Spacing = 0.0;
+    Grid_Memory = 256.0;
+
+    Density_Bound = 1.0;
 }
 
 Media::Media(const Media& source)
@@ -145,6 +151,15 @@ Media& Media::operator=(const Media& source)
         Variance = source.Variance;
         AA_Threshold = source.AA_Threshold;
         AA_Level = source.AA_Level;
+        Grid_Spacing = source.Grid_Spacing;
+        Grid_Memory = source.Grid_Memory;
+        Density_Bound = source.Density_Bound;
+
+        // the copy may be transformed independently, so it needs a grid of its own
+        if (source.Grid)
+            Grid = std::make_shared<MediaGrid>(Grid_Spacing, Grid_Memory);
+        else
+            Grid.reset();
 
         if (Sample_Threshold != nullptr)
             delete[] Sample_Threshold;
@@ -175,6 +190,10 @@ Media& Media::operator=(const Media& source)
 void Media::Transform(const TRANSFORM *Trans)
 {
     Transform_Density(Density, Trans);
+
+    // discard any density already baked
+    if (Grid)
+        Grid = std::make_shared<MediaGrid>(Grid_Spacing, Grid_Memory);
 }
 
 void Media::PostProcess()
@@ -218,6 +237,24 @@ void Media::PostProcess()
 
     for (vector<PIGMENT*>::iterator i = Density.begin(); i != Density.end(); ++ i)
         Post_Pigment(*i);
+
+    // The density is the product of all density pigments, and so is its bound.
+    Density_Bound = 1.0;
+    for (vector<PIGMENT*>::iterator i = Density.begin(); i != Density.end(); ++ i)
+    {
+        ColourChannel bound;
+        if (!Compute_Pigment_Bound(*i, bound))
+        {
+            Density_Bound = -1.0;
+            break;
+        }
+        Density_Bound *= bound;
+    }
+
+    if ((Grid_Spacing > 0.0) && !is_constant)
+        Grid = std::make_shared<MediaGrid>(Grid_Spacing, Grid_Memory);
+    else
+        Grid.reset();
 }
 
 void Transform_Density(vector<PIGMENT*>& Density, const TRANSFORM *Trans)
@@ -226,6 +263,144 @@ void Transform_Density(vector<PIGMENT*>& Density, const TRANSFORM *Trans)
         Transform_Tpattern(*i, Trans);
 }
 
+/// Sampler evaluating the density of a media.
+struct MediaDensitySampler final : public MediaGrid::Sampler
+{
+    std::vector<PIGMENT*>& density;
+    TraceThreadData *threadData;
+
+    MediaDensitySampler(std::vector<PIGMENT*>& d, TraceThreadData *td) : density(d), threadData(td) {}
+    virtual void operator()(const Vector3d& p, MathColour& c) override { Evaluate_Density_Pigment(density, p, c, threadData); }
+};
+
+MediaGrid::MediaGrid(DBL spacing, DBL memory) :
+    spacing(spacing),
+    invSpacing(1.0 / spacing),
+    maxBricks(size_t(memory * 1024.0 * 1024.0 / (sizeof(MathColour) * BrickSamples * BrickSamples * BrickSamples))),
+    brickCount(0)
+{}
+
+MediaGrid::BrickPtr MediaGrid::GetBrick(POV_UINT64 key, const int brickIndex[3], Sampler& sampler)
+{
+    Shard& shard = shards[(key ^ (key >> 21) ^ (key >> 42)) % ShardCount];
+
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        std::unordered_map<POV_UINT64, BrickPtr>::const_iterator i = shard.bricks.find(key);
+        if (i != shard.bricks.end())
+            return i->second;
+    }
+
+    if (brickCount >= maxBricks)
+        return BrickPtr();
+
+    // Bake the brick without holding the lock; should another thread happen to bake the
+    // same brick concurrently, the first one to finish wins.
+    std::shared_ptr<Brick> brick = std::make_shared<Brick>();
+    MathColour *sample = brick->samples;
+    brick->maximum = 0.0;
+    for (int z = 0; z < BrickSamples; z ++)
+        for (int y = 0; y < BrickSamples; y ++)
+            for (int x = 0; x < BrickSamples; x ++)
+            {
+                Vector3d p(DBL(brickIndex[X] * BrickSize + x) * spacing,
+                           DBL(brickIndex[Y] * BrickSize + y) * spacing,
+                           DBL(brickIndex[Z] * BrickSize + z) * spacing);
+                sampler(p, *sample);
+                brick->maximum = max(brick->maximum, sample->MaxAbs());
+                sample ++;
+            }
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    std::pair<std::unordered_map<POV_UINT64, BrickPtr>::iterator, bool> result = shard.bricks.insert(std::make_pair(key, BrickPtr(brick)));
+    if (result.second)
+        brickCount ++;
+    return result.first->second;
+}
+
+bool MediaGrid::Locate(const Vector3d& p, int brickIndex[3], int local[3], DBL frac[3], POV_UINT64& key) const
+{
+    key = 0;
+    for (int axis = X; axis <= Z; axis ++)
+    {
+        DBL g = p[axis] * invSpacing;
+        DBL cell = floor(g);
+        if (fabs(cell) >= DBL(BrickSize) * DBL(1 << 20))
+            return false; // beyond the addressable range
+        int i = int(cell);
+        brickIndex[axis] = (i >= 0) ? (i / BrickSize) : -((BrickSize - 1 - i) / BrickSize);
+        local[axis] = i - brickIndex[axis] * BrickSize;
+        frac[axis] = g - cell;
+        key = (key << 21) | POV_UINT64((brickIndex[axis] + (1 << 20)) & 0x1FFFFF);
+    }
+    return true;
+}
+
+bool MediaGrid::GetCachedBrick(POV_UINT64 key, const int brickIndex[3], MediaGridCache& cache, Sampler& sampler)
+{
+    if (!cache.brick || (cache.key != key))
+    {
+        BrickPtr brick = GetBrick(key, brickIndex, sampler);
+        if (!brick)
+            return false;
+        cache.key = key;
+        cache.brick = brick;
+    }
+    return true;
+}
+
+bool MediaGrid::Evaluate(const Vector3d& p, MathColour& c, MediaGridCache& cache, Sampler& sampler)
+{
+    int brickIndex[3];
+    int local[3];
+    DBL frac[3];
+    POV_UINT64 key;
+
+    if (!Locate(p, brickIndex, local, frac, key) || !GetCachedBrick(key, brickIndex, cache, sampler))
+        return false;
+
+    // trilinear interpolation
+    const MathColour *s = cache.brick->samples + (local[Z] * BrickSamples + local[Y]) * BrickSamples + local[X];
+    const int dy = BrickSamples;
+    const int dz = BrickSamples * BrickSamples;
+    MathColour c00 = s[0]       * (1.0 - frac[X]) + s[1]           * frac[X];
+    MathColour c10 = s[dy]      * (1.0 - frac[X]) + s[dy + 1]      * frac[X];
+    MathColour c01 = s[dz]      * (1.0 - frac[X]) + s[dz + 1]      * frac[X];
+    MathColour c11 = s[dz + dy] * (1.0 - frac[X]) + s[dz + dy + 1] * frac[X];
+    c = (c00 * (1.0 - frac[Y]) + c10 * frac[Y]) * (1.0 - frac[Z]) +
+        (c01 * (1.0 - frac[Y]) + c11 * frac[Y]) * frac[Z];
+    return true;
+}
+
+bool MediaGrid::Majorant(const BasicRay& ray, DBL t, DBL& maximum, DBL& exit, MediaGridCache& cache, Sampler& sampler)
+{
+    int brickIndex[3];
+    int local[3];
+    DBL frac[3];
+    POV_UINT64 key;
+    Vector3d p = ray.Evaluate(t);
+
+    if (!Locate(p, brickIndex, local, frac, key) || !GetCachedBrick(key, brickIndex, cache, sampler))
+        return false;
+
+    maximum = cache.brick->maximum;
+
+    DBL brickExtent = DBL(BrickSize) * spacing;
+    DBL distance = HUGE_VAL;
+    for (int axis = X; axis <= Z; axis ++)
+    {
+        DBL lo = DBL(brickIndex[axis]) * brickExtent;
+        if (ray.Direction[axis] > 0.0)
+            distance = min(distance, (lo + brickExtent - p[axis]) / ray.Direction[axis]);
+        else if (ray.Direction[axis] < 0.0)
+            distance = min(distance, (lo - p[axis]) / ray.Direction[axis]);
+    }
+
+    // make sure we advance into the next brick despite any rounding errors
+    exit = t + max(distance, spacing * 1.0e-6);
+    return true;
+}
+
 MediaFunction::MediaFunction(TraceThreadData *td, Trace *t, PhotonGatherer *pg) :
     randomNumbers(0.0, 1.0, 32768),
     randomNumberGenerator(&randomNumbers),
@@ -294,6 +469,7 @@ void MediaFunction::ComputeMedia(MediaVector& medias, const Ray& ray, Intersecti
     bool ignore_photons = true;
     bool use_extinction = false;
     bool use_scattering = false;
+    bool all_bounded = true;    // do we know the maximum density of all the media?
     int minSamples;
     DBL aa_threshold = HUGE_VAL;
 
@@ -322,6 +498,9 @@ void MediaFunction::ComputeMedia(MediaVector& medias, const Ray& ray, Intersecti
         // NK fast light_ray media calculation for constant media
         for (vector<PIGMENT*>::iterator ii = (*i)->Density.begin(); ii != (*i)->Density.end(); ++ ii)
             all_constant_and_light_ray = all_constant_and_light_ray && ((*ii)->Type == PLAIN_PATTERN);
+
+        // tracking needs a majorant of the density
+        all_bounded = all_bounded && ((*i)->Density_Bound >= 0.0);
     }
 
     // If this is a light ray and no extinction is used we can return.
@@ -332,6 +511,13 @@ void MediaFunction::ComputeMedia(MediaVector& medias, const Ray& ray, Intersecti
     if(!ray.IsShadowTestRay())
         ComputeMediaLightInterval(lights, litintervals, ray, isect);
 
+    // Track the ray through the media instead of sampling fixed intervals.
+    if((IMedia->Sample_Method == 4) && all_bounded && !all_constant_and_light_ray)
+    {
+        ComputeMediaTracking(medias, lights, ray, isect, aa_threshold, use_scattering, colour, transm);
+        return;
+    }
+
     if(litintervals.empty())
         litintervals.push_back(LitInterval(false, 0.0, isect.Depth, 0, 0));
 
@@ -355,7 +541,8 @@ void MediaFunction::ComputeMedia(MediaVector& medias, const Ray& ray, Intersecti
     minSamples = IMedia->Min_Samples;
 
     // Sample all intervals.
-    if((IMedia->Sample_Method == 3) && !all_constant_and_light_ray) //  adaptive sampling
+    // (Tracking falls back to adaptive sampling if the density of any of the media cannot be bounded.)
+    if((IMedia->Sample_Method >= 3) && !all_constant_and_light_ray) //  adaptive sampling
         ComputeMediaAdaptiveSampling(medias, lights, mediaintervals, ray, IMedia, aa_threshold, minSamples, ignore_photons, use_scattering);
     else
         ComputeMediaRegularSampling(medias, lights, mediaintervals, ray, IMedia, minSamples, ignore_photons, use_scattering, all_constant_and_light_ray);
@@ -500,6 +687,125 @@ void MediaFunction::ComputeMediaAdaptiveSampling(MediaVector& medias, LightSourc
     }
 }
 
+/*****************************************************************************
+* INPUT
+*   Ray       - Current ray, start point P0
+*   Inter     - Current intersection, end point P1
+*   threshold - Throughput below which tracking is terminated by russian roulette
+*   Colour    - Color emitted at P1 towards P0
+* OUTPUT
+*   Colour    - Color arriving at the end point
+* DESCRIPTION
+*   Integrate the media along the ray using ratio tracking: tentative
+*   collisions are placed along the ray at a rate given by a majorant of the
+*   media coefficients, and at each collision the throughput is scaled by the
+*   fraction of the majorant that is not actual extinction. Emission and
+*   in-scattered light are accumulated at each collision, weighted by the
+*   throughput and divided by the rate. The majorant is taken from the baked
+*   density grid brick by brick where available, so that empty space is
+*   stepped over in a single step, and from the bounds of the density
+*   pigments elsewhere. Media with constant density are attenuated
+*   analytically.
+******************************************************************************/
+
+void MediaFunction::ComputeMediaTracking(MediaVector& medias, LightSourceEntryVector& lights, const Ray& ray, const Intersection& isect,
+                                         DBL threshold, bool use_scattering, MathColour& colour, ColourChannel& transm)
+{
+    bool shadowRay = ray.IsShadowTestRay();
+    bool inScattering = !shadowRay && use_scattering && !ray.IsPhotonRay();
+    MathColour constantExtinction;
+    MathColour throughput(1.0);
+    MathColour emitted;
+    MathColour Extinction, Emission, Scattering;
+    DBL t = 0.0;
+    bool terminated = false;
+
+    for(MediaVector::iterator i(medias.begin()); i != medias.end(); i++)
+    {
+        if((*i)->is_constant)
+            constantExtinction += (*i)->Extinction;
+    }
+
+    while((t < isect.Depth) && !terminated)
+    {
+        // Find the majorant for the region ahead.
+        DBL rate = 0.0;
+        DBL end = isect.Depth;
+        for(MediaVector::iterator i(medias.begin()); i != medias.end(); i++)
+        {
+            // Constant media have no effect on shadow rays other than the analytic attenuation.
+            if((*i)->is_constant && shadowRay)
+                continue;
+
+            DBL density = (*i)->Density_Bound;
+            if((*i)->Grid)
+            {
+                DBL gridDensity, exit;
+                MediaDensitySampler sampler((*i)->Density, threadData);
+                if((*i)->Grid->Majorant(ray, t, gridDensity, exit, GetGridCache((*i)->Grid.get()), sampler))
+                {
+                    density = min(density, gridDensity);
+                    end = min(end, exit);
+                }
+            }
+
+            DBL coefficient = (*i)->Extinction.MaxAbs();
+            if(!shadowRay)
+                coefficient = max(coefficient, DBL((*i)->Emission.MaxAbs()));
+            rate += density * coefficient;
+        }
+
+        // Place tentative collisions within the region.
+        while(true)
+        {
+            DBL step = (rate > 0.0) ? -log(1.0 - randomNumberGenerator()) / rate : HUGE_VAL;
+            if(t + step >= end)
+            {
+                throughput *= Exp(-constantExtinction * (end - t));
+                t = end;
+                break;
+            }
+
+            t += step;
+            throughput *= Exp(-constantExtinction * step);
+
+            threadData->Stats()[Media_Samples]++;
+
+            Vector3d H = ray.Evaluate(t);
+            ComputeMediaCoefficients(medias, H, shadowRay, Extinction, Emission, Scattering);
+
+            if(!shadowRay)
+            {
+                if(inScattering)
+                    ComputeMediaInScattering(medias, lights, 0, lights.size() - 1, ray, t, H, Emission, Scattering, !lights.empty());
+                emitted += throughput * Emission / rate;
+            }
+
+            // Scale by the probability of the collision being a null collision.
+            MathColour nullFraction = MathColour(1.0) - (Extinction - constantExtinction) / rate;
+            for(int iChannel = 0; iChannel < nullFraction.channels; ++iChannel)
+                nullFraction[iChannel] = max(nullFraction[iChannel], 0.0f);
+            throughput *= nullFraction;
+
+            // Russian roulette once little light is left to come through.
+            ColourChannel weight = throughput.MaxAbs();
+            if(weight < threshold)
+            {
+                if(randomNumberGenerator() * threshold >= weight)
+                {
+                    throughput.Clear();
+                    terminated = true;
+                    break;
+                }
+                throughput *= ColourChannel(threshold / weight);
+            }
+        }
+    }
+
+    colour = colour * throughput + emitted;
+    transm *= throughput.Greyscale(); // TODO - in the long run, we should make transm a full-fledged RGB term
+}
+
 void MediaFunction::ComputeMediaColour(MediaIntervalVector& mediaintervals, MathColour& colour, ColourChannel& transm)
 {
     MathColour Od, Te;
@@ -923,6 +1229,17 @@ bool MediaFunction::ComputeCylinderLightInterval(const Ray &ray, const LightSour
     return false;
 }
 
+MediaGridCache& MediaFunction::GetGridCache(const MediaGrid *grid)
+{
+    for (std::vector<GridCacheEntry>::iterator i = gridCache.begin(); i != gridCache.end(); ++ i)
+        if (i->grid == grid)
+            return i->cache;
+
+    gridCache.push_back(GridCacheEntry());
+    gridCache.back().grid = grid;
+    return gridCache.back().cache;
+}
+
 /*****************************************************************************
 * INPUT
 *   dist  - distance of current sample
@@ -936,11 +1253,9 @@ void MediaFunction::ComputeOneMediaSample(MediaVector& medias, LightSourceEntryV
                                           MathColour& SampOptDepth, int sample_method, bool ignore_photons, bool use_scattering, bool photonPass)
 {
     // NK samples - moved d0 to parameter list
-    DBL d1, len;
-    Vector3d P, H;
-    MathColour C0, Light_Colour;
+    DBL d1;
+    Vector3d H;
     MathColour Emission, Extinction, Scattering;
-    Ray Light_Ray(ray);
 
     threadData->Stats()[Media_Samples]++;
 
@@ -950,20 +1265,7 @@ void MediaFunction::ComputeOneMediaSample(MediaVector& medias, LightSourceEntryV
     H = ray.Evaluate(d1);
 
     // Get coefficients in current sample location.
-    for(MediaVector::iterator i(medias.begin()); i != medias.end(); i++)
-    {
-        P = H;
-
-        Evaluate_Density_Pigment((*i)->Density, P, C0, threadData);
-
-        Extinction += C0 * (*i)->Extinction;
-
-        if(!ray.IsShadowTestRay())
-        {
-            Emission   += C0 * (*i)->Emission;
-            Scattering += C0 * (*i)->Scattering;
-        }
-    }
+    ComputeMediaCoefficients(medias, H, ray.IsShadowTestRay(), Extinction, Emission, Scattering);
 
     // Get estimate for the total optical depth of the current interval.
     SampOptDepth = Extinction * mediainterval.ds;
@@ -972,45 +1274,7 @@ void MediaFunction::ComputeOneMediaSample(MediaVector& medias, LightSourceEntryV
         mediainterval.od += SampOptDepth;
 
     if(!ray.IsShadowTestRay() && use_scattering && !ray.IsPhotonRay())
-    {
-        if(mediainterval.lit)
-        {
-            // note for performance: we could skip this if there are no photons (surface or media)
-
-            // determine whether or not this media is ignoring photons
-            // save this in the thread data... it will be used by ComputeShadowColour
-            // TODO - maybe this should be (or already is?) computed elsewhere and passed in
-            //        as a parameter ( see the ignore_photons parameter! )
-            //        I need to look closer at the new code to clean that up [NK]
-            // assume true, set to false if we find even one
-            threadData->litObjectIgnoresPhotons = true;
-            for(MediaVector::iterator i(medias.begin()); i != medias.end(); i++)
-            {
-                if(!(*i)->ignore_photons)
-                {
-                    threadData->litObjectIgnoresPhotons = false;
-                    break;
-                }
-            }
-
-            // Process all light sources.
-            for(size_t i = mediainterval.l0; i <= mediainterval.l1; i++)
-            {
-                // Use light only if active and within it's boundaries.
-                if((d1 >= lights[i].s0) && (d1 <= lights[i].s1))
-                {
-                    if(!(trace->TestShadow(*lights[i].light, len, Light_Ray, P, Light_Colour)))
-                        ComputeMediaScatteringAttenuation(medias, Emission, Scattering, Light_Colour, ray, Light_Ray);
-                }
-            }
-        }
-
-        // process media photons whether or not the interval is directly lit
-        if((photonGatherer != nullptr) && (photonGatherer->map->numPhotons > 0))
-        {
-            ComputeMediaPhotons(medias, Emission, Scattering, ray, H);
-        }
-    }
+        ComputeMediaInScattering(medias, lights, mediainterval.l0, mediainterval.l1, ray, d1, H, Emission, Scattering, mediainterval.lit);
 
     if(sample_method == 3)
     {
@@ -1037,6 +1301,87 @@ void MediaFunction::ComputeOneMediaSample(MediaVector& medias, LightSourceEntryV
     mediainterval.samples++;
 }
 
+void MediaFunction::ComputeMediaCoefficients(MediaVector& medias, const Vector3d& H, bool shadowRay, MathColour& Extinction, MathColour& Emission, MathColour& Scattering)
+{
+    MathColour C0;
+
+    Extinction.Clear();
+    Emission.Clear();
+    Scattering.Clear();
+
+    for(MediaVector::iterator i(medias.begin()); i != medias.end(); i++)
+    {
+        if ((*i)->Grid)
+        {
+            MediaDensitySampler sampler((*i)->Density, threadData);
+            if (!(*i)->Grid->Evaluate(H, C0, GetGridCache((*i)->Grid.get()), sampler))
+                sampler(H, C0);
+        }
+        else
+            Evaluate_Density_Pigment((*i)->Density, H, C0, threadData);
+
+        Extinction += C0 * (*i)->Extinction;
+
+        if(!shadowRay)
+        {
+            Emission   += C0 * (*i)->Emission;
+            Scattering += C0 * (*i)->Scattering;
+        }
+    }
+}
+
+void MediaFunction::ComputeMediaInScattering(MediaVector& medias, LightSourceEntryVector& lights, size_t l0, size_t l1, const Ray& ray, DBL d, const Vector3d& H,
+                                             MathColour& Emission, const MathColour& Scattering, bool lit)
+{
+    DBL len;
+    MathColour Light_Colour;
+    Ray Light_Ray(ray);
+
+    if(lit)
+    {
+        // note for performance: we could skip this if there are no photons (surface or media)
+
+        // determine whether or not this media is ignoring photons
+        // save this in the thread data... it will be used by ComputeShadowColour
+        // TODO - maybe this should be (or already is?) computed elsewhere and passed in
+        //        as a parameter ( see the ignore_photons parameter! )
+        //        I need to look closer at the new code to clean that up [NK]
+        // assume true, set to false if we find even one
+        threadData->litObjectIgnoresPhotons = true;
+        for(MediaVector::iterator i(medias.begin()); i != medias.end(); i++)
+        {
+            if(!(*i)->ignore_photons)
+            {
+                threadData->litObjectIgnoresPhotons = false;
+                break;
+            }
+        }
+
+        // Process all light sources.
+        for(size_t i = l0; i <= l1; i++)
+        {
+            // Use light only if active and within it's boundaries.
+            if((d >= lights[i].s0) && (d <= lights[i].s1))
+            {
+                const LightSource& light = *lights[i].light;
+                bool shadowed;
+                if (light.Media_Grid)
+                    shadowed = trace->TestShadow(light, *light.Media_Grid, GetGridCache(light.Media_Grid.get()), len, Light_Ray, H, Light_Colour);
+                else
+                    shadowed = trace->TestShadow(light, len, Light_Ray, H, Light_Colour);
+                if(!shadowed)
+                    ComputeMediaScatteringAttenuation(medias, Emission, Scattering, Light_Colour, ray, Light_Ray);
+            }
+        }
+    }
+
+    // process media photons whether or not the interval is directly lit
+    if((photonGatherer != nullptr) && (photonGatherer->map->numPhotons > 0))
+    {
+        ComputeMediaPhotons(medias, Emission, Scattering, ray, H);
+    }
+}
+
 void MediaFunction::ComputeOneMediaSampleRecursive(MediaVector& medias, LightSourceEntryVector& lights, MediaInterval& mediainterval, const Ray& ray,
                                                    DBL d1, DBL d3, MathColour& Result, const MathColour& C1, const MathColour& C3, MathColour& ODResult, const MathColour& od1, const MathColour& od3,
                                                    int depth, DBL Jitter, DBL aa_threshold, bool ignore_photons, bool use_scattering, bool photonPass)
@@ -1139,6 +1484,25 @@ void MediaFunction::ComputeMediaPhotons(MediaVector& medias, MathColour& Te, con
         // statistics
         threadData->Stats()[Gather_Performed_Count]++;
 
+        // the nearest precomputed irradiance estimate, if any, stands for all the photons around it,
+        // already divided by the volume they were gathered from
+        const PhotonMap& estimates = threadData->GetSceneData()->mediaIrradianceMap;
+        if(estimates.numPhotons > 0)
+        {
+            const Photon* estimate = estimates.findNearestPhoton(H, threadData->GetSceneData()->mediaPhotonMap.minGatherRad);
+            if(estimate != nullptr)
+            {
+                Light_Colour = ToMathColour(RGBColour(estimate->colour));
+                Light_Ray.Direction = estimate->GetDirection();
+                Light_Ray.Origin = Vector3d(estimate->Loc) - Light_Ray.Direction;
+
+                Colour2.Clear();
+                ComputeMediaScatteringAttenuation(medias, Colour2, Sc, Light_Colour, ray, Light_Ray);
+                Te += Colour2;
+                return;
+            }
+        }
+
         if(photonGatherer->gathered)
             r = photonGatherer->alreadyGatheredRadius;
         else
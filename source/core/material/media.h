@@ -43,6 +43,10 @@
 //  (none at the moment)
 
 // C++ standard header files
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 
 // POV-Ray header files (base module)
@@ -74,6 +78,82 @@ enum
 
 void Transform_Density(std::vector<PIGMENT*>& Density, const TRANSFORM *Trans);
 
+/// Lazily baked colour-valued field, sampled on a regular grid.
+///
+/// This is used to cache both the density of a media and the visibility of a light source
+/// as seen from within media.
+///
+/// The grid is aligned with the scene coordinate axes and organized in bricks of
+/// @ref BrickSize^3 cells, each of which is baked on first access and shared by all
+/// threads. Once the memory cap is reached, no further bricks are baked, and the
+/// field must be evaluated directly instead.
+///
+class MediaGrid final
+{
+    public:
+
+        static const int BrickSize = 8;
+        static const int BrickSamples = BrickSize + 1;
+
+        struct Brick final
+        {
+            MathColour samples[BrickSamples * BrickSamples * BrickSamples];
+            ColourChannel maximum; ///< Largest magnitude of any channel of any sample, bounding the interpolated field.
+        };
+        typedef std::shared_ptr<const Brick> BrickPtr;
+
+        /// Function computing the samples of the field.
+        class Sampler
+        {
+            public:
+                virtual ~Sampler() {}
+                virtual void operator()(const Vector3d& p, MathColour& c) = 0;
+        };
+
+        /// @param[in]  spacing     Size of the grid cells.
+        /// @param[in]  memory      Memory cap in MiB.
+        MediaGrid(DBL spacing, DBL memory);
+
+        /// Get the trilinearly interpolated field at a given point.
+        /// @return     `false` if the point is not covered by the grid and the field must be evaluated directly.
+        bool Evaluate(const Vector3d& p, MathColour& c, MediaGridCache& cache, Sampler& sampler);
+
+        /// Get an upper bound of the interpolated field within the brick a ray is passing through.
+        /// @param[in]  ray         Ray to follow.
+        /// @param[in]  t           Distance along the ray.
+        /// @param[out] maximum     Largest magnitude of any channel of the field within the brick.
+        /// @param[out] exit        Distance along the ray at which it leaves the brick.
+        /// @return     `false` if the point is not covered by the grid and the field must be evaluated directly.
+        bool Majorant(const BasicRay& ray, DBL t, DBL& maximum, DBL& exit, MediaGridCache& cache, Sampler& sampler);
+
+    private:
+
+        static const int ShardCount = 64;
+
+        struct Shard final
+        {
+            std::mutex                                  mutex;
+            std::unordered_map<POV_UINT64, BrickPtr>    bricks;
+        };
+
+        DBL                 spacing;
+        DBL                 invSpacing;
+        size_t              maxBricks;
+        std::atomic<size_t> brickCount;
+        Shard               shards[ShardCount];
+
+        BrickPtr GetBrick(POV_UINT64 key, const int brickIndex[3], Sampler& sampler);
+        bool Locate(const Vector3d& p, int brickIndex[3], int local[3], DBL frac[3], POV_UINT64& key) const;
+        bool GetCachedBrick(POV_UINT64 key, const int brickIndex[3], MediaGridCache& cache, Sampler& sampler);
+};
+
+/// Most recently used brick of a @ref MediaGrid, to be kept by each thread.
+struct MediaGridCache final
+{
+    POV_UINT64          key;
+    MediaGrid::BrickPtr brick;
+};
+
 class MediaFunction : public Trace::MediaFunctor
 {
     public:
@@ -94,11 +174,23 @@ class MediaFunction : public Trace::MediaFunctor
         /// photon gather functions
         PhotonGatherer *photonGatherer;
 
+        struct GridCacheEntry final
+        {
+            const MediaGrid    *grid;
+            MediaGridCache      cache;
+        };
+        /// most recently used media and light visibility grid bricks, by grid
+        std::vector<GridCacheEntry> gridCache;
+
+        MediaGridCache& GetGridCache(const MediaGrid *grid);
+
         void ComputeMediaRegularSampling(MediaVector& medias, LightSourceEntryVector& lights, MediaIntervalVector& mediaintervals,
                                          const Ray& ray, const Media *IMedia, int minsamples, bool ignore_photons, bool use_scattering,
                                          bool all_constant_and_light_ray);
         void ComputeMediaAdaptiveSampling(MediaVector& medias, LightSourceEntryVector& lights, MediaIntervalVector& mediaintervals,
                                           const Ray& ray, const Media *IMedia, DBL aa_threshold, int minsamples, bool ignore_photons, bool use_scattering);
+        void ComputeMediaTracking(MediaVector& medias, LightSourceEntryVector& lights, const Ray& ray, const Intersection& isect,
+                                  DBL threshold, bool use_scattering, MathColour& colour, ColourChannel& transm);
         void ComputeMediaColour(MediaIntervalVector& mediaintervals, MathColour& colour, ColourChannel& transm);
         void ComputeMediaSampleInterval(LitIntervalVector& litintervals, MediaIntervalVector& mediaintervals, const Media *media);
         void ComputeMediaLightInterval(LightSourceEntryVector& lights, LitIntervalVector& litintervals, const Ray& ray, const Intersection& isect);
@@ -107,6 +199,9 @@ class MediaFunction : public Trace::MediaFunctor
         bool ComputeCylinderLightInterval(const Ray &ray, const LightSource *Light, DBL *d1, DBL *d2);
         void ComputeOneMediaSample(MediaVector& medias, LightSourceEntryVector& lights, MediaInterval& mediainterval, const Ray &ray, DBL d0, MathColour& SampCol,
                                    MathColour& SampOptDepth, int sample_method, bool ignore_photons, bool use_scattering, bool photonPass);
+        void ComputeMediaCoefficients(MediaVector& medias, const Vector3d& H, bool shadowRay, MathColour& Extinction, MathColour& Emission, MathColour& Scattering);
+        void ComputeMediaInScattering(MediaVector& medias, LightSourceEntryVector& lights, size_t l0, size_t l1, const Ray& ray, DBL d, const Vector3d& H,
+                                      MathColour& Emission, const MathColour& Scattering, bool lit);
         void ComputeOneMediaSampleRecursive(MediaVector& medias, LightSourceEntryVector& lights, MediaInterval& mediainterval, const Ray& ray,
                                             DBL d1, DBL d3, MathColour& Result, const MathColour& C1, const MathColour& C3, MathColour& ODResult, const MathColour& od1, const MathColour& od3,
                                             int depth, DBL Jitter, DBL aa_threshold, bool ignore_photons, bool use_scattering, bool photonPass);
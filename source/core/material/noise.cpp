@@ -523,8 +523,19 @@ DBL Turbulence(const Vector3d& EPoint, const GenericTurbulenceWarp *Turb, int no
 {
     int i;
     DBL Lambda, Omega, l, o, value;
-    Vector3d temp;
-    int Octaves=Turb->Octaves;
+    Vector3d points[kMaxTurbulenceOctaves];
+    DBL noise[kMaxTurbulenceOctaves];
+    int Octaves=min(Turb->Octaves, kMaxTurbulenceOctaves);
+
+    // evaluate all octaves in a single batch
+    points[0] = EPoint;
+    l = Lambda = Turb->Lambda;
+    for (i = 1; i < Octaves; i++)
+    {
+        points[i] = EPoint * l;
+        l *= Lambda;
+    }
+    MultiNoise(noise, points, Octaves, noise_generator);
 
     // TODO - This distinction (with minor variations that seem to be more of an inconsistency rather than intentional)
     // appears in other places as well; make it a function.
@@ -532,37 +543,31 @@ DBL Turbulence(const Vector3d& EPoint, const GenericTurbulenceWarp *Turb, int no
     {
         case kNoiseGen_Default:
         case kNoiseGen_Original:
-            value = Noise(EPoint, noise_generator);
+            value = noise[0];
             break;
         default:
-            value = (2.0 * Noise(EPoint, noise_generator) - 0.5);
+            value = (2.0 * noise[0] - 0.5);
             value = min(max(value,0.0),1.0);
             break;
     }
 
-    l = Lambda = Turb->Lambda;
     o = Omega  = Turb->Omega;
 
-    for (i = 2; i <= Octaves; i++)
+    for (i = 1; i < Octaves; i++)
     {
-        temp = EPoint * l;
         // TODO - This distinction (with minor variations that seem to be more of an inconsistency rather than intentional)
         // appears in other places as well; make it a function.
         switch(noise_generator)
         {
             case kNoiseGen_Default:
             case kNoiseGen_Original:
-                value += o * Noise(temp, noise_generator);
+                value += o * noise[i];
                 break;
             default:
-                value += o * (2.0 * Noise(temp, noise_generator) - 0.5); // TODO similar code clips the (2.0 * Noise(temp, noise_generator) - 0.5) term
+                value += o * (2.0 * noise[i] - 0.5); // TODO similar code clips the (2.0 * Noise(temp, noise_generator) - 0.5) term
                 break;
         }
-        if (i < Octaves)
-        {
-            l *= Lambda;
-            o *= Omega;
-        }
+        o *= Omega;
     }
     return (value);
 }
@@ -604,29 +609,110 @@ void DTurbulence(Vector3d& result, const Vector3d& EPoint, const GenericTurbulen
     DBL Omega, Lambda;
     int i;
     DBL l, o;
-    Vector3d value, temp;
-    int Octaves=Turb->Octaves;
+    Vector3d points[kMaxTurbulenceOctaves];
+    Vector3d values[kMaxTurbulenceOctaves];
+    int Octaves=min(Turb->Octaves, kMaxTurbulenceOctaves);
 
-    result[X] = result[Y] = result[Z] = 0.0;
-    value[X]  = value[Y]  = value[Z]  = 0.0;
+    // evaluate all octaves in a single batch
+    points[0] = EPoint;
+    l = Lambda = Turb->Lambda;
+    for (i = 1; i < Octaves; i++)
+    {
+        points[i] = EPoint * l;
+        l *= Lambda;
+    }
+    MultiDNoise(values, points, Octaves);
 
-    DNoise(result, EPoint);
+    result = values[0];
 
-    l = Lambda = Turb->Lambda;
     o = Omega  = Turb->Omega;
 
-    for (i = 2; i <= Octaves; i++)
+    for (i = 1; i < Octaves; i++)
     {
-        temp = EPoint * l;
+        result += o * values[i];
+        o *= Omega;
+    }
+}
 
-        DNoise(value, temp);
-        result += o * value;
-        if (i < Octaves)
-        {
-            l *= Lambda;
-            o *= Omega;
-        }
+void PortableMultiNoise(DBL* results, const Vector3d* EPoints, size_t count, int noise_generator)
+{
+    for (size_t i = 0; i < count; i++)
+        results[i] = PortableNoise(EPoints[i], noise_generator);
+}
+
+void PortableMultiDNoise(Vector3d* results, const Vector3d* EPoints, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        PortableDNoise(results[i], EPoints[i]);
+}
+
+/// @note
+///     This follows the lattice noise computation of @ref PortableNoise(), differentiating each
+///     corner's contribution by the product rule. The Perlin noise generator is not supported.
+///
+bool NoiseGradient(DBL& value, Vector3d& gradient, const Vector3d& EPoint, int noise_generator)
+{
+    if (noise_generator == kNoiseGen_Perlin)
+        return false;
+
+    static const int kNoiseMin[3] = { NOISE_MINX, NOISE_MINY, NOISE_MINZ };
+    int lattice[3];
+    DBL frac[3], s[3], ds[3];
+
+    for (int i = X; i <= Z; i++)
+    {
+        // same integer lattice point computation as in PortableNoise()
+        int tmp = (EPoint[i] >= 0) ? (int)EPoint[i] : (int)(EPoint[i] - (1 - EPSILON));
+        lattice[i] = (int)((tmp - kNoiseMin[i]) & 0xFFF);
+        frac[i] = EPoint[i] - tmp;
+        s[i]  = frac[i] * frac[i] * (3.0 - 2.0 * frac[i]);
+        ds[i] = 6.0 * frac[i] * (1.0 - frac[i]);
+    }
+
+    DBL sum = 0.0;
+    gradient = Vector3d(0.0);
+
+    for (int corner = 0; corner < 8; corner++)
+    {
+        int jx = (corner & 1), jy = ((corner >> 1) & 1), jz = ((corner >> 2) & 1);
+
+        DBL wx = jx ? s[X] : 1.0 - s[X], dwx = jx ? ds[X] : -ds[X];
+        DBL wy = jy ? s[Y] : 1.0 - s[Y], dwy = jy ? ds[Y] : -ds[Y];
+        DBL wz = jz ? s[Z] : 1.0 - s[Z], dwz = jz ? ds[Z] : -ds[Z];
+
+        const DBL *mp = &RTable[Hash1dRTableIndex(Hash2d(lattice[X] + jx, lattice[Y] + jy), lattice[Z] + jz)];
+        DBL ramp = mp[1] + mp[2] * (frac[X] - jx) + mp[4] * (frac[Y] - jy) + mp[6] * (frac[Z] - jz);
+        DBL weight = wx * wy * wz;
+
+        sum += weight * ramp;
+        gradient[X] += dwx * wy * wz * ramp + weight * mp[2];
+        gradient[Y] += wx * dwy * wz * ramp + weight * mp[4];
+        gradient[Z] += wx * wy * dwz * ramp + weight * mp[6];
+    }
+
+    if (noise_generator == kNoiseGen_RangeCorrected)
+    {
+        // same range correction as in PortableNoise()
+        sum = (sum + 1.05242) * 0.48985582;
+        gradient *= 0.48985582;
     }
+    else
+        sum += 0.5;
+
+    // clamped values are flat
+    if (sum < 0.0)
+    {
+        sum = 0.0;
+        gradient = Vector3d(0.0);
+    }
+    else if (sum > 1.0)
+    {
+        sum = 1.0;
+        gradient = Vector3d(0.0);
+    }
+
+    value = sum;
+    return true;
 }
 
 
@@ -634,6 +720,22 @@ void DTurbulence(Vector3d& result, const Vector3d& EPoint, const GenericTurbulen
 
 NoiseFunction Noise;
 DNoiseFunction DNoise;
+MultiNoiseFunction MultiNoise;
+MultiDNoiseFunction MultiDNoise;
+
+/// Fallback for implementations without a dedicated multi-point noise function.
+static void DispatchedMultiNoise(DBL* results, const Vector3d* EPoints, size_t count, int noise_generator)
+{
+    for (size_t i = 0; i < count; i++)
+        results[i] = Noise(EPoints[i], noise_generator);
+}
+
+/// Fallback for implementations without a dedicated multi-point noise function.
+static void DispatchedMultiDNoise(Vector3d* results, const Vector3d* EPoints, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        DNoise(results[i], EPoints[i]);
+}
 
 /*****************************************************************************
 *
@@ -675,6 +777,8 @@ void Initialise_NoiseDispatch()
         if (pNoiseImpl->init) pNoiseImpl->init();
         Noise = pNoiseImpl->noise;
         DNoise = pNoiseImpl->dNoise;
+        MultiNoise = (pNoiseImpl->multiNoise ? pNoiseImpl->multiNoise : DispatchedMultiNoise);
+        MultiDNoise = (pNoiseImpl->multiDNoise ? pNoiseImpl->multiDNoise : DispatchedMultiDNoise);
     }
 }
 
@@ -683,6 +787,8 @@ OptimizedNoiseInfo gPortableNoiseInfo = {
     "portable",     // info,
     PortableNoise,  // noise,
     PortableDNoise, // dNoise,
+    PortableMultiNoise,  // multiNoise,
+    PortableMultiDNoise, // multiDNoise,
     nullptr,        // enabled,
     nullptr,        // supported,
     nullptr,        // recommended,
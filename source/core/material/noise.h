@@ -40,7 +40,7 @@
 #include "core/configcore.h"
 
 // C++ variants of C standard header files
-//  (none at the moment)
+#include <cstddef>
 
 // C++ standard header files
 #include <string>
@@ -116,10 +116,30 @@ DBL SolidNoise(const Vector3d& P);
 DBL PortableNoise(const Vector3d& EPoint, int noise_generator);
 void PortableDNoise(Vector3d& result, const Vector3d& EPoint);
 
+/// Evaluate @ref PortableNoise() for multiple points.
+void PortableMultiNoise(DBL* results, const Vector3d* EPoints, size_t count, int noise_generator);
+/// Evaluate @ref PortableDNoise() for multiple points.
+void PortableMultiDNoise(Vector3d* results, const Vector3d* EPoints, size_t count);
+
+/// Evaluate the noise function along with its gradient.
+///
+/// @param[out] value           The noise value, as @ref Noise() would return it (except for rounding).
+/// @param[out] gradient        The gradient of the noise value.
+/// @param[in]  EPoint          The point at which to evaluate the noise.
+/// @param[in]  noise_generator The noise generator to use; one of @ref NoiseGenType.
+/// @return                     `false` if no analytic gradient is available for the noise generator.
+///
+bool NoiseGradient(DBL& value, Vector3d& gradient, const Vector3d& EPoint, int noise_generator);
+
+/// Maximum number of points passed to @ref MultiNoise() or @ref MultiDNoise() by the turbulence functions.
+const int kMaxTurbulenceOctaves = 10;
+
 #ifdef TRY_OPTIMIZED_NOISE
 
 typedef DBL(*NoiseFunction) (const Vector3d& EPoint, int noise_generator);
 typedef void(*DNoiseFunction) (Vector3d& result, const Vector3d& EPoint);
+typedef void(*MultiNoiseFunction) (DBL* results, const Vector3d* EPoints, size_t count, int noise_generator);
+typedef void(*MultiDNoiseFunction) (Vector3d* results, const Vector3d* EPoints, size_t count);
 
 /// Optimized noise dispatch information.
 struct OptimizedNoiseInfo final
@@ -149,6 +169,14 @@ struct OptimizedNoiseInfo final
     /// Pointer to the optimized implementation of @ref PortableDNoise().
     DNoiseFunction dNoise;
 
+    /// Pointer to the optimized implementation of @ref PortableMultiNoise().
+    /// A value of `nullptr` indicates that @ref noise is to be called for each point.
+    MultiNoiseFunction multiNoise;
+
+    /// Pointer to the optimized implementation of @ref PortableMultiDNoise().
+    /// A value of `nullptr` indicates that @ref dNoise is to be called for each point.
+    MultiDNoiseFunction multiDNoise;
+
     /// Pointer to a constant indicating whether the implementation is enabled in the binary.
     const bool* enabled;
 
@@ -188,6 +216,8 @@ const OptimizedNoiseInfo* GetOptimizedNoise(const std::string& name);
 
 extern NoiseFunction Noise;
 extern DNoiseFunction DNoise;
+extern MultiNoiseFunction MultiNoise;
+extern MultiDNoiseFunction MultiDNoise;
 
 void Initialise_NoiseDispatch();
 
@@ -195,6 +225,8 @@ void Initialise_NoiseDispatch();
 
 inline DBL Noise(const Vector3d& EPoint, int noise_generator) { return PortableNoise(EPoint, noise_generator); }
 inline void DNoise(Vector3d& result, const Vector3d& EPoint) { PortableDNoise(result, EPoint); }
+inline void MultiNoise(DBL* results, const Vector3d* EPoints, size_t count, int noise_generator) { PortableMultiNoise(results, EPoints, count, noise_generator); }
+inline void MultiDNoise(Vector3d* results, const Vector3d* EPoints, size_t count) { PortableMultiDNoise(results, EPoints, count); }
 
 #endif // TRY_OPTIMIZED_NOISE
 
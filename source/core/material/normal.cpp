@@ -326,14 +326,20 @@ static void wrinkles (const Vector3d& EPoint, const TNORMAL *Tnormal, Vector3d&
 {
     int i;
     DBL scale = 1.0;
-    Vector3d result, value, value2;
+    Vector3d result, value, value2[10];
+    Vector3d values[10];
 
     result = Vector3d(0.0, 0.0, 0.0);
 
+    // evaluate all octaves in a single batch
+    for (i = 0; i < 10; scale *= 2.0, i++)
+        value2[i] = EPoint * scale;
+    MultiDNoise(values, value2, 10);
+
+    scale = 1.0;
     for (i = 0; i < 10; scale *= 2.0, i++)
     {
-        value2 = EPoint * scale;
-        DNoise(value, value2);
+        value = values[i];
 
         result[X] += fabs(value[X] / scale);
         result[Y] += fabs(value[Y] / scale);
@@ -733,6 +739,9 @@ void Post_Tnormal (TNORMAL *Tnormal)
 
         Tnormal->Flags |= POST_DONE;
 
+        if (Tnormal->pattern)
+            Optimize_Warps(Tnormal->pattern->warps);
+
         if ((Map = Tnormal->Blend_Map) != nullptr)
         {
             Map->Post((Tnormal->Flags & DONT_SCALE_BUMPS_FLAG) != 0);
@@ -820,7 +829,7 @@ void Perturb_Normal(Vector3d& Layer_Normal, const TNORMAL *Tnormal, const Vector
             DBL prevWeight, curWeight;
 
             /* NK 19 Nov 1999 added Warp_EPoint */
-            Warp_EPoint (TPoint, EPoint, Tnormal);
+            Warp_EPoint (TPoint, EPoint, Tnormal, Thread);
             value1 = Evaluate_TPat(Tnormal, TPoint, Intersection, ray, Thread);
 
             Blend_Map->Search (value1,Prev,Cur,prevWeight,curWeight);
@@ -828,7 +837,7 @@ void Perturb_Normal(Vector3d& Layer_Normal, const TNORMAL *Tnormal, const Vector
             Warp_Normal(Layer_Normal,Layer_Normal, Tnormal, Test_Flag(Tnormal,DONT_SCALE_BUMPS_FLAG));
             P1 = Layer_Normal;
 
-            Warp_EPoint (TPoint, EPoint, Tnormal);
+            Warp_EPoint (TPoint, EPoint, Tnormal, Thread);
 
             Perturb_Normal(Layer_Normal,Cur->Vals,TPoint,Intersection,ray,Thread);
 
@@ -857,7 +866,7 @@ void Perturb_Normal(Vector3d& Layer_Normal, const TNORMAL *Tnormal, const Vector
         Warp_Normal(Layer_Normal,Layer_Normal, Tnormal,
                     Test_Flag(Tnormal,DONT_SCALE_BUMPS_FLAG));
 
-        Warp_EPoint (TPoint, EPoint, Tnormal);
+        Warp_EPoint (TPoint, EPoint, Tnormal, Thread);
 
         switch (Tnormal->Type)
         {
@@ -889,13 +898,23 @@ void Perturb_Normal(Vector3d& Layer_Normal, const TNORMAL *Tnormal, const Vector
         Amount*=0.02/Tnormal->Delta; /* NK delta */
 
         /* warp the center point first - this is the last warp */
-        Warp_EPoint(TPoint,EPoint,Tnormal);
+        Warp_EPoint(TPoint,EPoint,Tnormal,Thread);
 
-        for(i=0; i<=3; i++)
+        Vector3d gradient;
+        if ((slopeMap == nullptr) && Tnormal->pattern->EvaluateGradient(gradient, TPoint, Tnormal->Delta, Thread))
+        {
+            // The pyramid vectors below are unit vectors with a sum of outer products of 4/3 times
+            // the identity, so for small deltas the finite differences converge to this.
+            Layer_Normal += (Amount * Tnormal->Delta * 4.0/3.0) * gradient;
+        }
+        else
         {
-            P1 = TPoint + (DBL)Tnormal->Delta * Pyramid_Vect[i]; /* NK delta */
-            value1 = Do_Slope_Map(Evaluate_TPat(Tnormal, P1, Intersection, ray, Thread), slopeMap.get());
-            Layer_Normal += (value1*Amount) * Pyramid_Vect[i];
+            for(i=0; i<=3; i++)
+            {
+                P1 = TPoint + (DBL)Tnormal->Delta * Pyramid_Vect[i]; /* NK delta */
+                value1 = Do_Slope_Map(Evaluate_TPat(Tnormal, P1, Intersection, ray, Thread), slopeMap.get());
+                Layer_Normal += (value1*Amount) * Pyramid_Vect[i];
+            }
         }
 
         UnWarp_Normal(Layer_Normal,Layer_Normal,Tnormal,
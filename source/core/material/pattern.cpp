@@ -67,6 +67,7 @@
 #include "core/scene/tracethreaddata.h"
 #include "core/support/cracklecache.h"
 #include "core/support/imageutil.h"
+#include "core/support/texturecache.h"
 #include "core/support/statistics.h"
 
 // this must be the last file included
@@ -298,6 +299,10 @@ ColourBlendMapConstPtr BasicPattern::GetDefaultBlendMap() const { return gpDefau
 
 bool BasicPattern::HasSpecialTurbulenceHandling() const { return false; }
 
+bool BasicPattern::DependsOnIntersection() const { return false; }
+
+bool BasicPattern::EvaluateGradient(Vector3d& gradient, const Vector3d& EPoint, DBL radius, TraceThreadData *pThread) const { return false; }
+
 
 ImagePatternImpl::ImagePatternImpl() :
     pImage(nullptr)
@@ -391,6 +396,75 @@ DBL ContinuousPattern::Evaluate(const Vector3d& EPoint, const Intersection *pIse
     return value;
 }
 
+bool ContinuousPattern::EvaluateGradient(Vector3d& gradient, const Vector3d& EPoint, DBL radius, TraceThreadData *pThread) const
+{
+    DBL value;
+
+    if (!EvaluateRawGradient(value, gradient, EPoint, radius, pThread))
+        return false;
+
+    if (waveType == kWaveType_Raw)
+        return true;
+
+    DBL period = 1.0;
+    if (waveFrequency != 0.0)
+    {
+        value = value * waveFrequency + wavePhase;
+        gradient *= waveFrequency;
+        period = 1.00001; // must match the magic number in Evaluate()
+    }
+
+    // All wave functions but the sine wave have a jump or kink where the value wraps around,
+    // and the triangle wave also has one half way; leave those to finite differences.
+    if (waveType != kWaveType_Sine)
+    {
+        DBL reach = radius * gradient.length();
+        DBL segments = ((waveType == kWaveType_Triangle) ? 2.0 : 1.0) / period;
+        if (floor((value - reach) * segments) != floor((value + reach) * segments))
+            return false;
+    }
+
+    if (waveFrequency != 0.0)
+        value = fmod(value, period);
+
+    if (value < 0.0)
+        value -= floor(value);
+
+    DBL slope;
+    switch (waveType)
+    {
+        case kWaveType_Ramp:
+            slope = 1.0;
+            break;
+        case kWaveType_Sine:
+            slope = M_PI * cos(value * TWO_M_PI);
+            break;
+        case kWaveType_Triangle:
+            slope = ((value - floor(value) >= 0.5) ? -2.0 : 2.0);
+            break;
+        case kWaveType_Scallop:
+            slope = M_PI * cos(value * M_PI);
+            if (sin(value * M_PI) < 0.0)
+                slope = -slope;
+            break;
+        case kWaveType_Cubic:
+            slope = 6.0 * value * (1.0 - value);
+            break;
+        case kWaveType_Poly:
+            if ((value <= 0.0) && (waveExponent < 1.0))
+                return false;
+            slope = waveExponent * pow(value, (DBL) waveExponent - 1.0);
+            break;
+        default:
+            return false;
+    }
+
+    gradient *= slope;
+    return true;
+}
+
+bool ContinuousPattern::EvaluateRawGradient(DBL& value, Vector3d& gradient, const Vector3d& EPoint, DBL radius, TraceThreadData *pThread) const { return false; }
+
 unsigned int ContinuousPattern::NumDiscreteBlendMapEntries() const { return 0; }
 bool ContinuousPattern::CanMap() const { return true; }
 
@@ -406,6 +480,8 @@ bool AveragePattern::HasSpecialTurbulenceHandling() const { return false; }
 
 AgatePattern::AgatePattern() : agateTurbScale(1.0) {}
 
+bool AOIPattern::DependsOnIntersection() const { return true; }
+
 bool AgatePattern::Precompute()
 {
     return (!warps.empty() && dynamic_cast<ClassicTurbulence*>(*warps.begin()));
@@ -507,12 +583,70 @@ bool ColourImagePattern::Evaluate(TransColour& result, const Vector3d& EPoint, c
     else
     {
         RGBFTColour rgbft;
-        image_colour_at(pImage, xcoor, ycoor, rgbft, &reg_number, false);
+        TextureCache *textureCache = nullptr;
+        DBL lod = 0.0;
+        if ((pThread != nullptr) && (pIsection != nullptr))
+        {
+            textureCache = pThread->GetSceneData()->textureCache.get();
+            DBL radius = pThread->pixelFootprintBase + pThread->pixelFootprintSlope * pIsection->Depth;
+            if ((textureCache != nullptr) && (radius > 0.0))
+                lod = LevelOfDetail(EPoint, xcoor, ycoor, pIsection, pRay, radius);
+        }
+        image_colour_at(pImage, xcoor, ycoor, lod, textureCache, rgbft, &reg_number, false);
         result = ToTransColour(rgbft);
         return true;
     }
 }
 
+DBL ColourImagePattern::LevelOfDetail(const Vector3d& EPoint, DBL xcoor, DBL ycoor, const Intersection *pIsection, const Ray *pRay, DBL radius) const
+{
+    // We estimate the footprint by mapping points offset from the intersection point
+    // along the surface. This only works if the pattern is evaluated at the (warped)
+    // intersection point itself, which is not the case with e.g. UV mapping.
+    Vector3d p = pIsection->IPoint;
+    for (WarpList::const_reverse_iterator iWarp = warps.rbegin(); iWarp != warps.rend(); iWarp ++)
+        (*iWarp)->WarpPoint(p);
+    if ((p - EPoint).lengthSqr() > Sqr(EPSILON * (1.0 + EPoint.length())))
+        return 0.0;
+
+    // Pick one tangent perpendicular to the ray, where the footprint is not stretched,
+    // and one along the projection of the ray, where it is stretched by the obliquity
+    // of the incidence (to a sane maximum).
+    const Vector3d& normal = pIsection->INormal;
+    Vector3d tangent[2];
+    DBL stretch = 1.0;
+    if (pRay != nullptr)
+    {
+        tangent[0] = cross(normal, pRay->Direction);
+        stretch = std::min(1.0 / std::max(fabs(dot(normal, pRay->Direction)), EPSILON), 4.0);
+    }
+    if ((pRay == nullptr) || (tangent[0].lengthSqr() < EPSILON))
+        tangent[0] = cross(normal, (fabs(normal[X]) < 0.5 ? Vector3d(1.0, 0.0, 0.0) : Vector3d(0.0, 1.0, 0.0)));
+    tangent[0].normalize();
+    tangent[1] = cross(normal, tangent[0]);
+    tangent[1].normalize();
+
+    DBL footprint = 0.0;
+    for (int i = 0; i < 2; i ++)
+    {
+        DBL qx = 0.0, qy = 0.0;
+        Vector3d q = pIsection->IPoint + tangent[i] * (radius * (i == 0 ? 1.0 : stretch));
+        for (WarpList::const_reverse_iterator iWarp = warps.rbegin(); iWarp != warps.rend(); iWarp ++)
+            (*iWarp)->WarpPoint(q);
+        if (map_pos(q, pImage, &qx, &qy))
+            continue;
+
+        // Account for wrapping around the image.
+        DBL dx = fabs(qx - xcoor);
+        DBL dy = fabs(qy - ycoor);
+        dx = std::min(dx, pImage->iwidth  - dx);
+        dy = std::min(dy, pImage->iheight - dy);
+        footprint = std::max(footprint, sqrt(dx * dx + dy * dy));
+    }
+
+    return (footprint > 1.0 ? log(footprint) / log(2.0) : 0.0);
+}
+
 bool ColourImagePattern::HasTransparency() const
 {
     return (!pImage || pImage->Once_Flag || !is_image_opaque(pImage));
@@ -581,6 +715,11 @@ DBL ImagePattern::EvaluateRaw(const Vector3d& EPoint, const Intersection *pIsect
     return image_pattern(EPoint, this);
 }
 
+bool ImagePattern::EvaluateRawGradient(DBL& value, Vector3d& gradient, const Vector3d& EPoint, DBL radius, TraceThreadData *pThread) const
+{
+    return image_pattern_gradient(value, gradient, EPoint, this);
+}
+
 
 MarblePattern::MarblePattern() :
     hasTurbulence()         // no explicit default; set by Precompute()
@@ -640,6 +779,8 @@ PigmentPattern::~PigmentPattern()
         Destroy_Pigment(pPigment);
 }
 
+bool PigmentPattern::DependsOnIntersection() const { return true; } // the pigment may use any pattern or mapping
+
 
 PotentialPattern::PotentialPattern() :
     pObject(nullptr),
@@ -683,6 +824,8 @@ SlopePattern::SlopePattern() :
     pointAt(false)
 {}
 
+bool SlopePattern::DependsOnIntersection() const { return true; }
+
 
 SpiralPattern::SpiralPattern() :
     arms(),                 // no explicit default; must be set by caller
@@ -843,7 +986,24 @@ MandelXPattern::MandelXPattern(const MandelXPattern& obj) :
 
 DBL Evaluate_TPat (const TPATTERN *TPat, const Vector3d& EPoint, const Intersection *pIsection, const Ray *pRay, TraceThreadData *pThread)
 {
-    return TPat->pattern->Evaluate(EPoint, pIsection, pRay, pThread);
+    const BasicPattern* pattern = TPat->pattern.get();
+
+    if ((pThread == nullptr) || !pThread->GetPatternCache().enabled || pattern->DependsOnIntersection())
+        return pattern->Evaluate(EPoint, pIsection, pRay, pThread);
+
+    PatternValueCache& cache = pThread->GetPatternCache();
+    DBL value;
+
+    pThread->Stats()[Pattern_Cache_Tests]++;
+    if (cache.Lookup(value, pattern, EPoint))
+    {
+        pThread->Stats()[Pattern_Cache_Hits]++;
+        return value;
+    }
+
+    value = pattern->Evaluate(EPoint, pIsection, pRay, pThread);
+    cache.Store(pattern, EPoint, value);
+    return value;
 }
 
 
@@ -1079,17 +1239,25 @@ void BlendMap<DATA_T>::Search (DBL value, EntryConstPtr& rpPrev, EntryConstPtr&
     }
     else
     {
-        // TODO - we might use a binary search instead
-
         typename std::vector<Entry>::const_iterator iP;
         typename std::vector<Entry>::const_iterator iN;
 
-        iP = iN = Blend_Map_Entries.begin();
-
-        while (value > iN->value)
+        if (Sorted)
         {
-            iP = iN;
-            iN++;
+            // Find the first entry not below the value, just like the linear search below would.
+            iN = std::lower_bound(Blend_Map_Entries.begin(), Blend_Map_Entries.end(), value,
+                                  [](const Entry& entry, DBL v) { return entry.value < v; });
+            iP = (iN == Blend_Map_Entries.begin()) ? iN : iN - 1;
+        }
+        else
+        {
+            iP = iN = Blend_Map_Entries.begin();
+
+            while (value > iN->value)
+            {
+                iP = iN;
+                iN++;
+            }
         }
 
         if ((value == iN->value) || (iP == iN))
@@ -5794,19 +5962,22 @@ DBL CracklePattern::EvaluateRaw(const Vector3d& EPoint, const Intersection *pIse
     CrackleCellCoord ccoord(flox, floy, floz, repeat.x(), repeat.y(), repeat.z());
     pThread->Stats()[CrackleCache_Tests]++;
 
-    CrackleCacheEntry dummy_entry;
-    CrackleCacheEntry* entry = &dummy_entry;
+    CrackleCacheEntry* entry = pThread->mpCrackleCell;
 
-    if (pThread->mpCrackleCache->Lookup(entry, ccoord))
+    if (entry->valid && (entry->coord == ccoord))
     {
-        // Cache hit. `entry` now points to the cached entry.
+        // Same cell as in the previous query by this thread.
+        pThread->Stats()[CrackleCache_Tests_Succeeded]++;
+    }
+    else if (pThread->mpCrackleCache->Lookup(*entry, ccoord))
+    {
+        // Cache hit. The cached entry has been copied to `entry`.
         pThread->Stats()[CrackleCache_Tests_Succeeded]++;
     }
     else
     {
-        // Cache miss. `entry` now points to a pristine entry set up in the
-        // cache, or to `dummy_entry` if the cache is too crowded already.
-        // In either case we need to fill in the blanks.
+        // Cache miss. We need to fill in the blanks, and then share the
+        // result with the other threads.
 
         // Calculate the random points for this new
         // cube and its 80 neighbours which differ in any axis by 1 or 2.
@@ -5849,6 +6020,10 @@ DBL CracklePattern::EvaluateRaw(const Vector3d& EPoint, const Intersection *pIse
             IntPickInCube(cacheX, cacheY, cacheZ, entry->aCellNuclei[i]);
             entry->aCellNuclei[i] += wrappingOffset;
         }
+
+        entry->coord = ccoord;
+        entry->valid = true;
+        pThread->Stats()[CrackleCache_Evictions] += pThread->mpCrackleCache->Store(*entry);
     }
 
     // Find the 3 points with the 3 shortest distances from the input point.
@@ -6392,6 +6567,20 @@ DBL GradientPattern::EvaluateRaw(const Vector3d& EPoint, const Intersection *pIs
     return ((Result > 1.0) ? fmod(Result, 1.0) : Result);
 }
 
+bool GradientPattern::EvaluateRawGradient(DBL& value, Vector3d& valueGradient, const Vector3d& EPoint, DBL radius, TraceThreadData *pThread) const
+{
+    DBL Result = dot(EPoint, gradient);
+    DBL reach = radius * gradient.length();
+
+    // Values above 1.0 wrap around at each integer; leave those to finite differences.
+    if ((floor(Result + reach) >= 1.0) && (floor(Result - reach) != floor(Result + reach)))
+        return false;
+
+    value = ((Result > 1.0) ? fmod(Result, 1.0) : Result);
+    valueGradient = gradient;
+    return true;
+}
+
 
 /*****************************************************************************
 *
@@ -6432,26 +6621,32 @@ DBL GranitePattern::EvaluateRaw(const Vector3d& EPoint, const Intersection *pIse
 
     int i;
     DBL temp, noise = 0.0, freq = 1.0;
-    Vector3d tv1, tv2;
+    Vector3d tv1;
+    Vector3d tv2[6];
+    DBL values[6];
 
     tv1 = EPoint * 4.0;
 
+    // evaluate all octaves in a single batch
     for (i = 0; i < 6; freq *= 2.0, i++)
-    {
-        tv2 = tv1 * freq;
+        tv2[i] = tv1 * freq;
+    MultiNoise(values, tv2, 6, noise_generator);
 
+    freq = 1.0;
+    for (i = 0; i < 6; freq *= 2.0, i++)
+    {
         // TODO - This distinction (with minor variations that seem to be more of an inconsistency rather than intentional)
         // appears in other places as well; make it a function.
         switch (noise_generator)
         {
             case kNoiseGen_Default:
             case kNoiseGen_Original:
-                temp = 0.5 - Noise (tv2, noise_generator);
+                temp = 0.5 - values[i];
                 temp = fabs(temp);
                 break;
 
             default:
-                temp = 1.0 - 2.0 * Noise (tv2, noise_generator); // TODO similar code clips the result
+                temp = 1.0 - 2.0 * values[i]; // TODO similar code clips the result
                 temp = fabs(temp);
                 if (temp>0.5) temp=0.5;
                 break;
@@ -7860,6 +8055,11 @@ DBL NoisePattern::EvaluateRaw(const Vector3d& EPoint, const Intersection *pIsect
     return Noise(EPoint, GetNoiseGen(pThread));
 }
 
+bool NoisePattern::EvaluateRawGradient(DBL& value, Vector3d& gradient, const Vector3d& EPoint, DBL radius, TraceThreadData *pThread) const
+{
+    return NoiseGradient(value, gradient, EPoint, GetNoiseGen(pThread));
+}
+
 
 
 /*****************************************************************************
@@ -10361,45 +10561,51 @@ DBL WrinklesPattern::EvaluateRaw(const Vector3d& EPoint, const Intersection *pIs
     DBL lambda = 2.0;
     DBL omega = 0.5;
     DBL value;
-    Vector3d temp;
+    Vector3d temp[10];
+    DBL values[10];
     DBL noise;
 
+    // evaluate all octaves in a single batch
+    temp[0] = EPoint;
+    for (i = 1; i < 10; i++)
+    {
+        temp[i] = EPoint * lambda;
+        lambda *= 2.0;
+    }
+    MultiNoise(values, temp, 10, noise_generator);
+
     // TODO - This distinction (with minor variations that seem to be more of an inconsistency rather than intentional)
     // appears in other places as well; make it a function.
     switch (noise_generator)
     {
         case kNoiseGen_Default:
         case kNoiseGen_Original:
-            value = Noise(EPoint, noise_generator);
+            value = values[0];
             break;
 
         default:
-            noise = Noise(EPoint, noise_generator)*2.0-0.5;
+            noise = values[0]*2.0-0.5;
             value = min(max(noise,0.0),1.0);
             break;
     }
 
     for (i = 1; i < 10; i++)
     {
-        temp = EPoint * lambda;
-
         // TODO - This distinction (with minor variations that seem to be more of an inconsistency rather than intentional)
         // appears in other places as well; make it a function.
         switch (noise_generator)
         {
             case kNoiseGen_Default:
             case kNoiseGen_Original:
-                value += omega * Noise(temp, noise_generator);
+                value += omega * values[i];
                 break;
 
             default:
-                noise = Noise(temp, noise_generator)*2.0-0.5;
+                noise = values[i]*2.0-0.5;
                 value += omega * min(max(noise,0.0),1.0);
                 break;
         }
 
-        lambda *= 2.0;
-
         omega *= 0.5;
     }
 
@@ -254,6 +254,29 @@ struct BasicPattern
     ///
     virtual bool HasSpecialTurbulenceHandling() const;
 
+    /// Whether the pattern's value depends on the intersection or ray rather than just the point.
+    ///
+    /// The values of patterns for which this returns `false` may be cached per thread; see
+    /// @ref PatternValueCache.
+    ///
+    /// @return     `true` if the pattern evaluates the intersection or ray data.
+    ///
+    virtual bool DependsOnIntersection() const;
+
+    /// Evaluates the pattern's gradient analytically.
+    ///
+    /// This is used by the normal perturbation code in place of finite differences where possible.
+    ///
+    /// @param[out]     gradient    The gradient of the pattern's value at the given point in space.
+    /// @param[in]      EPoint      The point of interest in 3D space.
+    /// @param[in]      radius      Radius of the finite difference stencil the gradient replaces;
+    ///                             patterns should fail if they are discontinuous within that distance.
+    /// @param[in,out]  pThread     Additional thread-local data.
+    /// @return                     `false` if no analytic gradient is available at the given point, in which
+    ///                             case the caller should fall back to finite differences.
+    ///
+    virtual bool EvaluateGradient(Vector3d& gradient, const Vector3d& EPoint, DBL radius, TraceThreadData *pThread) const;
+
     /// Whether the pattern can be used with maps.
     ///
     /// @return     `true` if the pattern can be used with maps.
@@ -330,6 +353,25 @@ struct ContinuousPattern : public BasicPattern
     ///
     virtual DBL EvaluateRaw(const Vector3d& EPoint, const Intersection *pIsection, const Ray *pRay, TraceThreadData *pThread) const = 0;
 
+    /// Evaluates the pattern's gradient, taking into account the wave function.
+    ///
+    /// @note   Derived classes should _not_ override this, but @ref EvaluateRawGradient() instead.
+    ///
+    virtual bool EvaluateGradient(Vector3d& gradient, const Vector3d& EPoint, DBL radius, TraceThreadData *pThread) const override final;
+
+    /// Evaluates the pattern's value and gradient, without taking into account the wave function.
+    ///
+    /// The default implementation returns `false`, indicating that no analytic gradient is available.
+    ///
+    /// @param[out]     value       The pattern's value as returned by @ref EvaluateRaw().
+    /// @param[out]     gradient    The gradient of that value.
+    /// @param[in]      EPoint      The point of interest in 3D space.
+    /// @param[in]      radius      See @ref BasicPattern::EvaluateGradient().
+    /// @param[in,out]  pThread     Additional thread-local data.
+    /// @return                     `false` if no analytic gradient is available at the given point.
+    ///
+    virtual bool EvaluateRawGradient(DBL& value, Vector3d& gradient, const Vector3d& EPoint, DBL radius, TraceThreadData *pThread) const;
+
     virtual unsigned int NumDiscreteBlendMapEntries() const override;
     virtual bool CanMap() const override;
 };
@@ -395,6 +437,7 @@ struct AOIPattern final : public ContinuousPattern
 {
     virtual PatternPtr Clone() const override { return BasicPattern::Clone(*this); }
     virtual DBL EvaluateRaw(const Vector3d& EPoint, const Intersection *pIsection, const Ray *pRay, TraceThreadData *pThread) const override;
+    virtual bool DependsOnIntersection() const override;
 };
 
 /// Implements the `boxed` pattern.
@@ -548,6 +591,7 @@ struct GradientPattern final : public ContinuousPattern
 
     virtual PatternPtr Clone() const override { return BasicPattern::Clone(*this); }
     virtual DBL EvaluateRaw(const Vector3d& EPoint, const Intersection *pIsection, const Ray *pRay, TraceThreadData *pThread) const override;
+    virtual bool EvaluateRawGradient(DBL& value, Vector3d& gradient, const Vector3d& EPoint, DBL radius, TraceThreadData *pThread) const override;
 };
 
 /// Implements the `granite` pattern.
@@ -571,6 +615,7 @@ struct ImagePattern final : public ContinuousPattern, public ImagePatternImpl
 {
     virtual PatternPtr Clone() const override { return BasicPattern::Clone(*this); }
     virtual DBL EvaluateRaw(const Vector3d& EPoint, const Intersection *pIsection, const Ray *pRay, TraceThreadData *pThread) const override;
+    virtual bool EvaluateRawGradient(DBL& value, Vector3d& gradient, const Vector3d& EPoint, DBL radius, TraceThreadData *pThread) const override;
 };
 
 /// Implements the `leopard` pattern.
@@ -600,6 +645,7 @@ struct NoisePattern : public ContinuousPattern
 {
     virtual PatternPtr Clone() const override = 0;
     virtual DBL EvaluateRaw(const Vector3d& EPoint, const Intersection *pIsection, const Ray *pRay, TraceThreadData *pThread) const override;
+    virtual bool EvaluateRawGradient(DBL& value, Vector3d& gradient, const Vector3d& EPoint, DBL radius, TraceThreadData *pThread) const override;
 };
 
 /// Implements the `object` pattern.
@@ -661,6 +707,7 @@ struct PigmentPattern final : public ContinuousPattern
     virtual ~PigmentPattern() override;
     virtual PatternPtr Clone() const override { return BasicPattern::Clone(*this); }
     virtual DBL EvaluateRaw(const Vector3d& EPoint, const Intersection *pIsection, const Ray *pRay, TraceThreadData *pThread) const override;
+    virtual bool DependsOnIntersection() const override;
 };
 
 /// Implements the `planar` pattern.
@@ -732,6 +779,7 @@ struct SlopePattern final : public ContinuousPattern
     SlopePattern();
     virtual PatternPtr Clone() const override { return BasicPattern::Clone(*this); }
     virtual DBL EvaluateRaw(const Vector3d& EPoint, const Intersection *pIsection, const Ray *pRay, TraceThreadData *pThread) const override;
+    virtual bool DependsOnIntersection() const override;
 };
 
 /// Implements the `spherical` pattern.
@@ -1161,6 +1209,21 @@ struct ColourImagePattern final : public ColourPattern, public ImagePatternImpl
     virtual PatternPtr Clone() const override { return BasicPattern::Clone(*this); }
     virtual bool Evaluate(TransColour& result, const Vector3d& EPoint, const Intersection *pIsection, const Ray *pRay, TraceThreadData *pThread) const override;
     virtual bool HasTransparency() const override;
+
+protected:
+
+    /// Estimates the level of detail at which to sample the image.
+    ///
+    /// @param[in]  EPoint      The point of interest, after applying the warps.
+    /// @param[in]  xcoor       Image coordinate of the point of interest.
+    /// @param[in]  ycoor       Image coordinate of the point of interest.
+    /// @param[in]  pIsection   The intersection.
+    /// @param[in]  pRay        The ray, or `nullptr` if not available.
+    /// @param[in]  radius      Radius of the pixel footprint at the intersection, in world units.
+    /// @return                 Binary logarithm of the pixel footprint in image pixels, or zero if
+    ///                         the footprint is smaller than a pixel or cannot be estimated.
+    ///
+    DBL LevelOfDetail(const Vector3d& EPoint, DBL xcoor, DBL ycoor, const Intersection *pIsection, const Ray *pRay, DBL radius) const;
 };
 
 
@@ -43,9 +43,11 @@
 #include "core/material/pigment.h"
 
 // C++ variants of C standard header files
-// C++ standard header files
 //  (none at the moment)
 
+// C++ standard header files
+#include <algorithm>
+
 // POV-Ray header files (base module)
 #include "base/pov_err.h"
 #include "base/povassert.h"
@@ -269,6 +271,9 @@ void Post_Pigment(PIGMENT *Pigment, bool* pHasFilter)
 
     Pigment->Flags |= POST_DONE;
 
+    if (Pigment->pattern)
+        Optimize_Warps(Pigment->pattern->warps);
+
     switch (Pigment->Type)
     {
         case NO_PATTERN:
@@ -344,6 +349,44 @@ void ColourBlendMap::Post(bool& rHasFilter)
             break;
         }
     }
+
+    // Default colour maps are shared between scenes, so make sure they are compiled only once.
+    std::call_once(mLookupTableOnce, [this]() { CompileLookupTable(); });
+}
+
+void ColourBlendMap::CompileLookupTable()
+{
+    // Small maps are searched quickly enough, and the table can only reproduce plain linear blending.
+    if ((Blend_Map_Entries.size() <= 2) ||
+        !((blendMode == 0) || ((blendMode == 2) && GammaCurve::IsNeutral(blendGamma))))
+        return;
+
+    // Between entries the map is linear in the pattern value, so interpolating between table samples is exact
+    // except in those intervals that contain an entry; the latter are flagged to be evaluated the old way.
+    mLookupTable.resize(kLookupTableSize + 1);
+    for (int i = 0; i <= kLookupTableSize; ++i)
+    {
+        const Entry* Prev;
+        const Entry* Cur;
+        DBL prevWeight;
+        DBL curWeight;
+        Search (DBL(i) / kLookupTableSize, Prev, Cur, prevWeight, curWeight);
+        if (Prev == Cur)
+            mLookupTable[i] = Cur->Vals;
+        else
+            mLookupTable[i] = Prev->Vals * prevWeight + Cur->Vals * curWeight;
+    }
+
+    mLookupExact.assign(kLookupTableSize, false);
+    for (Vector::const_iterator i = Blend_Map_Entries.begin(); i != Blend_Map_Entries.end(); i++)
+    {
+        if ((i->value < 0.0) || (i->value > 1.0))
+            continue;
+        int k = int(i->value * kLookupTableSize);
+        // An entry right at an interval boundary also affects the interval below.
+        for (int j = std::max(k - 1, 0); j <= std::min(k, kLookupTableSize - 1); ++j)
+            mLookupExact[j] = true;
+    }
 }
 
 void PigmentBlendMap::Post(bool& rHasFilter)
@@ -425,7 +468,7 @@ bool Compute_Pigment (TransColour& colour, const PIGMENT *Pigment, const Vector3
 
             case AVERAGE_PATTERN:
 
-                Warp_EPoint (TPoint, EPoint, Pigment);
+                Warp_EPoint (TPoint, EPoint, Pigment, Thread);
 
                 Do_Average_Pigments(colour, Pigment, TPoint, Intersect, ray, Thread);
 
@@ -441,7 +484,7 @@ bool Compute_Pigment (TransColour& colour, const PIGMENT *Pigment, const Vector3
             case IMAGE_MAP_PATTERN:
             case COLOUR_PATTERN:
 
-                Warp_EPoint (TPoint, EPoint, Pigment);
+                Warp_EPoint (TPoint, EPoint, Pigment, Thread);
 
                 colour.Clear();
 
@@ -459,7 +502,7 @@ bool Compute_Pigment (TransColour& colour, const PIGMENT *Pigment, const Vector3
     }
 
     /* NK 19 Nov 1999 added Warp_EPoint */
-    Warp_EPoint (TPoint, EPoint, Pigment);
+    Warp_EPoint (TPoint, EPoint, Pigment, Thread);
     value = Evaluate_TPat (Pigment, TPoint, Intersect, ray, Thread);
 
     return Pigment->Blend_Map->Compute (colour, value, TPoint, Intersect, ray, Thread);
@@ -528,6 +571,18 @@ void GenericPigmentBlendMap::Blend(TransColour& result, const TransColour& colou
 
 bool ColourBlendMap::Compute(TransColour& colour, DBL value, const Vector3d& TPoint, const Intersection *Intersect, const Ray *ray, TraceThreadData *Thread)
 {
+    if (!mLookupTable.empty() && (value >= 0.0) && (value < 1.0))
+    {
+        DBL t = value * kLookupTableSize;
+        int i = int(t);
+        if (!mLookupExact[i])
+        {
+            DBL f = t - i;
+            colour = mLookupTable[i] * (1.0 - f) + mLookupTable[i+1] * f;
+            return true;
+        }
+    }
+
     const BlendMapEntry<TransColour>* Prev;
     const BlendMapEntry<TransColour>* Cur;
     DBL prevWeight;
@@ -660,15 +715,61 @@ void Evaluate_Density_Pigment(vector<PIGMENT*>& Density, const Vector3d& p, Math
     }
 }
 
+// Determine an upper bound of the magnitude of any colour channel the pigment may produce.
+// Returns false if no such bound is known, e.g. for image maps.
+bool Compute_Pigment_Bound(const PIGMENT *Pigment, ColourChannel& bound)
+{
+    bound = 0.0;
+
+    if (Pigment->Quick_Colour.IsValid())
+        bound = Pigment->Quick_Colour.colour().MaxAbs();
+
+    if (Pigment->Type == PLAIN_PATTERN)
+    {
+        bound = std::max(bound, Pigment->colour.colour().MaxAbs());
+        return true;
+    }
+
+    if ((Pigment->Type != AVERAGE_PATTERN) && (Pigment->Type <= LAST_SPECIAL_PATTERN))
+        return false;
+
+    // Colour and pigment maps blend between adjacent entries (or, for averages, take a weighted
+    // mean of all entries), so the result never exceeds the largest entry.
+    if (const ColourBlendMap *map = dynamic_cast<const ColourBlendMap*>(Pigment->Blend_Map.get()))
+    {
+        for (ColourBlendMap::Vector::const_iterator i = map->Blend_Map_Entries.begin(); i != map->Blend_Map_Entries.end(); ++i)
+        {
+            if ((Pigment->Type == AVERAGE_PATTERN) && (i->value < 0.0))
+                return false;
+            bound = std::max(bound, i->Vals.colour().MaxAbs());
+        }
+        return true;
+    }
+
+    if (const PigmentBlendMap *map = dynamic_cast<const PigmentBlendMap*>(Pigment->Blend_Map.get()))
+    {
+        for (PigmentBlendMap::Vector::const_iterator i = map->Blend_Map_Entries.begin(); i != map->Blend_Map_Entries.end(); ++i)
+        {
+            ColourChannel entryBound;
+            if ((Pigment->Type == AVERAGE_PATTERN) && (i->value < 0.0))
+                return false;
+            if ((i->Vals == nullptr) || !Compute_Pigment_Bound(i->Vals, entryBound))
+                return false;
+            bound = std::max(bound, entryBound);
+        }
+        return true;
+    }
+
+    return false;
+}
+
 //******************************************************************************
 
 ColourBlendMap::ColourBlendMap() : BlendMap<TransColour>(kBlendMapType_Colour) {}
 
 ColourBlendMap::ColourBlendMap(int n, const ColourBlendMap::Entry aEntries[]) : BlendMap<TransColour>(kBlendMapType_Colour)
 {
-    Blend_Map_Entries.reserve(n);
-    for (int i = 0; i < n; i ++)
-        Blend_Map_Entries.push_back(aEntries[i]);
+    Set(Vector(aEntries, aEntries + n));
 }
 
 
@@ -44,6 +44,7 @@
 
 // C++ standard header files
 #include <memory>
+#include <mutex>
 #include <vector>
 
 // POV-Ray header files (base module)
@@ -98,6 +99,21 @@ class ColourBlendMap final : public BlendMap<TransColour>, public GenericPigment
         virtual void ComputeAverage(TransColour& colour, const Vector3d& EPoint, const Intersection *Intersect, const Ray *ray, TraceThreadData *Thread) override;
         virtual bool ComputeUVMapped(TransColour& colour, const Intersection *Intersect, const Ray *ray, TraceThreadData *Thread) override;
         virtual void Post(bool& rHasFilter) override;
+
+    private:
+
+        /// Number of intervals the lookup table divides the range [0..1] into.
+        static constexpr int kLookupTableSize = 1024;
+
+        /// Colours at the interval boundaries, or empty if the map is evaluated by searching the entries.
+        std::vector<TransColour> mLookupTable;
+
+        /// Whether an interval contains an entry, and must therefore be evaluated by searching the entries.
+        std::vector<bool> mLookupExact;
+
+        std::once_flag mLookupTableOnce;
+
+        void CompileLookupTable();
 };
 
 /// Pigment blend map.
@@ -142,6 +158,7 @@ void Destroy_Pigment(PIGMENT *Pigment);
 void Post_Pigment(PIGMENT *Pigment, bool* pHasFilter = nullptr);
 bool Compute_Pigment(TransColour& colour, const PIGMENT *Pigment, const Vector3d& IPoint, const Intersection *Intersect, const Ray *ray, TraceThreadData *Thread);
 void Evaluate_Density_Pigment(std::vector<PIGMENT*>& Density, const Vector3d& p, MathColour& c, TraceThreadData *ttd);
+bool Compute_Pigment_Bound(const PIGMENT *Pigment, ColourChannel& bound);
 
 /// @}
 ///
@@ -59,6 +59,7 @@
 #include "core/material/pattern.h"
 #include "core/material/pigment.h"
 #include "core/material/normal.h"
+#include "core/material/warp.h"
 #include "core/support/imageutil.h"
 
 // this must be the last file included
@@ -355,6 +356,9 @@ TEXTURE *Create_Texture()
 
     New->Next    = nullptr;
 
+    New->Linear_Lighting = false;
+    New->Lighting_Source = -1;
+
     return (New);
 }
 
@@ -432,6 +436,9 @@ TEXTURE *Copy_Textures(TEXTURE *Textures)
 
         New->References = 1;
 
+        New->Linear_Lighting = Layer->Linear_Lighting;
+        New->Lighting_Source = Layer->Lighting_Source;
+
         switch (Layer->Type)
         {
             case PLAIN_PATTERN:
@@ -520,6 +527,122 @@ void Destroy_Textures(TEXTURE *Textures)
 
 
 
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Same_Lighting
+*
+* INPUT
+*
+*   A, B - Finishes to compare
+*
+* OUTPUT
+*
+* RETURNS
+*
+*   bool - true, if the finishes give identical classic lighting
+*
+* AUTHOR
+*
+*   POV-Ray Team
+*
+* DESCRIPTION
+*
+*   Compare the finish parameters that enter the diffuse, phong, specular
+*   and iridescence terms of classic lighting. All other parameters
+*   (ambient, reflection, refraction etc.) are ignored.
+*
+* CHANGES
+*
+******************************************************************************/
+
+static bool Same_Lighting(const FINISH *A, const FINISH *B)
+{
+    if (A == B)
+        return true;
+
+    return (A->Diffuse             == B->Diffuse) &&
+           (A->DiffuseBack         == B->DiffuseBack) &&
+           (A->Brilliance          == B->Brilliance) &&
+#if POV_PARSER_EXPERIMENTAL_BRILLIANCE_OUT
+           (A->BrillianceOut       == B->BrillianceOut) &&
+#endif
+           (A->BrillianceAdjust    == B->BrillianceAdjust) &&
+           (A->Specular            == B->Specular) &&
+           (A->Roughness           == B->Roughness) &&
+           (A->Phong               == B->Phong) &&
+           (A->Phong_Size          == B->Phong_Size) &&
+           (A->Irid                == B->Irid) &&
+           (A->Irid_Film_Thickness == B->Irid_Film_Thickness) &&
+           (A->Irid_Turb           == B->Irid_Turb) &&
+           (A->Fresnel             == B->Fresnel);
+}
+
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Plan_Layer_Lighting
+*
+* INPUT
+*
+*   Textures - Layered texture chain
+*
+* OUTPUT
+*
+*   Textures - Layers' Linear_Lighting and Lighting_Source set
+*
+* RETURNS
+*
+* AUTHOR
+*
+*   POV-Ray Team
+*
+* DESCRIPTION
+*
+*   Work out once per texture which layers' classic lighting can be computed
+*   without their pigment and scaled by it afterwards, and which layers can
+*   reuse such lighting from an earlier layer with an identical finish, so
+*   that the trace code doesn't have to re-evaluate all light sources for
+*   every layer.
+*
+* CHANGES
+*
+******************************************************************************/
+
+static void Plan_Layer_Lighting(TEXTURE *Textures)
+{
+    TEXTURE *Layer, *Other;
+    int Layer_Number, Other_Number;
+
+    for (Layer_Number = 0, Layer = Textures; Layer != nullptr; Layer_Number++, Layer = Layer->Next)
+    {
+        const FINISH *Finish = Layer->Finish;
+
+        Layer->Lighting_Source = -1;
+        Layer->Linear_Lighting = (Layer->Type == PLAIN_PATTERN) && (Finish != nullptr) &&
+                                 (Finish->Crand == 0.0) && (Finish->Metallic == 0.0) &&
+                                 !Finish->AlphaKnockout && !Finish->UseSubsurface;
+
+        if (!Layer->Linear_Lighting)
+            continue;
+
+        for (Other_Number = 0, Other = Textures; Other != Layer; Other_Number++, Other = Other->Next)
+        {
+            if (Other->Linear_Lighting && (Other->Lighting_Source == -1) && Same_Lighting(Other->Finish, Finish))
+            {
+                Layer->Lighting_Source = Other_Number;
+                break;
+            }
+        }
+    }
+}
+
+
+
 /*****************************************************************************
 *
 * FUNCTION
@@ -554,6 +677,9 @@ void Post_Textures(TEXTURE *Textures)
     {
         if (!((Layer->Flags) & POST_DONE))
         {
+            if (Layer->pattern)
+                Optimize_Warps(Layer->pattern->warps);
+
             switch (Layer->Type)
             {
                 case PLAIN_PATTERN:
@@ -595,6 +721,8 @@ void Post_Textures(TEXTURE *Textures)
             }
         }
     }
+
+    Plan_Layer_Lighting(Textures);
 }
 
 
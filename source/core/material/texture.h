@@ -114,6 +114,8 @@ struct Texture_Struct final : public Pattern_Struct
     TNORMAL *Tnormal;
     FINISH *Finish;
     std::vector<TEXTURE*> Materials; // used for `material_map` (and only there)
+    bool Linear_Lighting;   ///< Whether classic lighting scales linearly with the layer's pigment; set by @ref Post_Textures().
+    int Lighting_Source;    ///< Index of an earlier layer of the same chain with identical classic lighting, or -1; set by @ref Post_Textures().
 };
 
 struct Finish_Struct final
@@ -40,9 +40,11 @@
 #include "core/material/warp.h"
 
 // C++ variants of C standard header files
-// C++ standard header files
 //  (none at the moment)
 
+// C++ standard header files
+#include <chrono>
+
 // POV-Ray header files (base module)
 #include "base/pov_err.h"
 
@@ -52,6 +54,8 @@
 #include "core/material/texture.h"
 #include "core/math/matrix.h"
 #include "core/math/randomsequence.h"
+#include "core/scene/tracethreaddata.h"
+#include "core/support/statistics.h"
 
 // this must be the last file included
 #include "base/povdebug.h"
@@ -65,6 +69,12 @@ namespace pov
 
 const DBL COORDINATE_LIMIT = 1.0e17;
 
+/// Only one in this many warp chain evaluations is timed, to keep the overhead of reading the clock low.
+const POV_LONG WARP_TIMING_INTERVAL = 16;
+
+/// Maximum deviation from the identity matrix for a transform warp to be dropped.
+const DBL IDENTITY_TRANSFORM_TOLERANCE = 1.0e-12;
+
 /*****************************************************************************
 * Static functions
 ******************************************************************************/
@@ -100,16 +110,31 @@ static RandomDoubleSequence WarpRands(0.0, 1.0, 32768);
 *
 ******************************************************************************/
 
-void Warp_EPoint (Vector3d& TPoint, const Vector3d& EPoint, const TPATTERN *TPat)
+void Warp_EPoint (Vector3d& TPoint, const Vector3d& EPoint, const TPATTERN *TPat, TraceThreadData *Thread)
 {
     WarpList& warps=TPat->pattern->warps;
 
     TPoint = EPoint;
 
-    for (WarpList::reverse_iterator iWarp = warps.rbegin(); iWarp != warps.rend(); iWarp ++)
+    if ((Thread != nullptr) && !warps.empty() &&
+        ((Thread->Stats()[Warp_Chains_Evaluated]++ % WARP_TIMING_INTERVAL) == 0))
     {
-        WarpPtr& warp = *iWarp;
-        warp->WarpPoint(TPoint);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (WarpList::reverse_iterator iWarp = warps.rbegin(); iWarp != warps.rend(); iWarp ++)
+        {
+            WarpPtr& warp = *iWarp;
+            warp->WarpPoint(TPoint);
+        }
+        Thread->Stats()[Warp_Time] += WARP_TIMING_INTERVAL *
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+    else
+    {
+        for (WarpList::reverse_iterator iWarp = warps.rbegin(); iWarp != warps.rend(); iWarp ++)
+        {
+            WarpPtr& warp = *iWarp;
+            warp->WarpPoint(TPoint);
+        }
     }
 
     for (int i=X; i<=Z; i++)
@@ -870,5 +895,93 @@ void Copy_Warps (WarpList& rNew, const WarpList& old)
         rNew.push_back((*i)->Clone());
 }
 
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Optimize_Warps
+*
+* INPUT
+*
+*   rWarps -- warp list of a pattern, in the order as parsed
+*
+* OUTPUT
+*
+*   rWarps -- equivalent, but possibly shorter warp list
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Fuses adjacent transform warps into a single one, and drops warps that
+*   do not modify the point (identity warps, transforms that amount to the
+*   identity, and turbulence warps of zero strength). Classic turbulence at
+*   the head of the list is always kept, as some patterns handle it
+*   themselves.
+*
+*   Turbulence is never moved past transform warps, as the two do not
+*   commute.
+*
+* CHANGES
+*
+******************************************************************************/
+
+static bool IsIdentityTransform(const TRANSFORM& trans)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        for (int j = 0; j < 4; j++)
+        {
+            if (fabs(trans.matrix[i][j] - (i == j ? 1.0 : 0.0)) > IDENTITY_TRANSFORM_TOLERANCE)
+                return false;
+        }
+    }
+    return true;
+}
+
+void Optimize_Warps (WarpList& rWarps)
+{
+    WarpList optimized;
+    optimized.reserve(rWarps.size());
+
+    for (WarpList::iterator i = rWarps.begin(); i != rWarps.end(); i ++)
+    {
+        WarpPtr warp = *i;
+
+        bool redundant = (dynamic_cast<IdentityWarp*>(warp) != nullptr);
+        if (const GenericTurbulenceWarp* turb = dynamic_cast<GenericTurbulenceWarp*>(warp))
+            redundant = (dynamic_cast<ClassicTurbulence*>(warp) == nullptr) && turb->Turbulence.IsNull();
+
+        if (TransformWarp* trans = dynamic_cast<TransformWarp*>(warp))
+        {
+            // Warps are applied last to first, so the combined transform is the earlier one followed by this one.
+            TransformWarp* previous = (optimized.empty() ? nullptr : dynamic_cast<TransformWarp*>(optimized.back()));
+            if (previous != nullptr)
+            {
+                Compose_Transforms(&previous->Trans, &trans->Trans);
+                redundant = true;
+                if (IsIdentityTransform(previous->Trans))
+                {
+                    delete previous;
+                    optimized.pop_back();
+                }
+            }
+            else
+                redundant = IsIdentityTransform(trans->Trans);
+        }
+
+        if (redundant)
+            delete warp;
+        else
+            optimized.push_back(warp);
+    }
+
+    rWarps.swap(optimized);
+}
+
 }
 // end of namespace pov
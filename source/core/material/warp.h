@@ -49,6 +49,7 @@
 //  (none at the moment)
 
 // POV-Ray header files (core module)
+#include "core/core_fwd.h"
 #include "core/math/matrix.h"
 #include "core/math/vector.h"
 
@@ -378,9 +379,10 @@ struct SphereWarp final: public GenericWarp
 * Global functions
 ******************************************************************************/
 
-void Warp_EPoint (Vector3d& TPoint, const Vector3d& EPoint, const TPATTERN *TPat);
+void Warp_EPoint (Vector3d& TPoint, const Vector3d& EPoint, const TPATTERN *TPat, TraceThreadData *Thread = nullptr);
 void Destroy_Warps (WarpList& rWarps);
 void Copy_Warps (WarpList& rNew, const WarpList& old);
+void Optimize_Warps (WarpList& rWarps);
 void Warp_Normal (Vector3d& TNorm, const Vector3d& ENorm, const TPATTERN *TPat, bool DontScaleBumps);
 void UnWarp_Normal (Vector3d& TNorm, const Vector3d& ENorm, const TPATTERN *TPat, bool DontScaleBumps);
 
@@ -37,6 +37,8 @@
 #include "core/math/matrix.h"
 
 // C++ variants of C standard header files
+#include <cstring>
+
 // C++ standard header files
 //  (none at the moment)
 
@@ -71,12 +73,71 @@ namespace pov
 * Local variables
 ******************************************************************************/
 
+#ifdef TRY_OPTIMIZED_TRANSFORM
+
+static const OptimizedTransformInfo gPortableTransformInfo = {
+    "generic",      // name,
+    "portable",     // info,
+    nullptr,        // transformPoints,
+    nullptr,        // transformDirections,
+    nullptr,        // invTransformNormals,
+    nullptr,        // transformRays,
+    nullptr,        // enabled,
+    nullptr         // supported
+};
+
+#endif // TRY_OPTIMIZED_TRANSFORM
+
 
 
 /*****************************************************************************
 * Static functions
 ******************************************************************************/
 
+// Portable implementations of the vector transformations.
+
+static inline void PortableTransPoint (Vector3d& result, const Vector3d& vector, const MATRIX *matrix)
+{
+    Vector3d temp; // needed in case vector and result refer to the same memory location
+
+    for (int i = 0; i < 3; i++)
+    {
+        temp[i] = vector[X] * (*matrix)[0][i] +
+                  vector[Y] * (*matrix)[1][i] +
+                  vector[Z] * (*matrix)[2][i] + (*matrix)[3][i];
+    }
+
+    result = temp;
+}
+
+static inline void PortableTransDirection (Vector3d& result, const Vector3d& vector, const MATRIX *matrix)
+{
+    Vector3d temp; // needed in case vector and result refer to the same memory location
+
+    for (int i = 0; i < 3; i++)
+    {
+        temp[i] = vector[X] * (*matrix)[0][i] +
+                  vector[Y] * (*matrix)[1][i] +
+                  vector[Z] * (*matrix)[2][i];
+    }
+
+    result = temp;
+}
+
+static inline void PortableInvTransNormal (Vector3d& result, const Vector3d& vector, const MATRIX *matrix)
+{
+    Vector3d temp; // needed in case vector and result refer to the same memory location
+
+    for (int i = 0; i < 3; i++)
+    {
+        temp[i] = vector[X] * (*matrix)[i][0] +
+                  vector[Y] * (*matrix)[i][1] +
+                  vector[Z] * (*matrix)[i][2];
+    }
+
+    result = temp;
+}
+
 
 
 /*****************************************************************************
@@ -414,16 +475,16 @@ void MTranspose (MATRIX result, const MATRIX matrix1)
 
 void MTransPoint (Vector3d& result, const Vector3d& vector, const MATRIX *matrix)
 {
-    Vector3d temp; // needed in case vector and result refer to the same memory location
-
-    for (int i = 0; i < 3; i++)
+#ifdef TRY_OPTIMIZED_TRANSFORM
+    static const TransformVectorsFunction transform = GetRecommendedOptimizedTransform()->transformPoints;
+    if (transform != nullptr)
     {
-        temp[i] = vector[X] * (*matrix)[0][i] +
-                  vector[Y] * (*matrix)[1][i] +
-                  vector[Z] * (*matrix)[2][i] + (*matrix)[3][i];
+        transform(&result, &vector, 1, matrix);
+        return;
     }
+#endif
 
-    result = temp;
+    PortableTransPoint(result, vector, matrix);
 }
 
 
@@ -454,16 +515,16 @@ void MTransPoint (Vector3d& result, const Vector3d& vector, const MATRIX *matrix
 
 void MTransDirection (Vector3d& result, const Vector3d& vector, const MATRIX *matrix)
 {
-    Vector3d temp; // needed in case vector and result refer to the same memory location
-
-    for (int i = 0; i < 3; i++)
+#ifdef TRY_OPTIMIZED_TRANSFORM
+    static const TransformVectorsFunction transform = GetRecommendedOptimizedTransform()->transformDirections;
+    if (transform != nullptr)
     {
-        temp[i] = vector[X] * (*matrix)[0][i] +
-                  vector[Y] * (*matrix)[1][i] +
-                  vector[Z] * (*matrix)[2][i];
+        transform(&result, &vector, 1, matrix);
+        return;
     }
+#endif
 
-    result = temp;
+    PortableTransDirection(result, vector, matrix);
 }
 
 
@@ -494,18 +555,151 @@ void MTransDirection (Vector3d& result, const Vector3d& vector, const MATRIX *ma
 
 void MInvTransNormal (Vector3d& result, const Vector3d& vector, const MATRIX* matrix)
 {
-    Vector3d temp; // needed in case vector and result refer to the same memory location
+#ifdef TRY_OPTIMIZED_TRANSFORM
+    static const TransformVectorsFunction transform = GetRecommendedOptimizedTransform()->invTransformNormals;
+    if (transform != nullptr)
+    {
+        transform(&result, &vector, 1, matrix);
+        return;
+    }
+#endif
 
-    for (int i = 0; i < 3; i++)
+    PortableInvTransNormal(result, vector, matrix);
+}
+
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   MTransPoints, MTransDirections, MInvTransNormals, MTransRays
+*
+* INPUT
+*
+*   vectors, rays - array of count vectors or rays to transform
+*   matrix        - matrix to transform by
+*
+* OUTPUT
+*
+*   result        - array of count transformed vectors or rays
+*
+* RETURNS
+*
+* AUTHOR
+*
+*   POV-Ray Team
+*
+* DESCRIPTION
+*
+*   Batched variants of MTransPoint, MTransDirection and MInvTransNormal,
+*   and the combined transformation of ray origins and directions. The
+*   optimized implementations load the matrix only once per batch.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+void MTransPoints (Vector3d result[], const Vector3d vectors[], size_t count, const MATRIX *matrix)
+{
+#ifdef TRY_OPTIMIZED_TRANSFORM
+    static const TransformVectorsFunction transform = GetRecommendedOptimizedTransform()->transformPoints;
+    if (transform != nullptr)
     {
-        temp[i] = vector[X] * (*matrix)[i][0] +
-                  vector[Y] * (*matrix)[i][1] +
-                  vector[Z] * (*matrix)[i][2];
+        transform(result, vectors, count, matrix);
+        return;
     }
+#endif
 
-    result = temp;
+    for (size_t i = 0; i < count; i++)
+        PortableTransPoint(result[i], vectors[i], matrix);
+}
+
+void MTransDirections (Vector3d result[], const Vector3d vectors[], size_t count, const MATRIX *matrix)
+{
+#ifdef TRY_OPTIMIZED_TRANSFORM
+    static const TransformVectorsFunction transform = GetRecommendedOptimizedTransform()->transformDirections;
+    if (transform != nullptr)
+    {
+        transform(result, vectors, count, matrix);
+        return;
+    }
+#endif
+
+    for (size_t i = 0; i < count; i++)
+        PortableTransDirection(result[i], vectors[i], matrix);
+}
+
+void MInvTransNormals (Vector3d result[], const Vector3d vectors[], size_t count, const MATRIX *matrix)
+{
+#ifdef TRY_OPTIMIZED_TRANSFORM
+    static const TransformVectorsFunction transform = GetRecommendedOptimizedTransform()->invTransformNormals;
+    if (transform != nullptr)
+    {
+        transform(result, vectors, count, matrix);
+        return;
+    }
+#endif
+
+    for (size_t i = 0; i < count; i++)
+        PortableInvTransNormal(result[i], vectors[i], matrix);
+}
+
+void MTransRays (BasicRay result[], const BasicRay rays[], size_t count, const MATRIX *matrix)
+{
+#ifdef TRY_OPTIMIZED_TRANSFORM
+    static const TransformRaysFunction transform = GetRecommendedOptimizedTransform()->transformRays;
+    if (transform != nullptr)
+    {
+        transform(result, rays, count, matrix);
+        return;
+    }
+#endif
+
+    for (size_t i = 0; i < count; i++)
+    {
+        PortableTransPoint(result[i].Origin, rays[i].Origin, matrix);
+        PortableTransDirection(result[i].Direction, rays[i].Direction, matrix);
+    }
+}
+
+void MTransPointsAxisAligned (Vector3d result[], const Vector3d vectors[], size_t count, const MATRIX *matrix, TransformKind kind)
+{
+    for (size_t i = 0; i < count; i++)
+        MTransPointAxisAligned(result[i], vectors[i], matrix, kind);
+}
+
+void MTransRaysAxisAligned (BasicRay result[], const BasicRay rays[], size_t count, const MATRIX *matrix, TransformKind kind)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        MTransPointAxisAligned(result[i].Origin, rays[i].Origin, matrix, kind);
+        MTransDirectionAxisAligned(result[i].Direction, rays[i].Direction, matrix, kind);
+    }
+}
+
+#ifdef TRY_OPTIMIZED_TRANSFORM
+
+const OptimizedTransformInfo* GetRecommendedOptimizedTransform()
+{
+    for (const OptimizedTransformInfo* p = gaOptimizedTransformInfo; p->name != nullptr; ++p)
+    {
+        if ((p->enabled == nullptr) || *p->enabled)
+        {
+            POV_CORE_ASSERT(p->supported);
+            if (p->supported())
+                return p;
+        }
+    }
+
+    // No optimized implementation found; go for the portable implementation.
+    return &gPortableTransformInfo;
 }
 
+#endif // TRY_OPTIMIZED_TRANSFORM
+
 
 
 /*****************************************************************************
@@ -545,6 +739,8 @@ void Compute_Scaling_Transform (TRANSFORM *result, const Vector3d& vector)
     (result->inverse)[0][0] = 1.0 / vector[X];
     (result->inverse)[1][1] = 1.0 / vector[Y];
     (result->inverse)[2][2] = 1.0 / vector[Z];
+
+    result->kind = kTransform_AxisAligned;
 }
 
 
@@ -592,6 +788,8 @@ void Compute_Matrix_Transform (TRANSFORM *result, const MATRIX matrix)
     }
 
     MInvers(result->inverse, result->matrix);
+
+    Classify_Transform(result);
 }
 
 
@@ -654,6 +852,8 @@ void Compute_Translation_Transform (TRANSFORM *transform, const Vector3d& vector
     (transform->inverse)[3][0] = -vector[X];
     (transform->inverse)[3][1] = -vector[Y];
     (transform->inverse)[3][2] = -vector[Z];
+
+    transform->kind = kTransform_Translation;
 }
 
 
@@ -731,6 +931,8 @@ void Compute_Rotation_Transform (TRANSFORM *transform, const Vector3d& vector)
     MTranspose (Matrix);
 
     MTimesB (Matrix, transform->inverse);
+
+    Classify_Transform(transform);
 }
 
 
@@ -787,9 +989,13 @@ void Compute_Look_At_Transform (TRANSFORM *result, Vector3d& Look_At, Vector3d&
 
 void Compose_Transforms (TRANSFORM *Original_Transform, const TRANSFORM *Additional_Transform)
 {
+    POV_ASSERT(!Original_Transform->pooled);
+
     MTimesA(Original_Transform->matrix, Additional_Transform->matrix);
 
     MTimesB(Additional_Transform->inverse, Original_Transform->inverse);
+
+    Classify_Transform(Original_Transform);
 }
 
 
@@ -847,6 +1053,8 @@ void Compute_Axis_Rotation_Transform (TRANSFORM *transform, const Vector3d& Axis
     transform->matrix[2][2] = V1[Z] * V1[Z] + cosx * (1.0 - V1[Z] * V1[Z]);
 
     MTranspose(transform->inverse, transform->matrix);
+
+    Classify_Transform(transform);
 }
 
 
@@ -976,6 +1184,7 @@ TRANSFORM *Copy_Transform (const TRANSFORM*Old)
     {
         New  = Create_Transform ();
         *New = *Old;
+        New->pooled = false;
     }
     else
     {
@@ -1013,12 +1222,135 @@ TRANSFORM *Copy_Transform (const TRANSFORM*Old)
 
 void Destroy_Transform (TRANSFORM *Trans)
 {
-    if (Trans != nullptr)
+    if ((Trans != nullptr) && !Trans->pooled)
         delete Trans;
 }
 
 
 
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Classify_Transform
+*
+* INPUT
+*
+*   Trans - Transformation to classify
+*
+* OUTPUT
+*
+*   Trans - Transformation with its kind set
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Find the cheapest way to apply a transformation. Only matrices whose
+*   off-diagonal elements are exactly zero qualify for the cheaper paths,
+*   which merely skip the multiplications by zero.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+void Classify_Transform (TRANSFORM *Trans)
+{
+    bool axisAligned = true;
+    bool unitScale = true;
+
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            if (i == j)
+                unitScale = unitScale && (Trans->matrix[i][i] == 1.0) && (Trans->inverse[i][i] == 1.0);
+            else
+                axisAligned = axisAligned && (Trans->matrix[i][j] == 0.0) && (Trans->inverse[i][j] == 0.0);
+        }
+        axisAligned = axisAligned && (Trans->matrix[i][3] == 0.0) && (Trans->inverse[i][3] == 0.0);
+    }
+    axisAligned = axisAligned && (Trans->matrix[3][3] == 1.0) && (Trans->inverse[3][3] == 1.0);
+
+    if (!axisAligned)
+        Trans->kind = kTransform_General;
+    else if (unitScale)
+        Trans->kind = kTransform_Translation;
+    else
+        Trans->kind = kTransform_AxisAligned;
+}
+
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   TransformPool::Intern
+*
+* INPUT
+*
+*   trans - Transformation to share
+*
+* OUTPUT
+*
+* RETURNS
+*
+*   TRANSFORM * - Pooled transformation identical to trans
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Transformations are considered identical if both their matrices are
+*   bitwise identical, so sharing never changes the results of a render.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+TRANSFORM *TransformPool::Intern(TRANSFORM *trans)
+{
+    if ((trans == nullptr) || trans->pooled)
+        return trans;
+
+    // FNV-1a over the forward matrix only; candidates are compared in full
+    const unsigned char *bytes = reinterpret_cast<const unsigned char *>(trans->matrix);
+    size_t hash = 2166136261u;
+    for (size_t i = 0; i < sizeof(MATRIX); i++)
+        hash = (hash ^ bytes[i]) * 16777619u;
+
+    auto range = mTransforms.equal_range(hash);
+    for (auto i = range.first; i != range.second; ++i)
+    {
+        if ((memcmp(i->second->matrix, trans->matrix, sizeof(MATRIX)) == 0) &&
+            (memcmp(i->second->inverse, trans->inverse, sizeof(MATRIX)) == 0))
+        {
+            delete trans;
+            mDuplicates++;
+            return i->second;
+        }
+    }
+
+    trans->pooled = true;
+    mTransforms.emplace(hash, trans);
+    return trans;
+}
+
+TransformPool::~TransformPool()
+{
+    for (auto& i : mTransforms)
+        delete i.second;
+}
+
+
+
 /*****************************************************************************
 *
 * FUNCTION
@@ -40,9 +40,11 @@
 #include "core/configcore.h"
 
 // C++ variants of C standard header files
-// C++ standard header files
 //  (none at the moment)
 
+// C++ standard header files
+#include <unordered_map>
+
 // POV-Ray header files (base module)
 //  (none at the moment)
 
@@ -67,10 +69,24 @@ namespace pov
 typedef DBL MATRIX[4][4]; ///< @todo       Make this obsolete.
 
 
+/// Classes of transformations that can be applied more cheaply than by a full matrix multiply.
+enum TransformKind : unsigned char
+{
+    kTransform_General,         ///< Arbitrary affine transformation.
+    kTransform_AxisAligned,     ///< Scaling along the coordinate axes, followed by a translation.
+    kTransform_Translation,     ///< Pure translation.
+};
+
 struct Transform_Struct final
 {
     MATRIX matrix;
     MATRIX inverse;
+    /// How the transformation can be applied, as determined by @ref Classify_Transform().
+    /// @note   Code writing to the matrices directly must call @ref Classify_Transform()
+    ///         afterwards, unless the transformation is still in its default state.
+    TransformKind kind = kTransform_General;
+    /// Whether the transformation is owned by a @ref TransformPool.
+    bool pooled = false;
 };
 using TRANSFORM = Transform_Struct; ///< @deprecated
 
@@ -94,15 +110,134 @@ void MTransPoint        (Vector3d& result, const Vector3d& vector, const MATRIX
 void MTransDirection    (Vector3d& result, const Vector3d& vector, const MATRIX *matrix);
 void MInvTransNormal    (Vector3d& result, const Vector3d& vector, const MATRIX *matrix);
 
-inline void MTransPoint        (Vector3d& result, const Vector3d& vector, const TRANSFORM* trans) { MTransPoint     (result, vector, &trans->matrix);  }
-inline void MInvTransPoint     (Vector3d& result, const Vector3d& vector, const TRANSFORM* trans) { MTransPoint     (result, vector, &trans->inverse); }
-inline void MTransDirection    (Vector3d& result, const Vector3d& vector, const TRANSFORM* trans) { MTransDirection (result, vector, &trans->matrix);  }
-inline void MInvTransDirection (Vector3d& result, const Vector3d& vector, const TRANSFORM* trans) { MTransDirection (result, vector, &trans->inverse); }
-inline void MTransNormal       (Vector3d& result, const Vector3d& vector, const TRANSFORM* trans) { MInvTransNormal (result, vector, &trans->inverse); }
-inline void MInvTransNormal    (Vector3d& result, const Vector3d& vector, const TRANSFORM* trans) { MInvTransNormal (result, vector, &trans->matrix);  }
+/// @name Axis-Aligned Transformations
+///
+/// These functions apply a matrix known to be of kind @ref kTransform_AxisAligned or
+/// @ref kTransform_Translation, reading only its diagonal and translation. The result and
+/// source may be identical.
+///
+/// @{
+
+inline void MTransPointAxisAligned(Vector3d& result, const Vector3d& vector, const MATRIX *matrix, TransformKind kind)
+{
+    if (kind == kTransform_Translation)
+        result = Vector3d(vector[X] + (*matrix)[3][0], vector[Y] + (*matrix)[3][1], vector[Z] + (*matrix)[3][2]);
+    else
+        result = Vector3d(vector[X] * (*matrix)[0][0] + (*matrix)[3][0],
+                          vector[Y] * (*matrix)[1][1] + (*matrix)[3][1],
+                          vector[Z] * (*matrix)[2][2] + (*matrix)[3][2]);
+}
+
+inline void MTransDirectionAxisAligned(Vector3d& result, const Vector3d& vector, const MATRIX *matrix, TransformKind kind)
+{
+    if (kind == kTransform_Translation)
+        result = vector;
+    else
+        result = Vector3d(vector[X] * (*matrix)[0][0], vector[Y] * (*matrix)[1][1], vector[Z] * (*matrix)[2][2]);
+}
+
+/// @}
+
+inline void MTransPoint (Vector3d& result, const Vector3d& vector, const TRANSFORM* trans)
+{
+    if (trans->kind == kTransform_General)
+        MTransPoint (result, vector, &trans->matrix);
+    else
+        MTransPointAxisAligned (result, vector, &trans->matrix, trans->kind);
+}
+
+inline void MInvTransPoint (Vector3d& result, const Vector3d& vector, const TRANSFORM* trans)
+{
+    if (trans->kind == kTransform_General)
+        MTransPoint (result, vector, &trans->inverse);
+    else
+        MTransPointAxisAligned (result, vector, &trans->inverse, trans->kind);
+}
+
+inline void MTransDirection (Vector3d& result, const Vector3d& vector, const TRANSFORM* trans)
+{
+    if (trans->kind == kTransform_General)
+        MTransDirection (result, vector, &trans->matrix);
+    else
+        MTransDirectionAxisAligned (result, vector, &trans->matrix, trans->kind);
+}
+
+inline void MInvTransDirection (Vector3d& result, const Vector3d& vector, const TRANSFORM* trans)
+{
+    if (trans->kind == kTransform_General)
+        MTransDirection (result, vector, &trans->inverse);
+    else
+        MTransDirectionAxisAligned (result, vector, &trans->inverse, trans->kind);
+}
+
+// for a diagonal matrix, the transposed inverse is the inverse itself
+inline void MTransNormal (Vector3d& result, const Vector3d& vector, const TRANSFORM* trans)
+{
+    if (trans->kind == kTransform_General)
+        MInvTransNormal (result, vector, &trans->inverse);
+    else
+        MTransDirectionAxisAligned (result, vector, &trans->inverse, trans->kind);
+}
+
+inline void MInvTransNormal (Vector3d& result, const Vector3d& vector, const TRANSFORM* trans)
+{
+    if (trans->kind == kTransform_General)
+        MInvTransNormal (result, vector, &trans->matrix);
+    else
+        MTransDirectionAxisAligned (result, vector, &trans->matrix, trans->kind);
+}
+
+/// @name Batched Transformations
+///
+/// These functions transform several vectors or rays by the same matrix, loading the matrix only
+/// once. The result and source arrays may be identical, but must not otherwise overlap.
+///
+/// @{
+
+void MTransPoints       (Vector3d result[], const Vector3d vectors[], size_t count, const MATRIX *matrix);
+void MTransDirections   (Vector3d result[], const Vector3d vectors[], size_t count, const MATRIX *matrix);
+void MInvTransNormals   (Vector3d result[], const Vector3d vectors[], size_t count, const MATRIX *matrix);
+void MTransRays         (BasicRay result[], const BasicRay rays[], size_t count, const MATRIX *matrix);
+
+/// @}
+
+void MTransPointsAxisAligned (Vector3d result[], const Vector3d vectors[], size_t count, const MATRIX *matrix, TransformKind kind);
+void MTransRaysAxisAligned   (BasicRay result[], const BasicRay rays[], size_t count, const MATRIX *matrix, TransformKind kind);
 
-inline void MTransRay    (BasicRay& res, const BasicRay& r, const TRANSFORM* t) { MTransPoint    (res.Origin, r.Origin, t); MTransDirection    (res.Direction, r.Direction, t); }
-inline void MInvTransRay (BasicRay& res, const BasicRay& r, const TRANSFORM* t) { MInvTransPoint (res.Origin, r.Origin, t); MInvTransDirection (res.Direction, r.Direction, t); }
+inline void MTransPoints (Vector3d result[], const Vector3d vectors[], size_t count, const TRANSFORM* trans)
+{
+    if (trans->kind == kTransform_General)
+        MTransPoints (result, vectors, count, &trans->matrix);
+    else
+        MTransPointsAxisAligned (result, vectors, count, &trans->matrix, trans->kind);
+}
+
+inline void MInvTransPoints (Vector3d result[], const Vector3d vectors[], size_t count, const TRANSFORM* trans)
+{
+    if (trans->kind == kTransform_General)
+        MTransPoints (result, vectors, count, &trans->inverse);
+    else
+        MTransPointsAxisAligned (result, vectors, count, &trans->inverse, trans->kind);
+}
+
+inline void MTransRays (BasicRay res[], const BasicRay r[], size_t count, const TRANSFORM* t)
+{
+    if (t->kind == kTransform_General)
+        MTransRays (res, r, count, &t->matrix);
+    else
+        MTransRaysAxisAligned (res, r, count, &t->matrix, t->kind);
+}
+
+inline void MInvTransRays (BasicRay res[], const BasicRay r[], size_t count, const TRANSFORM* t)
+{
+    if (t->kind == kTransform_General)
+        MTransRays (res, r, count, &t->inverse);
+    else
+        MTransRaysAxisAligned (res, r, count, &t->inverse, t->kind);
+}
+
+inline void MTransRay    (BasicRay& res, const BasicRay& r, const TRANSFORM* t) { MTransRays    (&res, &r, 1, t); }
+inline void MInvTransRay (BasicRay& res, const BasicRay& r, const TRANSFORM* t) { MInvTransRays (&res, &r, 1, t); }
 
 void Compute_Matrix_Transform (TRANSFORM *result, const MATRIX matrix);
 void Compute_Scaling_Transform (TRANSFORM *result, const Vector3d& vector);
@@ -116,10 +251,103 @@ void Compute_Coordinate_Transform (TRANSFORM *trans, const Vector3d& origin, Vec
 TRANSFORM *Create_Transform (void);
 TRANSFORM *Copy_Transform (const TRANSFORM *Old);
 void Destroy_Transform (TRANSFORM *Trans);
+void Classify_Transform (TRANSFORM *Trans);
 DBL *Create_Float (void);
 void MInvers (MATRIX r, const MATRIX m);
 int MInvers3(const Matrix3x3& inM, Matrix3x3& outM);
 
+/// Pool of transformations shared between objects.
+///
+/// Once a scene has been parsed its transformations no longer change, so objects carrying
+/// identical transformations (as is common in generated scenes) can share a single copy.
+/// Pooled transformations are owned by the pool: @ref Destroy_Transform() leaves them alone,
+/// and @ref Copy_Transform() turns them into regular transformations again.
+///
+class TransformPool final
+{
+    public:
+
+        TransformPool() = default;
+        ~TransformPool();
+
+        TransformPool(const TransformPool&) = delete;
+        TransformPool& operator=(const TransformPool&) = delete;
+
+        /// Get the pooled equivalent of a transformation.
+        ///
+        /// @param[in]  trans   Transformation to share, or `nullptr`. Unless already pooled,
+        ///                     ownership passes to the pool, which may destroy it right away.
+        /// @return             Pooled transformation identical to @p trans, or `nullptr`.
+        ///
+        TRANSFORM *Intern(TRANSFORM *trans);
+
+        /// Get the number of transformations in the pool.
+        inline size_t size() const { return mTransforms.size(); }
+
+        /// Get the number of transformations found to duplicate a pooled one.
+        inline size_t duplicates() const { return mDuplicates; }
+
+    private:
+
+        std::unordered_multimap<size_t, TRANSFORM*> mTransforms;
+        size_t mDuplicates = 0;
+};
+
+#ifdef TRY_OPTIMIZED_TRANSFORM
+
+/// Optimized transformation of several vectors by the same matrix.
+///
+/// Implementations must compute the same results as the corresponding portable functions, except
+/// for rounding differences due to the use of fused multiply-add. The result and source arrays
+/// may be identical, but must not otherwise overlap.
+///
+/// @param[out] result      Transformed vectors.
+/// @param[in]  vectors     Vectors to transform.
+/// @param[in]  count       Number of vectors.
+/// @param[in]  matrix      Matrix to transform by.
+///
+typedef void (*TransformVectorsFunction)(Vector3d result[], const Vector3d vectors[], size_t count, const MATRIX *matrix);
+
+/// Optimized transformation of several rays by the same matrix.
+///
+/// Only the origin and direction of the result rays are written; see @ref TransformVectorsFunction.
+///
+typedef void (*TransformRaysFunction)(BasicRay result[], const BasicRay rays[], size_t count, const MATRIX *matrix);
+
+/// Optimized transformation dispatch information.
+///
+/// See @ref OptimizedNoiseInfo for the meaning of the `name`, `info`, `enabled` and `supported`
+/// fields. The remaining fields implement @ref MTransPoints(), @ref MTransDirections(),
+/// @ref MInvTransNormals() and @ref MTransRays(), as well as their single-vector counterparts.
+///
+struct OptimizedTransformInfo final
+{
+    const char* name;
+    const char* info;
+    TransformVectorsFunction transformPoints;
+    TransformVectorsFunction transformDirections;
+    TransformVectorsFunction invTransformNormals;
+    TransformRaysFunction transformRays;
+    const bool* enabled;
+    bool(*supported)();
+};
+
+/// Optimized transformation dispatch table.
+///
+/// This table contains a list of all available optimized implementations, sorted by descending
+/// order of preference. The end of the table is indicated by an entry with the `name` field set
+/// to `nullptr`.
+///
+/// @note
+///     This table must be implemented by platform-specific code.
+///
+extern OptimizedTransformInfo gaOptimizedTransformInfo[];
+
+/// Get the recommended transformation implementation for the current runtime environment.
+const OptimizedTransformInfo* GetRecommendedOptimizedTransform();
+
+#endif // TRY_OPTIMIZED_TRANSFORM
+
 /// @}
 ///
 //##############################################################################
@@ -39,9 +39,11 @@
 #include "core/math/polynomialsolver.h"
 
 // C++ variants of C standard header files
-// C++ standard header files
 //  (none at the moment)
 
+// C++ standard header files
+#include <algorithm>
+
 // POV-Ray header files (base module)
 //  (none at the moment)
 
@@ -109,6 +111,18 @@ const DBL SMALL_ENOUGH = 1.0e-10;
 /* Smallest relative error we want. */
 const DBL RELERROR = 1.0e-12;
 
+/* Number of Newton steps used to polish the roots of the closed-form quartic solver. */
+const int QUARTIC_POLISH_STEPS = 2;
+
+/* Largest relative residual of a polished quartic root before falling back to Sturm sequences. */
+const DBL QUARTIC_MAX_RESIDUAL = 1.0e-6;
+
+/* Maximum number of times Solve_Polynomial_01() halves the interval. */
+const int BERNSTEIN_MAX_DEPTH = 64;
+
+/* Maximum number of steps Solve_Polynomial_01() takes to close in on a single root. */
+const int BERNSTEIN_MAX_ITERATIONS = 100;
+
 
 /*****************************************************************************
 * Local typedefs
@@ -1728,5 +1742,373 @@ int Solve_Polynomial(int n, const DBL *c0, DBL *r, int sturm, DBL epsilon, Rende
     return(roots);
 }
 
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Solve_Polynomials
+*
+* INPUT
+*
+*   n       - order of the polynomials
+*   count   - number of polynomials
+*   c       - coefficients of all polynomials, n+1 per polynomial
+*   sturm   - true, if Sturm sequences should be used
+*   epsilon - Tolerance to discard small roots
+*
+* OUTPUT
+*
+*   r       - roots of all polynomials, n per polynomial
+*   roots   - number of roots found per polynomial
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Solve a batch of polynomial equations of the same order, with the same
+*   results as calling Solve_Polynomial() for each of them.
+*
+*   Quadratic equations are solved in a loop free of data-dependent branches,
+*   which the compiler can vectorize. Higher orders are solved one by one.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+void Solve_Polynomials(int n, unsigned int count, const DBL *c, DBL *r, int *roots, int sturm, DBL epsilon, RenderStatistics& stats)
+{
+    unsigned int k;
+
+    if (n != 2)
+    {
+        for (k = 0; k < count; k++)
+        {
+            roots[k] = Solve_Polynomial(n, &c[k * (n + 1)], &r[k * n], sturm, epsilon, stats);
+        }
+
+        return;
+    }
+
+    stats[Polynomials_Tested] += count;
+
+    for (k = 0; k < count; k++)
+    {
+        DBL a  = c[3 * k];
+        DBL b  = -c[3 * k + 1];
+        DBL cc = c[3 * k + 2];
+
+        /* Degenerate cases as in Solve_Polynomial(), i.e. small leading coefficients. */
+
+        bool linear = (fabs(a) < SMALL_ENOUGH);
+        bool none   = linear && (fabs(b) < SMALL_ENOUGH);
+
+        /* Quadratic case as in solve_quadratic(). */
+
+        DBL an = linear ? 1.0 : a;
+        DBL bn = b / an;
+        DBL cn = cc / an;
+        DBL d  = bn * bn - 4.0 * cn;
+        DBL s  = (d >= SMALL_ENOUGH) ? sqrt(d) : 0.0;
+
+        int quadratic = (d >= SMALL_ENOUGH) ? 2 : ((d > -SMALL_ENOUGH) ? 1 : 0);
+
+        r[2 * k]     = linear ? cc / (none ? 1.0 : b) : 0.5 * (bn + s);
+        r[2 * k + 1] = 0.5 * (bn - s);
+
+        roots[k] = linear ? (none ? 0 : 1) : quadratic;
+    }
+}
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Solve_Polynomial_01
+*
+* INPUT
+*
+*   n       - order of the polynomial
+*   c       - coefficients of the polynomial
+*   epsilon - precision to locate the roots with
+*
+* OUTPUT
+*
+*   r       - roots found, in ascending order
+*
+* RETURNS
+*
+*   int - number of roots found
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Find the roots of the polynomial equation
+*
+*     c[0] * x ^ n + c[1] * x ^ (n-1) + ... + c[n-1] * x + c[n] = 0
+*
+*   within the interval [0, 1] only.
+*
+*   The polynomial is converted to Bernstein form, and the interval is
+*   subdivided until the control polygon of each part crosses zero no more
+*   than once. By the variation diminishing property, a part whose control
+*   polygon doesn't cross zero has no roots, and one whose control polygon
+*   crosses zero once has a single root, which is then closed in on.
+*
+*   Parts that shrink below epsilon without being resolved, e.g. around
+*   double roots, count as a single root if the polynomial changes sign
+*   across them and as none otherwise. This way the number of roots found
+*   always has the right parity, which is what ray intersection tests
+*   relying on entering and leaving intersections to come in pairs need.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+int Solve_Polynomial_01(int n, const DBL *c, DBL *r, DBL epsilon, RenderStatistics& stats)
+{
+    struct Part final
+    {
+        DBL lo, hi;
+        DBL b[MAX_ORDER + 1];
+    };
+
+    // Subdivision is depth-first, so we need to keep at most one pending part per level.
+    Part stack[BERNSTEIN_MAX_DEPTH + 2];
+    int sp = 0;
+    int roots = 0;
+    int i, j;
+
+    stats[Polynomials_Tested]++;
+
+    if ((n < 1) || (n > MAX_ORDER))
+        return 0;
+
+    // Convert to Bernstein form; b[k] = sum(j = 0..k) binomial(k,j) / binomial(n,j) * a[j],
+    // with a[j] the coefficient of x ^ j.
+
+    Part& top = stack[sp++];
+    top.lo = 0.0;
+    top.hi = 1.0;
+    for (i = 0; i <= n; i++)
+    {
+        DBL ckj = 1.0;  // binomial(i,j)
+        DBL cnj = 1.0;  // binomial(n,j)
+        top.b[i] = 0.0;
+        for (j = 0; j <= i; j++)
+        {
+            top.b[i] += ckj / cnj * c[n - j];
+            ckj = ckj * (i - j) / (j + 1);
+            cnj = cnj * (n - j) / (j + 1);
+        }
+    }
+
+    if (top.b[0] == 0.0)
+        r[roots++] = 0.0;
+    bool rootAtOne = (top.b[n] == 0.0);
+
+    while (sp > 0)
+    {
+        Part part = stack[--sp];
+
+        // Count sign changes of the control polygon, ignoring zero coefficients.
+
+        int changes = 0;
+        DBL first = 0.0, last = 0.0;
+        for (i = 0; i <= n; i++)
+        {
+            if (part.b[i] == 0.0)
+                continue;
+            if (first == 0.0)
+                first = part.b[i];
+            else if ((last < 0.0) != (part.b[i] < 0.0))
+                changes++;
+            last = part.b[i];
+        }
+
+        if (changes == 0)
+            continue;
+
+        if (changes == 1)
+        {
+            // Single root; close in on it using the Illinois variant of regula falsi.
+
+            DBL a = part.lo, b = part.hi;
+            DBL fa = ((part.b[0] != 0.0) ? part.b[0] : first);
+            DBL fb = ((part.b[n] != 0.0) ? part.b[n] : last);
+            DBL x = 0.5 * (a + b);
+            int side = 0;
+
+            for (i = 0; (i < BERNSTEIN_MAX_ITERATIONS) && (b - a > epsilon); i++)
+            {
+                x = (fb * a - fa * b) / (fb - fa);
+                if (!(x > a && x < b))
+                    x = 0.5 * (a + b);
+
+                DBL fx = c[0];
+                for (j = 1; j <= n; j++)
+                    fx = fx * x + c[j];
+                if (fx == 0.0)
+                    break;
+
+                if ((fx < 0.0) == (fa < 0.0))
+                {
+                    a = x;
+                    fa = fx;
+                    if (side == -1)
+                        fb *= 0.5;
+                    side = -1;
+                }
+                else
+                {
+                    b = x;
+                    fb = fx;
+                    if (side == 1)
+                        fa *= 0.5;
+                    side = 1;
+                }
+            }
+
+            if (roots < n)
+                r[roots++] = x;
+            continue;
+        }
+
+        if ((part.hi - part.lo < epsilon) || (sp >= BERNSTEIN_MAX_DEPTH))
+        {
+            // Unresolved cluster of roots; keep the parity right.
+            if (((first < 0.0) != (last < 0.0)) && (roots < n))
+                r[roots++] = 0.5 * (part.lo + part.hi);
+            continue;
+        }
+
+        // Split in half using de Casteljau's algorithm; the right half is pushed first,
+        // so that the left half is examined first.
+
+        Part& right = stack[sp++];
+        Part& left = stack[sp++];
+        DBL mid = 0.5 * (part.lo + part.hi);
+
+        right.lo = left.hi = mid;
+        left.lo = part.lo;
+        right.hi = part.hi;
+
+        for (i = 0; i <= n; i++)
+        {
+            left.b[i] = part.b[0];
+            right.b[n - i] = part.b[n - i];
+            for (j = 0; j < n - i; j++)
+                part.b[j] = 0.5 * (part.b[j] + part.b[j + 1]);
+        }
+
+        if ((left.b[n] == 0.0) && (roots < n))
+            r[roots++] = mid;
+    }
+
+    if (rootAtOne && (roots < n))
+        r[roots++] = 1.0;
+
+    // Roots at split points are found out of order.
+    for (i = 1; i < roots; i++)
+        for (j = i; (j > 0) && (r[j - 1] > r[j]); j--)
+            std::swap(r[j - 1], r[j]);
+
+    return roots;
+}
+
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Solve_Quartic
+*
+* INPUT
+*
+*   c       - coefficients of the quartic
+*   sturm   - true, if Sturm sequences should be used
+*   epsilon - Tolerance to discard small roots
+*
+* OUTPUT
+*
+*   r       - roots found
+*
+* RETURNS
+*
+*   int - number of roots found
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Solve a quartic equation, preferring the closed-form solver.
+*
+*   The roots found by the closed-form solver are polished by a few Newton
+*   steps. If any of them still leaves a noticeable residual, the equation
+*   is solved again using Sturm sequences. This gives the accuracy of the
+*   Sturm solver at close to the speed of the closed-form solver for well-
+*   behaved equations such as those of a torus.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+int Solve_Quartic(const DBL *c, DBL *r, int sturm, DBL epsilon, RenderStatistics& stats)
+{
+    int roots, i, j;
+    DBL x, p, dp, scale, ax;
+
+    roots = Solve_Polynomial(4, c, r, sturm, epsilon, stats);
+
+    if (sturm)
+    {
+        return(roots);
+    }
+
+    for (i = 0; i < roots; i++)
+    {
+        x = r[i];
+
+        for (j = 0; j <= QUARTIC_POLISH_STEPS; j++)
+        {
+            p  = (((c[0] * x + c[1]) * x + c[2]) * x + c[3]) * x + c[4];
+            dp = ((4.0 * c[0] * x + 3.0 * c[1]) * x + 2.0 * c[2]) * x + c[3];
+
+            if ((j == QUARTIC_POLISH_STEPS) || (fabs(dp) < SMALL_ENOUGH))
+            {
+                break;
+            }
+
+            x -= p / dp;
+        }
+
+        /* Measure the residual relative to the magnitude of the terms. */
+
+        ax = fabs(x);
+        scale = (((fabs(c[0]) * ax + fabs(c[1])) * ax + fabs(c[2])) * ax + fabs(c[3])) * ax + fabs(c[4]);
+
+        if (fabs(p) > QUARTIC_MAX_RESIDUAL * scale)
+        {
+            return Solve_Polynomial(4, c, r, true, epsilon, stats);
+        }
+
+        r[i] = x;
+    }
+
+    return(roots);
+}
+
 }
 // end of namespace pov
@@ -71,6 +71,9 @@ class RenderStatistics;
 ******************************************************************************/
 
 int Solve_Polynomial (int n, const DBL *c, DBL *r, int sturm, DBL epsilon, RenderStatistics& stats);
+void Solve_Polynomials (int n, unsigned int count, const DBL *c, DBL *r, int *roots, int sturm, DBL epsilon, RenderStatistics& stats);
+int Solve_Polynomial_01 (int n, const DBL *c, DBL *r, DBL epsilon, RenderStatistics& stats);
+int Solve_Quartic (const DBL *c, DBL *r, int sturm, DBL epsilon, RenderStatistics& stats);
 
 /// @}
 ///
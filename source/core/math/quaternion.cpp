@@ -229,6 +229,186 @@ bool JuliaFractalRules::Iterate(const Vector3d& point, const Fractal *Julia, DBL
 
 
 
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Z3FractalRules::Iterate
+*
+* INPUT
+*
+*   points - points to test
+*   count  - number of points, at most kMaxBatchSize
+*   Julia  - fractal to test against
+*
+* OUTPUT
+*
+*   inside - whether each of the points is inside the set
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Iterate several points in lock-step, without recording the iteration
+*   sequences. The lanes of points that have escaped are kept unchanged, and
+*   unused lanes repeat the first point, so that the inner loops have a fixed
+*   trip count and no branches, and can be vectorized by the compiler.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+void Z3FractalRules::Iterate(const Vector3d *points, unsigned int count, const Fractal *Julia, DBL **, bool *inside) const
+{
+    DBL x[kMaxBatchSize], y[kMaxBatchSize], z[kMaxBatchSize], w[kMaxBatchSize];
+    bool escaped[kMaxBatchSize];
+    unsigned int k;
+    int i;
+
+    for (k = 0; k < kMaxBatchSize; ++k)
+    {
+        const Vector3d& point = points[(k < count) ? k : 0];
+
+        x[k] = point[X];
+        y[k] = point[Y];
+        z[k] = point[Z];
+        w[k] = (Julia->SliceDist
+                - Julia->Slice[X]*x[k]
+                - Julia->Slice[Y]*y[k]
+                - Julia->Slice[Z]*z[k])/Julia->Slice[T];
+        escaped[k] = false;
+    }
+
+    const DBL Exit_Value = Julia->Exit_Value;
+
+    for (i = 1; i <= Julia->Num_Iterations; ++i)
+    {
+        bool allEscaped = true;
+
+        for (k = 0; k < kMaxBatchSize; ++k)
+        {
+            DBL d = y[k] * y[k] + z[k] * z[k] + w[k] * w[k];
+            DBL x2 = x[k] * x[k];
+
+            escaped[k] = escaped[k] || ((d + x2) > Exit_Value);
+
+            DBL tmp = 3.0 * x2 - d;
+            DBL xn = x[k] * (x2 - 3.0 * d) + Julia->Julia_Parm[X];
+            DBL yn = y[k] * tmp + Julia->Julia_Parm[Y];
+            DBL zn = z[k] * tmp + Julia->Julia_Parm[Z];
+            DBL wn = w[k] * tmp + Julia->Julia_Parm[T];
+
+            x[k] = escaped[k] ? x[k] : xn;
+            y[k] = escaped[k] ? y[k] : yn;
+            z[k] = escaped[k] ? z[k] : zn;
+            w[k] = escaped[k] ? w[k] : wn;
+            allEscaped = allEscaped && escaped[k];
+        }
+
+        if (allEscaped)
+            break;
+    }
+
+    for (k = 0; k < count; ++k)
+        inside[k] = !escaped[k];
+}
+
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   JuliaFractalRules::Iterate
+*
+* INPUT
+*
+*   points - points to test
+*   count  - number of points, at most kMaxBatchSize
+*   Julia  - fractal to test against
+*
+* OUTPUT
+*
+*   inside - whether each of the points is inside the set
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Iterate several points in lock-step, without recording the iteration
+*   sequences. The lanes of points that have escaped are kept unchanged, and
+*   unused lanes repeat the first point, so that the inner loops have a fixed
+*   trip count and no branches, and can be vectorized by the compiler.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+void JuliaFractalRules::Iterate(const Vector3d *points, unsigned int count, const Fractal *Julia, DBL **, bool *inside) const
+{
+    DBL x[kMaxBatchSize], y[kMaxBatchSize], z[kMaxBatchSize], w[kMaxBatchSize];
+    bool escaped[kMaxBatchSize];
+    unsigned int k;
+    int i;
+
+    for (k = 0; k < kMaxBatchSize; ++k)
+    {
+        const Vector3d& point = points[(k < count) ? k : 0];
+
+        x[k] = point[X];
+        y[k] = point[Y];
+        z[k] = point[Z];
+        w[k] = (Julia->SliceDist
+                - Julia->Slice[X]*x[k]
+                - Julia->Slice[Y]*y[k]
+                - Julia->Slice[Z]*z[k])/Julia->Slice[T];
+        escaped[k] = false;
+    }
+
+    const DBL Exit_Value = Julia->Exit_Value;
+
+    for (i = 1; i <= Julia->Num_Iterations; ++i)
+    {
+        bool allEscaped = true;
+
+        for (k = 0; k < kMaxBatchSize; ++k)
+        {
+            DBL d = y[k] * y[k] + z[k] * z[k] + w[k] * w[k];
+            DBL x2 = x[k] * x[k];
+
+            escaped[k] = escaped[k] || ((d + x2) > Exit_Value);
+
+            DBL x2x = 2.0 * x[k];
+            DBL xn = x2 - d + Julia->Julia_Parm[X];
+            DBL yn = x2x * y[k] + Julia->Julia_Parm[Y];
+            DBL zn = x2x * z[k] + Julia->Julia_Parm[Z];
+            DBL wn = x2x * w[k] + Julia->Julia_Parm[T];
+
+            x[k] = escaped[k] ? x[k] : xn;
+            y[k] = escaped[k] ? y[k] : yn;
+            z[k] = escaped[k] ? z[k] : zn;
+            w[k] = escaped[k] ? w[k] : wn;
+            allEscaped = allEscaped && escaped[k];
+        }
+
+        if (allEscaped)
+            break;
+    }
+
+    for (k = 0; k < count; ++k)
+        inside[k] = !escaped[k];
+}
+
+
+
 /*****************************************************************************
 *
 * FUNCTION
@@ -80,6 +80,7 @@ class JuliaFractalRules final : public QuaternionFractalRules
         virtual void CalcNormal (Vector3d&, int, const Fractal *, DBL **) const override;
         virtual bool Iterate (const Vector3d&, const Fractal *, DBL **) const override;
         virtual bool Iterate (const Vector3d&, const Fractal *, const Vector3d&, DBL *, DBL **) const override;
+        virtual void Iterate (const Vector3d *, unsigned int, const Fractal *, DBL **, bool *) const override;
 };
 
 class Z3FractalRules final : public QuaternionFractalRules
@@ -89,6 +90,7 @@ class Z3FractalRules final : public QuaternionFractalRules
         virtual void CalcNormal (Vector3d&, int, const Fractal *, DBL **) const override;
         virtual bool Iterate (const Vector3d&, const Fractal *, DBL **) const override;
         virtual bool Iterate (const Vector3d&, const Fractal *, const Vector3d&, DBL *, DBL **) const override;
+        virtual void Iterate (const Vector3d *, unsigned int, const Fractal *, DBL **, bool *) const override;
 };
 
 /// @}
@@ -0,0 +1,131 @@
+//******************************************************************************
+///
+/// @file core/math/samplesequence.h
+///
+/// Declarations related to well-distributed sample values for stochastic sampling.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+#ifndef POVRAY_CORE_SAMPLESEQUENCE_H
+#define POVRAY_CORE_SAMPLESEQUENCE_H
+
+// Module config header file must be the first file included within POV-Ray unit header files
+#include "core/configcore.h"
+
+// C++ variants of C standard header files
+// C++ standard header files
+//  (none at the moment)
+
+// POV-Ray header files (base module)
+//  (none at the moment)
+
+// POV-Ray header files (core module)
+#include "core/math/vector.h"
+
+namespace pov
+{
+
+//##############################################################################
+///
+/// @defgroup PovCoreMathSampleSequence Sample Sequences
+/// @ingroup PovCoreMath
+///
+/// @{
+
+/// Source of well-distributed sample values for stochastic sampling.
+///
+/// Values are accessed by pixel, sample number within the pixel, and dimension, and come in pairs.
+/// Each pair of dimensions is taken from the first two dimensions of a Sobol sequence with
+/// hash-based Owen scrambling, with independent scrambling and sample order for each pair, so
+/// that any number of leading samples of a pixel is well stratified in each pair. Pixels are
+/// decorrelated by a toroidal shift taken from a precomputed blue-noise tile, which distributes
+/// the remaining error over the image as high-frequency noise rather than clumps.
+///
+/// All values are computed on the fly from a few integer operations and a single table lookup,
+/// and only depend on the arguments and the seed; the order in which pixels are rendered does not
+/// matter.
+///
+class SampleSequence final
+{
+    public:
+
+        /// Dimension pairs reserved for particular samplers.
+        enum Dimension : unsigned int
+        {
+            kPixelDimension     = 0,    ///< Sub-pixel position of camera rays.
+            kFirstFreeDimension = 1,    ///< First pair handed out by @ref Next2d().
+        };
+
+        /// Pixel sample currently being traced.
+        ///
+        /// Samplers below the pixel level that draw their values from @ref Next2d() get a new
+        /// pair of dimensions on each call, in the order the calls are made while tracing the
+        /// sample.
+        ///
+        struct Context final
+        {
+            unsigned int x;         ///< Pixel column.
+            unsigned int y;         ///< Pixel row.
+            unsigned int sample;    ///< Sample number within the pixel.
+            unsigned int dimension; ///< Next dimension pair to hand out.
+            bool valid;             ///< Whether a pixel sample is being traced at all.
+
+            Context() : x(0), y(0), sample(0), dimension(kFirstFreeDimension), valid(false) {}
+            Context(unsigned int px, unsigned int py, unsigned int s) : x(px), y(py), sample(s), dimension(kFirstFreeDimension), valid(true) {}
+        };
+
+        explicit SampleSequence(unsigned int seed = 0) : mSeed(seed) {}
+
+        /// Get a pair of sample values.
+        ///
+        /// @param[in]  x           Pixel column.
+        /// @param[in]  y           Pixel row.
+        /// @param[in]  sample      Sample number within the pixel.
+        /// @param[in]  dimension   Dimension pair.
+        /// @return                 Sample values in the range [0..1).
+        ///
+        Vector2d Get2d(unsigned int x, unsigned int y, unsigned int sample, unsigned int dimension) const;
+
+        /// Get the next pair of sample values for the pixel sample currently being traced.
+        Vector2d Next2d(Context& context) const { return Get2d(context.x, context.y, context.sample, context.dimension++); }
+
+    private:
+
+        unsigned int mSeed;
+};
+
+/// @}
+///
+//##############################################################################
+
+}
+// end of namespace pov
+
+#endif // POVRAY_CORE_SAMPLESEQUENCE_H
@@ -50,6 +50,7 @@
 #include <cstring>
 
 // C++ standard header files
+#include <algorithm>
 #include <limits>
 
 // POV-Ray header files (base module)
@@ -76,6 +77,15 @@ namespace pov
 * Local preprocessor defines
 ******************************************************************************/
 
+/// Minimum number of entries for a spline to get a segment lookup table.
+const SplineEntryList::size_type kSplineLookupMinEntries = 16;
+
+/// Number of segment lookup table intervals per spline segment.
+const SplineEntryList::size_type kSplineLookupDensity = 2;
+
+/// Maximum number of segment lookup table intervals.
+const SplineEntryList::size_type kSplineLookupMaxSize = 65536;
+
 
 /*****************************************************************************
 * Local typedefs
@@ -857,6 +867,143 @@ SplineEntryList::size_type findt(const GenericSpline * sp, DBL Time)
 }
 
 
+/*****************************************************************************
+*
+* FUNCTION
+*
+*       GenericSpline::FindSegment
+*
+* INPUT
+*
+*       p : The parameter to search for
+*
+* OUTPUT
+*
+* RETURNS
+*
+*       The same as findt()
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*       Spline functions are typically evaluated at steadily increasing or
+*       decreasing parameters, so the segment found last time, or the one
+*       next to it, is usually the right one. Otherwise the lookup table
+*       narrows the search down to the few entries within one interval.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+SplineEntryList::size_type GenericSpline::FindSegment(DBL p) const
+{
+    const SplineEntryList& se = SplineEntries;
+    SplineEntryList::size_type numEntries = se.size();
+
+    if(numEntries == 0) return 0;
+    if(p <= se.front().par) return 0;
+    if(p >= se.back().par) return numEntries;
+
+    // From here on, se[0].par < p < se[numEntries-1].par; we're looking for the segment i
+    // with se[i-1].par < p <= se[i].par.
+
+    SplineEntryList::size_type i = LastSegment.load(std::memory_order_relaxed);
+    if((i > 0) && (i < numEntries) && (p > se[i-1].par))
+    {
+        if(p <= se[i].par)
+            return i;
+        if(p <= se[i+1].par) // se[i].par < p < se.back().par, so i+1 is a valid entry
+        {
+            LastSegment.store(i+1, std::memory_order_relaxed);
+            return i+1;
+        }
+    }
+    else if((i > 1) && (i < numEntries) && (p <= se[i-1].par) && (p > se[i-2].par))
+    {
+        LastSegment.store(i-1, std::memory_order_relaxed);
+        return i-1;
+    }
+
+    if(SegmentLookup.empty())
+        i = findt(this, p);
+    else
+    {
+        SplineEntryList::size_type cell = SplineEntryList::size_type((p - se.front().par) * SegmentLookupScale);
+        cell = std::min(cell, SegmentLookup.size() - 2);
+        SplineEntryList::size_type lo = SegmentLookup[cell];
+        SplineEntryList::size_type hi = SegmentLookup[cell+1];
+
+        // guard against rounding having placed p in a neighbouring interval
+        if((lo > 0) && (se[lo-1].par >= p))
+            lo = 0;
+        if(se[hi].par < p)
+            hi = numEntries - 1;
+
+        i = std::lower_bound(se.begin() + lo, se.begin() + hi + 1, p,
+                             [](const SplineEntry& e, DBL t) { return e.par < t; }) - se.begin();
+    }
+
+    LastSegment.store(i, std::memory_order_relaxed);
+    return i;
+}
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*       GenericSpline::PrepareLookup
+*
+* INPUT
+*
+* OUTPUT
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*       Divides the parameter range into equally sized intervals, and notes
+*       the segment at the start of each, so that FindSegment() only needs to
+*       search the entries within a single interval.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+void GenericSpline::PrepareLookup()
+{
+    const SplineEntryList& se = SplineEntries;
+    SplineEntryList::size_type numEntries = se.size();
+
+    SegmentLookup.clear();
+    LastSegment.store(0, std::memory_order_relaxed);
+
+    if((numEntries < kSplineLookupMinEntries) || !(se.back().par > se.front().par))
+        return;
+
+    SplineEntryList::size_type cells = std::min(numEntries * kSplineLookupDensity, kSplineLookupMaxSize);
+    DBL start = se.front().par;
+    SegmentLookupScale = DBL(cells) / (se.back().par - start);
+
+    SegmentLookup.resize(cells + 1);
+    SplineEntryList::size_type i = 0;
+    for(SplineEntryList::size_type cell = 0; cell <= cells; cell++)
+    {
+        DBL t = start + DBL(cell) / SegmentLookupScale;
+        while((i < numEntries - 1) && (se[i].par < t))
+            i++;
+        SegmentLookup[cell] = (unsigned int)i;
+    }
+}
+
+
 /*****************************************************************************
 *
 * FUNCTION
@@ -891,7 +1038,9 @@ SplineEntryList::size_type findt(const GenericSpline * sp, DBL Time)
 GenericSpline::GenericSpline() :
     Coeffs_Computed(false),
     Terms(2),
-    ref_count(1)
+    ref_count(1),
+    SegmentLookupScale(0.0),
+    LastSegment(0)
 {}
 
 LinearSpline::LinearSpline() : GenericSpline()
@@ -962,7 +1111,10 @@ GenericSpline::GenericSpline(const GenericSpline& o) :
     SplineEntries(o.SplineEntries),
     Coeffs_Computed(false),
     Terms(o.Terms),
-    ref_count(1)
+    ref_count(1),
+    SegmentLookup(o.SegmentLookup),
+    SegmentLookupScale(o.SegmentLookupScale),
+    LastSegment(0)
 {}
 
 LinearSpline::LinearSpline(const GenericSpline& o) : GenericSpline(o)
@@ -1117,6 +1269,7 @@ void Insert_Spline_Entry(GenericSpline * sp, DBL p, const EXPRESS& v)
     /* Reset the Coeffs_Computed flag.  Inserting a new point invalidates
      *  pre-computed coefficients */
     sp->Coeffs_Computed = false;
+    sp->SegmentLookup.clear();
     i = findt(sp, p);
     // If p is already in the spline, replace it.
     bool replace = false;
@@ -1167,6 +1320,7 @@ void Insert_Spline_Entry(GenericSpline * sp, DBL p, const EXPRESS& v, const Spli
     /* Reset the Coeffs_Computed flag.  Inserting a new point invalidates
      *  pre-computed coefficients */
     sp->Coeffs_Computed = false;
+    sp->SegmentLookup.clear();
     if (bsp)
     {
         bsp->freedom = f;
@@ -1223,6 +1377,7 @@ void Insert_Spline_Entry(GenericSpline * sp, DBL p, const EXPRESS& v, const Spli
     /* Reset the Coeffs_Computed flag.  Inserting a new point invalidates
      *  pre-computed coefficients */
     sp->Coeffs_Computed = false;
+    sp->SegmentLookup.clear();
     i = findt(sp, p);
     // If p is already in the spline, replace it.
     bool replace = false;
@@ -1321,7 +1476,7 @@ void LinearSpline::Get(DBL p, EXPRESS& v)
     else
     {
         /* Find which spline segment we're in.  i is the control point at the end of the segment */
-        SplineEntryList::size_type i = findt(this, p);
+        SplineEntryList::size_type i = FindSegment(p);
         for(int k=0; k<5; k++)
         {
             /* If outside spline range, return first or last point */
@@ -1343,7 +1498,7 @@ void QuadraticSpline::Get(DBL p, EXPRESS& v)
     else
     {
         /* Find which spline segment we're in.  i is the control point at the end of the segment */
-        SplineEntryList::size_type i = findt(this, p);
+        SplineEntryList::size_type i = FindSegment(p);
         for(int k=0; k<5; k++)
         {
             /* If outside the spline range, return the first or last point */
@@ -1375,7 +1530,7 @@ void NaturalSpline::Get(DBL p, EXPRESS& v)
         if (!Coeffs_Computed)
             Precompute();
         /* Find which spline segment we're in.  i is the control point at the end of the segment */
-        SplineEntryList::size_type i = findt(this, p);
+        SplineEntryList::size_type i = FindSegment(p);
         for(int k=0; k<5; k++)
         {
             /* If outside the spline range, return the first or last point */
@@ -1399,7 +1554,7 @@ void SorSpline::Get(DBL p, EXPRESS& v)
         if (!Coeffs_Computed)
             Precompute();
         SplineEntryList::size_type last = SplineEntries.size()-1;
-        SplineEntryList::size_type i = findt(this, p);
+        SplineEntryList::size_type i = FindSegment(p);
         for(int k=0; k<5; k++)
         {
             if(i <= 1)
@@ -1421,7 +1576,7 @@ void AkimaSpline::Get(DBL p, EXPRESS& v)
         if (!Coeffs_Computed)
             Precompute();
         SplineEntryList::size_type last = SplineEntries.size()-1;
-        SplineEntryList::size_type i = findt(this, p);
+        SplineEntryList::size_type i = FindSegment(p);
         for(int k=0; k<5; k++)
         {
             if(i == 0)
@@ -1443,7 +1598,7 @@ void TcbSpline::Get(DBL p, EXPRESS& v)
         if (!Coeffs_Computed)
             Precompute();
         SplineEntryList::size_type last = SplineEntries.size()-1;
-        SplineEntryList::size_type i = findt(this, p);
+        SplineEntryList::size_type i = FindSegment(p);
         for(int k=0; k<5; k++)
         {
             if(i <= 1)
@@ -1463,7 +1618,7 @@ void BasicXSpline::Get(DBL p, EXPRESS& v)
     else
     {
         SplineEntryList::size_type last = SplineEntries.size()-1;
-        SplineEntryList::size_type i = findt(this, p);
+        SplineEntryList::size_type i = FindSegment(p);
         for(int k=0; k<5; k++)
         {
             if(i <= 1)
@@ -1484,7 +1639,7 @@ void XSpline::Get(DBL p, EXPRESS& v)
     else
     {
         SplineEntryList::size_type last = SplineEntries.size()-1;
-        SplineEntryList::size_type i = findt(this, p);
+        SplineEntryList::size_type i = FindSegment(p);
         for(int k=0; k<5; k++)
         {
             if(i == 0)
@@ -1505,7 +1660,7 @@ void CatmullRomSpline::Get(DBL p, EXPRESS& v)
     else
     {
         /* Find which spline segment we're in.  i is the control point at the end of the segment */
-        SplineEntryList::size_type i = findt(this, p);
+        SplineEntryList::size_type i = FindSegment(p);
         for(int k=0; k<5; k++)
         {
             /* If only two points, return their average */
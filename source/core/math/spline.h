@@ -51,6 +51,7 @@
 //  (none at the moment)
 
 // C++ standard header files
+#include <atomic>
 #include <vector>
 
 // POV-Ray header files (base module)
@@ -118,8 +119,36 @@ struct GenericSpline
     int Terms;
     SplineRefCount ref_count;
 
+    /// Uniform segment lookup table for @ref FindSegment(), or empty if not built.
+    ///
+    /// The parameter range is divided into `SegmentLookup.size()-1` equally sized intervals;
+    /// entry `i` holds the segment of the parameter at the start of the `i`-th interval.
+    ///
+    std::vector<unsigned int> SegmentLookup;
+    DBL SegmentLookupScale; ///< Number of lookup table intervals per unit of the parameter.
+    /// Segment found by the most recent call to @ref FindSegment(), tried first by the next one.
+    mutable std::atomic<SplineEntryList::size_type> LastSegment;
+
     virtual void Get(DBL p, EXPRESS& v) = 0;
     virtual GenericSpline* Clone() const = 0;
+
+    /// Find the segment a parameter falls into.
+    ///
+    /// This gives the same result as a binary search of the entries, but first tries the segment
+    /// found by the previous call and its successor, then the segment lookup table if built.
+    ///
+    /// @return     The index of the first entry with a parameter no smaller than @p p,
+    ///             0 if @p p is at or before the first entry, or the number of entries if
+    ///             @p p is at or beyond the last one.
+    ///
+    SplineEntryList::size_type FindSegment(DBL p) const;
+
+    /// Build the segment lookup table, once all entries have been inserted.
+    ///
+    /// Splines with only a few entries get no table, as the binary search is just as fast.
+    ///
+    void PrepareLookup();
+
     void AcquireReference();
     void ReleaseReference();
     // indicate to the parser which additional parameters to collect
@@ -53,6 +53,7 @@ namespace pov
 {
 
 Ray::Ray(TraceTicket& ticket, RayType rt, bool shadowTest, bool photon, bool radiosity, bool monochromatic, bool pretrace) :
+    spectralElements(1),
     ticket(ticket)
 {
     SetFlags(rt, shadowTest, photon, radiosity, monochromatic, pretrace);
@@ -62,6 +63,7 @@ Ray::Ray(TraceTicket& ticket, RayType rt, bool shadowTest, bool photon, bool rad
 
 Ray::Ray(TraceTicket& ticket, const Vector3d& ov, const Vector3d& dv, RayType rt, bool shadowTest, bool photon, bool radiosity, bool monochromatic, bool pretrace) :
     BasicRay(ov, dv),
+    spectralElements(1),
     ticket(ticket)
 {
     SetFlags(rt, shadowTest, photon, radiosity, monochromatic, pretrace);
@@ -90,6 +92,12 @@ void Ray::AppendInteriors(RayInteriorVector& ii)
     }
 }
 
+void Ray::CopyInteriors(const Ray& other)
+{
+    interiors = other.interiors;
+    hollowRay = other.hollowRay;
+}
+
 bool Ray::RemoveInterior(const Interior *i)
 {
     bool checkhollow = false;
@@ -128,9 +136,10 @@ bool Ray::IsInterior(const Interior *i) const
     return false;
 }
 
-void Ray::SetSpectralBand(const SpectralBand& sb)
+void Ray::SetSpectralBand(const SpectralBand& sb, unsigned int elements)
 {
     spectralBand = sb;
+    spectralElements = elements;
     monochromaticRay = true;
 }
 
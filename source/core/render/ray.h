@@ -86,12 +86,22 @@ class Ray final : public BasicRay
         bool RemoveInterior(const Interior *i);
         void ClearInteriors() { interiors.clear(); }
 
+        /// Replace the interiors by those of another ray, including whether they are all hollow.
+        void CopyInteriors(const Ray& other);
+
         bool IsInterior(const Interior *i) const;
         const RayInteriorVector& GetInteriors() const { return interiors; }
         RayInteriorVector& GetInteriors() { return interiors; }
 
-        void SetSpectralBand(const SpectralBand&);
+        /// Make the ray monochromatic.
+        ///
+        /// @param[in]  sb          Spectral band carried by the ray.
+        /// @param[in]  elements    Number of dispersion elements the band stands for; the ray is
+        ///                         split into that many sub-bands at the next dispersive interface.
+        ///
+        void SetSpectralBand(const SpectralBand& sb, unsigned int elements = 1);
         const SpectralBand& GetSpectralBand() const;
+        unsigned int GetSpectralElements() const { return spectralElements; }
 
         void SetFlags(RayType rt, bool shadowTest = false, bool photon = false, bool radiosity = false, bool monochromatic = false, bool pretrace = false);
         void SetFlags(RayType rt, const Ray& other);
@@ -117,6 +127,7 @@ class Ray final : public BasicRay
 
         RayInteriorVector interiors;
         SpectralBand spectralBand;
+        unsigned int spectralElements;
         TraceTicket& ticket;
 
         bool primaryRay : 1;
@@ -47,10 +47,14 @@
 
 // POV-Ray header files (core module)
 #include "core/bounding/bsptree.h"
+#include "core/bounding/bvhtree.h"
+#include "core/bounding/compactbboxtree.h"
 #include "core/lighting/lightsource.h"
+#include "core/lighting/lighttree.h"
 #include "core/lighting/radiosity.h"
 #include "core/lighting/subsurface.h"
 #include "core/material/interior.h"
+#include "core/material/media.h"
 #include "core/material/noise.h"
 #include "core/material/normal.h"
 #include "core/material/pattern.h"
@@ -65,6 +69,7 @@
 #include "core/scene/tracethreaddata.h"
 #include "core/shape/box.h"
 #include "core/shape/csg.h"
+#include "core/shape/plane.h"
 #include "core/support/imageutil.h"
 #include "core/support/statistics.h"
 
@@ -80,6 +85,36 @@ using std::vector;
 
 #define SHADOW_TOLERANCE 1.0e-3
 
+/// Fraction of the pixel footprint by which the refracted directions of adjacent dispersion bands
+/// may differ before the bands are traced as separate rays.
+#define DISPERSION_GROUP_TOLERANCE 0.5
+
+/// Number of leading texture layers whose pigment-independent classic lighting is kept around
+/// for reuse by later layers with the same finish.
+#define MAX_SHARED_LIGHTING_LAYERS 8
+
+/// Classic lighting of a texture layer, computed without the layer's pigment.
+struct SharedLighting final
+{
+    Vector3d normal;        ///< Perturbed normal the lighting was computed for.
+    MathColour diffuse;     ///< Diffuse contribution, to be scaled by pigment and opacity.
+    MathColour highlights;  ///< Phong, specular and iridescence contribution.
+    bool valid = false;
+};
+
+/// Compute a refracted ray direction using Heckbert's method.
+///
+/// @return     `false` if total internal reflection occurs instead.
+///
+static bool RefractedDirection(const Vector3d& incident, const Vector3d& localnormal, double n, double ior, Vector3d& direction)
+{
+    double t = 1.0 + Sqr(ior) * (Sqr(n) - 1.0);
+    if(t < 0.0)
+        return false;
+    direction = ior * incident + (ior * n - sqrt(t)) * localnormal;
+    return true;
+}
+
 
 bool NoSomethingFlagRayObjectCondition::operator()(const Ray& ray, ConstObjectPtr object, double) const
 {
@@ -100,7 +135,6 @@ Trace::Trace(std::shared_ptr<SceneData> sd, TraceThreadData *td, const QualityFl
     sceneData(sd),
     maxFoundTraceLevel(0),
     qualityFlags(qf),
-    mailbox(0),
     crandRandomNumberGenerator(0),
     randomNumbers(0.0, 1.0, 32768),
     randomNumberGenerator(&randomNumbers),
@@ -110,22 +144,19 @@ Trace::Trace(std::shared_ptr<SceneData> sd, TraceThreadData *td, const QualityFl
     cooperate(cf),
     media(mf),
     radiosity(rf),
-    lightColorCacheIndex(-1)
+    lightColorCacheIndex(-1),
+    rouletteThreshold(0.0),
+    secondaryRayBudget(0),
+    secondaryRaysTraced(0)
 {
-    lightSourceLevel1ShadowCache.resize(max(1, (int) threadData->lightSources.size()));
-    for(vector<ObjectPtr>::iterator i(lightSourceLevel1ShadowCache.begin()); i != lightSourceLevel1ShadowCache.end(); i++)
-        *i = nullptr;
-
-    lightSourceOtherShadowCache.resize(max(1, (int) threadData->lightSources.size()));
-    for(vector<ObjectPtr>::iterator i(lightSourceOtherShadowCache.begin()); i != lightSourceOtherShadowCache.end(); i++)
-        *i = nullptr;
+    areaLightSamplesSource = nullptr;
 
     lightColorCache.resize(max(20U, sd->parsedMaxTraceLevel + 1));
     for(LightColorCacheListList::iterator it = lightColorCache.begin(); it != lightColorCache.end(); it++)
         it->resize(max(1, (int) threadData->lightSources.size()));
 
     if(sceneData->boundingMethod == 2)
-        mailbox = BSPTree::Mailbox(sceneData->numberOfFiniteObjects);
+        threadData->GetMailbox().resize(sceneData->numberOfFiniteObjects);
 }
 
 Trace::~Trace()
@@ -133,6 +164,12 @@ Trace::~Trace()
 }
 
 double Trace::TraceRay(Ray& ray, MathColour& colour, ColourChannel& transm, COLC weight, bool continuedRay, DBL maxDepth)
+{
+    return TraceRayWithIntersection(ray, colour, transm, weight, continuedRay, maxDepth, nullptr);
+}
+
+double Trace::TraceRayWithIntersection(Ray& ray, MathColour& colour, ColourChannel& transm, COLC weight, bool continuedRay, DBL maxDepth,
+                                       const Intersection *isect)
 {
     Intersection bestisect;
     bool found;
@@ -154,10 +191,57 @@ double Trace::TraceRay(Ray& ray, MathColour& colour, ColourChannel& transm, COLC
         return HUGE_VAL;
     }
 
-    if (maxDepth >= EPSILON)
-        bestisect.Depth = maxDepth;
+    // Russian roulette and secondary ray budget; primary rays are always traced.
+    COLC rouletteScale = 1.0;
+    if (ray.GetTicket().traceLevel == 0)
+        secondaryRaysTraced = 0;
+    else
+    {
+        unsigned int generation = min(ray.GetTicket().traceLevel, 5u);
+
+        if ((secondaryRayBudget > 0) && (secondaryRaysTraced >= secondaryRayBudget))
+        {
+            threadData->Stats()[Ray_Budget_Exhausted]++;
+            colour.Clear();
+            transm = 0.0;
+            return HUGE_VAL;
+        }
+
+        if (weight < rouletteThreshold)
+        {
+            COLC survival = weight / rouletteThreshold;
+            if (randomNumberGenerator() >= survival)
+            {
+                threadData->Stats()[(IntStatsIndex)(Roulette_Terminated_L1 + generation - 1)]++;
+                colour.Clear();
+                transm = 0.0;
+                return HUGE_VAL;
+            }
+            rouletteScale = 1.0 / survival;
+        }
+
+        secondaryRaysTraced++;
+    }
+
+    if (isect != nullptr)
+    {
+        bestisect = *isect;
+        found = (bestisect.Object != nullptr);
+    }
+    else
+    {
+        if (maxDepth >= EPSILON)
+            bestisect.Depth = maxDepth;
 
-    found = FindIntersection(bestisect, ray, precond, postcond);
+        found = FindIntersection(bestisect, ray, precond, postcond);
+    }
+
+    if (threadData->footprint != nullptr)
+    {
+        if (found)
+            threadData->footprint->AddObject(bestisect.Csg != nullptr ? bestisect.Csg : bestisect.Object);
+        threadData->footprint->AddSegment(ray.Origin, ray.Direction, found ? bestisect.Depth : (maxDepth >= EPSILON) ? maxDepth : HUGE_VAL);
+    }
 
     // Check if we're busy shooting too many radiosity sample rays at an unimportant object
     if (ray.GetTicket().radiosityImportanceQueried >= 0.0)
@@ -221,6 +305,12 @@ double Trace::TraceRay(Ray& ray, MathColour& colour, ColourChannel& transm, COLC
 
     ray.GetTicket().radiosityImportanceQueried = oldRadiosityImportanceQueried;
 
+    if (rouletteScale != 1.0)
+    {
+        colour *= rouletteScale;
+        transm *= rouletteScale;
+    }
+
     if(found == false)
         return HUGE_VAL;
     else
@@ -232,30 +322,37 @@ bool Trace::FindIntersection(Intersection& bestisect, const Ray& ray)
     switch(sceneData->boundingMethod)
     {
         case 2:
+        case 3:
         {
             BSPIntersectFunctor ifn(bestisect, ray, sceneData->objects, threadData);
-            bool found = false;
+            bool found = FindPlaneIntersection(bestisect, ray);
 
-            mailbox.clear();
+            if(sceneData->boundingMethod == 3)
+            {
+                if((*(sceneData->bvhTree))(ray, ifn, bestisect.Depth))
+                    found = true;
+            }
+            else
+            {
+                threadData->GetMailbox().clear();
 
-            found = (*(sceneData->tree))(ray, ifn, mailbox, bestisect.Depth);
+                if((*(sceneData->tree))(ray, ifn, threadData->GetMailbox(), bestisect.Depth))
+                    found = true;
+            }
 
-            // test infinite objects
-            for(vector<ObjectPtr>::iterator it = sceneData->objects.begin() + sceneData->numberOfFiniteObjects; it != sceneData->objects.end(); it++)
+            // test remaining infinite objects
+            for(vector<ObjectPtr>::iterator it = FirstOtherInfiniteObject(); it != sceneData->objects.end(); it++)
             {
-                Intersection isect;
-
-                if(FindIntersection(*it, isect, ray) && (isect.Depth < bestisect.Depth))
-                {
-                    bestisect = isect;
+                if(FindIntersection(*it, bestisect, ray, bestisect.Depth))
                     found = true;
-                }
             }
 
             return found;
         }
         case 1:
         {
+            if (sceneData->compactSlabs != nullptr)
+                return (sceneData->compactSlabs->Intersect(compactQueue, ray, &bestisect, threadData));
             if (sceneData->boundingSlabs != nullptr)
                 return (Intersect_BBox_Tree(priorityQueue, sceneData->boundingSlabs, ray, &bestisect, threadData));
         }
@@ -266,13 +363,8 @@ bool Trace::FindIntersection(Intersection& bestisect, const Ray& ray)
 
             for(vector<ObjectPtr>::iterator it = sceneData->objects.begin(); it != sceneData->objects.end(); it++)
             {
-                Intersection isect;
-
-                if(FindIntersection(*it, isect, ray) && (isect.Depth < bestisect.Depth))
-                {
-                    bestisect = isect;
+                if(FindIntersection(*it, bestisect, ray, bestisect.Depth))
                     found = true;
-                }
             }
 
             return found;
@@ -287,26 +379,31 @@ bool Trace::FindIntersection(Intersection& bestisect, const Ray& ray, const RayO
     switch(sceneData->boundingMethod)
     {
         case 2:
+        case 3:
         {
             BSPIntersectCondFunctor ifn(bestisect, ray, sceneData->objects, threadData, precondition, postcondition);
-            bool found = false;
+            bool found = FindPlaneIntersection(bestisect, ray, precondition, postcondition);
 
-            mailbox.clear();
+            if(sceneData->boundingMethod == 3)
+            {
+                if((*(sceneData->bvhTree))(ray, ifn, bestisect.Depth))
+                    found = true;
+            }
+            else
+            {
+                threadData->GetMailbox().clear();
 
-            found = (*(sceneData->tree))(ray, ifn, mailbox, bestisect.Depth);
+                if((*(sceneData->tree))(ray, ifn, threadData->GetMailbox(), bestisect.Depth))
+                    found = true;
+            }
 
-            // test infinite objects
-            for(vector<ObjectPtr>::iterator it = sceneData->objects.begin() + sceneData->numberOfFiniteObjects; it != sceneData->objects.end(); it++)
+            // test remaining infinite objects
+            for(vector<ObjectPtr>::iterator it = FirstOtherInfiniteObject(); it != sceneData->objects.end(); it++)
             {
                 if(precondition(ray, *it, 0.0) == true)
                 {
-                    Intersection isect;
-
-                    if(FindIntersection(*it, isect, ray, postcondition) && (isect.Depth < bestisect.Depth))
-                    {
-                        bestisect = isect;
+                    if(FindIntersection(*it, bestisect, ray, postcondition, bestisect.Depth))
                         found = true;
-                    }
                 }
             }
 
@@ -314,6 +411,8 @@ bool Trace::FindIntersection(Intersection& bestisect, const Ray& ray, const RayO
         }
         case 1:
         {
+            if (sceneData->compactSlabs != nullptr)
+                return (sceneData->compactSlabs->Intersect(compactQueue, ray, &bestisect, precondition, postcondition, threadData));
             if (sceneData->boundingSlabs != nullptr)
                 return (Intersect_BBox_Tree(priorityQueue, sceneData->boundingSlabs, ray, &bestisect, precondition, postcondition, threadData));
         }
@@ -323,26 +422,167 @@ bool Trace::FindIntersection(Intersection& bestisect, const Ray& ray, const RayO
             bool found = false;
 
             for(vector<ObjectPtr>::iterator it = sceneData->objects.begin(); it != sceneData->objects.end(); it++)
+            {
+                if(precondition(ray, *it, 0.0) == true)
+                {
+                    if(FindIntersection(*it, bestisect, ray, postcondition, bestisect.Depth))
+                        found = true;
+                }
+            }
+
+            return found;
+        }
+    }
+
+    return false;
+}
+
+bool Trace::FindOccluder(Intersection& occluder, bool& otherHits, const Ray& ray, double maxDepth,
+                         const RayObjectCondition& precondition, const RayObjectCondition& postcondition, const IntersectionCondition& occlusion)
+{
+    otherHits = false;
+
+    switch(sceneData->boundingMethod)
+    {
+        case 2:
+        case 3:
+        {
+            BSPOcclusionCondFunctor ifn(occluder, ray, sceneData->objects, threadData, precondition, postcondition, occlusion);
+
+            if(sceneData->boundingMethod == 3)
+            {
+                if((*(sceneData->bvhTree))(ray, ifn, maxDepth, true))
+                    return true;
+            }
+            else
+            {
+                threadData->GetMailbox().clear();
+
+                if((*(sceneData->tree))(ray, ifn, threadData->GetMailbox(), maxDepth, true))
+                    return true;
+            }
+
+            otherHits = ifn.OtherHits();
+
+            // test infinite planes
+            if(sceneData->planeSet != nullptr)
+            {
+                const PlaneSet& planes = *sceneData->planeSet;
+                DBL depths[PlaneSet::kBlockSize];
+
+                for(size_t first = 0; first < planes.size(); first += PlaneSet::kBlockSize)
+                {
+                    size_t count = min(PlaneSet::kBlockSize, planes.size() - first);
+                    planes.ComputeDepths(ray, ray.IsSubsurfaceRay() ? -HUGE_VAL : MIN_ISECT_DEPTH, first, count, depths, threadData->Stats());
+                    for(size_t i = 0; i < count; i++)
+                    {
+                        ObjectPtr plane = planes.GetObject(first + i);
+                        if((depths[i] < maxDepth) && precondition(ray, plane, 0.0) && postcondition(ray, plane, depths[i]))
+                        {
+                            Intersection isect(depths[i], ray.Evaluate(depths[i]), plane);
+                            if(occlusion(isect))
+                            {
+                                occluder = isect;
+                                return true;
+                            }
+                            otherHits = true;
+                        }
+                    }
+                }
+            }
+
+            // test remaining infinite objects
+            for(vector<ObjectPtr>::iterator it = FirstOtherInfiniteObject(); it != sceneData->objects.end(); it++)
             {
                 if(precondition(ray, *it, 0.0) == true)
                 {
                     Intersection isect;
 
-                    if(FindIntersection(*it, isect, ray, postcondition) && (isect.Depth < bestisect.Depth))
+                    if(FindIntersection(*it, isect, ray, postcondition, maxDepth))
                     {
-                        bestisect = isect;
-                        found = true;
+                        if(occlusion(isect))
+                        {
+                            occluder = isect;
+                            return true;
+                        }
+                        otherHits = true;
                     }
                 }
             }
 
-            return found;
+            return false;
+        }
+        case 1:
+        {
+            if (sceneData->compactSlabs != nullptr)
+                return (sceneData->compactSlabs->Occlude(compactQueue, ray, maxDepth, &occluder, otherHits, precondition, postcondition, occlusion, threadData));
+            if (sceneData->boundingSlabs != nullptr)
+                return (Occlude_BBox_Tree(bboxStack, sceneData->boundingSlabs, ray, maxDepth, &occluder, otherHits, precondition, postcondition, occlusion, threadData));
+        }
+        // FALLTHROUGH
+        case 0:
+        {
+            for(vector<ObjectPtr>::iterator it = sceneData->objects.begin(); it != sceneData->objects.end(); it++)
+            {
+                if(precondition(ray, *it, 0.0) == true)
+                {
+                    Intersection isect;
+
+                    if(FindIntersection(*it, isect, ray, postcondition, maxDepth))
+                    {
+                        if(occlusion(isect))
+                        {
+                            occluder = isect;
+                            return true;
+                        }
+                        otherHits = true;
+                    }
+                }
+            }
+
+            return false;
         }
     }
 
     return false;
 }
 
+bool Trace::FindPlaneIntersection(Intersection& bestisect, const Ray& ray)
+{
+    if(sceneData->planeSet == nullptr)
+        return false;
+
+    DBL depth = bestisect.Depth;
+    int i = sceneData->planeSet->FindClosest(ray, ray.IsSubsurfaceRay() ? -HUGE_VAL : MIN_ISECT_DEPTH, depth, threadData->Stats());
+    if(i < 0)
+        return false;
+
+    bestisect = Intersection(depth, ray.Evaluate(depth), sceneData->planeSet->GetObject(i));
+    return true;
+}
+
+bool Trace::FindPlaneIntersection(Intersection& bestisect, const Ray& ray, const RayObjectCondition& precondition, const RayObjectCondition& postcondition)
+{
+    if(sceneData->planeSet == nullptr)
+        return false;
+
+    DBL depth = bestisect.Depth;
+    int i = sceneData->planeSet->FindClosest(ray, ray.IsSubsurfaceRay() ? -HUGE_VAL : MIN_ISECT_DEPTH, depth, precondition, postcondition, threadData->Stats());
+    if(i < 0)
+        return false;
+
+    bestisect = Intersection(depth, ray.Evaluate(depth), sceneData->planeSet->GetObject(i));
+    return true;
+}
+
+vector<ObjectPtr>::iterator Trace::FirstOtherInfiniteObject() const
+{
+    size_t first = sceneData->numberOfFiniteObjects;
+    if(sceneData->planeSet != nullptr)
+        first += sceneData->planeSet->size();
+    return sceneData->objects.begin() + first;
+}
+
 bool Trace::FindIntersection(ObjectPtr object, Intersection& isect, const Ray& ray, double closest)
 {
     if (object != nullptr)
@@ -370,24 +610,13 @@ bool Trace::FindIntersection(ObjectPtr object, Intersection& isect, const Ray& r
 
         if(object->All_Intersections(ray, depthstack, threadData))
         {
-            bool found = false;
-            double tmpDepth = 0;
-
-            while(depthstack->size() > 0)
-            {
-                tmpDepth = depthstack->top().Depth;
-                // TODO FIXME - This was SMALL_TOLERANCE, but that's too rough for some scenes [cjc] need to check what it was in the old code [trf]
-                if(tmpDepth < closest && (ray.IsSubsurfaceRay() || tmpDepth > MIN_ISECT_DEPTH))
-                {
-                    isect = depthstack->top();
-                    closest = tmpDepth;
-                    found = true;
-                }
-
-                depthstack->pop();
-            }
+            // TODO FIXME - This was SMALL_TOLERANCE, but that's too rough for some scenes [cjc] need to check what it was in the old code [trf]
+            const Intersection *hit = depthstack->closest(closest, [&ray](const Intersection& i) { return ray.IsSubsurfaceRay() || i.Depth > MIN_ISECT_DEPTH; });
+            if(hit == nullptr)
+                return false;
 
-            return (found == true);
+            isect = *hit;
+            return true;
         }
 
         POV_REFPOOL_ASSERT(depthstack->empty()); // verify that the IStack is in a cleaned-up condition (again)
@@ -423,24 +652,13 @@ bool Trace::FindIntersection(ObjectPtr object, Intersection& isect, const Ray& r
 
         if(object->All_Intersections(ray, depthstack, threadData))
         {
-            bool found = false;
-            double tmpDepth = 0;
-
-            while(depthstack->size() > 0)
-            {
-                tmpDepth = depthstack->top().Depth;
-                // TODO FIXME - This was SMALL_TOLERANCE, but that's too rough for some scenes [cjc] need to check what it was in the old code [trf]
-                if(tmpDepth < closest && (ray.IsSubsurfaceRay() || tmpDepth > MIN_ISECT_DEPTH) && postcondition(ray, object, tmpDepth))
-                {
-                    isect = depthstack->top();
-                    closest = tmpDepth;
-                    found = true;
-                }
-
-                depthstack->pop();
-            }
+            // TODO FIXME - This was SMALL_TOLERANCE, but that's too rough for some scenes [cjc] need to check what it was in the old code [trf]
+            const Intersection *hit = depthstack->closest(closest, [&ray, object, &postcondition](const Intersection& i) { return (ray.IsSubsurfaceRay() || i.Depth > MIN_ISECT_DEPTH) && postcondition(ray, object, i.Depth); });
+            if(hit == nullptr)
+                return false;
 
-            return (found == true);
+            isect = *hit;
+            return true;
         }
 
         POV_REFPOOL_ASSERT(depthstack->empty()); // verify that the IStack is in a cleaned-up condition (again)
@@ -449,11 +667,93 @@ bool Trace::FindIntersection(ObjectPtr object, Intersection& isect, const Ray& r
     return false;
 }
 
+void Trace::FindIntersections(Intersection isect[], bool found[], const Ray* const rays[], unsigned int count,
+                              const RayObjectCondition& precondition, const RayObjectCondition& postcondition)
+{
+    if ((sceneData->boundingMethod != 3) || (count < 2))
+    {
+        for (unsigned int i = 0; i < count; i++)
+            found[i] = FindIntersection(isect[i], *rays[i], precondition, postcondition);
+        return;
+    }
+
+    for (unsigned int base = 0; base < count; base += BVHTree::kMaxPacketSize)
+    {
+        unsigned int n = count - base;
+        vector<BSPIntersectCondFunctor>& functors = packetFunctors;
+        const BasicRay *packet[BVHTree::kMaxPacketSize];
+        BSPTree::Intersect *ifn[BVHTree::kMaxPacketSize];
+        double maxdist[BVHTree::kMaxPacketSize];
+
+        if (n > BVHTree::kMaxPacketSize)
+            n = BVHTree::kMaxPacketSize;
+
+        functors.clear();
+        functors.reserve(BVHTree::kMaxPacketSize);
+        for (unsigned int i = 0; i < n; i++)
+        {
+            found[base + i] = FindPlaneIntersection(isect[base + i], *rays[base + i], precondition, postcondition);
+            functors.emplace_back(isect[base + i], *rays[base + i], sceneData->objects, threadData, precondition, postcondition);
+            packet[i] = rays[base + i];
+            ifn[i] = &functors[i];
+            maxdist[i] = isect[base + i].Depth;
+        }
+
+        (*(sceneData->bvhTree))(packet, ifn, maxdist, n);
+
+        for (unsigned int i = 0; i < n; i++)
+        {
+            const Ray& ray = *rays[base + i];
+
+            if (functors[i]())
+                found[base + i] = true;
+
+            // test remaining infinite objects
+            for(vector<ObjectPtr>::iterator it = FirstOtherInfiniteObject(); it != sceneData->objects.end(); it++)
+            {
+                if(precondition(ray, *it, 0.0) == true)
+                {
+                    Intersection tmpisect;
+
+                    if(FindIntersection(*it, tmpisect, ray, postcondition) && (tmpisect.Depth < isect[base + i].Depth))
+                    {
+                        isect[base + i] = tmpisect;
+                        found[base + i] = true;
+                    }
+                }
+            }
+        }
+    }
+}
+
 unsigned int Trace::GetHighestTraceLevel()
 {
     return maxFoundTraceLevel;
 }
 
+size_t Trace::GetScratchAllocationCount() const
+{
+    // the pooled simple vectors are shared by all instances running in the calling thread
+    return texturePool.GetAllocationCount() + wnrxPool.GetAllocationCount() + lightIndexPool.GetAllocationCount() +
+           photonGathererPool.GetAllocationCount() +
+           MediaVector::GetPoolAllocationCount() + MediaIntervalVector::GetPoolAllocationCount() +
+           LitIntervalVector::GetPoolAllocationCount() + LightSourceIntersectionVector::GetPoolAllocationCount() +
+           LightSourceEntryVector::GetPoolAllocationCount() + WeightedTextureVector::GetPoolAllocationCount() +
+           RayInteriorVector::GetPoolAllocationCount();
+}
+
+void Trace::SeedStreams(unsigned int key)
+{
+    // scramble the key, so that neighbouring tiles don't get overlapping streams
+    unsigned int hash = key * 2654435761u;
+    randomNumberGenerator.SetSeed(hash);
+    crandRandomNumberGenerator = hash;
+    // the sub-random sequences are created on demand with fixed seeds, so just start them over
+    ssltUniformDirectionGenerator.clear();
+    ssltUniformNumberGenerator.clear();
+    ssltCosWeightedDirectionGenerator.clear();
+}
+
 void Trace::ComputeTextureColour(Intersection& isect, MathColour& colour, ColourChannel& transm, Ray& ray, COLC weight, bool photonPass)
 {
     // NOTE: when called during the photon pass this method is used to deposit photons
@@ -477,6 +777,9 @@ void Trace::ComputeTextureColour(Intersection& isect, MathColour& colour, Colour
     for (LightColorCacheList::iterator it = lightColorCache[lightColorCacheIndex].begin(); it != lightColorCache[lightColorCacheIndex].end(); it++)
         it->tested = false;
 
+    // pattern values cached for a previous intersection are unlikely to be of any use here
+    threadData->GetPatternCache().NextIntersection();
+
     // compute the surface normal
     isect.Object->Normal(rawnormal, &isect, threadData);
 
@@ -629,7 +932,7 @@ void Trace::ComputeOneTextureColour(MathColour& resultColour, ColourChannel& res
                 resultTransm = 1.0;
                 break;
             case AVERAGE_PATTERN:
-                Warp_EPoint(tpoint, ipoint, warps.back());
+                Warp_EPoint(tpoint, ipoint, warps.back(), threadData);
                 ComputeAverageTextureColours(resultColour, resultTransm, texture, warps, tpoint, rawnormal, ray, weight, isect, shadowflag, photonPass);
                 break;
             case UV_MAP_PATTERN:
@@ -645,7 +948,7 @@ void Trace::ComputeOneTextureColour(MathColour& resultColour, ColourChannel& res
                 ComputeOneTextureColour(resultColour, resultTransm, cur->Vals, warps, tpoint, rawnormal, ray, weight, isect, shadowflag, photonPass);
                 break;
             case BITMAP_PATTERN:
-                Warp_EPoint(tpoint, ipoint, texture);
+                Warp_EPoint(tpoint, ipoint, texture, threadData);
                 ComputeOneTextureColour(resultColour, resultTransm, material_map(tpoint, texture), warps, tpoint, rawnormal, ray, weight, isect, shadowflag, photonPass);
                 break;
             case PLAIN_PATTERN:
@@ -662,7 +965,7 @@ void Trace::ComputeOneTextureColour(MathColour& resultColour, ColourChannel& res
     else
     {
         // NK 19 Nov 1999 added Warp_EPoint
-        Warp_EPoint(tpoint, ipoint, texture);
+        Warp_EPoint(tpoint, ipoint, texture, threadData);
         value1 = Evaluate_TPat(texture, tpoint, &isect, &ray, threadData);
 
         blendmap->Search(value1, prev, cur, prevWeight, curWeight);
@@ -760,7 +1063,8 @@ void Trace::ComputeLightedTexture(MathColour& resultColour, ColourChannel& resul
     MathColour ambBackCol;
     bool one_colour_found, colour_found;
     bool tir_occured;
-    std::unique_ptr<PhotonGatherer> surfacePhotonGatherer(nullptr);
+    PhotonGathererPtr surfacePhotonGatherer(nullptr, PhotonGathererRelease{ &photonGathererPool });
+    SharedLighting sharedLighting[MAX_SHARED_LIGHTING_LAYERS];
 
     double relativeIor;
     ComputeRelativeIOR(ray, isect.Object->interior.get(), relativeIor);
@@ -804,7 +1108,10 @@ void Trace::ComputeLightedTexture(MathColour& resultColour, ColourChannel& resul
     one_colour_found = false;
 
     if(sceneData->photonSettings.photonsEnabled && sceneData->surfacePhotonMap.numPhotons > 0)
-        surfacePhotonGatherer.reset(new PhotonGatherer(&sceneData->surfacePhotonMap, sceneData->photonSettings));
+    {
+        surfacePhotonGatherer.reset(photonGathererPool.alloc(&sceneData->surfacePhotonMap, sceneData->photonSettings));
+        surfacePhotonGatherer->gathered = false;
+    }
 
     for (layer_number = 0, layer = texture; (layer != nullptr) && (trans > ray.GetTicket().adcBailout); layer_number++, layer = layer->Next)
     {
@@ -1023,7 +1330,30 @@ void Trace::ComputeLightedTexture(MathColour& resultColour, ColourChannel& resul
                 {
                     MathColour classicContribution;
 
-                    ComputeDiffuseLight(layer->Finish, isect.IPoint, ray, layNormal, layCol.colour(), classicContribution, att, isect.Object, relativeIor);
+                    if (layer->Linear_Lighting && (layer_number < MAX_SHARED_LIGHTING_LAYERS))
+                    {
+                        // compute the lighting without the pigment (or reuse it from an earlier layer
+                        // with the same finish and normal), then apply this layer's pigment
+                        SharedLighting& shared = sharedLighting[layer_number];
+                        int source = layer->Lighting_Source;
+
+                        if ((source >= 0) && (source < layer_number) && sharedLighting[source].valid && (sharedLighting[source].normal - layNormal).IsNull())
+                        {
+                            shared = sharedLighting[source];
+                        }
+                        else
+                        {
+                            shared.diffuse.Clear();
+                            shared.highlights.Clear();
+                            ComputeDiffuseLight(layer->Finish, isect.IPoint, ray, layNormal, MathColour(1.0), shared.diffuse, 1.0, isect.Object, relativeIor, &shared.highlights);
+                            shared.normal = layNormal;
+                            shared.valid  = true;
+                        }
+
+                        classicContribution = shared.diffuse * layCol.colour() * att + shared.highlights;
+                    }
+                    else
+                        ComputeDiffuseLight(layer->Finish, isect.IPoint, ray, layNormal, layCol.colour(), classicContribution, att, isect.Object, relativeIor);
 
 #if POV_PARSER_EXPERIMENTAL_BRILLIANCE_OUT
                     if(layer->Finish->BrillianceOut != 1.0)
@@ -1204,6 +1534,10 @@ void Trace::ComputeShadowTexture(MathColour& filtercolour, const TEXTURE *textur
             tmpCol *= layer_Pigment_Colour.TransmittedColour();
         }
 
+        // Nothing gets past an opaque layer, so the layers below need not be evaluated.
+        if (tmpCol.IsZero())
+            break;
+
         // Get normal for faked caustics (will rewrite later to cache).
         if ((interior != nullptr) && ((caustics = interior->Caustics) != 0.0))
         {
@@ -1423,34 +1757,75 @@ bool Trace::ComputeRefraction(const FINISH* finish, Interior *interior, const Ve
         // TODO FIXME: also for first radiosity pass ? (see line 3272 of v3.6 lighting.cpp)
         if(!haveDispersion) // TODO FIXME - radiosity: || (!isFinalTrace)
             totalReflection = TraceRefractionRay(finish, ipoint, ray, nray, ior, n, normal, rawnormal, localnormal, colour, transm, weight);
-        else if(ray.IsMonochromaticRay())
+        else if(ray.IsMonochromaticRay() && (ray.GetSpectralElements() == 1))
             totalReflection = TraceRefractionRay(finish, ipoint, ray, nray, ray.GetSpectralBand().GetDispersionIOR(ior, dispersion), n, normal, rawnormal, localnormal, colour, transm, weight);
+        else if(ray.IsMonochromaticRay())
+            TraceDispersedRefractionRays(finish, ipoint, ray, nray, ior, dispersion, ray.GetSpectralElements(), n, normal, rawnormal, localnormal, colour, transm, weight);
         else
-        {
-            colour.Clear();
-            transm = 0.0;
+            TraceDispersedRefractionRays(finish, ipoint, ray, nray, ior, dispersion, dispersionelements, n, normal, rawnormal, localnormal, colour, transm, weight);
+    }
 
-            for(unsigned int i = 0; i < dispersionelements; i++)
-            {
-                MathColour tempColour;
-                ColourChannel tempTransm;
+    return totalReflection;
+}
 
-                // NB setting the dispersion factor also causes the MonochromaticRay flag to be set
-                SpectralBand spectralBand(i, dispersionelements);
-                nray.SetSpectralBand(spectralBand);
+void Trace::TraceDispersedRefractionRays(const FINISH* finish, const Vector3d& ipoint, Ray& ray, Ray& nray, double ior, double dispersion, unsigned int elements,
+                                         double n, const Vector3d& normal, const Vector3d& rawnormal, const Vector3d& localnormal,
+                                         MathColour& colour, ColourChannel& transm, COLC weight)
+{
+    // A monochromatic ray arriving here stands for a group of bands that parted ways only
+    // negligibly at an earlier interface; split it into its own sub-bands. Its hue has already
+    // been accounted for by whoever spawned it.
+    bool subBands = ray.IsMonochromaticRay();
+    const SpectralBand& superBand = ray.GetSpectralBand();
 
-                (void)TraceRefractionRay(finish, ipoint, ray, nray, spectralBand.GetDispersionIOR(ior, dispersion), n, normal, rawnormal, localnormal, tempColour, tempTransm, weight);
+    // Bands whose refracted directions stay this close together will hit the same surfaces anyway,
+    // so we trace them as a single ray.
+    double tolerance = DISPERSION_GROUP_TOLERANCE * threadData->pixelFootprintSlope;
 
-                colour += tempColour * spectralBand.GetHue();
-                transm += tempTransm;
-            }
+    colour.Clear();
+    transm = 0.0;
 
-            colour /= ColourChannel(dispersionelements);
-            transm /= ColourChannel(dispersionelements);
+    unsigned int first = 0;
+    while(first < elements)
+    {
+        Vector3d firstDirection, direction;
+        bool firstTotalReflection = !RefractedDirection(ray.Direction, localnormal, n,
+                                                        (subBands ? SpectralBand(superBand, first, elements) : SpectralBand(first, elements)).GetDispersionIOR(ior, dispersion),
+                                                        firstDirection);
+
+        unsigned int count = 1;
+        while(first + count < elements)
+        {
+            bool totalReflection = !RefractedDirection(ray.Direction, localnormal, n,
+                                                       (subBands ? SpectralBand(superBand, first + count, elements) : SpectralBand(first + count, elements)).GetDispersionIOR(ior, dispersion),
+                                                       direction);
+            if(totalReflection != firstTotalReflection)
+                break;
+            if(!totalReflection && ((direction - firstDirection).length() > tolerance))
+                break;
+            count++;
         }
+
+        MathColour tempColour;
+        ColourChannel tempTransm = 0.0;
+
+        // NB setting the dispersion factor also causes the MonochromaticRay flag to be set
+        SpectralBand spectralBand = (subBands ? SpectralBand(superBand, first, count, elements) : SpectralBand(first, count, elements));
+        nray.SetSpectralBand(spectralBand, count);
+
+        (void)TraceRefractionRay(finish, ipoint, ray, nray, spectralBand.GetDispersionIOR(ior, dispersion), n, normal, rawnormal, localnormal, tempColour, tempTransm, weight);
+
+        if(subBands)
+            colour += tempColour * ColourChannel(count);
+        else
+            colour += tempColour * spectralBand.GetHue() * ColourChannel(count);
+        transm += tempTransm * ColourChannel(count);
+
+        first += count;
     }
 
-    return totalReflection;
+    colour /= ColourChannel(elements);
+    transm /= ColourChannel(elements);
 }
 
 bool Trace::TraceRefractionRay(const FINISH* finish, const Vector3d& ipoint, Ray& ray, Ray& nray, double ior, double n, const Vector3d& normal, const Vector3d& rawnormal, const Vector3d& localnormal, MathColour& colour, ColourChannel& transm, COLC weight)
@@ -1486,7 +1861,7 @@ bool Trace::TraceRefractionRay(const FINISH* finish, const Vector3d& ipoint, Ray
 
 // see Diffuse in the v3.6 code (lighting.cpp)
 void Trace::ComputeDiffuseLight(const FINISH *finish, const Vector3d& ipoint, const Ray& eye, const Vector3d& layer_normal, const MathColour& layer_pigment_colour,
-                                MathColour& colour, double attenuation, ObjectPtr object, double relativeIor)
+                                MathColour& colour, double attenuation, ObjectPtr object, double relativeIor, MathColour *highlights)
 {
     Vector3d reye;
 
@@ -1497,15 +1872,54 @@ void Trace::ComputeDiffuseLight(const FINISH *finish, const Vector3d& ipoint, co
     // global light sources, if not turned off for this object
     if((object->Flags & NO_GLOBAL_LIGHTS_FLAG) != NO_GLOBAL_LIGHTS_FLAG)
     {
-        for(int i = 0; i < threadData->lightSources.size(); i++)
-            ComputeOneDiffuseLight(*threadData->lightSources[i], reye, finish, ipoint, eye, layer_normal, layer_pigment_colour, colour, attenuation, object, relativeIor, i);
+        // the light sources that may reach the object at all, if known
+        const std::vector<size_t> *reach = object->ReachingLights.get();
+
+        if(sceneData->lightTree != nullptr)
+        {
+            // only visit the light sources that can contribute more than the threshold
+            LightIndexVector lights(lightIndexPool);
+            sceneData->lightTree->Gather(ipoint, *lights);
+            std::vector<size_t>::const_iterator reachEntry;
+            if(reach != nullptr)
+                reachEntry = reach->begin();
+            for(size_t i : *lights)
+            {
+                if(reach != nullptr)
+                {
+                    // both lists are in ascending order of light source index
+                    while((reachEntry != reach->end()) && ((*reachEntry & ~LIGHT_REACH_PROJECTED_ONLY) < i))
+                        ++reachEntry;
+                    if((reachEntry == reach->end()) || ((*reachEntry & ~LIGHT_REACH_PROJECTED_ONLY) != i) ||
+                       ((*reachEntry & LIGHT_REACH_PROJECTED_ONLY) && qualityFlags.shadows))
+                        continue;
+                }
+                ComputeOneDiffuseLight(*threadData->lightSources[i], reye, finish, ipoint, eye, layer_normal, layer_pigment_colour, colour, attenuation, object, relativeIor, i, highlights);
+            }
+        }
+        else if(reach != nullptr)
+        {
+            for(size_t entry : *reach)
+            {
+                // light sources kept out only by `projected_through` still count when shadows are off
+                if((entry & LIGHT_REACH_PROJECTED_ONLY) && qualityFlags.shadows)
+                    continue;
+                size_t i = entry & ~LIGHT_REACH_PROJECTED_ONLY;
+                ComputeOneDiffuseLight(*threadData->lightSources[i], reye, finish, ipoint, eye, layer_normal, layer_pigment_colour, colour, attenuation, object, relativeIor, i, highlights);
+            }
+        }
+        else
+        {
+            for(int i = 0; i < threadData->lightSources.size(); i++)
+                ComputeOneDiffuseLight(*threadData->lightSources[i], reye, finish, ipoint, eye, layer_normal, layer_pigment_colour, colour, attenuation, object, relativeIor, i, highlights);
+        }
     }
 
     // local light sources from a light group, if any
     if(!object->LLights.empty())
     {
         for(int i = 0; i < object->LLights.size(); i++)
-            ComputeOneDiffuseLight(*object->LLights[i], reye, finish, ipoint, eye, layer_normal, layer_pigment_colour, colour, attenuation, object, relativeIor);
+            ComputeOneDiffuseLight(*object->LLights[i], reye, finish, ipoint, eye, layer_normal, layer_pigment_colour, colour, attenuation, object, relativeIor, -1, highlights);
     }
 }
 
@@ -1533,6 +1947,45 @@ void Trace::ComputePhotonDiffuseLight(const FINISH *Finish, const Vector3d& IPoi
     // statistics
     threadData->Stats()[Gather_Performed_Count]++;
 
+    // radiosity rays make do with the nearest precomputed irradiance estimate, if any; it stands for
+    // all the photons around it, already divided by the area they were gathered from
+    if(Eye.IsRadiosityRay() && (sceneData->surfaceIrradianceMap.numPhotons > 0))
+    {
+        const Photon* estimate = sceneData->surfaceIrradianceMap.findNearestPhoton(IPoint, sceneData->surfacePhotonMap.minGatherRad);
+        if(estimate != nullptr)
+        {
+            bool backside = false;
+
+            lightDirection = estimate->GetDirection();
+
+            att = dot(Raw_Normal, lightDirection);
+            if (att>1) att=1.0;
+            if (att<.1) att = 0.1; // limit to 10x - otherwise we get bright dots
+            Light_Colour = ToMathColour(RGBColour(estimate->colour)) / fabs(att);
+
+            if (!(Test_Flag(Object, DOUBLE_ILLUMINATE_FLAG)))
+            {
+                Cos_Shadow_Angle = dot(Layer_Normal, lightDirection);
+                if (Cos_Shadow_Angle < EPSILON)
+                {
+                    if (Finish->DiffuseBack != 0.0)
+                        backside = true;
+                    else
+                        return;
+                }
+            }
+
+            tmpCol.Clear();
+            if (!(sceneData->useSubsurface && Finish->UseSubsurface))
+                ComputeDiffuseColour(Finish, lightDirection, Eye.Direction, Layer_Normal, tmpCol, Light_Colour, Layer_Pigment_Colour, relativeIor, Attenuation, backside);
+            if (Finish->Irid > 0.0)
+                ComputeIridColour(Finish, lightDirection, Eye.Direction, Layer_Normal, IPoint, tmpCol);
+
+            colour += tmpCol;
+            return;
+        }
+    }
+
     if(gatherer.gathered)
         r = gatherer.alreadyGatheredRadius;
     else
@@ -1635,13 +2088,16 @@ void Trace::ComputePhotonDiffuseLight(const FINISH *Finish, const Vector3d& IPoi
 
 // see Diffuse_One_Light in the v3.6 code (lighting.cpp)
 void Trace::ComputeOneDiffuseLight(const LightSource &lightsource, const Vector3d& reye, const FINISH *finish, const Vector3d& ipoint, const Ray& eye, const Vector3d& layer_normal,
-                                   const MathColour& layer_pigment_colour, MathColour& colour, double attenuation, ConstObjectPtr object, double relativeIor, int light_index)
+                                   const MathColour& layer_pigment_colour, MathColour& colour, double attenuation, ConstObjectPtr object, double relativeIor, int light_index,
+                                   MathColour *highlights)
 {
     double lightsourcedepth, cos_shadow_angle;
     Ray lightsourceray(eye);
     MathColour lightcolour;
     bool backside = false;
     MathColour tmpCol;
+    MathColour tmpHighlights;
+    MathColour& highlightCol = ((highlights != nullptr) ? tmpHighlights : tmpCol);
 
     // Get a colour and a ray.
     ComputeOneLightRay(lightsource, lightsourcedepth, lightsourceray, ipoint, lightcolour);
@@ -1692,7 +2148,7 @@ void Trace::ComputeOneDiffuseLight(const LightSource &lightsource, const Vector3
             ComputeFullAreaDiffuseLight(lightsource, reye, finish, ipoint, eye,
                 layer_normal, layer_pigment_colour, colour, attenuation,
                 lightsourcedepth, lightsourceray, lightcolour,
-                object, relativeIor);
+                object, relativeIor, highlights);
             return;
         }
 
@@ -1711,26 +2167,33 @@ void Trace::ComputeOneDiffuseLight(const LightSource &lightsource, const Vector3
         {
             if(finish->Phong > 0.0)
             {
-                ComputePhongColour (finish, lightsourceray.Direction, eye.Direction, layer_normal, tmpCol,
+                ComputePhongColour (finish, lightsourceray.Direction, eye.Direction, layer_normal, highlightCol,
                                     tempLightColour, layer_pigment_colour, relativeIor);
             }
 
             if(finish->Specular > 0.0)
-                ComputeSpecularColour (finish, lightsourceray.Direction, -eye.Direction, layer_normal, tmpCol,
+                ComputeSpecularColour (finish, lightsourceray.Direction, -eye.Direction, layer_normal, highlightCol,
                                        tempLightColour, layer_pigment_colour, relativeIor);
         }
 
         if(finish->Irid > 0.0)
+        {
             ComputeIridColour(finish, lightsourceray.Direction, eye.Direction, layer_normal, ipoint, tmpCol);
+            if(highlights != nullptr)
+                ComputeIridColour(finish, lightsourceray.Direction, eye.Direction, layer_normal, ipoint, tmpHighlights);
+        }
     }
 
     colour += tmpCol;
+    if(highlights != nullptr)
+        *highlights += tmpHighlights;
 }
 
 // JN2007: Full area lighting:
 void Trace::ComputeFullAreaDiffuseLight(const LightSource &lightsource, const Vector3d& reye, const FINISH *finish, const Vector3d& ipoint, const Ray& eye,
                                         const Vector3d& layer_normal, const MathColour& layer_pigment_colour, MathColour& colour, double attenuation,
-                                        double lightsourcedepth, Ray& lightsourceray, const MathColour& lightcolour, ConstObjectPtr object, double relativeIor)
+                                        double lightsourcedepth, Ray& lightsourceray, const MathColour& lightcolour, ConstObjectPtr object, double relativeIor,
+                                        MathColour *highlights)
 {
     Vector3d temp;
     Vector3d axis1Temp, axis2Temp;
@@ -1766,7 +2229,13 @@ void Trace::ComputeFullAreaDiffuseLight(const LightSource &lightsource, const Ve
         axis2Temp *= axis1_Length;
     }
 
-    MathColour sampleLightcolour = lightcolour / (lightsource.Area_Size1 * lightsource.Area_Size2);
+    // if the light source has just been sampled for the shadow test, shade with the very same samples,
+    // each with its own shadowing, rather than with the average shadowing on a regular grid
+    bool useSamples = (lightsource.Sample_Variance > 0.0) && !areaLightSamples.empty() &&
+                      (areaLightSamplesSource == &lightsource) && (areaLightSamplesPoint - ipoint).IsNull();
+    int samples = (useSamples ? (int)areaLightSamples.size() : lightsource.Area_Size1 * lightsource.Area_Size2);
+
+    MathColour sampleLightcolour = lightcolour / samples;
     MathColour attenuatedLightcolour;
 
     for(int v = 0; v < lightsource.Area_Size2; ++v)
@@ -1779,47 +2248,63 @@ void Trace::ComputeFullAreaDiffuseLight(const LightSource &lightsource, const Ve
             double jitter_v = (double)v;
             bool backside = false;
             MathColour tmpCol;
+            MathColour tmpHighlights;
+            MathColour& highlightCol = ((highlights != nullptr) ? tmpHighlights : tmpCol);
+            int sample = v * lightsource.Area_Size1 + u;
 
-            if(lightsource.Jitter)
+            if(useSamples)
             {
-                jitter_u += randomNumberGenerator() - 0.5;
-                jitter_v += randomNumberGenerator() - 0.5;
-            }
+                if(sample >= samples)
+                    break;
 
-            // Create circular are lights [ENB 9/97]
-            // First, make jitter_u and jitter_v be numbers from -1 to 1
-            // Second, set scaleFactor to the abs max (jitter_u,jitter_v) (for shells)
-            // Third, divide scaleFactor by the length of <jitter_u,jitter_v>
-            // Fourth, scale jitter_u & jitter_v by scaleFactor
-            // Finally scale Axis1 by jitter_u & Axis2 by jitter_v
-            if(lightsource.Circular == true)
-            {
-                jitter_u = jitter_u / (lightsource.Area_Size1 - 1) - 0.5 + 0.001;
-                jitter_v = jitter_v / (lightsource.Area_Size2 - 1) - 0.5 + 0.001;
-                double scaleFactor = ((fabs(jitter_u) > fabs(jitter_v)) ? fabs(jitter_u) : fabs(jitter_v));
-                scaleFactor /= sqrt(jitter_u * jitter_u + jitter_v * jitter_v);
-                jitter_u *= scaleFactor;
-                jitter_v *= scaleFactor;
-                jitterAxis1 = axis1Temp * jitter_u;
-                jitterAxis2 = axis2Temp * jitter_v;
+                sampleLightcolour = areaLightSamples[sample].colour / samples;
+                jitterAxis1 = areaLightSamples[sample].offset;
+                jitterAxis2 = Vector3d(0.0, 0.0, 0.0);
             }
             else
             {
-                if(lightsource.Area_Size1 > 1)
+                if(lightsource.Jitter)
+                {
+                    Vector2d jitter = AreaLightJitter();
+                    jitter_u += jitter.x() - 0.5;
+                    jitter_v += jitter.y() - 0.5;
+                }
+
+                // Create circular are lights [ENB 9/97]
+                // First, make jitter_u and jitter_v be numbers from -1 to 1
+                // Second, set scaleFactor to the abs max (jitter_u,jitter_v) (for shells)
+                // Third, divide scaleFactor by the length of <jitter_u,jitter_v>
+                // Fourth, scale jitter_u & jitter_v by scaleFactor
+                // Finally scale Axis1 by jitter_u & Axis2 by jitter_v
+                if(lightsource.Circular == true)
                 {
-                    double scaleFactor = jitter_u / (double)(lightsource.Area_Size1 - 1) - 0.5;
-                    jitterAxis1 = axis1Temp * scaleFactor;
+                    jitter_u = jitter_u / (lightsource.Area_Size1 - 1) - 0.5 + 0.001;
+                    jitter_v = jitter_v / (lightsource.Area_Size2 - 1) - 0.5 + 0.001;
+                    double scaleFactor = ((fabs(jitter_u) > fabs(jitter_v)) ? fabs(jitter_u) : fabs(jitter_v));
+                    scaleFactor /= sqrt(jitter_u * jitter_u + jitter_v * jitter_v);
+                    jitter_u *= scaleFactor;
+                    jitter_v *= scaleFactor;
+                    jitterAxis1 = axis1Temp * jitter_u;
+                    jitterAxis2 = axis2Temp * jitter_v;
                 }
                 else
-                    jitterAxis1 = Vector3d(0.0, 0.0, 0.0);
+                {
+                    if(lightsource.Area_Size1 > 1)
+                    {
+                        double scaleFactor = jitter_u / (double)(lightsource.Area_Size1 - 1) - 0.5;
+                        jitterAxis1 = axis1Temp * scaleFactor;
+                    }
+                    else
+                        jitterAxis1 = Vector3d(0.0, 0.0, 0.0);
 
-                if(lightsource.Area_Size2 > 1)
-                {
-                    double scaleFactor = jitter_v / (double)(lightsource.Area_Size2 - 1) - 0.5;
-                    jitterAxis2 = axis2Temp * scaleFactor;
+                    if(lightsource.Area_Size2 > 1)
+                    {
+                        double scaleFactor = jitter_v / (double)(lightsource.Area_Size2 - 1) - 0.5;
+                        jitterAxis2 = axis2Temp * scaleFactor;
+                    }
+                    else
+                        jitterAxis2 = Vector3d(0.0, 0.0, 0.0);
                 }
-                else
-                    jitterAxis2 = Vector3d(0.0, 0.0, 0.0);
             }
 
             // Recalculate the light source ray but not the colour
@@ -1853,17 +2338,23 @@ void Trace::ComputeFullAreaDiffuseLight(const LightSource &lightsource, const Ve
             {
                 if(finish->Phong > 0.0)
                 {
-                    ComputePhongColour(finish, lsr.Direction, eye.Direction, layer_normal, tmpCol, attenuatedLightcolour, layer_pigment_colour, relativeIor);
+                    ComputePhongColour(finish, lsr.Direction, eye.Direction, layer_normal, highlightCol, attenuatedLightcolour, layer_pigment_colour, relativeIor);
                 }
 
                 if(finish->Specular > 0.0)
-                    ComputeSpecularColour(finish, lsr.Direction, -eye.Direction, layer_normal, tmpCol, attenuatedLightcolour, layer_pigment_colour, relativeIor);
+                    ComputeSpecularColour(finish, lsr.Direction, -eye.Direction, layer_normal, highlightCol, attenuatedLightcolour, layer_pigment_colour, relativeIor);
             }
 
             if(finish->Irid > 0.0)
+            {
                 ComputeIridColour(finish, lsr.Direction, eye.Direction, layer_normal, ipoint, tmpCol);
+                if(highlights != nullptr)
+                    ComputeIridColour(finish, lsr.Direction, eye.Direction, layer_normal, ipoint, tmpHighlights);
+            }
 
             colour += tmpCol;
+            if(highlights != nullptr)
+                *highlights += tmpHighlights;
         }
     }
 }
@@ -1905,25 +2396,27 @@ void Trace::TraceShadowRay(const LightSource &lightsource, double depth, Ray& li
 
     double newdepth;
     Intersection isect;
-    Ray newray(lightsourceray);
-
-    // Store current depth and ray because they will be modified.
-    newdepth = depth;
+    bool hasInteriors = false;
 
+    // Store current depth and ray because they will be modified; the interiors are only copied once needed.
     // NOTE: shadow rays are never photon rays, so flag can be hard-coded to false
-    newray.SetFlags(Ray::OtherRay, true, false);
+    Ray newray(lightsourceray.GetTicket(), lightsourceray.Origin, lightsourceray.Direction, Ray::OtherRay, true, false);
+    newdepth = depth;
 
     // Get shadows from current light source.
     if(lightsource.Area_Light && qualityFlags.areaLights)
-        TraceAreaLightShadowRay(lightsource, newdepth, newray, point, colour);
+        TraceAreaLightShadowRay(lightsource, newdepth, newray, point, colour, lightsourceray);
     else
-        TracePointLightShadowRay(lightsource, newdepth, newray, colour);
+        hasInteriors = TracePointLightShadowRay(lightsource, newdepth, newray, colour, lightsourceray);
 
     // If there's some distance left for the ray to reach the light source
     // we have to apply atmospheric stuff to this part of the ray.
 
     if((newdepth > SHADOW_TOLERANCE) && (lightsource.Media_Interaction) && (lightsource.Media_Attenuation))
     {
+        if(!hasInteriors)
+            newray.CopyInteriors(lightsourceray);
+
         isect.Depth = newdepth;
         isect.Object = nullptr;
         ComputeShadowMedia(newray, isect, colour, (lightsource.Media_Interaction) && (lightsource.Media_Attenuation));
@@ -1948,10 +2441,24 @@ struct SmallToleranceRayObjectCondition final  : public RayObjectCondition
     virtual bool operator()(const Ray&, ConstObjectPtr, double dist) const override { return dist > SMALL_TOLERANCE; }
 };
 
-void Trace::TracePointLightShadowRay(const LightSource &lightsource, double& lightsourcedepth, Ray& lightsourceray, MathColour& lightcolour)
+/// Matches intersections that are guaranteed to block a shadow ray completely.
+///
+/// @note   This must be kept in sync with the conditions under which
+///         @ref Trace::TracePointLightShadowRay() stops looking for further intersections.
+///
+struct OpaqueShadowIntersectionCondition final : public IntersectionCondition
+{
+    virtual bool operator()(const Intersection& isect) const override
+    {
+        return Test_Flag(isect.Object, OPAQUE_FLAG) &&
+               Test_Flag((isect.Csg != nullptr ? isect.Csg : isect.Object), OPAQUE_FLAG);
+    }
+};
+
+bool Trace::TracePointLightShadowRay(const LightSource &lightsource, double& lightsourcedepth, Ray& lightsourceray, MathColour& lightcolour,
+                                     const Ray& sourceray)
 {
     Intersection boundedIntersection;
-    ObjectPtr cacheObject = nullptr;
     bool foundTransparentObjects = false;
     bool foundIntersection;
 
@@ -1969,61 +2476,101 @@ void Trace::TracePointLightShadowRay(const LightSource &lightsource, double& lig
             else
             {
                 lightcolour.Clear();
-                return;
+                return false;
             }
         }
         else
         {
             lightcolour.Clear();
-            return;
+            return false;
         }
 
         // Make sure we don't do shadows for fill light sources.
         // (Note that if Projected_Through_Object is `nullptr`, the test for FILL_LIGHT_SOURCE has happened earlier already)
         if(lightsource.Light_Type == FILL_LIGHT_SOURCE)
-            return;
+            return false;
     }
 
     NoShadowFlagRayObjectCondition precond;
     SmallToleranceRayObjectCondition postcond;
 
-    // check for object in the light source shadow cache (object that fully shadowed during last test) first
+    // any object added anywhere between the surface and the light source may change the outcome
+    if (threadData->footprint != nullptr)
+        threadData->footprint->AddSegment(lightsourceray.Origin, lightsourceray.Direction, lightsourcedepth);
+
+    // check the objects that most recently shadowed this light source (in this tile) first;
+    // we don't cache for light groups
+    ShadowOccluderCache *cache = nullptr;
 
-    if(lightsource.lightGroupLight == false) // we don't cache for light groups
+    if(lightsource.lightGroupLight == false)
     {
-        if ((lightsourceray.GetTicket().traceLevel == 2) && (lightSourceLevel1ShadowCache[lightsource.index] != nullptr))
-            cacheObject = lightSourceLevel1ShadowCache[lightsource.index];
-        else if (lightSourceOtherShadowCache[lightsource.index] != nullptr)
-            cacheObject = lightSourceOtherShadowCache[lightsource.index];
+        cache = &threadData->GetShadowOccluderCache(lightsource.index, lightsourceray.GetTicket().traceLevel == 2);
 
-        // if there was an object in the light source shadow cache, check that first
-        if (cacheObject != nullptr)
+        for(size_t i = 0; (i < ShadowOccluderCache::kSize) && (cache->objects[i] != nullptr); ++i)
         {
-            if(FindIntersection(cacheObject, boundedIntersection, lightsourceray, lightsourcedepth - projectedDepth) == true)
+            threadData->Stats()[Shadow_Cache_Tests]++;
+
+            if((FindIntersection(cache->objects[i], boundedIntersection, lightsourceray, lightsourcedepth - projectedDepth) == true) &&
+               !Test_Flag(boundedIntersection.Object, NO_SHADOW_FLAG))
             {
-                if(!Test_Flag(boundedIntersection.Object, NO_SHADOW_FLAG))
-                {
-                    ComputeShadowColour(lightsource, boundedIntersection, lightsourceray, lightcolour);
+                // only a full shadow is conclusive; otherwise the object is dealt with again below
+                MathColour cachedColour(lightcolour);
 
-                    if(lightcolour.IsNearZero(EPSILON) &&
-                       (Test_Flag(boundedIntersection.Object, OPAQUE_FLAG)))
-                    {
-                        threadData->Stats()[Shadow_Ray_Tests]++;
-                        threadData->Stats()[Shadow_Rays_Succeeded]++;
-                        threadData->Stats()[Shadow_Cache_Hits]++;
-                        return;
-                    }
+                ComputeShadowColour(lightsource, boundedIntersection, lightsourceray, cachedColour);
+
+                if(cachedColour.IsNearZero(EPSILON) &&
+                   (Test_Flag(boundedIntersection.Object, OPAQUE_FLAG)))
+                {
+                    threadData->Stats()[Shadow_Ray_Tests]++;
+                    threadData->Stats()[Shadow_Rays_Succeeded]++;
+                    threadData->Stats()[Shadow_Cache_Hits]++;
+                    if (threadData->footprint != nullptr)
+                        threadData->footprint->AddObject(cache->objects[i]);
+                    cache->Touch(i);
+                    lightcolour.Clear();
+                    return false;
                 }
-                else
-                    cacheObject = nullptr;
             }
-            else
-                cacheObject = nullptr;
+        }
+    }
+
+    // Unless there are transparent objects in the way, all that matters is whether any opaque object blocks the light,
+    // which is cheaper to determine than the closest intersection; only if some other object was encountered do we need
+    // to trace the shadow ray step by step.
+    if(qualityFlags.shadows)
+    {
+        OpaqueShadowIntersectionCondition occlusion;
+        bool foundOtherObjects;
+
+        if(FindOccluder(boundedIntersection, foundOtherObjects, lightsourceray, min(lightsourcedepth - projectedDepth, lightsourcedepth - SHADOW_TOLERANCE),
+                        precond, postcond, occlusion))
+        {
+            threadData->Stats()[Shadow_Ray_Tests]++;
+            threadData->Stats()[Shadow_Rays_Succeeded]++;
+
+            // an opaque object always yields a full shadow (see ComputeShadowColour())
+            lightcolour.Clear();
+
+            if (threadData->footprint != nullptr)
+                threadData->footprint->AddObject(boundedIntersection.Csg != nullptr ? boundedIntersection.Csg : boundedIntersection.Object);
+
+            if(cache != nullptr)
+                cache->Insert(boundedIntersection.Csg != nullptr ? boundedIntersection.Csg : boundedIntersection.Object);
+            return false;
+        }
+
+        if(!foundOtherObjects)
+        {
+            threadData->Stats()[Shadow_Ray_Tests]++;
+            return false;
         }
     }
 
     foundTransparentObjects = false;
 
+    // The ray may pass through objects from here on, and needs to know what it is inside of.
+    lightsourceray.CopyInteriors(sourceray);
+
     while(true)
     {
         boundedIntersection.Object = boundedIntersection.Csg = nullptr;
@@ -2033,7 +2580,7 @@ void Trace::TracePointLightShadowRay(const LightSource &lightsource, double& lig
 
         foundIntersection = FindIntersection(boundedIntersection, lightsourceray, precond, postcond);
 
-        if((foundIntersection == true) && (boundedIntersection.Object != cacheObject) &&
+        if((foundIntersection == true) &&
            (boundedIntersection.Depth < lightsourcedepth - SHADOW_TOLERANCE) &&
            (lightsourcedepth - boundedIntersection.Depth > projectedDepth) &&
            (boundedIntersection.Depth > SHADOW_TOLERANCE))
@@ -2044,21 +2591,17 @@ void Trace::TracePointLightShadowRay(const LightSource &lightsource, double& lig
 
             ObjectPtr testObject(boundedIntersection.Csg != nullptr ? boundedIntersection.Csg : boundedIntersection.Object);
 
+            if (threadData->footprint != nullptr)
+                threadData->footprint->AddObject(testObject);
+
             if(lightcolour.IsNearZero(EPSILON) &&
                (Test_Flag(testObject, OPAQUE_FLAG)))
             {
                 // Hit a fully opaque object; cache that object, so that next time we can test for it first;
                 // don't cache for light groups though (why not??)
 
-                if((lightsource.lightGroupLight == false) && (foundTransparentObjects == false))
-                {
-                    cacheObject = testObject;
-
-                    if(lightsourceray.GetTicket().traceLevel == 2)
-                        lightSourceLevel1ShadowCache[lightsource.index] = cacheObject;
-                    else
-                        lightSourceOtherShadowCache[lightsource.index] = cacheObject;
-                }
+                if((cache != nullptr) && (foundTransparentObjects == false))
+                    cache->Insert(testObject);
                 break;
             }
 
@@ -2073,10 +2616,12 @@ void Trace::TracePointLightShadowRay(const LightSource &lightsource, double& lig
             // No further intersections in the direction of the ray.
             break;
     }
+
+    return true;
 }
 
 void Trace::TraceAreaLightShadowRay(const LightSource &lightsource, double& lightsourcedepth, Ray& lightsourceray,
-                                    const Vector3d& ipoint, MathColour& lightcolour)
+                                    const Vector3d& ipoint, MathColour& lightcolour, const Ray& sourceray)
 {
     Vector3d temp;
     Vector3d axis1Temp, axis2Temp;
@@ -2125,11 +2670,15 @@ void Trace::TraceAreaLightShadowRay(const LightSource &lightsource, double& ligh
         axis2Temp *= axis1_Length;
     }
 
-    TraceAreaLightSubsetShadowRay(lightsource, lightsourcedepth, lightsourceray, ipoint, lightcolour, 0, 0, lightsource.Area_Size1 - 1, lightsource.Area_Size2 - 1, 0, axis1Temp, axis2Temp);
+    if(lightsource.Sample_Variance > 0.0)
+        TraceAreaLightSampledShadowRay(lightsource, lightsourcedepth, lightsourceray, ipoint, lightcolour, axis1Temp, axis2Temp, sourceray);
+    else
+        TraceAreaLightSubsetShadowRay(lightsource, lightsourcedepth, lightsourceray, ipoint, lightcolour, 0, 0, lightsource.Area_Size1 - 1, lightsource.Area_Size2 - 1, 0, axis1Temp, axis2Temp, sourceray);
 }
 
 void Trace::TraceAreaLightSubsetShadowRay(const LightSource &lightsource, double& lightsourcedepth, Ray& lightsourceray,
-                                          const Vector3d& ipoint, MathColour& lightcolour, int u1, int  v1, int  u2, int  v2, int level, const Vector3d& axis1, const Vector3d& axis2)
+                                          const Vector3d& ipoint, MathColour& lightcolour, int u1, int  v1, int  u2, int  v2, int level, const Vector3d& axis1, const Vector3d& axis2,
+                                          const Ray& sourceray)
 {
     MathColour sample_Colour[4];
     int i, u, v, new_u1, new_v1, new_u2, new_v2;
@@ -2162,8 +2711,9 @@ void Trace::TraceAreaLightSubsetShadowRay(const LightSource &lightsource, double
 
             if(lightsource.Jitter)
             {
-                jitter_u += randomNumberGenerator() - 0.5;
-                jitter_v += randomNumberGenerator() - 0.5;
+                Vector2d jitter = AreaLightJitter();
+                jitter_u += jitter.x() - 0.5;
+                jitter_v += jitter.y() - 0.5;
             }
 
             // Create circular are lights [ENB 9/97]
@@ -2207,7 +2757,7 @@ void Trace::TraceAreaLightSubsetShadowRay(const LightSource &lightsource, double
 
             sample_Colour[i] = lightcolour;
 
-            TracePointLightShadowRay(lightsource, lightsourcedepth, lsr, sample_Colour[i]);
+            TracePointLightShadowRay(lightsource, lightsourcedepth, lsr, sample_Colour[i], sourceray);
 
             lightGrid[u * lightsource.Area_Size2 + v] = sample_Colour[i];
         }
@@ -2261,7 +2811,7 @@ void Trace::TraceAreaLightSubsetShadowRay(const LightSource &lightsource, double
                 sample_Colour[i] = lightcolour;
 
                 TraceAreaLightSubsetShadowRay(lightsource, lightsourcedepth, lightsourceray,
-                                              ipoint, sample_Colour[i], new_u1, new_v1, new_u2, new_v2, level + 1, axis1, axis2);
+                                              ipoint, sample_Colour[i], new_u1, new_v1, new_u2, new_v2, level + 1, axis1, axis2, sourceray);
             }
         }
     }
@@ -2270,6 +2820,106 @@ void Trace::TraceAreaLightSubsetShadowRay(const LightSource &lightsource, double
     lightcolour = (sample_Colour[0] + sample_Colour[1] + sample_Colour[2] + sample_Colour[3]) * 0.25;
 }
 
+Vector2d Trace::AreaLightJitter()
+{
+    if(threadData->sampleContext.valid)
+        return threadData->sampleSequence.Next2d(threadData->sampleContext);
+
+    double u = randomNumberGenerator();
+    double v = randomNumberGenerator();
+    return Vector2d(u, v);
+}
+
+void Trace::TraceAreaLightSampledShadowRay(const LightSource &lightsource, double& lightsourcedepth, Ray& lightsourceray,
+                                           const Vector3d& ipoint, MathColour& lightcolour, const Vector3d& axis1, const Vector3d& axis2,
+                                           const Ray& sourceray)
+{
+    size_t maxSamples = lightsource.Area_Size1 * lightsource.Area_Size2;
+    size_t waveSize = min(maxSamples, max<size_t>(4, maxSamples / 8));
+    MathColour unshadowedColour(lightcolour);
+    MathColour sumColour;
+    double unshadowedGrey = unshadowedColour.Greyscale();
+    double sum = 0.0;
+    double sumSqr = 0.0;
+    double shiftU = 0.0;
+    double shiftV = 0.0;
+    bool allLit = true;
+    bool allDark = true;
+    size_t n = 0;
+
+    std::shared_ptr<std::vector<Vector2d>>& pattern = areaLightSamplePatterns[maxSamples];
+    if(pattern == nullptr)
+        pattern = GetSubRandom2dGenerator(0, 0.0, 1.0, 0.0, 1.0, maxSamples)->GetSequence(maxSamples);
+
+    // With jitter, shift the whole pattern randomly for each point (wrapping around), so that the points
+    // stay well distributed over the light source while the shadow structure turns into noise.
+    if(lightsource.Jitter)
+    {
+        Vector2d shift = AreaLightJitter();
+        shiftU = shift.x();
+        shiftV = shift.y();
+    }
+
+    areaLightSamples.clear();
+    areaLightSamplesSource = &lightsource;
+    areaLightSamplesPoint = ipoint;
+
+    while(n < maxSamples)
+    {
+        for(size_t waveEnd = min(n + waveSize, maxSamples); n < waveEnd; ++n)
+        {
+            AreaLightSample sample;
+            Ray lsr(lightsourceray);
+            double u = (*pattern)[n][X] + shiftU;
+            double v = (*pattern)[n][Y] + shiftV;
+
+            u = (u >= 1.0 ? u - 1.0 : u) - 0.5;
+            v = (v >= 1.0 ? v - 1.0 : v) - 0.5;
+
+            // map square shells to circles, as for regular circular area lights
+            if(lightsource.Circular && ((u != 0.0) || (v != 0.0)))
+            {
+                double scaleFactor = max(fabs(u), fabs(v)) / sqrt(u * u + v * v);
+                u *= scaleFactor;
+                v *= scaleFactor;
+            }
+
+            sample.offset = axis1 * u + axis2 * v;
+            sample.colour = unshadowedColour;
+
+            // Recalculate the light source ray but not the colour
+            ComputeOneWhiteLightRay(lightsource, lightsourcedepth, lsr, ipoint, sample.offset);
+
+            TracePointLightShadowRay(lightsource, lightsourcedepth, lsr, sample.colour, sourceray);
+
+            if(!sample.colour.IsNearZero(EPSILON))
+                allDark = false;
+            if(ColourDistance(sample.colour, unshadowedColour) > EPSILON)
+                allLit = false;
+
+            double visibility = (fabs(unshadowedGrey) > EPSILON ? sample.colour.Greyscale() / unshadowedGrey : 0.0);
+            sum += visibility;
+            sumSqr += visibility * visibility;
+            sumColour += sample.colour;
+
+            areaLightSamples.push_back(sample);
+        }
+
+        // stop if the first wave agrees completely (later waves can't do so if the first didn't),
+        // or if the mean visibility has become sufficiently certain
+        if(allLit || allDark || (n >= maxSamples))
+            break;
+
+        double mean = sum / n;
+        double variance = max(0.0, (sumSqr - n * mean * mean) / (n - 1));
+
+        if(variance / n < lightsource.Sample_Variance)
+            break;
+    }
+
+    lightcolour = sumColour / double(n);
+}
+
 // see filter_shadow_ray in v3.6's lighting.cpp
 void Trace::ComputeShadowColour(const LightSource &lightsource, Intersection& isect, Ray& lightsourceray, MathColour& colour)
 {
@@ -2844,31 +3494,21 @@ void Trace::ComputeSky(const Ray& ray, MathColour& colour, ColourChannel& transm
         double att;
         MathColour col;
         TransColour col_Temp;
-        Vector3d p;
 
         col.Clear();
 
         if (sceneData->skysphere != nullptr)
         {
-            // Transform point on unit sphere.
-            if (sceneData->skysphere->Trans != nullptr)
-                MInvTransPoint(p, ray.Direction, sceneData->skysphere->Trans);
-            else
-                p = ray.Direction;
-
-            // TODO - Reverse iterator may be less performant than forward iterator; we might want to
-            //        compare performance with using forward iterators and decrement, or using random access.
-            //        Alternatively, reversing the vector after parsing might be another option.
-            for(vector<PIGMENT*>::const_reverse_iterator i = sceneData->skysphere->Pigments.rbegin(); i != sceneData->skysphere->Pigments.rend(); ++ i)
+            if (sceneData->skysphere->Cache != nullptr)
             {
-                // Compute sky colour from colour map.
-                Compute_Pigment(col_Temp, *i, p, nullptr, nullptr, threadData);
-
-                att = col_Temp.Opacity();
-
-                col += col_Temp.colour() * att * filCol * sceneData->skysphere->Emission;
-                filCol *= col_Temp.TransmittedColour();
+                // Look up the pre-computed sky sphere, blurred to match the solid angle covered by the ray.
+                double solidAngle = Sqr(threadData->pixelFootprintSlope);
+                if (ray.IsRadiosityRay() && (sceneData->radiositySettings.count > 0))
+                    solidAngle = max(solidAngle, 2.0 * M_PI / sceneData->radiositySettings.count);
+                sceneData->skysphere->Cache->Lookup(ray.Direction, solidAngle, col, filCol);
             }
+            else
+                Compute_Skysphere(col, filCol, sceneData->skysphere, ray.Direction, threadData);
         }
 
         // apply background as if it was another sky sphere with uniform pigment
@@ -2892,8 +3532,6 @@ void Trace::ComputeSky(const Ray& ray, MathColour& colour, ColourChannel& transm
 void Trace::ComputeFog(const Ray& ray, const Intersection& isect, MathColour& colour, ColourChannel& transm)
 {
     double att, width;
-    MathColour col_fog;
-    ColourChannel filter_fog, transm_fog;
     MathColour sum_att; // total attenuation.
     MathColour sum_col; // total color.
 
@@ -2913,29 +3551,42 @@ void Trace::ComputeFog(const Ray& ray, const Intersection& isect, MathColour& co
         {
             width = isect.Depth;
 
-            switch(fog->Type)
+            if (!fog->Transmittance_Table.empty())
             {
-                case GROUND_MIST:
-                    att = ComputeGroundFogDepth(ray, 0.0, width, fog);
-                    break;
-                default:
-                    att = ComputeConstantFogDepth(ray, 0.0, width, fog);
-                    break;
+                // Fog without turbulence; use the pre-computed tables.
+                switch(fog->Type)
+                {
+                    case GROUND_MIST:
+                        att = Fog_Transmittance(fog, width * ComputeGroundFogDensity(ray, width, fog) / fog->Distance);
+                        break;
+                    default:
+                        att = Fog_Transmittance(fog, width / fog->Distance);
+                        break;
+                }
             }
+            else
+            {
+                switch(fog->Type)
+                {
+                    case GROUND_MIST:
+                        att = ComputeGroundFogDepth(ray, 0.0, width, fog);
+                        break;
+                    default:
+                        att = ComputeConstantFogDepth(ray, 0.0, width, fog);
+                        break;
+                }
 
-            col_fog = fog->colour.colour();
-            fog->colour.GetFT(filter_fog, transm_fog);
-
-            // Check for minimum transmittance.
-            if(att < transm_fog)
-                att = transm_fog;
+                // Check for minimum transmittance.
+                if(att < fog->colour.transm())
+                    att = fog->colour.transm();
+            }
 
             // Get attenuation sum due to filtered/unfiltered translucency.
             // [CLi] removed computation of sum_att.filer() and sum_att.transm(), as they were discarded anyway
-            sum_att *= att * ((1.0 - filter_fog) + filter_fog * col_fog);
+            sum_att *= att * fog->Attenuation;
 
             if(!ray.IsShadowTestRay())
-                sum_col += (1.0 - att) * col_fog;
+                sum_col += (1.0 - att) * fog->colour.colour();
         }
     }
 
@@ -2985,6 +3636,30 @@ double Trace::ComputeConstantFogDepth(const Ray &ray, double depth, double width
 *   The integral of the density is atan(Y) (for Y >= 0).
 ******************************************************************************/
 
+double Trace::ComputeGroundFogDensity(const Ray& ray, double width, const FOG *fog)
+{
+    double start, end, delta;
+
+    // Get heights of start and end point in ground fog space.
+    start = (dot(ray.Origin, fog->Up) - fog->Offset) / fog->Alt;
+    end   = start + dot(ray.Direction, fog->Up) * width / fog->Alt;
+
+    if((start <= 0.0) && (end <= 0.0))
+        return 1.0;
+
+    delta = end - start;
+
+    // The tabulated integral is not precise enough to be differentiated over short spans.
+    if(fabs(delta) < 0.25)
+    {
+        if(fabs(delta) <= EPSILON)
+            return 1.0 / (Sqr(start) + 1.0);
+        return ((end > 0.0 ? atan(end) : end) - (start > 0.0 ? atan(start) : start)) / delta;
+    }
+
+    return (Ground_Fog_Density_Integral(end) - Ground_Fog_Density_Integral(start)) / delta;
+}
+
 double Trace::ComputeGroundFogDepth(const Ray& ray, double depth, double width, const FOG *fog)
 {
     double fog_density, delta;
@@ -3202,6 +3877,66 @@ bool Trace::TestShadow(const LightSource &lightsource, double& depth, Ray& light
     return false;
 }
 
+/// Sampler computing the fraction of a light source's light not blocked by shadows.
+class LightVisibilitySampler final : public MediaGrid::Sampler
+{
+    public:
+        LightVisibilitySampler(Trace& t, const LightSource& l, TraceTicket& tt) : trace(t), light(l), ticket(tt) {}
+        virtual void operator()(const Vector3d& p, MathColour& c) override { trace.ComputeLightVisibility(light, p, c, ticket); }
+    private:
+        Trace& trace;
+        const LightSource& light;
+        TraceTicket& ticket;
+};
+
+void Trace::ComputeLightVisibility(const LightSource &lightsource, const Vector3d& p, MathColour& visibility, TraceTicket& ticket)
+{
+    Ray lightsourceray(ticket);
+    double lightsourcedepth;
+    MathColour unshadowed;
+    ComputeOneLightRay(lightsource, lightsourcedepth, lightsourceray, p, unshadowed);
+
+    // Outside a spot light's cone visibility is moot, so assume the light to be unblocked
+    // to avoid darkening the edge of the cone when interpolating.
+    visibility = MathColour(1.0);
+    if (unshadowed.IsNearZero(EPSILON))
+        return;
+
+    MathColour shadowed = unshadowed;
+    TraceShadowRay(lightsource, lightsourcedepth, lightsourceray, p, shadowed);
+    for (int i = 0; i < MathColour::channels; i++)
+        visibility[i] = (unshadowed[i] > 0.0 ? shadowed[i] / unshadowed[i] : 1.0);
+}
+
+bool Trace::TestShadow(const LightSource &lightsource, MediaGrid& visibility, MediaGridCache& cache, double& depth, Ray& light_source_ray, const Vector3d& p, MathColour& colour)
+{
+    ComputeOneLightRay(lightsource, depth, light_source_ray, p, colour);
+
+    if(colour.IsNearZero(EPSILON))
+    {
+        colour.Clear();
+        return true;
+    }
+
+    if (qualityFlags.shadows && ((lightsource.Projected_Through_Object != nullptr) || (lightsource.Light_Type != FILL_LIGHT_SOURCE)))
+    {
+        LightVisibilitySampler sampler(*this, lightsource, light_source_ray.GetTicket());
+        MathColour lightVisibility;
+        if (visibility.Evaluate(p, lightVisibility, cache, sampler))
+            colour *= lightVisibility;
+        else
+            TraceShadowRay(lightsource, depth, light_source_ray, p, colour);
+
+        if(colour.IsNearZero(EPSILON))
+        {
+            colour.Clear();
+            return true;
+        }
+    }
+
+    return false;
+}
+
 bool Trace::IsObjectInCSG(ConstObjectPtr object, ConstObjectPtr parent)
 {
     bool found = false;
@@ -3519,7 +4254,7 @@ bool Trace::SSLTComputeRefractedDirection(const Vector3d& v, const Vector3d& n,
     return true;
 }
 
-void Trace::ComputeDiffuseContribution(const Intersection& out, const Vector3d& vOut, const Vector3d& pIn, const Vector3d& nIn, const Vector3d& vIn, double& sd, double sigma_prime_s, double sigma_a, double eta)
+double Trace::ComputeDiffuseReflectance(double distSqr, double sigma_prime_s, double sigma_a, double eta)
 {
     // TODO FIXME - a great deal of this can be precomputed
     double  sigma_prime_t = sigma_prime_s + sigma_a;
@@ -3528,18 +4263,9 @@ void Trace::ComputeDiffuseContribution(const Intersection& out, const Vector3d&
     double  Aconst = ((1 + F_dr) / (1 - F_dr));
     double  Rd;
 
-    double  cos_phi_in  = clip(dot(vIn,  nIn),         -1.0, 1.0); // (clip values to not run into trouble due to petty precision issues)
-    double  cos_phi_out = clip(dot(vOut, out.INormal), -1.0, 1.0);
-    double  phi_in  = acos(cos_phi_in);
-    double  phi_out = acos(cos_phi_out);
-
-    double  F = ComputeFt(phi_in, eta) * ComputeFt(phi_out, eta);
-
 #if 1
     // full BSSRDF model
 
-    double  distSqr = (pIn - out.IPoint).lengthSqr() * Sqr(sceneData->mmPerUnit);
-
     double  Dconst = 1 / (3 * sigma_prime_t);
     double  sigma_tr = sqrt(3 * sigma_a * sigma_prime_t);
 
@@ -3568,6 +4294,21 @@ void Trace::ComputeDiffuseContribution(const Intersection& out, const Vector3d&
 
 #endif
 
+    return Rd;
+}
+
+void Trace::ComputeDiffuseContribution(const Intersection& out, const Vector3d& vOut, const Vector3d& pIn, const Vector3d& nIn, const Vector3d& vIn, double& sd, double sigma_prime_s, double sigma_a, double eta)
+{
+    double  cos_phi_in  = clip(dot(vIn,  nIn),         -1.0, 1.0); // (clip values to not run into trouble due to petty precision issues)
+    double  cos_phi_out = clip(dot(vOut, out.INormal), -1.0, 1.0);
+    double  phi_in  = acos(cos_phi_in);
+    double  phi_out = acos(cos_phi_out);
+
+    double  F = ComputeFt(phi_in, eta) * ComputeFt(phi_out, eta);
+
+    double  distSqr = (pIn - out.IPoint).lengthSqr() * Sqr(sceneData->mmPerUnit);
+    double  Rd = ComputeDiffuseReflectance(distSqr, sigma_prime_s, sigma_a, eta);
+
     // NOTE: We're leaving out the 1/pi factor because in POV-Ray, by convention,
     // light intensity is normalized to imply this factor already.
     sd = F * Rd; // (normally this would be F*Rd/M_PI)
@@ -3690,6 +4431,148 @@ void Trace::ComputeDiffuseAmbientContribution1(const Intersection& out, const Ve
 #endif
 }
 
+void Trace::ComputeSubsurfaceIrradiance(const LightSource& lightsource, const Intersection& in, MathColour& irradiance, double eta, TraceTicket& ticket)
+{
+    // TODO FIXME - part of this code is very alike to ComputeDiffuseContribution1()
+
+    // Get a colour and a ray.
+    Ray lightsourceray(ticket);
+    double lightsourcedepth;
+    MathColour lightcolour;
+    ComputeOneLightRay(lightsource, lightsourcedepth, lightsourceray, in.IPoint, lightcolour, true);
+
+    // Don't calculate spotlights when outside of the light's cone.
+    if(lightcolour.IsNearZero(EPSILON))
+        return;
+
+    // [CLi] we're coming from inside the object, so the surface /must/ be properly oriented towards the camera; if it isn't,
+    // it must be the normal's fault
+    double cos_in = fabs(dot(in.INormal, lightsourceray.Direction));
+    // [CLi] light coming in almost parallel to the surface is a problem though
+    if(cos_in < EPSILON)
+        return;
+
+    if (qualityFlags.shadows && ((lightsource.Projected_Through_Object != nullptr) || (lightsource.Light_Type != FILL_LIGHT_SOURCE)))
+        TraceShadowRay(lightsource, lightsourcedepth, lightsourceray, in.IPoint, lightcolour);
+
+    irradiance += lightcolour * (cos_in * ComputeFt(acos(cos_in), eta));
+}
+
+std::shared_ptr<const SubsurfaceIrradianceCloud> Trace::BuildSubsurfaceIrradianceCloud(const Intersection& out, double eta, TraceTicket& ticket)
+{
+    const Interior *interior = out.Object->interior.get();
+    std::vector<SubsurfaceIrradianceSample> samples;
+
+    // Find the top-level objects sharing the interior; if there are none (e.g. because the interior was
+    // specified for a CSG child only), fall back to all finite objects and filter the intersections.
+    std::vector<ObjectPtr> candidates;
+    for (int pass = 0; (pass < 2) && candidates.empty(); pass ++)
+    {
+        for (std::vector<ObjectPtr>::const_iterator i = sceneData->objects.begin(); i != sceneData->objects.end(); i ++)
+        {
+            if (((pass == 1) || ((*i)->interior.get() == interior)) &&
+                ((*i)->BBox.size[X] < CRITICAL_LENGTH) && ((*i)->BBox.size[Y] < CRITICAL_LENGTH) && ((*i)->BBox.size[Z] < CRITICAL_LENGTH))
+                candidates.push_back(*i);
+        }
+    }
+    if (candidates.empty())
+        return std::make_shared<SubsurfaceIrradianceCloud>(samples, 0.0);
+
+    Vector3d lowerLeft(BOUND_HUGE), upperRight(-BOUND_HUGE);
+    for (std::vector<ObjectPtr>::const_iterator i = candidates.begin(); i != candidates.end(); i ++)
+    {
+        for (int axis = X; axis <= Z; axis ++)
+        {
+            lowerLeft[axis]  = min(lowerLeft[axis],  double((*i)->BBox.lowerLeft[axis]));
+            upperRight[axis] = max(upperRight[axis], double((*i)->BBox.lowerLeft[axis] + (*i)->BBox.size[axis]));
+        }
+    }
+    Vector3d center = (lowerLeft + upperRight) * 0.5;
+    double radius = (upperRight - lowerLeft).length() * 0.5 + EPSILON;
+
+    // Shoot isotropic random lines through the bounding sphere; by Crofton's formula, the intersections are
+    // uniformly distributed over the surface, each representing an area of 2*pi*radius^2 divided by the number
+    // of lines.
+    SeedableDoubleGeneratorPtr random = GetRandomDoubleGenerator(0.0, 1.0);
+    size_t targetCount = sceneData->subsurfacePointCount;
+    size_t maxLines = targetCount * 100;
+    size_t lines = 0;
+    while ((samples.size() < targetCount) && (lines < maxLines))
+    {
+        lines ++;
+
+        double cos_theta = 2.0 * (*random)() - 1.0;
+        double sin_theta = sqrt(1.0 - Sqr(cos_theta));
+        double phi = 2.0 * M_PI * (*random)();
+        Vector3d direction(sin_theta * cos(phi), sin_theta * sin(phi), cos_theta);
+        Vector3d axisU, axisV;
+        ComputeSurfaceTangents(direction, axisU, axisV);
+        double r = radius * sqrt((*random)());
+        double alpha = 2.0 * M_PI * (*random)();
+        Vector3d origin = center + axisU * (r * cos(alpha)) + axisV * (r * sin(alpha)) - direction * radius;
+
+        Ray ray(ticket, origin, direction);
+        for (std::vector<ObjectPtr>::const_iterator i = candidates.begin(); i != candidates.end(); i ++)
+        {
+            IStack depthstack(stackPool);
+            POV_REFPOOL_ASSERT(depthstack->empty()); // verify that the IStack pulled from the pool is in a cleaned-up condition
+
+            if ((*i)->All_Intersections(ray, depthstack, threadData))
+            {
+                while (depthstack->size() > 0)
+                {
+                    Intersection in = depthstack->top();
+                    depthstack->pop();
+                    if ((in.Depth < 0.0) || (in.Depth > 2.0 * radius) || (in.Object->interior.get() != interior))
+                        continue;
+
+                    ComputeSSLTNormal(in);
+
+                    SubsurfaceIrradianceSample sample;
+                    sample.position = in.IPoint;
+
+                    // global light sources, if not turned off for this object
+                    if((out.Object->Flags & NO_GLOBAL_LIGHTS_FLAG) != NO_GLOBAL_LIGHTS_FLAG)
+                    {
+                        for(int k = 0; k < threadData->lightSources.size(); k++)
+                            ComputeSubsurfaceIrradiance(*threadData->lightSources[k], in, sample.power, eta, ticket);
+                    }
+
+                    // local light sources from a light group, if any
+                    for(int k = 0; k < out.Object->LLights.size(); k++)
+                        ComputeSubsurfaceIrradiance(*out.Object->LLights[k], in, sample.power, eta, ticket);
+
+                    samples.push_back(sample);
+                }
+            }
+        }
+    }
+
+    double sampleArea = 2.0 * M_PI * Sqr(radius) / lines;
+    for (std::vector<SubsurfaceIrradianceSample>::iterator i = samples.begin(); i != samples.end(); i ++)
+        i->power *= sampleArea * Sqr(sceneData->mmPerUnit);
+
+    return std::make_shared<SubsurfaceIrradianceCloud>(samples, sampleArea);
+}
+
+const SubsurfaceIrradianceCloud *Trace::GetSubsurfaceIrradianceCloud(const Intersection& out, double eta, TraceTicket& ticket)
+{
+    const Interior *interior = out.Object->interior.get();
+
+    std::shared_ptr<const SubsurfaceIrradianceCloud>& cloud = ssltIrradianceClouds[interior];
+    if (!cloud)
+    {
+        // The first thread to encounter the interior builds the cloud, while all others wait for it.
+        std::lock_guard<std::mutex> lock(sceneData->subsurfaceIrradianceMutex);
+        std::shared_ptr<const SubsurfaceIrradianceCloud>& sharedCloud = sceneData->subsurfaceIrradianceClouds[interior];
+        if (!sharedCloud)
+            sharedCloud = BuildSubsurfaceIrradianceCloud(out, eta, ticket);
+        cloud = sharedCloud;
+    }
+
+    return cloud.get();
+}
+
 void Trace::ComputeSubsurfaceScattering(const FINISH *Finish, const MathColour& layer_pigment_colour, const Intersection& out, Ray& Eye, const Vector3d& Layer_Normal, MathColour& Final_Colour, double Attenuation)
 {
     int NumSamplesDiffuse = sceneData->subsurfaceSamplesDiffuse;
@@ -3761,8 +4644,21 @@ void Trace::ComputeSubsurfaceScattering(const FINISH *Finish, const MathColour&
                             (radiosity.CheckRadiosityTraceLevel(Eye.GetTicket()) == true) &&
                             (Test_Flag(out.Object, IGNORE_RADIOSITY_FLAG) == false);
 
+    // with an irradiance point cloud, light sources are accounted for by the cloud,
+    // and entry points only need to be sampled for radiosity
+    const SubsurfaceIrradianceCloud *cloud = nullptr;
+    if (sceneData->subsurfacePointCount > 0)
+    {
+        cloud = GetSubsurfaceIrradianceCloud(out, eta, Eye.GetTicket());
+        if (cloud->empty())
+            cloud = nullptr;
+        else if (!radiosity_needed)
+            NumSamplesDiffuse = 0;
+    }
+
     Vector3d sampleBase;
-    ComputeDiffuseSampleBase(sampleBase, out, vOut, 1.0 / (sigma_prime_t_mean * sceneData->mmPerUnit), Eye.GetTicket());
+    if (NumSamplesDiffuse > 0)
+        ComputeDiffuseSampleBase(sampleBase, out, vOut, 1.0 / (sigma_prime_t_mean * sceneData->mmPerUnit), Eye.GetTicket());
 
     weightSum = 0.0;
     trueNumSamples = 0;
@@ -3787,14 +4683,14 @@ void Trace::ComputeSubsurfaceScattering(const FINISH *Finish, const MathColour&
                     ComputeDiffuseAmbientContribution1(out, vOut, in, Total_Colour, sigma_prime_s, sigma_a, eta, weight, Eye.GetTicket());
 
                 // global light sources, if not turned off for this object
-                if((out.Object->Flags & NO_GLOBAL_LIGHTS_FLAG) != NO_GLOBAL_LIGHTS_FLAG)
+                if((cloud == nullptr) && ((out.Object->Flags & NO_GLOBAL_LIGHTS_FLAG) != NO_GLOBAL_LIGHTS_FLAG))
                 {
                     for(int k = 0; k < threadData->lightSources.size(); k++)
                         ComputeDiffuseContribution1(*threadData->lightSources[k], out, vOut, in, Total_Colour, sigma_prime_s, sigma_a, eta, weight, Eye.GetTicket());
                 }
 
                 // local light sources from a light group, if any
-                if(!out.Object->LLights.empty())
+                if((cloud == nullptr) && !out.Object->LLights.empty())
                 {
                     for(int k = 0; k < out.Object->LLights.size(); k++)
                         ComputeDiffuseContribution1(*out.Object->LLights[k], out, vOut, in, Total_Colour, sigma_prime_s, sigma_a, eta, weight, Eye.GetTicket());
@@ -3809,6 +4705,20 @@ void Trace::ComputeSubsurfaceScattering(const FINISH *Finish, const MathColour&
     if (trueNumSamples > 0)
         Total_Colour /= trueNumSamples;
 
+    if (cloud != nullptr)
+    {
+        // hierarchically evaluate the diffusion profile over the irradiance point cloud
+        double Ft_out = ComputeFt(acos(clip(dot(vOut, out.INormal), -1.0, 1.0)), eta);
+        ssltIrradianceSamples.clear();
+        cloud->Gather(ssltIrradianceSamples, out.IPoint, sceneData->subsurfaceErrorBound);
+        for (std::vector<SubsurfaceIrradianceSample>::const_iterator i = ssltIrradianceSamples.begin(); i != ssltIrradianceSamples.end(); i ++)
+        {
+            double distSqr = (i->position - out.IPoint).lengthSqr() * Sqr(sceneData->mmPerUnit);
+            for (int j = 0; j < MathColour::channels; j++)
+                Total_Colour[j] += i->power[j] * Ft_out * ComputeDiffuseReflectance(distSqr, sigma_prime_s[j], sigma_a[j], eta);
+        }
+    }
+
 #endif
 
     Vector3d refractedEye;
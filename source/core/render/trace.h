@@ -43,6 +43,7 @@
 //  (none at the moment)
 
 // C++ standard header files
+#include <map>
 #include <memory>
 #include <vector>
 
@@ -52,6 +53,8 @@
 // POV-Ray header files (core module)
 #include "core/coretypes.h"
 #include "core/bounding/bsptree.h"
+#include "core/bounding/compactbboxtree.h"
+#include "core/lighting/subsurface.h"
 #include "core/math/randomsequence.h"
 #include "core/render/ray.h"
 #include "core/scene/atmosphere_fwd.h"
@@ -257,12 +260,100 @@ class Trace
         bool FindIntersection(ObjectPtr object, Intersection& isect, const Ray& ray, double closest = HUGE_VAL);
         bool FindIntersection(ObjectPtr object, Intersection& isect, const Ray& ray, const RayObjectCondition& postcondition, double closest = HUGE_VAL);
 
+        /// Find the closest intersections for a packet of rays.
+        ///
+        /// With the wide BVH (`Bounding_Method=3`), the rays are traced through the bounding hierarchy
+        /// together; otherwise this is equivalent to calling @ref FindIntersection() for each ray.
+        ///
+        /// @param[in,out]  isect           Intersection for each ray; the @ref Intersection::Depth member
+        ///                                 must be set to the maximum distance.
+        /// @param[out]     found           Whether an intersection was found for each ray.
+        /// @param[in]      rays            Rays to trace.
+        /// @param[in]      count           Number of rays.
+        /// @param[in]      precondition    Condition an object must meet to be tested.
+        /// @param[in]      postcondition   Condition an intersection must meet to be accepted.
+        ///
+        void FindIntersections(Intersection isect[], bool found[], const Ray* const rays[], unsigned int count,
+                               const RayObjectCondition& precondition, const RayObjectCondition& postcondition);
+
+        /// Find any intersection meeting a given condition (any-hit query).
+        ///
+        /// Unlike @ref FindIntersection(), this stops at the first intersection found to meet the
+        /// occlusion condition, regardless of whether it is the closest one.
+        ///
+        /// @param[out]     occluder        Intersection found to meet the occlusion condition.
+        /// @param[out]     otherHits       Whether any intersections not meeting the occlusion condition were found.
+        /// @param[in]      ray             Ray to trace.
+        /// @param[in]      maxDepth        Intersections at or beyond this distance are ignored.
+        /// @param[in]      precondition    Condition an object must meet to be tested.
+        /// @param[in]      postcondition   Condition an intersection must meet to be considered at all.
+        /// @param[in]      occlusion       Condition an intersection must meet to terminate the query.
+        /// @return                         `true` if an intersection meeting the occlusion condition was found.
+        ///
+        bool FindOccluder(Intersection& occluder, bool& otherHits, const Ray& ray, double maxDepth,
+                          const RayObjectCondition& precondition, const RayObjectCondition& postcondition, const IntersectionCondition& occlusion);
+
         unsigned int GetHighestTraceLevel();
 
+        /// Get the number of scratch containers this instance's pools have had to allocate so far.
+        ///
+        /// Once the pools have grown to the depth of recursion the scene needs, tracing further
+        /// rays should not change this number; it is intended for debugging.
+        ///
+        size_t GetScratchAllocationCount() const;
+
+        /// Terminate secondary rays of low importance at random rather than tracing them all.
+        ///
+        /// Rays with a weight below the threshold are traced with a probability proportional to
+        /// their weight, and their contribution is scaled up accordingly, so that the result is
+        /// unbiased on average.
+        ///
+        /// @param[in]      threshold       Weight below which rays are subject to termination, or 0 to disable.
+        ///
+        void SetRussianRoulette(double threshold) { rouletteThreshold = threshold; }
+
+        /// Limit the number of secondary rays traced for each primary ray.
+        ///
+        /// Once the budget is exhausted, further secondary rays are not traced at all. Unlike
+        /// @ref SetRussianRoulette(), this does bias the result.
+        ///
+        /// @param[in]      budget          Maximum number of secondary rays, or 0 for no limit.
+        ///
+        void SetSecondaryRayBudget(unsigned int budget) { secondaryRayBudget = budget; }
+
+        /// Restart the random number streams used while tracing.
+        ///
+        /// The streams normally carry on from one tile to the next, so the numbers drawn for a
+        /// particular pixel depend on which tiles the same thread happened to render before.
+        /// For high reproducibility, they can instead be restarted for each tile, keyed by a
+        /// value that only depends on the tile's position in the image.
+        ///
+        /// @param[in]      key             Value to derive the stream positions from.
+        ///
+        void SeedStreams(unsigned int key);
+
         bool TestShadow(const LightSource &light, double& depth, Ray& light_source_ray, const Vector3d& p, MathColour& colour); // TODO FIXME - this should not be exposed here
 
+        /// Variant of @ref TestShadow() looking up the shadowing in a light visibility grid.
+        /// Grid bricks not yet baked are computed by tracing shadow rays from their sample points.
+        bool TestShadow(const LightSource &light, MediaGrid& visibility, MediaGridCache& cache, double& depth, Ray& light_source_ray, const Vector3d& p, MathColour& colour); // TODO FIXME - this should not be exposed here
+
+        /// Compute the fraction of a light source's light reaching a given point, per colour channel.
+        void ComputeLightVisibility(const LightSource &light, const Vector3d& p, MathColour& visibility, TraceTicket& ticket);
+
     protected: // TODO FIXME - should be private
 
+        /// Trace a ray, optionally with its closest intersection already determined.
+        ///
+        /// @param[in]      isect           Closest intersection of the ray (with @ref Intersection::Object
+        ///                                 set to `nullptr` if nothing was hit), or `nullptr` to have it
+        ///                                 determined as part of the call.
+        ///
+        /// See @ref TraceRay() for the other parameters.
+        ///
+        double TraceRayWithIntersection(Ray& ray, MathColour& colour, ColourChannel& transm, COLC weight, bool continuedRay, DBL maxDepth,
+                                        const Intersection *isect);
+
         /// Structure used to cache reflection information for multi-layered textures.
         struct WNRX final
         {
@@ -283,6 +374,20 @@ class Trace
         typedef RefPool<WNRXVectorData> WNRXVectorPool;
         typedef Ref<WNRXVectorData, RefClearContainer<WNRXVectorData>> WNRXVector;
 
+        typedef std::vector<size_t> LightIndexVectorData;
+        typedef RefPool<LightIndexVectorData> LightIndexVectorPool;
+        typedef Ref<LightIndexVectorData, RefClearContainer<LightIndexVectorData>> LightIndexVector;
+
+        typedef RefPool<PhotonGatherer> PhotonGathererPool;
+
+        /// Deleter returning a photon gatherer to its pool rather than destroying it.
+        struct PhotonGathererRelease final
+        {
+            PhotonGathererPool *pool;
+            void operator()(PhotonGatherer *gatherer) const { pool->release(gatherer); }
+        };
+        typedef std::unique_ptr<PhotonGatherer, PhotonGathererRelease> PhotonGathererPtr;
+
         /// Structure used to cache shadow test results for complex textures.
         struct LightColorCache final
         {
@@ -311,20 +416,40 @@ class Trace
 
         /// Bounding slabs priority queue.
         BBoxPriorityQueue priorityQueue;
-        /// BSP tree mailbox.
-        BSPTree::Mailbox mailbox;
+        /// Bounding slabs stack for any-hit queries.
+        BBoxTreeStack bboxStack;
+        /// Compact bounding slabs priority queue (also used as stack for any-hit queries).
+        CompactBBoxTree::Queue compactQueue;
         /// Area light grid buffer.
         std::vector<MathColour> lightGrid;
+
+        /// Shadow test result for a single sample of a sampled area light.
+        struct AreaLightSample final
+        {
+            Vector3d    offset;     ///< Position of the sample relative to the light source's center.
+            MathColour  colour;     ///< Light arriving from the sample, not yet attenuated by distance.
+        };
+
+        /// Samples taken by the most recent call to @ref TraceAreaLightSampledShadowRay().
+        std::vector<AreaLightSample> areaLightSamples;
+        /// Light source the samples in @ref areaLightSamples belong to.
+        const LightSource *areaLightSamplesSource;
+        /// Intersection point the samples in @ref areaLightSamples belong to.
+        Vector3d areaLightSamplesPoint;
+        /// Sub-random sample positions for sampled area lights, by number of samples.
+        std::map<size_t, std::shared_ptr<std::vector<Vector2d>>> areaLightSamplePatterns;
         /// Fast stack pool.
         IStackPool stackPool;
         /// Fast texture list pool.
         TextureVectorPool texturePool;
         /// Fast WNRX list pool.
         WNRXVectorPool wnrxPool;
-        /// Light source shadow cache for shadow tests of first trace level intersections.
-        std::vector<ObjectPtr> lightSourceLevel1ShadowCache;
-        /// Light source shadow cache for shadow tests of higher trace level intersections.
-        std::vector<ObjectPtr> lightSourceOtherShadowCache;
+        /// Light source index list pool.
+        LightIndexVectorPool lightIndexPool;
+        /// Surface photon gatherer pool, sparing each shaded point the allocation of the gather buffers.
+        PhotonGathererPool photonGathererPool;
+        /// Intersection functors for @ref FindIntersections(), kept to reuse their storage.
+        std::vector<BSPIntersectCondFunctor> packetFunctors;
         /// `crand` random number generator.
         unsigned int crandRandomNumberGenerator;
         /// Pseudo-random number sequence.
@@ -337,6 +462,10 @@ class Trace
         std::vector<SequentialDoubleGeneratorPtr> ssltUniformNumberGenerator;
         /// Sub-random cos-weighted 3d points on hemisphere sequence.
         std::vector<SequentialVectorGeneratorPtr> ssltCosWeightedDirectionGenerator;
+        /// Subsurface irradiance point clouds already looked up by this thread, by interior.
+        std::map<const Interior*, std::shared_ptr<const SubsurfaceIrradianceCloud>> ssltIrradianceClouds;
+        /// Scratch buffer for subsurface irradiance samples gathered from a point cloud.
+        std::vector<SubsurfaceIrradianceSample> ssltIrradianceSamples;
         /// Thread data.
         TraceThreadData *threadData;
 
@@ -344,6 +473,13 @@ class Trace
         MediaFunctor& media;
         RadiosityFunctor& radiosity;
 
+        /// Weight below which secondary rays are subject to Russian roulette, or 0 if disabled.
+        double rouletteThreshold;
+        /// Maximum number of secondary rays per primary ray, or 0 for no limit.
+        unsigned int secondaryRayBudget;
+        /// Number of secondary rays traced for the current primary ray.
+        unsigned int secondaryRaysTraced;
+
     ///
     //*****************************************************************************
     ///
@@ -540,6 +676,34 @@ class Trace
                                 const Vector3d& normal, const Vector3d& rawnormal, const Vector3d& localnormal,
                                 MathColour& colour, ColourChannel& transm, COLC weight);
 
+        /// Compute the contribution of the refracted rays at a dispersive interface.
+        ///
+        /// The spectrum carried by the ray (or the full visible spectrum for a polychromatic ray) is
+        /// split into `elements` bands. Adjacent bands whose refracted directions differ by less than
+        /// a fraction of the pixel footprint share a single ray, which carries the combined band and
+        /// is split again at the next dispersive interface.
+        ///
+        /// @remark         The computed contribution _overwrites_ any value passed in `colour`.
+        ///
+        /// @param[in]      finish          object's finish.
+        /// @param[in]      ipoint          Intersection point.
+        /// @param[in,out]  ray             Original ray and associated information.
+        /// @param[in,out]  nray            Refracted ray [out] and associated information [in,out].
+        /// @param[in]      ior             Nominal relative index of refraction.
+        /// @param[in]      dispersion      Nominal relative dispersion.
+        /// @param[in]      elements        Number of bands to split the spectrum into.
+        /// @param[in]      n               Cosine of angle of incidence.
+        /// @param[in]      normal          Effective (possibly pertubed) surface normal.
+        /// @param[in]      rawnormal       Geometric (possibly smoothed) surface normal.
+        /// @param[in]      localnormal     Effective surface normal, possibly flipped to match ray.
+        /// @param[out]     colour          Computed colour.
+        /// @param[out]     transm          Computed transmittance.
+        /// @param[in]      weight          Importance of this computation.
+        ///
+        void TraceDispersedRefractionRays(const FINISH* finish, const Vector3d& ipoint, Ray& ray, Ray& nray, double ior, double dispersion, unsigned int elements,
+                                          double n, const Vector3d& normal, const Vector3d& rawnormal, const Vector3d& localnormal,
+                                          MathColour& colour, ColourChannel& transm, COLC weight);
+
     ///
     /// @}
     ///
@@ -553,16 +717,21 @@ class Trace
     ///
 
         /// @todo The name is misleading, as it computes all contributions of classic lighting, including highlights.
+        ///
+        /// If `highlights` is non-null, phong, specular and iridescence contributions are added to it
+        /// rather than to `colour`, so that callers can scale the diffuse part by a pigment afterwards.
+        ///
         void ComputeDiffuseLight(const FINISH *finish, const Vector3d& ipoint, const  Ray& eye, const Vector3d& layer_normal, const MathColour& layer_pigment_colour,
-                                 MathColour& colour, double attenuation, ObjectPtr object, double relativeIor);
+                                 MathColour& colour, double attenuation, ObjectPtr object, double relativeIor, MathColour *highlights = nullptr);
         /// @todo The name is misleading, as it computes all contributions of classic lighting, including highlights.
         void ComputeOneDiffuseLight(const LightSource &lightsource, const Vector3d& reye, const FINISH *finish, const Vector3d& ipoint, const Ray& eye,
-                                    const Vector3d& layer_normal, const MathColour& Layer_Pigment_Colour, MathColour& colour, double Attenuation, ConstObjectPtr Object, double relativeIor, int light_index = -1);
+                                    const Vector3d& layer_normal, const MathColour& Layer_Pigment_Colour, MathColour& colour, double Attenuation, ConstObjectPtr Object, double relativeIor, int light_index = -1,
+                                    MathColour *highlights = nullptr);
         /// @todo The name is misleading, as it computes all contributions of classic lighting, including highlights.
         void ComputeFullAreaDiffuseLight(const LightSource &lightsource, const Vector3d& reye, const FINISH *finish, const Vector3d& ipoint, const Ray& eye,
                                          const Vector3d& layer_normal, const MathColour& layer_pigment_colour, MathColour& colour, double attenuation,
                                          double lightsourcedepth, Ray& lightsourceray, const MathColour& lightcolour,
-                                         ConstObjectPtr object, double relativeIor); // JN2007: Full area lighting
+                                         ConstObjectPtr object, double relativeIor, MathColour *highlights = nullptr); // JN2007: Full area lighting
 
         /// Compute the direction, distance and unshadowed brightness of an unshadowed light source.
         ///
@@ -579,12 +748,79 @@ class Trace
         void ComputeOneLightRay(const LightSource &lightsource, double& lightsourcedepth, Ray& lightsourceray,
                                 const Vector3d& ipoint, MathColour& lightcolour, bool forceAttenuate = false);
 
+        /// Find the closest intersection with the planes of @ref SceneData::planeSet.
+        ///
+        /// This is done ahead of traversing the BSP or BVH tree, so that a plane hit limits the
+        /// distance the traversal has to consider.
+        ///
+        /// @param[in,out]  bestisect   Closest intersection found so far; replaced if a plane is closer.
+        /// @param[in]      ray         Ray to test.
+        /// @return                     `true` if a plane was hit closer than @p bestisect.
+        ///
+        bool FindPlaneIntersection(Intersection& bestisect, const Ray& ray);
+
+        /// Find the closest intersection with the planes of @ref SceneData::planeSet, subject to conditions.
+        bool FindPlaneIntersection(Intersection& bestisect, const Ray& ray, const RayObjectCondition& precondition, const RayObjectCondition& postcondition);
+
+        /// First of the infinite objects not covered by @ref SceneData::planeSet.
+        std::vector<ObjectPtr>::iterator FirstOtherInfiniteObject() const;
+
+        /// Compute the shadowing of a light source.
+        ///
+        /// The shadow ray is derived from @p lightsourceray, but starts out as a bare ray without
+        /// the interiors it is in: as long as only opaque objects (or none at all) are in the way,
+        /// its origin, direction and flags are all that matters. Only once it is found to pass
+        /// through other objects does it take over the interiors, by way of the `sourceray`
+        /// parameter of the functions below.
+        ///
         void TraceShadowRay(const LightSource &light, double depth, Ray& lightsourceray, const Vector3d& point, MathColour& colour);
-        void TracePointLightShadowRay(const LightSource &lightsource, double& lightsourcedepth, Ray& lightsourceray, MathColour& lightcolour);
+
+        /// Compute the shadowing of a point light source, or of a single point on an area light.
+        ///
+        /// @param[in]      lightsource         Light source.
+        /// @param[in,out]  lightsourcedepth    Distance to the light source.
+        /// @param[in,out]  lightsourceray      Shadow ray.
+        /// @param[in,out]  lightcolour         Unshadowed brightness on input, shadowed brightness on output.
+        /// @param[in]      sourceray           Ray whose interiors the shadow ray starts out in.
+        /// @return                             Whether the shadow ray has taken over the interiors of
+        ///                                     @p sourceray, as it does when passing through any
+        ///                                     objects that do not fully block the light.
+        ///
+        bool TracePointLightShadowRay(const LightSource &lightsource, double& lightsourcedepth, Ray& lightsourceray, MathColour& lightcolour,
+                                      const Ray& sourceray);
         void TraceAreaLightShadowRay(const LightSource &lightsource, double& lightsourcedepth, Ray& lightsourceray,
-                                     const Vector3d& ipoint, MathColour& lightcolour);
+                                     const Vector3d& ipoint, MathColour& lightcolour, const Ray& sourceray);
         void TraceAreaLightSubsetShadowRay(const LightSource &lightsource, double& lightsourcedepth, Ray& lightsourceray,
-                                           const Vector3d& ipoint, MathColour& lightcolour, int u1, int  v1, int  u2, int  v2, int level, const Vector3d& axis1, const Vector3d& axis2);
+                                           const Vector3d& ipoint, MathColour& lightcolour, int u1, int  v1, int  u2, int  v2, int level, const Vector3d& axis1, const Vector3d& axis2,
+                                           const Ray& sourceray);
+
+        /// Compute the shadowing of an area light by sampling it stochastically.
+        ///
+        /// Up to `size_1`&times;`size_2` sub-random positions on the light are tested in waves, stopping
+        /// as soon as the first wave agrees on the light being fully visible or fully blocked, or the
+        /// estimated variance of the mean drops below the light source's `variance` setting. The samples
+        /// are kept in @ref areaLightSamples so that full area lighting can shade with the very same samples.
+        ///
+        /// @param[in]      lightsource         Light source.
+        /// @param[in,out]  lightsourcedepth    Distance to the light source.
+        /// @param[in,out]  lightsourceray      Ray to the light source.
+        /// @param[in]      ipoint              Intersection point.
+        /// @param[in,out]  lightcolour         Unshadowed brightness on input, average shadowed brightness on output.
+        /// @param[in]      axis1               First axis of the (possibly oriented) light source.
+        /// @param[in]      axis2               Second axis of the (possibly oriented) light source.
+        /// @param[in]      sourceray           Ray whose interiors the shadow ray starts out in.
+        ///
+        void TraceAreaLightSampledShadowRay(const LightSource &lightsource, double& lightsourcedepth, Ray& lightsourceray,
+                                            const Vector3d& ipoint, MathColour& lightcolour, const Vector3d& axis1, const Vector3d& axis2,
+                                            const Ray& sourceray);
+
+        /// Get a pair of random values in the range [0..1) for jittering area light samples.
+        ///
+        /// While a stochastic pixel sampler is tracing a pixel sample, the values are taken from the
+        /// thread's @ref SampleSequence, so that they are well distributed over the samples of the
+        /// pixel; otherwise they are pseudo-random.
+        ///
+        Vector2d AreaLightJitter();
 
         /// Compute the filtering effect of an object on incident light from a particular light source.
         ///
@@ -770,6 +1006,8 @@ class Trace
         void ComputeFog(const Ray& ray, const Intersection& isect, MathColour& colour, ColourChannel& transm);
         double ComputeConstantFogDepth(const Ray &ray, double depth, double width, const FOG *fog);
         double ComputeGroundFogDepth(const Ray& ray, double depth, double width, const FOG *fog);
+        /// Compute the mean density of a ground fog along a ray segment starting at the ray's origin.
+        double ComputeGroundFogDensity(const Ray& ray, double width, const FOG *fog);
         void ComputeRainbow(const Ray& ray, const Intersection& isect, MathColour& colour, ColourChannel& transm);
 
         /// Compute media effect on traversing light rays.
@@ -812,11 +1050,15 @@ class Trace
         bool IsSameSSLTObject(ConstObjectPtr obj1, ConstObjectPtr obj2);
         void ComputeDiffuseSampleBase(Vector3d& basePoint, const Intersection& out, const Vector3d& vOut, double avgFreeDist, TraceTicket& ticket);
         void ComputeDiffuseSamplePoint(const Vector3d& basePoint, Intersection& in, double& sampleArea, TraceTicket& ticket);
+        double ComputeDiffuseReflectance(double distSqr, double sigma_prime_s, double sigma_a, double eta);
         void ComputeDiffuseContribution(const Intersection& out, const Vector3d& vOut, const Vector3d& pIn, const Vector3d& nIn, const Vector3d& vIn, double& sd, double sigma_prime_s, double sigma_a, double eta);
         void ComputeDiffuseContribution1(const LightSource& lightsource, const Intersection& out, const Vector3d& vOut, const Intersection& in, MathColour& Total_Colour, const PreciseMathColour& sigma_prime_s, const PreciseMathColour& sigma_a, double eta, double weight, TraceTicket& ticket);
         void ComputeDiffuseAmbientContribution1(const Intersection& out, const Vector3d& vOut, const Intersection& in, MathColour& Total_Colour, const PreciseMathColour& sigma_prime_s, const PreciseMathColour& sigma_a, double eta, double weight, TraceTicket& ticket);
         void ComputeOneSingleScatteringContribution(const LightSource& lightsource, const Intersection& out, double sigma_t_xo, double sigma_s, double s_prime_out, MathColour& Lo, double eta, const Vector3d& bend_point, double phi_out, double cos_out_prime, TraceTicket& ticket);
         void ComputeSingleScatteringContribution(const Intersection& out, double dist, double theta_out, double cos_out_prime, const Vector3d& refractedREye, double sigma_t_xo, double sigma_s, MathColour& Lo, double eta, TraceTicket& ticket);
+        void ComputeSubsurfaceIrradiance(const LightSource& lightsource, const Intersection& in, MathColour& irradiance, double eta, TraceTicket& ticket);
+        std::shared_ptr<const SubsurfaceIrradianceCloud> BuildSubsurfaceIrradianceCloud(const Intersection& out, double eta, TraceTicket& ticket);
+        const SubsurfaceIrradianceCloud *GetSubsurfaceIrradianceCloud(const Intersection& out, double eta, TraceTicket& ticket);
         void ComputeSubsurfaceScattering (const FINISH *Finish, const MathColour& layer_pigment_colour, const Intersection& isect, Ray& Eye, const Vector3d& Layer_Normal, MathColour& colour, double Attenuation);
         bool SSLTComputeRefractedDirection(const Vector3d& v, const Vector3d& n, double eta, Vector3d& refracted);
 
@@ -45,14 +45,20 @@
 #include <cstring>
 
 // C++ standard header files
+#include <functional>
 #include <vector>
 
 // POV-Ray header files (base module)
 #include <algorithm>
+#include "base/povassert.h"
 
 // POV-Ray header files (core module)
+#include "core/bounding/bvhtree.h"
+#include "core/bounding/compactbboxtree.h"
 #include "core/material/normal.h"
+#include "core/material/pattern.h"
 #include "core/material/pigment.h"
+#include "core/material/texture.h"
 #include "core/math/chi2.h"
 #include "core/math/jitter.h"
 #include "core/math/matrix.h"
@@ -60,6 +66,7 @@
 #include "core/render/trace.h"
 #include "core/scene/object.h"
 #include "core/scene/scenedata.h"
+#include "core/scene/tracethreaddata.h"
 #include "core/shape/mesh.h"
 
 // this must be the last file included
@@ -70,6 +77,7 @@ namespace pov
 
 using std::min;
 using std::max;
+using std::vector;
 
 #ifdef DYNAMIC_HASHTABLE
 extern unsigned short *hashTable; // GLOBAL VARIABLE
@@ -207,7 +215,9 @@ TracePixel::TracePixel(std::shared_ptr<SceneData> sd, const Camera* cam, TraceTh
                        sceneData(sd),
                        TracePixelCameraData(td,pt),
                        maxTraceLevel(mtl),
-                       adcBailout(adcb)
+                       adcBailout(adcb),
+                       containerCandidateCellSize(0.0),
+                       batchFoundSize(0)
 {
     for (unsigned int i = 0; i < 3; ++i)
     {
@@ -347,7 +357,20 @@ void TracePixelCameraData::SetupCamera(const Camera& cam)
     // (Possibly we could store it in the view).
     useFocalBlur = ((camera.Aperture != 0.0) && (camera.Blur_Samples > 0));
     if(useFocalBlur == true)
-        focalBlurData = new FocalBlurData(camera, threadDataC);
+        focalBlurData = new FocalBlurData(camera, threadDataC, adaptiveFocalBlur);
+}
+
+void TracePixel::SetAdaptiveFocalBlur(bool adaptive)
+{
+    if (adaptive == adaptiveFocalBlur)
+        return;
+
+    adaptiveFocalBlur = adaptive;
+    if (focalBlurData != nullptr)
+    {
+        delete focalBlurData;
+        focalBlurData = new FocalBlurData(camera, threadDataC, adaptive);
+    }
 }
 
 void TracePixel::operator()(DBL x, DBL y, DBL width, DBL height, RGBTColour& colour)
@@ -380,6 +403,202 @@ void TracePixel::operator()(DBL x, DBL y, DBL width, DBL height, RGBTColour& col
         TraceRayWithFocalBlur(colour, x, y, width, height);
 }
 
+unsigned int TracePixel::GetPacketSize() const
+{
+    // only plain cameras shooting a single ray per pixel produce rays coherent enough to benefit
+    if ((sceneData->boundingMethod != 3) || (sceneData->bvhPacketSize < 2) || useFocalBlur || (camera.Rays_Per_Pixel != 1) ||
+        ((camera.Type != PERSPECTIVE_CAMERA) && (camera.Type != ORTHOGRAPHIC_CAMERA)))
+        return 0;
+
+    return sceneData->bvhPacketSize;
+}
+
+void TracePixel::TracePacket(const Vector2d positions[], unsigned int count, DBL width, DBL height, RGBTColour colours[])
+{
+    vector<TraceTicket>& tickets = batchTickets;
+    vector<Ray>& rays = batchRays;
+    Intersection isects[BVHTree::kMaxPacketSize];
+    bool found[BVHTree::kMaxPacketSize];
+    bool valid[BVHTree::kMaxPacketSize];
+    const Ray *packet[BVHTree::kMaxPacketSize];
+    unsigned int n = 0;
+    NoSomethingFlagRayObjectCondition precond;
+    TrueRayObjectCondition postcond;
+
+    POV_ASSERT(count <= BVHTree::kMaxPacketSize);
+
+    // rays keep a reference to their ticket, so the latter must not be moved around
+    rays.clear();
+    tickets.clear();
+    tickets.reserve(count);
+    rays.reserve(count);
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        tickets.emplace_back(maxTraceLevel, adcBailout, sceneData->outputAlpha);
+        rays.emplace_back(tickets[i]);
+
+        valid[i] = CreateCameraRay(rays[i], positions[i].x(), positions[i].y(), width, height, 0, *this);
+        if (valid[i])
+        {
+            if (camera.Max_Ray_Distance >= EPSILON)
+                isects[n].Depth = camera.Max_Ray_Distance;
+            packet[n++] = &rays[i];
+        }
+    }
+
+    FindIntersections(isects, found, packet, n, precond, postcond);
+
+    for (unsigned int i = 0, j = 0; i < count; i++)
+    {
+        if (valid[i])
+        {
+            MathColour col;
+            ColourChannel transm = 0.0;
+
+            if (!found[j])
+                isects[j].Object = nullptr;
+            TraceRayWithIntersection(rays[i], col, transm, 1.0, false, camera.Max_Ray_Distance, &isects[j]);
+            colours[i] = RGBTColour(ToRGBColour(col), transm);
+            j++;
+        }
+        else
+        {
+            colours[i].Clear();
+            colours[i].transm() = 1.0;
+        }
+    }
+}
+
+bool TracePixel::CanTraceWavefront() const
+{
+    return !useFocalBlur && (camera.Rays_Per_Pixel == 1);
+}
+
+void TracePixel::TraceWavefront(const Vector2d positions[], unsigned int count, DBL width, DBL height, RGBTColour colours[])
+{
+    vector<TraceTicket>& tickets = batchTickets;
+    vector<Ray>& rays = batchRays;
+    vector<Intersection>& isects = batchIntersections;
+    vector<const Ray*>& queue = batchQueue;
+    vector<unsigned int>& rayIndex = batchRayIndex;
+    NoSomethingFlagRayObjectCondition precond;
+    TrueRayObjectCondition postcond;
+
+    if (batchFoundSize < count)
+    {
+        batchFound.reset(new bool[count]);
+        batchFoundSize = count;
+    }
+    bool *found = batchFound.get();
+
+    // rays keep a reference to their ticket, so the latter must not be moved around
+    rays.clear();
+    tickets.clear();
+    queue.clear();
+    rayIndex.clear();
+    isects.clear();
+    isects.resize(count);
+    tickets.reserve(count);
+    rays.reserve(count);
+    queue.reserve(count);
+    rayIndex.reserve(count);
+
+    // stage 1: generate the primary rays
+    for (unsigned int i = 0; i < count; i++)
+    {
+        tickets.emplace_back(maxTraceLevel, adcBailout, sceneData->outputAlpha);
+        rays.emplace_back(tickets[i]);
+
+        if (CreateCameraRay(rays[i], positions[i].x(), positions[i].y(), width, height, 0, *this))
+        {
+            if (camera.Max_Ray_Distance >= EPSILON)
+                isects[queue.size()].Depth = camera.Max_Ray_Distance;
+            rayIndex.push_back(i);
+            queue.push_back(&rays[i]);
+        }
+        else
+        {
+            colours[i].Clear();
+            colours[i].transm() = 1.0;
+        }
+    }
+
+    // stage 2: intersect them in bulk (in packets, where the bounding hierarchy supports it)
+    FindIntersections(isects.data(), found, queue.data(), (unsigned int)queue.size(), precond, postcond);
+
+    // stage 3: sort the intersections by material, keeping rays hitting nothing (i.e. the sky) together as well
+    vector<unsigned int>& slots = batchSlots;
+    slots.resize(queue.size());
+    for (unsigned int j = 0; j < slots.size(); j++)
+    {
+        if (!found[j])
+            isects[j].Object = nullptr;
+        slots[j] = j;
+    }
+    // (ties are broken by slot rather than using std::stable_sort, which would allocate a buffer each time)
+    std::sort(slots.begin(), slots.end(), [&isects](unsigned int a, unsigned int b)
+    {
+        const ObjectBase *objectA = isects[a].Object;
+        const ObjectBase *objectB = isects[b].Object;
+        const TEXTURE *textureA = (objectA != nullptr) ? objectA->Texture : nullptr;
+        const TEXTURE *textureB = (objectB != nullptr) ? objectB->Texture : nullptr;
+        if (textureA != textureB)
+            return std::less<const TEXTURE*>()(textureA, textureB);
+        if (objectA != objectB)
+            return std::less<const ObjectBase*>()(objectA, objectB);
+        return a < b;
+    });
+
+    // stage 4: shade the intersections, tracing any secondary rays as usual
+    for (unsigned int j : slots)
+    {
+        unsigned int i = rayIndex[j];
+        MathColour col;
+        ColourChannel transm = 0.0;
+
+        TraceRayWithIntersection(rays[i], col, transm, 1.0, false, camera.Max_Ray_Distance, &isects[j]);
+        colours[i] = RGBTColour(ToRGBColour(col), transm);
+    }
+}
+
+bool TracePixel::TraceFeatures(DBL x, DBL y, DBL width, DBL height, RGBColour& albedo, Vector3d& normal, DBL& depth)
+{
+    TraceTicket ticket(maxTraceLevel, adcBailout, sceneData->outputAlpha);
+    Ray ray(ticket);
+    Intersection isect;
+
+    albedo.Clear();
+    normal = Vector3d(0.0);
+    depth = -1.0;
+
+    if (CreateCameraRay(ray, x, y, width, height, 0, *this) == false)
+        return false;
+
+    if (camera.Max_Ray_Distance >= EPSILON)
+        isect.Depth = camera.Max_Ray_Distance;
+    if (FindIntersection(isect, ray) == false)
+        return false;
+
+    depth = isect.Depth;
+
+    isect.Object->Normal(normal, &isect, threadData);
+    if (dot(normal, ray.Direction) > 0.0)
+        normal.invert();
+
+    // Only the top layer of plain textures is evaluated; anything more elaborate would essentially
+    // require a full texture evaluation, so we just don't let albedo guide the filter in that case.
+    const TEXTURE *texture = isect.Object->Texture;
+    TransColour pigmentColour;
+    if ((texture != nullptr) && (texture->Type == PLAIN_PATTERN) && (texture->Pigment != nullptr) &&
+        Compute_Pigment(pigmentColour, texture->Pigment, isect.IPoint, &isect, &ray, threadData))
+        albedo = ToRGBColour(pigmentColour.colour());
+    else
+        albedo = RGBColour(1.0);
+
+    return true;
+}
+
 bool TracePixelCameraData::CreateCameraRay(Ray& ray, DBL x, DBL y, DBL width, DBL height, size_t ray_number, TracePixel& parent)
 {
     DBL x0 = 0.0, y0 = 0.0;
@@ -1107,7 +1326,7 @@ bool TracePixelCameraData::CreateCameraRay(Ray& ray, DBL x, DBL y, DBL width, DB
                     return false;
 
                 // set the ray origin to the centriod of the triangle.
-                const Mesh_Triangle_Struct& tr = mesh->Data->Triangles[faceIndex];
+                const Mesh_Triangle_Struct tr = mesh->Data->Get_Triangle(faceIndex);
                 ray.Origin = Vector3d(mesh->Data->Vertices[tr.P1] + mesh->Data->Vertices[tr.P2] + mesh->Data->Vertices[tr.P3]) / 3;
 
                 // set the ray direction according to the normal of the face
@@ -1161,7 +1380,7 @@ bool TracePixelCameraData::CreateCameraRay(Ray& ray, DBL x, DBL y, DBL width, DB
                     {
                         faceIndex -= lastOffset;
                         const Mesh *mesh = static_cast<const Mesh *>(camera.Meshes[meshNo]);
-                        Mesh_Triangle_Struct& tr = mesh->Data->Triangles[faceIndex];
+                        const Mesh_Triangle_Struct tr = mesh->Data->Get_Triangle(faceIndex);
 
                         // see comments for distribution method 0
                         ray.Origin = Vector3d(mesh->Data->Vertices[tr.P1] + mesh->Data->Vertices[tr.P2] + mesh->Data->Vertices[tr.P3]) / 3;
@@ -1198,7 +1417,7 @@ bool TracePixelCameraData::CreateCameraRay(Ray& ray, DBL x, DBL y, DBL width, DB
                     return false;
 
                 // see comments for distribution method 0
-                Mesh_Triangle_Struct& tr = mesh->Data->Triangles[faceIndex];
+                const Mesh_Triangle_Struct tr = mesh->Data->Get_Triangle(faceIndex);
                 ray.Origin = Vector3d(mesh->Data->Vertices[tr.P1] + mesh->Data->Vertices[tr.P2] + mesh->Data->Vertices[tr.P3]) / 3;
                 ray.Direction = Vector3d(mesh->Data->Normals[tr.Normal_Ind]);
                 ray.Origin = ray.Evaluate(camera.Location[Z]);
@@ -1243,7 +1462,8 @@ bool TracePixelCameraData::CreateCameraRay(Ray& ray, DBL x, DBL y, DBL width, DB
                         {
                             if ((intersection & mask) != 0)
                             {
-                                const Mesh_Triangle_Struct *tr(mesh->Data->Triangles + idx * 32 + bit);
+                                const Mesh_Triangle_Struct triangle(mesh->Data->Get_Triangle(idx * 32 + bit));
+                                const Mesh_Triangle_Struct *tr(&triangle);
                                 const double& P1u(mesh->Data->UVCoords[tr->UV1][U]);
                                 const double& P2u(mesh->Data->UVCoords[tr->UV2][U]);
                                 const double& P3u(mesh->Data->UVCoords[tr->UV3][U]);
@@ -1319,343 +1539,32 @@ bool TracePixelCameraData::CreateCameraRay(Ray& ray, DBL x, DBL y, DBL width, DB
             break;
 
         case PROJ_TETRA_CAMERA:
-            // Convert the x coordinate to be a DBL from 0.0 to 1.0
-            x0 = x / width ;
-
-            // Convert the y coordinate to be a DBL from 0.0 to 1.0
-            y0 = y / height ;
-
-            if (!ProjectionTetraCameraRay(ray,x0,y0))
-                return false;
-
-            if(useFocalBlur)
-                JitterCameraRay(ray, x, y, ray_number);
-
-            parent.InitRayContainerState(ray,useFocalBlur);
-            break;
-
         case PROJ_CUBE_CAMERA:
-            // Convert the x coordinate to be a DBL from 0.0 to 1.0
-            x0 = x / width ;
-
-            // Convert the y coordinate to be a DBL from 0.0 to 1.0
-            y0 = y / height ;
-
-            if (!ProjectionCubeCameraRay(ray,x0,y0))
-                return false;
-
-            if(useFocalBlur)
-                JitterCameraRay(ray, x, y, ray_number);
-
-            parent.InitRayContainerState(ray,useFocalBlur);
-            break;
-
         case PROJ_OCTA_CAMERA:
-            // Convert the x coordinate to be a DBL from 0.0 to 1.0
-            x0 = x / width ;
-
-            // Convert the y coordinate to be a DBL from 0.0 to 1.0
-            y0 = y / height ;
-
-            if (!ProjectionOctaCameraRay(ray,x0,y0))
-                return false;
-
-            if(useFocalBlur)
-                JitterCameraRay(ray, x, y, ray_number);
-
-            parent.InitRayContainerState(ray,useFocalBlur);
-            break;
-
         case PROJ_ICOSA_CAMERA:
-            // Convert the x coordinate to be a DBL from 0.0 to 1.0
-            x0 = x / width ;
-
-            // Convert the y coordinate to be a DBL from 0.0 to 1.0
-            y0 = y / height ;
-
-            if (!ProjectionIcosaCameraRay(ray,x0,y0))
-                return false;
-
-            if(useFocalBlur)
-                JitterCameraRay(ray, x, y, ray_number);
-
-            parent.InitRayContainerState(ray,useFocalBlur);
-            break;
-
         case PROJ_PLATECARREE_CAMERA:
-            // Convert the x coordinate to be a DBL from 0.0 to 1.0
-            x0 = x / width ;
-
-            // Convert the y coordinate to be a DBL from 0.0 to 1.0
-            y0 = ((height - 1) - y) / height ;
-
-            if (!ProjectionPlateCarreeCameraRay(ray,x0,y0))
-                return false;
-
-            if(useFocalBlur)
-                JitterCameraRay(ray, x, y, ray_number);
-
-            parent.InitRayContainerState(ray,useFocalBlur);
-            break;
-
         case PROJ_MERCATOR_CAMERA:
-            // Convert the x coordinate to be a DBL from 0.0 to 1.0
-            x0 = x / width ;
-
-            // Convert the y coordinate to be a DBL from 0.0 to 1.0
-            y0 = ((height - 1) - y) / height ;
-
-            if (!ProjectionMercatorCameraRay(ray,x0,y0))
-                return false;
-
-            if(useFocalBlur)
-                JitterCameraRay(ray, x, y, ray_number);
-
-            parent.InitRayContainerState(ray,useFocalBlur);
-            break;
-
         case PROJ_LAMBERT_AZI_CAMERA:
-            // Convert the x coordinate to be a DBL from -2.0 to 2.0
-            x0 = 4.0*(x / width)-2.0 ;
-
-            // Convert the y coordinate to be a DBL from -2.0 to 2.0
-            y0 = 4.0*(((height - 1) - y) / height) -2.0 ;
-
-            if (!ProjectionLambertAzimuthalCameraRay(ray,x0,y0))
-                return false;
-
-            if(useFocalBlur)
-                JitterCameraRay(ray, x, y, ray_number);
-
-            parent.InitRayContainerState(ray,useFocalBlur);
-            break;
-
-
         case PROJ_LAMBERT_CYL_CAMERA:
-            cx = 1.0 ; 
-            // Convert the x coordinate to be a DBL from -1.0 to 1.0
-            x0 = 2.0*(x / width)-1.0 ;
-
-            // Convert the y coordinate to be a DBL from -1.0 to 1.0
-            y0 = 2.0*(((height - 1) - y) / height) -1.0 ;
-
-            if (!ProjectionEqualAreaCameraRay(ray,x0,y0,cx))
-                return false;
-
-            if(useFocalBlur)
-                JitterCameraRay(ray, x, y, ray_number);
-
-            parent.InitRayContainerState(ray,useFocalBlur);
-            break;
-
         case PROJ_BEHRMANN_CAMERA:
-            cx = cos(30.0 * M_PI_180 );
-            // Convert the x coordinate to be a DBL from -1.0 to 1.0
-            x0 = 2.0*(x / width)-1.0 ;
-
-            // Convert the y coordinate to be a DBL from -1.0 to 1.0
-            y0 = 2.0*(((height - 1) - y) / height) -1.0 ;
-
-            if (!ProjectionEqualAreaCameraRay(ray,x0,y0,cx))
-                return false;
-
-            if(useFocalBlur)
-                JitterCameraRay(ray, x, y, ray_number);
-
-            parent.InitRayContainerState(ray,useFocalBlur);
-            break;
-
         case PROJ_CRASTER_CAMERA: /* 37°04' , 37*60= 2220 */
-            cx = cos(2224.0/60.0 * M_PI_180 );
-            // Convert the x coordinate to be a DBL from -1.0 to 1.0
-            x0 = 2.0*(x / width)-1.0 ;
-
-            // Convert the y coordinate to be a DBL from -1.0 to 1.0
-            y0 = 2.0*(((height - 1) - y) / height) -1.0 ;
-
-            if (!ProjectionEqualAreaCameraRay(ray,x0,y0,cx))
-                return false;
-
-            if(useFocalBlur)
-                JitterCameraRay(ray, x, y, ray_number);
-
-            parent.InitRayContainerState(ray,useFocalBlur);
-            break;
-
         case PROJ_EDWARDS_CAMERA: /* 37°24' */
-            cx = cos(37.4 * M_PI_180 );
-            // Convert the x coordinate to be a DBL from -1.0 to 1.0
-            x0 = 2.0*(x / width)-1.0 ;
-
-            // Convert the y coordinate to be a DBL from -1.0 to 1.0
-            y0 = 2.0*(((height - 1) - y) / height) -1.0 ;
-
-            if (!ProjectionEqualAreaCameraRay(ray,x0,y0,cx))
-                return false;
-
-            if(useFocalBlur)
-                JitterCameraRay(ray, x, y, ray_number);
-
-            parent.InitRayContainerState(ray,useFocalBlur);
-            break;
-
         case PROJ_HOBO_DYER_CAMERA: /* 37°30' */
-            cx = cos(37.5 * M_PI_180 );
-            // Convert the x coordinate to be a DBL from -1.0 to 1.0
-            x0 = 2.0*(x / width)-1.0 ;
-
-            // Convert the y coordinate to be a DBL from -1.0 to 1.0
-            y0 = 2.0*(((height - 1) - y) / height) -1.0 ;
-
-            if (!ProjectionEqualAreaCameraRay(ray,x0,y0,cx))
-                return false;
-
-            if(useFocalBlur)
-                JitterCameraRay(ray, x, y, ray_number);
-
-            parent.InitRayContainerState(ray,useFocalBlur);
-            break;
-
         case PROJ_PETERS_CAMERA:
-            cx = cos(44.138 * M_PI_180 );
-            // Convert the x coordinate to be a DBL from -1.0 to 1.0
-            x0 = 2.0*(x / width)-1.0 ;
-
-            // Convert the y coordinate to be a DBL from -1.0 to 1.0
-            y0 = 2.0*(((height - 1) - y) / height) -1.0 ;
-
-            if (!ProjectionEqualAreaCameraRay(ray,x0,y0,cx))
-                return false;
-
-            if(useFocalBlur)
-                JitterCameraRay(ray, x, y, ray_number);
-
-            parent.InitRayContainerState(ray,useFocalBlur);
-            break;
-
         case PROJ_GALL_CAMERA:
-            cx = cos(45.0 * M_PI_180 );
-            // Convert the x coordinate to be a DBL from -1.0 to 1.0
-            x0 = 2.0*(x / width)-1.0 ;
-
-            // Convert the y coordinate to be a DBL from -1.0 to 1.0
-            y0 = 2.0*(((height - 1) - y) / height) -1.0 ;
-
-            if (!ProjectionEqualAreaCameraRay(ray,x0,y0,cx))
-                return false;
-
-            if(useFocalBlur)
-                JitterCameraRay(ray, x, y, ray_number);
-
-            parent.InitRayContainerState(ray,useFocalBlur);
-            break;
-
         case PROJ_BALTHASART_CAMERA:
-            cx = cos(50.0 * M_PI_180 );
-            // Convert the x coordinate to be a DBL from -1.0 to 1.0
-            x0 = 2.0*(x / width)-1.0 ;
-
-            // Convert the y coordinate to be a DBL from -1.0 to 1.0
-            y0 = 2.0*(((height - 1) - y) / height) -1.0 ;
-
-            if (!ProjectionEqualAreaCameraRay(ray,x0,y0,cx))
-                return false;
-
-            if(useFocalBlur)
-                JitterCameraRay(ray, x, y, ray_number);
-
-            parent.InitRayContainerState(ray,useFocalBlur);
-            break;
-
-
         case PROJ_VAN_DER_GRINTEN_CAMERA:
-            // Convert the x coordinate to be a DBL from -1.0 to 1.0
-            x0 = 2.0*(x / width)-1.0 ;
-
-            // Convert the y coordinate to be a DBL from -1.0 to 1.0
-            y0 = 2.0*(((height - 1) - y) / height) -1.0 ;
-
-            if (!ProjectionVanDerGrintenCameraRay(ray,x0,y0))
-                return false;
-
-            if(useFocalBlur)
-                JitterCameraRay(ray, x, y, ray_number);
-
-            parent.InitRayContainerState(ray,useFocalBlur);
-            break;
-
         case PROJ_MOLLWEIDE_CAMERA:
-            // Convert the x coordinate to be a DBL from -1.0 to 1.0
-            x0 = 2.0*(x / width)-1.0 ;
-
-            // Convert the y coordinate to be a DBL from -1.0 to 1.0
-            y0 = 2.0*(((height - 1) - y) / height) -1.0 ;
-
-            if (!ProjectionMollweideCameraRay(ray,x0,y0))
-                return false;
-
-            if(useFocalBlur)
-                JitterCameraRay(ray, x, y, ray_number);
-
-            parent.InitRayContainerState(ray,useFocalBlur);
-            break;
-
         case PROJ_AITOFF_CAMERA:
-            // Convert the x coordinate to be a DBL from -1.0 to 1.0
-            x0 = 2.0*(x / width)-1.0 ;
-
-            // Convert the y coordinate to be a DBL from -1.0 to 1.0
-            y0 = 2.0*(((height - 1) - y) / height) -1.0 ;
-
-            if (!ProjectionAitoffHammerCameraRay(ray,x0,y0))
-                return false;
-
-            if(useFocalBlur)
-                JitterCameraRay(ray, x, y, ray_number);
-
-            parent.InitRayContainerState(ray,useFocalBlur);
-            break;
-
         case PROJ_ECKERT4_CAMERA:
-            // Convert the x coordinate to be a DBL from -1.0 to 1.0
-            x0 = 2.0*(x / width)-1.0 ;
-
-            // Convert the y coordinate to be a DBL from -1.0 to 1.0
-            y0 = 2.0*(((height - 1) - y) / height) -1.0 ;
-
-            if (!ProjectionEckert4CameraRay(ray,x0,y0))
-                return false;
-
-            if(useFocalBlur)
-                JitterCameraRay(ray, x, y, ray_number);
-
-            parent.InitRayContainerState(ray,useFocalBlur);
-            break;
-
         case PROJ_ECKERT6_CAMERA:
-            // Convert the x coordinate to be a DBL from -1.0 to 1.0
-            x0 = 2.0*(x / width)-1.0 ;
-
-            // Convert the y coordinate to be a DBL from -1.0 to 1.0
-            y0 = 2.0*(((height - 1) - y) / height) -1.0 ;
-
-            if (!ProjectionEckert6CameraRay(ray,x0,y0))
-                return false;
-
-            if(useFocalBlur)
-                JitterCameraRay(ray, x, y, ray_number);
-
-            parent.InitRayContainerState(ray,useFocalBlur);
-            break;
-
         case PROJ_MILLER_CAMERA:
-            // Convert the x coordinate to be a DBL from -1.0 to 1.0
-            x0 = 2.0*(x / width)-1.0 ;
-
-            // Convert the y coordinate to be a DBL from -1.0 to 1.0
-            y0 = 2.0*(((height - 1) - y) / height) -1.0 ;
-
-            if (!ProjectionMillerCameraRay(ray,x0,y0))
+            if (projectionTable != nullptr)
+            {
+                if (!projectionTable->GetRay(*this, ray, x, y, width, height))
+                    return false;
+            }
+            else if (!ProjectionCameraRay(ray, x, y, width, height))
                 return false;
 
             if(useFocalBlur)
@@ -1687,20 +1596,42 @@ void TracePixel::InitRayContainerState(Ray& ray, bool compute)
         precomputeContainingInteriors = false;
         containingInteriors.clear();
 
-        if(sceneData->boundingMethod == 2)
+        // Origins of focal blur rays are scattered across the aperture, but all lie near the
+        // camera location, so only a few objects need to be considered at all.
+        const std::vector<ObjectPtr> *candidates = ((compute == true) && useFocalBlur) ? GetContainerCandidates(ray.Origin) : nullptr;
+
+        if (candidates != nullptr)
+        {
+            for (std::vector<ObjectPtr>::const_iterator object = candidates->begin(); object != candidates->end(); object++)
+                if (Inside_BBox(ray.Origin, (*object)->BBox) && (*object)->Inside(ray.Origin, threadDataC))
+                    containingInteriors.push_back((*object)->interior.get());
+        }
+        else if((sceneData->boundingMethod == 2) || (sceneData->boundingMethod == 3))
         {
             HasInteriorPointObjectCondition precond;
             ContainingInteriorsPointObjectCondition postcond(containingInteriors);
             BSPInsideCondFunctor ifn(ray.Origin, sceneData->objects, threadDataC, precond, postcond);
 
-            mailbox.clear();
-            (*sceneData->tree)(ray.Origin, ifn, mailbox);
+            if(sceneData->boundingMethod == 3)
+                (*sceneData->bvhTree)(ray.Origin, ifn);
+            else
+            {
+                threadData->GetMailbox().clear();
+                (*sceneData->tree)(ray.Origin, ifn, threadData->GetMailbox());
+            }
 
             // test infinite objects
             for(std::vector<ObjectPtr>::iterator object = sceneData->objects.begin() + sceneData->numberOfFiniteObjects; object != sceneData->objects.end(); object++)
                 if (((*object)->interior != nullptr) && Inside_BBox(ray.Origin, (*object)->BBox) && (*object)->Inside(ray.Origin, threadDataC))
                     containingInteriors.push_back((*object)->interior.get());
         }
+        else if ((sceneData->boundingMethod == 1) && (sceneData->compactSlabs != nullptr))
+        {
+            HasInteriorPointObjectCondition precond;
+            ContainingInteriorsPointObjectCondition postcond(containingInteriors);
+
+            sceneData->compactSlabs->FindInside(ray.Origin, precond, postcond, false, threadDataC);
+        }
         else if ((sceneData->boundingMethod == 0) || (sceneData->boundingSlabs == nullptr))
         {
             for(std::vector<ObjectPtr>::iterator object = sceneData->objects.begin(); object != sceneData->objects.end(); object++)
@@ -1716,6 +1647,57 @@ void TracePixel::InitRayContainerState(Ray& ray, bool compute)
     ray.AppendInteriors(containingInteriors);
 }
 
+const std::vector<ObjectPtr> *TracePixel::GetContainerCandidates(const Vector3d& point)
+{
+    if (containerCandidateCellSize <= 0.0)
+    {
+        if (camera.Aperture <= 0.0)
+            return nullptr;
+        // Cells the size of the aperture, so that a handful of them cover all ray origins.
+        containerCandidateCellSize = camera.Aperture;
+    }
+
+    const DBL size = containerCandidateCellSize;
+    Vector3d cell(floor(point.x() / size), floor(point.y() / size), floor(point.z() / size));
+    if ((fabs(cell.x()) > 1.0e9) || (fabs(cell.y()) > 1.0e9) || (fabs(cell.z()) > 1.0e9))
+        return nullptr;
+
+    long x = long(cell.x());
+    long y = long(cell.y());
+    long z = long(cell.z());
+
+    for (std::vector<ContainerCandidateCell>::const_iterator i = containerCandidateCells.begin(); i != containerCandidateCells.end(); i++)
+        if ((i->x == x) && (i->y == y) && (i->z == z))
+            return &i->objects;
+
+    if (containerCandidateCells.size() >= kMaxContainerCandidateCells)
+        return nullptr;
+
+    containerCandidateCells.push_back(ContainerCandidateCell());
+    ContainerCandidateCell& entry = containerCandidateCells.back();
+    entry.x = x;
+    entry.y = y;
+    entry.z = z;
+
+    // Cell bounds, generously padded to be robust against rounding.
+    Vector3d lo = cell * size - Vector3d(size * 0.01);
+    Vector3d hi = (cell + Vector3d(1.0)) * size + Vector3d(size * 0.01);
+
+    for (std::vector<ObjectPtr>::const_iterator object = sceneData->objects.begin(); object != sceneData->objects.end(); object++)
+    {
+        if ((*object)->interior == nullptr)
+            continue;
+
+        Vector3d bmin, bmax;
+        Make_min_max_from_BBox(bmin, bmax, (*object)->BBox);
+        if ((bmin.x() <= hi.x()) && (bmin.y() <= hi.y()) && (bmin.z() <= hi.z()) &&
+            (bmax.x() >= lo.x()) && (bmax.y() >= lo.y()) && (bmax.z() >= lo.z()))
+            entry.objects.push_back(*object);
+    }
+
+    return &entry.objects;
+}
+
 /*****************************************************************************
 *
 * METHOD
@@ -1769,6 +1751,14 @@ void TracePixel::TraceRayWithFocalBlur(RGBTColour& colour, DBL x, DBL y, DBL wid
     DBL dx, dy, n, randx, randy;
     RGBTColour C, V1, S1, S2;
     int seed = int((x-0.5) * 313.0 + 11.0) + int((y-0.5) * 311.0 + 17.0);
+    int samples = camera.Blur_Samples;
+    int minSamples = camera.Blur_Samples_Min;
+
+    if (adaptiveFocalBlur && (camera.Type == PERSPECTIVE_CAMERA))
+    {
+        samples = EstimateFocalBlurSamples(x, y, width, height);
+        minSamples = min(minSamples, samples);
+    }
 
     TraceTicket ticket(maxTraceLevel, adcBailout, sceneData->outputAlpha);
     Ray ray(ticket);
@@ -1795,7 +1785,7 @@ void TracePixel::TraceRayWithFocalBlur(RGBTColour& colour, DBL x, DBL y, DBL wid
             }
         }
 
-        for(i = 0; (i < max_s) && (nr < camera.Blur_Samples); i++)
+        for(i = 0; (i < max_s) && (nr < samples); i++)
         {
             // Choose sub-pixel location.
             dxi = PseudoRandom(seed + nr) % SUB_PIXEL_GRID_SIZE;
@@ -1847,15 +1837,66 @@ void TracePixel::TraceRayWithFocalBlur(RGBTColour& colour, DBL x, DBL y, DBL wid
 
         // Exit if samples are likely too be good enough.
 
-        if((nr >= camera.Blur_Samples_Min) &&
+        if((nr >= minSamples) &&
            (V1.IsNearZero(focalBlurData->Sample_Threshold[nr - 1])))
             break;
     }
-    while(nr < camera.Blur_Samples);
+    while(nr < samples);
 
     colour /= (DBL)nr;
 }
 
+int TracePixel::EstimateFocalBlurSamples(DBL x, DBL y, DBL width, DBL height)
+{
+    // Aperture positions to probe, in units of the aperture diameter.
+    static const DBL kProbes[5][2] = { { 0.0, 0.0 }, { 0.5, 0.0 }, { -0.5, 0.0 }, { 0.0, 0.5 }, { 0.0, -0.5 } };
+
+    TraceTicket ticket(maxTraceLevel, adcBailout, sceneData->outputAlpha);
+    Ray centre(ticket);
+
+    // Get the ray through the centre of the aperture.
+    useFocalBlur = false;
+    bool valid = CreateCameraRay(centre, x, y, width, height, 0, *this);
+    useFocalBlur = true;
+    if (!valid)
+        return camera.Blur_Samples;
+
+    Vector3d axis = cameraDirection.normalized();
+    DBL axial = dot(centre.Direction, axis);
+    if (axial <= EPSILON)
+        return camera.Blur_Samples;
+
+    // Point on the plane in focus, and size of a pixel there.
+    DBL focus = camera.Focal_Distance;
+    Vector3d focalPoint = centre.Origin + centre.Direction * (focus / axial);
+    DBL pixelSize = focus * cameraLengthRight / (cameraLengthDirection * width);
+    DBL radius = camera.Aperture * 0.5;
+    DBL maxCoC = 0.0;
+
+    for (int i = 0; i < 5; i++)
+    {
+        Vector3d deflection = focalBlurData->XPerp * (camera.Aperture * kProbes[i][0]) -
+                              focalBlurData->YPerp * (camera.Aperture * kProbes[i][1]);
+        Ray probe(ticket, centre.Origin + deflection, (focalPoint - centre.Origin - deflection).normalized());
+        Intersection isect;
+        DBL coc = radius; // for rays escaping to infinity
+
+        if (FindIntersection(isect, probe))
+        {
+            DBL depth = dot(isect.IPoint - centre.Origin, axis);
+            coc = (depth > EPSILON) ? radius * fabs(depth - focus) / depth : radius;
+        }
+
+        maxCoC = max(maxCoC, coc);
+    }
+
+    // One sample per square pixel covered by the circle of confusion.
+    DBL area = M_PI * Sqr(maxCoC / pixelSize);
+    if (!(area < camera.Blur_Samples))
+        return camera.Blur_Samples;
+    return max(1, int(ceil(area)));
+}
+
 void TracePixelCameraData::JitterCameraRay(Ray& ray, DBL x, DBL y, size_t ray_number)
 {
     DBL xjit, yjit, xlen, ylen, r;
@@ -1890,7 +1931,7 @@ void TracePixelCameraData::JitterCameraRay(Ray& ray, DBL x, DBL y, size_t ray_nu
     ray.Direction.normalize();
 }
 
-TracePixel::FocalBlurData::FocalBlurData(const Camera& camera, TraceThreadData* threadData)
+TracePixel::FocalBlurData::FocalBlurData(const Camera& camera, TraceThreadData* threadData, bool adaptive)
 {
     // Create list of thresholds for confidence test.
     Sample_Threshold = new DBL[camera.Blur_Samples];
@@ -1942,6 +1983,17 @@ TracePixel::FocalBlurData::FocalBlurData(const Camera& camera, TraceThreadData*
 
         // TODO - generate a warning if weightMax > 1.0, or weightAvg particularly low
     }
+    else if (adaptive)
+    {
+        // Any number of leading samples of a low-discrepancy sequence is evenly spread across the
+        // aperture, as needed when the number of samples varies from pixel to pixel.
+        Current_Number_Of_Samples = nullptr;
+        Max_Jitter = 0.5 / sqrt((DBL)camera.Blur_Samples);
+
+        SequentialVector2dGeneratorPtr vgen(GetSubRandomOnDiscGenerator(0, 0.5, camera.Blur_Samples));
+        for (int i = 0; i < camera.Blur_Samples; i++)
+            Sample_Grid[i] = (*vgen)();
+    }
     else
     {
 
@@ -43,7 +43,9 @@
 //  (none at the moment)
 
 // C++ standard header files
+#include <atomic>
 #include <memory>
+#include <vector>
 
 // POV-Ray header files (base module)
 //  (none at the moment)
@@ -75,16 +77,84 @@ struct ContainingInteriorsPointObjectCondition final : public PointObjectConditi
     RayInteriorVector &containingInteriors;
 };
 
+class TracePixelCameraData;
+
+/// Table of primary rays for the map projection cameras, filled on demand and shared by all
+/// render threads of a view.
+///
+/// Rays are computed exactly at the nodes of a grid spaced a fixed number of pixels apart, and
+/// interpolated bilinearly in between. Before a cell of the grid is first used, the interpolated
+/// rays at its centre and edge midpoints are checked against exact ones; cells failing the check
+/// (e.g. where a face of a polyhedral projection ends, or at the rim of a map) are computed
+/// exactly for every ray.
+///
+class ProjectionTable final
+{
+    public:
+
+        /// @param  w       Width of the image in pixels.
+        /// @param  h       Height of the image in pixels.
+        /// @param  s       Spacing of the grid nodes in pixels.
+        ProjectionTable(unsigned int w, unsigned int h, unsigned int s);
+
+        /// Compute the origin and direction of the primary ray through a point of the image.
+        /// @param[in]      camera  Camera to compute exact rays with.
+        /// @param[in,out]  ray     Ray to set up.
+        /// @param[in]      x       X-coordinate of the point (see @ref TracePixel::operator()()).
+        /// @param[in]      y       Y-coordinate of the point (see @ref TracePixel::operator()()).
+        /// @param[in]      width   Horizontal size of the image in pixels.
+        /// @param[in]      height  Vertical size of the image in pixels.
+        /// @return                 `false` if no ray passes through the point.
+        bool GetRay(TracePixelCameraData& camera, Ray& ray, DBL x, DBL y, DBL width, DBL height);
+
+    private:
+
+        struct Node final
+        {
+            Vector3d origin;
+            Vector3d direction;
+        };
+
+        /// State of a node or cell.
+        enum State : unsigned char
+        {
+            kUnknown,   ///< Not computed yet.
+            kBusy,      ///< Being computed by some thread.
+            kValid,     ///< Node holds a ray, or cell may be interpolated.
+            kInvalid,   ///< Node has no ray, or cell must be computed exactly.
+        };
+
+        /// Maximum deviation of an interpolated ray, relative to the length of the ray direction.
+        static constexpr DBL kTolerance = 1.0e-6;
+
+        unsigned int imageWidth;
+        unsigned int imageHeight;
+        unsigned int spacing;
+        unsigned int nodesX;
+        unsigned int nodesY;
+        std::vector<Node> nodes;
+        std::unique_ptr<std::atomic<unsigned char>[]> nodeState;
+        std::unique_ptr<std::atomic<unsigned char>[]> cellState;
+
+        State GetNode(TracePixelCameraData& camera, Ray& ray, unsigned int i, unsigned int j, DBL width, DBL height);
+        State ValidateCell(TracePixelCameraData& camera, Ray& ray, unsigned int i, unsigned int j, DBL width, DBL height);
+        void Interpolate(unsigned int i, unsigned int j, DBL u, DBL v, Vector3d& origin, Vector3d& direction) const;
+
+        ProjectionTable() = delete;
+        ProjectionTable(const ProjectionTable&) = delete;
+        ProjectionTable& operator=(const ProjectionTable&) = delete;
+};
+
 class TracePixel;
 class TracePixelCameraData
 {
     public:
-        TracePixelCameraData(TraceThreadData *td, bool pt):focalBlurData(nullptr),threadDataC(td),precomputeContainingInteriors(pt){}
+        TracePixelCameraData(TraceThreadData *td, bool pt):focalBlurData(nullptr),adaptiveFocalBlur(false),threadDataC(td),precomputeContainingInteriors(pt){}
         // Focal blur data
         class FocalBlurData final
         {
             public:
-                FocalBlurData(const Camera& camera, TraceThreadData* threadData);
+                FocalBlurData(const Camera& camera, TraceThreadData* threadData, bool adaptive = false);
                 ~FocalBlurData();
 
                 // Direction to focal plane. 
@@ -104,6 +174,8 @@ class TracePixelCameraData
 
         bool useFocalBlur;
         FocalBlurData *focalBlurData;
+        /// Whether to adapt the number of focal blur samples to the circle of confusion.
+        bool adaptiveFocalBlur;
 
         Vector3d cameraDirection;
         Vector3d cameraRight;
@@ -123,6 +195,8 @@ class TracePixelCameraData
         Camera camera;
         /// whether this is just a pretrace, allowing some computations to be skipped
         bool precomputeContainingInteriors;
+        /// table of primary rays shared by all render threads, or `nullptr` if rays are always computed exactly
+        std::shared_ptr<ProjectionTable> projectionTable;
         /// Thread-local instances of user-defined camera functions
         GenericScalarFunctionInstancePtr mpCameraLocationFn[3];
         GenericScalarFunctionInstancePtr mpCameraDirectionFn[3];
@@ -130,6 +204,11 @@ class TracePixelCameraData
         bool CreateCameraRay(Ray& ray, DBL x, DBL y, DBL width, DBL height, size_t ray_number, TracePixel& p);
         void JitterCameraRay(Ray& ray, DBL x, DBL y, size_t ray_number);
 
+        /// Determine whether a camera type is one of the map projections handled by @ref ProjectionCameraRay().
+        static bool IsProjectionCamera(int type);
+        /// Compute the primary ray of a map projection camera exactly.
+        bool ProjectionCameraRay(Ray& ray, DBL x, DBL y, DBL width, DBL height);
+
         // Additional map projection camera in tracepixel_*.cpp
         bool ProjectionTetraCameraRay(Ray& ray, DBL x,DBL y);
         bool ProjectionCubeCameraRay(Ray& ray, DBL x,DBL y);
@@ -178,7 +257,62 @@ class TracePixel final : public Trace,
         /// @param[in]  height  Vertical size of the image in pixels.
         /// @param[out] colour  Computed colour of the (sub-)pixel.
         void operator()(DBL x, DBL y, DBL width, DBL height, RGBTColour& colour);
+
+        /// Get the number of pixels to trace per call to @ref TracePacket().
+        /// @return             Packet size, or 0 if packet tracing is not supported for the current
+        ///                     scene and camera settings.
+        unsigned int GetPacketSize() const;
+
+        /// Trace a group of nearby pixels, determining the primary rays' intersections in a single
+        /// pass through the bounding hierarchy.
+        /// @note   Only valid if @ref GetPacketSize() returns non-zero.
+        /// @param[in]  positions   Coordinates of the pixels' centers (see @ref operator()()).
+        /// @param[in]  count       Number of pixels, at most the value returned by @ref GetPacketSize().
+        /// @param[in]  width       Horizontal size of the image in pixels.
+        /// @param[in]  height      Vertical size of the image in pixels.
+        /// @param[out] colours     Computed colour of each pixel.
+        void TracePacket(const Vector2d positions[], unsigned int count, DBL width, DBL height, RGBTColour colours[]);
+
+        /// Determine whether @ref TraceWavefront() can be used for the current camera settings.
+        /// @return             True if each pixel is traced with a single primary ray.
+        bool CanTraceWavefront() const;
+
+        /// Trace a block of pixels in stages: First all primary rays are generated, then their
+        /// intersections are determined in packets, and finally the intersections are shaded
+        /// sorted by material, so that consecutive shading work shares textures and objects.
+        /// Secondary rays are still traced recursively while shading.
+        /// @note   Only valid if @ref CanTraceWavefront() returns true.
+        /// @param[in]  positions   Coordinates of the pixels' centers (see @ref operator()()),
+        ///                         ideally ordered such that consecutive rays are coherent.
+        /// @param[in]  count       Number of pixels.
+        /// @param[in]  width       Horizontal size of the image in pixels.
+        /// @param[in]  height      Vertical size of the image in pixels.
+        /// @param[out] colours     Computed colour of each pixel.
+        void TraceWavefront(const Vector2d positions[], unsigned int count, DBL width, DBL height, RGBTColour colours[]);
+
+        /// Determine auxiliary features of a pixel for guiding a denoising filter.
+        /// Only the first intersection of a single primary ray through the pixel's center is considered.
+        /// @param[in]  x       X-coordinate of the pixel's center (see @ref operator()()).
+        /// @param[in]  y       Y-coordinate of the pixel's center (see @ref operator()()).
+        /// @param[in]  width   Horizontal size of the image in pixels.
+        /// @param[in]  height  Vertical size of the image in pixels.
+        /// @param[out] albedo  Pigment colour of the surface hit, or white if it cannot be determined easily.
+        /// @param[out] normal  Surface normal, facing the camera.
+        /// @param[out] depth   Distance from the camera.
+        /// @return             `true` if the ray hit an object, `false` otherwise (in which case the
+        ///                     outputs are set to black, a null vector and -1, respectively).
+        bool TraceFeatures(DBL x, DBL y, DBL width, DBL height, RGBColour& albedo, Vector3d& normal, DBL& depth);
+
         void InitRayContainerState(Ray& ray, bool compute = false);
+
+        /// Use a table of primary rays shared with other render threads, if the camera is a map projection.
+        void SetProjectionTable(std::shared_ptr<ProjectionTable> table) { projectionTable = table; }
+
+        /// Choose the number of focal blur samples per pixel from the size of the circle of confusion,
+        /// rather than always taking samples until the variance test is passed.
+        /// Aperture samples are then taken from a low-discrepancy sequence, so that any number of
+        /// them is evenly spread across the aperture.
+        void SetAdaptiveFocalBlur(bool adaptive);
     private:
         RayInteriorVector containingInteriors;
         /// scene data
@@ -189,9 +323,46 @@ class TracePixel final : public Trace,
         DBL adcBailout;
 
 
+        /// Objects that may contain the origin of a focal blur ray within a particular cell of a grid.
+        struct ContainerCandidateCell final
+        {
+            long x, y, z;
+            std::vector<ObjectPtr> objects;
+        };
+
+        /// Maximum number of grid cells to cache candidates for.
+        static constexpr size_t kMaxContainerCandidateCells = 64;
+
+        /// Cached candidates for the interiors containing the origins of focal blur rays, by grid cell.
+        std::vector<ContainerCandidateCell> containerCandidateCells;
+        /// Size of the grid cells, or 0 if not yet set up.
+        DBL containerCandidateCellSize;
+
+        /// @name Scratch storage for @ref TracePacket() and @ref TraceWavefront()
+        /// Kept from one batch of rays to the next, so that tracing them allocates no memory once
+        /// the buffers have grown to the batch size.
+        /// @{
+        std::vector<TraceTicket> batchTickets;
+        std::vector<Ray> batchRays;
+        std::vector<Intersection> batchIntersections;
+        std::vector<const Ray*> batchQueue;
+        std::vector<unsigned int> batchRayIndex;
+        std::vector<unsigned int> batchSlots;
+        std::unique_ptr<bool[]> batchFound;
+        unsigned int batchFoundSize;
+        /// @}
+
         void InitRayContainerStateTree(Ray& ray, BBOX_TREE *node);
 
+        /// Get the objects with an interior whose bounding box overlaps the grid cell a point is in.
+        /// @return             Candidates, or `nullptr` if the cache cannot be used.
+        const std::vector<ObjectPtr> *GetContainerCandidates(const Vector3d& point);
+
         void TraceRayWithFocalBlur(RGBTColour& colour, DBL x, DBL y, DBL width, DBL height);
+
+        /// Estimate the number of focal blur samples needed for a pixel, from the largest circle of
+        /// confusion of the surfaces hit by a few rays through the centre and rim of the aperture.
+        int EstimateFocalBlurSamples(DBL x, DBL y, DBL width, DBL height);
 };
 
 /// @}
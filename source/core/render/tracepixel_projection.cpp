@@ -859,4 +859,369 @@ http://mathworld.wolfram.com/LambertAzimuthalEqual-AreaProjection.html
         }         
         return false;
     }
+
+    bool TracePixelCameraData::IsProjectionCamera(int type)
+    {
+        switch(type)
+        {
+            case PROJ_TETRA_CAMERA:
+            case PROJ_CUBE_CAMERA:
+            case PROJ_OCTA_CAMERA:
+            case PROJ_ICOSA_CAMERA:
+            case PROJ_PLATECARREE_CAMERA:
+            case PROJ_MERCATOR_CAMERA:
+            case PROJ_LAMBERT_AZI_CAMERA:
+            case PROJ_LAMBERT_CYL_CAMERA:
+            case PROJ_BEHRMANN_CAMERA:
+            case PROJ_CRASTER_CAMERA:
+            case PROJ_EDWARDS_CAMERA:
+            case PROJ_HOBO_DYER_CAMERA:
+            case PROJ_PETERS_CAMERA:
+            case PROJ_GALL_CAMERA:
+            case PROJ_BALTHASART_CAMERA:
+            case PROJ_VAN_DER_GRINTEN_CAMERA:
+            case PROJ_MOLLWEIDE_CAMERA:
+            case PROJ_AITOFF_CAMERA:
+            case PROJ_ECKERT4_CAMERA:
+            case PROJ_ECKERT6_CAMERA:
+            case PROJ_MILLER_CAMERA:
+                return true;
+
+            default:
+                return false;
+        }
+    }
+
+    bool TracePixelCameraData::ProjectionCameraRay(Ray &ray, DBL x, DBL y, DBL width, DBL height)
+    {
+        DBL x0, y0, cx;
+
+        switch(camera.Type)
+        {
+
+            case PROJ_TETRA_CAMERA:
+                // Convert the x coordinate to be a DBL from 0.0 to 1.0
+                x0 = x / width ;
+
+                // Convert the y coordinate to be a DBL from 0.0 to 1.0
+                y0 = y / height ;
+
+                return ProjectionTetraCameraRay(ray,x0,y0);
+
+            case PROJ_CUBE_CAMERA:
+                // Convert the x coordinate to be a DBL from 0.0 to 1.0
+                x0 = x / width ;
+
+                // Convert the y coordinate to be a DBL from 0.0 to 1.0
+                y0 = y / height ;
+
+                return ProjectionCubeCameraRay(ray,x0,y0);
+
+            case PROJ_OCTA_CAMERA:
+                // Convert the x coordinate to be a DBL from 0.0 to 1.0
+                x0 = x / width ;
+
+                // Convert the y coordinate to be a DBL from 0.0 to 1.0
+                y0 = y / height ;
+
+                return ProjectionOctaCameraRay(ray,x0,y0);
+
+            case PROJ_ICOSA_CAMERA:
+                // Convert the x coordinate to be a DBL from 0.0 to 1.0
+                x0 = x / width ;
+
+                // Convert the y coordinate to be a DBL from 0.0 to 1.0
+                y0 = y / height ;
+
+                return ProjectionIcosaCameraRay(ray,x0,y0);
+
+            case PROJ_PLATECARREE_CAMERA:
+                // Convert the x coordinate to be a DBL from 0.0 to 1.0
+                x0 = x / width ;
+
+                // Convert the y coordinate to be a DBL from 0.0 to 1.0
+                y0 = ((height - 1) - y) / height ;
+
+                return ProjectionPlateCarreeCameraRay(ray,x0,y0);
+
+            case PROJ_MERCATOR_CAMERA:
+                // Convert the x coordinate to be a DBL from 0.0 to 1.0
+                x0 = x / width ;
+
+                // Convert the y coordinate to be a DBL from 0.0 to 1.0
+                y0 = ((height - 1) - y) / height ;
+
+                return ProjectionMercatorCameraRay(ray,x0,y0);
+
+            case PROJ_LAMBERT_AZI_CAMERA:
+                // Convert the x coordinate to be a DBL from -2.0 to 2.0
+                x0 = 4.0*(x / width)-2.0 ;
+
+                // Convert the y coordinate to be a DBL from -2.0 to 2.0
+                y0 = 4.0*(((height - 1) - y) / height) -2.0 ;
+
+                return ProjectionLambertAzimuthalCameraRay(ray,x0,y0);
+
+            case PROJ_LAMBERT_CYL_CAMERA:
+                cx = 1.0 ; 
+                // Convert the x coordinate to be a DBL from -1.0 to 1.0
+                x0 = 2.0*(x / width)-1.0 ;
+
+                // Convert the y coordinate to be a DBL from -1.0 to 1.0
+                y0 = 2.0*(((height - 1) - y) / height) -1.0 ;
+
+                return ProjectionEqualAreaCameraRay(ray,x0,y0,cx);
+
+            case PROJ_BEHRMANN_CAMERA:
+                cx = cos(30.0 * M_PI_180 );
+                // Convert the x coordinate to be a DBL from -1.0 to 1.0
+                x0 = 2.0*(x / width)-1.0 ;
+
+                // Convert the y coordinate to be a DBL from -1.0 to 1.0
+                y0 = 2.0*(((height - 1) - y) / height) -1.0 ;
+
+                return ProjectionEqualAreaCameraRay(ray,x0,y0,cx);
+
+            case PROJ_CRASTER_CAMERA: /* 37°04' , 37*60= 2220 */
+                cx = cos(2224.0/60.0 * M_PI_180 );
+                // Convert the x coordinate to be a DBL from -1.0 to 1.0
+                x0 = 2.0*(x / width)-1.0 ;
+
+                // Convert the y coordinate to be a DBL from -1.0 to 1.0
+                y0 = 2.0*(((height - 1) - y) / height) -1.0 ;
+
+                return ProjectionEqualAreaCameraRay(ray,x0,y0,cx);
+
+            case PROJ_EDWARDS_CAMERA: /* 37°24' */
+                cx = cos(37.4 * M_PI_180 );
+                // Convert the x coordinate to be a DBL from -1.0 to 1.0
+                x0 = 2.0*(x / width)-1.0 ;
+
+                // Convert the y coordinate to be a DBL from -1.0 to 1.0
+                y0 = 2.0*(((height - 1) - y) / height) -1.0 ;
+
+                return ProjectionEqualAreaCameraRay(ray,x0,y0,cx);
+
+            case PROJ_HOBO_DYER_CAMERA: /* 37°30' */
+                cx = cos(37.5 * M_PI_180 );
+                // Convert the x coordinate to be a DBL from -1.0 to 1.0
+                x0 = 2.0*(x / width)-1.0 ;
+
+                // Convert the y coordinate to be a DBL from -1.0 to 1.0
+                y0 = 2.0*(((height - 1) - y) / height) -1.0 ;
+
+                return ProjectionEqualAreaCameraRay(ray,x0,y0,cx);
+
+            case PROJ_PETERS_CAMERA:
+                cx = cos(44.138 * M_PI_180 );
+                // Convert the x coordinate to be a DBL from -1.0 to 1.0
+                x0 = 2.0*(x / width)-1.0 ;
+
+                // Convert the y coordinate to be a DBL from -1.0 to 1.0
+                y0 = 2.0*(((height - 1) - y) / height) -1.0 ;
+
+                return ProjectionEqualAreaCameraRay(ray,x0,y0,cx);
+
+            case PROJ_GALL_CAMERA:
+                cx = cos(45.0 * M_PI_180 );
+                // Convert the x coordinate to be a DBL from -1.0 to 1.0
+                x0 = 2.0*(x / width)-1.0 ;
+
+                // Convert the y coordinate to be a DBL from -1.0 to 1.0
+                y0 = 2.0*(((height - 1) - y) / height) -1.0 ;
+
+                return ProjectionEqualAreaCameraRay(ray,x0,y0,cx);
+
+            case PROJ_BALTHASART_CAMERA:
+                cx = cos(50.0 * M_PI_180 );
+                // Convert the x coordinate to be a DBL from -1.0 to 1.0
+                x0 = 2.0*(x / width)-1.0 ;
+
+                // Convert the y coordinate to be a DBL from -1.0 to 1.0
+                y0 = 2.0*(((height - 1) - y) / height) -1.0 ;
+
+                return ProjectionEqualAreaCameraRay(ray,x0,y0,cx);
+
+            case PROJ_VAN_DER_GRINTEN_CAMERA:
+                // Convert the x coordinate to be a DBL from -1.0 to 1.0
+                x0 = 2.0*(x / width)-1.0 ;
+
+                // Convert the y coordinate to be a DBL from -1.0 to 1.0
+                y0 = 2.0*(((height - 1) - y) / height) -1.0 ;
+
+                return ProjectionVanDerGrintenCameraRay(ray,x0,y0);
+
+            case PROJ_MOLLWEIDE_CAMERA:
+                // Convert the x coordinate to be a DBL from -1.0 to 1.0
+                x0 = 2.0*(x / width)-1.0 ;
+
+                // Convert the y coordinate to be a DBL from -1.0 to 1.0
+                y0 = 2.0*(((height - 1) - y) / height) -1.0 ;
+
+                return ProjectionMollweideCameraRay(ray,x0,y0);
+
+            case PROJ_AITOFF_CAMERA:
+                // Convert the x coordinate to be a DBL from -1.0 to 1.0
+                x0 = 2.0*(x / width)-1.0 ;
+
+                // Convert the y coordinate to be a DBL from -1.0 to 1.0
+                y0 = 2.0*(((height - 1) - y) / height) -1.0 ;
+
+                return ProjectionAitoffHammerCameraRay(ray,x0,y0);
+
+            case PROJ_ECKERT4_CAMERA:
+                // Convert the x coordinate to be a DBL from -1.0 to 1.0
+                x0 = 2.0*(x / width)-1.0 ;
+
+                // Convert the y coordinate to be a DBL from -1.0 to 1.0
+                y0 = 2.0*(((height - 1) - y) / height) -1.0 ;
+
+                return ProjectionEckert4CameraRay(ray,x0,y0);
+
+            case PROJ_ECKERT6_CAMERA:
+                // Convert the x coordinate to be a DBL from -1.0 to 1.0
+                x0 = 2.0*(x / width)-1.0 ;
+
+                // Convert the y coordinate to be a DBL from -1.0 to 1.0
+                y0 = 2.0*(((height - 1) - y) / height) -1.0 ;
+
+                return ProjectionEckert6CameraRay(ray,x0,y0);
+
+            case PROJ_MILLER_CAMERA:
+                // Convert the x coordinate to be a DBL from -1.0 to 1.0
+                x0 = 2.0*(x / width)-1.0 ;
+
+                // Convert the y coordinate to be a DBL from -1.0 to 1.0
+                y0 = 2.0*(((height - 1) - y) / height) -1.0 ;
+
+                return ProjectionMillerCameraRay(ray,x0,y0);
+
+            default:
+                throw POV_EXCEPTION_STRING("Unknown camera type in ProjectionCameraRay().");
+        }
+    }
+
+    constexpr DBL ProjectionTable::kTolerance;
+
+    ProjectionTable::ProjectionTable(unsigned int w, unsigned int h, unsigned int s) :
+        imageWidth(w),
+        imageHeight(h),
+        spacing(s),
+        // Nodes are placed at pixel centres, starting one node left of and above the image.
+        nodesX(w / s + 3),
+        nodesY(h / s + 3),
+        nodes(nodesX * nodesY),
+        nodeState(new std::atomic<unsigned char>[nodesX * nodesY]),
+        cellState(new std::atomic<unsigned char>[(nodesX - 1) * (nodesY - 1)])
+    {
+        for (unsigned int i = 0; i < nodesX * nodesY; ++i)
+            nodeState[i] = kUnknown;
+        for (unsigned int i = 0; i < (nodesX - 1) * (nodesY - 1); ++i)
+            cellState[i] = kUnknown;
+    }
+
+    bool ProjectionTable::GetRay(TracePixelCameraData& camera, Ray& ray, DBL x, DBL y, DBL width, DBL height)
+    {
+        if ((width != imageWidth) || (height != imageHeight))
+            return camera.ProjectionCameraRay(ray, x, y, width, height);
+
+        DBL fx = (x - 0.5) / spacing + 1.0;
+        DBL fy = (y - 0.5) / spacing + 1.0;
+        if (!(fx >= 0.0) || !(fy >= 0.0) || (fx >= nodesX - 1) || (fy >= nodesY - 1))
+            return camera.ProjectionCameraRay(ray, x, y, width, height);
+
+        unsigned int i = (unsigned int)fx;
+        unsigned int j = (unsigned int)fy;
+        unsigned char state = cellState[j * (nodesX - 1) + i].load(std::memory_order_acquire);
+        if (state == kUnknown)
+            state = ValidateCell(camera, ray, i, j, width, height);
+        if (state != kValid)
+            return camera.ProjectionCameraRay(ray, x, y, width, height);
+
+        Interpolate(i, j, fx - i, fy - j, ray.Origin, ray.Direction);
+        return true;
+    }
+
+    ProjectionTable::State ProjectionTable::GetNode(TracePixelCameraData& camera, Ray& ray, unsigned int i, unsigned int j, DBL width, DBL height)
+    {
+        unsigned int index = j * nodesX + i;
+        unsigned char state = nodeState[index].load(std::memory_order_acquire);
+        if (state != kUnknown)
+            return State(state);
+
+        unsigned char expected = kUnknown;
+        if (!nodeState[index].compare_exchange_strong(expected, kBusy, std::memory_order_acq_rel))
+            return State(expected);
+
+        // x and y of the node as passed to TracePixel::operator()().
+        DBL x = 0.5 + (DBL(i) - 1.0) * spacing;
+        DBL y = 0.5 + (DBL(j) - 1.0) * spacing;
+        bool valid = camera.ProjectionCameraRay(ray, x, y, width, height);
+        if (valid)
+        {
+            nodes[index].origin    = ray.Origin;
+            nodes[index].direction = ray.Direction;
+        }
+        nodeState[index].store(valid ? kValid : kInvalid, std::memory_order_release);
+        return (valid ? kValid : kInvalid);
+    }
+
+    ProjectionTable::State ProjectionTable::ValidateCell(TracePixelCameraData& camera, Ray& ray, unsigned int i, unsigned int j, DBL width, DBL height)
+    {
+        std::atomic<unsigned char>& cell = cellState[j * (nodesX - 1) + i];
+        unsigned char expected = kUnknown;
+        if (!cell.compare_exchange_strong(expected, kBusy, std::memory_order_acq_rel))
+            return State(expected);
+
+        State result = kValid;
+        for (unsigned int n = 0; n < 4; ++n)
+        {
+            State node = GetNode(camera, ray, i + (n & 1), j + (n >> 1), width, height);
+            if (node == kBusy)
+            {
+                // Some other thread is still computing a corner; leave validation for later.
+                cell.store(kUnknown, std::memory_order_release);
+                return kBusy;
+            }
+            if (node == kInvalid)
+                result = kInvalid;
+        }
+
+        // Check the centre and edge midpoints, where interpolation errors peak.
+        static const DBL kCheckPoints[5][2] = { { 0.5, 0.5 }, { 0.5, 0.0 }, { 0.0, 0.5 }, { 1.0, 0.5 }, { 0.5, 1.0 } };
+        for (unsigned int n = 0; (result == kValid) && (n < 5); ++n)
+        {
+            DBL u = kCheckPoints[n][0];
+            DBL v = kCheckPoints[n][1];
+            DBL x = 0.5 + (DBL(i) + u - 1.0) * spacing;
+            DBL y = 0.5 + (DBL(j) + v - 1.0) * spacing;
+            if (!camera.ProjectionCameraRay(ray, x, y, width, height))
+            {
+                result = kInvalid;
+                break;
+            }
+            Vector3d origin, direction;
+            Interpolate(i, j, u, v, origin, direction);
+            DBL limit = kTolerance * ray.Direction.length();
+            if (((origin - ray.Origin).length() > limit) || ((direction - ray.Direction).length() > limit))
+                result = kInvalid;
+        }
+
+        cell.store(result, std::memory_order_release);
+        return result;
+    }
+
+    void ProjectionTable::Interpolate(unsigned int i, unsigned int j, DBL u, DBL v, Vector3d& origin, Vector3d& direction) const
+    {
+        const Node& n00 = nodes[j * nodesX + i];
+        const Node& n10 = nodes[j * nodesX + i + 1];
+        const Node& n01 = nodes[(j + 1) * nodesX + i];
+        const Node& n11 = nodes[(j + 1) * nodesX + i + 1];
+        DBL w00 = (1.0 - u) * (1.0 - v);
+        DBL w10 = u * (1.0 - v);
+        DBL w01 = (1.0 - u) * v;
+        DBL w11 = u * v;
+        origin    = n00.origin    * w00 + n10.origin    * w10 + n01.origin    * w01 + n11.origin    * w11;
+        direction = n00.direction * w00 + n10.direction * w10 + n01.direction * w01 + n11.direction * w11;
+    }
 }
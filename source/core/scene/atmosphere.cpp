@@ -37,8 +37,10 @@
 #include "core/scene/atmosphere.h"
 
 // C++ variants of C standard header files
+#include <cmath>
+
 // C++ standard header files
-//  (none at the moment)
+#include <algorithm>
 
 // POV-Ray header files (base module)
 //  (none at the moment)
@@ -49,6 +51,7 @@
 #include "core/material/pigment.h"
 #include "core/material/texture.h"
 #include "core/math/matrix.h"
+#include "core/scene/tracethreaddata.h"
 
 // this must be the last file included
 #include "base/povdebug.h"
@@ -58,7 +61,8 @@ namespace pov
 
 Fog_Struct::Fog_Struct() :
     Turb(nullptr),
-    Next(nullptr)
+    Next(nullptr),
+    Table_Scale(0.0)
 {}
 
 Fog_Struct::~Fog_Struct()
@@ -201,6 +205,160 @@ void Destroy_Fog(FOG *Fog)
 
 
 
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Precompute_Fog
+*
+* INPUT
+*
+*   Fog - fog to set up
+*
+* OUTPUT
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Compute the parts of the fog calculation that do not depend on the ray:
+*   the attenuation colour, and for fogs without turbulence a table of the
+*   transmittance (already clipped to the fog's transmit value) against the
+*   optical depth. Fogs with turbulence are computed directly as before.
+*
+* CHANGES
+*
+******************************************************************************/
+
+void Precompute_Fog(FOG *Fog)
+{
+    ColourChannel filter_fog, transm_fog;
+
+    Fog->colour.GetFT(filter_fog, transm_fog);
+    Fog->Attenuation = (1.0 - filter_fog) + filter_fog * Fog->colour.colour();
+
+    Fog->Transmittance_Table.clear();
+    Fog->Table_Scale = 0.0;
+
+    if ((Fog->Turb != nullptr) || (Fog->Distance <= EPSILON))
+        return;
+
+    // Beyond this optical depth, the transmittance no longer changes noticeably.
+    DBL max_depth = -log(std::max(DBL(transm_fog), FOG_TABLE_MIN_TRANSMITTANCE));
+
+    Fog->Transmittance_Table.resize(FOG_TABLE_SIZE + 1);
+    if (max_depth <= 0.0)
+    {
+        // the fog does not attenuate at all
+        std::fill(Fog->Transmittance_Table.begin(), Fog->Transmittance_Table.end(), float(transm_fog));
+        return;
+    }
+
+    Fog->Table_Scale = FOG_TABLE_SIZE / max_depth;
+    for (int i = 0; i <= FOG_TABLE_SIZE; i++)
+        Fog->Transmittance_Table[i] = float(std::max(exp(-i / Fog->Table_Scale), DBL(transm_fog)));
+}
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Fog_Transmittance
+*
+* INPUT
+*
+*   Fog           - fog set up by Precompute_Fog() without turbulence
+*   Optical_Depth - optical depth along the ray
+*
+* OUTPUT
+*
+* RETURNS
+*
+*   DBL - transmittance, clipped to the fog's transmit value
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Look up the transmittance of a fog by linear interpolation in its table.
+*
+* CHANGES
+*
+******************************************************************************/
+
+DBL Fog_Transmittance(const FOG *Fog, DBL Optical_Depth)
+{
+    DBL x = Optical_Depth * Fog->Table_Scale;
+
+    if (!(x < FOG_TABLE_SIZE))
+        return Fog->Transmittance_Table[FOG_TABLE_SIZE];
+
+    int i = int(x);
+    DBL f = x - i;
+    return Fog->Transmittance_Table[i] * (1.0 - f) + Fog->Transmittance_Table[i + 1] * f;
+}
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Ground_Fog_Density_Integral
+*
+* INPUT
+*
+*   Height - height above the fog offset, in units of the fog altitude
+*
+* OUTPUT
+*
+* RETURNS
+*
+*   DBL - integral of the ground fog density from 0 to Height
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   The ground fog density is 1 / (Y*Y+1) for Y >= 0 and 1.0 for Y <= 0, so
+*   the integral is atan(Y) above and Y below the offset. The former is
+*   taken from a table shared by all fogs, which covers the heights where
+*   the density changes appreciably; above that range, the asymptotic
+*   expansion of atan(Y) is used.
+*
+* CHANGES
+*
+******************************************************************************/
+
+DBL Ground_Fog_Density_Integral(DBL Height)
+{
+    static const int kSize = 2048;
+    static const DBL kMaxHeight = 64.0;
+    static const std::vector<float> kTable = []()
+    {
+        std::vector<float> table(kSize + 1);
+        for (int i = 0; i <= kSize; i++)
+            table[i] = float(atan(i * kMaxHeight / kSize));
+        return table;
+    }();
+
+    if (Height <= 0.0)
+        return Height;
+
+    if (Height >= kMaxHeight)
+    {
+        DBL r = 1.0 / Height;
+        return M_PI_2 - r + r * r * r / 3.0;
+    }
+
+    DBL x = Height * (kSize / kMaxHeight);
+    int i = int(x);
+    DBL f = x - i;
+    return kTable[i] * (1.0 - f) + kTable[i + 1] * f;
+}
+
+
+
 /*****************************************************************************
 *
 * FUNCTION
@@ -422,6 +580,9 @@ SKYSPHERE *Copy_Skysphere(const SKYSPHERE *Old)
 
     New->Trans = Copy_Transform(Old->Trans);
 
+    // The pre-computed map, if any, reflects the original pigments and transformation, so the copy needs to be baked anew.
+    New->Cache.reset();
+
     // The standard assignment operator of SKYSPHERE has created a shallow copy of the Pigments vector, but we need a
     // deep copy in case Old gets destroyed.
     for (std::vector<PIGMENT*>::iterator i = New->Pigments.begin(); i != New->Pigments.end(); ++ i)
@@ -639,5 +800,202 @@ void Transform_Skysphere(SKYSPHERE *Skysphere, const TRANSFORM *Trans)
     Compose_Transforms(Skysphere->Trans, Trans);
 }
 
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Compute_Skysphere
+*
+* INPUT
+*
+*   Skysphere - Pointer to skysphere structure
+*   direction - Direction to evaluate the skysphere in
+*   Thread    - Thread-local data
+*
+* OUTPUT
+*
+*   colour    - Colour contributed by the skysphere layers
+*   filter    - Colour of light passing through all skysphere layers
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Evaluate the pigments of a skysphere in the manner of a layered texture,
+*   as done for scenes with a language version of 3.7 or later.
+*
+* CHANGES
+*
+******************************************************************************/
+
+void Compute_Skysphere(MathColour& colour, MathColour& filter, const SKYSPHERE *Skysphere, const Vector3d& direction, TraceThreadData *Thread)
+{
+    TransColour col_Temp;
+    Vector3d p;
+
+    colour.Clear();
+    filter = MathColour(1.0);
+
+    // Transform point on unit sphere.
+    if (Skysphere->Trans != nullptr)
+        MInvTransPoint(p, direction, Skysphere->Trans);
+    else
+        p = direction;
+
+    for (std::vector<PIGMENT*>::const_reverse_iterator i = Skysphere->Pigments.rbegin(); i != Skysphere->Pigments.rend(); ++ i)
+    {
+        // Compute sky colour from colour map.
+        Compute_Pigment(col_Temp, *i, p, nullptr, nullptr, Thread);
+
+        colour += col_Temp.colour() * col_Temp.Opacity() * filter * Skysphere->Emission;
+        filter *= col_Temp.TransmittedColour();
+    }
+}
+
+
+SkysphereCache::SkysphereCache(unsigned int resolution) :
+    mResolution(resolution)
+{
+    POV_ASSERT((resolution > 0) && ((resolution & (resolution - 1)) == 0));
+}
+
+void SkysphereCache::Bake(const SKYSPHERE *Skysphere, TraceThreadData *Thread)
+{
+    mLevels.clear();
+    mLevels.emplace_back(mResolution * mResolution);
+
+    // Octahedral map with the +y pole at the centre and the -y pole at the corners.
+    for (unsigned int j = 0; j < mResolution; ++j)
+    {
+        for (unsigned int i = 0; i < mResolution; ++i)
+        {
+            double px = 2.0 * (i + 0.5) / mResolution - 1.0;
+            double pz = 2.0 * (j + 0.5) / mResolution - 1.0;
+            double py = 1.0 - fabs(px) - fabs(pz);
+            if (py < 0.0)
+            {
+                double fx = (1.0 - fabs(pz)) * (px < 0.0 ? -1.0 : 1.0);
+                double fz = (1.0 - fabs(px)) * (pz < 0.0 ? -1.0 : 1.0);
+                px = fx;
+                pz = fz;
+            }
+            Vector3d direction(px, py, pz);
+            direction.normalize();
+
+            Texel& texel = mLevels[0][j * mResolution + i];
+            Compute_Skysphere(texel.colour, texel.filter, Skysphere, direction, Thread);
+        }
+    }
+
+    // The texels of an octahedral map cover roughly equal solid angles, so a plain box filter will do.
+    for (unsigned int size = mResolution / 2; size > 0; size /= 2)
+    {
+        const std::vector<Texel>& finer = mLevels.back();
+        std::vector<Texel> coarser(size * size);
+        for (unsigned int j = 0; j < size; ++j)
+        {
+            for (unsigned int i = 0; i < size; ++i)
+            {
+                const Texel& a = finer[(2 * j    ) * (2 * size) + 2 * i    ];
+                const Texel& b = finer[(2 * j    ) * (2 * size) + 2 * i + 1];
+                const Texel& c = finer[(2 * j + 1) * (2 * size) + 2 * i    ];
+                const Texel& d = finer[(2 * j + 1) * (2 * size) + 2 * i + 1];
+                coarser[j * size + i].colour = (a.colour + b.colour + c.colour + d.colour) * 0.25;
+                coarser[j * size + i].filter = (a.filter + b.filter + c.filter + d.filter) * 0.25;
+            }
+        }
+        mLevels.push_back(std::move(coarser));
+    }
+}
+
+const SkysphereCache::Texel& SkysphereCache::Fetch(unsigned int level, int i, int j) const
+{
+    int size = int(mResolution >> level);
+
+    // Texels beyond an edge of an octahedral map continue mirrored along the same edge.
+    if (i < 0)
+    {
+        i = 0;
+        j = size - 1 - j;
+    }
+    else if (i >= size)
+    {
+        i = size - 1;
+        j = size - 1 - j;
+    }
+    if (j < 0)
+    {
+        j = 0;
+        i = size - 1 - i;
+    }
+    else if (j >= size)
+    {
+        j = size - 1;
+        i = size - 1 - i;
+    }
+
+    return mLevels[level][j * size + i];
+}
+
+void SkysphereCache::Sample(unsigned int level, double u, double v, MathColour& colour, MathColour& filter) const
+{
+    unsigned int size = mResolution >> level;
+    double x = u * size - 0.5;
+    double y = v * size - 0.5;
+    int i = int(floor(x));
+    int j = int(floor(y));
+    ColourChannel fx = ColourChannel(x - i);
+    ColourChannel fy = ColourChannel(y - j);
+
+    const Texel& t00 = Fetch(level, i,     j    );
+    const Texel& t10 = Fetch(level, i + 1, j    );
+    const Texel& t01 = Fetch(level, i,     j + 1);
+    const Texel& t11 = Fetch(level, i + 1, j + 1);
+
+    colour = (t00.colour * (1.0f - fx) + t10.colour * fx) * (1.0f - fy) + (t01.colour * (1.0f - fx) + t11.colour * fx) * fy;
+    filter = (t00.filter * (1.0f - fx) + t10.filter * fx) * (1.0f - fy) + (t01.filter * (1.0f - fx) + t11.filter * fx) * fy;
+}
+
+void SkysphereCache::Lookup(const Vector3d& direction, double solidAngle, MathColour& colour, MathColour& filter) const
+{
+    double l = fabs(direction[X]) + fabs(direction[Y]) + fabs(direction[Z]);
+    double px = direction[X] / l;
+    double pz = direction[Z] / l;
+    if (direction[Y] < 0.0)
+    {
+        double fx = (1.0 - fabs(pz)) * (px < 0.0 ? -1.0 : 1.0);
+        double fz = (1.0 - fabs(px)) * (pz < 0.0 ? -1.0 : 1.0);
+        px = fx;
+        pz = fz;
+    }
+    double u = 0.5 * px + 0.5;
+    double v = 0.5 * pz + 0.5;
+
+    // Pick the mip level whose texels cover about the same solid angle as the ray.
+    unsigned int lastLevel = (unsigned int)(mLevels.size() - 1);
+    double level = 0.0;
+    if (solidAngle > 0.0)
+        level = 0.5 * std::log2(solidAngle * double(mResolution) * double(mResolution) / (4.0 * M_PI));
+
+    if (level <= 0.0)
+        Sample(0, u, v, colour, filter);
+    else if (level >= lastLevel)
+        Sample(lastLevel, u, v, colour, filter);
+    else
+    {
+        unsigned int level0 = (unsigned int)level;
+        ColourChannel f = ColourChannel(level - level0);
+        MathColour colour1, filter1;
+        Sample(level0,     u, v, colour,  filter);
+        Sample(level0 + 1, u, v, colour1, filter1);
+        colour = colour * (1.0f - f) + colour1 * f;
+        filter = filter * (1.0f - f) + filter1 * f;
+    }
+}
+
 }
 // end of namespace pov
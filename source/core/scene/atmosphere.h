@@ -44,6 +44,7 @@
 //  (none at the moment)
 
 // C++ standard header files
+#include <memory>
 #include <vector>
 
 // POV-Ray header files (base module)
@@ -72,6 +73,11 @@ namespace pov
 #define GROUND_MIST 2
 #define FOG_TYPES   2
 
+/// Number of intervals in the transmittance table of a fog without turbulence.
+#define FOG_TABLE_SIZE              1024
+/// Transmittance at which the table of a fog without turbulence ends.
+#define FOG_TABLE_MIN_TRANSMITTANCE 1.0e-7
+
 /*****************************************************************************
 * Global typedefs
 ******************************************************************************/
@@ -91,6 +97,11 @@ struct Fog_Struct final
     TurbulenceWarp *Turb;
     SNGL Turb_Depth;
     FOG *Next;
+
+    // Set up by Precompute_Fog().
+    MathColour              Attenuation;            ///< Attenuation factor due to filtered/unfiltered translucency.
+    std::vector<float>      Transmittance_Table;    ///< Transmittance vs. optical depth, clipped to the fog's transmit; empty if not applicable.
+    DBL                     Table_Scale;            ///< Table entries per unit of optical depth.
 };
 
 struct Rainbow_Struct final
@@ -107,13 +118,62 @@ struct Rainbow_Struct final
     RAINBOW *Next;
 };
 
+/// Pre-computed sky sphere colours.
+///
+/// The sky sphere is baked once per frame into an octahedral map of the full sphere of
+/// directions, with box-filtered mip levels down to 1x1 texel, so that rays escaping the scene
+/// need not evaluate the sky sphere pigments. Rays covering a large solid angle (most notably
+/// radiosity sample rays) are looked up in a correspondingly coarse mip level.
+///
+/// @note
+///     The cache stores the sky sphere colour and filter as computed for scenes with a language
+///     version of 3.7 or later; it is not used for older scenes.
+///
+class SkysphereCache final
+{
+    public:
+
+        /// @param[in]  resolution  Width and height of the finest mip level, in texels. Must be a power of 2.
+        SkysphereCache(unsigned int resolution);
+
+        /// Evaluate the sky sphere for each texel of the finest mip level, and compute the coarser levels.
+        void Bake(const SKYSPHERE *Skysphere, TraceThreadData *Thread);
+
+        /// Look up the sky sphere colour and filter in a given direction.
+        ///
+        /// @param[in]  direction   Direction (in world coordinates) to look up; need not be normalized.
+        /// @param[in]  solidAngle  Solid angle covered by the ray, in steradians.
+        /// @param[out] colour      Sky sphere colour, including emission.
+        /// @param[out] filter      Colour of light passing through all sky sphere layers.
+        ///
+        void Lookup(const Vector3d& direction, double solidAngle, MathColour& colour, MathColour& filter) const;
+
+        unsigned int GetResolution() const { return mResolution; }
+
+    private:
+
+        struct Texel final
+        {
+            MathColour colour;
+            MathColour filter;
+        };
+
+        unsigned int                        mResolution;
+        std::vector<std::vector<Texel>>     mLevels;
+
+        const Texel& Fetch(unsigned int level, int i, int j) const;
+        void Sample(unsigned int level, double u, double v, MathColour& colour, MathColour& filter) const;
+};
+
 struct Skysphere_Struct final
 {
-    Skysphere_Struct() : Trans(nullptr) {}
+    Skysphere_Struct() : Trans(nullptr), CacheResolution(0) {}
     ~Skysphere_Struct();
-    MathColour              Emission;   ///< Brightness adjustment.
-    std::vector<PIGMENT*>   Pigments;   ///< Pigment(s) to use.
-    TRANSFORM*              Trans;      ///< Skysphere transformation.
+    MathColour                      Emission;           ///< Brightness adjustment.
+    std::vector<PIGMENT*>           Pigments;           ///< Pigment(s) to use.
+    TRANSFORM*                      Trans;              ///< Skysphere transformation.
+    unsigned int                    CacheResolution;    ///< Resolution of the pre-computed map, or 0 to evaluate the pigments for each ray.
+    std::shared_ptr<SkysphereCache> Cache;              ///< Pre-computed map, if baked.
 };
 
 /*****************************************************************************
@@ -123,6 +183,9 @@ struct Skysphere_Struct final
 FOG *Create_Fog (void);
 FOG *Copy_Fog (const FOG *Fog);
 void Destroy_Fog (FOG *Fog);
+void Precompute_Fog (FOG *Fog);
+DBL Fog_Transmittance (const FOG *Fog, DBL Optical_Depth);
+DBL Ground_Fog_Density_Integral (DBL Height);
 
 RAINBOW *Create_Rainbow (void);
 RAINBOW *Copy_Rainbow (const RAINBOW *Rainbow);
@@ -135,6 +198,7 @@ void Scale_Skysphere (SKYSPHERE *Skysphere, const Vector3d& Vector);
 void Rotate_Skysphere (SKYSPHERE *Skysphere, const Vector3d& Vector);
 void Translate_Skysphere (SKYSPHERE *Skysphere, const Vector3d& Vector);
 void Transform_Skysphere (SKYSPHERE *Skysphere, const TRANSFORM *Trans);
+void Compute_Skysphere (MathColour& colour, MathColour& filter, const SKYSPHERE *Skysphere, const Vector3d& direction, TraceThreadData *Thread);
 
 /// @}
 ///
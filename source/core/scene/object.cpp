@@ -40,6 +40,7 @@
 //  (none at the moment)
 
 // C++ standard header files
+#include <chrono>
 #include <string>
 
 // POV-Ray header files (base module)
@@ -115,11 +116,39 @@ std::string& ObjectDebugHelper::SimpleDesc(std::string& result)
 *
 ******************************************************************************/
 
-bool Find_Intersection(Intersection *isect, ObjectPtr object, const Ray& ray, TraceThreadData *threadData)
+// Find all intersections of an object, collecting profiling data if enabled.
+static inline bool All_Intersections(ObjectPtr object, const Ray& ray, IStack& depthstack, TraceThreadData *threadData)
+{
+    if (!threadData->objectProfiling)
+        return object->All_Intersections(ray, depthstack, threadData);
+
+    ObjectProfileData& entry = threadData->objectProfile[object];
+    bool found;
+
+    entry.tests++;
+    if (threadData->objectProfileCountdown == 0)
+    {
+        threadData->objectProfileCountdown = kObjectProfileTimingInterval - 1;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        found = object->All_Intersections(ray, depthstack, threadData);
+        entry.time += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        entry.timedTests++;
+    }
+    else
+    {
+        threadData->objectProfileCountdown--;
+        found = object->All_Intersections(ray, depthstack, threadData);
+    }
+
+    if (found)
+        entry.hits++;
+    return found;
+}
+
+bool Find_Intersection(Intersection *isect, ObjectPtr object, const Ray& ray, TraceThreadData *threadData, DBL closest)
 {
     if (object != nullptr)
     {
-        DBL closest = HUGE_VAL;
         BBoxVector3d origin;
         BBoxVector3d invdir;
         BBoxDirection variant;
@@ -141,26 +170,15 @@ bool Find_Intersection(Intersection *isect, ObjectPtr object, const Ray& ray, Tr
         IStack depthstack(threadData->stackPool);
         POV_REFPOOL_ASSERT(depthstack->empty()); // verify that the IStack pulled from the pool is in a cleaned-up condition
 
-        if(object->All_Intersections(ray, depthstack, threadData))
+        if(All_Intersections(object, ray, depthstack, threadData))
         {
-            bool found = false;
-            double tmpDepth = 0;
-
-            while(depthstack->size() > 0)
-            {
-                tmpDepth = depthstack->top().Depth;
-                // TODO FIXME - This was SMALL_TOLERANCE, but that's too rough for some scenes [cjc] need to check what it was in the old code [trf]
-                if(tmpDepth < closest && (ray.IsSubsurfaceRay() || tmpDepth > MIN_ISECT_DEPTH))
-                {
-                    *isect = depthstack->top();
-                    closest = tmpDepth;
-                    found = true;
-                }
-
-                depthstack->pop();
-            }
-
-            return (found == true);
+            // TODO FIXME - This was SMALL_TOLERANCE, but that's too rough for some scenes [cjc] need to check what it was in the old code [trf]
+            const Intersection *hit = depthstack->closest(closest, [&ray](const Intersection& i) { return ray.IsSubsurfaceRay() || i.Depth > MIN_ISECT_DEPTH; });
+            if(hit == nullptr)
+                return false;
+
+            *isect = *hit;
+            return true;
         }
 
         POV_REFPOOL_ASSERT(depthstack->empty()); // verify that the IStack is in a cleaned-up condition (again)
@@ -169,11 +187,10 @@ bool Find_Intersection(Intersection *isect, ObjectPtr object, const Ray& ray, Tr
     return false;
 }
 
-bool Find_Intersection(Intersection *isect, ObjectPtr object, const Ray& ray, const RayObjectCondition& postcondition, TraceThreadData *threadData)
+bool Find_Intersection(Intersection *isect, ObjectPtr object, const Ray& ray, const RayObjectCondition& postcondition, TraceThreadData *threadData, DBL closest)
 {
     if (object != nullptr)
     {
-        DBL closest = HUGE_VAL;
         BBoxVector3d origin;
         BBoxVector3d invdir;
         BBoxDirection variant;
@@ -195,26 +212,15 @@ bool Find_Intersection(Intersection *isect, ObjectPtr object, const Ray& ray, co
         IStack depthstack(threadData->stackPool);
         POV_REFPOOL_ASSERT(depthstack->empty()); // verify that the IStack pulled from the pool is in a cleaned-up condition
 
-        if(object->All_Intersections(ray, depthstack, threadData))
+        if(All_Intersections(object, ray, depthstack, threadData))
         {
-            bool found = false;
-            double tmpDepth = 0;
-
-            while(depthstack->size() > 0)
-            {
-                tmpDepth = depthstack->top().Depth;
-                // TODO FIXME - This was SMALL_TOLERANCE, but that's too rough for some scenes [cjc] need to check what it was in the old code [trf]
-                if(tmpDepth < closest && (ray.IsSubsurfaceRay() || tmpDepth > MIN_ISECT_DEPTH) && postcondition(ray, object, tmpDepth))
-                {
-                    *isect = depthstack->top();
-                    closest = tmpDepth;
-                    found = true;
-                }
-
-                depthstack->pop();
-            }
-
-            return (found == true);
+            // TODO FIXME - This was SMALL_TOLERANCE, but that's too rough for some scenes [cjc] need to check what it was in the old code [trf]
+            const Intersection *hit = depthstack->closest(closest, [&ray, object, &postcondition](const Intersection& i) { return (ray.IsSubsurfaceRay() || i.Depth > MIN_ISECT_DEPTH) && postcondition(ray, object, i.Depth); });
+            if(hit == nullptr)
+                return false;
+
+            *isect = *hit;
+            return true;
         }
 
         POV_REFPOOL_ASSERT(depthstack->empty()); // verify that the IStack is in a cleaned-up condition (again)
@@ -223,11 +229,10 @@ bool Find_Intersection(Intersection *isect, ObjectPtr object, const Ray& ray, co
     return false;
 }
 
-bool Find_Intersection(Intersection *isect, ObjectPtr object, const Ray& ray, BBoxDirection variant, const BBoxVector3d& origin, const BBoxVector3d& invdir, TraceThreadData *threadData)
+bool Find_Intersection(Intersection *isect, ObjectPtr object, const Ray& ray, BBoxDirection variant, const BBoxVector3d& origin, const BBoxVector3d& invdir, TraceThreadData *threadData, DBL closest)
 {
     if (object != nullptr)
     {
-        DBL closest = HUGE_VAL;
 
         if(object->Intersect_BBox(variant, origin, invdir, closest) == false)
             return false;
@@ -241,26 +246,15 @@ bool Find_Intersection(Intersection *isect, ObjectPtr object, const Ray& ray, BB
         IStack depthstack(threadData->stackPool);
         POV_REFPOOL_ASSERT(depthstack->empty()); // verify that the IStack pulled from the pool is in a cleaned-up condition
 
-        if(object->All_Intersections(ray, depthstack, threadData))
+        if(All_Intersections(object, ray, depthstack, threadData))
         {
-            bool found = false;
-            double tmpDepth = 0;
-
-            while(depthstack->size() > 0)
-            {
-                tmpDepth = depthstack->top().Depth;
-                // TODO FIXME - This was SMALL_TOLERANCE, but that's too rough for some scenes [cjc] need to check what it was in the old code [trf]
-                if(tmpDepth < closest && (ray.IsSubsurfaceRay() || tmpDepth > MIN_ISECT_DEPTH))
-                {
-                    *isect = depthstack->top();
-                    closest = tmpDepth;
-                    found = true;
-                }
-
-                depthstack->pop();
-            }
-
-            return (found == true);
+            // TODO FIXME - This was SMALL_TOLERANCE, but that's too rough for some scenes [cjc] need to check what it was in the old code [trf]
+            const Intersection *hit = depthstack->closest(closest, [&ray](const Intersection& i) { return ray.IsSubsurfaceRay() || i.Depth > MIN_ISECT_DEPTH; });
+            if(hit == nullptr)
+                return false;
+
+            *isect = *hit;
+            return true;
         }
 
         POV_REFPOOL_ASSERT(depthstack->empty()); // verify that the IStack is in a cleaned-up condition (again)
@@ -269,11 +263,10 @@ bool Find_Intersection(Intersection *isect, ObjectPtr object, const Ray& ray, BB
     return false;
 }
 
-bool Find_Intersection(Intersection *isect, ObjectPtr object, const Ray& ray, BBoxDirection variant, const BBoxVector3d& origin, const BBoxVector3d& invdir, const RayObjectCondition& postcondition, TraceThreadData *threadData)
+bool Find_Intersection(Intersection *isect, ObjectPtr object, const Ray& ray, BBoxDirection variant, const BBoxVector3d& origin, const BBoxVector3d& invdir, const RayObjectCondition& postcondition, TraceThreadData *threadData, DBL closest)
 {
     if (object != nullptr)
     {
-        DBL closest = HUGE_VAL;
 
         if(object->Intersect_BBox(variant, origin, invdir, closest) == false)
             return false;
@@ -287,26 +280,15 @@ bool Find_Intersection(Intersection *isect, ObjectPtr object, const Ray& ray, BB
         IStack depthstack(threadData->stackPool);
         POV_REFPOOL_ASSERT(depthstack->empty()); // verify that the IStack pulled from the pool is in a cleaned-up condition
 
-        if(object->All_Intersections(ray, depthstack, threadData))
+        if(All_Intersections(object, ray, depthstack, threadData))
         {
-            bool found = false;
-            double tmpDepth = 0;
-
-            while(depthstack->size() > 0)
-            {
-                tmpDepth = depthstack->top().Depth;
-                // TODO FIXME - This was SMALL_TOLERANCE, but that's too rough for some scenes [cjc] need to check what it was in the old code [trf]
-                if(tmpDepth < closest && (ray.IsSubsurfaceRay() || tmpDepth > MIN_ISECT_DEPTH) && postcondition(ray, object, tmpDepth))
-                {
-                    *isect = depthstack->top();
-                    closest = tmpDepth;
-                    found = true;
-                }
-
-                depthstack->pop();
-            }
-
-            return (found == true);
+            // TODO FIXME - This was SMALL_TOLERANCE, but that's too rough for some scenes [cjc] need to check what it was in the old code [trf]
+            const Intersection *hit = depthstack->closest(closest, [&ray, object, &postcondition](const Intersection& i) { return (ray.IsSubsurfaceRay() || i.Depth > MIN_ISECT_DEPTH) && postcondition(ray, object, i.Depth); });
+            if(hit == nullptr)
+                return false;
+
+            *isect = *hit;
+            return true;
         }
 
         POV_REFPOOL_ASSERT(depthstack->empty()); // verify that the IStack is in a cleaned-up condition (again)
@@ -43,6 +43,7 @@
 //  (none at the moment)
 
 // C++ standard header files
+#include <memory>
 #include <vector>
 
 // POV-Ray header files (base module)
@@ -181,12 +182,17 @@ class ObjectBase
         std::vector<ObjectPtr> Bound;
         std::vector<ObjectPtr> Clip;
         std::vector<LightSource*> LLights;  ///< Used for light groups.
+        /// Global light sources that may reach the object (see @ref Compute_Light_Reach()), or `nullptr` for all.
+        /// Set up during bounding; objects reached by the same light sources share the list.
+        std::shared_ptr<const std::vector<size_t>> ReachingLights;
         BoundingBox BBox;
         TRANSFORM *Trans;
         SNGL Ph_Density;
         double RadiosityImportance;
         bool RadiosityImportanceSet;
         unsigned int Flags;
+        unsigned int sourceFile;            ///< Index of the source file in @ref SceneData::sourceFiles.
+        unsigned int sourceLine;            ///< Line the object was defined at in the source file, or 0 if unknown.
 
 #ifdef OBJECT_DEBUG_HELPER
         ObjectDebugHelper Debug;
@@ -196,7 +202,8 @@ class ObjectBase
         ObjectBase(int t) :
             Type(t),
             Texture(nullptr), Interior_Texture(nullptr), interior(), Trans(nullptr),
-            Ph_Density(0), RadiosityImportance(0.0), RadiosityImportanceSet(false), Flags(0)
+            Ph_Density(0), RadiosityImportance(0.0), RadiosityImportanceSet(false), Flags(0),
+            sourceFile(0), sourceLine(0)
         {
             Make_BBox(BBox, -BOUND_HUGE/2.0, -BOUND_HUGE/2.0, -BOUND_HUGE/2.0, BOUND_HUGE, BOUND_HUGE, BOUND_HUGE);
         }
@@ -209,10 +216,11 @@ class ObjectBase
         ///
         ObjectBase(int t, ObjectBase& o, bool transplant) :
             Type(t),
-            Texture(o.Texture), Interior_Texture(o.Interior_Texture), interior(o.interior), Trans(o.Trans),
+            Texture(o.Texture), Interior_Texture(o.Interior_Texture), interior(o.interior),
+            Bound(o.Bound), Clip(o.Clip), LLights(o.LLights), BBox(o.BBox), Trans(o.Trans),
             Ph_Density(o.Ph_Density), RadiosityImportance(o.RadiosityImportance),
             RadiosityImportanceSet(o.RadiosityImportanceSet), Flags(o.Flags),
-            Bound(o.Bound), Clip(o.Clip), LLights(o.LLights), BBox(o.BBox)
+            sourceFile(o.sourceFile), sourceLine(o.sourceLine)
         {
             if (transplant)
             {
@@ -318,9 +326,13 @@ class LightSource final : public CompoundObject
         Vector3d Direction, Center, Points_At, Axis1, Axis2;
         DBL Coeff, Radius, Falloff;
         DBL Fade_Distance, Fade_Power;
+        DBL Sample_Variance; ///< Target variance for stochastically sampled area lights, or 0 for the adaptive grid.
         int Area_Size1, Area_Size2;
         int Adaptive_Level;
         ObjectPtr Projected_Through_Object;
+        DBL Media_Grid_Spacing; ///< Cell size of the visibility grid for media sampling, or 0 to trace all shadow rays.
+        DBL Media_Grid_Memory;  ///< Memory cap for the visibility grid, in MiB.
+        std::shared_ptr<MediaGrid> Media_Grid;
 
         unsigned Light_Type : 8;
         bool Area_Light : 1;
@@ -393,10 +405,10 @@ struct ContainedBySphere final : public ContainedByShape
     virtual ContainedByShape* Copy() const override;
 };
 
-bool Find_Intersection(Intersection *Ray_Intersection, ObjectPtr Object, const Ray& ray, TraceThreadData *Thread);
-bool Find_Intersection(Intersection *Ray_Intersection, ObjectPtr Object, const Ray& ray, const RayObjectCondition& postcondition, TraceThreadData *Thread);
-bool Find_Intersection(Intersection *isect, ObjectPtr object, const Ray& ray, BBoxDirection variant, const BBoxVector3d& origin, const BBoxVector3d& invdir, TraceThreadData *ThreadData);
-bool Find_Intersection(Intersection *isect, ObjectPtr object, const Ray& ray, BBoxDirection variant, const BBoxVector3d& origin, const BBoxVector3d& invdir, const RayObjectCondition& postcondition, TraceThreadData *ThreadData);
+bool Find_Intersection(Intersection *Ray_Intersection, ObjectPtr Object, const Ray& ray, TraceThreadData *Thread, DBL closest = HUGE_VAL);
+bool Find_Intersection(Intersection *Ray_Intersection, ObjectPtr Object, const Ray& ray, const RayObjectCondition& postcondition, TraceThreadData *Thread, DBL closest = HUGE_VAL);
+bool Find_Intersection(Intersection *isect, ObjectPtr object, const Ray& ray, BBoxDirection variant, const BBoxVector3d& origin, const BBoxVector3d& invdir, TraceThreadData *ThreadData, DBL closest = HUGE_VAL);
+bool Find_Intersection(Intersection *isect, ObjectPtr object, const Ray& ray, BBoxDirection variant, const BBoxVector3d& origin, const BBoxVector3d& invdir, const RayObjectCondition& postcondition, TraceThreadData *ThreadData, DBL closest = HUGE_VAL);
 bool Ray_In_Bound(const Ray& ray, const std::vector<ObjectPtr>& Bounding_Object, TraceThreadData *Thread);
 bool Point_In_Clip(const Vector3d& IPoint, const std::vector<ObjectPtr>& Clip, TraceThreadData *Thread);
 ObjectPtr Copy_Object(ObjectPtr Old);
@@ -48,9 +48,16 @@
 #include "base/image/colourspace.h"
 
 // POV-Ray header files (core module)
+#include "core/bounding/bsptree.h"
+#include "core/bounding/bvhtree.h"
+#include "core/bounding/compactbboxtree.h"
+#include "core/lighting/lighttree.h"
+#include "core/lighting/subsurface.h"
 #include "core/material/noise.h"
 #include "core/material/pattern.h"
 #include "core/scene/atmosphere.h"
+#include "core/shape/plane.h"
+#include "core/support/cracklecache.h"
 
 // this must be the last file included
 #include "base/povdebug.h"
@@ -80,6 +87,8 @@ SceneData::SceneData() :
     explicitNoiseGenerator = false; // scene has not set the noise generator explicitly
     boundingMethod = 0;
     numberOfWaves = 10;
+    patternCache = false;
+    crackleCache = std::make_shared<CrackleCache>();
     parsedMaxTraceLevel = MAX_TRACE_LEVEL_DEFAULT;
     parsedAdcBailout = 1.0 / 255.0; // adc bailout sufficient for displays
     workingGamma.reset();
@@ -87,24 +96,57 @@ SceneData::SceneData() :
     inputFileGamma = SRGBGammaCurve::Get();
     gammaMode = kPOVList_GammaMode_None; // default setting for v3.6.2, which in turn is the default for the language
 
+    multiCamera = false;
+
     mmPerUnit = 10;
     useSubsurface = false;
     subsurfaceSamplesDiffuse = 50;
     subsurfaceSamplesSingle = 50;
     subsurfaceUseRadiosity = false;
+    subsurfacePointCount = 0;
+    subsurfaceErrorBound = 0.1;
 
     bspMaxDepth = 0;
     bspObjectIsectCost = bspBaseAccessCost = bspChildAccessCost = bspMissChance = 0.0f;
+    bvhWidth = 4;
+    bvhPacketSize = 16;
+    bvhRefitThreshold = 0.0f;
+    boundingSlabsCompact = 0;
+    boundingCacheHit = false;
+    boundingCacheRefit = false;
+    boundingAnalysis = false;
+    environmentFingerprint = 0;
+    environmentFingerprintStable = false;
 
     Fractal_Iteration_Stack_Length = 0;
-    Max_Blob_Components = 1000; // TODO FIXME - this gets set in the parser but allocated *before* that in the scene data, and if it is 0 here, a malloc may fail there because the memory requested is zero [trf]
-    Max_Bounding_Cylinders = 100; // TODO FIXME - see note for Max_Blob_Components
+    Max_Bounding_Cylinders = 100; // TODO FIXME - this gets set in the parser but allocated *before* that in the scene data, and if it is 0 here, a malloc may fail there because the memory requested is zero [trf]
     boundingSlabs = nullptr;
+    compactSlabs = nullptr;
 
     splitUnions = false;
     removeBounds = true;
+    mergeTriangles = true;
 
     tree = nullptr;
+    bvhTree = nullptr;
+    planeSet = nullptr;
+
+    lightThreshold = 0.0;
+    lightTree = nullptr;
+
+    meshImportTriangles = 0;
+    meshImportTime = 0;
+    symbolLookups = 0;
+    symbolProbes = 0;
+    declarationsReused = 0;
+    declarationsEvaluated = 0;
+    meshCacheHits = 0;
+    meshCacheWrites = 0;
+    heightFieldPoints = 0;
+    heightFieldTime = 0;
+
+    surfacePhotonBuildTime = 0;
+    mediaPhotonBuildTime = 0;
 }
 
 SceneData::~SceneData()
@@ -126,6 +168,8 @@ SceneData::~SceneData()
     }
     if (boundingSlabs != nullptr)
         Destroy_BBox_Tree(boundingSlabs);
+    if (compactSlabs != nullptr)
+        delete compactSlabs;
     for (std::vector<TrueTypeFont*>::iterator i = TTFonts.begin(); i != TTFonts.end(); ++i)
         delete *i;
     // TODO: perhaps ObjectBase::~ObjectBase would be a better place
@@ -134,6 +178,12 @@ SceneData::~SceneData()
 
     if (tree != nullptr)
         delete tree;
+    if (bvhTree != nullptr)
+        delete bvhTree;
+    if (planeSet != nullptr)
+        delete planeSet;
+    if (lightTree != nullptr)
+        delete lightTree;
 }
 
 }
@@ -45,6 +45,8 @@
 
 // C++ standard header files
 #include <map>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -53,8 +55,12 @@
 
 // POV-Ray header files (core module)
 #include "core/lighting/radiosity.h"
+#include "core/math/matrix.h"
 #include "core/scene/atmosphere_fwd.h"
 #include "core/scene/camera.h"
+#include "core/support/cracklecache_fwd.h"
+#include "core/support/scenearena.h"
+#include "core/support/texturecache_fwd.h"
 #include "core/shape/truetype.h"
 
 namespace pov
@@ -69,6 +75,11 @@ namespace pov
 using namespace pov_base;
 
 class BSPTree;
+class BVHTree;
+class CompactBBoxTree;
+class LightTree;
+class PlaneSet;
+class SubsurfaceIrradianceCloud;
 
 /// Class holding scene specific data.
 ///
@@ -91,6 +102,14 @@ class SceneData
         /// Destructor.
         virtual ~SceneData();
 
+        /// arena for parsed data that lives as long as the scene
+        /// @note
+        ///     Declared ahead of the objects, so that it outlives them.
+        SceneArena arena;
+        /// transformations shared by the objects once parsing is complete
+        /// @note
+        ///     Declared ahead of the objects, so that it outlives them.
+        TransformPool transformPool;
         /// list of all shape objects
         std::vector<ObjectPtr> objects;
         /// list of all global light sources
@@ -131,6 +150,12 @@ class SceneData
         int noiseGenerator;
         /// whether or not the noise generator was explicitly set by the scene - TODO FIXME remove [trf]
         bool explicitNoiseGenerator;
+        /// whether to cache pattern values per intersection
+        bool patternCache;
+        /// crackle cell cache shared by all render threads
+        std::shared_ptr<CrackleCache> crackleCache;
+        /// mip-mapped image map cache shared by all render threads, or `nullptr` if disabled
+        std::shared_ptr<TextureCache> textureCache;
         /// bounding method selector
         unsigned int boundingMethod;
         /// Working gamma.
@@ -157,6 +182,14 @@ class SceneData
         int subsurfaceSamplesSingle;
         /// whether to compute radiosity contribution to subsurface effects
         bool subsurfaceUseRadiosity;
+        /// approximate number of irradiance samples per SSLT object (0 to sample light at render time)
+        int subsurfacePointCount;
+        /// maximum solid angle for treating a group of irradiance samples as a single sample
+        DBL subsurfaceErrorBound;
+        /// subsurface irradiance point clouds built so far, by interior
+        std::map<const Interior*, std::shared_ptr<const SubsurfaceIrradianceCloud>> subsurfaceIrradianceClouds;
+        /// mutex guarding @ref subsurfaceIrradianceClouds
+        std::mutex subsurfaceIrradianceMutex;
 
         // ********************************************************************************
         // temporary variables for BSP testing ... we may or may not keep these in future
@@ -167,6 +200,43 @@ class SceneData
         float bspBaseAccessCost;
         float bspChildAccessCost;
         float bspMissChance;
+        unsigned int bvhWidth;
+        unsigned int bvhPacketSize;
+        float bvhRefitThreshold;
+        /// bits per coordinate for the compact bounding slabs (0 to keep the original tree)
+        unsigned int boundingSlabsCompact;
+
+        /// file to cache the bounding hierarchy in (empty if caching is disabled)
+        UCS2String boundingCacheFile;
+        /// set if the bounding hierarchy was read from the cache file
+        bool boundingCacheHit;
+        /// set if the bounding hierarchy was read from the cache file and refit to the current object bounds
+        bool boundingCacheRefit;
+        /// whether to remove useless manual bounds and report on the quality of the bounding hierarchy
+        bool boundingAnalysis;
+
+        /// Fingerprint of the input a top-level object was parsed from, for incremental re-rendering.
+        struct ObjectFingerprint final
+        {
+            POV_UINT64 fingerprint;
+            bool stable;    ///< Whether the fingerprint covers everything the object depends on.
+            bool global;    ///< Whether the object may affect any part of the image, e.g. as a light source.
+        };
+
+        /// file to keep the previous render in for incremental re-rendering (empty if disabled)
+        UCS2String incrementalRenderFile;
+        /// fingerprints of the top-level objects, for incremental re-rendering
+        std::map<ConstObjectPtr, ObjectFingerprint> objectFingerprints;
+        /// fingerprint of the input other than the top-level objects, for incremental re-rendering
+        POV_UINT64 environmentFingerprint;
+        /// set if @ref environmentFingerprint covers everything the image depends on
+        bool environmentFingerprintStable;
+
+        /// directory to share parsed mesh2 data and precomputed parametric bounds in (empty if sharing is disabled)
+        UCS2String meshCachePath;
+
+        /// file to write the parse profile to (empty if profiling is disabled)
+        UCS2String parseProfileFile;
 
         /// set if real-time raytracing is enabled.
         bool realTimeRaytracing;
@@ -191,9 +261,17 @@ class SceneData
         PhotonMap surfacePhotonMap;
         /// generated media photon map data // TODO FIXME - technically camera-independent, but computed for every view [trf]
         PhotonMap mediaPhotonMap;
+        /// precomputed irradiance estimates at a subset of the surface photons, if enabled
+        PhotonMap surfaceIrradianceMap;
+        /// precomputed irradiance estimates at a subset of the media photons, if enabled
+        PhotonMap mediaIrradianceMap;
 
         ScenePhotonSettings photonSettings; // TODO FIXME - is modified! [trf]
 
+        // photon map statistics
+        POV_LONG surfacePhotonBuildTime; ///< Time spent building the surface photon map kd-tree, in milliseconds.
+        POV_LONG mediaPhotonBuildTime; ///< Time spent building the media photon map kd-tree, in milliseconds.
+
         // TODO - decide if we want to keep this here
         // (we can't move it to the parser though, as part of the data needs to survive into rendering)
         std::vector<TrueTypeFont*> TTFonts;
@@ -202,6 +280,9 @@ class SceneData
         UCS2String inputFile; // TODO - handle differently
         UCS2String headerFile;
 
+        /// Names of the source files objects were parsed from, indexed by @ref ObjectBase::sourceFile.
+        std::vector<UCS2String> sourceFiles;
+
         /// Aspect ratio of the output image.
         DBL aspectRatio;
 
@@ -212,26 +293,52 @@ class SceneData
         Camera parsedCamera; // TODO - handle differently or move to parser
         bool clocklessAnimation; // TODO - this is support for an experimental feature and may be changed or removed
         std::vector<Camera> cameras; // TODO - this is support for an experimental feature and may be changed or removed
+        bool multiCamera; // INI option, defaults to false; render each camera in `cameras` as a view of its own
 
         // this is for fractal support
         int Fractal_Iteration_Stack_Length; // TODO - move somewhere else
-        int Max_Blob_Components; // TODO - move somewhere else
         // lathe and sor support (bounding cylinders)
         unsigned int Max_Bounding_Cylinders; // TODO - move somewhere else
         BBOX_TREE *boundingSlabs;
+        /// compact copy of the bounding slabs, replacing @ref boundingSlabs if present
+        CompactBBoxTree *compactSlabs;
 
         // TODO FIXME move to parser somehow
         bool splitUnions; // INI option, defaults to false
         bool removeBounds; // INI option, defaults to true
+        bool mergeTriangles; // INI option, defaults to true
 
         // experimental
         BSPTree *tree;
+        BVHTree *bvhTree;
+        /// infinite planes tested ahead of the BSP or BVH tree, or `nullptr` if there are none;
+        /// these are the first of the infinite objects in @ref objects
+        PlaneSet *planeSet;
+
+        /// light intensity below which distance-fading light sources are culled (0 to evaluate all of them)
+        DBL lightThreshold; // INI option, defaults to 0
+        /// hierarchy of the global light sources, or `nullptr` if culling is disabled
+        LightTree *lightTree;
         unsigned int numberOfFiniteObjects;
         unsigned int numberOfInfiniteObjects;
 
+        // mesh import statistics
+        POV_LONG meshImportTriangles; ///< Number of triangles read from OBJ and PLY files.
+        POV_LONG meshImportTime; ///< Time spent reading OBJ and PLY files, in milliseconds.
+        POV_LONG symbolLookups; ///< Number of identifier lookups during parsing.
+        POV_LONG symbolProbes; ///< Number of symbol table slots inspected by identifier lookups.
+        POV_LONG declarationsReused; ///< Number of declarations taken from previous parses.
+        POV_LONG declarationsEvaluated; ///< Number of declarations evaluated and offered for reuse.
+        POV_LONG meshCacheHits; ///< Number of mesh2 objects taken from the mesh cache directory.
+        POV_LONG meshCacheWrites; ///< Number of mesh2 objects written to the mesh cache directory.
+        POV_LONG heightFieldPoints; ///< Number of height field elevation points prepared.
+        POV_LONG heightFieldTime; ///< Time spent preparing height fields, in milliseconds.
+
         // BSP statistics // TODO - not sure if this is the best place for stats
+        // (the BVH tree re-uses nodes, objectNodes, maxObjects, averageObjects, maxDepth and averageDepth)
         unsigned int nodes, splitNodes, objectNodes, emptyNodes, maxObjects, maxDepth, aborts;
         float averageObjects, averageDepth, averageAborts, averageAbortObjects;
+        std::vector<POV_LONG> bspDepthTimes; ///< BSP split selection time per tree depth, in microseconds
 
 
         /// Convenience function to determine the effective SDL version.
@@ -40,16 +40,18 @@
 //  (none at the moment)
 
 // C++ standard header files
+#include <algorithm>
 #include <limits>
 
 // POV-Ray header files (base module)
-//  (none at the moment)
+#include "base/mathutil.h"
 
 // POV-Ray header files (core module)
 #include "core/material/noise.h"
 #include "core/scene/scenedata.h"
 #include "core/shape/blob.h"
 #include "core/shape/fractal.h"
+#include "core/shape/isosurface.h"
 #include "core/support/cracklecache.h"
 
 // this must be the last file included
@@ -58,23 +60,112 @@
 namespace pov
 {
 
+RenderFootprint::RenderFootprint(const Vector3d& lo, const Vector3d& hi) :
+    gridOrigin(lo),
+    lastObject(nullptr)
+{
+    for (int i = 0; i < 3; ++i)
+        cellSize[i] = std::max((hi[i] - lo[i]) / kGridSize, EPSILON);
+    Clear();
+}
+
+void RenderFootprint::Clear()
+{
+    objects.clear();
+    lastObject = nullptr;
+    for (unsigned int i = 0; i < kCellWords; ++i)
+        cells[i] = 0;
+}
+
+void RenderFootprint::AddSegment(const Vector3d& origin, const Vector3d& direction, DBL depth)
+{
+    // Clip the segment to the grid.
+    DBL tMin = 0.0;
+    DBL tMax = depth;
+    for (int i = 0; i < 3; ++i)
+    {
+        DBL lo = gridOrigin[i];
+        DBL hi = gridOrigin[i] + cellSize[i] * kGridSize;
+        if (fabs(direction[i]) < EPSILON)
+        {
+            if ((origin[i] < lo) || (origin[i] > hi))
+                return;
+        }
+        else
+        {
+            DBL t0 = (lo - origin[i]) / direction[i];
+            DBL t1 = (hi - origin[i]) / direction[i];
+            if (t0 > t1)
+                std::swap(t0, t1);
+            tMin = std::max(tMin, t0);
+            tMax = std::min(tMax, t1);
+        }
+    }
+    if (tMin > tMax)
+        return;
+
+    // Walk the cells along the clipped segment (Amanatides & Woo).
+    Vector3d start = origin + direction * tMin;
+    int cell[3];
+    int step[3];
+    DBL next[3];
+    DBL delta[3];
+    for (int i = 0; i < 3; ++i)
+    {
+        cell[i] = clip<int>(int(floor((start[i] - gridOrigin[i]) / cellSize[i])), 0, kGridSize - 1);
+        if (direction[i] >= EPSILON)
+        {
+            step[i]  = 1;
+            next[i]  = tMin + (gridOrigin[i] + (cell[i] + 1) * cellSize[i] - start[i]) / direction[i];
+            delta[i] = cellSize[i] / direction[i];
+        }
+        else if (direction[i] <= -EPSILON)
+        {
+            step[i]  = -1;
+            next[i]  = tMin + (gridOrigin[i] + cell[i] * cellSize[i] - start[i]) / direction[i];
+            delta[i] = -cellSize[i] / direction[i];
+        }
+        else
+        {
+            step[i]  = 0;
+            next[i]  = HUGE_VAL;
+            delta[i] = HUGE_VAL;
+        }
+    }
+
+    while (true)
+    {
+        unsigned int index = CellIndex(cell[X], cell[Y], cell[Z]);
+        cells[index / 64] |= POV_UINT64(1) << (index % 64);
+
+        int axis = (next[X] < next[Y]) ? ((next[X] < next[Z]) ? X : Z) : ((next[Y] < next[Z]) ? Y : Z);
+        if (next[axis] > tMax)
+            break;
+        cell[axis] += step[axis];
+        if ((cell[axis] < 0) || (cell[axis] >= int(kGridSize)))
+            break;
+        next[axis] += delta[axis];
+    }
+}
+
+//******************************************************************************
+
 TraceThreadData::TraceThreadData(std::shared_ptr<SceneData> sd, size_t seed) :
     sceneData(sd),
     qualityFlags(9),
+    pixelFootprintBase(0.0),
+    pixelFootprintSlope(0.0),
     stochasticRandomGenerator(GetRandomDoubleGenerator(0.0,1.0)),
     stochasticRandomSeedBase(seed),
-    mpCrackleCache(new CrackleCache),
-    mpRenderStats(new RenderStatistics)
+    sampleSequence((unsigned int)seed),
+    mpCrackleCache(sd->crackleCache.get()),
+    mpCrackleCell(new CrackleCacheEntry),
+    mpRenderStats(new RenderStatistics),
+    mailbox(*mpRenderStats)
 {
     for(int i = 0; i < 4; i++)
         Fractal_IStack[i] = nullptr;
     Fractal::Allocate_Iteration_Stack(Fractal_IStack, sceneData->Fractal_Iteration_Stack_Length);
-    Max_Blob_Queue_Size = 1;
-    Blob_Coefficient_Count = sceneData->Max_Blob_Components * 5;
-    Blob_Interval_Count = sceneData->Max_Blob_Components * 2;
-    Blob_Queue = reinterpret_cast<void **>(POV_MALLOC(sizeof(void *), "Blob Queue"));
-    Blob_Coefficients = reinterpret_cast<DBL *>(POV_MALLOC(sizeof(DBL) * Blob_Coefficient_Count, "Blob Coefficients"));
-    Blob_Intervals = new Blob_Interval_Struct [Blob_Interval_Count];
 
     BCyl_Intervals.reserve(4*sceneData->Max_Bounding_Cylinders);
     BCyl_RInt.reserve(2*sceneData->Max_Bounding_Cylinders);
@@ -82,6 +173,10 @@ TraceThreadData::TraceThreadData(std::shared_ptr<SceneData> sd, size_t seed) :
 
     Facets_Last_Seed = 0x80000000;
 
+    functionProfiling = false;
+    objectProfiling = false;
+    objectProfileCountdown = 0;
+
     timeType = kUnknownTime;
     cpuTime = 0;
     realTime = 0;
@@ -90,6 +185,8 @@ TraceThreadData::TraceThreadData(std::shared_ptr<SceneData> sd, size_t seed) :
 
     for(std::vector<LightSource *>::iterator it = sceneData->lightSources.begin(); it != sceneData->lightSources.end(); it++)
         lightSources.push_back(static_cast<LightSource *> (Copy_Object(*it)));
+    shadowOccluderCaches.resize(2 * lightSources.size());
+    patternCache.enabled = sceneData->patternCache;
 
     // all of these are for photons
     LightSource *photonLight = nullptr;
@@ -113,24 +210,33 @@ TraceThreadData::TraceThreadData(std::shared_ptr<SceneData> sd, size_t seed) :
 
 TraceThreadData::~TraceThreadData()
 {
+    // measurements from tasks without tiles, e.g. photon shooting
+    FlushIsosurfaceGradients();
+
     for(std::vector<GenericFunctionContext*>::iterator i = functionContextPool.begin(); i != functionContextPool.end(); ++i)
         delete *i;
 
-    POV_FREE(Blob_Coefficients);
-    POV_FREE(Blob_Queue);
     Fractal::Free_Iteration_Stack(Fractal_IStack);
     delete surfacePhotonMap;
     delete mediaPhotonMap;
-    delete[] Blob_Intervals;
     for(std::vector<LightSource *>::iterator it = lightSources.begin(); it != lightSources.end(); it++)
         Destroy_Object(*it);
-    delete mpCrackleCache;
+    delete mpCrackleCell;
     delete mpRenderStats;
 }
 
 void TraceThreadData::AfterTile()
 {
-    mpCrackleCache->Prune();
+    FlushIsosurfaceGradients();
+    for (auto& cache : shadowOccluderCaches)
+        cache.Clear();
+}
+
+void TraceThreadData::FlushIsosurfaceGradients()
+{
+    for (auto& entry : isosurfaceGradients)
+        entry.first->MergeGradients(entry.second);
+    isosurfaceGradients.clear();
 }
 
 }
@@ -40,23 +40,30 @@
 #include "core/configcore.h"
 
 // C++ variants of C standard header files
-//  (none at the moment)
+#include <cstring>
 
 // C++ standard header files
 #include <memory>
 #include <stack>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 // POV-Ray header files (base module)
 #include "base/types.h"
 #include "base/colour.h"
+#include "base/timer.h"
 
 // POV-Ray header files (core module)
 #include "core/coretypes.h"
 #include "core/bounding/boundingcylinder.h"
+#include "core/bounding/bsptree.h"
 #include "core/math/randomsequence_fwd.h"
+#include "core/math/samplesequence.h"
 #include "core/math/vector.h"
 #include "core/scene/scenedata_fwd.h"
+#include "core/shape/blob.h"
+#include "core/shape/spheresweep.h"
 #include "core/support/cracklecache_fwd.h"
 #include "core/support/statistics_fwd.h"
 
@@ -71,8 +78,224 @@ namespace pov
 
 using namespace pov_base;
 
+class IsoSurface;
 class PhotonMap;
-struct Blob_Interval_Struct;
+
+/// Gradient measurements of an isosurface, collected by a single thread.
+///
+/// These are kept per thread to avoid concurrent writes to the shared object, and are merged
+/// into the object's statistics by @ref TraceThreadData::AfterTile().
+///
+struct IsosurfaceGradients final
+{
+    DBL maxGradient;        ///< Working estimate of the maximum gradient; raised during the tile if `evaluate` is set.
+    DBL gradient;           ///< Maximum gradient measured.
+    DBL evalMax;            ///< Maximum of the estimates used for roots found with `evaluate`.
+    DBL evalCount;          ///< Number of roots found with `evaluate`.
+    DBL evalGradientSum;    ///< Sum of the estimates used for roots found with `evaluate`.
+    DBL evalVariation;      ///< Maximum change of the estimate while finding a root with `evaluate`.
+
+    IsosurfaceGradients(DBL mg) :
+        maxGradient(mg), gradient(0.0), evalMax(0.0), evalCount(0.0), evalGradientSum(0.0), evalVariation(0.0)
+    {}
+};
+
+/// Profiling data of a user-defined function, collected by a single thread.
+///
+/// Collected only if @ref TraceThreadData::functionProfiling is set, and merged into the
+/// render statistics at the end of the render.
+///
+struct FunctionProfileData final
+{
+    UTF8String  name;           ///< Name of the function, or a description of where it was defined.
+    POV_ULONG   calls;          ///< Number of calls, including calls from other functions.
+    POV_ULONG   instructions;   ///< Number of VM instructions executed in the function itself.
+    POV_ULONG   time;           ///< Time spent in the function itself, in nanoseconds.
+
+    FunctionProfileData() : calls(0), instructions(0), time(0) {}
+};
+
+/// Profiling data of a scene object, collected by a single thread.
+///
+/// Collected only if @ref TraceThreadData::objectProfiling is set, and merged into the
+/// render statistics at the end of the render. Only one in @ref kObjectProfileTimingInterval
+/// intersection tests is timed, to keep the overhead of reading the clock low.
+///
+struct ObjectProfileData final
+{
+    POV_ULONG   tests;          ///< Number of intersection tests, not counting those rejected by the bounding box.
+    POV_ULONG   hits;           ///< Number of intersection tests finding at least one intersection.
+    POV_ULONG   timedTests;     ///< Number of intersection tests timed.
+    POV_ULONG   time;           ///< Time spent in the timed intersection tests, in nanoseconds.
+
+    ObjectProfileData() : tests(0), hits(0), timedTests(0), time(0) {}
+
+    /// Estimated time spent in all intersection tests, in nanoseconds.
+    POV_ULONG EstimatedTime() const { return (timedTests > 0) ? static_cast<POV_ULONG>(double(time) * tests / timedTests) : 0; }
+};
+
+/// Interval at which intersection tests are timed for the object profile.
+const unsigned int kObjectProfileTimingInterval = 16;
+
+/// Opaque objects recently found to fully shadow a light source, most recently used first.
+///
+/// Adjacent pixels tend to be shadowed by the same few objects, so testing these first
+/// often saves the traversal of the bounding hierarchy.
+///
+struct ShadowOccluderCache final
+{
+    static constexpr size_t kSize = 4;
+
+    ObjectPtr objects[kSize];
+
+    ShadowOccluderCache() { Clear(); }
+
+    void Clear()
+    {
+        for (size_t i = 0; i < kSize; ++i)
+            objects[i] = nullptr;
+    }
+
+    /// Move an entry to the front.
+    void Touch(size_t i)
+    {
+        ObjectPtr object = objects[i];
+        for (; i > 0; --i)
+            objects[i] = objects[i - 1];
+        objects[0] = object;
+    }
+
+    /// Add an object at the front, dropping the least recently used entry if necessary.
+    void Insert(ObjectPtr object)
+    {
+        size_t i = 0;
+        while ((i < kSize - 1) && (objects[i] != nullptr) && (objects[i] != object))
+            ++i;
+        objects[i] = object;
+        Touch(i);
+    }
+};
+
+/// Pattern values recently computed by a thread, for the intersection currently being shaded.
+///
+/// Layered textures and normals may evaluate the same pattern more than once at the same point;
+/// this direct-mapped table lets those evaluations share the result. Entries are tagged with a
+/// generation number, so that starting on a new intersection merely bumps the counter.
+///
+/// @note   Only patterns that depend on nothing but the point may be cached; see
+///         @ref BasicPattern::DependsOnIntersection().
+///
+struct PatternValueCache final
+{
+    static constexpr size_t kSize = 64;
+
+    struct Entry final
+    {
+        const BasicPattern* pattern;
+        Vector3d            point;
+        DBL                 value;
+        unsigned int        generation;
+    };
+
+    Entry           entries[kSize];
+    unsigned int    generation;
+    bool            enabled;
+
+    PatternValueCache() : generation(1), enabled(false)
+    {
+        for (size_t i = 0; i < kSize; ++i)
+        {
+            entries[i].pattern = nullptr;
+            entries[i].generation = 0;
+        }
+    }
+
+    /// Invalidate all entries, typically because a new intersection is about to be shaded.
+    void NextIntersection()
+    {
+        if (++generation == 0)
+        {
+            for (size_t i = 0; i < kSize; ++i)
+                entries[i].generation = 0;
+            generation = 1;
+        }
+    }
+
+    /// Get the table slot for a given pattern and point.
+    Entry& Slot(const BasicPattern* pattern, const Vector3d& point)
+    {
+        size_t hash = reinterpret_cast<size_t>(pattern) >> 4;
+        for (int i = X; i <= Z; ++i)
+        {
+            DBL coord = point[i];
+            POV_UINT64 bits;
+            std::memcpy(&bits, &coord, sizeof(bits));
+            hash = (hash ^ size_t(bits ^ (bits >> 29))) * size_t(0x9E3779B97F4A7C15ull);
+        }
+        return entries[(hash >> 16) % kSize];
+    }
+
+    /// Look up a pattern value.
+    /// @return     `true` if the value was found.
+    bool Lookup(DBL& value, const BasicPattern* pattern, const Vector3d& point)
+    {
+        const Entry& entry = Slot(pattern, point);
+        if ((entry.generation != generation) || (entry.pattern != pattern) ||
+            (entry.point[X] != point[X]) || (entry.point[Y] != point[Y]) || (entry.point[Z] != point[Z]))
+            return false;
+        value = entry.value;
+        return true;
+    }
+
+    /// Store a pattern value, replacing whatever occupied its slot.
+    void Store(const BasicPattern* pattern, const Vector3d& point, DBL value)
+    {
+        Entry& entry = Slot(pattern, point);
+        entry.pattern    = pattern;
+        entry.point      = point;
+        entry.value      = value;
+        entry.generation = generation;
+    }
+};
+
+/// Parts of the scene visited by the rays of a thread while rendering a block.
+///
+/// Used by incremental re-rendering to tell which blocks an edit of the scene may affect. Rays
+/// record the top-level objects they hit, as well as the cells of a coarse grid over the scene
+/// they pass through; the latter allow objects added in a later version of the scene to be
+/// tested against the block as well.
+///
+struct RenderFootprint final
+{
+    static constexpr unsigned int kGridSize  = 16;
+    static constexpr unsigned int kCellWords = kGridSize * kGridSize * kGridSize / 64;
+
+    Vector3d                            gridOrigin;
+    Vector3d                            cellSize;
+    std::unordered_set<ConstObjectPtr>  objects;            ///< Top-level objects hit.
+    ConstObjectPtr                      lastObject;         ///< Most recently added to @ref objects.
+    POV_UINT64                          cells[kCellWords];  ///< One bit per grid cell passed through.
+
+    /// Set up an empty footprint.
+    /// @param  lo  Low corner of the grid.
+    /// @param  hi  High corner of the grid.
+    RenderFootprint(const Vector3d& lo, const Vector3d& hi);
+
+    void Clear();
+
+    void AddObject(ConstObjectPtr object)
+    {
+        if (object == lastObject)
+            return;
+        objects.insert(object);
+        lastObject = object;
+    }
+
+    /// Mark the grid cells a ray passes through up to the specified depth.
+    void AddSegment(const Vector3d& origin, const Vector3d& direction, DBL depth);
+
+    static unsigned int CellIndex(unsigned int x, unsigned int y, unsigned int z) { return (z * kGridSize + y) * kGridSize + x; }
+};
 
 /// Class holding parser thread specific data.
 class TraceThreadData : public ThreadData
@@ -92,18 +315,42 @@ class TraceThreadData : public ThreadData
         /// @return     Reference to statistic counters.
         RenderStatistics& Stats(void) { return *mpRenderStats; }
 
+        /// Get the BSP tree mailbox.
+        /// @note   The mailbox is shared by all BSP tree queries made by this thread, and must be
+        ///         sized via @ref BSPTree::Mailbox::resize() before first use.
+        /// @return     Reference to the mailbox.
+        BSPTree::Mailbox& GetMailbox() { return mailbox; }
+
+        /// Get the shadow occluder cache of a global light source.
+        /// @param  index       Index of the light source.
+        /// @param  level1      Whether the cache for primary intersections is requested.
+        /// @return     Reference to the cache, which is cleared by @ref AfterTile().
+        ShadowOccluderCache& GetShadowOccluderCache(size_t index, bool level1) { return shadowOccluderCaches[2 * index + (level1 ? 0 : 1)]; }
+
+        /// Get the pattern value cache.
+        /// @return     Reference to the cache, which is enabled via the scene's `pattern_cache` setting.
+        PatternValueCache& GetPatternCache() { return patternCache; }
+
         DBL *Fractal_IStack[4];
-        void **Blob_Queue;
-        unsigned int Max_Blob_Queue_Size;
-        DBL *Blob_Coefficients;
-        Blob_Interval_Struct *Blob_Intervals;
-        int Blob_Coefficient_Count;
-        int Blob_Interval_Count;
+        std::vector<DBL> Blob_Coefficients;
+        std::vector<Blob_Interval_Struct> Blob_Intervals;
         std::vector<BCYL_INT> BCyl_Intervals;
         std::vector<BCYL_INT> BCyl_RInt;
         std::vector<BCYL_INT> BCyl_HInt;
+        SphereSweepBuffers SphereSweep_Buffers;
         IStackPool stackPool;
         std::vector<GenericFunctionContextPtr> functionContextPool;
+        /// Whether to collect @ref functionProfile.
+        bool functionProfiling;
+        /// Profiling data of user-defined functions, indexed by function reference number.
+        std::vector<FunctionProfileData> functionProfile;
+        /// Whether to collect @ref objectProfile.
+        bool objectProfiling;
+        /// Number of intersection tests until the next one to be timed for @ref objectProfile.
+        unsigned int objectProfileCountdown;
+        /// Profiling data of scene objects.
+        std::unordered_map<ConstObjectPtr, ObjectProfileData> objectProfile;
+        std::unordered_map<const IsoSurface*, IsosurfaceGradients> isosurfaceGradients;
         int Facets_Last_Seed;
         int Facets_CVC;
         Vector3d Facets_Cube[81];
@@ -112,6 +359,11 @@ class TraceThreadData : public ThreadData
         SeedableDoubleGeneratorPtr stochasticRandomGenerator;
         size_t stochasticRandomSeedBase;
 
+        /// Well-distributed sample values for stochastic sampling.
+        SampleSequence sampleSequence;
+        /// Pixel sample currently being traced by a stochastic pixel sampler, if any.
+        SampleSequence::Context sampleContext;
+
         // TODO FIXME - thread-local copy of lightsources. we need this
         // because various parts of the lighting code seem to make changes
         // to the lightsource object passed to them (this is not confined
@@ -134,7 +386,10 @@ class TraceThreadData : public ThreadData
         PhotonMap* surfacePhotonMap;
         PhotonMap* mediaPhotonMap;
 
+        /// Crackle cell cache shared by all threads.
         CrackleCache* mpCrackleCache;
+        /// Most recently used crackle cell, to avoid locking the shared cache for coherent queries.
+        CrackleCacheEntry* mpCrackleCell;
 
         // data for waves and ripples pattern
         unsigned int numberOfWaves;
@@ -142,7 +397,8 @@ class TraceThreadData : public ThreadData
         std::vector<Vector3d> waveSources;
 
         /// Called after a rectangle is finished.
-        /// Used for crackle cache expiry.
+        /// Used to merge the isosurface gradient measurements, and to clear the shadow
+        /// occluder caches.
         void AfterTile();
 
         /// Used by the crackle pattern to indicate age of cache entries.
@@ -163,8 +419,19 @@ class TraceThreadData : public ThreadData
         TimeType timeType;
         POV_LONG cpuTime;
         POV_LONG realTime;
+        PerformanceCounts eventCounts; ///< Hardware events counted in the thread, if enabled.
         QualityFlags qualityFlags; // TODO FIXME - remove again
 
+        /// Parts of the scene visited while rendering the current block, or `nullptr` unless
+        /// incremental re-rendering is enabled.
+        std::unique_ptr<RenderFootprint> footprint;
+
+        /// Radius of the footprint of a pixel at the camera, in world units.
+        /// Zero if unknown; used to choose the level of detail of image maps.
+        DBL pixelFootprintBase;
+        /// Increase of the radius of the footprint of a pixel per unit of distance.
+        DBL pixelFootprintSlope;
+
         inline std::shared_ptr<const SceneData> GetSceneData() const { return sceneData; }
 
     protected:
@@ -172,6 +439,12 @@ class TraceThreadData : public ThreadData
         std::shared_ptr<SceneData> sceneData;
         /// render statistics
         RenderStatistics* mpRenderStats;
+        /// BSP tree mailbox
+        BSPTree::Mailbox mailbox;
+        /// shadow occluder caches, two per global light source
+        std::vector<ShadowOccluderCache> shadowOccluderCaches;
+        /// pattern value cache
+        PatternValueCache patternCache;
 
     private:
 
@@ -181,6 +454,12 @@ class TraceThreadData : public ThreadData
 
         /// current tile index (for crackle cache expiry)
         size_t progress_index;
+
+        /// Merge the isosurface gradient measurements into the objects' statistics.
+        /// @note   This also resets the working estimates, so that each tile starts out with
+        ///         the `max_gradient` values specified in the scene, independent of which
+        ///         thread happens to render it.
+        void FlushIsosurfaceGradients();
 };
 
 /// @}
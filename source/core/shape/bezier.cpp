@@ -1623,7 +1623,7 @@ bool BicubicPatch::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceT
 
     Found = false;
 
-    Thread->Stats()[Ray_Bicubic_Tests]++;
+    Thread->Stats().Shape(Ray_Bicubic_Tests)++;
 
     switch (Patch_Type)
     {
@@ -1646,7 +1646,7 @@ bool BicubicPatch::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceT
 
     if (cnt > 0)
     {
-        Thread->Stats()[Ray_Bicubic_Tests_Succeeded]++;
+        Thread->Stats().Shape(Ray_Bicubic_Tests_Succeeded)++;
 
         Found = true;
     }
@@ -1876,15 +1876,7 @@ void BicubicPatch::Scale(const Vector3d& Vector, const TRANSFORM *)
 
 void BicubicPatch::Transform(const TRANSFORM *tr)
 {
-    int i, j;
-
-    for (i = 0; i < 4; i++)
-    {
-        for (j = 0; j < 4; j++)
-        {
-            MTransPoint(Control_Points[i][j], Control_Points[i][j], tr);
-        }
-    }
+    MTransPoints(&Control_Points[0][0], &Control_Points[0][0], 16, tr);
 
     Precompute_Patch_Values();
 
@@ -2186,5 +2178,62 @@ void BicubicPatch::Compute_Texture_UV(const Vector2d& p, const Vector2d st[4], V
     t[1] = u1[1] + p[1] * (u2[1] - u1[1]);
 }
 
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   evalVertex, evalNormal, evalUV, minUV, maxUV
+*
+* INPUT
+*
+* OUTPUT
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Evaluate the patch at a given point of its parameter domain, as needed
+*   to tessellate it.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+void BicubicPatch::evalVertex(Vector3d& r, const DBL u, const DBL v, TraceThreadData *) const
+{
+    Vector3d N;
+
+    bezier_value(&Control_Points, u, v, r, N);
+}
+
+void BicubicPatch::evalNormal(Vector3d& r, const DBL u, const DBL v, TraceThreadData *) const
+{
+    Vector3d P;
+
+    bezier_value(&Control_Points, u, v, P, r);
+}
+
+void BicubicPatch::evalUV(Vector2d& r, const DBL u, const DBL v) const
+{
+    /* the texture mapping has u and v swapped, see bezier_subpatch_intersect */
+    Compute_Texture_UV(Vector2d(v, u), ST, r);
+}
+
+void BicubicPatch::minUV(Vector2d& r) const
+{
+    r = Vector2d(0.0, 0.0);
+}
+
+void BicubicPatch::maxUV(Vector2d& r) const
+{
+    r = Vector2d(1.0, 1.0);
+}
+
 }
 // end of namespace pov
@@ -48,6 +48,7 @@
 
 // POV-Ray header files (core module)
 #include "core/scene/object.h"
+#include "core/shape/uvmeshable.h"
 
 namespace pov
 {
@@ -100,7 +101,7 @@ struct Bezier_Vertices_Struct final
 };
 using BEZIER_VERTICES = Bezier_Vertices_Struct; ///< @deprecated
 
-class BicubicPatch final : public NonsolidObject
+class BicubicPatch final : public NonsolidObject, public UVMeshable
 {
     public:
         typedef Vector3d ControlPoints[4][4];
@@ -129,6 +130,12 @@ class BicubicPatch final : public NonsolidObject
         virtual void Compute_BBox() override;
 
         void Precompute_Patch_Values();
+
+        virtual void evalVertex(Vector3d& r, const DBL u, const DBL v, TraceThreadData *Thread) const override;
+        virtual void evalNormal(Vector3d& r, const DBL u, const DBL v, TraceThreadData *Thread) const override;
+        virtual void evalUV(Vector2d& r, const DBL u, const DBL v) const override;
+        virtual void minUV(Vector2d& r) const override;
+        virtual void maxUV(Vector2d& r) const override;
     protected:
         typedef Vector3d TripleVector3d[3];
         typedef DBL      TripleDouble[3];
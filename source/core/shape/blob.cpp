@@ -98,7 +98,7 @@
 #include "core/shape/blob.h"
 
 // C++ variants of C standard header files
-#include <cstring>
+//  (none at the moment)
 
 // C++ standard header files
 #include <algorithm>
@@ -109,7 +109,6 @@
 
 // POV-Ray header files (core module)
 #include "core/bounding/boundingbox.h"
-#include "core/bounding/boundingsphere.h"
 #include "core/material/texture.h"
 #include "core/math/matrix.h"
 #include "core/math/polynomialsolver.h"
@@ -141,6 +140,45 @@ const DBL INSIDE_TOLERANCE = 1.0e-6;
 const int ENTERING = 0;
 const int EXITING  = BLOB_ENTER_EXIT_FLAG;
 
+/* Number of children per node of the bounding hierarchy. */
+const unsigned int BLOB_BVH_WIDTH = 4;
+
+/* Maximum number of components per leaf of the bounding hierarchy. */
+const unsigned int BLOB_BVH_LEAF_COMPONENTS = 4;
+
+/* Number of components whose coefficients are calculated at once. */
+const unsigned int BLOB_COEFFICIENT_BATCH = 16;
+
+
+/*****************************************************************************
+* Local typedefs
+******************************************************************************/
+
+/// Component bounds as seen by the tree building code.
+class BlobBVHObjects final : public BSPTree::Objects
+{
+    public:
+
+        BlobBVHObjects(const vector<MinMaxBoundingBox>& b) : boxes(b) { }
+        virtual ~BlobBVHObjects() override { }
+
+        virtual unsigned int size() const override { return (unsigned int)boxes.size(); }
+        virtual float GetMin(unsigned int axis, unsigned int i) const override { return boxes[i].pmin[axis]; }
+        virtual float GetMax(unsigned int axis, unsigned int i) const override { return boxes[i].pmax[axis]; }
+
+    private:
+
+        const vector<MinMaxBoundingBox>& boxes;
+};
+
+class BlobBVHNoProgress final : public BSPTree::Progress
+{
+    public:
+
+        virtual void operator()(unsigned int) const override { }
+};
+
+
 
 /*****************************************************************************
 *
@@ -238,22 +276,22 @@ const int EXITING  = BLOB_ENTER_EXIT_FLAG;
 
 bool Blob::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThreadData *Thread)
 {
-    int i, j, cnt;
+    int i, j, cnt, computed;
     int root_count, in_flag;
     int Intersection_Found = false;
-    DBL t0, t1, t2, c0, c1, c2, dist, len, start_dist;
+    DBL dist, len, start_dist;
     DBL *fcoeffs;
+    DBL *coefficients;
     DBL coeffs[5];
     DBL roots[4];
-    Vector3d P, D, V1, PP, DD;
+    Vector3d P, D;
     Vector3d IPoint;
-    const Blob_Element *Element;
     DBL newcoeffs[5], dk[5];
     DBL max_bound;
     DBL l, w;
     DBL depthTolerance = (ray.IsSubsurfaceRay()? 0 : DEPTH_TOLERANCE);
 
-    Thread->Stats()[Ray_Blob_Tests]++;
+    Thread->Stats().Shape(Ray_Blob_Tests)++;
 
     /* Transform the ray into blob space. */
 
@@ -274,13 +312,19 @@ bool Blob::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThreadDat
     }
 
     /* Get the intervals along the ray where each component has an effect. */
-    Blob_Interval_Struct* intervals = Thread->Blob_Intervals;
-    if ((cnt = determine_influences(P, D, depthTolerance, intervals, Thread)) == 0)
+    if ((cnt = determine_influences(P, D, depthTolerance, Thread->Blob_Intervals, Thread)) == 0)
     {
         /* Ray doesn't hit any of the component elements. */
         return (false);
     }
 
+    Blob_Interval_Struct* intervals = Thread->Blob_Intervals.data();
+
+    /* Coefficients are calculated in batches as the components are entered. */
+    Thread->Blob_Coefficients.resize(cnt / 2 * 5);
+    coefficients = Thread->Blob_Coefficients.data();
+    computed = 0;
+
     /* To avoid numerical problems we start at the first interval. */
 
     if ((start_dist = intervals[0].bound) < SMALL_TOLERANCE)
@@ -340,108 +384,10 @@ bool Blob::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThreadDat
 
             in_flag++;
 
-            Element = intervals[i].Element;
-            fcoeffs = &Thread->Blob_Coefficients[Element->index * 5];
-
-            switch (Element->Type)
-            {
-                case BLOB_SPHERE:
-
-                    V1 = P - Element->O;
-
-                    t0 = V1.lengthSqr();
-                    t1 = dot(V1, D);
-                    t2 = max_bound * max_bound;
-
-                    c0 = Element->c[0];
-                    c1 = Element->c[1];
-                    c2 = Element->c[2];
-
-                    fcoeffs[0] = c0 * t2 * t2;
-                    fcoeffs[1] = 4.0 * c0 * t1 * t2;
-                    fcoeffs[2] = 2.0 * c0 * (2.0 * t1 * t1 + t0 * t2) + c1 * t2;
-                    fcoeffs[3] = 2.0 * t1 * (2.0 * c0 * t0 + c1);
-                    fcoeffs[4] = t0 * (c0 * t0 + c1) + c2;
-
-                    break;
+            if (i >= computed)
+                computed = calculate_coefficients(intervals, i, cnt, P, D, max_bound, coefficients);
 
-                case BLOB_ELLIPSOID:
-
-                    MInvTransPoint(PP, P, Element->Trans);
-                    MInvTransDirection(DD, D, Element->Trans);
-
-                    V1 = PP - Element->O;
-
-                    t0 = V1.lengthSqr();
-                    t1 = dot(V1, DD);
-                    t2 = DD.lengthSqr();
-
-                    c0 = Element->c[0];
-                    c1 = Element->c[1];
-                    c2 = Element->c[2];
-
-                    fcoeffs[0] = c0 * t2 * t2;
-                    fcoeffs[1] = 4.0 * c0 * t1 * t2;
-                    fcoeffs[2] = 2.0 * c0 * (2.0 * t1 * t1 + t0 * t2) + c1 * t2;
-                    fcoeffs[3] = 2.0 * t1 * (2.0 * c0 * t0 + c1);
-                    fcoeffs[4] = t0 * (c0 * t0 + c1) + c2;
-
-                    break;
-
-                case BLOB_BASE_HEMISPHERE:
-                case BLOB_APEX_HEMISPHERE:
-
-                    MInvTransPoint(PP, P, Element->Trans);
-                    MInvTransDirection(DD, D, Element->Trans);
-
-                    if (Element->Type == BLOB_APEX_HEMISPHERE)
-                    {
-                        PP[Z] -= Element->len;
-                    }
-
-                    t0 = PP.lengthSqr();
-                    t1 = dot(PP, DD);
-                    t2 = DD.lengthSqr();
-
-                    c0 = Element->c[0];
-                    c1 = Element->c[1];
-                    c2 = Element->c[2];
-
-                    fcoeffs[0] = c0 * t2 * t2;
-                    fcoeffs[1] = 4.0 * c0 * t1 * t2;
-                    fcoeffs[2] = 2.0 * c0 * (2.0 * t1 * t1 + t0 * t2) + c1 * t2;
-                    fcoeffs[3] = 2.0 * t1 * (2.0 * c0 * t0 + c1);
-                    fcoeffs[4] = t0 * (c0 * t0 + c1) + c2;
-
-                    break;
-
-                case BLOB_CYLINDER:
-
-                    /* Transform ray into cylinder space. */
-
-                    MInvTransPoint(PP, P, Element->Trans);
-                    MInvTransDirection(DD, D, Element->Trans);
-
-                    t0 = PP[X] * PP[X] + PP[Y] * PP[Y];
-                    t1 = PP[X] * DD[X] + PP[Y] * DD[Y];
-                    t2 = DD[X] * DD[X] + DD[Y] * DD[Y];
-
-                    c0 = Element->c[0];
-                    c1 = Element->c[1];
-                    c2 = Element->c[2];
-
-                    fcoeffs[0] = c0 * t2 * t2;
-                    fcoeffs[1] = 4.0 * c0 * t1 * t2;
-                    fcoeffs[2] = 2.0 * c0 * (2.0 * t1 * t1 + t0 * t2) + c1 * t2;
-                    fcoeffs[3] = 2.0 * t1 * (2.0 * c0 * t0 + c1);
-                    fcoeffs[4] = t0 * (c0 * t0 + c1) + c2;
-
-                    break;
-
-                default:
-
-                    throw POV_EXCEPTION_STRING("Unknown blob component in All_Blob_Intersections().");
-            }
+            fcoeffs = &coefficients[intervals[i].hit * 5];
 
             for (j = 0; j < 5; j++)
             {
@@ -454,7 +400,7 @@ bool Blob::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThreadDat
              * We are losing the influence of a component -->
              * subtract off its coefficients.
              */
-            fcoeffs = &Thread->Blob_Coefficients[intervals[i].Element->index * 5];
+            fcoeffs = &coefficients[intervals[i].hit * 5];
 
             for (j = 0; j < 5; j++)
             {
@@ -567,7 +513,7 @@ bool Blob::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThreadDat
     }
 
     if (Intersection_Found)
-        Thread->Stats()[Ray_Blob_Tests_Succeeded]++;
+        Thread->Stats().Shape(Ray_Blob_Tests_Succeeded)++;
 
     return (Intersection_Found);
 }
@@ -578,18 +524,112 @@ bool Blob::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThreadDat
 *
 * FUNCTION
 *
-*   insert_hit
+*   calculate_coefficients
 *
 * INPUT
 *
-*   Blob      - Pointer to blob structure
-*   Element   - Element to insert
-*   t0, t1    - Intersection depths
+*   intervals  - Sorted list of hits
+*   first      - Index of the first hit to process
+*   cnt        - Number of hits in intervals
+*   P, D       - Ray = P + t * D (with |D| = max_bound)
+*   max_bound  - Length of D
 *
 * OUTPUT
 *
-*   intervals - Pointer to sorted list of hits
-*   cnt       - Number of hits in intervals
+*   coeffs     - Coefficients of the components, by hit index
+*
+* RETURNS
+*
+*   unsigned int - Index of the first hit not processed
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Calculate the polynomial coefficients of the components entered next
+*   along the ray, up to BLOB_COEFFICIENT_BATCH of them at a time.
+*
+*   Spherical components, which make up the bulk of typical large blobs,
+*   are gathered into structure-of-arrays form and processed in a single
+*   tight loop the compiler is able to vectorize; all others are handled
+*   one by one.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+unsigned int Blob::calculate_coefficients(const Blob_Interval_Struct *intervals, unsigned int first, unsigned int cnt, const Vector3d& P, const Vector3d& D, DBL max_bound, DBL *coeffs)
+{
+    DBL Vx[BLOB_COEFFICIENT_BATCH], Vy[BLOB_COEFFICIENT_BATCH], Vz[BLOB_COEFFICIENT_BATCH];
+    DBL c0[BLOB_COEFFICIENT_BATCH], c1[BLOB_COEFFICIENT_BATCH], c2[BLOB_COEFFICIENT_BATCH];
+    DBL f[5][BLOB_COEFFICIENT_BATCH];
+    unsigned int hit[BLOB_COEFFICIENT_BATCH];
+    unsigned int entered = 0, spheres = 0;
+    unsigned int i;
+    const DBL t2 = max_bound * max_bound;
+
+    for (i = first; (i < cnt) && (entered < BLOB_COEFFICIENT_BATCH); i++)
+    {
+        if ((intervals[i].type & 1) != ENTERING)
+            continue;
+
+        entered++;
+
+        const Blob_Element *Element = intervals[i].Element;
+
+        if (Element->Type == BLOB_SPHERE)
+        {
+            Vx[spheres]  = P[X] - Element->O[X];
+            Vy[spheres]  = P[Y] - Element->O[Y];
+            Vz[spheres]  = P[Z] - Element->O[Z];
+            c0[spheres]  = Element->c[0];
+            c1[spheres]  = Element->c[1];
+            c2[spheres]  = Element->c[2];
+            hit[spheres] = intervals[i].hit;
+            spheres++;
+        }
+        else
+            calculate_element_coefficients(Element, P, D, max_bound, &coeffs[intervals[i].hit * 5]);
+    }
+
+    for (unsigned int k = 0; k < spheres; k++)
+    {
+        DBL t0 = Vx[k] * Vx[k] + Vy[k] * Vy[k] + Vz[k] * Vz[k];
+        DBL t1 = Vx[k] * D[X] + Vy[k] * D[Y] + Vz[k] * D[Z];
+
+        f[0][k] = c0[k] * t2 * t2;
+        f[1][k] = 4.0 * c0[k] * t1 * t2;
+        f[2][k] = 2.0 * c0[k] * (2.0 * t1 * t1 + t0 * t2) + c1[k] * t2;
+        f[3][k] = 2.0 * t1 * (2.0 * c0[k] * t0 + c1[k]);
+        f[4][k] = t0 * (c0[k] * t0 + c1[k]) + c2[k];
+    }
+
+    for (unsigned int k = 0; k < spheres; k++)
+        for (unsigned int j = 0; j < 5; j++)
+            coeffs[hit[k] * 5 + j] = f[j][k];
+
+    return (i);
+}
+
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   calculate_element_coefficients
+*
+* INPUT
+*
+*   Element    - Pointer to element structure
+*   P, D       - Ray = P + t * D (with |D| = max_bound)
+*   max_bound  - Length of D
+*
+* OUTPUT
+*
+*   fcoeffs    - Coefficients of the element's field along the ray
 *
 * RETURNS
 *
@@ -599,84 +639,154 @@ bool Blob::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThreadDat
 *
 * DESCRIPTION
 *
-*   Store the points of intersection. Keep track of: whether this is
-*   the start or end point of the hit, which component was pierced
-*   by the ray, and the point along the ray that the hit occurred at.
+*   Calculate the coefficients of the quartic polynomial describing the
+*   field of a single component along the ray.
 *
 * CHANGES
 *
-*   Oct 1994 : Modified to use memmove instead of loops for copying. [DB]
-*   Sep 1995 : Changed to allow use of memcpy if memmove isn't available. [AED]
-*   Jul 1996 : Changed to use POV_MEMMOVE, which can be memmove or pov_memmove.
-*   Oct 1996 : Changed to avoid unnecessary compares. [DB]
-*   Feb 2019 : Changed back to use std::memmove again. [CLi]
+*   Jul 1994 : Added code for cylindrical and ellipsoidical blobs. [DB]
+*
+*   Moved out of All_Blob_Intersections().
 *
 ******************************************************************************/
 
-void Blob::insert_hit(const Blob_Element *Element, DBL t0, DBL t1, Blob_Interval_Struct *intervals, unsigned int *cnt)
+void Blob::calculate_element_coefficients(const Blob_Element *Element, const Vector3d& P, const Vector3d& D, DBL max_bound, DBL *fcoeffs)
 {
-    unsigned int k;
+    DBL t0, t1, t2, c0, c1, c2;
+    Vector3d V1, PP, DD;
 
-    /* We are entering the component. */
+    switch (Element->Type)
+    {
+        case BLOB_SPHERE:
 
-    intervals[*cnt].type    = Element->Type | ENTERING;
-    intervals[*cnt].bound   = t0;
-    intervals[*cnt].Element = Element;
+            V1 = P - Element->O;
 
-    for (k = 0; t0 > intervals[k].bound; k++);
+            t0 = V1.lengthSqr();
+            t1 = dot(V1, D);
+            t2 = max_bound * max_bound;
 
-    if (k < *cnt)
-    {
-        /*
-         * This hit point is smaller than one that already exists -->
-         * bump the rest and insert it here.
-         */
+            break;
 
-        std::memmove(&intervals[k+1], &intervals[k], (*cnt-k)*sizeof(Blob_Interval_Struct));
+        case BLOB_ELLIPSOID:
 
-        /* We are entering the component. */
+            MInvTransPoint(PP, P, Element->Trans);
+            MInvTransDirection(DD, D, Element->Trans);
 
-        intervals[k].type    = Element->Type | ENTERING;
-        intervals[k].bound   = t0;
-        intervals[k].Element = Element;
+            V1 = PP - Element->O;
 
-        (*cnt)++;
+            t0 = V1.lengthSqr();
+            t1 = dot(V1, DD);
+            t2 = DD.lengthSqr();
 
-        /* We are exiting the component. */
+            break;
 
-        intervals[*cnt].type    = Element->Type | EXITING;
-        intervals[*cnt].bound   = t1;
-        intervals[*cnt].Element = Element;
+        case BLOB_BASE_HEMISPHERE:
+        case BLOB_APEX_HEMISPHERE:
 
-        for (k = k + 1; t1 > intervals[k].bound; k++);
+            MInvTransPoint(PP, P, Element->Trans);
+            MInvTransDirection(DD, D, Element->Trans);
 
-        if (k < *cnt)
-        {
-            std::memmove(&intervals[k+1], &intervals[k], (*cnt-k)*sizeof(Blob_Interval_Struct));
+            if (Element->Type == BLOB_APEX_HEMISPHERE)
+            {
+                PP[Z] -= Element->len;
+            }
 
-            /* We are exiting the component. */
+            t0 = PP.lengthSqr();
+            t1 = dot(PP, DD);
+            t2 = DD.lengthSqr();
 
-            intervals[k].type    = Element->Type | EXITING;
-            intervals[k].bound   = t1;
-            intervals[k].Element = Element;
-        }
+            break;
 
-        (*cnt)++;
-    }
-    else
-    {
-        /* Just plop the start and end points at the end of the list */
+        case BLOB_CYLINDER:
+
+            /* Transform ray into cylinder space. */
+
+            MInvTransPoint(PP, P, Element->Trans);
+            MInvTransDirection(DD, D, Element->Trans);
 
-        (*cnt)++;
+            t0 = PP[X] * PP[X] + PP[Y] * PP[Y];
+            t1 = PP[X] * DD[X] + PP[Y] * DD[Y];
+            t2 = DD[X] * DD[X] + DD[Y] * DD[Y];
 
-        /* We are exiting the component. */
+            break;
 
-        intervals[*cnt].type    = Element->Type | EXITING;
-        intervals[*cnt].bound   = t1;
-        intervals[*cnt].Element = Element;
+        default:
 
-        (*cnt)++;
+            throw POV_EXCEPTION_STRING("Unknown blob component in All_Blob_Intersections().");
     }
+
+    c0 = Element->c[0];
+    c1 = Element->c[1];
+    c2 = Element->c[2];
+
+    fcoeffs[0] = c0 * t2 * t2;
+    fcoeffs[1] = 4.0 * c0 * t1 * t2;
+    fcoeffs[2] = 2.0 * c0 * (2.0 * t1 * t1 + t0 * t2) + c1 * t2;
+    fcoeffs[3] = 2.0 * t1 * (2.0 * c0 * t0 + c1);
+    fcoeffs[4] = t0 * (c0 * t0 + c1) + c2;
+}
+
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   insert_hit
+*
+* INPUT
+*
+*   Element   - Element to insert
+*   t0, t1    - Intersection depths
+*
+* OUTPUT
+*
+*   intervals - List of hits
+*
+* RETURNS
+*
+* AUTHOR
+*
+*   Alexander Enzmann
+*
+* DESCRIPTION
+*
+*   Store the points of intersection. Keep track of: whether this is
+*   the start or end point of the hit, which component was pierced
+*   by the ray, and the point along the ray that the hit occurred at.
+*
+* CHANGES
+*
+*   Oct 1994 : Modified to use memmove instead of loops for copying. [DB]
+*   Sep 1995 : Changed to allow use of memcpy if memmove isn't available. [AED]
+*   Jul 1996 : Changed to use POV_MEMMOVE, which can be memmove or pov_memmove.
+*   Oct 1996 : Changed to avoid unnecessary compares. [DB]
+*   Feb 2019 : Changed back to use std::memmove again. [CLi]
+*
+*   The hits are now just appended, and sorted once all have been found,
+*   as inserting each into a sorted array takes quadratic time for blobs
+*   with many components along the ray.
+*
+******************************************************************************/
+
+void Blob::insert_hit(const Blob_Element *Element, DBL t0, DBL t1, vector<Blob_Interval_Struct>& intervals)
+{
+    Blob_Interval_Struct entry;
+
+    entry.Element = Element;
+    entry.hit     = (unsigned int)(intervals.size() / 2);
+
+    /* We are entering the component. */
+
+    entry.type  = Element->Type | ENTERING;
+    entry.bound = t0;
+    intervals.push_back(entry);
+
+    /* We are exiting the component. */
+
+    entry.type  = Element->Type | EXITING;
+    entry.bound = t1;
+    intervals.push_back(entry);
 }
 
 
@@ -1176,7 +1286,7 @@ int Blob::intersect_sphere(const Blob_Element *Element, const Vector3d& P, const
 int Blob::intersect_element(const Vector3d& P, const Vector3d& D, const Blob_Element *Element, DBL mindist, DBL *tmin, DBL *tmax, RenderStatistics& stats)
 {
 #ifdef BLOB_EXTRA_STATS
-    stats[Blob_Element_Tests]++;
+    stats.Shape(Blob_Element_Tests)++;
 #endif
 
     *tmin = BOUND_HUGE;
@@ -1223,7 +1333,7 @@ int Blob::intersect_element(const Vector3d& P, const Vector3d& D, const Blob_Ele
     }
 
 #ifdef BLOB_EXTRA_STATS
-    stats[Blob_Element_Tests_Succeeded]++;
+    stats.Shape(Blob_Element_Tests_Succeeded)++;
 #endif
 
     return (true);
@@ -1231,6 +1341,45 @@ int Blob::intersect_element(const Vector3d& P, const Vector3d& D, const Blob_Ele
 
 
 
+/// Leaf functor to collect the components of a blob affecting a ray.
+class Blob::BVHInfluences final : public BVHTree::LeafIntersect
+{
+    public:
+
+        BVHInfluences(const Blob_Data& d, const Vector3d& p, const Vector3d& dir, DBL m, vector<Blob_Interval_Struct>& i, RenderStatistics& s) :
+            data(d), P(p), D(dir), mindist(m), intervals(i), stats(s)
+        {}
+
+        virtual void operator()(unsigned int first, unsigned int count, double&) override
+        {
+            const vector<unsigned int>& list = data.Tree->GetObjectList();
+            DBL t0, t1;
+
+            // Only leaves whose bounding box is hit by the ray get here.
+            stats.Shape(Blob_Bound_Tests)++;
+            stats.Shape(Blob_Bound_Tests_Succeeded)++;
+
+            for (unsigned int i = first, end = first + count; i < end; i++)
+            {
+                const Blob_Element *Element = &data.Entry[list[i]];
+
+                if (intersect_element(P, D, Element, mindist, &t0, &t1, stats))
+                    insert_hit(Element, t0, t1, intervals);
+            }
+        }
+
+        virtual bool operator()() const override { return !intervals.empty(); }
+
+    private:
+
+        const Blob_Data& data;
+        const Vector3d& P;
+        const Vector3d& D;
+        DBL mindist;
+        vector<Blob_Interval_Struct>& intervals;
+        RenderStatistics& stats;
+};
+
 /*****************************************************************************
 *
 * FUNCTION
@@ -1264,17 +1413,16 @@ int Blob::intersect_element(const Vector3d& P, const Vector3d& D, const Blob_Ele
 *
 *   Jul 1994 : Added code for bounding hierarchy traversal. [DB]
 *
+*   Now traverses a bounding volume hierarchy, and sorts the hits once
+*   all have been found.
+*
 ******************************************************************************/
 
-int Blob::determine_influences(const Vector3d& P, const Vector3d& D, DBL mindist, Blob_Interval_Struct *intervals, TraceThreadData *Thread) const
+int Blob::determine_influences(const Vector3d& P, const Vector3d& D, DBL mindist, vector<Blob_Interval_Struct>& intervals, TraceThreadData *Thread) const
 {
-    unsigned int cnt, size;
-    DBL b, t, t0, t1;
-    Vector3d V1;
-    BSPHERE_TREE *Tree;
-    BSPHERE_TREE **Queue = reinterpret_cast<BSPHERE_TREE **>(Thread->Blob_Queue);
+    DBL t0, t1;
 
-    cnt = 0;
+    intervals.clear();
 
     if (Data->Tree == nullptr)
     {
@@ -1284,7 +1432,7 @@ int Blob::determine_influences(const Vector3d& P, const Vector3d& D, DBL mindist
         {
             if (intersect_element(P, D, &(*i), mindist, &t0, &t1, Thread->Stats()))
             {
-                insert_hit(&(*i), t0, t1, intervals, &cnt);
+                insert_hit(&(*i), t0, t1, intervals);
             }
         }
     }
@@ -1292,54 +1440,17 @@ int Blob::determine_influences(const Vector3d& P, const Vector3d& D, DBL mindist
     {
         /* Use blob's bounding hierarchy. */
 
-        size = 0;
-
-        Queue[size++] = Data->Tree;
-
-        while (size > 0)
-        {
-            Tree = Queue[--size];
-
-            /* Test if current node is a leaf. */
-
-            if (Tree->Entries <= 0)
-            {
-                /* Test element. */
-
-                if (intersect_element(P, D, reinterpret_cast<Blob_Element *>(Tree->Node), mindist, &t0, &t1, Thread->Stats()))
-                {
-                    insert_hit(reinterpret_cast<Blob_Element *>(Tree->Node), t0, t1, intervals, &cnt);
-                }
-            }
-            else
-            {
-                /* Test all sub-nodes. */
+        BVHInfluences influences(*Data, P, D, mindist, intervals, Thread->Stats());
 
-                for (int i = 0; i < (int)Tree->Entries; i++)
-                {
-#ifdef BLOB_EXTRA_STATS
-                    Thread->Stats()[Blob_Bound_Tests]++;
-#endif
+        (*Data->Tree)(BasicRay(P, D), influences, BOUND_HUGE);
+    }
 
-                    V1 = Tree->Node[i]->C - P;
-                    b = dot(V1, D);
-                    t = V1.lengthSqr();
+    /* Sort the hits along the ray, keeping entry before exit for empty intervals. */
 
-                    if ((t - Sqr(b)) <= Tree->Node[i]->r2)
-                    {
-#ifdef BLOB_EXTRA_STATS
-                        Thread->Stats()[Blob_Bound_Tests_Succeeded]++;
-#endif
+    std::stable_sort(intervals.begin(), intervals.end(),
+                     [](const Blob_Interval_Struct& a, const Blob_Interval_Struct& b) { return a.bound < b.bound; });
 
-                        if (insert_node(Tree->Node[i], &size, Thread))
-                            Queue = reinterpret_cast<BSPHERE_TREE **>(Thread->Blob_Queue);
-                    }
-                }
-            }
-        }
-    }
-
-    return (cnt);
+    return ((int)intervals.size());
 }
 
 
@@ -1467,94 +1578,120 @@ DBL Blob::calculate_element_field(const Blob_Element *Element, const Vector3d& P
 
 
 
+/// Point query functor to visit the components of a blob whose bounds contain a point.
+template<typename FUNCTOR>
+class Blob::BVHElements final : public BSPTree::Inside
+{
+    public:
+
+        BVHElements(const Blob_Data& d, FUNCTOR& f) : data(d), functor(f) {}
+
+        virtual bool operator()(unsigned int index) override
+        {
+            functor(&data.Entry[index]);
+            return false;
+        }
+
+        virtual bool operator()() const override { return false; }
+
+    private:
+
+        const Blob_Data& data;
+        FUNCTOR& functor;
+};
+
 /*****************************************************************************
 *
 * FUNCTION
 *
-*   calculate_field_value
+*   visit_elements
 *
 * INPUT
 *
-*   Blob - Pointer to blob structure
-*   P       - Point whos field value is calculated
+*   P       - Point (in blob space)
+*   functor - Function to invoke for each element
 *
 * OUTPUT
 *
 * RETURNS
 *
-*   DBL - Field value
-*
 * AUTHOR
 *
-*   Dieter Bayer
-*
 * DESCRIPTION
 *
-*   Calculate the field value of a blob in a given point P
-*   (which must already have been transformed into blob space).
+*   Invoke a function for each element that may affect the given point,
+*   using the bounding hierarchy if there is one. The function may also be
+*   invoked for elements that do not affect the point.
 *
 * CHANGES
 *
-*   Jul 1994 : Added code for bounding hierarchy traversal. [DB]
+*   -
 *
 ******************************************************************************/
 
-DBL Blob::calculate_field_value(const Vector3d& P, TraceThreadData *Thread) const
+template<typename FUNCTOR>
+void Blob::visit_elements(const Vector3d& P, FUNCTOR& functor) const
 {
-    unsigned int size;
-    DBL density, rad2;
-    Vector3d V1;
-    BSPHERE_TREE *Tree;
-    BSPHERE_TREE **Queue = reinterpret_cast<BSPHERE_TREE **>(Thread->Blob_Queue);
-
-    density = 0.0;
-
     if (Data->Tree == nullptr)
     {
         /* There's no tree --> step through all elements. */
 
-        for (vector<Blob_Element>::iterator i = Data->Entry.begin(); i != Data->Entry.end(); ++i)
+        for (vector<Blob_Element>::const_iterator i = Data->Entry.begin(); i != Data->Entry.end(); ++i)
         {
-            density += calculate_element_field(&(*i), P);
+            functor(&(*i));
         }
     }
     else
     {
-        /* A tree exists --> step through the tree. */
+        /* A tree exists --> visit the leaves containing the point. */
 
-        size = 0;
+        BVHElements<FUNCTOR> elements(*Data, functor);
 
-        Queue[size++] = Data->Tree;
+        (*Data->Tree)(P, elements);
+    }
+}
 
-        while (size > 0)
-        {
-            Tree = Queue[--size];
 
-            /* Test if current node is a leaf. */
 
-            if (Tree->Entries <= 0)
-            {
-                density += calculate_element_field(reinterpret_cast<Blob_Element *>(Tree->Node), P);
-            }
-            else
-            {
-                /* Test all sub-nodes. */
-
-                for (int i = 0; i < (int)Tree->Entries; i++)
-                {
-                    /* Insert sub-node if we are inside. */
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   calculate_field_value
+*
+* INPUT
+*
+*   Blob - Pointer to blob structure
+*   P       - Point whos field value is calculated
+*
+* OUTPUT
+*
+* RETURNS
+*
+*   DBL - Field value
+*
+* AUTHOR
+*
+*   Dieter Bayer
+*
+* DESCRIPTION
+*
+*   Calculate the field value of a blob in a given point P
+*   (which must already have been transformed into blob space).
+*
+* CHANGES
+*
+*   Jul 1994 : Added code for bounding hierarchy traversal. [DB]
+*
+******************************************************************************/
 
-                    V1 = P - Tree->Node[i]->C;
+DBL Blob::calculate_field_value(const Vector3d& P, TraceThreadData *Thread) const
+{
+    DBL density = 0.0;
 
-                    rad2 = V1.lengthSqr();
+    auto accumulate = [&density, &P](const Blob_Element *Element) { density += calculate_element_field(Element, P); };
 
-                    if (rad2 <= Tree->Node[i]->r2)
-                        if (insert_node(Tree->Node[i], &size, Thread))
-                            Queue = reinterpret_cast<BSPHERE_TREE **>(Thread->Blob_Queue);
-                }
-            }
-        }
-    }
+    visit_elements(P, accumulate);
 
     return (density);
 }
@@ -1814,12 +1951,8 @@ void Blob::element_normal(Vector3d& Result, const Vector3d& P, const Blob_Elemen
 
 void Blob::Normal(Vector3d& Result, Intersection *Inter, TraceThreadData *Thread) const
 {
-    int i;
-    unsigned int size;
-    DBL dist, val;
-    Vector3d New_Point, V1;
-    BSPHERE_TREE *Tree;
-    BSPHERE_TREE **Queue = reinterpret_cast<BSPHERE_TREE **>(Thread->Blob_Queue);
+    DBL val;
+    Vector3d New_Point;
 
     /* Transform the point into the blob space. */
     getLocalIPoint(New_Point, Inter);
@@ -1828,52 +1961,9 @@ void Blob::Normal(Vector3d& Result, Intersection *Inter, TraceThreadData *Thread
 
     /* For each component that contributes to this point, add its bit to the normal */
 
-    if (Data->Tree == nullptr)
-    {
-        /* There's no tree --> step through all elements. */
+    auto accumulate = [&Result, &New_Point](const Blob_Element *Element) { element_normal(Result, New_Point, Element); };
 
-        for (vector<Blob_Element>::iterator i = Data->Entry.begin(); i != Data->Entry.end(); ++i)
-        {
-            element_normal(Result, New_Point, &(*i));
-        }
-    }
-    else
-    {
-        /* A tree exists --> step through the tree. */
-
-        size = 0;
-
-        Queue[size++] = Data->Tree;
-
-        while (size > 0)
-        {
-            Tree = Queue[--size];
-
-            /* Test if current node is a leaf. */
-
-            if (Tree->Entries <= 0)
-            {
-                element_normal(Result, New_Point, reinterpret_cast<Blob_Element *>(Tree->Node));
-            }
-            else
-            {
-                /* Test all sub-nodes. */
-
-                for (i = 0; i < (int)Tree->Entries; i++)
-                {
-                    /* Insert sub-node if we are inside. */
-
-                    V1 = New_Point - Tree->Node[i]->C;
-
-                    dist = V1.lengthSqr();
-
-                    if (dist <= Tree->Node[i]->r2)
-                        if (insert_node(Tree->Node[i], &size, Thread))
-                            Queue = reinterpret_cast<BSPHERE_TREE **>(Thread->Blob_Queue);
-                }
-            }
-        }
-    }
+    visit_elements(New_Point, accumulate);
 
     val = Result.lengthSqr();
 
@@ -2053,7 +2143,16 @@ void Blob::Transform(const TRANSFORM *tr)
     Compose_Transforms(Trans, tr);
 
     for(vector<TEXTURE*>::iterator i = Element_Texture.begin(); i != Element_Texture.end(); ++i)
+    {
+        // Element textures are shared with copies of the blob until transformed.
+        if ((*i != nullptr) && ((*i)->References > 1))
+        {
+            TEXTURE *Shared = *i;
+            *i = Copy_Textures(Shared);
+            Destroy_Textures(Shared);
+        }
         Transform_Textures(*i, tr);
+    }
 }
 
 
@@ -2139,7 +2238,7 @@ ObjectPtr Blob::Copy()
     New->Data = Data->AcquireReference();
     New->Element_Texture.reserve(Element_Texture.size());
     for (vector<TEXTURE*>::iterator i = Element_Texture.begin(); i != Element_Texture.end(); ++i)
-        New->Element_Texture.push_back(Copy_Textures(*i));
+        New->Element_Texture.push_back(Copy_Texture_Pointer(*i));
     return (New);
 }
 
@@ -2444,7 +2543,7 @@ void Blob_Data::ReleaseReference (void)
 {
     if (--References == 0)
     {
-        Destroy_Bounding_Sphere_Hierarchy(Tree);
+        delete Tree;
 
         /*
          * Make sure to destroy multiple references of a texture
@@ -2513,7 +2612,7 @@ Blob_Data::~Blob_Data ()
 *
 ******************************************************************************/
 
-int Blob::Make_Blob(DBL threshold, Blob_List_Struct *BlobList, int npoints, TraceThreadData *Thread)
+int Blob::Make_Blob(DBL threshold, Blob_List_Struct *BlobList, int npoints)
 {
     int i, count;
     DBL rad2, coeff;
@@ -2598,25 +2697,11 @@ int Blob::Make_Blob(DBL threshold, Blob_List_Struct *BlobList, int npoints, Trac
 
     Compute_BBox();
 
-    /* Create bounding sphere hierarchy. */
+    /* Create bounding hierarchy. */
 
     if (Test_Flag(this, HIERARCHY_FLAG))
         build_bounding_hierarchy();
 
-    if (count * 5 >= Thread->Blob_Coefficient_Count)
-    {
-        POV_FREE(Thread->Blob_Coefficients);
-        Thread->Blob_Coefficient_Count = count * 7;
-        Thread->Blob_Coefficients = reinterpret_cast<DBL *>(POV_MALLOC(sizeof(DBL) * Thread->Blob_Coefficient_Count, "Blob Coefficients"));
-    }
-
-    if (Data->Entry.size() * 2 >= Thread->Blob_Interval_Count)
-    {
-        delete[] Thread->Blob_Intervals;
-        Thread->Blob_Interval_Count = Data->Entry.size() * 5 / 2;
-        Thread->Blob_Intervals = new Blob_Interval_Struct [Thread->Blob_Interval_Count];
-    }
-
     return (count) ;
 }
 
@@ -2690,46 +2775,40 @@ bool Blob::IsOpaque() const
 *
 * DESCRIPTION
 *
-*   Create the bounding sphere hierarchy.
+*   Create the bounding hierarchy.
 *
 * CHANGES
 *
 *   Oct 1994 : Creation. (Derived from the bounding slab creation code)
 *
+*   Now creates a wide bounding volume hierarchy of the elements' bounding
+*   boxes rather than a bounding sphere hierarchy.
+*
 ******************************************************************************/
 
 void Blob::build_bounding_hierarchy()
 {
-    int i, nElem, maxelements;
-    BSPHERE_TREE **Elements;
-
-    nElem = (int)Data->Entry.size();
-
-    maxelements = 2 * nElem;
-
-    /*
-     * Now allocate an array to hold references to these elements.
-     */
-
-    Elements = reinterpret_cast<BSPHERE_TREE **>(POV_MALLOC(maxelements*sizeof(BSPHERE_TREE *), "blob bounding hierarchy"));
+    BVHTree::Statistics stats;
+    vector<MinMaxBoundingBox> boxes(Data->Entry.size());
+    Vector3d C;
+    DBL r2, r;
 
-    /* Init list with blob elements. */
+    /* Get the bounding boxes of all elements. */
 
-    for (i = 0; i < nElem; i++)
+    for (size_t i = 0; i < Data->Entry.size(); i++)
     {
-        Elements[i] = reinterpret_cast<BSPHERE_TREE *>(POV_MALLOC(sizeof(BSPHERE_TREE), "blob bounding hierarchy"));
+        get_element_bounding_sphere(&Data->Entry[i], C, &r2);
 
-        Elements[i]->Entries = 0;
-        Elements[i]->Node    = reinterpret_cast<BSPHERE_TREE **>(&Data->Entry[i]);
+        r = sqrt(r2);
 
-        get_element_bounding_sphere(&Data->Entry[i], Elements[i]->C, &Elements[i]->r2);
+        boxes[i].pmin = BBoxVector3d(C - r);
+        boxes[i].pmax = BBoxVector3d(C + r);
     }
 
-    Build_Bounding_Sphere_Hierarchy(&Data->Tree, nElem, &Elements);
-
-    /* Get rid of the Elements array. */
+    delete Data->Tree;
 
-    POV_FREE(Elements);
+    Data->Tree = BVHTree::Create(BLOB_BVH_WIDTH, BLOB_BVH_LEAF_COMPONENTS);
+    Data->Tree->build(BlobBVHNoProgress(), BlobBVHObjects(boxes), stats);
 }
 
 
@@ -2767,64 +2846,18 @@ void Blob::build_bounding_hierarchy()
 
 void Blob::Determine_Textures(Intersection *isect, bool hitinside, WeightedTextureVector& textures, TraceThreadData *Thread)
 {
-    unsigned int size;
-    DBL rad2;
-    Vector3d V1, P;
-    Blob_Element *Element;
-    BSPHERE_TREE *Tree;
+    Vector3d P;
     size_t firstinserted = textures.size();
-    BSPHERE_TREE **Queue = reinterpret_cast<BSPHERE_TREE **>(Thread->Blob_Queue);
 
     /* Transform the point into the blob space. */
     getLocalIPoint(P, isect);
 
-    if (Data->Tree == nullptr)
+    auto collect = [this, &P, &textures](const Blob_Element *Element)
     {
-        /* There's no tree --> step through all elements. */
+        determine_element_texture(Element, Element_Texture[Element->index], P, textures);
+    };
 
-        for (int i = 0; i < Data->Entry.size(); i++)
-        {
-            Element = &Data->Entry[i];
-            determine_element_texture(Element, Element_Texture[i], P, textures);
-        }
-    }
-    else
-    {
-        /* A tree exists --> step through the tree. */
-
-        size = 0;
-
-        Queue[size++] = Data->Tree;
-
-        while (size > 0)
-        {
-            Tree = Queue[--size];
-
-            /* Test if current node is a leaf. */
-
-            if (Tree->Entries <= 0)
-            {
-                determine_element_texture(reinterpret_cast<Blob_Element *>(Tree->Node), Element_Texture[((Blob_Element *)Tree->Node)->index], P, textures);
-            }
-            else
-            {
-                /* Test all sub-nodes. */
-
-                for (int i = 0; i < (int)Tree->Entries; i++)
-                {
-                    /* Insert sub-node if we are inside. */
-
-                    V1 = P - Tree->Node[i]->C;
-
-                    rad2 = V1.lengthSqr();
-
-                    if (rad2 <= Tree->Node[i]->r2)
-                        if (insert_node(Tree->Node[i], &size, Thread))
-                            Queue = reinterpret_cast<BSPHERE_TREE **>(Thread->Blob_Queue);
-                }
-            }
-        }
-    }
+    visit_elements(P, collect);
 
     /* Normalize weights so that their sum is 1. */
 
@@ -3143,52 +3176,6 @@ void Blob::Invert_Blob_Element(Blob_Element *Element)
 }
 
 
-/*****************************************************************************
-*
-* FUNCTION
-*
-*   insert_node
-*
-* INPUT
-*
-* OUTPUT
-*
-* RETURNS
-*
-* AUTHOR
-*
-*   Dieter Bayer
-*
-* DESCRIPTION
-*
-*   Insert a node into the node queue.
-*
-* CHANGES
-*
-*   Feb 1995 : Creation.
-*
-******************************************************************************/
-
-bool Blob::insert_node(BSPHERE_TREE *Node, unsigned int *size, TraceThreadData *Thread)
-{
-    /* Resize queue if necessary. */
-    bool rval = false ;
-    BSPHERE_TREE **Queue = reinterpret_cast<BSPHERE_TREE **>(Thread->Blob_Queue);
-
-    if (*size >= Thread->Max_Blob_Queue_Size)
-    {
-        Thread->Max_Blob_Queue_Size = (*size + 1) * 3 / 2;
-        Queue = reinterpret_cast<BSPHERE_TREE **>(POV_REALLOC(Queue, Thread->Max_Blob_Queue_Size*sizeof(BSPHERE_TREE *), "blob queue"));
-        Thread->Blob_Queue = reinterpret_cast<void **>(Queue);
-        rval = true ;
-    }
-
-    Queue[(*size)++] = Node;
-    return (rval) ;
-}
-
-
-
 /*****************************************************************************
 *
 * FUNCTION
@@ -49,7 +49,7 @@
 //  (none at the moment)
 
 // POV-Ray header files (core module)
-#include "core/bounding/boundingsphere.h"
+#include "core/bounding/bvhtree.h"
 #include "core/scene/object.h"
 
 namespace pov
@@ -120,7 +120,7 @@ class Blob_Data final
         int Number_Of_Components;           /* Number of components     */
         DBL Threshold;                      /* Blob threshold           */
         std::vector<Blob_Element> Entry;    /* Array of blob components */
-        BSPHERE_TREE *Tree;                 /* Bounding hierarchy       */
+        BVHTree *Tree;                      /* Bounding hierarchy       */
 
         Blob_Data(int count = 0);
         ~Blob_Data();
@@ -143,6 +143,7 @@ struct Blob_Interval_Struct final
     int type;
     DBL bound;
     const Blob_Element *Element;
+    unsigned int hit;   /* Index of the element's coefficients */
 };
 
 class Blob final : public ObjectBase
@@ -171,7 +172,7 @@ class Blob final : public ObjectBase
 
         Blob_List_Struct *Create_Blob_List_Element();
         void Create_Blob_Element_Texture_List(Blob_List_Struct *BlobList, int npoints);
-        int Make_Blob(DBL threshold, Blob_List_Struct *bloblist, int npoints, TraceThreadData *Thread);
+        int Make_Blob(DBL threshold, Blob_List_Struct *bloblist, int npoints);
 
         static void Translate_Blob_Element(Blob_Element *Element, const Vector3d& Vector);
         static void Rotate_Blob_Element(Blob_Element *Element, const Vector3d& Vector);
@@ -179,12 +180,18 @@ class Blob final : public ObjectBase
         static void Invert_Blob_Element(Blob_Element *Element);
         static void Transform_Blob_Element(Blob_Element *Element, const TRANSFORM *Trans);
     private:
+        class BVHInfluences;
+        template<typename FUNCTOR> class BVHElements;
+
         static void element_normal(Vector3d& Result, const Vector3d& P, const Blob_Element *Element);
         static int intersect_element(const Vector3d& P, const Vector3d& D, const Blob_Element *Element, DBL mindist, DBL *t0, DBL *t1, RenderStatistics& stats);
-        static void insert_hit(const Blob_Element *Element, DBL t0, DBL t1, Blob_Interval_Struct *intervals, unsigned int *cnt);
-        int determine_influences(const Vector3d& P, const Vector3d& D, DBL mindist, Blob_Interval_Struct *intervals, TraceThreadData *Thread) const;
+        static void insert_hit(const Blob_Element *Element, DBL t0, DBL t1, std::vector<Blob_Interval_Struct>& intervals);
+        int determine_influences(const Vector3d& P, const Vector3d& D, DBL mindist, std::vector<Blob_Interval_Struct>& intervals, TraceThreadData *Thread) const;
+        static unsigned int calculate_coefficients(const Blob_Interval_Struct *intervals, unsigned int first, unsigned int cnt, const Vector3d& P, const Vector3d& D, DBL max_bound, DBL *coeffs);
+        static void calculate_element_coefficients(const Blob_Element *Element, const Vector3d& P, const Vector3d& D, DBL max_bound, DBL *fcoeffs);
         DBL calculate_field_value(const Vector3d& P, TraceThreadData *Thread) const;
         static DBL calculate_element_field(const Blob_Element *Element, const Vector3d& P);
+        template<typename FUNCTOR> void visit_elements(const Vector3d& P, FUNCTOR& functor) const;
 
         static int intersect_cylinder(const Blob_Element *Element, const Vector3d& P, const Vector3d& D, DBL mindist, DBL *tmin, DBL *tmax);
         static int intersect_hemisphere(const Blob_Element *Element, const Vector3d& P, const Vector3d& D, DBL mindist, DBL *tmin, DBL *tmax);
@@ -196,8 +203,6 @@ class Blob final : public ObjectBase
 
         void determine_element_texture(const Blob_Element *Element, TEXTURE *Texture, const Vector3d& P, WeightedTextureVector&);
 
-        static bool insert_node(BSPHERE_TREE *Node, unsigned int *size, TraceThreadData *Thread);
-
         void getLocalIPoint(Vector3d& lip, Intersection *isect) const;
 };
 
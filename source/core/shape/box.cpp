@@ -104,7 +104,7 @@ bool Box::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThreadData
     DBL Depth1, Depth2;
     Vector3d IPoint;
 
-    Thread->Stats()[Ray_Box_Tests]++;
+    Thread->Stats().Shape(Ray_Box_Tests)++;
 
     Intersection_Found = false;
 
@@ -133,7 +133,7 @@ bool Box::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThreadData
     }
 
     if (Intersection_Found)
-        Thread->Stats()[Ray_Box_Tests_Succeeded]++;
+        Thread->Stats().Shape(Ray_Box_Tests_Succeeded)++;
 
     return (Intersection_Found);
 }
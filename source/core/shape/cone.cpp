@@ -160,7 +160,7 @@ int Cone::Intersect(const BasicRay& ray, CONE_INT *Intersection, RenderStatistic
     DBL d;
     Vector3d P, D;
 
-    stats[Ray_Cone_Tests]++;
+    stats.Shape(Ray_Cone_Tests)++;
 
     /* Transform the ray into the cones space */
 
@@ -297,7 +297,7 @@ int Cone::Intersect(const BasicRay& ray, CONE_INT *Intersection, RenderStatistic
     }
 
     if (i)
-        stats[Ray_Cone_Tests_Succeeded]++;
+        stats.Shape(Ray_Cone_Tests_Succeeded)++;
 
     return (i);
 }
@@ -48,6 +48,7 @@
 
 // POV-Ray header files (core module)
 #include "core/bounding/boundingbox.h"
+#include "core/bounding/bvhtree.h"
 #include "core/lighting/lightgroup.h"
 #include "core/math/matrix.h"
 #include "core/render/ray.h"
@@ -75,6 +76,16 @@ using std::vector;
 #define MERGE_OBJECT        (IS_COMPOUND_OBJECT | IS_CSG_OBJECT)
 #define INTERSECTION_OBJECT (IS_COMPOUND_OBJECT | IS_CSG_OBJECT)
 
+/* Relative padding of child bounding boxes, to make up for their single precision. */
+
+const DBL CSG_BBOX_TOLERANCE = 1.0e-6;
+
+/// Smallest number of children for a union or merge to build a bounding hierarchy over them.
+const size_t CSG_TREE_MIN_CHILDREN = 16;
+
+/// Number of children per node of a union's or merge's bounding hierarchy.
+const unsigned int CSG_BVH_WIDTH = 4;
+
 
 
 inline bool Test_Ray_Flags(const Ray& ray, ConstObjectPtr obj)
@@ -99,6 +110,199 @@ inline bool Test_Ray_Flags_Shadow(const Ray& ray, ConstObjectPtr obj)
              ( ray.IsShadowTestRay() && !Test_Flag(obj, NO_SHADOW_FLAG) ) );
 }
 
+// Whether the bounding box of a CSG child is finite and also encloses the child's interior.
+// As in CSG::Compute_BBox(), this is presumed for all children except inverted ones and height fields.
+inline bool BBox_Bounds_Interior(ConstObjectPtr obj)
+{
+    return (!Test_Flag(obj, INVERTED_FLAG) &&
+            (dynamic_cast<const HField *>(obj) == nullptr) &&
+            !obj->BBox.isEmpty() &&
+            (obj->BBox.size[X] < CRITICAL_LENGTH) &&
+            (obj->BBox.size[Y] < CRITICAL_LENGTH) &&
+            (obj->BBox.size[Z] < CRITICAL_LENGTH));
+}
+
+// Get the (slightly padded) bounding box of a CSG child.
+inline void Padded_BBox(ConstObjectPtr obj, Vector3d& lo, Vector3d& hi)
+{
+    Make_min_max_from_BBox(lo, hi, obj->BBox);
+
+    for (int i = X; i <= Z; i++)
+    {
+        lo[i] -= CSG_BBOX_TOLERANCE * (1.0 + fabs(lo[i]));
+        hi[i] += CSG_BBOX_TOLERANCE * (1.0 + fabs(hi[i]));
+    }
+}
+
+// Get the part of a ray inside the bounding box of a CSG child.
+// Returns false if the ray misses the box; unbounded children yield an unbounded interval.
+static bool Ray_BBox_Interval(const Ray& ray, ConstObjectPtr obj, DBL& tmin, DBL& tmax)
+{
+    Vector3d lo, hi;
+    DBL t1, t2;
+
+    tmin = -BOUND_HUGE;
+    tmax =  BOUND_HUGE;
+
+    if (obj->BBox.isEmpty() ||
+        (obj->BBox.size[X] >= CRITICAL_LENGTH) || (obj->BBox.size[Y] >= CRITICAL_LENGTH) || (obj->BBox.size[Z] >= CRITICAL_LENGTH))
+        return true;
+
+    Padded_BBox(obj, lo, hi);
+
+    for (int i = X; i <= Z; i++)
+    {
+        if (fabs(ray.Direction[i]) < EPSILON)
+        {
+            if ((ray.Origin[i] < lo[i]) || (ray.Origin[i] > hi[i]))
+                return false;
+        }
+        else
+        {
+            t1 = (lo[i] - ray.Origin[i]) / ray.Direction[i];
+            t2 = (hi[i] - ray.Origin[i]) / ray.Direction[i];
+
+            if (t1 > t2)
+                std::swap(t1, t2);
+
+            tmin = max(tmin, t1);
+            tmax = min(tmax, t2);
+        }
+    }
+
+    return ((tmin <= tmax) && (tmax >= 0.0));
+}
+
+// Test whether a point is certainly outside a CSG child, judging by its bounding box.
+static bool Outside_Child_BBox(const Vector3d& point, ConstObjectPtr obj)
+{
+    Vector3d lo, hi;
+
+    if (!BBox_Bounds_Interior(obj))
+        return false;
+
+    Padded_BBox(obj, lo, hi);
+
+    return ((point[X] < lo[X]) || (point[X] > hi[X]) ||
+            (point[Y] < lo[Y]) || (point[Y] > hi[Y]) ||
+            (point[Z] < lo[Z]) || (point[Z] > hi[Z]));
+}
+
+// Test whether a point is inside a child of a union or merge; see CSGUnion::Inside_Child().
+static bool Point_In_Child(const Vector3d& point, ObjectPtr child, ConstObjectPtr exclude, const Ray *ray, TraceThreadData *Thread)
+{
+    if (child == exclude)
+        return false;
+
+    if ((child->Type & LIGHT_SOURCE_OBJECT) && (reinterpret_cast<LightSource *>(child))->children.empty())
+        return false;
+
+    if ((ray != nullptr) && !Test_Ray_Flags_Shadow(*ray, child)) // TODO CLARIFY - why does CSGUnion use Test_Ray_Flags(), while CSGMerge uses Test_Ray_Flags_Shadow(), and CSGIntersection uses neither?
+        return false;
+
+    return (!Outside_Child_BBox(point, child) && Inside_Object(point, child, Thread));
+}
+
+
+
+/*****************************************************************************
+* Local typedefs
+******************************************************************************/
+
+/// Bounding hierarchy over the children of a union or merge.
+struct CSGChildTree final
+{
+    /// Children referenced by the hierarchy.
+    vector<ObjectPtr> bounded;
+
+    /// Children tested one by one: light sources, and children whose bounding box is infinite
+    /// or does not enclose their interior.
+    vector<ObjectPtr> unbounded;
+
+    std::unique_ptr<BVHTree> tree;
+};
+
+/// Child bounds as seen by the tree building code.
+class CSGChildObjects final : public BSPTree::Objects
+{
+    public:
+
+        CSGChildObjects(const vector<ObjectPtr>& objs) : objects(objs) { }
+        virtual ~CSGChildObjects() override { }
+
+        virtual unsigned int size() const override { return (unsigned int)objects.size(); }
+        virtual float GetMin(unsigned int axis, unsigned int i) const override { return objects[i]->BBox.lowerLeft[axis]; }
+        virtual float GetMax(unsigned int axis, unsigned int i) const override { return (objects[i]->BBox.lowerLeft[axis] + objects[i]->BBox.size[axis]); }
+
+    private:
+
+        const vector<ObjectPtr>& objects;
+};
+
+class CSGChildNoProgress final : public BSPTree::Progress
+{
+    public:
+
+        virtual void operator()(unsigned int) const override { }
+};
+
+/// Intersection functor handing the children whose bounding box a ray hits on to a union or merge.
+///
+/// The search distance is never reduced, as all intersections are needed.
+///
+class CSGChildIntersect final : public BSPTree::Intersect
+{
+    public:
+
+        CSGChildIntersect(CSGUnion& o, const vector<ObjectPtr>& objs, const Ray& r, IStack& s, TraceThreadData *t) :
+            found(false), csg(o), objects(objs), ray(r), stack(s), threadData(t) { }
+
+        virtual bool operator()(unsigned int index, double&) override
+        {
+            if (csg.Intersect_Child(objects[index], ray, stack, threadData))
+                found = true;
+            return found;
+        }
+
+        virtual bool operator()() const override { return found; }
+
+    private:
+
+        bool found;
+        CSGUnion& csg;
+        const vector<ObjectPtr>& objects;
+        const Ray& ray;
+        IStack& stack;
+        TraceThreadData *threadData;
+};
+
+/// Inside functor testing the children whose bounding box contains a point.
+class CSGChildInside final : public BSPTree::Inside
+{
+    public:
+
+        CSGChildInside(const Vector3d& p, const vector<ObjectPtr>& objs, ConstObjectPtr x, const Ray *r, TraceThreadData *t) :
+            found(false), point(p), objects(objs), exclude(x), ray(r), threadData(t) { }
+
+        virtual bool operator()(unsigned int index) override
+        {
+            if (!found && Point_In_Child(point, objects[index], exclude, ray, threadData))
+                found = true;
+            return found;
+        }
+
+        virtual bool operator()() const override { return found; }
+
+    private:
+
+        bool found;
+        const Vector3d& point;
+        const vector<ObjectPtr>& objects;
+        ConstObjectPtr exclude;
+        const Ray *ray;
+        TraceThreadData *threadData;
+};
+
 /*****************************************************************************
 *
 * FUNCTION
@@ -129,67 +333,135 @@ bool CSGUnion::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThrea
 {
     int Found;
 
-    Thread->Stats()[Ray_CSG_Union_Tests]++;
-
-    Found = false;
+    Thread->Stats().Shape(Ray_CSG_Union_Tests)++;
 
     // Use shortcut if no clip.
 
     if(Clip.empty())
-    {
-        for(vector<ObjectPtr>::const_iterator Current_Sib = children.begin(); Current_Sib != children.end(); Current_Sib++)
-        {
-            if(Test_Ray_Flags(ray, (*Current_Sib))) // TODO CLARIFY - why does CSGUnion use Test_Ray_Flags(), while CSGMerge uses Test_Ray_Flags_Shadow(), and CSGIntersection uses neither?
-            {
-                if((*Current_Sib)->Bound.empty() == true || Ray_In_Bound(ray, (*Current_Sib)->Bound, Thread))
-                {
-                    if((*Current_Sib)->All_Intersections(ray, Depth_Stack, Thread))
-                        Found = true;
-                }
-            }
-        }
-    }
+        Found = Intersect_Children(ray, Depth_Stack, Thread);
     else
     {
         IStack Local_Stack(Thread->stackPool);
         POV_REFPOOL_ASSERT(Local_Stack->empty()); // verify that the IStack pulled from the pool is in a cleaned-up condition
 
-        for(vector<ObjectPtr>::const_iterator Current_Sib = children.begin(); Current_Sib != children.end(); Current_Sib++)
+        Found = false;
+
+        if(Intersect_Children(ray, Local_Stack, Thread))
         {
-            if(Test_Ray_Flags(ray, (*Current_Sib))) // TODO CLARIFY - why does CSGUnion use Test_Ray_Flags(), while CSGMerge uses Test_Ray_Flags_Shadow(), and CSGIntersection uses neither?
+            while(Local_Stack->size() > 0)
             {
-                if((*Current_Sib)->Bound.empty() == true || Ray_In_Bound(ray, (*Current_Sib)->Bound, Thread))
+                if(Point_In_Clip(Local_Stack->top().IPoint, Clip, Thread))
                 {
-                    if((*Current_Sib)->All_Intersections (ray, Local_Stack, Thread))
-                    {
-                        while(Local_Stack->size() > 0)
-                        {
-                            if(Clip.empty() || Point_In_Clip(Local_Stack->top().IPoint, Clip, Thread))
-                            {
-                                Local_Stack->top().Csg = this;
+                    Local_Stack->top().Csg = this;
 
-                                Depth_Stack->push(Local_Stack->top());
+                    Depth_Stack->push(Local_Stack->top());
 
-                                Found = true;
-                            }
-
-                            Local_Stack->pop();
-                        }
-                    }
+                    Found = true;
                 }
+
+                Local_Stack->pop();
             }
         }
         POV_REFPOOL_ASSERT(Local_Stack->empty()); // verify that the IStack is in a cleaned-up condition (again)
     }
 
     if(Found)
-        Thread->Stats()[Ray_CSG_Union_Tests_Succeeded]++;
+        Thread->Stats().Shape(Ray_CSG_Union_Tests_Succeeded)++;
 
     return (Found);
 }
 
 
 
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   CSGUnion::Intersect_Child
+*
+* INPUT
+*
+* OUTPUT
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Intersect a ray with a single child of a union, pushing all
+*   intersections onto the stack.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+bool CSGUnion::Intersect_Child(ObjectPtr child, const Ray& ray, IStack& Depth_Stack, TraceThreadData *Thread)
+{
+    if(Test_Ray_Flags(ray, child)) // TODO CLARIFY - why does CSGUnion use Test_Ray_Flags(), while CSGMerge uses Test_Ray_Flags_Shadow(), and CSGIntersection uses neither?
+    {
+        if(child->Bound.empty() == true || Ray_In_Bound(ray, child->Bound, Thread))
+            return child->All_Intersections(ray, Depth_Stack, Thread);
+    }
+
+    return false;
+}
+
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   CSGUnion::Intersect_Children
+*
+* INPUT
+*
+* OUTPUT
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Intersect a ray with all children of a union or merge. If there is a
+*   bounding hierarchy over the children, only the children it reports to
+*   be hit are intersected, plus those not in the hierarchy.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+bool CSGUnion::Intersect_Children(const Ray& ray, IStack& Depth_Stack, TraceThreadData *Thread)
+{
+    bool Found = false;
+
+    const vector<ObjectPtr>& linear = (childTree != nullptr) ? childTree->unbounded : children;
+
+    for(vector<ObjectPtr>::const_iterator Current_Sib = linear.begin(); Current_Sib != linear.end(); Current_Sib++)
+    {
+        if(Intersect_Child(*Current_Sib, ray, Depth_Stack, Thread))
+            Found = true;
+    }
+
+    if(childTree != nullptr)
+    {
+        CSGChildIntersect isect(*this, childTree->bounded, ray, Depth_Stack, Thread);
+
+        if((*childTree->tree)(ray, isect, BOUND_HUGE))
+            Found = true;
+    }
+
+    return Found;
+}
+
+
+
 /*****************************************************************************
 *
 * FUNCTION
@@ -214,20 +486,59 @@ bool CSGUnion::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThrea
 *
 *   Sep 1994 : Added code to count intersection tests. [DB]
 *
+*   The part of the ray inside the bounding boxes of all children is
+*   determined first; children whose bounding box doesn't overlap it are
+*   not intersected at all, and if it is empty the ray misses altogether.
+*   Intersections outside the bounding box of another child are rejected
+*   without calling its inside test.
+*
 ******************************************************************************/
 
 bool CSGIntersection::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThreadData *Thread)
 {
     int Maybe_Found, Found;
+    DBL tmin, tmax, cmin, cmax;
+
+    Thread->Stats().Shape(Ray_CSG_Intersection_Tests)++;
+
+    /* Get the part of the ray that can possibly be inside all children. */
+
+    tmin = -BOUND_HUGE;
+    tmax =  BOUND_HUGE;
+
+    for(vector<ObjectPtr>::const_iterator Current_Sib = children.begin(); Current_Sib != children.end(); Current_Sib++)
+    {
+        if (BBox_Bounds_Interior(*Current_Sib))
+        {
+            if (!Ray_BBox_Interval(ray, *Current_Sib, cmin, cmax))
+                tmax = -BOUND_HUGE;
+
+            tmin = max(tmin, cmin);
+            tmax = min(tmax, cmax);
+
+            if (tmin > tmax)
+            {
+                Thread->Stats().Shape(Ray_CSG_Child_Bound_Tests) += children.size();
+
+                return (false);
+            }
+        }
+    }
+
     IStack Local_Stack(Thread->stackPool);
     POV_REFPOOL_ASSERT(Local_Stack->empty()); // verify that the IStack pulled from the pool is in a cleaned-up condition
 
-    Thread->Stats()[Ray_CSG_Intersection_Tests]++;
-
     Found = false;
 
     for(vector<ObjectPtr>::const_iterator Current_Sib = children.begin(); Current_Sib != children.end(); Current_Sib++)
     {
+        Thread->Stats().Shape(Ray_CSG_Child_Bound_Tests)++;
+
+        if (!Ray_BBox_Interval(ray, *Current_Sib, cmin, cmax) || (cmin > tmax) || (cmax < tmin))
+            continue;
+
+        Thread->Stats().Shape(Ray_CSG_Child_Bound_Tests_Succeeded)++;
+
         if ((*Current_Sib)->Bound.empty() == true || Ray_In_Bound(ray, (*Current_Sib)->Bound, Thread))
         {
             if((*Current_Sib)->All_Intersections(ray, Local_Stack, Thread))
@@ -242,7 +553,8 @@ bool CSGIntersection::All_Intersections(const Ray& ray, IStack& Depth_Stack, Tra
                         {
                             if(!((*Inside_Sib)->Type & LIGHT_SOURCE_OBJECT) || (!(reinterpret_cast<LightSource *>(*Inside_Sib))->children.empty()))
                             {
-                                if(!Inside_Object(Local_Stack->top().IPoint, *Inside_Sib, Thread))
+                                if(Outside_Child_BBox(Local_Stack->top().IPoint, *Inside_Sib) ||
+                                   !Inside_Object(Local_Stack->top().IPoint, *Inside_Sib, Thread))
                                 {
                                     Maybe_Found = false;
                                     break;
@@ -270,7 +582,7 @@ bool CSGIntersection::All_Intersections(const Ray& ray, IStack& Depth_Stack, Tra
     }
 
     if(Found)
-        Thread->Stats()[Ray_CSG_Intersection_Tests_Succeeded]++;
+        Thread->Stats().Shape(Ray_CSG_Intersection_Tests_Succeeded)++;
 
     POV_REFPOOL_ASSERT(Local_Stack->empty()); // verify that the IStack is in a cleaned-up condition (again)
     return (Found);
@@ -302,76 +614,95 @@ bool CSGIntersection::All_Intersections(const Ray& ray, IStack& Depth_Stack, Tra
 *
 *   Sep 1994 : Added code to count intersection tests. [DB]
 *
+*   Children whose bounding box is missed by the ray are not intersected,
+*   and inside tests are skipped for children whose bounding box doesn't
+*   contain the intersection.
+*
 ******************************************************************************/
 
 bool CSGMerge::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThreadData *Thread)
 {
     int Found;
-    bool inside_flag;
-    IStack Local_Stack(Thread->stackPool);
-    POV_REFPOOL_ASSERT(Local_Stack->empty()); // verify that the IStack pulled from the pool is in a cleaned-up condition
 
-    Thread->Stats()[Ray_CSG_Merge_Tests]++;
+    Thread->Stats().Shape(Ray_CSG_Merge_Tests)++;
 
-    Found = false;
+    Found = Intersect_Children(ray, Depth_Stack, Thread);
 
-    // FIXME - though the name is misleading, the OPTIMISE_SHADOW_TEST flag can be used to
-    //  determine if we're in a shadow ray, but it SHOULD be renamed.
-    // We should probably change Optimization_Flags to a "ray-type" variable, that will tell
-    // us if it is primary, reflection, refraction, shadow, primary photon, photon refleciton, or photon refraction ray.
-    int shadow_flag = ray.IsShadowTestRay(); // TODO FIXME - why is this flag not used?!
+    if (Found)
+        Thread->Stats().Shape(Ray_CSG_Merge_Tests_Succeeded)++;
 
-    for(vector<ObjectPtr>::const_iterator Sib1 = children.begin(); Sib1 != children.end(); Sib1++)
-    {
-        if ( Test_Ray_Flags_Shadow(ray, (*Sib1)) )// TODO CLARIFY - why does CSGUnion use Test_Ray_Flags(), while CSGMerge uses Test_Ray_Flags_Shadow(), and CSGIntersection uses neither?
-        {
-            if ((*Sib1)->Bound.empty() == true || Ray_In_Bound (ray, (*Sib1)->Bound, Thread))
-            {
-                if ((*Sib1)->All_Intersections (ray, Local_Stack, Thread))
-                {
-                    while (Local_Stack->size() > 0)
-                    {
-                        if (Clip.empty() || Point_In_Clip(Local_Stack->top().IPoint, Clip, Thread))
-                        {
-                            inside_flag = true;
+    return (Found);
+}
 
-                            for(vector<ObjectPtr>::const_iterator Sib2 = children.begin(); (Sib2 != children.end()) && (inside_flag == true); Sib2++)
-                            {
-                                if (*Sib1 != *Sib2)
-                                {
-                                    if (!((*Sib2)->Type & LIGHT_SOURCE_OBJECT) || (!(reinterpret_cast<LightSource *>(*Sib2))->children.empty()))
-                                    {
-                                        if ( Test_Ray_Flags_Shadow(ray, (*Sib2)) )// TODO CLARIFY - why does CSGUnion use Test_Ray_Flags(), while CSGMerge uses Test_Ray_Flags_Shadow(), and CSGIntersection uses neither?
-                                        {
-                                            if (Inside_Object(Local_Stack->top().IPoint, *Sib2, Thread))
-                                                inside_flag = false;
-                                        }
-                                    }
-                                }
-                            }
 
-                            if (inside_flag == true)
-                            {
-                                Local_Stack->top().Csg = this;
 
-                                Found = true;
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   CSGMerge::Intersect_Child
+*
+* INPUT
+*
+* OUTPUT
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Intersect a ray with a single child of a merge, pushing those
+*   intersections onto the stack that are neither clipped away nor
+*   inside any other child.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+bool CSGMerge::Intersect_Child(ObjectPtr child, const Ray& ray, IStack& Depth_Stack, TraceThreadData *Thread)
+{
+    bool Found = false;
+    DBL cmin, cmax;
 
-                                Depth_Stack->push(Local_Stack->top());
-                            }
-                        }
+    if (!Test_Ray_Flags_Shadow(ray, child)) // TODO CLARIFY - why does CSGUnion use Test_Ray_Flags(), while CSGMerge uses Test_Ray_Flags_Shadow(), and CSGIntersection uses neither?
+        return false;
 
-                        Local_Stack->pop();
-                    }
-                }
+    Thread->Stats().Shape(Ray_CSG_Child_Bound_Tests)++;
+
+    if (!Ray_BBox_Interval(ray, child, cmin, cmax))
+        return false;
+
+    Thread->Stats().Shape(Ray_CSG_Child_Bound_Tests_Succeeded)++;
+
+    if (child->Bound.empty() == false && !Ray_In_Bound(ray, child->Bound, Thread))
+        return false;
+
+    IStack Local_Stack(Thread->stackPool);
+    POV_REFPOOL_ASSERT(Local_Stack->empty()); // verify that the IStack pulled from the pool is in a cleaned-up condition
+
+    if (child->All_Intersections(ray, Local_Stack, Thread))
+    {
+        while (Local_Stack->size() > 0)
+        {
+            if ((Clip.empty() || Point_In_Clip(Local_Stack->top().IPoint, Clip, Thread)) &&
+                !Inside_Child(Local_Stack->top().IPoint, child, &ray, Thread))
+            {
+                Local_Stack->top().Csg = this;
+
+                Found = true;
+
+                Depth_Stack->push(Local_Stack->top());
             }
+
+            Local_Stack->pop();
         }
     }
 
-    if (Found)
-        Thread->Stats()[Ray_CSG_Merge_Tests_Succeeded]++;
-
     POV_REFPOOL_ASSERT(Local_Stack->empty()); // verify that the IStack is in a cleaned-up condition (again)
-    return (Found);
+    return Found;
 }
 
 
@@ -404,13 +735,53 @@ bool CSGMerge::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThrea
 
 bool CSGUnion::Inside(const Vector3d& IPoint, TraceThreadData *Thread) const
 {
-    for(vector<ObjectPtr>::const_iterator Current_Sib = children.begin(); Current_Sib != children.end(); Current_Sib++)
+    return Inside_Child(IPoint, nullptr, nullptr, Thread);
+}
+
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   CSGUnion::Inside_Child
+*
+* INPUT
+*
+* OUTPUT
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Test whether a point is inside any child of a union or merge, other
+*   than the one excluded. If there is a bounding hierarchy over the
+*   children, only the children whose bounding box contains the point
+*   are tested, plus those not in the hierarchy.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+bool CSGUnion::Inside_Child(const Vector3d& point, ConstObjectPtr exclude, const Ray *ray, TraceThreadData *Thread) const
+{
+    const vector<ObjectPtr>& linear = (childTree != nullptr) ? childTree->unbounded : children;
+
+    for(vector<ObjectPtr>::const_iterator Current_Sib = linear.begin(); Current_Sib != linear.end(); Current_Sib++)
     {
-        if(!((*Current_Sib)->Type & LIGHT_SOURCE_OBJECT) || (!(reinterpret_cast<LightSource *>(*Current_Sib))->children.empty()))
-        {
-            if(Inside_Object(IPoint, *Current_Sib, Thread))
-                return (true);
-        }
+        if(Point_In_Child(point, *Current_Sib, exclude, ray, Thread))
+            return (true);
+    }
+
+    if(childTree != nullptr)
+    {
+        CSGChildInside inside(point, childTree->bounded, exclude, ray, Thread);
+
+        return (*childTree->tree)(point, inside, true);
     }
 
     return (false);
@@ -446,6 +817,12 @@ bool CSGUnion::Inside(const Vector3d& IPoint, TraceThreadData *Thread) const
 
 bool CSGIntersection::Inside(const Vector3d& IPoint, TraceThreadData *Thread) const
 {
+    // Rule out points outside the bounding box of any child first, which is much cheaper than the inside tests.
+    for(vector<ObjectPtr>::const_iterator Current_Sib = children.begin(); Current_Sib != children.end(); Current_Sib++)
+        if(!((*Current_Sib)->Type & LIGHT_SOURCE_OBJECT) || (!(reinterpret_cast<LightSource *>(*Current_Sib))->children.empty()))
+            if(Outside_Child_BBox(IPoint, *Current_Sib))
+                return (false);
+
     for(vector<ObjectPtr>::const_iterator Current_Sib = children.begin(); Current_Sib != children.end(); Current_Sib++)
         if(!((*Current_Sib)->Type & LIGHT_SOURCE_OBJECT) || (!(reinterpret_cast<LightSource *>(*Current_Sib))->children.empty()))
             if(!Inside_Object(IPoint, (*Current_Sib), Thread))
@@ -488,6 +865,8 @@ void CSG::Translate(const Vector3d& Vector, const TRANSFORM *tr)
     for(vector<ObjectPtr>::iterator Current_Sib = children.begin(); Current_Sib != children.end(); Current_Sib++)
         Translate_Object (*Current_Sib, Vector, tr) ;
 
+    childTree.reset();
+
     Recompute_BBox(&BBox, tr);
 }
 
@@ -525,6 +904,8 @@ void CSG::Rotate(const Vector3d& Vector, const TRANSFORM *tr)
     for(vector<ObjectPtr>::iterator Current_Sib = children.begin(); Current_Sib != children.end(); Current_Sib++)
         Rotate_Object (*Current_Sib, Vector, tr) ;
 
+    childTree.reset();
+
     Recompute_BBox(&BBox, tr);
 }
 
@@ -562,6 +943,8 @@ void CSG::Scale(const Vector3d& Vector, const TRANSFORM *tr)
     for(vector<ObjectPtr>::iterator Current_Sib = children.begin(); Current_Sib != children.end(); Current_Sib++)
         Scale_Object (*Current_Sib, Vector, tr) ;
 
+    childTree.reset();
+
     Recompute_BBox(&BBox, tr);
 }
 
@@ -599,6 +982,8 @@ void CSG::Transform(const TRANSFORM *tr)
     for(vector<ObjectPtr>::iterator Current_Sib = children.begin(); Current_Sib != children.end(); Current_Sib++)
         Transform_Object(*Current_Sib, tr);
 
+    childTree.reset();
+
     Recompute_BBox(&BBox, tr);
 }
 
@@ -789,6 +1174,9 @@ ObjectPtr CSGUnion::Copy()
     Destroy_Transform(New->Trans);
     *New = *this;
 
+    // the copy has children of its own
+    New->childTree.reset();
+
     New->children.clear();
     New->children.reserve(children.size());
     for(vector<ObjectPtr>::iterator i(children.begin()); i != children.end(); i++)
@@ -809,6 +1197,9 @@ ObjectPtr CSGMerge::Copy()
     Destroy_Transform(New->Trans);
     *New = *this;
 
+    // the copy has children of its own
+    New->childTree.reset();
+
     New->children.clear();
     New->children.reserve(children.size());
     for(vector<ObjectPtr>::iterator i(children.begin()); i != children.end(); i++)
@@ -829,6 +1220,9 @@ ObjectPtr CSGIntersection::Copy()
     Destroy_Transform(New->Trans);
     *New = *this;
 
+    // the copy has children of its own
+    New->childTree.reset();
+
     New->children.clear();
     New->children.reserve(children.size());
     for(vector<ObjectPtr>::iterator i(children.begin()); i != children.end(); i++)
@@ -843,6 +1237,62 @@ ObjectPtr CSGIntersection::Copy()
     return (New);
 }
 
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   CSG::Build_Child_Tree
+*
+* INPUT
+*
+* OUTPUT
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Build a bounding hierarchy over the finite children of a union or
+*   merge with many children. Light sources and children whose bounding
+*   box doesn't enclose their interior are kept out of the hierarchy and
+*   tested one by one. Intersections need to test all of their children
+*   regardless, so they never get a hierarchy.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+void CSG::Build_Child_Tree()
+{
+    childTree.reset();
+
+    if ((dynamic_cast<CSGUnion *>(this) == nullptr) || (children.size() < CSG_TREE_MIN_CHILDREN))
+        return;
+
+    std::shared_ptr<CSGChildTree> tree(new CSGChildTree);
+
+    for (vector<ObjectPtr>::const_iterator Current_Sib = children.begin(); Current_Sib != children.end(); Current_Sib++)
+    {
+        if (!((*Current_Sib)->Type & LIGHT_SOURCE_OBJECT) && BBox_Bounds_Interior(*Current_Sib))
+            tree->bounded.push_back(*Current_Sib);
+        else
+            tree->unbounded.push_back(*Current_Sib);
+    }
+
+    if (tree->bounded.size() < CSG_TREE_MIN_CHILDREN)
+        return;
+
+    BVHTree::Statistics stats;
+
+    tree->tree.reset(BVHTree::Create(CSG_BVH_WIDTH));
+    tree->tree->build(CSGChildNoProgress(), CSGChildObjects(tree->bounded), stats);
+
+    childTree = tree;
+}
+
 /*****************************************************************************
 *
 * FUNCTION
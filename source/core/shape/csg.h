@@ -41,9 +41,11 @@
 #include "core/shape/csg_fwd.h"
 
 // C++ variants of C standard header files
-// C++ standard header files
 //  (none at the moment)
 
+// C++ standard header files
+#include <memory>
+
 // POV-Ray header files (base module)
 //  (none at the moment)
 
@@ -77,6 +79,8 @@ namespace pov
 * Global typedefs
 ******************************************************************************/
 
+struct CSGChildTree;
+
 class CSG : public CompoundObject
 {
     public:
@@ -85,6 +89,17 @@ class CSG : public CompoundObject
 
         int do_split;
 
+        /// Build a bounding hierarchy over the children, if there are enough of them for it to pay off.
+        ///
+        /// Unions and merges use the hierarchy to find the children hit by a ray or containing a
+        /// point, rather than testing each child in turn.
+        ///
+        /// @note   Since the children are transformed in place, this must only be called once the
+        ///         object is complete, i.e. after parsing; transforming the object discards the
+        ///         hierarchy again.
+        ///
+        void Build_Child_Tree();
+
         virtual void Normal(Vector3d&, Intersection *, TraceThreadData *) const override { }
         virtual void Translate(const Vector3d&, const TRANSFORM *) override;
         virtual void Rotate(const Vector3d&, const TRANSFORM *) override;
@@ -94,6 +109,11 @@ class CSG : public CompoundObject
         virtual void Compute_BBox() override;
 
         virtual void Determine_Textures(Intersection *isect, bool hitinside, WeightedTextureVector& textures, TraceThreadData *Threaddata) override;
+
+    protected:
+
+        /// Bounding hierarchy over the children, or `nullptr` if they are to be tested one by one.
+        std::shared_ptr<CSGChildTree> childTree;
 };
 
 class CSGUnion : public CSG
@@ -108,6 +128,24 @@ class CSGUnion : public CSG
         virtual bool All_Intersections(const Ray&, IStack&, TraceThreadData *) override;
         virtual bool Inside(const Vector3d&, TraceThreadData *) const override;
         virtual ObjectPtr Invert() override;
+
+        /// Intersect a ray with a single child, pushing the intersections that count onto a stack.
+        virtual bool Intersect_Child(ObjectPtr child, const Ray& ray, IStack& Depth_Stack, TraceThreadData *Thread);
+
+    protected:
+
+        /// Intersect a ray with all children, using the bounding hierarchy if there is one.
+        bool Intersect_Children(const Ray& ray, IStack& Depth_Stack, TraceThreadData *Thread);
+
+        /// Test whether a point is inside any child.
+        ///
+        /// @param[in]  point       Point to test.
+        /// @param[in]  exclude     Child to ignore, or `nullptr`.
+        /// @param[in]  ray         Ray whose flags decide which children to consider (as a merge
+        ///                         does), or `nullptr` to consider all children.
+        /// @param[in]  Thread      Thread data.
+        ///
+        bool Inside_Child(const Vector3d& point, ConstObjectPtr exclude, const Ray *ray, TraceThreadData *Thread) const;
 };
 
 class CSGMerge final : public CSGUnion
@@ -119,6 +157,7 @@ class CSGMerge final : public CSGUnion
         virtual ObjectPtr Copy() override;
 
         virtual bool All_Intersections(const Ray&, IStack&, TraceThreadData *) override;
+        virtual bool Intersect_Child(ObjectPtr child, const Ray& ray, IStack& Depth_Stack, TraceThreadData *Thread) override;
 };
 
 class CSGIntersection final : public CSG
@@ -95,10 +95,10 @@ bool Disc::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThreadDat
 
     Intersection_Found = false;
 
-    Thread->Stats()[Ray_Disc_Tests]++;
+    Thread->Stats().Shape(Ray_Disc_Tests)++;
     if (Intersect(ray, &Depth, uv[0], uv[1]))
     {
-        Thread->Stats()[Ray_Disc_Tests_Succeeded]++;
+        Thread->Stats().Shape(Ray_Disc_Tests_Succeeded)++;
         IPoint = ray.Evaluate(Depth);
 
         if (Clip.empty() || Point_In_Clip(IPoint, Clip, Thread))
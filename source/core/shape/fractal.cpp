@@ -71,6 +71,7 @@ const DBL Fractal_Tolerance = 1e-7;
 #define Normal_Calc(F,V,IS) ( (F)->Rules->CalcNormal(V,(F)->Num_Iterations,F,IS) )
 #define F_Bound(R,F,dm,dM) ( (F)->Rules->Bound(R,F,dm,dM) )
 #define D_Iteration(V,F,I,D,IS) ( (F)->Rules->Iterate(V,F,I,D,IS) )
+#define Batch_Iteration(V,N,F,IS,R) ( (F)->Rules->Iterate(V,N,F,IS,R) )
 
 /*****************************************************************************
 * Local variables
@@ -125,17 +126,19 @@ const COMPLEX_FUNCTION_METHOD Complex_Function_List[] =
 bool Fractal::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThreadData *Thread)
 {
     bool Intersection_Found;
-    bool LastIsInside = false;
     bool CurrentIsInside, NextIsInside;
+    bool Batch_Inside[FractalRules::kMaxBatchSize];
+    unsigned int k;
     DBL Depth, Depth_Max;
     DBL Dist, Dist_Next, LenSqr, LenInv;
 
-    Vector3d IPoint, Mid_Point, Next_Point, Real_Pt;
+    Vector3d IPoint, Next_Point, Real_Pt;
+    Vector3d Batch_Points[FractalRules::kMaxBatchSize];
     Vector3d Real_Normal, F_Normal;
     Vector3d Direction;
     BasicRay New_Ray;
 
-    Thread->Stats()[Ray_Fractal_Tests]++;
+    Thread->Stats().Shape(Ray_Fractal_Tests)++;
 
     Intersection_Found = false;
 
@@ -227,7 +230,7 @@ bool Fractal::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThread
             if (Depth > Depth_Max)
             {
                 if (Intersection_Found)
-                    Thread->Stats()[Ray_Fractal_Tests_Succeeded]++;
+                    Thread->Stats().Shape(Ray_Fractal_Tests_Succeeded)++;
                 return (Intersection_Found);
             }
 
@@ -249,46 +252,53 @@ bool Fractal::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThread
             }
         }
 
-        /* then, polish the root via bisection method... */
+        /*
+         * then, polish the root: split the interval at several points tested
+         * in one batch, and keep the sub-interval where the surface is first
+         * crossed...
+         */
 
         while (Dist > Fractal_Tolerance)
         {
-            Dist *= 0.5;
-            Mid_Point = IPoint + Dist * Direction;
+            Dist /= (DBL)(FractalRules::kMaxBatchSize + 1);
+
+            for (k = 0; k < FractalRules::kMaxBatchSize; ++k)
+                Batch_Points[k] = IPoint + ((DBL)(k + 1) * Dist) * Direction;
+
+            Batch_Iteration(Batch_Points, FractalRules::kMaxBatchSize, this, Thread->Fractal_IStack, Batch_Inside);
 
-            LastIsInside = Iteration(Mid_Point, this, Thread->Fractal_IStack);
+            for (k = 0; k < FractalRules::kMaxBatchSize; ++k)
+            {
+                if (Batch_Inside[k] != CurrentIsInside)
+                    break;
+            }
 
-            if (LastIsInside == CurrentIsInside)
+            if (k > 0)
             {
-                IPoint = Mid_Point;
+                IPoint = Batch_Points[k - 1];
 
-                Depth += Dist;
+                Depth += (DBL)k * Dist;
 
                 if (Depth > Depth_Max)
                 {
                     if (Intersection_Found)
-                        Thread->Stats()[Ray_Fractal_Tests_Succeeded]++;
+                        Thread->Stats().Shape(Ray_Fractal_Tests_Succeeded)++;
                     return (Intersection_Found);
                 }
             }
         }
 
-        if (!CurrentIsInside) /* Mid_Point isn't inside the set */
+        if (!CurrentIsInside) /* IPoint isn't inside the set */
         {
             IPoint += Dist * Direction;
 
             Depth += Dist;
-
-            Iteration(IPoint, this, Thread->Fractal_IStack);
-        }
-        else
-        {
-            if (LastIsInside != CurrentIsInside)
-            {
-                Iteration(IPoint, this, Thread->Fractal_IStack);
-            }
         }
 
+        /* the batched tests leave no iteration sequence for the normal */
+
+        Iteration(IPoint, this, Thread->Fractal_IStack);
+
         if (Trans != nullptr)
         {
             MTransPoint(Real_Pt, IPoint, Trans);
@@ -324,7 +334,7 @@ bool Fractal::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThread
     }
 
     if (Intersection_Found)
-        Thread->Stats()[Ray_Fractal_Tests_Succeeded]++;
+        Thread->Stats().Shape(Ray_Fractal_Tests_Succeeded)++;
     return (Intersection_Found);
 }
 
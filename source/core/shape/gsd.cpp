@@ -146,7 +146,7 @@ bool GSDInterUnion::All_Intersections(const Ray& ray, IStack& Depth_Stack, Trace
 	IStack Local_Stack(Thread->stackPool);
 	assert(Local_Stack->empty()); // verify that the IStack pulled from the pool is in a cleaned-up condition
 
-	Thread->Stats()[Ray_GSD_Interunion_Tests]++;
+	Thread->Stats().Shape(Ray_GSD_Interunion_Tests)++;
 
 	Found = false;
 
@@ -190,7 +190,7 @@ bool GSDInterUnion::All_Intersections(const Ray& ray, IStack& Depth_Stack, Trace
 	}
 
 	if(Found)
-		Thread->Stats()[Ray_GSD_Interunion_Tests_Succeeded]++;
+		Thread->Stats().Shape(Ray_GSD_Interunion_Tests_Succeeded)++;
 
 	assert(Local_Stack->empty()); // verify that the IStack is in a cleaned-up condition (again)
 	return (Found);
@@ -203,7 +203,7 @@ bool GSDInterMerge::All_Intersections(const Ray& ray, IStack& Depth_Stack, Trace
 	IStack Local_Stack(Thread->stackPool);
 	assert(Local_Stack->empty()); // verify that the IStack pulled from the pool is in a cleaned-up condition
 
-	Thread->Stats()[Ray_GSD_Interunion_Tests]++;
+	Thread->Stats().Shape(Ray_GSD_Interunion_Tests)++;
 
 	Found = false;
 
@@ -252,7 +252,7 @@ bool GSDInterMerge::All_Intersections(const Ray& ray, IStack& Depth_Stack, Trace
 	}
 
 	if(Found)
-		Thread->Stats()[Ray_GSD_Interunion_Tests_Succeeded]++;
+		Thread->Stats().Shape(Ray_GSD_Interunion_Tests_Succeeded)++;
 
 	assert(Local_Stack->empty()); // verify that the IStack is in a cleaned-up condition (again)
 	return (Found);
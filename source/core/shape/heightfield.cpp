@@ -63,6 +63,11 @@
 
 // C++ standard header files
 #include <algorithm>
+#include <atomic>
+#include <exception>
+#include <system_error>
+#include <thread>
+#include <vector>
 
 // POV-Ray header files (base module)
 #include "base/pov_err.h"
@@ -98,6 +103,18 @@ const DBL HFIELD_OFFSET = 0.001;
 
 const DBL HFIELD_TOLERANCE = 1.0e-6;
 
+/* Size of the finest min/max hierarchy nodes, as a power of two of cells per side. */
+
+const int HFIELD_MIP_LEAF_SHIFT = 2;
+
+/* Minimum number of rows per strip when preparing a height field in parallel. */
+
+const int HFIELD_MIN_STRIP_ROWS = 64;
+
+/* Number of strips per thread when preparing a height field in parallel, to even out the load. */
+
+const int HFIELD_STRIPS_PER_THREAD = 4;
+
 
 //****************************************************************************
 // Local Types
@@ -111,6 +128,20 @@ struct HFBlock final
     DBL ymin, ymax;
 };
 
+/// Height range of a node in the min/max hierarchy.
+struct HFMipNode final
+{
+    HF_VAL ymin, ymax;
+};
+
+/// One level of the min/max hierarchy, covering square regions of `1 << shift` cells per side.
+struct HFMipLevel final
+{
+    int shift;
+    int size_x, size_z;
+    std::vector<HFMipNode> Nodes;
+};
+
 struct HFData final
 {
     int References;
@@ -119,12 +150,78 @@ struct HFData final
     HF_VAL min_y, max_y;
     int block_max_x, block_max_z;
     int block_width_x, block_width_z;
+    HF_VAL *Heights;     /* All rows of the map in a single allocation. */
     HF_VAL **Map;
     HF_Normals **Normals;
     HFBlock **Block;
+    std::vector<HFMipLevel> Mip; /* Min/max hierarchy, finest level first; empty if not used. */
 };
 
 
+/*****************************************************************************
+* Local functions
+******************************************************************************/
+
+/// Get the number of strips to split a number of rows into for preparing them in parallel.
+static int HField_Strips(int rows, unsigned int threads)
+{
+    if (threads <= 1)
+        return 1;
+
+    return max(1, min((int)threads * HFIELD_STRIPS_PER_THREAD, rows / HFIELD_MIN_STRIP_ROWS));
+}
+
+/// Run a function on each strip of a number of rows, in parallel.
+///
+/// The function is called as `fn(strip, first, end)` for the rows from `first` up to but not
+/// including `end`; the strips are handed out to the threads as they become idle. If any of the
+/// calls throws an exception, the exception of the lowest-numbered strip is re-thrown once all
+/// strips are done.
+///
+template<typename FN>
+static void HField_Parallel_Rows(int rows, int strips, unsigned int threads, const FN& fn)
+{
+    std::vector<std::exception_ptr> errors(strips);
+    std::atomic<int> next(0);
+
+    auto work = [&]()
+    {
+        for (int strip = next++; strip < strips; strip = next++)
+        {
+            try
+            {
+                fn(strip, (int)((POV_LONG)rows * strip / strips), (int)((POV_LONG)rows * (strip + 1) / strips));
+            }
+            catch (...)
+            {
+                errors[strip] = std::current_exception();
+            }
+        }
+    };
+
+    std::vector<std::thread> helpers;
+    for (int t = 1; t < min((int)threads, strips); t++)
+    {
+        try
+        {
+            helpers.emplace_back(work);
+        }
+        catch (std::system_error&)
+        {
+            break; // no more threads available; the others will pick up the work
+        }
+    }
+    work();
+
+    for (auto& helper : helpers)
+        helper.join();
+
+    for (auto& error : errors)
+        if (error)
+            std::rethrow_exception(error);
+}
+
+
 /*****************************************************************************
 *
 * FUNCTION
@@ -158,12 +255,12 @@ bool HField::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThreadD
     BasicRay Temp_Ray;
     DBL depth1, depth2;
 
-    Thread->Stats()[Ray_HField_Tests]++;
+    Thread->Stats().Shape(Ray_HField_Tests)++;
 
     MInvTransRay(Temp_Ray, ray, Trans);
 
 #ifdef HFIELD_EXTRA_STATS
-    Thread->Stats()[Ray_HField_Box_Tests]++;
+    Thread->Stats().Shape(Ray_HField_Box_Tests)++;
 #endif
 
     if (!Box::Intersect(Temp_Ray, nullptr, bounding_corner1, bounding_corner2, &depth1, &depth2, &Side1, &Side2))
@@ -172,7 +269,7 @@ bool HField::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThreadD
     }
 
 #ifdef HFIELD_EXTRA_STATS
-    Thread->Stats()[Ray_HField_Box_Tests_Succeeded]++;
+    Thread->Stats().Shape(Ray_HField_Box_Tests_Succeeded)++;
 #endif
 
     if (depth1 < HFIELD_TOLERANCE)
@@ -189,7 +286,7 @@ bool HField::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThreadD
 
     if (block_traversal(Temp_Ray, Start, Depth_Stack, ray, depth1, depth2, Thread))
     {
-        Thread->Stats()[Ray_HField_Tests_Succeeded]++;
+        Thread->Stats().Shape(Ray_HField_Tests_Succeeded)++;
 
         return(true);
     }
@@ -487,7 +584,7 @@ bool HField::intersect_pixel(int x, int z, const BasicRay &ray, DBL height1, DBL
     Vector3d N, V1;
 
 #ifdef HFIELD_EXTRA_STATS
-    Thread->Stats()[Ray_HField_Cell_Tests]++;
+    Thread->Stats().Shape(Ray_HField_Cell_Tests)++;
 #endif
 
     if (z>Data->max_z) z = Data->max_z;
@@ -520,7 +617,7 @@ bool HField::intersect_pixel(int x, int z, const BasicRay &ray, DBL height1, DBL
     }
 
 #ifdef HFIELD_EXTRA_STATS
-    Thread->Stats()[Ray_HField_Cell_Tests_Succeeded]++;
+    Thread->Stats().Shape(Ray_HField_Cell_Tests_Succeeded)++;
 #endif
 
     Found = false;
@@ -533,7 +630,7 @@ bool HField::intersect_pixel(int x, int z, const BasicRay &ray, DBL height1, DBL
     if ((max_height >= height1) && (min_height <= height2))
     {
 #ifdef HFIELD_EXTRA_STATS
-        Thread->Stats()[Ray_HField_Triangle_Tests]++;
+        Thread->Stats().Shape(Ray_HField_Triangle_Tests)++;
 #endif
 
         /* Set up triangle. */
@@ -572,7 +669,7 @@ bool HField::intersect_pixel(int x, int z, const BasicRay &ray, DBL height1, DBL
                     // (Check whether the point of intersection with the plane is within the triangle)
                 {
 #ifdef HFIELD_EXTRA_STATS
-                    Thread->Stats()[Ray_HField_Triangle_Tests_Succeeded]++;
+                    Thread->Stats().Shape(Ray_HField_Triangle_Tests_Succeeded)++;
 #endif
 
                     P = RRay.Evaluate(depth1);
@@ -611,7 +708,7 @@ bool HField::intersect_pixel(int x, int z, const BasicRay &ray, DBL height1, DBL
     if ((max_height >= height1) && (min_height <= height2))
     {
 #ifdef HFIELD_EXTRA_STATS
-        Thread->Stats()[Ray_HField_Triangle_Tests]++;
+        Thread->Stats().Shape(Ray_HField_Triangle_Tests)++;
 #endif
 
         /* Set up triangle. */
@@ -650,7 +747,7 @@ bool HField::intersect_pixel(int x, int z, const BasicRay &ray, DBL height1, DBL
                     // (Check whether the point of intersection with the plane is within the triangle)
                 {
 #ifdef HFIELD_EXTRA_STATS
-                    Thread->Stats()[Ray_HField_Triangle_Tests_Succeeded]++;
+                    Thread->Stats().Shape(Ray_HField_Triangle_Tests_Succeeded)++;
 #endif
 
                     P = RRay.Evaluate(depth2);
@@ -774,16 +871,17 @@ int HField::add_single_normal(HF_VAL **data, int xsize, int zsize, int x0, int z
 *   routine will walk through the data and produce averaged normals
 *   for all points on the grid.
 *
+*   The rows are processed in strips, in parallel if more than one
+*   thread is given.
+*
 * CHANGES
 *
 *   -
 *
 ******************************************************************************/
 
-void HField::smooth_height_field(int xsize, int zsize)
+void HField::smooth_height_field(int xsize, int zsize, unsigned int threads)
 {
-    int i, j, k;
-    Vector3d N;
     HF_VAL **map = Data->Map;
 
     /* First off, allocate all the memory needed to store the normal information */
@@ -792,7 +890,7 @@ void HField::smooth_height_field(int xsize, int zsize)
 
     Data->Normals = new HF_Normals*[zsize+1];
 
-    for (i = 0; i <= zsize; i++)
+    for (int i = 0; i <= zsize; i++)
     {
         Data->Normals[i] = new HF_Normals[xsize+1];
     }
@@ -802,31 +900,37 @@ void HField::smooth_height_field(int xsize, int zsize)
      * individually for each elevation point.
      */
 
-    for (i = 0; i <= zsize; i++)
+    HField_Parallel_Rows(zsize+1, HField_Strips(zsize+1, threads), threads, [&](int, int first, int end)
     {
-        for (j = 0; j <= xsize; j++)
+        Vector3d N;
+        int k;
+
+        for (int i = first; i < end; i++)
         {
-            N = Vector3d(0.0, 0.0, 0.0);
+            for (int j = 0; j <= xsize; j++)
+            {
+                N = Vector3d(0.0, 0.0, 0.0);
 
-            k = 0;
+                k = 0;
 
-            k += add_single_normal(map, xsize, zsize, j, i, j+1, i, j, i+1, N);
-            k += add_single_normal(map, xsize, zsize, j, i, j, i+1, j-1, i, N);
-            k += add_single_normal(map, xsize, zsize, j, i, j-1, i, j, i-1, N);
-            k += add_single_normal(map, xsize, zsize, j, i, j, i-1, j+1, i, N);
+                k += add_single_normal(map, xsize, zsize, j, i, j+1, i, j, i+1, N);
+                k += add_single_normal(map, xsize, zsize, j, i, j, i+1, j-1, i, N);
+                k += add_single_normal(map, xsize, zsize, j, i, j-1, i, j, i-1, N);
+                k += add_single_normal(map, xsize, zsize, j, i, j, i-1, j+1, i, N);
 
-            if (k == 0)
-            {
-                throw POV_EXCEPTION_STRING("Failed to find any normals at.");
-            }
+                if (k == 0)
+                {
+                    throw POV_EXCEPTION_STRING("Failed to find any normals at.");
+                }
 
-            N.normalize();
+                N.normalize();
 
-            Data->Normals[i][j][0] = (short)(32767 * N[X]);
-            Data->Normals[i][j][1] = (short)(32767 * N[Y]);
-            Data->Normals[i][j][2] = (short)(32767 * N[Z]);
+                Data->Normals[i][j][0] = (short)(32767 * N[X]);
+                Data->Normals[i][j][1] = (short)(32767 * N[Y]);
+                Data->Normals[i][j][2] = (short)(32767 * N[Z]);
+            }
         }
-    }
+    });
 }
 
 
@@ -852,47 +956,68 @@ void HField::smooth_height_field(int xsize, int zsize)
 *   Copy image data into height field map. Create bounding blocks
 *   for the block traversal. Calculate normals for smoothed height fields.
 *
+*   Each of these steps works on strips of rows, using up to the given
+*   number of threads.
+*
 * CHANGES
 *
 *   Feb 1995 : Modified to work with new intersection functions. [DB]
 *
 ******************************************************************************/
 
-void HField::Compute_HField(const ImageData *image)
+void HField::Compute_HField(const ImageData *image, unsigned int threads)
 {
-    int x, z, max_x, max_z;
-    HF_VAL min_y, max_y, temp_y;
+    int z, max_x, max_z;
+    HF_VAL min_y, max_y;
+
+    /* Get height field map size, making sure the image has been decoded first. */
 
-    /* Get height field map size. */
+    Resolve_Image(image);
 
     max_x = image->iwidth;
     max_z = image->iheight;
 
     /* Allocate memory for map. */
 
+    Data->Heights = new HF_VAL[(size_t)max_x * (size_t)max_z];
+
     Data->Map = new HF_VAL*[max_z];
 
     for (z = 0; z < max_z; z++)
     {
-        Data->Map[z] = new HF_VAL[max_x];
+        Data->Map[z] = Data->Heights + (size_t)z * (size_t)max_x;
     }
 
-    /* Copy map. */
+    /* Copy map, keeping track of the height range of each strip of rows. */
 
-    min_y = 65535L;
-    max_y = 0;
+    int strips = HField_Strips(max_z, threads);
+    std::vector<HF_VAL> strip_min_y(strips, 65535), strip_max_y(strips, 0);
 
-    for (z = 0; z < max_z; z++)
+    HField_Parallel_Rows(max_z, strips, threads, [&](int strip, int first, int end)
     {
-        for (x = 0; x < max_x; x++)
+        HF_VAL temp_y;
+
+        for (int z = first; z < end; z++)
         {
-            temp_y = image_height_at(image, x, max_z - z - 1);
+            for (int x = 0; x < max_x; x++)
+            {
+                temp_y = image_height_at(image, x, max_z - z - 1);
 
-            Data->Map[z][x] = temp_y;
+                Data->Map[z][x] = temp_y;
 
-            min_y = min(min_y, temp_y);
-            max_y = max(max_y, temp_y);
+                strip_min_y[strip] = min(strip_min_y[strip], temp_y);
+                strip_max_y[strip] = max(strip_max_y[strip], temp_y);
+            }
         }
+    });
+
+    min_y = 65535L;
+    max_y = 0;
+
+    for (int i = 0; i < strips; i++)
+    {
+        min_y = min(min_y, strip_min_y[i]);
+        max_y = max(max_y, strip_max_y[i]);
     }
 
     /* Resize bounding box. */
@@ -907,13 +1032,149 @@ void HField::Compute_HField(const ImageData *image)
 
     if (Test_Flag(this, SMOOTHED_FLAG))
     {
-        smooth_height_field(max_x-1, max_z-1);
+        smooth_height_field(max_x-1, max_z-1, threads);
     }
 
     Data->max_x = max_x-2;
     Data->max_z = max_z-2;
 
-    build_hfield_blocks();
+    if (Test_Flag(this, HIERARCHY_FLAG))
+    {
+        build_hfield_mip(threads);
+    }
+
+    build_hfield_blocks(threads);
+}
+
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   build_hfield_mip
+*
+* INPUT
+*
+* OUTPUT
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Create the min/max quadtree used by the hierarchical traversal.
+*
+*   The finest level stores the height range of regions of 4 x 4 cells,
+*   each coarser level combines 2 x 2 nodes of the level below, up to a
+*   single node covering the whole height field. Height fields fitting
+*   into a single finest-level node don't get a hierarchy at all.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+void HField::build_hfield_mip(unsigned int threads)
+{
+    int cells_x, cells_z;
+    int x, z, i, j;
+    HF_VAL ymin, ymax;
+
+    Data->Mip.clear();
+
+    cells_x = Data->max_x + 1;
+    cells_z = Data->max_z + 1;
+
+    if (max(cells_x, cells_z) <= (1 << HFIELD_MIP_LEAF_SHIFT))
+    {
+        return;
+    }
+
+    /* Finest level, computed from the height map. Note that a region of n cells spans n+1 heights. */
+
+    Data->Mip.push_back(HFMipLevel());
+
+    HFMipLevel *Level = &Data->Mip.back();
+
+    Level->shift  = HFIELD_MIP_LEAF_SHIFT;
+    Level->size_x = (cells_x + (1 << HFIELD_MIP_LEAF_SHIFT) - 1) >> HFIELD_MIP_LEAF_SHIFT;
+    Level->size_z = (cells_z + (1 << HFIELD_MIP_LEAF_SHIFT) - 1) >> HFIELD_MIP_LEAF_SHIFT;
+    Level->Nodes.resize((size_t)Level->size_x * (size_t)Level->size_z);
+
+    /* Rows of nodes are independent of each other, so they can be computed in parallel. */
+
+    HField_Parallel_Rows(Level->size_z, HField_Strips(Level->size_z << HFIELD_MIP_LEAF_SHIFT, threads), threads, [&](int, int first, int end)
+    {
+        int xmin, xmax, zmin, zmax;
+        HF_VAL ymin, ymax;
+
+        for (int z = first; z < end; z++)
+        {
+            zmin = z << HFIELD_MIP_LEAF_SHIFT;
+            zmax = min((z + 1) << HFIELD_MIP_LEAF_SHIFT, cells_z);
+
+            for (int x = 0; x < Level->size_x; x++)
+            {
+                xmin = x << HFIELD_MIP_LEAF_SHIFT;
+                xmax = min((x + 1) << HFIELD_MIP_LEAF_SHIFT, cells_x);
+
+                ymin = 65535;
+                ymax = 0;
+
+                for (int j = zmin; j <= zmax; j++)
+                {
+                    for (int i = xmin; i <= xmax; i++)
+                    {
+                        ymin = min(ymin, Data->Map[j][i]);
+                        ymax = max(ymax, Data->Map[j][i]);
+                    }
+                }
+
+                Level->Nodes[(size_t)z * Level->size_x + x].ymin = ymin;
+                Level->Nodes[(size_t)z * Level->size_x + x].ymax = ymax;
+            }
+        }
+    });
+
+    /* Coarser levels, computed from the level below. */
+
+    while ((Data->Mip.back().size_x > 1) || (Data->Mip.back().size_z > 1))
+    {
+        Data->Mip.push_back(HFMipLevel());
+
+        const HFMipLevel *Child = &Data->Mip[Data->Mip.size() - 2];
+
+        Level = &Data->Mip.back();
+
+        Level->shift  = Child->shift + 1;
+        Level->size_x = (Child->size_x + 1) >> 1;
+        Level->size_z = (Child->size_z + 1) >> 1;
+        Level->Nodes.resize((size_t)Level->size_x * (size_t)Level->size_z);
+
+        for (z = 0; z < Level->size_z; z++)
+        {
+            for (x = 0; x < Level->size_x; x++)
+            {
+                ymin = 65535;
+                ymax = 0;
+
+                for (j = 2 * z; j < min(2 * z + 2, Child->size_z); j++)
+                {
+                    for (i = 2 * x; i < min(2 * x + 2, Child->size_x); i++)
+                    {
+                        ymin = min(ymin, Child->Nodes[(size_t)j * Child->size_x + i].ymin);
+                        ymax = max(ymax, Child->Nodes[(size_t)j * Child->size_x + i].ymax);
+                    }
+                }
+
+                Level->Nodes[(size_t)z * Level->size_x + x].ymin = ymin;
+                Level->Nodes[(size_t)z * Level->size_x + x].ymax = ymax;
+            }
+        }
+    }
 }
 
 
@@ -938,18 +1199,22 @@ void HField::Compute_HField(const ImageData *image)
 *
 *   Create the bounding block hierarchy used by the block traversal.
 *
+*   If a min/max quadtree has been built, a single block is used, as the
+*   quadtree takes over the job of the block grid.
+*
+*   Rows of blocks are computed in parallel if more than one thread is
+*   given.
+*
 * CHANGES
 *
 *   Feb 1995 : Creation.
 *
 ******************************************************************************/
 
-void HField::build_hfield_blocks()
+void HField::build_hfield_blocks(unsigned int threads)
 {
-    int x, z, nx, nz, wx, wz;
-    int i, j;
-    int xmin, xmax, zmin, zmax;
-    DBL y, ymin, ymax, water;
+    int nx, nz, wx, wz;
+    DBL water;
 
     /* Get block size. */
 
@@ -973,7 +1238,7 @@ void HField::build_hfield_blocks()
         nz++;
     }
 
-    if (!Test_Flag(this, HIERARCHY_FLAG) || ((nx == 1) && (nz == 1)))
+    if (!Test_Flag(this, HIERARCHY_FLAG) || !Data->Mip.empty() || ((nx == 1) && (nz == 1)))
     {
         /* We don't want a bounding hierarchy. Just use one block. */
 
@@ -1016,47 +1281,55 @@ void HField::build_hfield_blocks()
 
     water = bounding_corner1[Y];
 
-    for (z = 0; z < nz; z++)
+    /* Strips are counted in height field rows, as that's what the work scales with. */
+
+    HField_Parallel_Rows(nz, min(nz, HField_Strips(Data->max_z + 2, threads)), threads, [&](int, int first, int end)
     {
-        Data->Block[z] = new HFBlock[nx];
+        int xmin, xmax, zmin, zmax;
+        DBL y, ymin, ymax;
 
-        for (x = 0; x < nx; x++)
+        for (int z = first; z < end; z++)
         {
-            /* Get block's borders. */
+            Data->Block[z] = new HFBlock[nx];
+
+            for (int x = 0; x < nx; x++)
+            {
+                /* Get block's borders. */
 
-            xmin = x * wx;
-            zmin = z * wz;
+                xmin = x * wx;
+                zmin = z * wz;
 
-            xmax = min((x + 1) * wx - 1, Data->max_x);
-            zmax = min((z + 1) * wz - 1, Data->max_z);
+                xmax = min((x + 1) * wx - 1, Data->max_x);
+                zmax = min((z + 1) * wz - 1, Data->max_z);
 
-            /* Find min. and max. height in current block. */
+                /* Find min. and max. height in current block. */
 
-            ymin = BOUND_HUGE;
-            ymax = -BOUND_HUGE;
+                ymin = BOUND_HUGE;
+                ymax = -BOUND_HUGE;
 
-            for (i = xmin; i <= xmax+1; i++)
-            {
-                for (j = zmin; j <= zmax+1; j++)
+                for (int i = xmin; i <= xmax+1; i++)
                 {
-                    y = Get_Height(i, j);
+                    for (int j = zmin; j <= zmax+1; j++)
+                    {
+                        y = Get_Height(i, j);
 
-                    ymin = min(ymin, y);
-                    ymax = max(ymax, y);
+                        ymin = min(ymin, y);
+                        ymax = max(ymax, y);
+                    }
                 }
-            }
 
-            /* Store block's borders. */
+                /* Store block's borders. */
 
-            Data->Block[z][x].xmin = xmin;
-            Data->Block[z][x].xmax = xmax;
-            Data->Block[z][x].zmin = zmin;
-            Data->Block[z][x].zmax = zmax;
+                Data->Block[z][x].xmin = xmin;
+                Data->Block[z][x].xmax = xmax;
+                Data->Block[z][x].zmin = zmin;
+                Data->Block[z][x].zmax = zmax;
 
-            Data->Block[z][x].ymin = max(ymin, water) - HFIELD_OFFSET;
-            Data->Block[z][x].ymax = ymax + HFIELD_OFFSET;
+                Data->Block[z][x].ymin = max(ymin, water) - HFIELD_OFFSET;
+                Data->Block[z][x].ymax = ymax + HFIELD_OFFSET;
+            }
         }
-    }
+    });
 }
 
 
@@ -1236,8 +1509,10 @@ HField::HField() : ObjectBase(HFIELD_OBJECT)
 
     Data->Normals_Height = 0;
 
+    Data->Heights = nullptr;
     Data->Map     = nullptr;
     Data->Normals = nullptr;
+    Data->Block   = nullptr;
 
     Data->max_x = 0;
     Data->max_z = 0;
@@ -1338,17 +1613,14 @@ HField::~HField()
     {
         if (Data->Map != nullptr)
         {
-            for (i = 0; i < Data->max_z+2; i++)
-            {
-                if (Data->Map[i] != nullptr)
-                {
-                    delete[] Data->Map[i];
-                }
-            }
-
             delete[] Data->Map;
         }
 
+        if (Data->Heights != nullptr)
+        {
+            delete[] Data->Heights;
+        }
+
         if (Data->Normals != nullptr)
         {
             for (i = 0; i < Data->Normals_Height; i++)
@@ -1920,6 +2192,13 @@ bool HField::block_traversal(const BasicRay &ray, const Vector3d& Start, IStack
         return intersect_pixel(x, z, ray, min(neary, fary), max(neary, fary), HField_Stack, RRay, mindist, maxdist, Thread);
     }
 
+    /* If we have a min/max quadtree we descend it. */
+
+    if (!Data->Mip.empty())
+    {
+        return mip_traversal(ray, Data->Mip.back().shift, 0, 0, mindist, maxdist, HField_Stack, RRay, mindist, maxdist, Thread);
+    }
+
     /* If we don't have blocks we just step through the grid. */
 
     if ((Data->block_max_x <= 1) && (Data->block_max_z <= 1))
@@ -1960,7 +2239,7 @@ bool HField::block_traversal(const BasicRay &ray, const Vector3d& Start, IStack
     do
     {
 #ifdef HFIELD_EXTRA_STATS
-        Thread->Stats()[Ray_HField_Block_Tests]++;
+        Thread->Stats().Shape(Ray_HField_Block_Tests)++;
 #endif
 
         /* Get current block. */
@@ -2060,7 +2339,7 @@ bool HField::block_traversal(const BasicRay &ray, const Vector3d& Start, IStack
             /* Test current block. */
 
 #ifdef HFIELD_EXTRA_STATS
-            Thread->Stats()[Ray_HField_Block_Tests_Succeeded]++;
+            Thread->Stats().Shape(Ray_HField_Block_Tests_Succeeded)++;
 #endif
 
             if (dda_traversal(ray, nearP, &Data->Block[z][x], HField_Stack, RRay, mindist, maxdist, Thread))
@@ -2090,5 +2369,160 @@ bool HField::block_traversal(const BasicRay &ray, const Vector3d& Start, IStack
     return(found);
 }
 
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   mip_traversal
+*
+* INPUT
+*
+*   Ray    - Current ray
+*   shift  - Size of the current node, as a power of two of cells per side
+*   x, z   - Indices of the current node
+*   t0, t1 - Part of the ray inside the current node
+*
+* OUTPUT
+*
+* RETURNS
+*
+*   int - true if intersection was found
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Traverse the min/max quadtree of the height field. Nodes whose height
+*   range doesn't overlap the part of the ray passing over them are skipped
+*   as a whole; otherwise the children are visited in the order the ray
+*   passes through them, down to the individual cells. Below the finest
+*   level of the quadtree the cells' own height test does the culling.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+bool HField::mip_traversal(const BasicRay &ray, int shift, int x, int z, DBL t0, DBL t1, IStack &HField_Stack, const BasicRay &RRay, DBL mindist, DBL maxdist, TraceThreadData *Thread)
+{
+    int i, n, cx, cz;
+    int found = false;
+    DBL y1, y2, t, tm;
+    DBL xmid, zmid;
+    DBL split[4];
+
+    /* Get height range of the ray inside the node. */
+
+    y1 = ray.Origin[Y] + t0 * ray.Direction[Y];
+    y2 = ray.Origin[Y] + t1 * ray.Direction[Y];
+
+    if (y1 > y2)
+    {
+        std::swap(y1, y2);
+    }
+
+    y1 -= EPSILON;
+    y2 += EPSILON;
+
+    if (shift == 0)
+    {
+        return intersect_pixel(x, z, ray, y1, y2, HField_Stack, RRay, mindist, maxdist, Thread);
+    }
+
+    if (shift >= HFIELD_MIP_LEAF_SHIFT)
+    {
+#ifdef HFIELD_EXTRA_STATS
+        Thread->Stats().Shape(Ray_HField_Block_Tests)++;
+#endif
+
+        const HFMipLevel& Level = Data->Mip[shift - HFIELD_MIP_LEAF_SHIFT];
+        const HFMipNode& Node = Level.Nodes[(size_t)z * Level.size_x + x];
+
+        if ((y1 > (DBL)Node.ymax) || (y2 < (DBL)Node.ymin))
+        {
+            return(false);
+        }
+
+#ifdef HFIELD_EXTRA_STATS
+        Thread->Stats().Shape(Ray_HField_Block_Tests_Succeeded)++;
+#endif
+    }
+
+    /* Split the ray at the planes dividing the node into its children. */
+
+    xmid = (DBL)((2 * x + 1) << (shift - 1));
+    zmid = (DBL)((2 * z + 1) << (shift - 1));
+
+    n = 0;
+
+    split[n++] = t0;
+
+    if (fabs(ray.Direction[X]) >= EPSILON)
+    {
+        t = (xmid - ray.Origin[X]) / ray.Direction[X];
+
+        if ((t > t0) && (t < t1))
+        {
+            split[n++] = t;
+        }
+    }
+
+    if (fabs(ray.Direction[Z]) >= EPSILON)
+    {
+        t = (zmid - ray.Origin[Z]) / ray.Direction[Z];
+
+        if ((t > t0) && (t < t1))
+        {
+            split[n++] = t;
+        }
+    }
+
+    if ((n == 3) && (split[2] < split[1]))
+    {
+        std::swap(split[1], split[2]);
+    }
+
+    split[n++] = t1;
+
+    /* Visit the children in the order the ray passes through them. */
+
+    for (i = 0; i < n - 1; i++)
+    {
+        if (split[i + 1] <= split[i])
+        {
+            continue;
+        }
+
+        tm = 0.5 * (split[i] + split[i + 1]);
+
+        cx = 2 * x + ((ray.Origin[X] + tm * ray.Direction[X] >= xmid) ? 1 : 0);
+        cz = 2 * z + ((ray.Origin[Z] + tm * ray.Direction[Z] >= zmid) ? 1 : 0);
+
+        /* Skip children beyond the border of the height field. */
+
+        if (((cx << (shift - 1)) > Data->max_x) || ((cz << (shift - 1)) > Data->max_z))
+        {
+            continue;
+        }
+
+        if (mip_traversal(ray, shift - 1, cx, cz, split[i], split[i + 1], HField_Stack, RRay, mindist, maxdist, Thread))
+        {
+            if (Type & IS_CHILD_OBJECT)
+            {
+                found = true;
+            }
+            else
+            {
+                return(true);
+            }
+        }
+    }
+
+    return(found);
+}
+
 }
 // end of namespace pov
@@ -88,7 +88,9 @@ class ImageData;
 ///
 /// The basic intersection routine first computes the ray's intersection with the box marking the limits of the shape,
 /// then follows the line from one intersection point to the other, testing the two triangles which form the pixel for
-/// an intersection with the ray at each step.
+/// an intersection with the ray at each step. If a bounding hierarchy is used on a large height field, the line is
+/// instead followed through a min/max quadtree of the heights, skipping any region the ray passes entirely above or
+/// below.
 ///
 class HField final : public ObjectBase
 {
@@ -111,15 +113,22 @@ class HField final : public ObjectBase
         virtual void Transform(const TRANSFORM *) override;
         virtual void Compute_BBox() override;
 
-        void Compute_HField(const ImageData *image);
+        /// Set up the height field from an image.
+        ///
+        /// @param  image       Image to take the heights from.
+        /// @param  threads     Maximum number of threads to use.
+        ///
+        void Compute_HField(const ImageData *image, unsigned int threads = 1);
     protected:
         static DBL normalize(Vector3d& A, const Vector3d& B);
-        void smooth_height_field(int xsize, int zsize);
+        void smooth_height_field(int xsize, int zsize, unsigned int threads);
         bool intersect_pixel(int x, int z, const BasicRay& ray, DBL height1, DBL height2, IStack &HField_Stack, const BasicRay &RRay, DBL mindist, DBL maxdist, TraceThreadData *Thread);
         static int add_single_normal(HF_VAL **data, int xsize, int zsize, int x0, int z0,int x1, int z1,int x2, int z2, Vector3d& N);
         bool dda_traversal(const BasicRay &ray, const Vector3d& Start, const HFBlock *Block, IStack &HField_Stack, const BasicRay &RRay, DBL mindist, DBL maxdist, TraceThreadData *Thread);
         bool block_traversal(const BasicRay &ray, const Vector3d& Start, IStack &HField_Stack, const BasicRay &RRay, DBL mindist, DBL maxdist, TraceThreadData *Thread);
-        void build_hfield_blocks();
+        bool mip_traversal(const BasicRay &ray, int shift, int x, int z, DBL t0, DBL t1, IStack &HField_Stack, const BasicRay &RRay, DBL mindist, DBL maxdist, TraceThreadData *Thread);
+        void build_hfield_blocks(unsigned int threads);
+        void build_hfield_mip(unsigned int threads);
 };
 
 /// @}
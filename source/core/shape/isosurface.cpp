@@ -45,6 +45,12 @@
 
 // C++ standard header files
 #include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
 
 // POV-Ray header files (base module)
 #include "base/messenger.h"
@@ -81,6 +87,7 @@ struct ISO_ThreadData final
 {
     IsosurfaceCache cache;
     GenericScalarFunctionInstance* pFn;
+    IsosurfaceGradients* pGradients;
     DBL Vlength;
     DBL tl;
     int Inv3;
@@ -95,6 +102,7 @@ struct ISO_Max_Gradient final
     DBL max_gradient, gradient;
     DBL eval_max, eval_cnt, eval_gradient_sum, eval_var;
     bool reported;
+    std::mutex mutex; // guards merging of per-thread measurements
 
     ISO_Max_Gradient() :
         max_gradient(0.0),
@@ -118,6 +126,171 @@ private:
 inline void intrusive_ptr_add_ref(ISO_Max_Gradient* f) { ++f->mRefCounter; }
 inline void intrusive_ptr_release(ISO_Max_Gradient* f) { if (!(--f->mRefCounter)) delete f; }
 
+/// Part of a ray passing through consecutive cells that may contain the surface.
+struct ISO_Run final
+{
+    DBL t1, t2;
+};
+
+/// Coarse grid of the cells of the container that may contain the surface or the interior.
+struct IsosurfaceOccupancy final
+{
+    Vector3d lower;                     ///< Lower corner of the grid.
+    Vector3d upper;                     ///< Upper corner of the grid.
+    Vector3d cellSize;                  ///< Size of each cell.
+    int size[3];                        ///< Number of cells along each axis.
+    std::vector<unsigned char> cells;   ///< Non-zero for each cell that may contain the surface or the interior.
+
+    IsosurfaceOccupancy(const Vector3d& lo, const Vector3d& hi, unsigned int resolution);
+
+    inline unsigned char& Cell(int i, int j, int k) { return cells[(size_t(k) * size[Y] + j) * size[X] + i]; }
+    inline bool Occupied(int i, int j, int k) const { return cells[(size_t(k) * size[Y] + j) * size[X] + i] != 0; }
+    inline DBL Boundary(int axis, int i) const { return (i >= size[axis]) ? upper[axis] : lower[axis] + i * cellSize[axis]; }
+
+    bool Occupied(const Vector3d& p) const;
+    void Find_Runs(const Vector3d& P, const Vector3d& D, DBL t1, DBL t2, DBL pad, std::vector<ISO_Run>& runs) const;
+};
+
+IsosurfaceOccupancy::IsosurfaceOccupancy(const Vector3d& lo, const Vector3d& hi, unsigned int resolution) :
+    lower(lo),
+    upper(hi),
+    cellSize((hi - lo) / DBL(resolution)),
+    cells(size_t(resolution) * resolution * resolution, 0)
+{
+    size[X] = size[Y] = size[Z] = int(resolution);
+}
+
+bool IsosurfaceOccupancy::Occupied(const Vector3d& p) const
+{
+    int cell[3];
+
+    for (int a = X; a <= Z; a++)
+    {
+        if ((p[a] < lower[a]) || (p[a] > upper[a]))
+            return false; // the cells outside the grid have all been found empty
+        cell[a] = min(int((p[a] - lower[a]) / cellSize[a]), size[a] - 1);
+    }
+
+    return Occupied(cell[X], cell[Y], cell[Z]);
+}
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Find_Runs
+*
+* INPUT
+*
+*   P, D - ray in object space
+*   t1, t2 - part of the ray to consider
+*   pad - distance by which to extend each run
+*
+* OUTPUT
+*
+*   runs - parts of the ray passing through cells that may contain the surface
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Walk the cells of the grid along the ray, merging consecutive cells that
+*   may contain the surface.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+void IsosurfaceOccupancy::Find_Runs(const Vector3d& P, const Vector3d& D, DBL t1, DBL t2, DBL pad, std::vector<ISO_Run>& runs) const
+{
+    DBL tEnter = t1, tExit = t2;
+    DBL tNext[3], tDelta[3];
+    int cell[3], step[3];
+
+    runs.clear();
+
+    for (int a = X; a <= Z; a++)
+    {
+        if (D[a] == 0.0)
+        {
+            if ((P[a] < lower[a]) || (P[a] > upper[a]))
+                return;
+        }
+        else
+        {
+            DBL ta = (lower[a] - P[a]) / D[a];
+            DBL tb = (upper[a] - P[a]) / D[a];
+            tEnter = max(tEnter, min(ta, tb));
+            tExit  = min(tExit,  max(ta, tb));
+        }
+    }
+
+    if (tEnter > tExit)
+        return;
+
+    for (int a = X; a <= Z; a++)
+    {
+        cell[a] = int(floor((P[a] + tEnter * D[a] - lower[a]) / cellSize[a]));
+        cell[a] = max(0, min(cell[a], size[a] - 1));
+        if (D[a] > 0.0)
+        {
+            step[a]   = 1;
+            tNext[a]  = (Boundary(a, cell[a] + 1) - P[a]) / D[a];
+            tDelta[a] = cellSize[a] / D[a];
+        }
+        else if (D[a] < 0.0)
+        {
+            step[a]   = -1;
+            tNext[a]  = (Boundary(a, cell[a]) - P[a]) / D[a];
+            tDelta[a] = -cellSize[a] / D[a];
+        }
+        else
+        {
+            step[a]   = 0;
+            tNext[a]  = HUGE_VAL;
+            tDelta[a] = HUGE_VAL;
+        }
+    }
+
+    DBL t = tEnter;
+    bool previous = false;
+
+    while (true)
+    {
+        int a = (tNext[X] < tNext[Y]) ? ((tNext[X] < tNext[Z]) ? X : Z) : ((tNext[Y] < tNext[Z]) ? Y : Z);
+        DBL tCellExit = min(tNext[a], tExit);
+
+        bool occupied = Occupied(cell[X], cell[Y], cell[Z]);
+        if (occupied)
+        {
+            if (previous)
+                runs.back().t2 = tCellExit;
+            else
+                runs.push_back(ISO_Run{ t, tCellExit });
+        }
+        previous = occupied;
+
+        if (tNext[a] >= tExit)
+            break;
+
+        t = tNext[a];
+        cell[a] += step[a];
+        if ((cell[a] < 0) || (cell[a] >= size[a]))
+            break;
+        tNext[a] += tDelta[a];
+    }
+
+    for (auto& run : runs)
+    {
+        run.t1 = max(t1, run.t1 - pad);
+        run.t2 = min(t2, run.t2 + pad);
+    }
+}
+
 
 /*****************************************************************************
 *
@@ -153,7 +326,7 @@ bool IsoSurface::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThr
     Vector3d IPoint;
     Vector3d Plocal, Dlocal;
     DBL tmax = 0.0, tmin = 0.0, tmp = 0.0;
-    DBL maxg = max_gradient;
+    DBL maxg;
     int i = 0 ; /* count of intervals in stack - 1      */
     int IFound = false;
     int begin = 0, end = 0;
@@ -161,14 +334,20 @@ bool IsoSurface::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThr
     Vector3d VTmp;
     thread_local ISO_ThreadData isoData;
 
-    Thread->Stats()[Ray_IsoSurface_Bound_Tests]++;
+    Thread->Stats().Shape(Ray_IsoSurface_Bound_Tests)++;
 
     if(container->Intersect(ray, Trans, Depth1, Depth2, Side1, Side2)) /* IsoSurface_Bound_Tests */
     {
-        Thread->Stats()[Ray_IsoSurface_Bound_Tests_Succeeded]++;
+        Thread->Stats().Shape(Ray_IsoSurface_Bound_Tests_Succeeded)++;
 
         GenericScalarFunctionInstance fn(Function, Thread);
 
+        auto gradients = Thread->isosurfaceGradients.find(this);
+        if (gradients == Thread->isosurfaceGradients.end())
+            gradients = Thread->isosurfaceGradients.emplace(this, IsosurfaceGradients(max_gradient)).first;
+        isoData.pGradients = &gradients->second;
+        maxg = isoData.pGradients->maxGradient;
+
         in_shadow_test = ray.IsShadowTestRay();
 
         if(Depth1 < 0.0)
@@ -237,7 +416,7 @@ bool IsoSurface::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThr
                 Depth_Stack->pop(); // we added an intersection already, so we need to undo that
             return (false);
         }
-        Thread->Stats()[Ray_IsoSurface_Tests]++;
+        Thread->Stats().Shape(Ray_IsoSurface_Tests)++;
         if((Depth1 < accuracy) && (isoData.Inv3 == 1))
         {
             /* IPoint is on the isosurface */
@@ -254,35 +433,50 @@ bool IsoSurface::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThr
 
         isoData.pFn = &fn;
 
-        for (; itrace < max_trace; itrace++)
+        // Only search the parts of the ray passing through cells that may contain the surface.
+        thread_local std::vector<ISO_Run> runs;
+        if (occupancy != nullptr)
+            occupancy->Find_Runs(Plocal, Dlocal, tmin, tmax, accuracy, runs);
+        else
+            runs.assign(1, ISO_Run{ tmin, tmax });
+
+        for (size_t run = 0; (run < runs.size()) && (itrace < max_trace); run++)
         {
-            if(Function_Find_Root(isoData, Plocal, Dlocal, &tmin, &tmax, maxg, in_shadow_test, Thread) == false)
-                break;
-            else
+            if (run > 0)
+                isoData.Inv3 = 1; // the cells in between are outside
+            tmin = max(tmin, runs[run].t1);
+            tmax = runs[run].t2;
+            if((tmax - tmin) < accuracy)
+                continue;
+
+            for (; itrace < max_trace; itrace++)
             {
-                IPoint = ray.Evaluate(tmin);
-                if(Clip.empty() || Point_In_Clip(IPoint, Clip, Thread))
+                if(Function_Find_Root(isoData, Plocal, Dlocal, &tmin, &tmax, maxg, in_shadow_test, Thread) == false)
+                    break;
+                else
                 {
-                    Depth_Stack->push(Intersection(tmin, IPoint, this, 0, 0 /*Side1*/));
-                    IFound = true;
+                    IPoint = ray.Evaluate(tmin);
+                    if(Clip.empty() || Point_In_Clip(IPoint, Clip, Thread))
+                    {
+                        Depth_Stack->push(Intersection(tmin, IPoint, this, 0, 0 /*Side1*/));
+                        IFound = true;
+                    }
                 }
+                tmin += accuracy * 5.0;
+                if((tmax - tmin) < accuracy)
+                    break;
+                isoData.Inv3 *= -1;
             }
-            tmin += accuracy * 5.0;
-            if((tmax - tmin) < accuracy)
-                break;
-            isoData.Inv3 *= -1;
         }
 
         if(IFound)
-            Thread->Stats()[Ray_IsoSurface_Tests_Succeeded]++;
+            Thread->Stats().Shape(Ray_IsoSurface_Tests_Succeeded)++;
 
-        isoData.pFn = nullptr;
-    }
+        if(eval == true)
+            isoData.pGradients->maxGradient = max(isoData.pGradients->maxGradient, maxg);
 
-    if(eval == true)
-    {
-        DBL temp_max_gradient = max_gradient; // TODO FIXME - works around nasty gcc (found using 4.0.1) bug failing to honor casting away of volatile on pass by value on template argument lookup [trf]
-        max_gradient = max((DBL)temp_max_gradient, maxg); // TODO FIXME - This is not thread-safe but should be!!! [trf]
+        isoData.pFn = nullptr;
+        isoData.pGradients = nullptr;
     }
 
     return (IFound);
@@ -328,6 +522,9 @@ bool IsoSurface::Inside(const Vector3d& IPoint, TraceThreadData *Thread) const
     if(!container->Inside(New_Point))
         return (Test_Flag(this, INVERTED_FLAG));
 
+    if((occupancy != nullptr) && !occupancy->Occupied(New_Point))
+        return (Test_Flag(this, INVERTED_FLAG));
+
     GenericScalarFunctionInstance fn(Function, Thread);
     if (!IsInside (fn, New_Point))
         return (Test_Flag(this, INVERTED_FLAG));
@@ -385,7 +582,7 @@ double IsoSurface::GetPotential (const Vector3d& globalPoint, bool subtractThres
 
 void IsoSurface::Normal(Vector3d& Result, Intersection *Inter, TraceThreadData *Thread) const
 {
-    Vector3d New_Point, TPoint;
+    Vector3d New_Point;
     DBL funct;
     bool containerHit = Inter->i1;
 
@@ -403,20 +600,18 @@ void IsoSurface::Normal(Vector3d& Result, Intersection *Inter, TraceThreadData *
         else
             New_Point = Inter->IPoint;
 
-        TPoint = New_Point;
-        funct = fn.Evaluate(TPoint);
-
-        TPoint = New_Point;
-        TPoint[X] += accuracy;
-        Result[X] = fn.Evaluate(TPoint) - funct;
-            TPoint = New_Point;
+        // evaluate all four samples in one go
+        Vector3d samples[4] = { New_Point, New_Point, New_Point, New_Point };
+        DBL values[4];
+        samples[1][X] += accuracy;
+        samples[2][Y] += accuracy;
+        samples[3][Z] += accuracy;
+        fn.EvaluateBatch(samples, 4, values);
 
-        TPoint[Y] += accuracy;
-        Result[Y] = fn.Evaluate(TPoint) - funct;
-            TPoint = New_Point;
-
-        TPoint[Z] += accuracy;
-        Result[Z] = fn.Evaluate(TPoint) - funct;
+        funct = values[0];
+        Result[X] = values[1] - funct;
+        Result[Y] = values[2] - funct;
+        Result[Z] = values[3] - funct;
 
         if((Result[X] == 0) && (Result[Y] == 0) && (Result[Z] == 0))
             Result[X] = 1.0;
@@ -602,7 +797,8 @@ void IsoSurface::Transform(const TRANSFORM* tr)
 
 IsoSurface::IsoSurface() :
     ObjectBase(ISOSURFACE_OBJECT),
-    positivePolarity(false)
+    positivePolarity(false),
+    intervalBounds(false)
 {
     container = std::shared_ptr<ContainedByShape>(new ContainedByBox());
 
@@ -621,7 +817,6 @@ IsoSurface::IsoSurface() :
     closed = true;
 
     max_gradient = 1.1;
-    gradient = 0.0;
     threshold = 0.0;
 
     mginfo = boost::intrusive_ptr<ISO_Max_Gradient>(new ISO_Max_Gradient());
@@ -726,7 +921,8 @@ IsoSurface::~IsoSurface()
 * DESCRIPTION
 *
 *   If any max_gradient messages need to be sent to the user, they are dispatched
-*   via the supplied CoreMessenger.
+*   via the supplied CoreMessenger. Otherwise, the maximum gradient found is
+*   reported for reference.
 *
 * CHANGES
 *
@@ -734,12 +930,8 @@ IsoSurface::~IsoSurface()
 
 void IsoSurface::DispatchShutdownMessages(GenericMessenger& messenger)
 {
-    // TODO FIXME - works around nasty gcc (found using 4.0.1) bug failing to honor casting
-    // away of volatile on pass by value on template argument lookup [trf]
-    DBL temp_max_gradient = max_gradient;
-
-    mginfo->gradient = max(gradient, mginfo->gradient);
-    mginfo->max_gradient = max((DBL)temp_max_gradient, mginfo->max_gradient);
+    // the measurements themselves have already been merged at the end of each tile
+    mginfo->max_gradient = max(max_gradient, mginfo->max_gradient);
 
     if (mginfo->IsShared())
     {
@@ -752,6 +944,8 @@ void IsoSurface::DispatchShutdownMessages(GenericMessenger& messenger)
 
     if (fnInfo != nullptr)
     {
+        bool reported = false;
+
         if (eval == false)
         {
             // Only show the warning if necessary!
@@ -769,6 +963,7 @@ void IsoSurface::DispatchShutdownMessages(GenericMessenger& messenger)
                                         "Adjust max_gradient to get a proper rendering of the isosurface.",
                                         (float)(mginfo->gradient),
                                         (float)(mginfo->max_gradient));
+                    reported = true;
                 }
                 else if ((diff >= 10.0) || ((prop >= 1.1) && (diff >= 0.5)))
                 {
@@ -778,6 +973,7 @@ void IsoSurface::DispatchShutdownMessages(GenericMessenger& messenger)
                                         "get a faster rendering of the isosurface.",
                                         (float)(mginfo->gradient),
                                         (float)(mginfo->max_gradient));
+                    reported = true;
                 }
             }
         }
@@ -795,11 +991,265 @@ void IsoSurface::DispatchShutdownMessages(GenericMessenger& messenger)
                                     (float)(mginfo->eval_max),
                                     (float)(mginfo->eval_gradient_sum / mginfo->eval_cnt),
                                     (float)(mginfo->eval_var));
+                reported = true;
             }
         }
+
+        if (!reported && (mginfo->gradient > EPSILON))
+            messenger.InfoAt(*fnInfo, "The maximum gradient found was %0.3f.", (float)(mginfo->gradient));
     }
 }
 
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   MergeGradients
+*
+* INPUT
+*
+*   data - gradient measurements of a render thread
+*
+* OUTPUT
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Merge the measurements into the statistics shared by all copies of the
+*   isosurface.
+*
+* CHANGES
+*
+******************************************************************************/
+
+void IsoSurface::MergeGradients(const IsosurfaceGradients& data) const
+{
+    if (!mginfo)
+        return; // already reported
+
+    std::lock_guard<std::mutex> lock(mginfo->mutex);
+
+    mginfo->gradient = max(data.gradient, mginfo->gradient);
+    mginfo->eval_max = max(data.evalMax, mginfo->eval_max);
+    mginfo->eval_var = max(data.evalVariation, mginfo->eval_var);
+    mginfo->eval_cnt += data.evalCount;
+    mginfo->eval_gradient_sum += data.evalGradientSum;
+}
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Compute_Occupancy
+*
+* INPUT
+*
+*   resolution - number of cells along each axis
+*   threads - thread data of the threads to use, the calling thread first
+*
+* OUTPUT
+*
+*   lower, upper - bounds of the cells that may contain the surface
+*
+* RETURNS
+*
+*   bool - false if no cell may contain the surface
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Classify the cells of a grid spanning the container, then classify the
+*   cells of a second grid spanning only those cells found to possibly contain
+*   the surface (or the interior), and use that to skip empty cells. A box
+*   container is tightened to the second grid; as the function is known to be
+*   outside on the faces that have moved, no caps are lost.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+bool IsoSurface::Compute_Occupancy(unsigned int resolution, const std::vector<TraceThreadData*>& threads, Vector3d& lower, Vector3d& upper)
+{
+    POV_ASSERT(!threads.empty());
+    POV_ASSERT(resolution > 0);
+
+    ContainedByBox* box = dynamic_cast<ContainedByBox*>(container.get());
+    if (box != nullptr)
+    {
+        lower = box->corner1;
+        upper = box->corner2;
+    }
+    else
+    {
+        const ContainedBySphere* sphere = dynamic_cast<const ContainedBySphere*>(container.get());
+        POV_ASSERT(sphere != nullptr);
+        lower = sphere->center - Vector3d(sphere->radius);
+        upper = sphere->center + Vector3d(sphere->radius);
+    }
+
+    for (int a = X; a <= Z; a++)
+        if (!(upper[a] > lower[a]))
+            return true; // degenerate container; nothing to be gained
+
+    std::shared_ptr<IsosurfaceOccupancy> grid(new IsosurfaceOccupancy(lower, upper, resolution));
+    Classify_Cells(*grid, threads);
+
+    int first[3] = { grid->size[X], grid->size[Y], grid->size[Z] };
+    int last[3]  = { -1, -1, -1 };
+    for (int k = 0; k < grid->size[Z]; k++)
+        for (int j = 0; j < grid->size[Y]; j++)
+            for (int i = 0; i < grid->size[X]; i++)
+            {
+                if (!grid->Occupied(i, j, k))
+                    continue;
+                const int cell[3] = { i, j, k };
+                for (int a = X; a <= Z; a++)
+                {
+                    first[a] = min(first[a], cell[a]);
+                    last[a]  = max(last[a],  cell[a]);
+                }
+            }
+
+    if (last[X] < 0)
+    {
+        // Rays will skip the entire container.
+        occupancy = grid;
+        return false;
+    }
+
+    bool shrunk = false;
+    for (int a = X; a <= Z; a++)
+    {
+        lower[a] = grid->Boundary(a, first[a]);
+        upper[a] = grid->Boundary(a, last[a] + 1);
+        shrunk = shrunk || (first[a] > 0) || (last[a] < grid->size[a] - 1);
+    }
+
+    if (shrunk)
+    {
+        grid.reset(new IsosurfaceOccupancy(lower, upper, resolution));
+        Classify_Cells(*grid, threads);
+
+        if (box != nullptr)
+        {
+            box->corner1 = lower;
+            box->corner2 = upper;
+            Compute_BBox();
+        }
+    }
+
+    occupancy = grid;
+    return true;
+}
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Classify_Cells
+*
+* INPUT
+*
+*   grid - grid to classify
+*   threads - thread data of the threads to use, the calling thread first
+*
+* OUTPUT
+*
+*   grid - cells marked if they may contain the surface or the interior
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   A cell is known to be outside if interval evaluation of the function
+*   over the cell shows it to stay on the outside of the threshold, or, if
+*   the function does not support that, if the value at the centre of the
+*   cell is farther from the threshold than `max_gradient` allows the
+*   function to change within the cell. The latter test is not used with
+*   `evaluate`, as `max_gradient` is just an estimate then.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+void IsoSurface::Classify_Cells(IsosurfaceOccupancy& grid, const std::vector<TraceThreadData*>& threads) const
+{
+    int rows = grid.size[Y] * grid.size[Z];
+    std::atomic<int> next(0);
+    std::vector<std::exception_ptr> errors(threads.size());
+
+    auto work = [&](size_t t)
+    {
+        try
+        {
+            GenericScalarFunctionInstance fn(Function, threads[t]);
+            FunctionInterval bounds;
+            Vector3d lo, hi, centre;
+            DBL lowest;
+
+            for (int row = next++; row < rows; row = next++)
+            {
+                int j = row % grid.size[Y];
+                int k = row / grid.size[Y];
+                for (int i = 0; i < grid.size[X]; i++)
+                {
+                    lo = Vector3d(grid.Boundary(X, i),     grid.Boundary(Y, j),     grid.Boundary(Z, k));
+                    hi = Vector3d(grid.Boundary(X, i + 1), grid.Boundary(Y, j + 1), grid.Boundary(Z, k + 1));
+
+                    // lowest possible value of the polarized function within the cell
+                    if (fn.EvaluateBounds(lo, hi, bounds))
+                        lowest = (positivePolarity ? threshold - bounds.upper : bounds.lower - threshold);
+                    else if (!eval)
+                    {
+                        centre = (lo + hi) * 0.5;
+                        lowest = EvaluatePolarized(fn, centre) - max_gradient * (hi - lo).length() * 0.5;
+                    }
+                    else
+                        lowest = -1.0;
+
+                    // NB: This also keeps cells where the bounds are NaN.
+                    grid.Cell(i, j, k) = !(lowest > 0.0);
+                }
+            }
+        }
+        catch (...)
+        {
+            errors[t] = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> helpers;
+    for (size_t t = 1; t < std::min<size_t>(threads.size(), rows); t++)
+    {
+        try
+        {
+            helpers.emplace_back(work, t);
+        }
+        catch (std::system_error&)
+        {
+            break; // no more threads available; the others will pick up the work
+        }
+    }
+    work(0);
+
+    for (auto& helper : helpers)
+        helper.join();
+
+    for (auto& error : errors)
+        if (error)
+            std::rethrow_exception(error);
+}
+
 /*****************************************************************************
 *
 * FUNCTION
@@ -868,13 +1318,14 @@ bool IsoSurface::Function_Find_Root(ISO_ThreadData& itd, const Vector3d& PP, con
     ISO_Pair EP1, EP2;
     Vector3d VTmp;
 
-    pThreadData->Stats()[Ray_IsoSurface_Find_Root]++;
+    pThreadData->Stats().Shape(Ray_IsoSurface_Find_Root)++;
 
     itd.Vlength = DD.length();
 
-    if(itd.cache.current == this)
+    // The cache relies on `max_gradient`, which need not be accurate when using interval bounds.
+    if((itd.cache.current == this) && !intervalBounds)
     {
-        pThreadData->Stats()[Ray_IsoSurface_Cache]++;
+        pThreadData->Stats().Shape(Ray_IsoSurface_Cache)++;
         VTmp = PP + *Depth1 * DD;
         VTmp -= itd.cache.Pglobal;
         l_b = VTmp.length();
@@ -883,7 +1334,7 @@ bool IsoSurface::Function_Find_Root(ISO_ThreadData& itd, const Vector3d& PP, con
         l_e = VTmp.length();
         if((itd.cache.fmax - maxg * max(l_b, l_e)) > 0.0)
         {
-            pThreadData->Stats()[Ray_IsoSurface_Cache_Succeeded]++;
+            pThreadData->Stats().Shape(Ray_IsoSurface_Cache_Succeeded)++;
             return false;
         }
     }
@@ -892,8 +1343,14 @@ bool IsoSurface::Function_Find_Root(ISO_ThreadData& itd, const Vector3d& PP, con
     itd.cache.Dglobal = DD;
 
     itd.cache.current = nullptr;
+
+    // evaluate both end points in one go
+    Vector3d ends[2] = { PP + *Depth1 * DD, PP + *Depth2 * DD };
+    DBL values[2];
+    itd.pFn->EvaluateBatch(ends, 2, values);
+
     EP1.t = *Depth1;
-    EP1.f = Float_Function(itd, *Depth1);
+    EP1.f = (DBL)itd.Inv3 * Polarize(values[0]);
     itd.cache.fmax = EP1.f;
     if((closed == false) && (EP1.f < 0.0))
     {
@@ -902,7 +1359,7 @@ bool IsoSurface::Function_Find_Root(ISO_ThreadData& itd, const Vector3d& PP, con
     }
 
     EP2.t = *Depth2;
-    EP2.f = Float_Function(itd, *Depth2);
+    EP2.f = (DBL)itd.Inv3 * Polarize(values[1]);
     itd.cache.fmax = min(EP2.f, itd.cache.fmax);
 
     oldmg = maxg;
@@ -914,16 +1371,17 @@ bool IsoSurface::Function_Find_Root(ISO_ThreadData& itd, const Vector3d& PP, con
     {
         if(eval == true)
         {
+            IsosurfaceGradients& gradients = *itd.pGradients;
             DBL curvar = fabs(maxg - oldmg);
 
-            if(curvar > mginfo->eval_var)
-                mginfo->eval_var = curvar;
+            if(curvar > gradients.evalVariation)
+                gradients.evalVariation = curvar;
 
-            mginfo->eval_cnt++;
-            mginfo->eval_gradient_sum += maxg;
+            gradients.evalCount++;
+            gradients.evalGradientSum += maxg;
 
-            if(maxg > mginfo->eval_max)
-                mginfo->eval_max = maxg;
+            if(maxg > gradients.evalMax)
+                gradients.evalMax = maxg;
         }
 
         *Depth1 = itd.tl;
@@ -972,10 +1430,39 @@ bool IsoSurface::Function_Find_Root_R(ISO_ThreadData& itd, const ISO_Pair* EP1,
 {
     ISO_Pair EPa;
     DBL temp;
+    FunctionInterval bounds;
+
+    if(intervalBounds && Float_Function_Bounds(itd, EP1->t, EP2->t, bounds))
+    {
+        // The function is guaranteed to stay positive, so there is no root in this interval.
+        if(bounds.lower > 0.0)
+            return false;
+
+        if(t21 < accuracy)
+        {
+            if(EP2->f < 0)
+            {
+                itd.tl = EP2->t;
+                return true;
+            }
+            else
+                return false;
+        }
+
+        t21 *= 0.5;
+        dt *= 0.5;
+        EPa.t = EP1->t + t21;
+        EPa.f = Float_Function(itd, EPa.t);
+
+        if(!Function_Find_Root_R(itd, EP1, &EPa, dt, t21, len * 2.0, maxg, pThreadData))
+            return (Function_Find_Root_R(itd, &EPa, EP2, dt, t21, len * 2.0, maxg, pThreadData));
+        else
+            return true;
+    }
 
     temp = fabs((EP2->f - EP1->f) * len);
-    if(gradient < temp)
-        gradient = temp;
+    if(itd.pGradients->gradient < temp)
+        itd.pGradients->gradient = temp;
 
     if((eval == true) && (maxg < temp * eval_param[1]))
     {
@@ -1048,6 +1535,58 @@ DBL IsoSurface::Float_Function(ISO_ThreadData& itd, DBL t) const
 }
 
 
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Float_Function_Bounds
+*
+* INPUT
+*
+*   t1, t2 - ends of the ray segment
+*
+* OUTPUT
+*
+*   bounds - bounds of the values of Float_Function() within the segment
+*
+* RETURNS
+*
+*   bool - true if the function supports interval evaluation
+*
+* DESCRIPTION
+*
+*   The function is evaluated over the bounding box of the segment, so the
+*   bounds may be wider than necessary but never too narrow.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+bool IsoSurface::Float_Function_Bounds(ISO_ThreadData& itd, DBL t1, DBL t2, FunctionInterval& bounds) const
+{
+    Vector3d P1, P2;
+    FunctionInterval fnBounds;
+
+    P1 = itd.cache.Pglobal + t1 * itd.cache.Dglobal;
+    P2 = itd.cache.Pglobal + t2 * itd.cache.Dglobal;
+
+    if (!itd.pFn->EvaluateBounds(min(P1, P2), max(P1, P2), fnBounds))
+        return false;
+
+    if (positivePolarity)
+        bounds = FunctionInterval(threshold - fnBounds.upper, threshold - fnBounds.lower);
+    else
+        bounds = FunctionInterval(fnBounds.lower - threshold, fnBounds.upper - threshold);
+
+    if (itd.Inv3 < 0)
+        bounds = FunctionInterval(-bounds.upper, -bounds.lower);
+
+    return true;
+}
+
+
 /*****************************************************************************/
 
 DBL IsoSurface::EvaluateAbs (GenericScalarFunctionInstance& fn, Vector3d& p) const
@@ -1056,11 +1595,16 @@ DBL IsoSurface::EvaluateAbs (GenericScalarFunctionInstance& fn, Vector3d& p) con
 }
 
 DBL IsoSurface::EvaluatePolarized (GenericScalarFunctionInstance& fn, Vector3d& p) const
+{
+    return Polarize (fn.Evaluate (p));
+}
+
+DBL IsoSurface::Polarize (DBL value) const
 {
     if (positivePolarity)
-        return threshold - fn.Evaluate (p);
+        return threshold - value;
     else
-        return fn.Evaluate (p) - threshold;
+        return value - threshold;
 }
 
 bool IsoSurface::IsInside (GenericScalarFunctionInstance& fn, Vector3d& p) const
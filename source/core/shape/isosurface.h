@@ -48,6 +48,7 @@
 
 // C++ standard header files
 #include <memory>
+#include <vector>
 
 // Boost header files
 #include <boost/intrusive_ptr.hpp>
@@ -81,6 +82,7 @@ namespace pov
 //******************************************************************************
 
 #define ISOSURFACE_MAXTRACE    10
+#define ISOSURFACE_MAX_OCCUPANCY_GRID 256
 
 
 /*****************************************************************************
@@ -98,14 +100,15 @@ struct ISO_Pair final
 
 struct ISO_Max_Gradient;
 struct ISO_ThreadData;
+struct IsosurfaceGradients;
+struct IsosurfaceOccupancy;
 
 class IsoSurface final : public ObjectBase
 {
     public:
 
         GenericScalarFunctionPtr Function;
-        volatile DBL max_gradient; // modified during render if `eval` is set
-        DBL gradient;
+        DBL max_gradient; // initial estimate if `eval` is set; the estimates refined during render are kept per thread
         DBL threshold;
         DBL accuracy;
         DBL eval_param[3];
@@ -113,8 +116,10 @@ class IsoSurface final : public ObjectBase
         bool closed             : 1;
         bool eval               : 1;
         bool positivePolarity   : 1; ///< `true` if values above threshold are considered inside, `false` if considered outside.
+        bool intervalBounds     : 1; ///< `true` if interval arithmetic is used to bracket roots, with `max_gradient` as fallback.
 
         std::shared_ptr<ContainedByShape> container;
+        std::shared_ptr<const IsosurfaceOccupancy> occupancy; ///< Cells of the container that may contain the surface, or `nullptr`.
 
         IsoSurface();
         virtual ~IsoSurface() override;
@@ -133,15 +138,38 @@ class IsoSurface final : public ObjectBase
 
         virtual void DispatchShutdownMessages(GenericMessenger& messenger) override;
 
+        /// Merge gradient measurements collected by a render thread into the statistics.
+        /// @note   This method is thread-safe.
+        void MergeGradients(const IsosurfaceGradients& data) const;
+
+        /// Find the cells of the container that may contain the surface or the interior.
+        ///
+        /// The bounding box of the container is divided into a grid of cells, and each cell is
+        /// tested using interval evaluation of the function or, where that is not supported, a
+        /// single sample and `max_gradient`. Rays skip the cells that are found to be outside. A
+        /// box container is also tightened to the cells that remain.
+        ///
+        /// @param[in]  resolution  Number of cells along each axis.
+        /// @param[in]  threads     Thread data of the threads to use, the calling thread first.
+        /// @param[out] lower       Lower corner of the cells that may contain the surface.
+        /// @param[out] upper       Upper corner of the cells that may contain the surface.
+        /// @return                 `false` if no cell may contain the surface.
+        ///
+        bool Compute_Occupancy(unsigned int resolution, const std::vector<TraceThreadData*>& threads, Vector3d& lower, Vector3d& upper);
+
     protected:
         bool Function_Find_Root(ISO_ThreadData& itd, const Vector3d&, const Vector3d&, DBL*, DBL*, DBL& max_gradient, bool in_shadow_test, TraceThreadData* pThreadData);
         bool Function_Find_Root_R(ISO_ThreadData& itd, const ISO_Pair*, const ISO_Pair*, DBL, DBL, DBL, DBL& max_gradient, TraceThreadData* pThreadData);
 
         inline DBL Float_Function(ISO_ThreadData& itd, DBL t) const;
+        inline bool Float_Function_Bounds(ISO_ThreadData& itd, DBL t1, DBL t2, FunctionInterval& bounds) const;
         inline DBL EvaluateAbs (GenericScalarFunctionInstance& fn, Vector3d& p) const;
         inline DBL EvaluatePolarized (GenericScalarFunctionInstance& fn, Vector3d& p) const;
+        inline DBL Polarize (DBL value) const;
         inline bool IsInside (GenericScalarFunctionInstance& fn, Vector3d& p) const;
 
+        void Classify_Cells(IsosurfaceOccupancy& grid, const std::vector<TraceThreadData*>& threads) const;
+
     private:
 
         boost::intrusive_ptr<ISO_Max_Gradient> mginfo; // global, but just a statistic (read: not thread safe but we don't care) [trf]
@@ -195,11 +195,11 @@ const DBL DEPTH_TOLERANCE = 1.0e-4;
 
 bool Lathe::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThreadData *Thread)
 {
-    Thread->Stats()[Ray_Lathe_Tests]++;
+    Thread->Stats().Shape(Ray_Lathe_Tests)++;
 
     if(Intersect(ray, Depth_Stack, Thread))
     {
-        Thread->Stats()[Ray_Lathe_Tests_Succeeded]++;
+        Thread->Stats().Shape(Ray_Lathe_Tests_Succeeded)++;
         return(true);
     }
 
@@ -270,7 +270,7 @@ bool Lathe::Intersect(const BasicRay& ray, IStack& Depth_Stack, TraceThreadData
     Dylen = D[Y] * len; // TODO FIXME - why don't we do this *before* normalizing, saving us the multiplication by len?
 
     #ifdef LATHE_EXTRA_STATS
-        Thread->Stats()[Lathe_Bound_Tests]++;
+        Thread->Stats().Shape(Lathe_Bound_Tests)++;
     #endif
 
     // Test if ray misses lathe's cylindrical bound.
@@ -299,7 +299,7 @@ bool Lathe::Intersect(const BasicRay& ray, IStack& Depth_Stack, TraceThreadData
         return false;
 
     #ifdef LATHE_EXTRA_STATS
-        Thread->Stats()[Lathe_Bound_Tests_Succeeded]++;
+        Thread->Stats().Shape(Lathe_Bound_Tests_Succeeded)++;
     #endif
 
     // Precalculate some constants that are ray-dependant only.
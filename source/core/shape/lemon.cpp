@@ -106,7 +106,7 @@ bool Lemon::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThreadDa
     Vector3d P,D;
     DBL len;
 
-    Thread->Stats()[Ray_Lemon_Tests]++;
+    Thread->Stats().Shape(Ray_Lemon_Tests)++;
     MInvTransPoint(P, ray.Origin, Trans);
     MInvTransDirection(D, ray.Direction, Trans);
     len = D.length();
@@ -133,7 +133,7 @@ bool Lemon::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThreadDa
     }
     if(Intersection_Found)
     {
-        Thread->Stats()[Ray_Lemon_Tests_Succeeded]++;
+        Thread->Stats().Shape(Ray_Lemon_Tests_Succeeded)++;
     }
     return (Intersection_Found);
 }
@@ -61,22 +61,29 @@
 #include "core/shape/mesh.h"
 
 // C++ variants of C standard header files
-//  (none at the moment)
+#include <cstring>
 
 // C++ standard header files
 #include <algorithm>
 #include <limits>
+#include <vector>
 
 // POV-Ray header files (base module)
+#include "base/fileinputoutput.h"
+#include "base/filesystem.h"
 #include "base/pov_err.h"
+#include "base/pov_mem.h"
 
 // POV-Ray header files (core module)
 #include "core/bounding/boundingbox.h"
+#include "core/bounding/bvhtree.h"
 #include "core/material/texture.h"
 #include "core/math/matrix.h"
 #include "core/render/ray.h"
 #include "core/scene/tracethreaddata.h"
+#include "core/shape/meshpager.h"
 #include "core/shape/triangle.h"
+#include "core/shape/uvmeshable.h"
 #include "core/support/statistics.h"
 
 // this must be the last file included
@@ -93,21 +100,330 @@ const DBL DEPTH_TOLERANCE = 1e-6;
 
 #define max3_coordinate(x,y,z) ((x > y) ? ((x > z) ? X : Z) : ((y > z) ? Y : Z))
 
-const int HASH_SIZE = 1000;
+/// Initial number of slots of the tables used to find duplicate vertices, normals and UV coordinates.
+const size_t INITIAL_HASH_SIZE = 1024;
 
 const int INITIAL_NUMBER_OF_ENTRIES = 256;
 
+/// Number of children per node of a mesh's bounding volume hierarchy.
+const unsigned int MESH_BVH_WIDTH = 4;
+
+/// Desired number of triangles per leaf of a mesh's bounding volume hierarchy.
+const unsigned int MESH_BVH_LEAF_TRIANGLES = 4;
+
+/// Number of triangles tested against a ray at once.
+const unsigned int MESH_BVH_BATCH = 4;
+
+/// Tolerance of the batched ray/triangle test, relative to the size of the triangle.
+const DBL MESH_BVH_TOLERANCE = 1e-6;
+
+/// Cosine of the angle between ray and triangle below which the batched ray/triangle test is considered unreliable.
+const DBL MESH_BVH_GRAZING = 1e-3;
+
+/// Identification of binary mesh files.
+const char MESH_FILE_MAGIC[8] = { 'P', 'O', 'V', 'M', 'E', 'S', 'H', 0x1A };
+
+/// Version of the binary mesh file format.
+const POV_UINT32 MESH_FILE_VERSION = 1;
+
+/// Value identifying the byte order of binary mesh files.
+const POV_UINT32 MESH_FILE_BYTE_ORDER = 0x01020304;
+
+/// Alignment of the arrays in binary mesh files.
+const POV_UINT64 MESH_FILE_ALIGNMENT = 16;
+
+/// Number of steps per parameter direction a surface tessellation starts out with.
+const size_t MESH_TESSELLATION_START_STEPS = 4;
+
+/// Maximum number of steps per parameter direction of a surface tessellation.
+const size_t MESH_TESSELLATION_MAX_STEPS = 1024;
+
+
+
+/*****************************************************************************
+* Local typedefs
+******************************************************************************/
+
+/// Bounding volume hierarchy of a mesh.
+///
+/// In addition to the tree itself, which references the triangles by index, the vertices of
+/// all triangles are stored once more in structure-of-arrays layout, in the order they are
+/// referenced by the leaves. This allows for testing a ray against all triangles of a leaf in
+/// a single tight loop the compiler is able to vectorize (see @ref Filter_Mesh_Triangles()).
+///
+class MeshBVH final
+{
+    public:
+
+        /// Tree referencing the triangles.
+        std::unique_ptr<BVHTree> tree;
+        /// Vertex coordinates by vertex, axis and position in the tree's object list.
+        std::vector<float> vertex[3][3];
+        /// Length of the (non-normalized) triangle normal by position in the tree's object list.
+        std::vector<float> area;
+};
+
+/// Open-addressing hash table to find duplicate vertices, normals or UV coordinates.
+///
+/// The table only holds indices into the element array being built, so it needs to be passed
+/// that array on each call. Elements are considered equal if they are identical in the
+/// precision they are stored in.
+///
+/// @tparam VECTOR  Data type of the elements, either @ref MeshVector or @ref MeshUVVector.
+///
+template<typename VECTOR>
+class MeshHashTable final
+{
+    public:
+
+        MeshHashTable() : slots(INITIAL_HASH_SIZE, -1), count(0) {}
+
+        /// Find an element, or enter a new index for it if not found.
+        ///
+        /// @param[in]  elements    Element array; all indices entered so far must be valid.
+        /// @param[in]  element     Element to find.
+        /// @param[in]  newIndex    Index to enter if the element is not found.
+        /// @return                 Index of the element found, or `newIndex`.
+        ///
+        MeshIndex Find(const VECTOR *elements, const VECTOR& element, MeshIndex newIndex)
+        {
+            if (2 * (count + 1) > slots.size())
+                Grow(elements);
+
+            const size_t mask = slots.size() - 1;
+            for (size_t slot = Hash(element) & mask; ; slot = (slot + 1) & mask)
+            {
+                if (slots[slot] < 0)
+                {
+                    slots[slot] = newIndex;
+                    count++;
+                    return newIndex;
+                }
+                if (Equal(elements[slots[slot]], element))
+                    return slots[slot];
+            }
+        }
+
+    private:
+
+        std::vector<MeshIndex> slots;
+        size_t count;
+
+        void Grow(const VECTOR *elements)
+        {
+            std::vector<MeshIndex> old(slots.size() * 2, -1);
+            old.swap(slots);
+
+            const size_t mask = slots.size() - 1;
+            for (MeshIndex index : old)
+            {
+                if (index < 0)
+                    continue;
+                size_t slot = Hash(elements[index]) & mask;
+                while (slots[slot] >= 0)
+                    slot = (slot + 1) & mask;
+                slots[slot] = index;
+            }
+        }
+
+        static const unsigned int kDimensions = sizeof(VECTOR) / sizeof(float);
+
+        static bool Equal(const VECTOR& a, const VECTOR& b)
+        {
+            for (unsigned int axis = 0; axis < kDimensions; axis++)
+                if (a[axis] != b[axis])
+                    return false;
+            return true;
+        }
+
+        static size_t Hash(const VECTOR& element)
+        {
+            POV_UINT64 hash = 0;
+            for (unsigned int axis = 0; axis < kDimensions; axis++)
+            {
+                // Adding zero maps -0.0 to +0.0, which compare equal.
+                const float value = element[axis] + 0.0f;
+                POV_UINT32 bits;
+                std::memcpy(&bits, &value, sizeof(bits));
+                hash = (hash ^ bits) * 0x9E3779B97F4A7C15ull;
+            }
+            return size_t(hash ^ (hash >> 32));
+        }
+};
+
+/// Tables used to find duplicates while a mesh is being built.
+class MeshHashTables final
+{
+    public:
+
+        MeshHashTable<MeshVector> vertices;
+        MeshHashTable<MeshVector> normals;
+        MeshHashTable<MeshUVVector> uvCoords;
+};
+
+/// Triangle bounds as seen by the tree building code.
+class MeshBVHObjects final : public BSPTree::Objects
+{
+    public:
+
+        MeshBVHObjects(const MESH_DATA *d) : data(d) { }
+        virtual ~MeshBVHObjects() override { }
+
+        virtual unsigned int size() const override
+        {
+            return (unsigned int)data->Number_Of_Triangles;
+        }
+
+        virtual float GetMin(unsigned int axis, unsigned int i) const override
+        {
+            const MESH_TRIANGLE triangle = data->Get_Triangle(i);
+            return std::min(std::min(data->Vertices[triangle.P1][axis], data->Vertices[triangle.P2][axis]), data->Vertices[triangle.P3][axis]);
+        }
+
+        virtual float GetMax(unsigned int axis, unsigned int i) const override
+        {
+            const MESH_TRIANGLE triangle = data->Get_Triangle(i);
+            return std::max(std::max(data->Vertices[triangle.P1][axis], data->Vertices[triangle.P2][axis]), data->Vertices[triangle.P3][axis]);
+        }
+
+    private:
+
+        const MESH_DATA *data;
+};
+
+/// Header of binary mesh files.
+///
+/// The header is followed by the vertex, normal, UV coordinate and triangle arrays, in this
+/// order, each aligned to @ref MESH_FILE_ALIGNMENT bytes, and finally by the serialized
+/// bounding volume hierarchy, if any. All data is stored in native layout and byte order; the
+/// element sizes serve to reject files written by an incompatible build.
+///
+struct MeshFileHeader final
+{
+    char magic[8];
+    POV_UINT32 version;
+    POV_UINT32 byteOrder;
+    POV_UINT32 vectorSize;
+    POV_UINT32 uvVectorSize;
+    POV_UINT32 triangleSize;
+    POV_UINT32 hasInsideVector;
+    POV_UINT32 hasHierarchy;
+    POV_INT32 numberOfVertices;
+    POV_INT32 numberOfNormals;
+    POV_INT32 numberOfUVCoords;
+    POV_INT32 numberOfTriangles;
+    POV_INT32 numberOfTextures;
+    double insideVector[3];
+    POV_UINT64 vertexOffset;
+    POV_UINT64 normalOffset;
+    POV_UINT64 uvOffset;
+    POV_UINT64 triangleOffset;
+    POV_UINT64 hierarchyOffset;
+};
+
+/// Progress callback for building a mesh's bounding volume hierarchy.
+class MeshBVHNoProgress final : public BSPTree::Progress
+{
+    public:
+
+        virtual void operator()(unsigned int) const override { }
+};
+
 
 
 /*****************************************************************************
-* Local variables
+*
+* FUNCTION
+*
+*   Filter_Mesh_Triangles
+*
+* INPUT
+*
+*   BVH   - Mesh bounding volume hierarchy
+*   first - Position of first triangle in the hierarchy's object list
+*   count - Number of triangles to test (at most MESH_BVH_BATCH)
+*   ray   - Ray in mesh space
+*
+* OUTPUT
+*
+* RETURNS
+*
+*   unsigned int - Bit mask of the triangles that may be hit
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Rule out triangles that are clearly missed by a ray.
+*
+*   The test follows Moeller and Trumbore, but errs on the side of caution:
+*   Triangles hit (or nearly hit) at a grazing angle are never ruled out,
+*   and neither are triangles hit within a small tolerance of their edges,
+*   so the results do not change when the remaining triangles are subjected
+*   to the regular intersection test.
+*
+* CHANGES
+*
+*   -
+*
 ******************************************************************************/
 
-HASH_TABLE **Mesh::Vertex_Hash_Table;
-HASH_TABLE **Mesh::Normal_Hash_Table;
-UV_HASH_TABLE **Mesh::UV_Hash_Table;
+static unsigned int Filter_Mesh_Triangles(const MeshBVH& BVH, unsigned int first, unsigned int count, const BasicRay& ray)
+{
+    const float *P[3][3];
+    bool candidate[MESH_BVH_BATCH];
+    unsigned int mask = 0;
+
+    for (unsigned int v = 0; v < 3; v++)
+        for (unsigned int axis = 0; axis < 3; axis++)
+            P[v][axis] = BVH.vertex[v][axis].data() + first;
+    const float *area = BVH.area.data() + first;
+
+    const DBL ox = ray.Origin[X], oy = ray.Origin[Y], oz = ray.Origin[Z];
+    const DBL dx = ray.Direction[X], dy = ray.Direction[Y], dz = ray.Direction[Z];
+    const DBL grazing = MESH_BVH_GRAZING * ray.Direction.length();
+
+    // written as a plain loop over the structure-of-arrays data so that it can be vectorized;
+    // the vertex data is padded so that reading past the last triangle is safe
+    for (unsigned int i = 0; i < MESH_BVH_BATCH; i++)
+    {
+        DBL e1x = DBL(P[1][X][i]) - DBL(P[0][X][i]);
+        DBL e1y = DBL(P[1][Y][i]) - DBL(P[0][Y][i]);
+        DBL e1z = DBL(P[1][Z][i]) - DBL(P[0][Z][i]);
+        DBL e2x = DBL(P[2][X][i]) - DBL(P[0][X][i]);
+        DBL e2y = DBL(P[2][Y][i]) - DBL(P[0][Y][i]);
+        DBL e2z = DBL(P[2][Z][i]) - DBL(P[0][Z][i]);
+
+        DBL px = dy * e2z - dz * e2y;
+        DBL py = dz * e2x - dx * e2z;
+        DBL pz = dx * e2y - dy * e2x;
+        DBL det = e1x * px + e1y * py + e1z * pz;
+
+        DBL sx = ox - DBL(P[0][X][i]);
+        DBL sy = oy - DBL(P[0][Y][i]);
+        DBL sz = oz - DBL(P[0][Z][i]);
+        DBL qx = sy * e1z - sz * e1y;
+        DBL qy = sz * e1x - sx * e1z;
+        DBL qz = sx * e1y - sy * e1x;
+
+        // barycentric coordinates and depth, all scaled by the determinant
+        DBL sign = (det < 0.0) ? -1.0 : 1.0;
+        DBL u = sign * (sx * px + sy * py + sz * pz);
+        DBL v = sign * (dx * qx + dy * qy + dz * qz);
+        DBL t = sign * (e2x * qx + e2y * qy + e2z * qz);
+        DBL adet = sign * det;
+        DBL tolerance = MESH_BVH_TOLERANCE * adet;
+
+        candidate[i] = (adet <= grazing * DBL(area[i])) ||
+                       ((u >= -tolerance) && (v >= -tolerance) && (u + v <= adet + tolerance) && (t >= -tolerance));
+    }
+
+    for (unsigned int i = 0; i < count; i++)
+        if (candidate[i])
+            mask |= (1u << i);
 
-thread_local std::unique_ptr<BBoxPriorityQueue> Mesh::mtpQueue(new BBoxPriorityQueue());
+    return mask;
+}
 
 /*****************************************************************************
 *
@@ -137,11 +453,14 @@ thread_local std::unique_ptr<BBoxPriorityQueue> Mesh::mtpQueue(new BBoxPriorityQ
 
 bool Mesh::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThreadData *Thread)
 {
-    Thread->Stats()[Ray_Mesh_Tests]++;
+    Thread->Stats().Shape(Ray_Mesh_Tests)++;
+
+    if (Data->Page != nullptr)
+        Data->Page->Touch(Thread);
 
     if (Intersect(ray, Depth_Stack, Thread))
     {
-        Thread->Stats()[Ray_Mesh_Tests_Succeeded]++;
+        Thread->Stats().Shape(Ray_Mesh_Tests_Succeeded)++;
         return(true);
     }
 
@@ -178,9 +497,7 @@ bool Mesh::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThreadDat
 
 bool Mesh::Intersect(const BasicRay& ray, IStack& Depth_Stack, TraceThreadData *Thread)
 {
-    MeshIndex i;
-    bool found;
-    DBL len, t;
+    DBL len;
     BasicRay New_Ray;
 
     /* Transform the ray into mesh space. */
@@ -199,22 +516,14 @@ bool Mesh::Intersect(const BasicRay& ray, IStack& Depth_Stack, TraceThreadData *
         len = 1.0;
     }
 
-    found = false;
-
-    if (Data->Tree == nullptr)
+    if (Data->BVH == nullptr)
     {
         /* There's no bounding hierarchy so just step through all elements. */
 
-        for (i = 0; i < Data->Number_Of_Triangles; i++)
-        {
-            if (intersect_mesh_triangle(New_Ray, &Data->Triangles[i], &t))
-            {
-                if (test_hit(&Data->Triangles[i], ray, t, len, Depth_Stack, Thread))
-                {
-                    found = true;
-                }
-            }
-        }
+        if (Data->CompactTriangles != nullptr)
+            return(intersect_all_triangles(Data->CompactTriangles, New_Ray, ray, len, Depth_Stack, Thread));
+        else
+            return(intersect_all_triangles(Data->Triangles, New_Ray, ray, len, Depth_Stack, Thread));
     }
     else
     {
@@ -222,6 +531,24 @@ bool Mesh::Intersect(const BasicRay& ray, IStack& Depth_Stack, TraceThreadData *
 
         return(intersect_bbox_tree(New_Ray, ray, len, Depth_Stack, Thread));
     }
+}
+
+template<typename TRIANGLE>
+bool Mesh::intersect_all_triangles(const TRIANGLE *Triangles, const BasicRay& ray, const BasicRay& Orig_Ray, DBL len, IStack& Depth_Stack, TraceThreadData *Thread)
+{
+    bool found = false;
+    DBL t;
+
+    for (MeshIndex i = 0; i < Data->Number_Of_Triangles; i++)
+    {
+        if (intersect_mesh_triangle(ray, &Triangles[i], &t))
+        {
+            if (test_hit(&Triangles[i], Orig_Ray, t, len, Depth_Stack, Thread))
+            {
+                found = true;
+            }
+        }
+    }
 
     return(found);
 }
@@ -260,14 +587,15 @@ bool Mesh::Intersect(const BasicRay& ray, IStack& Depth_Stack, TraceThreadData *
 bool Mesh::Inside(const Vector3d& IPoint, TraceThreadData *Thread) const
 {
     bool inside;
-    MeshIndex i;
     unsigned int found;
-    DBL t;
     BasicRay ray;
 
     if (has_inside_vector==false)
         return false;
 
+    if (Data->Page != nullptr)
+        Data->Page->Touch(Thread);
+
     ray.Direction = Data->Inside_Vect;
     ray.Origin = IPoint;
 
@@ -279,28 +607,20 @@ bool Mesh::Inside(const Vector3d& IPoint, TraceThreadData *Thread) const
         ray.Direction.normalize();
     }
 
-    found = 0;
-
-    if (Data->Tree == nullptr)
+    if (Data->BVH == nullptr)
     {
         /* just step through all elements. */
-        for (i = 0; i < Data->Number_Of_Triangles; i++)
-        {
-            if (intersect_mesh_triangle(ray, &Data->Triangles[i], &t))
-            {
-                /* actually, this should push onto a local depth stack and
-                   make sure that we don't have the same intersection point from
-                   two (or three) different triangles!!!!! */
-                found++;
-            }
-        }
+        if (Data->CompactTriangles != nullptr)
+            found = count_all_triangles(Data->CompactTriangles, ray);
+        else
+            found = count_all_triangles(Data->Triangles, ray);
         /* odd number = inside, even number = outside */
         inside = ((found & 1) != 0);
     }
     else
     {
         /* Use the mesh's bounding hierarchy. */
-        inside = inside_bbox_tree(ray, Thread->Stats());
+        inside = inside_bbox_tree(ray);
     }
 
     if (Test_Flag(this, INVERTED_FLAG))
@@ -310,6 +630,26 @@ bool Mesh::Inside(const Vector3d& IPoint, TraceThreadData *Thread) const
     return (inside);
 }
 
+template<typename TRIANGLE>
+unsigned int Mesh::count_all_triangles(const TRIANGLE *Triangles, const BasicRay& ray) const
+{
+    unsigned int found = 0;
+    DBL t;
+
+    for (MeshIndex i = 0; i < Data->Number_Of_Triangles; i++)
+    {
+        if (intersect_mesh_triangle(ray, &Triangles[i], &t))
+        {
+            /* actually, this should push onto a local depth stack and
+               make sure that we don't have the same intersection point from
+               two (or three) different triangles!!!!! */
+            found++;
+        }
+    }
+
+    return(found);
+}
+
 
 
 
@@ -342,9 +682,10 @@ bool Mesh::Inside(const Vector3d& IPoint, TraceThreadData *Thread) const
 void Mesh::Normal(Vector3d& Result, Intersection *Inter, TraceThreadData *Thread) const
 {
     Vector3d IPoint;
+    MESH_TRIANGLE Buffer;
     const MESH_TRIANGLE *Triangle;
 
-    Triangle = reinterpret_cast<const MESH_TRIANGLE *>(Inter->Pointer);
+    Triangle = get_hit_triangle(Inter, Buffer);
 
     if (Triangle->Smooth)
     {
@@ -581,7 +922,16 @@ void Mesh::Transform(const TRANSFORM *tr)
     /* NK 1998 added if */
     if (!Test_Flag(this, UV_FLAG))
         for (i=0; i<Number_Of_Textures; i++)
+        {
+            // Copies of a mesh share their textures until they need to be modified.
+            if ((Textures[i] != nullptr) && (Textures[i]->References > 1))
+            {
+                TEXTURE *Shared = Textures[i];
+                Textures[i] = Copy_Textures(Shared);
+                Destroy_Textures(Shared);
+            }
             Transform_Textures(Textures[i], tr);
+        }
 }
 
 
@@ -624,6 +974,8 @@ Mesh::Mesh() : ObjectBase(MESH_OBJECT)
 
     Number_Of_Textures=0; /* [LSK] these were uninitialized */
     Textures = nullptr;
+
+    HashTables = nullptr;
 }
 
 
@@ -650,6 +1002,10 @@ Mesh::Mesh() : ObjectBase(MESH_OBJECT)
 *
 *   NOTE: The components are not copied, only the number of references is
 *         counted, so that Destroy_Mesh() knows if they can be destroyed.
+*         The same holds for the per-triangle textures, which are copied
+*         only when a transformation needs to be applied to them. Note that
+*         each copy is still a separate object in the scene's bounding
+*         hierarchy; there is no dedicated instance object type.
 *
 *   -
 *
@@ -667,6 +1023,7 @@ ObjectPtr Mesh::Copy()
     Destroy_Transform(New->Trans);
     *New = *this;
     New->Trans = Copy_Transform(Trans);
+    New->HashTables = nullptr;
 
     New->Data = Data;
     New->Data->References++;
@@ -676,7 +1033,7 @@ ObjectPtr Mesh::Copy()
     {
         New->Textures = reinterpret_cast<TEXTURE **>(POV_MALLOC(Number_Of_Textures*sizeof(TEXTURE *), "triangle mesh data"));
         for (i = 0; i < Number_Of_Textures; i++)
-            New->Textures[i] = Copy_Textures(Textures[i]);
+            New->Textures[i] = Copy_Texture_Pointer(Textures[i]);
     }
 
     return(New);
@@ -714,6 +1071,8 @@ Mesh::~Mesh()
 {
     MeshIndex i;
 
+    delete HashTables;
+
     /* NK 1999 move texture outside of data block */
     if (Textures != nullptr)
     {
@@ -727,28 +1086,52 @@ Mesh::~Mesh()
 
     if (--(Data->References) == 0)
     {
-        Destroy_BBox_Tree(Data->Tree);
+        delete Data->BVH;
 
-        if (Data->Normals != nullptr)
-        {
-            POV_FREE(Data->Normals);
-        }
+        pov_base::pov_mem_unaccount(pov_base::kMemory_Mesh, Data->Accounted_Memory);
 
-        /* NK 1998 */
-        if (Data->UVCoords != nullptr)
+        if (Data->Storage != nullptr)
         {
-            POV_FREE(Data->UVCoords);
+            /* The arrays reside in a memory-mapped binary mesh file. */
+            MeshPager::Unregister(Data->Page);
+            delete Data->Storage;
         }
-        /* NK ---- */
-
-        if (Data->Vertices != nullptr)
+        else if (Data->In_Scene_Arena)
         {
-            POV_FREE(Data->Vertices);
+            /* The arrays reside in the scene arena, and are released along with the scene. */
+            if (Data->CompactTriangles != nullptr)
+            {
+                POV_FREE(Data->CompactTriangles);
+            }
         }
-
-        if (Data->Triangles != nullptr)
+        else
         {
-            POV_FREE(Data->Triangles);
+            if (Data->Normals != nullptr)
+            {
+                POV_FREE(Data->Normals);
+            }
+
+            /* NK 1998 */
+            if (Data->UVCoords != nullptr)
+            {
+                POV_FREE(Data->UVCoords);
+            }
+            /* NK ---- */
+
+            if (Data->Vertices != nullptr)
+            {
+                POV_FREE(Data->Vertices);
+            }
+
+            if (Data->Triangles != nullptr)
+            {
+                POV_FREE(Data->Triangles);
+            }
+
+            if (Data->CompactTriangles != nullptr)
+            {
+                POV_FREE(Data->CompactTriangles);
+            }
         }
 
         POV_FREE(Data);
@@ -798,7 +1181,9 @@ void Mesh::Compute_BBox()
 
     for (i = 0; i < Data->Number_Of_Triangles; i++)
     {
-        get_triangle_vertices(&Data->Triangles[i], P1, P2, P3);
+        const MESH_TRIANGLE Triangle = Data->Get_Triangle(i);
+
+        get_triangle_vertices(&Triangle, P1, P2, P3);
 
         mins = min(mins, P1, P2, P3);
         maxs = max(maxs, P1, P2, P3);
@@ -1037,7 +1422,8 @@ void Mesh::compute_smooth_triangle(MESH_TRIANGLE *Triangle, const Vector3d& P1,
 *
 ******************************************************************************/
 
-bool Mesh::intersect_mesh_triangle(const BasicRay &ray, const MESH_TRIANGLE *Triangle, DBL *Depth) const
+template<typename TRIANGLE>
+bool Mesh::intersect_mesh_triangle(const BasicRay &ray, const TRIANGLE *Triangle, DBL *Depth) const
 {
     DBL NormalDotOrigin, NormalDotDirection;
     DBL s, t;
@@ -1215,7 +1601,8 @@ void Mesh::MeshUV(const Vector3d& P, const MESH_TRIANGLE *Triangle, Vector2d& Re
 *
 ******************************************************************************/
 
-bool Mesh::test_hit(const MESH_TRIANGLE *Triangle, const BasicRay &OrigRay, DBL Depth, DBL len, IStack& Depth_Stack, TraceThreadData *Thread)
+template<typename TRIANGLE>
+bool Mesh::test_hit(const TRIANGLE *Triangle, const BasicRay &OrigRay, DBL Depth, DBL len, IStack& Depth_Stack, TraceThreadData *Thread)
 {
     Vector3d IPoint;
     DBL world_dist = Depth / len;
@@ -1306,43 +1693,48 @@ void Mesh::Init_Mesh_Triangle(MESH_TRIANGLE *Triangle)
 *
 * FUNCTION
 *
-*   get_triangle_bbox
+*   Compact_Mesh_Data
 *
 * INPUT
 *
-*   Triangle - Pointer to triangle
-*
 * OUTPUT
 *
-*   BBox     - Bounding box
-*
 * RETURNS
 *
 * AUTHOR
 *
-*   Dieter Bayer
-*
 * DESCRIPTION
 *
-*   Calculate the bounding box of a triangle.
+*   Convert the triangles to the compact format with 16-bit indices, provided
+*   all vertices, normals, uv coordinates and textures can be addressed that
+*   way. Must be called after the mesh data is complete, but before the
+*   bounding hierarchy is built.
 *
 * CHANGES
 *
-*   Sep 1994 : Creation.
+*   -
 *
 ******************************************************************************/
 
-void Mesh::get_triangle_bbox(const MESH_TRIANGLE *Triangle, BoundingBox *BBox) const
+void Mesh::Compact_Mesh_Data()
 {
-    Vector3d P1, P2, P3;
-    Vector3d Min, Max;
+    const MeshIndex limit = std::numeric_limits<CompactMeshIndex>::max();
 
-    get_triangle_vertices(Triangle, P1, P2, P3);
+    if ((Data->Storage != nullptr) || (Data->CompactTriangles != nullptr) || (Data->Triangles == nullptr))
+        return;
+
+    if ((Data->Number_Of_Vertices > limit) || (Data->Number_Of_Normals > limit) ||
+        (Data->Number_Of_UVCoords > limit) || (Number_Of_Textures > limit))
+        return;
+
+    Data->CompactTriangles = reinterpret_cast<Compact_Mesh_Triangle_Struct *>(POV_MALLOC(Data->Number_Of_Triangles * sizeof(Compact_Mesh_Triangle_Struct), "triangle mesh data"));
 
-    Min = min(P1, P2, P3);
-    Max = max(P1, P2, P3);
+    for (MeshIndex i = 0; i < Data->Number_Of_Triangles; i++)
+        Data->CompactTriangles[i] = Compact_Mesh_Triangle_Struct(Data->Triangles[i]);
 
-    Make_BBox_from_min_max(*BBox, Min, Max);
+    if (!Data->In_Scene_Arena)
+        POV_FREE(Data->Triangles);
+    Data->Triangles = nullptr;
 }
 
 
@@ -1351,89 +1743,283 @@ void Mesh::get_triangle_bbox(const MESH_TRIANGLE *Triangle, BoundingBox *BBox) c
 *
 * FUNCTION
 *
-*   Build_Mesh_BBox_Tree
+*   Tessellate_UV_Surface
 *
 * INPUT
 *
+*   surface   - Parametric surface to approximate
+*   tolerance - Maximum chordal deviation from the surface
+*
 * OUTPUT
 *
 * RETURNS
 *
-* AUTHOR
+*   bool - false if the tessellation resulted in no triangles
 *
-*   Dieter Bayer
+* AUTHOR
 *
 * DESCRIPTION
 *
-*   Create the bounding box hierarchy.
+*   Set up the mesh data as a tessellation of a parametric surface.
+*
+*   The parameter domain is covered by a grid whose lines are inserted
+*   adaptively: Wherever the surface deviates from a grid edge or from the
+*   center of a grid cell by more than the tolerance, the respective
+*   parameter intervals are split in half. As whole grid lines are inserted,
+*   neighbouring cells always share their vertices, and the mesh has no
+*   cracks. Each cell is then split into two smooth triangles along its
+*   shorter diagonal, with normals and uv coordinates taken from the surface.
 *
 * CHANGES
 *
-*   Feb 1995 : Creation. (Derived from the bounding slab creation code)
+*   -
 *
 ******************************************************************************/
 
-void Mesh::Build_Mesh_BBox_Tree()
+bool Mesh::Tessellate_UV_Surface(const UVMeshable& surface, DBL tolerance, TraceThreadData *Thread)
 {
-    MeshIndex i, nElem, maxelements;
-    BBOX_TREE **Triangles;
-
-    if (!Test_Flag(this, HIERARCHY_FLAG))
+    Vector2d uvMin, uvMax, uv;
+    Vector3d P, P1, P2, P3, N1, N2, N3, N;
+    std::vector<DBL> uSteps, vSteps, newSteps;
+    std::vector<Vector3d> points;
+    std::vector<bool> splitU, splitV;
+    size_t nu, nv, i, j;
+    bool refine;
+
+    surface.minUV(uvMin);
+    surface.maxUV(uvMax);
+
+    for (i = 0; i <= MESH_TESSELLATION_START_STEPS; i++)
     {
-        return;
+        uSteps.push_back(uvMin[U] + (uvMax[U] - uvMin[U]) * DBL(i) / DBL(MESH_TESSELLATION_START_STEPS));
+        vSteps.push_back(uvMin[V] + (uvMax[V] - uvMin[V]) * DBL(i) / DBL(MESH_TESSELLATION_START_STEPS));
     }
 
-    nElem = Data->Number_Of_Triangles;
+    /* Refine the grid until it is accurate enough. */
+
+    do
+    {
+        nu = uSteps.size();
+        nv = vSteps.size();
+
+        points.resize(nu * nv);
+        for (j = 0; j < nv; j++)
+            for (i = 0; i < nu; i++)
+                surface.evalVertex(points[j * nu + i], uSteps[i], vSteps[j], Thread);
+
+        splitU.assign(nu - 1, false);
+        splitV.assign(nv - 1, false);
+
+        for (j = 0; j < nv; j++)
+        {
+            for (i = 0; i < nu - 1; i++)
+            {
+                if (splitU[i])
+                    continue;
+                surface.evalVertex(P, 0.5 * (uSteps[i] + uSteps[i + 1]), vSteps[j], Thread);
+                if ((P - 0.5 * (points[j * nu + i] + points[j * nu + i + 1])).length() > tolerance)
+                    splitU[i] = true;
+            }
+        }
+
+        for (i = 0; i < nu; i++)
+        {
+            for (j = 0; j < nv - 1; j++)
+            {
+                if (splitV[j])
+                    continue;
+                surface.evalVertex(P, uSteps[i], 0.5 * (vSteps[j] + vSteps[j + 1]), Thread);
+                if ((P - 0.5 * (points[j * nu + i] + points[(j + 1) * nu + i])).length() > tolerance)
+                    splitV[j] = true;
+            }
+        }
+
+        for (j = 0; j < nv - 1; j++)
+        {
+            for (i = 0; i < nu - 1; i++)
+            {
+                if (splitU[i] && splitV[j])
+                    continue;
+                surface.evalVertex(P, 0.5 * (uSteps[i] + uSteps[i + 1]), 0.5 * (vSteps[j] + vSteps[j + 1]), Thread);
+                if ((P - 0.25 * (points[j * nu + i] + points[j * nu + i + 1] +
+                                 points[(j + 1) * nu + i] + points[(j + 1) * nu + i + 1])).length() > tolerance)
+                {
+                    splitU[i] = true;
+                    splitV[j] = true;
+                }
+            }
+        }
+
+        refine = false;
+
+        if (nu - 1 + std::count(splitU.begin(), splitU.end(), true) <= MESH_TESSELLATION_MAX_STEPS)
+        {
+            newSteps.clear();
+            for (i = 0; i < nu - 1; i++)
+            {
+                newSteps.push_back(uSteps[i]);
+                if (splitU[i])
+                {
+                    newSteps.push_back(0.5 * (uSteps[i] + uSteps[i + 1]));
+                    refine = true;
+                }
+            }
+            newSteps.push_back(uSteps[nu - 1]);
+            uSteps.swap(newSteps);
+        }
+
+        if (nv - 1 + std::count(splitV.begin(), splitV.end(), true) <= MESH_TESSELLATION_MAX_STEPS)
+        {
+            newSteps.clear();
+            for (j = 0; j < nv - 1; j++)
+            {
+                newSteps.push_back(vSteps[j]);
+                if (splitV[j])
+                {
+                    newSteps.push_back(0.5 * (vSteps[j] + vSteps[j + 1]));
+                    refine = true;
+                }
+            }
+            newSteps.push_back(vSteps[nv - 1]);
+            vSteps.swap(newSteps);
+        }
+    }
+    while (refine);
 
-    maxelements = 2 * nElem;
+    /* Evaluate vertices, normals and uv coordinates at the grid points. */
 
-    /* Now allocate an array to hold references to these elements. */
+    nu = uSteps.size();
+    nv = vSteps.size();
 
-    Triangles = reinterpret_cast<BBOX_TREE **>(POV_MALLOC(maxelements*sizeof(BBOX_TREE *), "mesh bbox tree"));
+    MeshIndex numberOfPoints = MeshIndex(nu * nv);
+    MeshIndex maxTriangles = MeshIndex(2 * (nu - 1) * (nv - 1));
 
-    /* Init list with mesh elements. */
+    MeshVector *vertexArray = reinterpret_cast<MeshVector *>(POV_MALLOC(numberOfPoints * sizeof(MeshVector), "triangle mesh data"));
+    MeshVector *normalArray = reinterpret_cast<MeshVector *>(POV_MALLOC((numberOfPoints + maxTriangles) * sizeof(MeshVector), "triangle mesh data"));
+    MeshUVVector *uvArray = reinterpret_cast<MeshUVVector *>(POV_MALLOC(numberOfPoints * sizeof(MeshUVVector), "triangle mesh data"));
+    MESH_TRIANGLE *triangleArray = reinterpret_cast<MESH_TRIANGLE *>(POV_MALLOC(maxTriangles * sizeof(MESH_TRIANGLE), "triangle mesh data"));
+    std::vector<bool> validNormal(numberOfPoints);
 
-    for (i = 0; i < nElem; i++)
+    for (j = 0; j < nv; j++)
     {
-        Triangles[i] = reinterpret_cast<BBOX_TREE *>(POV_MALLOC(sizeof(BBOX_TREE), "mesh bbox tree"));
+        for (i = 0; i < nu; i++)
+        {
+            MeshIndex k = MeshIndex(j * nu + i);
+
+            surface.evalVertex(P, uSteps[i], vSteps[j], Thread);
+            vertexArray[k] = MeshVector(P);
 
-        Triangles[i]->Infinite = false;
-        Triangles[i]->Entries  = 0;
-        Triangles[i]->Node     = reinterpret_cast<BBOX_TREE **>(&Data->Triangles[i]);
+            surface.evalNormal(N, uSteps[i], vSteps[j], Thread);
+            validNormal[k] = (N.lengthSqr() > EPSILON * EPSILON);
+            normalArray[k] = MeshVector(validNormal[k] ? N.normalized() : Vector3d(1.0, 0.0, 0.0));
 
-        get_triangle_bbox(&Data->Triangles[i], &Triangles[i]->BBox);
+            surface.evalUV(uv, uSteps[i], vSteps[j]);
+            uvArray[k] = MeshUVVector(uv);
+        }
     }
 
-    size_t maxfinitecount = 0;
-    Build_BBox_Tree(&Data->Tree, nElem, Triangles, 0, nullptr, maxfinitecount);
+    /* Split each grid cell into two triangles along its shorter diagonal. */
 
-    /* Get rid of the Triangles array. */
+    MeshIndex numberOfTriangles = 0;
 
-    POV_FREE(Triangles);
-}
+    for (j = 0; j < nv - 1; j++)
+    {
+        for (i = 0; i < nu - 1; i++)
+        {
+            MeshIndex k00 = MeshIndex(j * nu + i);
+            MeshIndex k10 = k00 + 1;
+            MeshIndex k01 = k00 + MeshIndex(nu);
+            MeshIndex k11 = k01 + 1;
+            MeshIndex corners[2][3];
+
+            if ((Vector3d(vertexArray[k00]) - Vector3d(vertexArray[k11])).lengthSqr() <=
+                (Vector3d(vertexArray[k10]) - Vector3d(vertexArray[k01])).lengthSqr())
+            {
+                corners[0][0] = k00; corners[0][1] = k10; corners[0][2] = k11;
+                corners[1][0] = k00; corners[1][1] = k11; corners[1][2] = k01;
+            }
+            else
+            {
+                corners[0][0] = k00; corners[0][1] = k10; corners[0][2] = k01;
+                corners[1][0] = k10; corners[1][1] = k11; corners[1][2] = k01;
+            }
 
+            for (int t = 0; t < 2; t++)
+            {
+                MESH_TRIANGLE& triangle = triangleArray[numberOfTriangles];
 
+                P1 = Vector3d(vertexArray[corners[t][0]]);
+                P2 = Vector3d(vertexArray[corners[t][1]]);
+                P3 = Vector3d(vertexArray[corners[t][2]]);
 
-/*****************************************************************************
-*
-* FUNCTION
-*
-*   intersect_bbox_tree
-*
-* INPUT
-*
-*   Mesh     - Mesh object
-*   Ray      - Current ray
-*   Orig_Ray - Original, untransformed ray
-*   len      - Length of the transformed ray direction
+                if (Degenerate(P1, P2, P3))
+                    continue;
+
+                Init_Mesh_Triangle(&triangle);
+                triangle.P1 = triangle.N1 = triangle.UV1 = corners[t][0];
+                triangle.P2 = triangle.N2 = triangle.UV2 = corners[t][1];
+                triangle.P3 = triangle.N3 = triangle.UV3 = corners[t][2];
+
+                triangle.Smooth = validNormal[corners[t][0]] && validNormal[corners[t][1]] && validNormal[corners[t][2]];
+
+                if (!Compute_Mesh_Triangle(&triangle, triangle.Smooth, P1, P2, P3, N))
+                    continue;
+
+                triangle.Normal_Ind = numberOfPoints + numberOfTriangles;
+                normalArray[triangle.Normal_Ind] = MeshVector(N);
+
+                numberOfTriangles++;
+            }
+        }
+    }
+
+    if (numberOfTriangles == 0)
+    {
+        POV_FREE(vertexArray);
+        POV_FREE(normalArray);
+        POV_FREE(uvArray);
+        POV_FREE(triangleArray);
+        return false;
+    }
+
+    Data = reinterpret_cast<MESH_DATA *>(POV_MALLOC(sizeof(MESH_DATA), "triangle mesh data"));
+    Data->References = 1;
+    Data->Accounted_Memory = 0;
+    Data->BVH = nullptr;
+    Data->Storage = nullptr;
+    Data->Page = nullptr;
+    Data->In_Scene_Arena = false;
+    Data->CompactTriangles = nullptr;
+
+    Data->Vertices  = vertexArray;
+    Data->Normals   = normalArray;
+    Data->UVCoords  = uvArray;
+    Data->Triangles = triangleArray;
+
+    Data->Number_Of_Vertices  = numberOfPoints;
+    Data->Number_Of_Normals   = numberOfPoints + numberOfTriangles;
+    Data->Number_Of_UVCoords  = numberOfPoints;
+    Data->Number_Of_Triangles = numberOfTriangles;
+
+    has_inside_vector = false;
+    Type |= PATCH_OBJECT;
+
+    return true;
+}
+
+
+
+/*****************************************************************************
 *
-* OUTPUT
+* FUNCTION
 *
-*   Depth_Stack - Stack of intersections
+*   Build_Mesh_BBox_Tree
 *
-* RETURNS
+* INPUT
 *
-*   bool - true if an intersection was found
+* OUTPUT
+*
+* RETURNS
 *
 * AUTHOR
 *
@@ -1441,90 +2027,507 @@ void Mesh::Build_Mesh_BBox_Tree()
 *
 * DESCRIPTION
 *
-*   Intersect a ray with the bounding box tree of a mesh.
+*   Create the bounding box hierarchy.
 *
 * CHANGES
 *
-*   Feb 1995 : Creation.
+*   Feb 1995 : Creation. (Derived from the bounding slab creation code)
+*
+*   Now creates a wide bounding volume hierarchy with multiple triangles per
+*   leaf rather than a bounding box tree with one triangle per leaf.
 *
 ******************************************************************************/
 
-bool Mesh::intersect_bbox_tree(const BasicRay &ray, const BasicRay &Orig_Ray, DBL len, IStack& Depth_Stack, TraceThreadData *Thread)
+void Mesh::Build_Mesh_BBox_Tree()
 {
-    bool found;
-    MeshIndex i;
-    DBL Best, Depth;
-    const BBOX_TREE *Node, *Root;
-    bool OldStyle = has_inside_vector;
+    BVHTree::Statistics stats;
+
+    /* The mesh data is complete at this point; arrays in a memory-mapped file are not accounted for. */
+    if ((Data->Storage == nullptr) && (Data->Accounted_Memory == 0))
+    {
+        POV_ULONG size = 0;
+        if (Data->Vertices != nullptr)
+            size += Data->Number_Of_Vertices * sizeof(MeshVector);
+        if (Data->Normals != nullptr)
+            size += Data->Number_Of_Normals * sizeof(MeshVector);
+        if (Data->UVCoords != nullptr)
+            size += Data->Number_Of_UVCoords * sizeof(MeshUVVector);
+        if (Data->Triangles != nullptr)
+            size += Data->Number_Of_Triangles * sizeof(MESH_TRIANGLE);
+        if (Data->CompactTriangles != nullptr)
+            size += Data->Number_Of_Triangles * sizeof(Compact_Mesh_Triangle_Struct);
+        pov_base::pov_mem_account(pov_base::kMemory_Mesh, size);
+        Data->Accounted_Memory = size;
+    }
+
+    if (!Test_Flag(this, HIERARCHY_FLAG))
+    {
+        /* Discard any hierarchy read from a binary mesh file. */
+        delete Data->BVH;
+        Data->BVH = nullptr;
+        return;
+    }
+
+    /* A hierarchy read from a binary mesh file is used as is. */
+    if (Data->BVH != nullptr)
+    {
+        return;
+    }
 
-    /* Create the direction vectors for this ray. */
-    Rayinfo rayinfo(ray);
+    MeshBVH *BVH = new MeshBVH;
 
-    /* Start with an empty priority queue. */
-    mtpQueue->Clear();
-    found = false;
+    BVH->tree.reset(BVHTree::Create(MESH_BVH_WIDTH, MESH_BVH_LEAF_TRIANGLES));
+    BVH->tree->build(MeshBVHNoProgress(), MeshBVHObjects(Data), stats);
 
-    Best = BOUND_HUGE;
+    Fill_Mesh_BVH(*BVH);
 
-#ifdef BBOX_EXTRA_STATS
-    Thread->Stats()[totalQueueResets]++;
-#endif
+    Data->BVH = BVH;
+}
 
-    /* Check top node. */
 
-    Root = Data->Tree;
 
-    /* Set the root object infinite to avoid a test. */
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Fill_Mesh_BVH
+*
+* INPUT
+*
+*   BVH - Bounding volume hierarchy with finished tree
+*
+* OUTPUT
+*
+*   BVH
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Store the vertices in the order referenced by the leaves of the tree,
+*   padded for the batched ray/triangle test.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
 
-    Check_And_Enqueue(*mtpQueue, Root, &Root->BBox, &rayinfo, Thread->Stats());
+void Mesh::Fill_Mesh_BVH(MeshBVH& BVH) const
+{
+    const std::vector<unsigned int>& list = BVH.tree->GetObjectList();
 
-    /* Check elements in the priority queue. */
+    for (unsigned int v = 0; v < 3; v++)
+        for (unsigned int axis = 0; axis < 3; axis++)
+            BVH.vertex[v][axis].assign(list.size() + MESH_BVH_BATCH - 1, 0.0f);
+    BVH.area.assign(list.size() + MESH_BVH_BATCH - 1, 0.0f);
 
-    while (!mtpQueue->IsEmpty())
+    for (size_t i = 0; i < list.size(); i++)
     {
-        mtpQueue->RemoveMin(Depth, Node);
+        Vector3d P[3];
+        const MESH_TRIANGLE Triangle = Data->Get_Triangle(list[i]);
 
-        /*
-         * If current intersection is larger than the best intersection found
-         * so far our task is finished, because all other bounding boxes in
-         * the priority queue are further away.
-         */
+        get_triangle_vertices(&Triangle, P[0], P[1], P[2]);
 
-        /* NK 1999 - had to comment this out for use with CSG
-        if (Depth > Best)
-        {
-            break;
-        }
-        */
-        if ( !OldStyle && Depth > Best)
-            break;
+        for (unsigned int v = 0; v < 3; v++)
+            for (unsigned int axis = 0; axis < 3; axis++)
+                BVH.vertex[v][axis][i] = float(P[v][axis]);
+        BVH.area[i] = float(cross(P[1] - P[0], P[2] - P[0]).length());
+    }
+}
+
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Write_Mesh_File
+*
+* INPUT
+*
+*   os - Stream to write to
+*
+* OUTPUT
+*
+* RETURNS
+*
+*   bool - true if the file was written successfully
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Write the mesh data, and the bounding volume hierarchy if present, to a
+*   binary mesh file (see MeshFileHeader).
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+static POV_UINT64 Align_Mesh_File_Offset(POV_UINT64 offset)
+{
+    return (offset + MESH_FILE_ALIGNMENT - 1) & ~(MESH_FILE_ALIGNMENT - 1);
+}
+
+static bool Write_Mesh_File_Block(OStream& os, POV_UINT64& pos, POV_UINT64 offset, const void *data, size_t size)
+{
+    static const char padding[MESH_FILE_ALIGNMENT] = { 0 };
 
-        /* Check current node. */
+    POV_ASSERT((offset >= pos) && (offset - pos < MESH_FILE_ALIGNMENT));
 
-        if (Node->Entries)
+    if (!os.write(padding, size_t(offset - pos)) || ((size > 0) && !os.write(data, size)))
+        return false;
+
+    pos = offset + size;
+    return true;
+}
+
+bool Mesh::Write_Mesh_File(OStream& os) const
+{
+    MeshFileHeader header;
+    MeshIndex number_of_textures = 0;
+    POV_UINT64 pos = 0;
+
+    for (MeshIndex i = 0; i < Data->Number_Of_Triangles; i++)
+    {
+        const MESH_TRIANGLE triangle = Data->Get_Triangle(i);
+        number_of_textures = std::max(number_of_textures, std::max(triangle.Texture, std::max(triangle.Texture2, triangle.Texture3)) + 1);
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MESH_FILE_MAGIC, sizeof(header.magic));
+    header.version           = MESH_FILE_VERSION;
+    header.byteOrder         = MESH_FILE_BYTE_ORDER;
+    header.vectorSize        = sizeof(MeshVector);
+    header.uvVectorSize      = sizeof(MeshUVVector);
+    header.triangleSize      = sizeof(MESH_TRIANGLE);
+    header.hasInsideVector   = has_inside_vector;
+    header.hasHierarchy      = (Data->BVH != nullptr);
+    header.numberOfVertices  = Data->Number_Of_Vertices;
+    header.numberOfNormals   = Data->Number_Of_Normals;
+    header.numberOfUVCoords  = Data->Number_Of_UVCoords;
+    header.numberOfTriangles = Data->Number_Of_Triangles;
+    header.numberOfTextures  = number_of_textures;
+    for (int axis = 0; axis < 3; axis++)
+        header.insideVector[axis] = Data->Inside_Vect[axis];
+
+    header.vertexOffset    = Align_Mesh_File_Offset(sizeof(header));
+    header.normalOffset    = Align_Mesh_File_Offset(header.vertexOffset   + POV_UINT64(Data->Number_Of_Vertices)  * sizeof(MeshVector));
+    header.uvOffset        = Align_Mesh_File_Offset(header.normalOffset   + POV_UINT64(Data->Number_Of_Normals)   * sizeof(MeshVector));
+    header.triangleOffset  = Align_Mesh_File_Offset(header.uvOffset       + POV_UINT64(Data->Number_Of_UVCoords)  * sizeof(MeshUVVector));
+    header.hierarchyOffset = Align_Mesh_File_Offset(header.triangleOffset + POV_UINT64(Data->Number_Of_Triangles) * sizeof(MESH_TRIANGLE));
+
+    if (!Write_Mesh_File_Block(os, pos, 0, &header, sizeof(header)) ||
+        !Write_Mesh_File_Block(os, pos, header.vertexOffset, Data->Vertices, Data->Number_Of_Vertices * sizeof(MeshVector)) ||
+        !Write_Mesh_File_Block(os, pos, header.normalOffset, Data->Normals, Data->Number_Of_Normals * sizeof(MeshVector)) ||
+        !Write_Mesh_File_Block(os, pos, header.uvOffset, Data->UVCoords, Data->Number_Of_UVCoords * sizeof(MeshUVVector)))
+        return false;
+
+    /* The file always holds the triangles in full form, so that it can be used in place. */
+    if (Data->CompactTriangles != nullptr)
+    {
+        if (!Write_Mesh_File_Block(os, pos, header.triangleOffset, nullptr, 0))
+            return false;
+
+        for (MeshIndex i = 0; i < Data->Number_Of_Triangles; i++)
         {
-            /* This is a node containing leaves to be checked. */
+            const MESH_TRIANGLE triangle = Data->Get_Triangle(i);
 
-            for (i = 0; i < Node->Entries; i++)
-                Check_And_Enqueue(*mtpQueue, Node->Node[i], &Node->Node[i]->BBox, &rayinfo, Thread->Stats());
+            if (!Write_Mesh_File_Block(os, pos, pos, &triangle, sizeof(triangle)))
+                return false;
         }
-        else
+    }
+    else if (!Write_Mesh_File_Block(os, pos, header.triangleOffset, Data->Triangles, Data->Number_Of_Triangles * sizeof(MESH_TRIANGLE)))
+        return false;
+
+    if (Data->BVH == nullptr)
+        return true;
+
+    return Write_Mesh_File_Block(os, pos, header.hierarchyOffset, nullptr, 0) && Data->BVH->tree->Save(os);
+}
+
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Map_Mesh_File
+*
+* INPUT
+*
+*   file - Memory-mapped binary mesh file
+*
+* OUTPUT
+*
+*   file             - Released if the file is valid
+*   numberOfTextures - Minimum number of textures required by the triangles
+*
+* RETURNS
+*
+*   bool - true if the file is valid
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Set up the mesh data to use the arrays of a binary mesh file in place.
+*
+*   All indices are checked before the file is accepted, so that a damaged
+*   file cannot cause accesses outside the arrays; this reads each triangle
+*   once, but nothing is copied.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+static bool Mesh_File_Array_Valid(const MeshFileHeader& header, POV_UINT64 offset, POV_INT32 count, size_t elementSize, size_t fileSize)
+{
+    return (offset >= sizeof(header)) && (offset % MESH_FILE_ALIGNMENT == 0) && (count >= 0) &&
+           (offset <= fileSize) && (POV_UINT64(count) * elementSize <= fileSize - offset);
+}
+
+static bool Mesh_File_Index_Valid(MeshIndex index, MeshIndex count)
+{
+    return (index >= 0) && (index < count);
+}
+
+bool Mesh::Map_Mesh_File(std::unique_ptr<pov_base::Filesystem::MappedFile>& file, MeshIndex& numberOfTextures)
+{
+    const unsigned char *base = reinterpret_cast<const unsigned char *>(file->GetData());
+    size_t size = file->GetSize();
+    MeshFileHeader header;
+    bool fully_textured = true;
+
+    if ((base == nullptr) || (size < sizeof(header)))
+        return false;
+
+    memcpy(&header, base, sizeof(header));
+
+    if ((memcmp(header.magic, MESH_FILE_MAGIC, sizeof(header.magic)) != 0) ||
+        (header.version != MESH_FILE_VERSION) ||
+        (header.byteOrder != MESH_FILE_BYTE_ORDER) ||
+        (header.vectorSize != sizeof(MeshVector)) ||
+        (header.uvVectorSize != sizeof(MeshUVVector)) ||
+        (header.triangleSize != sizeof(MESH_TRIANGLE)))
+        return false;
+
+    /* The normals always include one flat normal per triangle. */
+    if ((header.numberOfVertices <= 0) || (header.numberOfTriangles <= 0) || (header.numberOfUVCoords <= 0) ||
+        (header.numberOfNormals < header.numberOfTriangles) || (header.numberOfTextures < 0))
+        return false;
+
+    if (!Mesh_File_Array_Valid(header, header.vertexOffset, header.numberOfVertices, sizeof(MeshVector), size) ||
+        !Mesh_File_Array_Valid(header, header.normalOffset, header.numberOfNormals, sizeof(MeshVector), size) ||
+        !Mesh_File_Array_Valid(header, header.uvOffset, header.numberOfUVCoords, sizeof(MeshUVVector), size) ||
+        !Mesh_File_Array_Valid(header, header.triangleOffset, header.numberOfTriangles, sizeof(MESH_TRIANGLE), size) ||
+        (header.hasHierarchy && !Mesh_File_Array_Valid(header, header.hierarchyOffset, 0, 1, size)))
+        return false;
+
+    const MESH_TRIANGLE *triangles = reinterpret_cast<const MESH_TRIANGLE *>(base + header.triangleOffset);
+
+    for (MeshIndex i = 0; i < header.numberOfTriangles; i++)
+    {
+        const MESH_TRIANGLE& triangle = triangles[i];
+
+        if (!Mesh_File_Index_Valid(triangle.P1, header.numberOfVertices) ||
+            !Mesh_File_Index_Valid(triangle.P2, header.numberOfVertices) ||
+            !Mesh_File_Index_Valid(triangle.P3, header.numberOfVertices) ||
+            !Mesh_File_Index_Valid(triangle.Normal_Ind, header.numberOfNormals) ||
+            !Mesh_File_Index_Valid(triangle.UV1, header.numberOfUVCoords) ||
+            !Mesh_File_Index_Valid(triangle.UV2, header.numberOfUVCoords) ||
+            !Mesh_File_Index_Valid(triangle.UV3, header.numberOfUVCoords) ||
+            !Mesh_File_Index_Valid(triangle.Texture + 1, header.numberOfTextures + 1) ||
+            !Mesh_File_Index_Valid(triangle.Texture2 + 1, header.numberOfTextures + 1) ||
+            !Mesh_File_Index_Valid(triangle.Texture3 + 1, header.numberOfTextures + 1) ||
+            (triangle.Dominant_Axis > Z) || (triangle.vAxis > Z))
+            return false;
+
+        if (triangle.Smooth &&
+            (!Mesh_File_Index_Valid(triangle.N1, header.numberOfNormals) ||
+             !Mesh_File_Index_Valid(triangle.N2, header.numberOfNormals) ||
+             !Mesh_File_Index_Valid(triangle.N3, header.numberOfNormals)))
+            return false;
+
+        if (triangle.Texture < 0)
+            fully_textured = false;
+    }
+
+    std::unique_ptr<MeshBVH> BVH;
+
+    if (header.hasHierarchy)
+    {
+        IMemStream is(base + header.hierarchyOffset, size - size_t(header.hierarchyOffset), "binary mesh file");
+
+        BVH.reset(new MeshBVH);
+        BVH->tree.reset(BVHTree::Create(MESH_BVH_WIDTH, MESH_BVH_LEAF_TRIANGLES));
+        if (!BVH->tree->Load(is, (unsigned int)header.numberOfTriangles))
+            return false;
+    }
+
+    /* Init triangle mesh data; the arrays are never modified once the mesh has been created. */
+
+    Data = reinterpret_cast<MESH_DATA *>(POV_MALLOC(sizeof(MESH_DATA), "triangle mesh data"));
+    Data->References = 1;
+    Data->Accounted_Memory = 0;
+    Data->BVH = nullptr;
+    Data->Storage = file.release();
+    Data->Page = MeshPager::Register(Data->Storage);
+    Data->In_Scene_Arena = false;
+
+    Data->Vertices  = const_cast<MeshVector *>(reinterpret_cast<const MeshVector *>(base + header.vertexOffset));
+    Data->Normals   = const_cast<MeshVector *>(reinterpret_cast<const MeshVector *>(base + header.normalOffset));
+    Data->UVCoords  = const_cast<MeshUVVector *>(reinterpret_cast<const MeshUVVector *>(base + header.uvOffset));
+    Data->Triangles = const_cast<MESH_TRIANGLE *>(triangles);
+    Data->CompactTriangles = nullptr;
+
+    Data->Number_Of_Vertices  = header.numberOfVertices;
+    Data->Number_Of_Normals   = header.numberOfNormals;
+    Data->Number_Of_UVCoords  = header.numberOfUVCoords;
+    Data->Number_Of_Triangles = header.numberOfTriangles;
+
+    Data->Inside_Vect = Vector3d(header.insideVector[X], header.insideVector[Y], header.insideVector[Z]);
+
+    if (header.hasInsideVector)
+    {
+        has_inside_vector = true;
+        Type &= ~PATCH_OBJECT;
+    }
+    else
+    {
+        has_inside_vector = false;
+        Type |= PATCH_OBJECT;
+    }
+
+    if (fully_textured)
+        Type |= TEXTURED_OBJECT;
+
+    if (BVH != nullptr)
+    {
+        Fill_Mesh_BVH(*BVH);
+        Data->BVH = BVH.release();
+    }
+
+    numberOfTextures = header.numberOfTextures;
+
+    return true;
+}
+
+
+
+/// Leaf functor to intersect a ray with the triangles of a mesh.
+template<typename TRIANGLE>
+class Mesh::BVHIntersect final : public BVHTree::LeafIntersect
+{
+    public:
+
+        BVHIntersect(Mesh& m, const TRIANGLE *tr, const BasicRay& r, const BasicRay& o, DBL l, IStack& ds, TraceThreadData *t) :
+            mesh(m), triangles(tr), ray(r), origRay(o), len(l), depthStack(ds), thread(t), found(false)
+        {}
+
+        virtual void operator()(unsigned int first, unsigned int count, double& maxdist) override
         {
-            /* This is a leaf so test the contained triangle. */
+            const MeshBVH& BVH = *mesh.Data->BVH;
+            const std::vector<unsigned int>& list = BVH.tree->GetObjectList();
+            DBL Depth;
 
-            if (intersect_mesh_triangle(ray, reinterpret_cast<MESH_TRIANGLE *>(Node->Node), &Depth))
+            for (unsigned int batch = first, end = first + count; batch < end; batch += MESH_BVH_BATCH)
             {
-                if (test_hit(reinterpret_cast<MESH_TRIANGLE *>(Node->Node), Orig_Ray, Depth, len, Depth_Stack, Thread))
+                unsigned int mask = Filter_Mesh_Triangles(BVH, batch, std::min(end - batch, MESH_BVH_BATCH), ray);
+
+                for (unsigned int i = batch; mask != 0; i++, mask >>= 1)
                 {
-                    found = true;
+                    if ((mask & 1) == 0)
+                        continue;
+
+                    const TRIANGLE *Triangle = &triangles[list[i]];
+
+                    if (mesh.intersect_mesh_triangle(ray, Triangle, &Depth) &&
+                        mesh.test_hit(Triangle, origRay, Depth, len, depthStack, thread))
+                    {
+                        found = true;
 
-                    Best = Depth;
+                        // NK 1999 - meshes with an inside vector need all intersections for use with CSG
+                        if (!mesh.has_inside_vector)
+                            maxdist = std::min(maxdist, Depth);
+                    }
                 }
             }
         }
+
+        virtual bool operator()() const override { return found; }
+
+    private:
+
+        Mesh& mesh;
+        const TRIANGLE *triangles;
+        const BasicRay& ray;
+        const BasicRay& origRay;
+        DBL len;
+        IStack& depthStack;
+        TraceThreadData *thread;
+        bool found;
+};
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   intersect_bbox_tree
+*
+* INPUT
+*
+*   Mesh     - Mesh object
+*   Ray      - Current ray
+*   Orig_Ray - Original, untransformed ray
+*   len      - Length of the transformed ray direction
+*
+* OUTPUT
+*
+*   Depth_Stack - Stack of intersections
+*
+* RETURNS
+*
+*   bool - true if an intersection was found
+*
+* AUTHOR
+*
+*   Dieter Bayer
+*
+* DESCRIPTION
+*
+*   Intersect a ray with the bounding box tree of a mesh.
+*
+* CHANGES
+*
+*   Feb 1995 : Creation.
+*
+*   Now uses the mesh's bounding volume hierarchy, testing the triangles of
+*   each leaf as a batch.
+*
+******************************************************************************/
+
+bool Mesh::intersect_bbox_tree(const BasicRay &ray, const BasicRay &Orig_Ray, DBL len, IStack& Depth_Stack, TraceThreadData *Thread)
+{
+    if (Data->CompactTriangles != nullptr)
+    {
+        BVHIntersect<Compact_Mesh_Triangle_Struct> isect(*this, Data->CompactTriangles, ray, Orig_Ray, len, Depth_Stack, Thread);
+
+        return (*Data->BVH->tree)(ray, isect, BOUND_HUGE);
     }
+    else
+    {
+        BVHIntersect<MESH_TRIANGLE> isect(*this, Data->Triangles, ray, Orig_Ray, len, Depth_Stack, Thread);
 
-    return(found);
+        return (*Data->BVH->tree)(ray, isect, BOUND_HUGE);
+    }
 }
 
 
@@ -1537,18 +2540,18 @@ bool Mesh::intersect_bbox_tree(const BasicRay &ray, const BasicRay &Orig_Ray, DB
 *
 * INPUT
 *
-*   aPoint - Normal/Vertex to store
+*   aPoint - Normal/Vertex/UV vector to store
 *
 * OUTPUT
 *
-*   Hash_Table - Normal/Vertex hash table
-*   Number     - Number of normals/vertices
-*   Max        - Max. number of normals/vertices
-*   Elements   - List of normals/vertices
+*   Hash_Table - Normal/Vertex/UV vector hash table
+*   Number     - Number of normals/vertices/UV vectors
+*   Max        - Max. number of normals/vertices/UV vectors
+*   Elements   - List of normals/vertices/UV vectors
 *
 * RETURNS
 *
-*   MeshIndex - Index of normal/vertex into the normals/vertices list
+*   MeshIndex - Index of normal/vertex/UV vector into the list
 *
 * AUTHOR
 *
@@ -1565,37 +2568,22 @@ bool Mesh::intersect_bbox_tree(const BasicRay &ray, const BasicRay &Orig_Ray, DB
 *
 ******************************************************************************/
 
-MeshIndex Mesh::mesh_hash(HASH_TABLE **Hash_Table, MeshIndex *Number, MeshIndex  *Max, MeshVector **Elements, const Vector3d& aPoint)
+template<typename VECTOR, typename INPUT_VECTOR>
+static MeshIndex mesh_hash(MeshHashTable<VECTOR>& Hash_Table, MeshIndex *Number, MeshIndex *Max, VECTOR **Elements, const INPUT_VECTOR& aPoint)
 {
-    int hash;
-    MeshVector D, P;
-    HASH_TABLE *p;
-
-    P = MeshVector(aPoint);
-
-    /* Get hash value. */
-
-    // TODO - This is inefficient for very small meshes. Maybe scale by 2^N (or 2^-N) into the range 1.0..2.0 first.
-    hash = (unsigned int)((int)(326.0*P[X])^(int)(694.7*P[Y])^(int)(1423.6*P[Z])) % HASH_SIZE;
+    const VECTOR P = VECTOR(aPoint);
+    MeshIndex Index;
 
     /* Try to find normal/vertex. */
 
-    for (p = Hash_Table[hash]; p != nullptr; p = p->Next)
-    {
-        D = p->P - P;
-
-        if ((fabs(D[X]) < EPSILON) && (fabs(D[Y]) < EPSILON) && (fabs(D[Z]) < EPSILON))
-        {
-            break;
-        }
-    }
+    Index = Hash_Table.Find(*Elements, P, *Number);
 
-    if ((p != nullptr) && (p->Index >= 0))
+    if (Index != *Number)
     {
-        return(p->Index);
+        return(Index);
     }
 
-    /* Add new normal/vertex to the list and hash table. */
+    /* Add new normal/vertex to the list. */
 
     if ((*Number) >= (*Max))
     {
@@ -1606,21 +2594,11 @@ MeshIndex Mesh::mesh_hash(HASH_TABLE **Hash_Table, MeshIndex *Number, MeshIndex
 
         (*Max) *= 2;
 
-        (*Elements) = reinterpret_cast<MeshVector *>(POV_REALLOC((*Elements), (*Max)*sizeof(MeshVector), "mesh data"));
+        (*Elements) = reinterpret_cast<VECTOR *>(POV_REALLOC((*Elements), (*Max)*sizeof(VECTOR), "mesh data"));
     }
 
     (*Elements)[*Number] = P;
 
-    p = reinterpret_cast<HASH_TABLE *>(POV_MALLOC(sizeof(HASH_TABLE), "mesh data"));
-
-    p->P = P;
-
-    p->Index = *Number;
-
-    p->Next = Hash_Table[hash];
-
-    Hash_Table[hash] = p;
-
     return((*Number)++);
 }
 
@@ -1663,7 +2641,7 @@ MeshIndex Mesh::mesh_hash(HASH_TABLE **Hash_Table, MeshIndex *Number, MeshIndex
 
 MeshIndex Mesh::Mesh_Hash_Vertex(MeshIndex *Number_Of_Vertices, MeshIndex *Max_Vertices, MeshVector **Vertices, const Vector3d& Vertex)
 {
-    return(mesh_hash(Vertex_Hash_Table, Number_Of_Vertices, Max_Vertices, Vertices, Vertex));
+    return(mesh_hash(HashTables->vertices, Number_Of_Vertices, Max_Vertices, Vertices, Vertex));
 }
 
 
@@ -1705,7 +2683,7 @@ MeshIndex Mesh::Mesh_Hash_Vertex(MeshIndex *Number_Of_Vertices, MeshIndex *Max_V
 
 MeshIndex Mesh::Mesh_Hash_Normal(MeshIndex *Number_Of_Normals, MeshIndex *Max_Normals, MeshVector **Normals, const Vector3d& S_Normal)
 {
-    return(mesh_hash(Normal_Hash_Table, Number_Of_Normals, Max_Normals, Normals, S_Normal));
+    return(mesh_hash(HashTables->normals, Number_Of_Normals, Max_Normals, Normals, S_Normal));
 }
 
 
@@ -1820,62 +2798,7 @@ MeshIndex Mesh::Mesh_Hash_Texture(MeshIndex *Number_Of_Textures, MeshIndex *Max_
 
 MeshIndex Mesh::Mesh_Hash_UV(MeshIndex *Number, MeshIndex *Max, MeshUVVector **Elements, const Vector2d& aPoint)
 {
-    int hash;
-    MeshUVVector D, P;
-    UV_HASH_TABLE *p;
-
-    P = MeshUVVector(aPoint);
-
-    /* Get hash value. */
-
-    // TODO - This is inefficient for very small meshes. Maybe scale by 2^N (or 2^-N) into the range 1.0..2.0 first.
-    hash = (unsigned int)((int)(326.0*P[U])^(int)(694.7*P[V])) % HASH_SIZE;
-
-    /* Try to find normal/vertex. */
-
-    for (p = UV_Hash_Table[hash]; p != nullptr; p = p->Next)
-    {
-        /* VSub(D, p->P, P); */
-        D = p->P - P;
-
-        if ((fabs(D[U]) < EPSILON) && (fabs(D[V]) < EPSILON))
-        {
-            break;
-        }
-    }
-
-    if ((p != nullptr) && (p->Index >= 0))
-    {
-        return(p->Index);
-    }
-
-    /* Add new normal/vertex to the list and hash table. */
-
-    if ((*Number) >= (*Max))
-    {
-        if ((*Max) >= std::numeric_limits<MeshIndex>::max()/2)
-        {
-            throw POV_EXCEPTION_STRING("Too many normals/vertices in mesh.");
-        }
-
-        (*Max) *= 2;
-
-        (*Elements) = reinterpret_cast<MeshUVVector *>(POV_REALLOC((*Elements), (*Max)*sizeof(MeshUVVector), "mesh data"));
-    }
-
-    (*Elements)[*Number] = P;
-
-    p = reinterpret_cast<UV_HASH_TABLE *>(POV_MALLOC(sizeof(UV_HASH_TABLE), "mesh data"));
-
-    p->P = P;
-
-    p->Index = *Number;
-
-    p->Next = UV_Hash_Table[hash];
-
-    UV_Hash_Table[hash] = p;
-
-    return((*Number)++);
+    return(mesh_hash(HashTables->uvCoords, Number, Max, Elements, aPoint));
 }
 
 
@@ -1908,30 +2831,8 @@ MeshIndex Mesh::Mesh_Hash_UV(MeshIndex *Number, MeshIndex *Max, MeshUVVector **E
 
 void Mesh::Create_Mesh_Hash_Tables()
 {
-    MeshIndex i;
-
-    Vertex_Hash_Table = reinterpret_cast<HASH_TABLE **>(POV_MALLOC(HASH_SIZE*sizeof(HASH_TABLE *), "mesh hash table"));
-
-    for (i = 0; i < HASH_SIZE; i++)
-    {
-        Vertex_Hash_Table[i] = nullptr;
-    }
-
-    Normal_Hash_Table = reinterpret_cast<HASH_TABLE **>(POV_MALLOC(HASH_SIZE*sizeof(HASH_TABLE *), "mesh hash table"));
-
-    for (i = 0; i < HASH_SIZE; i++)
-    {
-        Normal_Hash_Table[i] = nullptr;
-    }
-
-    /* NK 1998 */
-    UV_Hash_Table = reinterpret_cast<UV_HASH_TABLE **>(POV_MALLOC(HASH_SIZE*sizeof(UV_HASH_TABLE *), "mesh hash table"));
-
-    for (i = 0; i < HASH_SIZE; i++)
-    {
-        UV_Hash_Table[i] = nullptr;
-    }
-    /* NK ---- */
+    delete HashTables;
+    HashTables = new MeshHashTables();
 }
 
 
@@ -1964,55 +2865,8 @@ void Mesh::Create_Mesh_Hash_Tables()
 
 void Mesh::Destroy_Mesh_Hash_Tables()
 {
-    MeshIndex i;
-    HASH_TABLE *Temp;
-    /* NK 1998 */
-    UV_HASH_TABLE *UVTemp;
-    /* NK ---- */
-
-    for (i = 0; i < HASH_SIZE; i++)
-    {
-        while (Vertex_Hash_Table[i] != nullptr)
-        {
-            Temp = Vertex_Hash_Table[i];
-
-            Vertex_Hash_Table[i] = Temp->Next;
-
-            POV_FREE(Temp);
-        }
-    }
-
-    POV_FREE(Vertex_Hash_Table);
-
-    for (i = 0; i < HASH_SIZE; i++)
-    {
-        while (Normal_Hash_Table[i] != nullptr)
-        {
-            Temp = Normal_Hash_Table[i];
-
-            Normal_Hash_Table[i] = Temp->Next;
-
-            POV_FREE(Temp);
-        }
-    }
-
-    POV_FREE(Normal_Hash_Table);
-
-    /* NK 1998 */
-    for (i = 0; i < HASH_SIZE; i++)
-    {
-        while (UV_Hash_Table[i] != nullptr)
-        {
-            UVTemp = UV_Hash_Table[i];
-
-            UV_Hash_Table[i] = UVTemp->Next;
-
-            POV_FREE(UVTemp);
-        }
-    }
-
-    POV_FREE(UV_Hash_Table);
-    /* NK ---- */
+    delete HashTables;
+    HashTables = nullptr;
 }
 
 
@@ -2048,7 +2902,8 @@ void Mesh::Destroy_Mesh_Hash_Tables()
 *
 ******************************************************************************/
 
-void Mesh::get_triangle_vertices(const MESH_TRIANGLE *Triangle, Vector3d& P1, Vector3d& P2, Vector3d& P3) const
+template<typename TRIANGLE>
+void Mesh::get_triangle_vertices(const TRIANGLE *Triangle, Vector3d& P1, Vector3d& P2, Vector3d& P3) const
 {
     P1 = Vector3d(Data->Vertices[Triangle->P1]);
     P2 = Vector3d(Data->Vertices[Triangle->P2]);
@@ -2133,6 +2988,65 @@ void Mesh::get_triangle_uvcoords(const MESH_TRIANGLE *Triangle, Vector2d& UV1, V
 }
 
 
+const MESH_TRIANGLE *Mesh_Data_Struct::Get_Triangles(std::vector<MESH_TRIANGLE>& Buffer) const
+{
+    if (CompactTriangles == nullptr)
+        return Triangles;
+
+    Buffer.clear();
+    Buffer.reserve(Number_Of_Triangles);
+    for (MeshIndex i = 0; i < Number_Of_Triangles; i++)
+        Buffer.push_back(MESH_TRIANGLE(CompactTriangles[i]));
+
+    return Buffer.data();
+}
+
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   get_hit_triangle
+*
+* INPUT
+*
+*   Inter  - Intersection found by this mesh
+*   Buffer - Storage for a widened copy of the triangle
+*
+* OUTPUT
+*
+*   Buffer
+*
+* RETURNS
+*
+*   Pointer to the triangle hit, in full format
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   -
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+const MESH_TRIANGLE *Mesh::get_hit_triangle(const Intersection *Inter, MESH_TRIANGLE& Buffer) const
+{
+    if (Data->CompactTriangles != nullptr)
+    {
+        Buffer = MESH_TRIANGLE(*reinterpret_cast<const Compact_Mesh_Triangle_Struct *>(Inter->Pointer));
+        return &Buffer;
+    }
+
+    return reinterpret_cast<const MESH_TRIANGLE *>(Inter->Pointer);
+}
+
+
+
 /*****************************************************************************
 *
 * FUNCTION
@@ -2258,6 +3172,7 @@ void Mesh::UVCoord(Vector2d& Result, const Intersection *Inter) const
     DBL w1, w2, w3, t1, t2;
     Vector3d vA, vB;
     Vector3d Side1, Side2;
+    MESH_TRIANGLE Buffer;
     const MESH_TRIANGLE *Triangle;
     Vector3d P;
 
@@ -2266,7 +3181,7 @@ void Mesh::UVCoord(Vector2d& Result, const Intersection *Inter) const
     else
         P = Inter->IPoint;
 
-    Triangle = reinterpret_cast<const MESH_TRIANGLE *>(Inter->Pointer);
+    Triangle = get_hit_triangle(Inter, Buffer);
 
     /* ---------------- this is for P1 ---------------- */
     /* Side1 is opposite side, Side2 is an adjacent side (vector pointing away) */
@@ -2332,6 +3247,49 @@ void Mesh::UVCoord(Vector2d& Result, const Intersection *Inter) const
 }
 
 
+/// Leaf functor to count the triangles of a mesh hit by a ray.
+template<typename TRIANGLE>
+class Mesh::BVHInside final : public BVHTree::LeafIntersect
+{
+    public:
+
+        BVHInside(const Mesh& m, const TRIANGLE *tr, const BasicRay& r) : mesh(m), triangles(tr), ray(r), found(0) {}
+
+        virtual void operator()(unsigned int first, unsigned int count, double&) override
+        {
+            const MeshBVH& BVH = *mesh.Data->BVH;
+            const std::vector<unsigned int>& list = BVH.tree->GetObjectList();
+            DBL Depth;
+
+            for (unsigned int batch = first, end = first + count; batch < end; batch += MESH_BVH_BATCH)
+            {
+                unsigned int mask = Filter_Mesh_Triangles(BVH, batch, std::min(end - batch, MESH_BVH_BATCH), ray);
+
+                for (unsigned int i = batch; mask != 0; i++, mask >>= 1)
+                {
+                    /* actually, this should push onto a local depth stack and
+                       make sure that we don't have the same intersection point from
+                       two (or three) different triangles!!!!! */
+                    if (((mask & 1) != 0) && mesh.intersect_mesh_triangle(ray, &triangles[list[i]], &Depth))
+                        found++;
+                }
+            }
+        }
+
+        /// Never report a hit, so that the query visits all triangles along the ray.
+        virtual bool operator()() const override { return false; }
+
+        /// Get the number of triangles hit.
+        inline unsigned int Count() const { return found; }
+
+    private:
+
+        const Mesh& mesh;
+        const TRIANGLE *triangles;
+        const BasicRay& ray;
+        unsigned int found;
+};
+
 /*****************************************************************************
 *
 * FUNCTION
@@ -2361,57 +3319,28 @@ void Mesh::UVCoord(Vector2d& Result, const Intersection *Inter) const
 *
 *   Oct 1998 : Creation.
 *
+*   Now uses the mesh's bounding volume hierarchy, testing the triangles of
+*   each leaf as a batch.
+*
 ******************************************************************************/
 
-bool Mesh::inside_bbox_tree(const BasicRay &ray, RenderStatistics& stats) const
+bool Mesh::inside_bbox_tree(const BasicRay &ray) const
 {
-    MeshIndex i, found;
-    DBL Best, Depth;
-    const BBOX_TREE *Node, *Root;
-
-    /* Create the direction vectors for this ray. */
-    Rayinfo rayinfo(ray);
-
-    /* Start with an empty priority queue. */
-    mtpQueue->Clear();
-    found = 0;
-
-    Best = BOUND_HUGE;
-
-#ifdef BBOX_EXTRA_STATS
-    stats[totalQueueResets]++;
-#endif
-
-    /* Check top node. */
-    Root = Data->Tree;
-
-    /* Set the root object infinite to avoid a test. */
-    Check_And_Enqueue(*mtpQueue, Root, &Root->BBox, &rayinfo, stats);
+    unsigned int found;
 
-    /* Check elements in the priority queue. */
-    while (!mtpQueue->IsEmpty())
+    if (Data->CompactTriangles != nullptr)
     {
-        mtpQueue->RemoveMin(Depth, Node);
+        BVHInside<Compact_Mesh_Triangle_Struct> inside(*this, Data->CompactTriangles, ray);
 
-        /* Check current node. */
-        if (Node->Entries)
-        {
-            /* This is a node containing leaves to be checked. */
-            for (i = 0; i < Node->Entries; i++)
-                Check_And_Enqueue(*mtpQueue, Node->Node[i], &Node->Node[i]->BBox, &rayinfo, stats);
-        }
-        else
-        {
-            /* This is a leaf so test the contained triangle. */
+        (void)(*Data->BVH->tree)(ray, inside, BOUND_HUGE);
+        found = inside.Count();
+    }
+    else
+    {
+        BVHInside<MESH_TRIANGLE> inside(*this, Data->Triangles, ray);
 
-            if (intersect_mesh_triangle(ray, reinterpret_cast<MESH_TRIANGLE *>(Node->Node), &Depth))
-            {
-                /* actually, this should push onto a local depth stack and
-                   make sure that we don't have the same intersection point from
-                   two (or three) different triangles!!!!! */
-                found++;
-            }
-        }
+        (void)(*Data->BVH->tree)(ray, inside, BOUND_HUGE);
+        found = inside.Count();
     }
 
     /* odd number = inside, even number = outside */
@@ -2420,7 +3349,8 @@ bool Mesh::inside_bbox_tree(const BasicRay &ray, RenderStatistics& stats) const
 
 void Mesh::Determine_Textures(Intersection *isect, bool hitinside, WeightedTextureVector& textures, TraceThreadData *Threaddata)
 {
-    const MESH_TRIANGLE *tri = reinterpret_cast<const MESH_TRIANGLE *>(isect->Pointer);
+    MESH_TRIANGLE Buffer;
+    const MESH_TRIANGLE *tri = get_hit_triangle(isect, Buffer);
 
     if ((Interior_Texture != nullptr) && (hitinside == true)) // useful feature for checking mesh orientation and other effects [trf]
         textures.push_back(WeightedTexture(1.0, Interior_Texture));
@@ -44,9 +44,11 @@
 
 // C++ standard header files
 #include <memory>
+#include <vector>
 
 // POV-Ray header files (base module)
-//  (none at the moment)
+#include "base/fileinputoutput_fwd.h"
+#include "base/filesystem_fwd.h"
 
 // POV-Ray header files (core module)
 #include "core/bounding/boundingbox_fwd.h"
@@ -77,33 +79,57 @@ namespace pov
 * Global typedefs
 ******************************************************************************/
 
-// TODO - a SnglVector2d should probably suffice for MeshUVVector, and reduce the Mesh's memory footprint by 8 bytes per triangle.
-// TODO - on systems with 64-bit int type, int is probably overkill for MeshIndex; maybe we even want to make Mesh a template, using short for small meshes.
-
 using MeshVector    = SnglVector3d; ///< Data type used to store vertices and normals.
-using MeshUVVector  = Vector2d;     ///< Data type used to store UV coordinates.
+using MeshUVVector  = SnglVector2d; ///< Data type used to store UV coordinates.
 using MeshIndex     = signed int;   ///< Data type used to store indices into vertices / normals / uv coordinate / texture tables. Must be signed and able to hold 2*max.
+using CompactMeshIndex = signed short; ///< Data type used to store indices in meshes small enough, see @ref Mesh::Compact_Mesh_Data().
 
-struct Mesh_Triangle_Struct final
+/// Triangle of a mesh.
+///
+/// @tparam INDEX   Data type used to store indices, either @ref MeshIndex or @ref CompactMeshIndex.
+///
+template<typename INDEX>
+struct GenericMeshTriangle final
 {
     MeshVector Perp;               ///< Vector used for smooth triangles.
 
     SNGL Distance;                 ///< Distance of triangle along normal.
 
-    MeshIndex Normal_Ind;          ///< Index of unsmoothed triangle normal.
-    MeshIndex P1, P2, P3;          ///< Indices of triangle vertices.
-    MeshIndex Texture;             ///< Index of triangle texture.
-    MeshIndex Texture2, Texture3;  ///< Color Triangle Patch.
-    MeshIndex N1, N2, N3;          ///< Indices of smoothed triangle normals.
-    MeshIndex UV1, UV2, UV3;       ///< Indicies of UV coordinate vectors
+    INDEX Normal_Ind;              ///< Index of unsmoothed triangle normal.
+    INDEX P1, P2, P3;              ///< Indices of triangle vertices.
+    INDEX Texture;                 ///< Index of triangle texture.
+    INDEX Texture2, Texture3;      ///< Color Triangle Patch.
+    INDEX N1, N2, N3;              ///< Indices of smoothed triangle normals.
+    INDEX UV1, UV2, UV3;           ///< Indicies of UV coordinate vectors
 
     unsigned int Smooth:1;         ///< Is this a smooth triangle.
     unsigned int Dominant_Axis:2;  ///< Dominant axis.
     unsigned int vAxis:2;          ///< Axis for smooth triangle.
     unsigned int ThreeTex:1;       ///< Color Triangle Patch.
+
+    GenericMeshTriangle() = default;
+
+    /// Convert from a different index type.
+    /// @note   The caller is responsible for making sure that all indices fit.
+    template<typename INDEX2>
+    explicit GenericMeshTriangle(const GenericMeshTriangle<INDEX2>& t) :
+        Perp(t.Perp), Distance(t.Distance),
+        Normal_Ind(INDEX(t.Normal_Ind)),
+        P1(INDEX(t.P1)), P2(INDEX(t.P2)), P3(INDEX(t.P3)),
+        Texture(INDEX(t.Texture)), Texture2(INDEX(t.Texture2)), Texture3(INDEX(t.Texture3)),
+        N1(INDEX(t.N1)), N2(INDEX(t.N2)), N3(INDEX(t.N3)),
+        UV1(INDEX(t.UV1)), UV2(INDEX(t.UV2)), UV3(INDEX(t.UV3)),
+        Smooth(t.Smooth), Dominant_Axis(t.Dominant_Axis), vAxis(t.vAxis), ThreeTex(t.ThreeTex)
+    {}
 };
+using Mesh_Triangle_Struct = GenericMeshTriangle<MeshIndex>;
+using Compact_Mesh_Triangle_Struct = GenericMeshTriangle<CompactMeshIndex>;
 using MESH_TRIANGLE = Mesh_Triangle_Struct; ///< @deprecated
 
+class MeshBVH;
+class MeshPage;
+class UVMeshable;
+
 struct Mesh_Data_Struct final
 {
     int References;                    ///< Number of references to the mesh.
@@ -113,27 +139,27 @@ struct Mesh_Data_Struct final
     MeshIndex Number_Of_Vertices;      ///< Number of vertices in the mesh.
     MeshVector *Normals, *Vertices;    ///< Arrays of normals and vertices.
     MeshUVVector *UVCoords;            ///< Array of UV coordinates
-    MESH_TRIANGLE *Triangles;          ///< Array of triangles.
-    BBOX_TREE *Tree;                   ///< Bounding box tree for mesh.
+    MESH_TRIANGLE *Triangles;          ///< Array of triangles, unless stored in compact form.
+    Compact_Mesh_Triangle_Struct *CompactTriangles; ///< Array of triangles, if stored in compact form.
+    MeshBVH *BVH;                      ///< Bounding volume hierarchy for mesh.
+    pov_base::Filesystem::MappedFile *Storage; ///< Binary mesh file holding the arrays, if memory-mapped.
+    MeshPage *Page;                    ///< Residency state of the binary mesh file, if memory-mapped.
+    bool In_Scene_Arena;               ///< Whether the arrays (except the compact triangles) reside in the scene arena.
+    POV_ULONG Accounted_Memory;        ///< Size of the arrays as reported to the memory accounting.
     Vector3d Inside_Vect;              ///< vector to use to test 'inside'
-};
-using MESH_DATA = Mesh_Data_Struct; ///< @deprecated
 
-struct Hash_Table_Struct final
-{
-    MeshIndex Index;
-    MeshVector P;
-    Hash_Table_Struct *Next;
-};
-using HASH_TABLE = Hash_Table_Struct; ///< @deprecated
+    /// Get a triangle, regardless of the form it is stored in.
+    inline MESH_TRIANGLE Get_Triangle(MeshIndex i) const
+    {
+        return (CompactTriangles != nullptr) ? MESH_TRIANGLE(CompactTriangles[i]) : Triangles[i];
+    }
 
-struct UV_Hash_Table_Struct final
-{
-    MeshIndex Index;
-    MeshUVVector P;
-    UV_Hash_Table_Struct *Next;
+    /// Get all triangles, widening them into the buffer provided if stored in compact form.
+    const MESH_TRIANGLE *Get_Triangles(std::vector<MESH_TRIANGLE>& Buffer) const;
 };
-using UV_HASH_TABLE = UV_Hash_Table_Struct; ///< @deprecated
+using MESH_DATA = Mesh_Data_Struct; ///< @deprecated
+
+class MeshHashTables;
 
 class Mesh final : public ObjectBase
 {
@@ -164,7 +190,56 @@ class Mesh final : public ObjectBase
         /// @note The method may decide to re-order the vertices without notice.
         bool Compute_Mesh_Triangle(MESH_TRIANGLE *Triangle, bool Smooth, const Vector3d& P1, const Vector3d& P2, const Vector3d& P3, Vector3d& S_Normal) const;
 
+        /// Store the triangles in compact form if possible.
+        ///
+        /// If the numbers of vertices, normals, UV coordinates and textures all fit into a
+        /// @ref CompactMeshIndex, the triangles are converted to @ref Compact_Mesh_Triangle_Struct,
+        /// which takes up a third less memory.
+        ///
+        /// @note   This must be called once the mesh has been fully set up, as the original
+        ///         triangle array is freed. Code outside the mesh implementation should use
+        ///         @ref Mesh_Data_Struct::Get_Triangle() to access the triangles from then on.
+        ///
+        void Compact_Mesh_Data();
+
+        /// Create the bounding volume hierarchy.
         void Build_Mesh_BBox_Tree();
+
+        /// Set up the mesh data as a tessellation of a parametric surface.
+        ///
+        /// The parameter domain is refined adaptively until the mesh deviates from the surface
+        /// by no more than the given tolerance, measured at the midpoints of the grid edges and
+        /// cells. Normals and uv coordinates are taken from the surface.
+        ///
+        /// @param[in]  surface     Surface to tessellate.
+        /// @param[in]  tolerance   Maximum chordal deviation, in the surface's coordinate system.
+        /// @param[in]  Thread      Thread data to evaluate the surface with.
+        /// @return                 `false` if the tessellation resulted in no triangles.
+        ///
+        bool Tessellate_UV_Surface(const UVMeshable& surface, DBL tolerance, TraceThreadData *Thread);
+
+        /// Write the mesh data to a binary mesh file.
+        ///
+        /// The file holds the vertex, normal, UV coordinate and triangle arrays in native layout
+        /// and byte order, followed by the bounding volume hierarchy if one has been built. It is
+        /// only intended to be read back by @ref Map_Mesh_File() on the same platform.
+        ///
+        /// @return     `true` if the file was written successfully.
+        ///
+        bool Write_Mesh_File(OStream& os) const;
+
+        /// Use a binary mesh file as the mesh data.
+        ///
+        /// The arrays in the file are used in place rather than copied, and a bounding volume
+        /// hierarchy stored in the file is used instead of building a new one. The mesh takes
+        /// ownership of the file.
+        ///
+        /// @param[in,out]  file                Memory-mapped file written by @ref Write_Mesh_File().
+        /// @param[out]     numberOfTextures    Minimum number of textures referenced by the triangles.
+        /// @return                             `true` if the file was valid, in which case the data
+        ///                                     has been set up and `file` has been released.
+        ///
+        bool Map_Mesh_File(std::unique_ptr<pov_base::Filesystem::MappedFile>& file, MeshIndex& numberOfTextures);
         bool Degenerate(const Vector3d& P1, const Vector3d& P2, const Vector3d& P3);
         void Init_Mesh_Triangle(MESH_TRIANGLE *Triangle);
         void Destroy_Mesh_Hash_Tables();
@@ -180,33 +255,26 @@ class Mesh final : public ObjectBase
         void Compute_Mesh_BBox();
         void MeshUV(const Vector3d& P, const MESH_TRIANGLE *Triangle, Vector2d& Result) const;
         void compute_smooth_triangle(MESH_TRIANGLE *Triangle, const Vector3d& P1, const Vector3d& P2, const Vector3d& P3) const;
-        bool intersect_mesh_triangle(const BasicRay& ray, const MESH_TRIANGLE *Triangle, DBL *Depth) const;
-        bool test_hit(const MESH_TRIANGLE *Triangle, const BasicRay& OrigRay, DBL Depth, DBL len, IStack& Depth_Stack, TraceThreadData *Thread);
-        void get_triangle_bbox(const MESH_TRIANGLE *Triangle, BoundingBox *BBox) const;
+        template<typename TRIANGLE> bool intersect_mesh_triangle(const BasicRay& ray, const TRIANGLE *Triangle, DBL *Depth) const;
+        template<typename TRIANGLE> bool test_hit(const TRIANGLE *Triangle, const BasicRay& OrigRay, DBL Depth, DBL len, IStack& Depth_Stack, TraceThreadData *Thread);
+        template<typename TRIANGLE> bool intersect_all_triangles(const TRIANGLE *Triangles, const BasicRay& ray, const BasicRay& Orig_Ray, DBL len, IStack& Depth_Stack, TraceThreadData *Thread);
+        template<typename TRIANGLE> unsigned int count_all_triangles(const TRIANGLE *Triangles, const BasicRay& ray) const;
         bool intersect_bbox_tree(const BasicRay& ray, const BasicRay& Orig_Ray, DBL len, IStack& Depth_Stack, TraceThreadData *Thread);
-        bool inside_bbox_tree(const BasicRay& ray, RenderStatistics& stats) const;
-        void get_triangle_vertices(const MESH_TRIANGLE *Triangle, Vector3d& P1, Vector3d& P2, Vector3d& P3) const;
+        bool inside_bbox_tree(const BasicRay& ray) const;
+        template<typename TRIANGLE> void get_triangle_vertices(const TRIANGLE *Triangle, Vector3d& P1, Vector3d& P2, Vector3d& P3) const;
+        const MESH_TRIANGLE *get_hit_triangle(const Intersection *Inter, MESH_TRIANGLE& Buffer) const;
         void get_triangle_normals(const MESH_TRIANGLE *Triangle, Vector3d& N1, Vector3d& N2, Vector3d& N3) const;
         void get_triangle_uvcoords(const MESH_TRIANGLE *Triangle, Vector2d& U1, Vector2d& U2, Vector2d& U3) const;
-        static MeshIndex mesh_hash(HASH_TABLE **Hash_Table, MeshIndex *Number, MeshIndex *Max, MeshVector **Elements, const Vector3d& aPoint);
 
 private:
         // these are used temporarily during parsing and are destroyed
         // when the parser has finished constructing the object
-        static HASH_TABLE **Vertex_Hash_Table;
-        static HASH_TABLE **Normal_Hash_Table;
-        static UV_HASH_TABLE **UV_Hash_Table;
+        MeshHashTables *HashTables;
 
-        /// Priority queue object.
-        ///
-        /// This object is for temporary use in the intersection and insideness tests;
-        /// the only reason it is not simply a local variable there is that we want to
-        /// avoid the overhead of repeated construction and destruction on the stack.
-        /// Technically we could get the same performance by keeping it local to the
-        /// functions and making it thread-local, but this would mean having one such
-        /// object per function, when it's perfectly safe for them to share one object.
-        ///
-        static thread_local std::unique_ptr<BBoxPriorityQueue> mtpQueue;
+        template<typename TRIANGLE> class BVHIntersect;
+        template<typename TRIANGLE> class BVHInside;
+
+        void Fill_Mesh_BVH(MeshBVH& BVH) const;
 };
 
 /// @}
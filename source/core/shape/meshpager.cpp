@@ -0,0 +1,171 @@
+//******************************************************************************
+///
+/// @file core/shape/meshpager.cpp
+///
+/// Implementation of the pager for memory-mapped mesh data.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+// Unit header file must be the first file included within POV-Ray *.cpp files (pulls in config)
+#include "core/shape/meshpager.h"
+
+// C++ variants of C standard header files
+//  (none at the moment)
+
+// C++ standard header files
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+// POV-Ray header files (base module)
+#include "base/filesystem.h"
+
+// POV-Ray header files (core module)
+#include "core/scene/tracethreaddata.h"
+#include "core/support/statistics.h"
+
+// this must be the last file included
+#include "base/povdebug.h"
+
+namespace pov
+{
+
+/// Distance between the bytes read to page in a mesh; this should not exceed the system's page size.
+const size_t MESH_PAGE_STRIDE = 4096;
+
+std::atomic<POV_ULONG> MeshPage::sEpoch(0);
+
+static std::mutex gMeshPagerMutex;
+static std::vector<MeshPage *> gMeshPages;
+static POV_ULONG gMeshBudget = 0;
+static POV_ULONG gMeshResident = 0;
+
+MeshPage::MeshPage(const pov_base::Filesystem::MappedFile *f) :
+    file(f),
+    lastUse(sEpoch.load()),
+    resident(true)
+{}
+
+void MeshPage::PageIn(TraceThreadData *Thread)
+{
+    std::lock_guard<std::mutex> lock(gMeshPagerMutex);
+
+    // another thread may have paged in the mesh while we were waiting
+    if (resident.load(std::memory_order_relaxed))
+        return;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    // Read the data in bulk, rather than leaving it to be faulted in piecemeal, and in random order,
+    // by the intersection tests.
+    file->Prefetch();
+    const volatile unsigned char *data = reinterpret_cast<const volatile unsigned char *>(file->GetData());
+    for (size_t i = 0; i < file->GetSize(); i += MESH_PAGE_STRIDE)
+        (void)data[i];
+
+    lastUse.store(++sEpoch, std::memory_order_relaxed);
+    gMeshResident += file->GetSize();
+    resident.store(true, std::memory_order_release);
+
+    Thread->Stats()[Mesh_Page_Ins]++;
+    Thread->Stats()[Mesh_Page_In_Time] += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+    MeshPager::EnforceBudget(this, Thread);
+}
+
+void MeshPager::SetBudget(POV_ULONG bytes)
+{
+    std::lock_guard<std::mutex> lock(gMeshPagerMutex);
+    gMeshBudget = bytes;
+}
+
+MeshPage *MeshPager::Register(const pov_base::Filesystem::MappedFile *file)
+{
+    std::lock_guard<std::mutex> lock(gMeshPagerMutex);
+
+    MeshPage *page = new MeshPage(file);
+    page->lastUse.store(++MeshPage::sEpoch, std::memory_order_relaxed);
+    gMeshPages.push_back(page);
+    gMeshResident += file->GetSize();
+
+    EnforceBudget(page, nullptr);
+
+    return page;
+}
+
+void MeshPager::Unregister(MeshPage *page)
+{
+    if (page == nullptr)
+        return;
+
+    std::lock_guard<std::mutex> lock(gMeshPagerMutex);
+
+    std::vector<MeshPage *>::iterator i = std::find(gMeshPages.begin(), gMeshPages.end(), page);
+    if (i != gMeshPages.end())
+        gMeshPages.erase(i);
+    if (page->resident.load(std::memory_order_relaxed))
+        gMeshResident -= page->file->GetSize();
+
+    delete page;
+}
+
+void MeshPager::EnforceBudget(const MeshPage *keep, TraceThreadData *Thread)
+{
+    if (gMeshBudget == 0)
+        return;
+
+    while (gMeshResident > gMeshBudget)
+    {
+        MeshPage *victim = nullptr;
+
+        for (std::vector<MeshPage *>::iterator i = gMeshPages.begin(); i != gMeshPages.end(); i++)
+        {
+            if (((*i) != keep) && (*i)->resident.load(std::memory_order_relaxed) &&
+                ((victim == nullptr) || ((*i)->lastUse.load(std::memory_order_relaxed) < victim->lastUse.load(std::memory_order_relaxed))))
+                victim = *i;
+        }
+
+        if (victim == nullptr)
+            break;
+
+        // Clear the flag first, so that threads starting to use the mesh from now on page it in again;
+        // threads already using it merely fault in what they need.
+        victim->resident.store(false, std::memory_order_relaxed);
+        victim->file->Evict();
+        gMeshResident -= victim->file->GetSize();
+
+        if (Thread != nullptr)
+            Thread->Stats()[Mesh_Page_Evictions]++;
+    }
+}
+
+}
+// end of namespace pov
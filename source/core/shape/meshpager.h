@@ -0,0 +1,148 @@
+//******************************************************************************
+///
+/// @file core/shape/meshpager.h
+///
+/// Declarations related to paging memory-mapped mesh data in and out under a memory budget.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+#ifndef POVRAY_CORE_MESHPAGER_H
+#define POVRAY_CORE_MESHPAGER_H
+
+// Module config header file must be the first file included within POV-Ray unit header files
+#include "core/configcore.h"
+
+// C++ variants of C standard header files
+//  (none at the moment)
+
+// C++ standard header files
+#include <atomic>
+
+// POV-Ray header files (base module)
+#include "base/filesystem_fwd.h"
+
+// POV-Ray header files (core module)
+#include "core/core_fwd.h"
+
+namespace pov
+{
+
+//##############################################################################
+///
+/// @addtogroup PovCoreShape
+///
+/// @{
+
+/// Residency state of a memory-mapped binary mesh file.
+///
+/// One of these is created by @ref MeshPager::Register() for each mesh loaded from a binary mesh
+/// file, and shared by all copies of the mesh.
+///
+class MeshPage final
+{
+    public:
+
+        /// Note that the mesh is about to be accessed, paging it in if it has been evicted.
+        inline void Touch(TraceThreadData *Thread)
+        {
+            POV_ULONG now = sEpoch.load(std::memory_order_relaxed);
+            if (lastUse.load(std::memory_order_relaxed) != now)
+                lastUse.store(now, std::memory_order_relaxed);
+            if (!resident.load(std::memory_order_acquire))
+                PageIn(Thread);
+        }
+
+    private:
+
+        friend class MeshPager;
+
+        /// Counter advanced whenever a mesh is paged in, serving as a coarse clock to find the
+        /// least recently used meshes.
+        static std::atomic<POV_ULONG> sEpoch;
+
+        const pov_base::Filesystem::MappedFile *file;
+        std::atomic<POV_ULONG> lastUse;
+        std::atomic<bool> resident;
+
+        MeshPage(const pov_base::Filesystem::MappedFile *f);
+
+        void PageIn(TraceThreadData *Thread);
+};
+
+/// Pager keeping the memory held by memory-mapped binary mesh files within a budget.
+///
+/// Meshes loaded from binary mesh files are used in place in the mapped file, so the operating
+/// system already reads them on demand. The pager additionally drops the meshes used least recently
+/// from memory once the total size of those in use exceeds the budget, so that scenes with more mesh
+/// data than fits into memory keep their working set resident, rather than leaving it to the system
+/// to page out whatever it sees fit (or to fail altogether).
+///
+/// Since the mappings are read-only, a mesh can be evicted at any time without harm, even while
+/// other threads are using it; they merely have to read it from the file again. The budget is
+/// therefore soft: meshes in use are never waited for, and a single mesh larger than the budget is
+/// still paged in.
+///
+/// @note
+///     The granularity is an entire binary mesh file. Meshes whose data resides in ordinary
+///     memory are not affected.
+///
+class MeshPager final
+{
+    public:
+
+        /// Set the budget for memory-mapped mesh data, in bytes, or 0 for none.
+        static void SetBudget(POV_ULONG bytes);
+
+        /// Start tracking a memory-mapped binary mesh file, which is assumed to be resident.
+        /// @note
+        ///     The returned page must be released via @ref Unregister() before the file is closed.
+        static MeshPage *Register(const pov_base::Filesystem::MappedFile *file);
+
+        /// Stop tracking a memory-mapped binary mesh file.
+        static void Unregister(MeshPage *page);
+
+    private:
+
+        friend class MeshPage;
+
+        /// Evict the least recently used meshes until the budget is met, sparing the one given.
+        /// @note
+        ///     Must be called with the pager's mutex held.
+        static void EnforceBudget(const MeshPage *keep, TraceThreadData *Thread);
+};
+
+/// @}
+///
+//##############################################################################
+
+}
+// end of namespace pov
+
+#endif // POVRAY_CORE_MESHPAGER_H
@@ -278,7 +278,7 @@ bool Ovus::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThreadDat
     DBL len, horizontal;
     Vector3d P,D;
 
-    Thread->Stats()[Ray_Ovus_Tests]++;
+    Thread->Stats().Shape(Ray_Ovus_Tests)++;
     MInvTransPoint(P, ray.Origin, Trans);
     MInvTransDirection(D, ray.Direction, Trans);
     len = D.length();
@@ -402,7 +402,7 @@ bool Ovus::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThreadDat
     }
     if (Found)
     {
-        Thread->Stats()[Ray_Ovus_Tests_Succeeded]++;
+        Thread->Stats().Shape(Ray_Ovus_Tests_Succeeded)++;
     }
     return (Found);
 }
@@ -37,14 +37,18 @@
 #include "core/shape/parametric.h"
 
 // C++ variants of C standard header files
-//  (none at the moment)
+#include <cstring>
 
 // C++ standard header files
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <exception>
+#include <system_error>
+#include <thread>
 
 // POV-Ray header files (base module)
-//  (none at the moment)
+#include "base/fileinputoutput.h"
 
 // POV-Ray header files (core module)
 #include "core/math/matrix.h"
@@ -80,6 +84,23 @@ const int OK_T     =  32;
 const int OK_U     =  64;
 const int OK_V     = 128;
 
+/// Number of sector subtrees per thread when precomputing in parallel.
+const unsigned int PRECOMP_SUBTREES_PER_THREAD = 4;
+
+/// Identifies files written by Parametric::Write_Precomputed_Values().
+const char PRECOMP_FILE_MAGIC[8] = { 'P', 'O', 'V', 'P', 'R', 'E', 'C', 'P' };
+const POV_UINT32 PRECOMP_FILE_VERSION = 1;
+
+struct PrecompFileHeader final
+{
+    char        magic[8];
+    POV_UINT32  version;
+    POV_UINT32  flags;
+    POV_UINT32  depth;
+    POV_UINT32  reserved;
+    POV_UINT64  key;
+};
+
 
 /*****************************************************************************
  *
@@ -120,13 +141,13 @@ bool Parametric::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThr
     DBL Intervals_Hi[2][32];
     int SectorNum[32];
 
-    Thread->Stats()[Ray_Par_Bound_Tests]++;
+    Thread->Stats().Shape(Ray_Par_Bound_Tests)++;
 
     if (!container->Intersect(ray, Trans, Depth1, Depth2, Side1, Side2))
         return false;
 
-    Thread->Stats()[Ray_Par_Bound_Tests_Succeeded]++;
-    Thread->Stats()[Ray_Parametric_Tests]++;
+    Thread->Stats().Shape(Ray_Par_Bound_Tests_Succeeded)++;
+    Thread->Stats().Shape(Ray_Parametric_Tests)++;
 
     if (Trans != nullptr)
     {
@@ -372,7 +393,7 @@ bool Parametric::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThr
 
     if (TResult < Depth2)
     {
-        Thread->Stats()[Ray_Parametric_Tests_Succeeded]++;
+        Thread->Stats().Shape(Ray_Parametric_Tests_Succeeded)++;
         IPoint = ray.Direction * TResult;
         IPoint += ray.Origin;
 
@@ -673,7 +694,6 @@ ObjectPtr Parametric::Copy()
     New->Function[1] = Function[1]->Clone();
     New->Function[2] = Function[2]->Clone();
     New->Trans = Copy_Transform(Trans);
-    New->PData = Copy_PrecompParVal();
 
     New->container = std::shared_ptr<ContainedByShape>(container->Copy());
 
@@ -710,7 +730,6 @@ Parametric::~Parametric()
     delete Function[0];
     delete Function[1];
     delete Function[2];
-    Destroy_PrecompParVal();
 }
 
 
@@ -751,7 +770,6 @@ Parametric::Parametric() : NonsolidObject(PARAMETRIC_OBJECT)
     Function[2] = nullptr;
     accuracy = 0.001;
     max_gradient = 1;
-    PData = nullptr;
 }
 
 
@@ -809,19 +827,20 @@ void Parametric::UVCoord(Vector2d& Result, const Intersection *inter) const
  *
  * CHANGES
  *
- *   -
+ *   Operates on explicitly passed data, so that several threads can fill
+ *   disjoint parts of the sector tree at the same time.
  *
  ******************************************************************************/
 
-void Parametric::Precomp_Par_Int(int depth, DBL umin, DBL vmin, DBL umax, DBL vmax, GenericScalarFunctionInstance aFn[3])
+void Parametric::Precomp_Par_Int(PRECOMP_PAR_DATA& data, int depth, DBL umin, DBL vmin, DBL umax, DBL vmax, GenericScalarFunctionInstance aFn[3]) const
 {
     int j;
 
-    if(depth >= PrecompLastDepth)
+    if(depth >= (1 << (data.depth - 1)))
     {
         for(j = 0; j < 3; j++)
         {
-            if(PData->flags & (1 << j))
+            if(data.flags & (1 << j))
             {
                 Vector2d low,hi;
 
@@ -835,8 +854,8 @@ void Parametric::Precomp_Par_Int(int depth, DBL umin, DBL vmin, DBL umax, DBL vm
                                               low,
                                               hi,
                                               max_gradient,
-                                              PData->Low[j][depth],
-                                              PData->Hi[j][depth]);
+                                              data.Low[j][depth],
+                                              data.Hi[j][depth]);
             }
         }
     }
@@ -844,27 +863,54 @@ void Parametric::Precomp_Par_Int(int depth, DBL umin, DBL vmin, DBL umax, DBL vm
     {
         if(umax - umin < vmax - vmin)
         {
-            Precomp_Par_Int(2 * depth, umin, vmin, umax, (vmin + vmax) / 2.0, aFn);
-            Precomp_Par_Int(2 * depth + 1, umin, (vmin + vmax) / 2.0, umax, vmax, aFn);
+            Precomp_Par_Int(data, 2 * depth, umin, vmin, umax, (vmin + vmax) / 2.0, aFn);
+            Precomp_Par_Int(data, 2 * depth + 1, umin, (vmin + vmax) / 2.0, umax, vmax, aFn);
         }
         else
         {
-            Precomp_Par_Int(2 * depth, umin, vmin, (umin + umax) / 2.0, vmax, aFn);
-            Precomp_Par_Int(2 * depth + 1, (umin + umax) / 2.0, vmin, umax, vmax, aFn);
+            Precomp_Par_Int(data, 2 * depth, umin, vmin, (umin + umax) / 2.0, vmax, aFn);
+            Precomp_Par_Int(data, 2 * depth + 1, (umin + umax) / 2.0, vmin, umax, vmax, aFn);
         }
-        for(j = 0; j < 3; j++)
+        Precomp_Par_Merge(data, depth);
+    }
+}
+
+
+/*****************************************************************************
+ *
+ * FUNCTION
+ *
+ *   Precomp_Par_Merge
+ *
+ * INPUT
+ *
+ *   data - sector tree
+ *   depth - index of the sector to merge the bounds of its two halves into
+ *
+ * OUTPUT
+ *
+ * RETURNS
+ *
+ * AUTHOR
+ *
+ * DESCRIPTION
+ *
+ *   -
+ *
+ * CHANGES
+ *
+ *   -
+ *
+ ******************************************************************************/
+
+void Parametric::Precomp_Par_Merge(PRECOMP_PAR_DATA& data, int depth)
+{
+    for(int j = 0; j < 3; j++)
+    {
+        if(data.flags & (1 << j))
         {
-            if(PData->flags & (1 << j))
-            {
-                if(PData->Hi[j][2 * depth] > PData->Hi[j][2 * depth + 1])
-                    PData->Hi[j][depth] = PData->Hi[j][2 * depth];
-                else
-                    PData->Hi[j][depth] = PData->Hi[j][2 * depth + 1];
-                if(PData->Low[j][2 * depth] < PData->Low[j][2 * depth + 1])
-                    PData->Low[j][depth] = PData->Low[j][2 * depth];
-                else
-                    PData->Low[j][depth] = PData->Low[j][2 * depth + 1];
-            }
+            data.Hi[j][depth] = max(data.Hi[j][2 * depth], data.Hi[j][2 * depth + 1]);
+            data.Low[j][depth] = min(data.Low[j][2 * depth], data.Low[j][2 * depth + 1]);
         }
     }
 }
@@ -878,6 +924,10 @@ void Parametric::Precomp_Par_Int(int depth, DBL umin, DBL vmin, DBL umax, DBL vm
  *
  * INPUT
  *
+ *   flags - functions to compute the bounds of
+ *   depth - number of sector tree levels
+ *   threads - thread data of the threads to use, the calling thread first
+ *
  * OUTPUT
  *
  * RETURNS
@@ -890,47 +940,102 @@ void Parametric::Precomp_Par_Int(int depth, DBL umin, DBL vmin, DBL umax, DBL vm
  *
  * CHANGES
  *
- *   -
+ *   The upper levels of the sector tree are split into a number of
+ *   subtrees, which are computed in parallel if more than one thread is
+ *   given.
  *
  ******************************************************************************/
 
-void Parametric::Precompute_Parametric_Values(char flags, int depth, TraceThreadData *Thread)
+void Parametric::Precompute_Parametric_Values(char flags, int depth, const std::vector<TraceThreadData*>& threads)
 {
     const char* es = "precompute";
     int nmb;
 
+    POV_ASSERT(!threads.empty());
+
     if ((depth < 1) || (depth > 20))
         throw POV_EXCEPTION_STRING("Precompute: invalid depth");
     nmb = 1 << depth;
 
-    PData = new PRECOMP_PAR_DATA;
-    PData->flags = flags;
-    PData->depth = depth;
-    PData->use = 1;
+    std::shared_ptr<PRECOMP_PAR_DATA> data(new PRECOMP_PAR_DATA);
+    data->flags = flags;
+    data->depth = depth;
 
-    if (flags & OK_X)
+    for (int j = 0; j < 3; j++)
     {
-        PData->Low[0] = new DBL[nmb];
-        PData->Hi[0] = new DBL[nmb];
+        if (flags & (1 << j))
+        {
+            data->Low[j].resize(nmb);
+            data->Hi[j].resize(nmb);
+        }
     }
-    if (flags & OK_Y)
+
+    // Pick a tree level with a few subtrees per thread, so that the work
+    // evens out even though some sectors are more expensive than others.
+    int level = 0;
+    if (threads.size() > 1)
+        while ((level < depth - 1) && ((1u << level) < PRECOMP_SUBTREES_PER_THREAD * threads.size()))
+            level++;
+
+    int first = 1 << level;
+    std::vector<Vector2d> low(2 * first), hi(2 * first);
+    low[1] = Vector2d(umin, vmin);
+    hi[1] = Vector2d(umax, vmax);
+    for (int i = 1; i < first; i++)
     {
-        PData->Low[1] = new DBL[nmb];
-        PData->Hi[1] = new DBL[nmb];
+        int split = ((hi[i][U] - low[i][U] < hi[i][V] - low[i][V]) ? V : U);
+        DBL mid = (low[i][split] + hi[i][split]) / 2.0;
+        low[2 * i] = low[2 * i + 1] = low[i];
+        hi[2 * i] = hi[2 * i + 1] = hi[i];
+        hi[2 * i][split] = low[2 * i + 1][split] = mid;
     }
-    if (flags & OK_Z)
+
+    std::atomic<int> next(first);
+    std::vector<std::exception_ptr> errors(threads.size());
+
+    auto work = [&](size_t t)
     {
-        PData->Low[2] = new DBL[nmb];
-        PData->Hi[2] = new DBL[nmb];
+        try
+        {
+            std::array<GenericScalarFunctionInstance,3> aFn = {
+                GenericScalarFunctionInstance(Function[0], threads[t]),
+                GenericScalarFunctionInstance(Function[1], threads[t]),
+                GenericScalarFunctionInstance(Function[2], threads[t])
+            };
+            for (int i = next++; i < 2 * first; i = next++)
+                Precomp_Par_Int(*data, i, low[i][U], low[i][V], hi[i][U], hi[i][V], aFn.data());
+        }
+        catch (...)
+        {
+            errors[t] = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> helpers;
+    for (size_t t = 1; t < std::min<size_t>(threads.size(), first); t++)
+    {
+        try
+        {
+            helpers.emplace_back(work, t);
+        }
+        catch (std::system_error&)
+        {
+            break; // no more threads available; the others will pick up the work
+        }
     }
+    work(0);
 
-    PrecompLastDepth = 1 << (depth - 1);
-    std::array<GenericScalarFunctionInstance,3> aFn = {
-        GenericScalarFunctionInstance(Function[0], Thread),
-        GenericScalarFunctionInstance(Function[1], Thread),
-        GenericScalarFunctionInstance(Function[2], Thread)
-    };
-    Precomp_Par_Int(1, umin, vmin, umax, vmax, aFn.data());
+    for (auto& helper : helpers)
+        helper.join();
+
+    for (auto& error : errors)
+        if (error)
+            std::rethrow_exception(error);
+
+    for (int i = first - 1; i >= 1; i--)
+        Precomp_Par_Merge(*data, i);
+
+    PData = data;
 }
 
 
@@ -938,14 +1043,20 @@ void Parametric::Precompute_Parametric_Values(char flags, int depth, TraceThread
  *
  * FUNCTION
  *
- *   Copy_PrecompParVal
+ *   Get_Precompute_Key
  *
  * INPUT
  *
+ *   flags, depth - as for Precompute_Parametric_Values
+ *
  * OUTPUT
  *
+ *   key - fingerprint of everything the precomputed values depend on
+ *
  * RETURNS
  *
+ *   false if the functions can't be fingerprinted
+ *
  * AUTHOR
  *
  * DESCRIPTION
@@ -958,14 +1069,32 @@ void Parametric::Precompute_Parametric_Values(char flags, int depth, TraceThread
  *
  ******************************************************************************/
 
-PRECOMP_PAR_DATA* Parametric::Copy_PrecompParVal()
+bool Parametric::Get_Precompute_Key(char flags, int depth, POV_UINT64& key) const
 {
-    if (PData == nullptr)
-        return nullptr;
+    POV_UINT64 fingerprint;
 
-    (PData->use)++;
+    key = 0xCBF29CE484222325ull;
+    auto mix = [&key](const void *p, size_t size)
+    {
+        for (size_t i = 0; i < size; i++)
+            key = (key ^ reinterpret_cast<const unsigned char *>(p)[i]) * 0x100000001B3ull;
+    };
+
+    for (int j = 0; j < 3; j++)
+    {
+        if (flags & (1 << j))
+        {
+            if (!Function[j]->GetFingerprint(fingerprint))
+                return false;
+            mix(&fingerprint, sizeof(fingerprint));
+        }
+    }
 
-    return (PData);
+    const DBL ranges[] = { umin, umax, vmin, vmax, accuracy, max_gradient };
+    mix(ranges, sizeof(ranges));
+    mix(&flags, sizeof(flags));
+    mix(&depth, sizeof(depth));
+    return true;
 }
 
 
@@ -973,19 +1102,25 @@ PRECOMP_PAR_DATA* Parametric::Copy_PrecompParVal()
  *
  * FUNCTION
  *
- *   Destroy_PrecompParVal
+ *   Write_Precomputed_Values
  *
  * INPUT
  *
+ *   os - stream to write to
+ *   key - as computed by Get_Precompute_Key
+ *
  * OUTPUT
  *
  * RETURNS
  *
+ *   false if writing failed
+ *
  * AUTHOR
  *
  * DESCRIPTION
  *
- *   -
+ *   The file is in the native byte order, and only intended to be read
+ *   back on the same platform.
  *
  * CHANGES
  *
@@ -993,31 +1128,94 @@ PRECOMP_PAR_DATA* Parametric::Copy_PrecompParVal()
  *
  ******************************************************************************/
 
-void Parametric::Destroy_PrecompParVal()
+bool Parametric::Write_Precomputed_Values(OStream& os, POV_UINT64 key) const
 {
     if (PData == nullptr)
-        return;
+        return false;
 
-    PData->use--;
-    if (PData->use == 0)
+    PrecompFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, PRECOMP_FILE_MAGIC, sizeof(header.magic));
+    header.version = PRECOMP_FILE_VERSION;
+    header.flags = PData->flags;
+    header.depth = PData->depth;
+    header.key = key;
+
+    if (!os.write(&header, sizeof(header)))
+        return false;
+
+    for (int j = 0; j < 3; j++)
     {
-        if (PData->flags & OK_X)
+        if (PData->flags & (1 << j))
         {
-            delete[] PData->Low[0];
-            delete[] PData->Hi[0];
+            if (!os.write(PData->Low[j].data(), PData->Low[j].size() * sizeof(DBL)) ||
+                !os.write(PData->Hi[j].data(), PData->Hi[j].size() * sizeof(DBL)))
+                return false;
         }
-        if (PData->flags & OK_Y)
-        {
-            delete[] PData->Low[1];
-            delete[] PData->Hi[1];
-        }
-        if (PData->flags & OK_Z)
+    }
+    return true;
+}
+
+
+/*****************************************************************************
+ *
+ * FUNCTION
+ *
+ *   Read_Precomputed_Values
+ *
+ * INPUT
+ *
+ *   is - stream to read from
+ *   flags, depth - as for Precompute_Parametric_Values
+ *   key - as computed by Get_Precompute_Key
+ *
+ * OUTPUT
+ *
+ * RETURNS
+ *
+ *   false if the file doesn't hold matching data
+ *
+ * AUTHOR
+ *
+ * DESCRIPTION
+ *
+ *   -
+ *
+ * CHANGES
+ *
+ *   -
+ *
+ ******************************************************************************/
+
+bool Parametric::Read_Precomputed_Values(IStream& is, char flags, int depth, POV_UINT64 key)
+{
+    PrecompFileHeader header;
+
+    if ((depth < 1) || (depth > 20) ||
+        !is.read(&header, sizeof(header)) ||
+        (memcmp(header.magic, PRECOMP_FILE_MAGIC, sizeof(header.magic)) != 0) ||
+        (header.version != PRECOMP_FILE_VERSION) || (header.flags != POV_UINT32(flags)) ||
+        (header.depth != POV_UINT32(depth)) || (header.key != key))
+        return false;
+
+    std::shared_ptr<PRECOMP_PAR_DATA> data(new PRECOMP_PAR_DATA);
+    data->flags = flags;
+    data->depth = depth;
+
+    for (int j = 0; j < 3; j++)
+    {
+        if (flags & (1 << j))
         {
-            delete[] PData->Low[2];
-            delete[] PData->Hi[2];
+            data->Low[j].resize(1 << depth);
+            data->Hi[j].resize(1 << depth);
+            if (!is.read(data->Low[j].data(), data->Low[j].size() * sizeof(DBL)) ||
+                !is.read(data->Hi[j].data(), data->Hi[j].size() * sizeof(DBL)))
+                return false;
         }
-        delete PData;
     }
+
+    PData = data;
+    return true;
 }
 
 
@@ -48,9 +48,10 @@
 
 // C++ standard header files
 #include <memory>
+#include <vector>
 
 // POV-Ray header files (base module)
-//  (none at the moment)
+#include "base/fileinputoutput_fwd.h"
 
 // POV-Ray header files (core module)
 #include "core/coretypes.h"
@@ -83,11 +84,17 @@ namespace pov
 * Global typedefs
 ******************************************************************************/
 
+/// Bounds of the parametric functions over the sectors of the (u,v) range.
+///
+/// Sectors form a binary tree stored in level order, starting at index 1; each sector is split
+/// across its longer side into sectors `2*n` and `2*n+1`. Once computed, the data is never
+/// modified again, and is shared by all copies of the object.
+///
 struct PrecompParValues_Struct final
 {
-    int use, depth;
+    int depth;
     char flags;
-    DBL *Low[3], *Hi[3];     /*  X,Y,Z  */
+    std::vector<DBL> Low[3], Hi[3];     /*  X,Y,Z  */
 };
 using PRECOMP_PAR_DATA = PrecompParValues_Struct; ///< @deprecated
 
@@ -117,7 +124,28 @@ class Parametric final : public NonsolidObject,  public UVMeshable
         virtual void Transform(const TRANSFORM *) override;
         virtual void Compute_BBox() override;
 
-        void Precompute_Parametric_Values(char flags, int depth, TraceThreadData *Thread);
+        /// Compute the bounds of the functions over the sectors of the (u,v) range.
+        /// @param  flags       Functions to compute the bounds of (bit 0 for x, 1 for y, 2 for z).
+        /// @param  depth       Number of sector tree levels.
+        /// @param  threads     Thread data of the threads to spread the work across; the first
+        ///                     entry must belong to the calling thread.
+        void Precompute_Parametric_Values(char flags, int depth, const std::vector<TraceThreadData*>& threads);
+
+        /// Compute a key identifying the result of @ref Precompute_Parametric_Values().
+        /// @return `false` if the functions involved can't be fingerprinted.
+        bool Get_Precompute_Key(char flags, int depth, POV_UINT64& key) const;
+
+        /// Get the precomputed bounds (`nullptr` if none were computed).
+        const std::shared_ptr<const PrecompParValues_Struct>& Get_Precomputed_Values() const { return PData; }
+
+        /// Use bounds precomputed by another object with the same key.
+        void Set_Precomputed_Values(const std::shared_ptr<const PrecompParValues_Struct>& data) { PData = data; }
+
+        /// Write the precomputed bounds to a cache file.
+        bool Write_Precomputed_Values(OStream& os, POV_UINT64 key) const;
+
+        /// Read precomputed bounds from a cache file written by @ref Write_Precomputed_Values().
+        bool Read_Precomputed_Values(IStream& is, char flags, int depth, POV_UINT64 key);
 
         virtual void evalVertex( Vector3d& r, const DBL u, const DBL v, TraceThreadData *Thread )const override;
         virtual void evalNormal( Vector3d& r, const DBL u, const DBL v, TraceThreadData *Thread )const override;
@@ -125,15 +153,13 @@ class Parametric final : public NonsolidObject,  public UVMeshable
         virtual void maxUV( Vector2d& r )const override;
 
     protected:
-        void Precomp_Par_Int(int depth, DBL umin, DBL vmin, DBL umax, DBL vmax, GenericScalarFunctionInstance aFn[3]);
-        PRECOMP_PAR_DATA *Copy_PrecompParVal();
-        void Destroy_PrecompParVal();
+        void Precomp_Par_Int(PRECOMP_PAR_DATA& data, int depth, DBL umin, DBL vmin, DBL umax, DBL vmax, GenericScalarFunctionInstance aFn[3]) const;
+        static void Precomp_Par_Merge(PRECOMP_PAR_DATA& data, int depth);
 
         static inline void Evaluate_Function_Interval_UV(GenericScalarFunctionInstance& fn, DBL threshold, const Vector2d& fnvec_low, const Vector2d& fnvec_hi, DBL max_gradient, DBL& low, DBL& hi);
         static void Interval(DBL dx, DBL a, DBL b, DBL max_gradient, DBL *Min, DBL *Max);
     private:
-        PRECOMP_PAR_DATA *PData;
-        int PrecompLastDepth;
+        std::shared_ptr<const PRECOMP_PAR_DATA> PData;
 };
 
 /// @}
@@ -37,8 +37,10 @@
 #include "core/shape/plane.h"
 
 // C++ variants of C standard header files
+#include <cmath>
+
 // C++ standard header files
-//  (none at the moment)
+#include <algorithm>
 
 // POV-Ray header files (base module)
 //  (none at the moment)
@@ -141,7 +143,7 @@ bool Plane::Intersect(const BasicRay& ray, DBL *Depth, RenderStatistics& stats)
     DBL NormalDotOrigin, NormalDotDirection;
     Vector3d P, D;
 
-    stats[Ray_Plane_Tests]++;
+    stats.Shape(Ray_Plane_Tests)++;
 
     if (Trans == nullptr)
     {
@@ -173,7 +175,7 @@ bool Plane::Intersect(const BasicRay& ray, DBL *Depth, RenderStatistics& stats)
 
     if ((*Depth >= DEPTH_TOLERANCE) && (*Depth <= MAX_DISTANCE))
     {
-        stats[Ray_Plane_Tests_Succeeded]++;
+        stats.Shape(Ray_Plane_Tests_Succeeded)++;
         return (true);
     }
     else
@@ -631,5 +633,114 @@ bool Plane::Intersect_BBox(BBoxDirection, const BBoxVector3d&, const BBoxVector3
     return true;
 }
 
+//******************************************************************************
+
+const size_t PlaneSet::kBlockSize;
+
+PlaneSet* PlaneSet::Create(std::vector<ObjectPtr>::iterator first, std::vector<ObjectPtr>::iterator last)
+{
+    std::vector<ObjectPtr>::iterator end = std::stable_partition(first, last, IsEligible);
+    if (end == first)
+        return nullptr;
+
+    PlaneSet *set = new PlaneSet();
+    size_t count = end - first;
+    set->mNormalX.reserve(count);
+    set->mNormalY.reserve(count);
+    set->mNormalZ.reserve(count);
+    set->mDistance.reserve(count);
+    set->mObjects.reserve(count);
+    for (std::vector<ObjectPtr>::iterator it = first; it != end; ++it)
+    {
+        const Plane *plane = static_cast<const Plane *>(*it);
+        set->mNormalX.push_back(plane->Normal_Vector[X]);
+        set->mNormalY.push_back(plane->Normal_Vector[Y]);
+        set->mNormalZ.push_back(plane->Normal_Vector[Z]);
+        set->mDistance.push_back(plane->Distance);
+        set->mObjects.push_back(*it);
+    }
+    return set;
+}
+
+bool PlaneSet::IsEligible(ConstObjectPtr object)
+{
+    const Plane *plane = dynamic_cast<const Plane *>(object);
+    return (plane != nullptr) && (plane->Trans == nullptr) && plane->Clip.empty() && plane->Bound.empty();
+}
+
+// This must give the same depths as Plane::Intersect(); it is written without branches so that
+// the compiler can vectorize it.
+void PlaneSet::ComputeDepths(const BasicRay& ray, DBL minDepth, size_t first, size_t count, DBL *depths, RenderStatistics& stats) const
+{
+    const DBL *nx = &mNormalX[first];
+    const DBL *ny = &mNormalY[first];
+    const DBL *nz = &mNormalZ[first];
+    const DBL *dist = &mDistance[first];
+    const DBL ox = ray.Origin[X], oy = ray.Origin[Y], oz = ray.Origin[Z];
+    const DBL dx = ray.Direction[X], dy = ray.Direction[Y], dz = ray.Direction[Z];
+    unsigned int hits = 0;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        DBL normalDotDirection = nx[i] * dx + ny[i] * dy + nz[i] * dz;
+        DBL normalDotOrigin    = nx[i] * ox + ny[i] * oy + nz[i] * oz;
+        DBL depth = -(normalDotOrigin + dist[i]) / normalDotDirection;
+        bool hit = (std::fabs(normalDotDirection) >= EPSILON) & (depth >= DEPTH_TOLERANCE) & (depth <= MAX_DISTANCE);
+        hits += hit;
+        depths[i] = (hit & (depth > minDepth)) ? depth : HUGE_VAL;
+    }
+
+    stats.Shape(Ray_Plane_Tests) += count;
+    stats.Shape(Ray_Plane_Tests_Succeeded) += hits;
+}
+
+int PlaneSet::FindClosest(const BasicRay& ray, DBL minDepth, DBL& depth, RenderStatistics& stats) const
+{
+    DBL depths[kBlockSize];
+    int best = -1;
+
+    for (size_t first = 0; first < mObjects.size(); first += kBlockSize)
+    {
+        size_t count = std::min(kBlockSize, mObjects.size() - first);
+        ComputeDepths(ray, minDepth, first, count, depths, stats);
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (depths[i] < depth)
+            {
+                depth = depths[i];
+                best = int(first + i);
+            }
+        }
+    }
+
+    return best;
+}
+
+int PlaneSet::FindClosest(const Ray& ray, DBL minDepth, DBL& depth,
+                          const RayObjectCondition& precondition, const RayObjectCondition& postcondition,
+                          RenderStatistics& stats) const
+{
+    DBL depths[kBlockSize];
+    int best = -1;
+
+    for (size_t first = 0; first < mObjects.size(); first += kBlockSize)
+    {
+        size_t count = std::min(kBlockSize, mObjects.size() - first);
+        ComputeDepths(ray, minDepth, first, count, depths, stats);
+        for (size_t i = 0; i < count; ++i)
+        {
+            if ((depths[i] < depth) &&
+                precondition(ray, mObjects[first + i], 0.0) &&
+                postcondition(ray, mObjects[first + i], depths[i]))
+            {
+                depth = depths[i];
+                best = int(first + i);
+            }
+        }
+    }
+
+    return best;
+}
+
 }
 // end of namespace pov
@@ -40,9 +40,11 @@
 #include "core/configcore.h"
 
 // C++ variants of C standard header files
-// C++ standard header files
 //  (none at the moment)
 
+// C++ standard header files
+#include <vector>
+
 // POV-Ray header files (base module)
 //  (none at the moment)
 
@@ -96,6 +98,86 @@ class Plane final : public ObjectBase
         bool Intersect(const BasicRay& ray, DBL *Depth, RenderStatistics& stats) const;
 };
 
+/// Compact set of infinite planes, to be tested against a ray all at once.
+///
+/// Scenes often have a ground plane, sky plane or a few walls among their infinite objects, which
+/// the hierarchical bounding methods test one by one after traversing the hierarchy, each through
+/// the full generic object interface. This set instead keeps the plane equations in separate
+/// arrays (one per component) so that all planes can be tested in a single tight loop the compiler
+/// can vectorize; the closest hit can then be found before traversing the hierarchy, limiting the
+/// distance the traversal has to consider.
+///
+/// Only untransformed, unclipped and unbounded planes are eligible, as for these the plain
+/// ray-plane test gives the exact same result as @ref Plane::All_Intersections().
+///
+class PlaneSet final
+{
+    public:
+
+        /// Maximum number of planes tested per call to @ref ComputeDepths().
+        static const size_t kBlockSize = 64;
+
+        /// Collect the eligible planes among a range of objects.
+        ///
+        /// The eligible planes are moved to the front of the range, keeping the order of all
+        /// objects otherwise.
+        ///
+        /// @return     The set, or `nullptr` if there are no eligible planes.
+        ///
+        static PlaneSet* Create(std::vector<ObjectPtr>::iterator first, std::vector<ObjectPtr>::iterator last);
+
+        /// Test whether a plane can be included in a set.
+        static bool IsEligible(ConstObjectPtr object);
+
+        size_t size() const { return mObjects.size(); }
+        ObjectPtr GetObject(size_t i) const { return mObjects[i]; }
+
+        /// Compute the depths at which a ray hits a block of planes.
+        ///
+        /// @param[in]  ray         Ray to test.
+        /// @param[in]  minDepth    Depth a hit must be beyond (in addition to the usual tolerance).
+        /// @param[in]  first       Index of the first plane to test.
+        /// @param[in]  count       Number of planes to test (at most @ref kBlockSize).
+        /// @param[out] depths      Depth of each plane's hit, or `HUGE_VAL` if the plane is missed.
+        /// @param[in]  stats       Statistics to update.
+        ///
+        void ComputeDepths(const BasicRay& ray, DBL minDepth, size_t first, size_t count, DBL *depths, RenderStatistics& stats) const;
+
+        /// Find the closest plane hit by a ray.
+        ///
+        /// @param[in]      ray         Ray to test.
+        /// @param[in]      minDepth    Depth a hit must be beyond (in addition to the usual tolerance).
+        /// @param[in,out]  depth       Depth the hit must be closer than; set to the depth of the hit.
+        /// @param[in]      stats       Statistics to update.
+        /// @return                     Index of the plane hit, or -1 if none.
+        ///
+        int FindClosest(const BasicRay& ray, DBL minDepth, DBL& depth, RenderStatistics& stats) const;
+
+        /// Find the closest plane hit by a ray, subject to conditions.
+        ///
+        /// @param[in]      ray             Ray to test.
+        /// @param[in]      minDepth        Depth a hit must be beyond (in addition to the usual tolerance).
+        /// @param[in,out]  depth           Depth the hit must be closer than; set to the depth of the hit.
+        /// @param[in]      precondition    Condition a plane must meet to be considered at all.
+        /// @param[in]      postcondition   Condition a plane's hit must meet.
+        /// @param[in]      stats           Statistics to update.
+        /// @return                         Index of the plane hit, or -1 if none.
+        ///
+        int FindClosest(const Ray& ray, DBL minDepth, DBL& depth,
+                        const RayObjectCondition& precondition, const RayObjectCondition& postcondition,
+                        RenderStatistics& stats) const;
+
+    private:
+
+        std::vector<DBL> mNormalX;
+        std::vector<DBL> mNormalY;
+        std::vector<DBL> mNormalZ;
+        std::vector<DBL> mDistance;
+        std::vector<ObjectPtr> mObjects;
+
+        PlaneSet() = default;
+};
+
 /// @}
 ///
 //##############################################################################
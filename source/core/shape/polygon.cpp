@@ -66,6 +66,7 @@
 
 // C++ standard header files
 #include <algorithm>
+#include <vector>
 
 // POV-Ray header files (base module)
 #include "base/pov_err.h"
@@ -92,6 +93,9 @@ const DBL DEPTH_TOLERANCE = 1.0e-8;
 /* If |x| < ZERO_TOLERANCE x is assumed to be 0. */
 const DBL ZERO_TOLERANCE = 1.0e-10;
 
+/* Minimum number of points to index the edges of a polygon for. */
+const int EDGE_BANDS_THRESHOLD = 32;
+
 
 
 /*****************************************************************************
@@ -194,7 +198,7 @@ bool Polygon::Intersect(const BasicRay& ray, DBL *Depth, RenderStatistics& stats
     if (Test_Flag(this, DEGENERATE_FLAG))
         return(false);
 
-    stats[Ray_Polygon_Tests]++;
+    stats.Shape(Ray_Polygon_Tests)++;
 
     /* Transform the ray into the polygon space. */
 
@@ -221,9 +225,9 @@ bool Polygon::Intersect(const BasicRay& ray, DBL *Depth, RenderStatistics& stats
     x = p[X] + *Depth * d[X];
     y = p[Y] + *Depth * d[Y];
 
-    if (in_polygon(Data->Number, Data->Points, x, y))
+    if ((Data->EdgeBands != nullptr) ? in_polygon(Data, x, y) : in_polygon(Data->Number, Data->Points, x, y))
     {
-        stats[Ray_Polygon_Tests_Succeeded]++;
+        stats.Shape(Ray_Polygon_Tests_Succeeded)++;
 
         *Depth /= len;
 
@@ -601,6 +605,8 @@ Polygon::~Polygon()
         {
             if (Data->Points != nullptr)
                 delete[] Data->Points;
+            delete[] Data->Edges;
+            delete Data->EdgeBands;
             delete Data;
         }
     }
@@ -661,6 +667,10 @@ void Polygon::Compute_Polygon(int number, Vector3d *points)
         Data->Number = number;
 
         Data->Points = new Vector2d[number];
+
+        Data->Edges = nullptr;
+
+        Data->EdgeBands = nullptr;
     }
     else
     {
@@ -767,11 +777,89 @@ void Polygon::Compute_Polygon(int number, Vector3d *points)
 
     S_Normal.normalize();
 
+    if (number >= EDGE_BANDS_THRESHOLD)
+    {
+        Compute_Edge_Bands(Data);
+    }
+
     Compute_BBox();
 }
 
 
 
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Compute_Edge_Bands
+*
+* INPUT
+*
+*   data - Polygon data with 2d points
+*
+* OUTPUT
+*
+*   data
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Collect the edges that in_polygon() walks, skipping those joining
+*   consecutive sub-polygons, and index them by their y range. A point
+*   test then only needs to look at the edges that may straddle the
+*   point's y coordinate.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+void Polygon::Compute_Edge_Bands(POLYGON_DATA *data)
+{
+    int i, n, first;
+    const Vector2d *points = data->Points;
+
+    data->Edges = new int[data->Number];
+
+    std::vector<DBL> lo, hi;
+
+    lo.reserve(data->Number);
+    hi.reserve(data->Number);
+
+    /* Mirror the way in_polygon() moves from one edge to the next. */
+
+    n = 0;
+
+    first = 0;
+
+    for (i = 1; i < data->Number; )
+    {
+        data->Edges[n++] = i - 1;
+
+        lo.push_back(std::min(points[i - 1][Y], points[i][Y]));
+        hi.push_back(std::max(points[i - 1][Y], points[i][Y]));
+
+        if ((i < data->Number - 2) && (points[i][X] == points[first][X]) && (points[i][Y] == points[first][Y]))
+        {
+            first = i + 1;
+
+            i += 2;
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    data->EdgeBands = new BandIndex(lo.data(), hi.data(), n);
+}
+
+
+
 /*****************************************************************************
 *
 * FUNCTION
@@ -980,5 +1068,71 @@ bool Polygon::in_polygon(int number, Vector2d *points, DBL u, DBL  v)
     return(inside_flag);
 }
 
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   in_polygon
+*
+* INPUT
+*
+*   data   - Polygon data with indexed edges
+*   u, v   - 2D-coordinates of the point to test
+*
+* OUTPUT
+*
+* RETURNS
+*
+*   bool - true, if inside
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Same as the crossings test above, but only looking at the edges
+*   whose y range may contain the point's y coordinate, as listed by
+*   the polygon's edge index. Edges that don't straddle the test ray
+*   never change the result, so the outcome is the same.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+bool Polygon::in_polygon(const POLYGON_DATA *data, DBL u, DBL v)
+{
+    bool yflag0, yflag1;
+    bool inside_flag;
+    const unsigned int *item, *end;
+    const DBL *vtx0, *vtx1;
+
+    inside_flag = false;
+
+    if (!data->EdgeBands->Find(v, item, end))
+        return(inside_flag);
+
+    for (; item != end; item++)
+    {
+        vtx0 = &data->Points[data->Edges[*item]][X];
+        vtx1 = &data->Points[data->Edges[*item] + 1][X];
+
+        yflag0 = (vtx0[Y] >= v);
+        yflag1 = (vtx1[Y] >= v);
+
+        if (yflag0 != yflag1)
+        {
+            if (((vtx1[Y]-v) * (vtx0[X]-vtx1[X]) >= (vtx1[X]-u) * (vtx0[Y]-vtx1[Y])) == yflag1)
+            {
+                inside_flag = !inside_flag;
+            }
+        }
+    }
+
+    return(inside_flag);
+}
+
 }
 // end of namespace pov
@@ -47,6 +47,7 @@
 //  (none at the moment)
 
 // POV-Ray header files (core module)
+#include "core/bounding/bandindex.h"
 #include "core/scene/object.h"
 
 namespace pov
@@ -80,6 +81,8 @@ struct Polygon_Data_Struct final
     int References;
     int Number;
     Vector2d *Points;
+    int *Edges;           /* First points of the edges tested, or nullptr for few points. */
+    BandIndex *EdgeBands; /* Edges by y range, or nullptr for few points.                 */
 };
 using POLYGON_DATA = Polygon_Data_Struct; ///< @deprecated
 
@@ -108,6 +111,8 @@ class Polygon final : public NonsolidObject
     protected:
         bool Intersect(const BasicRay& ray, DBL *Depth, RenderStatistics& stats) const;
         static bool in_polygon(int number, Vector2d *points, DBL u, DBL  v);
+        static bool in_polygon(const POLYGON_DATA *data, DBL u, DBL v);
+        static void Compute_Edge_Bands(POLYGON_DATA *data);
 };
 
 /// @}
@@ -186,7 +186,7 @@ bool Polyline::Intersect(const BasicRay& ray, DBL *Depth, TraceThreadData *Threa
     if (Test_Flag(this, DEGENERATE_FLAG))
         return(false);
 
-    Thread->Stats()[Ray_Polyline_Tests]++;
+    Thread->Stats().Shape(Ray_Polyline_Tests)++;
 
     /* Transform the ray into the polyline space. */
 
@@ -215,7 +215,7 @@ bool Polyline::Intersect(const BasicRay& ray, DBL *Depth, TraceThreadData *Threa
 
     if (in_polyline(x, y))
     {
-        Thread->Stats()[Ray_Polyline_Tests_Succeeded]++;
+        Thread->Stats().Shape(Ray_Polyline_Tests_Succeeded)++;
 
         *Depth /= len;
 
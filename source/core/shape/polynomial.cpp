@@ -225,7 +225,7 @@ bool Poly::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThreadDat
 
     Intersection_Found = false;
 
-    Thread->Stats()[Ray_Poly_Tests]++;
+    Thread->Stats().Shape(Ray_Poly_Tests)++;
 
     switch (Order)
     {
@@ -248,7 +248,7 @@ bool Poly::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThreadDat
 
     if (cnt > 0)
     {
-        Thread->Stats()[Ray_Poly_Tests_Succeeded]++;
+        Thread->Stats().Shape(Ray_Poly_Tests_Succeeded)++;
     }
 
     for (i = 0; i < cnt; i++)
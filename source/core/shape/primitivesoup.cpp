@@ -0,0 +1,1080 @@
+//******************************************************************************
+///
+/// @file core/shape/primitivesoup.cpp
+///
+/// Implementation of the primitive soup geometric primitive.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+// Unit header file must be the first file included within POV-Ray *.cpp files (pulls in config)
+#include "core/shape/primitivesoup.h"
+
+// C++ variants of C standard header files
+//  (none at the moment)
+
+// C++ standard header files
+#include <algorithm>
+
+// POV-Ray header files (base module)
+//  (none at the moment)
+
+// POV-Ray header files (core module)
+#include "core/bounding/boundingbox.h"
+#include "core/math/matrix.h"
+#include "core/render/ray.h"
+#include "core/scene/tracethreaddata.h"
+#include "core/shape/box.h"
+#include "core/shape/sphere.h"
+
+// this must be the last file included
+#include "base/povdebug.h"
+
+namespace pov
+{
+
+using std::min;
+using std::max;
+using std::vector;
+
+/*****************************************************************************
+* Local preprocessor defines
+******************************************************************************/
+
+/* Minimal intersection depth. */
+
+const DBL DEPTH_TOLERANCE = 1.0e-6;
+
+/// Number of children per node of a primitive soup's bounding volume hierarchy.
+const unsigned int SOUP_BVH_WIDTH = 4;
+
+/// Desired number of elements per leaf of a primitive soup's bounding volume hierarchy.
+const unsigned int SOUP_BVH_LEAF_ELEMENTS = 4;
+
+/// Number of elements tested against a ray at once.
+const unsigned int SOUP_BVH_BATCH = 4;
+
+/// Tolerance of the batched bounding sphere test, relative to the squared radius.
+const DBL SOUP_BVH_TOLERANCE = 1e-4;
+
+/// Parts of a cylinder, as recorded in the intersections.
+enum SoupCylinderPart
+{
+    kCylinderSide = 0,
+    kCylinderBase = 1,
+    kCylinderApex = 2,
+};
+
+
+
+/*****************************************************************************
+* Local typedefs
+******************************************************************************/
+
+/// Element bounds as seen by the tree building code.
+class PrimitiveSoupObjects final : public BSPTree::Objects
+{
+    public:
+
+        PrimitiveSoupObjects(const PrimitiveSoupData& d)
+        {
+            for (unsigned int axis = 0; axis < 3; axis++)
+            {
+                lo[axis].resize(d.size());
+                hi[axis].resize(d.size());
+            }
+            for (unsigned int i = 0; i < d.size(); i++)
+            {
+                Vector3d pmin, pmax;
+                d.GetBounds(i, pmin, pmax);
+                for (unsigned int axis = 0; axis < 3; axis++)
+                {
+                    lo[axis][i] = float(pmin[axis]);
+                    hi[axis][i] = float(pmax[axis]);
+                }
+            }
+        }
+
+        virtual ~PrimitiveSoupObjects() override { }
+
+        virtual unsigned int size() const override { return (unsigned int)lo[X].size(); }
+        virtual float GetMin(unsigned int axis, unsigned int i) const override { return lo[axis][i]; }
+        virtual float GetMax(unsigned int axis, unsigned int i) const override { return hi[axis][i]; }
+
+    private:
+
+        vector<float> lo[3];
+        vector<float> hi[3];
+};
+
+/// Progress callback for building a primitive soup's bounding volume hierarchy.
+class PrimitiveSoupNoProgress final : public BSPTree::Progress
+{
+    public:
+
+        virtual void operator()(unsigned int) const override { }
+};
+
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Filter_Soup_Elements
+*
+* INPUT
+*
+*   Data  - Primitive soup geometry
+*   first - Position of first element
+*   count - Number of elements to test (at most SOUP_BVH_BATCH)
+*   ray   - Ray in soup space, with normalized direction
+*
+* OUTPUT
+*
+* RETURNS
+*
+*   unsigned int - Bit mask of the elements that may be hit
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Rule out elements that are clearly missed by a ray, by testing the ray
+*   against their bounding spheres. For spheres this is the exact test,
+*   save for a small tolerance; elements lying entirely behind the ray
+*   origin are ruled out as well.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+static unsigned int Filter_Soup_Elements(const PrimitiveSoupData& Data, unsigned int first, unsigned int count, const BasicRay& ray)
+{
+    const float *C[3], *V[3];
+    bool candidate[SOUP_BVH_BATCH];
+    unsigned int mask = 0;
+
+    for (unsigned int axis = 0; axis < 3; axis++)
+    {
+        C[axis] = Data.center[axis].data() + first;
+        V[axis] = Data.vector[axis].data() + first;
+    }
+    const float *R = Data.radius.data() + first;
+
+    const DBL ox = ray.Origin[X], oy = ray.Origin[Y], oz = ray.Origin[Z];
+    const DBL dx = ray.Direction[X], dy = ray.Direction[Y], dz = ray.Direction[Z];
+
+    // Always test a full batch of bounding spheres, as Filter_Mesh_Triangles() in mesh.cpp does
+    // for triangles. Slots beyond `count` hold the next leaf's elements or the zero padding at
+    // the end of the arrays; their results are ignored below.
+    for (unsigned int i = 0; i < SOUP_BVH_BATCH; i++)
+    {
+        DBL ocx = DBL(C[X][i]) - ox;
+        DBL ocy = DBL(C[Y][i]) - oy;
+        DBL ocz = DBL(C[Z][i]) - oz;
+        DBL vx = DBL(V[X][i]), vy = DBL(V[Y][i]), vz = DBL(V[Z][i]);
+        DBL r = DBL(R[i]);
+
+        // the bounding sphere radius is exact for all three kinds of elements
+        DBL r2 = (vx * vx + vy * vy + vz * vz + r * r) * (1.0 + SOUP_BVH_TOLERANCE);
+        DBL tca = ocx * dx + ocy * dy + ocz * dz;
+        DBL d2 = ocx * ocx + ocy * ocy + ocz * ocz - tca * tca;
+
+        candidate[i] = (d2 <= r2) && ((tca >= 0.0) || (tca * tca <= r2));
+    }
+
+    for (unsigned int i = 0; i < count; i++)
+        if (candidate[i])
+            mask |= (1u << i);
+
+    return mask;
+}
+
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   PrimitiveSoupData::Add
+*
+* INPUT
+*
+*   k - Kind of element
+*   c - Centre
+*   v - Half extents or half axis
+*   r - Radius
+*
+* OUTPUT
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Append an element to the (not yet re-ordered) arrays.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+void PrimitiveSoupData::Add(Kind k, const Vector3d& c, const Vector3d& v, DBL r)
+{
+    kind.push_back(k);
+    for (unsigned int axis = 0; axis < 3; axis++)
+    {
+        center[axis].push_back(float(c[axis]));
+        vector[axis].push_back(float(v[axis]));
+    }
+    radius.push_back(float(r));
+}
+
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   PrimitiveSoupData::GetBounds
+*
+* INPUT
+*
+*   i - Position of element
+*
+* OUTPUT
+*
+*   lo, hi - Bounding box of the element
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   -
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+void PrimitiveSoupData::GetBounds(unsigned int i, Vector3d& lo, Vector3d& hi) const
+{
+    Vector3d c(center[X][i], center[Y][i], center[Z][i]);
+    Vector3d v(vector[X][i], vector[Y][i], vector[Z][i]);
+    DBL r = radius[i];
+    Vector3d extent;
+
+    switch (kind[i])
+    {
+        case kSphere:
+            extent = Vector3d(r);
+            break;
+
+        case kBox:
+            extent = Vector3d(fabs(v[X]), fabs(v[Y]), fabs(v[Z]));
+            break;
+
+        default:
+        {
+            // the caps stick out from the axis by the radius, scaled by the sine of their tilt
+            DBL len2 = v.lengthSqr();
+            for (unsigned int axis = 0; axis < 3; axis++)
+                extent[axis] = fabs(v[axis]) + r * sqrt(max(0.0, 1.0 - ((len2 > 0.0) ? Sqr(v[axis]) / len2 : 0.0)));
+            break;
+        }
+    }
+
+    lo = c - extent;
+    hi = c + extent;
+}
+
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   PrimitiveSoupData::Build
+*
+* INPUT
+*
+* OUTPUT
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Build the bounding hierarchy and store the elements in the order they
+*   are referenced by its leaves, padded for the batched ray test.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+void PrimitiveSoupData::Build()
+{
+    BVHTree::Statistics stats;
+
+    tree.reset(BVHTree::Create(SOUP_BVH_WIDTH, SOUP_BVH_LEAF_ELEMENTS));
+    tree->build(PrimitiveSoupNoProgress(), PrimitiveSoupObjects(*this), stats);
+
+    const std::vector<unsigned int>& list = tree->GetObjectList();
+    const size_t padded = list.size() + SOUP_BVH_BATCH - 1;
+
+    std::vector<unsigned char> newKind(list.size());
+    for (size_t i = 0; i < list.size(); i++)
+        newKind[i] = kind[list[i]];
+    kind.swap(newKind);
+
+    std::vector<float> newValues(padded, 0.0f);
+    for (unsigned int axis = 0; axis < 3; axis++)
+    {
+        for (size_t i = 0; i < list.size(); i++)
+            newValues[i] = center[axis][list[i]];
+        center[axis].swap(newValues);
+        newValues.assign(padded, 0.0f);
+
+        for (size_t i = 0; i < list.size(); i++)
+            newValues[i] = vector[axis][list[i]];
+        vector[axis].swap(newValues);
+        newValues.assign(padded, 0.0f);
+    }
+    for (size_t i = 0; i < list.size(); i++)
+        newValues[i] = radius[list[i]];
+    radius.swap(newValues);
+
+    memory.Set(kind.size() * sizeof(unsigned char) + padded * 7 * sizeof(float));
+}
+
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   PrimitiveSoup::Intersect_Element
+*
+* INPUT
+*
+*   ray - Ray in soup space, with normalized direction
+*   i   - Position of element
+*
+* OUTPUT
+*
+*   Depth - Distances of the intersections
+*   Part  - Part of the element hit at each intersection
+*
+* RETURNS
+*
+*   unsigned int - Number of intersections found
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Spheres and boxes use the tests of the respective objects; cylinders
+*   are intersected with the infinite cylinder around their axis and the
+*   planes of their caps.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+unsigned int PrimitiveSoup::Intersect_Element(const BasicRay& ray, unsigned int i, DBL Depth[2], int Part[2]) const
+{
+    const PrimitiveSoupData& D = *Data;
+    Vector3d c(D.center[X][i], D.center[Y][i], D.center[Z][i]);
+    Vector3d v(D.vector[X][i], D.vector[Y][i], D.vector[Z][i]);
+    DBL r = D.radius[i];
+
+    switch (D.kind[i])
+    {
+        case PrimitiveSoupData::kSphere:
+            Part[0] = Part[1] = 0;
+            return (Sphere::Intersect(ray, c, Sqr(r), &Depth[0], &Depth[1]) ? 2 : 0);
+
+        case PrimitiveSoupData::kBox:
+            return (Box::Intersect(ray, nullptr, c - v, c + v, &Depth[0], &Depth[1], &Part[0], &Part[1]) ? 2 : 0);
+
+        default:
+        {
+            unsigned int n = 0;
+            DBL h = v.length();
+            if (h == 0.0)
+                return 0;
+            Vector3d u = v / h;
+            Vector3d o = ray.Origin - c;
+            DBL ou = dot(o, u);
+            DBL du = dot(ray.Direction, u);
+            Vector3d op = o - ou * u;
+            Vector3d dp = ray.Direction - du * u;
+
+            DBL a = dp.lengthSqr();
+            if (a > EPSILON)
+            {
+                DBL b = dot(op, dp);
+                DBL disc = Sqr(b) - a * (op.lengthSqr() - Sqr(r));
+                if (disc >= 0.0)
+                {
+                    DBL s = sqrt(disc);
+                    DBL t[2] = { (-b - s) / a, (-b + s) / a };
+                    for (unsigned int k = 0; k < 2; k++)
+                    {
+                        if (fabs(ou + t[k] * du) <= h)
+                        {
+                            Depth[n] = t[k];
+                            Part[n] = kCylinderSide;
+                            n++;
+                        }
+                    }
+                }
+            }
+
+            if ((D.kind[i] == PrimitiveSoupData::kCylinder) && (fabs(du) > EPSILON))
+            {
+                for (unsigned int k = 0; (k < 2) && (n < 2); k++)
+                {
+                    DBL t = ((k == 0 ? -h : h) - ou) / du;
+                    if ((op + t * dp).lengthSqr() <= Sqr(r))
+                    {
+                        Depth[n] = t;
+                        Part[n] = (k == 0 ? kCylinderBase : kCylinderApex);
+                        n++;
+                    }
+                }
+            }
+
+            return n;
+        }
+    }
+}
+
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   PrimitiveSoup::Inside_Element
+*
+* INPUT
+*
+*   point - Point in soup space
+*   i     - Position of element
+*
+* OUTPUT
+*
+* RETURNS
+*
+*   bool - true if the point is inside the element
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   -
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+bool PrimitiveSoup::Inside_Element(const Vector3d& point, unsigned int i) const
+{
+    const PrimitiveSoupData& D = *Data;
+    Vector3d p = point - Vector3d(D.center[X][i], D.center[Y][i], D.center[Z][i]);
+    Vector3d v(D.vector[X][i], D.vector[Y][i], D.vector[Z][i]);
+    DBL r = D.radius[i];
+
+    switch (D.kind[i])
+    {
+        case PrimitiveSoupData::kSphere:
+            return (p.lengthSqr() < Sqr(r));
+
+        case PrimitiveSoupData::kBox:
+            return ((fabs(p[X]) < v[X]) && (fabs(p[Y]) < v[Y]) && (fabs(p[Z]) < v[Z]));
+
+        default:
+        {
+            DBL h = v.length();
+            if (h == 0.0)
+                return false;
+            Vector3d u = v / h;
+            DBL along = dot(p, u);
+            return ((fabs(along) < h) && ((p - along * u).lengthSqr() < Sqr(r)));
+        }
+    }
+}
+
+
+
+/// Leaf functor to intersect a ray with the elements of a primitive soup.
+class PrimitiveSoup::BVHIntersect final : public BVHTree::LeafIntersect
+{
+    public:
+
+        BVHIntersect(PrimitiveSoup& s, const BasicRay& r, const BasicRay& o, DBL l, IStack& ds, TraceThreadData *t) :
+            soup(s), ray(r), origRay(o), len(l), depthStack(ds), thread(t), found(false)
+        {}
+
+        virtual void operator()(unsigned int first, unsigned int count, double&) override
+        {
+            const PrimitiveSoupData& Data = *soup.Data;
+            DBL Depth[2];
+            int Part[2];
+            Vector3d IPoint;
+
+            for (unsigned int batch = first, end = first + count; batch < end; batch += SOUP_BVH_BATCH)
+            {
+                unsigned int mask = Filter_Soup_Elements(Data, batch, min(end - batch, SOUP_BVH_BATCH), ray);
+
+                for (unsigned int i = batch; mask != 0; i++, mask >>= 1)
+                {
+                    if ((mask & 1) == 0)
+                        continue;
+
+                    unsigned int n = soup.Intersect_Element(ray, i, Depth, Part);
+
+                    for (unsigned int k = 0; k < n; k++)
+                    {
+                        if ((Depth[k] <= DEPTH_TOLERANCE) || (Depth[k] >= MAX_DISTANCE))
+                            continue;
+
+                        // the elements are solid, so all intersections are needed for use with CSG
+                        IPoint = origRay.Evaluate(Depth[k] / len);
+
+                        if (soup.Clip.empty() || Point_In_Clip(IPoint, soup.Clip, thread))
+                        {
+                            depthStack->push(Intersection(Depth[k] / len, IPoint, &soup, int(i), Part[k]));
+                            found = true;
+                        }
+                    }
+                }
+            }
+        }
+
+        virtual bool operator()() const override { return found; }
+
+    private:
+
+        PrimitiveSoup& soup;
+        const BasicRay& ray;
+        const BasicRay& origRay;
+        DBL len;
+        IStack& depthStack;
+        TraceThreadData *thread;
+        bool found;
+};
+
+/// Leaf functor to test whether a point is inside any of the elements of a primitive soup.
+class PrimitiveSoup::BVHInside final : public BVHTree::LeafIntersect
+{
+    public:
+
+        BVHInside(const PrimitiveSoup& s, const Vector3d& p) : soup(s), point(p), found(false) {}
+
+        virtual void operator()(unsigned int first, unsigned int count, double&) override
+        {
+            for (unsigned int i = first, end = first + count; (i < end) && !found; i++)
+                found = soup.Inside_Element(point, i);
+        }
+
+        virtual bool operator()() const override { return found; }
+
+    private:
+
+        const PrimitiveSoup& soup;
+        const Vector3d& point;
+        bool found;
+};
+
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   All_Primitive_Soup_Intersections
+*
+* INPUT
+*
+* OUTPUT
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Transform the ray into soup space and find the intersections with all
+*   elements whose bounds it passes through.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+bool PrimitiveSoup::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThreadData *Thread)
+{
+    DBL len;
+    BasicRay New_Ray;
+
+    if (Trans != nullptr)
+    {
+        MInvTransRay(New_Ray, ray, Trans);
+
+        len = New_Ray.Direction.length();
+        New_Ray.Direction /= len;
+    }
+    else
+    {
+        New_Ray = ray;
+
+        len = 1.0;
+    }
+
+    BVHIntersect isect(*this, New_Ray, ray, len, Depth_Stack, Thread);
+
+    return (*Data->tree)(New_Ray, isect, BOUND_HUGE);
+}
+
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Inside_Primitive_Soup
+*
+* INPUT
+*
+* OUTPUT
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   A point is inside the soup if it is inside any of its elements.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+bool PrimitiveSoup::Inside(const Vector3d& IPoint, TraceThreadData *Thread) const
+{
+    Vector3d New_Point;
+
+    if (Trans != nullptr)
+        MInvTransPoint(New_Point, IPoint, Trans);
+    else
+        New_Point = IPoint;
+
+    BVHInside inside(*this, New_Point);
+
+    bool Result = (*Data->tree)(New_Point, inside, true);
+
+    return (Result != Test_Flag(this, INVERTED_FLAG));
+}
+
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Primitive_Soup_Normal
+*
+* INPUT
+*
+* OUTPUT
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Compute the normal of the element and part recorded in the intersection.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+void PrimitiveSoup::Normal(Vector3d& Result, Intersection *Inter, TraceThreadData *Thread) const
+{
+    const PrimitiveSoupData& D = *Data;
+    unsigned int i = (unsigned int)Inter->i1;
+    Vector3d P;
+
+    if (Trans != nullptr)
+        MInvTransPoint(P, Inter->IPoint, Trans);
+    else
+        P = Inter->IPoint;
+
+    P -= Vector3d(D.center[X][i], D.center[Y][i], D.center[Z][i]);
+    Vector3d v(D.vector[X][i], D.vector[Y][i], D.vector[Z][i]);
+
+    switch (D.kind[i])
+    {
+        case PrimitiveSoupData::kSphere:
+            Result = P;
+            break;
+
+        case PrimitiveSoupData::kBox:
+            switch (Inter->i2)
+            {
+                case Box::kSideHit_X0: Result = Vector3d(-1.0,  0.0,  0.0); break;
+                case Box::kSideHit_X1: Result = Vector3d( 1.0,  0.0,  0.0); break;
+                case Box::kSideHit_Y0: Result = Vector3d( 0.0, -1.0,  0.0); break;
+                case Box::kSideHit_Y1: Result = Vector3d( 0.0,  1.0,  0.0); break;
+                case Box::kSideHit_Z0: Result = Vector3d( 0.0,  0.0, -1.0); break;
+                case Box::kSideHit_Z1: Result = Vector3d( 0.0,  0.0,  1.0); break;
+
+                default: throw POV_EXCEPTION_STRING("Unknown box side in Primitive_Soup_Normal().");
+            }
+            break;
+
+        default:
+        {
+            Vector3d u = v.normalized();
+            switch (Inter->i2)
+            {
+                case kCylinderBase: Result = -u; break;
+                case kCylinderApex: Result = u; break;
+                default:            Result = P - dot(P, u) * u; break;
+            }
+            break;
+        }
+    }
+
+    if (Trans != nullptr)
+        MTransNormal(Result, Result, Trans);
+
+    Result.normalize();
+}
+
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Translate_Primitive_Soup
+*
+* INPUT
+*
+* OUTPUT
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   -
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+void PrimitiveSoup::Translate(const Vector3d&, const TRANSFORM *tr)
+{
+    Transform(tr);
+}
+
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Rotate_Primitive_Soup
+*
+* INPUT
+*
+* OUTPUT
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   -
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+void PrimitiveSoup::Rotate(const Vector3d&, const TRANSFORM *tr)
+{
+    Transform(tr);
+}
+
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Scale_Primitive_Soup
+*
+* INPUT
+*
+* OUTPUT
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   -
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+void PrimitiveSoup::Scale(const Vector3d&, const TRANSFORM *tr)
+{
+    Transform(tr);
+}
+
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Transform_Primitive_Soup
+*
+* INPUT
+*
+* OUTPUT
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   The elements themselves are never transformed, so that copies can keep
+*   sharing them.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+void PrimitiveSoup::Transform(const TRANSFORM *tr)
+{
+    if (Trans == nullptr)
+        Trans = Create_Transform();
+
+    Recompute_BBox(&BBox, tr);
+
+    Compose_Transforms(Trans, tr);
+}
+
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Create_Primitive_Soup
+*
+* INPUT
+*
+* OUTPUT
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   -
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+PrimitiveSoup::PrimitiveSoup() : ObjectBase(PRIMITIVE_SOUP_OBJECT)
+{
+    Trans = nullptr;
+}
+
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Copy_Primitive_Soup
+*
+* INPUT
+*
+* OUTPUT
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   The copy shares the elements with the original.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+ObjectPtr PrimitiveSoup::Copy()
+{
+    PrimitiveSoup *New = new PrimitiveSoup();
+
+    Destroy_Transform(New->Trans);
+    *New = *this;
+    New->Trans = Copy_Transform(Trans);
+
+    return(New);
+}
+
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Destroy_Primitive_Soup
+*
+* INPUT
+*
+* OUTPUT
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   -
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+PrimitiveSoup::~PrimitiveSoup()
+{
+}
+
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Compute_Primitive_Soup_BBox
+*
+* INPUT
+*
+* OUTPUT
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Calculate the bounding box of all elements.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+void PrimitiveSoup::Compute_BBox()
+{
+    Vector3d mins(BOUND_HUGE), maxs(-BOUND_HUGE);
+    Vector3d lo, hi;
+
+    for (unsigned int i = 0; i < Data->size(); i++)
+    {
+        Data->GetBounds(i, lo, hi);
+        for (unsigned int axis = 0; axis < 3; axis++)
+        {
+            mins[axis] = min(mins[axis], lo[axis]);
+            maxs[axis] = max(maxs[axis], hi[axis]);
+        }
+    }
+
+    Make_BBox_from_min_max(BBox, mins, maxs);
+
+    if (Trans != nullptr)
+        Recompute_BBox(&BBox, Trans);
+}
+
+}
+// end of namespace pov
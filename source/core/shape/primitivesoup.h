@@ -0,0 +1,184 @@
+//******************************************************************************
+///
+/// @file core/shape/primitivesoup.h
+///
+/// Declarations related to the primitive soup geometric primitive.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+#ifndef POVRAY_CORE_PRIMITIVESOUP_H
+#define POVRAY_CORE_PRIMITIVESOUP_H
+
+// Module config header file must be the first file included within POV-Ray unit header files
+#include "core/configcore.h"
+
+// C++ variants of C standard header files
+//  (none at the moment)
+
+// C++ standard header files
+#include <memory>
+#include <vector>
+
+// POV-Ray header files (base module)
+#include "base/pov_mem.h"
+
+// POV-Ray header files (core module)
+#include "core/bounding/bvhtree.h"
+#include "core/scene/object.h"
+
+namespace pov
+{
+
+//##############################################################################
+///
+/// @addtogroup PovCoreShape
+///
+/// @{
+
+//******************************************************************************
+///
+/// @name Object Types
+///
+/// @{
+
+#define PRIMITIVE_SOUP_OBJECT (BASIC_OBJECT)
+
+/// @}
+///
+//******************************************************************************
+
+/// Geometry of a primitive soup.
+///
+/// The elements are stored in structure-of-arrays layout, in the order they are referenced
+/// by the leaves of the bounding hierarchy, so that the elements of a leaf occupy a
+/// contiguous range of the arrays and can be tested against a ray in a single tight loop
+/// the compiler is able to vectorize. Every element is described by a centre, a vector and
+/// a radius:
+///
+///   - Spheres have a zero vector.
+///   - Boxes have the half extents as the vector, and a zero radius.
+///   - Cylinders have half the axis, from the centre towards the apex, as the vector.
+///
+/// Copies of a primitive soup share the geometry, which is never modified once built.
+///
+struct PrimitiveSoupData final
+{
+    /// Element kinds.
+    enum Kind : unsigned char
+    {
+        kSphere,
+        kBox,
+        kCylinder,
+        kOpenCylinder,
+    };
+
+    std::vector<unsigned char> kind;    ///< Kind of each element.
+    std::vector<float> center[3];       ///< Centre of each element, by axis.
+    std::vector<float> vector[3];       ///< Half extents or half axis of each element, by axis.
+    std::vector<float> radius;          ///< Radius of each element.
+
+    /// Bounding hierarchy of the elements.
+    std::unique_ptr<BVHTree> tree;
+
+    /// Memory accounted for the arrays.
+    pov_base::MemoryAccount memory;
+
+    PrimitiveSoupData() : memory(pov_base::kMemory_Mesh) {}
+
+    /// Get the number of elements.
+    inline unsigned int size() const { return (unsigned int)kind.size(); }
+
+    /// Add an element; see @ref PrimitiveSoupData for the meaning of the parameters.
+    void Add(Kind k, const Vector3d& c, const Vector3d& v, DBL r);
+
+    /// Build the bounding hierarchy, re-ordering the elements to match it.
+    ///
+    /// @note   This must be called once all elements have been added, and before the
+    ///         geometry is used in any other way.
+    ///
+    void Build();
+
+    /// Get the bounding box of an element.
+    void GetBounds(unsigned int i, Vector3d& lo, Vector3d& hi) const;
+};
+
+/// Large collection of spheres, boxes and cylinders sharing a single texture and interior.
+///
+/// This is intended for particle systems and similar scenes with millions of simple
+/// elements, which would take up hundreds of bytes each as individual objects. Here each
+/// element takes up about 30 bytes, plus its share of the bounding hierarchy.
+///
+class PrimitiveSoup final : public ObjectBase
+{
+    public:
+
+        std::shared_ptr<PrimitiveSoupData> Data;
+
+        PrimitiveSoup();
+        virtual ~PrimitiveSoup() override;
+
+        virtual ObjectPtr Copy() override;
+
+        virtual bool All_Intersections(const Ray&, IStack&, TraceThreadData *) override;
+        virtual bool Inside(const Vector3d&, TraceThreadData *) const override;
+        virtual void Normal(Vector3d&, Intersection *, TraceThreadData *) const override;
+        virtual void Translate(const Vector3d&, const TRANSFORM *) override;
+        virtual void Rotate(const Vector3d&, const TRANSFORM *) override;
+        virtual void Scale(const Vector3d&, const TRANSFORM *) override;
+        virtual void Transform(const TRANSFORM *) override;
+        virtual void Compute_BBox() override;
+
+    protected:
+
+        class BVHIntersect;
+        class BVHInside;
+
+        /// Intersect a ray with a single element.
+        ///
+        /// @param[in]  ray     Ray in soup space, with normalized direction.
+        /// @param[in]  i       Position of the element.
+        /// @param[out] Depth   Distances of the intersections found.
+        /// @param[out] Part    Part of the element hit at each intersection, for @ref Normal().
+        /// @return             Number of intersections found (at most 2).
+        ///
+        unsigned int Intersect_Element(const BasicRay& ray, unsigned int i, DBL Depth[2], int Part[2]) const;
+
+        /// Test whether a point in soup space is inside a single element.
+        bool Inside_Element(const Vector3d& point, unsigned int i) const;
+};
+
+/// @}
+///
+//##############################################################################
+
+}
+// end of namespace pov
+
+#endif // POVRAY_CORE_PRIMITIVESOUP_H
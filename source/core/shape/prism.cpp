@@ -120,6 +120,7 @@
 
 // C++ standard header files
 #include <algorithm>
+#include <vector>
 
 // POV-Ray header files (base module)
 #include "base/pov_err.h"
@@ -155,6 +156,10 @@ const int BASE_HIT   = 1;
 const int CAP_HIT    = 2;
 const int SPLINE_HIT = 3;
 
+/* Minimum number of segments to index the segments of a prism for. */
+
+const int SPLINE_BANDS_THRESHOLD = 16;
+
 
 
 /*****************************************************************************
@@ -208,7 +213,7 @@ bool Prism::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThreadDa
     if (Test_Flag(this, DEGENERATE_FLAG))
         return (false);
 
-    Thread->Stats()[Ray_Prism_Tests]++;
+    Thread->Stats().Shape(Ray_Prism_Tests)++;
 
     /* Transform the ray into the prism space */
     MInvTransPoint(P, ray.Origin, Trans);
@@ -219,7 +224,7 @@ bool Prism::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThreadDa
     /* Test overall bounding rectangle. */
 
 #ifdef PRISM_EXTRA_STATS
-    Thread->Stats()[Prism_Bound_Tests]++;
+    Thread->Stats().Shape(Prism_Bound_Tests)++;
 #endif
 
     if (((D[X] >= 0.0) && (P[X] > x2)) ||
@@ -231,7 +236,7 @@ bool Prism::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThreadDa
     }
 
 #ifdef PRISM_EXTRA_STATS
-    Thread->Stats()[Prism_Bound_Tests_Succeeded]++;
+    Thread->Stats().Shape(Prism_Bound_Tests_Succeeded)++;
 #endif
 
     /* Number of intersections found. */
@@ -313,7 +318,7 @@ bool Prism::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThreadDa
                 for (j = 0; j < Number; j++, Entry++)
                 {
 #ifdef PRISM_EXTRA_STATS
-                    Thread->Stats()[Prism_Bound_Tests]++;
+                    Thread->Stats().Shape(Prism_Bound_Tests)++;
 #endif
                     /* Test spline's bounding rectangle (modified Cohen-Sutherland). */
                     if (((D[X] >= 0.0) && (P[X] > Entry->x2)) ||
@@ -331,7 +336,7 @@ bool Prism::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThreadDa
                         case LINEAR_SPLINE :
 
 #ifdef PRISM_EXTRA_STATS
-                            Thread->Stats()[Prism_Bound_Tests_Succeeded]++;
+                            Thread->Stats().Shape(Prism_Bound_Tests_Succeeded)++;
 #endif
                             /* Solve linear equation. */
 
@@ -344,7 +349,7 @@ bool Prism::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThreadDa
                         case QUADRATIC_SPLINE :
 
 #ifdef PRISM_EXTRA_STATS
-                            Thread->Stats()[Prism_Bound_Tests_Succeeded]++;
+                            Thread->Stats().Shape(Prism_Bound_Tests_Succeeded)++;
 #endif
 
                             /* Solve quadratic equation. */
@@ -361,7 +366,7 @@ bool Prism::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThreadDa
                             if (test_rectangle(P, D, Entry->x1, Entry->y1, Entry->x2, Entry->y2))
                             {
 #ifdef PRISM_EXTRA_STATS
-                                Thread->Stats()[Prism_Bound_Tests_Succeeded]++;
+                                Thread->Stats().Shape(Prism_Bound_Tests_Succeeded)++;
 #endif
 
                                 /* Solve cubic equation. */
@@ -602,7 +607,7 @@ bool Prism::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThreadDa
     }
 
     if (Found)
-        Thread->Stats()[Ray_Prism_Tests_Succeeded]++;
+        Thread->Stats().Shape(Ray_Prism_Tests_Succeeded)++;
     return(Found);
 }
 
@@ -1070,6 +1075,7 @@ Prism::~Prism()
 {
     if (--(Spline->References) == 0)
     {
+        delete Spline->Bands;
         POV_FREE(Spline->Entry);
         POV_FREE(Spline);
     }
@@ -1153,11 +1159,13 @@ void Prism::Compute_BBox()
 
 int Prism::in_curve(DBL u, DBL v, RenderStatistics& stats) const
 {
-    int i, n, NC;
+    int i, n, NC, count;
     DBL k, w;
     DBL x[4];
     DBL y[3];
     PRISM_SPLINE_ENTRY Entry;
+    const unsigned int *item = nullptr;
+    const unsigned int *end = nullptr;
 
     NC = 0;
 
@@ -1166,9 +1174,21 @@ int Prism::in_curve(DBL u, DBL v, RenderStatistics& stats) const
     if ((u >= u1) && (u <= u2) &&
         (v >= v1) && (v <= v2))
     {
-        for (i = 0; i < Number; i++)
+        /* With many segments, only look at those whose v range may contain v. */
+
+        if (Spline->Bands != nullptr)
+        {
+            if (!Spline->Bands->Find(v, item, end))
+                return(0);
+
+            count = end - item;
+        }
+        else
+            count = Number;
+
+        for (i = 0; i < count; i++)
         {
-            Entry = Spline->Entry[i];
+            Entry = Spline->Entry[(item != nullptr) ? item[i] : i];
 
             /* Test if current segment can be hit. */
 
@@ -1391,6 +1411,7 @@ void Prism::Compute_Prism(Vector2d *P, RenderStatistics& stats)
         Spline = reinterpret_cast<PRISM_SPLINE *>(POV_MALLOC(sizeof(PRISM_SPLINE), "spline segments of prism"));
         Spline->References = 1;
         Spline->Entry = reinterpret_cast<PRISM_SPLINE_ENTRY *>(POV_MALLOC(Number*sizeof(PRISM_SPLINE_ENTRY), "spline segments of prism"));
+        Spline->Bands = nullptr;
     }
     else
     {
@@ -1669,6 +1690,21 @@ void Prism::Compute_Prism(Vector2d *P, RenderStatistics& stats)
 
     Number = number_of_splines;
 
+    /* Index the segments by their v range, so in_curve() can skip most of them. */
+
+    if (Number >= SPLINE_BANDS_THRESHOLD)
+    {
+        std::vector<DBL> lo(Number), hi(Number);
+
+        for (i = 0; i < Number; i++)
+        {
+            lo[i] = Spline->Entry[i].v1;
+            hi[i] = Spline->Entry[i].v2;
+        }
+
+        Spline->Bands = new BandIndex(lo.data(), hi.data(), Number);
+    }
+
     /* Set overall bounding rectangle. */
 
     x1 =
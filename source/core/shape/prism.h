@@ -47,6 +47,7 @@
 //  (none at the moment)
 
 // POV-Ray header files (core module)
+#include "core/bounding/bandindex.h"
 #include "core/scene/object.h"
 
 namespace pov
@@ -100,6 +101,7 @@ struct Prism_Spline_Struct final
 {
     int References;
     PRISM_SPLINE_ENTRY *Entry;
+    BandIndex *Bands;    /* Segments by v range, or nullptr for few segments */
 };
 using PRISM_SPLINE = Prism_Spline_Struct; ///< @deprecated
 
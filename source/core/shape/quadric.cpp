@@ -128,10 +128,10 @@ bool Quadric::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThread
 
     Intersection_Found = false;
 
-    Thread->Stats()[Ray_Quadric_Tests]++;
+    Thread->Stats().Shape(Ray_Quadric_Tests)++;
     if (Intersect(ray, &Depth1, &Depth2))
     {
-        Thread->Stats()[Ray_Quadric_Tests_Succeeded]++;
+        Thread->Stats().Shape(Ray_Quadric_Tests_Succeeded)++;
         if ((Depth1 > DEPTH_TOLERANCE) && (Depth1 < MAX_DISTANCE))
         {
             IPoint = ray.Evaluate(Depth1);
@@ -118,7 +118,7 @@ const DBL MAGICAL_CONSTANT  = ( 1.0 - 0.2 );
 
 bool RationalBezierPatch::All_Intersections( const Ray& ray, IStack& Depth_Stack, TraceThreadData* Thread )
 {
-    Thread->Stats()[Ray_Rational_Bezier_Patch_Tests]++;
+    Thread->Stats().Shape(Ray_Rational_Bezier_Patch_Tests)++;
     bool Found = false;
     BasicRay New_Ray;
     Vector2d interval[2];
@@ -160,7 +160,7 @@ bool RationalBezierPatch::All_Intersections( const Ray& ray, IStack& Depth_Stack
 
     if( Found )
     {
-        Thread->Stats()[Ray_Rational_Bezier_Patch_Tests_Succeeded]++;
+        Thread->Stats().Shape(Ray_Rational_Bezier_Patch_Tests_Succeeded)++;
     }
 
     return ( Found );
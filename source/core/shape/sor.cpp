@@ -184,11 +184,11 @@ const int MAX_INTERSECTIONS_PER_SEGMENT = 4;
 
 bool Sor::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThreadData *Thread)
 {
-    Thread->Stats()[Ray_Sor_Tests]++;
+    Thread->Stats().Shape(Ray_Sor_Tests)++;
 
     if (Intersect(ray, Depth_Stack, Thread))
     {
-        Thread->Stats()[Ray_Sor_Tests_Succeeded]++;
+        Thread->Stats().Shape(Ray_Sor_Tests_Succeeded)++;
 
         return(true);
     }
@@ -260,7 +260,7 @@ bool Sor::Intersect(const BasicRay& ray, IStack& Depth_Stack, TraceThreadData *T
     /* Test if ray misses object's bounds. */
 
 #ifdef SOR_EXTRA_STATS
-    Thread->Stats()[Sor_Bound_Tests]++;
+    Thread->Stats().Shape(Sor_Bound_Tests)++;
 #endif
 
     if (((D[Y] >= 0.0) && (P[Y] >  Height2)) ||
@@ -355,13 +355,13 @@ bool Sor::Intersect(const BasicRay& ray, IStack& Depth_Stack, TraceThreadData *T
     {
 #ifdef SOR_EXTRA_STATS
         if (found)
-            Thread->Stats()[Sor_Bound_Tests_Succeeded]++;
+            Thread->Stats().Shape(Sor_Bound_Tests_Succeeded)++;
 #endif
         return(found);
     }
 
 #ifdef SOR_EXTRA_STATS
-    Thread->Stats()[Sor_Bound_Tests_Succeeded]++;
+    Thread->Stats().Shape(Sor_Bound_Tests_Succeeded)++;
 #endif
 
 /* Step through the list of intersections. */
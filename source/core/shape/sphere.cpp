@@ -91,7 +91,7 @@ const DBL DEPTH_TOLERANCE = 1.0e-6;
 
 bool Sphere::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThreadData *Thread)
 {
-    Thread->Stats()[Ray_Sphere_Tests]++;
+    Thread->Stats().Shape(Ray_Sphere_Tests)++;
 
     if(Do_Ellipsoid)
     {
@@ -111,7 +111,7 @@ bool Sphere::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThreadD
 
         if(Intersect(New_Ray, Vector3d(0.0), 1.0, &Depth1, &Depth2))
         {
-            Thread->Stats()[Ray_Sphere_Tests_Succeeded]++;
+            Thread->Stats().Shape(Ray_Sphere_Tests_Succeeded)++;
             if((Depth1 > DEPTH_TOLERANCE) && (Depth1 < MAX_DISTANCE))
             {
                 IPoint = New_Ray.Evaluate(Depth1);
@@ -149,7 +149,7 @@ bool Sphere::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThreadD
 
         if(Intersect(ray, Center, Sqr(Radius), &Depth1, &Depth2))
         {
-            Thread->Stats()[Ray_Sphere_Tests_Succeeded]++;
+            Thread->Stats().Shape(Ray_Sphere_Tests_Succeeded)++;
             if((Depth1 > DEPTH_TOLERANCE) && (Depth1 < MAX_DISTANCE))
             {
                 IPoint = ray.Evaluate(Depth1);
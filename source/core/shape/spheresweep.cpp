@@ -106,6 +106,10 @@
 namespace pov
 {
 
+using std::min;
+using std::max;
+using std::vector;
+
 /*****************************************************************************
 * Local preprocessor defines
 ******************************************************************************/
@@ -114,8 +118,18 @@ const DBL DEPTH_TOLERANCE       = 1.0e-6;
 const DBL ZERO_TOLERANCE        = 1.0e-4;
 const DBL RADIUS_TOLERANCE      = 1.0e-6;
 
-// TODO - Technically this should be `(Num_Spheres + Num_Segments * order) * 2` [CLi]
-#define SPHSWEEP_MAX_ISECT  ((Num_Spheres + Num_Segments) * 2 + 64)
+/// Maximum number of intersections of a line with a single segment: two closing discs, plus
+/// up to ten roots of the segment's polynomial, each possibly standing for two intersections.
+const int SPHSWEEP_MAX_SEGMENT_ISECT = 22;
+
+/// Minimum number of segments and single spheres for a sweep to get a bounding hierarchy.
+const int SPHSWEEP_BVH_MIN_ELEMENTS = 16;
+/// Number of children per node of the bounding hierarchy.
+const unsigned int SPHSWEEP_BVH_WIDTH = 4;
+/// Maximum number of segments and single spheres per leaf of the bounding hierarchy.
+const unsigned int SPHSWEEP_BVH_LEAF_ELEMENTS = 4;
+/// Padding of the element bounds, to keep grazing hits from being culled.
+const DBL SPHSWEEP_BVH_PADDING = 1.0e-6;
 
 
 
@@ -141,6 +155,83 @@ const MATRIX B_Matrix =
 
 
 
+/*****************************************************************************
+* Local typedefs
+******************************************************************************/
+
+/// Segment and single sphere bounds as seen by the tree building code.
+class SphereSweepBVHObjects final : public BSPTree::Objects
+{
+    public:
+
+        SphereSweepBVHObjects(const vector<MinMaxBoundingBox>& b) : boxes(b) { }
+        virtual ~SphereSweepBVHObjects() override { }
+
+        virtual unsigned int size() const override { return (unsigned int)boxes.size(); }
+        virtual float GetMin(unsigned int axis, unsigned int i) const override { return boxes[i].pmin[axis]; }
+        virtual float GetMax(unsigned int axis, unsigned int i) const override { return boxes[i].pmax[axis]; }
+
+    private:
+
+        const vector<MinMaxBoundingBox>& boxes;
+};
+
+class SphereSweepBVHNoProgress final : public BSPTree::Progress
+{
+    public:
+
+        virtual void operator()(unsigned int) const override { }
+};
+
+/// Leaf functor to collect the segments and single spheres whose bounds a ray hits.
+class SphereSweep::BVHCandidates final : public BVHTree::LeafIntersect
+{
+    public:
+
+        BVHCandidates(const BVHTree& t, vector<unsigned int>& c) : tree(t), candidates(c) {}
+
+        virtual void operator()(unsigned int first, unsigned int count, double&) override
+        {
+            const vector<unsigned int>& list = tree.GetObjectList();
+            candidates.insert(candidates.end(), list.begin() + first, list.begin() + first + count);
+        }
+
+        virtual bool operator()() const override { return false; }
+
+    private:
+
+        const BVHTree& tree;
+        vector<unsigned int>& candidates;
+};
+
+/// Point query functor to test whether a point is inside any of the segments whose bounds
+/// contain it.
+class SphereSweep::BVHInside final : public BSPTree::Inside
+{
+    public:
+
+        BVHInside(const SphereSweep& s, const Vector3d& p, RenderStatistics& st) : sweep(s), point(p), stats(st), found(false) {}
+
+        virtual bool operator()(unsigned int index) override
+        {
+            // Single spheres are covered by the segments they close.
+            if (!found && (index < (unsigned int)sweep.Num_Segments))
+                found = Inside_Segment(point, &sweep.Segment[index], stats);
+            return found;
+        }
+
+        virtual bool operator()() const override { return found; }
+
+    private:
+
+        const SphereSweep& sweep;
+        const Vector3d& point;
+        RenderStatistics& stats;
+        bool found;
+};
+
+
+
 /*****************************************************************************
 *
 * FUNCTION
@@ -169,24 +260,26 @@ const MATRIX B_Matrix =
 *
 * CHANGES
 *
-*   -
+*   Only the segments and single spheres whose bounds the ray hits are
+*   tested, using per-thread buffers; the polynomials of linear segments
+*   are solved all at once.
 *
 ******************************************************************************/
 
 bool SphereSweep::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThreadData *Thread)
 {
-    // TODO - To improve performance, we might use thread-local buffers for all sphere sweeps.
-    SPHSWEEP_INT    *Isect = reinterpret_cast<SPHSWEEP_INT *>(POV_MALLOC(sizeof(SPHSWEEP_INT) * SPHSWEEP_MAX_ISECT, "sphere sweep intersections"));
-    SPHSWEEP_INT    *Sphere_Isect = reinterpret_cast<SPHSWEEP_INT *>(POV_MALLOC(sizeof(SPHSWEEP_INT) * 2 * Num_Spheres, "Sphere sweep sphere intersections"));
-    SPHSWEEP_INT    *Segment_Isect = reinterpret_cast<SPHSWEEP_INT *>(POV_MALLOC(sizeof(SPHSWEEP_INT) * 12 * Num_Segments, "Sphere sweep segment intersections"));
+    SphereSweepBuffers& Buffers = Thread->SphereSweep_Buffers;
+    vector<SPHSWEEP_INT>& Isect = Buffers.Intersections;
+    vector<unsigned int>& Candidates = Buffers.Candidates;
+    SPHSWEEP_INT    Segment_Isect[SPHSWEEP_MAX_SEGMENT_ISECT];
     BasicRay        New_Ray;
     DBL             len;
     bool            Intersection_Found = false;
-    int             Num_Isect = 0;
+    int             Num_Isect;
     int             Num_Seg_Isect;
     int             i, j;
 
-    Thread->Stats()[Ray_Sphere_Sweep_Tests]++;
+    Thread->Stats().Shape(Ray_Sphere_Sweep_Tests)++;
 
     if (Trans == nullptr)
     {
@@ -201,44 +294,95 @@ bool SphereSweep::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceTh
         New_Ray.Direction /= len;
     }
 
-    // Intersections with single spheres
-    for(i = 0; i < Num_Spheres; i++)
+    // Find the segments and single spheres that may be intersected. Intersections behind the
+    // ray origin are needed to tell interior surfaces apart, so we're really looking at the
+    // whole line, and start tracing the hierarchy where the line enters the sweep's bounds.
+    Candidates.clear();
+    if ((Geometry != nullptr) && (Geometry->Tree != nullptr))
     {
-        // Test for end of vector
-        if (Num_Isect + 2 <= SPHSWEEP_MAX_ISECT)
+        DBL t0 = -BOUND_HUGE, t1 = BOUND_HUGE;
+        for (i = X; (i <= Z) && (t0 <= t1); i++)
+        {
+            if (fabs(New_Ray.Direction[i]) < EPSILON)
+            {
+                if ((New_Ray.Origin[i] < Geometry->Tree_Min[i]) || (New_Ray.Origin[i] > Geometry->Tree_Max[i]))
+                    t1 = -BOUND_HUGE;
+            }
+            else
+            {
+                DBL ta = (Geometry->Tree_Min[i] - New_Ray.Origin[i]) / New_Ray.Direction[i];
+                DBL tb = (Geometry->Tree_Max[i] - New_Ray.Origin[i]) / New_Ray.Direction[i];
+                t0 = max(t0, min(ta, tb));
+                t1 = min(t1, max(ta, tb));
+            }
+        }
+        if (t0 <= t1)
         {
-            // Are there intersections with this sphere?
-            if (Intersect_Sphere(New_Ray, &Sphere[i], Isect + Num_Isect))
-                Num_Isect += 2;
+            BVHCandidates candidates(*Geometry->Tree, Candidates);
+            (*Geometry->Tree)(BasicRay(New_Ray.Evaluate(t0), New_Ray.Direction), candidates, t1 - t0);
         }
     }
+    else
+    {
+        for (i = 0; i < Num_Segments + Num_Spheres; i++)
+            Candidates.push_back(i);
+    }
 
-    // Intersections with segments
-    for(i = 0; i < Num_Segments; i++)
+    // Solve the polynomials of linear segments all at once.
+    int Num_Batched = 0;
+    if (Interpolation == LINEAR_SPHERE_SWEEP)
     {
-        // Are there intersections with this segment?
-        Num_Seg_Isect = Intersect_Segment(New_Ray, &Segment[i], Segment_Isect, Thread->Stats());
+        Buffers.Coefs.resize(3 * Candidates.size());
+        for (unsigned int c : Candidates)
+        {
+            if (c < (unsigned int)Num_Segments)
+            {
+                DBL b, d, e;
+                Linear_Segment_Polynomial(New_Ray, &Segment[c], &Buffers.Coefs[3 * Num_Batched], b, d, e);
+                Num_Batched++;
+            }
+        }
+        Buffers.Roots.resize(2 * Num_Batched);
+        Buffers.Num_Roots.resize(Num_Batched);
+        if (Num_Batched > 0)
+            Solve_Polynomials(2, Num_Batched, Buffers.Coefs.data(), Buffers.Roots.data(), Buffers.Num_Roots.data(), true, 1e-10, Thread->Stats());
+    }
 
-        // Test for end of vector
-        if(Num_Isect + Num_Seg_Isect <= SPHSWEEP_MAX_ISECT)
+    Isect.clear();
+    j = 0;
+    for (unsigned int c : Candidates)
+    {
+        if (c < (unsigned int)Num_Segments)
         {
-            for (j = 0; j < Num_Seg_Isect; j++)
+            // Intersections with segments
+            if (Interpolation == LINEAR_SPHERE_SWEEP)
             {
-                // Add intersection
-                Isect[Num_Isect] = Segment_Isect[j];
-                Num_Isect++;
+                Num_Seg_Isect = Intersect_Segment(New_Ray, &Segment[c], Segment_Isect, Thread->Stats(), &Buffers.Roots[2 * j], Buffers.Num_Roots[j]);
+                j++;
             }
+            else
+                Num_Seg_Isect = Intersect_Segment(New_Ray, &Segment[c], Segment_Isect, Thread->Stats());
+
+            Isect.insert(Isect.end(), Segment_Isect, Segment_Isect + Num_Seg_Isect);
+        }
+        else
+        {
+            // Intersections with single spheres
+            if (Intersect_Sphere(New_Ray, &Sphere[c - Num_Segments], Segment_Isect))
+                Isect.insert(Isect.end(), Segment_Isect, Segment_Isect + 2);
         }
     }
 
+    Num_Isect = (int)Isect.size();
+
     // Any intersections?
     if(Num_Isect > 0)
     {
         // Sort intersections
-        std::qsort(Isect, Num_Isect, sizeof(SPHSWEEP_INT), Comp_Isects);
+        std::qsort(Isect.data(), Num_Isect, sizeof(SPHSWEEP_INT), Comp_Isects);
 
         // Delete invalid intersections inside the sphere sweep
-        Num_Isect = Find_Valid_Points(Isect, Num_Isect, New_Ray);
+        Num_Isect = Find_Valid_Points(Isect.data(), Num_Isect, New_Ray);
 
         // Push valid intersections
         for (i = 0; i < Num_Isect; i++)
@@ -273,13 +417,9 @@ bool SphereSweep::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceTh
         }
 
         if(Intersection_Found)
-            Thread->Stats()[Ray_Sphere_Sweep_Tests_Succeeded]++;
+            Thread->Stats().Shape(Ray_Sphere_Sweep_Tests_Succeeded)++;
     }
 
-    POV_FREE(Isect);
-    POV_FREE(Sphere_Isect);
-    POV_FREE(Segment_Isect);
-
     return Intersection_Found;
 }
 
@@ -420,7 +560,8 @@ bool SphereSweep::Intersect_Sphere(const BasicRay &ray, const SPHSWEEP_SPH *Sphe
 ///     The current implementation exhibits numeric instabilities for 3rd order polynomial splines.
 ///     (See GitHub issue #147.)
 ///
-int SphereSweep::Intersect_Segment(const BasicRay &ray, const SPHSWEEP_SEG *Segment, SPHSWEEP_INT *Isect, RenderStatistics& stats)
+int SphereSweep::Intersect_Segment(const BasicRay &ray, const SPHSWEEP_SEG *Segment, SPHSWEEP_INT *Isect, RenderStatistics& stats,
+                                   const DBL *Given_Roots, int Num_Given_Roots)
 {
     int             Isect_Count;
     DBL             Dot1, Dot2;
@@ -529,31 +670,15 @@ int SphereSweep::Intersect_Segment(const BasicRay &ray, const SPHSWEEP_SEG *Segm
     {
         case 2:   // First order Polynomial
 
-            Vector = ray.Origin - Segment->Center_Coef[0];
-
-            // a is always 1.0
-
-            b = dot(Segment->Center_Coef[1], ray.Direction);
-            b *= -2.0;
-
-            c = dot(Vector, ray.Direction);
-            c *= 2.0;
-
-            d = Segment->Center_Coef[1].lengthSqr();
-            d -= Sqr(Segment->Radius_Coef[1]);
-
-            e = dot(Vector, Segment->Center_Coef[1]);
-            e += Segment->Radius_Coef[0] * Segment->Radius_Coef[1];
-            e *= -2.0;
-
-            f = Vector.lengthSqr();
-            f -= Sqr(Segment->Radius_Coef[0]);
+            Linear_Segment_Polynomial(ray, Segment, Coef, b, d, e);
 
-            Coef[0] = 4.0 * Sqr(d) - Sqr(b) * d;
-            Coef[1] = 4.0 * d * e - 2.0 * b * c * d;
-            Coef[2] = Sqr(e) - b * c * e + Sqr(b) * f;
-
-            Num_Poly_Roots = Solve_Polynomial(2, Coef, Root, true, 1e-10, stats);
+            if (Given_Roots != nullptr)
+            {
+                Num_Poly_Roots = Num_Given_Roots;
+                std::copy(Given_Roots, Given_Roots + Num_Given_Roots, Root);
+            }
+            else
+                Num_Poly_Roots = Solve_Polynomial(2, Coef, Root, true, 1e-10, stats);
             break;
 
         case 4:   // Third order polynomial
@@ -629,7 +754,8 @@ int SphereSweep::Intersect_Segment(const BasicRay &ray, const SPHSWEEP_SEG *Segm
             Coef[9] = 4.0 * j * k - 2.0 * c * k * e - 2.0 * d * j * e + 4.0 * c * d * l;
             Coef[10] = Sqr(k) - d * k * e + l * Sqr(d);
 
-            Num_Poly_Roots = bezier_01(10, Coef, Root, true, 1e-10, stats);
+            // Only roots in [0, 1] are of interest.
+            Num_Poly_Roots = Solve_Polynomial_01(10, Coef, Root, 1e-10, stats);
             break;
 
         default:
@@ -748,6 +874,69 @@ int SphereSweep::Intersect_Segment(const BasicRay &ray, const SPHSWEEP_SEG *Segm
 
 
 
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Linear_Segment_Polynomial
+*
+* INPUT
+*
+*   Ray     - Ray to test intersection with
+*   Segment - Linear segment of a sphere sweep
+*
+* OUTPUT
+*
+*   Coef    - Coefficients of the quadratic polynomial
+*   b, d, e - Terms needed to locate the intersections at the roots
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Compute the polynomial whose roots are the spline parameters at which
+*   the ray touches the sides of a linear segment.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+void SphereSweep::Linear_Segment_Polynomial(const BasicRay &ray, const SPHSWEEP_SEG *Segment, DBL *Coef, DBL& b, DBL& d, DBL& e)
+{
+    Vector3d    Vector;
+    DBL         c, f;
+
+    Vector = ray.Origin - Segment->Center_Coef[0];
+
+    // a is always 1.0
+
+    b = dot(Segment->Center_Coef[1], ray.Direction);
+    b *= -2.0;
+
+    c = dot(Vector, ray.Direction);
+    c *= 2.0;
+
+    d = Segment->Center_Coef[1].lengthSqr();
+    d -= Sqr(Segment->Radius_Coef[1]);
+
+    e = dot(Vector, Segment->Center_Coef[1]);
+    e += Segment->Radius_Coef[0] * Segment->Radius_Coef[1];
+    e *= -2.0;
+
+    f = Vector.lengthSqr();
+    f -= Sqr(Segment->Radius_Coef[0]);
+
+    Coef[0] = 4.0 * Sqr(d) - Sqr(b) * d;
+    Coef[1] = 4.0 * d * e - 2.0 * b * c * d;
+    Coef[2] = Sqr(e) - b * c * e + Sqr(b) * f;
+}
+
+
+
 /*****************************************************************************
 *
 * FUNCTION
@@ -776,20 +965,15 @@ int SphereSweep::Intersect_Segment(const BasicRay &ray, const SPHSWEEP_SEG *Segm
 *
 * CHANGES
 *
-*   -
+*   Only the segments whose bounds contain the point are tested.
 *
 ******************************************************************************/
 
 bool SphereSweep::Inside(const Vector3d& IPoint, TraceThreadData *Thread) const
 {
-    int     inside;
+    bool        inside;
     Vector3d    New_Point;
-    int     i, j;
-    Vector3d    Vector;
-    DBL     temp;
-    DBL     Coef[7];
-    DBL     Root[6];
-    int     Num_Poly_Roots;
+    int         i;
 
     inside = false;
 
@@ -798,126 +982,167 @@ bool SphereSweep::Inside(const Vector3d& IPoint, TraceThreadData *Thread) const
     else
         MInvTransPoint(New_Point, IPoint, Trans);
 
-    switch(Interpolation)
+    if ((Geometry != nullptr) && (Geometry->Tree != nullptr))
     {
-        case LINEAR_SPHERE_SWEEP:
-            // For each segment...
-            for(i = 0; i < Num_Segments; i++)
-            {
-                // Pre-calculate vector
-                Vector = New_Point - Segment[i].Center_Coef[0];
+        BVHInside query(*this, New_Point, Thread->Stats());
+        inside = (*Geometry->Tree)(New_Point, query, true);
+    }
+    else
+    {
+        // For each segment...
+        for(i = 0; (i < Num_Segments) && !inside; i++)
+            inside = Inside_Segment(New_Point, &Segment[i], Thread->Stats());
+    }
 
-                // Coefficient for u^2
-                Coef[0] = Segment[i].Center_Coef[1].lengthSqr();
-                Coef[0] -= Sqr(Segment[i].Radius_Coef[1]);
+    if(Test_Flag(this, INVERTED_FLAG))
+        inside = !inside;
 
-                // Coefficient for u^1
-                Coef[1] = dot(Vector, Segment[i].Center_Coef[1]);
-                Coef[1] += Segment[i].Radius_Coef[0]
-                         * Segment[i].Radius_Coef[1];
-                Coef[1] *= -2.0;
+    return inside;
+}
 
-                // Coefficient for u^0
-                Coef[2] = Vector.lengthSqr();
-                Coef[2] -= Sqr(Segment[i].Radius_Coef[0]);
 
-                // Find roots
-                Num_Poly_Roots = Solve_Polynomial(2, Coef, Root, true, 1e-10, Thread->Stats());
 
-                // Test for interval [0, 1]
-                for(j = 0; j < Num_Poly_Roots; j++)
-                {
-                    if(Root[j] >= 0.0 && Root[j] <= 1.0)
-                    {
-                        // At least one root inside interval,
-                        // so we are inside sphere sweep
-                        inside = true;
-                        break;
-                    }
-                }
-            }
-            break;
-        case CATMULL_ROM_SPLINE_SPHERE_SWEEP:
-        case B_SPLINE_SPHERE_SWEEP:
-            // For each segment...
-            for(i = 0; i < Num_Segments; i++)
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Inside_Sphere_Sweep_Segment
+*
+* INPUT
+*
+*   Point   - Point to test
+*   Segment - Segment of a sphere sweep
+*
+* OUTPUT
+*
+* RETURNS
+*
+*   Boolean - is the point inside the segment?
+*
+* AUTHOR
+*
+*   Jochen Lippert
+*
+* DESCRIPTION
+*
+*   Test if point is inside one segment of a sphere sweep.
+*
+* CHANGES
+*
+*   Split off from Inside_Sphere_Sweep.
+*
+******************************************************************************/
+
+bool SphereSweep::Inside_Segment(const Vector3d& Point, const SPHSWEEP_SEG *Segment, RenderStatistics& stats)
+{
+    int         j;
+    Vector3d    Vector;
+    DBL         temp;
+    DBL         Coef[7];
+    DBL         Root[6];
+    int         Num_Poly_Roots;
+
+    switch (Segment->Num_Coefs)
+    {
+        case 2:   // First order Polynomial
+
+            // Pre-calculate vector
+            Vector = Point - Segment->Center_Coef[0];
+
+            // Coefficient for u^2
+            Coef[0] = Segment->Center_Coef[1].lengthSqr();
+            Coef[0] -= Sqr(Segment->Radius_Coef[1]);
+
+            // Coefficient for u^1
+            Coef[1] = dot(Vector, Segment->Center_Coef[1]);
+            Coef[1] += Segment->Radius_Coef[0]
+                     * Segment->Radius_Coef[1];
+            Coef[1] *= -2.0;
+
+            // Coefficient for u^0
+            Coef[2] = Vector.lengthSqr();
+            Coef[2] -= Sqr(Segment->Radius_Coef[0]);
+
+            // Find roots
+            Num_Poly_Roots = Solve_Polynomial(2, Coef, Root, true, 1e-10, stats);
+
+            // Test for interval [0, 1]
+            for(j = 0; j < Num_Poly_Roots; j++)
             {
-                // Pre-calculate vector
-                Vector = New_Point - Segment[i].Center_Coef[0];
-
-                // Coefficient for u^6
-                Coef[0] = Segment[i].Center_Coef[3].lengthSqr();
-                Coef[0] -= Sqr(Segment[i].Radius_Coef[3]);
-
-                // Coefficient for u^5
-                Coef[1] = dot(Segment[i].Center_Coef[3],
-                              Segment[i].Center_Coef[2]);
-                Coef[1] -= Segment[i].Radius_Coef[3]
-                         * Segment[i].Radius_Coef[2];
-                Coef[1] *= 2.0;
-
-                // Coefficient for u^4
-                Coef[2] = dot(Segment[i].Center_Coef[3],
-                              Segment[i].Center_Coef[1]);
-                Coef[2] *= 2.0;
-                temp = Segment[i].Center_Coef[2].lengthSqr();
-                Coef[2] += temp;
-                Coef[2] -= 2.0 * Segment[i].Radius_Coef[3]
-                               * Segment[i].Radius_Coef[1];
-                Coef[2] -= Sqr(Segment[i].Radius_Coef[2]);
-
-                // Coefficient for u^3
-                Coef[3] = dot(Segment[i].Center_Coef[3], Vector);
-                temp = dot(Segment[i].Center_Coef[2],
-                           Segment[i].Center_Coef[1]);
-                Coef[3] -= temp;
-                Coef[3] += Segment[i].Radius_Coef[3]
-                         * Segment[i].Radius_Coef[0];
-                Coef[3] += Segment[i].Radius_Coef[2]
-                         * Segment[i].Radius_Coef[1];
-                Coef[3] *= -2.0;
-
-                // Coefficient for u^2
-                Coef[4] = dot(Segment[i].Center_Coef[2], Vector);
-                Coef[4] += Segment[i].Radius_Coef[2]
-                         * Segment[i].Radius_Coef[0];
-                Coef[4] *= -2.0;
-                temp = Segment[i].Center_Coef[1].lengthSqr();
-                Coef[4] += temp;
-                Coef[4] -= Sqr(Segment[i].Radius_Coef[1]);
-
-                // Coefficient for u^1
-                Coef[5] = dot(Segment[i].Center_Coef[1], Vector);
-                Coef[5] += Segment[i].Radius_Coef[1]
-                         * Segment[i].Radius_Coef[0];
-                Coef[5] *= -2.0;
-
-                // Coefficient for u^0
-                Coef[6] = Vector.lengthSqr();
-                Coef[6] -= Sqr(Segment[i].Radius_Coef[0]);
-
-                // Find roots
-                Num_Poly_Roots = bezier_01(6, Coef, Root, true, 1e-10, Thread->Stats());
-
-                // Test for interval [0, 1]
-                for(j = 0; j < Num_Poly_Roots; j++)
-                {
-                    if(Root[j] >= 0.0 && Root[j] <= 1.0)
-                    {
-                        // At least one root inside interval,
-                        // so we are inside the sphere sweep
-                        inside = true;
-                        break;
-                    }
-                }
+                // At least one root inside interval,
+                // so we are inside the segment
+                if(Root[j] >= 0.0 && Root[j] <= 1.0)
+                    return true;
             }
             break;
-    }
 
-    if(Test_Flag(this, INVERTED_FLAG))
-        inside = !inside;
+        case 4:   // Third order polynomial
 
-    return inside;
+            // Pre-calculate vector
+            Vector = Point - Segment->Center_Coef[0];
+
+            // Coefficient for u^6
+            Coef[0] = Segment->Center_Coef[3].lengthSqr();
+            Coef[0] -= Sqr(Segment->Radius_Coef[3]);
+
+            // Coefficient for u^5
+            Coef[1] = dot(Segment->Center_Coef[3],
+                          Segment->Center_Coef[2]);
+            Coef[1] -= Segment->Radius_Coef[3]
+                     * Segment->Radius_Coef[2];
+            Coef[1] *= 2.0;
+
+            // Coefficient for u^4
+            Coef[2] = dot(Segment->Center_Coef[3],
+                          Segment->Center_Coef[1]);
+            Coef[2] *= 2.0;
+            temp = Segment->Center_Coef[2].lengthSqr();
+            Coef[2] += temp;
+            Coef[2] -= 2.0 * Segment->Radius_Coef[3]
+                           * Segment->Radius_Coef[1];
+            Coef[2] -= Sqr(Segment->Radius_Coef[2]);
+
+            // Coefficient for u^3
+            Coef[3] = dot(Segment->Center_Coef[3], Vector);
+            temp = dot(Segment->Center_Coef[2],
+                       Segment->Center_Coef[1]);
+            Coef[3] -= temp;
+            Coef[3] += Segment->Radius_Coef[3]
+                     * Segment->Radius_Coef[0];
+            Coef[3] += Segment->Radius_Coef[2]
+                     * Segment->Radius_Coef[1];
+            Coef[3] *= -2.0;
+
+            // Coefficient for u^2
+            Coef[4] = dot(Segment->Center_Coef[2], Vector);
+            Coef[4] += Segment->Radius_Coef[2]
+                     * Segment->Radius_Coef[0];
+            Coef[4] *= -2.0;
+            temp = Segment->Center_Coef[1].lengthSqr();
+            Coef[4] += temp;
+            Coef[4] -= Sqr(Segment->Radius_Coef[1]);
+
+            // Coefficient for u^1
+            Coef[5] = dot(Segment->Center_Coef[1], Vector);
+            Coef[5] += Segment->Radius_Coef[1]
+                     * Segment->Radius_Coef[0];
+            Coef[5] *= -2.0;
+
+            // Coefficient for u^0
+            Coef[6] = Vector.lengthSqr();
+            Coef[6] -= Sqr(Segment->Radius_Coef[0]);
+
+            // Find roots; only those in [0, 1] are of interest, and any of them
+            // means we are inside the segment
+            Num_Poly_Roots = Solve_Polynomial_01(6, Coef, Root, 1e-10, stats);
+            return (Num_Poly_Roots > 0);
+
+        default:
+            POV_SHAPE_ASSERT(false);
+            break;
+    }
+
+    return false;
 }
 
 
@@ -996,23 +1221,19 @@ void SphereSweep::Normal(Vector3d& Result, Intersection *Inter, TraceThreadData
 ObjectPtr SphereSweep::Copy()
 {
     SphereSweep *New = new SphereSweep();
-    int         i;
 
     Destroy_Transform(New->Trans);
     *New = *this;
 
-    New->Segment = nullptr;
-    New->Sphere = nullptr;
-    New->Interpolation = Interpolation;
-
-    New->Num_Modeling_Spheres = Num_Modeling_Spheres;
-    New->Modeling_Sphere = reinterpret_cast<SPHSWEEP_SPH *>(POV_MALLOC(Num_Modeling_Spheres * sizeof(SPHSWEEP_SPH), "modeling sphere"));
-    for(i = 0; i < New->Num_Modeling_Spheres; i++)
-        New->Modeling_Sphere[i] = Modeling_Sphere[i];
-
-    New->Depth_Tolerance = Depth_Tolerance;
-
-    New->Compute();
+    // The geometry is shared until either copy is modified.
+    if (Geometry == nullptr)
+    {
+        New->Modeling_Sphere = reinterpret_cast<SPHSWEEP_SPH *>(POV_MALLOC(Num_Modeling_Spheres * sizeof(SPHSWEEP_SPH), "modeling sphere"));
+        std::copy(Modeling_Sphere, Modeling_Sphere + Num_Modeling_Spheres, New->Modeling_Sphere);
+        New->Sphere = nullptr;
+        New->Segment = nullptr;
+        New->Compute();
+    }
 
     New->Trans = Copy_Transform(Trans);
 
@@ -1057,6 +1278,7 @@ void SphereSweep::Translate(const Vector3d& Vector, const TRANSFORM *tr)
 {
     if (Trans == nullptr)
     {
+        Unshare_Geometry();
         for(int i = 0; i < Num_Modeling_Spheres; i++)
             Modeling_Sphere[i].Center += Vector;
         Compute();
@@ -1104,6 +1326,7 @@ void SphereSweep::Rotate(const Vector3d&, const TRANSFORM *tr)
 {
     if (Trans == nullptr)
     {
+        Unshare_Geometry();
         for (int i = 0; i < Num_Modeling_Spheres; i++)
             MTransPoint(Modeling_Sphere[i].Center, Modeling_Sphere[i].Center, tr);
         Compute();
@@ -1157,6 +1380,7 @@ void SphereSweep::Scale(const Vector3d& Vector, const TRANSFORM *tr)
 
     if (Trans == nullptr)
     {
+        Unshare_Geometry();
         for(int i = 0; i < Num_Modeling_Spheres; i++)
         {
             Modeling_Sphere[i].Center *= Vector[X];
@@ -1302,6 +1526,18 @@ void SphereSweep::Transform(const TRANSFORM *tr)
 
 SphereSweep::~SphereSweep()
 {
+    // Once computed, the arrays are owned by the geometry.
+    if (Geometry == nullptr)
+    {
+        POV_FREE(Modeling_Sphere);
+        POV_FREE(Sphere);
+        POV_FREE(Segment);
+    }
+}
+
+SphereSweepGeometry::~SphereSweepGeometry()
+{
+    delete Tree;
     POV_FREE(Modeling_Sphere);
     POV_FREE(Sphere);
     POV_FREE(Segment);
@@ -1309,6 +1545,49 @@ SphereSweep::~SphereSweep()
 
 
 
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Unshare_Geometry
+*
+* INPUT
+*
+* OUTPUT
+*
+* RETURNS
+*
+*   -
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Give a sphere sweep a private copy of its modeling spheres before they are
+*   modified, if they are currently shared with copies of the object. The
+*   segments and single spheres are left for Compute() to re-create.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+void SphereSweep::Unshare_Geometry()
+{
+    if ((Geometry == nullptr) || (Geometry.use_count() == 1))
+        return;
+
+    SPHSWEEP_SPH *Shared = Modeling_Sphere;
+    Modeling_Sphere = reinterpret_cast<SPHSWEEP_SPH *>(POV_MALLOC(Num_Modeling_Spheres * sizeof(SPHSWEEP_SPH), "modeling sphere"));
+    std::copy(Shared, Shared + Num_Modeling_Spheres, Modeling_Sphere);
+    Sphere = nullptr;
+    Segment = nullptr;
+    Geometry.reset();
+}
+
+
+
 /*****************************************************************************
 *
 * FUNCTION
@@ -1840,6 +2119,129 @@ void SphereSweep::Compute()
       Segment[i].Ubase[2] = Sphere[i+1].Ubase[0];
       Segment[i].Ubase[3] = Sphere[i+1].Ubase[1];
     }
+
+    // hand the arrays over to the geometry, so that copies can share them
+    if (Geometry == nullptr)
+        Geometry = std::make_shared<SphereSweepGeometry>(Modeling_Sphere, Sphere, Segment);
+
+    Build_Segment_Tree();
+}
+
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Build_Segment_Tree
+*
+* INPUT
+*
+* OUTPUT
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Build a bounding hierarchy of the segments and single spheres of the
+*   sphere sweep, so that rays and points only need to be tested against
+*   the few elements nearby. Short sweeps do without one.
+*
+*   A segment's center is bounded by the convex hull of the Bernstein
+*   control points of its spline, and its radius by the largest magnitude
+*   of the control values of the radius spline.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+void SphereSweep::Build_Segment_Tree()
+{
+    vector<MinMaxBoundingBox> boxes;
+    BVHTree::Statistics stats;
+    int i, j, n;
+
+    delete Geometry->Tree;
+    Geometry->Tree = nullptr;
+
+    if (Num_Segments + Num_Spheres < SPHSWEEP_BVH_MIN_ELEMENTS)
+        return;
+
+    boxes.reserve(Num_Segments + Num_Spheres);
+
+    Vector3d lo(BOUND_HUGE), hi(-BOUND_HUGE);
+
+    for (i = 0; i < Num_Segments; i++)
+    {
+        const SPHSWEEP_SEG& seg = Segment[i];
+        Vector3d ctrl[4];
+        DBL rctrl[4];
+        DBL radius = 0.0;
+
+        // Convert the power basis coefficients to Bernstein control values.
+        n = seg.Num_Coefs - 1;
+        if (n == 1)
+        {
+            ctrl[0] = seg.Center_Coef[0];
+            ctrl[1] = seg.Center_Coef[0] + seg.Center_Coef[1];
+            rctrl[0] = seg.Radius_Coef[0];
+            rctrl[1] = seg.Radius_Coef[0] + seg.Radius_Coef[1];
+        }
+        else
+        {
+            ctrl[0] = seg.Center_Coef[0];
+            ctrl[1] = seg.Center_Coef[0] + seg.Center_Coef[1] / 3.0;
+            ctrl[2] = seg.Center_Coef[0] + seg.Center_Coef[1] * (2.0 / 3.0) + seg.Center_Coef[2] / 3.0;
+            ctrl[3] = seg.Center_Coef[0] + seg.Center_Coef[1] + seg.Center_Coef[2] + seg.Center_Coef[3];
+            rctrl[0] = seg.Radius_Coef[0];
+            rctrl[1] = seg.Radius_Coef[0] + seg.Radius_Coef[1] / 3.0;
+            rctrl[2] = seg.Radius_Coef[0] + seg.Radius_Coef[1] * (2.0 / 3.0) + seg.Radius_Coef[2] / 3.0;
+            rctrl[3] = seg.Radius_Coef[0] + seg.Radius_Coef[1] + seg.Radius_Coef[2] + seg.Radius_Coef[3];
+        }
+
+        for (j = 0; j <= n; j++)
+            radius = max(radius, fabs(rctrl[j]));
+
+        Vector3d pmin(ctrl[0]), pmax(ctrl[0]);
+        for (j = 1; j <= n; j++)
+        {
+            pmin = min(pmin, ctrl[j]);
+            pmax = max(pmax, ctrl[j]);
+        }
+        pmin -= radius;
+        pmax += radius;
+
+        // The closing discs may stick out a bit where the radius changes quickly.
+        for (j = 0; j < 2; j++)
+        {
+            pmin = min(pmin, seg.Closing_Sphere[j].Center - fabs(seg.Closing_Sphere[j].Radius));
+            pmax = max(pmax, seg.Closing_Sphere[j].Center + fabs(seg.Closing_Sphere[j].Radius));
+        }
+
+        pmin -= SPHSWEEP_BVH_PADDING;
+        pmax += SPHSWEEP_BVH_PADDING;
+        boxes.push_back(MinMaxBoundingBox{ BBoxVector3d(pmin), BBoxVector3d(pmax) });
+        lo = min(lo, pmin);
+        hi = max(hi, pmax);
+    }
+
+    for (i = 0; i < Num_Spheres; i++)
+    {
+        Vector3d pmin(Sphere[i].Center - (fabs(Sphere[i].Radius) + SPHSWEEP_BVH_PADDING));
+        Vector3d pmax(Sphere[i].Center + (fabs(Sphere[i].Radius) + SPHSWEEP_BVH_PADDING));
+        boxes.push_back(MinMaxBoundingBox{ BBoxVector3d(pmin), BBoxVector3d(pmax) });
+        lo = min(lo, pmin);
+        hi = max(hi, pmax);
+    }
+
+    Geometry->Tree = BVHTree::Create(SPHSWEEP_BVH_WIDTH, SPHSWEEP_BVH_LEAF_ELEMENTS);
+    Geometry->Tree->build(SphereSweepBVHNoProgress(), SphereSweepBVHObjects(boxes), stats);
+    Geometry->Tree_Min = lo;
+    Geometry->Tree_Max = hi;
 }
 
 
@@ -2015,63 +2417,5 @@ void SphereSweep::NormalVectorInterpolation(Vector3d& r, const Vector3d& start,
     }
 }
 
-/*****************************************************************************
-*
-* FUNCTION
-*
-*   bezier_01
-*
-* INPUT
-*
-* OUTPUT
-*
-* RETURNS
-*
-* AUTHOR
-*
-*   Massimo Valentini
-*
-* DESCRIPTION
-*
-*   Optimization to exclude the presence of a root of a polynomial in (0 1).
-*   The rendering time decreases impressively.
-*
-* CHANGES
-*
-*   -
-*
-******************************************************************************/
-
-const int lcm_bezier_01[] =
-{
-    60,  10,  4,  3,  4, 10, 60,
-    2520, 252, 56, 21, 12, 10, 12, 21, 56, 252, 2520
-};
-
-int SphereSweep::bezier_01(int degree, const DBL* Coef, DBL* Roots, bool sturm, DBL tolerance, RenderStatistics& stats)
-{
-    DBL d[11];
-    bool non_negative = true, non_positive = true;
-    int i, j;
-    const int *lcm = &(lcm_bezier_01[degree == 6 ? 0 : 7]);
-
-    for(i = 0; i <= degree; ++i)
-        d[i] = Coef[i] * lcm[i];
-
-    for(i = 0; i <= degree; ++i)
-    {
-        non_negative = (non_negative && (d[degree - i] >= 0));
-        non_positive = (non_positive && (d[degree - i] <= 0));
-
-        if(!(non_negative || non_positive))
-            return Solve_Polynomial(degree, Coef, Roots, sturm, tolerance, stats);
-
-        for(j = 0; j < degree - i; ++j)
-            d[j] += d[j+1];
-    }
-
-    return 0;
-}
-
 }
 // end of namespace pov
@@ -42,13 +42,17 @@
 #include "core/configcore.h"
 
 // C++ variants of C standard header files
-// C++ standard header files
 //  (none at the moment)
 
+// C++ standard header files
+#include <memory>
+#include <vector>
+
 // POV-Ray header files (base module)
 //  (none at the moment)
 
 // POV-Ray header files (core module)
+#include "core/bounding/bvhtree.h"
 #include "core/scene/object.h"
 
 namespace pov
@@ -127,6 +131,38 @@ struct Sphere_Sweep_Intersection_Structure final
 };
 using SPHSWEEP_INT = Sphere_Sweep_Intersection_Structure; ///< @deprecated
 
+/// Arrays describing the geometry of a sphere sweep.
+///
+/// Copies of a sphere sweep share these until one of them is modified.
+///
+struct SphereSweepGeometry final
+{
+    SPHSWEEP_SPH    *Modeling_Sphere;
+    SPHSWEEP_SPH    *Sphere;
+    SPHSWEEP_SEG    *Segment;
+    /// Bounding hierarchy of the segments and single spheres, in that order;
+    /// `nullptr` for sweeps too short to benefit from one.
+    BVHTree         *Tree;
+    /// Bounds of the elements in the hierarchy, padded slightly.
+    Vector3d        Tree_Min, Tree_Max;
+
+    SphereSweepGeometry(SPHSWEEP_SPH *m, SPHSWEEP_SPH *s, SPHSWEEP_SEG *g) : Modeling_Sphere(m), Sphere(s), Segment(g), Tree(nullptr) {}
+    ~SphereSweepGeometry();
+
+    SphereSweepGeometry(const SphereSweepGeometry&) = delete;
+    SphereSweepGeometry& operator=(const SphereSweepGeometry&) = delete;
+};
+
+/// Per-thread buffers used while intersecting sphere sweeps.
+struct SphereSweepBuffers final
+{
+    std::vector<SPHSWEEP_INT>   Intersections;
+    std::vector<unsigned int>   Candidates;     ///< Segments and single spheres whose bounds the ray hits.
+    std::vector<DBL>            Coefs;          ///< Coefficients of the candidate segments' polynomials.
+    std::vector<DBL>            Roots;
+    std::vector<int>            Num_Roots;
+};
+
 /* The complete object */
 class SphereSweep final : public ObjectBase
 {
@@ -140,6 +176,8 @@ class SphereSweep final : public ObjectBase
         SPHSWEEP_SEG    *Segment;               /* Tubular segments              */
         DBL             Depth_Tolerance;        /* Preferred depth tolerance     */
         Vector3d        uref;/**< direction of origin of u in uv_mapping */
+        /// Owner of the arrays above, once computed; `nullptr` before that.
+        std::shared_ptr<SphereSweepGeometry> Geometry;
 
         SphereSweep();
         virtual ~SphereSweep() override;
@@ -159,6 +197,16 @@ class SphereSweep final : public ObjectBase
         void Compute();
     protected:
 
+        class BVHCandidates;
+        class BVHInside;
+
+        /// Build the bounding hierarchy of the segments and single spheres, if worthwhile.
+        void Build_Segment_Tree();
+
+        /// Get a private copy of the modeling spheres, if currently shared with other copies.
+        /// The other arrays are left to be re-computed.
+        void Unshare_Geometry();
+
         /// @note
         ///     This function is quasi-guaranteed to always compute a pair of intersection points
         ///     (if any), even in the case of a "glancing blow", and with surface normals oriented
@@ -171,7 +219,20 @@ class SphereSweep final : public ObjectBase
         ///     (if any), even in the case of a "glancing blow", and with surface normals oriented
         ///     away from the spline "backbone".
         ///
-        static int Intersect_Segment(const BasicRay &ray, const SPHSWEEP_SEG *Segment, SPHSWEEP_INT *Isect, RenderStatistics& stats);
+        /// @param[in]  Given_Roots     Roots of the segment's polynomial if already known, e.g. from
+        ///                             solving the polynomials of several segments at once, or
+        ///                             `nullptr` to have them computed.
+        /// @param[in]  Num_Given_Roots Number of known roots.
+        ///
+        static int Intersect_Segment(const BasicRay &ray, const SPHSWEEP_SEG *Segment, SPHSWEEP_INT *Isect, RenderStatistics& stats,
+                                     const DBL *Given_Roots = nullptr, int Num_Given_Roots = 0);
+
+        /// Test whether a point is inside one segment.
+        static bool Inside_Segment(const Vector3d& Point, const SPHSWEEP_SEG *Segment, RenderStatistics& stats);
+
+        /// Compute the quadratic polynomial whose roots are the intersections of a ray with the
+        /// sides of a linear segment, along with the terms needed to locate the intersections.
+        static void Linear_Segment_Polynomial(const BasicRay &ray, const SPHSWEEP_SEG *Segment, DBL *Coef, DBL& b, DBL& d, DBL& e);
 
         /// Eliminate interior surfaces.
         ///
@@ -185,7 +246,6 @@ class SphereSweep final : public ObjectBase
         static int Find_Valid_Points(SPHSWEEP_INT *Inter, int Num_Inter, const BasicRay &ray);
 
         static int Comp_Isects(const void *Intersection_1, const void *Intersection_2);
-        static int bezier_01(int degree, const DBL* Coef, DBL* Roots, bool sturm, DBL tolerance, RenderStatistics& stats);
 
         static void NormalVectorInterpolation(Vector3d& r, const Vector3d& start, DBL ratio, const Vector3d& end);
 };
@@ -54,7 +54,11 @@
 *
 *  Syntax:
 *
-*    superellipsoid { <e, n> }
+*    superellipsoid { <e, n> [method 1|2] }
+*
+*    With method 2, superellipsoids with e and n no larger than 2 (which are
+*    convex) are intersected using Newton iteration instead of subdividing
+*    the ray.
 *
 *
 *  ---
@@ -70,7 +74,7 @@
 #include <cstdlib>
 
 // C++ standard header files
-//  (none at the moment)
+#include <algorithm>
 
 // POV-Ray header files (base module)
 //  (none at the moment)
@@ -109,6 +113,9 @@ const DBL MAX_VALUE  = 1.01;
 
 const int MAX_ITERATIONS = 20;
 
+/* Maximum number of Newton steps to find a single root before giving up. */
+const int MAX_NEWTON_ITERATIONS = 50;
+
 const int PLANECOUNT = 9;
 
 
@@ -163,11 +170,11 @@ const DBL planes[PLANECOUNT][4] =
 
 bool Superellipsoid::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThreadData *Thread)
 {
-    Thread->Stats()[Ray_Superellipsoid_Tests]++;
+    Thread->Stats().Shape(Ray_Superellipsoid_Tests)++;
 
     if (Intersect(ray, Depth_Stack, Thread))
     {
-        Thread->Stats()[Ray_Superellipsoid_Tests_Succeeded]++;
+        Thread->Stats().Shape(Ray_Superellipsoid_Tests_Succeeded)++;
 
         return(true);
     }
@@ -241,6 +248,28 @@ bool Superellipsoid::Intersect(const BasicRay& ray, IStack& Depth_Stack, TraceTh
         return(false);
     }
 
+    /* Convex superellipsoids can be solved faster. */
+
+    if ((Method == 2) && (Power[X] >= 1.0) && (Power[Z] >= 1.0) && solve_newton(P, D, t1, t2, dists, &cnt))
+    {
+        for (i = 0; i < cnt; i++)
+        {
+            if (insert_hit(ray, dists[i] / len, Depth_Stack, Thread))
+            {
+                if (Type & IS_CHILD_OBJECT)
+                {
+                    Found = true;
+                }
+                else
+                {
+                    return(true);
+                }
+            }
+        }
+
+        return(Found);
+    }
+
     cnt = 0;
 
     if (t1 < DEPTH_TOLERANCE)
@@ -675,6 +704,7 @@ Superellipsoid::Superellipsoid() : ObjectBase(SUPERELLIPSOID_OBJECT)
     Trans = Create_Transform();
 
     Power = Vector3d(2.0, 2.0, 2.0);
+    Method = 1;
 }
 
 
@@ -1063,6 +1093,220 @@ DBL Superellipsoid::evaluate_superellipsoid(const Vector3d& P) const
 
 
 
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   evaluate_g
+*
+* INPUT
+*
+*   x, y - Coordinates
+*   e    - Power
+*
+* OUTPUT
+*
+*   dx, dy - Partial derivatives
+*
+* RETURNS
+*
+*   DBL
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Like the other variant, but also compute the partial derivatives of
+*   (x^e + y^e)^(1/e). These come from the same powers, at the cost of a
+*   few divisions. Where y is 0, the derivative with respect to it is taken
+*   to be 0, which for e = 1 is one of its subgradients.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+DBL Superellipsoid::evaluate_g(DBL x, DBL y, DBL e, DBL& dx, DBL& dy)
+{
+    DBL g = 0, q, w;
+
+    dx = dy = 0;
+
+    if (x > y)
+    {
+        q = power(y/x, e);
+        w = 1 + q;
+        g = (w != 1) ? x * power(w, 1/e) : x;
+        dx = g / (x * w);
+        if (y != 0)
+            dy = q * g / (y * w);
+    }
+    else if (y != 0)
+    {
+        q = power(x/y, e);
+        w = 1 + q;
+        g = (w != 1) ? y * power(w, 1/e) : y;
+        dy = g / (y * w);
+        if (x != 0)
+            dx = q * g / (x * w);
+    }
+    return g;
+}
+
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   evaluate_superellipsoid
+*
+* INPUT
+*
+*   P - Point
+*   D - Direction
+*
+* OUTPUT
+*
+*   slope - Derivative in direction D
+*
+* RETURNS
+*
+*   DBL
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Get superellipsoid value and its derivative along a ray in the given
+*   point.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+DBL Superellipsoid::evaluate_superellipsoid(const Vector3d& P, const Vector3d& D, DBL& slope) const
+{
+    DBL dx, dy, dr, dz;
+    DBL r = evaluate_g(fabs(P[X]), fabs(P[Y]), Power[X], dx, dy);
+    DBL g = evaluate_g(r, fabs(P[Z]), Power[Z], dr, dz);
+
+    slope = dr * (dx * SGNX(P[X]) * D[X] + dy * SGNX(P[Y]) * D[Y]) + dz * SGNX(P[Z]) * D[Z];
+
+    return g - 1;
+}
+
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   solve_newton
+*
+* INPUT
+*
+*   P, D   - Ray in superellipsoid space
+*   t1, t2 - Part of the ray within the bounding box
+*
+* OUTPUT
+*
+*   dists - Intersection depths
+*   cnt   - Number of intersections
+*
+* RETURNS
+*
+*   bool - false if the method failed to converge
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Find the intersections of a ray with a convex superellipsoid (e and n
+*   no larger than 2).
+*
+*   The function is then a norm minus 1, and therefore convex along the ray.
+*   Newton steps taken from the near side of the bounding box, where the
+*   function is positive, can thus never overshoot the first root, and either
+*   converge on it or reach a point where the function stops falling, proving
+*   that the ray misses. Likewise, Newton steps from the far side converge on
+*   the second root. This holds where the function is not smooth, too, as its
+*   gradient is replaced with a subgradient there.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+bool Superellipsoid::solve_newton(const Vector3d& P, const Vector3d& D, DBL t1, DBL t2, DBL *dists, int *cnt) const
+{
+    int i;
+    DBL t, v, slope;
+
+    *cnt = 0;
+
+    /* Approach the entry point from the near side. */
+
+    for (t = t1, i = 0; ; i++)
+    {
+        v = evaluate_superellipsoid(P + t * D, D, slope);
+
+        if (v < ZERO_TOLERANCE)
+        {
+            break;
+        }
+
+        if (slope >= 0.0)
+        {
+            /* The function only rises from here on, so the ray misses. */
+            return(true);
+        }
+
+        if (i == MAX_NEWTON_ITERATIONS)
+        {
+            return(false);
+        }
+
+        t -= v / slope;
+
+        if (t > t2)
+        {
+            return(true);
+        }
+    }
+
+    dists[(*cnt)++] = t;
+
+    /* Approach the exit point from the far side. */
+
+    for (t = t2, i = 0; ; i++)
+    {
+        v = evaluate_superellipsoid(P + t * D, D, slope);
+
+        if (v < ZERO_TOLERANCE)
+        {
+            break;
+        }
+
+        if ((slope <= 0.0) || (i == MAX_NEWTON_ITERATIONS))
+        {
+            return(false);
+        }
+
+        t -= v / slope;
+    }
+
+    dists[(*cnt)++] = std::max(t, dists[0]);
+
+    return(true);
+}
+
+
+
 /*****************************************************************************
 *
 * FUNCTION
@@ -74,6 +74,7 @@ class Superellipsoid final : public ObjectBase
 {
     public:
         Vector3d Power;
+        int Method; ///< Intersection method: 1 = ray subdivision, 2 = Newton iteration where the shape is convex.
 
         Superellipsoid();
         virtual ~Superellipsoid() override;
@@ -93,7 +94,10 @@ class Superellipsoid final : public ObjectBase
         static bool intersect_box(const Vector3d& P, const Vector3d& D, DBL *dmin, DBL *dmax);
         static DBL power(DBL x, DBL e);
         static DBL evaluate_g(DBL x, DBL y, DBL e);
+        static DBL evaluate_g(DBL x, DBL y, DBL e, DBL& dx, DBL& dy);
         DBL evaluate_superellipsoid(const Vector3d& P) const;
+        DBL evaluate_superellipsoid(const Vector3d& P, const Vector3d& D, DBL& slope) const;
+        bool solve_newton(const Vector3d& P, const Vector3d& D, DBL t1, DBL t2, DBL *dists, int *cnt) const;
         static int compdists(const void *in_a, const void *in_b);
         int find_ray_plane_points(const Vector3d& P, const Vector3d& D, int cnt, DBL *dists, DBL mindist, DBL maxdist) const;
         void solve_hit1(DBL v0, const Vector3d& tP0, DBL v1, const Vector3d& tP1, Vector3d& P) const;
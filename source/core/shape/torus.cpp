@@ -250,7 +250,7 @@ int Torus::Intersect(const BasicRay& ray, DBL *Depth, RenderStatistics& stats) c
     DBL BoundingSphereRadius; // Sphere fully (amply) enclosing torus.
     DBL Closer;               // P is moved Closer*D closer to torus.
 
-    stats[Ray_Torus_Tests]++;
+    stats.Shape(Ray_Torus_Tests)++;
 
     /* Transform the ray into the torus space. */
 
@@ -274,13 +274,13 @@ int Torus::Intersect(const BasicRay& ray, DBL *Depth, RenderStatistics& stats) c
     r2 = Sqr(MajorRadius + MinorRadius);
 
 #ifdef TORUS_EXTRA_STATS
-    stats[Torus_Bound_Tests]++;
+    stats.Shape(Torus_Bound_Tests)++;
 #endif
 
     if (Test_Thick_Cylinder(P, D, y1, y2, r1, r2))
     {
 #ifdef TORUS_EXTRA_STATS
-        stats[Torus_Bound_Tests_Succeeded]++;
+        stats.Shape(Torus_Bound_Tests_Succeeded)++;
 #endif
 
         // Move P close to bounding sphere to have more precise root calculation.
@@ -316,14 +316,14 @@ int Torus::Intersect(const BasicRay& ray, DBL *Depth, RenderStatistics& stats) c
 
         c[4] = k1 * k1 + 4.0 * R2 * (Py2 - r2);
 
-        n = Solve_Polynomial(4, c, r, Test_Flag(this, STURM_FLAG), ROOT_TOLERANCE, stats);
+        n = Solve_Quartic(c, r, Test_Flag(this, STURM_FLAG), ROOT_TOLERANCE, stats);
 
         while(n--)
             Depth[i++] = (r[n] + Closer) / len;
     }
 
     if (i)
-        stats[Ray_Torus_Tests_Succeeded]++;
+        stats.Shape(Ray_Torus_Tests_Succeeded)++;
 
     return(i);
 }
@@ -431,10 +431,10 @@ bool Triangle::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThrea
     DBL Depth;
     Vector3d IPoint;
 
-    Thread->Stats()[Ray_Triangle_Tests]++;
+    Thread->Stats().Shape(Ray_Triangle_Tests)++;
     if (Intersect(ray, &Depth))
     {
-        Thread->Stats()[Ray_Triangle_Tests_Succeeded]++;
+        Thread->Stats().Shape(Ray_Triangle_Tests_Succeeded)++;
         IPoint = ray.Evaluate(Depth);
 
         if (Clip.empty() || Point_In_Clip(IPoint, Clip, Thread))
@@ -42,7 +42,11 @@
 //  (none at the moment)
 
 // C++ standard header files
+#include <algorithm>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
 #include <vector>
 
 // POV-Ray header files (base module)
@@ -257,6 +261,7 @@ struct Contour final
     USHORT count;                 /* Number of points in the contour */
     std::vector<BYTE> flags;      /* On/off curve flags */
     std::vector<DBL> x, y;        /* Coordinates of control vertices */
+    DBL xmin, xmax, ymin, ymax;   /* Bounds of the control vertices, and hence of the contour */
 };
 
 
@@ -265,11 +270,13 @@ struct GlyphStruct final
 {
     GlyphHeader header;           /* Count and sizing information about this glyph */
     GlyphIndex glyph_index;       /* Internal glyph index for this character */
-    Contour *contours;            /* Array of outline contours */
+    std::vector<Contour> contours; /* Outline contours */
     USHORT unitsPerEm;            /* Max units character */
     GlyphIndex myMetrics;         /* Which glyph index this is for metrics */
 };
 
+using SharedGlyphPtr = std::shared_ptr<GlyphStruct>;
+
 struct KernData final
 {
     USHORT left, right;           /* Glyph index of left/right to kern */
@@ -301,7 +308,35 @@ struct longHorMetric final
 };
 
 
-typedef std::map<USHORT, GlyphPtr> GlyphPtrMap;
+typedef std::map<USHORT, SharedGlyphPtr> GlyphPtrMap;
+
+/// Key identifying a glyph in the process-wide glyph cache.
+struct GlyphCacheKey final
+{
+    UCS2String filename;
+    ULONG checkSum;               /* Font checksum, to tell apart different versions of a file */
+    GlyphIndex glyph_index;
+    bool space;                   /* Whether extracted for the space character, which is treated specially */
+
+    bool operator<(const GlyphCacheKey& o) const
+    {
+        return std::tie(filename, checkSum, glyph_index, space) < std::tie(o.filename, o.checkSum, o.glyph_index, o.space);
+    }
+};
+
+/// Process-wide glyph cache.
+///
+/// Glyphs are shared by all text objects using the same font file, across all fonts (i.e. character
+/// mappings) and scenes. The cache only holds weak references, so glyphs are released together with
+/// the last scene using them.
+struct GlyphCache final
+{
+    std::mutex mutex;
+    std::map<GlyphCacheKey, std::weak_ptr<GlyphStruct>> glyphs;
+    size_t purgeSize;             /* Number of entries at which to next purge expired entries */
+
+    GlyphCache() : purgeSize(64) {}
+};
 
 struct CMAPSelector final
 {
@@ -344,6 +379,7 @@ struct TrueTypeInfo final
     USHORT numGlyphs;                 /* How many symbols in this file */
     USHORT unitsPerEm;                /* The "resolution" of this font */
     SHORT indexToLocFormat;           /* 0 - short format, 1 - long format */
+    ULONG checkSumAdjustment;         /* Checksum of the whole font file */
     ULONG *loca_table;                /* Mapping from characters to glyphs */
     GlyphPtrMap glyphsByChar;         /* Cached info for this font */
     GlyphPtrMap glyphsByIndex;        /* Cached info for this font */
@@ -404,6 +440,7 @@ void ProcessKernTable(TrueTypeFont *ffile, int kern_table_offset);
 void ProcessHheaTable(TrueTypeFont *ffile, int hhea_table_offset);
 void ProcessHmtxTable(TrueTypeFont *ffile, int hmtx_table_offset);
 GlyphPtr ProcessCharacter(TrueTypeFont *ffile, UCS4 search_char, GlyphIndex *glyph_index);
+SharedGlyphPtr GetSharedGlyph(TrueTypeFont *ffile, GlyphIndex glyph_index, UCS4 c);
 GlyphIndex ProcessCharMap(TrueTypeFont *ffile, UCS4 search_char);
 
 /// @pre The glyph index shall be 0.
@@ -418,7 +455,7 @@ bool ProcessFormat4Glyph(TrueTypeFont *ffile, GlyphIndex& glyphIndex, int cmapId
 /// @pre If the return value is `false`, the glyph index shall be 0.
 bool ProcessFormat6Glyph(TrueTypeFont *ffile, GlyphIndex& glyphIndex, POV_UINT32 search_codepoint);
 
-GlyphPtr ExtractGlyphInfo(TrueTypeFont *ffile, GlyphIndex glyph_index, UCS4 c);
+SharedGlyphPtr ExtractGlyphInfo(TrueTypeFont *ffile, GlyphIndex glyph_index, UCS4 c);
 GlyphOutline *ExtractGlyphOutline(TrueTypeFont *ffile, GlyphIndex glyph_index, UCS4 c);
 GlyphPtr ConvertOutlineToGlyph(TrueTypeFont *ffile, const GlyphOutline *ttglyph);
 
@@ -1293,6 +1330,7 @@ void ProcessHeadTable(TrueTypeFont *ffile, int head_table_offset)
 
     ffile->info->indexToLocFormat = fontHeader.indexToLocFormat;
     ffile->info->unitsPerEm = fontHeader.unitsPerEm;
+    ffile->info->checkSumAdjustment = fontHeader.checkSumAdjustment;
 }
 
 /* Determine the relative offsets of glyphs */
@@ -1575,7 +1613,7 @@ GlyphPtr ProcessCharacter(TrueTypeFont *ffile, UCS4 search_char, GlyphIndex *gly
         Debug_Info("Cached glyph: %c/%u\n",(char)search_char,(*iGlyph).second->glyph_index);
 #endif
         *glyph_index = (*iGlyph).second->glyph_index;
-        return (*iGlyph).second;
+        return (*iGlyph).second.get();
     }
 
     *glyph_index = ProcessCharMap(ffile, search_char);
@@ -1593,10 +1631,10 @@ GlyphPtr ProcessCharacter(TrueTypeFont *ffile, UCS4 search_char, GlyphIndex *gly
         Debug_Info("Cached glyph: %c/%u\n",(char)search_char,(*iGlyph).second->glyph_index);
 #endif
         *glyph_index = (*iGlyph).second->glyph_index;
-        return (*iGlyph).second;
+        return (*iGlyph).second.get();
     }
 
-    GlyphPtr glyph = ExtractGlyphInfo(ffile, *glyph_index, search_char);
+    SharedGlyphPtr glyph = GetSharedGlyph(ffile, *glyph_index, search_char);
 
     /* Add this glyph to the ones we already know about */
 
@@ -1605,6 +1643,87 @@ GlyphPtr ProcessCharacter(TrueTypeFont *ffile, UCS4 search_char, GlyphIndex *gly
 
     /* Glyph is all built */
 
+    return glyph.get();
+}
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   GetSharedGlyph
+*
+* INPUT
+*
+* OUTPUT
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Get a glyph from the process-wide glyph cache, extracting it from the
+*   font file if no other font or scene using the same file has done so yet.
+*   Built-in fonts have no file name to identify them by, so their glyphs
+*   are not shared.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+static GlyphCache gGlyphCache;
+
+SharedGlyphPtr GetSharedGlyph(TrueTypeFont *ffile, GlyphIndex glyph_index, UCS4 c)
+{
+    if (ffile->filename.empty())
+        return ExtractGlyphInfo(ffile, glyph_index, c);
+
+    GlyphCacheKey key;
+    key.filename = ffile->filename;
+    key.checkSum = ffile->info->checkSumAdjustment;
+    key.glyph_index = glyph_index;
+    key.space = (c == ' ');
+
+    {
+        std::lock_guard<std::mutex> lock(gGlyphCache.mutex);
+
+        auto iGlyph = gGlyphCache.glyphs.find(key);
+        if (iGlyph != gGlyphCache.glyphs.end())
+        {
+            SharedGlyphPtr glyph = iGlyph->second.lock();
+            if (glyph != nullptr)
+                return glyph;
+        }
+    }
+
+    /* Extract the glyph without holding the lock, as this may take a while */
+
+    SharedGlyphPtr glyph = ExtractGlyphInfo(ffile, glyph_index, c);
+
+    std::lock_guard<std::mutex> lock(gGlyphCache.mutex);
+
+    std::weak_ptr<GlyphStruct>& entry = gGlyphCache.glyphs[key];
+    SharedGlyphPtr existing = entry.lock();
+    if (existing != nullptr)
+        return existing; // someone else was faster
+    entry = glyph;
+
+    /* Get rid of glyphs no longer used by any scene */
+
+    if (gGlyphCache.glyphs.size() >= gGlyphCache.purgeSize)
+    {
+        for (auto i = gGlyphCache.glyphs.begin(); i != gGlyphCache.glyphs.end(); )
+        {
+            if (i->second.expired())
+                i = gGlyphCache.glyphs.erase(i);
+            else
+                ++i;
+        }
+        gGlyphCache.purgeSize = std::max<size_t>(64, 2 * gGlyphCache.glyphs.size());
+    }
+
     return glyph;
 }
 
@@ -2059,10 +2178,10 @@ bool ProcessFormat6Glyph(TrueTypeFont *ffile, GlyphIndex& glyphIndex, POV_UINT32
 *   -
 *
 ******************************************************************************/
-GlyphPtr ExtractGlyphInfo(TrueTypeFont *ffile, GlyphIndex glyph_index, UCS4 c)
+SharedGlyphPtr ExtractGlyphInfo(TrueTypeFont *ffile, GlyphIndex glyph_index, UCS4 c)
 {
     GlyphOutline *ttglyph;
-    GlyphPtr glyph;
+    SharedGlyphPtr glyph;
 
     ttglyph = ExtractGlyphOutline(ffile, glyph_index, c);
     POV_SHAPE_ASSERT(ttglyph != nullptr);
@@ -2072,7 +2191,7 @@ GlyphPtr ExtractGlyphInfo(TrueTypeFont *ffile, GlyphIndex glyph_index, UCS4 c)
      * easily processed format
      */
 
-    glyph = ConvertOutlineToGlyph(ffile, ttglyph);
+    glyph = SharedGlyphPtr(ConvertOutlineToGlyph(ffile, ttglyph));
     glyph->glyph_index = glyph_index;
     glyph->myMetrics = ttglyph->myMetrics;
 
@@ -2604,11 +2723,7 @@ GlyphPtr ConvertOutlineToGlyph(TrueTypeFont *ffile, const GlyphOutline *ttglyph)
     glyph = new GlyphStruct;
     if (ttglyph->header.numContours > 0)
     {
-        glyph->contours = new Contour[ttglyph->header.numContours];
-    }
-    else
-    {
-        glyph->contours = nullptr;
+        glyph->contours.resize(ttglyph->header.numContours);
     }
 
     /* Copy sizing information about this glyph */
@@ -2647,6 +2762,13 @@ GlyphPtr ConvertOutlineToGlyph(TrueTypeFont *ffile, const GlyphOutline *ttglyph)
 
         glyph->contours[i].count = j;
 
+        /* Precompute the contour's bounds, so rays can skip it quickly */
+
+        glyph->contours[i].xmin = *std::min_element(glyph->contours[i].x.cbegin(), glyph->contours[i].x.cend());
+        glyph->contours[i].xmax = *std::max_element(glyph->contours[i].x.cbegin(), glyph->contours[i].x.cend());
+        glyph->contours[i].ymin = *std::min_element(glyph->contours[i].y.cbegin(), glyph->contours[i].y.cend());
+        glyph->contours[i].ymax = *std::max_element(glyph->contours[i].y.cbegin(), glyph->contours[i].y.cend());
+
         /*
          * Set last_j to point to the beginning of the next contour's coordinate
          * information
@@ -2682,27 +2804,56 @@ GlyphPtr ConvertOutlineToGlyph(TrueTypeFont *ffile, const GlyphOutline *ttglyph)
     return glyph;
 }
 
+/* Test whether the line a*x + b*y + c = 0 may touch the given bounds, allowing for rounding errors. */
+static inline bool Line_Crosses_Bounds(double a, double b, double c, double xmin, double ymin, double xmax, double ymax)
+{
+    double v[4], tol;
+    int i, pos = 0, neg = 0;
+
+    v[0] = a * xmin + b * ymin + c;
+    v[1] = a * xmax + b * ymin + c;
+    v[2] = a * xmin + b * ymax + c;
+    v[3] = a * xmax + b * ymax + c;
+
+    tol = EPSILON * (fabs(a) * std::max(fabs(xmin), fabs(xmax)) + fabs(b) * std::max(fabs(ymin), fabs(ymax)) + fabs(c));
+
+    for (i = 0; i < 4; i++)
+    {
+        if (v[i] > tol)
+            pos++;
+        else if (v[i] < -tol)
+            neg++;
+    }
+
+    return ((pos < 4) && (neg < 4));
+}
+
 /* Test to see if "point" is inside the splined polygon "points". */
 bool TrueType::Inside_Glyph(double x, double y, const GlyphStruct* glyph) const
 {
     int i, j, k, n, n1, crossings;
     int qi, ri, qj, rj;
-    Contour *contour;
+    const Contour *contour;
     double xt[3], yt[3], roots[2];
-    DBL *xv, *yv;
+    const DBL *xv, *yv;
     double x0, x1, x2, t;
     double y0, y1, y2;
     double m, b, xc;
-    BYTE *fv;
+    const BYTE *fv;
 
     crossings = 0;
 
     n = glyph->header.numContours;
 
-    contour = glyph->contours;
+    contour = glyph->contours.data();
 
     for (i = 0; i < n; i++)
     {
+        /* A contour entirely above, below or left of the point can't cross the test ray */
+
+        if ((y < contour[i].ymin) || (y > contour[i].ymax) || (x > contour[i].xmax + EPSILON))
+            continue;
+
         xv = contour[i].x.data();
         yv = contour[i].y.data();
         fv = contour[i].flags.data();
@@ -2999,7 +3150,7 @@ void TrueType::GetZeroOneHits(const GlyphStruct* glyph, const Vector3d& P, const
  */
 bool TrueType::GlyphIntersect(const Vector3d& P, const Vector3d& D, const GlyphStruct* glyph, DBL glyph_depth, const BasicRay& ray, IStack& Depth_Stack, TraceThreadData *Thread)
 {
-    Contour *contour;
+    const Contour *contour;
     int i, j, k, l, n, m;
     bool Flag = false;
     Vector3d N, IPoint;
@@ -3007,8 +3158,8 @@ bool TrueType::GlyphIntersect(const Vector3d& P, const Vector3d& D, const GlyphS
     double x0, x1, y0, y1, x2, y2, t, t0, t1, z;
     double xt0, xt1, xt2, yt0, yt1, yt2;
     double a, b, c, d0, d1, C[3], S[2];
-    DBL *xv, *yv;
-    BYTE *fv;
+    const DBL *xv, *yv;
+    const BYTE *fv;
     int dirflag = 0;
 
     /*
@@ -3081,8 +3232,13 @@ bool TrueType::GlyphIntersect(const Vector3d& P, const Vector3d& D, const GlyphS
 
     n = glyph->header.numContours;
 
-    for (i = 0, contour = glyph->contours; i < n; i++, contour++)
+    for (i = 0, contour = glyph->contours.data(); i < n; i++, contour++)
     {
+        /* Skip the contour if the ray passes it by, i.e. all corners of its bounds are on the same side */
+
+        if (!Line_Crosses_Bounds(a, b, c, contour->xmin, contour->ymin, contour->xmax, contour->ymax))
+            continue;
+
         xv = contour->x.data();
         yv = contour->y.data();
         fv = contour->flags.data();
@@ -3222,7 +3378,7 @@ bool TrueType::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThrea
 {
     Vector3d P, D;
 
-    Thread->Stats()[Ray_TTF_Tests]++;
+    Thread->Stats().Shape(Ray_TTF_Tests)++;
 
     /* Transform the point into the glyph's space */
 
@@ -3241,7 +3397,7 @@ bool TrueType::All_Intersections(const Ray& ray, IStack& Depth_Stack, TraceThrea
 
     if (GlyphIntersect(P, D, glyph, depth, ray, Depth_Stack, Thread)) /* tw */
     {
-        Thread->Stats()[Ray_TTF_Tests_Succeeded]++;
+        Thread->Stats().Shape(Ray_TTF_Tests_Succeeded)++;
         return true;
     }
 
@@ -3444,6 +3600,7 @@ TrueTypeInfo::TrueTypeInfo() :
     numGlyphs(0),
     unitsPerEm(0),
     indexToLocFormat(0),
+    checkSumAdjustment(0),
     loca_table(nullptr),
     numberOfHMetrics(0),
     hmtx_table(nullptr)
@@ -3457,13 +3614,6 @@ TrueTypeInfo::~TrueTypeInfo()
     if (loca_table != nullptr)
         delete[] loca_table;
 
-    for (GlyphPtrMap::iterator iGlyph = glyphsByIndex.begin(); iGlyph != glyphsByIndex.end(); ++iGlyph)
-    {
-        if ((*iGlyph).second->contours != nullptr)
-            delete[] (*iGlyph).second->contours;
-        delete (*iGlyph).second;
-    }
-
     if (kerning_tables.tables != nullptr)
     {
         for (int i = 0; i < kerning_tables.nTables; i++)
@@ -70,6 +70,13 @@ class UVMeshable
          * \param[out] r retrieved maximal values
          */
         virtual void maxUV( Vector2d& r )const=0;
+        /**
+         * get texture coordinates for u,v values
+         * \param[out] r computed texture coordinates
+         * \param[in] u value of u
+         * \param[in] v value of v
+         */
+        virtual void evalUV( Vector2d& r, const DBL u, const DBL v )const { r[U] = u; r[V] = v; }
 };
 }
 #endif
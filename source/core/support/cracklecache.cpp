@@ -37,9 +37,12 @@
 #include "core/support/cracklecache.h"
 
 // C++ variants of C standard header files
-// C++ standard header files
 //  (none at the moment)
 
+// C++ standard header files
+#include <algorithm>
+#include <iterator>
+
 // POV-Ray header files (base module)
 // POV-Ray header files (core module)
 // POV-Ray header files (parser module)
@@ -51,100 +54,67 @@
 namespace pov
 {
 
-CrackleCache::CrackleCache() :
-    mPruneCounter(0)
+CrackleCache::CrackleCache(std::size_t maxBytes)
+{
+    // Account for the list node and the index entry in addition to the payload.
+    // Note that the memory is split evenly between the shards, so we allow for
+    // at least one entry per shard even with a tiny limit.
+    std::size_t entryBytes = sizeof(CrackleCacheEntry) + 4 * sizeof(void*) + sizeof(CrackleCacheIndex::value_type);
+    mMaxEntriesPerShard = std::max<std::size_t>(1, maxBytes / entryBytes / kShardCount);
+
+    for (auto& shard : mShards)
+        shard.index.reserve(mMaxEntriesPerShard);
+}
+
+CrackleCache::Shard& CrackleCache::GetShard(const CrackleCellCoord& coord)
 {
-    // Advise the unordered_map that we don't mind hash collisions.
-    // While this is a very high load factor, the simple fact is that the cost of
-    // allocating memory at render time (each insert into the table requires an alloc
-    // as the container doesn't pre-emptively allocate, unlike e.g. std::vector) is
-    // quite high, particularly when we have multiple threads contending for the heap
-    // lock.
-    mData.max_load_factor(50.0);
+    // Mix the hash a bit more, so that neighbouring cells end up in different shards.
+    std::size_t h = hash_value(coord);
+    h ^= (h >> 17);
+    h *= 0x9E3779B9u;
+    return mShards[(h >> 7) % kShardCount];
 }
 
-bool CrackleCache::Lookup(CrackleCacheEntryPtr& entry, const CrackleCellCoord& coord)
+bool CrackleCache::Lookup(CrackleCacheEntry& entry, const CrackleCellCoord& coord)
 {
-    // search for this hash value in the cache
-    CrackleCacheData::iterator iter = mData.find(coord);
-    bool found = (iter != mData.end());
+    Shard& shard = GetShard(coord);
+    std::lock_guard<std::mutex> lock(shard.mutex);
 
-    if (!found)
-    {
-        // Not in cache.
-
-        // If cache is already excessively large; refrain from creating a new entry.
-        // Having to re-calculate entries that would have been cache hits had we not
-        // skipped on adding an entry is less expensive than chewing up immense amounts
-        // of RAM and finally hitting the swapfile. unfortunately there's no good way
-        // to tell how much memory is 'too much' for the cache, so we just use a hard-
-        // coded number for now (ideally we should allow the user to configure this).
-        // keep in mind that the cache memory usage is per-thread, so the more threads,
-        // the more RAM. If we don't do the insert, `entry` will remain unchanged.
-        if (mData.size() * sizeof(CrackleCacheData::value_type) >= 30 * 1024 * 1024)
-            return false;
-
-        // Generate a new cache entry.
-        iter = mData.insert(mData.end(), CrackleCacheData::value_type(coord, CrackleCacheEntry()));
-        entry = &iter->second;
-        entry->lastUsed = mPruneCounter;
+    CrackleCacheIndex::iterator iter = shard.index.find(coord);
+    if (iter == shard.index.end())
         return false;
-    }
-    else
-    {
-        entry = &iter->second;
-        // NB: We're deliberately _not_ updating `entry->lastUsed` here, as that
-        // seems to be counter-productive to performance.
-        return true;
-    }
+
+    // Mark as most recently used.
+    shard.entries.splice(shard.entries.begin(), shard.entries, iter->second);
+    entry = *iter->second;
+    return true;
 }
 
-void CrackleCache::Prune()
+unsigned int CrackleCache::Store(const CrackleCacheEntry& entry)
 {
-    CrackleCacheData::iterator it;
-
-    // This serves as a kind of "clock" to track age of cache entries.
-    ++mPruneCounter;
-
-    // Probably we ought to have a means for the end-user to choose the preferred maximum bytes reserved for the cache.
-    // For now, we have hard-coded values. we also do not discard any entries that are from the current block, even if
-    // the cache size is exceeded. also, note that the cache size is per-thread. finally, don't forget that erasing
-    // elements doesn't in and of itself return the freed memory to the heap.
-
-    // Don't go through the hassle of pruning unless the cache has reached a certain size.
-    if (mData.size() * sizeof(CrackleCacheData::value_type) < 15 * 1024 * 1024 / 64)
-        return;
-
-    // If we're pruning, aim for a somewhat lower size.
-    // Traverse the map to determine the oldest age, then traverse it again to
-    // throw away all entries with that age. Rinse, repeat.
-    // TODO - This salami approach - cutting away one slice at a time - seems
-    //        inefficient; instead, from the oldest age we should probably be
-    //        able to guesstimate a cut-off age that will get us close to the
-    //        desired cache size, and then throw away everything older than
-    //        that in a single pass.
-    while (mData.size() * sizeof(CrackleCacheData::value_type) > 10 * 1024 * 1024 / 64)
+    Shard& shard = GetShard(entry.coord);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    unsigned int evicted = 0;
+
+    // Another thread may have computed the same entry in the meantime.
+    if (shard.index.find(entry.coord) != shard.index.end())
+        return 0;
+
+    if (shard.index.size() >= mMaxEntriesPerShard)
     {
-        // search the cache for the oldest entries
-        int oldest = std::numeric_limits<int>::max();
-        for (it = mData.begin(); it != mData.end(); it++)
-            if (it->second.lastUsed < oldest)
-                oldest = (int)it->second.lastUsed;
-
-        // don't remove any entries from the most recent block
-        if (oldest == mPruneCounter)
-            break;
-
-        for (it = mData.begin(); it != mData.end(); )
-        {
-            if (it->second.lastUsed == oldest)
-            {
-                it = mData.erase(it);
-                continue;
-            }
-            it++;
-        }
+        // Evict the least recently used entry, recycling its list node to avoid
+        // hitting the heap at render time.
+        CrackleCacheList::iterator oldest = std::prev(shard.entries.end());
+        shard.index.erase(oldest->coord);
+        shard.entries.splice(shard.entries.begin(), shard.entries, oldest);
+        *oldest = entry;
+        ++evicted;
     }
+    else
+        shard.entries.push_front(entry);
+
+    shard.index.emplace(entry.coord, shard.entries.begin());
+    return evicted;
 }
 
 }
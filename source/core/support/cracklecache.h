@@ -41,9 +41,11 @@
 #include "core/support/cracklecache_fwd.h"
 
 // C++ variants of C standard header files
-//  (none at the moment)
+#include <cstddef>
 
 // C++ standard header files
+#include <list>
+#include <mutex>
 #include <unordered_map>
 
 // Boost header files
@@ -75,7 +77,8 @@ public:
 
     bool operator==(CrackleCellCoord const& other) const
     {
-        return mX == other.mX && mY == other.mY && mZ == other.mZ;
+        return mX == other.mX && mY == other.mY && mZ == other.mZ &&
+               mRepeatX == other.mRepeatX && mRepeatY == other.mRepeatY && mRepeatZ == other.mRepeatZ;
     }
 
     /// Function to compute a hash value from the coordinates.
@@ -92,6 +95,9 @@ public:
         boost::hash_combine(seed, coord.mX);
         boost::hash_combine(seed, coord.mY);
         boost::hash_combine(seed, coord.mZ);
+        boost::hash_combine(seed, coord.mRepeatX);
+        boost::hash_combine(seed, coord.mRepeatY);
+        boost::hash_combine(seed, coord.mRepeatZ);
 
         return seed;
     }
@@ -120,47 +126,73 @@ protected:
 /// Helper class to implement the crackle cache.
 struct CrackleCacheEntry final
 {
-    /// A kind of timestamp specifying when this particular entry was last used.
-    size_t lastUsed;
+    /// The cell this entry belongs to.
+    CrackleCellCoord coord;
+
+    /// Whether the entry has been filled in.
+    bool valid;
 
     /// The pseudo-random points defining the pattern in this particular subset of 3D space.
     Vector3d aCellNuclei[81];
+
+    CrackleCacheEntry() : valid(false) {}
 };
-using CrackleCacheEntryPtr = CrackleCacheEntry*;
 
 //******************************************************************************
 
 /// Crackle cache.
 ///
 /// This class buffers the pseudorandom "seeds points" for the Voronoi-based
-/// crackle pattern.
+/// crackle pattern. A single instance is shared by all render threads of a
+/// scene; to keep lock contention low, it is split into a number of shards,
+/// each guarded by its own mutex and each evicting its least recently used
+/// entries once its share of the memory limit is reached.
+///
+/// Entries are copied in and out of the cache, so that threads never hold on
+/// to data that another thread might evict.
 ///
 class CrackleCache final
 {
 public:
 
+    /// Default memory limit in bytes.
+    static const std::size_t kDefaultMaxBytes = 64 * 1024 * 1024;
+
     /// Construct a new crackle cache.
-    CrackleCache();
+    /// @param[in]  maxBytes    Approximate memory limit in bytes.
+    explicit CrackleCache(std::size_t maxBytes = kDefaultMaxBytes);
 
     /// Look up cache entry.
-    /// If the queried entry is not currently in the cache, an empty entry is
-    /// automatically created, unless the cache has reached an excessive size.
-    /// @param[out] entry   Pointer to cache entry, or unchanged if not in cache.
+    /// @param[out] entry   Entry to copy the cached data to, or unchanged if not in cache.
     /// @param[in]  coord   Crackle cell coordinates.
-    /// @return             `true` if entry already existed, `false` otherwise.
-    bool Lookup(CrackleCacheEntryPtr& entry, const CrackleCellCoord& coord);
+    /// @return             `true` if the entry was found, `false` otherwise.
+    bool Lookup(CrackleCacheEntry& entry, const CrackleCellCoord& coord);
 
-    /// Prune the crackle cache.
-    /// This function is intended to be called at regular intervals to remove
-    /// the least recently used entries from the cache to keep it reasonably
-    /// lean and fast.
-    void Prune();
+    /// Add an entry to the cache.
+    /// If the cache has reached its memory limit, the least recently used entries are evicted.
+    /// @param[in]  entry   Entry to copy into the cache.
+    /// @return             Number of entries evicted.
+    unsigned int Store(const CrackleCacheEntry& entry);
 
 private:
 
-    using CrackleCacheData = std::unordered_map<CrackleCellCoord, CrackleCacheEntry, boost::hash<CrackleCellCoord>>;
-    CrackleCacheData mData;
-    std::size_t mPruneCounter;
+    static const int kShardCount = 64;
+
+    using CrackleCacheList = std::list<CrackleCacheEntry>;
+    using CrackleCacheIndex = std::unordered_map<CrackleCellCoord, CrackleCacheList::iterator, boost::hash<CrackleCellCoord>>;
+
+    struct Shard final
+    {
+        std::mutex          mutex;
+        /// Entries ordered from most to least recently used.
+        CrackleCacheList    entries;
+        CrackleCacheIndex   index;
+    };
+
+    Shard mShards[kShardCount];
+    std::size_t mMaxEntriesPerShard;
+
+    Shard& GetShard(const CrackleCellCoord& coord);
 };
 
 }
@@ -48,6 +48,7 @@ namespace pov
 {
 
 class CrackleCache;
+struct CrackleCacheEntry;
 
 }
 // end of namespace pov
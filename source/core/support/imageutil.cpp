@@ -45,12 +45,14 @@
 #include "base/povassert.h"
 #include "base/image/encoding.h"
 #include "base/image/image.h"
+#include "base/image/imagecache.h"
 
 // POV-Ray header files (core module)
 #include "core/colour/spectral.h"
 #include "core/material/normal.h"
 #include "core/material/pattern.h"
 #include "core/material/texture.h"
+#include "core/support/texturecache.h"
 
 #ifdef SYS_IMAGE_HEADER
 #include SYS_IMAGE_HEADER
@@ -92,6 +94,7 @@ static int torus_image_map(const Vector3d& EPoint, const ImageData *image, DBL *
 static int spherical_image_map(const Vector3d& EPoint, const ImageData *image, DBL *u, DBL *v);
 static int planar_image_map(const Vector3d& EPoint, const ImageData *image, DBL *u, DBL *v);
 static int angular_image_map(const Vector3d& EPoint, const ImageData *image, DBL *u, DBL  *v);
+static void pixel_position(const ImageData *image, DBL xcoor, DBL ycoor, int& ixcoor, int& iycoor);
 static void no_interpolation(const ImageData *image, DBL xcoor, DBL ycoor, RGBFTColour& colour, int *index, bool premul);
 static void bilinear(DBL *factors, DBL x, DBL y);
 static void norm_dist(DBL *factors, DBL x, DBL y);
@@ -207,6 +210,7 @@ void bump_map(const Vector3d& EPoint, const TNORMAL *Tnormal, Vector3d& normal)
     POV_PATTERN_ASSERT(pattern);
 
     image = pattern->pImage;
+    Resolve_Image(image);
 
     // going to have to change this
     // need to know if bump point is off of image for all 3 points
@@ -366,6 +370,93 @@ DBL image_pattern(const Vector3d& EPoint, const ImagePattern* pPattern)
 }
 
 
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   image_pattern_gradient
+*
+* INPUT
+*
+*   EPoint -- The point in 3d space at which the pattern is evaluated.
+*
+* OUTPUT
+*
+*   value    -- The pattern value, as computed by image_pattern().
+*   gradient -- The derivative of the bilinearly interpolated image.
+*
+* RETURNS
+*
+*   false if the gradient cannot be computed analytically for this image.
+*
+* DESCRIPTION
+*
+*   Only planar repeating images using bilinear interpolation, no palette and
+*   no transparency are supported; anything else is left to the caller's
+*   finite differences.
+*
+******************************************************************************/
+
+bool image_pattern_gradient(DBL& value, Vector3d& gradient, const Vector3d& EPoint, const ImagePattern* pPattern)
+{
+    const ImageData *image = pPattern->pImage;
+    DBL xcoor = 0.0, ycoor = 0.0;
+    RGBFTColour colour;
+
+    Resolve_Image(image);
+
+    if ((image->Map_Type != PLANAR_MAP) || (image->Interpolation_Type != BILINEAR) || image->Once_Flag ||
+        (image->Use == USE_ALPHA) || image->data->IsIndexed() || image->data->HasTransparency())
+        return false;
+
+    if (map_pos(EPoint, image, &xcoor, &ycoor))
+        return false;
+
+    value = image_pattern(EPoint, pPattern);
+    gradient = Vector3d(0.0);
+    if ((value <= 0.0) || (value >= 1.0))
+        return true; // clamped
+
+    // Same corner pixels and weights as used by Interp().
+    DBL x = xcoor + 0.5;
+    DBL y = ycoor + 0.5;
+    int ix = (int)x;
+    int iy = (int)y;
+    DBL p = x - ix;
+    DBL q = y - iy;
+    DBL corner[4];
+    const int dx[4] = { 0, -1,  0, -1 };
+    const int dy[4] = { 0,  0, -1, -1 };
+
+    for (int i = 0; i < 4; i++)
+    {
+        image->data->GetRGBFTValue((int)wrap((DBL)(ix + dx[i]), (DBL)image->iwidth),
+                                   (int)wrap((DBL)(iy + dy[i]), (DBL)image->iheight), colour, false);
+        corner[i] = colour.Greyscale();
+    }
+
+    DBL dValueDx = q * (corner[0] - corner[1]) + (1.0 - q) * (corner[2] - corner[3]);
+    DBL dValueDy = p * (corner[0] - corner[2]) + (1.0 - p) * (corner[1] - corner[3]);
+
+    // Chain rule for planar_image_map() and map_pos(); as there, the last axis
+    // mapped to either image coordinate wins, and the image's y axis is upside down.
+    int uAxis = -1, vAxis = -1;
+    for (int i = X; i <= Z; i++)
+    {
+        if (image->Gradient[i] > 0.0)
+            uAxis = i;
+        else if (image->Gradient[i] < 0.0)
+            vAxis = i;
+    }
+    if (uAxis >= 0)
+        gradient[uAxis] = dValueDx * image->width;
+    if (vAxis >= 0)
+        gradient[vAxis] = -dValueDy * image->height;
+
+    return true;
+}
+
+
 /*****************************************************************************
 *
 * FUNCTION
@@ -390,13 +481,21 @@ void image_colour_at(const ImageData *image, DBL xcoor, DBL ycoor, RGBFTColour&
 
     // As the caller isn't sure whether to prefer premultiplied or non-premultiplied alpha,
     // we'll just give him what the original image source provided.
+    Resolve_Image(image);
     image_colour_at(image, xcoor, ycoor, colour, index, image->data->IsPremultiplied());
 }
 
 void image_colour_at(const ImageData *image, DBL xcoor, DBL ycoor, RGBFTColour& colour, int *index, bool premul)
+{
+    image_colour_at(image, xcoor, ycoor, 0.0, nullptr, colour, index, premul);
+}
+
+void image_colour_at(const ImageData *image, DBL xcoor, DBL ycoor, DBL lod, TextureCache *textureCache, RGBFTColour& colour, int *index, bool premul)
 {
     *index = -1;
 
+    Resolve_Image(image);
+
     bool doProperTransmitAll = image->data->HasTransparency() &&
                                !image->AllTransmitLegacyMode &&
                                !image->data->IsIndexed() && ( (image->AllTransmit != 0.0) || (image->AllFilter != 0.0) );
@@ -407,19 +506,28 @@ void image_colour_at(const ImageData *image, DBL xcoor, DBL ycoor, RGBFTColour&
     bool getPremul = doProperTransmitAll ? (premul && image->data->IsPremultiplied()) :
                                            (premul || image->data->IsPremultiplied());
 
-    switch(image->Interpolation_Type)
+    bool havePremul = getPremul;
+
+    // Use the reduced resolution versions of the image if the footprint is larger than a pixel;
+    // these always come with premultiplied alpha.
+    if ((lod > 0.0) && (textureCache != nullptr) && !image->data->IsIndexed() &&
+        textureCache->Sample(image, xcoor, ycoor, lod, colour))
+        havePremul = true;
+    else
     {
-        case NO_INTERPOLATION:
-            no_interpolation(image, xcoor, ycoor, colour, index, getPremul);
-            break;
-        case BICUBIC:
-            InterpolateBicubic(image, xcoor, ycoor, colour, index, getPremul);
-            break;
-        default:
-            Interp(image, xcoor, ycoor, colour, index, getPremul);
-            break;
+        switch(image->Interpolation_Type)
+        {
+            case NO_INTERPOLATION:
+                no_interpolation(image, xcoor, ycoor, colour, index, getPremul);
+                break;
+            case BICUBIC:
+                InterpolateBicubic(image, xcoor, ycoor, colour, index, getPremul);
+                break;
+            default:
+                Interp(image, xcoor, ycoor, colour, index, getPremul);
+                break;
+        }
     }
-    bool havePremul = getPremul;
 
     if (!premul && havePremul)
     {
@@ -484,6 +592,8 @@ HF_VAL image_height_at(const ImageData *image, int x, int y)
 
     RGBColour colour;
 
+    Resolve_Image(image);
+
     // for 8-bit indexed images, use the index (scaled to match short int range)
     if (image->data->IsIndexed())
         return ((HF_VAL)image->data->GetIndexedValue(x, y) * 256);
@@ -529,6 +639,11 @@ HF_VAL image_height_at(const ImageData *image, int x, int y)
 
 bool is_image_opaque(const ImageData *image)
 {
+    // Don't force a deferred decoder to run just for this; err on the safe side instead.
+    if (image->Pending.load(std::memory_order_acquire) && image->Decoder->IsDeferred())
+        return false;
+
+    Resolve_Image(image);
     return image->data->IsOpaque();
 }
 
@@ -931,6 +1046,8 @@ static int planar_image_map(const Vector3d& EPoint, const ImageData *image, DBL
 
 int map_pos(const Vector3d& EPoint, const ImageData* image, DBL *xcoor, DBL *ycoor)
 {
+    Resolve_Image(image);
+
     // Determine which mapper to use.
 
     switch(image->Map_Type)
@@ -998,10 +1115,10 @@ int map_pos(const Vector3d& EPoint, const ImageData* image, DBL *xcoor, DBL *yco
 *
 ******************************************************************************/
 
-static void no_interpolation(const ImageData *image, DBL xcoor, DBL ycoor, RGBFTColour& colour, int *index, bool premul)
-{
-    int iycoor, ixcoor;
+// Compute the pixel to sample for the given (unwrapped) image coordinates
 
+static void pixel_position(const ImageData *image, DBL xcoor, DBL ycoor, int& ixcoor, int& iycoor)
+{
     if(image->Once_Flag)
     {
         // image is to be seen only once, so when taking samples for interpolation
@@ -1030,8 +1147,48 @@ static void no_interpolation(const ImageData *image, DBL xcoor, DBL ycoor, RGBFT
         ixcoor = (int)wrap(xcoor, (DBL)image->iwidth);
         iycoor = (int)wrap(ycoor, (DBL)image->iheight);
     }
+}
+
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+* INPUT
+*
+* OUTPUT
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+* CHANGES
+*
+******************************************************************************/
 
-    image->data->GetRGBFTValue(ixcoor, iycoor, colour, premul);
+static void no_interpolation(const ImageData *image, DBL xcoor, DBL ycoor, RGBFTColour& colour, int *index, bool premul)
+{
+    int iycoor, ixcoor;
+
+    pixel_position(image, xcoor, ycoor, ixcoor, iycoor);
+
+    if (!image->LinearData.empty())
+    {
+        const float *pixel = &image->LinearData[(ixcoor + iycoor * size_t(image->iwidth)) * 5];
+        colour = RGBFTColour(pixel[0], pixel[1], pixel[2], pixel[3], pixel[4]);
+        if (image->data->HasTransparency() && (premul != image->data->IsPremultiplied()))
+        {
+            if (premul)
+                AlphaPremultiply(colour);
+            else
+                AlphaUnPremultiply(colour);
+        }
+    }
+    else
+        image->data->GetRGBFTValue(ixcoor, iycoor, colour, premul);
 
     if(image->data->IsIndexed() == false)
     {
@@ -1084,11 +1241,6 @@ static void Interp(const ImageData *image, DBL xcoor, DBL ycoor, RGBFTColour& co
     iycoor = (int)ycoor;
     ixcoor = (int)xcoor;
 
-    no_interpolation(image, (DBL)ixcoor,     (DBL)iycoor,     Corner_Colour[0], &Corners_Index[0], premul);
-    no_interpolation(image, (DBL)ixcoor - 1, (DBL)iycoor,     Corner_Colour[1], &Corners_Index[1], premul);
-    no_interpolation(image, (DBL)ixcoor,     (DBL)iycoor - 1, Corner_Colour[2], &Corners_Index[2], premul);
-    no_interpolation(image, (DBL)ixcoor - 1, (DBL)iycoor - 1, Corner_Colour[3], &Corners_Index[3], premul);
-
     if(image->Interpolation_Type == BILINEAR)
         bilinear(Corner_Factors, xcoor, ycoor);
     else if(image->Interpolation_Type == NORMALIZED_DIST)
@@ -1096,6 +1248,34 @@ static void Interp(const ImageData *image, DBL xcoor, DBL ycoor, RGBFTColour& co
     else
         POV_ASSERT(false);
 
+    if (!image->LinearData.empty() && !image->AllTransmitLegacyMode &&
+        !(image->data->HasTransparency() && (premul != image->data->IsPremultiplied())))
+    {
+        // Pre-decoded data that needs no per-pixel adjustment; fetch the corners directly from
+        // the linear pixel array, and blend all channels in a single loop.
+        int x[2], y[2];
+        pixel_position(image, (DBL)ixcoor,     (DBL)iycoor,     x[0], y[0]);
+        pixel_position(image, (DBL)ixcoor - 1, (DBL)iycoor - 1, x[1], y[1]);
+        const float *corner[4] = {
+            &image->LinearData[(x[0] + y[0] * size_t(image->iwidth)) * 5],
+            &image->LinearData[(x[1] + y[0] * size_t(image->iwidth)) * 5],
+            &image->LinearData[(x[0] + y[1] * size_t(image->iwidth)) * 5],
+            &image->LinearData[(x[1] + y[1] * size_t(image->iwidth)) * 5]
+        };
+        DBL channel[5];
+        for (int c = 0; c < 5; ++c)
+            channel[c] = corner[0][c] * Corner_Factors[0] + corner[1][c] * Corner_Factors[1] +
+                         corner[2][c] * Corner_Factors[2] + corner[3][c] * Corner_Factors[3];
+        colour = RGBFTColour(PreciseRGBFTColour(channel[0], channel[1], channel[2], channel[3], channel[4]));
+        *index = -1;
+        return;
+    }
+
+    no_interpolation(image, (DBL)ixcoor,     (DBL)iycoor,     Corner_Colour[0], &Corners_Index[0], premul);
+    no_interpolation(image, (DBL)ixcoor - 1, (DBL)iycoor,     Corner_Colour[1], &Corners_Index[1], premul);
+    no_interpolation(image, (DBL)ixcoor,     (DBL)iycoor - 1, Corner_Colour[2], &Corners_Index[2], premul);
+    no_interpolation(image, (DBL)ixcoor - 1, (DBL)iycoor - 1, Corner_Colour[3], &Corners_Index[3], premul);
+
     // We're using double precision for the colors here to avoid higher-than-1.0 results due to rounding errors,
     // which would otherwise lead to stray dot artifacts when clamped to [0..1] range for a color_map or similar.
     // (Note that strictly speaking we don't avoid such rounding errors, but rather make them small enough that
@@ -1314,7 +1494,9 @@ ImageData::ImageData() :
     Offset(0.0, 0.0),
     AllFilter(0.0), AllTransmit(0.0),
     Object(nullptr),
-    data(nullptr)
+    data(nullptr),
+    Pending(false),
+    Memory(pov_base::kMemory_ImageMap)
 #ifdef POV_VIDCAP_IMPL
     // beta-test feature
     ,VidCap(nullptr)
@@ -1323,6 +1505,249 @@ ImageData::ImageData() :
 
 
 
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Precompute_Image
+*
+* INPUT
+*
+*   image - image to precompute
+*
+* OUTPUT
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Decodes the pixel data of an image to linear single-precision RGBFT once,
+*   so that subsequent lookups by image_colour_at() need neither a virtual
+*   per-pixel fetch nor a gamma decoding step. Indexed images are left alone,
+*   as their palette already holds decoded values.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+void Precompute_Image(ImageData *image)
+{
+#ifdef POV_VIDCAP_IMPL
+    // beta-test feature
+    if (image->VidCap != nullptr)
+        return;
+#endif
+
+    if ((image->data == nullptr) || image->data->IsIndexed())
+        return;
+
+    image->LinearData.resize(size_t(image->iwidth) * size_t(image->iheight) * 5);
+
+    float *pixel = image->LinearData.data();
+    for (int y = 0; y < image->iheight; ++y)
+    {
+        for (int x = 0; x < image->iwidth; ++x, pixel += 5)
+            image->data->GetRGBFTValue(x, y, pixel[0], pixel[1], pixel[2], pixel[3], pixel[4]);
+    }
+}
+
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Account_Image_Memory
+*
+* INPUT
+*
+*   image - image whose data has been loaded
+*
+* OUTPUT
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Reports the memory occupied by the pixel data of an image to the memory
+*   accounting.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+void Account_Image_Memory(ImageData *image)
+{
+    POV_ULONG size = image->LinearData.capacity() * sizeof(float);
+
+    if (image->data != nullptr)
+        size += EstimateImageMemory(image->data);
+
+    image->Memory.Set(size);
+}
+
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Resolve_Pending_Image
+*
+* INPUT
+*
+*   image - image whose decoder has yet to be consulted
+*
+* OUTPUT
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Obtains the pixel data of an image from its decoder, waiting for a helper
+*   thread to finish decoding or doing the job on the calling thread as
+*   necessary, and fills in the image dimensions. Any number of threads may
+*   call this concurrently; the first to get here does the job, and all others
+*   wait for it to finish. Should decoding fail, the exception is re-thrown,
+*   and the next caller will try again.
+*
+*   Use the inline function Resolve_Image() instead of calling this directly.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+void Resolve_Pending_Image(const ImageData *constImage)
+{
+    // The image data is logically part of the image, even if it arrives late.
+    ImageData *image = const_cast<ImageData*>(constImage);
+
+    std::call_once(image->ResolveOnce, [image]()
+    {
+        std::shared_ptr<Image> data = image->Decoder->TakeImage();
+        if (data == nullptr)
+            throw POV_EXCEPTION(kFileDataErr, "Cannot read image.");
+
+        image->SharedData = data;
+        image->data    = data.get();
+        image->iwidth  = data->GetWidth();
+        image->iheight = data->GetHeight();
+        image->width   = (SNGL) image->iwidth;
+        image->height  = (SNGL) image->iheight;
+
+        if (image->Decoder->IsPrecomputed())
+            Precompute_Image(image);
+
+        Account_Image_Memory(image);
+
+        image->Pending.store(false, std::memory_order_release);
+    });
+}
+
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   ImageDecodeTask
+*
+* INPUT
+*
+* OUTPUT
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Image decoding job that may be run on whichever thread gets to it first.
+*   Errors are captured and handed over to the thread that takes the image.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+ImageDecodeTask::ImageDecodeTask(Decoder&& decoder, bool precompute, bool deferred) :
+    mDecoder(std::move(decoder)),
+    mStarted(false),
+    mDone(false),
+    mPrecompute(precompute),
+    mDeferred(deferred)
+{}
+
+ImageDecodeTask::~ImageDecodeTask()
+{}
+
+void ImageDecodeTask::Run()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mStarted)
+            return;
+        mStarted = true;
+    }
+
+    std::shared_ptr<Image> image;
+    std::exception_ptr error;
+    std::vector<std::string> warnings;
+
+    try
+    {
+        image = mDecoder(warnings);
+    }
+    catch (...)
+    {
+        error = std::current_exception();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mImage    = image;
+        mError    = error;
+        mWarnings = std::move(warnings);
+        mDone     = true;
+        // Let go of the decoder, and with it the input file.
+        mDecoder  = Decoder();
+    }
+    mFinished.notify_all();
+}
+
+bool ImageDecodeTask::Wait()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    mFinished.wait(lock, [this]() { return mDone; });
+    return !mError;
+}
+
+std::shared_ptr<Image> ImageDecodeTask::TakeImage()
+{
+    Run();
+    (void)Wait();
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mError)
+        std::rethrow_exception(mError);
+    return std::move(mImage);
+}
+
+
+
 /*****************************************************************************
 *
 * FUNCTION
@@ -1401,7 +1826,7 @@ ImageData::~ImageData()
         delete VidCap;
 #endif
 
-    if (data != nullptr)
+    if ((data != nullptr) && (SharedData == nullptr))
         delete data;
 }
 
@@ -41,16 +41,27 @@
 #include "core/configcore.h"
 
 // C++ variants of C standard header files
-// C++ standard header files
 //  (none at the moment)
 
+// C++ standard header files
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
 // POV-Ray header files (base module)
+#include "base/pov_mem.h"
 #include "base/image/image_fwd.h"
 
 // POV-Ray header files (core module)
 #include "core/coretypes.h"
 #include "core/material/pattern_fwd.h"
 #include "core/math/vector.h"
+#include "core/support/texturecache_fwd.h"
 
 namespace pov
 {
@@ -101,6 +112,59 @@ enum
     USE_ALPHA        = 3
 };
 
+/// Decoder for an image file whose data is not needed right away.
+///
+/// The parser wraps the reading of an image file in an instance of this class, so that the actual
+/// decoding can be delegated to a helper thread, or deferred until the image data is first accessed.
+/// Whichever thread gets to call @ref Run() first does the decoding; all others just wait for it.
+///
+class ImageDecodeTask final
+{
+    public:
+        typedef std::function<std::shared_ptr<Image>(std::vector<std::string>& warnings)> Decoder;
+
+        /// @param[in]  decoder     Function to read the image file.
+        /// @param[in]  precompute  Whether to run @ref Precompute_Image() once the data has arrived.
+        /// @param[in]  deferred    Whether decoding is deferred until first access, rather than
+        ///                         delegated to a helper thread.
+        ImageDecodeTask(Decoder&& decoder, bool precompute, bool deferred);
+        ~ImageDecodeTask();
+
+        ImageDecodeTask(const ImageDecodeTask&) = delete;
+        ImageDecodeTask& operator=(const ImageDecodeTask&) = delete;
+
+        /// Decode the image, unless already done or in progress.
+        void Run();
+
+        /// Wait for decoding to finish, without running the decoder on the calling thread.
+        /// @return     `true` if the image was decoded successfully.
+        bool Wait();
+
+        /// Get the decoded image, running the decoder on the calling thread if nobody has yet.
+        /// The task lets go of the image; this may be done only once.
+        /// @note   Any exception thrown by the decoder is re-thrown here.
+        std::shared_ptr<Image> TakeImage();
+
+        /// Warnings issued by the decoder; valid once @ref Wait() or @ref TakeImage() has returned.
+        const std::vector<std::string>& GetWarnings() const { return mWarnings; }
+
+        bool IsDeferred() const { return mDeferred; }
+        bool IsPrecomputed() const { return mPrecompute; }
+
+    private:
+
+        Decoder                     mDecoder;
+        std::mutex                  mMutex;
+        std::condition_variable     mFinished;
+        bool                        mStarted;
+        bool                        mDone;
+        std::shared_ptr<Image>      mImage;
+        std::exception_ptr          mError;
+        std::vector<std::string>    mWarnings;
+        bool                        mPrecompute;
+        bool                        mDeferred;
+};
+
 class ImageData final
 {
     public:
@@ -117,6 +181,15 @@ class ImageData final
         COLC AllFilter, AllTransmit;
         void *Object;
         Image *data;
+        std::shared_ptr<Image> SharedData; ///< Owner of @ref data if possibly shared with other images, or null if owned outright.
+        std::vector<float> LinearData; ///< Pixel data decoded to linear RGBFT by @ref Precompute_Image(), or empty.
+
+        /// Decoder yet to deliver @ref data, @ref iwidth and @ref iheight, or null.
+        /// @note Use @ref Resolve_Image() before accessing any of those.
+        std::shared_ptr<ImageDecodeTask> Decoder;
+        std::atomic<bool> Pending; ///< Whether @ref Decoder has yet to be consulted.
+        std::once_flag ResolveOnce;
+        pov_base::MemoryAccount Memory; ///< Size of @ref data and @ref LinearData as reported to the memory accounting.
 
 // it would have been a lot cleaner if POV_VIDCAP_IMPL was a subclass of pov::Image,
 // since we could just assign it to data above and the following would not be needed.
@@ -133,16 +206,28 @@ class ImageData final
 typedef ImageData *ImageDataPtr;
 
 DBL image_pattern(const Vector3d& EPoint, const ImagePattern* pPattern); // TODO - move to pattern.cpp
+bool image_pattern_gradient(DBL& value, Vector3d& gradient, const Vector3d& EPoint, const ImagePattern* pPattern);
 TEXTURE *material_map(const Vector3d& IPoint, const TEXTURE *Texture);
 void bump_map(const Vector3d& EPoint, const TNORMAL *Tnormal, Vector3d& normal);
 void image_colour_at(const ImageData *image, DBL xcoor, DBL ycoor, RGBFTColour& colour, int *index); // TODO ALPHA - caller should decide whether to prefer premultiplied or non-premultiplied alpha
 void image_colour_at(const ImageData *image, DBL xcoor, DBL ycoor, RGBFTColour& colour, int *index, bool premul);
+void image_colour_at(const ImageData *image, DBL xcoor, DBL ycoor, DBL lod, TextureCache *textureCache, RGBFTColour& colour, int *index, bool premul);
 HF_VAL image_height_at(const ImageData *image, int x, int y);
 bool is_image_opaque(const ImageData *image);
 int map_pos(const Vector3d& EPoint, const ImageData* pImage, DBL *xcoor, DBL *ycoor);
 ImageData *Copy_Image(ImageData *old);
 ImageData *Create_Image(void);
+void Precompute_Image(ImageData *image);
+void Account_Image_Memory(ImageData *image);
 void Destroy_Image(ImageData *image);
+void Resolve_Pending_Image(const ImageData *image);
+
+/// Make sure the data of an image is available, waiting for or running its decoder if necessary.
+inline void Resolve_Image(const ImageData *image)
+{
+    if (image->Pending.load(std::memory_order_acquire))
+        Resolve_Pending_Image(image);
+}
 
 /// @}
 ///
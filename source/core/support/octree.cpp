@@ -66,12 +66,15 @@
 // C++ standard header files
 #include <algorithm>
 #include <limits>
+#include <vector>
 
 // POV-Ray header files (base module)
 #include "base/fileinputoutput.h"
+#include "base/filesystem.h"
 #include "base/mathutil.h"
 #include "base/pov_err.h"
 #include "base/pov_mem.h"
+#include "base/povassert.h"
 
 // POV-Ray header files (core module)
 #include "core/colour/spectral.h"
@@ -460,7 +463,6 @@ bool ot_save_node (const Vector3d& point, OT_ID *node);
 bool ot_traverse (OT_NODE *subtree, bool (*function)(OT_BLOCK *block, void * handle1), void * handle2);
 bool ot_free_subtree (OT_NODE *node);
 
-void ot_list_insert (OT_BLOCK **list_ptr, OT_BLOCK *item);
 bool ot_point_in_node (const Vector3d& point, const OT_ID *node);
 
 /*****************************************************************************
@@ -521,6 +523,7 @@ void ot_ins(OT_NODE **root_ptr, OT_BLOCK *new_block, const OT_ID *new_id)
 
     if (*root_ptr == nullptr)
     {
+        pov_base::pov_mem_account(pov_base::kMemory_Radiosity, sizeof(OT_NODE));
         *root_ptr = new OT_NODE;
 
 #ifdef RADSTATS
@@ -598,6 +601,7 @@ void ot_ins(OT_NODE **root_ptr, OT_BLOCK *new_block, const OT_ID *new_id)
         if (this_node->Kids[index] == nullptr)
         {
             // Next level down doesn't exist yet, so create it
+            pov_base::pov_mem_account(pov_base::kMemory_Radiosity, sizeof(OT_NODE));
             temp_node = new OT_NODE;
 
 #ifdef RADSTATS
@@ -640,12 +644,14 @@ void ot_ins(OT_NODE **root_ptr, OT_BLOCK *new_block, const OT_ID *new_id)
 *
 * DESCRIPTION
 *
-*   -
+*   Prepends a block to a node's list of blocks. Returns the number of times
+*   the insertion had to be retried because another thread changed the list
+*   concurrently.
 *
 * THREAD SAFETY
 *
-*   This function is *NOT* THREAD-SAFE regarding concurrent modifications to
-*   the tree.
+*   This function is lock-free and THREAD-SAFE regarding concurrent insertions
+*   into the same list.
 *
 *   This function ensures that tree integrity is maintained at any time,
 *   hooking in the new block only after it has been fully built.
@@ -661,11 +667,18 @@ void ot_ins(OT_NODE **root_ptr, OT_BLOCK *new_block, const OT_ID *new_id)
 *
 ******************************************************************************/
 
-void ot_list_insert(OT_BLOCK **list_head, OT_BLOCK *new_block)
+unsigned int ot_list_insert(std::atomic<OT_BLOCK*> *list_head, OT_BLOCK *new_block)
 {
-    new_block->next = *list_head; // copy addr of old first block
+    unsigned int retries = 0;
 
-    *list_head = new_block;
+    new_block->next = list_head->load(std::memory_order_relaxed); // copy addr of old first block
+
+    // hook in the block, unless some other thread has changed the list head in the meantime
+    // (in which case new_block->next is updated to the new head, and we try again)
+    while (!list_head->compare_exchange_weak(new_block->next, new_block, std::memory_order_release, std::memory_order_relaxed))
+        retries++;
+
+    return retries;
 }
 
 
@@ -711,6 +724,7 @@ void ot_newroot(OT_NODE **root_ptr)
     OT_NODE *newroot;
     int dx, dy, dz, index;
 
+    pov_base::pov_mem_account(pov_base::kMemory_Radiosity, sizeof(OT_NODE));
     newroot = new OT_NODE;
 
 #ifdef RADSTATS
@@ -1344,7 +1358,7 @@ bool ot_save_tree(OT_NODE *root, OStream *fd)
 
 bool ot_write_block(OT_BLOCK *bl, void *fd) // must be passed as void * for compatibility
 {
-    (reinterpret_cast<OStream *>(fd))->printf("C%d\t%g\t%g\t%g\t%02x%02x%02x\t%.4f\t%.4f\t%.4f\t%g\t%g\t%02x%02x%02x\n", // tw
+    (reinterpret_cast<OStream *>(fd))->printf("C%d\t%g\t%g\t%g\t%02x%02x%02x\t%.4f\t%.4f\t%.4f\t%g\t%g\t%02x%02x%02x\t%u\n", // tw
         (int)(bl->Bounce_Depth + 1), // file format still uses 1-based bounce depth counting
 
         bl->Point[X], bl->Point[Y], bl->Point[Z],
@@ -1362,7 +1376,9 @@ bool ot_write_block(OT_BLOCK *bl, void *fd) // must be passed as void * for comp
         bl->Nearest_Distance,
         (int)((bl->To_Nearest_Surface[X]+1.)*.5*254.+.499999),
         (int)((bl->To_Nearest_Surface[Y]+1.)*.5*254.+.499999),
-        (int)((bl->To_Nearest_Surface[Z]+1.)*.5*254.+.499999)
+        (int)((bl->To_Nearest_Surface[Z]+1.)*.5*254.+.499999),
+
+        (unsigned int)bl->Frame // older versions ignore this trailing field
 
         // TODO - write Quality and Brilliance
     );
@@ -1370,6 +1386,330 @@ bool ot_write_block(OT_BLOCK *bl, void *fd) // must be passed as void * for comp
 }
 
 
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   ot_save_binary
+*
+* INPUT
+*
+*   root - root of the tree to save
+*   fd   - stream to write to, opened in binary mode
+*
+* RETURNS
+*
+*   true for success, false for failure
+*
+* DESCRIPTION
+*
+*   Save a complete radiosity cache tree in the binary cache file format.
+*
+*   The file consists of a header, the nodes and the data blocks, with the
+*   node and block arrays aligned to OT_FILE_ALIGNMENT bytes. The nodes are
+*   stored in pre-order, so that each child has a higher index than its
+*   parent, and the blocks of each node are stored contiguously; pointers are
+*   replaced by indices. Everything is stored in native layout and byte order,
+*   so that the file can be memory-mapped and used in place (see
+*   ot_map_file()); the element sizes serve to reject files written by an
+*   incompatible build.
+*
+* THREAD SAFETY
+*
+*   This function is *NOT THREAD-SAFE*.
+*
+******************************************************************************/
+
+/// Identification of binary radiosity cache files.
+const char OT_FILE_MAGIC[8] = { 'P', 'O', 'V', 'R', 'C', 'A', 0, 0x1A };
+
+/// Version of the binary radiosity cache file format.
+const POV_UINT32 OT_FILE_VERSION = 2;
+
+/// Value identifying the byte order of binary radiosity cache files.
+const POV_UINT32 OT_FILE_BYTE_ORDER = 0x01020304;
+
+/// Alignment of the arrays in binary radiosity cache files.
+const POV_UINT64 OT_FILE_ALIGNMENT = 16;
+
+/// Header of binary radiosity cache files.
+struct ot_file_header_struct final
+{
+    char        magic[8];
+    POV_UINT32  version;
+    POV_UINT32  byteOrder;
+    POV_UINT32  nodeSize;
+    POV_UINT32  blockSize;
+    POV_UINT32  nodeCount;
+    POV_UINT32  blockCount;
+    POV_UINT64  nodeOffset;
+    POV_UINT64  blockOffset;
+};
+
+static POV_UINT64 ot_file_align(POV_UINT64 offset)
+{
+    return (offset + OT_FILE_ALIGNMENT - 1) & ~(OT_FILE_ALIGNMENT - 1);
+}
+
+static bool ot_write_padding(OStream *fd, POV_UINT64& pos, POV_UINT64 offset)
+{
+    static const char padding[OT_FILE_ALIGNMENT] = { 0 };
+
+    POV_ASSERT((offset >= pos) && (offset - pos < OT_FILE_ALIGNMENT));
+
+    if ((offset > pos) && !fd->write(padding, size_t(offset - pos)))
+        return false;
+
+    pos = offset;
+    return true;
+}
+
+// Number the nodes of a subtree in pre-order, and assign the ranges of their data blocks.
+static POV_INT32 ot_collect_file_nodes(OT_NODE *node, std::vector<OT_FILE_NODE>& nodes, POV_UINT32& blockCount)
+{
+    POV_INT32 index = POV_INT32(nodes.size());
+    OT_FILE_NODE fileNode;
+
+    fileNode.x = node->Id.x;
+    fileNode.y = node->Id.y;
+    fileNode.z = node->Id.z;
+    fileNode.Size = node->Id.Size;
+    fileNode.FirstBlock = blockCount;
+    fileNode.BlockCount = 0;
+    for (OT_BLOCK *block = node->Values; block != nullptr; block = block->next)
+        fileNode.BlockCount++;
+    blockCount += fileNode.BlockCount;
+    nodes.push_back(fileNode);
+
+    for (int i = 0; i < 8; i++)
+    {
+        OT_NODE *kid = node->Kids[i];
+        POV_INT32 kidIndex = -1;
+        if (kid != nullptr)
+            kidIndex = ot_collect_file_nodes(kid, nodes, blockCount);
+        nodes[index].Kids[i] = kidIndex;
+    }
+
+    return index;
+}
+
+// Write the data blocks of a subtree, in the order assigned by ot_collect_file_nodes().
+static bool ot_write_file_blocks(OT_NODE *node, OStream *fd)
+{
+    for (OT_BLOCK *block = node->Values; block != nullptr; block = block->next)
+    {
+        OT_BLOCK fileBlock(*block);
+        fileBlock.next = nullptr;
+        if (!fd->write(&fileBlock, sizeof(OT_BLOCK)))
+            return false;
+    }
+
+    for (int i = 0; i < 8; i++)
+    {
+        OT_NODE *kid = node->Kids[i];
+        if ((kid != nullptr) && !ot_write_file_blocks(kid, fd))
+            return false;
+    }
+
+    return true;
+}
+
+bool ot_save_binary(OT_NODE *root, OStream *fd)
+{
+    std::vector<OT_FILE_NODE> nodes;
+    POV_UINT32 blockCount = 0;
+    ot_file_header_struct header;
+    POV_UINT64 pos = 0;
+
+    if (fd == nullptr)
+        return false;
+
+    if (root != nullptr)
+        ot_collect_file_nodes(root, nodes, blockCount);
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, OT_FILE_MAGIC, sizeof(header.magic));
+    header.version     = OT_FILE_VERSION;
+    header.byteOrder   = OT_FILE_BYTE_ORDER;
+    header.nodeSize    = sizeof(OT_FILE_NODE);
+    header.blockSize   = sizeof(OT_BLOCK);
+    header.nodeCount   = POV_UINT32(nodes.size());
+    header.blockCount  = blockCount;
+    header.nodeOffset  = ot_file_align(sizeof(header));
+    header.blockOffset = ot_file_align(header.nodeOffset + POV_UINT64(header.nodeCount) * sizeof(OT_FILE_NODE));
+
+    if (!fd->write(&header, sizeof(header)))
+        return false;
+    pos = sizeof(header);
+
+    if (!ot_write_padding(fd, pos, header.nodeOffset))
+        return false;
+    if (!nodes.empty() && !fd->write(nodes.data(), nodes.size() * sizeof(OT_FILE_NODE)))
+        return false;
+    pos += POV_UINT64(header.nodeCount) * sizeof(OT_FILE_NODE);
+
+    if (!ot_write_padding(fd, pos, header.blockOffset))
+        return false;
+    if (root != nullptr)
+        return ot_write_file_blocks(root, fd);
+
+    return true;
+}
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   ot_is_binary_file
+*
+* DESCRIPTION
+*
+*   Test whether a file is in the binary cache file format (as opposed to the
+*   text format written by ot_write_block()).
+*
+******************************************************************************/
+
+bool ot_is_binary_file(const pov_base::Filesystem::MappedFile& file)
+{
+    return (file.GetSize() >= sizeof(OT_FILE_MAGIC)) &&
+           (memcmp(file.GetData(), OT_FILE_MAGIC, sizeof(OT_FILE_MAGIC)) == 0);
+}
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   ot_map_file
+*
+* INPUT
+*
+*   tree - tree to set up
+*   file - memory-mapped file holding a binary cache file written by
+*          ot_save_binary()
+*   offset - offset of the binary cache file within the mapped file, e.g.
+*            within a scene bundle; must be aligned to OT_FILE_ALIGNMENT
+*   size - size of the binary cache file, or 0 for the rest of the mapped file
+*
+* RETURNS
+*
+*   true for success, false if the file is invalid or was written by an
+*   incompatible build
+*
+* DESCRIPTION
+*
+*   Set up a tree to use the nodes and data blocks of a binary cache file in
+*   place. The indices are validated, so that a damaged file cannot cause
+*   out-of-bounds accesses or endless loops in ot_mapped_dist_traverse().
+*
+******************************************************************************/
+
+static bool ot_file_array_valid(POV_UINT64 offset, POV_UINT32 count, size_t elementSize, size_t fileSize)
+{
+    return (offset >= sizeof(ot_file_header_struct)) && (offset % OT_FILE_ALIGNMENT == 0) &&
+           (offset <= fileSize) && (POV_UINT64(count) * elementSize <= fileSize - offset);
+}
+
+bool ot_map_file(OT_MAPPED_TREE *tree, const std::shared_ptr<pov_base::Filesystem::MappedFile>& file, POV_UINT64 offset, POV_UINT64 size)
+{
+    ot_file_header_struct header;
+
+    if ((offset % OT_FILE_ALIGNMENT != 0) || (offset > file->GetSize()))
+        return false;
+    if ((size == 0) || (size > file->GetSize() - offset))
+        size = file->GetSize() - offset;
+
+    const unsigned char *base = reinterpret_cast<const unsigned char *>(file->GetData()) + offset;
+
+    if ((size < sizeof(header)) || (memcmp(base, OT_FILE_MAGIC, sizeof(OT_FILE_MAGIC)) != 0))
+        return false;
+
+    memcpy(&header, base, sizeof(header));
+
+    if ((header.version != OT_FILE_VERSION) ||
+        (header.byteOrder != OT_FILE_BYTE_ORDER) ||
+        (header.nodeSize != sizeof(OT_FILE_NODE)) ||
+        (header.blockSize != sizeof(OT_BLOCK)) ||
+        !ot_file_array_valid(header.nodeOffset, header.nodeCount, sizeof(OT_FILE_NODE), size) ||
+        !ot_file_array_valid(header.blockOffset, header.blockCount, sizeof(OT_BLOCK), size))
+        return false;
+
+    const OT_FILE_NODE *nodes = reinterpret_cast<const OT_FILE_NODE *>(base + header.nodeOffset);
+
+    for (POV_UINT32 i = 0; i < header.nodeCount; i++)
+    {
+        if ((nodes[i].FirstBlock > header.blockCount) || (nodes[i].BlockCount > header.blockCount - nodes[i].FirstBlock))
+            return false;
+        for (int k = 0; k < 8; k++)
+        {
+            // children must come after their parent, which also rules out cycles
+            if ((nodes[i].Kids[k] != -1) &&
+                ((nodes[i].Kids[k] <= POV_INT32(i)) || (POV_UINT32(nodes[i].Kids[k]) >= header.nodeCount)))
+                return false;
+        }
+    }
+
+    tree->Storage    = file;
+    tree->Nodes      = nodes;
+    tree->Blocks     = reinterpret_cast<const OT_BLOCK *>(base + header.blockOffset);
+    tree->NodeCount  = header.nodeCount;
+    tree->BlockCount = header.blockCount;
+    return true;
+}
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   ot_mapped_dist_traverse
+*
+* DESCRIPTION
+*
+*   Counterpart of ot_dist_traverse() for a tree memory-mapped by
+*   ot_map_file(), starting at the node with the given index.
+*
+*   The data blocks are passed to the function as non-const pointers for
+*   compatibility, but must not be modified.
+*
+******************************************************************************/
+
+bool ot_mapped_dist_traverse(const OT_MAPPED_TREE *tree, POV_UINT32 node, const Vector3d& point, int bounce_depth, bool (*function)(OT_BLOCK *block, void *handle1), void *handle)
+{
+    const OT_FILE_NODE& subtree = tree->Nodes[node];
+
+    // First, recurse to the child nodes
+    for (int i = 0; i < 8 ; i++)
+    {
+        if (subtree.Kids[i] != -1)
+        {
+            const OT_FILE_NODE& kid = tree->Nodes[subtree.Kids[i]];
+            OT_ID id;
+            id.x = kid.x;
+            id.y = kid.y;
+            id.z = kid.z;
+            id.Size = kid.Size;
+            if (ot_point_in_node(point, &id))
+            {
+                if (!ot_mapped_dist_traverse(tree, POV_UINT32(subtree.Kids[i]), point, bounce_depth, function, handle))
+                    return false;
+            }
+        }
+    }
+
+    // Now, call the specified routine for each data block of this tree node
+    const OT_BLOCK *blocks = tree->Blocks + subtree.FirstBlock;
+    for (POV_UINT32 i = 0; i < subtree.BlockCount; i++)
+    {
+        if ((int)blocks[i].Bounce_Depth == bounce_depth)
+        {
+            if (!(*function)(const_cast<OT_BLOCK *>(&blocks[i]), handle))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+
 /*****************************************************************************
 *
 * FUNCTION
@@ -1465,11 +1805,81 @@ bool ot_free_subtree(OT_NODE *subtree)
 
     // Finally, free this block itself
     delete subtree;
+    pov_base::pov_mem_unaccount(pov_base::kMemory_Radiosity, sizeof(OT_NODE));
 
     return true;
 }
 
 
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   ot_sort_lists
+*
+* INPUT
+*
+*   subtree - root of the (sub-)tree to process
+*
+* OUTPUT
+*
+* RETURNS
+*
+* AUTHOUR
+*
+* DESCRIPTION
+*
+*   Re-order the block lists of all nodes in the tree by pass and tile ID,
+*   keeping the relative order of blocks from the same pass and tile.
+*
+*   Blocks are prepended to the lists as they are computed, so blocks from
+*   different tiles of the same pass end up interleaved in an order that
+*   depends on thread timing; as the sums computed by ot_dist_traverse()
+*   depend on the order in which the blocks are visited, this in turn affects
+*   the result in the last bits. Sorting the lists once a pass is complete
+*   gives a canonical order that only depends on the set of blocks.
+*
+* THREAD SAFETY
+*
+*   This function is *NOT THREAD-SAFE*.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+void ot_sort_lists(OT_NODE *subtree)
+{
+    std::vector<OT_BLOCK*> blocks;
+
+    for (int i = 0; i < 8; i++)
+    {
+        OT_NODE *this_node = subtree->Kids[i];
+        if (this_node != nullptr)
+            ot_sort_lists(this_node);
+    }
+
+    for (OT_BLOCK *block = subtree->Values; block != nullptr; block = block->next)
+        blocks.push_back(block);
+    if (blocks.size() < 2)
+        return;
+
+    std::stable_sort(blocks.begin(), blocks.end(),
+                     [](const OT_BLOCK *a, const OT_BLOCK *b)
+                     {
+                         if (a->Pass != b->Pass)
+                             return a->Pass < b->Pass;
+                         return a->TileId < b->TileId;
+                     });
+
+    for (size_t i = 0; i + 1 < blocks.size(); i++)
+        blocks[i]->next = blocks[i + 1];
+    blocks.back()->next = nullptr;
+    subtree->Values = blocks.front();
+}
+
+
 /*****************************************************************************
 *
 * FUNCTION
@@ -51,10 +51,12 @@
 #include <climits>
 
 // C++ standard header files
-//  (none at the moment)
+#include <atomic>
+#include <memory>
 
 // POV-Ray header files (base module)
 #include "base/fileinputoutput_fwd.h"
+#include "base/filesystem_fwd.h"
 
 // POV-Ray header files (core module)
 #include "core/coretypes.h"
@@ -97,6 +99,8 @@ constexpr auto OT_PASS_MAX     = kOctreePassMax;        ///< @deprecated
 using OT_DEPTH = OctreeDepth;
 constexpr auto OT_DEPTH_MAX    = kOctreeDepthMax;       ///< @deprecated
 
+typedef unsigned short OT_FRAME;
+
 // Each node in the oct-tree has a (possibly null) linked list of these data blocks off it.
 struct ot_block_struct final
 {
@@ -105,7 +109,8 @@ struct ot_block_struct final
     Vector3d    Point;
     Vector3d    S_Normal;
     Vector3d    To_Nearest_Surface;
-    MathColour  dx, dy, dz; // gradients, not colors, but used only to manipulate colors [trf]
+    MathColour  dx, dy, dz; // translational gradients, not colors, but used only to manipulate colors [trf]
+    MathColour  rx, ry, rz; // rotational gradients, likewise
     MathColour  Illuminance;
     SNGL        Brilliance; // surface brilliance for which the sample was computed
     SNGL        Harmonic_Mean_Distance;
@@ -114,6 +119,7 @@ struct ot_block_struct final
     OT_TILE     TileId;     // tile in which this sample was taken
     OT_PASS     Pass;       // pass during which this sample was taken (OT_PASS_FINAL for final render)
     OT_DEPTH    Bounce_Depth;
+    OT_FRAME    Frame;      // animation frame in which this sample was taken (modulo 65536)
 };
 using OT_BLOCK = ot_block_struct; ///< @deprecated
 
@@ -128,16 +134,43 @@ struct ot_id_struct final
 using OT_ID = ot_id_struct; ///< @deprecated
 
 // These are the structures that make up the oct-tree itself, known as nodes
+// The pointers are atomic so that nodes and blocks can be added while other threads traverse the tree.
 struct ot_node_struct final
 {
     OT_ID    Id;
-    OT_BLOCK *Values;
-    ot_node_struct *Kids[8];
+    std::atomic<OT_BLOCK*> Values;
+    std::atomic<ot_node_struct*> Kids[8];
 
     ot_node_struct() : Id(), Values(nullptr) { for (unsigned int i = 0; i < 8; i ++) { Kids[i] = nullptr; } }
 };
 using OT_NODE = ot_node_struct; ///< @deprecated
 
+// Node of an oct-tree in the binary cache file format (see ot_save_binary()).
+// Pointers are replaced by indices, so that the nodes can be used in place.
+struct ot_file_node_struct final
+{
+    POV_INT32   x, y, z;
+    POV_INT32   Size;
+    POV_UINT32  FirstBlock; // index of the first data block of this node
+    POV_UINT32  BlockCount; // number of data blocks of this node, stored contiguously
+    POV_INT32   Kids[8];    // indices of the child nodes, or -1
+};
+using OT_FILE_NODE = ot_file_node_struct;
+
+// An oct-tree memory-mapped from a binary cache file; node 0 is the root.
+// The data blocks are stored without their `next` pointers, which are meaningless.
+struct ot_mapped_tree_struct final
+{
+    std::shared_ptr<pov_base::Filesystem::MappedFile> Storage;
+    const OT_FILE_NODE* Nodes;
+    const OT_BLOCK*     Blocks;
+    POV_UINT32          NodeCount;
+    POV_UINT32          BlockCount;
+
+    ot_mapped_tree_struct() : Nodes(nullptr), Blocks(nullptr), NodeCount(0), BlockCount(0) {}
+};
+using OT_MAPPED_TREE = ot_mapped_tree_struct;
+
 // These are informations the octree reader needs to know
 struct ot_read_param_struct final
 {
@@ -160,13 +193,19 @@ using OT_READ_INFO = ot_read_info_struct; ///< @deprecated
 ******************************************************************************/
 
 void ot_ins (OT_NODE **root, OT_BLOCK *new_block, const OT_ID *new_id);
+unsigned int ot_list_insert (std::atomic<OT_BLOCK*> *list_head, OT_BLOCK *new_block);
 bool ot_dist_traverse (OT_NODE *subtree, const Vector3d& point, int bounce_depth, bool (*func)(OT_BLOCK *block, void *handle1), void *handle2);
 void ot_index_sphere (const Vector3d& point, DBL radius, OT_ID *id);
 void ot_index_box (const Vector3d& min_point, const Vector3d& max_point, OT_ID *id);
 bool ot_save_tree (OT_NODE *root, OStream *fd);
 bool ot_write_block (OT_BLOCK *bl, void * handle);
 bool ot_free_tree (OT_NODE **root_ptr);
+void ot_sort_lists (OT_NODE *subtree);
 bool ot_read_file (OT_NODE **root, IStream * fd, const OT_READ_PARAM* param, OT_READ_INFO* info);
+bool ot_save_binary (OT_NODE *root, OStream *fd);
+bool ot_is_binary_file (const pov_base::Filesystem::MappedFile& file);
+bool ot_map_file (OT_MAPPED_TREE *tree, const std::shared_ptr<pov_base::Filesystem::MappedFile>& file, POV_UINT64 offset = 0, POV_UINT64 size = 0);
+bool ot_mapped_dist_traverse (const OT_MAPPED_TREE *tree, POV_UINT32 node, const Vector3d& point, int bounce_depth, bool (*func)(OT_BLOCK *block, void *handle1), void *handle2);
 void ot_newroot (OT_NODE **root_ptr);
 void ot_parent (OT_ID *dad, OT_ID *kid);
 
@@ -0,0 +1,90 @@
+//******************************************************************************
+///
+/// @file core/support/scenearena.cpp
+///
+/// Implementation of the scene-lifetime memory arena.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+
+// Unit header file must be the first file included within POV-Ray *.cpp files (pulls in config)
+#include "core/support/scenearena.h"
+
+// C++ variants of C standard header files
+//  (none at the moment)
+
+// C++ standard header files
+//  (none at the moment)
+
+// POV-Ray header files (base module)
+//  (none at the moment)
+
+// POV-Ray header files (core module)
+//  (none at the moment)
+
+// this must be the last file included
+#include "base/povdebug.h"
+
+namespace pov
+{
+
+constexpr std::size_t SceneArena::kChunkSize;
+constexpr std::size_t SceneArena::kAlignment;
+
+SceneArena::SceneArena() :
+    mUsed(kChunkSize),
+    mAllocated(0)
+{}
+
+void* SceneArena::Allocate(std::size_t size)
+{
+    size = (size + kAlignment - 1) & ~(kAlignment - 1);
+    mAllocated += size;
+
+    if (size > kChunkSize / 4)
+    {
+        // Large blocks get a chunk of their own, slipped in before the current chunk so that the
+        // latter's remaining space can still be used.
+        return maChunks.emplace(maChunks.end() - (maChunks.empty() ? 0 : 1), new char[size])->get();
+    }
+
+    if (mUsed + size > kChunkSize)
+    {
+        maChunks.emplace_back(new char[kChunkSize]);
+        mUsed = 0;
+    }
+
+    void* block = maChunks.back().get() + mUsed;
+    mUsed += size;
+    return block;
+}
+
+}
+// end of namespace pov
@@ -0,0 +1,106 @@
+//******************************************************************************
+///
+/// @file core/support/scenearena.h
+///
+/// Declarations related to the scene-lifetime memory arena.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+#ifndef POVRAY_CORE_SCENEARENA_H
+#define POVRAY_CORE_SCENEARENA_H
+
+// Module config header file must be the first file included within POV-Ray unit header files
+#include "core/configcore.h"
+
+// C++ variants of C standard header files
+#include <cstddef>
+
+// C++ standard header files
+#include <memory>
+#include <vector>
+
+// POV-Ray header files (base module)
+//  (none at the moment)
+
+// POV-Ray header files (core module)
+//  (none at the moment)
+
+namespace pov
+{
+
+//******************************************************************************
+
+/// Arena for data that lives as long as the scene.
+///
+/// Memory is handed out from large chunks by advancing a pointer, and is only returned en bloc
+/// when the arena is destroyed along with the scene; individual blocks are never freed. This keeps
+/// data built together close together in memory, and turns the teardown of a large scene from
+/// countless individual deallocations into a handful.
+///
+/// Only trivially destructible data may be allocated from the arena, and only data known to be
+/// needed for most of the scene's lifetime should be, as memory no longer used is not reclaimed
+/// before the scene is destroyed.
+///
+/// @note
+///     Allocation is not thread-safe; the arena is intended to be filled by the parser.
+///
+class SceneArena final
+{
+public:
+
+    SceneArena();
+
+    SceneArena(const SceneArena&) = delete;
+    SceneArena& operator=(const SceneArena&) = delete;
+
+    /// Allocate uninitialized memory.
+    void* Allocate(std::size_t size);
+
+    /// Allocate uninitialized memory for an array of trivial values.
+    template<typename T>
+    T* AllocateArray(std::size_t count) { return reinterpret_cast<T*>(Allocate(count * sizeof(T))); }
+
+    /// Get the total number of octets allocated from the arena so far.
+    std::size_t GetAllocatedSize() const { return mAllocated; }
+
+private:
+
+    static constexpr std::size_t kChunkSize = 1024 * 1024;
+    static constexpr std::size_t kAlignment = 16;
+
+    std::vector<std::unique_ptr<char[]>> maChunks; ///< Chunks, the one currently allocated from last.
+    std::size_t mUsed;      ///< Octets allocated from the current chunk.
+    std::size_t mAllocated; ///< Octets allocated in total.
+};
+
+}
+// end of namespace pov
+
+#endif // POVRAY_CORE_SCENEARENA_H
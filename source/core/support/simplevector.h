@@ -635,7 +635,8 @@ public:
 
     VectorPool(size_t sizeHint = 0, size_t initialPoolSize = POV_VECTOR_POOL_SIZE) :
         mPool(),
-        mSizeHint(sizeHint)
+        mSizeHint(sizeHint),
+        mAllocations(0)
     {
         if (initialPoolSize != 0)
             mPool.reserve(initialPoolSize);
@@ -656,6 +657,7 @@ public:
         if (mPool.empty())
         {
             p = new VECTOR_T();
+            ++mAllocations;
         }
         else
         {
@@ -674,10 +676,18 @@ public:
         mPool.push_back(p);
     }
 
+    /// Number of vectors the pool has had to allocate from the heap so far.
+    /// Once a render has warmed up, this should no longer change.
+    size_t GetAllocationCount() const
+    {
+        return mAllocations;
+    }
+
 private:
 
     std::vector<VECTOR_T*> mPool;
     size_t mSizeHint;
+    size_t mAllocations;
 };
 
 //******************************************************************************
@@ -728,6 +738,7 @@ public:
     inline PooledSimpleVector& operator=(const PooledSimpleVector& o)
     {
         *mpVector = *o.mpVector;
+        return *this;
     }
 
     // assign() not supported
@@ -775,6 +786,12 @@ public:
     // resize() not supported
     // swap() not supported
 
+    /// Number of vectors the calling thread's pool has had to allocate from the heap so far.
+    static inline size_t GetPoolAllocationCount()
+    {
+        return GetPool().GetAllocationCount();
+    }
+
 private:
 
     /// Get thread-local vector pool instance.
@@ -97,6 +97,8 @@ const INTERSECTION_STATS_INFO intersection_stats[kPOVList_Stat_Last] =
       "CSG Merge" },
     { kPOVList_Stat_CSGUnionTest,       Ray_CSG_Union_Tests, Ray_CSG_Union_Tests_Succeeded,
       "CSG Union" },
+    { kPOVList_Stat_CSGChildBdTest,     Ray_CSG_Child_Bound_Tests, Ray_CSG_Child_Bound_Tests_Succeeded,
+      "CSG Child Bound" },
     { kPOVList_Stat_DiscTest,           Ray_Disc_Tests, Ray_Disc_Tests_Succeeded,
       "Disc" },
     { kPOVList_Stat_FractalTest,        Ray_Fractal_Tests, Ray_Fractal_Tests_Succeeded,
@@ -175,6 +177,10 @@ const INTERSECTION_STATS_INFO intersection_stats[kPOVList_Stat_Last] =
       "Clipping Object" },
     { kPOVList_Stat_BoundingBoxTest,    nChecked, nEnqueued,
       "Bounding Box" },
+    { kPOVList_Stat_MailboxTest,        BSP_Mailbox_Tests, BSP_Mailbox_Hits,
+      "BSP Mailbox" },
+    { kPOVList_Stat_PatternCacheTest,   Pattern_Cache_Tests, Pattern_Cache_Hits,
+      "Pattern Cache" },
     { kPOVList_Stat_LightBufferTest,    LBuffer_Tests, LBuffer_Tests_Succeeded,
       "Light Buffer" },
     { kPOVList_Stat_VistaBufferTest,    VBuffer_Tests, VBuffer_Tests_Succeeded,
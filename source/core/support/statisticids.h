@@ -112,6 +112,9 @@ enum
     kPOVList_Stat_OvusTest,
     kPOVList_Stat_LemonTest,
     kPOVList_Stat_RationalTest,
+    kPOVList_Stat_MailboxTest,
+    kPOVList_Stat_CSGChildBdTest,
+    kPOVList_Stat_PatternCacheTest,
     kPOVList_Stat_Last
 };
 
@@ -150,6 +153,8 @@ typedef enum INTSTATS
     Ray_CSG_Merge_Tests_Succeeded,
     Ray_CSG_Union_Tests,
     Ray_CSG_Union_Tests_Succeeded,
+    Ray_CSG_Child_Bound_Tests,
+    Ray_CSG_Child_Bound_Tests_Succeeded,
     Ray_Disc_Tests,
     Ray_Disc_Tests_Succeeded,
     Ray_Fractal_Tests,
@@ -226,6 +231,11 @@ typedef enum INTSTATS
     /* crackle cache */
     CrackleCache_Tests,
     CrackleCache_Tests_Succeeded,
+    CrackleCache_Evictions,
+
+    /* warps */
+    Warp_Chains_Evaluated,
+    Warp_Time,                        // estimated time spent evaluating warps (in nanoseconds)
 
     /* bounding etc */
     Bounding_Region_Tests,
@@ -236,6 +246,8 @@ typedef enum INTSTATS
     /* isosurface and functions */
     Ray_IsoSurface_Find_Root,
     Ray_Function_VM_Calls,
+    Ray_Function_VM_Native_Calls,     // function evaluations run as native code
+    Ray_Function_VM_Batch_Calls,      // function evaluations run in batches
     Ray_Function_VM_Instruction_Est,
 
     /* Vista and light buffer */
@@ -254,14 +266,30 @@ typedef enum INTSTATS
     Transmitted_Rays_Traced,
     Internal_Reflected_Rays_Traced,
     Shadow_Cache_Hits,
+    Shadow_Cache_Tests,
     Shadow_Rays_Succeeded,
     Shadow_Ray_Tests,
+    Roulette_Terminated_L1,           // number of secondary rays of the 1st generation terminated by Russian roulette
+    Roulette_Terminated_L2,           //  ...
+    Roulette_Terminated_L3,
+    Roulette_Terminated_L4,
+    Roulette_Terminated_L5ff,         // number of secondary rays of the 5th or later generation terminated by Russian roulette
+    Ray_Budget_Exhausted,             // number of rays not traced because the secondary ray budget was exhausted
+
+    /* Mesh paging */
+    Mesh_Page_Ins,                    // number of memory-mapped meshes paged in again after having been evicted
+    Mesh_Page_In_Time,                // time spent paging in memory-mapped meshes (in microseconds)
+    Mesh_Page_Evictions,              // number of memory-mapped meshes evicted to stay within the memory budget
 
     nChecked,
     nEnqueued,
     totalQueues,
     totalQueueResets,
     totalQueueResizes,
+    BSP_Mailbox_Tests,
+    BSP_Mailbox_Hits,
+    Pattern_Cache_Tests,
+    Pattern_Cache_Hits,
     Polynomials_Tested,
     Roots_Eliminated,
 
@@ -280,6 +308,7 @@ typedef enum INTSTATS
     Radiosity_GatherCount,            // number of samples gathered
     Radiosity_UnsavedCount,           // number of samples gathered but not stored in cache
     Radiosity_RayCount,               // number of rays shot to gather samples
+    Radiosity_RaysSaved,              // number of rays not shot due to adaptive sampling
     Radiosity_OctreeNodes,            // number of nodes in octree
     Radiosity_OctreeLookups,          // number of blocks examined for sample lookup
     Radiosity_OctreeAccepts0,         // number of blocks accepted by pass & tile id check
@@ -288,14 +317,19 @@ typedef enum INTSTATS
     Radiosity_OctreeAccepts3,         // number of blocks accepted by next more sophisticated check
     Radiosity_OctreeAccepts4,         // number of blocks accepted by next more sophisticated check
     Radiosity_OctreeAccepts5,         // number of blocks accepted by next more sophisticated check
+    Radiosity_OctreeRetries,          // number of octree insertions retried due to concurrent modification
+    Radiosity_LockWaitTime,           // time spent waiting for radiosity cache locks (in microseconds)
+    Radiosity_RecentHits,             // number of sample lookups satisfied by the thread's recent samples alone
     // [CLi] radiosity "top level" recursion stats (all pre- & final traces)
     Radiosity_TopLevel_ReuseCount,    // ambient value queries satisfied without taking a new sample
     Radiosity_TopLevel_GatherCount,   // number of samples gathered
     Radiosity_TopLevel_RayCount,      // number of rays shot to gather samples
+    Radiosity_TopLevel_RaysSaved,     // number of rays not shot due to adaptive sampling
     // [CLi] radiosity final trace stats (all recursion depths)
     Radiosity_Final_ReuseCount,       // ambient value queries satisfied without taking a new sample
     Radiosity_Final_GatherCount,      // number of samples gathered
     Radiosity_Final_RayCount,         // number of rays shot to gather samples
+    Radiosity_Final_RaysSaved,        // number of rays not shot due to adaptive sampling
     // [CLi] radiosity detailed sample stats
     Radiosity_SamplesTaken_PTS1_R0,   // number of samples gathered during pretrace step 1 at recursion depth 0
     Radiosity_SamplesTaken_PTS1_R1,   //  ...
@@ -327,6 +361,18 @@ typedef enum INTSTATS
     Radiosity_SamplesTaken_Final_R2,
     Radiosity_SamplesTaken_Final_R3,
     Radiosity_SamplesTaken_Final_R4ff,
+    Radiosity_RayCount_PTS1,          // number of rays shot during pretrace step 1
+    Radiosity_RayCount_PTS2,          //  ...
+    Radiosity_RayCount_PTS3,
+    Radiosity_RayCount_PTS4,
+    Radiosity_RayCount_PTS5ff,        // number of rays shot during pretrace step 5 or deeper
+    Radiosity_RayCount_Final,         // number of rays shot during final render
+    Radiosity_RaysSaved_PTS1,         // number of rays not shot due to adaptive sampling during pretrace step 1
+    Radiosity_RaysSaved_PTS2,         //  ...
+    Radiosity_RaysSaved_PTS3,
+    Radiosity_RaysSaved_PTS4,
+    Radiosity_RaysSaved_PTS5ff,       // number of rays not shot due to adaptive sampling during pretrace step 5 or deeper
+    Radiosity_RaysSaved_Final,        // number of rays not shot due to adaptive sampling during final render
     Radiosity_QueryCount_R0,          // ambient value queries at recursion depth 0
     Radiosity_QueryCount_R1,          // ...
     Radiosity_QueryCount_R2,          // ...
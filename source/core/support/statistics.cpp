@@ -50,41 +50,12 @@
 namespace pov
 {
 
-const unsigned int kMaxReadAttempts = 10;
-
-template <typename T>
-bool Counter<T>::SafeRead(unsigned int maxattempts, T *result) const
-{
-    // Use pointers to the value because even though it is declared
-    // as volatile, we cannot trust all compilers enough to not
-    // optimize the accesses!
-    const volatile T *p1 = &value;
-    const volatile T *p2 = &value;
-
-    do
-    {
-        T val1 = *p1;
-        T val2 = *p2;
-
-        if (val2 == val1)
-        {
-            *result = val2;
-            return true;
-        }
-    } while (maxattempts--);
-
-    return false;
-}
-
 template <typename T, int numElem>
 void StatisticsBase<T, numElem>::operator+=(const StatisticsBase<T, numElem>& other)
 {
+    // the other thread's task has finished by now, so its counters can be read directly
     for (int i = 0; i < numElem; i++)
-    {
-        T temp;
-        other.counters[i].SafeRead(kMaxReadAttempts, &temp);
-        counters[i] += temp;
-    }
+        counters[i] += other.counters[i];
 }
 
 template <typename T, int numElem>
@@ -62,12 +62,18 @@ namespace pov
 ///
 /// @{
 
+/// Statistics counter.
+///
+/// Each render thread owns a private set of counters, which is only ever accessed by that thread
+/// while it is running, and is merged into the totals by the owning view or scene once the thread's
+/// task has finished. The value is therefore deliberately a plain (non-volatile, non-atomic) member,
+/// so that the compiler is free to keep it in a register across the hottest loops.
+///
 template <typename T>
 class Counter final
 {
     public:
-        Counter() { value = 0; } // assumes for all types of T that 0 is a valid assignment
-        virtual ~Counter() { }
+        Counter() : value(0) {} // assumes for all types of T that 0 is a valid assignment
         inline T operator+(T other) { return value + other; }
         inline T operator-(T other) { return value - other; }
         inline T operator++(int) { return value++; }
@@ -76,10 +82,17 @@ class Counter final
         inline void operator-=(T other) { value -= other; }
         inline const T operator=(T other) { value = other; return value; }
         inline operator T() const { return value; }
-        bool SafeRead(unsigned int maxattempts, T *result) const;
 
     private:
-        volatile T value;
+        T value;
+};
+
+/// Stand-in for a @ref Counter that has been compiled out.
+class NullCounter final
+{
+    public:
+        inline void operator++(int) {}
+        template <typename T> inline void operator+=(T) {}
 };
 
 template <typename T, int numElem>
@@ -87,7 +100,6 @@ class StatisticsBase final
 {
     public:
         StatisticsBase() {}
-        virtual ~StatisticsBase() {}
 
         inline Counter<T>& operator[](std::size_t idx) { return counters[idx]; }
         inline Counter<T> operator[](std::size_t idx) const { return counters[idx]; }
@@ -108,7 +120,6 @@ class RenderStatistics final
 {
 public:
     RenderStatistics() {}
-    virtual ~RenderStatistics() {}
 
     inline Counter<POV_ULONG>& operator[](IntStatsIndex idx) { return intStats[idx]; }
     inline Counter<POV_ULONG> operator[](IntStatsIndex idx) const { return intStats[idx]; }
@@ -120,6 +131,17 @@ public:
     inline operator FPStatistics() const { return fpStats; }
     inline void operator+=(const RenderStatistics& rhs) { intStats += rhs.intStats; fpStats += rhs.fpStats; }
 
+    /// Access a counter of the ray-object tests of an individual shape type.
+    ///
+    /// @note
+    ///     These counters are removed entirely if @ref POV_SHAPE_STATISTICS is disabled.
+    ///
+#if POV_SHAPE_STATISTICS
+    inline Counter<POV_ULONG>& Shape(IntStatsIndex idx) { return intStats[idx]; }
+#else
+    inline NullCounter Shape(IntStatsIndex) { return NullCounter(); }
+#endif
+
 protected:
     IntStatistics intStats;
     FPStatistics fpStats;
@@ -0,0 +1,248 @@
+//******************************************************************************
+///
+/// @file core/support/texturecache.cpp
+///
+/// Implementation of the mip-mapped image map texture cache.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+
+// Unit header file must be the first file included within POV-Ray *.cpp files (pulls in config)
+#include "core/support/texturecache.h"
+
+// C++ variants of C standard header files
+#include <cmath>
+
+// C++ standard header files
+#include <algorithm>
+
+// POV-Ray header files (base module)
+#include "base/mathutil.h"
+#include "base/image/image.h"
+
+// POV-Ray header files (core module)
+#include "core/support/imageutil.h"
+
+// this must be the last file included
+#include "base/povdebug.h"
+
+namespace pov
+{
+
+static inline int LevelSize(int size, int level)
+{
+    return std::max(1, size >> level);
+}
+
+static inline int Address(int i, int size, bool once)
+{
+    if (once)
+        return clip(i, 0, size - 1);
+    else
+        return wrapInt(i, size);
+}
+
+//******************************************************************************
+
+class TextureCache::TexelReader final
+{
+public:
+
+    TexelReader(TextureCache& c, const ImageData *img) : cache(c), image(img), tileLevel(-1), tileX(0), tileY(0) {}
+
+    /// Get a texel with premultiplied alpha.
+    /// @note   The coordinates must be within the bounds of the level.
+    bool Get(int level, int x, int y, RGBFTColour& colour)
+    {
+        if (level == 0)
+        {
+            image->data->GetRGBFTValue(x, y, colour, true);
+            return true;
+        }
+
+        int tx = x / TileSize;
+        int ty = y / TileSize;
+        if (!tile || (level != tileLevel) || (tx != tileX) || (ty != tileY))
+        {
+            tile = cache.GetTile(image, level, tx, ty);
+            tileLevel = level;
+            tileX = tx;
+            tileY = ty;
+            if (!tile)
+                return false;
+        }
+        colour = tile->texels[(y % TileSize) * TileSize + (x % TileSize)];
+        return true;
+    }
+
+    const ImageData *GetImage() const { return image; }
+
+private:
+
+    TextureCache&       cache;
+    const ImageData*    image;
+    int                 tileLevel;
+    int                 tileX;
+    int                 tileY;
+    TilePtr             tile;
+};
+
+//******************************************************************************
+
+std::size_t TextureCache::TileKeyHash::operator()(const TileKey& key) const
+{
+    POV_UINT64 h = key.index ^ (POV_UINT64(reinterpret_cast<std::size_t>(key.image)) * 0x9E3779B97F4A7C15ull);
+    return std::size_t(h ^ (h >> 29));
+}
+
+TextureCache::TextureCache(std::size_t maxBytes) :
+    maxTiles(maxBytes / sizeof(Tile)),
+    tileCount(0)
+{}
+
+TextureCache::TilePtr TextureCache::GetTile(const ImageData *image, int level, int tileX, int tileY)
+{
+    TileKey key = { image->data, (POV_UINT64(level) << 56) | (POV_UINT64(tileX) << 28) | POV_UINT64(tileY) };
+    Shard& shard = shards[TileKeyHash()(key) % ShardCount];
+
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        std::unordered_map<TileKey, TilePtr, TileKeyHash>::const_iterator i = shard.tiles.find(key);
+        if (i != shard.tiles.end())
+            return i->second;
+    }
+
+    if (tileCount >= maxTiles)
+        return TilePtr();
+
+    // Compute the tile from the next finer level without holding the lock; should another
+    // thread happen to compute the same tile concurrently, the first one to finish wins.
+    std::shared_ptr<Tile> tile = std::make_shared<Tile>();
+    TexelReader reader(*this, image);
+    int width      = LevelSize(image->iwidth,  level);
+    int height     = LevelSize(image->iheight, level);
+    int fineWidth  = LevelSize(image->iwidth,  level - 1);
+    int fineHeight = LevelSize(image->iheight, level - 1);
+    RGBFTColour texel;
+
+    for (int y = 0; y < TileSize; y ++)
+    {
+        if (tileY * TileSize + y >= height)
+            break;
+        int fy = (tileY * TileSize + y) * 2;
+        int fy0 = std::min(fy,     fineHeight - 1);
+        int fy1 = std::min(fy + 1, fineHeight - 1);
+
+        for (int x = 0; x < TileSize; x ++)
+        {
+            if (tileX * TileSize + x >= width)
+                break;
+            int fx = (tileX * TileSize + x) * 2;
+            int fx0 = std::min(fx,     fineWidth - 1);
+            int fx1 = std::min(fx + 1, fineWidth - 1);
+
+            RGBFTColour& sum = tile->texels[y * TileSize + x];
+            if (!reader.Get(level - 1, fx0, fy0, sum))
+                return TilePtr();
+            if (!reader.Get(level - 1, fx1, fy0, texel))
+                return TilePtr();
+            sum += texel;
+            if (!reader.Get(level - 1, fx0, fy1, texel))
+                return TilePtr();
+            sum += texel;
+            if (!reader.Get(level - 1, fx1, fy1, texel))
+                return TilePtr();
+            sum += texel;
+            sum *= 0.25;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    std::pair<std::unordered_map<TileKey, TilePtr, TileKeyHash>::iterator, bool> result = shard.tiles.insert(std::make_pair(key, TilePtr(tile)));
+    if (result.second)
+        tileCount ++;
+    return result.first->second;
+}
+
+bool TextureCache::SampleLevel(TexelReader& reader, DBL xcoor, DBL ycoor, int level, RGBFTColour& colour)
+{
+    const ImageData *image = reader.GetImage();
+    int width  = LevelSize(image->iwidth,  level);
+    int height = LevelSize(image->iheight, level);
+
+    // Same convention as the bilinear interpolation of the full-resolution image.
+    DBL fx = xcoor * width  / image->iwidth  - 0.5;
+    DBL fy = ycoor * height / image->iheight - 0.5;
+    int ix = (int)floor(fx);
+    int iy = (int)floor(fy);
+    DBL p = fx - ix;
+    DBL q = fy - iy;
+
+    int x0 = Address(ix,     width,  image->Once_Flag);
+    int x1 = Address(ix + 1, width,  image->Once_Flag);
+    int y0 = Address(iy,     height, image->Once_Flag);
+    int y1 = Address(iy + 1, height, image->Once_Flag);
+
+    RGBFTColour c00, c10, c01, c11;
+    if (!reader.Get(level, x0, y0, c00) || !reader.Get(level, x1, y0, c10) ||
+        !reader.Get(level, x0, y1, c01) || !reader.Get(level, x1, y1, c11))
+        return false;
+
+    colour = (c00 * ColourChannel(1.0 - p) + c10 * ColourChannel(p)) * ColourChannel(1.0 - q) +
+             (c01 * ColourChannel(1.0 - p) + c11 * ColourChannel(p)) * ColourChannel(q);
+    return true;
+}
+
+bool TextureCache::Sample(const ImageData *image, DBL xcoor, DBL ycoor, DBL lod, RGBFTColour& colour)
+{
+    int maxLevel = 0;
+    while ((LevelSize(image->iwidth, maxLevel) > 1) || (LevelSize(image->iheight, maxLevel) > 1))
+        maxLevel ++;
+
+    TexelReader reader(*this, image);
+    int level = std::min((int)lod, maxLevel);
+    DBL weight = (level < maxLevel ? lod - level : 0.0);
+
+    if (!SampleLevel(reader, xcoor, ycoor, level, colour))
+        return false;
+
+    if (weight > 0.0)
+    {
+        RGBFTColour coarse;
+        if (!SampleLevel(reader, xcoor, ycoor, level + 1, coarse))
+            return false;
+        colour = colour * ColourChannel(1.0 - weight) + coarse * ColourChannel(weight);
+    }
+
+    return true;
+}
+
+}
+// end of namespace pov
@@ -0,0 +1,142 @@
+//******************************************************************************
+///
+/// @file core/support/texturecache.h
+///
+/// Declarations related to the mip-mapped image map texture cache.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+#ifndef POVRAY_CORE_TEXTURECACHE_H
+#define POVRAY_CORE_TEXTURECACHE_H
+
+// Module config header file must be the first file included within POV-Ray unit header files
+#include "core/configcore.h"
+
+// C++ variants of C standard header files
+#include <cstddef>
+
+// C++ standard header files
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+// POV-Ray header files (base module)
+#include "base/colour.h"
+#include "base/image/image_fwd.h"
+
+// POV-Ray header files (core module)
+//  (none at the moment)
+
+namespace pov
+{
+
+using namespace pov_base;
+
+class ImageData;
+
+
+//******************************************************************************
+
+/// Mip-mapped image map texture cache.
+///
+/// This class provides box-filtered, reduced resolution versions of image maps, for
+/// use with texel footprints larger than a single pixel of the image. The reduced
+/// levels are organized in tiles of @ref TileSize^2 texels, each of which is computed
+/// on first access from the next finer level and shared by all threads. Once the
+/// memory limit is reached, no further tiles are computed, and the caller must
+/// sample the original image instead.
+///
+/// Tiles store premultiplied colours, so that transparent texels do not bleed their
+/// colour into the reduced levels.
+///
+class TextureCache final
+{
+public:
+
+    static const int TileSize = 32;
+
+    /// Construct a new texture cache.
+    /// @param[in]  maxBytes    Approximate memory limit in bytes.
+    explicit TextureCache(std::size_t maxBytes);
+
+    /// Sample an image with trilinear filtering.
+    /// @param[in]  image   Image to sample.
+    /// @param[in]  xcoor   Horizontal image coordinate, in full-resolution pixels.
+    /// @param[in]  ycoor   Vertical image coordinate, in full-resolution pixels.
+    /// @param[in]  lod     Level of detail, i.e. binary logarithm of the texel footprint in
+    ///                     full-resolution pixels. Must be positive.
+    /// @param[out] colour  Resulting colour, with premultiplied alpha.
+    /// @return             `false` if the memory limit prevented sampling.
+    bool Sample(const ImageData *image, DBL xcoor, DBL ycoor, DBL lod, RGBFTColour& colour);
+
+private:
+
+    struct Tile final
+    {
+        RGBFTColour texels[TileSize * TileSize];
+    };
+    typedef std::shared_ptr<const Tile> TilePtr;
+
+    struct TileKey final
+    {
+        const Image *image;
+        POV_UINT64  index;
+        bool operator==(const TileKey& other) const { return (image == other.image) && (index == other.index); }
+    };
+
+    struct TileKeyHash final
+    {
+        std::size_t operator()(const TileKey& key) const;
+    };
+
+    /// Helper to look up texels, keeping hold of the most recently used tile.
+    class TexelReader;
+
+    static const int ShardCount = 64;
+
+    struct Shard final
+    {
+        std::mutex                                      mutex;
+        std::unordered_map<TileKey, TilePtr, TileKeyHash> tiles;
+    };
+
+    std::size_t         maxTiles;
+    std::atomic<size_t> tileCount;
+    Shard               shards[ShardCount];
+
+    TilePtr GetTile(const ImageData *image, int level, int tileX, int tileY);
+    bool SampleLevel(TexelReader& reader, DBL xcoor, DBL ycoor, int level, RGBFTColour& colour);
+};
+
+}
+// end of namespace pov
+
+#endif // POVRAY_CORE_TEXTURECACHE_H
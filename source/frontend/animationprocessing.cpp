@@ -136,6 +136,7 @@ POVMS_Object AnimationProcessing::GetFrameRenderOptions()
     POVMS_Object opts(renderOptions);
 
     opts.SetFloat(kPOVAttrib_Clock, clockValue);
+    opts.SetInt(kPOVAttrib_FrameNumber, nominalFrameNumber);
 
     // append to console files if not first frame (user can set this for first frame via command line to append all data to existing files, so don't set it to false)
     if(nominalFrameNumber > subsetStartFrame)
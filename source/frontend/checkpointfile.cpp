@@ -0,0 +1,410 @@
+//******************************************************************************
+///
+/// @file frontend/checkpointfile.cpp
+///
+/// Compact render state checkpoints for continuing interrupted renders.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+// Unit header file must be the first file included within POV-Ray *.cpp files (pulls in config)
+#include "frontend/checkpointfile.h"
+
+// C++ variants of C standard header files
+#include <cstring>
+
+// C++ standard header files
+#include <algorithm>
+#include <limits>
+#include <memory>
+
+// POV-Ray header files (base module)
+#include "base/fileinputoutput.h"
+#include "base/filesystem.h"
+
+// POV-Ray header files (POVMS module)
+#include "povms/povmsid.h"
+
+// this must be the last file included
+#include "base/povdebug.h"
+
+namespace pov_frontend
+{
+
+using namespace pov_base;
+
+/// Checkpoint file header.
+///
+/// The header is followed by the payload, which consists of the block completion bitmap (one
+/// bit per block, least significant bit first), the pixels (four floats per pixel), and the
+/// accumulated samples (for each block, five ints for its rectangle and pass, one int for the
+/// number of floats, and the floats themselves).
+///
+/// @note
+///     The file is intended to be read back by the same installation of POV-Ray, so all data
+///     is stored in native byte order.
+///
+struct CheckpointHeader final
+{
+    char        sig[8];
+    POV_UINT32  version;
+    POV_UINT32  width;
+    POV_UINT32  height;
+    POV_UINT32  blockCount;
+    POV_UINT32  sampleBlockCount;
+    POV_UINT32  reserved;
+    POV_UINT64  payloadSize;
+    POV_UINT64  checksum;
+};
+
+static const char       kCheckpointSig[8]   = { 'P', 'O', 'V', 'C', 'K', 'P', 'T', '\0' };
+static const POV_UINT32 kCheckpointVersion  = 1;
+
+/// Running checksum of the payload (64-bit FNV-1a).
+class CheckpointChecksum final
+{
+    public:
+        CheckpointChecksum() : value(14695981039346656037ULL) {}
+        void Add(const void *data, size_t size)
+        {
+            const unsigned char *p = reinterpret_cast<const unsigned char *>(data);
+            for (size_t i = 0; i < size; ++i)
+                value = (value ^ p[i]) * 1099511628211ULL;
+        }
+        POV_UINT64 Get() const { return value; }
+    private:
+        POV_UINT64 value;
+};
+
+/// Checkpoint file writer, keeping track of size and checksum of the payload.
+class CheckpointWriter final
+{
+    public:
+        CheckpointWriter(OStream& f) : file(f), size(0) {}
+        bool Write(const void *data, size_t count)
+        {
+            checksum.Add(data, count);
+            size += count;
+            return file.write(data, count);
+        }
+        bool WriteInt(POVMSInt v) { POV_INT32 i = v; return Write(&i, sizeof(i)); }
+        OStream& file;
+        CheckpointChecksum checksum;
+        POV_UINT64 size;
+};
+
+/// Checkpoint file reader, guarding against reading past the end of the payload.
+class CheckpointReader final
+{
+    public:
+        CheckpointReader(const unsigned char *d, size_t s) : data(d), size(s) {}
+        bool Read(void *buffer, size_t count)
+        {
+            if (count > size)
+                return false;
+            std::memcpy(buffer, data, count);
+            data += count;
+            size -= count;
+            return true;
+        }
+        bool ReadInt(POVMSInt& v) { POV_INT32 i; if (!Read(&i, sizeof(i))) return false; v = i; return true; }
+        const unsigned char *data;
+        size_t size;
+};
+
+CheckpointFile::CheckpointFile(const Path& fn, unsigned int w, unsigned int h, unsigned int seconds) :
+    filename(fn),
+    width(w),
+    height(h),
+    interval(std::chrono::seconds(seconds)),
+    lastSnapshot(Clock::now()),
+    changed(false),
+    snapshotPending(false),
+    writing(false),
+    quit(false)
+{
+    // pixels never rendered are marked as NaN, so that they are not restored when continuing
+    state.pixels.resize(size_t(width) * size_t(height) * 4, std::numeric_limits<float>::quiet_NaN());
+}
+
+CheckpointFile::~CheckpointFile()
+{
+    if (writer.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wakeup.notify_all();
+        writer.join();
+    }
+}
+
+bool CheckpointFile::Load()
+{
+    std::unique_ptr<IMappedFileStream> file(new IMappedFileStream(filename()));
+    if (!*file)
+        return false;
+
+    size_t size = 0;
+    const unsigned char *data = file->readSpan(size);
+    CheckpointHeader hdr;
+
+    if ((data == nullptr) || (size < sizeof(hdr)))
+        return false;
+    std::memcpy(&hdr, data, sizeof(hdr));
+    if ((std::memcmp(hdr.sig, kCheckpointSig, sizeof(hdr.sig)) != 0) || (hdr.version != kCheckpointVersion) ||
+        (hdr.width != width) || (hdr.height != height) || (hdr.payloadSize != size - sizeof(hdr)))
+        return false;
+
+    CheckpointChecksum checksum;
+    checksum.Add(data + sizeof(hdr), size - sizeof(hdr));
+    if (checksum.Get() != hdr.checksum)
+        return false;
+
+    CheckpointReader in(data + sizeof(hdr), size - sizeof(hdr));
+    State s;
+
+    std::vector<unsigned char> bitmap((hdr.blockCount + 7) / 8);
+    if (!in.Read(bitmap.data(), bitmap.size()))
+        return false;
+    s.blocks.resize(hdr.blockCount);
+    for (POV_UINT32 i = 0; i < hdr.blockCount; ++i)
+        s.blocks[i] = ((bitmap[i / 8] >> (i % 8)) & 1) != 0;
+
+    s.pixels.resize(size_t(width) * size_t(height) * 4);
+    if (!in.Read(s.pixels.data(), s.pixels.size() * sizeof(float)))
+        return false;
+
+    for (POV_UINT32 i = 0; i < hdr.sampleBlockCount; ++i)
+    {
+        SampleBlock block;
+        POVMSInt count;
+        if (!in.ReadInt(block.left) || !in.ReadInt(block.top) || !in.ReadInt(block.right) || !in.ReadInt(block.bottom) ||
+            !in.ReadInt(block.pass) || !in.ReadInt(count) || (count < 0) || (size_t(count) > in.size / sizeof(POVMSFloat)))
+            return false;
+        block.stats.resize(count);
+        if (!in.Read(block.stats.data(), block.stats.size() * sizeof(POVMSFloat)))
+            return false;
+        s.samples[std::make_pair(block.left, block.top)] = std::move(block);
+    }
+
+    state = std::move(s);
+    changed = false;
+    return true;
+}
+
+void CheckpointFile::SetPixel(unsigned int x, unsigned int y, const RGBTColour& col)
+{
+    if ((x >= width) || (y >= height))
+        return;
+
+    float *p = &state.pixels[(size_t(y) * width + x) * 4];
+    p[0] = col.red();
+    p[1] = col.green();
+    p[2] = col.blue();
+    p[3] = col.transm();
+    changed = true;
+}
+
+void CheckpointFile::BlockCompleted(POVMSInt id)
+{
+    if (id < 0)
+        return;
+    if (size_t(id) >= state.blocks.size())
+        state.blocks.resize(id + 1, false);
+    state.blocks[id] = true;
+    changed = true;
+}
+
+void CheckpointFile::SetSampleStatistics(POVMSInt left, POVMSInt top, POVMSInt right, POVMSInt bottom, POVMSInt pass, const std::vector<POVMSFloat>& stats)
+{
+    SampleBlock& block = state.samples[std::make_pair(left, top)];
+    block.left   = left;
+    block.top    = top;
+    block.right  = right;
+    block.bottom = bottom;
+    block.pass   = pass;
+    block.stats  = stats;
+    changed = true;
+}
+
+void CheckpointFile::Update()
+{
+    if (changed && (Clock::now() - lastSnapshot >= interval))
+        TakeSnapshot();
+}
+
+void CheckpointFile::Flush()
+{
+    TakeSnapshot();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    written.wait(lock, [this] { return !snapshotPending && !writing; });
+}
+
+RGBTColour CheckpointFile::GetPixel(unsigned int x, unsigned int y) const
+{
+    const float *p = &state.pixels[(size_t(y) * width + x) * 4];
+    return RGBTColour(p[0], p[1], p[2], p[3]);
+}
+
+void CheckpointFile::GetCompletedBlocks(POVMSInt& serial, std::vector<POVMSInt>& skip) const
+{
+    size_t i = 0;
+
+    while ((i < state.blocks.size()) && state.blocks[i])
+        ++i;
+    serial = POVMSInt(i);
+
+    skip.clear();
+    for (++i; i < state.blocks.size(); ++i)
+    {
+        if (state.blocks[i])
+            skip.push_back(POVMSInt(i));
+    }
+}
+
+bool CheckpointFile::GetSampleStatistics(POVMS_List& stats) const
+{
+    if (state.samples.empty())
+        return false;
+
+    for (SampleBlockMap::const_iterator i(state.samples.begin()); i != state.samples.end(); ++i)
+    {
+        POVMS_Object block(kPOVObjectClass_PixelData);
+        std::vector<POVMSFloat> values(i->second.stats);
+
+        block.SetInt(kPOVAttrib_Left, i->second.left);
+        block.SetInt(kPOVAttrib_Top, i->second.top);
+        block.SetInt(kPOVAttrib_Right, i->second.right);
+        block.SetInt(kPOVAttrib_Bottom, i->second.bottom);
+        block.SetFloatVector(kPOVAttrib_SampleStatistics, values);
+        block.SetInt(kPOVAttrib_SamplePass, i->second.pass);
+        stats.Append(block);
+    }
+    return true;
+}
+
+void CheckpointFile::TakeSnapshot()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        // a snapshot not yet written is simply superseded
+        snapshot = state;
+        snapshotPending = true;
+    }
+
+    if (!writer.joinable())
+        writer = std::thread(&CheckpointFile::WriterThread, this);
+    wakeup.notify_all();
+
+    lastSnapshot = Clock::now();
+    changed = false;
+}
+
+void CheckpointFile::WriterThread()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true)
+    {
+        wakeup.wait(lock, [this] { return snapshotPending || quit; });
+        if (quit)
+            break;
+
+        State s(std::move(snapshot));
+        snapshotPending = false;
+        writing = true;
+        lock.unlock();
+
+        Write(s);
+
+        lock.lock();
+        writing = false;
+        written.notify_all();
+    }
+}
+
+void CheckpointFile::Write(const State& s)
+{
+    // write to a temporary file first and replace the checkpoint file only once complete,
+    // so that an interruption at any time leaves a valid checkpoint behind
+    UCS2String tempName(filename() + u".tmp");
+    bool ok;
+
+    {
+        OStream file(tempName);
+        if (!file)
+            return;
+
+        CheckpointHeader hdr;
+        std::memset(&hdr, 0, sizeof(hdr));
+        ok = file.write(&hdr, sizeof(hdr));
+
+        CheckpointWriter out(file);
+
+        std::vector<unsigned char> bitmap((s.blocks.size() + 7) / 8, 0);
+        for (size_t i = 0; i < s.blocks.size(); ++i)
+        {
+            if (s.blocks[i])
+                bitmap[i / 8] |= (unsigned char)(1 << (i % 8));
+        }
+        ok = ok && out.Write(bitmap.data(), bitmap.size());
+        ok = ok && out.Write(s.pixels.data(), s.pixels.size() * sizeof(float));
+
+        for (SampleBlockMap::const_iterator i(s.samples.begin()); ok && (i != s.samples.end()); ++i)
+        {
+            ok = out.WriteInt(i->second.left) && out.WriteInt(i->second.top) &&
+                 out.WriteInt(i->second.right) && out.WriteInt(i->second.bottom) &&
+                 out.WriteInt(i->second.pass) && out.WriteInt(POVMSInt(i->second.stats.size())) &&
+                 out.Write(i->second.stats.data(), i->second.stats.size() * sizeof(POVMSFloat));
+        }
+
+        std::memcpy(hdr.sig, kCheckpointSig, sizeof(hdr.sig));
+        hdr.version          = kCheckpointVersion;
+        hdr.width            = width;
+        hdr.height           = height;
+        hdr.blockCount       = POV_UINT32(s.blocks.size());
+        hdr.sampleBlockCount = POV_UINT32(s.samples.size());
+        hdr.payloadSize      = out.size;
+        hdr.checksum         = out.checksum.Get();
+
+        ok = ok && file.seekg(0, IOBase::seek_set) && file.write(&hdr, sizeof(hdr));
+        ok = ok && !!file.flush();
+    }
+
+    if (ok)
+        ok = Filesystem::RenameFile(tempName, filename());
+    if (!ok)
+        (void)Filesystem::DeleteFile(tempName);
+}
+
+}
+// end of namespace pov_frontend
@@ -0,0 +1,169 @@
+//******************************************************************************
+///
+/// @file frontend/checkpointfile.h
+///
+/// Compact render state checkpoints for continuing interrupted renders.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+#ifndef POVRAY_FRONTEND_CHECKPOINTFILE_H
+#define POVRAY_FRONTEND_CHECKPOINTFILE_H
+
+// Module config header file must be the first file included within POV-Ray unit header files
+#include "frontend/configfrontend.h"
+
+// C++ variants of C standard header files
+//  (none at the moment)
+
+// C++ standard header files
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// POV-Ray header files (base module)
+#include "base/colour.h"
+#include "base/path.h"
+
+// POV-Ray header files (POVMS module)
+#include "povms/povmscpp.h"
+
+namespace pov_frontend
+{
+
+/// Render state checkpoint.
+///
+/// As an alternative to the render state log, which records every final pixel message and is
+/// replayed message by message when a render is continued, a checkpoint holds a copy of the
+/// final pixels, a bitmap of the blocks completed, and the samples accumulated in progressive
+/// mode. A snapshot of this state is written periodically by a background thread, to a
+/// temporary file that then replaces the checkpoint file, so that the checkpoint file is
+/// always complete; its contents are protected by a checksum. Continuing a render loads the
+/// checkpoint in time proportional to the image size, regardless of how long the render ran.
+///
+class CheckpointFile final
+{
+    public:
+
+        /// Create a checkpoint for an image of the given size.
+        ///
+        /// @param  filename    Name of the checkpoint file.
+        /// @param  width       Width of the image.
+        /// @param  height      Height of the image.
+        /// @param  interval    Minimum time between snapshots, in seconds.
+        ///
+        CheckpointFile(const pov_base::Path& filename, unsigned int width, unsigned int height, unsigned int interval);
+
+        /// Stop the background writer, discarding any snapshot not yet written.
+        ~CheckpointFile();
+
+        CheckpointFile(const CheckpointFile&) = delete;
+        CheckpointFile& operator=(const CheckpointFile&) = delete;
+
+        /// Load the state from the checkpoint file.
+        ///
+        /// @return `false` if the file does not exist, or is incomplete, corrupt or for another image size.
+        ///
+        bool Load();
+
+        /// Store a final pixel.
+        void SetPixel(unsigned int x, unsigned int y, const pov_base::RGBTColour& col);
+
+        /// Mark a block as completed.
+        void BlockCompleted(POVMSInt id);
+
+        /// Store the samples accumulated for a block in progressive mode, superseding those of earlier passes.
+        void SetSampleStatistics(POVMSInt left, POVMSInt top, POVMSInt right, POVMSInt bottom, POVMSInt pass, const std::vector<POVMSFloat>& stats);
+
+        /// Have a snapshot written in the background if the state has changed and the interval has elapsed.
+        void Update();
+
+        /// Write a snapshot of the current state and wait for it to be written.
+        void Flush();
+
+        /// Get a pixel of the image.
+        pov_base::RGBTColour GetPixel(unsigned int x, unsigned int y) const;
+
+        /// Get the continue-trace block information: the first block not completed, and the blocks
+        /// completed after it.
+        void GetCompletedBlocks(POVMSInt& serial, std::vector<POVMSInt>& skip) const;
+
+        /// Get the samples accumulated in progressive mode, in the format expected with the render options.
+        bool GetSampleStatistics(POVMS_List& stats) const;
+
+    private:
+
+        typedef std::chrono::steady_clock Clock;
+
+        struct SampleBlock final
+        {
+            POVMSInt left, top, right, bottom, pass;
+            std::vector<POVMSFloat> stats;
+        };
+
+        typedef std::map<std::pair<POVMSInt, POVMSInt>, SampleBlock> SampleBlockMap;
+
+        /// State of the render, as held in memory and written to the file.
+        struct State final
+        {
+            std::vector<float> pixels;      ///< Red, green, blue and transmit of each pixel, in row-major order.
+            std::vector<bool> blocks;       ///< Completion flag of each block, by block id.
+            SampleBlockMap samples;         ///< Samples accumulated in progressive mode, by top left corner of the block.
+        };
+
+        pov_base::Path filename;
+        unsigned int width;
+        unsigned int height;
+        Clock::duration interval;
+        Clock::time_point lastSnapshot;
+        bool changed;
+        State state;
+
+        std::thread writer;
+        std::mutex mutex;
+        std::condition_variable wakeup;
+        std::condition_variable written;
+        State snapshot;                     ///< State to be written next; guarded by @ref mutex.
+        bool snapshotPending;               ///< Whether @ref snapshot is waiting to be written; guarded by @ref mutex.
+        bool writing;                       ///< Whether a snapshot is being written; guarded by @ref mutex.
+        bool quit;                          ///< Whether the writer is to terminate; guarded by @ref mutex.
+
+        void TakeSnapshot();
+        void WriterThread();
+        void Write(const State& s);
+};
+
+}
+// end of namespace pov_frontend
+
+#endif // POVRAY_FRONTEND_CHECKPOINTFILE_H
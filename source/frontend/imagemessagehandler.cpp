@@ -149,6 +149,9 @@ void ImageMessageHandler::DrawPixelSet(const SceneData& sd, const ViewData& vd,
 
             if (final && (vd.image != nullptr) && (x < vd.image->GetWidth()) && (y < vd.image->GetHeight()))
                 vd.image->SetRGBTValue(x, y, col);
+
+            if (final && (vd.checkpoint != nullptr))
+                vd.checkpoint->SetPixel(x, y, col);
         }
         else
         {
@@ -163,6 +166,15 @@ void ImageMessageHandler::DrawPixelSet(const SceneData& sd, const ViewData& vd,
                         vd.image->SetRGBTValue(x + px, y + py, col);
                 }
             }
+
+            if (final && (vd.checkpoint != nullptr))
+            {
+                for(unsigned int py = 0; py < psize; py++)
+                {
+                    for(unsigned int px = 0; px < psize; px++)
+                        vd.checkpoint->SetPixel(x + px, y + py, col);
+                }
+            }
         }
     }
 
@@ -171,6 +183,13 @@ void ImageMessageHandler::DrawPixelSet(const SceneData& sd, const ViewData& vd,
         msg.Write(*vd.imageBackup);
         vd.imageBackup->flush();
     }
+
+    if (final && (vd.checkpoint != nullptr))
+    {
+        if (msg.Exist(kPOVAttrib_PixelId))
+            vd.checkpoint->BlockCompleted(msg.GetInt(kPOVAttrib_PixelId));
+        vd.checkpoint->Update();
+    }
 }
 
 void ImageMessageHandler::DrawPixelBlockSet(const SceneData& sd, const ViewData& vd, POVMS_Object& msg, bool final)
@@ -180,22 +199,30 @@ void ImageMessageHandler::DrawPixelBlockSet(const SceneData& sd, const ViewData&
     vector<RGBTColour> cols;
     vector<Display::RGBA8> rgbas;
     unsigned int psize(msg.GetInt(kPOVAttrib_PixelSize));
+    const SharedFramebuffer *framebuffer = nullptr;
+    vector<POVMSFloat> pixelvector;
     int i = 0;
 
-    msg.Get(kPOVAttrib_PixelBlock, pixelattr);
-
-    vector<POVMSFloat> pixelvector(pixelattr.GetFloatVector());
+    // the backend may have stored the pixels in the shared framebuffer rather than sending them
+    if ((vd.sharedFramebuffer != nullptr) && (msg.TryGetInt(kPOVAttrib_SharedFramebufferId, 0) == vd.sharedFramebuffer->GetId()))
+        framebuffer = vd.sharedFramebuffer.get();
+    else
+    {
+        msg.Get(kPOVAttrib_PixelBlock, pixelattr);
+        pixelvector = pixelattr.GetFloatVector();
+    }
 
     cols.reserve(rect.GetArea());
     rgbas.reserve(rect.GetArea());
 
     for(i = 0; i < rect.GetArea() *  5; i += 5)
     {
-        RGBTColour col(pixelvector[i], pixelvector[i + 1], pixelvector[i + 2], pixelvector[i + 4]); // NB pixelvector[i + 3] is an unused channel
-        RGBTColour gcol(col);
-        Display::RGBA8 rgba;
         unsigned int x(rect.left + (i/5) % rect.GetWidth());
         unsigned int y(rect.top  + (i/5) / rect.GetWidth());
+        RGBTColour col(framebuffer != nullptr ? framebuffer->GetPixel(x, y)
+                                              : RGBTColour(pixelvector[i], pixelvector[i + 1], pixelvector[i + 2], pixelvector[i + 4])); // NB pixelvector[i + 3] is an unused channel
+        RGBTColour gcol(col);
+        Display::RGBA8 rgba;
         float dither = GetDitherOffset(x, y);
 
         if (vd.display != nullptr)
@@ -252,11 +279,62 @@ void ImageMessageHandler::DrawPixelBlockSet(const SceneData& sd, const ViewData&
         }
     }
 
+    if (final && (vd.features != nullptr) && (psize == 1) && msg.Exist(kPOVAttrib_PixelFeatures))
+    {
+        POVMS_Attribute featuresattr;
+        msg.Get(kPOVAttrib_PixelFeatures, featuresattr);
+        vd.features->SetBlock(rect.left, rect.top, rect.right, rect.bottom, featuresattr.GetFloatVector());
+    }
+
+    if (final && (vd.costMap != nullptr) && (psize == 1) && msg.Exist(kPOVAttrib_PixelCosts))
+    {
+        POVMS_Attribute costsattr;
+        msg.Get(kPOVAttrib_PixelCosts, costsattr);
+        vd.costMap->AddBlock(rect.left, rect.top, rect.right, rect.bottom, costsattr.GetFloatVector());
+    }
+
     if (final && (vd.imageBackup != nullptr))
     {
+        // the render state file must hold the pixels themselves
+        if (framebuffer != nullptr)
+        {
+            pixelvector.reserve(cols.size() * 5);
+            for(vector<RGBTColour>::const_iterator c(cols.begin()); c != cols.end(); c++)
+            {
+                pixelvector.push_back(c->red());
+                pixelvector.push_back(c->green());
+                pixelvector.push_back(c->blue());
+                pixelvector.push_back(0.0); // unused component
+                pixelvector.push_back(c->transm());
+            }
+            POVMS_Attribute backupattr(pixelvector);
+            msg.Set(kPOVAttrib_PixelBlock, backupattr);
+            msg.Remove(kPOVAttrib_SharedFramebufferId);
+        }
         msg.Write(*vd.imageBackup);
         vd.imageBackup->flush();
     }
+
+    if (final && (vd.checkpoint != nullptr))
+    {
+        for(unsigned int y = rect.top, i = 0; y <= rect.bottom; y += psize)
+        {
+            for(unsigned int x = rect.left; x <= rect.right; x += psize, i++)
+            {
+                for(unsigned int py = 0; py < psize; py++)
+                {
+                    for(unsigned int px = 0; px < psize; px++)
+                        vd.checkpoint->SetPixel(x + px, y + py, cols[i]);
+                }
+            }
+        }
+        if (msg.Exist(kPOVAttrib_SampleStatistics))
+            vd.checkpoint->SetSampleStatistics(rect.left, rect.top, rect.right, rect.bottom, msg.TryGetInt(kPOVAttrib_SamplePass, 0),
+                                               msg.GetFloatVector(kPOVAttrib_SampleStatistics));
+        if (msg.Exist(kPOVAttrib_PixelId))
+            vd.checkpoint->BlockCompleted(msg.GetInt(kPOVAttrib_PixelId));
+        vd.checkpoint->Update();
+    }
 }
 
 void ImageMessageHandler::DrawPixelRowSet(const SceneData& sd, const ViewData& vd, POVMS_Object& msg, bool final)
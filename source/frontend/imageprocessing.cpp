@@ -37,12 +37,23 @@
 #include "frontend/imageprocessing.h"
 
 // C++ variants of C standard header files
+#include <cmath>
+
 // C++ standard header files
-//  (none at the moment)
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 // POV-Ray header files (base module)
 #include "base/fileinputoutput.h"
 #include "base/path.h"
+#include "base/stringutilities.h"
 #include "base/image/colourspace.h"
 #include "base/image/dither.h"
 #include "base/image/image.h"
@@ -56,10 +67,6 @@
 // this must be the last file included
 #include "base/povdebug.h"
 
-// TODO: update ImageProcessing with the means of accepting and caching
-// blocks of pixels as opposed to individual ones, with a back-end that
-// can serialize completed rows to the final image output file.
-
 namespace pov_frontend
 {
 
@@ -72,9 +79,602 @@ enum
     Z = 2
 };
 
-ImageProcessing::ImageProcessing(unsigned int width, unsigned int height)
+//******************************************************************************
+
+/// Image container for streaming output.
+///
+/// This container holds only those rows of the image that have been started but not yet written
+/// to the output file. As soon as the topmost pending rows have been completely filled in, they
+/// are handed to an @ref ImageStreamWriter and discarded.
+///
+/// @note
+///     The number of rows held depends on the order in which blocks are rendered: With the default
+///     render pattern only a few rows of blocks are pending at any time, while render patterns
+///     that visit the bottom of the image early require correspondingly more memory.
+///
+class StreamedImage final : public Image
+{
+    public:
+
+        StreamedImage(unsigned int w, unsigned int h) : Image(w, h, ImageDataType::RGBFT_Float), nextRow(0), cachedRow(nullptr) { }
+        virtual ~StreamedImage() override { }
+
+        /// Start writing a new image, discarding any previous image data.
+        void Start(OStream *file, ImageStreamWriter *writer);
+
+        /// Write all remaining rows, filling in any missing pixels, and complete the file.
+        void Finish();
+
+        virtual bool IsOpaque() const override { throw POV_EXCEPTION(kUncategorizedError, "Internal error: IsOpaque() not supported in StreamedImage"); }
+        virtual bool IsGrayscale() const override { return false; }
+        virtual bool IsColour() const override { return true; }
+        virtual bool IsFloat() const override { return true; }
+        virtual bool IsInt() const override { return false; }
+        virtual bool IsIndexed() const override { return false; }
+        virtual bool IsGammaEncoded() const override { return false; }
+        virtual bool HasAlphaChannel() const override { return false; }
+        virtual bool HasFilterTransmit() const override { return true; }
+        virtual unsigned int GetMaxIntValue() const override { return 255; }
+        virtual bool TryDeferDecoding(GammaCurvePtr&, unsigned int) override { return false; }
+
+        virtual bool GetBitValue(unsigned int x, unsigned int y) const override
+        {
+            float red, green, blue, filter, transm;
+            GetRGBFTValue(x, y, red, green, blue, filter, transm);
+            return (red * green * blue != 0.0f);
+        }
+        virtual float GetGrayValue(unsigned int x, unsigned int y) const override
+        {
+            float red, green, blue, filter, transm;
+            GetRGBFTValue(x, y, red, green, blue, filter, transm);
+            return RGB2Gray(red, green, blue);
+        }
+        virtual void GetGrayAValue(unsigned int x, unsigned int y, float& gray, float& alpha) const override
+        {
+            float red, green, blue, filter, transm;
+            GetRGBFTValue(x, y, red, green, blue, filter, transm);
+            gray = RGB2Gray(red, green, blue);
+            alpha = RGBFTColour::FTtoA(filter, transm);
+        }
+        virtual void GetRGBValue(unsigned int x, unsigned int y, float& red, float& green, float& blue) const override
+        {
+            float filter, transm;
+            GetRGBFTValue(x, y, red, green, blue, filter, transm);
+        }
+        virtual void GetRGBAValue(unsigned int x, unsigned int y, float& red, float& green, float& blue, float& alpha) const override
+        {
+            float filter, transm;
+            GetRGBFTValue(x, y, red, green, blue, filter, transm);
+            alpha = RGBFTColour::FTtoA(filter, transm);
+        }
+        virtual void GetRGBTValue(unsigned int x, unsigned int y, float& red, float& green, float& blue, float& transm) const override
+        {
+            float filter;
+            GetRGBFTValue(x, y, red, green, blue, filter, transm);
+            transm = 1.0 - RGBFTColour::FTtoA(filter, transm);
+        }
+        virtual void GetRGBFTValue(unsigned int x, unsigned int y, float& red, float& green, float& blue, float& filter, float& transm) const override;
+
+        virtual void SetBitValue(unsigned int x, unsigned int y, bool bit) override
+        {
+            SetGrayValue(x, y, bit ? 1.0f : 0.0f);
+        }
+        virtual void SetGrayValue(unsigned int x, unsigned int y, float gray) override
+        {
+            SetRGBFTValue(x, y, gray, gray, gray, 0.0f, 0.0f);
+        }
+        virtual void SetGrayValue(unsigned int x, unsigned int y, unsigned int gray) override
+        {
+            SetGrayValue(x, y, float(gray) / 255.0f);
+        }
+        virtual void SetGrayAValue(unsigned int x, unsigned int y, float gray, float alpha) override
+        {
+            float filter, transm;
+            RGBFTColour::AtoFT(alpha, filter, transm);
+            SetRGBFTValue(x, y, gray, gray, gray, filter, transm);
+        }
+        virtual void SetGrayAValue(unsigned int x, unsigned int y, unsigned int gray, unsigned int alpha) override
+        {
+            SetGrayAValue(x, y, float(gray) / 255.0f, float(alpha) / 255.0f);
+        }
+        virtual void SetRGBValue(unsigned int x, unsigned int y, float red, float green, float blue) override
+        {
+            SetRGBFTValue(x, y, red, green, blue, 0.0f, 0.0f);
+        }
+        virtual void SetRGBValue(unsigned int x, unsigned int y, unsigned int red, unsigned int green, unsigned int blue) override
+        {
+            SetRGBFTValue(x, y, float(red) / 255.0f, float(green) / 255.0f, float(blue) / 255.0f, 0.0f, 0.0f);
+        }
+        virtual void SetRGBAValue(unsigned int x, unsigned int y, float red, float green, float blue, float alpha) override
+        {
+            float filter, transm;
+            RGBFTColour::AtoFT(alpha, filter, transm);
+            SetRGBFTValue(x, y, red, green, blue, filter, transm);
+        }
+        virtual void SetRGBAValue(unsigned int x, unsigned int y, unsigned int red, unsigned int green, unsigned int blue, unsigned int alpha) override
+        {
+            SetRGBAValue(x, y, float(red) / 255.0f, float(green) / 255.0f, float(blue) / 255.0f, float(alpha) / 255.0f);
+        }
+        virtual void SetRGBTValue(unsigned int x, unsigned int y, float red, float green, float blue, float transm) override
+        {
+            SetRGBFTValue(x, y, red, green, blue, 0.0f, transm);
+        }
+        virtual void SetRGBTValue(unsigned int x, unsigned int y, const RGBTColour& col) override
+        {
+            SetRGBFTValue(x, y, col.red(), col.green(), col.blue(), 0.0f, col.transm());
+        }
+        virtual void SetRGBFTValue(unsigned int x, unsigned int y, float red, float green, float blue, float filter, float transm) override
+        {
+            SetRGBFTValue(x, y, RGBFTColour(red, green, blue, filter, transm));
+        }
+        virtual void SetRGBFTValue(unsigned int x, unsigned int y, const RGBFTColour& col) override;
+
+        // Rows are discarded once written, so filling the entire image is not supported.
+        virtual void FillBitValue(bool) override { FillNotSupported(); }
+        virtual void FillGrayValue(float) override { FillNotSupported(); }
+        virtual void FillGrayValue(unsigned int) override { FillNotSupported(); }
+        virtual void FillGrayAValue(float, float) override { FillNotSupported(); }
+        virtual void FillGrayAValue(unsigned int, unsigned int) override { FillNotSupported(); }
+        virtual void FillRGBValue(float, float, float) override { FillNotSupported(); }
+        virtual void FillRGBValue(unsigned int, unsigned int, unsigned int) override { FillNotSupported(); }
+        virtual void FillRGBAValue(float, float, float, float) override { FillNotSupported(); }
+        virtual void FillRGBAValue(unsigned int, unsigned int, unsigned int, unsigned int) override { FillNotSupported(); }
+        virtual void FillRGBTValue(float, float, float, float) override { FillNotSupported(); }
+        virtual void FillRGBFTValue(float, float, float, float, float) override { FillNotSupported(); }
+
+    private:
+
+        struct Row final
+        {
+            std::vector<RGBFTColour>    pixels;
+            std::vector<bool>           done;
+            unsigned int                count;
+        };
+
+        std::map<unsigned int, Row>         rows;
+        std::unique_ptr<OStream>            file;
+        std::unique_ptr<ImageStreamWriter>  writer;
+        unsigned int                        nextRow;    ///< Topmost row not yet written.
+        mutable const Row*                  cachedRow;  ///< Row most recently accessed by @ref GetRGBFTValue().
+        mutable unsigned int                cachedY;
+
+        Row& GetRow(unsigned int y);
+        void WriteCompletedRows();
+
+        static void FillNotSupported() { throw POV_EXCEPTION(kUncategorizedError, "Internal error: Fill...() not supported in StreamedImage"); }
+};
+
+void StreamedImage::Start(OStream *f, ImageStreamWriter *w)
+{
+    // Make sure the writer is destroyed before the file it writes to.
+    writer.reset();
+    file.reset(f);
+    writer.reset(w);
+    rows.clear();
+    cachedRow = nullptr;
+    nextRow = 0;
+    WriteCompletedRows();
+}
+
+void StreamedImage::Finish()
+{
+    if (writer == nullptr)
+        return;
+
+    // If the render was incomplete, pixels not yet rendered end up black.
+    for (; nextRow < height; ++nextRow)
+    {
+        GetRow(nextRow);
+        writer->WriteRows(this, nextRow, 1);
+        rows.erase(nextRow);
+        cachedRow = nullptr;
+    }
+
+    writer->Finish();
+    writer.reset();
+    file.reset();
+}
+
+StreamedImage::Row& StreamedImage::GetRow(unsigned int y)
+{
+    Row& row = rows[y];
+    if (row.pixels.empty())
+    {
+        row.pixels.resize(width, RGBFTColour(0.0f, 0.0f, 0.0f, 0.0f, 0.0f));
+        row.done.resize(width, false);
+        row.count = 0;
+    }
+    return row;
+}
+
+void StreamedImage::GetRGBFTValue(unsigned int x, unsigned int y, float& red, float& green, float& blue, float& filter, float& transm) const
+{
+    if ((cachedRow == nullptr) || (cachedY != y))
+    {
+        auto i = rows.find(y);
+        cachedRow = ((i == rows.end()) ? nullptr : &i->second);
+        cachedY = y;
+    }
+    if ((cachedRow == nullptr) || (x >= width))
+    {
+        red = green = blue = filter = transm = 0.0f;
+        return;
+    }
+    const RGBFTColour& col = cachedRow->pixels[x];
+    red    = col.red();
+    green  = col.green();
+    blue   = col.blue();
+    filter = col.filter();
+    transm = col.transm();
+}
+
+void StreamedImage::SetRGBFTValue(unsigned int x, unsigned int y, const RGBFTColour& col)
+{
+    // Ignore pixels outside the image, as well as pixels in rows that have already been written.
+    if ((x >= width) || (y >= height) || (y < nextRow))
+        return;
+
+    Row& row = GetRow(y);
+    row.pixels[x] = col;
+    if (!row.done[x])
+    {
+        row.done[x] = true;
+        if ((++row.count == width) && (y == nextRow))
+            WriteCompletedRows();
+    }
+}
+
+void StreamedImage::WriteCompletedRows()
+{
+    if (writer == nullptr)
+        return;
+
+    unsigned int count = 0;
+    for (auto i = rows.find(nextRow); (i != rows.end()) && (i->first == nextRow + count) && (i->second.count == width); ++i)
+        ++count;
+    if (count == 0)
+        return;
+
+    writer->WriteRows(this, nextRow, count);
+    rows.erase(rows.find(nextRow), rows.lower_bound(nextRow + count));
+    cachedRow = nullptr;
+    nextRow += count;
+}
+
+//******************************************************************************
+
+static Image::ImageFileType GetImageWriteSettings(POVMS_Object& ropts, unsigned int width, unsigned int& filetype, ImageWriteOptions& wopts)
+{
+    Image::ImageFileType imagetype = Image::SYS;
+    filetype = POV_File_Image_System;
+
+    wopts.bitsPerChannel = clip(ropts.TryGetInt(kPOVAttrib_BitsPerColor, 8), 1, 16);
+    wopts.alphaMode = (ropts.TryGetBool(kPOVAttrib_OutputAlpha, false) ? ImageAlphaMode::Default : ImageAlphaMode::None );
+    wopts.compression = (ropts.Exist(kPOVAttrib_Compression) ? clip(ropts.GetInt(kPOVAttrib_Compression), 0, 255) : -1);
+    wopts.grayscale = ropts.TryGetBool(kPOVAttrib_GrayscaleOutput, false);
+    wopts.threads = clip(ropts.TryGetInt(kPOVAttrib_MaxRenderThreads, 1), 1, 512); // same budget as the render itself
+
+    switch(ropts.TryGetInt(kPOVAttrib_OutputFileType, DEFAULT_OUTPUT_FORMAT))
+    {
+        case kPOVList_FileType_Targa:
+            imagetype = Image::TGA;
+            filetype = POV_File_Image_Targa;
+            break;
+        case kPOVList_FileType_CompressedTarga:
+            // TODO - this file type is obsolete, as Targa compression can now
+            // be controlled using the `Compression` INI setting.
+            imagetype = Image::TGA;
+            filetype = POV_File_Image_Targa;
+            wopts.compression = 1;
+            break;
+        case kPOVList_FileType_PNG:
+            imagetype = Image::PNG;
+            filetype = POV_File_Image_PNG;
+            break;
+        case kPOVList_FileType_JPEG:
+            imagetype = Image::JPEG;
+            filetype = POV_File_Image_JPEG;
+            break;
+        case kPOVList_FileType_PPM:
+            imagetype = Image::PPM;
+            filetype = POV_File_Image_PPM;
+            break;
+        case kPOVList_FileType_BMP:
+            imagetype = Image::BMP;
+            filetype = POV_File_Image_BMP;
+            break;
+        case kPOVList_FileType_OpenEXR:
+            imagetype = Image::EXR;
+            filetype = POV_File_Image_EXR;
+            break;
+        case kPOVList_FileType_RadianceHDR:
+            imagetype = Image::HDR;
+            filetype = POV_File_Image_HDR;
+            break;
+        case kPOVList_FileType_System:
+            imagetype = Image::SYS;
+            filetype = POV_File_Image_System;
+            break;
+        default:
+            throw POV_EXCEPTION_STRING("Invalid file type for output");
+    }
+
+    GammaTypeId gammaType;
+    float gamma;
+    if (ropts.Exist(kPOVAttrib_FileGammaType))
+    {
+        gammaType = (GammaTypeId)ropts.GetInt(kPOVAttrib_FileGammaType);
+        gamma = ropts.GetFloat(kPOVAttrib_FileGamma);
+        wopts.encodingGamma = GetGammaCurve(gammaType, gamma);
+    }
+    else
+    {
+        // if user didn't explicitly specify File_Gamma, use the file format specific default.
+        wopts.encodingGamma.reset();
+    }
+    // NB: RenderFrontend<...>::CreateView should have dealt with kPOVAttrib_LegacyGammaMode already and updated kPOVAttrib_WorkingGammaType and kPOVAttrib_WorkingGamma to fit.
+    gammaType = (GammaTypeId)ropts.TryGetInt(kPOVAttrib_WorkingGammaType, DEFAULT_WORKING_GAMMA_TYPE);
+    gamma = ropts.TryGetFloat(kPOVAttrib_WorkingGamma, DEFAULT_WORKING_GAMMA);
+    wopts.workingGamma = GetGammaCurve(gammaType, gamma);
+
+    bool dither = ropts.TryGetBool(kPOVAttrib_Dither, false);
+    DitherMethodId ditherMethod = DitherMethodId::kNone;
+    if (dither)
+        ditherMethod = ropts.TryGetEnum(kPOVAttrib_DitherMethod, DitherMethodId::kBlueNoise);
+    wopts.ditherStrategy = GetDitherStrategy(ditherMethod, width);
+
+    return imagetype;
+}
+
+/// Write an image to file.
+static void WriteImageFile(const Image *image, POVMS_Object& ropts, const UCS2String& filename)
+{
+    ImageWriteOptions wopts;
+    unsigned int filetype;
+    Image::ImageFileType imagetype = GetImageWriteSettings(ropts, image->GetWidth(), filetype, wopts);
+
+    std::unique_ptr<OStream> imagefile(NewOStream(filename.c_str(), filetype, false)); // TODO - check file permissions somehow without macro [ttrf]
+    if (imagefile == nullptr)
+        throw POV_EXCEPTION_CODE(kCannotOpenFileErr);
+
+    Image::Write(imagetype, imagefile.get(), image, wopts);
+}
+
+//******************************************************************************
+
+constexpr unsigned int ImageFeatures::kSize;
+
+ImageFeatures::ImageFeatures(unsigned int w, unsigned int h) :
+    width(w),
+    height(h),
+    values(std::size_t(w) * h * kSize, 0.0f),
+    present(std::size_t(w) * h, false)
+{}
+
+void ImageFeatures::SetBlock(unsigned int left, unsigned int top, unsigned int right, unsigned int bottom, const std::vector<POVMSFloat>& v)
+{
+    if ((right < left) || (bottom < top) || (v.size() != std::size_t(right - left + 1) * (bottom - top + 1) * kSize))
+        return;
+
+    auto i = v.begin();
+    for (unsigned int y = top; y <= bottom; ++y)
+    {
+        for (unsigned int x = left; x <= right; ++x, i += kSize)
+        {
+            if ((x >= width) || (y >= height))
+                continue;
+            std::size_t index = std::size_t(y) * width + x;
+            std::copy(i, i + kSize, values.begin() + index * kSize);
+            present[index] = true;
+        }
+    }
+}
+
+const float *ImageFeatures::Get(unsigned int x, unsigned int y) const
+{
+    std::size_t index = std::size_t(y) * width + x;
+    return (present[index] ? &values[index * kSize] : nullptr);
+}
+
+void ImageFeatures::Clear()
+{
+    std::fill(present.begin(), present.end(), false);
+}
+
+//******************************************************************************
+
+ImageCostMap::ImageCostMap(unsigned int w, unsigned int h) :
+    width(w),
+    height(h),
+    values(std::size_t(w) * h, 0.0f)
+{}
+
+void ImageCostMap::AddBlock(unsigned int left, unsigned int top, unsigned int right, unsigned int bottom, const std::vector<POVMSFloat>& v)
+{
+    if ((right < left) || (bottom < top) || (v.size() != std::size_t(right - left + 1) * (bottom - top + 1)))
+        return;
+
+    auto i = v.begin();
+    for (unsigned int y = top; y <= bottom; ++y)
+    {
+        for (unsigned int x = left; x <= right; ++x, ++i)
+        {
+            if ((x < width) && (y < height))
+                values[std::size_t(y) * width + x] += *i;
+        }
+    }
+}
+
+void ImageCostMap::Write(const UCS2String& filename) const
+{
+    float maxCost = 0.0f;
+    for (float cost : values)
+        maxCost = std::max(maxCost, cost);
+    float scale = ((maxCost > 0.0f) ? 1.0f / maxCost : 0.0f);
+
+    std::unique_ptr<Image> image(Image::Create(width, height, ImageDataType::Gray_Int16, false));
+    for (unsigned int y = 0; y < height; ++y)
+        for (unsigned int x = 0; x < width; ++x)
+            image->SetGrayValue(x, y, values[std::size_t(y) * width + x] * scale);
+
+    // The values are proportional to time, not colours, so they are stored without gamma encoding.
+    ImageWriteOptions wopts;
+    wopts.encodingGamma = NeutralGammaCurve::Get();
+
+    std::unique_ptr<OStream> file(NewOStream(filename.c_str(), POV_File_Image_PNG, false));
+    if (file == nullptr)
+        throw POV_EXCEPTION_CODE(kCannotOpenFileErr);
+
+    Image::Write(Image::PNG, file.get(), image.get(), wopts);
+}
+
+void ImageCostMap::Clear()
+{
+    std::fill(values.begin(), values.end(), 0.0f);
+}
+
+//******************************************************************************
+
+/// Parameters of the joint bilateral denoising filter.
+struct DenoiseParameters final
+{
+    int     radius;
+    float   spatialFactor;  ///< -1/(2 sigma^2) for the distance in pixels.
+    float   colourFactor;   ///< -1/(2 sigma^2) for the difference in tone-mapped colour.
+    float   albedoFactor;   ///< -1/(2 sigma^2) for the difference in albedo.
+    float   normalFactor;   ///< -1/sigma for one minus the cosine between the normals.
+    float   depthFactor;    ///< -1/(2 sigma^2) for the relative difference in depth.
+};
+
+/// Compress a colour channel into [0,1), so that highlights do not dominate the colour term.
+static inline float DenoiseToneMap(float c)
 {
-    image = shared_ptr<Image>(Image::Create(width, height, ImageDataType::RGBFT_Float));
+    c = std::max(c, 0.0f);
+    return c / (1.0f + c);
+}
+
+/// Apply the joint bilateral filter to every `step`-th row of an image, starting at `first`.
+///
+/// Each neighbour is weighted by its distance, its difference in colour, and - where features are
+/// available for both pixels - its difference in albedo, normal and depth. The feature terms keep
+/// the filter from blurring across geometric and texture edges, while the colour term protects
+/// detail such as shadow boundaries that the features do not capture.
+///
+static void DenoiseRows(const std::vector<RGBTColour>& source, std::vector<RGBTColour>& target,
+                        const ImageFeatures& features, unsigned int width, unsigned int height,
+                        const DenoiseParameters& params, unsigned int first, unsigned int step)
+{
+    for (unsigned int y = first; y < height; y += step)
+    {
+        int y0 = std::max(int(y) - params.radius, 0);
+        int y1 = std::min(int(y) + params.radius, int(height) - 1);
+        for (unsigned int x = 0; x < width; ++x)
+        {
+            int x0 = std::max(int(x) - params.radius, 0);
+            int x1 = std::min(int(x) + params.radius, int(width) - 1);
+
+            const RGBTColour& centre = source[std::size_t(y) * width + x];
+            const float *centreFeatures = features.Get(x, y);
+            float cr = DenoiseToneMap(centre.red());
+            float cg = DenoiseToneMap(centre.green());
+            float cb = DenoiseToneMap(centre.blue());
+
+            RGBTColour sum(0.0f, 0.0f, 0.0f, 0.0f);
+            float weightSum = 0.0f;
+
+            for (int ny = y0; ny <= y1; ++ny)
+            {
+                for (int nx = x0; nx <= x1; ++nx)
+                {
+                    const RGBTColour& neighbour = source[std::size_t(ny) * width + nx];
+                    float dx = float(nx - int(x));
+                    float dy = float(ny - int(y));
+                    float dr = DenoiseToneMap(neighbour.red())   - cr;
+                    float dg = DenoiseToneMap(neighbour.green()) - cg;
+                    float db = DenoiseToneMap(neighbour.blue())  - cb;
+
+                    float exponent = (dx * dx + dy * dy) * params.spatialFactor +
+                                     (dr * dr + dg * dg + db * db) * params.colourFactor;
+
+                    const float *neighbourFeatures = features.Get(nx, ny);
+                    if ((centreFeatures != nullptr) && (neighbourFeatures != nullptr))
+                    {
+                        bool centreHit    = (centreFeatures[6] >= 0.0f);
+                        bool neighbourHit = (neighbourFeatures[6] >= 0.0f);
+                        if (centreHit != neighbourHit)
+                            continue;
+                        if (centreHit)
+                        {
+                            float da0 = neighbourFeatures[0] - centreFeatures[0];
+                            float da1 = neighbourFeatures[1] - centreFeatures[1];
+                            float da2 = neighbourFeatures[2] - centreFeatures[2];
+                            float cosine = neighbourFeatures[3] * centreFeatures[3] +
+                                           neighbourFeatures[4] * centreFeatures[4] +
+                                           neighbourFeatures[5] * centreFeatures[5];
+                            float dz = (neighbourFeatures[6] - centreFeatures[6]) / std::max(centreFeatures[6], 1.0e-6f);
+                            exponent += (da0 * da0 + da1 * da1 + da2 * da2) * params.albedoFactor +
+                                        (1.0f - cosine) * params.normalFactor +
+                                        dz * dz * params.depthFactor;
+                        }
+                    }
+
+                    float weight = std::exp(exponent);
+                    sum += neighbour * weight;
+                    weightSum += weight;
+                }
+            }
+
+            // The centre pixel always contributes with a weight of 1, so weightSum is never zero.
+            target[std::size_t(y) * width + x] = sum / weightSum;
+        }
+    }
+}
+
+//******************************************************************************
+
+/// Background thread writing images to file in order of submission.
+struct ImageProcessing::AsyncWriter final
+{
+    struct Job final
+    {
+        shared_ptr<Image>   image;
+        POVMS_Object        ropts;
+        UCS2String          filename;
+        std::exception_ptr  error;
+        bool                done;
+    };
+
+    std::mutex                      mutex;
+    std::condition_variable         changed;
+    std::deque<shared_ptr<Job>>     jobs;           ///< Jobs in order of submission, until their results have been retrieved.
+    std::vector<shared_ptr<Image>>  spareImages;    ///< Image buffers available for re-use.
+    std::thread                     thread;
+    bool                            quit;
+
+    AsyncWriter() : quit(false) {}
+
+    std::size_t CountUnwritten() const
+    {
+        std::size_t count = 0;
+        for (auto& job : jobs)
+            if (!job->done)
+                ++count;
+        return count;
+    }
+};
+
+//******************************************************************************
+
+ImageProcessing::ImageProcessing(unsigned int width, unsigned int height) :
+    bufferType(ImageDataType::RGBFT_Float),
+    maxBufferMem(0),
+    pixelsPerBlock(0),
+    maxPendingWrites(0),
+    denoiseStrength(0.0f),
+    denoiseThreads(1)
+{
+    image = shared_ptr<Image>(CreateBuffer(width, height));
+    streamedImage = nullptr;
     toStderr = toStdout = false;
 
     // TODO FIXME - find a better place for this
@@ -86,19 +686,69 @@ ImageProcessing::ImageProcessing(POVMS_Object& ropts)
     unsigned int width(ropts.TryGetInt(kPOVAttrib_Width, 160));
     unsigned int height(ropts.TryGetInt(kPOVAttrib_Height, 120));
     unsigned int blockSize(ropts.TryGetInt(kPOVAttrib_RenderBlockSize, 32));
-    unsigned int maxBufferMem(ropts.TryGetInt(kPOVAttrib_MaxImageBufferMem, 128)); // number is megabytes
 
-    image = shared_ptr<Image>(Image::Create(width, height, ImageDataType::RGBFT_Float, maxBufferMem, blockSize * blockSize));
+    maxBufferMem = ropts.TryGetInt(kPOVAttrib_MaxImageBufferMem, 128); // number is megabytes
+    pixelsPerBlock = blockSize * blockSize;
+    maxPendingWrites = clip(ropts.TryGetInt(kPOVAttrib_OutputQueueLength, 1), 0, 16);
+
     toStdout = OutputIsStdout(ropts);
     toStderr = OutputIsStderr(ropts);
 
+    // Streaming output writes rows to the output file as soon as they are complete, rather than
+    // keeping the whole image in memory; this is only supported for file formats that can be
+    // written in row order.
+    // Half precision is ample for low dynamic range output, and halves the memory footprint.
+    bufferType = (ropts.TryGetBool(kPOVAttrib_HalfPrecisionBuffer, false) ? ImageDataType::RGBFT_Half
+                                                                          : ImageDataType::RGBFT_Float);
+
+    bool streaming = false;
+    if (ropts.TryGetBool(kPOVAttrib_OutputStreaming, false) && ropts.TryGetBool(kPOVAttrib_OutputToFile, true) && !toStdout && !toStderr)
+    {
+        switch (ropts.TryGetInt(kPOVAttrib_OutputFileType, DEFAULT_OUTPUT_FORMAT))
+        {
+            case kPOVList_FileType_PNG:
+            case kPOVList_FileType_OpenEXR:
+                streaming = true;
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    if (streaming)
+    {
+        streamedImage = new StreamedImage(width, height);
+        image = shared_ptr<Image>(streamedImage);
+    }
+    else
+    {
+        streamedImage = nullptr;
+        image = shared_ptr<Image>(CreateBuffer(width, height));
+    }
+
+    // Denoising needs the whole image, so it is not available with streaming output.
+    denoiseStrength = clip(ropts.TryGetFloat(kPOVAttrib_DenoiseStrength, 1.0f), 0.0f, 10.0f);
+    denoiseThreads = clip(ropts.TryGetInt(kPOVAttrib_MaxRenderThreads, 1), 1, 512);
+    if (ropts.TryGetBool(kPOVAttrib_Denoise, false) && !streaming && (denoiseStrength > 0.0f))
+        features = std::make_shared<ImageFeatures>(width, height);
+    if (ropts.TryGetBool(kPOVAttrib_CostMap, false))
+        costMap = std::make_shared<ImageCostMap>(width, height);
+
     // TODO FIXME - find a better place for this
     image->SetPremultiplied(true); // POV-Ray uses premultiplied opacity for its math, so that's what will end up in the image container
 }
 
-ImageProcessing::ImageProcessing(shared_ptr<Image>& img)
+ImageProcessing::ImageProcessing(shared_ptr<Image>& img) :
+    bufferType(ImageDataType::RGBFT_Float),
+    maxBufferMem(0),
+    pixelsPerBlock(0),
+    maxPendingWrites(0),
+    denoiseStrength(0.0f),
+    denoiseThreads(1)
 {
     image = img;
+    streamedImage = nullptr;
     toStderr = toStdout = false;
 
     // TODO FIXME - find a better place for this
@@ -107,89 +757,59 @@ ImageProcessing::ImageProcessing(shared_ptr<Image>& img)
 
 ImageProcessing::~ImageProcessing()
 {
+    if (asyncWriter != nullptr)
+    {
+        // Any images still pending are written before the thread exits.
+        {
+            std::lock_guard<std::mutex> lock(asyncWriter->mutex);
+            asyncWriter->quit = true;
+        }
+        asyncWriter->changed.notify_all();
+        asyncWriter->thread.join();
+    }
 }
 
-UCS2String ImageProcessing::WriteImage(POVMS_Object& ropts, POVMSInt frame, int digits)
+Image *ImageProcessing::CreateBuffer(unsigned int width, unsigned int height) const
 {
-    if(ropts.TryGetBool(kPOVAttrib_OutputToFile, true) == true)
-    {
-        ImageWriteOptions wopts;
-        Image::ImageFileType imagetype = Image::SYS;
-        unsigned int filetype = POV_File_Image_System;
+    return Image::Create(width, height, bufferType, maxBufferMem, pixelsPerBlock);
+}
 
-        wopts.bitsPerChannel = clip(ropts.TryGetInt(kPOVAttrib_BitsPerColor, 8), 1, 16);
-        wopts.alphaMode = (ropts.TryGetBool(kPOVAttrib_OutputAlpha, false) ? ImageAlphaMode::Default : ImageAlphaMode::None );
-        wopts.compression = (ropts.Exist(kPOVAttrib_Compression) ? clip(ropts.GetInt(kPOVAttrib_Compression), 0, 255) : -1);
-        wopts.grayscale = ropts.TryGetBool(kPOVAttrib_GrayscaleOutput, false);
+void ImageProcessing::BeginImage(POVMS_Object& ropts)
+{
+    if (streamedImage == nullptr)
+        return;
 
-        switch(ropts.TryGetInt(kPOVAttrib_OutputFileType, DEFAULT_OUTPUT_FORMAT))
-        {
-            case kPOVList_FileType_Targa:
-                imagetype = Image::TGA;
-                filetype = POV_File_Image_Targa;
-                break;
-            case kPOVList_FileType_CompressedTarga:
-                // TODO - this file type is obsolete, as Targa compression can now
-                // be controlled using the `Compression` INI setting.
-                imagetype = Image::TGA;
-                filetype = POV_File_Image_Targa;
-                wopts.compression = 1;
-                break;
-            case kPOVList_FileType_PNG:
-                imagetype = Image::PNG;
-                filetype = POV_File_Image_PNG;
-                break;
-            case kPOVList_FileType_JPEG:
-                imagetype = Image::JPEG;
-                filetype = POV_File_Image_JPEG;
-                break;
-            case kPOVList_FileType_PPM:
-                imagetype = Image::PPM;
-                filetype = POV_File_Image_PPM;
-                break;
-            case kPOVList_FileType_BMP:
-                imagetype = Image::BMP;
-                filetype = POV_File_Image_BMP;
-                break;
-            case kPOVList_FileType_OpenEXR:
-                imagetype = Image::EXR;
-                filetype = POV_File_Image_EXR;
-                break;
-            case kPOVList_FileType_RadianceHDR:
-                imagetype = Image::HDR;
-                filetype = POV_File_Image_HDR;
-                break;
-            case kPOVList_FileType_System:
-                imagetype = Image::SYS;
-                filetype = POV_File_Image_System;
-                break;
-            default:
-                throw POV_EXCEPTION_STRING("Invalid file type for output");
-        }
+    ImageWriteOptions wopts;
+    unsigned int filetype;
+    Image::ImageFileType imagetype = GetImageWriteSettings(ropts, image->GetWidth(), filetype, wopts);
 
-        GammaTypeId gammaType;
-        float gamma;
-        if (ropts.Exist(kPOVAttrib_FileGammaType))
-        {
-            gammaType = (GammaTypeId)ropts.GetInt(kPOVAttrib_FileGammaType);
-            gamma = ropts.GetFloat(kPOVAttrib_FileGamma);
-            wopts.encodingGamma = GetGammaCurve(gammaType, gamma);
-        }
-        else
+    // the frontend code sets the filename via a call to GetOutputFilename() before the render starts.
+    streamedFilename = ropts.TryGetUCS2String(kPOVAttrib_OutputFile, "");
+    if (streamedFilename.empty() == true)
+        streamedFilename = GetOutputFilename(ropts, 0, 0);
+
+    std::unique_ptr<OStream> imagefile(NewOStream(streamedFilename.c_str(), filetype, false)); // TODO - check file permissions somehow without macro [ttrf]
+    if (imagefile == nullptr)
+        throw POV_EXCEPTION_CODE(kCannotOpenFileErr);
+
+    std::unique_ptr<ImageStreamWriter> writer(Image::CreateStreamWriter(imagetype, imagefile.get(), image.get(), wopts));
+    if (writer == nullptr)
+        throw POV_EXCEPTION_STRING("Streaming output not supported for selected file format");
+
+    streamedImage->Start(imagefile.release(), writer.release());
+}
+
+UCS2String ImageProcessing::WriteImage(POVMS_Object& ropts, POVMSInt frame, int digits)
+{
+    if(ropts.TryGetBool(kPOVAttrib_OutputToFile, true) == true)
+    {
+        if (streamedImage != nullptr)
         {
-            // if user didn't explicitly specify File_Gamma, use the file format specific default.
-            wopts.encodingGamma.reset();
+            // all rows rendered so far have already been written; just complete the file.
+            streamedImage->Finish();
+            WriteCostMap(streamedFilename);
+            return streamedFilename;
         }
-        // NB: RenderFrontend<...>::CreateView should have dealt with kPOVAttrib_LegacyGammaMode already and updated kPOVAttrib_WorkingGammaType and kPOVAttrib_WorkingGamma to fit.
-        gammaType = (GammaTypeId)ropts.TryGetInt(kPOVAttrib_WorkingGammaType, DEFAULT_WORKING_GAMMA_TYPE);
-        gamma = ropts.TryGetFloat(kPOVAttrib_WorkingGamma, DEFAULT_WORKING_GAMMA);
-        wopts.workingGamma = GetGammaCurve(gammaType, gamma);
-
-        bool dither = ropts.TryGetBool(kPOVAttrib_Dither, false);
-        DitherMethodId ditherMethod = DitherMethodId::kNone;
-        if (dither)
-            ditherMethod = ropts.TryGetEnum(kPOVAttrib_DitherMethod, DitherMethodId::kBlueNoise);
-        wopts.ditherStrategy = GetDitherStrategy(ditherMethod, image->GetWidth());
 
         // in theory this should always return a filename since the frontend code
         // sets it via a call to GetOutputFilename() before the render starts.
@@ -197,11 +817,9 @@ UCS2String ImageProcessing::WriteImage(POVMS_Object& ropts, POVMSInt frame, int
         if(filename.empty() == true)
             filename = GetOutputFilename(ropts, frame, digits);
 
-        std::unique_ptr<OStream> imagefile(NewOStream(filename.c_str(), filetype, false)); // TODO - check file permissions somehow without macro [ttrf]
-        if (imagefile == nullptr)
-            throw POV_EXCEPTION_CODE(kCannotOpenFileErr);
-
-        Image::Write(imagetype, imagefile.get(), image.get(), wopts);
+        Denoise();
+        WriteImageFile(image.get(), ropts, filename);
+        WriteCostMap(filename);
 
         return filename;
     }
@@ -209,11 +827,207 @@ UCS2String ImageProcessing::WriteImage(POVMS_Object& ropts, POVMSInt frame, int
         return UCS2String();
 }
 
+bool ImageProcessing::CanWriteAsync(POVMS_Object& ropts)
+{
+    return (maxPendingWrites > 0) && (streamedImage == nullptr) && !toStdout && !toStderr &&
+           ropts.TryGetBool(kPOVAttrib_OutputToFile, true);
+}
+
+void ImageProcessing::WriteImageAsync(POVMS_Object& ropts, POVMSInt frame, int digits)
+{
+    POV_ASSERT(CanWriteAsync(ropts));
+
+    // Resolve the filename here, as GetOutputFilename() is not thread-safe.
+    UCS2String filename = ropts.TryGetUCS2String(kPOVAttrib_OutputFile, "");
+    if (filename.empty() == true)
+        filename = GetOutputFilename(ropts, frame, digits);
+
+    if (asyncWriter == nullptr)
+    {
+        asyncWriter.reset(new AsyncWriter);
+        asyncWriter->thread = std::thread(&ImageProcessing::WriterThread, this);
+    }
+
+    Denoise();
+    WriteCostMap(filename);
+
+    shared_ptr<AsyncWriter::Job> job(new AsyncWriter::Job);
+    job->image = image;
+    job->ropts = ropts;
+    job->filename = filename;
+    job->done = false;
+
+    {
+        std::unique_lock<std::mutex> lock(asyncWriter->mutex);
+        asyncWriter->changed.wait(lock, [this] { return asyncWriter->CountUnwritten() < maxPendingWrites; });
+        asyncWriter->jobs.push_back(job);
+        if (asyncWriter->spareImages.empty())
+            image.reset();
+        else
+        {
+            image = asyncWriter->spareImages.back();
+            asyncWriter->spareImages.pop_back();
+        }
+    }
+    asyncWriter->changed.notify_all();
+
+    // Render the next image into a different buffer.
+    if (image == nullptr)
+    {
+        image = shared_ptr<Image>(CreateBuffer(job->image->GetWidth(), job->image->GetHeight()));
+        image->SetPremultiplied(true); // POV-Ray uses premultiplied opacity for its math, so that's what will end up in the image container
+    }
+}
+
+bool ImageProcessing::GetWrittenImage(UCS2String& filename, bool wait)
+{
+    if (asyncWriter == nullptr)
+        return false;
+
+    shared_ptr<AsyncWriter::Job> job;
+    {
+        std::unique_lock<std::mutex> lock(asyncWriter->mutex);
+        if (asyncWriter->jobs.empty())
+            return false;
+        if (wait)
+            asyncWriter->changed.wait(lock, [this] { return asyncWriter->jobs.front()->done; });
+        else if (!asyncWriter->jobs.front()->done)
+            return false;
+        job = asyncWriter->jobs.front();
+        asyncWriter->jobs.pop_front();
+        asyncWriter->spareImages.push_back(job->image);
+    }
+
+    if (job->error)
+        std::rethrow_exception(job->error);
+
+    filename = job->filename;
+    return true;
+}
+
+void ImageProcessing::WriterThread()
+{
+    std::unique_lock<std::mutex> lock(asyncWriter->mutex);
+    while (true)
+    {
+        shared_ptr<AsyncWriter::Job> job;
+        for (auto& pending : asyncWriter->jobs)
+        {
+            if (!pending->done)
+            {
+                job = pending;
+                break;
+            }
+        }
+
+        if (job == nullptr)
+        {
+            if (asyncWriter->quit)
+                return;
+            asyncWriter->changed.wait(lock);
+            continue;
+        }
+
+        lock.unlock();
+        try
+        {
+            WriteImageFile(job->image.get(), job->ropts, job->filename);
+        }
+        catch (...)
+        {
+            job->error = std::current_exception();
+        }
+        lock.lock();
+
+        job->done = true;
+        asyncWriter->changed.notify_all();
+    }
+}
+
 shared_ptr<Image>& ImageProcessing::GetImage()
 {
     return image;
 }
 
+shared_ptr<ImageFeatures>& ImageProcessing::GetFeatures()
+{
+    return features;
+}
+
+shared_ptr<ImageCostMap>& ImageProcessing::GetCostMap()
+{
+    return costMap;
+}
+
+void ImageProcessing::Denoise()
+{
+    if (features == nullptr)
+        return;
+
+    unsigned int width = image->GetWidth();
+    unsigned int height = image->GetHeight();
+
+    DenoiseParameters params;
+    params.radius = std::max(1, int(std::lround(2.0f * denoiseStrength)));
+    float sigmaSpatial = 0.5f * float(params.radius);
+    float sigmaColour = 0.25f * denoiseStrength;
+    params.spatialFactor = -0.5f / (sigmaSpatial * sigmaSpatial);
+    params.colourFactor  = -0.5f / (sigmaColour * sigmaColour);
+    params.albedoFactor  = -0.5f / (0.1f * 0.1f);
+    params.normalFactor  = -1.0f / 0.1f;
+    params.depthFactor   = -0.5f / (0.05f * 0.05f);
+
+    // Work on a copy, as image buffers (especially file-backed ones) are not safe to access from
+    // multiple threads.
+    std::vector<RGBTColour> source(std::size_t(width) * height);
+    std::vector<RGBTColour> target(source.size());
+    for (unsigned int y = 0; y < height; ++y)
+    {
+        for (unsigned int x = 0; x < width; ++x)
+        {
+            RGBTColour& col = source[std::size_t(y) * width + x];
+            image->GetRGBTValue(x, y, col.red(), col.green(), col.blue(), col.transm());
+        }
+    }
+
+    // Rows are interleaved between the threads to balance the load.
+    unsigned int threadCount = std::min(denoiseThreads, height);
+    std::vector<std::thread> threads;
+    for (unsigned int i = 1; i < threadCount; ++i)
+        threads.emplace_back(DenoiseRows, std::cref(source), std::ref(target), std::cref(*features),
+                             width, height, std::cref(params), i, threadCount);
+    DenoiseRows(source, target, *features, width, height, params, 0, threadCount);
+    for (auto& thread : threads)
+        thread.join();
+
+    for (unsigned int y = 0; y < height; ++y)
+        for (unsigned int x = 0; x < width; ++x)
+            image->SetRGBTValue(x, y, target[std::size_t(y) * width + x]);
+
+    features->Clear();
+}
+
+void ImageProcessing::WriteCostMap(const UCS2String& filename)
+{
+    if (costMap == nullptr)
+        return;
+
+    // The cost map goes next to the image, as "<name>_cost.png"; there is nowhere to put it
+    // if the image is written to the console.
+    if (!toStdout && !toStderr)
+    {
+        Path path(filename);
+        UCS2String name = path.GetFile();
+        UCS2String::size_type pos = name.find_last_of('.');
+        if (pos != UCS2String::npos)
+            name.erase(pos);
+        path.SetFile(name + u"_cost.png");
+        costMap->Write(path());
+    }
+
+    costMap->Clear();
+}
+
 bool ImageProcessing::OutputIsStdout(POVMS_Object& ropts)
 {
     UCS2String path(ropts.TryGetUCS2String(kPOVAttrib_OutputFile, ""));
@@ -355,5 +1169,21 @@ UCS2String ImageProcessing::GetOutputFilename(POVMS_Object& ropts, POVMSInt fram
     return path();
 }
 
+UCS2String ImageProcessing::GetCameraOutputFilename(const UCS2String& filename, POVMSInt camera)
+{
+    if (filename.empty() || (filename == u"stdout") || (filename == u"stderr"))
+        return filename;
+
+    Path path(filename);
+    UCS2String file = path.GetFile();
+    UCS2String::size_type pos = file.find_last_of('.');
+    if (pos == UCS2String::npos)
+        pos = file.length();
+    file.insert(pos, ASCIItoUCS2String("_cam" + std::to_string(camera + 1)));
+    path.SetFile(file);
+
+    return path();
+}
+
 }
 // end of namespace pov_frontend
@@ -44,6 +44,7 @@
 
 // C++ standard header files
 #include <memory>
+#include <vector>
 
 // POV-Ray header files (base module)
 #include "base/stringtypes.h"
@@ -60,6 +61,66 @@ namespace pov_frontend
 
 using namespace pov_base;
 
+class StreamedImage;
+
+/// Auxiliary per-pixel data guiding the denoising stage.
+///
+/// For each pixel, this holds the albedo, surface normal and depth at the first intersection of
+/// the primary ray through the pixel centre, as emitted by the render threads alongside the colour.
+///
+class ImageFeatures final
+{
+    public:
+
+        /// Number of values per pixel: albedo (RGB), normal (XYZ) and depth (negative if no object was hit).
+        static constexpr unsigned int kSize = 7;
+
+        ImageFeatures(unsigned int w, unsigned int h);
+
+        /// Store the features of a rectangular block of pixels, in row-major order.
+        void SetBlock(unsigned int left, unsigned int top, unsigned int right, unsigned int bottom, const std::vector<POVMSFloat>& values);
+
+        /// Get the features of a pixel, or `nullptr` if none have been received for it.
+        const float *Get(unsigned int x, unsigned int y) const;
+
+        /// Discard all features, in preparation for the next image.
+        void Clear();
+
+    private:
+
+        unsigned int        width;
+        unsigned int        height;
+        std::vector<float>  values;
+        std::vector<bool>   present;
+};
+
+/// Per-pixel render cost, as measured by the render threads.
+///
+/// For each pixel, this holds the wall time spent computing it, accumulated over all passes
+/// that contribute to the final image.
+///
+class ImageCostMap final
+{
+    public:
+
+        ImageCostMap(unsigned int w, unsigned int h);
+
+        /// Add the costs of a rectangular block of pixels, in row-major order.
+        void AddBlock(unsigned int left, unsigned int top, unsigned int right, unsigned int bottom, const std::vector<POVMSFloat>& values);
+
+        /// Write the costs as a greyscale PNG file, scaled so that the most expensive pixel is white.
+        void Write(const UCS2String& filename) const;
+
+        /// Discard all costs, in preparation for the next image.
+        void Clear();
+
+    private:
+
+        unsigned int        width;
+        unsigned int        height;
+        std::vector<float>  values;
+};
+
 class ImageProcessing
 {
     public:
@@ -68,11 +129,59 @@ class ImageProcessing
         ImageProcessing(std::shared_ptr<Image>& img);
         virtual ~ImageProcessing();
 
+        /// Prepare for rendering an image.
+        ///
+        /// With streaming output enabled, this opens the output file, so that rows can be written
+        /// as soon as they have been completed.
+        ///
+        void BeginImage(POVMS_Object& ropts);
+
         UCS2String WriteImage(POVMS_Object& ropts, POVMSInt frame = 0, int digits = 0);
 
+        /// Test whether the image can be written asynchronously via @ref WriteImageAsync().
+        bool CanWriteAsync(POVMS_Object& ropts);
+
+        /// Hand the image over to a background thread for writing.
+        ///
+        /// Subsequent renders use a different image buffer, so that writing one image can overlap
+        /// with parsing and rendering the next. If the configured number of images is already
+        /// waiting to be written, this call blocks until the oldest of them has been written.
+        ///
+        /// @note
+        ///     The results must be retrieved via @ref GetWrittenImage(), in order of submission.
+        ///
+        void WriteImageAsync(POVMS_Object& ropts, POVMSInt frame = 0, int digits = 0);
+
+        /// Retrieve the result of the oldest pending asynchronous write.
+        ///
+        /// Any exception raised while writing the image is re-thrown here.
+        ///
+        /// @param[out] filename    Name of the file written.
+        /// @param[in]  wait        Whether to wait for the write to complete.
+        /// @return                 `true` if a result was retrieved, `false` if no write is
+        ///                         pending, or if it has not completed yet and `wait` is not set.
+        ///
+        bool GetWrittenImage(UCS2String& filename, bool wait);
+
         std::shared_ptr<Image>& GetImage();
 
+        /// Get the buffer to collect denoising features in, or `nullptr` if denoising is disabled.
+        std::shared_ptr<ImageFeatures>& GetFeatures();
+
+        /// Get the buffer to collect pixel costs in, or `nullptr` if no cost map is to be written.
+        std::shared_ptr<ImageCostMap>& GetCostMap();
+
         UCS2String GetOutputFilename(POVMS_Object& ropts, POVMSInt frame, int digits);
+
+        /// Derive the output filename for one of several cameras rendered from the same scene.
+        ///
+        /// The 1-based camera number is appended to the file name proper, so that e.g.
+        /// `scene.png` becomes `scene_cam2.png` for the second camera.
+        ///
+        /// @param  filename    Output filename as returned by @ref GetOutputFilename().
+        /// @param  camera      0-based index of the camera.
+        ///
+        static UCS2String GetCameraOutputFilename(const UCS2String& filename, POVMSInt camera);
         bool OutputIsStdout(void) { return toStdout; }
         bool OutputIsStderr(void) { return toStderr; }
         virtual bool OutputIsStdout(POVMS_Object& ropts);
@@ -80,11 +189,30 @@ class ImageProcessing
 
     protected:
         std::shared_ptr<Image> image;
+        StreamedImage *streamedImage; ///< Same as @ref image if streaming output, `nullptr` otherwise.
+        UCS2String streamedFilename;
         bool toStdout;
         bool toStderr;
 
     private:
 
+        struct AsyncWriter;
+
+        ImageDataType bufferType;           ///< Data type of the image buffers.
+        unsigned int maxBufferMem;          ///< Size limit for in-memory image buffers, in megabytes (0 = none).
+        unsigned int pixelsPerBlock;        ///< Block size of file-backed image buffers.
+        unsigned int maxPendingWrites;      ///< Maximum number of images waiting to be written asynchronously.
+        std::unique_ptr<AsyncWriter> asyncWriter;
+        std::shared_ptr<ImageFeatures> features;    ///< Denoising features, or `nullptr` if denoising is disabled.
+        std::shared_ptr<ImageCostMap> costMap;      ///< Pixel costs, or `nullptr` if no cost map is to be written.
+        float denoiseStrength;              ///< Scale of the denoising filter's radius and colour tolerance.
+        unsigned int denoiseThreads;        ///< Number of threads to run the denoising filter on.
+
+        Image *CreateBuffer(unsigned int width, unsigned int height) const;
+        void Denoise();
+        void WriteCostMap(const UCS2String& filename);
+        void WriterThread();
+
         ImageProcessing() = delete;
         ImageProcessing(const ImageProcessing&) = delete;
         ImageProcessing& operator=(const ImageProcessing&) = delete;
@@ -107,9 +107,13 @@ void ParserMessageHandler::HandleMessage(const SceneData& sd, POVMSType ident, P
                 Message2Console::ParserStatistics(obj, sd.streams[ALL_STREAM].get());
                 Message2Console::ParserTime(obj, sd.streams[ALL_STREAM].get());
             }
+            if (sd.results != nullptr)
+                sd.results->ParserStatistics(obj);
             break;
         case kPOVMsgIdent_Progress:
             Progress(sd.console.get(), obj, sd.verbose);
+            if (sd.progress != nullptr)
+                sd.progress->Progress(obj);
 //          if (sd.streams[ALL_STREAM].get() != nullptr)
 //              Message2Console::Progress(obj, sd.streams[ALL_STREAM].get());
             break;
@@ -133,6 +137,8 @@ void ParserMessageHandler::HandleMessage(const SceneData& sd, POVMSType ident, P
                 Message2Console::FatalError(obj, sd.streams[FATAL_STREAM].get());
             if (sd.streams[ALL_STREAM].get() != nullptr)
                 Message2Console::FatalError(obj, sd.streams[ALL_STREAM].get());
+            if (sd.progress != nullptr)
+                sd.progress->FatalError();
             break;
         case kPOVMsgIdent_Debug:
             DebugInfo(sd.console.get(), obj, sd.consoleoutput[DEBUG_STREAM]);
@@ -171,7 +177,10 @@ void ParserMessageHandler::Progress(Console *console, POVMS_Object& obj, bool ve
         case kPOVObjectClass_ParserProgress:
         {
             sstr << Message2Console::GetProgressTime(obj, kPOVAttrib_RealTime)
-                 << " Parsing " << (obj.GetLong(kPOVAttrib_CurrentTokenCount) / (POVMSLong)(1000)) << "K tokens\r";
+                 << " Parsing " << (obj.GetLong(kPOVAttrib_CurrentTokenCount) / (POVMSLong)(1000)) << "K tokens";
+            if (obj.Exist(kPOVAttrib_CurrentMemoryUsage))
+                sstr << ", " << (obj.GetLong(kPOVAttrib_CurrentMemoryUsage) / (POVMSLong)(1048576)) << " MB";
+            sstr << "    \r";
             break;
         }
         case kPOVObjectClass_BoundingProgress:
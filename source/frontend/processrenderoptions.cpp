@@ -109,6 +109,7 @@ struct ProcessOptions::INI_Parser_Table RenderOptions_INI_Table[] =
     { "Antialias_Confidence",kPOVAttrib_AntialiasConfidence,kPOVMSType_Float },
     { "Antialias_Depth",     kPOVAttrib_AntialiasDepth,     kPOVMSType_Int },
     { "Antialias_Gamma",     kPOVAttrib_AntialiasGamma,     kPOVMSType_Float },
+    { "Antialias_Global",    kPOVAttrib_AntialiasGlobal,    kPOVMSType_Bool },
     { "Antialias_Threshold", kPOVAttrib_AntialiasThreshold, kPOVMSType_Float },
     { "Append_File",         kPOVAttrib_AppendConsoleFiles, kPOVMSType_Bool },
 
@@ -117,18 +118,27 @@ struct ProcessOptions::INI_Parser_Table RenderOptions_INI_Table[] =
     { "Bounding",            kPOVAttrib_Bounding,           kPOVMSType_Bool },
     { "Bounding_Method",     kPOVAttrib_BoundingMethod,     kPOVMSType_Int },
     { "Bounding_Threshold",  kPOVAttrib_BoundingThreshold,  kPOVMSType_Int },
+    { "Bounding_Cache_File", kPOVAttrib_BoundingCacheFile,  kPOVMSType_UCS2String },
+    { "Bounding_Slabs_Compact", kPOVAttrib_BoundingSlabsCompact, kPOVMSType_Int },
+    { "Bounding_Analysis",   kPOVAttrib_BoundingAnalysis,   kPOVMSType_Bool },
     { "BSP_BaseAccessCost",  kPOVAttrib_BSP_BaseAccessCost, kPOVMSType_Float },
     { "BSP_ChildAccessCost", kPOVAttrib_BSP_ChildAccessCost,kPOVMSType_Float },
     { "BSP_ISectCost",       kPOVAttrib_BSP_ISectCost,      kPOVMSType_Float },
     { "BSP_MaxDepth",        kPOVAttrib_BSP_MaxDepth,       kPOVMSType_Int },
     { "BSP_MissChance",      kPOVAttrib_BSP_MissChance,     kPOVMSType_Float },
+    { "BVH_Width",           kPOVAttrib_BVH_Width,          kPOVMSType_Int },
+    { "BVH_Packet_Size",     kPOVAttrib_BVH_PacketSize,     kPOVMSType_Int },
+    { "BVH_Refit_Threshold", kPOVAttrib_BVH_RefitThreshold, kPOVMSType_Float },
     { "Buffer_Output",       0,                             0 },
     { "Buffer_Size",         0,                             0 },
 
+    { "Checkpoint_Interval", kPOVAttrib_CheckpointInterval, kPOVMSType_Int },
     { "Clock",               kPOVAttrib_Clock,              kPOVMSType_Float },
     { "Clockless_Animation", kPOVAttrib_ClocklessAnimation, kPOVMSType_Bool },
     { "Compression",         kPOVAttrib_Compression,        kPOVMSType_Int },
+    { "Concurrent_Jobs",     kPOVAttrib_ConcurrentJobs,     kPOVMSType_Int },
     { "Continue_Trace",      kPOVAttrib_ContinueTrace,      kPOVMSType_Bool },
+    { "Cost_Map",            kPOVAttrib_CostMap,            kPOVMSType_Bool },
     { "Create_Continue_Trace_Log", kPOVAttrib_BackupTrace,  kPOVMSType_Bool },
     { "Create_Histogram",    0,                             0 },
     { "Create_Ini",          kPOVAttrib_CreateIni,          kPOVMSType_UCS2String },
@@ -137,6 +147,9 @@ struct ProcessOptions::INI_Parser_Table RenderOptions_INI_Table[] =
     { "Debug_Console",       kPOVAttrib_DebugConsole,       kPOVMSType_Bool },
     { "Debug_File",          kPOVAttrib_DebugFile,          kPOVMSType_UCS2String },
     { "Declare",             kPOVAttrib_Declare,            kUseSpecialHandler },
+    { "Defer_Image_Decoding",kPOVAttrib_DeferImageDecoding, kPOVMSType_Bool },
+    { "Denoise",             kPOVAttrib_Denoise,            kPOVMSType_Bool },
+    { "Denoise_Strength",    kPOVAttrib_DenoiseStrength,    kPOVMSType_Float },
     { "Display",             kPOVAttrib_Display,            kPOVMSType_Bool },
     { "Display_Gamma",       kPOVAttrib_DisplayGamma,       kUseSpecialHandler },
     { "Dither",              kPOVAttrib_Dither,             kPOVMSType_Bool },
@@ -154,39 +167,61 @@ struct ProcessOptions::INI_Parser_Table RenderOptions_INI_Table[] =
     { "File_Gamma",          kPOVAttrib_FileGamma,          kUseSpecialHandler },
     { "Final_Clock",         kPOVAttrib_FinalClock,         kPOVMSType_Float },
     { "Final_Frame",         kPOVAttrib_FinalFrame,         kPOVMSType_Int },
+    { "Focal_Blur_Adaptive", kPOVAttrib_AdaptiveFocalBlur,  kPOVMSType_Bool },
     { "Frame_Step",          kPOVAttrib_FrameStep,          kPOVMSType_Int },
+    { "Frames_In_Flight",    kPOVAttrib_FramesInFlight,     kPOVMSType_Int },
+    { "Function_Profile",    kPOVAttrib_FunctionProfile,    kPOVMSType_Bool },
 
     { "Grayscale_Output",    kPOVAttrib_GrayscaleOutput,    kPOVMSType_Bool },
     { "Greyscale_Output",    kPOVAttrib_GrayscaleOutput,    kPOVMSType_Bool,        kINIOptFlag_SuppressWrite },
 
+    { "Half_Precision_Buffer", kPOVAttrib_HalfPrecisionBuffer, kPOVMSType_Bool },
     { "Height",              kPOVAttrib_Height,             kPOVMSType_Int },
     { "High_Reproducibility",kPOVAttrib_HighReproducibility,kPOVMSType_Bool },
     { "Histogram_Name",      0,                             0 },
     { "Histogram_Grid_Size", 0,                             0 },
     { "Histogram_Type",      0,                             0 },
 
+    { "Image_Cache_Size",    kPOVAttrib_ImageCacheSize,     kPOVMSType_Int },
     { "Initial_Clock",       kPOVAttrib_InitialClock,       kPOVMSType_Float },
     { "Initial_Frame",       kPOVAttrib_InitialFrame,       kPOVMSType_Int },
     { "Input_File_Name",     kPOVAttrib_InputFile,          kPOVMSType_UCS2String },
     { "Include_Header",      kPOVAttrib_IncludeHeader,      kPOVMSType_UCS2String },
     { "Include_Ini",         kPOVAttrib_IncludeIni,         kUseSpecialHandler },
+    { "Incremental_Render_File", kPOVAttrib_IncrementalRenderFile, kPOVMSType_UCS2String },
 
     { "Jitter_Amount",       kPOVAttrib_JitterAmount,       kPOVMSType_Float },
     { "Jitter",              kPOVAttrib_Jitter,             kPOVMSType_Bool },
+    { "Job_List",            kPOVAttrib_JobList,            kPOVMSType_UCS2String },
 
     { "Library_Path",        kPOVAttrib_LibraryPath,        kUseSpecialHandler },
     { "Light_Buffer",        kPOVAttrib_LightBuffer,        kPOVMSType_Bool },
+    { "Light_Threshold",     kPOVAttrib_LightThreshold,     kPOVMSType_Float },
 
     { "Max_Image_Buffer_Memory", kPOVAttrib_MaxImageBufferMem, kPOVMSType_Int },
-
+    { "Max_Image_Map_Memory", kPOVAttrib_MaxImageMapMem,    kPOVMSType_Int },
+    { "Memory_Limit",        kPOVAttrib_MemoryLimit,        kPOVMSType_Int },
+    { "Merge_Triangles",     kPOVAttrib_MergeTriangles,     kPOVMSType_Bool },
+    { "Mesh_Cache_Path",     kPOVAttrib_MeshCachePath,      kPOVMSType_UCS2String },
+    { "Mesh_Memory_Budget",  kPOVAttrib_MeshMemoryBudget,   kPOVMSType_Int },
+    { "Multi_Camera",        kPOVAttrib_MultiCamera,        kPOVMSType_Bool },
+
+    { "Object_Profile",      kPOVAttrib_ObjectProfile,      kPOVMSType_Int },
     { "Odd_Field",           kPOVAttrib_OddField,           kPOVMSType_Bool },
     { "Output_Alpha",        kPOVAttrib_OutputAlpha,        kPOVMSType_Bool },
     { "Output_File_Name",    kPOVAttrib_OutputFile,         kPOVMSType_UCS2String },
     { "Output_File_Type",    kPOVAttrib_OutputFileType,     kUseSpecialHandler },
+    { "Output_Queue_Length", kPOVAttrib_OutputQueueLength,  kPOVMSType_Int },
+    { "Output_Streaming",    kPOVAttrib_OutputStreaming,    kPOVMSType_Bool },
     { "Output_To_File",      kPOVAttrib_OutputToFile,       kPOVMSType_Bool },
 
     { "Palette",             kPOVAttrib_Palette,            kUseSpecialHandler },
+    { "Parse_Profile_File",  kPOVAttrib_ParseProfileFile,   kPOVMSType_UCS2String },
     { "Pause_When_Done",     kPOVAttrib_PauseWhenDone,      kPOVMSType_Bool },
+    { "Performance_Counters", kPOVAttrib_PerformanceCounters, kPOVMSType_Bool },
+    { "Photon_Merge_Slices", kPOVAttrib_PhotonMergeSlices,  kPOVMSType_Int },
+    { "Photon_Slice",        kPOVAttrib_PhotonSlice,        kPOVMSType_Int },
+    { "Photon_Slices",       kPOVAttrib_PhotonSlices,       kPOVMSType_Int },
     { "Post_Frame_Command",  kPOVAttrib_PostFrameCommand,   kUseSpecialHandler },
     { "Post_Frame_Return",   kPOVAttrib_PostFrameCommand,   kUseSpecialHandler },
     { "Post_Scene_Command",  kPOVAttrib_PostSceneCommand,   kUseSpecialHandler },
@@ -197,22 +232,36 @@ struct ProcessOptions::INI_Parser_Table RenderOptions_INI_Table[] =
     { "Pre_Frame_Return",    kPOVAttrib_PreFrameCommand,    kUseSpecialHandler },
     { "Pre_Scene_Command",   kPOVAttrib_PreSceneCommand,    kUseSpecialHandler },
     { "Pre_Scene_Return",    kPOVAttrib_PreSceneCommand,    kUseSpecialHandler },
+    { "Prepare_Bundle",      kPOVAttrib_PrepareBundle,      kPOVMSType_UCS2String },
+    { "Progress_File",       kPOVAttrib_ProgressFile,       kPOVMSType_UCS2String },
+    { "Progressive_Time_Budget", kPOVAttrib_ProgressiveTimeBudget, kPOVMSType_Float },
+    { "Projection_Table",    kPOVAttrib_ProjectionTable,    kPOVMSType_Int },
 
     { "Quality",             kPOVAttrib_Quality,            kPOVMSType_Int },
 
+    { "Radiosity_File_Binary", kPOVAttrib_RadiosityFileBinary, kPOVMSType_Bool },
     { "Radiosity_File_Name", kPOVAttrib_RadiosityFileName,  kPOVMSType_UCS2String },
     { "Radiosity_From_File", kPOVAttrib_RadiosityFromFile,  kPOVMSType_Bool },
+    { "Radiosity_Incremental", kPOVAttrib_RadiosityIncremental, kPOVMSType_Int },
     { "Radiosity_To_File",   kPOVAttrib_RadiosityToFile,    kPOVMSType_Bool },
     { "Radiosity_Vain_Pretrace", kPOVAttrib_RadiosityVainPretrace, kPOVMSType_Bool },
     { "Real_Time_Raytracing",kPOVAttrib_RealTimeRaytracing, kPOVMSType_Bool },
     { "Remove_Bounds",       kPOVAttrib_RemoveBounds,       kPOVMSType_Bool },
     { "Render_Block_Size",   kPOVAttrib_RenderBlockSize,    kPOVMSType_Int },
     { "Render_Block_Step",   kPOVAttrib_RenderBlockStep,    kPOVMSType_Int },
+    { "Render_Block_Worker", kPOVAttrib_RenderBlockWorker,  kPOVMSType_Int },
+    { "Render_Block_Workers",kPOVAttrib_RenderBlockWorkers, kPOVMSType_Int },
     { "Render_Console",      kPOVAttrib_RenderConsole,      kPOVMSType_Bool },
     { "Render_File",         kPOVAttrib_RenderFile,         kPOVMSType_UCS2String },
+    { "Render_From_Bundle",  kPOVAttrib_RenderFromBundle,   kPOVMSType_UCS2String },
     { "Render_Pattern",      kPOVAttrib_RenderPattern,      kPOVMSType_Int },
+    { "Results_File",        kPOVAttrib_ResultsFile,        kPOVMSType_UCS2String },
+    { "Reuse_Declarations",  kPOVAttrib_ReuseDeclarations,  kPOVMSType_Bool },
+    { "Russian_Roulette",    kPOVAttrib_RussianRoulette,    kPOVMSType_Float },
 
     { "Sampling_Method",     kPOVAttrib_SamplingMethod,     kPOVMSType_Int },
+    { "Secondary_Ray_Budget",kPOVAttrib_SecondaryRayBudget, kPOVMSType_Int },
+    { "Shared_Framebuffer",  kPOVAttrib_SharedFramebuffer,  kPOVMSType_Bool },
     { "Split_Unions",        kPOVAttrib_SplitUnions,        kPOVMSType_Bool },
     { "Start_Column",        kPOVAttrib_Left,               kPOVMSType_Float },
     { "Start_Row",           kPOVAttrib_Top,                kPOVMSType_Float },
@@ -224,6 +273,8 @@ struct ProcessOptions::INI_Parser_Table RenderOptions_INI_Table[] =
 
     { "Test_Abort_Count",    kPOVAttrib_TestAbortCount,     kPOVMSType_Int },
     { "Test_Abort",          kPOVAttrib_TestAbort,          kPOVMSType_Bool },
+    { "Thread_Affinity",     kPOVAttrib_ThreadAffinity,     kPOVMSType_Bool },
+    { "Timeline_File",       kPOVAttrib_TimelineFile,       kPOVMSType_UCS2String },
 
     { "User_Abort_Command",  kPOVAttrib_UserAbortCommand,   kUseSpecialHandler },
     { "User_Abort_Return",   kPOVAttrib_UserAbortCommand,   kUseSpecialHandler },
@@ -236,6 +287,7 @@ struct ProcessOptions::INI_Parser_Table RenderOptions_INI_Table[] =
     { "Warning_Console",     kPOVAttrib_WarningConsole,     kPOVMSType_Bool },
     { "Warning_File",        kPOVAttrib_WarningFile,        kPOVMSType_UCS2String },
     { "Warning_Level",       kPOVAttrib_WarningLevel,       kPOVMSType_Int },
+    { "Wavefront_Shading",   kPOVAttrib_WavefrontShading,   kPOVMSType_Bool },
     { "Width",               kPOVAttrib_Width,              kPOVMSType_Int },
     { "Work_Threads",        kPOVAttrib_MaxRenderThreads,   kPOVMSType_Int },
 
@@ -37,10 +37,12 @@
 #include "frontend/renderfrontend.h"
 
 // C++ variants of C standard header files
-//  (none at the moment)
+#include <cmath>
 
 // C++ standard header files
 #include <algorithm>
+#include <map>
+#include <utility>
 
 // POV-Ray header files (base module)
 #include "base/fileinputoutput.h"
@@ -229,6 +231,7 @@ RenderFrontendBase::SceneId RenderFrontendBase::CreateScene(SceneData& shd, POVM
         // TODO FIXME END
 
         shd.verbose = obj.TryGetBool(kPOVAttrib_Verbose, true);
+        shd.cameras = 0;
 
         for(size_t i = 0; i < MAX_STREAMS; i++)
         {
@@ -311,6 +314,24 @@ RenderFrontendBase::SceneId RenderFrontendBase::CreateScene(SceneData& shd, POVM
             }
         }
 
+        shd.results.reset();
+        if(obj.Exist(kPOVAttrib_ResultsFile) == true)
+        {
+            Path tmp(obj.GetUCS2String(kPOVAttrib_ResultsFile));
+            // results are typically collected from many runs, so absolute file names are allowed
+            Path path(tmp.HasVolume() ? tmp : Path(shd.outputpath, tmp));
+            shd.results = std::make_shared<ResultsFile>(path, UCS2toSysString(obj.TryGetUCS2String(kPOVAttrib_InputFile, "")));
+        }
+
+        shd.progress.reset();
+        if(obj.Exist(kPOVAttrib_ProgressFile) == true)
+        {
+            Path tmp(obj.GetUCS2String(kPOVAttrib_ProgressFile));
+            // the file is polled by job schedulers, so absolute file names are allowed
+            Path path(tmp.HasVolume() ? tmp : Path(shd.outputpath, tmp));
+            shd.progress = std::make_shared<ProgressFile>(path, UCS2toSysString(obj.TryGetUCS2String(kPOVAttrib_InputFile, "")));
+        }
+
         if(obj.Exist(kPOVAttrib_LibraryPath) == true)
         {
             POVMS_List lps;
@@ -666,6 +687,9 @@ void RenderFrontendBase::ContinueBackup(POVMS_Object& ropts, ViewData& vd, ViewI
 
     size_t pos = sizeof(Backup_File_Header);
 
+    // samples accumulated in progressive mode, by block (identified by its top left corner); later passes supersede earlier ones
+    std::map<std::pair<POVMSInt, POVMSInt>, POVMS_Object> sampleStats;
+
     if (inbuffer != nullptr)
     {
         Backup_File_Header hdr;
@@ -710,6 +734,21 @@ void RenderFrontendBase::ContinueBackup(POVMS_Object& ropts, ViewData& vd, ViewI
                             serial++;
                     }
 
+                    // keep the samples accumulated in progressive mode, so that sampling can pick up where it left off
+                    if(msg.Exist(kPOVAttrib_SampleStatistics) == true)
+                    {
+                        POVMS_Object block(kPOVObjectClass_PixelData);
+                        std::vector<POVMSFloat> stats(msg.GetFloatVector(kPOVAttrib_SampleStatistics));
+
+                        block.SetInt(kPOVAttrib_Left, msg.GetInt(kPOVAttrib_Left));
+                        block.SetInt(kPOVAttrib_Top, msg.GetInt(kPOVAttrib_Top));
+                        block.SetInt(kPOVAttrib_Right, msg.GetInt(kPOVAttrib_Right));
+                        block.SetInt(kPOVAttrib_Bottom, msg.GetInt(kPOVAttrib_Bottom));
+                        block.SetFloatVector(kPOVAttrib_SampleStatistics, stats);
+                        block.SetInt(kPOVAttrib_SamplePass, msg.TryGetInt(kPOVAttrib_SamplePass, 0));
+                        sampleStats[std::make_pair(msg.GetInt(kPOVAttrib_Left), msg.GetInt(kPOVAttrib_Top))] = block;
+                    }
+
                     HandleImageMessage(vid, msg.GetIdentifier(), msg);
                 }
                 catch(pov_base::Exception&)
@@ -731,6 +770,15 @@ void RenderFrontendBase::ContinueBackup(POVMS_Object& ropts, ViewData& vd, ViewI
     else
         throw POV_EXCEPTION(kCannotOpenFileErr, "Cannot open state file from previous render.");
 
+    if (sampleStats.empty() == false)
+    {
+        POVMS_List stats;
+
+        for(std::map<std::pair<POVMSInt, POVMSInt>, POVMS_Object>::iterator i(sampleStats.begin()); i != sampleStats.end(); i++)
+            stats.Append(i->second);
+        ropts.Set(kPOVAttrib_SampleStatistics, stats);
+    }
+
     // make sure the input file is closed since we're about to write to it
     inbuffer.reset();
 
@@ -751,6 +799,91 @@ void RenderFrontendBase::ContinueBackup(POVMS_Object& ropts, ViewData& vd, ViewI
     }
 }
 
+void RenderFrontendBase::NewCheckpoint(POVMS_Object& ropts, ViewData& vd, const Path& outputpath)
+{
+    vd.checkpoint.reset();
+
+    MakeBackupPath(ropts, vd, outputpath);
+    vd.imageBackupFile.SetFile(GetFileName(Path(vd.imageBackupFile.GetFile())) + u".pov-ckpt");
+    if (!pov_base::PlatformBase::GetInstance().AllowLocalFileAccess (vd.imageBackupFile(), POV_File_Data_Backup, true))
+        throw POV_EXCEPTION(kCannotOpenFileErr, "Permission denied to create render state output file.");
+
+    vd.checkpoint = std::make_shared<CheckpointFile>(vd.imageBackupFile, ropts.TryGetInt(kPOVAttrib_Width, 160), ropts.TryGetInt(kPOVAttrib_Height, 120),
+                                                     ropts.TryGetInt(kPOVAttrib_CheckpointInterval, 0));
+
+    // as with the render state log, an existing output file must not survive an incomplete render
+    UCS2String filename = ropts.TryGetUCS2String(kPOVAttrib_OutputFile, "");
+    if((filename.length() > 0) && CheckIfFileExists(filename.c_str()))
+        pov_base::Filesystem::DeleteFile(filename);
+}
+
+bool RenderFrontendBase::ContinueCheckpoint(POVMS_Object& ropts, ViewData& vd, ViewId vid, POVMSInt& serial, std::vector<POVMSInt>& skip, const Path& outputpath)
+{
+    unsigned int width(ropts.TryGetInt(kPOVAttrib_Width, 160));
+    unsigned int height(ropts.TryGetInt(kPOVAttrib_Height, 120));
+
+    vd.checkpoint.reset();
+    MakeBackupPath(ropts, vd, outputpath);
+    vd.imageBackupFile.SetFile(GetFileName(Path(vd.imageBackupFile.GetFile())) + u".pov-ckpt");
+
+    std::shared_ptr<CheckpointFile> checkpoint(std::make_shared<CheckpointFile>(vd.imageBackupFile, width, height,
+                                                                                ropts.TryGetInt(kPOVAttrib_CheckpointInterval, 0)));
+    if (checkpoint->Load() == false)
+        return false;
+
+    checkpoint->GetCompletedBlocks(serial, skip);
+
+    POVMS_List stats;
+    if (checkpoint->GetSampleStatistics(stats) == true)
+        ropts.Set(kPOVAttrib_SampleStatistics, stats);
+
+    // restore the image and display, one run of rendered pixels at a time
+    std::vector<POVMSFloat> pixelvector;
+    for(unsigned int y = 0; y < height; y++)
+    {
+        for(unsigned int x = 0; x < width; )
+        {
+            unsigned int left = x;
+
+            pixelvector.clear();
+            for(; x < width; x++)
+            {
+                RGBTColour col(checkpoint->GetPixel(x, y));
+                if (std::isnan(col.red()))
+                    break;
+                pixelvector.push_back(col.red());
+                pixelvector.push_back(col.green());
+                pixelvector.push_back(col.blue());
+                pixelvector.push_back(0.0); // unused component
+                pixelvector.push_back(col.transm());
+            }
+
+            if (x > left)
+            {
+                POVMS_Object msg(kPOVObjectClass_PixelData);
+                POVMS_Attribute pixelattr(pixelvector);
+
+                msg.SetInt(kPOVAttrib_Left, left);
+                msg.SetInt(kPOVAttrib_Top, y);
+                msg.SetInt(kPOVAttrib_Right, x - 1);
+                msg.SetInt(kPOVAttrib_Bottom, y);
+                msg.SetInt(kPOVAttrib_PixelSize, 1);
+                msg.Set(kPOVAttrib_PixelBlock, pixelattr);
+                msg.SetVoid(kPOVAttrib_PixelFinal);
+                HandleImageMessage(vid, kPOVMsgIdent_PixelBlockSet, msg);
+            }
+            else
+                x++;
+        }
+    }
+
+    // if there isn't going to be an output file, we don't write to the checkpoint file
+    if (ropts.TryGetBool(kPOVAttrib_OutputToFile, true) == true)
+        vd.checkpoint = checkpoint;
+
+    return true;
+}
+
 namespace Message2Console
 {
 
@@ -972,9 +1105,10 @@ void ParserOptions(POVMS_Object& cppmsg, TextStreamBuffer *tsb)
         tsb->printf("  Input file: %s\n", UCS2toSysString(ucs2buf).c_str());
     else
         tsb->printf("  Input file: %s (compatible to version %1.2f)\n", UCS2toSysString(ucs2buf).c_str(), (double)f);
-    tsb->printf("  Remove bounds.......%s\n  Split unions........%s\n",
+    tsb->printf("  Remove bounds.......%s\n  Split unions........%s\n  Merge triangles.....%s\n",
                   GetOptionSwitchString(msg, kPOVAttrib_RemoveBounds, true),
-                  GetOptionSwitchString(msg, kPOVAttrib_SplitUnions, false));
+                  GetOptionSwitchString(msg, kPOVAttrib_SplitUnions, false),
+                  GetOptionSwitchString(msg, kPOVAttrib_MergeTriangles, true));
 
     tsb->printf("  Library paths:\n");
     if(POVMSObject_Get(msg, &attr, kPOVAttrib_LibraryPath) == kNoErr)
@@ -1325,6 +1459,61 @@ void ParserStatistics(POVMS_Object& cppmsg, TextStreamBuffer *tsb)
     tsb->printf("Light Sources:    %10d\n", l);
     tsb->printf("Total:            %10d\n", s + i + l);
 
+    if(cppmsg.Exist(kPOVAttrib_MeshImportTriangles) == true)
+    {
+        ll = cppmsg.TryGetLong(kPOVAttrib_MeshImportTriangles, 0);
+        double seconds = POVMSLongToCDouble(cppmsg.TryGetLong(kPOVAttrib_MeshImportTime, 0)) / 1000.0;
+        tsb->printf("----------------------------------------------------------------------------\n");
+        tsb->printf("Imported Mesh Triangles: %10.0f in %8.3f s", POVMSLongToCDouble(ll), seconds);
+        if(seconds > 0.0)
+            tsb->printf(" (%.0f triangles/s)", POVMSLongToCDouble(ll) / seconds);
+        tsb->printf("\n");
+    }
+
+    if(cppmsg.Exist(kPOVAttrib_HeightFieldPoints) == true)
+    {
+        ll = cppmsg.TryGetLong(kPOVAttrib_HeightFieldPoints, 0);
+        double seconds = POVMSLongToCDouble(cppmsg.TryGetLong(kPOVAttrib_HeightFieldTime, 0)) / 1000.0;
+        tsb->printf("----------------------------------------------------------------------------\n");
+        tsb->printf("Height Field Points:     %10.0f in %8.3f s", POVMSLongToCDouble(ll), seconds);
+        if(seconds > 0.0)
+            tsb->printf(" (%.0f points/s)", POVMSLongToCDouble(ll) / seconds);
+        tsb->printf("\n");
+    }
+
+    if(cppmsg.Exist(kPOVAttrib_SymbolLookups) == true)
+    {
+        double lookups = POVMSLongToCDouble(cppmsg.TryGetLong(kPOVAttrib_SymbolLookups, 0));
+        double probes = POVMSLongToCDouble(cppmsg.TryGetLong(kPOVAttrib_SymbolProbes, 0));
+        tsb->printf("----------------------------------------------------------------------------\n");
+        tsb->printf("Symbol Lookups:   %10.0f          Average Probes: %8.2f\n", lookups, (lookups > 0.0) ? probes / lookups : 0.0);
+    }
+
+    if(cppmsg.Exist(kPOVAttrib_DeclarationsReused) == true)
+    {
+        double reused = POVMSLongToCDouble(cppmsg.TryGetLong(kPOVAttrib_DeclarationsReused, 0));
+        double evaluated = POVMSLongToCDouble(cppmsg.TryGetLong(kPOVAttrib_DeclarationsEvaluated, 0));
+        tsb->printf("Declarations Reused: %7.0f          Evaluated:      %8.0f\n", reused, evaluated);
+    }
+
+    if(cppmsg.Exist(kPOVAttrib_MeshCacheHits) == true)
+    {
+        double hits = POVMSLongToCDouble(cppmsg.TryGetLong(kPOVAttrib_MeshCacheHits, 0));
+        double writes = POVMSLongToCDouble(cppmsg.TryGetLong(kPOVAttrib_MeshCacheWrites, 0));
+        tsb->printf("Cached Meshes Read:  %7.0f          Written:        %8.0f\n", hits, writes);
+    }
+
+    if(cppmsg.TryGetBool(kPOVAttrib_BoundingCacheHit, false) == true)
+    {
+        tsb->printf("----------------------------------------------------------------------------\n");
+        tsb->printf("Bounding hierarchy read from cache file.\n");
+    }
+    else if(cppmsg.TryGetBool(kPOVAttrib_BoundingCacheRefit, false) == true)
+    {
+        tsb->printf("----------------------------------------------------------------------------\n");
+        tsb->printf("Bounding hierarchy read from cache file and refit.\n");
+    }
+
     if(cppmsg.Exist(kPOVAttrib_BSPNodes) == true)
     {
         tsb->printf("----------------------------------------------------------------------------\n");
@@ -1340,6 +1529,32 @@ void ParserStatistics(POVMS_Object& cppmsg, TextStreamBuffer *tsb)
         tsb->printf("BSP Max Depth Stopped Nodes:  %10d (%3.1f%%)   Objects/Node:   %8.2f\n",
                     cppmsg.TryGetInt(kPOVAttrib_BSPAborts, 0), cppmsg.TryGetFloat(kPOVAttrib_BSPAverageAborts, 0.0f) * 100.0f,
                     cppmsg.TryGetFloat(kPOVAttrib_BSPAverageAbortObjects, 0.0f));
+        if(cppmsg.Exist(kPOVAttrib_BSPDepthTimes) == true)
+        {
+            std::vector<POVMSLong> depthTimes(cppmsg.GetLongVector(kPOVAttrib_BSPDepthTimes));
+
+            tsb->printf("----------------------------------------------------------------------------\n");
+            tsb->printf("BSP Split Selection Time per Tree Depth (CPU ms):\n");
+            for(size_t i = 0; i < depthTimes.size(); i += 6)
+            {
+                tsb->printf("  %3d-%3d:", int(i), int(min(i + 5, depthTimes.size() - 1)));
+                for(size_t j = i; (j < i + 6) && (j < depthTimes.size()); j++)
+                    tsb->printf(" %10.3f", double(depthTimes[j]) / 1000.0);
+                tsb->printf("\n");
+            }
+        }
+    }
+    else if(cppmsg.Exist(kPOVAttrib_BVHNodes) == true)
+    {
+        tsb->printf("----------------------------------------------------------------------------\n");
+        tsb->printf("BVH Node Width:   %10d\n", cppmsg.TryGetInt(kPOVAttrib_BVH_Width, 0));
+        tsb->printf("BVH Leaf Nodes:   %10d\n", cppmsg.TryGetInt(kPOVAttrib_BVHLeafNodes, 0));
+        tsb->printf("BVH Total Nodes:  %10d\n", cppmsg.TryGetInt(kPOVAttrib_BVHNodes, 0));
+        tsb->printf("----------------------------------------------------------------------------\n");
+        tsb->printf("BVH Objects/Leaf Average:       %8.2f          Maximum:      %10d\n",
+                    cppmsg.TryGetFloat(kPOVAttrib_BVHAverageObjects, 0.0f), cppmsg.TryGetInt(kPOVAttrib_BVHMaxObjects, 0));
+        tsb->printf("BVH Tree Depth Average:         %8.2f          Maximum:      %10d\n",
+                    cppmsg.TryGetFloat(kPOVAttrib_BVHAverageDepth, 0.0f), cppmsg.TryGetInt(kPOVAttrib_BVHMaxDepth, 0));
     }
 
     tsb->printf("----------------------------------------------------------------------------\n");
@@ -1350,7 +1565,7 @@ void RenderStatistics(POVMS_Object& cppmsg, TextStreamBuffer *tsb)
     POVMSObject msgobj(cppmsg());
     POVMSObjectPtr msg = &msgobj;
     POVMSAttribute attr;
-    POVMSLong l, l2, l3;
+    POVMSLong l, l2, l3, l4;
     POV_LONG Pixels_In_Image;
     int i, i2;
 
@@ -1427,17 +1642,98 @@ void RenderStatistics(POVMS_Object& cppmsg, TextStreamBuffer *tsb)
 
     (void)POVMSUtil_GetLong(msg, kPOVAttrib_IsoFindRoot, &l);
     (void)POVMSUtil_GetLong(msg, kPOVAttrib_FunctionVMCalls, &l2);
-    if((POVMSLongToCDouble(l) > 0.5) || (POVMSLongToCDouble(l2) > 0.5))
+    (void)POVMSUtil_GetLong(msg, kPOVAttrib_FunctionVMNativeCalls, &l3);
+    (void)POVMSUtil_GetLong(msg, kPOVAttrib_FunctionVMBatchCalls, &l4);
+    if((POVMSLongToCDouble(l) > 0.5) || (POVMSLongToCDouble(l2) > 0.5) || (POVMSLongToCDouble(l3) > 0.5) || (POVMSLongToCDouble(l4) > 0.5))
     {
         tsb->printf("----------------------------------------------------------------------------\n");
         if(POVMSLongToCDouble(l) > 0.5)
             tsb->printf("Isosurface roots:   %15.0f\n", POVMSLongToCDouble(l));
         if(POVMSLongToCDouble(l2) > 0.5)
             tsb->printf("Function VM calls:  %15.0f\n", POVMSLongToCDouble(l2));
+        if(POVMSLongToCDouble(l3) > 0.5)
+            tsb->printf("Native fn calls:    %15.0f (%3.0f percent)\n", POVMSLongToCDouble(l3),
+                        100.0 * POVMSLongToCDouble(l3) / (POVMSLongToCDouble(l2) + POVMSLongToCDouble(l3) + POVMSLongToCDouble(l4)));
+        if(POVMSLongToCDouble(l4) > 0.5)
+            tsb->printf("Batched fn calls:   %15.0f (%3.0f percent)\n", POVMSLongToCDouble(l4),
+                        100.0 * POVMSLongToCDouble(l4) / (POVMSLongToCDouble(l2) + POVMSLongToCDouble(l3) + POVMSLongToCDouble(l4)));
+    }
+
+    if(POVMSObject_Get(msg, &attr, kPOVAttrib_FunctionProfileStats) == kNoErr)
+    {
+        int cnt = 0;
+
+        if((POVMSAttrList_Count(&attr, &cnt) == kNoErr) && (cnt > 0))
+        {
+            POVMSObject obj;
+            int ii, len;
+            char str[64];
+
+            tsb->printf("----------------------------------------------------------------------------\n");
+            tsb->printf("Function Profile                     Calls    Instructions   Self Time (s)\n");
+            tsb->printf("----------------------------------------------------------------------------\n");
+
+            for(ii = 1; ii <= cnt; ii++)
+            {
+                if(POVMSAttrList_GetNth(&attr, ii, &obj) == kNoErr)
+                {
+                    len = 64;
+                    str[0] = 0;
+                    (void)POVMSUtil_GetString(&obj, kPOVAttrib_ObjectName, str, &len);
+                    (void)POVMSUtil_GetLong(&obj, kPOVAttrib_FunctionCalls, &l);
+                    (void)POVMSUtil_GetLong(&obj, kPOVAttrib_FunctionInstructions, &l2);
+                    (void)POVMSUtil_GetLong(&obj, kPOVAttrib_FunctionTime, &l3);
+
+                    tsb->printf("%-28.28s %13.0f %15.0f %15.3f\n", str,
+                                POVMSLongToCDouble(l), POVMSLongToCDouble(l2), POVMSLongToCDouble(l3) / 1000000000.0);
+
+                    (void)POVMSAttr_Delete(&obj);
+                }
+            }
+        }
+
+        (void)POVMSAttr_Delete(&attr);
+    }
+
+    if(POVMSObject_Get(msg, &attr, kPOVAttrib_ObjectProfileStats) == kNoErr)
+    {
+        int cnt = 0;
+
+        if((POVMSAttrList_Count(&attr, &cnt) == kNoErr) && (cnt > 0))
+        {
+            POVMSObject obj;
+            int ii, len;
+            char str[64];
+
+            tsb->printf("----------------------------------------------------------------------------\n");
+            tsb->printf("Object Profile                       Tests            Hits  Est. Time (s)\n");
+            tsb->printf("----------------------------------------------------------------------------\n");
+
+            for(ii = 1; ii <= cnt; ii++)
+            {
+                if(POVMSAttrList_GetNth(&attr, ii, &obj) == kNoErr)
+                {
+                    len = 64;
+                    str[0] = 0;
+                    (void)POVMSUtil_GetString(&obj, kPOVAttrib_ObjectName, str, &len);
+                    (void)POVMSUtil_GetLong(&obj, kPOVAttrib_ISectsTests, &l);
+                    (void)POVMSUtil_GetLong(&obj, kPOVAttrib_ISectsSucceeded, &l2);
+                    (void)POVMSUtil_GetLong(&obj, kPOVAttrib_ObjectProfileTime, &l3);
+
+                    tsb->printf("%-28.28s %13.0f %15.0f %15.3f\n", str,
+                                POVMSLongToCDouble(l), POVMSLongToCDouble(l2), POVMSLongToCDouble(l3) / 1000000000.0);
+
+                    (void)POVMSAttr_Delete(&obj);
+                }
+            }
+        }
+
+        (void)POVMSAttr_Delete(&attr);
     }
 
     (void)POVMSUtil_GetLong(msg, kPOVAttrib_CrackleCacheTest, &l);
     (void)POVMSUtil_GetLong(msg, kPOVAttrib_CrackleCacheTestSuc, &l2);
+    (void)POVMSUtil_GetLong(msg, kPOVAttrib_CrackleCacheEvict, &l3);
     if((POVMSLongToCDouble(l) > 0.5) || (POVMSLongToCDouble(l2) > 0.5))
     {
         tsb->printf("----------------------------------------------------------------------------\n");
@@ -1446,7 +1742,33 @@ void RenderStatistics(POVMS_Object& cppmsg, TextStreamBuffer *tsb)
             if(POVMSLongToCDouble(l2) > 0.5)
                 tsb->printf("Crackle Cache Hits:    %15.0f (%3.0f percent)\n", POVMSLongToCDouble(l2),
                             100.0 * POVMSLongToCDouble(l2) / POVMSLongToCDouble(l));
+            if(POVMSLongToCDouble(l3) > 0.5)
+                tsb->printf("Crackle Cache Evictions: %13.0f\n", POVMSLongToCDouble(l3));
+    }
+
+    (void)POVMSUtil_GetLong(msg, kPOVAttrib_WarpChains, &l);
+    (void)POVMSUtil_GetLong(msg, kPOVAttrib_WarpTime, &l2);
+    if(POVMSLongToCDouble(l) > 0.5)
+    {
+        tsb->printf("----------------------------------------------------------------------------\n");
+        tsb->printf("Warp Chains Evaluated: %15.0f\n", POVMSLongToCDouble(l));
+        tsb->printf("Warp Time (estimated): %15.3f s\n", POVMSLongToCDouble(l2) / 1000000000.0);
+    }
+
+#if POV_FRONTEND_DEBUG
+    (void)POVMSUtil_GetLong(msg, kPOVAttrib_TaskQueueTasks, &l);
+    (void)POVMSUtil_GetLong(msg, kPOVAttrib_TaskQueueLatency, &l2);
+    (void)POVMSUtil_GetLong(msg, kPOVAttrib_TaskQueueSyncWaits, &l3);
+    (void)POVMSUtil_GetLong(msg, kPOVAttrib_TaskQueueSyncWaitTime, &l4);
+    if(POVMSLongToCDouble(l) > 0.5)
+    {
+        tsb->printf("----------------------------------------------------------------------------\n");
+        tsb->printf("Tasks Started:         %15.0f   Avg. Latency: %10.3f ms\n",
+                    POVMSLongToCDouble(l), POVMSLongToCDouble(l2) / POVMSLongToCDouble(l) / 1000000.0);
+        tsb->printf("Sync Waits:            %15.0f   Wait Time:    %10.3f s\n",
+                    POVMSLongToCDouble(l3), POVMSLongToCDouble(l4) / 1000000000.0);
     }
+#endif
 
     tsb->printf("----------------------------------------------------------------------------\n");
 
@@ -1481,9 +1803,39 @@ void RenderStatistics(POVMS_Object& cppmsg, TextStreamBuffer *tsb)
         tsb->printf("Shadow Ray Tests:   %15.0f   Succeeded:       %15.0f\n",
                       POVMSLongToCDouble(l), POVMSLongToCDouble(l2));
 
-        (void)POVMSUtil_GetLong(msg, kPOVAttrib_ShadowCacheHits, &l);
+        (void)POVMSUtil_GetLong(msg, kPOVAttrib_ShadowCacheTests, &l);
         if(POVMSLongToCDouble(l) > 0.5)
-            tsb->printf("Shadow Cache Hits:  %15.0f\n", POVMSLongToCDouble(l));
+        {
+            (void)POVMSUtil_GetLong(msg, kPOVAttrib_ShadowCacheHits, &l2);
+            tsb->printf("Shadow Cache Tests: %15.0f   Hits:            %15.0f (%4.1f%%)\n",
+                          POVMSLongToCDouble(l), POVMSLongToCDouble(l2), 100.0 * POVMSLongToCDouble(l2) / POVMSLongToCDouble(l));
+        }
+    }
+
+    {
+        static const POVMSType rouletteStats[] = { kPOVAttrib_RouletteTerminated1, kPOVAttrib_RouletteTerminated2,
+                                                   kPOVAttrib_RouletteTerminated3, kPOVAttrib_RouletteTerminated4,
+                                                   kPOVAttrib_RouletteTerminated5 };
+        for (int i = 0; i < 5; i++)
+        {
+            (void)POVMSUtil_GetLong(msg, rouletteStats[i], &l);
+            if(POVMSLongToCDouble(l) > 0.5)
+                tsb->printf("Roulette Level %d%s:  %15.0f rays terminated\n", i + 1, (i == 4 ? "+" : " "), POVMSLongToCDouble(l));
+        }
+    }
+
+    (void)POVMSUtil_GetLong(msg, kPOVAttrib_RayBudgetExhausted, &l);
+    if(POVMSLongToCDouble(l) > 0.5)
+        tsb->printf("Over Ray Budget:    %15.0f rays not traced\n", POVMSLongToCDouble(l));
+
+    (void)POVMSUtil_GetLong(msg, kPOVAttrib_MeshPageIns, &l);
+    (void)POVMSUtil_GetLong(msg, kPOVAttrib_MeshPageEvictions, &l2);
+    if((POVMSLongToCDouble(l) > 0.5) || (POVMSLongToCDouble(l2) > 0.5))
+    {
+        (void)POVMSUtil_GetLong(msg, kPOVAttrib_MeshPageInTime, &l3);
+        tsb->printf("Mesh Page-Ins:      %15.0f   Evictions:       %15.0f\n",
+                      POVMSLongToCDouble(l), POVMSLongToCDouble(l2));
+        tsb->printf("Mesh Page-In Stall: %15.3f s\n", POVMSLongToCDouble(l3) / 1000000.0);
     }
 
     (void)POVMSUtil_GetLong(msg, kPOVAttrib_ReflectedRays, &l);
@@ -1532,11 +1884,24 @@ void RenderStatistics(POVMS_Object& cppmsg, TextStreamBuffer *tsb)
 
         tsb->printf("Radiosity samples reused:      %15.0f\n", POVMSLongToCDouble(l2));
 
+        (void)POVMSUtil_GetLong(msg, kPOVAttrib_RadIncrementalReused, &l3);
+        (void)POVMSUtil_GetLong(msg, kPOVAttrib_RadIncrementalDiscarded, &l4);
+        if((POVMSLongToCDouble(l3) > 0.5) || (POVMSLongToCDouble(l4) > 0.5))
+        {
+            tsb->printf("Samples from previous frames:  %15.0f\n", POVMSLongToCDouble(l3) + POVMSLongToCDouble(l4));
+            tsb->printf("  discarded as outdated:       %15.0f\n", POVMSLongToCDouble(l4));
+        }
+
         (void)POVMSUtil_GetLong(msg, kPOVAttrib_RadRayCount, &l3);
         if(POVMSLongToCDouble(l3) > 0.5)
         {
             tsb->printf("Radiosity sample rays shot:    %15.0f\n", POVMSLongToCDouble(l3));
         }
+        (void)POVMSUtil_GetLong(msg, kPOVAttrib_RadRaysSaved, &l3);
+        if(POVMSLongToCDouble(l3) > 0.5)
+        {
+            tsb->printf("Radiosity sample rays saved:   %15.0f\n", POVMSLongToCDouble(l3));
+        }
 
         (void)POVMSUtil_GetLong(msg, kPOVAttrib_RadOctreeNodes, &l2);
         if(POVMSLongToCDouble(l2) > 0.5)
@@ -1570,6 +1935,16 @@ void RenderStatistics(POVMS_Object& cppmsg, TextStreamBuffer *tsb)
         if(POVMSLongToCDouble(l3) > 0.5)
             tsb->printf("Radiosity blocks rejected:     %15.0f (%.2f %%)\n", POVMSLongToCDouble(l3), 100.0 * POVMSLongToCDouble(l3) / POVMSLongToCDouble(l));
 
+        (void)POVMSUtil_GetLong(msg, kPOVAttrib_RadOctreeRetries, &l);
+        if(POVMSLongToCDouble(l) > 0.5)
+            tsb->printf("Radiosity octree insert retries:%14.0f\n", POVMSLongToCDouble(l));
+        (void)POVMSUtil_GetLong(msg, kPOVAttrib_RadLockWaitTime, &l);
+        if(POVMSLongToCDouble(l) > 0.5)
+            tsb->printf("Radiosity cache lock wait:     %15.3f s\n", POVMSLongToCDouble(l) / 1000000.0);
+        (void)POVMSUtil_GetLong(msg, kPOVAttrib_RadRecentHits, &l);
+        if(POVMSLongToCDouble(l) > 0.5)
+            tsb->printf("Radiosity recent sample hits:  %15.0f\n", POVMSLongToCDouble(l));
+
         (void)POVMSUtil_GetLong(msg, kPOVAttrib_RadTopLevelGatherCount, &l);
         (void)POVMSUtil_GetLong(msg, kPOVAttrib_RadTopLevelReuseCount, &l2);
         (void)POVMSUtil_GetLong(msg, kPOVAttrib_RadTopLevelRayCount, &l3);
@@ -1577,6 +1952,9 @@ void RenderStatistics(POVMS_Object& cppmsg, TextStreamBuffer *tsb)
         tsb->printf("Radiosity Depth 0 calculated:  %15.0f (%.2f %%)\n", POVMSLongToCDouble(l), 100.0 * POVMSLongToCDouble(l) / (POVMSLongToCDouble(l) + POVMSLongToCDouble(l2)));
         tsb->printf("Radiosity Depth 0 reused:      %15.0f\n", POVMSLongToCDouble(l2));
         tsb->printf("Radiosity Depth 0 rays shot:   %15.0f\n", POVMSLongToCDouble(l3));
+        (void)POVMSUtil_GetLong(msg, kPOVAttrib_RadTopLevelRaysSaved, &l3);
+        if(POVMSLongToCDouble(l3) > 0.5)
+            tsb->printf("Radiosity Depth 0 rays saved:  %15.0f\n", POVMSLongToCDouble(l3));
 
         (void)POVMSUtil_GetLong(msg, kPOVAttrib_RadFinalGatherCount, &l);
         (void)POVMSUtil_GetLong(msg, kPOVAttrib_RadFinalReuseCount, &l2);
@@ -1585,6 +1963,9 @@ void RenderStatistics(POVMS_Object& cppmsg, TextStreamBuffer *tsb)
         tsb->printf("Radiosity (final) calculated:  %15.0f (%.2f %%)\n", POVMSLongToCDouble(l), 100.0 * POVMSLongToCDouble(l) / (POVMSLongToCDouble(l) + POVMSLongToCDouble(l2)));
         tsb->printf("Radiosity (final) reused:      %15.0f\n", POVMSLongToCDouble(l2));
         tsb->printf("Radiosity (final) rays shot:   %15.0f\n", POVMSLongToCDouble(l3));
+        (void)POVMSUtil_GetLong(msg, kPOVAttrib_RadFinalRaysSaved, &l3);
+        if(POVMSLongToCDouble(l3) > 0.5)
+            tsb->printf("Radiosity (final) rays saved:  %15.0f\n", POVMSLongToCDouble(l3));
 
         POVMSLong samples[5][5];
         POVMSLong sampleSumPerRecursion[5];
@@ -1670,6 +2051,40 @@ void RenderStatistics(POVMS_Object& cppmsg, TextStreamBuffer *tsb)
                 tsb->printf("         - ");
         }
         tsb->printf("\n");
+
+        POVMSLong raysShot[6], raysSaved[6];
+        POVMSLong raysShotSum = 0, raysSavedSum = 0;
+        for (int pass = 1; pass <= 6; pass ++)
+        {
+            unsigned int id = (pass <= 5 ? kPOVAttrib_RadRayCountP1 + (pass-1)*256 : kPOVAttrib_RadRayCountF);
+            l = 0;
+            (void)POVMSUtil_GetLong(msg, id, &l);
+            raysShot[pass-1] = l;
+            raysShotSum += l;
+            id = (pass <= 5 ? kPOVAttrib_RadRaysSavedP1 + (pass-1)*256 : kPOVAttrib_RadRaysSavedF);
+            l = 0;
+            (void)POVMSUtil_GetLong(msg, id, &l);
+            raysSaved[pass-1] = l;
+            raysSavedSum += l;
+        }
+        if (POVMSLongToCDouble(raysShotSum) > 0.5)
+        {
+            tsb->printf("----------------------------------------------------------------------------\n");
+            tsb->printf("  Pass       Rays shot      Rays saved\n");
+            tsb->printf("----------------------------------------------------------------------------\n");
+            for (int pass = 1; pass <= 6; pass ++)
+            {
+                if ((POVMSLongToCDouble(raysShot[pass-1]) < 0.5) && (POVMSLongToCDouble(raysSaved[pass-1]) < 0.5))
+                    continue;
+                if (pass <= 5)
+                    tsb->printf("  %i%c   ", pass, (pass < 5 ? ' ' : '+'));
+                else
+                    tsb->printf("  Final");
+                tsb->printf(" %15.0f %15.0f\n", POVMSLongToCDouble(raysShot[pass-1]), POVMSLongToCDouble(raysSaved[pass-1]));
+            }
+            tsb->printf("----------------------------------------------------------------------------\n");
+            tsb->printf("  Total %15.0f %15.0f\n", POVMSLongToCDouble(raysShotSum), POVMSLongToCDouble(raysSavedSum));
+        }
     }
 
     (void)POVMSUtil_GetLong(msg, kPOVAttrib_PhotonsShot, &l);
@@ -1683,6 +2098,12 @@ void RenderStatistics(POVMS_Object& cppmsg, TextStreamBuffer *tsb)
         (void)POVMSUtil_GetLong(msg, kPOVAttrib_MediaPhotonsStored, &l);
         if(POVMSLongToCDouble(l) > 0.5)
             tsb->printf("Media photons stored:   %15.0f\n", POVMSLongToCDouble(l));
+        (void)POVMSUtil_GetLong(msg, kPOVAttrib_SurfacePhotonBuildTime, &l);
+        if(POVMSLongToCDouble(l) > 0.5)
+            tsb->printf("Surface kd-tree build:  %15.3f s\n", POVMSLongToCDouble(l) / 1000.0);
+        (void)POVMSUtil_GetLong(msg, kPOVAttrib_MediaPhotonBuildTime, &l);
+        if(POVMSLongToCDouble(l) > 0.5)
+            tsb->printf("Media kd-tree build:    %15.3f s\n", POVMSLongToCDouble(l) / 1000.0);
         (void)POVMSUtil_GetLong(msg, kPOVAttrib_GlobalPhotonsStored, &l);
         if(POVMSLongToCDouble(l) > 0.5)
             tsb->printf("Global photons stored:  %15.0f\n", POVMSLongToCDouble(l));
@@ -1721,6 +2142,47 @@ void RenderStatistics(POVMS_Object& cppmsg, TextStreamBuffer *tsb)
     if(POVMSLongToCDouble(l) > 0.5)
         tsb->printf("Peak memory used:   %15.0f bytes\n", POVMSLongToCDouble(l));
 
+    if(POVMSObject_Get(msg, &attr, kPOVAttrib_SubsystemMemory) == kNoErr)
+    {
+        int cnt = 0;
+        bool header = false;
+
+        if(POVMSAttrList_Count(&attr, &cnt) == kNoErr)
+        {
+            POVMSObject obj;
+            int ii, len;
+            char str[64];
+
+            for(ii = 1; ii <= cnt; ii++)
+            {
+                if(POVMSAttrList_GetNth(&attr, ii, &obj) == kNoErr)
+                {
+                    len = 64;
+                    str[0] = 0;
+                    l = l2 = 0;
+                    (void)POVMSUtil_GetString(&obj, kPOVAttrib_ObjectName, str, &len);
+                    (void)POVMSUtil_GetLong(&obj, kPOVAttrib_CurrentMemoryUsage, &l);
+                    (void)POVMSUtil_GetLong(&obj, kPOVAttrib_PeakMemoryUsage, &l2);
+
+                    // subsystems the scene did not use at all are not worth mentioning
+                    if(POVMSLongToCDouble(l2) > 0.5)
+                    {
+                        if(!header)
+                        {
+                            tsb->printf("Memory by subsystem              Current (bytes)       Peak (bytes)\n");
+                            header = true;
+                        }
+                        tsb->printf("  %-28.28s %17.0f %18.0f\n", str, POVMSLongToCDouble(l), POVMSLongToCDouble(l2));
+                    }
+
+                    (void)POVMSAttr_Delete(&obj);
+                }
+            }
+        }
+
+        (void)POVMSAttr_Delete(&attr);
+    }
+
     tsb->printf("----------------------------------------------------------------------------\n");
 
     POVMSObject_Delete(msg);
@@ -1816,6 +2278,55 @@ const char *GetOptionSwitchString(POVMSObjectPtr msg, POVMSType key, bool defaul
     return ".Off";
 }
 
+/// Print the hardware events counted in one thread or in total, as far as they have been counted.
+static void EventCountsLine(POVMS_Object& obj, TextStreamBuffer *tsb)
+{
+    const char *separator = "";
+    if (obj.Exist(kPOVAttrib_Cycles))
+    {
+        tsb->printf("%s%.0f cycles", separator, double(obj.TryGetLong(kPOVAttrib_Cycles, 0)));
+        separator = ", ";
+    }
+    if (obj.Exist(kPOVAttrib_Instructions))
+    {
+        tsb->printf("%s%.0f instructions", separator, double(obj.TryGetLong(kPOVAttrib_Instructions, 0)));
+        if (obj.TryGetLong(kPOVAttrib_Cycles, 0) > 0)
+            tsb->printf(" (%.2f per cycle)", double(obj.TryGetLong(kPOVAttrib_Instructions, 0)) / double(obj.TryGetLong(kPOVAttrib_Cycles, 0)));
+        separator = ", ";
+    }
+    if (obj.Exist(kPOVAttrib_CacheMisses))
+    {
+        tsb->printf("%s%.0f cache misses", separator, double(obj.TryGetLong(kPOVAttrib_CacheMisses, 0)));
+        separator = ", ";
+    }
+    if (obj.Exist(kPOVAttrib_BranchMisses))
+        tsb->printf("%s%.0f branch mispredictions", separator, double(obj.TryGetLong(kPOVAttrib_BranchMisses, 0)));
+    tsb->printf("\n");
+}
+
+/// Print the hardware events counted in a phase of the render, if any, in total and per thread.
+static void EventCounts(POVMS_Object& timeObj, TextStreamBuffer *tsb)
+{
+    if (!timeObj.Exist(kPOVAttrib_ThreadEvents))
+        return;
+
+    tsb->printf("              counted ");
+    EventCountsLine(timeObj, tsb);
+
+    POVMS_List threads;
+    timeObj.Get(kPOVAttrib_ThreadEvents, threads);
+    if (threads.GetListSize() > 1)
+    {
+        for (int i = 1; i <= threads.GetListSize(); i++)
+        {
+            POVMS_Object thread;
+            threads.GetNth(i, thread);
+            tsb->printf("                thread %2d: ", i);
+            EventCountsLine(thread, tsb);
+        }
+    }
+}
+
 void ParserTime(POVMS_Object& cppmsg, TextStreamBuffer *tsb)
 {
     POV_LONG i = 0;
@@ -1843,6 +2354,7 @@ void ParserTime(POVMS_Object& cppmsg, TextStreamBuffer *tsb)
         }
         else
             tsb->printf("              using %d thread(s)\n", int(parseTime.TryGetInt(kPOVAttrib_TimeSamples, 1)));
+        EventCounts(parseTime, tsb);
     }
     else
         tsb->printf("  Parse Time:       No parsing\n");
@@ -1863,6 +2375,7 @@ void ParserTime(POVMS_Object& cppmsg, TextStreamBuffer *tsb)
         }
         else
             tsb->printf("              using %d thread(s)\n", int(boundingTime.TryGetInt(kPOVAttrib_TimeSamples, 1)));
+        EventCounts(boundingTime, tsb);
     }
     else
         tsb->printf("  Bounding Time:    No bounding\n");
@@ -1896,6 +2409,7 @@ void RenderTime(POVMS_Object& cppmsg, TextStreamBuffer *tsb)
         }
         else
             tsb->printf("              using %d thread(s)\n", int(photonTime.TryGetInt(kPOVAttrib_TimeSamples, 1)));
+        EventCounts(photonTime, tsb);
     }
     else
         tsb->printf("  Photon Time:      No photons\n");
@@ -1916,6 +2430,7 @@ void RenderTime(POVMS_Object& cppmsg, TextStreamBuffer *tsb)
         }
         else
             tsb->printf("              using %d thread(s)\n", int(radiosityTime.TryGetInt(kPOVAttrib_TimeSamples, 1)));
+        EventCounts(radiosityTime, tsb);
     }
     else
         tsb->printf("  Radiosity Time:   No radiosity\n");
@@ -1936,6 +2451,7 @@ void RenderTime(POVMS_Object& cppmsg, TextStreamBuffer *tsb)
         }
         else
             tsb->printf("              using %d thread(s)\n", int(renderTime.TryGetInt(kPOVAttrib_TimeSamples, 1)));
+        EventCounts(renderTime, tsb);
     }
     else
         tsb->printf("  Trace Time:       No trace\n");
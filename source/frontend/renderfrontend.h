@@ -63,6 +63,7 @@
 #include "base/textstreambuffer_fwd.h"
 #include "base/types.h"
 #include "base/image/colourspace.h"
+#include "base/image/framebuffer.h"
 #include "base/image/image.h"
 
 // POV-Ray header files (POVMS module)
@@ -70,8 +71,10 @@
 #include "povms/povmsid.h"
 
 // POV-Ray header files (frontend module)
+#include "frontend/checkpointfile.h"
 #include "frontend/console.h"
 #include "frontend/imageprocessing.h"
+#include "frontend/resultsfile.h"
 
 namespace pov_frontend
 {
@@ -128,6 +131,12 @@ struct SceneData final
 
     bool verbose;
 
+    /// Number of cameras to render as separate views of the scene, or 0 to render a single view.
+    unsigned int cameras;
+
+    std::shared_ptr<ResultsFile> results;
+    std::shared_ptr<ProgressFile> progress;
+
     struct final
     {
         int legacyGammaMode;
@@ -157,6 +166,10 @@ struct ViewData final
     mutable std::shared_ptr<Image> image;
     mutable std::shared_ptr<Display> display;
     mutable std::shared_ptr<OStream> imageBackup;
+    mutable std::shared_ptr<CheckpointFile> checkpoint; ///< Render state checkpoint, or `nullptr` if the render state is logged to @ref imageBackup instead.
+    mutable std::shared_ptr<ImageFeatures> features; ///< Denoising features, or `nullptr` if denoising is disabled.
+    mutable std::shared_ptr<ImageCostMap> costMap;   ///< Pixel costs, or `nullptr` if no cost map is to be written.
+    mutable std::shared_ptr<SharedFramebuffer> sharedFramebuffer; ///< Framebuffer the backend may store final pixels in, or `nullptr` if disabled.
     GammaCurvePtr displayGamma;
     bool greyscaleDisplay;
 
@@ -269,6 +282,8 @@ class RenderFrontendBase : public POVMS_MessageReceiver
         void MakeBackupPath(POVMS_Object& ropts, ViewData& vd, const Path& outputpath);
         void NewBackup(POVMS_Object& ropts, ViewData& vd, const Path& outputpath);
         void ContinueBackup(POVMS_Object& ropts, ViewData& vd, ViewId vid, POVMSInt& serial, std::vector<POVMSInt>& skip, const Path& outputpath);
+        void NewCheckpoint(POVMS_Object& ropts, ViewData& vd, const Path& outputpath);
+        bool ContinueCheckpoint(POVMS_Object& ropts, ViewData& vd, ViewId vid, POVMSInt& serial, std::vector<POVMSInt>& skip, const Path& outputpath);
 };
 
 // TODO - Do we really need this to be a template?
@@ -300,6 +315,13 @@ class RenderFrontend : public RenderFrontendBase
 
         SceneData::SceneState GetSceneState(SceneId sid);
 
+        /// Get the number of cameras to render as separate views of a parsed scene.
+        ///
+        /// @return     Number of cameras if the scene was parsed with `Multi_Camera` set and
+        ///             declares more than one camera, 0 otherwise.
+        ///
+        unsigned int GetSceneCameras(SceneId sid);
+
         void StartParser(SceneId sid, POVMS_Object& obj);
         void PauseParser(SceneId sid);
         void ResumeParser(SceneId sid);
@@ -418,6 +440,16 @@ SceneData::SceneState RenderFrontend<PARSER_MH, FILE_MH, RENDER_MH, IMAGE_MH>::G
         return SceneData::Scene_Unknown;
 }
 
+template<class PARSER_MH, class FILE_MH, class RENDER_MH, class IMAGE_MH>
+unsigned int RenderFrontend<PARSER_MH, FILE_MH, RENDER_MH, IMAGE_MH>::GetSceneCameras(SceneId sid)
+{
+    typename SceneHandlerMap::iterator shi(scenehandler.find(sid));
+    if((shi != scenehandler.end()) && (shi->second.data.cameras > 1))
+        return shi->second.data.cameras;
+    else
+        return 0;
+}
+
 template<class PARSER_MH, class FILE_MH, class RENDER_MH, class IMAGE_MH>
 void RenderFrontend<PARSER_MH, FILE_MH, RENDER_MH, IMAGE_MH>::StartParser(SceneId sid, POVMS_Object& obj)
 {
@@ -545,6 +577,13 @@ RenderFrontendBase::ViewId RenderFrontend<PARSER_MH, FILE_MH, RENDER_MH, IMAGE_M
 
             vh.data.greyscaleDisplay = obj.TryGetBool(kPOVAttrib_GrayscaleOutput, false);
 
+            // real-time raytracing sends whole frames, which would gain nothing from the framebuffer
+            if (obj.TryGetBool(kPOVAttrib_SharedFramebuffer, true) && !obj.TryGetBool(kPOVAttrib_RealTimeRaytracing, false))
+            {
+                vh.data.sharedFramebuffer = SharedFramebuffer::Create(width, height);
+                obj.SetInt(kPOVAttrib_SharedFramebufferId, vh.data.sharedFramebuffer->GetId());
+            }
+
             vh.data.state = ViewData::View_Invalid;
 
             vid = RenderFrontendBase::CreateView(shi->second.data, vh.data, sid, obj);
@@ -560,6 +599,11 @@ RenderFrontendBase::ViewId RenderFrontend<PARSER_MH, FILE_MH, RENDER_MH, IMAGE_M
                         throw POV_EXCEPTION_STRING("Invalid partial rendered image. Image size does not match!");
 
                     vh.data.image = img;
+                    vh.data.features = imageProcessing->GetFeatures();
+                    vh.data.costMap = imageProcessing->GetCostMap();
+
+                    // with streaming output, the output file needs to be ready before any pixels arrive
+                    imageProcessing->BeginImage(obj);
                 }
                 else
                     vh.data.image = std::shared_ptr<Image>(Image::Create(width, height, ImageDataType::RGBFT_Float));
@@ -659,16 +703,27 @@ void RenderFrontend<PARSER_MH, FILE_MH, RENDER_MH, IMAGE_MH>::StartRender(ViewId
                         POVMSInt serial;
                         std::vector<POVMSInt> skip;
 
-                        ContinueBackup(obj, vhi->second.data, vid, serial, skip, outputpath);
-
-                        obj.SetInt(kPOVAttrib_PixelId, serial);
-                        if(skip.empty() == false)
-                            obj.SetIntVector(kPOVAttrib_PixelSkipList, skip);
-                        continueOK = true;
+                        // in checkpoint mode, a missing or unusable checkpoint means starting over
+                        if(obj.TryGetInt(kPOVAttrib_CheckpointInterval, 0) > 0)
+                            continueOK = ContinueCheckpoint(obj, vhi->second.data, vid, serial, skip, outputpath);
+                        else
+                        {
+                            ContinueBackup(obj, vhi->second.data, vid, serial, skip, outputpath);
+                            continueOK = true;
+                        }
+
+                        if(continueOK == true)
+                        {
+                            obj.SetInt(kPOVAttrib_PixelId, serial);
+                            if(skip.empty() == false)
+                                obj.SetIntVector(kPOVAttrib_PixelSkipList, skip);
+                        }
                     }
                     catch(pov_base::Exception&)
                     {
                         vhi->second.data.imageBackup.reset();
+                        vhi->second.data.checkpoint.reset();
+                        continueOK = false;
                     }
                 }
             }
@@ -700,11 +755,15 @@ void RenderFrontend<PARSER_MH, FILE_MH, RENDER_MH, IMAGE_MH>::StartRender(ViewId
             {
                 try
                 {
-                    NewBackup(obj, vhi->second.data, outputpath);
+                    if(obj.TryGetInt(kPOVAttrib_CheckpointInterval, 0) > 0)
+                        NewCheckpoint(obj, vhi->second.data, outputpath);
+                    else
+                        NewBackup(obj, vhi->second.data, outputpath);
                 }
                 catch(pov_base::Exception&)
                 {
                     vhi->second.data.imageBackup.reset ();
+                    vhi->second.data.checkpoint.reset ();
                     throw;
                 }
             }
@@ -778,6 +837,7 @@ void RenderFrontend<PARSER_MH, FILE_MH, RENDER_MH, IMAGE_MH>::HandleParserMessag
         if(ident == kPOVMsgIdent_Done)
         {
             GetBackwardCompatibilityData(shi->second.data, msg);
+            shi->second.data.cameras = msg.TryGetInt(kPOVAttrib_Cameras, 0);
             shi->second.data.state = SceneData::Scene_Ready;
         }
         else if(ident == kPOVMsgIdent_Failed)
@@ -818,6 +878,11 @@ void RenderFrontend<PARSER_MH, FILE_MH, RENDER_MH, IMAGE_MH>::HandleRenderMessag
                 vhi->second.data.imageBackup.reset();
                 pov_base::Filesystem::DeleteFile(vhi->second.data.imageBackupFile());
             }
+            if (vhi->second.data.checkpoint != nullptr)
+            {
+                vhi->second.data.checkpoint.reset();
+                pov_base::Filesystem::DeleteFile(vhi->second.data.imageBackupFile());
+            }
         }
         else if(ident == kPOVMsgIdent_Failed)
         {
@@ -829,6 +894,13 @@ void RenderFrontend<PARSER_MH, FILE_MH, RENDER_MH, IMAGE_MH>::HandleRenderMessag
             // close the state file if it's open
             if (vhi->second.data.imageBackup != nullptr)
                 vhi->second.data.imageBackup.reset();
+
+            // make sure the checkpoint reflects everything rendered so far
+            if (vhi->second.data.checkpoint != nullptr)
+            {
+                vhi->second.data.checkpoint->Flush();
+                vhi->second.data.checkpoint.reset();
+            }
         }
         else
             vhi->second.render.HandleMessage(sceneData, vhi->second.data, ident, msg);
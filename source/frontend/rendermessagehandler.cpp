@@ -93,9 +93,15 @@ void RenderMessageHandler::HandleMessage(const SceneData& sd, const ViewData&, P
                 Message2Console::RenderStatistics(obj, sd.streams[ALL_STREAM].get());
                 Message2Console::RenderTime(obj, sd.streams[ALL_STREAM].get());
             }
+            if (sd.results != nullptr)
+                sd.results->RenderStatistics(obj);
+            if (sd.progress != nullptr)
+                sd.progress->RenderStatistics(obj);
             break;
         case kPOVMsgIdent_Progress:
             Progress(sd.console.get(), obj, sd.verbose);
+            if (sd.progress != nullptr)
+                sd.progress->Progress(obj);
 //          if (sd.streams[ALL_STREAM].get() != nullptr)
 //              Message2Console::Progress(obj, sd.streams[ALL_STREAM]);
             break;
@@ -119,6 +125,8 @@ void RenderMessageHandler::HandleMessage(const SceneData& sd, const ViewData&, P
                 Message2Console::FatalError(obj, sd.streams[FATAL_STREAM].get());
             if (sd.streams[ALL_STREAM].get() != nullptr)
                 Message2Console::FatalError(obj, sd.streams[ALL_STREAM].get());
+            if (sd.progress != nullptr)
+                sd.progress->FatalError();
             break;
     }
 }
@@ -176,7 +184,10 @@ void RenderMessageHandler::Progress(Console *console, POVMS_Object& obj, bool ve
                 percent = (pc * 100) / pt;
 
             sstr << Message2Console::GetProgressTime(obj, kPOVAttrib_RealTime)
-                 << "Rendering completed " << pc << " of " << pt << " pixels (" << percent << "%) and " << pp << " pixels pending    \r";
+                 << "Rendering completed " << pc << " of " << pt << " pixels (" << percent << "%) and " << pp << " pixels pending";
+            if (obj.Exist(kPOVAttrib_CurrentMemoryUsage))
+                sstr << ", " << (obj.GetLong(kPOVAttrib_CurrentMemoryUsage) / (POVMSLong)(1048576)) << " MB";
+            sstr << "    \r";
             break;
         }
     }
@@ -0,0 +1,306 @@
+//******************************************************************************
+///
+/// @file frontend/resultsfile.cpp
+///
+/// Machine-readable render performance results and live progress.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+// Unit header file must be the first file included within POV-Ray *.cpp files (pulls in config)
+#include "frontend/resultsfile.h"
+
+// C++ variants of C standard header files
+//  (none at the moment)
+
+// C++ standard header files
+#include <algorithm>
+#include <chrono>
+#include <memory>
+
+// POV-Ray header files (base module)
+#include "base/fileinputoutput.h"
+#include "base/version.h"
+
+// POV-Ray header files (POVMS module)
+#include "povms/povmsid.h"
+
+// this must be the last file included
+#include "base/povdebug.h"
+
+namespace pov_frontend
+{
+
+using namespace pov_base;
+
+/// Name of the results file format.
+static const char *kResultsSchema = "povray-results";
+
+/// Version of the results file format.
+static const int kResultsSchemaVersion = 1;
+
+/// Name of the progress file format.
+static const char *kProgressSchema = "povray-progress";
+
+/// Version of the progress file format.
+static const int kProgressSchemaVersion = 1;
+
+/// Minimum interval between updates of the progress file.
+static const std::chrono::milliseconds kProgressFileInterval(1000);
+
+/// Names of the phases in the progress file, in the order of @ref ProgressFile::Phase.
+static const char *kProgressPhaseNames[] =
+{
+    "starting",
+    "parsing",
+    "bounding",
+    "photons",
+    "radiosity",
+    "rendering",
+    "done",
+    "failed",
+};
+
+/// Quote a string for use in JSON.
+static std::string JSONString(const std::string& str)
+{
+    std::string result("\"");
+    for (char c : str)
+    {
+        if ((c == '"') || (c == '\\'))
+        {
+            result += '\\';
+            result += c;
+        }
+        else if ((unsigned char)c < 0x20)
+            result += ' ';
+        else
+            result += c;
+    }
+    return result + "\"";
+}
+
+/// Get the wall-clock time of a phase in seconds, and update the number of threads used.
+static double PhaseSeconds(POVMS_Object& obj, POVMSType key, int& threads)
+{
+    if (!obj.Exist(key))
+        return 0.0;
+
+    POVMS_Object time;
+    obj.Get(key, time);
+    threads = std::max(threads, int(time.TryGetInt(kPOVAttrib_TimeSamples, 1)));
+    return time.TryGetLong(kPOVAttrib_RealTime, 0) * 1.0e-3;
+}
+
+/// Get the time between the first and the last thread of a phase finishing, in seconds.
+static double PhaseTailSeconds(POVMS_Object& obj, POVMSType key)
+{
+    if (!obj.Exist(key))
+        return 0.0;
+
+    POVMS_Object time;
+    obj.Get(key, time);
+    return time.TryGetLong(kPOVAttrib_TailTime, 0) * 1.0e-3;
+}
+
+ResultsFile::ResultsFile(const Path& fn, const std::string& sn) :
+    filename(fn),
+    scene(sn),
+    parseSeconds(0.0),
+    boundingSeconds(0.0)
+{}
+
+void ResultsFile::ParserStatistics(POVMS_Object& obj)
+{
+    int threads = 0;
+    parseSeconds    = PhaseSeconds(obj, kPOVAttrib_ParseTime, threads);
+    boundingSeconds = PhaseSeconds(obj, kPOVAttrib_BoundingTime, threads);
+}
+
+void ResultsFile::RenderStatistics(POVMS_Object& obj)
+{
+    int threads = 0;
+    double photonSeconds    = PhaseSeconds(obj, kPOVAttrib_PhotonTime, threads);
+    double radiositySeconds = PhaseSeconds(obj, kPOVAttrib_RadiosityTime, threads);
+    double traceSeconds     = PhaseSeconds(obj, kPOVAttrib_TraceTime, threads);
+    double totalSeconds     = parseSeconds + boundingSeconds + photonSeconds + radiositySeconds + traceSeconds;
+    double photonSortSeconds    = (obj.TryGetLong(kPOVAttrib_SurfacePhotonBuildTime, 0) +
+                                   obj.TryGetLong(kPOVAttrib_MediaPhotonBuildTime, 0)) * 1.0e-3;
+    double radiosityTailSeconds = PhaseTailSeconds(obj, kPOVAttrib_RadiosityTime);
+    double traceTailSeconds     = PhaseTailSeconds(obj, kPOVAttrib_TraceTime);
+
+    POV_LONG pixels = obj.TryGetLong(kPOVAttrib_Pixels, 0);
+    POV_LONG samples = obj.TryGetLong(kPOVAttrib_PixelSamples, 0);
+    POV_LONG rays = obj.TryGetLong(kPOVAttrib_Rays, 0);
+    POV_LONG peakMemory = obj.TryGetLong(kPOVAttrib_PeakMemoryUsage, 0);
+
+    // failing to write the results is not an error, as it does not affect the render
+    std::unique_ptr<OStream> os(NewOStream(filename, POV_File_Text_User, true));
+    if (os != nullptr)
+    {
+        os->printf("{\"schema\":\"%s\",\"schema_version\":%d,\"version\":%s,\"scene\":%s,\"width\":%d,\"height\":%d,\"threads\":%d,",
+                   kResultsSchema, kResultsSchemaVersion, JSONString(POV_RAY_FULL_VERSION).c_str(), JSONString(scene).c_str(),
+                   int(obj.TryGetInt(kPOVAttrib_Width, 0)), int(obj.TryGetInt(kPOVAttrib_Height, 0)), threads);
+        os->printf("\"cpu\":%s,\"noise_generator\":%s,",
+                   JSONString(obj.TryGetString(kPOVAttrib_CPUInfo, "")).c_str(),
+                   JSONString(obj.TryGetString(kPOVAttrib_NoiseGenerator, "")).c_str());
+        os->printf("\"parse_seconds\":%.3f,\"bounding_seconds\":%.3f,\"photon_seconds\":%.3f,\"radiosity_seconds\":%.3f,\"trace_seconds\":%.3f,\"total_seconds\":%.3f,",
+                   parseSeconds, boundingSeconds, photonSeconds, radiositySeconds, traceSeconds, totalSeconds);
+        os->printf("\"block_size\":%d,\"photon_sort_seconds\":%.3f,\"radiosity_tail_seconds\":%.3f,\"trace_tail_seconds\":%.3f,",
+                   int(obj.TryGetInt(kPOVAttrib_RenderBlockSize, 0)), photonSortSeconds, radiosityTailSeconds, traceTailSeconds);
+        os->printf("\"pixels\":%.0f,\"samples\":%.0f,\"rays\":%.0f,\"pixels_per_second\":%.1f,\"rays_per_second\":%.1f,\"peak_memory_bytes\":%.0f}\n",
+                   double(pixels), double(samples), double(rays),
+                   (traceSeconds > 0.0 ? pixels / traceSeconds : 0.0), (traceSeconds > 0.0 ? rays / traceSeconds : 0.0),
+                   double(peakMemory));
+    }
+
+    // the next frame of an animation is parsed anew
+    parseSeconds = 0.0;
+    boundingSeconds = 0.0;
+}
+
+ProgressFile::ProgressFile(const Path& fn, const std::string& sn) :
+    filename(fn),
+    scene(sn),
+    phase(kPhase_Starting),
+    frame(1),
+    frameStart(Clock::now()),
+    phaseStart(frameStart),
+    lastWrite(frameStart),
+    written(false),
+    done(0),
+    total(0),
+    pending(0),
+    memory(0)
+{}
+
+void ProgressFile::Progress(POVMS_Object& obj)
+{
+    Phase newPhase;
+
+    switch (obj.GetType(kPOVMSObjectClassID))
+    {
+        case kPOVObjectClass_ParserProgress:
+            newPhase = kPhase_Parsing;
+            done = obj.TryGetLong(kPOVAttrib_CurrentTokenCount, 0);
+            total = pending = 0;
+            break;
+        case kPOVObjectClass_BoundingProgress:
+            newPhase = kPhase_Bounding;
+            done = obj.TryGetLong(kPOVAttrib_CurrentNodeCount, 0);
+            total = pending = 0;
+            break;
+        case kPOVObjectClass_PhotonProgress:
+            newPhase = kPhase_Photons;
+            done = obj.TryGetInt(kPOVAttrib_CurrentPhotonCount, 0);
+            total = pending = 0;
+            break;
+        case kPOVObjectClass_RadiosityProgress:
+            newPhase = kPhase_Radiosity;
+            done = obj.TryGetInt(kPOVAttrib_PixelsCompleted, 0);
+            total = obj.TryGetInt(kPOVAttrib_Pixels, 0);
+            pending = 0;
+            break;
+        case kPOVObjectClass_RenderProgress:
+            newPhase = kPhase_Rendering;
+            done = obj.TryGetInt(kPOVAttrib_PixelsCompleted, 0);
+            total = obj.TryGetInt(kPOVAttrib_Pixels, 0);
+            pending = obj.TryGetInt(kPOVAttrib_PixelsPending, 0);
+            break;
+        default:
+            return;
+    }
+
+    memory = obj.TryGetLong(kPOVAttrib_CurrentMemoryUsage, memory);
+
+    if (newPhase != phase)
+    {
+        // the first progress message of a frame follows the statistics of the previous one
+        if (phase == kPhase_Done)
+        {
+            frame++;
+            frameStart = Clock::now();
+        }
+        phase = newPhase;
+        phaseStart = Clock::now();
+        Write(true);
+    }
+    else
+        Write(false);
+}
+
+void ProgressFile::RenderStatistics(POVMS_Object& obj)
+{
+    phase = kPhase_Done;
+    done = total = obj.TryGetLong(kPOVAttrib_Pixels, total);
+    pending = 0;
+    phaseStart = Clock::now();
+    Write(true);
+}
+
+void ProgressFile::FatalError()
+{
+    phase = kPhase_Failed;
+    phaseStart = Clock::now();
+    Write(true);
+}
+
+void ProgressFile::Write(bool force)
+{
+    Clock::time_point now = Clock::now();
+
+    if (!force && written && (now - lastWrite < kProgressFileInterval))
+        return;
+
+    double elapsedSeconds = std::chrono::duration<double>(now - frameStart).count();
+    double phaseSeconds = std::chrono::duration<double>(now - phaseStart).count();
+    double rate = (phaseSeconds > 0.0) ? done / phaseSeconds : 0.0;
+    double updated = std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+    // failing to write the progress is not an error, as it does not affect the render
+    std::unique_ptr<OStream> os(NewOStream(filename, POV_File_Text_User, false));
+    if (os != nullptr)
+    {
+        os->printf("{\"schema\":\"%s\",\"schema_version\":%d,\"scene\":%s,\"frame\":%d,\"phase\":\"%s\",",
+                   kProgressSchema, kProgressSchemaVersion, JSONString(scene).c_str(), frame, kProgressPhaseNames[phase]);
+        os->printf("\"elapsed_seconds\":%.3f,\"phase_seconds\":%.3f,\"done\":%.0f,\"total\":%.0f,\"pending\":%.0f,\"per_second\":%.1f,",
+                   elapsedSeconds, phaseSeconds, double(done), double(total), double(pending), rate);
+        if ((total > 0) && (done > 0) && (done < total))
+            os->printf("\"eta_seconds\":%.1f,", phaseSeconds * (total - done) / done);
+        else
+            os->printf("\"eta_seconds\":null,");
+        os->printf("\"memory_bytes\":%.0f,\"updated\":%.3f}\n", double(memory), updated);
+    }
+
+    lastWrite = now;
+    written = true;
+}
+
+}
+// end of namespace pov_frontend
@@ -0,0 +1,151 @@
+//******************************************************************************
+///
+/// @file frontend/resultsfile.h
+///
+/// Machine-readable render performance results and live progress.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+#ifndef POVRAY_FRONTEND_RESULTSFILE_H
+#define POVRAY_FRONTEND_RESULTSFILE_H
+
+// Module config header file must be the first file included within POV-Ray unit header files
+#include "frontend/configfrontend.h"
+
+// C++ variants of C standard header files
+//  (none at the moment)
+
+// C++ standard header files
+#include <chrono>
+#include <string>
+
+// POV-Ray header files (base module)
+#include "base/path.h"
+
+// POV-Ray header files (POVMS module)
+#include "povms/povmscpp.h"
+
+namespace pov_frontend
+{
+
+/// Machine-readable record of render performance.
+///
+/// For each frame rendered, a single line of JSON is appended to the results file, holding the
+/// wall-clock time of each phase, the pixel and ray throughput, the peak memory use, the number
+/// of render threads, the block size and the CPU features the backend is using. The time the
+/// photon maps took to sort and the time the render threads spent waiting for the slowest one
+/// at the end of the radiosity pretrace and the trace are recorded as well. One object per line
+/// keeps the file appendable across runs, so that repeated runs of the same scene can be compared
+/// statistically (see `scripts/compare_results.sh`), or runs with different thread counts can be
+/// compared for scaling (see `scripts/scaling_report.sh`).
+///
+/// The format carries a schema name and version; fields may be added without changing the
+/// version, but never removed or changed in meaning.
+///
+class ResultsFile final
+{
+    public:
+        ResultsFile(const pov_base::Path& filename, const std::string& scene);
+
+        /// Record the parse and bounding times of the current frame.
+        void ParserStatistics(POVMS_Object& obj);
+
+        /// Append the record of the current frame to the results file.
+        void RenderStatistics(POVMS_Object& obj);
+
+    private:
+
+        pov_base::Path filename;
+        std::string scene;
+        double parseSeconds;
+        double boundingSeconds;
+};
+
+/// Machine-readable live progress of a render.
+///
+/// The progress file is rewritten at most once per second from the progress messages the
+/// backend sends anyway, holding a single JSON object with the current phase, the work done in
+/// that phase, the pixel throughput, an estimate of the time remaining and the memory in use.
+/// A render farm manager can poll the file to spot stalled or slow jobs: the `updated` field
+/// holds the time of the last update, in seconds since the Unix epoch.
+///
+/// As the file is overwritten in place, a reader may occasionally see it incomplete, and should
+/// simply try again.
+///
+class ProgressFile final
+{
+    public:
+        ProgressFile(const pov_base::Path& filename, const std::string& scene);
+
+        /// Update the progress from a parser or render progress message.
+        void Progress(POVMS_Object& obj);
+
+        /// Mark the current frame as completed.
+        void RenderStatistics(POVMS_Object& obj);
+
+        /// Mark the current frame as failed.
+        void FatalError();
+
+    private:
+
+        typedef std::chrono::steady_clock Clock;
+
+        enum Phase
+        {
+            kPhase_Starting,
+            kPhase_Parsing,
+            kPhase_Bounding,
+            kPhase_Photons,
+            kPhase_Radiosity,
+            kPhase_Rendering,
+            kPhase_Done,
+            kPhase_Failed,
+        };
+
+        pov_base::Path filename;
+        std::string scene;
+        Phase phase;
+        int frame;
+        Clock::time_point frameStart;
+        Clock::time_point phaseStart;
+        Clock::time_point lastWrite;
+        bool written;
+        POV_LONG done;
+        POV_LONG total;
+        POV_LONG pending;
+        POV_LONG memory;
+
+        void Write(bool force);
+};
+
+}
+// end of namespace pov_frontend
+
+#endif // POVRAY_FRONTEND_RESULTSFILE_H
@@ -59,7 +59,7 @@
 #endif
 
 /// @def POV_PARSER_EXPERIMENTAL_OBJ_IMPORT
-/// Whether experimental Wavefront OBJ import should be enabled.
+/// Whether experimental Wavefront OBJ and PLY import should be enabled.
 ///
 #ifndef POV_PARSER_EXPERIMENTAL_OBJ_IMPORT
     #define POV_PARSER_EXPERIMENTAL_OBJ_IMPORT 0
@@ -72,6 +72,25 @@
     #define POV_PARSER_MAX_CACHED_MACRO_SIZE 65536
 #endif
 
+/// @def POV_PARSER_TOKEN_CACHE_SIZE
+/// Approximate memory limit in bytes for the process-wide cache of pre-scanned input files.
+///
+/// Define as zero to disable the cache.
+///
+#ifndef POV_PARSER_TOKEN_CACHE_SIZE
+    #define POV_PARSER_TOKEN_CACHE_SIZE (256*1024*1024)
+#endif
+
+/// @def POV_PARSER_DECLARATION_CACHE_SIZE
+/// Maximum number of evaluated declarations to keep in the process-wide cache used by the
+/// `Reuse_Declarations` option.
+///
+/// Define as zero to disable the cache.
+///
+#ifndef POV_PARSER_DECLARATION_CACHE_SIZE
+    #define POV_PARSER_DECLARATION_CACHE_SIZE 65536
+#endif
+
 //******************************************************************************
 ///
 /// @name Debug Settings.
@@ -0,0 +1,337 @@
+//******************************************************************************
+///
+/// @file parser/declarationcache.cpp
+///
+/// Implementation of the process-wide cache of evaluated declarations.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+// Unit header file must be the first file included within POV-Ray *.cpp files (pulls in config)
+#include "parser/declarationcache.h"
+
+// C++ variants of C standard header files
+//  (none at the moment)
+
+// C++ standard header files
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+// POV-Ray header files (base module)
+//  (none at the moment)
+
+// POV-Ray header files (core module)
+//  (none at the moment)
+
+// POV-Ray header files (parser module)
+#include "parser/symboltable.h"
+
+// this must be the last file included
+#include "base/povdebug.h"
+
+namespace pov_parser
+{
+
+//******************************************************************************
+
+DeclarationResult::DeclarationResult() :
+    type(NOT_A_TOKEN),
+    data(nullptr),
+    fingerprint(0),
+    end{ 0, 0, 0 },
+    tokenCount(0),
+    experimentalFlags(0)
+{}
+
+DeclarationResult::DeclarationResult(const DeclarationResult& o) :
+    reads(o.reads),
+    effects(o.effects),
+    type(o.type),
+    data(SymbolTable::Copy_Identifier(o.data, o.type)),
+    fingerprint(o.fingerprint),
+    end(o.end),
+    tokenCount(o.tokenCount),
+    experimentalFlags(o.experimentalFlags)
+{
+    for (auto& effect : effects)
+        effect.data = SymbolTable::Copy_Identifier(effect.data, effect.type);
+}
+
+DeclarationResult::DeclarationResult(DeclarationResult&& o) :
+    reads(std::move(o.reads)),
+    effects(std::move(o.effects)),
+    type(o.type),
+    data(o.data),
+    fingerprint(o.fingerprint),
+    end(o.end),
+    tokenCount(o.tokenCount),
+    experimentalFlags(o.experimentalFlags)
+{
+    o.effects.clear();
+    o.data = nullptr;
+}
+
+DeclarationResult::~DeclarationResult()
+{
+    Clear();
+}
+
+DeclarationResult& DeclarationResult::operator=(DeclarationResult o)
+{
+    std::swap(reads, o.reads);
+    std::swap(effects, o.effects);
+    std::swap(type, o.type);
+    std::swap(data, o.data);
+    fingerprint = o.fingerprint;
+    end = o.end;
+    tokenCount = o.tokenCount;
+    experimentalFlags = o.experimentalFlags;
+    return *this;
+}
+
+void DeclarationResult::Clear()
+{
+    for (auto& effect : effects)
+        SymbolTable::Destroy_Ident_Data(effect.data, effect.type);
+    effects.clear();
+    reads.clear();
+    if (data != nullptr)
+        SymbolTable::Destroy_Ident_Data(data, type);
+    data = nullptr;
+    type = NOT_A_TOKEN;
+}
+
+//******************************************************************************
+
+POV_UINT64 HashDeclarationReads(const std::vector<DeclarationRead>& reads)
+{
+    POV_UINT64 hash = kDeclarationHashSeed;
+    for (auto& read : reads)
+        hash = HashDeclarationValue(hash, read.fingerprint);
+    return hash;
+}
+
+//******************************************************************************
+
+/// Process-wide cache of evaluated declarations.
+///
+/// Declarations are identified by the position of their right-hand side in the cached tokens
+/// of an input file, together with the global settings in effect. For each declaration, the
+/// cache keeps the outcomes of previous evaluations, grouped by the set of symbols each
+/// evaluation depended on, and indexed by the combined fingerprints of those symbols' values.
+///
+struct DeclarationCache final
+{
+    using ResultPtr = std::shared_ptr<const DeclarationResult>;
+
+    /// Outcomes depending on one particular set of symbols.
+    struct ReadSet final
+    {
+        std::vector<DeclarationRead>                    reads;      ///< Dependencies; fingerprints are not used.
+        std::unordered_map<POV_UINT64, ResultPtr>       results;    ///< Outcomes by combined fingerprint.
+    };
+
+    /// Outcomes of one particular declaration.
+    struct Entry final
+    {
+        DeclarationKey          key;
+        std::vector<ReadSet>    readSets;
+        std::size_t             resultCount;
+    };
+
+    std::mutex                                              mutex;
+    std::list<Entry>                                        entries;    ///< Most recently used first.
+    std::unordered_map<POV_UINT64, std::list<Entry>::iterator> index;
+    std::size_t                                             resultCount;
+
+    DeclarationCache() : resultCount(0) {}
+
+    static POV_UINT64 HashKey(const DeclarationKey& key);
+    static bool SameKey(const DeclarationKey& a, const DeclarationKey& b);
+    static bool SameReads(const std::vector<DeclarationRead>& a, const std::vector<DeclarationRead>& b);
+
+    bool Find(const DeclarationKey& key, const DeclarationReadFingerprinter& fingerprinter, DeclarationResult& result);
+    void Insert(const DeclarationKey& key, const DeclarationResult& result);
+};
+
+/// The cache is intentionally never destroyed, as the values it holds may reference resources
+/// that are already gone during static de-initialization.
+static DeclarationCache& gDeclarationCache = *(new DeclarationCache);
+
+POV_UINT64 DeclarationCache::HashKey(const DeclarationKey& key)
+{
+    POV_UINT64 hash = kDeclarationHashSeed;
+    hash = HashDeclarationValue(hash, key.position.hash);
+    hash = HashDeclarationValue(hash, key.position.size);
+    hash = HashDeclarationValue(hash, key.position.index);
+    hash = HashDeclarationValue(hash, key.environment);
+    return hash;
+}
+
+bool DeclarationCache::SameKey(const DeclarationKey& a, const DeclarationKey& b)
+{
+    return (a.position.hash  == b.position.hash)  &&
+           (a.position.size  == b.position.size)  &&
+           (a.position.index == b.position.index) &&
+           (a.environment    == b.environment);
+}
+
+bool DeclarationCache::SameReads(const std::vector<DeclarationRead>& a, const std::vector<DeclarationRead>& b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (std::size_t i = 0; i < a.size(); ++i)
+    {
+        if ((a[i].kind != b[i].kind) || (a[i].name != b[i].name))
+            return false;
+    }
+    return true;
+}
+
+bool DeclarationCache::Find(const DeclarationKey& key, const DeclarationReadFingerprinter& fingerprinter,
+                            DeclarationResult& result)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto iIndex = index.find(HashKey(key));
+    if ((iIndex == index.end()) || !SameKey(iIndex->second->key, key))
+        return false;
+
+    auto iEntry = iIndex->second;
+    entries.splice(entries.begin(), entries, iEntry);
+
+    for (auto& readSet : iEntry->readSets)
+    {
+        POV_UINT64 hash = kDeclarationHashSeed;
+        bool ok = true;
+        for (auto& read : readSet.reads)
+        {
+            POV_UINT64 fingerprint;
+            if (!fingerprinter(read, fingerprint))
+            {
+                ok = false;
+                break;
+            }
+            hash = HashDeclarationValue(hash, fingerprint);
+        }
+        if (!ok)
+            continue;
+
+        auto iResult = readSet.results.find(hash);
+        if (iResult != readSet.results.end())
+        {
+            // Copy while holding the lock, so that the cached values are never accessed concurrently.
+            result = *iResult->second;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void DeclarationCache::Insert(const DeclarationKey& key, const DeclarationResult& result)
+{
+    ResultPtr pResult = std::make_shared<DeclarationResult>(result);
+    POV_UINT64 readsHash = HashDeclarationReads(result.reads);
+    POV_UINT64 keyHash = HashKey(key);
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto iIndex = index.find(keyHash);
+    if ((iIndex != index.end()) && !SameKey(iIndex->second->key, key))
+    {
+        // Hash collision; the newer declaration wins.
+        resultCount -= iIndex->second->resultCount;
+        entries.erase(iIndex->second);
+        index.erase(iIndex);
+        iIndex = index.end();
+    }
+
+    if (iIndex == index.end())
+    {
+        entries.push_front(Entry{ key, {}, 0 });
+        iIndex = index.emplace(keyHash, entries.begin()).first;
+    }
+    else
+        entries.splice(entries.begin(), entries, iIndex->second);
+
+    Entry& entry = *iIndex->second;
+    ReadSet* pReadSet = nullptr;
+    for (auto& readSet : entry.readSets)
+    {
+        if (SameReads(readSet.reads, result.reads))
+        {
+            pReadSet = &readSet;
+            break;
+        }
+    }
+    if (pReadSet == nullptr)
+    {
+        entry.readSets.push_back(ReadSet{ result.reads, {} });
+        pReadSet = &entry.readSets.back();
+    }
+
+    if (pReadSet->results.emplace(readsHash, pResult).second)
+    {
+        ++entry.resultCount;
+        ++resultCount;
+    }
+
+    // Evict least recently used declarations, but never the one just inserted.
+    while ((resultCount > POV_PARSER_DECLARATION_CACHE_SIZE) && (entries.size() > 1))
+    {
+        Entry& victim = entries.back();
+        resultCount -= victim.resultCount;
+        index.erase(HashKey(victim.key));
+        entries.pop_back();
+    }
+}
+
+//******************************************************************************
+
+bool FindCachedDeclaration(const DeclarationKey& key, const DeclarationReadFingerprinter& fingerprinter,
+                           DeclarationResult& result)
+{
+    if (POV_PARSER_DECLARATION_CACHE_SIZE == 0)
+        return false;
+    return gDeclarationCache.Find(key, fingerprinter, result);
+}
+
+void CacheDeclaration(const DeclarationKey& key, const DeclarationResult& result)
+{
+    if (POV_PARSER_DECLARATION_CACHE_SIZE == 0)
+        return;
+    gDeclarationCache.Insert(key, result);
+}
+
+}
+// end of namespace pov_parser
@@ -0,0 +1,164 @@
+//******************************************************************************
+///
+/// @file parser/declarationcache.h
+///
+/// Declarations for the process-wide cache of evaluated declarations.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+#ifndef POVRAY_PARSER_DECLARATIONCACHE_H
+#define POVRAY_PARSER_DECLARATIONCACHE_H
+
+// Module config header file must be the first file included within POV-Ray unit header files
+#include "parser/configparser.h"
+
+// C++ variants of C standard header files
+#include <cstddef>
+
+// C++ standard header files
+#include <functional>
+#include <vector>
+
+// POV-Ray header files (base module)
+#include "base/stringtypes.h"
+
+// POV-Ray header files (core module)
+//  (none at the moment)
+
+// POV-Ray header files (parser module)
+#include "parser/rawtokenizer.h"
+#include "parser/reservedwords.h"
+
+namespace pov_parser
+{
+
+using namespace pov_base;
+
+//------------------------------------------------------------------------------
+
+/// Initial value for declaration fingerprints.
+const POV_UINT64 kDeclarationHashSeed = 0xCBF29CE484222325ull;
+
+/// Mix raw data into a declaration fingerprint.
+inline POV_UINT64 HashDeclarationData(POV_UINT64 hash, const void* data, std::size_t size)
+{
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        hash ^= p[i];
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+/// Mix a plain value into a declaration fingerprint.
+template<typename T>
+inline POV_UINT64 HashDeclarationValue(POV_UINT64 hash, const T& value)
+{
+    return HashDeclarationData(hash, &value, sizeof(T));
+}
+
+/// Dependency of a declaration on a symbol or keyword value.
+struct DeclarationRead final
+{
+    TokenId     kind;           ///< @ref IDENTIFIER_TOKEN for symbols, or the keyword read.
+    UTF8String  name;           ///< Name of the symbol; empty for keywords.
+    POV_UINT64  fingerprint;    ///< Fingerprint of the value found.
+};
+
+/// Symbol assigned by a declaration in addition to its target.
+struct DeclarationEffect final
+{
+    UTF8String  name;           ///< Name of the symbol.
+    bool        global;         ///< Whether the symbol lives in the global rather than the declaration's table.
+    TokenId     type;           ///< Type of the value assigned.
+    void*       data;           ///< Value assigned.
+};
+
+/// Key identifying a declaration.
+struct DeclarationKey final
+{
+    CachedTokenPosition position;       ///< Position of the first token of the right-hand side.
+    POV_UINT64          environment;    ///< Fingerprint of the global settings in effect.
+};
+
+/// Outcome of a declaration.
+///
+/// Instances own the values they reference; copies are deep copies.
+///
+struct DeclarationResult final
+{
+    std::vector<DeclarationRead>    reads;              ///< Values the declaration depends on.
+    std::vector<DeclarationEffect>  effects;            ///< Other symbols assigned.
+    TokenId                         type;               ///< Type of the value declared.
+    void*                           data;               ///< Value declared.
+    POV_UINT64                      fingerprint;        ///< Identity of the value declared.
+    CachedTokenPosition             end;                ///< Position of the first token not consumed.
+    POV_LONG                        tokenCount;         ///< Number of tokens consumed.
+    unsigned int                    experimentalFlags;  ///< Experimental features used.
+
+    DeclarationResult();
+    DeclarationResult(const DeclarationResult& o);
+    DeclarationResult(DeclarationResult&& o);
+    ~DeclarationResult();
+    DeclarationResult& operator=(DeclarationResult o);
+    void Clear();
+};
+
+/// Callback to determine the current fingerprint of a declaration's dependency.
+using DeclarationReadFingerprinter = std::function<bool(const DeclarationRead& read, POV_UINT64& fingerprint)>;
+
+/// Combine the fingerprints of a declaration's dependencies.
+POV_UINT64 HashDeclarationReads(const std::vector<DeclarationRead>& reads);
+
+/// Find a declaration in the process-wide cache.
+///
+/// A cached outcome matches if the current fingerprints of all its dependencies, as reported by
+/// `fingerprinter`, match those found when it was evaluated.
+///
+/// @param[in]  key             Declaration to look for.
+/// @param[in]  fingerprinter   Callback to determine the current fingerprint of a dependency.
+/// @param[out] result          Copy of the cached outcome.
+/// @return `true` if a matching outcome was found.
+///
+bool FindCachedDeclaration(const DeclarationKey& key, const DeclarationReadFingerprinter& fingerprinter,
+                           DeclarationResult& result);
+
+/// Store a declaration in the process-wide cache.
+///
+/// @param[in]  key             Declaration evaluated.
+/// @param[in]  result          Outcome of the evaluation; a copy is stored.
+///
+void CacheDeclaration(const DeclarationKey& key, const DeclarationResult& result);
+
+}
+// end of namespace pov_parser
+
+#endif // POVRAY_PARSER_DECLARATIONCACHE_H
@@ -39,6 +39,7 @@
 #include "parser/fncode.h"
 
 // C++ variants of C standard header files
+#include <cmath>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
@@ -72,6 +73,254 @@ using std::max;
 
 using namespace pov;
 
+/*****************************************************************************
+* Local functions
+******************************************************************************/
+
+// Estimate the cost of evaluating an expression, or return -1 if the
+// expression cannot be evaluated once and then be reused.
+static int expr_cost(const ExprNode *expr)
+{
+    int cost = 0;
+
+    for(const ExprNode *i = expr; i != nullptr; i = i->next)
+    {
+        switch(i->op)
+        {
+            case OP_LEFTMOST:
+            case OP_FIRST:
+            case OP_CONSTANT:
+            case OP_VARIABLE:
+                break;
+            case OP_CALL:
+                if((i->call.token == SUM_TOKEN) || (i->call.token == PROD_TOKEN) || (i->call.token == VECTFUNCT_ID_TOKEN))
+                    return -1;
+                cost += 4;
+                break;
+            default:
+                if((i->op < OP_CMP_EQ) || (i->op > OP_NEG))
+                    return -1;
+                cost++;
+                break;
+        }
+
+        if(i->child != nullptr)
+        {
+            int child_cost = expr_cost(i->child);
+
+            if(child_cost < 0)
+                return -1;
+            cost += child_cost;
+        }
+    }
+
+    return cost;
+}
+
+static unsigned int expr_hash(const ExprNode *expr)
+{
+    unsigned int hash = 0;
+
+    for(const ExprNode *i = expr; i != nullptr; i = i->next)
+    {
+        hash = hash * 31 + (unsigned int)(i->op);
+
+        switch(i->op)
+        {
+            case OP_CONSTANT:
+                {
+                    unsigned char bytes[sizeof(DBL)];
+                    std::memcpy(bytes, &i->number, sizeof(DBL));
+                    for(std::size_t b = 0; b < sizeof(DBL); b++)
+                        hash = hash * 31 + bytes[b];
+                }
+                break;
+            case OP_VARIABLE:
+            case OP_MEMBER:
+                for(const char *c = i->variable; *c != '\0'; c++)
+                    hash = hash * 31 + (unsigned char)(*c);
+                break;
+            case OP_CALL:
+                hash = hash * 31 + (unsigned int)(i->call.token);
+                hash = hash * 31 + (unsigned int)(i->call.fn);
+                break;
+        }
+
+        if(i->child != nullptr)
+            hash = hash * 31 + expr_hash(i->child);
+    }
+
+    return hash;
+}
+
+static bool expr_equal(const ExprNode *a, const ExprNode *b)
+{
+    for(; (a != nullptr) && (b != nullptr); a = a->next, b = b->next)
+    {
+        if(a->op != b->op)
+            return false;
+
+        switch(a->op)
+        {
+            case OP_CONSTANT:
+                if(std::memcmp(&a->number, &b->number, sizeof(DBL)) != 0)
+                    return false;
+                break;
+            case OP_VARIABLE:
+            case OP_MEMBER:
+                if(strcmp(a->variable, b->variable) != 0)
+                    return false;
+                break;
+            case OP_CALL:
+                if((a->call.token != b->call.token) || (a->call.fn != b->call.fn) || (strcmp(a->call.name, b->call.name) != 0))
+                    return false;
+                break;
+            case OP_TRAP:
+                if(a->trap != b->trap)
+                    return false;
+                break;
+        }
+
+        if(expr_equal(a->child, b->child) == false)
+            return false;
+    }
+
+    return (a == b);
+}
+
+const unsigned int INSTRUCTION_PURE   = 1; // may be removed if the results are not used
+const unsigned int INSTRUCTION_BRANCH = 2; // conditional branch to k
+const unsigned int INSTRUCTION_JUMP   = 4; // unconditional jump to k
+const unsigned int INSTRUCTION_RETURN = 8;
+const unsigned int INSTRUCTION_CALL   = 16;
+
+const unsigned int REGISTER_CCR = (1 << 8);
+
+// Determine the registers read and written by an instruction (bits 0 to 7
+// for r0 to r7, bit 8 for the condition code register) and its properties.
+// Returns false for instructions the optimiser does not understand.
+static bool decode_instruction(Instruction instr, unsigned int& uses, unsigned int& defs, unsigned int& flags)
+{
+    unsigned int op = GET_OP(instr);
+    unsigned int s = (op >> 3) & 7;
+    unsigned int d = op & 7;
+
+    uses = 0;
+    defs = 0;
+    flags = 0;
+
+    switch(op >> 6)
+    {
+        case 0: // add, sub, mul, div, mod
+        case 1:
+        case 2:
+        case 3:
+        case 4:
+            uses = (1 << s) | (1 << d);
+            defs = (1 << d);
+            flags = INSTRUCTION_PURE;
+            return true;
+        case 5: // move
+        case 7: // neg
+        case 8: // abs
+            uses = (1 << s);
+            defs = (1 << d);
+            flags = INSTRUCTION_PURE;
+            return true;
+        case 6: // cmp
+            uses = (1 << s) | (1 << d);
+            defs = REGISTER_CCR;
+            flags = INSTRUCTION_PURE;
+            return true;
+        case 9: // addi, subi, muli, divi, modi, loadi, cmpi
+            if(s <= 4)
+            {
+                uses = (1 << d);
+                defs = (1 << d);
+            }
+            else if(s == 5)
+                defs = (1 << d);
+            else if(s == 6)
+            {
+                uses = (1 << d);
+                defs = REGISTER_CCR;
+            }
+            else
+                return false;
+            flags = INSTRUCTION_PURE;
+            return true;
+        case 10: // seq, sne, slt, sle, sgt, sge, teq, tne
+            if(s <= 5)
+                uses = REGISTER_CCR;
+            else
+                uses = (1 << d);
+            defs = (1 << d);
+            flags = INSTRUCTION_PURE;
+            return true;
+        case 11: // load
+            if(s > 1)
+                return false;
+            defs = (1 << d);
+            flags = INSTRUCTION_PURE;
+            return true;
+        case 12: // store
+            if(s > 1)
+                return false;
+            uses = (1 << d);
+            return true;
+        case 13: // beq, bne, blt, ble, bgt, bge
+            if(s > 5)
+                return false;
+            uses = REGISTER_CCR;
+            flags = INSTRUCTION_BRANCH;
+            return true;
+        case 14: // xeq, xne, xlt, xle, xgt, xge, xdz
+            if(s <= 5)
+                uses = (1 << d);
+            else if(s == 6)
+                uses = 1 | (1 << d);
+            else
+                return false;
+            return true;
+        case 15:
+            switch(op)
+            {
+                case OPCODE_JMP:
+                    flags = INSTRUCTION_JUMP;
+                    return true;
+                case OPCODE_RTS:
+                    // the caller only uses the result register r0
+                    uses = 1;
+                    flags = INSTRUCTION_RETURN;
+                    return true;
+                case OPCODE_CALL:
+                    flags = INSTRUCTION_CALL;
+                    return true;
+                case OPCODE_SYS1:
+                    uses = 1;
+                    defs = 1;
+                    flags = INSTRUCTION_PURE;
+                    return true;
+                case OPCODE_SYS2:
+                    uses = 1 | 2;
+                    defs = 1;
+                    flags = INSTRUCTION_PURE;
+                    return true;
+                case OPCODE_GROW:
+                case OPCODE_PUSH:
+                case OPCODE_POP:
+                    return true;
+                case OPCODE_NOP:
+                    flags = INSTRUCTION_PURE;
+                    return true;
+            }
+            return false;
+    }
+
+    return false;
+}
+
+
 /*****************************************************************************
 *
 * FUNCTION
@@ -115,6 +364,7 @@ FNCode::FNCode(Parser *pa, FunctionCode *f, bool is_local, const char *n)
     max_stack_size = 0;
     stack_pointer = 0;
     parameter_stack_pointer = 0;
+    cse_base = 0;
 
     parser = pa;
     functionVM = parser->GetFunctionVM();
@@ -320,9 +570,15 @@ void FNCode::Compile(ExprNode *expression)
         max_stack_size = function->parameter_cnt;
         stack_pointer = function->parameter_cnt;
 
+        // reserve stack locations for common subexpressions
+        cse_prepare(expression);
+
         // compile the expression
         compile_recursive(expression);
 
+        cse_slot.clear();
+        cse_done.clear();
+
         // fill in "grow max_stack_size" now
         compile_instruction(gpos, OPCODE_GROW, 0, 0, max_stack_size);
     }
@@ -330,6 +586,9 @@ void FNCode::Compile(ExprNode *expression)
     // return from function
     compile_instruction(OPCODE_RTS, 0, 0, 0);
 
+    // remove redundant register moves and dead instructions
+    optimise_program();
+
     // set optimal size of program memory
     function->program = reinterpret_cast<Instruction *>(POV_REALLOC(function->program, sizeof(Instruction) * function->program_size, "fn: program"));
 
@@ -356,6 +615,434 @@ void FNCode::Compile(ExprNode *expression)
 }
 
 
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   FNCode::cse_prepare
+*
+* INPUT
+*
+*   expr - expression tree that will be compiled
+*
+* OUTPUT
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Find subexpressions which occur more than once in the unconditionally
+*   evaluated part of the expression tree and assign a stack location to
+*   each of them.  The first occurrence compiled stores its result in that
+*   location, all other occurrences simply load it (see compile_recursive).
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+void FNCode::cse_prepare(ExprNode *expr)
+{
+    std::vector<ExprNode *> candidates;
+    std::multimap<unsigned int, std::vector<ExprNode *> > classes;
+    unsigned int cnt = 0;
+
+    cse_slot.clear();
+    cse_done.clear();
+    cse_base = stack_pointer;
+
+    cse_collect(expr, candidates);
+
+    // group structurally identical subexpressions
+    for(std::vector<ExprNode *>::iterator i = candidates.begin(); i != candidates.end(); i++)
+    {
+        unsigned int hash = expr_hash(*i);
+        std::multimap<unsigned int, std::vector<ExprNode *> >::iterator c = classes.lower_bound(hash);
+
+        for(; (c != classes.end()) && (c->first == hash); c++)
+        {
+            if(expr_equal(c->second.front(), *i) == true)
+                break;
+        }
+
+        if((c != classes.end()) && (c->first == hash))
+            c->second.push_back(*i);
+        else
+            classes.insert(std::make_pair(hash, std::vector<ExprNode *>(1, *i)));
+    }
+
+    for(std::multimap<unsigned int, std::vector<ExprNode *> >::iterator c = classes.begin(); c != classes.end(); c++)
+    {
+        if(c->second.size() < 2)
+            continue;
+
+        for(std::vector<ExprNode *>::iterator i = c->second.begin(); i != c->second.end(); i++)
+            cse_slot[*i] = cnt;
+        cnt++;
+    }
+
+    cse_done.resize(cnt, false);
+    stack_pointer += cnt;
+    max_stack_size = (unsigned int)max((int)stack_pointer, (int)max_stack_size);
+}
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   FNCode::cse_collect
+*
+* INPUT
+*
+*   expr - expression (sub-) tree
+*
+* OUTPUT
+*
+*   candidates - subexpressions worth evaluating only once
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Collect the subexpressions of an expression tree.  Parts which are
+*   evaluated conditionally or repeatedly (the branches of select as well
+*   as sum and prod) are skipped, so the first occurrence compiled is
+*   always executed before any of the others.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+void FNCode::cse_collect(ExprNode *expr, std::vector<ExprNode *>& candidates)
+{
+    if(expr == nullptr)
+        return;
+
+    // a parenthesised expression is the same as its content
+    if(((expr->op != OP_FIRST) || (expr->next != nullptr)) && (expr_cost(expr) >= 2))
+        candidates.push_back(expr);
+
+    for(ExprNode *i = expr; i != nullptr; i = i->next)
+    {
+        if(i->child == nullptr)
+            continue;
+
+        if(i->op == OP_CALL)
+        {
+            switch(i->call.token)
+            {
+                case SELECT_TOKEN:
+                    // only the condition is always evaluated
+                    cse_collect(i->child->child, candidates);
+                    break;
+                case SUM_TOKEN:
+                case PROD_TOKEN:
+                case VECTFUNCT_ID_TOKEN:
+                    break;
+                default:
+                    for(ExprNode *p = i->child; p != nullptr; p = p->next)
+                        cse_collect(p->child, candidates);
+                    break;
+            }
+        }
+        else
+            cse_collect(i->child, candidates);
+    }
+}
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   FNCode::optimise_program
+*
+* INPUT
+*
+* OUTPUT
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Peephole optimiser for the compiled program.  The compiler passes all
+*   intermediate results through r0 and r5, which creates many register
+*   moves that can be removed:
+*
+*     move  rx, r0              op    rx, rd
+*     op    r0, rd      ->      (r0 not used afterwards)
+*
+*     op    rs, r0              op    rs, rd
+*     move  r0, rd      ->      (r0 not used afterwards)
+*
+*   Moves and loads of values already in the destination register as well
+*   as instructions whose results are never used are removed, too.  Unlike
+*   the old peephole code in compile_instruction this takes the branches
+*   into account: register liveness is computed for the whole program and
+*   value tracking starts over at every branch target.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+void FNCode::optimise_program()
+{
+    Instruction *program = function->program;
+    unsigned int size = function->program_size;
+    std::vector<unsigned int> uses(size), defs(size), flags(size), live_in(size), live_out(size);
+    std::vector<bool> target(size + 1, false);
+    std::vector<unsigned int> newpos(size + 1);
+    bool changed = true;
+    bool modified = false;
+
+    for(unsigned int i = 0; i < size; i++)
+    {
+        // leave programs with unknown instructions alone
+        if(decode_instruction(program[i], uses[i], defs[i], flags[i]) == false)
+            return;
+        if((flags[i] & (INSTRUCTION_BRANCH | INSTRUCTION_JUMP)) != 0)
+        {
+            if(GET_K(program[i]) > size)
+                return;
+            target[GET_K(program[i])] = true;
+        }
+    }
+
+    for(int pass = 0; (pass < 8) && (changed == true); pass++)
+    {
+        std::map<unsigned int, unsigned int> const_value;
+        std::map<unsigned int, unsigned int> stack_value;
+        unsigned int reg_value[8];
+        unsigned int next_value = 0;
+
+        changed = false;
+
+        // compute the registers live after each instruction
+        live_in.assign(size, 0);
+        for(bool again = true; again == true; )
+        {
+            again = false;
+            for(unsigned int i = size; i-- > 0; )
+            {
+                unsigned int out = 0;
+                unsigned int in;
+
+                if((flags[i] & INSTRUCTION_RETURN) == 0)
+                {
+                    if(((flags[i] & INSTRUCTION_JUMP) == 0) && (i + 1 < size))
+                        out |= live_in[i + 1];
+                    if(((flags[i] & (INSTRUCTION_BRANCH | INSTRUCTION_JUMP)) != 0) && (GET_K(program[i]) < size))
+                        out |= live_in[GET_K(program[i])];
+                }
+                in = uses[i] | (out & ~defs[i]);
+                live_out[i] = out;
+                if(in != live_in[i])
+                {
+                    live_in[i] = in;
+                    again = true;
+                }
+            }
+        }
+
+        for(unsigned int i = 0; i < size; i++)
+        {
+            unsigned int op = GET_OP(program[i]);
+            unsigned int j;
+
+            // forget all values at branch targets
+            if((target[i] == true) || (i == 0))
+            {
+                for(unsigned int r = 0; r < 8; r++)
+                    reg_value[r] = next_value++;
+                const_value.clear();
+                stack_value.clear();
+            }
+
+            if(op == OPCODE_NOP)
+                continue;
+
+            // remove instructions whose results are never used
+            if(((flags[i] & INSTRUCTION_PURE) != 0) && ((defs[i] & live_out[i]) == 0))
+            {
+                program[i] = MAKE_INSTRUCTION(OPCODE_NOP, 0);
+                decode_instruction(program[i], uses[i], defs[i], flags[i]);
+                changed = true;
+                continue;
+            }
+
+            // find the next instruction, which must not be a branch target
+            for(j = i + 1; (j < size) && (target[j] == false) && (GET_OP(program[j]) == OPCODE_NOP); j++) { }
+
+            if((j < size) && (target[j] == false) && ((op & 0x03C0) == OPCODE_MOVE))
+            {
+                unsigned int a = (op >> 3) & 7;
+                unsigned int b = op & 7;
+                unsigned int next = GET_OP(program[j]);
+                unsigned int s = (next >> 3) & 7;
+                unsigned int d = next & 7;
+                bool forward = false;
+
+                if((a != b) && ((live_out[j] & (1 << b)) == 0))
+                {
+                    switch(next >> 6)
+                    {
+                        case 0: case 1: case 2: case 3: case 4: case 6:
+                            if((s == b) && (d != b))
+                            {
+                                s = a;
+                                forward = true;
+                            }
+                            break;
+                        case 5: case 7: case 8:
+                            if(s == b)
+                            {
+                                s = a;
+                                forward = true;
+                            }
+                            break;
+                        case 12:
+                            if(d == b)
+                            {
+                                d = a;
+                                forward = true;
+                            }
+                            break;
+                        case 14:
+                            if((s <= 5) && (d == b))
+                            {
+                                d = a;
+                                forward = true;
+                            }
+                            break;
+                    }
+                }
+
+                // let the next instruction read the source of the move directly
+                if(forward == true)
+                {
+                    program[j] = MAKE_INSTRUCTION((next & 0x0FC0) | (s << 3) | d, GET_K(program[j]));
+                    decode_instruction(program[j], uses[j], defs[j], flags[j]);
+                    program[i] = MAKE_INSTRUCTION(OPCODE_NOP, 0);
+                    decode_instruction(program[i], uses[i], defs[i], flags[i]);
+                    changed = true;
+                    continue;
+                }
+            }
+
+            if((j < size) && (target[j] == false) && ((GET_OP(program[j]) & 0x03C0) == OPCODE_MOVE) &&
+               ((flags[i] & INSTRUCTION_PURE) != 0) && ((uses[i] & defs[i]) == 0) &&
+               (defs[i] == (1u << (op & 7))))
+            {
+                unsigned int next = GET_OP(program[j]);
+                unsigned int b = (next >> 3) & 7;
+                unsigned int c = next & 7;
+
+                // let this instruction write the destination of the next move directly
+                if((b == (op & 7)) && (b != c) && ((live_out[j] & (1 << b)) == 0))
+                {
+                    op = (op & 0x0FF8) | c;
+                    program[i] = MAKE_INSTRUCTION(op, GET_K(program[i]));
+                    decode_instruction(program[i], uses[i], defs[i], flags[i]);
+                    live_out[i] = live_out[j];
+                    program[j] = MAKE_INSTRUCTION(OPCODE_NOP, 0);
+                    decode_instruction(program[j], uses[j], defs[j], flags[j]);
+                    changed = true;
+                }
+            }
+
+            // track the values held by the registers
+            if((op & 0x03C0) == OPCODE_MOVE)
+            {
+                unsigned int s = (op >> 3) & 7;
+                unsigned int d = op & 7;
+
+                if(reg_value[d] == reg_value[s])
+                {
+                    program[i] = MAKE_INSTRUCTION(OPCODE_NOP, 0);
+                    decode_instruction(program[i], uses[i], defs[i], flags[i]);
+                    changed = true;
+                    continue;
+                }
+                reg_value[d] = reg_value[s];
+            }
+            else if(((op & 0x03F8) == OPCODE_LOADI) || ((op & 0x03F8) == (OPCODE_LOAD | (1 << 3))))
+            {
+                std::map<unsigned int, unsigned int>& values = (((op & 0x03F8) == OPCODE_LOADI) ? const_value : stack_value);
+                std::map<unsigned int, unsigned int>::iterator v = values.find(GET_K(program[i]));
+                unsigned int d = op & 7;
+
+                if(v == values.end())
+                    v = values.insert(std::make_pair(GET_K(program[i]), next_value++)).first;
+                if(reg_value[d] == v->second)
+                {
+                    program[i] = MAKE_INSTRUCTION(OPCODE_NOP, 0);
+                    decode_instruction(program[i], uses[i], defs[i], flags[i]);
+                    changed = true;
+                    continue;
+                }
+                reg_value[d] = v->second;
+            }
+            else if((op & 0x03F8) == (OPCODE_STORE | (1 << 3)))
+                stack_value[GET_K(program[i])] = reg_value[op & 7];
+            else if((flags[i] & INSTRUCTION_CALL) != 0)
+            {
+                for(unsigned int r = 0; r < 8; r++)
+                    reg_value[r] = next_value++;
+                stack_value.clear();
+            }
+            else
+            {
+                if((op == OPCODE_PUSH) || (op == OPCODE_POP))
+                    stack_value.clear();
+                for(unsigned int r = 0; r < 8; r++)
+                {
+                    if((defs[i] & (1 << r)) != 0)
+                        reg_value[r] = next_value++;
+                }
+            }
+        }
+
+        modified = modified || changed;
+    }
+
+    if(modified == false)
+        return;
+
+    // remove the deleted instructions and adjust the branches
+    unsigned int cnt = 0;
+
+    for(unsigned int i = 0; i < size; i++)
+    {
+        newpos[i] = cnt;
+        if(GET_OP(program[i]) != OPCODE_NOP)
+            program[cnt++] = program[i];
+    }
+    newpos[size] = cnt;
+
+    for(unsigned int i = 0; i < cnt; i++)
+    {
+        unsigned int op = GET_OP(program[i]);
+
+        if(((op & 0x03C0) == OPCODE_BEQ) || (op == OPCODE_JMP))
+            program[i] = MAKE_INSTRUCTION(op, newpos[GET_K(program[i])]);
+    }
+
+    function->program_size = cnt;
+}
+
+
 /*****************************************************************************
 *
 * FUNCTION
@@ -511,6 +1198,17 @@ void FNCode::compile_recursive(ExprNode *expr)
     POV_PARSER_ASSERT(expr != nullptr);
 
     unsigned int local_k = 0;
+    std::map<ExprNode *, unsigned int>::const_iterator cse = cse_slot.find(expr);
+
+    // common subexpressions are only evaluated once and then loaded from the stack
+    if(cse != cse_slot.end())
+    {
+        if(cse_done[cse->second] == true)
+        {
+            compile_instruction(OPCODE_LOAD, 1, 0, cse_base + cse->second);
+            return;
+        }
+    }
 
     if(expr->op <= OP_LEFTMOST)
         local_k = compile_push_result();
@@ -600,6 +1298,33 @@ void FNCode::compile_recursive(ExprNode *expr)
                             compile_instruction(OPCODE_MUL, 5, 5, 0);
                             continue;
                         }
+                        else if((i->child->number == floor(i->child->number)) && (fabs(i->child->number) <= 16.0))
+                        {
+                            unsigned int n = (unsigned int)fabs(i->child->number);
+                            unsigned int bit = 16;
+
+                            // square-and-multiply with the base in r0 and the power in r5
+                            if(n > 1)
+                            {
+                                while((bit & n) == 0)
+                                    bit >>= 1;
+                                compile_instruction(OPCODE_MOVE, 5, 0, 0);
+                                for(bit >>= 1; bit != 0; bit >>= 1)
+                                {
+                                    compile_instruction(OPCODE_MUL, 5, 5, 0);
+                                    if((bit & n) != 0)
+                                        compile_instruction(OPCODE_MUL, 0, 5, 0);
+                                }
+                            }
+                            // negative powers are the reciprocal
+                            if(i->child->number < 0.0)
+                            {
+                                compile_instruction(OPCODE_LOADI, 0, 0, functionVM->AddConstant(1.0));
+                                compile_instruction(OPCODE_DIV, 5, 0, 0);
+                                compile_instruction(OPCODE_MOVE, 0, 5, 0);
+                            }
+                            continue;
+                        }
                         break;
                 }
             }
@@ -699,6 +1424,12 @@ void FNCode::compile_recursive(ExprNode *expr)
         compile_instruction(OPCODE_MOVE, 5, 0, 0);
         compile_pop_result(local_k);
     }
+
+    if(cse != cse_slot.end())
+    {
+        compile_instruction(OPCODE_STORE, 1, 0, cse_base + cse->second);
+        cse_done[cse->second] = true;
+    }
 }
 
 
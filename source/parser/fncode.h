@@ -42,9 +42,12 @@
 #include "parser/configparser.h"
 
 // C++ variants of C standard header files
-// C++ standard header files
 //  (none at the moment)
 
+// C++ standard header files
+#include <map>
+#include <vector>
+
 // Boost header files
 #include <boost/intrusive_ptr.hpp>
 
@@ -150,6 +153,10 @@ class FNCode final
         unsigned int parameter_stack_pointer;
         int level;
 
+        std::map<ExprNode *, unsigned int> cse_slot;
+        std::vector<bool> cse_done;
+        unsigned int cse_base;
+
         #if (DEBUG_FLOATFUNCTION == 1)
 
         char *asm_input;
@@ -161,6 +168,9 @@ class FNCode final
         FNCode() = delete;
         FNCode(FNCode&) = delete;
 
+        void cse_prepare(ExprNode *expr);
+        void cse_collect(ExprNode *expr, std::vector<ExprNode *>& candidates);
+        void optimise_program();
         void compile_recursive(ExprNode *expr);
         void compile_member(char *name);
         void compile_call(ExprNode *expr, FUNCTION fn, int token, char *name);
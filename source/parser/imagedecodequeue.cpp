@@ -0,0 +1,114 @@
+//******************************************************************************
+///
+/// @file parser/imagedecodequeue.cpp
+///
+/// Implementation of the helper threads decoding image files during parsing.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+// Unit header file must be the first file included within POV-Ray *.cpp files (pulls in config)
+#include "parser/imagedecodequeue.h"
+
+// C++ variants of C standard header files
+//  (none at the moment)
+
+// C++ standard header files
+#include <algorithm>
+
+// POV-Ray header files (base module)
+//  (none at the moment)
+
+// POV-Ray header files (core module)
+//  (none at the moment)
+
+// POV-Ray header files (parser module)
+//  (none at the moment)
+
+// this must be the last file included
+#include "base/povdebug.h"
+
+namespace pov_parser
+{
+
+//******************************************************************************
+
+ImageDecodeQueue::ImageDecodeQueue(unsigned int maxThreads) :
+    mMaxThreads(std::max(maxThreads, 1u)),
+    mIdleThreads(0),
+    mQuit(false)
+{}
+
+ImageDecodeQueue::~ImageDecodeQueue()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mQuit = true;
+    }
+    mWakeUp.notify_all();
+    for (auto& thread : maThreads)
+        thread.join();
+}
+
+void ImageDecodeQueue::Submit(const std::shared_ptr<pov::ImageDecodeTask>& task)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        maTasks.push_back(task);
+        if ((mIdleThreads < maTasks.size()) && (maThreads.size() < mMaxThreads))
+            maThreads.emplace_back(&ImageDecodeQueue::HelperThread, this);
+    }
+    mWakeUp.notify_one();
+}
+
+void ImageDecodeQueue::HelperThread()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true)
+    {
+        ++mIdleThreads;
+        mWakeUp.wait(lock, [this]() { return mQuit || !maTasks.empty(); });
+        --mIdleThreads;
+        if (mQuit)
+            return;
+
+        std::shared_ptr<pov::ImageDecodeTask> task = maTasks.front().lock();
+        maTasks.pop_front();
+        if (task == nullptr)
+            continue;
+
+        lock.unlock();
+        task->Run();
+        task.reset();
+        lock.lock();
+    }
+}
+
+}
+// end of namespace pov_parser
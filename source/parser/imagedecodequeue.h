@@ -0,0 +1,106 @@
+//******************************************************************************
+///
+/// @file parser/imagedecodequeue.h
+///
+/// Declarations for the helper threads decoding image files during parsing.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+#ifndef POVRAY_PARSER_IMAGEDECODEQUEUE_H
+#define POVRAY_PARSER_IMAGEDECODEQUEUE_H
+
+// Module config header file must be the first file included within POV-Ray unit header files
+#include "parser/configparser.h"
+
+// C++ variants of C standard header files
+//  (none at the moment)
+
+// C++ standard header files
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// POV-Ray header files (base module)
+//  (none at the moment)
+
+// POV-Ray header files (core module)
+#include "core/support/imageutil.h"
+
+// POV-Ray header files (parser module)
+//  (none at the moment)
+
+namespace pov_parser
+{
+
+//------------------------------------------------------------------------------
+
+/// Queue of image files to be decoded by helper threads while parsing goes on.
+///
+/// Helper threads are started on demand, up to the maximum number specified. The queue only holds
+/// weak references to the tasks, so that images dropped by the scene before a helper thread got
+/// around to them are never decoded at all.
+///
+/// @note
+///     Tasks still queued when the queue is destroyed are simply left alone; they will be run
+///     on demand by @ref pov::Resolve_Image().
+///
+class ImageDecodeQueue final
+{
+public:
+
+    ImageDecodeQueue(unsigned int maxThreads);
+    ~ImageDecodeQueue();
+
+    ImageDecodeQueue(const ImageDecodeQueue&) = delete;
+    ImageDecodeQueue& operator=(const ImageDecodeQueue&) = delete;
+
+    /// Have a task run by a helper thread.
+    void Submit(const std::shared_ptr<pov::ImageDecodeTask>& task);
+
+private:
+
+    void HelperThread();
+
+    std::vector<std::thread>                            maThreads;
+    std::deque<std::weak_ptr<pov::ImageDecodeTask>>     maTasks;
+    std::mutex                                          mMutex;
+    std::condition_variable                             mWakeUp;
+    unsigned int                                        mMaxThreads;
+    unsigned int                                        mIdleThreads;
+    bool                                                mQuit;
+};
+
+}
+// end of namespace pov_parser
+
+#endif // POVRAY_PARSER_IMAGEDECODEQUEUE_H
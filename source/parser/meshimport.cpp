@@ -0,0 +1,899 @@
+//******************************************************************************
+///
+/// @file parser/meshimport.cpp
+///
+/// This module implements the readers used to import Wavefront OBJ and PLY files.
+///
+/// The readers work on the complete file contents in memory, and do not depend on
+/// the parser proper, so that they can safely use multiple threads.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+// Unit header file must be the first file included within POV-Ray *.cpp files (pulls in config)
+#include "parser/meshimport.h"
+
+// C++ variants of C standard header files
+#include <cstdlib>
+#include <cstring>
+
+// C++ standard header files
+#include <algorithm>
+#include <exception>
+#include <limits>
+#include <system_error>
+#include <thread>
+
+// POV-Ray header files (base module)
+//  (none at the moment)
+
+// POV-Ray header files (core module)
+//  (none at the moment)
+
+// POV-Ray header files (parser module)
+//  (none at the moment)
+
+// this must be the last file included
+#include "base/povdebug.h"
+
+namespace pov_parser
+{
+
+using std::size_t;
+using std::string;
+using std::vector;
+
+/// Minimum size of the chunks an OBJ file is split into for reading in parallel.
+static const size_t kMinObjChunkSize = 1024 * 1024;
+
+/// Minimum number of vertices decoded per thread when reading a PLY file.
+static const size_t kMinPlyVerticesPerThread = 65536;
+
+/// Maximum length of a number in an OBJ file.
+static const size_t kMaxObjNumberLength = 64;
+
+//------------------------------------------------------------------------------
+
+/// Run a function for each of a number of work items, in parallel.
+///
+/// Item 0 is run by the calling thread, all others by helper threads. If any of the calls
+/// throws an exception, the exception of the lowest-numbered item is re-thrown once all
+/// items are done.
+///
+template<typename FN>
+static void RunParallel(size_t items, const FN& fn)
+{
+    vector<std::exception_ptr> errors(items);
+    vector<std::thread> helpers;
+
+    auto run = [&](size_t i)
+    {
+        try
+        {
+            fn(i);
+        }
+        catch (...)
+        {
+            errors[i] = std::current_exception();
+        }
+    };
+
+    for (size_t i = 1; i < items; i++)
+    {
+        try
+        {
+            helpers.emplace_back(run, i);
+        }
+        catch (std::system_error&)
+        {
+            run(i); // no more threads available; just do it ourselves
+        }
+    }
+    run(0);
+
+    for (auto& helper : helpers)
+        helper.join();
+
+    for (auto& error : errors)
+        if (error)
+            std::rethrow_exception(error);
+}
+
+//******************************************************************************
+// Wavefront OBJ
+
+/// Triangle read from a chunk of an OBJ file.
+struct ObjChunkTriangle final
+{
+    MeshImportTriangle  triangle;
+    POV_LONG            line;       ///< Line number within the chunk.
+    unsigned int        relative;   ///< Bit mask of indices counted from the start of the chunk (bits 0-2 vertices, 3-5 normals, 6-8 UVs).
+};
+
+/// Material selected within a chunk of an OBJ file.
+struct ObjMaterialUse final
+{
+    size_t      triangle;           ///< Number of triangles in the chunk before the selection.
+    string      name;
+    POV_LONG    line;               ///< Line number within the chunk.
+};
+
+/// Data read from a chunk of an OBJ file.
+struct ObjChunk final
+{
+    vector<MeshVector>          vertices;
+    vector<MeshVector>          normals;
+    vector<MeshUVVector>        uvCoords;
+    vector<ObjChunkTriangle>    triangles;
+    vector<ObjMaterialUse>      materialUses;
+    vector<MeshImportMessage>   messages;   ///< Messages with line numbers within the chunk.
+    POV_LONG                    lines;
+    bool                        polygonFaces;
+    bool                        failed;
+
+    ObjChunk() : lines(0), polygonFaces(false), failed(false) {}
+};
+
+inline static bool IsObjBlank(char c)
+{
+    return (c == ' ') || (c == '\t') || (c == '\r') || (c == '\v') || (c == '\f');
+}
+
+/// Get the next word from a line, advancing the read position.
+/// @return `false` if the end of the line has been reached.
+inline static bool ReadObjWord(const char *&p, const char *lineEnd, const char *&word, size_t& length)
+{
+    while ((p < lineEnd) && IsObjBlank(*p))
+        ++p;
+    word = p;
+    while ((p < lineEnd) && !IsObjBlank(*p))
+        ++p;
+    length = p - word;
+    return (length > 0);
+}
+
+inline static bool ReadObjFloat(float& result, const char *&p, const char *lineEnd)
+{
+    const char *word;
+    size_t length;
+    char buffer[kMaxObjNumberLength];
+    char *numberEnd;
+
+    if (!ReadObjWord(p, lineEnd, word, length) || (length >= kMaxObjNumberLength))
+        return false;
+    std::memcpy(buffer, word, length);
+    buffer[length] = '\0';
+    result = float(std::strtod(buffer, &numberEnd));
+    return (numberEnd == buffer + length);
+}
+
+/// Read one index field of a face vertex (e.g. `12` or `-3`).
+/// @return `false` if the field is invalid.
+inline static bool ReadObjIndexField(POV_LONG& result, const char *&p, const char *wordEnd)
+{
+    bool negative = false;
+    POV_LONG value = 0;
+
+    if ((p < wordEnd) && (*p == '-'))
+    {
+        negative = true;
+        ++p;
+    }
+    if ((p == wordEnd) || !isdigit((unsigned char)*p))
+        return false;
+    while ((p < wordEnd) && (*p != '/'))
+    {
+        if (!isdigit((unsigned char)*p))
+            return false;
+        value = (value * 10) + (*p - '0');
+        if (value > std::numeric_limits<MeshIndex>::max())
+            return false;
+        ++p;
+    }
+    if (value == 0)
+        return false;
+    result = (negative ? -value : value);
+    return true;
+}
+
+/// Convert an index as specified in the file to a zero-based index.
+/// Negative indices are converted to indices relative to the start of the chunk, as indicated
+/// by setting the corresponding bit in `relative`.
+inline static MeshIndex ObjIndex(POV_LONG raw, size_t chunkCount, unsigned int& relative, unsigned int bit)
+{
+    if (raw > 0)
+        return MeshIndex(raw - 1);
+    relative |= bit;
+    return MeshIndex(POV_LONG(chunkCount) + raw);
+}
+
+static void ReadObjChunk(ObjChunk& chunk, const char *p, const char *end)
+{
+    MeshImportTriangle corner[3];
+    POV_LONG fields[3];
+
+    while (p < end)
+    {
+        const char *lineEnd = static_cast<const char *>(std::memchr(p, '\n', end - p));
+        if (lineEnd == nullptr)
+            lineEnd = end;
+
+        POV_LONG line = ++chunk.lines;
+        const char *word;
+        size_t length;
+        bool unsupportedCmd = false;
+        bool skipLine = false;
+
+        (void)ReadObjWord(p, lineEnd, word, length);
+        string command(word, length);
+
+        if (command.empty() || (command[0] == '#') || (command == "g") || (command == "o"))
+        {
+            // empty line, comment, group ("g NAME") or object name ("o NAME")
+            skipLine = true;
+        }
+        else if (command == "v")
+        {
+            // vertex XYZ coordinates ("v FLOAT FLOAT FLOAT")
+            MeshVector v;
+            for (int dimension = X; dimension <= Z; ++dimension)
+            {
+                if (!ReadObjFloat(v[dimension], p, lineEnd))
+                    throw MeshImportError("Invalid coordinate value", line);
+            }
+            chunk.vertices.push_back(v);
+        }
+        else if (command == "vn")
+        {
+            // vertex normal vector ("vn FLOAT FLOAT FLOAT")
+            MeshVector v;
+            for (int dimension = X; dimension <= Z; ++dimension)
+            {
+                if (!ReadObjFloat(v[dimension], p, lineEnd))
+                    throw MeshImportError("Invalid coordinate value", line);
+            }
+            chunk.normals.push_back(v);
+        }
+        else if (command == "vt")
+        {
+            // vertex UV coordinates ("vt FLOAT FLOAT")
+            MeshUVVector v;
+            for (int dimension = X; dimension <= Y; ++dimension)
+            {
+                if (!ReadObjFloat(v[dimension], p, lineEnd))
+                    throw MeshImportError("Invalid coordinate value", line);
+            }
+            chunk.uvCoords.push_back(v);
+        }
+        else if (command == "f")
+        {
+            // face ("f VERTEXID VERTEXID VERTEXID ...")
+            int haveVertices = 0;
+            int haveUV = 0;
+            int haveNormal = 0;
+            int vertex = 0;
+            unsigned int relative[3] = { 0, 0, 0 };
+
+            while (ReadObjWord(p, lineEnd, word, length))
+            {
+                const char *q = word;
+                const char *wordEnd = word + length;
+                MeshImportTriangle& c = corner[vertex];
+
+                fields[0] = fields[1] = fields[2] = 0;
+                bool valid = ReadObjIndexField(fields[0], q, wordEnd);
+                if (valid && (q < wordEnd))
+                {
+                    ++q;
+                    if ((q < wordEnd) && (*q != '/'))
+                        valid = ReadObjIndexField(fields[1], q, wordEnd);
+                    if (valid && (q < wordEnd))
+                    {
+                        ++q;
+                        valid = ReadObjIndexField(fields[2], q, wordEnd) && (q == wordEnd);
+                    }
+                }
+                if (!valid)
+                    throw MeshImportError("Invalid or unsupported face index data '" + string(word, length) + "'", line);
+
+                relative[vertex] = 0;
+                c.vertex[0] = ObjIndex(fields[0], chunk.vertices.size(), relative[vertex], 0x001);
+                c.uv[0]     = (fields[1] != 0) ? ObjIndex(fields[1], chunk.uvCoords.size(), relative[vertex], 0x040) : -1;
+                c.normal[0] = (fields[2] != 0) ? ObjIndex(fields[2], chunk.normals.size(),  relative[vertex], 0x008) : -1;
+
+                ++haveVertices;
+                if (fields[1] != 0)
+                    ++haveUV;
+                if (fields[2] != 0)
+                    ++haveNormal;
+
+                if (haveVertices >= 3)
+                {
+                    ObjChunkTriangle t;
+                    t.line = line;
+                    t.relative = 0;
+                    for (int i = 0; i < 3; ++i)
+                    {
+                        t.triangle.vertex[i] = corner[i].vertex[0];
+                        t.triangle.normal[i] = corner[i].normal[0];
+                        t.triangle.uv[i]     = corner[i].uv[0];
+                        t.relative |= (relative[i] << i);
+                    }
+                    t.triangle.material = -1;
+                    chunk.triangles.push_back(t);
+                    corner[1] = corner[2];
+                    relative[1] = relative[2];
+                }
+                else
+                    ++vertex;
+            }
+            if (haveVertices > 3)
+                chunk.polygonFaces = true;
+            if (haveVertices < 3)
+                throw MeshImportError("Insufficient number of vertices per face", line);
+            if ((haveUV != 0) && (haveUV != haveVertices))
+                throw MeshImportError("Inconsistent use of UV indices", line);
+            if ((haveNormal != 0) && (haveNormal != haveVertices))
+                throw MeshImportError("Inconsistent use of normal indices", line);
+        }
+        else if (command == "usemtl")
+        {
+            // material selection ("usemtl NAME")
+            if (!ReadObjWord(p, lineEnd, word, length))
+                throw MeshImportError("Invalid material name", line);
+            ObjMaterialUse use;
+            use.triangle = chunk.triangles.size();
+            use.name.assign(word, length);
+            use.line = line;
+            chunk.materialUses.push_back(use);
+        }
+        else
+        {
+            // includes material library ("mtllib FILE FILE ..."), which is not supported yet
+            unsupportedCmd = true;
+        }
+
+        if (unsupportedCmd)
+        {
+            chunk.messages.push_back(MeshImportMessage{ "Unsupported command '" + command + "' skipped", line, false });
+            skipLine = true;
+        }
+
+        if (!skipLine && ReadObjWord(p, lineEnd, word, length))
+            chunk.messages.push_back(MeshImportMessage{ "Unexpected extra data skipped", line, true });
+
+        // skip remainder of line
+        p = lineEnd + 1;
+    }
+}
+
+void ReadObjFile(MeshImportData& data, const char *text, size_t size, unsigned int threads)
+{
+    // Split the file into chunks at line boundaries.
+
+    size_t chunkCount = std::max<size_t>(1, std::min<size_t>(std::max(threads, 1u), size / kMinObjChunkSize));
+    vector<const char *> bounds;
+    const char *end = text + size;
+
+    bounds.push_back(text);
+    for (size_t i = 1; i < chunkCount; ++i)
+    {
+        const char *p = std::max(bounds.back(), text + (size / chunkCount) * i);
+        const char *lineEnd = static_cast<const char *>(std::memchr(p, '\n', end - p));
+        if (lineEnd == nullptr)
+            break;
+        bounds.push_back(lineEnd + 1);
+    }
+    bounds.push_back(end);
+    chunkCount = bounds.size() - 1;
+
+    vector<ObjChunk> chunks(chunkCount);
+
+    try
+    {
+        RunParallel(chunkCount, [&](size_t i)
+        {
+            try
+            {
+                ReadObjChunk(chunks[i], bounds[i], bounds[i + 1]);
+            }
+            catch (MeshImportError&)
+            {
+                chunks[i].failed = true;
+                throw;
+            }
+        });
+    }
+    catch (MeshImportError& e)
+    {
+        // The error reported is that of the first failed chunk, so all chunks before it
+        // have been read completely; adjust the line number accordingly.
+        POV_LONG lineBase = 0;
+        for (size_t i = 0; (i < chunkCount) && !chunks[i].failed; ++i)
+            lineBase += chunks[i].lines;
+        throw MeshImportError(e.what(), e.line + lineBase);
+    }
+
+    // Merge the chunks.
+
+    size_t totalVertices = 0, totalNormals = 0, totalUVCoords = 0, totalTriangles = 0;
+    for (auto& chunk : chunks)
+    {
+        totalVertices  += chunk.vertices.size();
+        totalNormals   += chunk.normals.size();
+        totalUVCoords  += chunk.uvCoords.size();
+        totalTriangles += chunk.triangles.size();
+    }
+
+    if (std::max(std::max(totalVertices, totalNormals), std::max(totalUVCoords, totalTriangles)) >= size_t(std::numeric_limits<MeshIndex>::max() / 2))
+        throw MeshImportError("Too many elements");
+
+    data.vertices.reserve(totalVertices);
+    data.normals.reserve(totalNormals);
+    data.uvCoords.reserve(totalUVCoords);
+    data.triangles.reserve(totalTriangles);
+
+    MeshIndex material = -1;
+    POV_LONG lineBase = 0;
+
+    for (auto& chunk : chunks)
+    {
+        const MeshIndex vertexBase = MeshIndex(data.vertices.size());
+        const MeshIndex normalBase = MeshIndex(data.normals.size());
+        const MeshIndex uvBase     = MeshIndex(data.uvCoords.size());
+
+        data.vertices.insert(data.vertices.end(), chunk.vertices.begin(), chunk.vertices.end());
+        data.normals.insert(data.normals.end(), chunk.normals.begin(), chunk.normals.end());
+        data.uvCoords.insert(data.uvCoords.end(), chunk.uvCoords.begin(), chunk.uvCoords.end());
+
+        for (auto& message : chunk.messages)
+        {
+            data.messages.push_back(message);
+            data.messages.back().line += lineBase;
+        }
+
+        auto use = chunk.materialUses.begin();
+        for (size_t i = 0; i <= chunk.triangles.size(); ++i)
+        {
+            for (; (use != chunk.materialUses.end()) && (use->triangle == i); ++use)
+            {
+                for (material = 0; material < MeshIndex(data.materials.size()); ++material)
+                    if (data.materials[material].name == use->name)
+                        break;
+                if (material == MeshIndex(data.materials.size()))
+                    data.materials.push_back(MeshImportMaterial{ use->name, use->line + lineBase });
+            }
+
+            if (i == chunk.triangles.size())
+                break;
+
+            const ObjChunkTriangle& t = chunk.triangles[i];
+            MeshImportTriangle triangle = t.triangle;
+            triangle.material = material;
+            for (int k = 0; k < 3; ++k)
+            {
+                if (t.relative & (0x001 << k))
+                    triangle.vertex[k] += vertexBase;
+                if (t.relative & (0x008 << k))
+                    triangle.normal[k] += normalBase;
+                if (t.relative & (0x040 << k))
+                    triangle.uv[k] += uvBase;
+
+                if ((triangle.vertex[k] < 0) || (triangle.vertex[k] >= MeshIndex(totalVertices)))
+                    throw MeshImportError("Vertex index out of range", t.line + lineBase);
+                if ((t.triangle.uv[k] != -1 || (t.relative & (0x040 << k))) && ((triangle.uv[k] < 0) || (triangle.uv[k] >= MeshIndex(totalUVCoords))))
+                    throw MeshImportError("UV index out of range", t.line + lineBase);
+                if ((t.triangle.normal[k] != -1 || (t.relative & (0x008 << k))) && ((triangle.normal[k] < 0) || (triangle.normal[k] >= MeshIndex(totalNormals))))
+                    throw MeshImportError("Normal index out of range", t.line + lineBase);
+            }
+            data.triangles.push_back(triangle);
+        }
+
+        data.polygonFaces = data.polygonFaces || chunk.polygonFaces;
+        lineBase += chunk.lines;
+
+        // release memory as we go
+        vector<MeshVector>().swap(chunk.vertices);
+        vector<MeshVector>().swap(chunk.normals);
+        vector<MeshUVVector>().swap(chunk.uvCoords);
+        vector<ObjChunkTriangle>().swap(chunk.triangles);
+    }
+}
+
+//******************************************************************************
+// PLY
+
+enum PlyType
+{
+    kPlyInvalid = -1,
+    kPlyInt8,
+    kPlyUInt8,
+    kPlyInt16,
+    kPlyUInt16,
+    kPlyInt32,
+    kPlyUInt32,
+    kPlyFloat32,
+    kPlyFloat64,
+};
+
+static const size_t kPlyTypeSize[] = { 1, 1, 2, 2, 4, 4, 4, 8 };
+
+struct PlyProperty final
+{
+    string  name;
+    PlyType type;           ///< Type of the value, or of the list items.
+    PlyType countType;      ///< Type of the list item count, or @ref kPlyInvalid if not a list.
+    size_t  offset;         ///< Offset within the element's record, if all preceding properties are scalar.
+};
+
+struct PlyElement final
+{
+    string              name;
+    size_t              count;
+    vector<PlyProperty> properties;
+    size_t              stride;     ///< Size of each record, or 0 if the element has list properties.
+};
+
+static PlyType PlyTypeFromName(const string& name)
+{
+    static const struct { const char *name; PlyType type; } kTypes[] =
+    {
+        { "char",   kPlyInt8    }, { "int8",    kPlyInt8    },
+        { "uchar",  kPlyUInt8   }, { "uint8",   kPlyUInt8   },
+        { "short",  kPlyInt16   }, { "int16",   kPlyInt16   },
+        { "ushort", kPlyUInt16  }, { "uint16",  kPlyUInt16  },
+        { "int",    kPlyInt32   }, { "int32",   kPlyInt32   },
+        { "uint",   kPlyUInt32  }, { "uint32",  kPlyUInt32  },
+        { "float",  kPlyFloat32 }, { "float32", kPlyFloat32 },
+        { "double", kPlyFloat64 }, { "float64", kPlyFloat64 },
+    };
+    for (auto& t : kTypes)
+        if (name == t.name)
+            return t.type;
+    return kPlyInvalid;
+}
+
+/// Decode a single binary value.
+inline static double ReadPlyValue(const char *p, PlyType type, bool swap)
+{
+    unsigned char bytes[8];
+    const size_t size = kPlyTypeSize[type];
+
+    if (swap)
+        std::reverse_copy(p, p + size, bytes);
+    else
+        std::memcpy(bytes, p, size);
+
+    switch (type)
+    {
+        case kPlyInt8:    { POV_INT8    v; std::memcpy(&v, bytes, size); return v; }
+        case kPlyUInt8:   { POV_UINT8   v; std::memcpy(&v, bytes, size); return v; }
+        case kPlyInt16:   { POV_INT16   v; std::memcpy(&v, bytes, size); return v; }
+        case kPlyUInt16:  { POV_UINT16  v; std::memcpy(&v, bytes, size); return v; }
+        case kPlyInt32:   { POV_INT32   v; std::memcpy(&v, bytes, size); return v; }
+        case kPlyUInt32:  { POV_UINT32  v; std::memcpy(&v, bytes, size); return v; }
+        case kPlyFloat32: { float       v; std::memcpy(&v, bytes, size); return v; }
+        default:          { double      v; std::memcpy(&v, bytes, size); return v; }
+    }
+}
+
+static int FindPlyProperty(const PlyElement& element, const char *name)
+{
+    for (size_t i = 0; i < element.properties.size(); ++i)
+        if (element.properties[i].name == name)
+            return int(i);
+    return -1;
+}
+
+void ReadPlyFile(MeshImportData& data, const char *bytes, size_t size, unsigned int threads)
+{
+    const char *p = bytes;
+    const char *end = bytes + size;
+    vector<PlyElement> elements;
+    bool bigEndian = false;
+    bool haveFormat = false;
+    bool haveEnd = false;
+    POV_LONG line = 0;
+
+    // Read the header.
+
+    while (!haveEnd && (p < end))
+    {
+        const char *lineEnd = static_cast<const char *>(std::memchr(p, '\n', end - p));
+        if (lineEnd == nullptr)
+            break;
+        ++line;
+
+        vector<string> words;
+        const char *word;
+        size_t length;
+        while (ReadObjWord(p, lineEnd, word, length))
+            words.emplace_back(word, length);
+        p = lineEnd + 1;
+
+        if (line == 1)
+        {
+            if ((words.size() != 1) || (words[0] != "ply"))
+                throw MeshImportError("Not a PLY file");
+        }
+        else if (words.empty() || (words[0] == "comment") || (words[0] == "obj_info"))
+        {
+            // nothing to do
+        }
+        else if (words[0] == "format")
+        {
+            if ((words.size() < 2) || (words[1] == "ascii"))
+                throw MeshImportError("Only binary PLY files are supported", line);
+            else if (words[1] == "binary_little_endian")
+                bigEndian = false;
+            else if (words[1] == "binary_big_endian")
+                bigEndian = true;
+            else
+                throw MeshImportError("Unknown PLY format '" + words[1] + "'", line);
+            haveFormat = true;
+        }
+        else if (words[0] == "element")
+        {
+            PlyElement element;
+            char *numberEnd;
+            if (words.size() != 3)
+                throw MeshImportError("Invalid element declaration", line);
+            element.name = words[1];
+            element.count = size_t(std::strtoull(words[2].c_str(), &numberEnd, 10));
+            if (*numberEnd != '\0')
+                throw MeshImportError("Invalid element count", line);
+            element.stride = 0;
+            elements.push_back(element);
+        }
+        else if (words[0] == "property")
+        {
+            PlyProperty property;
+            if (elements.empty())
+                throw MeshImportError("Property declared outside of element", line);
+            if ((words.size() == 5) && (words[1] == "list"))
+            {
+                property.countType = PlyTypeFromName(words[2]);
+                property.type = PlyTypeFromName(words[3]);
+                property.name = words[4];
+                if ((property.countType == kPlyInvalid) || (property.countType == kPlyFloat32) || (property.countType == kPlyFloat64))
+                    throw MeshImportError("Invalid list count type '" + words[2] + "'", line);
+            }
+            else if (words.size() == 3)
+            {
+                property.countType = kPlyInvalid;
+                property.type = PlyTypeFromName(words[1]);
+                property.name = words[2];
+            }
+            else
+                throw MeshImportError("Invalid property declaration", line);
+            if (property.type == kPlyInvalid)
+                throw MeshImportError("Invalid property type", line);
+            elements.back().properties.push_back(property);
+        }
+        else if (words[0] == "end_header")
+            haveEnd = true;
+        else
+            throw MeshImportError("Unknown PLY header keyword '" + words[0] + "'", line);
+    }
+
+    if (!haveEnd)
+        throw MeshImportError("Incomplete PLY header");
+    if (!haveFormat)
+        throw MeshImportError("Missing PLY format declaration");
+
+    for (auto& element : elements)
+    {
+        size_t offset = 0;
+        for (auto& property : element.properties)
+        {
+            property.offset = offset;
+            if (property.countType != kPlyInvalid)
+            {
+                offset = 0;
+                break;
+            }
+            offset += kPlyTypeSize[property.type];
+        }
+        element.stride = offset;
+    }
+
+    const POV_UINT16 probe = 1;
+    POV_UINT8 lowByte;
+    std::memcpy(&lowByte, &probe, 1);
+    const bool swap = (bigEndian == (lowByte == 1)); // host and file byte order differ
+    size_t vertexCount = 0;
+
+    for (auto& element : elements)
+        if (element.name == "vertex")
+            vertexCount = element.count;
+    if (vertexCount >= size_t(std::numeric_limits<MeshIndex>::max() / 2))
+        throw MeshImportError("Too many vertices");
+
+    // Read the data.
+
+    for (auto& element : elements)
+    {
+        if (element.name == "vertex")
+        {
+            int x = FindPlyProperty(element, "x");
+            int y = FindPlyProperty(element, "y");
+            int z = FindPlyProperty(element, "z");
+            int nx = FindPlyProperty(element, "nx");
+            int ny = FindPlyProperty(element, "ny");
+            int nz = FindPlyProperty(element, "nz");
+            int u = FindPlyProperty(element, "u");
+            int v = FindPlyProperty(element, "v");
+            if ((u < 0) || (v < 0))
+            {
+                u = FindPlyProperty(element, "s");
+                v = FindPlyProperty(element, "t");
+            }
+            if ((u < 0) || (v < 0))
+            {
+                u = FindPlyProperty(element, "texture_u");
+                v = FindPlyProperty(element, "texture_v");
+            }
+            if ((u < 0) || (v < 0))
+            {
+                u = FindPlyProperty(element, "texture_s");
+                v = FindPlyProperty(element, "texture_t");
+            }
+            const bool haveNormals = (nx >= 0) && (ny >= 0) && (nz >= 0);
+            const bool haveUV = (u >= 0) && (v >= 0);
+
+            if ((x < 0) || (y < 0) || (z < 0))
+                throw MeshImportError("Vertex coordinates missing");
+            if (element.stride == 0)
+                throw MeshImportError("List properties of vertices are not supported");
+            if (element.count > size_t(end - p) / element.stride)
+                throw MeshImportError("Unexpected end of file");
+
+            data.vertices.resize(element.count);
+            if (haveNormals)
+                data.normals.resize(element.count);
+            if (haveUV)
+                data.uvCoords.resize(element.count);
+
+            const PlyProperty *prop[7] =
+            {
+                &element.properties[x], &element.properties[y], &element.properties[z],
+                haveNormals ? &element.properties[nx] : nullptr,
+                haveNormals ? &element.properties[ny] : nullptr,
+                haveNormals ? &element.properties[nz] : nullptr,
+                nullptr
+            };
+            const PlyProperty *uvProp[2] = { haveUV ? &element.properties[u] : nullptr, haveUV ? &element.properties[v] : nullptr };
+            const char *base = p;
+            const size_t stride = element.stride;
+            const size_t count = element.count;
+            const size_t ranges = std::max<size_t>(1, std::min<size_t>(std::max(threads, 1u), count / kMinPlyVerticesPerThread));
+
+            RunParallel(ranges, [&](size_t range)
+            {
+                const size_t first = count * range / ranges;
+                const size_t last = count * (range + 1) / ranges;
+                for (size_t i = first; i < last; ++i)
+                {
+                    const char *record = base + i * stride;
+                    for (int axis = X; axis <= Z; ++axis)
+                        data.vertices[i][axis] = float(ReadPlyValue(record + prop[axis]->offset, prop[axis]->type, swap));
+                    if (haveNormals)
+                        for (int axis = X; axis <= Z; ++axis)
+                            data.normals[i][axis] = float(ReadPlyValue(record + prop[3 + axis]->offset, prop[3 + axis]->type, swap));
+                    if (haveUV)
+                        for (int axis = U; axis <= V; ++axis)
+                            data.uvCoords[i][axis] = float(ReadPlyValue(record + uvProp[axis]->offset, uvProp[axis]->type, swap));
+                }
+            });
+
+            p += count * stride;
+        }
+        else if (element.stride != 0)
+        {
+            // skip other elements of fixed size
+            if (element.count > size_t(end - p) / element.stride)
+                throw MeshImportError("Unexpected end of file");
+            p += element.count * element.stride;
+        }
+        else
+        {
+            // walk through elements of variable size, importing faces if applicable
+            int indices = -1;
+            if (element.name == "face")
+            {
+                indices = FindPlyProperty(element, "vertex_indices");
+                if (indices < 0)
+                    indices = FindPlyProperty(element, "vertex_index");
+                if ((indices >= 0) && (element.properties[indices].countType == kPlyInvalid))
+                    throw MeshImportError("Face vertex indices are not a list");
+                data.triangles.reserve(element.count);
+            }
+
+            const bool haveNormals = !data.normals.empty();
+            const bool haveUV = !data.uvCoords.empty();
+            vector<MeshIndex> face;
+
+            for (size_t i = 0; i < element.count; ++i)
+            {
+                for (int j = 0; j < int(element.properties.size()); ++j)
+                {
+                    const PlyProperty& property = element.properties[j];
+                    size_t items = 1;
+                    if (property.countType != kPlyInvalid)
+                    {
+                        if (size_t(end - p) < kPlyTypeSize[property.countType])
+                            throw MeshImportError("Unexpected end of file");
+                        items = size_t(ReadPlyValue(p, property.countType, swap));
+                        p += kPlyTypeSize[property.countType];
+                    }
+                    const size_t itemSize = kPlyTypeSize[property.type];
+                    if (items > size_t(end - p) / itemSize)
+                        throw MeshImportError("Unexpected end of file");
+
+                    if (j == indices)
+                    {
+                        if (items < 3)
+                            throw MeshImportError("Insufficient number of vertices per face");
+                        if (items > 3)
+                            data.polygonFaces = true;
+                        face.resize(items);
+                        for (size_t k = 0; k < items; ++k)
+                        {
+                            double index = ReadPlyValue(p + k * itemSize, property.type, swap);
+                            if ((index < 0) || (index >= double(vertexCount)))
+                                throw MeshImportError("Vertex index out of range");
+                            face[k] = MeshIndex(index);
+                        }
+                        for (size_t k = 2; k < items; ++k)
+                        {
+                            MeshImportTriangle triangle;
+                            triangle.vertex[0] = face[0];
+                            triangle.vertex[1] = face[k - 1];
+                            triangle.vertex[2] = face[k];
+                            for (int c = 0; c < 3; ++c)
+                            {
+                                triangle.normal[c] = haveNormals ? triangle.vertex[c] : -1;
+                                triangle.uv[c] = haveUV ? triangle.vertex[c] : -1;
+                            }
+                            triangle.material = -1;
+                            data.triangles.push_back(triangle);
+                        }
+                    }
+                    p += items * itemSize;
+                }
+            }
+
+            if (data.triangles.size() >= size_t(std::numeric_limits<MeshIndex>::max() / 2))
+                throw MeshImportError("Too many faces");
+        }
+    }
+}
+
+}
+// end of namespace pov_parser
@@ -0,0 +1,148 @@
+//******************************************************************************
+///
+/// @file parser/meshimport.h
+///
+/// Declarations for the readers used to import Wavefront OBJ and PLY files.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+#ifndef POVRAY_PARSER_MESHIMPORT_H
+#define POVRAY_PARSER_MESHIMPORT_H
+
+// Module config header file must be the first file included within POV-Ray unit header files
+#include "parser/configparser.h"
+
+// C++ variants of C standard header files
+#include <cstddef>
+
+// C++ standard header files
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// POV-Ray header files (base module)
+//  (none at the moment)
+
+// POV-Ray header files (core module)
+#include "core/shape/mesh.h"
+
+// POV-Ray header files (parser module)
+//  (none at the moment)
+
+namespace pov_parser
+{
+
+using namespace pov;
+
+//------------------------------------------------------------------------------
+
+/// Triangle read from a mesh file.
+///
+/// All indices are zero-based; normal and UV coordinate indices are -1 if not specified.
+///
+struct MeshImportTriangle final
+{
+    MeshIndex vertex[3];    ///< Indices of the vertices.
+    MeshIndex normal[3];    ///< Indices of the normals, or -1.
+    MeshIndex uv[3];        ///< Indices of the UV coordinates, or -1.
+    MeshIndex material;     ///< Index into @ref MeshImportData::materials, or -1.
+};
+
+/// Material referenced by a mesh file.
+struct MeshImportMaterial final
+{
+    std::string name;       ///< Name of the material.
+    POV_LONG    line;       ///< Line of the first reference to the material.
+};
+
+/// Diagnostic message generated while reading a mesh file.
+struct MeshImportMessage final
+{
+    std::string text;       ///< Message text, without file name and line number.
+    POV_LONG    line;       ///< Line number, or 0 if not applicable.
+    bool        possibleError; ///< Whether to report as possible error rather than warning.
+};
+
+/// Raw mesh data read from a mesh file.
+///
+/// Polygons are split into triangle fans, but otherwise the data is kept as it was found
+/// in the file.
+///
+struct MeshImportData final
+{
+    std::vector<MeshVector>         vertices;
+    std::vector<MeshVector>         normals;
+    std::vector<MeshUVVector>       uvCoords;
+    std::vector<MeshImportTriangle> triangles;
+    std::vector<MeshImportMaterial> materials;
+    std::vector<MeshImportMessage>  messages;
+    bool                            polygonFaces;   ///< Whether any non-triangular faces were found.
+
+    MeshImportData() : polygonFaces(false) {}
+};
+
+/// Exception thrown if a mesh file cannot be read.
+class MeshImportError final : public std::runtime_error
+{
+    public:
+        MeshImportError(const std::string& text, POV_LONG l = 0) : std::runtime_error(text), line(l) {}
+        POV_LONG line;      ///< Line number, or 0 if not applicable.
+};
+
+/// Read a Wavefront OBJ file.
+///
+/// The file is split into chunks at line boundaries, which are read by up to `threads`
+/// threads in parallel and merged afterwards.
+///
+/// @param[out] data        Mesh data read.
+/// @param[in]  text        File contents.
+/// @param[in]  size        File size.
+/// @param[in]  threads     Maximum number of threads to use.
+/// @throws MeshImportError if the file is invalid.
+///
+void ReadObjFile(MeshImportData& data, const char *text, std::size_t size, unsigned int threads);
+
+/// Read a binary PLY file.
+///
+/// The `vertex` and `face` elements are imported; other elements and properties are skipped.
+/// The vertices are decoded by up to `threads` threads in parallel.
+///
+/// @param[out] data        Mesh data read.
+/// @param[in]  bytes       File contents.
+/// @param[in]  size        File size.
+/// @param[in]  threads     Maximum number of threads to use.
+/// @throws MeshImportError if the file is invalid or not in binary format.
+///
+void ReadPlyFile(MeshImportData& data, const char *bytes, std::size_t size, unsigned int threads);
+
+}
+// end of namespace pov_parser
+
+#endif // POVRAY_PARSER_MESHIMPORT_H
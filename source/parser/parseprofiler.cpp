@@ -0,0 +1,168 @@
+//******************************************************************************
+///
+/// @file parser/parseprofiler.cpp
+///
+/// Implementation of the parse-phase profiler.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+// Unit header file must be the first file included within POV-Ray *.cpp files (pulls in config)
+#include "parser/parseprofiler.h"
+
+// C++ variants of C standard header files
+//  (none at the moment)
+
+// C++ standard header files
+#include <algorithm>
+
+// POV-Ray header files (base module)
+#include "base/pov_mem.h"
+#include "base/povassert.h"
+
+// POV-Ray header files (core module)
+//  (none at the moment)
+
+// POV-Ray header files (parser module)
+//  (none at the moment)
+
+// this must be the last file included
+#include "base/povdebug.h"
+
+namespace pov_parser
+{
+
+//******************************************************************************
+
+const char* ParseProfileEntry::GetKindName(Kind kind)
+{
+    switch (kind)
+    {
+        case kInclude:      return "include";
+        case kMacro:        return "macro";
+        case kDirective:    return "directive";
+    }
+    POV_PARSER_PANIC();
+    return "";
+}
+
+//******************************************************************************
+
+constexpr std::size_t ParseProfiler::kNoLevel;
+
+ParseProfiler::ParseProfiler() :
+    mEnabled(false)
+{}
+
+void ParseProfiler::Start()
+{
+    mTimer.Reset();
+    mEnabled = true;
+}
+
+std::size_t ParseProfiler::Enter(ParseProfileEntry::Kind kind, const std::string& name, POV_LONG tokenCount)
+{
+    if (!mEnabled)
+        return kNoLevel;
+
+    std::string key(1, char('0' + kind));
+    key += name;
+    auto iIndex = mIndex.find(key);
+    if (iIndex == mIndex.end())
+    {
+        maEntries.push_back(ParseProfileEntry{ kind, name, 0, 0, 0, 0, 0, 0, 0 });
+        maActiveCounts.push_back(0);
+        iIndex = mIndex.emplace(key, maEntries.size() - 1).first;
+    }
+
+    std::size_t entry = iIndex->second;
+    ++maEntries[entry].calls;
+    ++maActiveCounts[entry];
+
+    std::size_t level = maActivations.size();
+    maActivations.push_back(Activation{ entry, mTimer.ElapsedRealTime(), tokenCount, pov_mem_allocated_bytes(), 0, 0, 0 });
+    return level;
+}
+
+void ParseProfiler::Leave(std::size_t level, POV_LONG tokenCount)
+{
+    if (level >= maActivations.size())
+        return;
+
+    POV_LONG  time  = mTimer.ElapsedRealTime();
+    POV_ULONG bytes = pov_mem_allocated_bytes();
+
+    while (maActivations.size() > level)
+    {
+        Activation& activation = maActivations.back();
+        ParseProfileEntry& entry = maEntries[activation.entry];
+
+        POV_LONG  elapsedTime   = time       - activation.startTime;
+        POV_LONG  elapsedTokens = tokenCount - activation.startTokens;
+        POV_ULONG elapsedBytes  = bytes      - activation.startBytes;
+
+        entry.exclusiveTime   += elapsedTime   - activation.nestedTime;
+        entry.exclusiveTokens += elapsedTokens - activation.nestedTokens;
+        entry.exclusiveBytes  += elapsedBytes  - activation.nestedBytes;
+
+        // Only the outermost of any recursive activations counts towards the inclusive figures.
+        if (--maActiveCounts[activation.entry] == 0)
+        {
+            entry.inclusiveTime   += elapsedTime;
+            entry.inclusiveTokens += elapsedTokens;
+            entry.inclusiveBytes  += elapsedBytes;
+        }
+
+        maActivations.pop_back();
+
+        if (!maActivations.empty())
+        {
+            Activation& parent = maActivations.back();
+            parent.nestedTime   += elapsedTime;
+            parent.nestedTokens += elapsedTokens;
+            parent.nestedBytes  += elapsedBytes;
+        }
+    }
+}
+
+std::vector<ParseProfileEntry> ParseProfiler::GetEntries() const
+{
+    std::vector<ParseProfileEntry> entries(maEntries);
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](const ParseProfileEntry& a, const ParseProfileEntry& b)
+                     {
+                         if (a.exclusiveTime != b.exclusiveTime)
+                             return (a.exclusiveTime > b.exclusiveTime);
+                         return (a.exclusiveTokens > b.exclusiveTokens);
+                     });
+    return entries;
+}
+
+}
+// end of namespace pov_parser
@@ -0,0 +1,159 @@
+//******************************************************************************
+///
+/// @file parser/parseprofiler.h
+///
+/// Declarations for the parse-phase profiler.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+#ifndef POVRAY_PARSER_PARSEPROFILER_H
+#define POVRAY_PARSER_PARSEPROFILER_H
+
+// Module config header file must be the first file included within POV-Ray unit header files
+#include "parser/configparser.h"
+
+// C++ variants of C standard header files
+#include <cstddef>
+
+// C++ standard header files
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// POV-Ray header files (base module)
+#include "base/timer.h"
+
+// POV-Ray header files (core module)
+//  (none at the moment)
+
+// POV-Ray header files (parser module)
+//  (none at the moment)
+
+namespace pov_parser
+{
+
+using namespace pov_base;
+
+//------------------------------------------------------------------------------
+
+/// Statistics gathered by the @ref ParseProfiler for one include file, macro or directive.
+///
+/// Inclusive figures cover everything that happened while the entry was active, while exclusive
+/// figures exclude nested entries. Recursive activations are accounted for only once in the
+/// inclusive figures.
+///
+struct ParseProfileEntry final
+{
+    enum Kind { kInclude, kMacro, kDirective };
+
+    Kind        kind;
+    std::string name;
+    POV_LONG    calls;
+    POV_LONG    inclusiveTime;      ///< Wall-clock time in milliseconds.
+    POV_LONG    exclusiveTime;      ///< Wall-clock time in milliseconds.
+    POV_LONG    inclusiveTokens;
+    POV_LONG    exclusiveTokens;
+    POV_ULONG   inclusiveBytes;     ///< Memory allocated via @ref pov_malloc or @ref pov_realloc.
+    POV_ULONG   exclusiveBytes;     ///< Memory allocated via @ref pov_malloc or @ref pov_realloc.
+
+    /// Get a human-readable name for the kind of entry.
+    static const char* GetKindName(Kind kind);
+};
+
+/// Parse-phase profiler.
+///
+/// This class attributes wall-clock time, tokens and allocated memory to the include files, macros
+/// and major directives processed by the parser. Measurements are taken only when entering or
+/// leaving one of those, so the profiler is cheap enough to leave enabled.
+///
+/// All time measurements are taken from a single @ref Timer. Since each reading is truncated to
+/// whole milliseconds, individual short activations may be attributed 0 or 1 ms, but the errors
+/// average out over many activations.
+///
+class ParseProfiler final
+{
+public:
+
+    /// Level returned by @ref Enter() while the profiler is disabled.
+    static constexpr std::size_t kNoLevel = std::size_t(-1);
+
+    ParseProfiler();
+
+    /// Enable the profiler.
+    void Start();
+
+    /// Test whether the profiler is enabled.
+    inline bool IsEnabled() const { return mEnabled; }
+
+    /// Start an activation of an include file, macro or directive.
+    ///
+    /// @param[in]  kind        Kind of entry.
+    /// @param[in]  name        Name of the entry.
+    /// @param[in]  tokenCount  Total number of tokens parsed so far.
+    /// @return                 Level to pass to @ref Leave(), or @ref kNoLevel if disabled.
+    ///
+    std::size_t Enter(ParseProfileEntry::Kind kind, const std::string& name, POV_LONG tokenCount);
+
+    /// End an activation, along with any activations started since that haven't ended yet.
+    ///
+    /// @param[in]  level       Level returned by the corresponding call to @ref Enter().
+    /// @param[in]  tokenCount  Total number of tokens parsed so far.
+    ///
+    void Leave(std::size_t level, POV_LONG tokenCount);
+
+    /// Get the statistics gathered, sorted by exclusive time in descending order.
+    /// @note Any activations still in progress are not included.
+    std::vector<ParseProfileEntry> GetEntries() const;
+
+private:
+
+    struct Activation final
+    {
+        std::size_t entry;
+        POV_LONG    startTime;
+        POV_LONG    startTokens;
+        POV_ULONG   startBytes;
+        POV_LONG    nestedTime;
+        POV_LONG    nestedTokens;
+        POV_ULONG   nestedBytes;
+    };
+
+    Timer                                           mTimer;
+    std::vector<ParseProfileEntry>                  maEntries;
+    std::vector<int>                                maActiveCounts;
+    std::unordered_map<std::string, std::size_t>    mIndex;
+    std::vector<Activation>                         maActivations;
+    bool                                            mEnabled;
+};
+
+}
+// end of namespace pov_parser
+
+#endif // POVRAY_PARSER_PARSEPROFILER_H
@@ -46,16 +46,26 @@
 
 // C++ standard header files
 #include <algorithm>
+#include <atomic>
+#include <exception>
+#include <map>
+#include <set>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
 
 // POV-Ray header files (base module)
 #include "base/fileinputoutput.h"
+#include "base/filesystem.h"
 #include "base/fileutil.h"
 #include "base/path.h"
 #include "base/povassert.h"
 #include "base/stringutilities.h"
+#include "base/timer.h"
 #include "base/types.h"
 #include "base/image/colourspace.h"
 #include "base/image/image.h"
+#include "base/image/imagecache.h"
 
 // POV-Ray header files (core module)
 #include "core/bounding/boundingcylinder.h"
@@ -67,6 +77,7 @@
 #include "core/lighting/subsurface.h"
 #include "core/material/blendmap.h"
 #include "core/material/interior.h"
+#include "core/material/media.h"
 #include "core/material/noise.h"
 #include "core/material/normal.h"
 #include "core/material/pattern.h"
@@ -99,6 +110,7 @@
 #include "core/shape/polynomial.h"
 #include "core/shape/polygon.h"
 #include "core/shape/polyline.h"
+#include "core/shape/primitivesoup.h"
 #include "core/shape/prism.h"
 #include "core/shape/quadric.h"
 #include "core/shape/rationalbezierpatch.h"
@@ -110,8 +122,10 @@
 #include "core/shape/triangle.h"
 #include "core/shape/truetype.h"
 #include "core/shape/uvmeshable.h"
+#include "core/support/cracklecache.h"
 #include "core/support/imageutil.h"
 #include "core/support/octree.h"
+#include "core/support/texturecache.h"
 
 // POV-Ray header files (VM module)
 #include "vm/fnpovfpu.h"
@@ -140,6 +154,10 @@ using std::vector;
 
 const DBL INFINITE_VOLUME = BOUND_HUGE;
 
+/* Minimum number of loose triangles worth merging into a mesh. */
+
+const size_t MERGE_TRIANGLES_MIN_COUNT = 16;
+
 
 //******************************************************************************
 
@@ -148,6 +166,7 @@ Parser::Parser(shared_ptr<SceneData> sd, const Options& opts,
     sceneData(sd),
     clockValue(opts.clock),
     useClock(opts.useClock),
+    mImportThreads(opts.threads),
     mMessageFactory(mf),
     mFileResolver(fr),
     mProgressReporter(pr),
@@ -158,6 +177,15 @@ Parser::Parser(shared_ptr<SceneData> sd, const Options& opts,
     Destroying_Frame(false),
     mTokenCount(0),
     mTokensSinceLastProgressReport(0),
+    // Reused declarations skip the input that content fingerprints are computed from.
+    mReuseDeclarations(opts.reuseDeclarations && sd->incrementalRenderFile.empty()),
+    mDeclarationEnvironment(kDeclarationHashSeed),
+    mDeclarationsReused(0),
+    mDeclarationsEvaluated(0),
+    mFingerprintContent(!sd->incrementalRenderFile.empty()),
+    mContentTarget(nullptr),
+    mContentTokenDepth(0),
+    mDeferImageDecoding(opts.deferImageDecoding),
     next_rand(nullptr)
 {
     std::tm tmY2K;
@@ -185,6 +213,64 @@ Parser::~Parser()
     delete fnVMContext;
 }
 
+/* Set up the visibility grid a light source uses for media sampling, if any. */
+static void PostProcessLightMediaGrid(LightSource *light)
+{
+    if ((light->Media_Grid_Spacing > 0.0) && light->Media_Interaction)
+        light->Media_Grid = std::make_shared<MediaGrid>(light->Media_Grid_Spacing, light->Media_Grid_Memory);
+    else
+        light->Media_Grid.reset();
+}
+
+/// Run a function for each of a number of independent work items, using up to the given number of threads.
+///
+/// The calling thread takes part in the work; the items are handed out one by one, so that a few
+/// expensive items don't hold up the others. If any of the calls throws an exception, the exception
+/// of the lowest-numbered item is re-thrown once all threads are done.
+///
+template<typename FN>
+static void ForEachParallel(size_t items, unsigned int threads, const FN& fn)
+{
+    vector<std::exception_ptr> errors(items);
+    vector<std::thread> helpers;
+    std::atomic<size_t> next(0);
+
+    auto run = [&]()
+    {
+        for (size_t i = next++; i < items; i = next++)
+        {
+            try
+            {
+                fn(i);
+            }
+            catch (...)
+            {
+                errors[i] = std::current_exception();
+            }
+        }
+    };
+
+    for (size_t i = 1; (i < threads) && (i < items); i++)
+    {
+        try
+        {
+            helpers.emplace_back(run);
+        }
+        catch (std::system_error&)
+        {
+            break; // no more threads available; make do with the ones we have
+        }
+    }
+    run();
+
+    for (auto& helper : helpers)
+        helper.join();
+
+    for (auto& error : errors)
+        if (error)
+            std::rethrow_exception(error);
+}
+
 /* Parse the file. */
 void Parser::Run()
 {
@@ -202,6 +288,12 @@ void Parser::Run()
 
             Initialize_Tokenizer();
 
+            if (!sceneData->parseProfileFile.empty())
+            {
+                mProfiler.Start();
+                (void)mProfiler.Enter(ParseProfileEntry::kInclude, UCS2toSysString(sceneData->inputFile), mTokenCount);
+            }
+
             Default_Texture = Create_Texture ();
             Default_Texture->Pigment = Create_Pigment();
             Default_Texture->Tnormal = nullptr;
@@ -212,6 +304,7 @@ void Parser::Run()
 
             // Initialize various defaults depending on language version as per command line / INI settings.
             InitDefaults(sceneData->EffectiveLanguageVersion());
+            UpdateDeclarationEnvironment();
 
             Not_In_Default = true;
             Ok_To_Declare = true;
@@ -241,19 +334,48 @@ void Parser::Run()
                 }
             }
 
+            if (mFingerprintContent)
+                BeginContentFingerprint();
+
             IncludeHeader(sceneData->headerFile);
 
             Parse_Frame();
 
+            Finish_Image_Decoding();
+
+            Merge_Identical_Textures();
+
+            if (sceneData->mergeTriangles)
+                Merge_Loose_Triangles();
+
+            Share_Identical_Transforms();
+
+            Build_CSG_Child_Trees();
+
+            if (mFingerprintContent)
+            {
+                ContentFingerprint environment = EndContentFingerprint();
+                POV_UINT64 hash = HashDeclarationValue(environment.hash, mDeclarationEnvironment);
+                hash = HashDeclarationValue(hash, sceneData->outputAlpha);
+                sceneData->environmentFingerprint = hash;
+                // Merged meshes replace objects whose fingerprints we have already recorded.
+                sceneData->environmentFingerprintStable = environment.stable && !sceneData->mergeTriangles;
+            }
+
             // post process atmospheric media
             for (vector<Media>::iterator i(sceneData->atmosphere.begin()); i != sceneData->atmosphere.end(); i++)
                 i->PostProcess();
 
+            // pre-compute fog tables
+            for (FOG *fog = sceneData->fog; fog != nullptr; fog = fog->Next)
+                Precompute_Fog(fog);
+
             // post process global light sources
             for (size_t i = 0; i < sceneData->lightSources.size(); i++)
             {
                 sceneData->lightSources[i]->index = i;
                 sceneData->lightSources[i]->lightGroupLight = false;
+                PostProcessLightMediaGrid(sceneData->lightSources[i]);
             }
 
             // post process local light sources
@@ -261,6 +383,7 @@ void Parser::Run()
             {
                 sceneData->lightGroupLightSources[i]->index = i;
                 sceneData->lightGroupLightSources[i]->lightGroupLight = true;
+                PostProcessLightMediaGrid(sceneData->lightGroupLightSources[i]);
             }
         }
         // Make sure any exceptional situations are reported as a parse error (pov_base::Exception)
@@ -343,6 +466,13 @@ void Parser::Run()
     if(sceneData->objects.empty())
         Warning("No objects in scene.");
 
+    sceneData->symbolLookups = mSymbolStack.GetLookupCount();
+    sceneData->symbolProbes = mSymbolStack.GetProbeCount();
+    sceneData->declarationsReused = mDeclarationsReused;
+    sceneData->declarationsEvaluated = mDeclarationsEvaluated;
+
+    Write_Parse_Profile();
+
     Cleanup();
 
     // Check for experimental features
@@ -355,6 +485,7 @@ void Parser::Run()
     if(mExperimentalFlags.functionHf)           featureList.push_back("function '.hf'");
     if(mExperimentalFlags.meshCamera)           featureList.push_back("mesh camera");
     if(mExperimentalFlags.objImport)            featureList.push_back("wavefront obj import");
+    if(mExperimentalFlags.plyImport)            featureList.push_back("ply import");
     if(mExperimentalFlags.slopeAltitude)        featureList.push_back("slope pattern altitude");
     if(mExperimentalFlags.spline)               featureList.push_back("spline");
     if(mExperimentalFlags.subsurface)           featureList.push_back("subsurface light transport");
@@ -480,6 +611,14 @@ void Parser::Run()
             sceneData->parsedCamera = sceneData->cameras[0];
         }
     }
+    else if (sceneData->multiCamera == true)
+    {
+        if (sceneData->cameras.size() > 1)
+        {
+            Warning("Multi-camera: total of %d cameras will be rendered as separate views.", sceneData->cameras.size());
+            sceneData->parsedCamera = sceneData->cameras[0];
+        }
+    }
 
     if (sceneData->radiositySettings.pretraceEnd > sceneData->radiositySettings.pretraceStart)
         Error("Radiosity pretrace end must be smaller than or equal to pretrace start.");
@@ -511,6 +650,78 @@ void Parser::Run()
     }
 }
 
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Write_Parse_Profile
+*
+* INPUT
+*
+* OUTPUT
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Report the statistics gathered by the parse profiler, if enabled: The
+*   entries taking up the most time are listed on the debug stream, while all
+*   entries are written to the file specified via the `Parse_Profile_File`
+*   option, in CSV format.
+*
+* CHANGES
+*
+******************************************************************************/
+
+void Parser::Write_Parse_Profile()
+{
+    static const size_t kMaxReportedEntries = 20;
+
+    if (!mProfiler.IsEnabled())
+        return;
+
+    mProfiler.Leave(0, mTokenCount);
+    vector<ParseProfileEntry> entries = mProfiler.GetEntries();
+
+    Debug_Info("Parse profile (top %d of %d by exclusive time):\n", int(min(entries.size(), kMaxReportedEntries)), int(entries.size()));
+    Debug_Info("%-9s %9s %10s %10s %12s %12s  %s\n", "kind", "calls", "incl ms", "excl ms", "excl tokens", "excl bytes", "name");
+    for (size_t i = 0; (i < entries.size()) && (i < kMaxReportedEntries); ++i)
+    {
+        const ParseProfileEntry& entry = entries[i];
+        Debug_Info("%-9s %9lld %10lld %10lld %12lld %12llu  %s\n",
+                   ParseProfileEntry::GetKindName(entry.kind), (long long)entry.calls,
+                   (long long)entry.inclusiveTime, (long long)entry.exclusiveTime,
+                   (long long)entry.exclusiveTokens, (unsigned long long)entry.exclusiveBytes,
+                   entry.name.c_str());
+    }
+
+    std::unique_ptr<OStream> file(CreateFile(sceneData->parseProfileFile, POV_File_Text_CSV, false));
+    if (file == nullptr)
+    {
+        Warning("Cannot write parse profile file '%s'.", UCS2toSysString(sceneData->parseProfileFile).c_str());
+        return;
+    }
+
+    file->printf("kind,name,calls,inclusive_ms,exclusive_ms,inclusive_tokens,exclusive_tokens,inclusive_bytes,exclusive_bytes\n");
+    for (auto& entry : entries)
+    {
+        std::string name;
+        for (auto c : entry.name)
+        {
+            if (c == '"')
+                name += '"';
+            name += c;
+        }
+        file->printf("%s,\"%s\",%lld,%lld,%lld,%lld,%lld,%llu,%llu\n",
+                     ParseProfileEntry::GetKindName(entry.kind), name.c_str(), (long long)entry.calls,
+                     (long long)entry.inclusiveTime, (long long)entry.exclusiveTime,
+                     (long long)entry.inclusiveTokens, (long long)entry.exclusiveTokens,
+                     (unsigned long long)entry.inclusiveBytes, (unsigned long long)entry.exclusiveBytes);
+    }
+}
+
 void Parser::Cleanup()
 {
     // TODO FIXME - cleanup [trf]
@@ -730,6 +941,7 @@ ObjectPtr Parser::Parse_Bicubic_Patch ()
 {
     BicubicPatch *Object;
     int i, j;
+    DBL Tolerance = 0.0;
 
     Parse_Begin ();
 
@@ -779,6 +991,12 @@ ObjectPtr Parser::Parse_Bicubic_Patch ()
             Object->accuracy = Parse_Float();
         END_CASE
 
+        CASE (TESSELATE_TOKEN)
+            Tolerance = Parse_Float();
+            if (Tolerance <= 0.0)
+                Error("Tesselation tolerance must be positive.");
+        END_CASE
+
         CASE(UV_VECTORS_TOKEN)
             /* Store 4 ST coords for quadrilateral  */
             Parse_UV_Vect(Object->ST[0]);  Parse_Comma();
@@ -817,6 +1035,9 @@ ObjectPtr Parser::Parse_Bicubic_Patch ()
         }
     }
 
+    if (Tolerance > 0.0)
+        return Parse_Tessellated_Patch(Object, *Object, Tolerance);
+
     Object->Precompute_Patch_Values(); /* interpolated mesh coords */
 
     Object->Compute_BBox();
@@ -1021,9 +1242,7 @@ ObjectPtr Parser::Parse_Blob()
 
     /* Finally, process the information */
 
-    int components = Object->Make_Blob(threshold, blob_components, npoints, GetParserDataPtr());
-    if (components > sceneData->Max_Blob_Components)
-        sceneData->Max_Blob_Components = components;
+    Object->Make_Blob(threshold, blob_components, npoints);
 
     return (reinterpret_cast<ObjectPtr>(Object));
 }
@@ -1251,7 +1470,8 @@ void Parser::Parse_Mesh_Camera (Camera& Cam)
             Cam.V_Xref[i].resize(size);
         }
 
-        Mesh_Triangle_Struct *tr(mesh->Data->Triangles);
+        std::vector<Mesh_Triangle_Struct> triangles;
+        const Mesh_Triangle_Struct *tr(mesh->Data->Get_Triangles(triangles));
         for (int i = 0, idx = 0, bit = 1; i < mesh->Data->Number_Of_Triangles; i++, tr++)
         {
             int P1u(mesh->Data->UVCoords[tr->UV1][U] * 10);
@@ -3026,7 +3246,12 @@ ObjectPtr Parser::Parse_HField ()
 
     Parse_Object_Mods(reinterpret_cast<ObjectPtr>(Object));
 
-    Object->Compute_HField(image);
+    pov_base::Timer timer;
+
+    Object->Compute_HField(image, mImportThreads);
+
+    sceneData->heightFieldPoints += (POV_LONG)image->iwidth * (POV_LONG)image->iheight;
+    sceneData->heightFieldTime += timer.ElapsedRealTime();
 
     Object->Compute_BBox();
 
@@ -3058,6 +3283,7 @@ ObjectPtr Parser::Parse_HField ()
 ObjectPtr Parser::Parse_Isosurface()
 {
     IsoSurface *Object;
+    unsigned int resolution = 0;
 
     Parse_Begin();
 
@@ -3113,6 +3339,14 @@ ObjectPtr Parser::Parse_Isosurface()
             Object->positivePolarity = (Parse_Float() > 0);
         END_CASE
 
+        CASE (INTERVAL_BOUNDS_TOKEN)
+            Object->intervalBounds = (Allow_Float(1.0) > 0.0);
+        END_CASE
+
+        CASE (OCCUPANCY_GRID_TOKEN)
+            resolution = (unsigned int)Parse_Int_With_Range(0, ISOSURFACE_MAX_OCCUPANCY_GRID, "isosurface occupancy_grid");
+        END_CASE
+
         OTHERWISE
             UNGET
             EXIT
@@ -3130,11 +3364,85 @@ ObjectPtr Parser::Parse_Isosurface()
         Object->max_gradient = 1.1;
     }
 
+    if (resolution > 0)
+        Compute_Isosurface_Occupancy(Object, resolution);
+
     Parse_Object_Mods (reinterpret_cast<ObjectPtr>(Object));
 
     return (reinterpret_cast<ObjectPtr>(Object));
 }
 
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Compute_Isosurface_Occupancy
+*
+* INPUT
+*
+*   Object - isosurface to compute the occupancy grid of
+*   resolution - as specified by the `occupancy_grid` keyword
+*
+* OUTPUT
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   The grid is computed using the mesh import threads. As the container is
+*   tightened before any transformations are applied, the tightened bounds
+*   are reported in the isosurface's own coordinate system.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+void Parser::Compute_Isosurface_Occupancy(IsoSurface* Object, unsigned int resolution)
+{
+    Vector3d lower, upper, oldLower, oldUpper;
+
+    ContainedByBox* box = dynamic_cast<ContainedByBox*>(Object->container.get());
+    ContainedBySphere* sphere = dynamic_cast<ContainedBySphere*>(Object->container.get());
+    if (box != nullptr)
+    {
+        oldLower = box->corner1;
+        oldUpper = box->corner2;
+    }
+    else if (sphere != nullptr)
+    {
+        oldLower = sphere->center - Vector3d(sphere->radius);
+        oldUpper = sphere->center + Vector3d(sphere->radius);
+    }
+
+    std::vector<std::unique_ptr<TraceThreadData>> helpers;
+    std::vector<TraceThreadData*> threads(1, GetParserDataPtr());
+    for (unsigned int i = 1; i < mImportThreads; i++)
+    {
+        helpers.emplace_back(new TraceThreadData(sceneData, i));
+        threads.push_back(helpers.back().get());
+    }
+
+    bool occupied = Object->Compute_Occupancy(resolution, threads, lower, upper);
+
+    for (auto& helper : helpers)
+        GetParserDataPtr()->Stats() += helper->Stats();
+
+    if (!occupied)
+        Warning("Isosurface function does not reach the threshold anywhere within the container.");
+    else if ((lower - oldLower).IsNull() && (upper - oldUpper).IsNull())
+        return;
+    else if (box != nullptr)
+        Warning("Isosurface container tightened to contained_by { box { <%g, %g, %g>, <%g, %g, %g> } }.",
+                lower.x(), lower.y(), lower.z(), upper.x(), upper.y(), upper.z());
+    else
+        Warning("Isosurface container could be tightened to contained_by { box { <%g, %g, %g>, <%g, %g, %g> } }.",
+                lower.x(), lower.y(), lower.z(), upper.x(), upper.y(), upper.z());
+}
+
 //******************************************************************************
 
 void Parser::ParseContainedBy(shared_ptr<pov::ContainedByShape>& container, ObjectPtr obj)
@@ -3394,6 +3702,7 @@ ObjectPtr Parser::Parse_Julia_Fractal ()
     int num_iterations = Object->SetUp_Fractal();
     if (num_iterations > sceneData->Fractal_Iteration_Stack_Length)
     {
+        NoteSideEffect();
         sceneData->Fractal_Iteration_Stack_Length = num_iterations;
         TraceThreadData *td = GetParserDataPtr();
         Fractal::Allocate_Iteration_Stack(td->Fractal_IStack, sceneData->Fractal_Iteration_Stack_Length);
@@ -3606,6 +3915,7 @@ ObjectPtr Parser::Parse_Lathe()
     if (Object->Spline->BCyl->number > sceneData->Max_Bounding_Cylinders)
     {
         TraceThreadData *td = GetParserDataPtr();
+        NoteSideEffect();
         sceneData->Max_Bounding_Cylinders = Object->Spline->BCyl->number;
         td->BCyl_Intervals.reserve(4*sceneData->Max_Bounding_Cylinders);
         td->BCyl_RInt.reserve(2*sceneData->Max_Bounding_Cylinders);
@@ -4096,6 +4406,16 @@ ObjectPtr Parser::Parse_Light_Source ()
             Object->Adaptive_Level = (int)Parse_Float();
         END_CASE
 
+        CASE (VARIANCE_TOKEN)
+            Object->Sample_Variance = Parse_Float();
+            if (Object->Sample_Variance < 0.0)
+                Error("Area light variance must not be negative.");
+            if (!(Object->Area_Light))
+            {
+                Warning("Variance only affects area_light");
+            }
+        END_CASE
+
         CASE (MEDIA_ATTENUATION_TOKEN)
             Object->Media_Attenuation = Allow_Float(1.0) > 0.0;
         END_CASE
@@ -4104,6 +4424,16 @@ ObjectPtr Parser::Parse_Light_Source ()
             Object->Media_Interaction = Allow_Float(1.0) > 0.0;
         END_CASE
 
+        CASE (PRECOMPUTE_TOKEN)
+            Object->Media_Grid_Spacing = Parse_Float();
+            Parse_Comma();
+            Object->Media_Grid_Memory = Allow_Float(Object->Media_Grid_Memory);
+            if (Object->Media_Grid_Spacing < 0.0)
+                Error("Media visibility grid spacing must not be negative.");
+            if (Object->Media_Grid_Memory <= 0.0)
+                Error("Media visibility grid memory must be greater than zero.");
+        END_CASE
+
         CASE (TRANSLATE_TOKEN)
             Parse_Vector (Local_Vector);
             Compute_Translation_Transform(&Local_Trans, Local_Vector);
@@ -4229,6 +4559,11 @@ ObjectPtr Parser::Parse_Mesh()
             Parse_Obj (Object);
         END_CASE
 
+        CASE (PLY_TOKEN)
+            mExperimentalFlags.plyImport = true;
+            Parse_Ply (Object);
+        END_CASE
+
         OTHERWISE
             UNGET
             Parse_Mesh1 (Object);
@@ -4250,8 +4585,9 @@ ObjectPtr Parser::Parse_Mesh()
 
     Parse_Object_Mods (reinterpret_cast<ObjectPtr>(Object));
 
-    // Create bounding box tree.
+    // Use the compact triangle format if possible, and create bounding box tree.
 
+    Object->Compact_Mesh_Data();
     Object->Build_Mesh_BBox_Tree();
 
     return Object;
@@ -4655,8 +4991,13 @@ void Parser::Parse_Mesh1 (Mesh* Object)
 
 
     Object->Data->References = 1;
+    Object->Data->Accounted_Memory = 0;
 
-    Object->Data->Tree = nullptr;
+    Object->Data->BVH = nullptr;
+    Object->Data->Storage = nullptr;
+    Object->Data->Page = nullptr;
+    Object->Data->In_Scene_Arena = true;
+    Object->Data->CompactTriangles = nullptr;
     /* NK 1998 */
 
     if( (fabs(Inside_Vect[X]) < EPSILON) &&  (fabs(Inside_Vect[Y]) < EPSILON) &&  (fabs(Inside_Vect[Z]) < EPSILON))
@@ -4679,7 +5020,8 @@ void Parser::Parse_Mesh1 (Mesh* Object)
     Object->Data->Triangles = nullptr;
     Object->Data->Vertices  = nullptr;
 
-    /* Allocate memory for normals, textures, triangles and vertices. */
+    /* Allocate memory for normals, textures, triangles and vertices; */
+    /* the mesh arrays go to the scene arena, as they are never modified once parsed. */
 
     Object->Number_Of_Textures = number_of_textures;
 
@@ -4689,7 +5031,7 @@ void Parser::Parse_Mesh1 (Mesh* Object)
 
     Object->Data->Number_Of_Vertices = number_of_vertices;
 
-    Object->Data->Normals = reinterpret_cast<MeshVector *>(POV_MALLOC(number_of_normals*sizeof(MeshVector), "triangle mesh data"));
+    Object->Data->Normals = sceneData->arena.AllocateArray<MeshVector>(number_of_normals);
 
     if (number_of_textures)
     {
@@ -4699,9 +5041,9 @@ void Parser::Parse_Mesh1 (Mesh* Object)
         Object->Textures = reinterpret_cast<TEXTURE **>(POV_MALLOC(number_of_textures*sizeof(TEXTURE *), "triangle mesh data"));
     }
 
-    Object->Data->Triangles = reinterpret_cast<MESH_TRIANGLE *>(POV_MALLOC(number_of_triangles*sizeof(MESH_TRIANGLE), "triangle mesh data"));
+    Object->Data->Triangles = sceneData->arena.AllocateArray<MESH_TRIANGLE>(number_of_triangles);
 
-    Object->Data->Vertices = reinterpret_cast<MeshVector *>(POV_MALLOC(number_of_vertices*sizeof(MeshVector), "triangle mesh data"));
+    Object->Data->Vertices = sceneData->arena.AllocateArray<MeshVector>(number_of_vertices);
 
     /* Copy normals, textures, triangles and vertices into mesh. */
 
@@ -4739,7 +5081,7 @@ void Parser::Parse_Mesh1 (Mesh* Object)
     /* do the four steps above, but for UV coordinates*/
     Object->Data->UVCoords  = nullptr;
     Object->Data->Number_Of_UVCoords = number_of_uvcoords;
-    Object->Data->UVCoords = reinterpret_cast<MeshUVVector *>(POV_MALLOC(number_of_uvcoords*sizeof(MeshUVVector), "triangle mesh data"));
+    Object->Data->UVCoords = sceneData->arena.AllocateArray<MeshUVVector>(number_of_uvcoords);
     for (i = 0; i < number_of_uvcoords; i++)
     {
         Object->Data->UVCoords[i] = UVCoords[i];
@@ -4769,6 +5111,57 @@ void Parser::Parse_Mesh1 (Mesh* Object)
 */
 }
 
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Parse_Tessellated_Patch
+*
+* INPUT
+*
+*   Object    - Patch just parsed, up to but excluding its object modifiers
+*   Surface   - The same patch, as a parametric surface
+*   Tolerance - Maximum deviation of the mesh from the patch
+*
+* OUTPUT
+*
+* RETURNS
+*
+*   OBJECT
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Replace a patch by a mesh approximating it, and parse the object
+*   modifiers for the mesh instead. Tracing rays against the mesh is much
+*   faster than subdividing the patch for each ray.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+ObjectPtr Parser::Parse_Tessellated_Patch(ObjectPtr Object, const UVMeshable& Surface, DBL Tolerance)
+{
+    Mesh *Result = new Mesh();
+
+    if (!Result->Tessellate_UV_Surface(Surface, Tolerance, GetParserDataPtr()))
+        Error("Tesselation of patch results in no triangles.");
+
+    Destroy_Object(Object);
+
+    Result->Compute_BBox();
+
+    Parse_Object_Mods(reinterpret_cast<ObjectPtr>(Result));
+
+    Result->Compact_Mesh_Data();
+    Result->Build_Mesh_BBox_Tree();
+
+    return (reinterpret_cast<ObjectPtr>(Result));
+}
+
 /*****************************************************************************
 *
 * FUNCTION
@@ -4811,7 +5204,35 @@ ObjectPtr Parser::Parse_Mesh2()
 
     Object = new Mesh();
 
-    Parse_Mesh2 (Object);
+    // Take the mesh data from the mesh cache directory if possible, or else arrange for it
+    // to be put there.
+
+    MeshSnapshot snapshot;
+
+    if (!Find_Mesh2_Snapshot(Object, snapshot))
+    {
+        if (!snapshot.fileName.empty())
+            BeginTrackedDeclaration(nullptr);
+
+        Parse_Mesh2 (Object);
+
+        if (!snapshot.fileName.empty())
+            Finish_Mesh2_Snapshot(Object, snapshot);
+    }
+
+    // Look for a binary mesh file to write the mesh to.
+
+    UCS2String saveFileName;
+
+    EXPECT_ONE
+        CASE(SAVE_FILE_TOKEN)
+            saveFileName = SysToUCS2String(Parse_SysString(true));
+        END_CASE
+
+        OTHERWISE
+            UNGET
+        END_CASE
+    END_EXPECT
 
     // Create bounding box.
 
@@ -4821,10 +5242,24 @@ ObjectPtr Parser::Parse_Mesh2()
 
     Parse_Object_Mods (reinterpret_cast<ObjectPtr>(Object));
 
-    // Create bounding box tree.
+    // Use the compact triangle format if possible, and create bounding box tree.
 
+    Object->Compact_Mesh_Data();
     Object->Build_Mesh_BBox_Tree();
 
+    // Write binary mesh file, including the bounding box tree.
+
+    if (!saveFileName.empty())
+    {
+        std::unique_ptr<OStream> file(CreateFile(saveFileName, POV_File_Data_PMB, false));
+
+        if ((file == nullptr) || !Object->Write_Mesh_File(*file))
+            Error("Cannot write binary mesh file '%s'.", UCS2toSysString(saveFileName).c_str());
+    }
+
+    if (snapshot.write)
+        Write_Mesh2_Snapshot(Object, snapshot);
+
     return Object;
 }
 
@@ -4853,6 +5288,25 @@ void Parser::Parse_Mesh2 (Mesh* Object)
 
     Inside_Vect = Vector3d(0.0, 0.0, 0.0);
 
+    /* -----------------  Get the mesh data from a binary file ------------ */
+    bool found_file = false;
+
+    EXPECT_ONE
+        CASE(LOAD_FILE_TOKEN)
+            found_file = true;
+        END_CASE
+
+        OTHERWISE
+            UNGET
+        END_CASE
+    END_EXPECT
+
+    if (found_file)
+    {
+        Parse_Mesh2_File(Object);
+        return;
+    }
+
     /* normals, uvcoords, and textures are optional */
     number_of_vertices = 0;
     number_of_uvcoords = 0;
@@ -4867,8 +5321,8 @@ void Parser::Parse_Mesh2 (Mesh* Object)
         CASE(VERTEX_VECTORS_TOKEN)
             if (number_of_vertices>0)
             {
+                // (the previous block resides in the scene arena, and will be released along with the scene)
                 Warning("Duplicate vertex_vectors block; ignoring previous block.");
-                POV_FREE(Vertices);
             }
 
             Parse_Begin();
@@ -4879,7 +5333,7 @@ void Parser::Parse_Mesh2 (Mesh* Object)
                 Error("No vertices in triangle mesh.");
 
             /* allocate memory for vertices */
-            Vertices = reinterpret_cast<MeshVector *>(POV_MALLOC(number_of_vertices*sizeof(MeshVector), "triangle mesh data"));
+            Vertices = sceneData->arena.AllocateArray<MeshVector>(number_of_vertices);
 
             for(i=0; i<number_of_vertices; i++)
             {
@@ -4925,8 +5379,8 @@ void Parser::Parse_Mesh2 (Mesh* Object)
         CASE(UV_VECTORS_TOKEN)
             if (number_of_uvcoords>0)
             {
+                // (the previous block resides in the scene arena, and will be released along with the scene)
                 Warning("Duplicate uv_vectors block; ignoring previous block.");
-                POV_FREE(UVCoords);
             }
 
             Parse_Begin();
@@ -4934,7 +5388,7 @@ void Parser::Parse_Mesh2 (Mesh* Object)
 
             if (number_of_uvcoords>0)
             {
-                UVCoords = reinterpret_cast<MeshUVVector *>(POV_MALLOC(number_of_uvcoords*sizeof(MeshUVVector), "triangle mesh data"));
+                UVCoords = sceneData->arena.AllocateArray<MeshUVVector>(number_of_uvcoords);
 
                 for(i=0; i<number_of_uvcoords; i++)
                 {
@@ -4954,30 +5408,7 @@ void Parser::Parse_Mesh2 (Mesh* Object)
 
     EXPECT*/
         CASE(TEXTURE_LIST_TOKEN)
-            Parse_Begin();
-
-            number_of_textures = (int)Parse_Float();  Parse_Comma();
-
-            if (number_of_textures>0)
-            {
-                Textures = reinterpret_cast<TEXTURE **>(POV_MALLOC(number_of_textures*sizeof(TEXTURE *), "triangle mesh data"));
-
-                for(i=0; i<number_of_textures; i++)
-                {
-                    /*
-                    GET(TEXTURE_ID_TOKEN)
-                    Textures[i] = Copy_Texture_Pointer(CurrentTokenDataPtr<TEXTURE*>());
-                    */
-                    GET(TEXTURE_TOKEN);
-                    Parse_Begin();
-                    Textures[i] = Parse_Texture();
-                    Post_Textures(Textures[i]);
-                    Parse_End();
-                    Parse_Comma();
-                }
-            }
-
-            Parse_End();
+            Parse_Mesh2_Texture_List(Textures, number_of_textures);
             EXIT
         END_CASE
 
@@ -4995,7 +5426,7 @@ void Parser::Parse_Mesh2 (Mesh* Object)
     if (number_of_uvcoords == 0)
     {
         number_of_uvcoords = 1;
-        UVCoords = reinterpret_cast<MeshUVVector *>(POV_MALLOC(number_of_uvcoords*sizeof(MeshUVVector), "triangle mesh data"));
+        UVCoords = sceneData->arena.AllocateArray<MeshUVVector>(number_of_uvcoords);
         UVCoords[0][U] = 0;
         UVCoords[0][V] = 0;
     }
@@ -5013,7 +5444,7 @@ void Parser::Parse_Mesh2 (Mesh* Object)
     }
 
     /* allocate memory for triangles */
-    Triangles = reinterpret_cast<MESH_TRIANGLE *>(POV_MALLOC(number_of_triangles*sizeof(MESH_TRIANGLE), "triangle mesh data"));
+    Triangles = sceneData->arena.AllocateArray<MESH_TRIANGLE>(number_of_triangles);
 
     /* start reading triangles */
 
@@ -5266,11 +5697,16 @@ void Parser::Parse_Mesh2 (Mesh* Object)
 
     /* ---------------- Compute Triangle Normals ---------------- */
 
-    /* reallocate the normals stuff */
-    if (!number_of_normals)
-        Normals = reinterpret_cast<MeshVector *>(POV_MALLOC(number_of_triangles*sizeof(MeshVector), "triangle mesh data"));
-    else
-        Normals = reinterpret_cast<MeshVector *>(POV_REALLOC(Normals, (number_of_normals+number_of_triangles)*sizeof(MeshVector), "triangle mesh data"));
+    /* reallocate the normals stuff, moving them to the scene arena */
+    {
+        MeshVector *parsedNormals = Normals;
+        Normals = sceneData->arena.AllocateArray<MeshVector>(number_of_normals+number_of_triangles);
+        if (number_of_normals)
+        {
+            std::copy(parsedNormals, parsedNormals + number_of_normals, Normals);
+            POV_FREE(parsedNormals);
+        }
+    }
 
     for (i=0; i<number_of_triangles; i++)
     {
@@ -5330,7 +5766,12 @@ void Parser::Parse_Mesh2 (Mesh* Object)
     /* Init triangle mesh data. */
     Object->Data = reinterpret_cast<MESH_DATA *>(POV_MALLOC(sizeof(MESH_DATA), "triangle mesh data"));
     Object->Data->References = 1;
-    Object->Data->Tree = nullptr;
+    Object->Data->Accounted_Memory = 0;
+    Object->Data->BVH = nullptr;
+    Object->Data->Storage = nullptr;
+    Object->Data->Page = nullptr;
+    Object->Data->In_Scene_Arena = true;
+    Object->Data->CompactTriangles = nullptr;
     /* NK 1998 */
     /*YS* 31/12/1999 */
 
@@ -5387,41 +5828,461 @@ void Parser::Parse_Mesh2 (Mesh* Object)
 *
 * FUNCTION
 *
-*   Parse_Mesh_Texture
+*   Parse_Mesh2_Texture_List
 *
 * INPUT
 *
 * OUTPUT
 *
-* RETURNS
+*   textures           - Array of textures
+*   number_of_textures - Number of textures
 *
-*   OBJECT
+* RETURNS
 *
 * AUTHOR
 *
-*   Dieter Bayer
+*   Nathan Kopp
 *
 * DESCRIPTION
 *
-*   Read an individual triangle mesh texture.
+*   Read the texture list of a triangle mesh - syntax version 2.
 *
 * CHANGES
 *
-*   Feb 1995 : Creation.
+*   Moved out of Parse_Mesh2, so that it can also be used with binary mesh
+*   files.
 *
 ******************************************************************************/
 
-TEXTURE *Parser::Parse_Mesh_Texture (TEXTURE **t2, TEXTURE **t3)
+void Parser::Parse_Mesh2_Texture_List(TEXTURE**& textures, int& number_of_textures)
 {
-    TEXTURE *Texture;
-
-    Texture = nullptr;
+    Parse_Begin();
 
-    EXPECT
-        CASE(TEXTURE_TOKEN)
-            Parse_Begin();
+    number_of_textures = (int)Parse_Float();  Parse_Comma();
 
-            GET(TEXTURE_ID_TOKEN);
+    if (number_of_textures>0)
+    {
+        textures = reinterpret_cast<TEXTURE **>(POV_MALLOC(number_of_textures*sizeof(TEXTURE *), "triangle mesh data"));
+
+        for(int i=0; i<number_of_textures; i++)
+        {
+            /*
+            GET(TEXTURE_ID_TOKEN)
+            textures[i] = Copy_Texture_Pointer(CurrentTokenDataPtr<TEXTURE*>());
+            */
+            GET(TEXTURE_TOKEN);
+            Parse_Begin();
+            textures[i] = Parse_Texture();
+            Post_Textures(textures[i]);
+            Parse_End();
+            Parse_Comma();
+        }
+    }
+
+    Parse_End();
+}
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Parse_Mesh2_File
+*
+* INPUT
+*
+* OUTPUT
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Read a triangle mesh whose data is held in a binary mesh file, as
+*   written by mesh2's save_file keyword. The file is memory-mapped and used
+*   in place; only the texture list and inside vector are read from the
+*   scene file.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+void Parser::Parse_Mesh2_File(Mesh* Object)
+{
+    UCS2String file_name = SysToUCS2String(Parse_SysString(true));
+    UCS2String actual_file_name;
+    std::unique_ptr<pov_base::Filesystem::MappedFile> file(new pov_base::Filesystem::MappedFile);
+    MeshIndex number_of_required_textures;
+    int number_of_textures = 0;
+    TEXTURE **Textures = nullptr;
+    bool found_inside_vector = false;
+    Vector3d Inside_Vect;
+
+    /* Use the regular file lookup, so that the search path and I/O restrictions apply. */
+    if (Locate_File(file_name, POV_File_Data_PMB, actual_file_name, true) == nullptr)
+        Error("Cannot open binary mesh file.");
+
+    if (!file->Open(actual_file_name))
+        Error("Cannot map binary mesh file '%s'.", UCS2toSysString(actual_file_name).c_str());
+
+    if (!Object->Map_Mesh_File(file, number_of_required_textures))
+        Error("Invalid or incompatible binary mesh file '%s'.", UCS2toSysString(actual_file_name).c_str());
+
+    EXPECT
+        CASE(TEXTURE_LIST_TOKEN)
+            if (number_of_textures>0)
+                Error("Only one texture_list section is allowed in mesh2");
+            Parse_Mesh2_Texture_List(Textures, number_of_textures);
+        END_CASE
+
+        CASE(INSIDE_VECTOR_TOKEN)
+            Parse_Vector(Inside_Vect);
+            found_inside_vector = true;
+        END_CASE
+
+        OTHERWISE
+            UNGET
+            EXIT
+        END_CASE
+    END_EXPECT
+
+    Object->Textures = Textures;
+    Object->Number_Of_Textures = number_of_textures;
+
+    if (number_of_textures < number_of_required_textures)
+        Error("Binary mesh file references %d textures, but texture_list holds only %d.",
+              int(number_of_required_textures), number_of_textures);
+
+    if (number_of_textures)
+    {
+        Set_Flag(Object, MULTITEXTURE_FLAG);
+    }
+
+    /* An inside vector in the scene file takes precedence over the one in the file. */
+    if (found_inside_vector)
+    {
+        if( (fabs(Inside_Vect[X]) < EPSILON) &&  (fabs(Inside_Vect[Y]) < EPSILON) &&  (fabs(Inside_Vect[Z]) < EPSILON))
+        {
+            Object->has_inside_vector=false;
+            Object->Type |= PATCH_OBJECT;
+        }
+        else
+        {
+            Object->Data->Inside_Vect = Inside_Vect.normalized();
+            Object->has_inside_vector=true;
+            Object->Type &= ~PATCH_OBJECT;
+        }
+    }
+}
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Find_Mesh2_Snapshot
+*
+* INPUT
+*
+*   Object - mesh to receive the data
+*
+* OUTPUT
+*
+*   snapshot - where to put the data if it needs to be parsed
+*
+* RETURNS
+*
+*   true if the mesh data has been taken from the mesh cache directory
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Look for a snapshot of the upcoming mesh2 body in the mesh cache
+*   directory, as written by an earlier parse of the same input, possibly on
+*   a different machine. Snapshots are binary mesh files, accompanied by a
+*   small file identifying the stretch of input they were parsed from; the
+*   input is checked against it before the snapshot is used, and the body is
+*   then skipped in its entirety.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+/// Identifies the input a mesh snapshot was parsed from.
+struct MeshSnapshotHeader final
+{
+    char        magic[8];
+    POV_UINT32  version;
+    POV_UINT32  reserved;
+    POV_INT64   start;
+    POV_INT64   endLine;
+    POV_INT64   endColumn;
+    POV_INT64   endOffset;
+    POV_INT64   tokenCount;
+    POV_UINT64  sourceHash;
+};
+
+static const char       kMeshSnapshotMagic[8]   = { 'P', 'O', 'V', 'M', 'S', 'N', 'A', 'P' };
+static const POV_UINT32 kMeshSnapshotVersion    = 1;
+
+static bool HashMeshSnapshotSource(const UCS2String& sourceName, POV_OFF_T start, POV_OFF_T end, POV_UINT64& hash)
+{
+    if (end <= start)
+        return false;
+
+    std::unique_ptr<IStream> file(NewIStream(Path(sourceName), POV_File_Text_POV));
+    if ((file == nullptr) || !file->seekg(start))
+        return false;
+
+    std::vector<unsigned char> buffer(65536);
+    hash = kDeclarationHashSeed;
+    for (POV_OFF_T remaining = end - start; remaining > 0; )
+    {
+        size_t count = size_t(std::min<POV_OFF_T>(remaining, POV_OFF_T(buffer.size())));
+        if (!file->read(buffer.data(), count))
+            return false;
+        hash = HashDeclarationData(hash, buffer.data(), count);
+        remaining -= POV_OFF_T(count);
+    }
+    return true;
+}
+
+bool Parser::Find_Mesh2_Snapshot(Mesh* Object, MeshSnapshot& snapshot)
+{
+    snapshot.fileName.clear();
+    snapshot.write = false;
+
+    if (sceneData->meshCachePath.empty())
+        return false;
+
+    // Only literal bodies starting in a plain input file are eligible; anything else (e.g. the
+    // mesh data coming from a macro) is caught while parsing the body.
+    Get_Token();
+    Unget_Token();
+    if ((CurrentTrueTokenId() != VERTEX_VECTORS_TOKEN) || mToken.ungetRaw || mHavePendingRawToken ||
+        (mToken.sourceFile == nullptr) || (mToken.sourceFile != mTokenizer.GetInputStream()))
+        return false;
+
+    snapshot.sourceName = mToken.sourceFile->Name();
+    snapshot.start      = mToken.raw.lexeme.position.offset;
+
+    POV_UINT64 key = kDeclarationHashSeed;
+    key = HashDeclarationData(key, snapshot.sourceName.data(), snapshot.sourceName.size() * sizeof(UCS2));
+    key = HashDeclarationValue(key, snapshot.start);
+    key = HashDeclarationValue(key, sceneData->EffectiveLanguageVersion());
+
+    char name[32];
+    std::snprintf(name, sizeof(name), "mesh-%016llx", (unsigned long long)key);
+
+    Path path(sceneData->meshCachePath);
+    if (!path.GetFile().empty())
+        path.AppendFolder(path.GetFile());
+    path.SetFile(name);
+    snapshot.fileName = path();
+
+    // Check that the snapshot was taken from the very same input.
+
+    MeshSnapshotHeader header;
+    std::unique_ptr<IStream> headerFile(NewIStream(Path(snapshot.fileName + ASCIItoUCS2String(".pms")), POV_File_Data_PMB));
+    if ((headerFile == nullptr) || !headerFile->read(&header, sizeof(header)) ||
+        (memcmp(header.magic, kMeshSnapshotMagic, sizeof(header.magic)) != 0) ||
+        (header.version != kMeshSnapshotVersion) || (header.start != snapshot.start) || (header.tokenCount < 0))
+        return false;
+    headerFile.reset();
+
+    POV_UINT64 sourceHash;
+    if (!HashMeshSnapshotSource(snapshot.sourceName, snapshot.start, header.endOffset, sourceHash) ||
+        (sourceHash != header.sourceHash))
+        return false;
+
+    std::unique_ptr<pov_base::Filesystem::MappedFile> file(new pov_base::Filesystem::MappedFile);
+    MeshIndex number_of_required_textures;
+    if (!file->Open(snapshot.fileName + ASCIItoUCS2String(".pmb")) ||
+        !Object->Map_Mesh_File(file, number_of_required_textures) || (number_of_required_textures != 0))
+        return false;
+
+    // Skip the body, preferably staying with the cached tokens of the input file.
+
+    LexemePosition end;
+    end.line   = header.endLine;
+    end.column = header.endColumn;
+    end.offset = header.endOffset;
+
+    mToken.Unget_Token = false;
+
+    CachedTokenPosition resume;
+    if (!mTokenizer.GetReplayPosition(resume, end) || !mTokenizer.SkipReplay(resume))
+    {
+        RawTokenizer::HotBookmark bookmark(GetHotBookmark());
+        static_cast<LexemePosition&>(bookmark) = end;
+        if (!GoToBookmark(bookmark))
+            Error("Cannot resume parsing after mesh data from the mesh cache directory.");
+    }
+
+    mTokenCount += header.tokenCount;
+    ++sceneData->meshCacheHits;
+    return true;
+}
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Finish_Mesh2_Snapshot
+*
+* INPUT
+*
+*   Object - mesh just parsed
+*
+* OUTPUT
+*
+*   snapshot - whether and where to put the data
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Decide whether a freshly parsed mesh2 body can be shared via the mesh
+*   cache directory. This is the case if it consisted of nothing but literal
+*   data from a single stretch of input, so that the same input will always
+*   give the same mesh.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+void Parser::Finish_Mesh2_Snapshot(const Mesh* Object, MeshSnapshot& snapshot)
+{
+    POV_PARSER_ASSERT(!maDeclarationScopes.empty());
+    DeclarationScope scope(std::move(maDeclarationScopes.back()));
+    maDeclarationScopes.pop_back();
+
+    // We also need a look-ahead token to resume at.
+    snapshot.write = scope.reusable && scope.reads.empty() && scope.written.empty() &&
+                     (Object->Number_Of_Textures == 0) &&
+                     (Cond_Stack.size() == scope.condStackSize) && (maBraceStack.size() == scope.braceStackSize) &&
+                     (maIncludeStack.size() == scope.includeStackSize) && (mTokenizer.GetInputStream() == scope.stream) &&
+                     mToken.Unget_Token && !mToken.ungetRaw && !mHavePendingRawToken && !mToken.End_Of_File &&
+                     (mToken.sourceFile == scope.stream) && (mToken.raw.lexeme.position.offset > snapshot.start);
+    if (!snapshot.write)
+        return;
+
+    snapshot.end        = mToken.raw.lexeme.position;
+    snapshot.tokenCount = mTokenCount - scope.tokenCount - 1;
+}
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Write_Mesh2_Snapshot
+*
+* INPUT
+*
+*   Object - mesh to write, complete with bounding box tree
+*   snapshot - where to put the data
+*
+* OUTPUT
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Put a mesh into the mesh cache directory. The identifying file is
+*   written last, so that other parses never pick up an incomplete snapshot.
+*   Failure is not an error; the mesh will just be parsed again next time.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+void Parser::Write_Mesh2_Snapshot(const Mesh* Object, const MeshSnapshot& snapshot)
+{
+    MeshSnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, kMeshSnapshotMagic, sizeof(header.magic));
+    header.version    = kMeshSnapshotVersion;
+    header.start      = snapshot.start;
+    header.endLine    = snapshot.end.line;
+    header.endColumn  = snapshot.end.column;
+    header.endOffset  = snapshot.end.offset;
+    header.tokenCount = snapshot.tokenCount;
+
+    if (!HashMeshSnapshotSource(snapshot.sourceName, snapshot.start, snapshot.end.offset, header.sourceHash))
+        return;
+
+    UCS2String headerFileName(snapshot.fileName + ASCIItoUCS2String(".pms"));
+    (void)pov_base::Filesystem::DeleteFile(headerFileName);
+
+    {
+        std::unique_ptr<OStream> file(NewOStream(Path(snapshot.fileName + ASCIItoUCS2String(".pmb")), POV_File_Data_PMB, false));
+        if ((file == nullptr) || !Object->Write_Mesh_File(*file))
+            return;
+    }
+
+    std::unique_ptr<OStream> headerFile(NewOStream(Path(headerFileName), POV_File_Data_PMB, false));
+    if ((headerFile == nullptr) || !headerFile->write(&header, sizeof(header)))
+        return;
+
+    ++sceneData->meshCacheWrites;
+}
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Parse_Mesh_Texture
+*
+* INPUT
+*
+* OUTPUT
+*
+* RETURNS
+*
+*   OBJECT
+*
+* AUTHOR
+*
+*   Dieter Bayer
+*
+* DESCRIPTION
+*
+*   Read an individual triangle mesh texture.
+*
+* CHANGES
+*
+*   Feb 1995 : Creation.
+*
+******************************************************************************/
+
+TEXTURE *Parser::Parse_Mesh_Texture (TEXTURE **t2, TEXTURE **t3)
+{
+    TEXTURE *Texture;
+
+    Texture = nullptr;
+
+    EXPECT
+        CASE(TEXTURE_TOKEN)
+            Parse_Begin();
+
+            GET(TEXTURE_ID_TOKEN);
 
             Texture = CurrentTokenDataPtr<TEXTURE*>();
 
@@ -5721,16 +6582,113 @@ ObjectPtr Parser::Parse_Parametric(void)
     Parse_Object_Mods(reinterpret_cast<ObjectPtr>(Object));
 
     if(PrecompFlag != 0)
-        Object->Precompute_Parametric_Values(PrecompFlag, PrecompDepth, GetParserDataPtr());
+        Precompute_Parametric(Object, PrecompFlag, PrecompDepth);
 
     return (reinterpret_cast<ObjectPtr>(Object));
 }
 
-//******************************************************************************
-
-ObjectPtr Parser::Parse_Plane ()
-{
-    DBL len;
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Precompute_Parametric
+*
+* INPUT
+*
+*   Object - parametric to precompute the function bounds of
+*   flags, depth - as specified by the `precompute` keyword
+*
+* OUTPUT
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Parametrics with the same functions and parameters share a single set
+*   of bounds, which is also kept in the mesh cache directory if one is
+*   set, so that later parses can pick it up from there. Bounds that need
+*   to be computed are computed using the mesh import threads.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+void Parser::Precompute_Parametric(Parametric* Object, char flags, int depth)
+{
+    POV_UINT64 key;
+    UCS2String fileName;
+
+    bool keyed = Object->Get_Precompute_Key(flags, depth, key);
+    if (keyed)
+    {
+        auto i = maParametricPrecomputes.find(key);
+        if (i != maParametricPrecomputes.end())
+        {
+            Object->Set_Precomputed_Values(i->second);
+            return;
+        }
+
+        if (!sceneData->meshCachePath.empty())
+        {
+            char name[32];
+            std::snprintf(name, sizeof(name), "param-%016llx.ppv", (unsigned long long)key);
+
+            Path path(sceneData->meshCachePath);
+            if (!path.GetFile().empty())
+                path.AppendFolder(path.GetFile());
+            path.SetFile(name);
+            fileName = path();
+
+            std::unique_ptr<IStream> file(NewIStream(Path(fileName), POV_File_Data_PMB));
+            if ((file != nullptr) && Object->Read_Precomputed_Values(*file, flags, depth, key))
+            {
+                maParametricPrecomputes[key] = Object->Get_Precomputed_Values();
+                return;
+            }
+        }
+    }
+
+    std::vector<std::unique_ptr<TraceThreadData>> helpers;
+    std::vector<TraceThreadData*> threads(1, GetParserDataPtr());
+    for (unsigned int i = 1; i < mImportThreads; i++)
+    {
+        helpers.emplace_back(new TraceThreadData(sceneData, i));
+        threads.push_back(helpers.back().get());
+    }
+
+    Object->Precompute_Parametric_Values(flags, depth, threads);
+
+    for (auto& helper : helpers)
+        GetParserDataPtr()->Stats() += helper->Stats();
+
+    if (!keyed)
+        return;
+
+    maParametricPrecomputes[key] = Object->Get_Precomputed_Values();
+
+    // Failure to write the file is not an error; the bounds will just be computed again next time.
+    if (!fileName.empty())
+    {
+        UCS2String tempName(fileName + ASCIItoUCS2String(".tmp"));
+        bool ok;
+        {
+            std::unique_ptr<OStream> file(NewOStream(Path(tempName), POV_File_Data_PMB, false));
+            ok = (file != nullptr) && Object->Write_Precomputed_Values(*file, key);
+        }
+        if (!ok || !pov_base::Filesystem::RenameFile(tempName, fileName))
+            (void)pov_base::Filesystem::DeleteFile(tempName);
+    }
+}
+
+//******************************************************************************
+
+ObjectPtr Parser::Parse_Plane ()
+{
+    DBL len;
     Plane *Object;
 
     Parse_Begin ();
@@ -5956,6 +6914,123 @@ ObjectPtr Parser::Parse_Polygon()
 
 
 
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Parse_Primitive_Soup
+*
+* INPUT
+*
+* OUTPUT
+*
+* RETURNS
+*
+*   ObjectPtr  -
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Parse a collection of spheres, boxes and cylinders:
+*
+*   primitive_soup {
+*       sphere { <Center>, Radius }
+*       box { <Corner1>, <Corner2> }
+*       cylinder { <Base>, <Apex>, Radius [open] }
+*       ...
+*       [OBJECT_MODIFIERS...]
+*   }
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+ObjectPtr Parser::Parse_Primitive_Soup()
+{
+    PrimitiveSoup *Object;
+    Vector3d P1, P2;
+    DBL r;
+    bool open;
+
+    Parse_Begin();
+
+    Object = reinterpret_cast<PrimitiveSoup *>(Parse_Object_Id());
+    if (Object != nullptr)
+        return (reinterpret_cast<ObjectPtr>(Object));
+
+    Object = new PrimitiveSoup();
+    Object->Data = std::make_shared<PrimitiveSoupData>();
+
+    EXPECT
+        CASE (SPHERE_TOKEN)
+            Parse_Begin();
+            Parse_Vector(P1);  Parse_Comma();
+            r = Parse_Float();
+            Parse_End();
+
+            Object->Data->Add(PrimitiveSoupData::kSphere, P1, Vector3d(0.0), fabs(r));
+        END_CASE
+
+        CASE (BOX_TOKEN)
+            Parse_Begin();
+            Parse_Vector(P1);  Parse_Comma();
+            Parse_Vector(P2);
+            Parse_End();
+
+            Object->Data->Add(PrimitiveSoupData::kBox, midpoint(P1, P2),
+                              Vector3d(fabs(P2[X] - P1[X]), fabs(P2[Y] - P1[Y]), fabs(P2[Z] - P1[Z])) * 0.5, 0.0);
+        END_CASE
+
+        CASE (CYLINDER_TOKEN)
+            Parse_Begin();
+            Parse_Vector(P1);  Parse_Comma();
+            Parse_Vector(P2);  Parse_Comma();
+            r = Parse_Float();
+            open = false;
+            EXPECT_ONE
+                CASE (OPEN_TOKEN)
+                    open = true;
+                END_CASE
+
+                OTHERWISE
+                    UNGET
+                END_CASE
+            END_EXPECT
+            Parse_End();
+
+            if ((P2 - P1).lengthSqr() < Sqr(EPSILON))
+                Warning("Degenerate cylinder in primitive soup, base point and apex are identical; ignored.");
+            else
+                Object->Data->Add(open ? PrimitiveSoupData::kOpenCylinder : PrimitiveSoupData::kCylinder,
+                                  midpoint(P1, P2), (P2 - P1) * 0.5, fabs(r));
+        END_CASE
+
+        OTHERWISE
+            UNGET
+            EXIT
+        END_CASE
+    END_EXPECT
+
+    if (Object->Data->size() == 0)
+        Error("Primitive soup needs at least one sphere, box or cylinder.");
+
+    // Create bounding box tree and bounding box.
+
+    Object->Data->Build();
+    Object->Compute_BBox();
+
+    // Parse object modifiers.
+
+    Parse_Object_Mods(reinterpret_cast<ObjectPtr>(Object));
+
+    return (reinterpret_cast<ObjectPtr>(Object));
+}
+
+
+
 /*****************************************************************************
 *
 * FUNCTION
@@ -6320,6 +7395,7 @@ ObjectPtr Parser::Parse_Rational_Bezier_Patch()
     RationalBezierPatch *Object;
     size_t xdim, ydim;
     VECTOR_4D vector4d;
+    DBL Tolerance = 0.0;
 
     Parse_Begin();
 
@@ -6342,6 +7418,13 @@ ObjectPtr Parser::Parse_Rational_Bezier_Patch()
         CASE(ACCURACY_TOKEN)
             Object->setAccuracy ( Parse_Float() );
         END_CASE
+        CASE(TESSELATE_TOKEN)
+            Tolerance = Parse_Float();
+            if( Tolerance <= 0.0 )
+            {
+                Error( "Tesselation tolerance must be positive." );
+            }
+        END_CASE
         OTHERWISE
             UNGET
             EXIT
@@ -6363,6 +7446,11 @@ ObjectPtr Parser::Parse_Rational_Bezier_Patch()
         }
     }
 
+    if( Tolerance > 0.0 )
+    {
+        return Parse_Tessellated_Patch( Object, *Object, Tolerance );
+    }
+
     Object->Compute_BBox();
     Parse_Object_Mods (reinterpret_cast<ObjectPtr>(Object));
     return (reinterpret_cast<ObjectPtr>(Object));
@@ -6402,6 +7490,7 @@ ObjectPtr Parser::Parse_Nurbs()
     size_t xorder,yorder,xdim, ydim;
     VECTOR_4D vector4d;
     DBL value;
+    DBL Tolerance = 0.0;
     Parse_Begin();
 
     xorder = Parse_Float();
@@ -6423,6 +7512,20 @@ ObjectPtr Parser::Parse_Nurbs()
     }
 
     Object = new Nurbs(xdim, ydim, xorder, yorder);
+    EXPECT
+        CASE(TESSELATE_TOKEN)
+            Tolerance = Parse_Float();
+            Parse_Comma();
+            if( Tolerance <= 0.0 )
+            {
+                Error( "Tesselation tolerance must be positive." );
+            }
+        END_CASE
+        OTHERWISE
+            UNGET
+            EXIT
+        END_CASE
+    END_EXPECT
     // get the u knots
     for( size_t i = 0; i < (xdim+xorder); ++i )
     {
@@ -6447,6 +7550,11 @@ ObjectPtr Parser::Parse_Nurbs()
         }
     }
 
+    if( Tolerance > 0.0 )
+    {
+        return Parse_Tessellated_Patch( Object, *Object, Tolerance );
+    }
+
     Object->Compute_BBox();
     Parse_Object_Mods (reinterpret_cast<ObjectPtr>(Object));
 
@@ -6637,6 +7745,7 @@ ObjectPtr Parser::Parse_Sor()
     if (Object->Spline->BCyl->number > sceneData->Max_Bounding_Cylinders)
     {
         TraceThreadData *td = GetParserDataPtr();
+        NoteSideEffect();
         sceneData->Max_Bounding_Cylinders = Object->Spline->BCyl->number;
         td->BCyl_Intervals.reserve(4*sceneData->Max_Bounding_Cylinders);
         td->BCyl_RInt.reserve(2*sceneData->Max_Bounding_Cylinders);
@@ -6841,6 +7950,17 @@ ObjectPtr Parser::Parse_Superellipsoid()
     Object->Power[Y] = V1[X] / V1[Y];
     Object->Power[Z] = 2.0  / V1[Y];
 
+    EXPECT
+        CASE(METHOD_TOKEN)
+            Object->Method = Parse_Int_With_Range(1, 2, "superellipsoid method");
+        END_CASE
+
+        OTHERWISE
+            UNGET
+            EXIT
+        END_CASE
+    END_EXPECT
+
     /* Compute bounding box. */
 
     Object->Compute_BBox();
@@ -7249,6 +8369,9 @@ TrueTypeFont *Parser::OpenFontFile(const char *asciifn, const int font_id, POV_U
     UCS2String ign;
     UCS2String formalFilename;
 
+    // Fonts are shared via the scene data.
+    NoteSideEffect();
+
     if (asciifn != nullptr)
     {
         formalFilename = SysToUCS2String(asciifn);
@@ -7312,11 +8435,68 @@ TrueTypeFont *Parser::OpenFontFile(const char *asciifn, const int font_id, POV_U
     return font;
 }
 
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Source_File_Index
+*
+* INPUT
+*
+*   name - name of a source file
+*
+* OUTPUT
+*
+* RETURNS
+*
+*   unsigned int - index of the file in the scene's list of source files
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Look up a source file in the list kept for the object profile, adding it
+*   if not present yet. Scenes are rarely spread across more than a few files,
+*   and consecutive objects usually come from the same one, so a linear search
+*   after checking the most recently added file will do.
+*
+* CHANGES
+*
+******************************************************************************/
+
+unsigned int Parser::Source_File_Index (const UCS2 *name)
+{
+    vector<UCS2String>& files = sceneData->sourceFiles;
+
+    if (!files.empty() && (files.back() == name))
+        return (unsigned int)(files.size() - 1);
+
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        if (files[i] == name)
+            return (unsigned int)i;
+    }
+
+    files.push_back(name);
+    return (unsigned int)(files.size() - 1);
+}
+
 //******************************************************************************
 
 ObjectPtr Parser::Parse_Object ()
 {
     ObjectPtr Object = nullptr;
+    unsigned int sourceFile = 0;
+    POV_LONG sourceLine = 0;
+
+    // note where the object starts, for the object profile
+    Get_Token();
+    if (HaveCurrentFile())
+    {
+        sourceFile = Source_File_Index(CurrentFileName());
+        sourceLine = CurrentFilePosition().line;
+    }
+    Unget_Token();
 
     EXPECT_ONE
 
@@ -7414,6 +8594,10 @@ ObjectPtr Parser::Parse_Object ()
             Object = Parse_Polyline();
         END_CASE
 
+        CASE (PRIMITIVE_SOUP_TOKEN)
+            Object = Parse_Primitive_Soup();
+        END_CASE
+
         CASE (PRISM_TOKEN)
             Object = Parse_Prism();
         END_CASE
@@ -7600,6 +8784,12 @@ ObjectPtr Parser::Parse_Object ()
         END_CASE
     END_EXPECT
 
+    if (Object && (sourceLine > 0))
+    {
+        Object->sourceFile = sourceFile;
+        Object->sourceLine = (unsigned int)sourceLine;
+    }
+
     if (Object && !Object->Precompute())
         PossibleError("Inconsistent object parameters.");
 
@@ -7757,7 +8947,7 @@ void Parser::Parse_Frame ()
         CASE (CAMERA_TOKEN)
             if (sceneData->EffectiveLanguageVersion() >= 350)
             {
-                if (sceneData->clocklessAnimation == false)
+                if ((sceneData->clocklessAnimation == false) && (sceneData->multiCamera == false))
                 {
                     if (had_camera == true)
                         Warning("More than one camera in scene. Ignoring previous camera(s).");
@@ -7767,7 +8957,7 @@ void Parser::Parse_Frame ()
             }
 
             Parse_Camera(sceneData->parsedCamera);
-            if (sceneData->clocklessAnimation == true)
+            if ((sceneData->clocklessAnimation == true) || (sceneData->multiCamera == true))
                 sceneData->cameras.push_back(sceneData->parsedCamera);
         END_CASE
 
@@ -7814,7 +9004,9 @@ void Parser::Parse_Frame ()
         END_CASE
 
         CASE (DEFAULT_TOKEN)
+            BeginEnvironmentChange();
             Parse_Default();
+            EndEnvironmentChange();
         END_CASE
 
         CASE (END_OF_FILE_TOKEN)
@@ -7822,7 +9014,9 @@ void Parser::Parse_Frame ()
         END_CASE
 
         CASE (GLOBAL_SETTINGS_TOKEN)
+            BeginEnvironmentChange();
             Parse_Global_Settings();
+            EndEnvironmentChange();
         END_CASE
 
         CASE (GTS_SAVE_TOKEN)
@@ -7836,17 +9030,50 @@ void Parser::Parse_Frame ()
 
         OTHERWISE
             UNGET
-            Object = Parse_Object();
-            if (Object == nullptr)
-                Expectation_Error ("object or directive");
-            Post_Process (Object, nullptr);
-            Link_To_Frame (Object);
+            if (mFingerprintContent)
+            {
+                // The token just put back belongs to the object rather than the environment.
+                maContentFingerprints.back().hash = maContentFingerprints.back().undo;
+                BeginContentFingerprint();
+            }
+            {
+                size_t oldObjectCount = sceneData->objects.size();
+                size_t oldLightCount  = sceneData->lightSources.size();
+                Object = Parse_Object();
+                if (Object == nullptr)
+                    Expectation_Error ("object or directive");
+                Post_Process (Object, nullptr);
+                Link_To_Frame (Object);
+                if (mFingerprintContent)
+                    Fingerprint_Frame_Objects(oldObjectCount, (sceneData->lightSources.size() != oldLightCount), EndContentFingerprint());
+            }
         END_CASE
     END_EXPECT
 }
 
 //******************************************************************************
 
+/// Record the content fingerprints of the objects just linked to the frame.
+///
+/// @param[in]  first       Index of the first object in @ref SceneData::objects to fingerprint.
+/// @param[in]  lights      Whether the objects have added global light sources.
+/// @param[in]  content     Fingerprint of the input the objects were parsed from.
+///
+void Parser::Fingerprint_Frame_Objects(size_t first, bool lights, const ContentFingerprint& content)
+{
+    // Split unions yield more than one object per fingerprint.
+    for (size_t i = first; i < sceneData->objects.size(); ++i)
+    {
+        ConstObjectPtr object = sceneData->objects[i];
+        SceneData::ObjectFingerprint& entry = sceneData->objectFingerprints[object];
+        entry.fingerprint = HashDeclarationValue(content.hash, POV_UINT64(i - first));
+        entry.stable      = content.stable;
+        entry.global      = lights || Test_Flag(object, INFINITE_FLAG) || ((object->Type & LIGHT_SOURCE_OBJECT) != 0);
+    }
+}
+
+//******************************************************************************
+
 void Parser::Parse_Global_Settings()
 {
     Parse_Begin();
@@ -7953,6 +9180,31 @@ void Parser::Parse_Global_Settings()
             sceneData->explicitNoiseGenerator = true;
         END_CASE
 
+        CASE (PATTERN_CACHE_TOKEN)
+            sceneData->patternCache = (Allow_Float(1.0) > 0.0);
+        END_CASE
+
+        CASE (CRACKLE_CACHE_TOKEN)
+        {
+            DBL megabytes = Parse_Float();
+            if (megabytes <= 0.0)
+                Error("crackle_cache memory limit must be positive.");
+            sceneData->crackleCache = std::make_shared<CrackleCache>((size_t)(megabytes * 1024.0 * 1024.0));
+        }
+        END_CASE
+
+        CASE (TEXTURE_CACHE_TOKEN)
+        {
+            DBL megabytes = Parse_Float();
+            if (megabytes < 0.0)
+                Error("texture_cache memory limit must not be negative.");
+            if (megabytes > 0.0)
+                sceneData->textureCache = std::make_shared<TextureCache>((size_t)(megabytes * 1024.0 * 1024.0));
+            else
+                sceneData->textureCache.reset();
+        }
+        END_CASE
+
         CASE (AMBIENT_LIGHT_TOKEN)
             Parse_Colour (sceneData->ambientLight);
         END_CASE
@@ -7984,6 +9236,13 @@ void Parser::Parse_Global_Settings()
             sceneData->photonSettings.surfaceCount = 0;
             //  sceneData->photonSettings.globalCount = 0;
 
+            sceneData->photonSettings.progressivePasses = 1;
+            sceneData->photonSettings.progressiveAlpha = 0.7;
+
+            sceneData->photonSettings.importance = 1.0;
+
+            sceneData->photonSettings.precomputeStride = 0;
+
             sceneData->surfacePhotonMap.minGatherRad = -1;
 
             Parse_Begin();
@@ -8042,6 +9301,28 @@ void Parser::Parse_Global_Settings()
                     sceneData->photonSettings.autoStopPercent = Parse_Float();
                 END_CASE
 
+                CASE (PROGRESSIVE_TOKEN)
+                    sceneData->photonSettings.progressivePasses = (int)Parse_Float();
+                    Parse_Comma();
+                    sceneData->photonSettings.progressiveAlpha = Allow_Float(0.7);
+                    if (sceneData->photonSettings.progressivePasses < 1)
+                        Error("progressive pass count must be at least 1.");
+                    if ((sceneData->photonSettings.progressiveAlpha <= 0.0) || (sceneData->photonSettings.progressiveAlpha > 1.0))
+                        Error("progressive alpha must be greater than 0 and at most 1.");
+                END_CASE
+
+                CASE (IMPORTANCE_TOKEN)
+                    sceneData->photonSettings.importance = Parse_Float();
+                    if ((sceneData->photonSettings.importance <= 0.0) || (sceneData->photonSettings.importance > 1.0))
+                        Error("photon importance must be greater than 0 and at most 1.");
+                END_CASE
+
+                CASE (PRECOMPUTE_TOKEN)
+                    sceneData->photonSettings.precomputeStride = (int)Parse_Float();
+                    if (sceneData->photonSettings.precomputeStride < 0)
+                        Error("photon precompute stride cannot be negative.");
+                END_CASE
+
                 CASE (ADC_BAILOUT_TOKEN)
                     sceneData->photonSettings.adcBailout = Parse_Float ();
                 END_CASE
@@ -8283,6 +9564,21 @@ void Parser::Parse_Global_Settings()
                     sceneData->radiositySettings.brilliance = ((int)Parse_Float() != 0);
                 END_CASE
 
+                CASE (JITTER_TOKEN)
+                    sceneData->radiositySettings.jitter = ((int)Allow_Float(1.0) != 0);
+                END_CASE
+
+                CASE (GRADIENT_TOKEN)
+                    sceneData->radiositySettings.gradient = ((int)Allow_Float(1.0) != 0);
+                END_CASE
+
+                CASE (ADAPTIVE_TOKEN)
+                    if ((sceneData->radiositySettings.adaptive = Parse_Float()) < 0.0)
+                    {
+                        Error("Radiosity adaptive error must not be negative.");
+                    }
+                END_CASE
+
                 OTHERWISE
                     UNGET
                     EXIT
@@ -8316,7 +9612,19 @@ void Parser::Parse_Global_Settings()
                     sceneData->subsurfaceUseRadiosity = ((int)Parse_Float() != 0);
                 END_CASE
 
-                OTHERWISE
+                CASE (COUNT_TOKEN)
+                    sceneData->subsurfacePointCount = (int)Parse_Float();
+                    if (sceneData->subsurfacePointCount < 0)
+                        Error("Subsurface point count must not be negative.");
+                END_CASE
+
+                CASE (ERROR_BOUND_TOKEN)
+                    sceneData->subsurfaceErrorBound = Parse_Float();
+                    if (sceneData->subsurfaceErrorBound <= 0.0)
+                        Error("Subsurface error bound must be positive.");
+                END_CASE
+
+                OTHERWISE
                     UNGET
                     EXIT
                 END_CASE
@@ -8920,6 +10228,7 @@ TRANSFORM *Parser::Parse_Transform_Block(TRANSFORM *New)
     {
         MInvers(New->matrix, New->matrix);
         MInvers(New->inverse, New->inverse);
+        Classify_Transform(New);
     }
 
     return (New);
@@ -9153,6 +10462,8 @@ void Parser::Parse_Declare(bool is_local, bool after_hash)
     TokenId* numberPtr = nullptr;
     void** dataPtr = nullptr;
     bool optional = false;
+    SYM_ENTRY *targetEntry = nullptr;
+    bool reused = false;
 
     POV_EXPERIMENTAL_ASSERT(IsOkToDeclare());
     SetOkToDeclare(false);
@@ -9215,6 +10526,7 @@ void Parser::Parse_Declare(bool is_local, bool after_hash)
 
         EXPECT
             CASE (DEPRECATED_TOKEN)
+                NoteSideEffect();
                 deprecated = true;
                 ALLOW(ONCE_TOKEN);
                 if (CurrentTrueTokenId() == ONCE_TOKEN)
@@ -9354,10 +10666,47 @@ void Parser::Parse_Declare(bool is_local, bool after_hash)
         POV_PARSER_ASSERT((numberPtr != nullptr) || (mToken.NumberPtr == nullptr));
         POV_PARSER_ASSERT((dataPtr != nullptr) || (mToken.DataPtr == nullptr));
 
+        if ((dataPtr != nullptr) && !CurrentTokenIsArrayElement() &&
+            ((Temp_Entry == nullptr) || (Temp_Entry->Token_Number != DUMMY_SYMBOL_TOKEN)))
+        {
+            // Whatever value the symbol will hold, it will no longer be the outcome of a tracked
+            // declaration (unless it is again).
+            bool dictionaryElement = CurrentTokenIsDictionaryElement();
+            int symbolIndex = ((Temp_Entry != nullptr) ? Local_Index : mToken.context);
+            SYM_ENTRY *symbol = Temp_Entry;
+            if ((symbol == nullptr) && dictionaryElement)
+                symbol = mToken.table->Find_Symbol(CurrentTokenText().c_str());
+            else if (symbol == nullptr)
+                symbol = mSymbolStack.Find_Symbol(symbolIndex, CurrentTokenText().c_str());
+            if ((symbol != nullptr) && (&(symbol->Data) == dataPtr))
+            {
+                symbol->fingerprintData = nullptr;
+                symbol->contentFingerprintData = nullptr;
+                if (!dictionaryElement)
+                {
+                    if (!maDeclarationScopes.empty())
+                        NoteSymbolWrite(CurrentTokenText(), symbolIndex);
+                    if (!tupleDeclare && !lvectorDeclare && !larrayDeclare)
+                        targetEntry = symbol;
+                }
+            }
+            else if (!dictionaryElement)
+                NoteSideEffect();
+        }
+
         LValue lvalue;
         lvalue.numberPtr = numberPtr;
         lvalue.dataPtr = dataPtr;
         lvalue.symEntry = Temp_Entry;
+        lvalue.array = nullptr;
+        lvalue.arrayIndex = 0;
+        if (CurrentTokenIsArrayElement() && (dataPtr == mToken.DataPtr))
+        {
+            // Elements held in an array's contiguous storage can't be replaced as they are.
+            lvalue.array = mToken.array;
+            lvalue.arrayIndex = mToken.arrayIndex;
+            lvalue.array->MakeElementSparse(lvalue.arrayIndex);
+        }
         lvalue.previous = Previous;
         lvalue.allowRedefine = allow_redefine;
         lvalue.optional = optional;
@@ -9443,11 +10792,40 @@ void Parser::Parse_Declare(bool is_local, bool after_hash)
     }
     else
     {
+        DeclarationKey declarationKey;
+        bool tracked = false;
+
+        if (mReuseDeclarations && (targetEntry != nullptr) && after_hash && !deprecated && GetDeclarationKey(declarationKey))
+        {
+            DeclarationResult cached;
+            if (FindCachedDeclaration(declarationKey,
+                                      [this](const DeclarationRead& read, POV_UINT64& fingerprint) { return GetReadFingerprint(fingerprint, read); },
+                                      cached) &&
+                ReuseDeclaration(cached))
+            {
+                numberPtr = lvalues[0].numberPtr;
+                dataPtr = lvalues[0].dataPtr;
+                *numberPtr = cached.type;
+                Test_Redefine(lvalues[0].previous, numberPtr, *dataPtr, lvalues[0].allowRedefine);
+                *dataPtr = cached.data;
+                cached.data = nullptr;
+                targetEntry->fingerprintData = targetEntry->Data;
+                targetEntry->fingerprint = cached.fingerprint;
+                ++mDeclarationsReused;
+                reused = true;
+            }
+            else
+            {
+                BeginTrackedDeclaration(&declarationKey);
+                tracked = true;
+            }
+        }
+
         if (tupleDeclare)
         {
             Parse_Paren_Begin();
         }
-        for (int i = 0; i < lvalues.size(); ++i)
+        for (int i = 0; (i < lvalues.size()) && !reused; ++i)
         {
             numberPtr = lvalues[i].numberPtr;
             dataPtr = lvalues[i].dataPtr;
@@ -9461,7 +10839,14 @@ void Parser::Parse_Declare(bool is_local, bool after_hash)
                 GET (COMMA_TOKEN)
             }
             bool finalParameter = (i == lvalues.size()-1);
-            if (!Parse_RValue (Previous, numberPtr, dataPtr, Temp_Entry, false, !tupleDeclare, is_local, allow_redefine, true, MAX_NUMBER_OF_TABLES))
+            mContentTarget = targetEntry;
+            bool haveRValue = Parse_RValue (Previous, numberPtr, dataPtr, Temp_Entry, false, !tupleDeclare, is_local, allow_redefine, true, MAX_NUMBER_OF_TABLES);
+            if (tracked)
+            {
+                EndTrackedDeclaration(haveRValue ? targetEntry : nullptr);
+                ++mDeclarationsEvaluated;
+            }
+            if (!haveRValue)
             {
                 EXPECT_ONE
                     CASE (IDENTIFIER_TOKEN)
@@ -9499,6 +10884,12 @@ void Parser::Parse_Declare(bool is_local, bool after_hash)
         }
     }
 
+    for (auto& lvalue : lvalues)
+    {
+        if (lvalue.array != nullptr)
+            lvalue.array->MakeElementDense(lvalue.arrayIndex);
+    }
+
     // discard any dummy symbol entries we may have created as stand-in for omitted identifiers
     // in tuple-style declarations
     for (vector<LValue>::iterator i = lvalues.begin(); i != lvalues.end(); ++i)
@@ -9554,10 +10945,23 @@ bool Parser::Parse_RValue (TokenId Previous, TokenId *NumberPtr, void **DataPtr,
     bool had_callable_identifier;
     SYM_ENTRY* symbol_entry;
     SymbolTable* symbol_entry_table;
+    POV_ARRAY* identifier_array;
 
     bool oldParseOptionalRVaue = parseOptionalRValue;
     parseOptionalRValue = allowUndefined;
 
+    // Symbol to attribute the content fingerprint of the value to.
+    SYM_ENTRY* contentTarget = nullptr;
+    if (mFingerprintContent)
+    {
+        if ((sym != nullptr) && (DataPtr == &(sym->Data)))
+            contentTarget = sym;
+        else if ((mContentTarget != nullptr) && (DataPtr == &(mContentTarget->Data)))
+            contentTarget = mContentTarget;
+        BeginContentFingerprint();
+    }
+    mContentTarget = nullptr;
+
     EXPECT_ONE_CAT
         CASE4 (NORMAL_ID_TOKEN, FINISH_ID_TOKEN, TEXTURE_ID_TOKEN, OBJECT_ID_TOKEN)
         CASE4 (COLOUR_MAP_ID_TOKEN, TRANSFORM_ID_TOKEN, CAMERA_ID_TOKEN, PIGMENT_ID_TOKEN)
@@ -9568,6 +10972,9 @@ bool Parser::Parse_RValue (TokenId Previous, TokenId *NumberPtr, void **DataPtr,
             if ((ParFlag) && PassParameterByReference (old_table_index))
             {
                 // pass by reference
+                if (mToken.is_array_elem)
+                    // The element may be replaced via the parameter at any time.
+                    mToken.array->MakeSparse();
                 New_Par            = reinterpret_cast<POV_PARAM *>(POV_MALLOC(sizeof(POV_PARAM),"parameter"));
                 New_Par->NumberPtr = mToken.NumberPtr;
                 New_Par->DataPtr   = mToken.DataPtr;
@@ -9632,6 +11039,10 @@ bool Parser::Parse_RValue (TokenId Previous, TokenId *NumberPtr, void **DataPtr,
             callable_identifier = function_identifier ||
                                   (CurrentTrueTokenId() == SPLINE_ID_TOKEN);
 
+            // The expression parsing below clears the current token's array element flag, so
+            // remember the array in case the identifier is passed by reference.
+            identifier_array = mToken.is_array_elem ? mToken.array : nullptr;
+
             // don't allow #declares from here
             SetOkToDeclare(false);
 
@@ -9705,6 +11116,9 @@ bool Parser::Parse_RValue (TokenId Previous, TokenId *NumberPtr, void **DataPtr,
                 else
                 {
                     // pass by reference
+                    if (identifier_array != nullptr)
+                        // The element may be replaced via the parameter at any time.
+                        identifier_array->MakeSparse();
                     New_Par            = reinterpret_cast<POV_PARAM *>(POV_MALLOC(sizeof(POV_PARAM),"parameter"));
                     New_Par->NumberPtr = mToken.NumberPtr;
                     New_Par->DataPtr   = mToken.DataPtr;
@@ -9994,6 +11408,24 @@ bool Parser::Parse_RValue (TokenId Previous, TokenId *NumberPtr, void **DataPtr,
 
     SetOkToDeclare(oldOkToDeclare);
     parseOptionalRValue = oldParseOptionalRVaue;
+
+    if (mFingerprintContent)
+    {
+        ContentFingerprint content = EndContentFingerprint();
+        if (contentTarget != nullptr)
+        {
+            contentTarget->contentFingerprintData = (content.stable ? contentTarget->Data : nullptr);
+            contentTarget->contentFingerprint     = content.hash;
+        }
+        else
+        {
+            // We don't know where the value ends up, so attribute it to whatever is being parsed.
+            NoteContent(content.hash);
+            if (!content.stable)
+                NoteUnstableContent();
+        }
+    }
+
     return(Found);
 }
 
@@ -10320,135 +11752,667 @@ void Parser::Post_Process (ObjectPtr Object, ObjectPtr Parent)
             len1 = Light->Axis1.length();
             len2 = Light->Axis2.length();
 
-            if(fabs(len1-len2)>EPSILON)
-            {
-                Warning("When using orient, the two axes of the area light must be of equal length.\nOnly the length of the first axis will be used.");
+            if(fabs(len1-len2)>EPSILON)
+            {
+                Warning("When using orient, the two axes of the area light must be of equal length.\nOnly the length of the first axis will be used.");
+
+                // the equalization is actually done in the lighting code, since only the length of
+                // Axis1 will be used
+
+            }
+
+            if(Light->Area_Size1 != Light->Area_Size2)
+            {
+                Warning("When using orient, the two sample sizes for the area light should be equal.");
+            }
+        }
+
+        // Make sure that circular light sources are larger than 1 by x [ENB 9/97]
+        if (Light->Circular)
+        {
+            if ((Light->Area_Size1 <= 1) || (Light->Area_Size2 <= 1))
+            {
+                Warning("Circular area lights must have more than one sample along each axis.");
+                Light->Circular = false;
+            }
+        }
+    }
+
+    if (Object->Type & LIGHT_SOURCE_OBJECT)
+    {
+        // post-process the light source
+        if ((reinterpret_cast<LightSource *>(Object))->Projected_Through_Object != nullptr)
+        {
+            if ((reinterpret_cast<LightSource *>(Object))->Projected_Through_Object->interior != nullptr)
+            {
+                (reinterpret_cast<LightSource *>(Object))->Projected_Through_Object->interior.reset();
+                Warning("Projected through objects can not have interior, interior removed.");
+            }
+            if ((reinterpret_cast<LightSource *>(Object))->Projected_Through_Object->Texture != nullptr)
+            {
+                Destroy_Textures((reinterpret_cast<LightSource *>(Object))->Projected_Through_Object->Texture);
+                (reinterpret_cast<LightSource *>(Object))->Projected_Through_Object->Texture = nullptr;
+                Warning("Projected through objects can not have texture, texture removed.");
+            }
+        }
+
+        // only global light sources are in Frame.Light_Sources list [trf]
+        if(!(Object->Type & LIGHT_GROUP_LIGHT_OBJECT))
+            // add this light to the frame's list of global light sources
+            sceneData->lightSources.push_back(reinterpret_cast<LightSource *>(Object));
+        else
+            // Put it into the frame's list of light-group lights
+            sceneData->lightGroupLightSources.push_back(reinterpret_cast<LightSource *>(Object));
+    }
+    else
+    {
+        // post-process the object
+
+        // If there is no interior create one.
+
+        if (Object->interior == nullptr)
+        {
+            Object->interior = InteriorPtr(new Interior());
+        }
+
+        // Promote hollow flag to interior.
+
+        Object->interior->hollow = (Test_Flag(Object, HOLLOW_FLAG) != false);
+
+        // Promote finish's IOR to interior IOR.
+
+        if (Object->Texture != nullptr)
+        {
+            if (Object->Texture->Type == PLAIN_PATTERN)
+            {
+                Finish = Object->Texture->Finish;
+                if (Finish != nullptr)
+                {
+                    if (Finish->Temp_IOR >= 0.0)
+                    {
+                        Object->interior->IOR = Finish->Temp_IOR;
+                        Object->interior->Dispersion = Finish->Temp_Dispersion;
+                    }
+                    if (Finish->Temp_Caustics >= 0.0)
+                    {
+                        Object->interior->Caustics = Finish->Temp_Caustics;
+                    }
+
+                    Object->interior->Old_Refract = Finish->Temp_Refract;
+                }
+            }
+        }
+
+        // If there is no IOR specified use the atmopshere ior.
+
+        if (Object->interior->IOR == 0.0)
+        {
+            Object->interior->IOR = sceneData->atmosphereIOR;
+            Object->interior->Dispersion = sceneData->atmosphereDispersion;
+        }
+
+        // If object has subsurface light transport enabled, precompute some necessary information
+        /* if(!Object->Texture->Finish->SubsurfaceTranslucency.IsZero()) */
+        if (sceneData->useSubsurface)
+        {
+            Object->interior->subsurface = shared_ptr<SubsurfaceInterior>(new SubsurfaceInterior(Object->interior->IOR));
+        }
+    }
+
+    if (Object->Type & IS_COMPOUND_OBJECT)
+    {
+        for (vector<ObjectPtr>::iterator Sib = (reinterpret_cast<CSG *>(Object))->children.begin(); Sib != (reinterpret_cast<CSG *>(Object))->children.end(); Sib++)
+        {
+            Post_Process(*Sib, Object);
+        }
+    }
+
+    // Test whether the object is finite or infinite. [DB 9/94]
+    // CJC TODO FIXME: see if this can be improved, and/or if it is appropriate for all bounding systems
+
+    BOUNDS_VOLUME(Volume, Object->BBox);
+
+    if (Volume > INFINITE_VOLUME)
+    {
+        Set_Flag(Object, INFINITE_FLAG);
+    }
+
+    // Test if the object is opaque or not. [DB 8/94]
+
+    if (Object->IsOpaque())
+        Set_Flag(Object, OPAQUE_FLAG);
+}
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Merge_Loose_Triangles
+*
+* INPUT
+*
+* OUTPUT
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Replace top-level triangles and smooth triangles by meshes. Triangles are
+*   grouped if they share all object properties a mesh can only have once,
+*   i.e. everything except texture; textures that differ are carried over as
+*   per-triangle textures. Triangles that are clipped, bounded, uv-mapped or
+*   have an interior texture or media are left alone.
+*
+*   This saves the per-object overhead, and gets the triangles the mesh
+*   bounding hierarchy instead of one bounding slab entry each.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+static bool Interiors_Equivalent(const Interior& a, const Interior& b)
+{
+    return (a.hollow == b.hollow) && (a.Disp_NElems == b.Disp_NElems) &&
+           (a.IOR == b.IOR) && (a.Dispersion == b.Dispersion) &&
+           (a.Caustics == b.Caustics) && (a.Old_Refract == b.Old_Refract) &&
+           (a.Fade_Distance == b.Fade_Distance) && (a.Fade_Power == b.Fade_Power) &&
+           (a.Fade_Colour - b.Fade_Colour).IsZero() &&
+           a.media.empty() && b.media.empty() &&
+           ((a.subsurface == nullptr) == (b.subsurface == nullptr));
+}
+
+static bool Triangle_Mergeable(ObjectPtr Object)
+{
+    return (dynamic_cast<Triangle *>(Object) != nullptr) &&
+           Object->Bound.empty() && Object->Clip.empty() &&
+           (Object->Trans == nullptr) && (Object->Texture != nullptr) && (Object->Interior_Texture == nullptr) &&
+           (Object->interior != nullptr) && Object->interior->media.empty() &&
+           !Test_Flag(Object, UV_FLAG) && !Test_Flag(Object, MULTITEXTURE_FLAG);
+}
+
+static bool Triangles_Mergeable(ObjectPtr a, ObjectPtr b)
+{
+    const unsigned int derivedFlags = OPAQUE_FLAG | INFINITE_FLAG;
+
+    return ((a->Flags & ~derivedFlags) == (b->Flags & ~derivedFlags)) &&
+           (a->Type == b->Type) &&
+           (a->Ph_Density == b->Ph_Density) &&
+           (a->RadiosityImportance == b->RadiosityImportance) &&
+           (a->RadiosityImportanceSet == b->RadiosityImportanceSet) &&
+           (a->LLights == b->LLights) &&
+           ((a->interior == b->interior) || Interiors_Equivalent(*a->interior, *b->interior));
+}
+
+void Parser::Merge_Loose_Triangles()
+{
+    vector<vector<ObjectPtr>> groups;
+    vector<ObjectPtr> meshes, remaining;
+    std::set<ObjectPtr> mergedTriangles;
+
+    for (vector<ObjectPtr>::iterator i = sceneData->objects.begin(); i != sceneData->objects.end(); ++i)
+    {
+        if (!Triangle_Mergeable(*i))
+            continue;
+
+        vector<vector<ObjectPtr>>::iterator group;
+        for (group = groups.begin(); group != groups.end(); ++group)
+        {
+            if (Triangles_Mergeable(group->front(), *i))
+                break;
+        }
+        if (group == groups.end())
+            groups.push_back(vector<ObjectPtr>(1, *i));
+        else
+            group->push_back(*i);
+    }
+
+    for (vector<vector<ObjectPtr>>::iterator group = groups.begin(); group != groups.end(); ++group)
+    {
+        if (group->size() < MERGE_TRIANGLES_MIN_COUNT)
+            continue;
+
+        ObjectPtr first = group->front();
+        Mesh *Object = new Mesh();
+
+        MeshIndex number_of_normals = 0, number_of_triangles = 0, number_of_vertices = 0;
+        MeshIndex max_normals = 256, max_vertices = 256;
+        MeshVector *Normals = reinterpret_cast<MeshVector *>(POV_MALLOC(max_normals*sizeof(MeshVector), "temporary triangle mesh data"));
+        MeshVector *Vertices = reinterpret_cast<MeshVector *>(POV_MALLOC(max_vertices*sizeof(MeshVector), "temporary triangle mesh data"));
+        vector<TEXTURE *> Textures;
+        std::map<TEXTURE *, MeshIndex> TextureIndices; // Mesh_Hash_Texture() does a linear search, too slow for this many textures
+        MESH_TRIANGLE *Triangles = reinterpret_cast<MESH_TRIANGLE *>(POV_MALLOC(group->size()*sizeof(MESH_TRIANGLE), "triangle mesh data"));
+        Vector3d N;
+
+        Object->Create_Mesh_Hash_Tables();
+
+        for (vector<ObjectPtr>::iterator i = group->begin(); i != group->end(); ++i)
+        {
+            Triangle *Tri = reinterpret_cast<Triangle *>(*i);
+            SmoothTriangle *SmoothTri = dynamic_cast<SmoothTriangle *>(Tri);
+            MESH_TRIANGLE& MeshTri = Triangles[number_of_triangles];
+
+            Object->Init_Mesh_Triangle(&MeshTri);
+
+            MeshTri.P1 = Object->Mesh_Hash_Vertex(&number_of_vertices, &max_vertices, &Vertices, Tri->P1);
+            MeshTri.P2 = Object->Mesh_Hash_Vertex(&number_of_vertices, &max_vertices, &Vertices, Tri->P2);
+            MeshTri.P3 = Object->Mesh_Hash_Vertex(&number_of_vertices, &max_vertices, &Vertices, Tri->P3);
+            MeshTri.UV1 = MeshTri.UV2 = MeshTri.UV3 = 0;
+            std::map<TEXTURE *, MeshIndex>::iterator iTexture = TextureIndices.find(Tri->Texture);
+            if (iTexture == TextureIndices.end())
+            {
+                iTexture = TextureIndices.insert(std::make_pair(Tri->Texture, MeshIndex(Textures.size()))).first;
+                Textures.push_back(Tri->Texture);
+            }
+            MeshTri.Texture = iTexture->second;
+
+            if (SmoothTri != nullptr)
+            {
+                MeshTri.N1 = Object->Mesh_Hash_Normal(&number_of_normals, &max_normals, &Normals, SmoothTri->N1);
+                MeshTri.N2 = Object->Mesh_Hash_Normal(&number_of_normals, &max_normals, &Normals, SmoothTri->N2);
+                MeshTri.N3 = Object->Mesh_Hash_Normal(&number_of_normals, &max_normals, &Normals, SmoothTri->N3);
+            }
+
+            if (!Object->Compute_Mesh_Triangle(&MeshTri, (SmoothTri != nullptr), Tri->P1, Tri->P2, Tri->P3, N))
+                continue;
+
+            MeshTri.Normal_Ind = Object->Mesh_Hash_Normal(&number_of_normals, &max_normals, &Normals, N);
+
+            number_of_triangles++;
+        }
+
+        Object->Destroy_Mesh_Hash_Tables();
+
+        Object->Data = reinterpret_cast<MESH_DATA *>(POV_MALLOC(sizeof(MESH_DATA), "triangle mesh data"));
+        Object->Data->References = 1;
+        Object->Data->Accounted_Memory = 0;
+        Object->Data->BVH = nullptr;
+        Object->Data->Storage = nullptr;
+        Object->Data->Page = nullptr;
+        Object->Data->In_Scene_Arena = false;
+        Object->Data->CompactTriangles = nullptr;
+
+        Object->Data->Vertices  = Vertices;
+        Object->Data->Normals   = Normals;
+        Object->Data->Triangles = Triangles;
+        Object->Data->UVCoords  = reinterpret_cast<MeshUVVector *>(POV_MALLOC(sizeof(MeshUVVector), "triangle mesh data"));
+        Object->Data->UVCoords[0] = MeshUVVector(0.0f, 0.0f);
+
+        Object->Data->Number_Of_Vertices  = number_of_vertices;
+        Object->Data->Number_Of_Normals   = number_of_normals;
+        Object->Data->Number_Of_Triangles = number_of_triangles;
+        Object->Data->Number_Of_UVCoords  = 1;
+
+        if (number_of_triangles == 0)
+        {
+            delete Object;
+            continue;
+        }
+
+        /* The mesh takes over the triangles' properties, with the textures carried over per triangle. */
+
+        Object->Type = MESH_OBJECT;
+        Object->Flags = first->Flags | HIERARCHY_FLAG;
+        Clear_Flag(Object, OPAQUE_FLAG);
+        Object->interior = first->interior;
+        Object->LLights = first->LLights;
+        Object->Ph_Density = first->Ph_Density;
+        Object->RadiosityImportance = first->RadiosityImportance;
+        Object->RadiosityImportanceSet = first->RadiosityImportanceSet;
+
+        if (Textures.size() == 1)
+        {
+            Object->Texture = Copy_Texture_Pointer(Textures[0]);
+            for (MeshIndex i = 0; i < number_of_triangles; i++)
+                Triangles[i].Texture = -1;
+        }
+        else
+        {
+            Object->Textures = reinterpret_cast<TEXTURE **>(POV_MALLOC(Textures.size()*sizeof(TEXTURE *), "triangle mesh data"));
+            for (size_t i = 0; i < Textures.size(); i++)
+                Object->Textures[i] = Copy_Texture_Pointer(Textures[i]);
+            Object->Number_Of_Textures = MeshIndex(Textures.size());
+            Object->Type |= TEXTURED_OBJECT;
+            Set_Flag(Object, MULTITEXTURE_FLAG);
+        }
+
+        Object->has_inside_vector = false;
+
+        meshes.push_back(Object);
+        mergedTriangles.insert(group->begin(), group->end());
+    }
+
+    if (meshes.empty())
+        return;
+
+    /* The meshes are independent of each other, so their hierarchies can be built concurrently. */
+
+    ForEachParallel(meshes.size(), mImportThreads, [&meshes](size_t i)
+    {
+        Mesh *Object = static_cast<Mesh *>(meshes[i]);
+
+        Object->Compute_BBox();
+        Object->Compact_Mesh_Data();
+        Object->Build_Mesh_BBox_Tree();
+
+        if (Object->IsOpaque())
+            Set_Flag(Object, OPAQUE_FLAG);
+    });
+
+    /* Rebuild the object list, with the meshes in place of the triangles. */
+
+    for (vector<ObjectPtr>::iterator i = sceneData->objects.begin(); i != sceneData->objects.end(); ++i)
+    {
+        if (mergedTriangles.count(*i) == 0)
+            remaining.push_back(*i);
+    }
+    remaining.insert(remaining.end(), meshes.begin(), meshes.end());
+
+    for (std::set<ObjectPtr>::iterator i = mergedTriangles.begin(); i != mergedTriangles.end(); ++i)
+        Destroy_Object(*i);
+
+    sceneData->objects.swap(remaining);
+}
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Merge_Identical_Textures
+*
+* INPUT
+*
+* OUTPUT
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Replace structurally identical textures of the scene's objects by a
+*   single shared instance. Scenes generated via macros often give each
+*   object a fresh copy of the same texture; sharing them saves memory, and
+*   lets anything keyed by texture (e.g. the per-texture mesh lists built by
+*   Merge_Loose_Triangles) see them as one.
+*
+*   Only textures whose layers are all plain pigments with a finish and no
+*   normal are considered; anything involving patterns is left alone, as
+*   comparing those would require comparing arbitrary pattern trees.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+static bool Colours_Identical(const MathColour& a, const MathColour& b)
+{
+    for (int i = 0; i < MathColour::channels; i++)
+    {
+        if (a[i] != b[i])
+            return false;
+    }
+    return true;
+}
+
+static bool TransColours_Identical(const TransColour& a, const TransColour& b)
+{
+    // invalid colours (e.g. an unset quick_color) are all alike
+    if (!a.IsValid() || !b.IsValid())
+        return (a.IsValid() == b.IsValid());
+    return Colours_Identical(a.colour(), b.colour()) && (a.filter() == b.filter()) && (a.transm() == b.transm());
+}
+
+static bool Finishes_Identical(const FINISH& a, const FINISH& b)
+{
+    return (a.Diffuse == b.Diffuse) && (a.DiffuseBack == b.DiffuseBack) && (a.Brilliance == b.Brilliance) &&
+#if POV_PARSER_EXPERIMENTAL_BRILLIANCE_OUT
+           (a.BrillianceOut == b.BrillianceOut) &&
+#endif
+           (a.BrillianceAdjust == b.BrillianceAdjust) && (a.BrillianceAdjustRad == b.BrillianceAdjustRad) &&
+           (a.Specular == b.Specular) && (a.Roughness == b.Roughness) &&
+           (a.Phong == b.Phong) && (a.Phong_Size == b.Phong_Size) &&
+           (a.Irid == b.Irid) && (a.Irid_Film_Thickness == b.Irid_Film_Thickness) && (a.Irid_Turb == b.Irid_Turb) &&
+           (a.Temp_Caustics == b.Temp_Caustics) && (a.Temp_IOR == b.Temp_IOR) && (a.Temp_Dispersion == b.Temp_Dispersion) &&
+           (a.Temp_Refract == b.Temp_Refract) && (a.Reflect_Exp == b.Reflect_Exp) &&
+           (a.Crand == b.Crand) && (a.Metallic == b.Metallic) &&
+           Colours_Identical(a.Ambient, b.Ambient) && Colours_Identical(a.Emission, b.Emission) &&
+           Colours_Identical(a.Reflection_Max, b.Reflection_Max) && Colours_Identical(a.Reflection_Min, b.Reflection_Min) &&
+           Colours_Identical(a.SubsurfaceTranslucency, b.SubsurfaceTranslucency) &&
+           Colours_Identical(a.SubsurfaceAnisotropy, b.SubsurfaceAnisotropy) &&
+           (a.Reflection_Falloff == b.Reflection_Falloff) && (a.Reflection_Fresnel == b.Reflection_Fresnel) &&
+           (a.Fresnel == b.Fresnel) && (a.Reflect_Metallic == b.Reflect_Metallic) &&
+           (a.Conserve_Energy == b.Conserve_Energy) && (a.UseSubsurface == b.UseSubsurface) &&
+           (a.AlphaKnockout == b.AlphaKnockout);
+}
+
+static bool Texture_Mergeable(const TEXTURE *Texture)
+{
+    for (const TEXTURE *Layer = Texture; Layer != nullptr; Layer = Layer->Next)
+    {
+        if ((Layer->Type != PLAIN_PATTERN) || (Layer->Blend_Map != nullptr) || !Layer->Materials.empty() ||
+            (Layer->Tnormal != nullptr) || (Layer->Finish == nullptr) || (Layer->Pigment == nullptr) ||
+            (Layer->Pigment->Type != PLAIN_PATTERN) || (Layer->Pigment->Blend_Map != nullptr))
+            return false;
+    }
+    return true;
+}
+
+static bool Textures_Identical(const TEXTURE *a, const TEXTURE *b)
+{
+    for (; (a != nullptr) && (b != nullptr); a = a->Next, b = b->Next)
+    {
+        if ((a->Flags != b->Flags) || (a->Pigment->Flags != b->Pigment->Flags) ||
+            !TransColours_Identical(a->Pigment->colour, b->Pigment->colour) ||
+            !TransColours_Identical(a->Pigment->Quick_Colour, b->Pigment->Quick_Colour) ||
+            !Finishes_Identical(*a->Finish, *b->Finish))
+            return false;
+    }
+    return (a == nullptr) && (b == nullptr);
+}
 
-                // the equalization is actually done in the lighting code, since only the length of
-                // Axis1 will be used
+static POV_UINT64 Hash_Texture(const TEXTURE *Texture)
+{
+    // only hash the most telling properties; Textures_Identical() has the final say
+    POV_UINT64 hash = kDeclarationHashSeed;
+    for (const TEXTURE *Layer = Texture; Layer != nullptr; Layer = Layer->Next)
+    {
+        hash = HashDeclarationValue(hash, Layer->Flags);
+        for (int i = 0; i < MathColour::channels; i++)
+            hash = HashDeclarationValue(hash, Layer->Pigment->colour.colour()[i]);
+        hash = HashDeclarationValue(hash, Layer->Pigment->colour.transm());
+        hash = HashDeclarationValue(hash, Layer->Finish->Diffuse);
+        hash = HashDeclarationValue(hash, Layer->Finish->Phong);
+        hash = HashDeclarationValue(hash, Layer->Finish->Specular);
+    }
+    return hash;
+}
 
-            }
+void Parser::Merge_Identical_Textures()
+{
+    std::unordered_map<POV_UINT64, vector<TEXTURE *>> buckets;
+    std::map<TEXTURE *, TEXTURE *> canonical;
+    vector<ObjectPtr> pending(sceneData->objects);
+    size_t mergedTextures = 0, savedBytes = 0;
 
-            if(Light->Area_Size1 != Light->Area_Size2)
-            {
-                Warning("When using orient, the two sample sizes for the area light should be equal.");
-            }
-        }
+    auto merge = [&](TEXTURE *& Texture)
+    {
+        if ((Texture == nullptr) || !Texture_Mergeable(Texture))
+            return;
 
-        // Make sure that circular light sources are larger than 1 by x [ENB 9/97]
-        if (Light->Circular)
+        std::map<TEXTURE *, TEXTURE *>::iterator known = canonical.find(Texture);
+        if (known == canonical.end())
         {
-            if ((Light->Area_Size1 <= 1) || (Light->Area_Size2 <= 1))
+            vector<TEXTURE *>& bucket = buckets[Hash_Texture(Texture)];
+            vector<TEXTURE *>::iterator match = bucket.begin();
+            while ((match != bucket.end()) && !Textures_Identical(*match, Texture))
+                ++match;
+            if (match == bucket.end())
             {
-                Warning("Circular area lights must have more than one sample along each axis.");
-                Light->Circular = false;
+                bucket.push_back(Texture);
+                canonical[Texture] = Texture;
+                return;
             }
+            known = canonical.insert(std::make_pair(Texture, *match)).first;
         }
-    }
 
-    if (Object->Type & LIGHT_SOURCE_OBJECT)
-    {
-        // post-process the light source
-        if ((reinterpret_cast<LightSource *>(Object))->Projected_Through_Object != nullptr)
+        if (known->second == Texture)
+            return;
+
+        if (Texture->References == 1)
         {
-            if ((reinterpret_cast<LightSource *>(Object))->Projected_Through_Object->interior != nullptr)
-            {
-                (reinterpret_cast<LightSource *>(Object))->Projected_Through_Object->interior.reset();
-                Warning("Projected through objects can not have interior, interior removed.");
-            }
-            if ((reinterpret_cast<LightSource *>(Object))->Projected_Through_Object->Texture != nullptr)
-            {
-                Destroy_Textures((reinterpret_cast<LightSource *>(Object))->Projected_Through_Object->Texture);
-                (reinterpret_cast<LightSource *>(Object))->Projected_Through_Object->Texture = nullptr;
-                Warning("Projected through objects can not have texture, texture removed.");
-            }
+            mergedTextures++;
+            for (const TEXTURE *Layer = Texture; Layer != nullptr; Layer = Layer->Next)
+                savedBytes += sizeof(TEXTURE) + sizeof(PIGMENT) + sizeof(FINISH);
         }
+        Destroy_Textures(Texture);
+        Texture = Copy_Texture_Pointer(known->second);
+    };
 
-        // only global light sources are in Frame.Light_Sources list [trf]
-        if(!(Object->Type & LIGHT_GROUP_LIGHT_OBJECT))
-            // add this light to the frame's list of global light sources
-            sceneData->lightSources.push_back(reinterpret_cast<LightSource *>(Object));
-        else
-            // Put it into the frame's list of light-group lights
-            sceneData->lightGroupLightSources.push_back(reinterpret_cast<LightSource *>(Object));
-    }
-    else
+    while (!pending.empty())
     {
-        // post-process the object
+        ObjectPtr Object = pending.back();
+        pending.pop_back();
 
-        // If there is no interior create one.
+        merge(Object->Texture);
+        merge(Object->Interior_Texture);
 
-        if (Object->interior == nullptr)
+        Mesh *MeshObject = dynamic_cast<Mesh *>(Object);
+        if ((MeshObject != nullptr) && (MeshObject->Textures != nullptr))
         {
-            Object->interior = InteriorPtr(new Interior());
+            for (MeshIndex i = 0; i < MeshObject->Number_Of_Textures; i++)
+                merge(MeshObject->Textures[i]);
         }
 
-        // Promote hollow flag to interior.
+        if (Object->Type & IS_COMPOUND_OBJECT)
+        {
+            const vector<ObjectPtr>& children = static_cast<CompoundObject *>(Object)->children;
+            pending.insert(pending.end(), children.begin(), children.end());
+        }
+    }
 
-        Object->interior->hollow = (Test_Flag(Object, HOLLOW_FLAG) != false);
+    if (mergedTextures > 0)
+        Debug_Info("Merged %lu duplicate textures, saving %lu KiB.\n", (unsigned long)mergedTextures, (unsigned long)(savedBytes / 1024));
+}
 
-        // Promote finish's IOR to interior IOR.
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Share_Identical_Transforms
+*
+* INPUT
+*
+* OUTPUT
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Replace the transformations of all objects in the scene, including their
+*   children and clipping and bounding objects, by shared copies from the
+*   scene's transformation pool. Objects carrying identical transformations
+*   thus end up sharing a single one.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
 
-        if (Object->Texture != nullptr)
-        {
-            if (Object->Texture->Type == PLAIN_PATTERN)
-            {
-                Finish = Object->Texture->Finish;
-                if (Finish != nullptr)
-                {
-                    if (Finish->Temp_IOR >= 0.0)
-                    {
-                        Object->interior->IOR = Finish->Temp_IOR;
-                        Object->interior->Dispersion = Finish->Temp_Dispersion;
-                    }
-                    if (Finish->Temp_Caustics >= 0.0)
-                    {
-                        Object->interior->Caustics = Finish->Temp_Caustics;
-                    }
+void Parser::Share_Identical_Transforms()
+{
+    vector<ObjectPtr> pending(sceneData->objects);
+    TransformPool& pool = sceneData->transformPool;
+    size_t oldDuplicates = pool.duplicates();
 
-                    Object->interior->Old_Refract = Finish->Temp_Refract;
-                }
-            }
-        }
+    while (!pending.empty())
+    {
+        ObjectPtr Object = pending.back();
+        pending.pop_back();
 
-        // If there is no IOR specified use the atmopshere ior.
+        Object->Trans = pool.Intern(Object->Trans);
 
-        if (Object->interior->IOR == 0.0)
-        {
-            Object->interior->IOR = sceneData->atmosphereIOR;
-            Object->interior->Dispersion = sceneData->atmosphereDispersion;
-        }
+        pending.insert(pending.end(), Object->Clip.begin(), Object->Clip.end());
+        pending.insert(pending.end(), Object->Bound.begin(), Object->Bound.end());
 
-        // If object has subsurface light transport enabled, precompute some necessary information
-        /* if(!Object->Texture->Finish->SubsurfaceTranslucency.IsZero()) */
-        if (sceneData->useSubsurface)
+        if (Object->Type & IS_COMPOUND_OBJECT)
         {
-            Object->interior->subsurface = shared_ptr<SubsurfaceInterior>(new SubsurfaceInterior(Object->interior->IOR));
+            const vector<ObjectPtr>& children = static_cast<CompoundObject *>(Object)->children;
+            pending.insert(pending.end(), children.begin(), children.end());
         }
     }
 
-    if (Object->Type & IS_COMPOUND_OBJECT)
-    {
-        for (vector<ObjectPtr>::iterator Sib = (reinterpret_cast<CSG *>(Object))->children.begin(); Sib != (reinterpret_cast<CSG *>(Object))->children.end(); Sib++)
-        {
-            Post_Process(*Sib, Object);
-        }
-    }
+    size_t sharedTransforms = pool.duplicates() - oldDuplicates;
+    if (sharedTransforms > 0)
+        Debug_Info("Shared %lu duplicate transformations, saving %lu KiB.\n",
+                   (unsigned long)sharedTransforms, (unsigned long)(sharedTransforms * sizeof(TRANSFORM) / 1024));
+}
 
-    // Test whether the object is finite or infinite. [DB 9/94]
-    // CJC TODO FIXME: see if this can be improved, and/or if it is appropriate for all bounding systems
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Build_CSG_Child_Trees
+*
+* INPUT
+*
+* OUTPUT
+*
+* RETURNS
+*
+* AUTHOR
+*
+* DESCRIPTION
+*
+*   Have all CSG objects in the scene, including nested ones and clipping
+*   and bounding objects, build a bounding hierarchy over their children
+*   where worthwhile. This must happen once parsing is complete, as
+*   transforming an object discards its hierarchy. The hierarchies are
+*   built on all import threads.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
 
-    BOUNDS_VOLUME(Volume, Object->BBox);
+void Parser::Build_CSG_Child_Trees()
+{
+    vector<ObjectPtr> pending(sceneData->objects);
+    vector<CSG *> csgs;
 
-    if (Volume > INFINITE_VOLUME)
+    while (!pending.empty())
     {
-        Set_Flag(Object, INFINITE_FLAG);
-    }
+        ObjectPtr Object = pending.back();
+        pending.pop_back();
 
-    // Test if the object is opaque or not. [DB 8/94]
+        pending.insert(pending.end(), Object->Clip.begin(), Object->Clip.end());
+        pending.insert(pending.end(), Object->Bound.begin(), Object->Bound.end());
 
-    if (Object->IsOpaque())
-        Set_Flag(Object, OPAQUE_FLAG);
+        if (Object->Type & IS_COMPOUND_OBJECT)
+        {
+            const vector<ObjectPtr>& children = static_cast<CompoundObject *>(Object)->children;
+            pending.insert(pending.end(), children.begin(), children.end());
+        }
+
+        if (Object->Type & IS_CSG_OBJECT)
+        {
+            CSG *csg = dynamic_cast<CSG *>(Object);
+            if (csg != nullptr)
+                csgs.push_back(csg);
+        }
+    }
+
+    // Each hierarchy only depends on the bounding boxes of the object's own children, which are
+    // final at this point, so the objects can be processed concurrently and in any order.
+    ForEachParallel(csgs.size(), mImportThreads, [&csgs](size_t i) { csgs[i]->Build_Child_Tree(); });
 }
 
 /*****************************************************************************
@@ -10833,6 +12797,8 @@ void Parser::Warning(WarningLevel level, const char *format,...)
     std::vsnprintf(localvsbuffer, sizeof(localvsbuffer), format, marker);
     va_end(marker);
 
+    NoteSideEffect();
+
     if (HaveCurrentMessageContext())
         mMessageFactory.WarningAt(level, CurrentMessageContext(), "%s", localvsbuffer);
     else
@@ -10850,6 +12816,8 @@ void Parser::Warning(WarningLevel level, const MessageContext& loc, const char *
     std::vsnprintf(localvsbuffer, sizeof(localvsbuffer), format, marker);
     va_end(marker);
 
+    NoteSideEffect();
+
     mMessageFactory.WarningAt(level, loc, "%s", localvsbuffer);
 }
 
@@ -10877,6 +12845,8 @@ void Parser::PossibleError(const char *format,...)
     std::vsnprintf(localvsbuffer, sizeof(localvsbuffer), format, marker);
     va_end(marker);
 
+    NoteSideEffect();
+
     if (HaveCurrentMessageContext())
         mMessageFactory.PossibleErrorAt(CurrentMessageContext(), "%s", localvsbuffer);
     else
@@ -11061,6 +13031,13 @@ void Parser::CheckPassThru(ObjectPtr o, int flag)
 
 shared_ptr<IStream> Parser::Locate_File(const UCS2String& filename, unsigned int stype, UCS2String& buffer, bool err_flag)
 {
+    // File contents may change between parses.
+    NoteSideEffect();
+    // Input read from text files is fingerprinted as it is parsed, but data files are opaque to us.
+    if (mFingerprintContent && (stype != POV_File_Text_POV) && (stype != POV_File_Text_INC) &&
+        (stype != POV_File_Text_INI) && (stype != POV_File_Text_Stream) && (stype != POV_File_Text_User))
+        NoteUnstableContent();
+
     UCS2String fn(filename);
     UCS2String foundfile(mFileResolver.FindFile(fn, stype));
 
@@ -11121,17 +13098,15 @@ shared_ptr<IStream> Parser::Locate_File(const UCS2String& filename, unsigned int
 
 OStream *Parser::CreateFile(const UCS2String& filename, unsigned int stype, bool append)
 {
+    NoteSideEffect();
     return mFileResolver.CreateFile(filename, stype, append);
 }
 
 //******************************************************************************
 
-Image *Parser::Read_Image(int filetype, const UCS2 *filename, const ImageReadOptions& options)
+/// Get the file and image type corresponding to a file type keyword token.
+static void GetImageFileType(int filetype, unsigned int& stype, Image::ImageFileType& type)
 {
-    unsigned int stype;
-    Image::ImageFileType type;
-    UCS2String ign;
-
     switch(filetype)
     {
         case GIF_FILE:
@@ -11189,13 +13164,87 @@ Image *Parser::Read_Image(int filetype, const UCS2 *filename, const ImageReadOpt
         default:
             throw POV_EXCEPTION(kDataTypeErr, "Unknown file type.");
     }
+}
+
+std::shared_ptr<Image> Parser::Read_Image(int filetype, const UCS2 *filename, const ImageReadOptions& options)
+{
+    unsigned int stype;
+    Image::ImageFileType type;
+    UCS2String ign;
+
+    GetImageFileType(filetype, stype, type);
+
+    shared_ptr<IStream> file = Locate_File(filename, stype, ign, true);
+
+    if (file == nullptr)
+        throw POV_EXCEPTION(kCannotOpenFileErr, "Cannot find image file.");
+
+    return ReadCachedImage(type, file.get(), options);
+}
+
+//******************************************************************************
+
+void Parser::Read_Image_Async(ImageData *image, int filetype, const UCS2 *filename, const ImageReadOptions& options, bool precompute, const char *name)
+{
+    unsigned int stype;
+    Image::ImageFileType type;
+    UCS2String ign;
 
+    GetImageFileType(filetype, stype, type);
+
+    // Locate and open the file right away, so that errors are reported in context.
     shared_ptr<IStream> file = Locate_File(filename, stype, ign, true);
 
     if (file == nullptr)
         throw POV_EXCEPTION(kCannotOpenFileErr, "Cannot find image file.");
 
-    return Image::Read(type, file.get(), options);
+    image->Decoder = std::make_shared<ImageDecodeTask>(
+        [type, file, options](vector<std::string>& warnings) mutable -> shared_ptr<Image>
+        {
+            shared_ptr<Image> result = ReadCachedImage(type, file.get(), options);
+            warnings.swap(options.warnings);
+            return result;
+        },
+        precompute, mDeferImageDecoding);
+    image->Pending = true;
+
+    if (mDeferImageDecoding)
+        return;
+
+    if (mpImageDecodeQueue == nullptr)
+        mpImageDecodeQueue.reset(new ImageDecodeQueue(mImportThreads));
+    mpImageDecodeQueue->Submit(image->Decoder);
+    maPendingImages.push_back(PendingImage{ name, image->Decoder });
+}
+
+//******************************************************************************
+
+void Parser::Finish_Image_Decoding()
+{
+    // Wait for the helper threads, so that any errors and warnings are reported as part of the parse.
+    for (auto& pending : maPendingImages)
+    {
+        shared_ptr<ImageDecodeTask> task = pending.task.lock();
+        if (task == nullptr)
+            continue; // image no longer used by the scene
+
+        task->Run(); // in case no helper thread has gotten around to it yet
+        if (!task->Wait())
+        {
+            try
+            {
+                (void)task->TakeImage(); // re-throws the decoder's exception
+            }
+            catch (std::exception& e)
+            {
+                Error("Cannot read image '%s': %s", pending.name.c_str(), e.what());
+            }
+        }
+
+        for (auto& warning : task->GetWarnings())
+            Warning("%s: %s", pending.name.c_str(), warning.c_str());
+    }
+    maPendingImages.clear();
 }
 
 //******************************************************************************
@@ -11451,12 +13500,99 @@ void Parser::POV_ARRAY::Shrink()
     }
 }
 
-Parser::POV_ARRAY::POV_ARRAY(const POV_ARRAY& obj)
+/// Whether an element is held in the array's contiguous storage rather than allocated on its own.
+bool Parser::POV_ARRAY::IsDenseElement(size_t i) const
+{
+    const DBL* p = reinterpret_cast<const DBL*>(DataPtrs[i]);
+    return (!DenseData.empty() && (p >= DenseData.data()) && (p < DenseData.data() + DenseData.size()));
+}
+
+/// Give an element storage of its own, so that it can be destroyed or replaced like any other value.
+void Parser::POV_ARRAY::MakeElementSparse(size_t i)
+{
+    if (IsDenseElement(i))
+        DataPtrs[i] = SymbolTable::Copy_Identifier(DataPtrs[i], DenseType);
+}
+
+/// Move an element into the array's contiguous storage, if the array is eligible.
+///
+/// Only fixed-size homogenous arrays of floats, uv vectors or 3D vectors are held in contiguous
+/// storage, as long as no references to individual elements have been handed out.
+///
+void Parser::POV_ARRAY::MakeElementDense(size_t i)
+{
+    size_t stride = DenseStride(Type_);
+    if (resizable || mixedType || escaped || (stride == 0) || (DataPtrs[i] == nullptr) || IsDenseElement(i))
+        return;
+
+    if (DenseData.empty())
+    {
+        DenseData.assign(DataPtrs.size() * stride, 0.0);
+        DenseType = Type_;
+        SymbolTable::Register_Shared_Storage(DenseData.data(), DenseData.size() * sizeof(DBL));
+    }
+    else if (DenseType != Type_)
+        return;
+
+    DBL* p = DenseData.data() + i * stride;
+    switch (Type_)
+    {
+        case FLOAT_ID_TOKEN:
+            *p = *reinterpret_cast<DBL*>(DataPtrs[i]);
+            break;
+
+        case UV_ID_TOKEN:
+            *reinterpret_cast<Vector2d*>(p) = *reinterpret_cast<Vector2d*>(DataPtrs[i]);
+            break;
+
+        case VECTOR_ID_TOKEN:
+            *reinterpret_cast<Vector3d*>(p) = *reinterpret_cast<Vector3d*>(DataPtrs[i]);
+            break;
+
+        default:
+            POV_PARSER_PANIC();
+            return;
+    }
+    SymbolTable::Destroy_Ident_Data(DataPtrs[i], Type_);
+    DataPtrs[i] = p;
+}
+
+/// Give all elements storage of their own, and keep it that way.
+///
+/// This is required whenever a reference to an individual element is handed out.
+///
+void Parser::POV_ARRAY::MakeSparse()
+{
+    escaped = true;
+    if (DenseData.empty())
+        return;
+    for (size_t i = 0; i < DataPtrs.size(); ++i)
+        MakeElementSparse(i);
+    SymbolTable::Unregister_Shared_Storage(DenseData.data());
+    DenseData.clear();
+    DenseData.shrink_to_fit();
+}
+
+size_t Parser::POV_ARRAY::DenseStride(TokenId type)
+{
+    switch (type)
+    {
+        case FLOAT_ID_TOKEN:    return 1;
+        case UV_ID_TOKEN:       return 2;
+        case VECTOR_ID_TOKEN:   return 3;
+        default:                return 0;
+    }
+}
+
+Parser::POV_ARRAY::POV_ARRAY(const POV_ARRAY& obj) :
+    DenseData(obj.DenseData)
 {
     maxDim = obj.maxDim;
     Type_ = obj.Type_;
+    DenseType = obj.DenseType;
     resizable = obj.resizable;
     mixedType = obj.mixedType;
+    escaped = false;
     for (int i = 0; i < POV_ARRAY::kMaxDimensions; ++i)
     {
         Sizes[i] = obj.Sizes[i];
@@ -11464,14 +13600,26 @@ Parser::POV_ARRAY::POV_ARRAY(const POV_ARRAY& obj)
     }
     DataPtrs.resize(obj.DataPtrs.size());
     for (int i = 0; i < obj.DataPtrs.size(); i++)
-        DataPtrs[i] = SymbolTable::Copy_Identifier(obj.DataPtrs[i], obj.ElementType(i));
+    {
+        if (obj.IsDenseElement(i))
+            DataPtrs[i] = DenseData.data() + (reinterpret_cast<const DBL*>(obj.DataPtrs[i]) - obj.DenseData.data());
+        else
+            DataPtrs[i] = SymbolTable::Copy_Identifier(obj.DataPtrs[i], obj.ElementType(i));
+    }
     Types = obj.Types;
+    if (!DenseData.empty())
+        SymbolTable::Register_Shared_Storage(DenseData.data(), DenseData.size() * sizeof(DBL));
 }
 
 Parser::POV_ARRAY::~POV_ARRAY()
 {
     for (int i = 0; i < this->DataPtrs.size(); ++i)
-        SymbolTable::Destroy_Ident_Data(this->DataPtrs[i], this->ElementType(i));
+    {
+        if (!IsDenseElement(i))
+            SymbolTable::Destroy_Ident_Data(this->DataPtrs[i], this->ElementType(i));
+    }
+    if (!DenseData.empty())
+        SymbolTable::Unregister_Shared_Storage(DenseData.data());
 }
 
 Parser::POV_ARRAY* Parser::POV_ARRAY::Clone() const
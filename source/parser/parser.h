@@ -47,6 +47,7 @@
 
 // C++ standard header files
 #include <chrono>
+#include <map>
 #include <memory>
 #include <string>
 #include <vector>
@@ -77,11 +78,15 @@
 #include "vm/fnpovfpu_fwd.h"
 
 // POV-Ray header files (parser module)
+#include "parser/declarationcache.h"
 #include "parser/fncode.h"
+#include "parser/imagedecodequeue.h"
+#include "parser/parseprofiler.h"
 #include "parser/parsertypes.h"
 #include "parser/reservedwords.h"
 #include "parser/rawtokenizer.h"
 #include "parser/symboltable.h"
+#include "parser/transientarena.h"
 
 namespace pov
 {
@@ -90,10 +95,14 @@ class Blob_Element;
 struct ContainedByShape;
 struct GenericSpline;
 class ImageData;
+class IsoSurface;
 class Mesh;
+class Parametric;
 struct PavementPattern;
+struct PrecompParValues_Struct;
 struct TilingPattern;
 struct TrueTypeFont;
+class UVMeshable;
 
 }
 // end of namespace pov
@@ -181,6 +190,7 @@ struct ExperimentalFlags final
     bool    functionHf              : 1;
     bool    meshCamera              : 1;
     bool    objImport               : 1;
+    bool    plyImport               : 1;
     bool    slopeAltitude           : 1;
     bool    spline                  : 1;
     bool    subsurface              : 1;
@@ -192,6 +202,7 @@ struct ExperimentalFlags final
         functionHf(false),
         meshCamera(false),
         objImport(false),
+        plyImport(false),
         slopeAltitude(false),
         spline(false),
         subsurface(false),
@@ -235,6 +246,8 @@ class Parser final
 
         // tokenize.h/tokenize.cpp
 
+        struct POV_ARRAY;
+
         /// Structure holding information about the current token
         struct Token_Struct final : MessageContext
         {
@@ -246,6 +259,8 @@ class Parser final
             TokenId *NumberPtr;
             void **DataPtr;
             SymbolTable* table;                 ///< Table or dictionary the token references an element of.
+            POV_ARRAY* array;                   ///< Array the token references an element of.
+            size_t arrayIndex;                  ///< Linear index of the array element referenced.
             bool Unget_Token            : 1;    ///< `true` if @ref Get_Token() must re-issue this token as-is.
             bool ungetRaw               : 1;    ///< `true` if @ref Get_Token() must re-evaluate this token from raw.
             bool End_Of_File            : 1;
@@ -279,6 +294,8 @@ class Parser final
             void**       dataPtr;
             TokenId      previous;
             SYM_ENTRY*   symEntry;
+            POV_ARRAY*   array;         ///< Array the lvalue is an element of, if any.
+            size_t       arrayIndex;
             bool         allowRedefine : 1;
             bool         optional      : 1;
         };
@@ -300,6 +317,8 @@ class Parser final
             std::vector<MacroParameter> parameters;
             unsigned char *Cache;
             size_t CacheSize;
+            TokenCachePtr tokenCache; ///< Cached tokens of the file the macro was defined in, if available.
+            CachedTokenPosition cachedEnd; ///< Position of the terminating `#end` within @ref tokenCache.
         };
 
         struct POV_ARRAY final : public Assignable
@@ -311,8 +330,11 @@ class Parser final
             size_t Mags[kMaxDimensions];
             std::vector<void*> DataPtrs;
             std::vector<TokenId> Types;
+            std::vector<DBL> DenseData;             ///< Contiguous storage for float, uv or vector elements.
+            TokenId DenseType;                      ///< Type of the elements held in @ref DenseData.
             bool resizable : 1;
             bool mixedType : 1;
+            bool escaped : 1;                       ///< Whether element references may be held elsewhere.
             bool IsInitialized() const;
             bool HasElement(size_t i) const;
             const TokenId& ElementType(size_t i) const;
@@ -322,6 +344,11 @@ class Parser final
             void GrowBy(size_t delta);
             void GrowTo(size_t delta);
             void Shrink();
+            bool IsDenseElement(size_t i) const;
+            void MakeElementSparse(size_t i);
+            void MakeElementDense(size_t i);
+            void MakeSparse();
+            static size_t DenseStride(TokenId type);
             POV_ARRAY() = default;
             POV_ARRAY(const POV_ARRAY& obj);
             virtual ~POV_ARRAY() override;
@@ -425,6 +452,7 @@ class Parser final
         ObjectPtr Parse_Object_Mods (ObjectPtr Object);
 
         ObjectPtr Parse_Object (void);
+        unsigned int Source_File_Index (const UCS2 *name);
         void Parse_Bound_Clip (std::vector<ObjectPtr>& objects, bool notexture = true);
         void Parse_Default (void);
         void Parse_Declare (bool is_local, bool after_hash);
@@ -461,7 +489,9 @@ class Parser final
         std::shared_ptr<IStream> Locate_File(const UCS2String& formalFileName, unsigned int stype, UCS2String& actualFileName, bool err_flag = false);
 
         OStream *CreateFile(const UCS2String& filename, unsigned int stype, bool append);
-        Image *Read_Image(int filetype, const UCS2 *filename, const ImageReadOptions& options);
+        std::shared_ptr<Image> Read_Image(int filetype, const UCS2 *filename, const ImageReadOptions& options);
+        void Read_Image_Async(ImageData *image, int filetype, const UCS2 *filename, const ImageReadOptions& options, bool precompute, const char *name);
+        void Finish_Image_Decoding();
 
         // tokenize.h/tokenize.cpp
         void Get_Token (void);
@@ -586,7 +616,8 @@ class Parser final
         // parsestr.h/parsestr.cpp
         char *Parse_C_String(bool pathname = false);
         void ParseString(UTF8String& s, bool pathname = false);
-        UCS2 *Parse_String(bool pathname = false, bool require = true);
+        UCS2 *Parse_String(bool pathname = false, bool require = true, TransientArena* arena = nullptr);
+        const UCS2 *Parse_Transient_String(bool pathname = false, bool require = true);
         std::string Parse_SysString(bool pathname = false, bool require = true);
 
         UCS2 *String_Literal_To_UCS2(const std::string& str);
@@ -761,6 +792,7 @@ class Parser final
 
         DBL clockValue;
         bool useClock;
+        unsigned int mImportThreads;
 
         // parse.h/parse.cpp
         bool Not_In_Default;
@@ -803,9 +835,10 @@ class Parser final
             RawTokenizer::HotBookmark   returnToBookmark;
             int                         condStackSize;
             int                         braceStackSize;
+            std::size_t                 profileLevel;
 
             IncludeStackEntry(const RawTokenizer::HotBookmark& rtb, int css, int bss) :
-                returnToBookmark(rtb), condStackSize(css), braceStackSize(bss)
+                returnToBookmark(rtb), condStackSize(css), braceStackSize(bss), profileLevel(ParseProfiler::kNoLevel)
             {}
         };
         std::vector<IncludeStackEntry> maIncludeStack;
@@ -821,7 +854,8 @@ class Parser final
             UTF8String Loop_Identifier;
             DBL For_Loop_End;
             DBL For_Loop_Step;
-            CS_ENTRY() : Cond_Type(BUSY_COND), PMac(nullptr) {}
+            std::size_t profileLevel;
+            CS_ENTRY() : Cond_Type(BUSY_COND), PMac(nullptr), profileLevel(ParseProfiler::kNoLevel) {}
             ~CS_ENTRY() {}
         };
 
@@ -834,6 +868,71 @@ class Parser final
         RawToken        mPendingRawToken;
         bool            mHavePendingRawToken;
 
+        /// Declaration (or global settings change) being evaluated with dependency tracking.
+        struct DeclarationScope final
+        {
+            DeclarationKey                                  key;
+            bool                                            haveKey;            ///< Whether @ref key is valid.
+            bool                                            reusable;           ///< Whether the outcome depends only on @ref reads.
+            int                                             tableIndex;         ///< Symbol table current at the start.
+            size_t                                          condStackSize;
+            size_t                                          braceStackSize;
+            size_t                                          includeStackSize;
+            ConstStreamPtr                                  stream;
+            POV_LONG                                        tokenCount;         ///< Token count at the start.
+            unsigned int                                    experimentalFlags;  ///< Experimental features used before the start.
+            std::vector<DeclarationRead>                    reads;              ///< Values read from outside the scope.
+            std::vector<std::pair<UTF8String, int>>         written;            ///< Symbols assigned outside the scope (name, table).
+        };
+
+        bool                            mReuseDeclarations;         ///< Whether to reuse declarations evaluated in previous parses.
+        std::vector<DeclarationScope>   maDeclarationScopes;        ///< Nested declarations being tracked.
+        POV_UINT64                      mDeclarationEnvironment;    ///< Fingerprint of the global settings in effect.
+        POV_LONG                        mDeclarationsReused;
+        POV_LONG                        mDeclarationsEvaluated;
+
+        /// Fingerprint of the input contributing to a value, accumulated for incremental re-rendering.
+        struct ContentFingerprint final
+        {
+            POV_UINT64                                      hash;
+            POV_UINT64                                      undo;               ///< Value of @ref hash before the most recent token.
+            bool                                            stable;             ///< Whether all contributions could be fingerprinted.
+        };
+
+        bool                            mFingerprintContent;        ///< Whether to fingerprint top-level objects for incremental re-rendering.
+        std::vector<ContentFingerprint> maContentFingerprints;      ///< Nested fingerprints being accumulated; the first one covers the environment.
+        SYM_ENTRY*                      mContentTarget;             ///< Symbol the next right-hand side is assigned to, if not otherwise evident.
+        size_t                          mContentTokenDepth;         ///< Number of fingerprints being accumulated when the current token was noted.
+
+        ParseProfiler                   mProfiler;                  ///< Profiler enabled via the `Parse_Profile_File` option.
+
+        TransientArena                  mTransientArena;            ///< Interim values during expression evaluation.
+
+        /// Image file handed to a helper thread for decoding.
+        struct PendingImage final
+        {
+            std::string                                     name;               ///< File name as specified in the scene.
+            std::weak_ptr<ImageDecodeTask>                  task;
+        };
+
+        bool                                mDeferImageDecoding;    ///< Whether to decode image files only on first access.
+        std::unique_ptr<ImageDecodeQueue>   mpImageDecodeQueue;     ///< Helper threads decoding image files; started on demand.
+        std::vector<PendingImage>           maPendingImages;        ///< Image files handed to the helper threads.
+
+        /// Parametric bounds computed during this parse, keyed by @ref Parametric::Get_Precompute_Key().
+        std::map<POV_UINT64, std::shared_ptr<const PrecompParValues_Struct>> maParametricPrecomputes;
+
+        /// Literal mesh2 body that may be shared via the mesh cache directory.
+        struct MeshSnapshot final
+        {
+            UCS2String                                      fileName;           ///< Snapshot files, sans extension; empty if not eligible.
+            UCS2String                                      sourceName;         ///< Input file holding the body.
+            POV_OFF_T                                       start;              ///< Offset of the body in the input file.
+            LexemePosition                                  end;                ///< Position of the first token after the body.
+            POV_LONG                                        tokenCount;         ///< Number of tokens in the body, except the first.
+            bool                                            write;              ///< Whether the snapshot is to be written.
+        };
+
         // parstxtr.h/parstxtr.cpp
         TEXTURE *Default_Texture;
 
@@ -886,6 +985,7 @@ class Parser final
         ObjectPtr Parse_Polynom();
         ObjectPtr Parse_Polygon();
         ObjectPtr Parse_Polyline();
+        ObjectPtr Parse_Primitive_Soup();
         ObjectPtr Parse_Prism();
         ObjectPtr Parse_Quadric();
         ObjectPtr Parse_Rational_Bezier_Patch();
@@ -897,12 +997,20 @@ class Parser final
         ObjectPtr Parse_Triangle();
         ObjectPtr Parse_Mesh();
         ObjectPtr Parse_Mesh2();
+        ObjectPtr Parse_Tessellated_Patch(ObjectPtr Object, const UVMeshable& Surface, DBL Tolerance);
 
 #if POV_PARSER_EXPERIMENTAL_OBJ_IMPORT
         void Parse_Obj (Mesh*);
+        void Parse_Ply (Mesh*);
+        void Parse_Mesh_Import (Mesh*, int fileType);
 #endif
         void Parse_Mesh1 (Mesh*);
         void Parse_Mesh2 (Mesh*);
+        void Parse_Mesh2_File (Mesh*);
+        bool Find_Mesh2_Snapshot (Mesh*, MeshSnapshot& snapshot);
+        void Finish_Mesh2_Snapshot (const Mesh*, MeshSnapshot& snapshot);
+        void Write_Mesh2_Snapshot (const Mesh*, const MeshSnapshot& snapshot);
+        void Parse_Mesh2_Texture_List (TEXTURE**& textures, int& number_of_textures);
 
         TEXTURE *Parse_Mesh_Texture(TEXTURE **t2, TEXTURE **t3);
         ObjectPtr Parse_TrueType(void);
@@ -920,6 +1028,11 @@ class Parser final
 
         void Link(ObjectPtr New_Object, std::vector<ObjectPtr>& Object_List_Root);
         void Link_To_Frame(ObjectPtr Object);
+        void Fingerprint_Frame_Objects(size_t first, bool lights, const ContentFingerprint& content);
+        void Merge_Loose_Triangles();
+        void Merge_Identical_Textures();
+        void Share_Identical_Transforms();
+        void Build_CSG_Child_Trees();
         void Post_Process(ObjectPtr Object, ObjectPtr Parent);
 
         void Parse_Global_Settings();
@@ -929,7 +1042,9 @@ class Parser final
         void Set_CSG_Tree_Flag(ObjectPtr, unsigned int, int);
 
         ObjectPtr Parse_Isosurface();
+        void Compute_Isosurface_Occupancy(IsoSurface* Object, unsigned int resolution);
         ObjectPtr Parse_Parametric();
+        void Precompute_Parametric(Parametric* Object, char flags, int depth);
         void ParseContainedBy(std::shared_ptr<ContainedByShape>& container, ObjectPtr obj);
 
         ObjectPtr Parse_Sphere_Sweep(void);
@@ -940,8 +1055,32 @@ class Parser final
         bool GetRawToken(RawToken& rawToken, bool fastForwardToDirective);
         bool PeekRawToken(RawToken& rawToken);
         void Read_Symbol(const RawToken& rawToken);
+
+        void BeginTrackedDeclaration(const DeclarationKey* key);
+        bool GetDeclarationKey(DeclarationKey& key);
+        void EndTrackedDeclaration(SYM_ENTRY* target);
+        bool ReuseDeclaration(DeclarationResult& result);
+        void BeginEnvironmentChange();
+        void EndEnvironmentChange();
+        void UpdateDeclarationEnvironment();
+        void NoteSymbolRead(const UTF8String& name, const SYM_ENTRY* entry, int index);
+        void NoteKeywordRead(TokenId keyword);
+        void NoteSymbolWrite(const UTF8String& name, int index);
+        void NoteSideEffect();
+        bool GetValueFingerprint(POV_UINT64& fingerprint, TokenId type, const void* data, const SYM_ENTRY* entry) const;
+        bool GetReadFingerprint(POV_UINT64& fingerprint, const DeclarationRead& read);
+        void BeginContentFingerprint();
+        ContentFingerprint EndContentFingerprint();
+        void NoteContent(POV_UINT64 value);
+        void NoteTokenContent();
+        void NoteSymbolContent(const SYM_ENTRY* entry);
+        void NoteUnstableContent();
+        unsigned int GetExperimentalFlagMask() const;
+        void SetExperimentalFlagMask(unsigned int mask);
         void Skip_Tokens (COND_TYPE cond);
         void Break (void);
+        std::size_t Enter_Profiled_Directive(const char* directive, const LexemePosition& position);
+        void Write_Parse_Profile();
 
         inline void Write_Token(const RawToken& rawToken, SymbolTable* table = nullptr);
         inline void Write_Token(TokenId Token_Id, const RawToken& rawToken, SymbolTable* table = nullptr);
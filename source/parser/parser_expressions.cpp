@@ -913,6 +913,7 @@ void Parser::Parse_Camera_Access(Vector3d &Vect,const TokenId t)
 {
     Camera that_camera;
     unsigned int idx=0; /* default to first camera */
+    NoteSideEffect();
     Vect = Vector3d(0.0,0.0,0.0); // default value
     if (sceneData->clocklessAnimation == true)
     {
@@ -987,7 +988,6 @@ void Parser::Parse_Num_Factor (EXPRESS& Express,int *Terms)
     CompoundObject* compoundObject;
     TRANSFORM Trans;
     TurbulenceWarp Turb;
-    UCS2 *Local_String, *Local_String2;
     char *Local_C_String;
     UCS2String ign;
     shared_ptr<IStream> f;
@@ -1043,11 +1043,12 @@ void Parser::Parse_Num_Factor (EXPRESS& Express,int *Terms)
                     break;
 
                 case ASC_TOKEN:
-                    Parse_Paren_Begin();
-                    Local_String=Parse_String();
-                    Val = (DBL)Local_String[0];
-                    POV_FREE(Local_String);
-                    Parse_Paren_End();
+                    {
+                        TransientArena::Scope scope(mTransientArena);
+                        Parse_Paren_Begin();
+                        Val = (DBL)Parse_Transient_String()[0];
+                        Parse_Paren_End();
+                    }
                     break;
 
                 case ASIN_TOKEN:
@@ -1106,6 +1107,8 @@ void Parser::Parse_Num_Factor (EXPRESS& Express,int *Terms)
                     break;
 
                 case CLOCK_TOKEN:
+                    if (!maDeclarationScopes.empty())
+                        NoteKeywordRead(CLOCK_TOKEN);
                     Val = clockValue;
                     break;
 
@@ -1341,22 +1344,24 @@ void Parser::Parse_Num_Factor (EXPRESS& Express,int *Terms)
                     break;
 
                 case STRCMP_TOKEN:
-                    Parse_Paren_Begin();
-                    Local_String=Parse_String();
-                    Parse_Comma();
-                    Local_String2=Parse_String();
-                    Val = (DBL)UCS2_strcmp(Local_String, Local_String2);
-                    POV_FREE(Local_String);
-                    POV_FREE(Local_String2);
-                    Parse_Paren_End();
+                    {
+                        TransientArena::Scope scope(mTransientArena);
+                        Parse_Paren_Begin();
+                        const UCS2 *lhs = Parse_Transient_String();
+                        Parse_Comma();
+                        const UCS2 *rhs = Parse_Transient_String();
+                        Val = (DBL)UCS2_strcmp(lhs, rhs);
+                        Parse_Paren_End();
+                    }
                     break;
 
                 case STRLEN_TOKEN:
-                    Parse_Paren_Begin();
-                    Local_String=Parse_String();
-                    Val = (DBL)UCS2_strlen(Local_String);
-                    POV_FREE(Local_String);
-                    Parse_Paren_End();
+                    {
+                        TransientArena::Scope scope(mTransientArena);
+                        Parse_Paren_Begin();
+                        Val = (DBL)UCS2_strlen(Parse_Transient_String());
+                        Parse_Paren_End();
+                    }
                     break;
 
                 case TAN_TOKEN:
@@ -1411,6 +1416,9 @@ void Parser::Parse_Num_Factor (EXPRESS& Express,int *Terms)
                     if ((i < 0) || (i >= Number_Of_Random_Generators))
                         Error("Illegal random number generator.");
                     Val = stream_rand(i);
+                    // The value depends on how often the generator has been used before.
+                    if (mFingerprintContent)
+                        NoteContent(HashDeclarationValue(kDeclarationHashSeed, Val));
                     break;
 
                 case DIMENSIONS_TOKEN:
@@ -1477,11 +1485,15 @@ void Parser::Parse_Num_Factor (EXPRESS& Express,int *Terms)
 
                 case PARSED_TOKENS_TOKEN:
                 {
+                  NoteSideEffect();
+                  NoteUnstableContent();
                   Val = mTokenCount;
                 }
                 break;
                 case NOW_TOKEN:
                     {
+                        NoteSideEffect();
+                        NoteUnstableContent();
                         auto now = std::chrono::system_clock::now();
                         using FractionalDays = std::chrono::duration<double, std::ratio<24 * 60 * 60>>;
                         Val = std::chrono::duration_cast<FractionalDays> (now - mY2K).count();
@@ -1528,7 +1540,7 @@ void Parser::Parse_Num_Factor (EXPRESS& Express,int *Terms)
                         && (i>=0)
                         &&(LocalMesh->Data->Number_Of_Triangles > i))
                     {
-                      Val = LocalMesh->Data->Triangles[i].Smooth;
+                      Val = LocalMesh->Data->Get_Triangle(i).Smooth;
                     }
                     else
                     {
@@ -1702,6 +1714,7 @@ void Parser::Parse_Num_Factor (EXPRESS& Express,int *Terms)
                             Pigment = CurrentTokenDataPtr<PIGMENT*>();
                             if (const ImagePatternImpl *pattern = dynamic_cast<ImagePatternImpl*>(Pigment->pattern.get()))
                             {
+                                Resolve_Image(pattern->pImage);
                                 Vect[X] = pattern->pImage->iwidth;
                                 Vect[Y] = pattern->pImage->iheight;
                                 Vect[Z] = 0;
@@ -1745,9 +1758,9 @@ void Parser::Parse_Num_Factor (EXPRESS& Express,int *Terms)
                         &&(LocalMesh->Data->Number_Of_Triangles > i))
                     {
                       Vect = Vector3d(
-                          LocalMesh->Data->Triangles[i].P1,
-                          LocalMesh->Data->Triangles[i].P2,
-                          LocalMesh->Data->Triangles[i].P3);
+                          LocalMesh->Data->Get_Triangle(i).P1,
+                          LocalMesh->Data->Get_Triangle(i).P2,
+                          LocalMesh->Data->Get_Triangle(i).P3);
                     }
                     else
                     {
@@ -1767,9 +1780,9 @@ void Parser::Parse_Num_Factor (EXPRESS& Express,int *Terms)
                         &&(LocalMesh->Data->Number_Of_Triangles > i))
                     {
                       Vect = Vector3d(
-                          LocalMesh->Data->Triangles[i].N1,
-                          LocalMesh->Data->Triangles[i].N2,
-                          LocalMesh->Data->Triangles[i].N3);
+                          LocalMesh->Data->Get_Triangle(i).N1,
+                          LocalMesh->Data->Get_Triangle(i).N2,
+                          LocalMesh->Data->Get_Triangle(i).N3);
                     }
                     else
                     {
@@ -1789,9 +1802,9 @@ void Parser::Parse_Num_Factor (EXPRESS& Express,int *Terms)
                         &&(LocalMesh->Data->Number_Of_Triangles > i))
                     {
                       Vect = Vector3d(
-                          LocalMesh->Data->Triangles[i].UV1,
-                          LocalMesh->Data->Triangles[i].UV2,
-                          LocalMesh->Data->Triangles[i].UV3);
+                          LocalMesh->Data->Get_Triangle(i).UV1,
+                          LocalMesh->Data->Get_Triangle(i).UV2,
+                          LocalMesh->Data->Get_Triangle(i).UV3);
                     }
                     else
                     {
@@ -2270,53 +2283,48 @@ void Parser::Parse_Rel_Factor (EXPRESS& Express,int *Terms)
 DBL Parser::Parse_Rel_String_Term (const UCS2 *lhs)
 {
     int Val;
-    UCS2 *rhs = nullptr;
+    const UCS2 *rhs = nullptr;
+    TransientArena::Scope scope(mTransientArena);
 
     EXPECT_ONE
         CASE (LEFT_ANGLE_TOKEN)
-            rhs = Parse_String();
+            rhs = Parse_Transient_String();
             Val = UCS2_strcmp(lhs, rhs);
-            POV_FREE(rhs);
 
             return (DBL)(Val < 0);
         END_CASE
 
         CASE (REL_LE_TOKEN)
-            rhs = Parse_String();
+            rhs = Parse_Transient_String();
             Val = UCS2_strcmp(lhs, rhs);
-            POV_FREE(rhs);
 
             return (DBL)(Val <= 0);
         END_CASE
 
         CASE (EQUALS_TOKEN)
-            rhs = Parse_String();
+            rhs = Parse_Transient_String();
             Val = UCS2_strcmp(lhs, rhs);
-            POV_FREE(rhs);
 
             return (DBL)(Val == 0);
         END_CASE
 
         CASE (REL_NE_TOKEN)
-            rhs = Parse_String();
+            rhs = Parse_Transient_String();
             Val = UCS2_strcmp(lhs, rhs);
-            POV_FREE(rhs);
 
             return (DBL)(Val != 0);
         END_CASE
 
         CASE (REL_GE_TOKEN)
-            rhs = Parse_String();
+            rhs = Parse_Transient_String();
             Val = UCS2_strcmp(lhs, rhs);
-            POV_FREE(rhs);
 
             return (DBL)(Val >= 0);
         END_CASE
 
         CASE (RIGHT_ANGLE_TOKEN)
-            rhs = Parse_String();
+            rhs = Parse_Transient_String();
             Val = UCS2_strcmp(lhs, rhs);
-            POV_FREE(rhs);
 
             return (DBL)(Val > 0);
         END_CASE
@@ -2340,14 +2348,16 @@ void Parser::Parse_Rel_Term (EXPRESS& Express,int *Terms)
     bool oldOkToDeclare = IsOkToDeclare();
     SetOkToDeclare(true);
 
-    UCS2 *Local_String = Parse_String(false, false);
-    if (Local_String != nullptr)
     {
+        TransientArena::Scope scope(mTransientArena);
+        const UCS2 *Local_String = Parse_Transient_String(false, false);
+        if (Local_String != nullptr)
+        {
             *Terms = 1;
             Express[0] = Parse_Rel_String_Term(Local_String);
-            POV_FREE(Local_String);
             SetOkToDeclare(oldOkToDeclare);
             return;
+        }
     }
     SetOkToDeclare(oldOkToDeclare);
 
@@ -4283,6 +4293,7 @@ GenericSpline *Parser::Parse_Spline()
             Error("Spline must have at least one entry.");
 
     New->Terms = MaxTerms; // keep number of supplied terms
+    New->PrepareLookup();
 
     Allow_Identifier_In_Call = old_allow_id;
 
@@ -4347,6 +4358,7 @@ void Parser::POV_strlwr(char *s)
 
 DBL Parser::stream_rand(int stream)
 {
+    NoteSideEffect();
     return POV_rand(next_rand[stream]);
 }
 
@@ -4382,6 +4394,7 @@ DBL Parser::stream_rand(int stream)
 
 int Parser::stream_seed(int seed)
 {
+    NoteSideEffect();
     next_rand = reinterpret_cast<unsigned int *>(POV_REALLOC(next_rand, (Number_Of_Random_Generators+1)*sizeof(unsigned int), "random number generator"));
 
     next_rand[Number_Of_Random_Generators] = (unsigned int)seed;
@@ -100,6 +100,9 @@ FUNCTION_PTR Parser::Parse_Function(void)
     ExprNode *expression = nullptr;
     FunctionCode function;
 
+    // Functions live in this parser's function VM.
+    NoteSideEffect();
+
     Parse_Begin();
 
     FNCode f(this, &function, false, nullptr);
@@ -150,6 +153,9 @@ FUNCTION_PTR Parser::Parse_FunctionContent(void)
     ExprNode *expression = nullptr;
     FunctionCode function;
 
+    // Functions live in this parser's function VM.
+    NoteSideEffect();
+
     FNCode f(this, &function, false, nullptr);
 
     expression = FNSyntax_ParseExpression();
@@ -224,6 +230,9 @@ FUNCTION_PTR Parser::Parse_DeclareFunction(TokenId *token_id, const char *fn_nam
     ExprNode *expression = nullptr;
     FunctionCode function;
 
+    // Functions live in this parser's function VM.
+    NoteSideEffect();
+
     // default type is float function
     *token_id = FUNCT_ID_TOKEN;
 
@@ -217,6 +217,7 @@ ImageData *Parser::Parse_Image(int Legal, bool GammaCorrect)
     int filetype = NO_FILE;
     UCS2String ign;
     FUNCTION_PTR fnPtr;
+    bool precompute = false;
 
     image = Create_Image();
 
@@ -439,6 +440,10 @@ ImageData *Parser::Parse_Image(int Legal, bool GammaCorrect)
                 options.premultipliedOverride = true;
                 options.premultiplied = ((int)Parse_Float() != 0);
             END_CASE
+            CASE (PRECOMPUTE_TOKEN)
+                // User wants the pixel data decoded to linear floating-point once, rather than on every access.
+                precompute = true;
+            END_CASE
             OTHERWISE
                 UNGET
                 EXIT
@@ -492,18 +497,30 @@ ImageData *Parser::Parse_Image(int Legal, bool GammaCorrect)
             // e.g. ":vidcap:source=/dev/video0:w=640:h=480:fps=5"
             image->data = image->VidCap->Init(Name + 7, options, true);
             mBetaFeatureFlags.videoCapture = true;
+            NoteSideEffect();
+            NoteUnstableContent();
 #else
             Error("Beta-test video capture feature not implemented on this platform.");
 #endif
         }
+        else if (Legal == (HF_FILE))
+        {
+            // height fields need the data right away anyway
+            image->SharedData = Read_Image(filetype, filename.c_str(), options);
+            image->data = image->SharedData.get();
+        }
         else
-            image->data = Read_Image(filetype, filename.c_str(), options);
+            Read_Image_Async(image, filetype, filename.c_str(), options, precompute, Name);
 
         if (!options.warnings.empty())
             for (vector<std::string>::iterator it = options.warnings.begin(); it != options.warnings.end(); it++)
                 Warning("%s: %s", Name, it->c_str());
 
         POV_FREE(Name);
+
+        // The remaining fields are filled in by the decoder once it has delivered.
+        if (image->Decoder != nullptr)
+            return image;
     }
 
     if (image->data == nullptr)
@@ -514,6 +531,11 @@ ImageData *Parser::Parse_Image(int Legal, bool GammaCorrect)
     image->width = (SNGL) image->iwidth;
     image->height = (SNGL) image->iheight;
 
+    if (precompute)
+        Precompute_Image(image);
+
+    Account_Image_Memory(image);
+
     return image;
 }
 
@@ -626,6 +648,7 @@ void Parser::Parse_Image_Map (PIGMENT *Pigment)
         END_CASE
 
         CASE (REPEAT_TOKEN)
+            Resolve_Image(image);
             Parse_UV_Vect (Repeat);
             if ((Repeat[0]<=0.0) || (Repeat[1]<=0.0))
                 Error("Zero or Negative Image Repeat Vector.");
@@ -634,6 +657,7 @@ void Parser::Parse_Image_Map (PIGMENT *Pigment)
         END_CASE
 
         CASE (OFFSET_TOKEN)
+            Resolve_Image(image);
             Parse_UV_Vect (image->Offset);
             image->Offset[U] *= (DBL)-image->iwidth;
             image->Offset[V] *= (DBL)-image->iheight;
@@ -644,6 +668,7 @@ void Parser::Parse_Image_Map (PIGMENT *Pigment)
             // FALLTHROUGH
 
         CASE (FILTER_TOKEN)
+            Resolve_Image(image);
             EXPECT_ONE
                 CASE (ALL_TOKEN)
                     {
@@ -697,6 +722,7 @@ void Parser::Parse_Image_Map (PIGMENT *Pigment)
         END_CASE
 
         CASE (TRANSMIT_TOKEN)
+            Resolve_Image(image);
             EXPECT_ONE
                 CASE (ALL_TOKEN)
                     {
@@ -821,6 +847,7 @@ void Parser::Parse_Bump_Map (TNORMAL *Tnormal)
         END_CASE
 
         CASE (REPEAT_TOKEN)
+            Resolve_Image(image);
             Parse_UV_Vect (Repeat);
             if ((Repeat[0]<=0.0) || (Repeat[1]<=0.0))
                 Error("Zero or Negative Image Repeat Vector.");
@@ -829,6 +856,7 @@ void Parser::Parse_Bump_Map (TNORMAL *Tnormal)
         END_CASE
 
         CASE (OFFSET_TOKEN)
+            Resolve_Image(image);
             Parse_UV_Vect (image->Offset);
             image->Offset[U] *= (DBL)-image->iwidth;
             image->Offset[V] *= (DBL)-image->iheight;
@@ -925,6 +953,7 @@ PatternPtr Parser::ParseImagePattern()
         END_CASE
 
         CASE (REPEAT_TOKEN)
+            Resolve_Image(image);
             Parse_UV_Vect (Repeat);
             if ((Repeat[0]<=0.0) || (Repeat[1]<=0.0))
                 Error("Zero or Negative Image Repeat Vector.");
@@ -933,6 +962,7 @@ PatternPtr Parser::ParseImagePattern()
         END_CASE
 
         CASE (OFFSET_TOKEN)
+            Resolve_Image(image);
             Parse_UV_Vect (image->Offset);
             image->Offset[U] *= (DBL)-image->iwidth;
             image->Offset[V] *= (DBL)-image->iheight;
@@ -2979,6 +3009,7 @@ TEXTURE *Parser::Parse_Material_Map()
         END_CASE
 
         CASE (REPEAT_TOKEN)
+            Resolve_Image(pImage);
             Parse_UV_Vect (Repeat);
             if ((Repeat[0]<=0.0) || (Repeat[1]<=0.0))
                 Error("Zero or Negative Image Repeat Vector.");
@@ -2987,6 +3018,7 @@ TEXTURE *Parser::Parse_Material_Map()
         END_CASE
 
         CASE (OFFSET_TOKEN)
+            Resolve_Image(pImage);
             Parse_UV_Vect (pImage->Offset);
             pImage->Offset[U] *= -(DBL)pImage->iwidth;
             pImage->Offset[V] *= -(DBL)pImage->iheight;
@@ -3637,9 +3669,9 @@ void Parser::Parse_Media(vector<Media>& medialist)
 
         CASE (METHOD_TOKEN)
             IMedia->Sample_Method = (int)Parse_Float();
-            if (IMedia->Sample_Method != 1 && IMedia->Sample_Method!= 2 && IMedia->Sample_Method!= 3)
+            if (IMedia->Sample_Method != 1 && IMedia->Sample_Method!= 2 && IMedia->Sample_Method!= 3 && IMedia->Sample_Method!= 4)
             {
-                Error("Sample method choices are 1, 2, or 3.");
+                Error("Sample method choices are 1, 2, 3, or 4.");
             }
         END_CASE
 
@@ -3727,6 +3759,20 @@ void Parser::Parse_Media(vector<Media>& medialist)
             Parse_End();
         END_CASE
 
+        CASE (PRECOMPUTE_TOKEN)
+            IMedia->Grid_Spacing = Parse_Float();
+            Parse_Comma();
+            IMedia->Grid_Memory = Allow_Float(IMedia->Grid_Memory);
+            if (IMedia->Grid_Spacing < 0.0)
+            {
+                Error("Density grid spacing in media must not be negative.");
+            }
+            if (IMedia->Grid_Memory <= 0.0)
+            {
+                Error("Density grid memory in media must be greater than zero.");
+            }
+        END_CASE
+
         CASE (TRANSLATE_TOKEN)
             Parse_Vector (Local_Vector);
             Compute_Translation_Transform(&Local_Trans, Local_Vector);
@@ -4287,6 +4333,19 @@ SKYSPHERE *Parser::Parse_Skysphere()
             Parse_Colour(Skysphere->Emission);
         END_CASE
 
+        CASE (CACHE_RESOLUTION_TOKEN)
+        {
+            int resolution = Parse_Int();
+            if ((resolution < 0) || ((resolution & (resolution - 1)) != 0))
+                Error("sky_sphere cache_resolution must be 0 or a power of 2.");
+            if (resolution > 8192)
+                Error("sky_sphere cache_resolution must not exceed 8192.");
+            if ((resolution > 0) && (sceneData->EffectiveLanguageVersion() < 370))
+                Warning("sky_sphere cache_resolution is ignored in legacy (pre-v3.7) scenes.");
+            Skysphere->CacheResolution = (unsigned int)resolution;
+        }
+        END_CASE
+
         CASE (TRANSLATE_TOKEN)
             Parse_Vector (Local_Vector);
             Translate_Skysphere(Skysphere, Local_Vector);
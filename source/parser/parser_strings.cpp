@@ -70,11 +70,10 @@ using namespace pov;
 
 char *Parser::Parse_C_String(bool pathname)
 {
-    UCS2 *str = Parse_String(pathname);
+    TransientArena::Scope scope(mTransientArena);
+    const UCS2 *str = Parse_Transient_String(pathname);
     char *New = UCS2_To_String(str);
 
-    POV_FREE(str);
-
     return New;
 }
 
@@ -82,22 +81,22 @@ void Parser::ParseString(UTF8String& s, bool pathname)
 {
     /// @todo Add support for non-ASCII strings.
 
-    UCS2 *str = Parse_String(pathname);
+    TransientArena::Scope scope(mTransientArena);
+    const UCS2 *str = Parse_Transient_String(pathname);
     char *New = UCS2_To_String(str);
 
     s = New;
-
-    POV_FREE(str);
 }
 
 //******************************************************************************
 
-UCS2 *Parser::Parse_String(bool pathname, bool require)
+UCS2 *Parser::Parse_String(bool pathname, bool require, TransientArena* arena)
 {
     UCS2 *New = nullptr;
     int len = 0;
     const UCS2String* pString;
     const StringValue* stringValue = nullptr;
+    bool inArena = false;
 
     EXPECT
         CASE(STRING_LITERAL_TOKEN)
@@ -145,7 +144,13 @@ UCS2 *Parser::Parse_String(bool pathname, bool require)
             }
 
             len = pString->size() + 1;
-            New = reinterpret_cast<UCS2 *>(POV_MALLOC(len * sizeof(UCS2), "UCS2 String"));
+            if (arena != nullptr)
+            {
+                New = arena->AllocateArray<UCS2>(len);
+                inArena = true;
+            }
+            else
+                New = reinterpret_cast<UCS2 *>(POV_MALLOC(len * sizeof(UCS2), "UCS2 String"));
             std::memcpy(reinterpret_cast<void *>(New),
                         reinterpret_cast<const void *>(pString->c_str()),
                         len * sizeof(UCS2));
@@ -163,6 +168,7 @@ UCS2 *Parser::Parse_String(bool pathname, bool require)
         END_CASE
 
         CASE(CAMERA_TYPE_TOKEN)
+            NoteSideEffect();
             New = Parse_CameraType(pathname);
             EXIT
         END_CASE
@@ -199,7 +205,13 @@ UCS2 *Parser::Parse_String(bool pathname, bool require)
 
         CASE(STRING_ID_TOKEN)
             len = UCS2_strlen(CurrentTokenDataPtr<UCS2*>()) + 1;
-            New = reinterpret_cast<UCS2 *>(POV_MALLOC(len * sizeof(UCS2), "UCS2 String"));
+            if (arena != nullptr)
+            {
+                New = arena->AllocateArray<UCS2>(len);
+                inArena = true;
+            }
+            else
+                New = reinterpret_cast<UCS2 *>(POV_MALLOC(len * sizeof(UCS2), "UCS2 String"));
             std::memcpy(reinterpret_cast<void *>(New), CurrentTokenDataPtr<void*>(), len * sizeof(UCS2));
             EXIT
         END_CASE
@@ -215,16 +227,29 @@ UCS2 *Parser::Parse_String(bool pathname, bool require)
         END_CASE
     END_EXPECT
 
+    // Strings computed by the string functions have been allocated on the heap,
+    // but we can still have the arena take care of them.
+    if ((arena != nullptr) && (New != nullptr) && !inArena)
+        arena->Adopt(New);
+
     return New;
 }
 
 //******************************************************************************
 
+const UCS2 *Parser::Parse_Transient_String(bool pathname, bool require)
+{
+    // NB: The caller is responsible for establishing a `TransientArena::Scope`.
+    return Parse_String(pathname, require, &mTransientArena);
+}
+
+//******************************************************************************
+
 std::string Parser::Parse_SysString(bool pathname, bool require)
 {
-    UCS2 *cstr = Parse_String(pathname, require);
+    TransientArena::Scope scope(mTransientArena);
+    const UCS2 *cstr = Parse_Transient_String(pathname, require);
     std::string ret(UCS2toSysString(cstr));
-    POV_FREE(cstr);
     return ret;
 }
 
@@ -290,10 +315,12 @@ UCS2 *Parser::Parse_VStr(bool pathname)
     EXPRESS Express;
     int Terms;
     int Dim = 5;
-    UCS2 *str;
+    const UCS2 *str;
     UCS2 *str2;
     UCS2 *New;
 
+    TransientArena::Scope scope(mTransientArena);
+
     Parse_Paren_Begin();
 
     vl = (int)Parse_Float();
@@ -308,7 +335,7 @@ UCS2 *Parser::Parse_VStr(bool pathname)
     Terms = Parse_Unknown_Vector(Express);
 
     Parse_Comma();
-    str = Parse_String(pathname);
+    str = Parse_Transient_String(pathname);
     Parse_Comma();
     l = (int)Parse_Float();
     Parse_Comma();
@@ -356,8 +383,6 @@ UCS2 *Parser::Parse_VStr(bool pathname)
         POV_FREE(str2);
     }
 
-    POV_FREE(str);
-
     return New;
 }
 
@@ -365,7 +390,6 @@ UCS2 *Parser::Parse_VStr(bool pathname)
 
 UCS2 *Parser::Parse_Concat(bool pathname)
 {
-    UCS2 *str;
     UCS2 *New;
 
     Parse_Paren_Begin();
@@ -381,9 +405,11 @@ UCS2 *Parser::Parse_Concat(bool pathname)
         OTHERWISE
             UNGET
             Parse_Comma();
-            str = Parse_String(pathname);
-            New = UCS2_strcat(New, str);
-            POV_FREE(str);
+            {
+                TransientArena::Scope scope(mTransientArena);
+                const UCS2 *str = Parse_Transient_String(pathname);
+                New = UCS2_strcat(New, str);
+            }
         END_CASE
     END_EXPECT
 
@@ -717,13 +743,15 @@ UCS2 *Parser::Parse_Datetime(bool pathname)
 
 UCS2 *Parser::Parse_Substr(bool pathname)
 {
-    UCS2 *str;
+    const UCS2 *str;
     UCS2 *New;
     int l, d;
 
+    TransientArena::Scope scope(mTransientArena);
+
     Parse_Paren_Begin();
 
-    str = Parse_String(pathname);
+    str = Parse_Transient_String(pathname);
     Parse_Comma();
     l = (int)Parse_Float();
     Parse_Comma();
@@ -738,8 +766,6 @@ UCS2 *Parser::Parse_Substr(bool pathname)
     UCS2_strncpy(New, &(str[l - 1]), d);
     New[d] = 0;
 
-    POV_FREE(str);
-
     return New;
 }
 
@@ -46,6 +46,8 @@
 //  (none at the moment)
 
 // C++ standard header files
+#include <algorithm>
+#include <atomic>
 #include <limits>
 
 // POV-Ray header files (base module)
@@ -213,6 +215,10 @@ void Parser::Get_Token ()
     {
         mToken.Unget_Token = false;
 
+        // A token put back at the end of a nested value belongs to the enclosing one.
+        if (mFingerprintContent && (maContentFingerprints.size() != mContentTokenDepth))
+            NoteTokenContent();
+
         return;
     }
 
@@ -262,6 +268,7 @@ void Parser::Get_Token ()
                 }
             }
             GoToBookmark(maIncludeStack.back().returnToBookmark); // TODO handle errors
+            mProfiler.Leave(maIncludeStack.back().profileLevel, mTokenCount);
             maIncludeStack.pop_back();
 
             continue;
@@ -325,6 +332,9 @@ void Parser::Get_Token ()
         while (mToken.ungetRaw);
     }
 
+    if (mFingerprintContent)
+        NoteTokenContent();
+
     mTokenCount++;
     mTokensSinceLastProgressReport++;
 
@@ -404,6 +414,7 @@ void Parser::Read_Symbol(const RawToken& rawToken)
     int pseudoDictionary = -1;
     RawToken nextRawToken;
     bool haveNextRawToken;
+    SYM_ENTRY *contentEntry = nullptr;
 
     if (rawToken.isReservedWord && !parseRawIdentifiers)
     {
@@ -432,6 +443,9 @@ void Parser::Read_Symbol(const RawToken& rawToken)
     {
         if (pseudoDictionary >= 0)
         {
+            // We don't track which elements of the symbol tables are accessed this way.
+            NoteSideEffect();
+
             mToken.SetTokenId(DICTIONARY_ID_TOKEN);
             mToken.is_array_elem = false;
             mToken.is_mixed_array_elem = false;
@@ -445,6 +459,9 @@ void Parser::Read_Symbol(const RawToken& rawToken)
         {
             /* See if it's a previously declared identifier. */
             Temp_Entry = mSymbolStack.Find_Symbol(rawToken.lexeme.text.c_str(), &Local_Index);
+            if (!maDeclarationScopes.empty())
+                NoteSymbolRead(rawToken.lexeme.text, Temp_Entry, (Temp_Entry != nullptr) ? Local_Index : -1);
+            contentEntry = Temp_Entry;
             if (Temp_Entry != nullptr)
             {
                 if (Temp_Entry->deprecated && !Temp_Entry->deprecatedShown)
@@ -551,6 +568,8 @@ void Parser::Read_Symbol(const RawToken& rawToken)
                             }
 
                             mToken.DataPtr = &(a->DataPtrs[j]);
+                            mToken.array = a;
+                            mToken.arrayIndex = j;
                             mToken.is_mixed_array_elem = a->mixedType;
                             mToken.NumberPtr = &(a->ElementType(j));
                             mToken.SetTokenId(*mToken.NumberPtr);
@@ -630,6 +649,7 @@ void Parser::Read_Symbol(const RawToken& rawToken)
                                 break;
                             }
 
+                            contentEntry = Temp_Entry;
                             if (Temp_Entry)
                             {
                                 mToken.SetTokenId(Temp_Entry->Token_Number);
@@ -655,6 +675,13 @@ void Parser::Read_Symbol(const RawToken& rawToken)
                             if (dictIndex)
                                 POV_FREE(dictIndex);
 
+                            // Assigning to a parameter assigns to a symbol we don't keep track of.
+                            if (LValue_Ok)
+                            {
+                                NoteSideEffect();
+                                Temp_Entry->contentFingerprintData = nullptr;
+                            }
+
                             Par = reinterpret_cast<POV_PARAM *>(Temp_Entry->Data);
                             mToken.SetTokenId(*(Par->NumberPtr));
                             mToken.is_array_elem        = false;
@@ -678,6 +705,8 @@ void Parser::Read_Symbol(const RawToken& rawToken)
             mToken.context = Local_Index;
             if (dictIndex != nullptr)
                 mToken.raw.lexeme.text = dictIndex;
+            if (mFingerprintContent)
+                NoteSymbolContent(mToken.is_array_elem ? nullptr : contentEntry);
             return;
         }
     }
@@ -920,6 +949,560 @@ void Parser::UngetRawToken(const RawToken& rawToken)
     mHavePendingRawToken = true;
 }
 
+//******************************************************************************
+
+/// Whether values of the given type can be kept in the declaration cache.
+static bool IsReusableDeclarationType(TokenId type)
+{
+    switch (type)
+    {
+        case FLOAT_ID_TOKEN:        case VECTOR_ID_TOKEN:       case UV_ID_TOKEN:
+        case VECTOR_4D_ID_TOKEN:    case COLOUR_ID_TOKEN:       case STRING_ID_TOKEN:
+        case PIGMENT_ID_TOKEN:      case DENSITY_ID_TOKEN:      case NORMAL_ID_TOKEN:
+        case FINISH_ID_TOKEN:       case MEDIA_ID_TOKEN:        case INTERIOR_ID_TOKEN:
+        case MATERIAL_ID_TOKEN:     case TEXTURE_ID_TOKEN:      case OBJECT_ID_TOKEN:
+        case COLOUR_MAP_ID_TOKEN:   case PIGMENT_MAP_ID_TOKEN:  case SLOPE_MAP_ID_TOKEN:
+        case NORMAL_MAP_ID_TOKEN:   case TEXTURE_MAP_ID_TOKEN:  case DENSITY_MAP_ID_TOKEN:
+        case TRANSFORM_ID_TOKEN:    case RAINBOW_ID_TOKEN:      case FOG_ID_TOKEN:
+        case SKYSPHERE_ID_TOKEN:    case SPLINE_ID_TOKEN:
+            return true;
+
+        default:
+            // Arrays and dictionaries may be modified element-wise behind our back, functions
+            // live in the parser's function VM, and cameras may reference scene objects.
+            return false;
+    }
+}
+
+/// Start tracking the dependencies of a declaration or global settings change.
+///
+/// @param[in]  key     Position and environment identifying the declaration, or `nullptr` if
+///                     the declaration cannot be identified.
+///
+void Parser::BeginTrackedDeclaration(const DeclarationKey* key)
+{
+    DeclarationScope scope;
+    scope.haveKey           = (key != nullptr);
+    if (scope.haveKey)
+        scope.key           = *key;
+    scope.reusable          = true;
+    scope.tableIndex        = mSymbolStack.GetLocalTableIndex();
+    scope.condStackSize     = Cond_Stack.size();
+    scope.braceStackSize    = maBraceStack.size();
+    scope.includeStackSize  = maIncludeStack.size();
+    scope.stream            = mTokenizer.GetInputStream();
+    scope.tokenCount        = mTokenCount;
+    scope.experimentalFlags = GetExperimentalFlagMask();
+    maDeclarationScopes.push_back(std::move(scope));
+}
+
+/// Get the key identifying a declaration whose right-hand side is about to be parsed.
+///
+/// @return `false` if the declaration cannot be identified, e.g. because the input is not
+///         being replayed from the token cache.
+///
+bool Parser::GetDeclarationKey(DeclarationKey& key)
+{
+    if (mToken.Unget_Token || mToken.ungetRaw || mHavePendingRawToken)
+        return false;
+    key.environment = mDeclarationEnvironment;
+    return mTokenizer.GetReplayPosition(key.position);
+}
+
+/// Stop tracking the dependencies of a declaration, and cache its outcome if possible.
+///
+/// @param[in]  target  Symbol the declaration has assigned to, or `nullptr` if not applicable.
+///
+void Parser::EndTrackedDeclaration(SYM_ENTRY* target)
+{
+    POV_PARSER_ASSERT(!maDeclarationScopes.empty());
+    DeclarationScope scope(std::move(maDeclarationScopes.back()));
+    maDeclarationScopes.pop_back();
+
+    if (!scope.haveKey || !scope.reusable || (target == nullptr) || !IsReusableDeclarationType(target->Token_Number))
+        return;
+
+    // The declaration must have been parsed from a single stretch of input.
+    if ((Cond_Stack.size() != scope.condStackSize) || (maBraceStack.size() != scope.braceStackSize) ||
+        (maIncludeStack.size() != scope.includeStackSize) || (mTokenizer.GetInputStream() != scope.stream) ||
+        mToken.End_Of_File || mToken.ungetRaw)
+        return;
+
+    DeclarationResult result;
+
+    // Find out where to resume when reusing the declaration, taking into account any tokens
+    // the parser has already looked ahead at.
+    bool ok;
+    if (mToken.Unget_Token)
+        ok = (mToken.sourceFile == scope.stream) && mTokenizer.GetReplayPosition(result.end, mToken.raw.lexeme.position);
+    else if (mHavePendingRawToken)
+        ok = mTokenizer.GetReplayPosition(result.end, mPendingRawToken.lexeme.position);
+    else
+        ok = mTokenizer.GetReplayPosition(result.end);
+    if (!ok || (result.end.hash != scope.key.position.hash) || (result.end.size != scope.key.position.size) ||
+        (result.end.index < scope.key.position.index))
+        return;
+
+    // Symbols assigned by the declaration in passing must be re-assigned when reusing it.
+    for (auto& written : scope.written)
+    {
+        DeclarationEffect effect;
+        effect.name = written.first;
+        if (written.second == scope.tableIndex)
+            effect.global = false;
+        else if (written.second == mSymbolStack.GetGlobalTableIndex())
+            effect.global = true;
+        else
+            return;
+        SYM_ENTRY* entry = mSymbolStack.Find_Symbol(written.second, written.first.c_str());
+        if ((entry == nullptr) || !IsReusableDeclarationType(entry->Token_Number))
+            return;
+        effect.type = entry->Token_Number;
+        effect.data = SymbolTable::Copy_Identifier(entry->Data, entry->Token_Number);
+        result.effects.push_back(effect);
+    }
+
+    result.reads = std::move(scope.reads);
+    result.type = target->Token_Number;
+    result.data = SymbolTable::Copy_Identifier(target->Data, target->Token_Number);
+    result.tokenCount = mTokenCount - scope.tokenCount;
+    result.experimentalFlags = GetExperimentalFlagMask() & ~scope.experimentalFlags;
+
+    POV_UINT64 fingerprint = kDeclarationHashSeed;
+    fingerprint = HashDeclarationValue(fingerprint, scope.key.position.hash);
+    fingerprint = HashDeclarationValue(fingerprint, scope.key.position.size);
+    fingerprint = HashDeclarationValue(fingerprint, scope.key.position.index);
+    fingerprint = HashDeclarationValue(fingerprint, scope.key.environment);
+    fingerprint = HashDeclarationValue(fingerprint, HashDeclarationReads(result.reads));
+    result.fingerprint = fingerprint;
+
+    target->fingerprintData = target->Data;
+    target->fingerprint     = fingerprint;
+    for (auto& written : scope.written)
+    {
+        SYM_ENTRY* entry = mSymbolStack.Find_Symbol(written.second, written.first.c_str());
+        entry->fingerprintData = entry->Data;
+        entry->fingerprint     = HashDeclarationData(fingerprint, written.first.data(), written.first.size());
+    }
+
+    CacheDeclaration(scope.key, result);
+}
+
+/// Re-apply a declaration from the declaration cache, except for the assignment to its target.
+///
+/// This skips the declaration's right-hand side in the input, re-assigns any symbols the
+/// declaration assigned in passing, and records its dependencies with any enclosing
+/// declarations being tracked.
+///
+/// @return `false` if the declaration cannot be reused after all.
+///
+bool Parser::ReuseDeclaration(DeclarationResult& result)
+{
+    if (!mTokenizer.SkipReplay(result.end))
+        return false;
+
+    for (auto& read : result.reads)
+    {
+        if (read.kind == IDENTIFIER_TOKEN)
+        {
+            int index = -1;
+            SYM_ENTRY* entry = mSymbolStack.Find_Symbol(read.name.c_str(), &index);
+            NoteSymbolRead(read.name, entry, index);
+        }
+        else
+            NoteKeywordRead(read.kind);
+    }
+
+    for (auto& effect : result.effects)
+    {
+        int index = (effect.global ? mSymbolStack.GetGlobalTableIndex() : mSymbolStack.GetLocalTableIndex());
+        SYM_ENTRY* entry = mSymbolStack.Find_Symbol(index, effect.name.c_str());
+        if (entry == nullptr)
+            entry = mSymbolStack.Add_Symbol(index, effect.name, IDENTIFIER_TOKEN);
+        else
+            SymbolTable::Destroy_Ident_Data(entry->Data, entry->Token_Number);
+        entry->Token_Number    = effect.type;
+        entry->Data            = effect.data;
+        entry->fingerprintData = entry->Data;
+        entry->fingerprint     = HashDeclarationData(result.fingerprint, effect.name.data(), effect.name.size());
+        effect.data = nullptr;
+        NoteSymbolWrite(effect.name, index);
+    }
+
+    SetExperimentalFlagMask(GetExperimentalFlagMask() | result.experimentalFlags);
+    mTokenCount += result.tokenCount;
+    return true;
+}
+
+/// Start tracking a change to the global settings that may affect subsequent declarations.
+void Parser::BeginEnvironmentChange()
+{
+    if (!mReuseDeclarations)
+        return;
+
+    NoteSideEffect();
+    DeclarationKey key;
+    bool keyed = GetDeclarationKey(key);
+    BeginTrackedDeclaration(keyed ? &key : nullptr);
+}
+
+/// Finish tracking a change to the global settings.
+void Parser::EndEnvironmentChange()
+{
+    static std::atomic<POV_UINT64> nonce(0);
+
+    if (!mReuseDeclarations)
+        return;
+
+    POV_PARSER_ASSERT(!maDeclarationScopes.empty());
+    DeclarationScope scope(std::move(maDeclarationScopes.back()));
+    maDeclarationScopes.pop_back();
+
+    if (scope.haveKey && scope.reusable)
+    {
+        mDeclarationEnvironment = HashDeclarationValue(mDeclarationEnvironment, scope.key.position.hash);
+        mDeclarationEnvironment = HashDeclarationValue(mDeclarationEnvironment, scope.key.position.size);
+        mDeclarationEnvironment = HashDeclarationValue(mDeclarationEnvironment, scope.key.position.index);
+        mDeclarationEnvironment = HashDeclarationValue(mDeclarationEnvironment, HashDeclarationReads(scope.reads));
+    }
+    else
+        // We can't tell whether the change will be the same next time, so make sure that
+        // none of the subsequent declarations will match anything cached before.
+        mDeclarationEnvironment = HashDeclarationValue(mDeclarationEnvironment, POV_UINT64(++nonce));
+}
+
+/// Mix the current language and scene settings into the declaration environment fingerprint.
+void Parser::UpdateDeclarationEnvironment()
+{
+    POV_UINT64 hash = mDeclarationEnvironment;
+    hash = HashDeclarationValue(hash, sceneData->languageVersion);
+    hash = HashDeclarationValue(hash, sceneData->languageVersionSet);
+    hash = HashDeclarationValue(hash, sceneData->languageVersionLate);
+    hash = HashDeclarationValue(hash, sceneData->legacyCharset);
+    hash = HashDeclarationValue(hash, sceneData->gammaMode);
+    hash = HashDeclarationValue(hash, sceneData->noiseGenerator);
+    hash = HashDeclarationValue(hash, sceneData->explicitNoiseGenerator);
+    hash = HashDeclarationValue(hash, sceneData->warningLevel);
+    hash = HashDeclarationValue(hash, sceneData->defaultFileType);
+    hash = HashDeclarationValue(hash, sceneData->clocklessAnimation);
+    hash = HashDeclarationValue(hash, sceneData->splitUnions);
+    hash = HashDeclarationValue(hash, sceneData->removeBounds);
+    hash = HashDeclarationValue(hash, sceneData->mergeTriangles);
+    hash = HashDeclarationValue(hash, sceneData->outputAlpha);
+    hash = HashDeclarationValue(hash, sceneData->realTimeRaytracing);
+    hash = HashDeclarationValue(hash, useClock);
+    hash = HashDeclarationData(hash, sceneData->inputFile.data(), sceneData->inputFile.size() * sizeof(UCS2));
+    mDeclarationEnvironment = hash;
+}
+
+/// Record that the declarations being tracked have read a symbol.
+///
+/// @param[in]  name    Name of the symbol.
+/// @param[in]  entry   Symbol found, or `nullptr` if the symbol is undefined.
+/// @param[in]  index   Index of the symbol table the symbol was found in.
+///
+void Parser::NoteSymbolRead(const UTF8String& name, const SYM_ENTRY* entry, int index)
+{
+    int state = 0; // 0 = fingerprint not determined yet, 1 = valid, -1 = unavailable
+    POV_UINT64 fingerprint;
+
+    for (auto& scope : maDeclarationScopes)
+    {
+        if (!scope.reusable || ((entry != nullptr) && (index > scope.tableIndex)))
+            continue;
+        if (std::find(scope.written.begin(), scope.written.end(), std::make_pair(name, index)) != scope.written.end())
+            continue;
+        if (std::find_if(scope.reads.begin(), scope.reads.end(),
+                         [&name](const DeclarationRead& r) { return (r.kind == IDENTIFIER_TOKEN) && (r.name == name); }) != scope.reads.end())
+            continue;
+
+        if (state == 0)
+        {
+            if (entry == nullptr)
+                state = (GetValueFingerprint(fingerprint, NOT_A_TOKEN, nullptr, nullptr) ? 1 : -1);
+            else
+                state = (GetValueFingerprint(fingerprint, entry->Token_Number, entry->Data, entry) ? 1 : -1);
+        }
+        if (state > 0)
+            scope.reads.push_back(DeclarationRead{ IDENTIFIER_TOKEN, name, fingerprint });
+        else
+            scope.reusable = false;
+    }
+}
+
+/// Record that the declarations being tracked have read a keyword with a scene-dependent value.
+void Parser::NoteKeywordRead(TokenId keyword)
+{
+    DeclarationRead read{ keyword, UTF8String(), 0 };
+    if (!GetReadFingerprint(read.fingerprint, read))
+    {
+        NoteSideEffect();
+        NoteUnstableContent();
+        return;
+    }
+
+    if (mFingerprintContent)
+        NoteContent(read.fingerprint);
+
+    for (auto& scope : maDeclarationScopes)
+    {
+        if (std::find_if(scope.reads.begin(), scope.reads.end(),
+                         [keyword](const DeclarationRead& r) { return (r.kind == keyword); }) == scope.reads.end())
+            scope.reads.push_back(read);
+    }
+}
+
+/// Record that the declarations being tracked have assigned a symbol.
+///
+/// @param[in]  name    Name of the symbol.
+/// @param[in]  index   Index of the symbol table the symbol lives in.
+///
+void Parser::NoteSymbolWrite(const UTF8String& name, int index)
+{
+    for (auto& scope : maDeclarationScopes)
+    {
+        if (index > scope.tableIndex)
+            continue;
+        auto written = std::make_pair(name, index);
+        if (std::find(scope.written.begin(), scope.written.end(), written) == scope.written.end())
+            scope.written.push_back(written);
+    }
+}
+
+/// Record that the declarations being tracked have effects beyond their symbols.
+///
+/// Such declarations are never reused.
+///
+void Parser::NoteSideEffect()
+{
+    for (auto& scope : maDeclarationScopes)
+        scope.reusable = false;
+}
+
+/// Start accumulating the content fingerprint of a value or top-level object.
+///
+/// Content fingerprints identify the input a value was parsed from, including the values of any
+/// symbols it refers to, so that incremental re-rendering can tell which top-level objects have
+/// changed since the previous parse. Unlike declaration fingerprints, they do not depend on
+/// the position of the input.
+///
+void Parser::BeginContentFingerprint()
+{
+    maContentFingerprints.push_back(ContentFingerprint{ kDeclarationHashSeed, kDeclarationHashSeed, true });
+}
+
+/// Stop accumulating the innermost content fingerprint.
+Parser::ContentFingerprint Parser::EndContentFingerprint()
+{
+    POV_PARSER_ASSERT(!maContentFingerprints.empty());
+    ContentFingerprint content = maContentFingerprints.back();
+    maContentFingerprints.pop_back();
+    return content;
+}
+
+/// Mix a value into the innermost content fingerprint.
+void Parser::NoteContent(POV_UINT64 value)
+{
+    if (!maContentFingerprints.empty())
+        maContentFingerprints.back().hash = HashDeclarationValue(maContentFingerprints.back().hash, value);
+}
+
+/// Mix the current token into the innermost content fingerprint.
+void Parser::NoteTokenContent()
+{
+    mContentTokenDepth = maContentFingerprints.size();
+    if (maContentFingerprints.empty() || mToken.End_Of_File)
+        return;
+    ContentFingerprint& content = maContentFingerprints.back();
+    content.undo = content.hash;
+    content.hash = HashDeclarationData(content.hash, mToken.raw.lexeme.text.data(), mToken.raw.lexeme.text.size());
+}
+
+/// Mix the value of the symbol just read into the innermost content fingerprint.
+///
+/// @param[in]  entry   Symbol holding the value, or `nullptr` if the value is held elsewhere,
+///                     e.g. in an array.
+///
+void Parser::NoteSymbolContent(const SYM_ENTRY* entry)
+{
+    if (maContentFingerprints.empty() || LValue_Ok || Inside_Ifdef || parseRawIdentifiers)
+        return;
+
+    TokenId type = mToken.GetTrueTokenId();
+    const void* data = ((mToken.DataPtr != nullptr) ? *(mToken.DataPtr) : nullptr);
+    POV_UINT64 fingerprint = HashDeclarationValue(kDeclarationHashSeed, type);
+
+    if (type == ARRAY_ID_TOKEN)
+    {
+        // Elements are accounted for as they are read; only the layout matters here.
+        const POV_ARRAY* a = reinterpret_cast<const POV_ARRAY*>(data);
+        if (a != nullptr)
+        {
+            for (int i = 0; i <= a->maxDim; ++i)
+                fingerprint = HashDeclarationValue(fingerprint, a->Sizes[i]);
+            fingerprint = HashDeclarationValue(fingerprint, a->DataPtrs.size());
+        }
+    }
+    else if (type == DICTIONARY_ID_TOKEN)
+    {
+        // Elements are accounted for as they are read.
+    }
+    else if (!GetValueFingerprint(fingerprint, type, data, nullptr))
+    {
+        // Scalars are fingerprinted by value above, as some are modified in place (e.g. by `#for`);
+        // anything else is identified by the input it was parsed from.
+        if ((entry == nullptr) || (entry->contentFingerprintData == nullptr) || (entry->contentFingerprintData != entry->Data))
+        {
+            NoteUnstableContent();
+            return;
+        }
+        fingerprint = entry->contentFingerprint;
+    }
+
+    NoteContent(fingerprint);
+}
+
+/// Record that the innermost content fingerprint does not cover everything the value depends on.
+void Parser::NoteUnstableContent()
+{
+    if (!maContentFingerprints.empty())
+        maContentFingerprints.back().stable = false;
+}
+
+/// Determine the fingerprint of a symbol's value.
+///
+/// @param[out] fingerprint Fingerprint of the value.
+/// @param[in]  type        Type of the value, or @ref NOT_A_TOKEN for undefined symbols.
+/// @param[in]  data        The value.
+/// @param[in]  entry       Symbol holding the value, or `nullptr` if not applicable.
+/// @return `false` if the value cannot be fingerprinted.
+///
+bool Parser::GetValueFingerprint(POV_UINT64& fingerprint, TokenId type, const void* data, const SYM_ENTRY* entry) const
+{
+    POV_UINT64 hash = HashDeclarationValue(kDeclarationHashSeed, type);
+
+    switch (type)
+    {
+        case NOT_A_TOKEN:
+        case IDENTIFIER_TOKEN:
+            break;
+
+        case FLOAT_ID_TOKEN:
+            hash = HashDeclarationValue(hash, *reinterpret_cast<const DBL*>(data));
+            break;
+
+        case UV_ID_TOKEN:
+            for (int i = 0; i < 2; ++i)
+                hash = HashDeclarationValue(hash, (*reinterpret_cast<const Vector2d*>(data))[i]);
+            break;
+
+        case VECTOR_ID_TOKEN:
+            for (int i = 0; i < 3; ++i)
+                hash = HashDeclarationValue(hash, (*reinterpret_cast<const Vector3d*>(data))[i]);
+            break;
+
+        case VECTOR_4D_ID_TOKEN:
+            hash = HashDeclarationData(hash, data, sizeof(VECTOR_4D));
+            break;
+
+        case COLOUR_ID_TOKEN:
+            {
+                const RGBFTColour& colour = *reinterpret_cast<const RGBFTColour*>(data);
+                hash = HashDeclarationValue(hash, colour.red());
+                hash = HashDeclarationValue(hash, colour.green());
+                hash = HashDeclarationValue(hash, colour.blue());
+                hash = HashDeclarationValue(hash, colour.filter());
+                hash = HashDeclarationValue(hash, colour.transm());
+            }
+            break;
+
+        case STRING_ID_TOKEN:
+            for (const UCS2* p = reinterpret_cast<const UCS2*>(data); *p != 0; ++p)
+                hash = HashDeclarationValue(hash, *p);
+            break;
+
+        case MACRO_ID_TOKEN:
+            {
+                const Macro* macro = reinterpret_cast<const Macro*>(data);
+                if (macro->tokenCache == nullptr)
+                    return false;
+                hash = HashDeclarationValue(hash, macro->cachedEnd.hash);
+                hash = HashDeclarationValue(hash, macro->cachedEnd.size);
+                hash = HashDeclarationValue(hash, macro->cachedEnd.index);
+            }
+            break;
+
+        case PARAMETER_ID_TOKEN:
+            {
+                // Non-scalar parameters alias the caller's symbol, which we don't know here.
+                const POV_PARAM* param = reinterpret_cast<const POV_PARAM*>(data);
+                return GetValueFingerprint(fingerprint, *param->NumberPtr, *param->DataPtr, nullptr);
+            }
+
+        default:
+            // Other values are identified by the declaration that produced them, if any.
+            if ((entry == nullptr) || (data == nullptr) || (entry->Data != data) || (entry->fingerprintData != data))
+                return false;
+            hash = HashDeclarationValue(hash, entry->fingerprint);
+            break;
+    }
+
+    fingerprint = hash;
+    return true;
+}
+
+/// Determine the current fingerprint of a declaration's dependency.
+bool Parser::GetReadFingerprint(POV_UINT64& fingerprint, const DeclarationRead& read)
+{
+    switch (read.kind)
+    {
+        case IDENTIFIER_TOKEN:
+            {
+                SYM_ENTRY* entry = mSymbolStack.Find_Symbol(read.name.c_str());
+                if (entry == nullptr)
+                    return GetValueFingerprint(fingerprint, NOT_A_TOKEN, nullptr, nullptr);
+                return GetValueFingerprint(fingerprint, entry->Token_Number, entry->Data, entry);
+            }
+
+        case CLOCK_TOKEN:
+            fingerprint = HashDeclarationValue(HashDeclarationValue(kDeclarationHashSeed, read.kind), clockValue);
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+/// Get the experimental features used so far, as a bit mask.
+unsigned int Parser::GetExperimentalFlagMask() const
+{
+    return (mExperimentalFlags.backsideIllumination ? 0x001u : 0u) |
+           (mExperimentalFlags.functionHf           ? 0x002u : 0u) |
+           (mExperimentalFlags.meshCamera           ? 0x004u : 0u) |
+           (mExperimentalFlags.objImport            ? 0x008u : 0u) |
+           (mExperimentalFlags.plyImport            ? 0x010u : 0u) |
+           (mExperimentalFlags.slopeAltitude        ? 0x020u : 0u) |
+           (mExperimentalFlags.spline               ? 0x040u : 0u) |
+           (mExperimentalFlags.subsurface           ? 0x080u : 0u) |
+           (mExperimentalFlags.tiff                 ? 0x100u : 0u) |
+           (mExperimentalFlags.userDefinedCamera    ? 0x200u : 0u);
+}
+
+/// Set the experimental features used so far from a bit mask.
+void Parser::SetExperimentalFlagMask(unsigned int mask)
+{
+    mExperimentalFlags.backsideIllumination = ((mask & 0x001u) != 0);
+    mExperimentalFlags.functionHf           = ((mask & 0x002u) != 0);
+    mExperimentalFlags.meshCamera           = ((mask & 0x004u) != 0);
+    mExperimentalFlags.objImport            = ((mask & 0x008u) != 0);
+    mExperimentalFlags.plyImport            = ((mask & 0x010u) != 0);
+    mExperimentalFlags.slopeAltitude        = ((mask & 0x020u) != 0);
+    mExperimentalFlags.spline               = ((mask & 0x040u) != 0);
+    mExperimentalFlags.subsurface           = ((mask & 0x080u) != 0);
+    mExperimentalFlags.tiff                 = ((mask & 0x100u) != 0);
+    mExperimentalFlags.userDefinedCamera    = ((mask & 0x200u) != 0);
+}
+
 
 /*****************************************************************************
 *
@@ -1051,6 +1634,7 @@ void Parser::Parse_Directive()
                 if (fabs(Value)>EPSILON)
                 {
                     Cond_Stack.back().Cond_Type = WHILE_COND;
+                    Cond_Stack.back().profileLevel = Enter_Profiled_Directive("#while", hashPosition);
                 }
                 else
                 {
@@ -1079,6 +1663,7 @@ void Parser::Parse_Directive()
                     Cond_Stack.back().returnToBookmark = GetHotBookmark();
                     Cond_Stack.back().For_Loop_End = End;
                     Cond_Stack.back().For_Loop_Step = Step;
+                    Cond_Stack.back().profileLevel = Enter_Profiled_Directive("#for", hashPosition);
                 }
                 else
                 {
@@ -1286,8 +1871,13 @@ void Parser::Parse_Directive()
 
                             PMac->endPosition = hashPosition;
                             POV_OFF_T macroLength = CurrentFilePosition() - PMac->source;
+                            // If the file's tokens are cached anyway, just hold on to those;
+                            // otherwise keep a copy of the macro's raw text.
+                            PMac->tokenCache = mTokenizer.GetTokenCache();
+                            if (PMac->tokenCache != nullptr)
+                                (void)mTokenizer.GetReplayPosition(PMac->cachedEnd);
                             /// @todo Re-enable cached macros.
-                            if (macroLength <= MaxCachedMacroSize)
+                            if ((PMac->tokenCache == nullptr) && (macroLength <= MaxCachedMacroSize))
                             {
                                 PMac->CacheSize = macroLength;
                                 PMac->Cache = new unsigned char[PMac->CacheSize];
@@ -1302,6 +1892,7 @@ void Parser::Parse_Directive()
                             }
                         }
                     }
+                    mProfiler.Leave(Cond_Stack.back().profileLevel, mTokenCount);
                     Cond_Stack.pop_back();
                     if (Cond_Stack.empty())
                         Error("Mis-matched '#end'.");
@@ -1355,6 +1946,8 @@ void Parser::Parse_Directive()
                         DBL  Step       = Cond_Stack.back().For_Loop_Step;
 
                         *CurrentPtr = *CurrentPtr + Step;
+                        if (!maDeclarationScopes.empty())
+                            NoteSymbolWrite(Cond_Stack.back().Loop_Identifier, mSymbolStack.GetLocalTableIndex());
 
                         if ( ((Step > 0) && (*CurrentPtr > End + EPSILON)) ||
                              ((Step < 0) && (*CurrentPtr < End - EPSILON)) )
@@ -1404,7 +1997,9 @@ void Parser::Parse_Directive()
             }
             else
             {
+                BeginEnvironmentChange();
                 Parse_Default();
+                EndEnvironmentChange();
             }
         END_CASE
 
@@ -1416,6 +2011,7 @@ void Parser::Parse_Directive()
             }
             else
             {
+                NoteSideEffect();
                 Open_Include();
             }
         END_CASE
@@ -1428,6 +2024,7 @@ void Parser::Parse_Directive()
             }
             else
             {
+                NoteSideEffect();
                 Parse_Version();
                 if (mToken.Unget_Token && (CurrentTrueTokenId() == HASH_TOKEN))
                 {
@@ -1492,6 +2089,7 @@ void Parser::Parse_Directive()
             }
             else
             {
+                NoteSideEffect();
                 ts=Parse_C_String();
                 if(strlen(ts) > 200) // intentional 200, not 160
                 {
@@ -1511,6 +2109,7 @@ void Parser::Parse_Directive()
             }
             else
             {
+                NoteSideEffect();
                 Parse_Fopen();
             }
         END_CASE
@@ -1523,6 +2122,7 @@ void Parser::Parse_Directive()
             }
             else
             {
+                NoteSideEffect();
                 Parse_Fclose();
             }
         END_CASE
@@ -1535,7 +2135,10 @@ void Parser::Parse_Directive()
             }
             else
             {
+                NoteSideEffect();
+                size_t profileLevel = Enter_Profiled_Directive("#read", hashPosition);
                 Parse_Read();
+                mProfiler.Leave(profileLevel, mTokenCount);
             }
         END_CASE
 
@@ -1547,6 +2150,7 @@ void Parser::Parse_Directive()
             }
             else
             {
+                NoteSideEffect();
                 Parse_Write();
             }
         END_CASE
@@ -1559,6 +2163,7 @@ void Parser::Parse_Directive()
             }
             else
             {
+                NoteSideEffect();
                 POV_EXPERIMENTAL_ASSERT(IsOkToDeclare());
                 SetOkToDeclare(false);
                 EXPECT_ONE
@@ -1583,6 +2188,8 @@ void Parser::Parse_Directive()
                     CASE4 (VECTOR_4D_ID_TOKEN, RAINBOW_ID_TOKEN, FOG_ID_TOKEN, SKYSPHERE_ID_TOKEN)
                     CASE3 (MATERIAL_ID_TOKEN, SPLINE_ID_TOKEN, DICTIONARY_ID_TOKEN)
                     CASE2 (VECTOR_ID_TOKEN, FLOAT_ID_TOKEN)
+                        if (mToken.is_array_elem)
+                            mToken.array->MakeElementSparse(mToken.arrayIndex);
                         mToken.table->Remove_Symbol (CurrentTokenText().c_str(), mToken.is_array_elem, mToken.DataPtr, CurrentTrueTokenId());
                         if (mToken.is_mixed_array_elem)
                             *mToken.NumberPtr = IDENTIFIER_TOKEN;
@@ -1605,6 +2212,7 @@ void Parser::Parse_Directive()
                 {
                     Error("Cannot nest macro definitions");
                 }
+                NoteSideEffect();
                 Inside_MacroDef=true;
                 PMac=Parse_Macro();
                 Inside_MacroDef=false;
@@ -1623,6 +2231,7 @@ void Parser::Parse_Directive()
             }
             else
             {
+                NoteSideEffect();
                 Parse_Breakpoint();
             }
         END_CASE
@@ -1755,6 +2364,8 @@ void Parser::Parse_Version()
         Error("Your scene file requires POV-Ray version %g or later!\n", (DBL)(sceneData->EffectiveLanguageVersion() / 100.0));
     }
 
+    UpdateDeclarationEnvironment();
+
     SetOkToDeclare(true);
     parsingVersionDirective = wasParsingVersionDirective;
 }
@@ -1837,6 +2448,22 @@ void Parser::Break()
     POV_EXPERIMENTAL_ASSERT(!IsEndOfSkip());
 }
 
+//******************************************************************************
+
+size_t Parser::Enter_Profiled_Directive(const char* directive, const LexemePosition& position)
+{
+    if (!mProfiler.IsEnabled())
+        return ParseProfiler::kNoLevel;
+
+    // Each occurrence of a directive is profiled separately, identified by its location.
+    std::string name(directive);
+    name += " at ";
+    name += UCS2toSysString(CurrentFileName());
+    name += ":";
+    name += std::to_string(position.line);
+    return mProfiler.Enter(ParseProfileEntry::kDirective, name, mTokenCount);
+}
+
 
 /*****************************************************************************
 *
@@ -2008,6 +2635,7 @@ void Parser::Invoke_Macro()
         {
             bool finalParameter = (i == PMac->parameters.size()-1);
             Table_Entries[i] = SymbolTable::Create_Entry (PMac->parameters[i].name, IDENTIFIER_TOKEN);
+            mContentTarget = Table_Entries[i];
             if (!Parse_RValue(IDENTIFIER_TOKEN, &(Table_Entries[i]->Token_Number), &(Table_Entries[i]->Data), nullptr, true, false, true, true, true, Local_Index))
             {
                 EXPECT_ONE
@@ -2053,6 +2681,9 @@ void Parser::Invoke_Macro()
     Cond_Stack.back().returnToBookmark   = GetHotBookmark();
     Cond_Stack.back().PMac               = PMac;
 
+    if (mProfiler.IsEnabled())
+        Cond_Stack.back().profileLevel   = mProfiler.Enter(ParseProfileEntry::kMacro, PMac->Macro_Name, mTokenCount);
+
     /* Gotta have new symbol table in case #local is used */
     mSymbolStack.PushTable();
 
@@ -2074,17 +2705,24 @@ void Parser::Invoke_Macro()
         Cond_Stack.back().Macro_Same_Flag = false;
         Got_EOF=false;
         shared_ptr<IStream> is;
-        if (PMac->Cache)
+        if (PMac->tokenCache)
         {
-            is = std::make_shared<IMemStream>(Cond_Stack.back().PMac->Cache, PMac->CacheSize, PMac->source.fileName, PMac->source.offset);
+            mTokenizer.SetInputTokens(PMac->tokenCache);
         }
         else
         {
-            is = Locate_File (PMac->source.fileName, POV_File_Text_Macro, ign, true);
-            if (is == nullptr)
-                Error ("Cannot open macro file '%s'.", UCS2toSysString(PMac->source.fileName).c_str());
+            if (PMac->Cache)
+            {
+                is = std::make_shared<IMemStream>(Cond_Stack.back().PMac->Cache, PMac->CacheSize, PMac->source.fileName, PMac->source.offset);
+            }
+            else
+            {
+                is = Locate_File (PMac->source.fileName, POV_File_Text_Macro, ign, true);
+                if (is == nullptr)
+                    Error ("Cannot open macro file '%s'.", UCS2toSysString(PMac->source.fileName).c_str());
+            }
+            mTokenizer.SetInputStream(is);
         }
-        mTokenizer.SetInputStream(is);
     }
     else
     {
@@ -2121,6 +2759,7 @@ void Parser::Return_From_Macro()
     // Always destroy macro locals
     mSymbolStack.PopTable();
 
+    mProfiler.Leave(Cond_Stack.back().profileLevel, mTokenCount);
     Cond_Stack.pop_back();
     if (Cond_Stack.empty())
         Error("Mis-matched '#end'.");
@@ -2128,7 +2767,8 @@ void Parser::Return_From_Macro()
 
 Parser::Macro::Macro(const char *s) :
     Macro_Name(POV_STRDUP(s)),
-    Cache(nullptr)
+    Cache(nullptr),
+    cachedEnd{ 0, 0, 0 }
 {}
 
 Parser::Macro::~Macro()
@@ -2153,7 +2793,9 @@ Parser::POV_ARRAY *Parser::Parse_Array_Declare (void)
     size_t j;
 
     New = new POV_ARRAY;
+    New->DenseType = EMPTY_ARRAY_TOKEN;
     New->resizable = false;
+    New->escaped = false;
     New->mixedType = AllowToken(MIXED_TOKEN);
 
     i=0;
@@ -2350,6 +2992,8 @@ void Parser::Parse_Initalizer (int Sub, size_t Base, POV_ARRAY *a)
                     END_CASE
                 END_EXPECT
             }
+            else
+                a->MakeElementDense(Base+i);
             properlyDelimited = Parse_Comma();
         }
     }
@@ -2418,6 +3062,10 @@ void Parser::Parse_Fopen(void)
         END_CASE
     END_EXPECT
 
+    // The file may be included later on, so make sure we're not using stale cached tokens.
+    if (New->Out_File != nullptr)
+        mTokenizer.InvalidateCachedStreams();
+
     New->busyParsing = false;
 }
 
@@ -2433,6 +3081,8 @@ void Parser::Parse_Fclose(void)
             // NB no need to set Data->busyParsing, as we're not reading any tokens where the
             // tokenizer might stumble upon nested file access directives
             Got_EOF=false;
+            if (Data->Out_File != nullptr)
+                mTokenizer.InvalidateCachedStreams();
             Data->inTokenizer = nullptr;
             Data->Out_File = nullptr;
             mSymbolStack.GetGlobalTable()->Remove_Symbol(CurrentTokenText().c_str(), false, nullptr, 0);
@@ -2488,6 +3138,8 @@ void Parser::Parse_Read()
         CASE (STRING_ID_TOKEN)
             if (!End_File)
             {
+                if (mToken.is_array_elem)
+                    mToken.array->MakeElementSparse(mToken.arrayIndex);
                 End_File = Parse_Read_Value (User_File, CurrentTrueTokenId(), mToken.NumberPtr, mToken.DataPtr);
                 // TODO - Why are we clearing the array/dictionary related flags in this case
                 //        but not in case of VECTOR_ID_TOKEN and FLOAT_ID_TOKEN?
@@ -2498,10 +3150,19 @@ void Parser::Parse_Read()
             }
         END_CASE
 
-        CASE2 (VECTOR_ID_TOKEN, FLOAT_ID_TOKEN)
+        // Uninitialized elements of homogenous arrays are accepted as well, so that arrays can be
+        // filled from a file.
+        CASE3 (VECTOR_ID_TOKEN, FLOAT_ID_TOKEN, EMPTY_ARRAY_TOKEN)
             if (!End_File)
             {
+                bool arrayElement = mToken.is_array_elem;
+                POV_ARRAY* a = mToken.array;
+                size_t index = mToken.arrayIndex;
+                if (arrayElement)
+                    a->MakeElementSparse(index);
                 End_File = Parse_Read_Value (User_File, CurrentTrueTokenId(), mToken.NumberPtr, mToken.DataPtr);
+                if (arrayElement)
+                    a->MakeElementDense(index);
                 // TODO - Why are we not clearing the array/dictionary related flags in this case,
                 //        as we do in case of STRING_ID_TOKEN?
                 Parse_Comma(); /* Scene file comma between 2 idents */
@@ -2944,6 +3605,9 @@ int Parser::Parse_For_Param (UTF8String& identifierName, DBL* EndPtr, DBL* StepP
 
     LValue_Ok = false;
 
+    if (!maDeclarationScopes.empty())
+        NoteSymbolWrite(CurrentTokenText(), mSymbolStack.GetLocalTableIndex());
+
     *mToken.NumberPtr = FLOAT_ID_TOKEN;
     Test_Redefine(Previous,mToken.NumberPtr,*mToken.DataPtr, true);
     *mToken.DataPtr   = reinterpret_cast<void *>(Create_Float());
@@ -2984,6 +3648,9 @@ void Parser::IncludeHeader(const UCS2String& formalFileName)
 
     SetInputStream(is);
 
+    if (mProfiler.IsEnabled())
+        maIncludeStack.back().profileLevel = mProfiler.Enter(ParseProfileEntry::kInclude, UCS2toSysString(formalFileName), mTokenCount);
+
     mSymbolStack.PushTable();
 
     InvalidateCurrentToken();
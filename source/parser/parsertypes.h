@@ -198,7 +198,11 @@ struct ParserOptions final
     bool    useClock;
     DBL     clock;
     size_t  randomSeed;
-    ParserOptions(bool uc, DBL c, size_t rs) : useClock(uc), clock(c), randomSeed(rs) {}
+    unsigned int threads;   ///< Maximum number of threads to use for tasks that can run in parallel.
+    bool    reuseDeclarations; ///< Whether to reuse declarations evaluated in previous parses.
+    bool    deferImageDecoding; ///< Whether to decode image files only when first accessed, rather than in parallel.
+    ParserOptions(bool uc, DBL c, size_t rs, unsigned int t = 1, bool rd = false, bool did = false) :
+        useClock(uc), clock(c), randomSeed(rs), threads(t), reuseDeclarations(rd), deferImageDecoding(did) {}
 };
 
 //------------------------------------------------------------------------------
@@ -37,7 +37,15 @@
 #include "parser/rawtokenizer.h"
 
 // C++ variants of C standard header files
+//  (none at the moment)
+
 // C++ standard header files
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <type_traits>
 
 // POV-Ray header files (base module)
 #include "base/fileinputoutput.h"
@@ -66,6 +74,86 @@ static int HexDigitToInt(UTF8String::value_type c)
     return -1;
 }
 
+// NB: The result is only correctly rounded if the final division or multiplication is carried
+// out as a single IEEE operation. `-ffast-math` would permit the compiler to replace the division
+// with a multiplication by an inexact reciprocal; GCC does not do this for a single division by a
+// table value, but tests/source/tests_rawtokenizer.cpp checks the results against strtod, and
+// should be run whenever the compiler or its flags change.
+bool FastFloatLiteralToDouble(const UTF8String& text, double& value)
+{
+    static const double kPowersOfTen[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    const int kMaxExponent = 22;
+    const int kMaxDigits = 19;
+
+    const char* p = text.c_str();
+    POV_UINT64 mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+
+    // Integer part; leading zeros are not significant.
+    for (; (*p >= '0') && (*p <= '9'); ++p)
+    {
+        if ((mantissa == 0) && (*p == '0'))
+            continue;
+        if (++digits > kMaxDigits)
+            return false;
+        mantissa = mantissa * 10 + (*p - '0');
+    }
+
+    // Fractional part.
+    if (*p == '.')
+    {
+        for (++p; (*p >= '0') && (*p <= '9'); ++p)
+        {
+            --exponent;
+            if ((mantissa == 0) && (*p == '0'))
+                continue;
+            if (++digits > kMaxDigits)
+                return false;
+            mantissa = mantissa * 10 + (*p - '0');
+        }
+    }
+
+    // Scientific notation exponent; the scanner allows it to have no digits.
+    if ((*p == 'e') || (*p == 'E'))
+    {
+        ++p;
+        bool negative = (*p == '-');
+        if ((*p == '+') || (*p == '-'))
+            ++p;
+        // Saturate rather than bail out, so that zero with a huge exponent is still handled here.
+        int explicitExponent = 0;
+        for (; (*p >= '0') && (*p <= '9'); ++p)
+        {
+            if (explicitExponent <= 1000)
+                explicitExponent = explicitExponent * 10 + (*p - '0');
+        }
+        exponent += (negative ? -explicitExponent : explicitExponent);
+    }
+
+    if (*p != '\0')
+        return false;
+
+    if (mantissa == 0)
+    {
+        value = 0.0;
+        return true;
+    }
+
+    if ((mantissa > (POV_UINT64(1) << 53)) || (exponent < -kMaxExponent) || (exponent > kMaxExponent))
+        return false;
+
+    value = double(mantissa);
+    if (exponent < 0)
+        value /= kPowersOfTen[-exponent];
+    else
+        value *= kPowersOfTen[exponent];
+    return true;
+}
+
 static bool IsUCS4ScalarValue(UCS4 c)
 {
     return (c <= 0x10FFFFu) && ((c < 0xD800u) || (c > 0xDFFFu));
@@ -73,6 +161,123 @@ static bool IsUCS4ScalarValue(UCS4 c)
 
 //******************************************************************************
 
+/// Lexemes of an input stream, as produced by the scanner.
+///
+/// Entries are immutable once created, and shared by all raw tokenizers reading a stream of
+/// identical name and content.
+///
+struct TokenCacheEntry final
+{
+    /// Individual token.
+    struct Token final
+    {
+        LexemePosition  position;       ///< Position of the lexeme.
+        LexemePosition  endPosition;    ///< Scanner position after the lexeme.
+        unsigned int    lexeme;         ///< Index into @ref lexemes.
+    };
+
+    /// Scanner state in effect after a given number of tokens.
+    struct State final
+    {
+        size_t                          tokenCount;
+        Scanner::CharacterEncodingPtr   characterEncoding;
+        Scanner::Character              nominalEndOfLine;
+    };
+
+    UCS2String              name;
+    POV_OFF_T               size;
+    POV_UINT64              hash;
+    std::vector<RawToken>   lexemes;        ///< Distinct lexemes; fully processed except for words.
+    std::vector<Token>      tokens;
+    std::vector<State>      states;         ///< Scanner state changes, in order of @ref State::tokenCount.
+    LexemePosition          endPosition;    ///< Scanner position at end of stream.
+    State                   endState;       ///< Scanner state at end of stream.
+    size_t                  memory;         ///< Approximate memory footprint.
+
+    const State& GetState(size_t tokenCount) const
+    {
+        auto i = std::upper_bound(states.begin(), states.end(), tokenCount,
+                                  [](size_t n, const State& s) { return n < s.tokenCount; });
+        POV_PARSER_ASSERT(i != states.begin());
+        return *(i - 1);
+    }
+};
+
+/// Process-wide cache of scanned input streams.
+struct TokenCache final
+{
+    std::mutex                  mutex;
+    std::list<TokenCachePtr>    entries;    ///< Most recently used first.
+    size_t                      memory;
+
+    TokenCache() : memory(0) {}
+
+    TokenCachePtr Find(const UCS2String& name, POV_OFF_T size, POV_UINT64 hash);
+    TokenCachePtr Insert(const TokenCachePtr& pEntry);
+};
+
+static TokenCache gTokenCache;
+
+TokenCachePtr TokenCache::Find(const UCS2String& name, POV_OFF_T size, POV_UINT64 hash)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (auto i = entries.begin(); i != entries.end(); ++i)
+    {
+        if (((*i)->hash == hash) && ((*i)->size == size) && ((*i)->name == name))
+        {
+            entries.splice(entries.begin(), entries, i);
+            return entries.front();
+        }
+    }
+    return nullptr;
+}
+
+TokenCachePtr TokenCache::Insert(const TokenCachePtr& pEntry)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (auto i = entries.begin(); i != entries.end(); )
+    {
+        if ((*i)->name != pEntry->name)
+            ++i;
+        else if (((*i)->hash == pEntry->hash) && ((*i)->size == pEntry->size))
+            return *i; // someone else was faster
+        else
+        {
+            // Stale version of the same file.
+            memory -= (*i)->memory;
+            i = entries.erase(i);
+        }
+    }
+
+    entries.push_front(pEntry);
+    memory += pEntry->memory;
+
+    // Evict least recently used entries; raw tokenizers still replaying them keep them alive.
+    while ((memory > POV_PARSER_TOKEN_CACHE_SIZE) && (entries.size() > 1))
+    {
+        memory -= entries.back()->memory;
+        entries.pop_back();
+    }
+
+    return pEntry;
+}
+
+/// Compute a 64-bit FNV-1a hash of a file's contents.
+static POV_UINT64 HashTokenCacheData(const std::vector<unsigned char>& data)
+{
+    POV_UINT64 hash = 0xCBF29CE484222325ull;
+    for (unsigned char c : data)
+    {
+        hash ^= c;
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+//******************************************************************************
+
 void AmbiguousStringValue::InvalidEscapeSequenceInfo::Throw() const
 {
     throw InvalidEscapeSequenceException(stream->Name(), position, text);
@@ -99,45 +304,242 @@ RawTokenizer::KnownWordInfo::KnownWordInfo() :
 
 //******************************************************************************
 
-RawTokenizer::RawTokenizer() :
-    mNextIdentifierId(TOKEN_COUNT+1)
+RawTokenizer::ReservedWordTable::ReservedWordTable()
 {
+    size_t count = 0;
+    for (auto i = Reserved_Words; i->Token_Name != nullptr; ++i)
+        ++count;
+
+    size_t size = 16;
+    while (size < count * 4)
+        size *= 2;
+    mMask = size - 1;
+    mEntries.resize(size, Entry{ nullptr, 0, KnownWordInfo() });
+
     for (auto i = Reserved_Words; i->Token_Name != nullptr; ++i)
     {
         if (!isalpha(i->Token_Name[0]))
             continue;
         if (strchr(i->Token_Name, ' ') != nullptr)
             continue;
-        KnownWordInfo& knownWord        = mKnownWords[i->Token_Name];
-        knownWord.id                    = i->Token_Number;
-        knownWord.expressionId          = GetCategorizedTokenId(i->Token_Number);
-        knownWord.isReservedWord        = true;
-        knownWord.isPseudoIdentifier    = ((knownWord.id == GLOBAL_TOKEN) || (knownWord.id == LOCAL_TOKEN));
+        size_t length = strlen(i->Token_Name);
+        size_t slot = Hash(i->Token_Name, length) & mMask;
+        // Probe for a free slot, or the slot of a duplicate spelling (in which case the later entry wins).
+        while ((mEntries[slot].name != nullptr) &&
+               ((mEntries[slot].length != length) || (memcmp(mEntries[slot].name, i->Token_Name, length) != 0)))
+            slot = (slot + 1) & mMask;
+        Entry& entry                    = mEntries[slot];
+        entry.name                      = i->Token_Name;
+        entry.length                    = length;
+        entry.info.id                   = i->Token_Number;
+        entry.info.expressionId         = GetCategorizedTokenId(i->Token_Number);
+        entry.info.isReservedWord       = true;
+        entry.info.isPseudoIdentifier   = ((entry.info.id == GLOBAL_TOKEN) || (entry.info.id == LOCAL_TOKEN));
     }
 }
 
+const RawTokenizer::ReservedWordTable& RawTokenizer::ReservedWordTable::Get()
+{
+    static const ReservedWordTable table;
+    return table;
+}
+
+size_t RawTokenizer::ReservedWordTable::Hash(const char* name, size_t length)
+{
+    // FNV-1a
+    std::uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; ++i)
+        hash = (hash ^ (unsigned char)name[i]) * 16777619u;
+    return hash;
+}
+
+const RawTokenizer::KnownWordInfo* RawTokenizer::ReservedWordTable::Find(const UTF8String& word) const
+{
+    size_t length = word.size();
+    const char* name = word.data();
+    for (size_t slot = Hash(name, length) & mMask; mEntries[slot].name != nullptr; slot = (slot + 1) & mMask)
+    {
+        const Entry& entry = mEntries[slot];
+        if ((entry.length == length) && (memcmp(entry.name, name, length) == 0))
+            return &entry.info;
+    }
+    return nullptr;
+}
+
+//******************************************************************************
+
+RawTokenizer::RawTokenizer() :
+    mNextIdentifierId(TOKEN_COUNT+1),
+    mAllowNestedBlockComments(true),
+    mReplayIndex(0),
+    mReplayAtEnd(false)
+{
+    // Build the shared reserved word table now rather than on the first word scanned.
+    (void)ReservedWordTable::Get();
+}
+
 void RawTokenizer::SetInputStream(StreamPtr pStream)
 {
+    mpReplay = nullptr;
+
+    CachedStreamPtr pCached = GetCachedStream(pStream);
+    if (pCached != nullptr)
+    {
+        // Forget about streams no longer in use before registering the new one.
+        mReplayableStreams.erase(std::remove_if(mReplayableStreams.begin(), mReplayableStreams.end(),
+                                                [](const ReplayableStream& s) { return s.pStream.expired(); }),
+                                 mReplayableStreams.end());
+        mReplayableStreams.push_back(ReplayableStream{ pStream, pCached });
+
+        if (mAllowNestedBlockComments)
+        {
+            mpReplay = pCached;
+            mpReplayStream = pStream;
+            mReplayIndex = 0;
+            mReplayAtEnd = false;
+            return;
+        }
+    }
+
     mScanner.SetInputStream(pStream);
 }
 
 void RawTokenizer::SetStringEncoding(CharacterEncodingID encoding)
 {
+    // Cached lexemes are only valid for the encoding the scanner chose by itself.
+    StopReplay();
     mScanner.SetCharacterEncoding(encoding);
 }
 
 void pov_parser::RawTokenizer::SetNestedBlockComments(bool allow)
 {
+    if (!allow)
+        StopReplay();
     mScanner.SetNestedBlockComments(allow);
+    mAllowNestedBlockComments = allow;
+}
+
+TokenCachePtr RawTokenizer::GetTokenCache() const
+{
+    if (mpReplay == nullptr)
+        return nullptr;
+    return mpReplay->pEntry;
+}
+
+bool RawTokenizer::GetReplayPosition(CachedTokenPosition& position) const
+{
+    if (mpReplay == nullptr)
+        return false;
+
+    const TokenCacheEntry& entry = *mpReplay->pEntry;
+    position.hash  = entry.hash;
+    position.size  = entry.size;
+    position.index = (mReplayAtEnd ? entry.tokens.size() : mReplayIndex);
+    return true;
+}
+
+bool RawTokenizer::GetReplayPosition(CachedTokenPosition& position, const LexemePosition& lexemePosition) const
+{
+    if (mpReplay == nullptr)
+        return false;
+
+    const TokenCacheEntry& entry = *mpReplay->pEntry;
+    auto i = std::lower_bound(entry.tokens.begin(), entry.tokens.end(), lexemePosition.offset,
+                              [](const TokenCacheEntry::Token& t, POV_OFF_T o) { return t.position.offset < o; });
+    if ((i == entry.tokens.end()) || (i->position.offset != lexemePosition.offset))
+        return false;
+
+    position.hash  = entry.hash;
+    position.size  = entry.size;
+    position.index = size_t(i - entry.tokens.begin());
+    return true;
+}
+
+bool RawTokenizer::SkipReplay(const CachedTokenPosition& position)
+{
+    if (mpReplay == nullptr)
+        return false;
+
+    const TokenCacheEntry& entry = *mpReplay->pEntry;
+    if ((position.hash != entry.hash) || (position.size != entry.size) ||
+        mReplayAtEnd || (position.index < mReplayIndex) || (position.index > entry.tokens.size()))
+        return false;
+
+    mReplayIndex = position.index;
+    return true;
+}
+
+void RawTokenizer::SetInputTokens(const TokenCachePtr& pTokens)
+{
+    // Stand-in for the original stream, providing just the name. We never need to fall back to
+    // the scanner for this one, as any bookmark into it originates from the replay.
+    StreamPtr pStream = std::make_shared<IMemStream>(nullptr, 0, pTokens->name);
+
+    CachedStreamPtr pCached;
+    auto iCached = mCachedStreams.find(pTokens->name);
+    if ((iCached != mCachedStreams.end()) && (iCached->second->pEntry == pTokens))
+        pCached = iCached->second;
+    else
+    {
+        pCached = std::make_shared<CachedStream>();
+        pCached->pEntry = pTokens;
+        pCached->words.assign(pTokens->lexemes.size(), nullptr);
+    }
+
+    mReplayableStreams.erase(std::remove_if(mReplayableStreams.begin(), mReplayableStreams.end(),
+                                            [](const ReplayableStream& s) { return s.pStream.expired(); }),
+                             mReplayableStreams.end());
+    mReplayableStreams.push_back(ReplayableStream{ pStream, pCached });
+
+    mpReplay = pCached;
+    mpReplayStream = pStream;
+    mReplayIndex = 0;
+    mReplayAtEnd = false;
+}
+
+void RawTokenizer::InvalidateCachedStreams()
+{
+    mCachedStreams.clear();
+    mReplayableStreams.clear();
 }
 
 //------------------------------------------------------------------------------
 
 bool RawTokenizer::GetNextToken(RawToken& token)
 {
+    if (mpReplay != nullptr)
+    {
+        const TokenCacheEntry& entry = *mpReplay->pEntry;
+        if (mReplayIndex >= entry.tokens.size())
+        {
+            mReplayAtEnd = true;
+            return false;
+        }
+
+        const TokenCacheEntry::Token& cachedToken = entry.tokens[mReplayIndex++];
+        token = entry.lexemes[cachedToken.lexeme];
+        token.lexeme.position = cachedToken.position;
+        if (token.lexeme.category == Lexeme::kWord)
+        {
+            const KnownWordInfo*& pWord = mpReplay->words[cachedToken.lexeme];
+            if (pWord == nullptr)
+                pWord = &GetKnownWord(token.lexeme.text);
+            token.id                    = pWord->id;
+            token.expressionId          = pWord->expressionId;
+            token.isReservedWord        = pWord->isReservedWord;
+            token.isPseudoIdentifier    = pWord->isPseudoIdentifier;
+        }
+        return true;
+    }
+
     if (!mScanner.GetNextLexeme(token.lexeme))
         return false;
 
+    return ProcessLexeme(token);
+}
+
+bool RawTokenizer::ProcessLexeme(RawToken& token)
+{
     switch (token.lexeme.category)
     {
         case Lexeme::kWord:             if (ProcessWordLexeme(token))           return true;
@@ -151,7 +553,27 @@ bool RawTokenizer::GetNextToken(RawToken& token)
 
 bool RawTokenizer::GetNextDirective(RawToken& token)
 {
-    if (!mScanner.GetNextDirective(token.lexeme))
+    if (mpReplay != nullptr)
+    {
+        const TokenCacheEntry& entry = *mpReplay->pEntry;
+        for (;;)
+        {
+            if (mReplayIndex >= entry.tokens.size())
+            {
+                mReplayAtEnd = true;
+                return false;
+            }
+            const TokenCacheEntry::Token& cachedToken = entry.tokens[mReplayIndex++];
+            const RawToken& cachedLexeme = entry.lexemes[cachedToken.lexeme];
+            if ((cachedLexeme.lexeme.category == Lexeme::kOther) && (cachedLexeme.id == int(HASH_TOKEN)))
+            {
+                token.lexeme = cachedLexeme.lexeme;
+                token.lexeme.position = cachedToken.position;
+                break;
+            }
+        }
+    }
+    else if (!mScanner.GetNextDirective(token.lexeme))
         return false;
 
     POV_PARSER_ASSERT(token.lexeme.category == Lexeme::kOther);
@@ -166,17 +588,27 @@ bool RawTokenizer::GetNextDirective(RawToken& token)
     return true;
 }
 
-bool RawTokenizer::ProcessWordLexeme(RawToken& token)
+const RawTokenizer::KnownWordInfo& RawTokenizer::GetKnownWord(const UTF8String& word)
 {
-    POV_PARSER_ASSERT(token.lexeme.category == Lexeme::kWord);
-    POV_PARSER_ASSERT(token.lexeme.text.size() > 0);
+    const KnownWordInfo* reserved = ReservedWordTable::Get().Find(word);
+    if (reserved != nullptr)
+        return *reserved;
 
-    auto& i = mKnownWords[token.lexeme.text];
+    auto& i = mKnownWords[word];
     if (i.id == int(NOT_A_TOKEN))
     {
         i.id = ++mNextIdentifierId;
         i.expressionId = IDENTIFIER_TOKEN;
     }
+    return i;
+}
+
+bool RawTokenizer::ProcessWordLexeme(RawToken& token)
+{
+    POV_PARSER_ASSERT(token.lexeme.category == Lexeme::kWord);
+    POV_PARSER_ASSERT(token.lexeme.text.size() > 0);
+
+    auto& i = GetKnownWord(token.lexeme.text);
     token.id = i.id;
     token.expressionId = i.expressionId;
     token.value = nullptr;
@@ -193,7 +625,10 @@ bool RawTokenizer::ProcessFloatLiteralLexeme(RawToken& token)
     token.id = int(FLOAT_TOKEN);
     token.expressionId = FLOAT_TOKEN_CATEGORY;
 
-    if (sscanf(token.lexeme.text.c_str(), POV_DBL_FORMAT_STRING, &token.floatValue) == 0)
+    double value;
+    if (std::is_same<DBL, double>::value && FastFloatLiteralToDouble(token.lexeme.text, value))
+        token.floatValue = DBL(value);
+    else if (sscanf(token.lexeme.text.c_str(), POV_DBL_FORMAT_STRING, &token.floatValue) == 0)
         return false;
 
     token.isReservedWord = false;
@@ -443,6 +878,7 @@ bool RawTokenizer::ProcessSignatureLexeme(RawToken& token)
 
 bool RawTokenizer::GetRaw(unsigned char* buffer, size_t size)
 {
+    StopReplay();
     return mScanner.GetRaw(buffer, size);
 }
 
@@ -450,33 +886,254 @@ bool RawTokenizer::GetRaw(unsigned char* buffer, size_t size)
 
 pov_parser::ConstStreamPtr RawTokenizer::GetInputStream() const
 {
+    if (mpReplay != nullptr)
+        return mpReplayStream;
     return mScanner.GetInputStream();
 }
 
 pov_base::UCS2String RawTokenizer::GetInputStreamName() const
 {
+    if (mpReplay != nullptr)
+        return mpReplayStream->Name();
     return mScanner.GetInputStreamName();
 }
 
 pov_parser::RawTokenizer::HotBookmark RawTokenizer::GetHotBookmark()
 {
+    if (mpReplay != nullptr)
+        return GetReplayBookmark();
     return mScanner.GetHotBookmark();
 }
 
 pov_parser::RawTokenizer::ColdBookmark RawTokenizer::GetColdBookmark() const
 {
+    if (mpReplay != nullptr)
+    {
+        HotBookmark bookmark = GetReplayBookmark();
+        return ColdBookmark(bookmark.pStream->Name(), bookmark, bookmark.characterEncoding,
+                            bookmark.nominalEndOfLine, bookmark.allowNestedBlockComments);
+    }
     return mScanner.GetColdBookmark();
 }
 
 bool RawTokenizer::GoToBookmark(const HotBookmark& bookmark)
 {
+    if (ResumeReplay(bookmark.pStream, bookmark))
+        return true;
+    mpReplay = nullptr;
+    mAllowNestedBlockComments = bookmark.allowNestedBlockComments;
     return mScanner.GoToBookmark(bookmark);
 }
 
 bool RawTokenizer::GoToBookmark(const ColdBookmark& bookmark)
 {
+    if (bookmark.fileName != GetInputStreamName())
+        return false;
+    if (ResumeReplay(GetInputStream(), bookmark))
+        return true;
+    mAllowNestedBlockComments = bookmark.allowNestedBlockComments;
+    if (mpReplay != nullptr)
+    {
+        // Scanner is not positioned in the current stream yet.
+        HotBookmark hotBookmark(mpReplayStream, bookmark, bookmark.characterEncoding,
+                                bookmark.nominalEndOfLine, bookmark.allowNestedBlockComments);
+        mpReplay = nullptr;
+        return mScanner.GoToBookmark(hotBookmark);
+    }
     return mScanner.GoToBookmark(bookmark);
 }
 
+//------------------------------------------------------------------------------
+
+RawTokenizer::CachedStreamPtr RawTokenizer::GetCachedStream(const StreamPtr& pStream)
+{
+    if (POV_PARSER_TOKEN_CACHE_SIZE == 0)
+        return nullptr;
+
+    // Streams not starting at the beginning of a file (e.g. cached macros) are not eligible.
+    if (pStream->tellg() != 0)
+        return nullptr;
+
+    // Files are presumed not to change during parsing, except where the parser says otherwise;
+    // so we only need to load (and hash) each file once.
+    CachedStreamPtr& pCached = mCachedStreams[pStream->Name()];
+    if (pCached == nullptr)
+    {
+        pCached = std::make_shared<CachedStream>();
+        pCached->pEntry = LoadTokenCacheEntry(pStream);
+        if (pCached->pEntry != nullptr)
+            pCached->words.assign(pCached->pEntry->lexemes.size(), nullptr);
+    }
+
+    if (pCached->pEntry == nullptr)
+        return nullptr;
+    return pCached;
+}
+
+TokenCachePtr RawTokenizer::LoadTokenCacheEntry(const StreamPtr& pStream)
+{
+    POV_OFF_T size = -1;
+    if (pStream->seekg(0, IOBase::seek_end))
+        size = pStream->tellg();
+
+    // Don't bother reading files that would most likely exceed the cache size anyway,
+    // presuming a typical density of about one token per four octets.
+    std::vector<unsigned char> data;
+    bool ok = ((size > 0) && (size * (sizeof(TokenCacheEntry::Token) / 4) <= POV_PARSER_TOKEN_CACHE_SIZE));
+    if (ok)
+    {
+        data.resize(size_t(size));
+        ok = pStream->seekg(0) && pStream->read(data.data(), data.size());
+    }
+
+    // Leave the stream as we found it, in case we need to fall back to the scanner.
+    pStream->clearstate();
+    pStream->seekg(0);
+
+    if (!ok)
+        return nullptr;
+
+    UCS2String name(pStream->Name());
+    POV_UINT64 hash = HashTokenCacheData(data);
+
+    TokenCachePtr pEntry = gTokenCache.Find(name, size, hash);
+    if (pEntry != nullptr)
+        return pEntry;
+
+    std::shared_ptr<TokenCacheEntry> pNewEntry = ScanTokenCacheEntry(name, data);
+    if ((pNewEntry == nullptr) || (pNewEntry->memory > POV_PARSER_TOKEN_CACHE_SIZE))
+        return nullptr;
+    pNewEntry->size = size;
+    pNewEntry->hash = hash;
+    return gTokenCache.Insert(pNewEntry);
+}
+
+std::shared_ptr<TokenCacheEntry> RawTokenizer::ScanTokenCacheEntry(const UCS2String& name, const std::vector<unsigned char>& data)
+{
+    auto pEntry = std::make_shared<TokenCacheEntry>();
+    pEntry->name = name;
+
+    Scanner scanner;
+    scanner.SetInputStream(std::make_shared<IMemStream>(data.data(), data.size(), name));
+
+    std::unordered_map<UTF8String, unsigned int> lexemeIndex;
+    RawToken token;
+    HotBookmark bookmark = scanner.GetHotBookmark();
+    pEntry->states.push_back(TokenCacheEntry::State{ 0, bookmark.characterEncoding, bookmark.nominalEndOfLine });
+
+    try
+    {
+        while (scanner.GetNextLexeme(token.lexeme))
+        {
+            auto iLexeme = lexemeIndex.emplace(token.lexeme.text, (unsigned int)pEntry->lexemes.size());
+            if (iLexeme.second)
+            {
+                token.value = nullptr;
+                // Word IDs are specific to each raw tokenizer; these are resolved during replay.
+                if (token.lexeme.category != Lexeme::kWord)
+                {
+                    (void)ProcessLexeme(token);
+
+                    // Invalid escape sequences refer to the stream they were found in; don't bother caching those.
+                    auto pString = std::dynamic_pointer_cast<const AmbiguousStringValue>(token.value);
+                    if ((pString != nullptr) && (pString->invalidEscapeSequence != nullptr))
+                        return nullptr;
+                }
+                pEntry->lexemes.push_back(token);
+            }
+
+            bookmark = scanner.GetHotBookmark();
+            pEntry->tokens.push_back(TokenCacheEntry::Token{ token.lexeme.position, bookmark, iLexeme.first->second });
+
+            const TokenCacheEntry::State& state = pEntry->states.back();
+            if ((bookmark.characterEncoding != state.characterEncoding) || (bookmark.nominalEndOfLine != state.nominalEndOfLine))
+                pEntry->states.push_back(TokenCacheEntry::State{ pEntry->tokens.size(), bookmark.characterEncoding, bookmark.nominalEndOfLine });
+        }
+    }
+    catch (const std::exception&)
+    {
+        // Leave it to the scanner to report the error, if and when the parser gets there.
+        return nullptr;
+    }
+
+    bookmark = scanner.GetHotBookmark();
+    pEntry->endPosition = bookmark;
+    pEntry->endState = TokenCacheEntry::State{ pEntry->tokens.size(), bookmark.characterEncoding, bookmark.nominalEndOfLine };
+
+    pEntry->tokens.shrink_to_fit();
+    pEntry->memory = sizeof(TokenCacheEntry) +
+                     pEntry->tokens.size() * sizeof(TokenCacheEntry::Token) +
+                     pEntry->states.size() * sizeof(TokenCacheEntry::State);
+    for (auto& lexeme : pEntry->lexemes)
+        pEntry->memory += sizeof(RawToken) + lexeme.lexeme.text.capacity();
+
+    return pEntry;
+}
+
+RawTokenizer::HotBookmark RawTokenizer::GetReplayBookmark() const
+{
+    POV_PARSER_ASSERT(mpReplay != nullptr);
+    const TokenCacheEntry& entry = *mpReplay->pEntry;
+
+    if (mReplayAtEnd)
+        return HotBookmark(mpReplayStream, entry.endPosition, entry.endState.characterEncoding,
+                           entry.endState.nominalEndOfLine, true);
+
+    const TokenCacheEntry::State& state = entry.GetState(mReplayIndex);
+    LexemePosition position;
+    if (mReplayIndex > 0)
+        position = entry.tokens[mReplayIndex - 1].endPosition;
+    return HotBookmark(mpReplayStream, position, state.characterEncoding, state.nominalEndOfLine, true);
+}
+
+bool RawTokenizer::ResumeReplay(const ConstStreamPtr& pStream, const Scanner::Bookmark& bookmark)
+{
+    if (!bookmark.allowNestedBlockComments)
+        return false;
+
+    for (auto& replayable : mReplayableStreams)
+    {
+        StreamPtr pReplayStream = replayable.pStream.lock();
+        if (pReplayStream != pStream)
+            continue;
+
+        // Find the token ending where the bookmark was taken.
+        const TokenCacheEntry& entry = *replayable.pCached->pEntry;
+        size_t index = 0;
+        if (bookmark.offset != 0)
+        {
+            auto i = std::lower_bound(entry.tokens.begin(), entry.tokens.end(), bookmark.offset,
+                                      [](const TokenCacheEntry::Token& t, POV_OFF_T o) { return t.endPosition.offset < o; });
+            if ((i == entry.tokens.end()) || (i->endPosition.offset != bookmark.offset))
+                return false;
+            index = (i - entry.tokens.begin()) + 1;
+        }
+
+        const TokenCacheEntry::State& state = entry.GetState(index);
+        if ((state.characterEncoding != bookmark.characterEncoding) || (state.nominalEndOfLine != bookmark.nominalEndOfLine))
+            return false;
+
+        mpReplay = replayable.pCached;
+        mpReplayStream = pReplayStream;
+        mReplayIndex = index;
+        mReplayAtEnd = false;
+        mAllowNestedBlockComments = true;
+        return true;
+    }
+
+    return false;
+}
+
+void RawTokenizer::StopReplay()
+{
+    if (mpReplay == nullptr)
+        return;
+
+    // Position the scanner where the replay left off.
+    HotBookmark bookmark = GetReplayBookmark();
+    mpReplay = nullptr;
+    (void)mScanner.GoToBookmark(bookmark);
+}
+
 }
 // end of namespace pov_parser
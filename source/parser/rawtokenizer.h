@@ -45,6 +45,7 @@
 // C++ standard header files
 #include <memory>
 #include <unordered_map>
+#include <vector>
 
 // POV-Ray header files (base module)
 #include "base/stringtypes.h"
@@ -63,6 +64,23 @@ using namespace pov_base;
 
 //------------------------------------------------------------------------------
 
+/// Convert a float literal, if this can be done both quickly and exactly.
+///
+/// This handles the common case of literals with no more than 19 significant digits, a mantissa
+/// no larger than 2^53 and a small decimal exponent. Such values can be computed from the mantissa
+/// with a single, correctly rounded multiplication or division by an exactly representable power
+/// of ten, yielding the same result as a full-fledged conversion. Other literals are left to the
+/// C library.
+///
+/// @note
+///     Unlike the C library, this function does not depend on the locale.
+///
+/// @return `false` if the literal is not eligible for this conversion.
+///
+bool FastFloatLiteralToDouble(const UTF8String& text, double& value);
+
+//------------------------------------------------------------------------------
+
 /// Abstract structure representing an arbitrary literal or variable value.
 struct Value
 {
@@ -166,6 +184,22 @@ struct RawToken final
 
 //******************************************************************************
 
+struct TokenCacheEntry;
+
+using TokenCachePtr = std::shared_ptr<const TokenCacheEntry>;
+
+/// Position of a token within the cached lexemes of an input stream.
+///
+/// Positions are independent of any particular tokenizer, and remain valid across parses
+/// as long as the content of the stream does not change.
+///
+struct CachedTokenPosition final
+{
+    POV_UINT64  hash;   ///< Hash of the stream content.
+    POV_OFF_T   size;   ///< Size of the stream.
+    size_t      index;  ///< Index of the token within the stream.
+};
+
 /// Class implementing the parser's _raw tokenizer_ stage.
 ///
 /// The parser's _raw tokenizer_ stage processes individual _lexemes_ from the
@@ -236,6 +270,36 @@ public:
     /// Go to bookmark.
     bool GoToBookmark(const ColdBookmark& bookmark);
 
+    /// Get the cached lexemes of the current stream.
+    /// @return The cached lexemes, or `nullptr` if the current stream is not being replayed from cache.
+    TokenCachePtr GetTokenCache() const;
+
+    /// Get the position of the next token to be replayed from cache.
+    /// @return `false` if the current stream is not being replayed from cache.
+    bool GetReplayPosition(CachedTokenPosition& position) const;
+
+    /// Get the position of a token previously replayed from cache.
+    /// @param[out] position        Position of the token.
+    /// @param[in]  lexemePosition  Position of the token's lexeme within the current stream.
+    /// @return `false` if the current stream is not being replayed from cache, or no token
+    ///         starts at the specified position.
+    bool GetReplayPosition(CachedTokenPosition& position, const LexemePosition& lexemePosition) const;
+
+    /// Skip ahead in the cached lexemes of the current stream.
+    /// @return `false` if the position does not lie ahead in the stream currently being replayed.
+    bool SkipReplay(const CachedTokenPosition& position);
+
+    /// Replay cached lexemes without access to the original stream.
+    /// The replay starts at the beginning of the cached stream; use @ref GoToBookmark to go to
+    /// any other position.
+    void SetInputTokens(const TokenCachePtr& pTokens);
+
+    /// Re-validate cached lexemes against the files' current contents.
+    /// @note
+    ///     This must be called whenever a file may have been modified during
+    ///     parsing, e.g. by `#write`.
+    void InvalidateCachedStreams();
+
 private:
 
     struct KnownWordInfo final
@@ -247,10 +311,61 @@ private:
         KnownWordInfo();
     };
 
+    /// Immutable table of reserved words, shared by all tokenizers.
+    ///
+    /// The table is built on first use and never modified afterwards, so that tokenizers need not
+    /// set up a per-instance map of several hundred reserved words before they can scan a single
+    /// lexeme. Lookups use open addressing at a load factor of at most 1/4, so a miss (i.e. any
+    /// identifier) typically terminates at the first empty slot.
+    class ReservedWordTable final
+    {
+    public:
+        static const ReservedWordTable& Get();
+        const KnownWordInfo* Find(const UTF8String& word) const;
+    private:
+        struct Entry final
+        {
+            const char*     name;
+            size_t          length;
+            KnownWordInfo   info;
+        };
+        std::vector<Entry>  mEntries;
+        size_t              mMask;
+        ReservedWordTable();
+        static size_t Hash(const char* name, size_t length);
+    };
+
+    /// Cached lexemes of an input stream, as seen by this tokenizer.
+    struct CachedStream final
+    {
+        TokenCachePtr                           pEntry;
+        std::vector<const KnownWordInfo*>       words;  ///< Word info for each cached lexeme, resolved on demand.
+    };
+
+    using CachedStreamPtr = std::shared_ptr<CachedStream>;
+
+    /// Input stream eligible for replay of cached lexemes.
+    struct ReplayableStream final
+    {
+        std::weak_ptr<IStream>  pStream;
+        CachedStreamPtr         pCached;
+    };
+
     Scanner                                         mScanner;
-    std::unordered_map<UTF8String, KnownWordInfo>   mKnownWords;
+    std::unordered_map<UTF8String, KnownWordInfo>   mKnownWords;        ///< Identifiers seen so far; reserved words live in @ref ReservedWordTable.
     unsigned int                                    mNextIdentifierId;
+    bool                                            mAllowNestedBlockComments;
 
+    std::unordered_map<UCS2String, CachedStreamPtr> mCachedStreams;     ///< Cached lexemes by stream name.
+    std::vector<ReplayableStream>                   mReplayableStreams;
+    CachedStreamPtr                                 mpReplay;           ///< Lexemes being replayed, or `nullptr` to use the scanner.
+    StreamPtr                                       mpReplayStream;
+    size_t                                          mReplayIndex;       ///< Index of next cached token to replay.
+    bool                                            mReplayAtEnd;
+
+    const KnownWordInfo& GetKnownWord(const UTF8String& word);
+
+    bool ProcessLexeme(RawToken& token);
     bool ProcessWordLexeme(RawToken& token);
     bool ProcessOtherLexeme(RawToken& token);
     bool ProcessFloatLiteralLexeme(RawToken& token);
@@ -258,6 +373,14 @@ private:
     bool ProcessSignatureLexeme(RawToken& token);
 
     bool ProcessUCSEscapeDigits(UCS4& c, UTF8String::const_iterator& i, UTF8String::const_iterator& escapeSequenceEnd, unsigned int digits);
+
+    CachedStreamPtr GetCachedStream(const StreamPtr& pStream);
+    TokenCachePtr LoadTokenCacheEntry(const StreamPtr& pStream);
+    std::shared_ptr<TokenCacheEntry> ScanTokenCacheEntry(const UCS2String& name, const std::vector<unsigned char>& data);
+
+    HotBookmark GetReplayBookmark() const;
+    bool ResumeReplay(const ConstStreamPtr& pStream, const Scanner::Bookmark& bookmark);
+    void StopReplay();
 };
 
 }
@@ -154,6 +154,7 @@ const RESERVED_WORD Reserved_Words[] = {
     { BUMP_SIZE_TOKEN,              "bump_size" },
     { BUMPS_TOKEN,                  "bumps" },
 
+    { CACHE_RESOLUTION_TOKEN,       "cache_resolution" },
     { CAMERA_TOKEN,                 "camera" },
     { CAMERA_DIRECTION_TOKEN,       "camera_direction" },
     { CAMERA_LOCATION_TOKEN,        "camera_location" },
@@ -193,6 +194,7 @@ const RESERVED_WORD Reserved_Words[] = {
     { COSH_TOKEN,                   "cosh" },
     { COUNT_TOKEN,                  "count" },
     { CRACKLE_TOKEN,                "crackle" },
+    { CRACKLE_CACHE_TOKEN,          "crackle_cache" },
     { CRAND_TOKEN,                  "crand" },
     { CRISTAL_TOKEN,                "cristal" },
     { CUBE_TOKEN,                   "cube" },
@@ -350,6 +352,7 @@ const RESERVED_WORD Reserved_Words[] = {
     { INTERPOLATE_TOKEN,            "interpolate" },
     { INTERSECTION_TOKEN,           "intersection" },
     { INTERUNION_TOKEN,             "interunion" },
+    { INTERVAL_BOUNDS_TOKEN,        "interval_bounds" },
     { INTERVALS_TOKEN,              "intervals" },
     { INVERSE_TOKEN,                "inverse" },
     { IOR_TOKEN,                    "ior" },
@@ -454,6 +457,7 @@ const RESERVED_WORD Reserved_Words[] = {
     { OBJ_TOKEN,                    "obj" },
 #endif
     { OBJECT_TOKEN,                 "object" },
+    { OCCUPANCY_GRID_TOKEN,         "occupancy_grid" },
     { OCTA_TOKEN,                   "octa" },
     { OCTAVES_TOKEN,                "octaves" },
     { OFF_TOKEN,                    "off" },
@@ -482,6 +486,7 @@ const RESERVED_WORD Reserved_Words[] = {
     { PARSED_TOKENS_TOKEN,          "parsed_tokens" },
     { PASS_THROUGH_TOKEN,           "pass_through" },
     { PATTERN_TOKEN,                "pattern" },
+    { PATTERN_CACHE_TOKEN,          "pattern_cache" },
     { PAVEMENT_TOKEN,               "pavement" },
     { PERSPECTIVE_TOKEN,            "perspective" },
     { PETERS_TOKEN,                 "peters" },
@@ -498,6 +503,9 @@ const RESERVED_WORD Reserved_Words[] = {
     { PLANE_TOKEN,                  "plane" },
     { PLANET_TOKEN,                 "planet" },
     { PLATECARREE_TOKEN,            "plate_carree" },
+#if POV_PARSER_EXPERIMENTAL_OBJ_IMPORT
+    { PLY_TOKEN,                    "ply" },
+#endif
     { PNG_TOKEN,                    "png" },
     { POINT_AT_TOKEN,               "point_at" },
     { POLARITY_TOKEN,               "polarity" },
@@ -518,8 +526,10 @@ const RESERVED_WORD Reserved_Words[] = {
     { PREMULTIPLIED_TOKEN,          "premultiplied" },
     { PRETRACE_END_TOKEN,           "pretrace_end" },
     { PRETRACE_START_TOKEN,         "pretrace_start" },
+    { PRIMITIVE_SOUP_TOKEN,         "primitive_soup" },
     { PRISM_TOKEN,                  "prism" },
     { PROD_TOKEN,                   "prod" },
+    { PROGRESSIVE_TOKEN,            "progressive" },
     { PROJECTED_THROUGH_TOKEN,      "projected_through" },
     { PROPORTION_TOKEN,             "proportion" },
     { PROXIMITY_TOKEN,              "proximity" },
@@ -650,6 +660,7 @@ const RESERVED_WORD Reserved_Words[] = {
     { TETRA_TOKEN,                  "tetra" },
     { TEXT_TOKEN,                   "text" },
     { TEXTURE_TOKEN,                "texture" },
+    { TEXTURE_CACHE_TOKEN,          "texture_cache" },
     { TEXTURE_LIST_TOKEN,           "texture_list" },
     { TEXTURE_MAP_TOKEN,            "texture_map" },
     { TGA_TOKEN,                    "tga" },
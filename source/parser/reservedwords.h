@@ -325,6 +325,7 @@ enum TokenId : int
     BUMP_SIZE_TOKEN,
     BUMPS_TOKEN,
 
+    CACHE_RESOLUTION_TOKEN,
     CAMERA_TOKEN,
     CAMERA_ID_TOKEN,
     CAMERA_TYPE_TOKEN,
@@ -357,6 +358,7 @@ enum TokenId : int
     COUNT_TOKEN,
     COORDS_TOKEN,
     CRACKLE_TOKEN,
+    CRACKLE_CACHE_TOKEN,
     CRISTAL_TOKEN,
     CRAND_TOKEN,
     CUBE_TOKEN,
@@ -505,6 +507,7 @@ enum TokenId : int
     INTERPOLATE_TOKEN,
     INTERSECTION_TOKEN,
     INTERUNION_TOKEN,
+    INTERVAL_BOUNDS_TOKEN,
     INTERVALS_TOKEN,
     INVERSE_TOKEN,
     IOR_TOKEN,
@@ -609,6 +612,7 @@ enum TokenId : int
 #endif
     OBJECT_TOKEN,
     OBJECT_ID_TOKEN,
+    OCCUPANCY_GRID_TOKEN,
     OCTA_TOKEN,
     OCTAVES_TOKEN,
     OFFSET_TOKEN,
@@ -635,6 +639,7 @@ enum TokenId : int
     PARAMETRIC_TOKEN,
     PASS_THROUGH_TOKEN,
     PATTERN_TOKEN,
+    PATTERN_CACHE_TOKEN,
     PAVEMENT_TOKEN,
     PERCENT_TOKEN,
     PERIOD_TOKEN,
@@ -655,6 +660,9 @@ enum TokenId : int
     PLANET_TOKEN,
     PLATECARREE_TOKEN,
     PLUS_TOKEN,
+#if POV_PARSER_EXPERIMENTAL_OBJ_IMPORT
+    PLY_TOKEN,
+#endif
     PNG_TOKEN,
     POINT_AT_TOKEN,
     POLARITY_TOKEN,
@@ -674,7 +682,9 @@ enum TokenId : int
     PREMULTIPLIED_TOKEN,
     PRETRACE_END_TOKEN,
     PRETRACE_START_TOKEN,
+    PRIMITIVE_SOUP_TOKEN,
     PRISM_TOKEN,
+    PROGRESSIVE_TOKEN,
     PROJECTED_THROUGH_TOKEN,
     PROPORTION_TOKEN,
     PROXIMITY_TOKEN,
@@ -793,6 +803,7 @@ enum TokenId : int
     TETRA_TOKEN,
     TEXT_TOKEN,
     TEXTURE_TOKEN,
+    TEXTURE_CACHE_TOKEN,
     TEXTURE_ID_TOKEN,
     TEXTURE_LIST_TOKEN,
     TEXTURE_MAP_TOKEN,
@@ -570,14 +570,18 @@ UCS2String Scanner::HotBookmark::GetFileName() const
 //******************************************************************************
 
 Scanner::Buffer::Buffer() :
+    mpStart(maData),
     mpEnd(maData),
-    mpPos(maData)
+    mpPos(maData),
+    mSpan(false)
 {}
 
 void Scanner::Buffer::Clear()
 {
-    mpEnd = maData;
-    mpPos  = maData;
+    mpStart = maData;
+    mpEnd   = maData;
+    mpPos   = maData;
+    mSpan   = false;
 }
 
 void Scanner::Buffer::Advance(size_t delta)
@@ -589,9 +593,9 @@ void Scanner::Buffer::Advance(size_t delta)
 
 void Scanner::Buffer::AdvanceTo(size_t offset)
 {
-    POV_PARSER_ASSERT(mpEnd >= maData);
-    POV_PARSER_ASSERT(mpEnd - maData >= offset);
-    mpPos = maData + offset;
+    POV_PARSER_ASSERT(mpEnd >= mpStart);
+    POV_PARSER_ASSERT(mpEnd - mpStart >= offset);
+    mpPos = mpStart + offset;
 }
 
 size_t Scanner::Buffer::Capacity() const
@@ -601,14 +605,14 @@ size_t Scanner::Buffer::Capacity() const
 
 size_t Scanner::Buffer::TotalCount() const
 {
-    POV_PARSER_ASSERT(mpEnd >= maData);
-    return (mpEnd - maData);
+    POV_PARSER_ASSERT(mpEnd >= mpStart);
+    return (mpEnd - mpStart);
 }
 
 size_t Scanner::Buffer::ProcessedCount() const
 {
-    POV_PARSER_ASSERT(mpPos >= maData);
-    return (mpPos - maData);
+    POV_PARSER_ASSERT(mpPos >= mpStart);
+    return (mpPos - mpStart);
 }
 
 size_t Scanner::Buffer::PendingCount() const
@@ -619,7 +623,8 @@ size_t Scanner::Buffer::PendingCount() const
 
 bool Scanner::Buffer::IsLean() const
 {
-    return (TotalCount() < Capacity());
+    // A span always extends to the end of the stream.
+    return mSpan || (TotalCount() < Capacity());
 }
 
 bool Scanner::Buffer::IsFresh() const
@@ -653,8 +658,21 @@ void Scanner::Buffer::GetBulk(Octet* dst, size_t count)
 void Scanner::Buffer::Refill(StreamPtr pStream)
 {
     POV_PARSER_ASSERT(IsExhausted());
-    mpPos = maData;
-    mpEnd = maData + pStream->readUpTo(maData, Capacity());
+    size_t count;
+    const Octet* pSpan = pStream->readSpan(count);
+    mSpan = (pSpan != nullptr);
+    if (mSpan)
+    {
+        // Stream lets us access its data directly; no need to copy anything.
+        mpStart = pSpan;
+        mpEnd   = pSpan + count;
+    }
+    else
+    {
+        mpStart = maData;
+        mpEnd   = maData + pStream->readUpTo(maData, Capacity());
+    }
+    mpPos = mpStart;
 }
 
 //------------------------------------------------------------------------------
@@ -284,6 +284,8 @@ private:
         inline void GetBulk(Octet* dst, size_t count);
 
         /// Refill from stream.
+        /// If the stream supports it, the buffer will refer directly to all the remaining data in
+        /// the stream, rather than holding a copy of the next chunk.
         /// @pre Buffer shall be exhausted.
         inline void Refill(StreamPtr pStream);
 
@@ -291,9 +293,11 @@ private:
 
         static constexpr size_t kCapacity = 64 * 1024; ///< Maximum capacity.
 
-        Octet   maData[kCapacity];  ///< Array holding the buffered data.
-        Octet*  mpEnd;              ///< Pointer to end of data (first unoccupied octet).
-        Octet*  mpPos;              ///< Pointer to current pending octet.
+        Octet           maData[kCapacity];  ///< Array holding the buffered data.
+        const Octet*    mpStart;            ///< Pointer to start of data.
+        const Octet*    mpEnd;              ///< Pointer to end of data (first unoccupied octet).
+        const Octet*    mpPos;              ///< Pointer to current pending octet.
+        bool            mSpan;              ///< Whether the data is a span of the stream's own memory.
     };
 
     //------------------------------------------------------------------------------
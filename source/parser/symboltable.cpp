@@ -40,7 +40,10 @@
 #include <cstring>
 
 // C++ standard header files
-//  (none at the moment)
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
 
 // POV-Ray header files (base module)
 #include "base/pov_mem.h"
@@ -73,36 +76,36 @@ using namespace pov;
 
 //******************************************************************************
 
-SymbolTable::SymbolTable()
+/// Memory reported to the memory accounting for a symbol table entry.
+static inline POV_ULONG SymbolEntryMemory(const UTF8String& Name)
 {
-    for (int i = 0; i < SYM_TABLE_SIZE; i++)
-        mapHashTable[i] = nullptr;
+    return sizeof(SYM_ENTRY) + Name.size();
 }
 
-SymbolTable::SymbolTable(const SymbolTable& obj)
+//******************************************************************************
+
+SymbolTable::SymbolTable() :
+    mEntryCount(0)
+{}
+
+SymbolTable::SymbolTable(const SymbolTable& obj) :
+    mSlots(obj.mSlots),
+    mEntryCount(obj.mEntryCount)
 {
-    for (int i = SYM_TABLE_SIZE - 1; i >= 0; i--)
+    // Same layout as the original, just with copies of the entries.
+    for (auto& slot : mSlots)
     {
-        SYM_ENTRY* oldEntry = obj.mapHashTable[i];
-        while (oldEntry)
-        {
-            SYM_ENTRY* newEntry = Copy_Entry(oldEntry);
-            newEntry->next = obj.mapHashTable[i];
-            mapHashTable[i] = newEntry;
-            oldEntry = oldEntry->next;
-        }
+        if (slot.entry != nullptr)
+            slot.entry = Copy_Entry(slot.entry);
     }
 }
 
 SymbolTable::~SymbolTable()
 {
-    for (int i = SYM_TABLE_SIZE - 1; i >= 0; i--)
+    for (auto& slot : mSlots)
     {
-        SYM_ENTRY *entry = mapHashTable[i];
-        while (entry)
-        {
-            entry = Destroy_Entry(entry);
-        }
+        if (slot.entry != nullptr)
+            Destroy_Entry(slot.entry);
     }
 }
 
@@ -110,6 +113,7 @@ SymbolTable::~SymbolTable()
 
 SYM_ENTRY* SymbolTable::Create_Entry(const UTF8String& Name, TokenId Number)
 {
+    pov_base::pov_mem_account(pov_base::kMemory_Parser, SymbolEntryMemory(Name));
     SYM_ENTRY *New = new SYM_ENTRY();
 
     New->Token_Number = Number;
@@ -119,7 +123,12 @@ SYM_ENTRY* SymbolTable::Create_Entry(const UTF8String& Name, TokenId Number)
     New->deprecatedShown = false;
     New->Deprecation_Message = nullptr;
     New->ref_count = 1;
+    New->fingerprintData = nullptr;
+    New->fingerprint = 0;
+    New->contentFingerprintData = nullptr;
+    New->contentFingerprint = 0;
     New->name = Name;
+    New->hash = get_hash_value(Name.c_str());
 
     return New;
 }
@@ -128,6 +137,7 @@ SYM_ENTRY* SymbolTable::Copy_Entry(const SYM_ENTRY* oldEntry)
 {
     SYM_ENTRY* newEntry;
 
+    pov_base::pov_mem_account(pov_base::kMemory_Parser, SymbolEntryMemory(oldEntry->name));
     newEntry = new SYM_ENTRY();
 
     newEntry->Token_Number = oldEntry->Token_Number;
@@ -137,21 +147,20 @@ SYM_ENTRY* SymbolTable::Copy_Entry(const SYM_ENTRY* oldEntry)
     newEntry->deprecatedShown = false;
     newEntry->Deprecation_Message = nullptr;
     newEntry->ref_count = 1;
+    newEntry->fingerprintData = nullptr;
+    newEntry->fingerprint = 0;
+    newEntry->contentFingerprintData = nullptr;
+    newEntry->contentFingerprint = 0;
     newEntry->name = oldEntry->name;
+    newEntry->hash = oldEntry->hash;
 
     return newEntry;
 }
 
-SYM_ENTRY* SymbolTable::Destroy_Entry(SYM_ENTRY *Entry)
+void SymbolTable::Destroy_Entry(SYM_ENTRY *Entry)
 {
-    SYM_ENTRY *Next;
-
     if (Entry == nullptr)
-        return nullptr;
-
-    // always unhook the entry from hash table (if it is still member of one)
-    Next = Entry->next;
-    Entry->next = nullptr;
+        return;
 
     if (Entry->ref_count <= 0)
         POV_PARSER_PANIC(); // Error("Internal error: Symbol reference counter underflow");
@@ -163,10 +172,9 @@ SYM_ENTRY* SymbolTable::Destroy_Entry(SYM_ENTRY *Entry)
         if (Entry->Deprecation_Message != nullptr)
             POV_FREE(Entry->Deprecation_Message);
 
+        pov_base::pov_mem_unaccount(pov_base::kMemory_Parser, SymbolEntryMemory(Entry->name));
         delete Entry;
     }
-
-    return Next;
 }
 
 //------------------------------------------------------------------------------
@@ -293,11 +301,48 @@ void* SymbolTable::Copy_Identifier(void* Data, int Type)
     return New;
 }
 
+/// Buffers registered via @ref SymbolTable::Register_Shared_Storage(), mapping start to end.
+static std::map<const char*, const char*> gSharedStorage;
+static std::mutex gSharedStorageMutex;
+static std::atomic<size_t> gSharedStorageCount(0);
+
+void SymbolTable::Register_Shared_Storage(const void* Begin, size_t Size)
+{
+    std::lock_guard<std::mutex> lock(gSharedStorageMutex);
+    const char* begin = reinterpret_cast<const char*>(Begin);
+    gSharedStorage[begin] = begin + Size;
+    gSharedStorageCount = gSharedStorage.size();
+}
+
+void SymbolTable::Unregister_Shared_Storage(const void* Begin)
+{
+    std::lock_guard<std::mutex> lock(gSharedStorageMutex);
+    gSharedStorage.erase(reinterpret_cast<const char*>(Begin));
+    gSharedStorageCount = gSharedStorage.size();
+}
+
+bool SymbolTable::Is_Shared_Storage(const void* Data)
+{
+    if (gSharedStorageCount == 0)
+        return false;
+    std::lock_guard<std::mutex> lock(gSharedStorageMutex);
+    const char* p = reinterpret_cast<const char*>(Data);
+    auto i = gSharedStorage.upper_bound(p);
+    if (i == gSharedStorage.begin())
+        return false;
+    --i;
+    return (p < i->second);
+}
+
 void SymbolTable::Destroy_Ident_Data(void *Data, int Type)
 {
     if (Data == nullptr)
         return;
 
+    // values held in a shared buffer, such as an array's contiguous storage, are owned by that buffer
+    if (((Type == FLOAT_ID_TOKEN) || (Type == UV_ID_TOKEN) || (Type == VECTOR_ID_TOKEN)) && Is_Shared_Storage(Data))
+        return;
+
     switch (Type)
     {
         case COLOUR_ID_TOKEN:
@@ -407,10 +452,51 @@ void SymbolTable::Destroy_Ident_Data(void *Data, int Type)
 
 void SymbolTable::Add_Entry(SYM_ENTRY *Table_Entry)
 {
-    int i = get_hash_value(Table_Entry->name.c_str());
+    if ((mEntryCount + 1) * 2 > mSlots.size())
+        Grow();
+
+    Insert_Slot(Table_Entry, true);
+    mEntryCount++;
+}
+
+void SymbolTable::Insert_Slot(SYM_ENTRY *Table_Entry, bool shadow)
+{
+    size_t mask = mSlots.size() - 1;
+    size_t i = Table_Entry->hash & mask;
+
+    while (mSlots[i].entry != nullptr)
+    {
+        // A new entry takes the place of any older entry of the same name,
+        // which in turn moves further down the probing sequence.
+        if (shadow && (mSlots[i].hash == Table_Entry->hash) && (mSlots[i].entry->name == Table_Entry->name))
+            std::swap(mSlots[i].entry, Table_Entry);
+        i = (i + 1) & mask;
+    }
+
+    mSlots[i].hash = Table_Entry->hash;
+    mSlots[i].entry = Table_Entry;
+}
+
+void SymbolTable::Grow()
+{
+    std::vector<Slot> oldSlots(std::max(mSlots.size() * 2, size_t(SYM_TABLE_MIN_SIZE)), Slot{ 0, nullptr });
+    oldSlots.swap(mSlots);
 
-    Table_Entry->next = mapHashTable[i];
-    mapHashTable[i] = Table_Entry;
+    if (oldSlots.empty())
+        return;
+
+    // Re-insert the entries in probing order (starting just past an empty slot, of which there
+    // is always at least one), so that entries of the same name retain their order.
+    size_t mask = oldSlots.size() - 1;
+    size_t start = 0;
+    while (oldSlots[start].entry != nullptr)
+        ++start;
+    for (size_t n = 1; n <= oldSlots.size(); ++n)
+    {
+        const Slot& slot = oldSlots[(start + n) & mask];
+        if (slot.entry != nullptr)
+            Insert_Slot(slot.entry, false);
+    }
 }
 
 SYM_ENTRY *SymbolTable::Add_Symbol(const UTF8String& Name, TokenId Number)
@@ -425,7 +511,8 @@ SYM_ENTRY *SymbolTable::Add_Symbol(const UTF8String& Name, TokenId Number)
 
 SYM_ENTRY* SymbolTable::Find_Symbol(const char* name) const
 {
-    return Find_Symbol(name, get_hash_value(name));
+    POV_LONG probes = 0;
+    return Find_Symbol(name, get_hash_value(name), probes);
 }
 
 void SymbolTable::Remove_Symbol(const char *Name, bool is_array_elem, void **DataPtr, int ttype)
@@ -444,25 +531,32 @@ void SymbolTable::Remove_Symbol(const char *Name, bool is_array_elem, void **Dat
     }
     else
     {
-        SYM_ENTRY *Entry;
-        SYM_ENTRY **EntryPtr;
-
-        int i = get_hash_value(Name);
-
-        EntryPtr = &(mapHashTable[i]);
-        Entry = *EntryPtr;
+        unsigned int hash = get_hash_value(Name);
+        size_t mask = mSlots.size() - 1;
 
-        while (Entry)
+        for (size_t i = hash & mask; !mSlots.empty() && (mSlots[i].entry != nullptr); i = (i + 1) & mask)
         {
-            if (strcmp(Name, Entry->name.c_str()) == 0)
+            if ((mSlots[i].hash == hash) && (strcmp(Name, mSlots[i].entry->name.c_str()) == 0))
             {
-                *EntryPtr = Entry->next;
+                SYM_ENTRY *Entry = mSlots[i].entry;
+
+                // Close the gap by moving subsequent entries of the same cluster back,
+                // unless that would move them before their home slot.
+                for (size_t j = (i + 1) & mask; mSlots[j].entry != nullptr; j = (j + 1) & mask)
+                {
+                    size_t home = mSlots[j].hash & mask;
+                    if (((j - home) & mask) >= ((j - i) & mask))
+                    {
+                        mSlots[i] = mSlots[j];
+                        i = j;
+                    }
+                }
+                mSlots[i].entry = nullptr;
+                mEntryCount--;
+
                 Destroy_Entry(Entry);
                 return;
             }
-
-            EntryPtr = &(Entry->next);
-            Entry = *EntryPtr;
         }
 
         POV_PARSER_PANIC();
@@ -492,6 +586,7 @@ void SymbolTable::Release_Entry_Reference(SYM_ENTRY *Entry)
         if (Entry->Deprecation_Message != nullptr)
             POV_FREE(Entry->Deprecation_Message);
 
+        pov_base::pov_mem_unaccount(pov_base::kMemory_Parser, SymbolEntryMemory(Entry->name));
         delete Entry;
     }
 }
@@ -515,31 +610,35 @@ template<typename T> void SymbolTable::DeleteData(void* data)
 
 //------------------------------------------------------------------------------
 
-SYM_ENTRY* SymbolTable::Find_Symbol(const char* Name, int hash) const
+SYM_ENTRY* SymbolTable::Find_Symbol(const char* Name, unsigned int hash, POV_LONG& probes) const
 {
-    SYM_ENTRY* Entry = mapHashTable[hash];
+    if (mSlots.empty())
+        return nullptr;
 
-    while (Entry)
-    {
-        if (strcmp(Name, Entry->name.c_str()) == 0)
-            return Entry;
+    size_t mask = mSlots.size() - 1;
 
-        Entry = Entry->next;
+    for (size_t i = hash & mask; ; i = (i + 1) & mask)
+    {
+        const Slot& slot = mSlots[i];
+        ++probes;
+        if (slot.entry == nullptr)
+            return nullptr;
+        if ((slot.hash == hash) && (strcmp(Name, slot.entry->name.c_str()) == 0))
+            return slot.entry;
     }
-
-    return Entry;
 }
 
-int SymbolTable::get_hash_value(const char *s)
+unsigned int SymbolTable::get_hash_value(const char *s)
 {
-    unsigned int i = 0;
+    // 32-bit FNV-1a
+    unsigned int i = 2166136261u;
 
     while (*s)
     {
-        i = (i << 1) ^ *s++;
+        i = (i ^ (unsigned char)(*s++)) * 16777619u;
     }
 
-    return((int)(i % SYM_TABLE_SIZE));
+    return i;
 }
 
 //******************************************************************************
@@ -593,16 +692,18 @@ SYM_ENTRY *SymbolStack::Add_Symbol(int Index, const UTF8String& Name, TokenId Nu
 
 SYM_ENTRY* SymbolStack::Find_Symbol(int index, const char* name)
 {
-    return Tables[index]->Find_Symbol(name, SymbolTable::get_hash_value(name));
+    ++mLookups;
+    return Tables[index]->Find_Symbol(name, SymbolTable::get_hash_value(name), mProbes);
 }
 
 SYM_ENTRY* SymbolStack::Find_Symbol(const char* name, int* pIndex)
 {
     SYM_ENTRY *entry;
-    int hash = SymbolTable::get_hash_value(name);
+    unsigned int hash = SymbolTable::get_hash_value(name);
+    ++mLookups;
     for (int index = Table_Index; index >= SYM_TABLE_GLOBAL; --index)
     {
-        entry = Tables[index]->Find_Symbol(name, hash);
+        entry = Tables[index]->Find_Symbol(name, hash, mProbes);
         if (entry)
         {
             if (pIndex != nullptr)
@@ -623,7 +724,9 @@ void SymbolStack::Remove_Symbol(int Index, const char *Name, bool is_array_elem,
 //------------------------------------------------------------------------------
 
 SymbolStack::SymbolStack() :
-    Table_Index(-1)
+    Table_Index(-1),
+    mLookups(0),
+    mProbes(0)
 {}
 
 SymbolStack::~SymbolStack()
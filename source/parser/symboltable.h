@@ -44,6 +44,7 @@
 
 // C++ standard header files
 #include <memory>
+#include <vector>
 
 // POV-Ray header files (base module)
 #include "base/stringtypes.h"
@@ -63,7 +64,7 @@ using namespace pov_base;
 //------------------------------------------------------------------------------
 
 const int MAX_NUMBER_OF_TABLES = 100;
-const int SYM_TABLE_SIZE = 257;
+const int SYM_TABLE_MIN_SIZE = 16;     ///< Initial number of slots in a symbol table; must be a power of 2.
 
 typedef unsigned short SymTableEntryRefCount;
 
@@ -76,8 +77,8 @@ enum
 /// Structure holding information about a symbol
 struct Sym_Table_Entry final
 {
-    Sym_Table_Entry *next;      ///< Reference to next symbol with same hash
     UTF8String name;            ///< Symbol name
+    unsigned int hash;          ///< Hash of the symbol name
     char *Deprecation_Message;  ///< Warning to print if the symbol is deprecated
     void *Data;                 ///< Reference to the symbol value
     TokenId Token_Number;       ///< Unique ID of this symbol
@@ -85,6 +86,10 @@ struct Sym_Table_Entry final
     bool deprecatedOnce : 1;
     bool deprecatedShown : 1;
     SymTableEntryRefCount ref_count; ///< normally 1, but may be greater when passing symbols out of macros
+    const void *fingerprintData;    ///< Value @ref fingerprint refers to; the fingerprint is stale if this differs from @ref Data.
+    POV_UINT64 fingerprint;         ///< Identity of the value, for reuse of declarations depending on it.
+    const void *contentFingerprintData; ///< Value @ref contentFingerprint refers to; the fingerprint is stale if this differs from @ref Data.
+    POV_UINT64 contentFingerprint;      ///< Fingerprint of the input the value was parsed from, for incremental re-rendering.
 };
 using SYM_ENTRY = Sym_Table_Entry; ///< @deprecated
 
@@ -100,13 +105,23 @@ struct SymbolTable final
 
     static SYM_ENTRY* Create_Entry(const UTF8String& Name, TokenId Number);
     static SYM_ENTRY* Copy_Entry(const SYM_ENTRY* oldEntry);
-    static SYM_ENTRY* Destroy_Entry(SYM_ENTRY* Entry);
+    static void Destroy_Entry(SYM_ENTRY* Entry);
 
     // Payload Data Lifetime
 
     static void* Copy_Identifier(void* Data, int Type);
     static void Destroy_Ident_Data(void* Data, int Type);
 
+    /// Register a buffer holding the values of several identifiers, such as array elements.
+    ///
+    /// Values within a registered buffer are owned by the buffer, so @ref Destroy_Ident_Data()
+    /// leaves them alone. This guards against pointers into the buffer ending up on any of the
+    /// code paths that destroy identifier values.
+    ///
+    static void Register_Shared_Storage(const void* Begin, size_t Size);
+    static void Unregister_Shared_Storage(const void* Begin);
+    static bool Is_Shared_Storage(const void* Data);
+
     // Entry-Table Relationship
 
     void Add_Entry(SYM_ENTRY *Table_Entry);
@@ -123,14 +138,32 @@ protected:
     template<typename T> static void* CloneData(const void*);
     template<typename T> static void DeleteData(void*);
 
-    SYM_ENTRY* Find_Symbol(const char* s, int hash) const;
-    static int get_hash_value(const char *s);
+    SYM_ENTRY* Find_Symbol(const char* s, unsigned int hash, POV_LONG& probes) const;
+    static unsigned int get_hash_value(const char *s);
 
     friend class SymbolStack;
 
 private:
 
-    SYM_ENTRY* mapHashTable[SYM_TABLE_SIZE];
+    /// Hash table slot.
+    /// @note
+    ///     The hash is kept alongside the entry pointer, so that probing rarely needs to touch
+    ///     the entries themselves.
+    struct Slot final
+    {
+        unsigned int hash;
+        SYM_ENTRY* entry;       ///< Entry, or `nullptr` if the slot is empty.
+    };
+
+    /// Open-addressing hash table with linear probing.
+    /// The number of slots is always a power of 2, and kept at least twice the number of entries.
+    /// Entries of the same name are kept in order of insertion (most recent first), with the
+    /// most recent one shadowing the others.
+    std::vector<Slot> mSlots;
+    size_t mEntryCount;
+
+    void Insert_Slot(SYM_ENTRY* Table_Entry, bool shadow);
+    void Grow();
 };
 
 using SymbolTablePtr = std::shared_ptr<SymbolTable>;
@@ -160,6 +193,12 @@ public:
     SYM_ENTRY* Find_Symbol(const char* s, int* pIndex = nullptr);
     void Remove_Symbol(int Index, const char *Name, bool is_array_elem, void **DataPtr, int ttype);
 
+    /// Get the number of symbol lookups performed.
+    POV_LONG GetLookupCount() const { return mLookups; }
+
+    /// Get the total number of hash table slots inspected by symbol lookups.
+    POV_LONG GetProbeCount() const { return mProbes; }
+
     //------------------------------------------------------------------------------
 
     SymbolStack();
@@ -178,6 +217,8 @@ protected:
 
     SymbolTable* Tables[MAX_NUMBER_OF_TABLES];
     int Table_Index;
+    POV_LONG mLookups;
+    POV_LONG mProbes;
 };
 
 }
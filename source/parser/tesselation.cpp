@@ -329,7 +329,12 @@ namespace pov_parser
       (MESH_DATA*)POV_MALLOC(sizeof(MESH_DATA),
           "tesselation triangle mesh data");
     das->tesselationMesh->Data->References = 1;
-    das->tesselationMesh->Data->Tree = NULL;
+    das->tesselationMesh->Data->Accounted_Memory = 0;
+    das->tesselationMesh->Data->BVH = NULL;
+    das->tesselationMesh->Data->Storage = NULL;
+    das->tesselationMesh->Data->Page = NULL;
+    das->tesselationMesh->Data->In_Scene_Arena = false;
+    das->tesselationMesh->Data->CompactTriangles = NULL;
     das->tesselationMesh->Data->UVCoords = NULL;
 
     das->tesselationMesh->Data->Normals   = NULL;
@@ -379,6 +384,7 @@ namespace pov_parser
 
     das->tesselationMesh->Compute_BBox();
     Parse_Object_Mods((ObjectPtr)das->tesselationMesh);
+    das->tesselationMesh->Compact_Mesh_Data();
     das->tesselationMesh->Build_Mesh_BBox_Tree();
   }
   /*----------------------------------------------------------------------
@@ -513,9 +519,9 @@ namespace pov_parser
          // generate the list of edges (something not in the mesh object)
      for(cursor = 0;cursor < number_of_face;cursor++)
      {
-       first = meshobj->Data->Triangles[cursor].P1;
-       second = meshobj->Data->Triangles[cursor].P2;
-       third = meshobj->Data->Triangles[cursor].P3;
+       first = meshobj->Data->Get_Triangle(cursor).P1;
+       second = meshobj->Data->Get_Triangle(cursor).P2;
+       third = meshobj->Data->Get_Triangle(cursor).P3;
        if (first > second)
        {
          swappe = first;
@@ -572,9 +578,9 @@ namespace pov_parser
          edge.clear();// a bit late to reclaim memory, but let's do it now that we can forget about that set.
      for(cursor = 0;cursor < number_of_face; cursor++)
      {
-       first = meshobj->Data->Triangles[cursor].P1;
-       second = meshobj->Data->Triangles[cursor].P2;
-       third = meshobj->Data->Triangles[cursor].P3;
+       first = meshobj->Data->Get_Triangle(cursor).P1;
+       second = meshobj->Data->Get_Triangle(cursor).P2;
+       third = meshobj->Data->Get_Triangle(cursor).P3;
        if (first > second)
        {
          swappe = first;
@@ -713,9 +719,15 @@ namespace pov_parser
          FIX_INT(write_nf);
          filep->write(&write_nf, 4);
          memset(&entry,0,sizeof(entry));
-         of[0] = meshobj->Data->Tree->BBox.GetMinX();
-         of[1] = meshobj->Data->Tree->BBox.GetMinY();
-         of[2] = meshobj->Data->Tree->BBox.GetMinZ();
+         of[0] = of[1] = of[2] = 0.0f;
+         for(cursor = 0;cursor < (uint_least32_t)meshobj->Data->Number_Of_Vertices; cursor++)
+         {
+             for(int axis = 0;axis < 3; axis++)
+             {
+                 if ((cursor == 0) || (meshobj->Data->Vertices[cursor][axis] < of[axis]))
+                     of[axis] = meshobj->Data->Vertices[cursor][axis];
+             }
+         }
      for(cursor = 0;cursor < number_of_face; cursor++)
      {
              /* let normal be recomputed by loader, otherwise we need unit vector to outside */
@@ -725,9 +737,9 @@ namespace pov_parser
              /* no choice, no color, between both variants of STL */
              entry.attribute = 0;
              /* get actual data */
-       first = meshobj->Data->Triangles[cursor].P1;
-       second = meshobj->Data->Triangles[cursor].P2;
-       third = meshobj->Data->Triangles[cursor].P3;
+       first = meshobj->Data->Get_Triangle(cursor).P1;
+       second = meshobj->Data->Get_Triangle(cursor).P2;
+       third = meshobj->Data->Get_Triangle(cursor).P3;
              entry.vertex1[0] = (meshobj->Data->Vertices[first][X])-of[0];
              entry.vertex1[1] = (meshobj->Data->Vertices[first][Y])-of[1];
              entry.vertex1[2] = (meshobj->Data->Vertices[first][Z])-of[2];
@@ -3085,7 +3097,8 @@ bool Find_TesselIntersection(Intersection *isect, DBL len, ObjectPtr object, con
     TraceTicket ticket( 1, 0.0);
     Ray ray( ticket );
     Mesh * meshobj= (Mesh *)Obj;
-    MESH_TRIANGLE*s = meshobj->Data->Triangles;
+    std::vector<MESH_TRIANGLE> triangleBuffer;
+    const MESH_TRIANGLE *s = meshobj->Data->Get_Triangles(triangleBuffer);
     SnglVector3d*v = meshobj->Data->Vertices;
     SnglVector3d*n = meshobj->Data->Normals;
     int tria1,tria2,tria3;
@@ -3274,7 +3287,8 @@ bool Find_TesselIntersection(Intersection *isect, DBL len, ObjectPtr object, con
     TraceTicket ticket( 1, 0.0);
     Ray ray( ticket );
     Mesh * meshobj= (Mesh *)Obj;
-    MESH_TRIANGLE*s = meshobj->Data->Triangles;
+    std::vector<MESH_TRIANGLE> triangleBuffer;
+    const MESH_TRIANGLE *s = meshobj->Data->Get_Triangles(triangleBuffer);
     SnglVector3d*v = meshobj->Data->Vertices;
     SnglVector3d*n = meshobj->Data->Normals;
     int tria1,tria2,tria3;
@@ -3468,7 +3482,8 @@ bool Find_TesselIntersection(Intersection *isect, DBL len, ObjectPtr object, con
     TraceTicket ticket( 1, 0.0);
     Ray ray( ticket );
     Mesh * meshobj= (Mesh *)Obj;
-    MESH_TRIANGLE*s = meshobj->Data->Triangles;
+    std::vector<MESH_TRIANGLE> triangleBuffer;
+    const MESH_TRIANGLE *s = meshobj->Data->Get_Triangles(triangleBuffer);
     SnglVector3d*v = meshobj->Data->Vertices;
     SnglVector3d*n = meshobj->Data->Normals;
     int tria1,tria2,tria3;
@@ -3746,7 +3761,8 @@ bool Find_TesselIntersection(Intersection *isect, DBL len, ObjectPtr object, con
       )
   {
     Mesh * meshobj= (Mesh *)Obj;
-    MESH_TRIANGLE*s = meshobj->Data->Triangles;
+    std::vector<MESH_TRIANGLE> triangleBuffer;
+    const MESH_TRIANGLE *s = meshobj->Data->Get_Triangles(triangleBuffer);
     SnglVector3d*v = meshobj->Data->Vertices;
     SnglVector3d*n = meshobj->Data->Normals;
     TEXTURE *t1,*t2,*t3;
@@ -3922,7 +3938,8 @@ bool Find_TesselIntersection(Intersection *isect, DBL len, ObjectPtr object, con
       )
   {
     Mesh * meshobj= (Mesh *)Obj;
-    MESH_TRIANGLE*s = meshobj->Data->Triangles;
+    std::vector<MESH_TRIANGLE> triangleBuffer;
+    const MESH_TRIANGLE *s = meshobj->Data->Get_Triangles(triangleBuffer);
     SnglVector3d*v = meshobj->Data->Vertices;
     SnglVector3d*n = meshobj->Data->Normals;
     TransColour colour;
@@ -4052,7 +4069,8 @@ bool Find_TesselIntersection(Intersection *isect, DBL len, ObjectPtr object, con
       )
   {
     Mesh * meshobj= (Mesh *)Obj;
-    MESH_TRIANGLE*s = meshobj->Data->Triangles;
+    std::vector<MESH_TRIANGLE> triangleBuffer;
+    const MESH_TRIANGLE *s = meshobj->Data->Get_Triangles(triangleBuffer);
     SnglVector3d*v = meshobj->Data->Vertices;
     SnglVector3d*n = meshobj->Data->Normals;
     TransColour colour;
@@ -4177,7 +4195,8 @@ bool Find_TesselIntersection(Intersection *isect, DBL len, ObjectPtr object, con
   {
     Mesh * meshobj= (Mesh *)Obj;
     ObjectPtr  boundary = info->bound;
-    MESH_TRIANGLE*s = meshobj->Data->Triangles;
+    std::vector<MESH_TRIANGLE> triangleBuffer;
+    const MESH_TRIANGLE *s = meshobj->Data->Get_Triangles(triangleBuffer);
     SnglVector3d*v = meshobj->Data->Vertices;
     SnglVector3d*n = meshobj->Data->Normals;
     Vector3d vertex;
@@ -4670,7 +4689,8 @@ bool Find_TesselIntersection(Intersection *isect, DBL len, ObjectPtr object, con
     TraceTicket ticket( 1, 0.0);
     Ray ray( ticket );
     Mesh * meshobj= (Mesh *)Obj;
-    MESH_TRIANGLE*s = meshobj->Data->Triangles;
+    std::vector<MESH_TRIANGLE> triangleBuffer;
+    const MESH_TRIANGLE *s = meshobj->Data->Get_Triangles(triangleBuffer);
     SnglVector3d*v = meshobj->Data->Vertices;
     SnglVector3d*n = meshobj->Data->Normals;
     int tria1,tria2,tria3;
@@ -5071,7 +5091,7 @@ bool Find_TesselIntersection(Intersection *isect, DBL len, ObjectPtr object, con
     {
       Error("Index value out of range.\n");
     }
-    return meshobj->Data->Triangles[ind].Smooth;
+    return meshobj->Data->Get_Triangle(ind).Smooth;
   }
 
   DBL Parser::Parse_Get_Triangles_Amount(void)
@@ -5127,7 +5147,6 @@ bool Find_TesselIntersection(Intersection *isect, DBL len, ObjectPtr object, con
   void Parser::Parse_Get_Vertex_Indices(Vector3d& Vect)
   {
     Mesh* meshobj = ParseParameter(false);
-    MESH_TRIANGLE* s = meshobj->Data->Triangles;
     int ind = ParseSecondParameter();
 
     if(ind < 0 || ind >= meshobj->Data->Number_Of_Triangles)
@@ -5135,15 +5154,15 @@ bool Find_TesselIntersection(Intersection *isect, DBL len, ObjectPtr object, con
       Error("Index value out of range.\n");
     }
 
-    Vect[X] = s[ind].P1;
-    Vect[Y] = s[ind].P2;
-    Vect[Z] = s[ind].P3;
+    const MESH_TRIANGLE s = meshobj->Data->Get_Triangle(ind);
+    Vect[X] = s.P1;
+    Vect[Y] = s.P2;
+    Vect[Z] = s.P3;
   }
 
   void Parser::Parse_Get_Normal_Indices(Vector3d& Vect)
   {
     Mesh* meshobj = ParseParameter(false);
-    MESH_TRIANGLE* s = meshobj->Data->Triangles;
     int ind = ParseSecondParameter();
 
     if(ind < 0 || ind >= meshobj->Data->Number_Of_Triangles)
@@ -5151,9 +5170,10 @@ bool Find_TesselIntersection(Intersection *isect, DBL len, ObjectPtr object, con
       Error("Index value out of range.\n");
     }
 
-    Vect[X] = s[ind].N1;
-    Vect[Y] = s[ind].N2;
-    Vect[Z] = s[ind].N3;
+    const MESH_TRIANGLE s = meshobj->Data->Get_Triangle(ind);
+    Vect[X] = s.N1;
+    Vect[Y] = s.N2;
+    Vect[Z] = s.N3;
   }
 
    ObjectPtr Parser::Planet_Object(ObjectPtr Obj,
@@ -5163,7 +5183,8 @@ bool Find_TesselIntersection(Intersection *isect, DBL len, ObjectPtr object, con
     TraceTicket ticket( 1, 0.0);
     Ray ray( ticket );
     Mesh * meshobj= (Mesh *)Obj;
-    MESH_TRIANGLE*s = meshobj->Data->Triangles;
+    std::vector<MESH_TRIANGLE> triangleBuffer;
+    const MESH_TRIANGLE *s = meshobj->Data->Get_Triangles(triangleBuffer);
     SnglVector3d*v = meshobj->Data->Vertices;
     SnglVector3d*n = meshobj->Data->Normals;
     int vlimit;
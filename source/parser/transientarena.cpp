@@ -0,0 +1,123 @@
+//******************************************************************************
+///
+/// @file parser/transientarena.cpp
+///
+/// Implementation of the arena holding transient values during parsing.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+// Unit header file must be the first file included within POV-Ray *.cpp files (pulls in config)
+#include "parser/transientarena.h"
+
+// C++ variants of C standard header files
+//  (none at the moment)
+
+// C++ standard header files
+#include <algorithm>
+
+// POV-Ray header files (base module)
+#include "base/pov_mem.h"
+#include "base/povassert.h"
+
+// POV-Ray header files (core module)
+//  (none at the moment)
+
+// POV-Ray header files (parser module)
+//  (none at the moment)
+
+// this must be the last file included
+#include "base/povdebug.h"
+
+namespace pov_parser
+{
+
+using namespace pov_base;
+
+//******************************************************************************
+
+constexpr std::size_t TransientArena::kChunkSize;
+constexpr std::size_t TransientArena::kAlignment;
+
+TransientArena::TransientArena() :
+    mChunk(0),
+    mUsed(0)
+{}
+
+TransientArena::~TransientArena()
+{
+    Release(Mark{ 0, 0, 0 });
+}
+
+void* TransientArena::Allocate(std::size_t size)
+{
+    size = (size + kAlignment - 1) & ~(kAlignment - 1);
+
+    if (maChunks.empty() || (mUsed + size > maChunks[mChunk].size))
+    {
+        // Current chunk exhausted; move on to the next one, or insert a new one if that is too small.
+        std::size_t next = (maChunks.empty() ? 0 : mChunk + 1);
+        if ((next >= maChunks.size()) || (maChunks[next].size < size))
+        {
+            std::size_t chunkSize = std::max(size, kChunkSize);
+            maChunks.insert(maChunks.begin() + next, Chunk{ std::unique_ptr<char[]>(new char[chunkSize]), chunkSize });
+        }
+        mChunk = next;
+        mUsed = 0;
+    }
+
+    void* block = maChunks[mChunk].data.get() + mUsed;
+    mUsed += size;
+    return block;
+}
+
+void TransientArena::Adopt(void* block)
+{
+    maAdopted.push_back(block);
+}
+
+TransientArena::Mark TransientArena::GetMark() const
+{
+    return Mark{ mChunk, mUsed, maAdopted.size() };
+}
+
+void TransientArena::Release(const Mark& mark)
+{
+    POV_PARSER_ASSERT(mark.adopted <= maAdopted.size());
+    while (maAdopted.size() > mark.adopted)
+    {
+        POV_FREE(maAdopted.back());
+        maAdopted.pop_back();
+    }
+    mChunk = mark.chunk;
+    mUsed  = mark.used;
+}
+
+}
+// end of namespace pov_parser
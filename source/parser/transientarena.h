@@ -0,0 +1,149 @@
+//******************************************************************************
+///
+/// @file parser/transientarena.h
+///
+/// Declarations for the arena holding transient values during parsing.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+#ifndef POVRAY_PARSER_TRANSIENTARENA_H
+#define POVRAY_PARSER_TRANSIENTARENA_H
+
+// Module config header file must be the first file included within POV-Ray unit header files
+#include "parser/configparser.h"
+
+// C++ variants of C standard header files
+#include <cstddef>
+
+// C++ standard header files
+#include <memory>
+#include <vector>
+
+// POV-Ray header files (base module)
+//  (none at the moment)
+
+// POV-Ray header files (core module)
+//  (none at the moment)
+
+// POV-Ray header files (parser module)
+//  (none at the moment)
+
+namespace pov_parser
+{
+
+//------------------------------------------------------------------------------
+
+/// Arena for transient values created while evaluating expressions.
+///
+/// Values allocated from the arena are interim by definition: They are owned by the arena, and
+/// released en bloc when the innermost enclosing @ref Scope ends. Values that may escape into
+/// declarations or the scene must never be allocated from the arena.
+///
+/// Memory is taken from a list of chunks that is retained when values are released, so that in
+/// the steady state (e.g. in the body of a `#while` loop) no memory needs to be allocated from
+/// the general-purpose heap at all.
+///
+/// @note
+///     Since macros may be invoked in the middle of an expression, releasing values strictly in
+///     reverse order of their allocation, as implemented via @ref Scope, is the only safe way to
+///     reset the arena.
+///
+class TransientArena final
+{
+public:
+
+    /// Position in the arena to release values back to.
+    struct Mark final
+    {
+        std::size_t chunk;
+        std::size_t used;
+        std::size_t adopted;
+    };
+
+    /// Range of code during which transient values remain valid.
+    ///
+    /// All values allocated or adopted by the arena while an instance of this class exists are
+    /// released when the instance is destroyed.
+    ///
+    class Scope final
+    {
+    public:
+        Scope(TransientArena& arena) : mArena(arena), mMark(arena.GetMark()) {}
+        ~Scope() { mArena.Release(mMark); }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    private:
+        TransientArena& mArena;
+        Mark            mMark;
+    };
+
+    TransientArena();
+    ~TransientArena();
+
+    TransientArena(const TransientArena&) = delete;
+    TransientArena& operator=(const TransientArena&) = delete;
+
+    /// Allocate uninitialized memory.
+    void* Allocate(std::size_t size);
+
+    /// Allocate uninitialized memory for an array of trivial values.
+    template<typename T>
+    T* AllocateArray(std::size_t count) { return reinterpret_cast<T*>(Allocate(count * sizeof(T))); }
+
+    /// Take ownership of a block allocated via @ref POV_MALLOC.
+    void Adopt(void* block);
+
+    /// Get the current position in the arena.
+    Mark GetMark() const;
+
+    /// Release all values allocated or adopted since the specified position.
+    void Release(const Mark& mark);
+
+private:
+
+    static constexpr std::size_t kChunkSize = 64 * 1024;
+    static constexpr std::size_t kAlignment = sizeof(double);
+
+    struct Chunk final
+    {
+        std::unique_ptr<char[]> data;
+        std::size_t             size;
+    };
+
+    std::vector<Chunk>  maChunks;   ///< Chunks, including unused ones retained for later use.
+    std::size_t         mChunk;     ///< Index of the chunk currently allocated from.
+    std::size_t         mUsed;      ///< Octets allocated from the current chunk.
+    std::vector<void*>  maAdopted;  ///< Blocks adopted, in order of adoption.
+};
+
+}
+// end of namespace pov_parser
+
+#endif // POVRAY_PARSER_TRANSIENTARENA_H
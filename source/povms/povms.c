@@ -38,6 +38,14 @@
 #include <stdio.h>
 #include <time.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <mutex>
+#include <new>
+#include <vector>
+
 // Note: Needed for function prototypes
 #define POVMS_EXPORT_STREAM_FUNCTIONS
 #include "povms.h"
@@ -64,6 +72,16 @@ using namespace pov_base;
     #define kDefaultTimeout                 10
 #endif
 
+// Note: Batched messages are delivered once this many bytes have accumulated for a destination...
+#ifndef kPOVMSBatchMaxSize
+    #define kPOVMSBatchMaxSize              65536
+#endif
+
+// ...or once the oldest of them has waited this many milliseconds, whichever comes first.
+#ifndef kPOVMSBatchMaxDelay
+    #define kPOVMSBatchMaxDelay             20
+#endif
+
 #ifndef POVMS_ASSERT
     #define POVMS_ASSERT(c,s) POVMS_AssertFunction(c, s, __FILE__, __LINE__)
 #endif
@@ -227,6 +245,26 @@ struct POVMSContextData
     POVMSLong nextsequenceid;
 };
 
+// Messages sent using POVMS_SendBatched to one destination and not yet delivered.
+struct POVMSBatch
+{
+    POVMSAddress addr;
+    POVMSStream *data;      // batch header followed by the messages, each preceded by its size
+    int size;
+    int capacity;
+    int count;
+    std::chrono::steady_clock::time_point started;
+};
+
+struct POVMSBatchList
+{
+    std::mutex mutex;
+    std::vector<POVMSBatch> batches;
+    std::atomic<int> pending;   // number of batches, for a quick check without locking the mutex
+
+    POVMSBatchList() : pending(0) {}
+};
+
 
 /*****************************************************************************
 * Local variables
@@ -241,6 +279,11 @@ struct
     int ucs2_write[kPOVMSStreamUCS2Size],   ucs2_read[kPOVMSStreamUCS2Size];
 } POVMSStreamOrderTables;
 
+// Note: Never destroyed, as messages may still be sent during static destruction.
+static POVMSBatchList& gPOVMSBatches = *(new POVMSBatchList);
+
+static const int kPOVMSBatchHeaderSize = kPOVMSMagicSize + 3 * kPOVMSStreamIntSize; // header, version, total size, message count
+
 
 /*****************************************************************************
 * Local functions
@@ -264,6 +307,15 @@ void POVMSStream_WriteDataUnordered                   (const POVMSStream *data,
 
 POVMSNode *POVMSObject_Find    (POVMSObjectPtr msg, POVMSType key);
 
+POVMSResult POVMS_ProcessStream                       (POVMSContextData *context, POVMSStream *stream, int maxsize);
+POVMSResult POVMS_ProcessBatch                        (POVMSContextData *context, POVMSStream *stream, int maxsize);
+POVMSStream *POVMS_WriteStream                        (POVMSObjectPtr msg, POVMSObjectPtr result, int mode, int *totalsizeptr);
+POVMSResult POVMS_PrepareSend                         (POVMSContext contextref, POVMSObjectPtr msg, POVMSAddress *addrptr);
+POVMSResult POVMS_AppendToBatch                       (POVMSAddress addr, POVMSStream *stream, int streamsize);
+POVMSResult POVMS_FlushBatch                          (POVMSAddress addr);
+void POVMS_DiscardBatch                               (POVMSAddress addr);
+POVMSResult POVMS_DeliverBatch                        (POVMSBatch& batch);
+
 #ifndef POVMS_NO_DUMP_SUPPORT
 POVMSResult POVMSStream_Dump           (FILE *file, POVMSStream *stream, int datasize);
 POVMSResult POVMSObject_DumpSpace      (FILE *file);
@@ -366,6 +418,8 @@ POVMS_EXPORT POVMSResult POVMS_CDECL POVMS_CloseContext(POVMSContext contextref)
 
     context->valid = POVMSFalse;
 
+    POVMS_DiscardBatch(POVMS_Sys_QueueToAddress(context->queue));
+
     POVMS_Sys_QueueClose(context->queue);
     context->queue = POVMS_NULLPTR;
 
@@ -531,20 +585,7 @@ POVMS_EXPORT POVMSResult POVMS_CDECL POVMS_RemoveReceiver(POVMSContext contextre
 POVMS_EXPORT POVMSResult POVMS_CDECL POVMS_ProcessMessages(POVMSContext contextref, POVMSBool blocking, POVMSBool yielding)
 {
     POVMSContextData *context = (POVMSContextData *)contextref;
-    POVMSObject msg;
-    POVMSObject result;
-    POVMSAddress saddr = POVMSInvalidAddress;
-    POVMSAddress daddr = POVMSInvalidAddress;
     POVMSStream *stream = POVMS_NULLPTR;
-    POVMSLong resultid = 0;
-    POVMSInt msgsize = 0;
-    POVMSInt mode = kPOVMSSendMode_Invalid;
-    POVMSInt resultsize = 0;
-    POVMSInt objectcnt = 0;
-    POVMSInt totalsize = 0;
-    POVMSInt datasize = 0;
-    POVMSInt version = 0;
-    char header[kPOVMSMagicSize];
     POVMSResult err = kNoErr;
     int maxsize = 0;
 
@@ -555,118 +596,226 @@ POVMS_EXPORT POVMSResult POVMS_CDECL POVMS_ProcessMessages(POVMSContext contextr
     if((context->result.type != kPOVMSType_Null) && (context->resultid != 0))
         return kOutOfSyncErr;
 
+    // messages batched for this context need not wait any longer once it is ready to receive them
+    (void)POVMS_FlushBatch(POVMS_Sys_QueueToAddress(context->queue));
+
     stream = (POVMSStream *)POVMS_Sys_QueueReceive(context->queue, &maxsize, blocking, yielding);
     if ((stream != POVMS_NULLPTR) && (maxsize > 16))
     {
-        msg.type = kPOVMSType_Null;
-        msg.size = 0;
-        msg.root = POVMS_NULLPTR;
+        try
+        {
+            if((stream[0] == 'P') && (stream[1] == 'O') && (stream[2] == 'V') && (stream[3] == 'R') &&
+               (stream[4] == 'A') && (stream[5] == 'Y') && (stream[6] == 'M') && (stream[7] == 'B'))
+                err = POVMS_ProcessBatch(context, stream, maxsize);
+            else
+                err = POVMS_ProcessStream(context, stream, maxsize);
+        }
+        catch(...)
+        {
+            POVMS_Sys_Free(stream);
+            throw;
+        }
 
-        result.type = kPOVMSType_Null;
-        result.size = 0;
-        result.root = POVMS_NULLPTR;
+        POVMS_Sys_Free(stream);
 
-        datasize += POVMSStream_ReadString(header, stream, kPOVMSMagicSize, &maxsize); // header       8 byte
-        if(!((header[0] == 'P') && (header[1] == 'O') && (header[2] == 'V') && (header[3] == 'R') &&
-             (header[4] == 'A') && (header[5] == 'Y') && (header[6] == 'M') && (header[7] == 'S')))
-            err = kCannotHandleDataErr;
+        return err;
+    }
 
-        datasize += POVMSStream_ReadInt(&version, stream + datasize, &maxsize);        // version      4 byte
-        if(version != POVMS_VERSION)
-            err = kVersionErr;
+    return kNoErr;
+}
 
-        datasize += POVMSStream_ReadInt(&totalsize, stream + datasize, &maxsize);      // total size   4 byte
-        if((totalsize - 16) != maxsize)
-            err = kInvalidDataSizeErr;
 
-        datasize += POVMSStream_ReadInt(&mode, stream + datasize, &maxsize);           // flags        4 byte
+/*****************************************************************************
+*
+* FUNCTION
+*   POVMS_ProcessBatch
+*
+* DESCRIPTION
+*   Processes all messages of a batch built by POVMS_SendBatched.  Returns
+*   kFalseErr as there *might* be more messages waiting to be processed.
+*   Each message is processed on its own: if a handler throws an exception,
+*   the remaining messages are still processed, and the first exception is
+*   rethrown once the whole batch has been dealt with.
+*
+* CHANGES
+*   -
+*
+******************************************************************************/
+
+POVMSResult POVMS_ProcessBatch(POVMSContextData *context, POVMSStream *stream, int maxsize)
+{
+    POVMSInt version = 0;
+    POVMSInt totalsize = 0;
+    POVMSInt count = 0;
+    POVMSInt msgsize = 0;
+    int datasize = kPOVMSMagicSize;                                                  // header       8 byte
 
-        datasize += POVMSStream_ReadInt(&objectcnt, stream + datasize, &maxsize);      // objects      4 byte
+    maxsize -= kPOVMSMagicSize;
+    datasize += POVMSStream_ReadInt(&version, stream + datasize, &maxsize);         // version      4 byte
+    datasize += POVMSStream_ReadInt(&totalsize, stream + datasize, &maxsize);       // total size   4 byte
+    datasize += POVMSStream_ReadInt(&count, stream + datasize, &maxsize);           // messages     4 byte
+    if((version != POVMS_VERSION) || (totalsize - datasize != maxsize))
+        return kNoErr; // ignore all errors
 
-        datasize += POVMSStream_ReadInt(&msgsize, stream + datasize, &maxsize);        // object size  4 byte
-        datasize += POVMSStream_Read(&msg, stream + datasize, &maxsize);               // message      x byte
+    std::exception_ptr firstexception;
 
-        if(objectcnt == 2)
+    for(; (count > 0) && (maxsize > kPOVMSStreamIntSize); count--)
+    {
+        datasize += POVMSStream_ReadInt(&msgsize, stream + datasize, &maxsize);     // message size 4 byte
+        if((msgsize <= 16) || (msgsize > maxsize))
+            break;
+        try
+        {
+            (void)POVMS_ProcessStream(context, stream + datasize, msgsize);          // message      x byte
+        }
+        catch(...)
         {
-            datasize += POVMSStream_ReadInt(&resultsize, stream + datasize, &maxsize); // object size  4 byte
-            datasize += POVMSStream_Read(&result, stream + datasize, &maxsize);        // result       x byte
+            if(!firstexception)
+                firstexception = std::current_exception();
         }
+        datasize += msgsize;
+        maxsize -= msgsize;
+    }
 
-        (void)POVMSUtil_GetLong(&msg, kPOVMSResultSequenceID, &resultid);
+    if(firstexception)
+        std::rethrow_exception(firstexception);
 
-        if(err == kNoErr)
+    return kFalseErr;
+}
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*   POVMS_ProcessStream
+*
+* DESCRIPTION
+*   Processes a single message stream.  Return kFalseErr if there *might* be
+*   more messages waiting to be processed.  The stream is not freed.
+*
+* CHANGES
+*   -
+*
+******************************************************************************/
+
+POVMSResult POVMS_ProcessStream(POVMSContextData *context, POVMSStream *stream, int maxsize)
+{
+    POVMSObject msg;
+    POVMSObject result;
+    POVMSAddress saddr = POVMSInvalidAddress;
+    POVMSAddress daddr = POVMSInvalidAddress;
+    POVMSLong resultid = 0;
+    POVMSInt msgsize = 0;
+    POVMSInt mode = kPOVMSSendMode_Invalid;
+    POVMSInt resultsize = 0;
+    POVMSInt objectcnt = 0;
+    POVMSInt totalsize = 0;
+    POVMSInt datasize = 0;
+    POVMSInt version = 0;
+    char header[kPOVMSMagicSize];
+    POVMSResult err = kNoErr;
+
+    msg.type = kPOVMSType_Null;
+    msg.size = 0;
+    msg.root = POVMS_NULLPTR;
+
+    result.type = kPOVMSType_Null;
+    result.size = 0;
+    result.root = POVMS_NULLPTR;
+
+    datasize += POVMSStream_ReadString(header, stream, kPOVMSMagicSize, &maxsize); // header       8 byte
+    if(!((header[0] == 'P') && (header[1] == 'O') && (header[2] == 'V') && (header[3] == 'R') &&
+         (header[4] == 'A') && (header[5] == 'Y') && (header[6] == 'M') && (header[7] == 'S')))
+        err = kCannotHandleDataErr;
+
+    datasize += POVMSStream_ReadInt(&version, stream + datasize, &maxsize);        // version      4 byte
+    if(version != POVMS_VERSION)
+        err = kVersionErr;
+
+    datasize += POVMSStream_ReadInt(&totalsize, stream + datasize, &maxsize);      // total size   4 byte
+    if((totalsize - 16) != maxsize)
+        err = kInvalidDataSizeErr;
+
+    datasize += POVMSStream_ReadInt(&mode, stream + datasize, &maxsize);           // flags        4 byte
+
+    datasize += POVMSStream_ReadInt(&objectcnt, stream + datasize, &maxsize);      // objects      4 byte
+
+    datasize += POVMSStream_ReadInt(&msgsize, stream + datasize, &maxsize);        // object size  4 byte
+    datasize += POVMSStream_Read(&msg, stream + datasize, &maxsize);               // message      x byte
+
+    if(objectcnt == 2)
+    {
+        datasize += POVMSStream_ReadInt(&resultsize, stream + datasize, &maxsize); // object size  4 byte
+        datasize += POVMSStream_Read(&result, stream + datasize, &maxsize);        // result       x byte
+    }
+
+    (void)POVMSUtil_GetLong(&msg, kPOVMSResultSequenceID, &resultid);
+
+    if(err == kNoErr)
+    {
+        if((context->resultid == 0) || (context->resultid != resultid))
         {
-            if((context->resultid == 0) || (context->resultid != resultid))
+            // set source and destination addresses
+            if((objectcnt == 2) && (result.type != kPOVMSType_Null))
             {
-                // set source and destination addresses
-                if((objectcnt == 2) && (result.type != kPOVMSType_Null))
+                if(err == kNoErr)
                 {
+                    if((POVMSMsg_GetSourceAddress(&msg, &saddr) != kNoErr) || (saddr == POVMSInvalidAddress))
+                        err = POVMSMsg_GetSourceAddress(&result, &saddr);
                     if(err == kNoErr)
-                    {
-                        if((POVMSMsg_GetSourceAddress(&msg, &saddr) != kNoErr) || (saddr == POVMSInvalidAddress))
-                            err = POVMSMsg_GetSourceAddress(&result, &saddr);
-                        if(err == kNoErr)
-                            err = POVMSMsg_SetDestinationAddress(&result, saddr);
-                    }
-
-                    if(err == kNoErr)
-                    {
-                        if((POVMSMsg_GetDestinationAddress(&msg, &daddr) != kNoErr) || (daddr == POVMSInvalidAddress))
-                            err = POVMSMsg_GetDestinationAddress(&result, &daddr);
-                        if(err == kNoErr)
-                            (void)POVMSMsg_SetSourceAddress(&result, daddr);
-                    }
+                        err = POVMSMsg_SetDestinationAddress(&result, saddr);
+                }
 
+                if(err == kNoErr)
+                {
+                    if((POVMSMsg_GetDestinationAddress(&msg, &daddr) != kNoErr) || (daddr == POVMSInvalidAddress))
+                        err = POVMSMsg_GetDestinationAddress(&result, &daddr);
                     if(err == kNoErr)
-                        err = POVMSUtil_GetLong(&result, kPOVMSResultSequenceID, &resultid);
+                        (void)POVMSMsg_SetSourceAddress(&result, daddr);
                 }
 
                 if(err == kNoErr)
+                    err = POVMSUtil_GetLong(&result, kPOVMSResultSequenceID, &resultid);
+            }
+
+            if(err == kNoErr)
+            {
+                try
                 {
-                    try
-                    {
-                        err = POVMS_Receive(context, &msg, &result, mode);
-                    }
-                    catch(...)
-                    {
-                        POVMSObject_Delete(&result);
-                        POVMSObject_Delete(&msg);
-                        POVMS_Sys_Free(stream);
-                        throw;
-                    }
+                    err = POVMS_Receive(context, &msg, &result, mode);
                 }
-
-                if(((objectcnt == 2) && (result.type != kPOVMSType_Null)) && (err == kNoErr))
+                catch(...)
                 {
-                    if((objectcnt == 2) && (result.type != kPOVMSType_Null)) // enforce result sequence id
-                        err = POVMSUtil_SetLong(&result, kPOVMSResultSequenceID, resultid);
-                    if(err == kNoErr)
-                        err = POVMS_Send(context, &result, POVMS_NULLPTR, kPOVMSSendMode_NoReply);
+                    POVMSObject_Delete(&result);
+                    POVMSObject_Delete(&msg);
+                    throw;
                 }
-                else
-                    (void)POVMSObject_Delete(&result);
-
-                (void)POVMSObject_Delete(&msg);
-
-                POVMS_Sys_Free(stream);
+            }
 
-                return kFalseErr;
+            if(((objectcnt == 2) && (result.type != kPOVMSType_Null)) && (err == kNoErr))
+            {
+                if((objectcnt == 2) && (result.type != kPOVMSType_Null)) // enforce result sequence id
+                    err = POVMSUtil_SetLong(&result, kPOVMSResultSequenceID, resultid);
+                if(err == kNoErr)
+                    err = POVMS_Send(context, &result, POVMS_NULLPTR, kPOVMSSendMode_NoReply);
             }
             else
-            {
-                context->result = msg;
-                context->resultid = 0;
+                (void)POVMSObject_Delete(&result);
 
-                POVMS_Sys_Free(stream);
+            (void)POVMSObject_Delete(&msg);
 
-                return kNoErr;
-            }
+            return kFalseErr;
         }
         else
-            return kNoErr; // ignore all errors
-    }
+        {
+            context->result = msg;
+            context->resultid = 0;
 
-    return kNoErr;
+            return kNoErr;
+        }
+    }
+    else
+        return kNoErr; // ignore all errors
 }
 
 
@@ -717,88 +866,42 @@ POVMS_EXPORT POVMSResult POVMS_CDECL POVMS_Send(POVMSContext contextref, POVMSOb
             err = kParamErr;
     }
 
-    if(err == kNoErr)
-    {
-        if((POVMSMsg_GetSourceAddress(msg, &addr) != kNoErr) || (addr == POVMSInvalidAddress))
-        {
-            if (contextref == POVMS_NULLPTR)
-                err = kParamErr;
-            else
-                err = POVMS_GetContextAddress(contextref, &addr);
-            if(err == kNoErr)
-                err = POVMSMsg_SetSourceAddress(msg, addr);
-        }
-    }
-
     if(err == kNoErr)
     {
         if(POVMSUtil_GetInt(msg, kPOVMSMessageTimeoutID, &maxtime) != kNoErr)
             maxtime = kDefaultTimeout; // kDefaultTimeout seconds is the default timeout
     }
 
-    if (contextref != POVMS_NULLPTR)
-    {
-        if(err == kNoErr)
-            err = POVMSUtil_SetLong(msg, kPOVMSMessageSequenceID, context->nextsequenceid);
+    if(err == kNoErr)
+        err = POVMS_PrepareSend(contextref, msg, &addr);
+    else if (contextref != POVMS_NULLPTR)
         context->nextsequenceid++;
 
-        if(mode == kPOVMSSendMode_WaitReply)
+    if ((contextref != POVMS_NULLPTR) && (mode == kPOVMSSendMode_WaitReply))
+    {
+        if(err == kNoErr)
         {
-            if(err == kNoErr)
-            {
-                if (!POVMS_ASSERT(context->thread == POVMS_Sys_GetCurrentThread(), "POVMS_Send context not valid for this thread"))
-                    err = kInvalidContextErr;
-            }
-
-            resultid = context->nextsequenceid;
-            if(err == kNoErr)
-                err = POVMSUtil_SetLong(result, kPOVMSResultSequenceID, context->nextsequenceid);
-            context->nextsequenceid++;
+            if (!POVMS_ASSERT(context->thread == POVMS_Sys_GetCurrentThread(), "POVMS_Send context not valid for this thread"))
+                err = kInvalidContextErr;
         }
+
+        resultid = context->nextsequenceid;
+        if(err == kNoErr)
+            err = POVMSUtil_SetLong(result, kPOVMSResultSequenceID, context->nextsequenceid);
+        context->nextsequenceid++;
     }
 
+    // messages batched earlier must arrive first
     if(err == kNoErr)
-        err = POVMSMsg_GetDestinationAddress(msg, &addr);
+        (void)POVMS_FlushBatch(addr);
 
     if(err == kNoErr)
     {
-        int msgsize = POVMSStream_Size(msg);
-        int resultsize = POVMSStream_Size(result);
-        int objectcnt = 0;
         int totalsize = 0;
-        int datasize = 0;
-        int maxsize = 0;
-
-        if (result != POVMS_NULLPTR)
-            objectcnt = 2;
-        else
-            objectcnt = 1;
-
-        totalsize =         kPOVMSMagicSize     // header
-                  +     5 * kPOVMSStreamIntSize // version, total size, flags, object count, objects size
-                  +         msgsize;            // message
-        if (result != POVMS_NULLPTR)
-            totalsize +=    kPOVMSStreamIntSize // result object size
-                       +    resultsize;         // result
-        maxsize = totalsize;
-
-        POVMSStream *stream = (POVMSStream *)POVMS_Sys_Malloc(totalsize);
+        POVMSStream *stream = POVMS_WriteStream(msg, result, mode, &totalsize);
 
         if (stream != POVMS_NULLPTR)
         {
-            datasize += POVMSStream_WriteString("POVRAYMS", stream, &maxsize);             // header       8 byte
-            datasize += POVMSStream_WriteInt(POVMS_VERSION, stream + datasize, &maxsize);  // version      4 byte
-            datasize += POVMSStream_WriteInt(totalsize, stream + datasize, &maxsize);      // total size   4 byte
-            datasize += POVMSStream_WriteInt(mode, stream + datasize, &maxsize);           // flags        4 byte
-            datasize += POVMSStream_WriteInt(objectcnt, stream + datasize, &maxsize);      // objects      4 byte
-            datasize += POVMSStream_WriteInt(msgsize, stream + datasize, &maxsize);        // object size  4 byte
-            datasize += POVMSStream_Write(msg, stream + datasize, &maxsize);               // message      x byte
-            if (result != POVMS_NULLPTR)
-            {
-                datasize += POVMSStream_WriteInt(resultsize, stream + datasize, &maxsize); // object size  4 byte
-                datasize += POVMSStream_Write(result, stream + datasize, &maxsize);        // result       x byte
-            }
-
             if(POVMS_Sys_QueueSend(POVMS_Sys_AddressToQueue(addr), stream, totalsize) != kPOVMSQueueNoErr)
                 err = kQueueFullErr; // TODO FIXME - queue may have failed for other reasons
 
@@ -845,6 +948,384 @@ POVMS_EXPORT POVMSResult POVMS_CDECL POVMS_Send(POVMSContext contextref, POVMSOb
 }
 
 
+/*****************************************************************************
+*
+* FUNCTION
+*   POVMS_SendBatched
+*
+* DESCRIPTION
+*   Sends a message like POVMS_Send in kPOVMSSendMode_NoReply mode, but may
+*   hold it back to be delivered together with other messages to the same
+*   destination, to reduce the queue traffic caused by many small messages.
+*   A batch is delivered once it has grown to kPOVMSBatchMaxSize bytes, once
+*   its oldest message has waited for kPOVMSBatchMaxDelay milliseconds, once
+*   a message is sent to the same destination using POVMS_Send, or once the
+*   receiving context calls POVMS_ProcessMessages, whichever comes first.
+*   As with kPOVMSSendMode_NoReply, the context is optional.
+*
+* CHANGES
+*   -
+*
+******************************************************************************/
+
+POVMS_EXPORT POVMSResult POVMS_CDECL POVMS_SendBatched(POVMSContext contextref, POVMSObjectPtr msg)
+{
+    POVMSAddress addr = POVMSInvalidAddress;
+    POVMSResult err = kNoErr;
+
+    POVMS_LOG_OUTPUT("POVMS_SendBatched");
+
+    if (msg == POVMS_NULLPTR)
+        return kParamErr;
+    else if(msg->type == kPOVMSType_LockedObject)
+        return kNotNowErr;
+
+    err = POVMS_PrepareSend(contextref, msg, &addr);
+
+    if(err == kNoErr)
+    {
+        int totalsize = 0;
+        POVMSStream *stream = POVMS_WriteStream(msg, POVMS_NULLPTR, kPOVMSSendMode_NoReply, &totalsize);
+
+        if (stream != POVMS_NULLPTR)
+        {
+            err = POVMS_AppendToBatch(addr, stream, totalsize);
+            POVMS_Sys_Free(stream);
+        }
+        else
+            err = kMemFullErr;
+    }
+
+    (void)POVMSObject_Delete(msg);
+
+    return err;
+}
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*   POVMS_FlushBatches
+*
+* DESCRIPTION
+*   Delivers all messages held back by POVMS_SendBatched right away.
+*
+* CHANGES
+*   -
+*
+******************************************************************************/
+
+POVMS_EXPORT POVMSResult POVMS_CDECL POVMS_FlushBatches()
+{
+    std::lock_guard<std::mutex> lock(gPOVMSBatches.mutex);
+    POVMSResult err = kNoErr;
+
+    while(!gPOVMSBatches.batches.empty())
+    {
+        POVMSResult temp_err = POVMS_DeliverBatch(gPOVMSBatches.batches.back());
+        if(err == kNoErr)
+            err = temp_err;
+        gPOVMSBatches.batches.pop_back();
+    }
+    gPOVMSBatches.pending = 0;
+
+    return err;
+}
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*   POVMS_PrepareSend
+*
+* DESCRIPTION
+*   Sets the source address and sequence id of a message about to be sent,
+*   and gets its destination address.
+*
+* CHANGES
+*   -
+*
+******************************************************************************/
+
+POVMSResult POVMS_PrepareSend(POVMSContext contextref, POVMSObjectPtr msg, POVMSAddress *addrptr)
+{
+    POVMSContextData *context = (POVMSContextData *)contextref;
+    POVMSAddress addr = POVMSInvalidAddress;
+    POVMSResult err = kNoErr;
+
+    if((POVMSMsg_GetSourceAddress(msg, &addr) != kNoErr) || (addr == POVMSInvalidAddress))
+    {
+        if (contextref == POVMS_NULLPTR)
+            err = kParamErr;
+        else
+            err = POVMS_GetContextAddress(contextref, &addr);
+        if(err == kNoErr)
+            err = POVMSMsg_SetSourceAddress(msg, addr);
+    }
+
+    if (contextref != POVMS_NULLPTR)
+    {
+        if(err == kNoErr)
+            err = POVMSUtil_SetLong(msg, kPOVMSMessageSequenceID, context->nextsequenceid);
+        context->nextsequenceid++;
+    }
+
+    if(err == kNoErr)
+        err = POVMSMsg_GetDestinationAddress(msg, addrptr);
+
+    return err;
+}
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*   POVMS_WriteStream
+*
+* DESCRIPTION
+*   Writes a message and optional result object to a newly allocated
+*   stream as expected by POVMS_ProcessStream.  Returns POVMS_NULLPTR if
+*   out of memory.
+*
+* CHANGES
+*   -
+*
+******************************************************************************/
+
+POVMSStream *POVMS_WriteStream(POVMSObjectPtr msg, POVMSObjectPtr result, int mode, int *totalsizeptr)
+{
+    int msgsize = POVMSStream_Size(msg);
+    int resultsize = POVMSStream_Size(result);
+    int objectcnt = 0;
+    int totalsize = 0;
+    int datasize = 0;
+    int maxsize = 0;
+
+    if (result != POVMS_NULLPTR)
+        objectcnt = 2;
+    else
+        objectcnt = 1;
+
+    totalsize =         kPOVMSMagicSize     // header
+              +     5 * kPOVMSStreamIntSize // version, total size, flags, object count, objects size
+              +         msgsize;            // message
+    if (result != POVMS_NULLPTR)
+        totalsize +=    kPOVMSStreamIntSize // result object size
+                   +    resultsize;         // result
+    maxsize = totalsize;
+
+    POVMSStream *stream = (POVMSStream *)POVMS_Sys_Malloc(totalsize);
+
+    if (stream != POVMS_NULLPTR)
+    {
+        datasize += POVMSStream_WriteString("POVRAYMS", stream, &maxsize);             // header       8 byte
+        datasize += POVMSStream_WriteInt(POVMS_VERSION, stream + datasize, &maxsize);  // version      4 byte
+        datasize += POVMSStream_WriteInt(totalsize, stream + datasize, &maxsize);      // total size   4 byte
+        datasize += POVMSStream_WriteInt(mode, stream + datasize, &maxsize);           // flags        4 byte
+        datasize += POVMSStream_WriteInt(objectcnt, stream + datasize, &maxsize);      // objects      4 byte
+        datasize += POVMSStream_WriteInt(msgsize, stream + datasize, &maxsize);        // object size  4 byte
+        datasize += POVMSStream_Write(msg, stream + datasize, &maxsize);               // message      x byte
+        if (result != POVMS_NULLPTR)
+        {
+            datasize += POVMSStream_WriteInt(resultsize, stream + datasize, &maxsize); // object size  4 byte
+            datasize += POVMSStream_Write(result, stream + datasize, &maxsize);        // result       x byte
+        }
+    }
+
+    *totalsizeptr = totalsize;
+
+    return stream;
+}
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*   POVMS_AppendToBatch
+*
+* DESCRIPTION
+*   Appends a message stream to the batch for the given destination,
+*   delivering the batch if it is due.
+*
+* CHANGES
+*   -
+*
+******************************************************************************/
+
+POVMSResult POVMS_AppendToBatch(POVMSAddress addr, POVMSStream *stream, int streamsize)
+{
+    std::lock_guard<std::mutex> lock(gPOVMSBatches.mutex);
+    POVMSBatch *batch = POVMS_NULLPTR;
+    POVMSResult err = kNoErr;
+
+    for(std::vector<POVMSBatch>::iterator i = gPOVMSBatches.batches.begin(); i != gPOVMSBatches.batches.end(); i++)
+    {
+        if(i->addr == addr)
+        {
+            batch = &(*i);
+            break;
+        }
+    }
+
+    if (batch == POVMS_NULLPTR)
+    {
+        POVMSBatch newbatch;
+
+        newbatch.addr = addr;
+        newbatch.data = POVMS_NULLPTR;
+        newbatch.size = kPOVMSBatchHeaderSize;
+        newbatch.capacity = 0;
+        newbatch.count = 0;
+        newbatch.started = std::chrono::steady_clock::now();
+
+        gPOVMSBatches.batches.push_back(newbatch);
+        gPOVMSBatches.pending = (int)gPOVMSBatches.batches.size();
+        batch = &gPOVMSBatches.batches.back();
+    }
+
+    if (batch->size + kPOVMSStreamIntSize + streamsize > batch->capacity)
+    {
+        int capacity = std::max(std::max(batch->capacity * 2, 4096), batch->size + kPOVMSStreamIntSize + streamsize);
+        POVMSStream *data = (POVMSStream *)POVMS_Sys_Realloc(batch->data, capacity);
+
+        if (data == POVMS_NULLPTR)
+            return kMemFullErr;
+
+        batch->data = data;
+        batch->capacity = capacity;
+    }
+
+    int maxsize = batch->capacity - batch->size;
+    batch->size += POVMSStream_WriteInt(streamsize, batch->data + batch->size, &maxsize);   // message size 4 byte
+    POVMS_Sys_Memmove(batch->data + batch->size, stream, streamsize);                        // message      x byte
+    batch->size += streamsize;
+    batch->count++;
+
+    if ((batch->size >= kPOVMSBatchMaxSize) ||
+        (std::chrono::steady_clock::now() - batch->started >= std::chrono::milliseconds(kPOVMSBatchMaxDelay)))
+    {
+        err = POVMS_DeliverBatch(*batch);
+        *batch = gPOVMSBatches.batches.back();
+        gPOVMSBatches.batches.pop_back();
+        gPOVMSBatches.pending = (int)gPOVMSBatches.batches.size();
+    }
+
+    return err;
+}
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*   POVMS_FlushBatch
+*
+* DESCRIPTION
+*   Delivers the messages held back for the given destination, if any.
+*
+* CHANGES
+*   -
+*
+******************************************************************************/
+
+POVMSResult POVMS_FlushBatch(POVMSAddress addr)
+{
+    if (gPOVMSBatches.pending == 0)
+        return kNoErr;
+
+    std::lock_guard<std::mutex> lock(gPOVMSBatches.mutex);
+
+    for(std::vector<POVMSBatch>::iterator i = gPOVMSBatches.batches.begin(); i != gPOVMSBatches.batches.end(); i++)
+    {
+        if(i->addr == addr)
+        {
+            POVMSResult err = POVMS_DeliverBatch(*i);
+            *i = gPOVMSBatches.batches.back();
+            gPOVMSBatches.batches.pop_back();
+            gPOVMSBatches.pending = (int)gPOVMSBatches.batches.size();
+            return err;
+        }
+    }
+
+    return kNoErr;
+}
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*   POVMS_DiscardBatch
+*
+* DESCRIPTION
+*   Drops the messages held back for the given destination, if any, as the
+*   destination is about to go away.
+*
+* CHANGES
+*   -
+*
+******************************************************************************/
+
+void POVMS_DiscardBatch(POVMSAddress addr)
+{
+    if (gPOVMSBatches.pending == 0)
+        return;
+
+    std::lock_guard<std::mutex> lock(gPOVMSBatches.mutex);
+
+    for(std::vector<POVMSBatch>::iterator i = gPOVMSBatches.batches.begin(); i != gPOVMSBatches.batches.end(); i++)
+    {
+        if(i->addr == addr)
+        {
+            POVMS_Sys_Free(i->data);
+            *i = gPOVMSBatches.batches.back();
+            gPOVMSBatches.batches.pop_back();
+            gPOVMSBatches.pending = (int)gPOVMSBatches.batches.size();
+            return;
+        }
+    }
+}
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*   POVMS_DeliverBatch
+*
+* DESCRIPTION
+*   Completes the header of a batch and hands it to the destination queue,
+*   which takes ownership of its data.  Must be called with the batch mutex
+*   held.
+*
+* CHANGES
+*   -
+*
+******************************************************************************/
+
+POVMSResult POVMS_DeliverBatch(POVMSBatch& batch)
+{
+    int maxsize = kPOVMSBatchHeaderSize;
+    int datasize = 0;
+
+    if (batch.data == POVMS_NULLPTR)
+        return kNoErr;
+
+    datasize += POVMSStream_WriteString("POVRAYMB", batch.data, &maxsize);                 // header       8 byte
+    datasize += POVMSStream_WriteInt(POVMS_VERSION, batch.data + datasize, &maxsize);      // version      4 byte
+    datasize += POVMSStream_WriteInt(batch.size, batch.data + datasize, &maxsize);         // total size   4 byte
+    datasize += POVMSStream_WriteInt(batch.count, batch.data + datasize, &maxsize);        // messages     4 byte
+
+    if(POVMS_Sys_QueueSend(POVMS_Sys_AddressToQueue(batch.addr), batch.data, batch.size) != kPOVMSQueueNoErr)
+    {
+        POVMS_Sys_Free(batch.data);
+        batch.data = POVMS_NULLPTR;
+        return kQueueFullErr; // TODO FIXME - queue may have failed for other reasons
+    }
+
+    batch.data = POVMS_NULLPTR;
+
+    return kNoErr;
+}
+
+
 /*****************************************************************************
 *
 * FUNCTION
@@ -4695,6 +5176,175 @@ int POVMS_Sys_AddressToStreamSize_Default(POVMSAddress)
     return (2 + sizeof(POVMSAddress));
 }
 
+/*****************************************************************************
+* POVMS memory pool functions
+******************************************************************************/
+
+// Note: Messages are mostly built, streamed and destroyed by one thread, so
+// small blocks are recycled through per-thread free lists without locking.
+// Each block is preceded by a header recording its size class.
+
+static const unsigned int kPOVMSPoolClassCount  = 6;    // 16, 32, 64, 128, 256 and 512 bytes
+static const size_t kPOVMSPoolMinSize           = 16;
+static const size_t kPOVMSPoolMaxSize           = kPOVMSPoolMinSize << (kPOVMSPoolClassCount - 1);
+static const int kPOVMSPoolMaxCached            = 256;  // per thread and size class
+static const unsigned int kPOVMSPoolUnpooled    = kPOVMSPoolClassCount;
+static const size_t kPOVMSPoolHeaderSize        = 16;   // keeps blocks 16-byte aligned
+
+struct POVMSPoolHeader
+{
+    union
+    {
+        POVMSPoolHeader *next;  // next free block of the same size class
+        size_t size;            // size of a block too large to be pooled
+    };
+    unsigned int sizeclass;
+};
+
+static_assert(sizeof(POVMSPoolHeader) <= kPOVMSPoolHeaderSize, "POVMS pool header too large");
+
+struct POVMSPoolCache
+{
+    POVMSPoolHeader *freelist[kPOVMSPoolClassCount];
+    int count[kPOVMSPoolClassCount];
+
+    POVMSPoolCache();
+    ~POVMSPoolCache();
+};
+
+static thread_local POVMSPoolCache gPOVMSPoolCache;
+static thread_local bool gPOVMSPoolCacheDestroyed = false; // blocks freed after thread exit go straight back to the system
+
+POVMSPoolCache::POVMSPoolCache()
+{
+    for(unsigned int i = 0; i < kPOVMSPoolClassCount; i++)
+    {
+        freelist[i] = POVMS_NULLPTR;
+        count[i] = 0;
+    }
+}
+
+POVMSPoolCache::~POVMSPoolCache()
+{
+    gPOVMSPoolCacheDestroyed = true;
+    for(unsigned int i = 0; i < kPOVMSPoolClassCount; i++)
+    {
+        while (freelist[i] != POVMS_NULLPTR)
+        {
+            POVMSPoolHeader *next = freelist[i]->next;
+            free((void *)freelist[i]);
+            freelist[i] = next;
+        }
+    }
+}
+
+static inline unsigned int POVMS_Pool_SizeClass(size_t size)
+{
+    unsigned int sizeclass = 0;
+
+    while((kPOVMSPoolMinSize << sizeclass) < size)
+        sizeclass++;
+
+    return sizeclass;
+}
+
+static inline size_t POVMS_Pool_Capacity(const POVMSPoolHeader *header)
+{
+    if (header->sizeclass == kPOVMSPoolUnpooled)
+        return header->size;
+    return kPOVMSPoolMinSize << header->sizeclass;
+}
+
+POVMS_EXPORT void * POVMS_CDECL POVMS_Pool_Malloc(size_t size)
+{
+    POVMSPoolHeader *header = POVMS_NULLPTR;
+
+    if ((size <= kPOVMSPoolMaxSize) && !gPOVMSPoolCacheDestroyed)
+    {
+        unsigned int sizeclass = POVMS_Pool_SizeClass(size);
+        POVMSPoolCache& cache = gPOVMSPoolCache;
+
+        header = cache.freelist[sizeclass];
+        if (header != POVMS_NULLPTR)
+        {
+            cache.freelist[sizeclass] = header->next;
+            cache.count[sizeclass]--;
+        }
+        else
+        {
+            header = (POVMSPoolHeader *)malloc(kPOVMSPoolHeaderSize + (kPOVMSPoolMinSize << sizeclass));
+            if (header == POVMS_NULLPTR)
+                return POVMS_NULLPTR;
+        }
+        header->sizeclass = sizeclass;
+    }
+    else
+    {
+        header = (POVMSPoolHeader *)malloc(kPOVMSPoolHeaderSize + size);
+        if (header == POVMS_NULLPTR)
+            return POVMS_NULLPTR;
+        header->sizeclass = kPOVMSPoolUnpooled;
+        header->size = size;
+    }
+
+    return (void *)(((char *)header) + kPOVMSPoolHeaderSize);
+}
+
+POVMS_EXPORT void * POVMS_CDECL POVMS_Pool_Realloc(void *ptr, size_t size)
+{
+    if (ptr == POVMS_NULLPTR)
+        return POVMS_Pool_Malloc(size);
+
+    POVMSPoolHeader *header = (POVMSPoolHeader *)(((char *)ptr) - kPOVMSPoolHeaderSize);
+    size_t capacity = POVMS_Pool_Capacity(header);
+
+    if ((header->sizeclass != kPOVMSPoolUnpooled) && (size <= capacity))
+        return ptr;
+
+    if ((header->sizeclass == kPOVMSPoolUnpooled) && (size > kPOVMSPoolMaxSize))
+    {
+        header = (POVMSPoolHeader *)realloc((void *)header, kPOVMSPoolHeaderSize + size);
+        if (header == POVMS_NULLPTR)
+            return POVMS_NULLPTR;
+        header->size = size;
+        return (void *)(((char *)header) + kPOVMSPoolHeaderSize);
+    }
+
+    void *newptr = POVMS_Pool_Malloc(size);
+    if (newptr == POVMS_NULLPTR)
+        return POVMS_NULLPTR;
+    POVMS_Sys_Memmove(newptr, ptr, std::min(size, capacity));
+    POVMS_Pool_Free(ptr);
+
+    return newptr;
+}
+
+POVMS_EXPORT void POVMS_CDECL POVMS_Pool_Free(void *ptr)
+{
+    if (ptr == POVMS_NULLPTR)
+        return;
+
+    POVMSPoolHeader *header = (POVMSPoolHeader *)(((char *)ptr) - kPOVMSPoolHeaderSize);
+    unsigned int sizeclass = header->sizeclass;
+
+    if ((sizeclass != kPOVMSPoolUnpooled) && !gPOVMSPoolCacheDestroyed)
+    {
+        POVMSPoolCache& cache = gPOVMSPoolCache;
+
+        // blocks freed by another thread than the one that allocated them may pile up here
+        if (cache.count[sizeclass] < kPOVMSPoolMaxCached)
+        {
+            header->next = cache.freelist[sizeclass];
+            cache.freelist[sizeclass] = header;
+            cache.count[sizeclass]++;
+            return;
+        }
+    }
+
+    free((void *)header);
+}
+
+
 /*****************************************************************************
 * POVMS memory debugging functions
 ******************************************************************************/
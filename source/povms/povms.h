@@ -292,16 +292,17 @@
 
 // Note: Remember that the POVMS cannot use the standard
 // POV_MALLOC, POV_REALLOC, POV_FREE calls!
+// Note: By default, small blocks are recycled through per-thread pools.
 #ifndef POVMS_Sys_Malloc
-    #define POVMS_Sys_Malloc(s)           malloc(s)
+    #define POVMS_Sys_Malloc(s)           POVMS_Pool_Malloc(s)
 #endif
 
 #ifndef POVMS_Sys_Realloc
-    #define POVMS_Sys_Realloc(p,s)        realloc(p,s)
+    #define POVMS_Sys_Realloc(p,s)        POVMS_Pool_Realloc(p,s)
 #endif
 
 #ifndef POVMS_Sys_Free
-    #define POVMS_Sys_Free(p)             free(p)
+    #define POVMS_Sys_Free(p)             POVMS_Pool_Free(p)
 #endif
 
 #undef POVMS_VERSION
@@ -422,6 +423,8 @@ POVMS_EXPORT POVMSResult POVMS_CDECL POVMS_Receive          (POVMSContext contex
 
 // Message send functions
 POVMS_EXPORT POVMSResult POVMS_CDECL POVMS_Send             (POVMSContext contextref, POVMSObjectPtr msg, POVMSObjectPtr result, int mode);
+POVMS_EXPORT POVMSResult POVMS_CDECL POVMS_SendBatched      (POVMSContext contextref, POVMSObjectPtr msg);
+POVMS_EXPORT POVMSResult POVMS_CDECL POVMS_FlushBatches     ();
 
 // Message data functions
 POVMS_EXPORT POVMSResult POVMS_CDECL POVMSMsg_SetupMessage          (POVMSObjectPtr object, POVMSType msgclass, POVMSType msgid);
@@ -499,6 +502,11 @@ POVMS_EXPORT POVMSResult POVMS_CDECL POVMSUtil_GetType      (POVMSObjectPtr obje
 POVMS_EXPORT POVMSResult POVMS_CDECL POVMSUtil_TempAlloc    (void **ptr, int datasize);
 POVMS_EXPORT POVMSResult POVMS_CDECL POVMSUtil_TempFree     (void *ptr);
 
+// Memory pool functions
+POVMS_EXPORT void * POVMS_CDECL POVMS_Pool_Malloc           (size_t size);
+POVMS_EXPORT void * POVMS_CDECL POVMS_Pool_Realloc          (void *ptr, size_t size);
+POVMS_EXPORT void POVMS_CDECL POVMS_Pool_Free               (void *ptr);
+
 // Memory debug functions
 #ifdef _DEBUG_POVMS_TRACE_MEMORY_
 POVMS_EXPORT POVMSResult POVMS_TraceDump                    ();
@@ -1890,3 +1890,30 @@ void POVMS_SendMessage(POVMSContext contextref, POVMS_Message& msg, POVMS_Messag
 
     msg.DetachData();
 }
+
+
+/*****************************************************************************
+*
+* FUNCTION
+*   POVMS_SendMessageBatched
+*
+* DESCRIPTION
+*   POVMS_SendMessageBatched same as POVMS_SendBatched in povms.cpp, but
+*   takes a POVMS_Message object as argument. The context is optional.
+*
+* CHANGES
+*   -
+*
+******************************************************************************/
+
+void POVMS_SendMessageBatched(POVMSContext contextref, POVMS_Message& msg)
+{
+    int err;
+
+    err = POVMS_SendBatched(contextref, &msg.data);
+
+    if(err != pov_base::kNoErr)
+        throw POV_EXCEPTION_CODE(err);
+
+    msg.DetachData();
+}
@@ -63,6 +63,7 @@ class POVMS_Container
 {
         friend void POVMS_SendMessage(POVMS_Message&);
         friend void POVMS_SendMessage(POVMSContext, POVMS_Message&, POVMS_Message *, int);
+        friend void POVMS_SendMessageBatched(POVMSContext, POVMS_Message&);
         friend class POVMS_List;
         friend class POVMS_Object;
         friend class POVMS_MessageReceiver;
@@ -500,5 +501,6 @@ class POVMS_MessageReceiver
 
 void POVMS_SendMessage(POVMS_Message& msg);
 void POVMS_SendMessage(POVMSContext contextref, POVMS_Message& msg, POVMS_Message *result, int mode);
+void POVMS_SendMessageBatched(POVMSContext contextref, POVMS_Message& msg);
 
 #endif
@@ -146,8 +146,12 @@ enum
 {
     kPOVObjectClass_Rectangle           = 'Rect',
     kPOVObjectClass_ElapsedTime         = 'ETim',
+    kPOVObjectClass_EventCounts         = 'ECnt',
 
     kPOVObjectClass_IsectStat           = 'ISta',
+    kPOVObjectClass_FunctionStat        = 'FSta',
+    kPOVObjectClass_ObjectProfileStat   = 'OSta',
+    kPOVObjectClass_MemoryStat          = 'MSta',
     kPOVObjectClass_SceneCamera         = 'SCam',
 
     kPOVObjectClass_ShellCommand        = 'SCmd',
@@ -263,6 +267,7 @@ enum
 
     kPOVAttrib_PlatformData          = 'PlaD',
     kPOVAttrib_MaxRenderThreads      = 'MRTh',
+    kPOVAttrib_ThreadAffinity        = 'TAff',
     kPOVAttrib_SceneCamera           = 'SCam',
 
     // universal use
@@ -286,6 +291,7 @@ enum
     kPOVAttrib_Optimizations         = 'Opti',
     kPOVAttrib_CPUInfo               = 'CPUI',
     kPOVAttrib_CPUInfoDetails        = 'CPUD',
+    kPOVAttrib_NoiseGenerator        = 'NGen',
 
     // options handled by frontend
     kPOVAttrib_TestAbort             = 'TstA', // currently not supported by code
@@ -294,6 +300,7 @@ enum
 
     kPOVAttrib_ContinueTrace         = 'ConT',
     kPOVAttrib_BackupTrace           = 'BacT',
+    kPOVAttrib_CheckpointInterval    = 'CkIv',
 
     kPOVAttrib_Verbose               = 'Verb',
     kPOVAttrib_DebugConsole          = 'DCon',
@@ -309,6 +316,8 @@ enum
     kPOVAttrib_WarningFile           = 'WFNa',
     kPOVAttrib_AllFile               = 'AFNa',
     kPOVAttrib_AppendConsoleFiles    = 'ACFi',
+    kPOVAttrib_ResultsFile           = 'RsFi',
+    kPOVAttrib_ProgressFile          = 'PrFi',
 
     kPOVAttrib_Display               = 'Disp',
     kPOVAttrib_VideoMode             = 'VMod', // currently not supported by code
@@ -334,6 +343,9 @@ enum
     kPOVAttrib_FieldRender           = 'FldR', // currently not supported by code
     kPOVAttrib_OddField              = 'OddF', // currently not supported by code
     kPOVAttrib_FrameStep             = 'FStp',
+    kPOVAttrib_FramesInFlight        = 'FIFl',
+    kPOVAttrib_JobList               = 'JobL',
+    kPOVAttrib_ConcurrentJobs        = 'CJob',
 
     kPOVAttrib_OutputToFile          = 'OToF',
     kPOVAttrib_OutputFileType        = 'OFTy',
@@ -343,6 +355,9 @@ enum
     kPOVAttrib_OutputFile            = 'OFNa',
     kPOVAttrib_OutputPath            = 'OPat',
     kPOVAttrib_Compression           = 'OFCo',
+    kPOVAttrib_OutputStreaming       = 'OStr',
+    kPOVAttrib_HalfPrecisionBuffer   = 'OHPB',
+    kPOVAttrib_OutputQueueLength     = 'OQLn',
 
     kPOVAttrib_HistogramFileType     = 'HFTy', // currently not supported by code
     kPOVAttrib_HistogramFile         = 'HFNa', // currently not supported by code
@@ -369,7 +384,9 @@ enum
     kPOVAttrib_WarningLevel          = 'WLev',
     kPOVAttrib_Declare               = 'Decl',
     kPOVAttrib_Clock                 = 'Clck',
+    kPOVAttrib_FrameNumber           = 'FrNo',
     kPOVAttrib_ClocklessAnimation    = 'Ckla',
+    kPOVAttrib_MultiCamera           = 'MCam',
     kPOVAttrib_RealTimeRaytracing    = 'RTRa',
     kPOVAttrib_Version               = 'Vers',
 
@@ -391,22 +408,52 @@ enum
     kPOVAttrib_JitterAmount          = 'AAJA',
     kPOVAttrib_AntialiasGamma        = 'AAGa',
     kPOVAttrib_AntialiasGammaType    = 'AAGT', // currently not supported by code
+    kPOVAttrib_AntialiasGlobal       = 'AAGl',
     kPOVAttrib_Quality               = 'Qual',
     kPOVAttrib_HighReproducibility   = 'HRep',
+    kPOVAttrib_FunctionProfile       = 'FPrf',
     kPOVAttrib_StochasticSeed        = 'Seed',
+    kPOVAttrib_ProgressiveTimeBudget = 'PTBu',
+    kPOVAttrib_Denoise               = 'Dnoi',
+    kPOVAttrib_DenoiseStrength       = 'DnSt',
+    kPOVAttrib_CostMap               = 'CMap',
+    kPOVAttrib_PerformanceCounters   = 'PfCn',
+    kPOVAttrib_TimelineFile          = 'TLFi',
+    kPOVAttrib_WavefrontShading      = 'WvSh',
+    kPOVAttrib_ProjectionTable       = 'PrTb',
+    kPOVAttrib_AdaptiveFocalBlur     = 'AdFB',
+    kPOVAttrib_RussianRoulette       = 'RuRo',
+    kPOVAttrib_SecondaryRayBudget    = 'SRBu',
+    kPOVAttrib_ObjectProfile         = 'OPrf',
+    kPOVAttrib_SharedFramebuffer     = 'ShFB',  ///< (Bool) Pass pixels through a framebuffer shared by front-end and back-end if possible.
 
     kPOVAttrib_Bounding              = 'Boun',
     kPOVAttrib_BoundingMethod        = 'BdMe',
     kPOVAttrib_BoundingThreshold     = 'BdTh',
+    kPOVAttrib_BoundingCacheFile     = 'BdCF',
+    kPOVAttrib_PrepareBundle         = 'PBnd',
+    kPOVAttrib_RenderFromBundle      = 'RBnd',
+    kPOVAttrib_BoundingSlabsCompact  = 'BdSC',
+    kPOVAttrib_BoundingAnalysis      = 'BdAn',
     kPOVAttrib_BSP_MaxDepth          = 'BspD',
     kPOVAttrib_BSP_ISectCost         = 'BspI',
     kPOVAttrib_BSP_BaseAccessCost    = 'BspB',
     kPOVAttrib_BSP_ChildAccessCost   = 'BspC',
     kPOVAttrib_BSP_MissChance        = 'BspM',
+    kPOVAttrib_BVH_Width             = 'BvhW',
+    kPOVAttrib_BVH_PacketSize        = 'BvhP',
+    kPOVAttrib_BVH_RefitThreshold    = 'BvhR',
     kPOVAttrib_LightBuffer           = 'LBuf', // currently not supported by code
+    kPOVAttrib_LightThreshold        = 'LtTh',
     kPOVAttrib_VistaBuffer           = 'VBuf', // currently not supported by code
     kPOVAttrib_RemoveBounds          = 'RmBd',
     kPOVAttrib_SplitUnions           = 'SplU',
+    kPOVAttrib_MergeTriangles        = 'MrgT',
+    kPOVAttrib_ReuseDeclarations     = 'RuDe',
+    kPOVAttrib_MeshCachePath         = 'MeCP',
+    kPOVAttrib_ParseProfileFile      = 'PaPF',
+    kPOVAttrib_DeferImageDecoding    = 'DfID',
+    kPOVAttrib_IncrementalRenderFile = 'InRF',
 
     kPOVAttrib_CreateHistogram       = 'CHis', // currently not supported by code
     kPOVAttrib_DrawVistas            = 'DrVi', // currently not supported by code
@@ -414,14 +461,24 @@ enum
     kPOVAttrib_PreviewStartSize      = 'PStS',
     kPOVAttrib_PreviewEndSize        = 'PEnS',
 
+    kPOVAttrib_RadiosityFileBinary   = 'RaFB',
     kPOVAttrib_RadiosityFileName     = 'RaFN',
     kPOVAttrib_RadiosityFromFile     = 'RaFF',
+    kPOVAttrib_RadiosityIncremental  = 'RaIn',
     kPOVAttrib_RadiosityToFile       = 'RaTF',
     kPOVAttrib_RadiosityVainPretrace = 'RaVP',
 
+    kPOVAttrib_PhotonSlice           = 'PhSl',
+    kPOVAttrib_PhotonSlices          = 'PhSs',
+    kPOVAttrib_PhotonMergeSlices     = 'PhMS',
+
     kPOVAttrib_RenderBlockSize       = 'RBSi',
 
     kPOVAttrib_MaxImageBufferMem     = 'MIBM', // [JG] for file backed image
+    kPOVAttrib_MaxImageMapMem        = 'MIMM',
+    kPOVAttrib_MemoryLimit           = 'MeLi',  ///< (Int) Limit on the memory accounted for all subsystems, in megabytes; 0 for none.
+    kPOVAttrib_MeshMemoryBudget      = 'MMBu',  ///< (Int) Budget for memory-mapped mesh data, in megabytes; 0 for none.
+    kPOVAttrib_ImageCacheSize        = 'ICSz',  ///< (Int) Memory held by decoded images kept for later parses, in megabytes; 0 for none.
 
     kPOVAttrib_CameraIndex           = 'CIdx',
 
@@ -436,6 +493,8 @@ enum
     kPOVAttrib_PhotonTime            = 'PhoT',
     kPOVAttrib_RadiosityTime         = 'RadT',
     kPOVAttrib_TraceTime             = 'TraT',
+    kPOVAttrib_SurfacePhotonBuildTime = 'PSBT',
+    kPOVAttrib_MediaPhotonBuildTime  = 'PMBT',
 
     // statistics generated by frontend
     kPOVAttrib_CurrentFrame          = 'CurF',
@@ -450,6 +509,16 @@ enum
     kPOVAttrib_InfiniteObjects       = 'InOb',
     kPOVAttrib_LightSources          = 'LiSo',
     kPOVAttrib_Cameras               = 'Cama',
+    kPOVAttrib_MeshImportTriangles   = 'MITr',
+    kPOVAttrib_MeshImportTime        = 'MITi',
+    kPOVAttrib_SymbolLookups         = 'SyLo',
+    kPOVAttrib_SymbolProbes          = 'SyPr',
+    kPOVAttrib_DeclarationsReused    = 'DeRu',
+    kPOVAttrib_DeclarationsEvaluated = 'DeEv',
+    kPOVAttrib_MeshCacheHits         = 'MeCH',
+    kPOVAttrib_MeshCacheWrites       = 'MeCW',
+    kPOVAttrib_HeightFieldPoints     = 'HFPo',
+    kPOVAttrib_HeightFieldTime       = 'HFTi',
 
     // statistics generated by scene/bounding
     kPOVAttrib_BSPNodes              = 'BNod',
@@ -463,18 +532,30 @@ enum
     kPOVAttrib_BSPAborts             = 'BAbo',
     kPOVAttrib_BSPAverageAborts      = 'BAAb',
     kPOVAttrib_BSPAverageAbortObjects = 'BAAO',
+    kPOVAttrib_BSPDepthTimes         = 'BDTi',
+    kPOVAttrib_BoundingCacheHit      = 'BdCH',
+    kPOVAttrib_BoundingCacheRefit    = 'BdCR',
+    kPOVAttrib_BVHNodes              = 'VhNo',
+    kPOVAttrib_BVHLeafNodes          = 'VhLN',
+    kPOVAttrib_BVHMaxObjects         = 'VhMO',
+    kPOVAttrib_BVHAverageObjects     = 'VhAO',
+    kPOVAttrib_BVHMaxDepth           = 'VhMD',
+    kPOVAttrib_BVHAverageDepth       = 'VhAD',
 
     // statistics generated by view/render (radiosity)
     kPOVAttrib_RadGatherCount        = 'RGCt',
     kPOVAttrib_RadUnsavedCount       = 'RUCo',
     kPOVAttrib_RadReuseCount         = 'RRCt',
     kPOVAttrib_RadRayCount           = 'RYCt',
+    kPOVAttrib_RadRaysSaved          = 'RYSt',
     kPOVAttrib_RadTopLevelGatherCount= 'RGCT',
     kPOVAttrib_RadTopLevelReuseCount = 'RRCT',
     kPOVAttrib_RadTopLevelRayCount   = 'RYCT',
+    kPOVAttrib_RadTopLevelRaysSaved  = 'RYST',
     kPOVAttrib_RadFinalGatherCount   = 'RGCF',
     kPOVAttrib_RadFinalReuseCount    = 'RRCF',
     kPOVAttrib_RadFinalRayCount      = 'RYCF',
+    kPOVAttrib_RadFinalRaysSaved     = 'RYSF',
     kPOVAttrib_RadOctreeNodes        = 'ROcN',
     kPOVAttrib_RadOctreeLookups      = 'ROcL',
     kPOVAttrib_RadOctreeAccepts0     = 'ROc0',
@@ -483,6 +564,11 @@ enum
     kPOVAttrib_RadOctreeAccepts3     = 'ROc3',
     kPOVAttrib_RadOctreeAccepts4     = 'ROc4',
     kPOVAttrib_RadOctreeAccepts5     = 'ROc5',
+    kPOVAttrib_RadOctreeRetries      = 'ROcR',
+    kPOVAttrib_RadLockWaitTime       = 'RLkW',
+    kPOVAttrib_RadRecentHits         = 'RRcH',
+    kPOVAttrib_RadIncrementalReused  = 'RIcR',
+    kPOVAttrib_RadIncrementalDiscarded = 'RIcD',
     // [CLi] per-pass per-recursion sample count statistics
     // (Note: Do not change the IDs of any of these "just for fun"; at several places they are computed from the first one)
     kPOVAttrib_RadSamplesP1R0        = 'RS10',
@@ -515,6 +601,20 @@ enum
     kPOVAttrib_RadSamplesFR2         = 'RSF2',
     kPOVAttrib_RadSamplesFR3         = 'RSF3',
     kPOVAttrib_RadSamplesFR4ff       = 'RSF4',
+    // per-pass ray count statistics
+    // (Note: Do not change the IDs of any of these "just for fun"; at several places they are computed from the first one)
+    kPOVAttrib_RadRayCountP1         = 'RY1s',
+    kPOVAttrib_RadRayCountP2         = 'RY2s',
+    kPOVAttrib_RadRayCountP3         = 'RY3s',
+    kPOVAttrib_RadRayCountP4         = 'RY4s',
+    kPOVAttrib_RadRayCountP5ff       = 'RY5s',
+    kPOVAttrib_RadRayCountF          = 'RYFs',
+    kPOVAttrib_RadRaysSavedP1        = 'RY1v',
+    kPOVAttrib_RadRaysSavedP2        = 'RY2v',
+    kPOVAttrib_RadRaysSavedP3        = 'RY3v',
+    kPOVAttrib_RadRaysSavedP4        = 'RY4v',
+    kPOVAttrib_RadRaysSavedP5ff      = 'RY5v',
+    kPOVAttrib_RadRaysSavedF         = 'RYFv',
     kPOVAttrib_RadWeightR0           = 'RWt0',
     kPOVAttrib_RadWeightR1           = 'RWt1',
     kPOVAttrib_RadWeightR2           = 'RWt2',
@@ -556,6 +656,18 @@ enum
     kPOVAttrib_ShadowTest            = 'ShdT',
     kPOVAttrib_ShadowTestSuc         = 'ShdS',
     kPOVAttrib_ShadowCacheHits       = 'ShdC',
+    kPOVAttrib_ShadowCacheTests      = 'ShdO',
+
+    kPOVAttrib_RouletteTerminated1   = 'RRT1',
+    kPOVAttrib_RouletteTerminated2   = 'RRT2',
+    kPOVAttrib_RouletteTerminated3   = 'RRT3',
+    kPOVAttrib_RouletteTerminated4   = 'RRT4',
+    kPOVAttrib_RouletteTerminated5   = 'RRT5',
+    kPOVAttrib_RayBudgetExhausted    = 'RBEx',
+
+    kPOVAttrib_MeshPageIns           = 'MPgI',
+    kPOVAttrib_MeshPageInTime        = 'MPgT',
+    kPOVAttrib_MeshPageEvictions     = 'MPgE',
 
     kPOVAttrib_PolynomTest           = 'PnmT',
     kPOVAttrib_RootsEliminated       = 'REli',
@@ -573,20 +685,41 @@ enum
 
     kPOVAttrib_IsoFindRoot           = 'IFRo',
     kPOVAttrib_FunctionVMCalls       = 'FVMC',
+    kPOVAttrib_FunctionVMNativeCalls = 'FVMN',
+    kPOVAttrib_FunctionVMBatchCalls  = 'FVMB',
     kPOVAttrib_FunctionVMInstrEst    = 'FVMI',
 
     kPOVAttrib_CrackleCacheTest      = 'CrCT',
     kPOVAttrib_CrackleCacheTestSuc   = 'CrCS',
+    kPOVAttrib_CrackleCacheEvict     = 'CrCE',
+
+    kPOVAttrib_WarpChains            = 'WrpC',
+    kPOVAttrib_WarpTime              = 'WrpT',
 
     kPOVAttrib_ObjectIStats          = 'OISt',
     kPOVAttrib_ISectsTests           = 'ITst',
     kPOVAttrib_ISectsSucceeded       = 'ISuc',
 
+    kPOVAttrib_FunctionProfileStats  = 'FPSt',
+    kPOVAttrib_FunctionCalls         = 'FPCa',
+    kPOVAttrib_FunctionInstructions  = 'FPIn',
+    kPOVAttrib_FunctionTime          = 'FPTi',
+
+    kPOVAttrib_ObjectProfileStats    = 'OPSt',
+    kPOVAttrib_ObjectProfileTime     = 'OPTi',
+
+    kPOVAttrib_TaskQueueTasks        = 'TQTa',
+    kPOVAttrib_TaskQueueLatency      = 'TQLa',
+    kPOVAttrib_TaskQueueSyncWaits    = 'TQSW',
+    kPOVAttrib_TaskQueueSyncWaitTime = 'TQST',
+
     kPOVAttrib_MinAlloc              = 'MinA',
     kPOVAttrib_MaxAlloc              = 'MaxA',
     kPOVAttrib_CallsToAlloc          = 'CTAl',
     kPOVAttrib_CallsToFree           = 'CTFr',
     kPOVAttrib_PeakMemoryUsage       = 'PMUs',
+    kPOVAttrib_CurrentMemoryUsage    = 'CMUs',  ///< (Long) Memory currently accounted for all subsystems, in bytes.
+    kPOVAttrib_SubsystemMemory       = 'SMem',  ///< (List of @ref kPOVObjectClass_MemoryStat) Memory accounted per subsystem.
 
     // subject to elimination
     kPOVAttrib_BoundingQueues        = 'BQue',
@@ -600,6 +733,12 @@ enum
     kPOVAttrib_RealTime              = 'ReaT',
     kPOVAttrib_CPUTime               = 'CPUT',
     kPOVAttrib_TimeSamples           = 'TSam',
+    kPOVAttrib_TailTime              = 'TaiT',  ///< (Long) Wall-clock time between the first and the last thread of a phase finishing, in milliseconds.
+    kPOVAttrib_Cycles                = 'Cycl',  ///< (Long) CPU cycles counted by the hardware performance counters.
+    kPOVAttrib_Instructions          = 'Inst',  ///< (Long) Instructions retired.
+    kPOVAttrib_CacheMisses           = 'CaMi',  ///< (Long) Last level cache misses.
+    kPOVAttrib_BranchMisses          = 'BrMi',  ///< (Long) Mispredicted branches.
+    kPOVAttrib_ThreadEvents          = 'ThEv',  ///< (List of @ref kPOVObjectClass_EventCounts) Hardware events counted per thread.
 
     // parser progress
     kPOVAttrib_CurrentTokenCount     = 'CTCo',
@@ -621,7 +760,12 @@ enum
     kPOVAttrib_PixelColors           = 'PCol',
     kPOVAttrib_PixelPositions        = 'PPos',
     kPOVAttrib_PixelSkipList         = 'PSLi',
+    kPOVAttrib_SampleStatistics      = 'SStt',  ///< (Float vector) Samples accumulated per pixel in progressive mode; (List) in render options.
+    kPOVAttrib_SamplePass            = 'SPas',  ///< (Int) Progressive pass the sample statistics were sent in.
+    kPOVAttrib_PixelFeatures         = 'PFea',  ///< (Float vector) Albedo (RGB), normal (XYZ) and depth (-1 if no hit) per pixel, for denoising.
+    kPOVAttrib_PixelCosts            = 'PCos',  ///< (Float vector) Wall time in seconds spent computing each pixel, for the cost map.
     kPOVAttrib_PixelFinal            = 'PFin',  ///< (Void) Set if pixel data is relevant for final image.
+    kPOVAttrib_SharedFramebufferId   = 'ShFI',  ///< (Int) ID of the shared framebuffer the pixel data has been stored in, instead of being sent.
 
     // scene/view error reporting and TBD
     kPOVAttrib_CurrentLine           = 'CurL',
@@ -644,6 +788,8 @@ enum
 
     // Rendering order
     kPOVAttrib_RenderBlockStep       = 'RBSt',
+    kPOVAttrib_RenderBlockWorker     = 'RBWk',
+    kPOVAttrib_RenderBlockWorkers    = 'RBWs',
     kPOVAttrib_RenderPattern         = 'RPat',
 
     // helpers
@@ -60,9 +60,33 @@
     #define SYS_MATH_RETURN double
 #endif
 
+/// @def TRY_OPTIMIZED_FUNCTIONS
+/// Whether the platform provides a native code compiler for user-defined functions.
+///
+/// Define if the platform can translate function VM programs into native machine code at parse
+/// time. Functions that cannot be translated are still run by the interpreter. Leave undefined
+/// otherwise.
+///
+/// @note
+///     If this macro is defined, the platform must implement the functions
+///     @ref pov::POVFPU_CompileNative(), @ref pov::POVFPU_ReleaseNative() and
+///     @ref pov::POVFPU_RunNative() as declared in @ref vm/fnpovfpu.h.
+///
+#ifndef TRY_OPTIMIZED_FUNCTIONS
+    // leave undefined
+    #ifdef DOXYGEN
+        // Doxygen cannot document undefined macros.
+        #define TRY_OPTIMIZED_FUNCTIONS
+    #endif
+#endif
+
 // Function that executes functions, the parameter is the function index
 #ifndef POVFPU_Run
-    #define POVFPU_Run(ctx, fn) POVFPU_RunDefault(ctx, fn)
+    #ifdef TRY_OPTIMIZED_FUNCTIONS
+        #define POVFPU_Run(ctx, fn) POVFPU_RunOptimized(ctx, fn)
+    #else
+        #define POVFPU_Run(ctx, fn) POVFPU_RunDefault(ctx, fn)
+    #endif
 #endif
 
 // Adjust to add system specific handling of functions like just-in-time compilation
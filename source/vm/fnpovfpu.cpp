@@ -239,6 +239,8 @@ Density of instruction set: 916 / 1024 = 0.8945
 
 // C++ standard header files
 #include <algorithm>
+#include <chrono>
+#include <string>
 
 // POV-Ray header files (base module)
 #include "base/mathutil.h"
@@ -689,6 +691,10 @@ void FunctionVM::Reset()
         if(i->reference_count > 0) // ignore the reference count [trf]
         {
             SYS_DELETE_FUNCTION(&(*i));
+#ifdef TRY_OPTIMIZED_FUNCTIONS
+            POVFPU_ReleaseNative(i->native);
+            i->native = nullptr;
+#endif
             FNCode_Delete(&(i->fn));
             i->reference_count = 0;
         }
@@ -1045,6 +1051,10 @@ FUNCTION FunctionVM::AddFunction(FunctionCode *f)
 
     functions[fn].fn = *f;
     functions[fn].reference_count = 1;
+#ifdef TRY_OPTIMIZED_FUNCTIONS
+    functions[fn].native = nullptr;
+    functions[fn].native = POVFPU_CompileNative(functions[fn].fn, fn, consts, functions);
+#endif
     SYS_ADD_FUNCTION(fn);
 
     return fn;
@@ -1095,6 +1105,10 @@ void FunctionVM::RemoveFunction(FUNCTION fn)
             unsigned int i = 0;
 
             SYS_DELETE_FUNCTION(&f);
+#ifdef TRY_OPTIMIZED_FUNCTIONS
+            POVFPU_ReleaseNative(f.native);
+            functions[fn].native = nullptr;
+#endif
             for(i = 0; i < f.fn.program_size; i++)
             {
                 if(GET_OP(f.fn.program[i]) == OPCODE_CALL)
@@ -1168,6 +1182,61 @@ void POVFPU_Exception(FPUContext *context, FUNCTION fn, const char *msg)
 }
 
 
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Function profiling helpers
+*
+* DESCRIPTION
+*
+*   Used by POVFPU_RunDefault if profiling is enabled for the thread, to charge
+*   the instructions executed and the time spent since the last checkpoint to
+*   the function they belong to whenever control passes from one function to
+*   another. Functions inlined by the compiler are part of their callers.
+*
+******************************************************************************/
+
+static POV_ULONG ProfileClock()
+{
+    return static_cast<POV_ULONG>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+static FunctionProfileData& ProfileEntry(FPUContext *context, FUNCTION fn)
+{
+    vector<FunctionProfileData>& profile(context->threaddata->functionProfile);
+
+    if (profile.size() <= fn)
+        profile.resize(fn + 1);
+
+    FunctionProfileData& entry = profile[fn];
+    if (entry.name.empty())
+    {
+        const CustomFunctionSourceInfo& info = context->functionvm->GetFunction(fn)->sourceInfo;
+        if (!info.name.empty())
+            entry.name = info.name;
+        else
+            entry.name = "unnamed (line " + std::to_string(info.position.line) + ")";
+    }
+    return entry;
+}
+
+static void ProfileCall(FPUContext *context, FUNCTION fn)
+{
+    ProfileEntry(context, fn).calls++;
+}
+
+static void ProfileCharge(FPUContext *context, FUNCTION fn, POV_ULONG& icount)
+{
+    POV_ULONG now = ProfileClock();
+    FunctionProfileData& entry = ProfileEntry(context, fn);
+
+    entry.instructions += icount;
+    entry.time += now - context->profiletime;
+    context->profiletime = now;
+    icount = 0;
+}
+
 /*****************************************************************************
 *
 * FUNCTION
@@ -1213,6 +1282,8 @@ DBL POVFPU_RunDefault(FPUContext *context, FUNCTION fn)
     unsigned int ccr = 0;
     unsigned int sp = 0;
     unsigned int psp = 0;
+    bool profiling = context->threaddata->functionProfiling;
+    POV_ULONG icount = 0; // instructions executed since the last profiling checkpoint
 
 #if (SUPPORT_INTEGER_INSTRUCTIONS == 1)
     POV_LONG iA, iB, itemp;
@@ -1229,10 +1300,17 @@ DBL POVFPU_RunDefault(FPUContext *context, FUNCTION fn)
 
     context->threaddata->Stats()[Ray_Function_VM_Calls]++;
 
+    if(profiling)
+    {
+        ProfileCall(context, fn);
+        context->profiletime = ProfileClock();
+    }
+
     program = functions[fn].fn.program;
 
     while(true)
     {
+        icount++;
         k = GET_K(program[pc]);
         switch(GET_OP(program[pc]))
         {
@@ -1330,6 +1408,8 @@ DBL POVFPU_RunDefault(FPUContext *context, FUNCTION fn)
                 pc = k;
                 continue; // prevent increment of pc
             OP_SPECIAL_CASE(15,0,2)                     // rts
+                if(profiling)
+                    ProfileCharge(context, fn, icount);
                 if(psp == 0)
                     return r0;
                 psp--;
@@ -1343,6 +1423,11 @@ DBL POVFPU_RunDefault(FPUContext *context, FUNCTION fn)
                 psp++;
                 if(psp >= MAX_CALL_STACK_SIZE)
                     POVFPU_Exception(context, fn, "Maximum function evaluation recursion level reached.");
+                if(profiling)
+                {
+                    ProfileCharge(context, fn, icount);
+                    ProfileCall(context, k);
+                }
                 fn = k;
                 program = functions[fn].fn.program;
                 pc = 0;
@@ -1476,6 +1561,1011 @@ DBL POVFPU_RunDefault(FPUContext *context, FUNCTION fn)
 #endif
 }
 
+#ifdef TRY_OPTIMIZED_FUNCTIONS
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   POVFPU_RunOptimized
+*
+* INPUT
+*
+*   fn - function reference number
+*
+* OUTPUT
+*
+* RETURNS
+*
+*   DBL - result found in R0
+*
+* DESCRIPTION
+*
+*   Execute a compiled function, using its native code if there is any.
+*   Native code bails out to the interpreter whenever it runs into one of the
+*   error conditions the interpreter checks for, in which case the function
+*   is simply run again by the interpreter. The arguments are saved up front,
+*   as the native code may already have overwritten them at that point.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+DBL POVFPU_RunOptimized(FPUContext *context, FUNCTION fn)
+{
+    FunctionVM *vm = context->functionvm.get();
+    const FunctionEntry& entry = vm->functions[fn];
+
+    // profiling needs the interpreter to count the instructions executed
+    if((entry.native == nullptr) || context->threaddata->functionProfiling)
+        return POVFPU_RunDefault(context, fn);
+
+    DBL args[MAX_FUNCTION_PARAMETER_LIST];
+    unsigned int argcnt = min((unsigned int)entry.fn.parameter_cnt, context->maxdblstacksize);
+    argcnt = min(argcnt, (unsigned int)MAX_FUNCTION_PARAMETER_LIST);
+    std::copy(context->dblstackbase, context->dblstackbase + argcnt, args);
+
+    std::exception_ptr exception;
+    FunctionNativeState state;
+    state.dblstack = context->dblstackbase;
+    state.maxdblstacksize = context->maxdblstacksize;
+    state.globals = vm->globals.data();
+    state.functions = vm->functions.data();
+    state.context = context;
+    state.hostStack = nullptr;
+    state.bail = false;
+    state.exception = &exception;
+
+    DBL result = POVFPU_RunNative(entry.native, state);
+
+    if(exception)
+        std::rethrow_exception(exception);
+
+    if(state.bail)
+    {
+        std::copy(args, args + argcnt, context->dblstackbase);
+        return POVFPU_RunDefault(context, fn);
+    }
+
+    context->threaddata->Stats()[Ray_Function_VM_Native_Calls]++;
+
+    return result;
+}
+
+DBL POVFPU_NativeTrap(FunctionNativeState *state, unsigned int k, unsigned int sp, FUNCTION fn)
+{
+    FPUContext *context = state->context;
+    DBL r0 = 0.0;
+
+    try
+    {
+        r0 = POVFPU_TrapTable[k].fn(context, &state->dblstack[sp], fn);
+    }
+    catch(...)
+    {
+        // exceptions must not propagate through native code
+        *state->exception = std::current_exception();
+        state->bail = true;
+    }
+
+    state->dblstack = context->dblstackbase;
+    state->maxdblstacksize = context->maxdblstacksize;
+    return r0;
+}
+
+void POVFPU_NativeTrapS(FunctionNativeState *state, unsigned int k, unsigned int sp, FUNCTION fn)
+{
+    FPUContext *context = state->context;
+
+    try
+    {
+        POVFPU_TrapSTable[k].fn(context, &state->dblstack[sp], fn, sp);
+    }
+    catch(...)
+    {
+        // exceptions must not propagate through native code
+        *state->exception = std::current_exception();
+        state->bail = true;
+    }
+
+    state->dblstack = context->dblstackbase;
+    state->maxdblstacksize = context->maxdblstacksize;
+}
+
+void POVFPU_NativeGrow(FunctionNativeState *state, unsigned int k)
+{
+    FPUContext *context = state->context;
+    unsigned int size = context->maxdblstacksize + max(k + 1, (unsigned int)INITIAL_DBL_STACK_SIZE);
+
+    try
+    {
+        context->dblstackbase = reinterpret_cast<DBL *>(POV_REALLOC(context->dblstackbase, sizeof(DBL) * size, "fn: stack"));
+        context->maxdblstacksize = size;
+    }
+    catch(...)
+    {
+        // exceptions must not propagate through native code
+        *state->exception = std::current_exception();
+        state->bail = true;
+    }
+
+    state->dblstack = context->dblstackbase;
+    state->maxdblstacksize = context->maxdblstacksize;
+}
+
+#endif // TRY_OPTIMIZED_FUNCTIONS
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   Interval arithmetic helpers
+*
+* DESCRIPTION
+*
+*   Each helper computes an interval containing all results of the respective
+*   operation for arguments within the argument intervals. They return false
+*   if no such interval can be determined, which includes all cases where the
+*   operation might leave its domain for some of the arguments.
+*
+******************************************************************************/
+
+/// Relative slack added to the final bounds to absorb rounding errors.
+const DBL kIntervalRelativeSlack = 1.0e-9;
+/// Absolute slack added to the final bounds to absorb rounding errors.
+const DBL kIntervalAbsoluteSlack = 1.0e-9;
+
+inline static bool IntervalValid(const FunctionInterval& a)
+{
+    // also catches NaNs
+    return (a.lower <= a.upper);
+}
+
+inline static bool IntervalContainsZero(const FunctionInterval& a)
+{
+    return (a.lower <= 0.0) && (a.upper >= 0.0);
+}
+
+inline static FunctionInterval IntervalMul(const FunctionInterval& a, const FunctionInterval& b)
+{
+    DBL p1 = a.lower * b.lower;
+    DBL p2 = a.lower * b.upper;
+    DBL p3 = a.upper * b.lower;
+    DBL p4 = a.upper * b.upper;
+    return FunctionInterval(min(min(p1, p2), min(p3, p4)), max(max(p1, p2), max(p3, p4)));
+}
+
+inline static FunctionInterval IntervalAbs(const FunctionInterval& a)
+{
+    if (a.lower >= 0.0)
+        return a;
+    else if (a.upper <= 0.0)
+        return FunctionInterval(-a.upper, -a.lower);
+    else
+        return FunctionInterval(0.0, max(-a.lower, a.upper));
+}
+
+inline static FunctionInterval IntervalSqr(const FunctionInterval& a)
+{
+    FunctionInterval b = IntervalAbs(a);
+    return FunctionInterval(b.lower * b.lower, b.upper * b.upper);
+}
+
+static bool IntervalDiv(FunctionInterval& r, const FunctionInterval& a, const FunctionInterval& b)
+{
+    if (IntervalContainsZero(b))
+        return false;
+    r = IntervalMul(a, FunctionInterval(1.0 / b.upper, 1.0 / b.lower));
+    return true;
+}
+
+static bool IntervalMod(FunctionInterval& r, const FunctionInterval& a, const FunctionInterval& b)
+{
+    if (IntervalContainsZero(b))
+        return false;
+    // result has the sign of the dividend, and is smaller in magnitude than both operands
+    DBL m = max(fabs(b.lower), fabs(b.upper));
+    if (a.lower >= 0.0)
+        r = FunctionInterval(0.0, min(a.upper, m));
+    else if (a.upper <= 0.0)
+        r = FunctionInterval(max(a.lower, -m), 0.0);
+    else
+        r = FunctionInterval(max(a.lower, -m), min(a.upper, m));
+    return true;
+}
+
+/// Bounds of `sin(a)`.
+static FunctionInterval IntervalSin(const FunctionInterval& a)
+{
+    if (a.upper - a.lower >= TWO_M_PI)
+        return FunctionInterval(-1.0, 1.0);
+    DBL s1 = sin(a.lower);
+    DBL s2 = sin(a.upper);
+    FunctionInterval r(min(s1, s2), max(s1, s2));
+    // check whether a maximum (pi/2 + 2k*pi) or minimum (-pi/2 + 2k*pi) lies within the interval
+    if (ceil((a.lower - M_PI_2) / TWO_M_PI) * TWO_M_PI + M_PI_2 <= a.upper)
+        r.upper = 1.0;
+    if (ceil((a.lower + M_PI_2) / TWO_M_PI) * TWO_M_PI - M_PI_2 <= a.upper)
+        r.lower = -1.0;
+    return r;
+}
+
+/// Bounds of a monotonically non-decreasing function.
+template<typename FN>
+inline static FunctionInterval IntervalIncreasing(FN fn, const FunctionInterval& a)
+{
+    return FunctionInterval(fn(a.lower), fn(a.upper));
+}
+
+static bool IntervalSys1(FunctionInterval& r, unsigned int k, const FunctionInterval& a)
+{
+    switch (k)
+    {
+        case TRAP_SYS1_SIN:
+            r = IntervalSin(a);
+            return true;
+        case TRAP_SYS1_COS:
+            r = IntervalSin(FunctionInterval(a.lower + M_PI_2, a.upper + M_PI_2));
+            return true;
+        case TRAP_SYS1_TAN:
+            // fail if there is a pole (pi/2 + k*pi) within the interval
+            if (ceil((a.lower - M_PI_2) / M_PI) * M_PI + M_PI_2 <= a.upper)
+                return false;
+            r = IntervalIncreasing<DBL(*)(DBL)>(tan, a);
+            return true;
+        case TRAP_SYS1_ASIN:
+            if ((a.lower < -1.0) || (a.upper > 1.0))
+                return false;
+            r = IntervalIncreasing<DBL(*)(DBL)>(asin, a);
+            return true;
+        case TRAP_SYS1_ACOS:
+            if ((a.lower < -1.0) || (a.upper > 1.0))
+                return false;
+            r = FunctionInterval(acos(a.upper), acos(a.lower));
+            return true;
+        case TRAP_SYS1_ATAN:
+            r = IntervalIncreasing<DBL(*)(DBL)>(atan, a);
+            return true;
+        case TRAP_SYS1_SINH:
+            r = IntervalIncreasing<DBL(*)(DBL)>(sinh, a);
+            return true;
+        case TRAP_SYS1_COSH:
+            r = IntervalIncreasing<DBL(*)(DBL)>(cosh, IntervalAbs(a));
+            return true;
+        case TRAP_SYS1_TANH:
+            r = IntervalIncreasing<DBL(*)(DBL)>(tanh, a);
+            return true;
+        case TRAP_SYS1_ASINH:
+            r = IntervalIncreasing<DBL(*)(DBL)>(std::asinh, a);
+            return true;
+        case TRAP_SYS1_ACOSH:
+            if (a.lower < 1.0)
+                return false;
+            r = IntervalIncreasing<DBL(*)(DBL)>(std::acosh, a);
+            return true;
+        case TRAP_SYS1_ATANH:
+            if ((a.lower <= -1.0) || (a.upper >= 1.0))
+                return false;
+            r = IntervalIncreasing<DBL(*)(DBL)>(std::atanh, a);
+            return true;
+        case TRAP_SYS1_FLOOR:
+            r = IntervalIncreasing<DBL(*)(DBL)>(floor, a);
+            return true;
+        case TRAP_SYS1_CEIL:
+            r = IntervalIncreasing<DBL(*)(DBL)>(ceil, a);
+            return true;
+        case TRAP_SYS1_SQRT:
+            if (a.lower < 0.0)
+                return false;
+            r = IntervalIncreasing<DBL(*)(DBL)>(sqrt, a);
+            return true;
+        case TRAP_SYS1_EXP:
+            r = IntervalIncreasing<DBL(*)(DBL)>(exp, a);
+            return true;
+        case TRAP_SYS1_LN:
+            if (a.lower <= 0.0)
+                return false;
+            r = IntervalIncreasing<DBL(*)(DBL)>(log, a);
+            return true;
+        case TRAP_SYS1_LOG:
+            if (a.lower <= 0.0)
+                return false;
+            r = IntervalIncreasing<DBL(*)(DBL)>(log10, a);
+            return true;
+        case TRAP_SYS1_INT:
+            if ((a.lower <= INT_MIN) || (a.upper >= INT_MAX))
+                return false;
+            r = IntervalIncreasing(math_int, a);
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool IntervalSys2(FunctionInterval& r, unsigned int k, const FunctionInterval& a, const FunctionInterval& b)
+{
+    switch (k)
+    {
+        case TRAP_SYS2_POW:
+            if ((b.lower == b.upper) && (b.lower == floor(b.lower)) && (fabs(b.lower) <= 1024.0))
+            {
+                // integer exponent
+                DBL n = b.lower;
+                if ((n < 0.0) && IntervalContainsZero(a))
+                    return false;
+                if (fmod(n, 2.0) == 0.0)
+                    r = IntervalIncreasing([n](DBL x) { return pow(x, n); }, IntervalAbs(a));
+                else
+                    r = IntervalIncreasing([n](DBL x) { return pow(x, n); }, a);
+                if (n < 0.0)
+                    std::swap(r.lower, r.upper);
+                return true;
+            }
+            else if ((a.lower > 0.0) || ((a.lower == 0.0) && (b.lower > 0.0)))
+            {
+                // pow(a,b) = exp(b * ln(a)), which takes its extrema at the corners
+                DBL p1 = pow(a.lower, b.lower);
+                DBL p2 = pow(a.lower, b.upper);
+                DBL p3 = pow(a.upper, b.lower);
+                DBL p4 = pow(a.upper, b.upper);
+                r = FunctionInterval(min(min(p1, p2), min(p3, p4)), max(max(p1, p2), max(p3, p4)));
+                return true;
+            }
+            return false;
+        case TRAP_SYS2_ATAN2:
+            r = FunctionInterval(-M_PI, M_PI);
+            return true;
+        case TRAP_SYS2_MOD:
+            return IntervalMod(r, a, b);
+        case TRAP_SYS2_DIV:
+            if (!IntervalDiv(r, a, b) || (r.lower <= INT_MIN) || (r.upper >= INT_MAX))
+                return false;
+            r = IntervalIncreasing(math_int, r);
+            return true;
+        default:
+            return false;
+    }
+}
+
+/// Get the condition codes possible when comparing two intervals.
+/// @return Bit mask of the possible values of the condition code register.
+inline static unsigned int IntervalCompare(const FunctionInterval& s, const FunctionInterval& d)
+{
+    unsigned int ccr = 0;
+    if (s.upper > d.lower)
+        ccr |= (1 << 2);    // s > d
+    if ((s.lower <= d.upper) && (d.lower <= s.upper))
+        ccr |= (1 << 1);    // s == d
+    if (s.lower < d.upper)
+        ccr |= (1 << 0);    // s < d
+    return ccr;
+}
+
+/// Get the condition codes for which a branch or set instruction holds.
+/// @return Bit mask of condition code register values.
+inline static unsigned int IntervalCondition(unsigned int s)
+{
+    static const unsigned int kConditions[] =
+    {
+        (1 << 1),               // eq: ccr == 1
+        (1 << 0) | (1 << 2),    // ne: ccr != 1
+        (1 << 2),               // lt: ccr == 2
+        (1 << 1) | (1 << 2),    // le: ccr >= 1
+        (1 << 0),               // gt: ccr == 0
+        (1 << 0) | (1 << 1),    // ge: ccr <= 1
+    };
+    return kConditions[s];
+}
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   POVFPU_RunBounds
+*
+* INPUT
+*
+*   fn - function reference number
+*   args - ranges of the function parameters
+*   argCount - number of function parameters
+*
+* OUTPUT
+*
+*   result - bounds of the function value
+*
+* RETURNS
+*
+*   bool - true if bounds have been computed
+*
+* DESCRIPTION
+*
+*   Execute a compiled function using interval arithmetic, computing bounds
+*   that are guaranteed to contain the function's value for any combination
+*   of arguments within the given ranges.
+*
+*   Conditional branches are followed if the comparison gives the same result
+*   for all values; otherwise, the minimum and maximum idioms generated by the
+*   compiler are evaluated as such, while any other code fails. Calls to
+*   internal functions, stores to global variables and possible domain errors
+*   fail as well, in which case the caller has to resort to other means.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+bool POVFPU_RunBounds(FPUContext *context, FUNCTION fn, const FunctionInterval *args, unsigned int argCount, FunctionInterval& result)
+{
+    vector<FunctionEntry>& functions(context->functionvm->functions);
+    vector<DBL>& consts(context->functionvm->consts);
+    vector<DBL>& globals(context->functionvm->globals);
+    vector<FunctionInterval>& stack(context->intervalstack);
+    StackFrame *pstack = context->pstackbase;
+    FunctionInterval r[8];
+    Instruction *program = functions[fn].fn.program;
+    unsigned int pc = 0;
+    unsigned int ccr = 0; // bit mask of possible condition codes
+    unsigned int sp = 0;
+    unsigned int psp = 0;
+
+    if (stack.size() < max(argCount, (unsigned int)INITIAL_DBL_STACK_SIZE))
+        stack.resize(max(argCount, (unsigned int)INITIAL_DBL_STACK_SIZE));
+    for (unsigned int i = 0; i < argCount; i++)
+        stack[i] = args[i];
+
+    while (true)
+    {
+        unsigned int k = GET_K(program[pc]);
+        unsigned int op = GET_OP(program[pc]);
+        unsigned int s = (op >> 3) & 7;
+        unsigned int d = op & 7;
+        FunctionInterval& rs = r[s];
+        FunctionInterval& rd = r[d];
+
+        switch (op >> 6)
+        {
+            case 0: // add   Rs, Rd
+                rd = FunctionInterval(rd.lower + rs.lower, rd.upper + rs.upper);
+                break;
+            case 1: // sub   Rs, Rd
+                rd = FunctionInterval(rd.lower - rs.upper, rd.upper - rs.lower);
+                break;
+            case 2: // mul   Rs, Rd
+                rd = ((s == d) ? IntervalSqr(rd) : IntervalMul(rd, rs));
+                break;
+            case 3: // div   Rs, Rd
+                if (!IntervalDiv(rd, rd, rs))
+                    return false;
+                break;
+            case 4: // mod   Rs, Rd
+                if (!IntervalMod(rd, rd, rs))
+                    return false;
+                break;
+            case 5: // move  Rs, Rd
+                rd = rs;
+                break;
+            case 6: // cmp   Rs, Rd
+                if (!IntervalValid(rs) || !IntervalValid(rd))
+                    return false;
+                ccr = IntervalCompare(rs, rd);
+                break;
+            case 7: // neg   Rs, Rd
+                rd = FunctionInterval(-rs.upper, -rs.lower);
+                break;
+            case 8: // abs   Rs, Rd
+                rd = IntervalAbs(rs);
+                break;
+            case 9:
+                switch (s)
+                {
+                    case 0: rd = FunctionInterval(rd.lower + consts[k], rd.upper + consts[k]); break;   // addi  k, Rd
+                    case 1: rd = FunctionInterval(rd.lower - consts[k], rd.upper - consts[k]); break;   // subi  k, Rd
+                    case 2: rd = IntervalMul(rd, FunctionInterval(consts[k])); break;                   // muli  k, Rd
+                    case 3: if (!IntervalDiv(rd, rd, FunctionInterval(consts[k]))) return false; break; // divi  k, Rd
+                    case 4: if (!IntervalMod(rd, rd, FunctionInterval(consts[k]))) return false; break; // modi  k, Rd
+                    case 5: rd = FunctionInterval(consts[k]); break;                                    // loadi k, Rd
+                    case 6:                                                                             // cmpi  k, Rd
+                        if (!IntervalValid(rd))
+                            return false;
+                        ccr = IntervalCompare(FunctionInterval(consts[k]), rd);
+                        break;
+                    default: break;
+                }
+                break;
+            case 10:
+                if (s < 6)                              // seq etc.
+                {
+                    unsigned int cond = IntervalCondition(s);
+                    if ((ccr & cond) == 0)
+                        rd = FunctionInterval(0.0);
+                    else if ((ccr & ~cond) == 0)
+                        rd = FunctionInterval(1.0);
+                    else
+                        rd = FunctionInterval(0.0, 1.0);
+                }
+                else                                    // teq, tne
+                {
+                    bool alwaysZero = (rd.lower == 0.0) && (rd.upper == 0.0);
+                    bool neverZero = !IntervalContainsZero(rd);
+                    if (alwaysZero)
+                        rd = FunctionInterval(s == 6 ? 1.0 : 0.0);
+                    else if (neverZero)
+                        rd = FunctionInterval(s == 6 ? 0.0 : 1.0);
+                    else
+                        rd = FunctionInterval(0.0, 1.0);
+                }
+                break;
+            case 11:
+                if (s == 0)                             // load  0(k), Rd
+                    rd = FunctionInterval(globals[k]);
+                else if (s == 1)                        // load  SP(k), Rd
+                    rd = stack[sp + k];
+                break;
+            case 12:
+                if (s == 0)                             // store Rs, 0(k)
+                    return false;
+                else if (s == 1)                        // store Rs, SP(k)
+                    stack[sp + k] = r[d];
+                break;
+            case 13:
+                if (s < 6)                              // beq etc.
+                {
+                    unsigned int cond = IntervalCondition(s);
+                    if ((ccr & ~cond) == 0)
+                    {
+                        pc = k;
+                        continue;
+                    }
+                    else if ((ccr & cond) != 0)
+                    {
+                        // Both paths are possible; this is only supported for the minimum and
+                        // maximum idioms, i.e. `cmp X, Y; bcc +2; move M, D` with {M,D} = {X,Y}.
+                        if ((pc == 0) || (k != pc + 2) || (GET_OP(program[pc - 1]) >> 6 != 6) || (GET_OP(program[pc + 1]) >> 6 != 5))
+                            return false;
+                        unsigned int x = (GET_OP(program[pc - 1]) >> 3) & 7;
+                        unsigned int y = GET_OP(program[pc - 1]) & 7;
+                        unsigned int m = (GET_OP(program[pc + 1]) >> 3) & 7;
+                        unsigned int n = GET_OP(program[pc + 1]) & 7;
+                        if (!(((m == x) && (n == y)) || ((m == y) && (n == x))) || (x == y))
+                            return false;
+                        // register chosen if X > Y, and if X < Y
+                        unsigned int chosenGreater = (cond & (1 << 2)) ? n : m;
+                        unsigned int chosenLess    = (cond & (1 << 0)) ? n : m;
+                        if ((chosenGreater == x) && (chosenLess == y))
+                            r[n] = FunctionInterval(max(r[x].lower, r[y].lower), max(r[x].upper, r[y].upper));
+                        else if ((chosenGreater == y) && (chosenLess == x))
+                            r[n] = FunctionInterval(min(r[x].lower, r[y].lower), min(r[x].upper, r[y].upper));
+                        else
+                            return false;
+                        pc += 2;
+                        continue;
+                    }
+                }
+                break;
+            case 14:
+                if (s < 6)                              // xeq etc.
+                {
+                    static const unsigned int kCompareZero[] = { 1 << 1, (1 << 0) | (1 << 2), 1 << 0, (1 << 0) | (1 << 1), 1 << 2, (1 << 1) | (1 << 2) };
+                    if (!IntervalValid(rd) || (IntervalCompare(rd, FunctionInterval(0.0)) & kCompareZero[s]))
+                        return false;
+                }
+                else if (s == 6)                        // xdz   R0, Rd
+                {
+                    if (IntervalContainsZero(r[0]) && IntervalContainsZero(rd))
+                        return false;
+                }
+                break;
+            case 15:
+                if (s == 0)
+                {
+                    switch (d)
+                    {
+                        case 0:                         // jsr   k
+                            pstack[psp].pc = pc;
+                            pstack[psp].fn = fn;
+                            psp++;
+                            if (psp >= MAX_CALL_STACK_SIZE)
+                                return false;
+                            pc = k;
+                            continue;
+                        case 1:                         // jmp   k
+                            pc = k;
+                            continue;
+                        case 2:                         // rts
+                            if (psp == 0)
+                            {
+                                result = r[0];
+                                if (!IntervalValid(result))
+                                    return false;
+                                result.lower -= fabs(result.lower) * kIntervalRelativeSlack + kIntervalAbsoluteSlack;
+                                result.upper += fabs(result.upper) * kIntervalRelativeSlack + kIntervalAbsoluteSlack;
+                                return true;
+                            }
+                            psp--;
+                            pc = pstack[psp].pc;
+                            fn = pstack[psp].fn;
+                            program = functions[fn].fn.program;
+                            break;
+                        case 3:                         // call  k
+                            pstack[psp].pc = pc;
+                            pstack[psp].fn = fn;
+                            psp++;
+                            if (psp >= MAX_CALL_STACK_SIZE)
+                                return false;
+                            fn = k;
+                            program = functions[fn].fn.program;
+                            pc = 0;
+                            continue;
+                        case 4:                         // sys1  k
+                            if (!IntervalValid(r[0]) || !IntervalSys1(r[0], k, r[0]))
+                                return false;
+                            break;
+                        case 5:                         // sys2  k
+                            if (!IntervalValid(r[0]) || !IntervalValid(r[1]) || !IntervalSys2(r[0], k, r[0], r[1]))
+                                return false;
+                            break;
+                        default:                        // trap, traps
+                            return false;
+                    }
+                }
+                else if (s == 1)
+                {
+                    switch (d)
+                    {
+                        case 0:                         // grow  k
+                            if (sp + k >= MAX_K)
+                                return false;
+                            if (sp + k >= stack.size())
+                                stack.resize(sp + max(k + 1, (unsigned int)INITIAL_DBL_STACK_SIZE));
+                            break;
+                        case 1:                         // push  k
+                            if (sp + k >= stack.size())
+                                return false;
+                            sp += k;
+                            break;
+                        case 2:                         // pop   k
+                            if (k > sp)
+                                return false;
+                            sp -= k;
+                            break;
+                        default:                        // nop
+                            break;
+                    }
+                }
+                break;
+        }
+
+        pc++;
+    }
+}
+
+inline static bool BatchCheckFails(unsigned int s, DBL v)
+{
+    switch (s)
+    {
+        case 0:  return (v == 0.0); // xeq
+        case 1:  return (v != 0.0); // xne
+        case 2:  return (v <  0.0); // xlt
+        case 3:  return (v <= 0.0); // xle
+        case 4:  return (v >  0.0); // xgt
+        default: return (v >= 0.0); // xge
+    }
+}
+
+/*****************************************************************************
+*
+* FUNCTION
+*
+*   POVFPU_RunBatch
+*
+* INPUT
+*
+*   fn - function reference number
+*   args - function parameters, argCount consecutive values per evaluation
+*   argCount - number of function parameters
+*   count - number of evaluations, at most FUNCTION_BATCH_LANES
+*
+* OUTPUT
+*
+*   results - function values, one per evaluation
+*
+* RETURNS
+*
+*   bool - true if the function has been evaluated
+*
+* DESCRIPTION
+*
+*   Execute a compiled function for several sets of arguments at once. All
+*   evaluations step through the program together, with each register and
+*   stack slot holding one value per evaluation, so that the cost of decoding
+*   the instructions is shared, and the operations themselves run in simple
+*   loops the compiler can turn into vector code. Internal functions called
+*   via trap are invoked once per evaluation.
+*
+*   Conditional branches are followed if the comparison gives the same result
+*   for all evaluations; otherwise, only the minimum and maximum idioms
+*   generated by the compiler, i.e. a branch around a single move, are
+*   supported. Any other code the evaluations disagree on fails, as do the
+*   traps instruction and stores to global variables, in which case the
+*   caller has to evaluate the function one argument set after the other.
+*
+* CHANGES
+*
+*   -
+*
+******************************************************************************/
+
+bool POVFPU_RunBatch(FPUContext *context, FUNCTION fn, const DBL *args, unsigned int argCount, unsigned int count, DBL *results)
+{
+    const unsigned int L = FUNCTION_BATCH_LANES;
+    vector<FunctionEntry>& functions(context->functionvm->functions);
+    vector<DBL>& consts(context->functionvm->consts);
+    vector<DBL>& globals(context->functionvm->globals);
+    vector<DBL>& stack(context->batchstack);
+    StackFrame *pstack = context->pstackbase;
+    DBL r[8][FUNCTION_BATCH_LANES] = {};
+    unsigned int ccr[FUNCTION_BATCH_LANES] = {};
+    Instruction *program = functions[fn].fn.program;
+    unsigned int n = count;
+    unsigned int pc = 0;
+    unsigned int sp = 0;
+    unsigned int psp = 0;
+    unsigned int stacksize = max(argCount, (unsigned int)INITIAL_DBL_STACK_SIZE);
+
+    POV_VM_ASSERT((count > 0) && (count <= FUNCTION_BATCH_LANES));
+
+    if (stack.size() < stacksize * L)
+        stack.resize(stacksize * L);
+    stacksize = stack.size() / L;
+    for (unsigned int a = 0; a < argCount; a++)
+        for (unsigned int i = 0; i < n; i++)
+            stack[a * L + i] = args[i * argCount + a];
+
+    while (true)
+    {
+        unsigned int k = GET_K(program[pc]);
+        unsigned int op = GET_OP(program[pc]);
+        unsigned int s = (op >> 3) & 7;
+        unsigned int d = op & 7;
+        DBL *rs = r[s];
+        DBL *rd = r[d];
+
+        switch (op >> 6)
+        {
+            case 0: // add   Rs, Rd
+                for (unsigned int i = 0; i < n; i++) rd[i] = rd[i] + rs[i];
+                break;
+            case 1: // sub   Rs, Rd
+                for (unsigned int i = 0; i < n; i++) rd[i] = rd[i] - rs[i];
+                break;
+            case 2: // mul   Rs, Rd
+                for (unsigned int i = 0; i < n; i++) rd[i] = rd[i] * rs[i];
+                break;
+            case 3: // div   Rs, Rd
+                for (unsigned int i = 0; i < n; i++) rd[i] = rd[i] / rs[i];
+                break;
+            case 4: // mod   Rs, Rd
+                for (unsigned int i = 0; i < n; i++) rd[i] = fmod(rd[i], rs[i]);
+                break;
+            case 5: // move  Rs, Rd
+                for (unsigned int i = 0; i < n; i++) rd[i] = rs[i];
+                break;
+            case 6: // cmp   Rs, Rd
+                for (unsigned int i = 0; i < n; i++) ccr[i] = (((rs[i] > rd[i]) & 1) << 1) | ((rs[i] == rd[i]) & 1);
+                break;
+            case 7: // neg   Rs, Rd
+                for (unsigned int i = 0; i < n; i++) rd[i] = -rs[i];
+                break;
+            case 8: // abs   Rs, Rd
+                for (unsigned int i = 0; i < n; i++) rd[i] = fabs(rs[i]);
+                break;
+            case 9:
+            {
+                DBL c = consts[k];
+                switch (s)
+                {
+                    case 0: for (unsigned int i = 0; i < n; i++) rd[i] = rd[i] + c; break;          // addi  k, Rd
+                    case 1: for (unsigned int i = 0; i < n; i++) rd[i] = rd[i] - c; break;          // subi  k, Rd
+                    case 2: for (unsigned int i = 0; i < n; i++) rd[i] = rd[i] * c; break;          // muli  k, Rd
+                    case 3: for (unsigned int i = 0; i < n; i++) rd[i] = rd[i] / c; break;          // divi  k, Rd
+                    case 4: for (unsigned int i = 0; i < n; i++) rd[i] = fmod(rd[i], c); break;     // modi  k, Rd
+                    case 5: for (unsigned int i = 0; i < n; i++) rd[i] = c; break;                  // loadi k, Rd
+                    case 6:                                                                         // cmpi  k, Rd
+                        for (unsigned int i = 0; i < n; i++) ccr[i] = (((c > rd[i]) & 1) << 1) | ((c == rd[i]) & 1);
+                        break;
+                    default: break;
+                }
+                break;
+            }
+            case 10:
+                if (s < 6)                              // seq etc.
+                {
+                    unsigned int cond = IntervalCondition(s);
+                    for (unsigned int i = 0; i < n; i++) rd[i] = DBL((cond >> ccr[i]) & 1);
+                }
+                else if (s == 6)                        // teq   Rd
+                {
+                    for (unsigned int i = 0; i < n; i++) rd[i] = DBL(rd[i] == 0.0);
+                }
+                else                                    // tne   Rd
+                {
+                    for (unsigned int i = 0; i < n; i++) rd[i] = DBL(rd[i] != 0.0);
+                }
+                break;
+            case 11:
+                if (s == 0)                             // load  0(k), Rd
+                {
+                    for (unsigned int i = 0; i < n; i++) rd[i] = globals[k];
+                }
+                else if (s == 1)                        // load  SP(k), Rd
+                {
+                    const DBL *slot = &stack[(sp + k) * L];
+                    for (unsigned int i = 0; i < n; i++) rd[i] = slot[i];
+                }
+                break;
+            case 12:
+                if (s == 0)                             // store Rs, 0(k)
+                    return false;
+                else if (s == 1)                        // store Rs, SP(k)
+                {
+                    DBL *slot = &stack[(sp + k) * L];
+                    for (unsigned int i = 0; i < n; i++) slot[i] = rd[i];
+                }
+                break;
+            case 13:
+                if (s < 6)                              // beq etc.
+                {
+                    unsigned int cond = IntervalCondition(s);
+                    unsigned int taken = 0;
+                    for (unsigned int i = 0; i < n; i++) taken += (cond >> ccr[i]) & 1;
+                    if (taken == n)
+                    {
+                        pc = k;
+                        continue;
+                    }
+                    else if (taken != 0)
+                    {
+                        // The evaluations disagree; this is only supported for a branch around
+                        // a single move, as generated for the minimum and maximum functions,
+                        // which is simply executed for those evaluations not taking the branch.
+                        if ((k != pc + 2) || (GET_OP(program[pc + 1]) >> 6 != 5))
+                            return false;
+                        DBL *ms = r[(GET_OP(program[pc + 1]) >> 3) & 7];
+                        DBL *md = r[GET_OP(program[pc + 1]) & 7];
+                        for (unsigned int i = 0; i < n; i++)
+                        {
+                            if (((cond >> ccr[i]) & 1) == 0)
+                                md[i] = ms[i];
+                        }
+                        pc += 2;
+                        continue;
+                    }
+                }
+                break;
+            case 14:
+                if (s < 6)                              // xeq etc.
+                {
+                    for (unsigned int i = 0; i < n; i++)
+                    {
+                        if (BatchCheckFails(s, rd[i]))
+                        {
+                            POVFPU_Exception(context, fn);
+                            break;
+                        }
+                    }
+                }
+                else if (s == 6)                        // xdz   R0, Rd
+                {
+                    for (unsigned int i = 0; i < n; i++)
+                    {
+                        if ((r[0][i] == 0.0) && (rd[i] == 0.0))
+                        {
+                            POVFPU_Exception(context, fn);
+                            break;
+                        }
+                    }
+                }
+                break;
+            case 15:
+                if (s == 0)
+                {
+                    switch (d)
+                    {
+                        case 0:                         // jsr   k
+                            pstack[psp].pc = pc;
+                            pstack[psp].fn = fn;
+                            psp++;
+                            if (psp >= MAX_CALL_STACK_SIZE)
+                                return false;
+                            pc = k;
+                            continue;
+                        case 1:                         // jmp   k
+                            pc = k;
+                            continue;
+                        case 2:                         // rts
+                            if (psp == 0)
+                            {
+                                for (unsigned int i = 0; i < n; i++) results[i] = r[0][i];
+                                context->threaddata->Stats()[Ray_Function_VM_Batch_Calls] += n;
+                                return true;
+                            }
+                            psp--;
+                            pc = pstack[psp].pc;
+                            fn = pstack[psp].fn;
+                            program = functions[fn].fn.program;
+                            break;
+                        case 3:                         // call  k
+                            pstack[psp].pc = pc;
+                            pstack[psp].fn = fn;
+                            psp++;
+                            if (psp >= MAX_CALL_STACK_SIZE)
+                                return false;
+                            fn = k;
+                            program = functions[fn].fn.program;
+                            pc = 0;
+                            continue;
+                        case 4:                         // sys1  k
+                            for (unsigned int i = 0; i < n; i++) r[0][i] = POVFPU_Sys1Table[k](r[0][i]);
+                            break;
+                        case 5:                         // sys2  k
+                            for (unsigned int i = 0; i < n; i++) r[0][i] = POVFPU_Sys2Table[k](r[0][i], r[1][i]);
+                            break;
+                        case 6:                         // trap  k
+                        {
+                            // run the internal function once per evaluation, passing the
+                            // respective parameters on the regular stack
+                            unsigned int cnt = POVFPU_TrapTable[k].parameter_cnt;
+                            if ((sp + cnt > stacksize) || (cnt > context->maxdblstacksize))
+                                return false;
+                            for (unsigned int i = 0; i < n; i++)
+                            {
+                                for (unsigned int a = 0; a < cnt; a++)
+                                    context->dblstackbase[a] = stack[(sp + a) * L + i];
+                                r[0][i] = POVFPU_TrapTable[k].fn(context, context->dblstackbase, fn);
+                            }
+                            break;
+                        }
+                        default:                        // traps
+                            return false;
+                    }
+                }
+                else if (s == 1)
+                {
+                    switch (d)
+                    {
+                        case 0:                         // grow  k
+                            if (sp + k >= MAX_K)
+                                return false;
+                            if (sp + k >= stacksize)
+                            {
+                                stacksize = sp + max(k + 1, (unsigned int)INITIAL_DBL_STACK_SIZE);
+                                stack.resize(stacksize * L);
+                            }
+                            break;
+                        case 1:                         // push  k
+                            if (sp + k >= stacksize)
+                                return false;
+                            sp += k;
+                            break;
+                        case 2:                         // pop   k
+                            if (k > sp)
+                                return false;
+                            sp -= k;
+                            break;
+                        default:                        // nop
+                            break;
+                    }
+                }
+                break;
+        }
+
+        pc++;
+    }
+}
+
 /*****************************************************************************
 *
 * FUNCTION
@@ -1565,6 +2655,57 @@ void FunctionVM::DestroyFunction(FUNCTION_PTR pK)
 
 /*****************************************************************************/
 
+bool FunctionVM::GetFingerprint(FUNCTION fn, POV_UINT64& fingerprint, unsigned int level)
+{
+    const FunctionCode& f = functions[fn].fn;
+
+    // Patterns and other private data can't be told apart by the code alone.
+    if ((f.private_data != nullptr) || (level >= MAX_CALL_STACK_SIZE))
+        return false;
+
+    auto mix = [&fingerprint](POV_UINT64 v)
+    {
+        fingerprint = (fingerprint ^ v) * 0x100000001B3ull;
+    };
+
+    mix(f.program_size);
+    mix(f.return_size);
+    mix(f.parameter_cnt);
+
+    for (unsigned int pc = 0; pc < f.program_size; pc++)
+    {
+        unsigned int k = GET_K(f.program[pc]);
+        unsigned int op = GET_OP(f.program[pc]);
+        unsigned int s = (op >> 3) & 7;
+        unsigned int d = op & 7;
+
+        // Constant and function numbers depend on the order in which things were parsed,
+        // so mix in what they refer to instead.
+        if ((op >> 6 == 9) && (s < 7))                      // addi k, Rd etc.
+        {
+            POV_UINT64 bits;
+            static_assert(sizeof(bits) == sizeof(DBL), "DBL is expected to be 64 bits wide");
+            memcpy(&bits, &consts[k], sizeof(bits));
+            mix(op);
+            mix(bits);
+        }
+        else if (((op >> 6 == 11) || (op >> 6 == 12)) && (s == 0)) // load 0(k), Rd; store Rs, 0(k)
+            return false;
+        else if ((op >> 6 == 15) && (s == 0) && (d == 3))   // call k
+        {
+            mix(op);
+            if (!GetFingerprint(k, fingerprint, level + 1))
+                return false;
+        }
+        else
+            mix(f.program[pc]);
+    }
+
+    return true;
+}
+
+/*****************************************************************************/
+
 FunctionVM::CustomFunction::CustomFunction(FunctionVM* pVm, FUNCTION_PTR pFn) :
     mpVm(pVm),
     mpFn(pFn)
@@ -1613,6 +2754,37 @@ DBL FunctionVM::CustomFunction::Execute(GenericFunctionContextPtr pGenericContex
     return POVFPU_Run (pContext, *mpFn);
 }
 
+bool FunctionVM::CustomFunction::ExecuteBounds(GenericFunctionContextPtr pGenericContext, const FunctionInterval* args, unsigned int argCount, FunctionInterval& result)
+{
+    FPUContext* pContext = GetFPUContextPtr(pGenericContext);
+    return POVFPU_RunBounds (pContext, *mpFn, args, argCount, result);
+}
+
+void FunctionVM::CustomFunction::ExecuteBatch(GenericFunctionContextPtr pGenericContext, const DBL* args, unsigned int argCount, unsigned int count, DBL* results)
+{
+    FPUContext* pContext = GetFPUContextPtr(pGenericContext);
+    // profiling is done by the regular interpreter only
+    if (pContext->threaddata->functionProfiling)
+    {
+        GenericScalarFunction::ExecuteBatch(pGenericContext, args, argCount, count, results);
+        return;
+    }
+#ifdef TRY_OPTIMIZED_FUNCTIONS
+    // native code beats the batch interpreter even when run for one argument set at a time
+    if (mpVm->functions[*mpFn].native != nullptr)
+    {
+        GenericScalarFunction::ExecuteBatch(pGenericContext, args, argCount, count, results);
+        return;
+    }
+#endif
+    for (unsigned int i = 0; i < count; i += FUNCTION_BATCH_LANES)
+    {
+        unsigned int n = min(count - i, (unsigned int)FUNCTION_BATCH_LANES);
+        if (!POVFPU_RunBatch(pContext, *mpFn, args + i * argCount, argCount, n, results + i))
+            GenericScalarFunction::ExecuteBatch(pGenericContext, args + i * argCount, argCount, n, results + i);
+    }
+}
+
 GenericScalarFunctionPtr FunctionVM::CustomFunction::Clone() const
 {
     return new CustomFunction(mpVm.get(), mpVm->CopyFunction(mpFn));
@@ -1623,6 +2795,12 @@ const CustomFunctionSourceInfo* FunctionVM::CustomFunction::GetSourceInfo() cons
     return &(mpVm->GetFunction(*mpFn)->sourceInfo);
 }
 
+bool FunctionVM::CustomFunction::GetFingerprint(POV_UINT64& fingerprint) const
+{
+    fingerprint = 0xCBF29CE484222325ull;
+    return mpVm->GetFingerprint(*mpFn, fingerprint);
+}
+
 inline FPUContext* FunctionVM::CustomFunction::GetFPUContextPtr(GenericFunctionContextPtr pGenericContext)
 {
 #if POV_VM_DEBUG
@@ -1648,7 +2826,8 @@ FPUContext::FPUContext(FunctionVM* pVm, TraceThreadData* pThreadData) :
     pstackbase(reinterpret_cast<StackFrame *>(POV_MALLOC(sizeof(StackFrame) * MAX_CALL_STACK_SIZE, "fn: pstack"))),
     functionvm(pVm),
     threaddata(pThreadData),
-    nextArgument(0)
+    nextArgument(0),
+    profiletime(0)
 {
     #if (SYS_FUNCTIONS == 1)
     context->dblstack = context->dblstackbase;
@@ -47,6 +47,7 @@
 //  (none at the moment)
 
 // C++ standard header files
+#include <exception>
 #include <set>
 #include <vector>
 
@@ -67,6 +68,7 @@ namespace pov
 
 #define MAX_CALL_STACK_SIZE 1024
 #define INITIAL_DBL_STACK_SIZE 256
+#define FUNCTION_BATCH_LANES 8
 
 #define MAX_K ((unsigned int)0x000fffff)
 
@@ -145,11 +147,19 @@ struct FunctionCode
     void *private_data;
 };
 
+#ifdef TRY_OPTIMIZED_FUNCTIONS
+/// Native code compiled from a function; layout is defined by the platform.
+struct FunctionNativeCode;
+#endif
+
 struct FunctionEntry
 {
     FunctionCode fn;            // valid if reference_count != 0
     FUNCTION next_unreferenced; // valid if reference_count == 0
     unsigned int reference_count;
+    #ifdef TRY_OPTIMIZED_FUNCTIONS
+    FunctionNativeCode *native; // nullptr if the function is interpreted
+    #endif
     SYS_FUNCTION_ENTRY
 };
 
@@ -174,6 +184,9 @@ class FPUContext : public GenericFunctionContext
         DBL *dblstack;
         #endif
         int nextArgument;
+        POV_ULONG profiletime; // time of the last profiling checkpoint, in nanoseconds
+        std::vector<FunctionInterval> intervalstack;
+        std::vector<DBL> batchstack; // FUNCTION_BATCH_LANES entries per stack slot
 
         void SetLocal(unsigned int k, DBL v);
         DBL GetLocal(unsigned int k);
@@ -251,13 +264,88 @@ extern const unsigned int POVFPU_Sys2TableSize;
 
 void POVFPU_Exception(FPUContext *context, FUNCTION fn, const char *msg = nullptr);
 DBL POVFPU_RunDefault(FPUContext *context, FUNCTION k);
+bool POVFPU_RunBounds(FPUContext *context, FUNCTION k, const FunctionInterval *args, unsigned int argCount, FunctionInterval& result);
+bool POVFPU_RunBatch(FPUContext *context, FUNCTION k, const DBL *args, unsigned int argCount, unsigned int count, DBL *results);
 
 void FNCode_Delete(FunctionCode *);
 
+#ifdef TRY_OPTIMIZED_FUNCTIONS
+
+/// Run-time state shared between @ref POVFPU_RunOptimized() and native function code.
+///
+/// Native code keeps this structure in a register while it runs, and passes it on to the
+/// `POVFPU_Native*` helpers below whenever it needs the interpreter's help.
+///
+struct FunctionNativeState final
+{
+    DBL *dblstack;                  ///< Base of the data stack; updated whenever it is re-allocated.
+    unsigned int maxdblstacksize;   ///< Size of the data stack.
+    DBL *globals;                   ///< Global variables.
+    const FunctionEntry *functions; ///< Function table, for calls between native functions.
+    FPUContext *context;            ///< Context the function is run in.
+    void *hostStack;                ///< Platform-specific, used to unwind native code on bail-out.
+    bool bail;                      ///< Set if native code bailed out to the interpreter.
+    std::exception_ptr *exception;  ///< Set if an internal function threw an exception.
+};
+
+/// Compile a function to native code.
+///
+/// @note
+///     This function must be implemented by platform-specific code.
+///
+/// @param[in]  f           Function to compile.
+/// @param[in]  fn          Function reference number.
+/// @param[in]  consts      Constants of the function VM.
+/// @param[in]  functions   Function table; functions called by `f` must already be compiled.
+/// @return                 Native code, or `nullptr` if `f` can only be interpreted.
+///
+FunctionNativeCode *POVFPU_CompileNative(const FunctionCode& f, FUNCTION fn,
+                                         const std::vector<DBL>& consts,
+                                         const std::vector<FunctionEntry>& functions);
+
+/// Release native code obtained from @ref POVFPU_CompileNative().
+///
+/// @note
+///     This function must be implemented by platform-specific code.
+///
+void POVFPU_ReleaseNative(FunctionNativeCode *code);
+
+/// Run native code.
+///
+/// If the native code runs into a condition it does not handle itself, such as a stack overflow
+/// or a floating-point exception check that fails, it sets `state.bail` and returns immediately.
+///
+/// @note
+///     This function must be implemented by platform-specific code.
+///
+DBL POVFPU_RunNative(const FunctionNativeCode *code, FunctionNativeState& state);
+
+/// Run a function, using native code if available.
+DBL POVFPU_RunOptimized(FPUContext *context, FUNCTION fn);
+
+/// @name Helpers called from native code
+/// @{
+
+/// Execute the `trap` instruction. Sets `state->bail` if the internal function threw.
+DBL POVFPU_NativeTrap(FunctionNativeState *state, unsigned int k, unsigned int sp, FUNCTION fn);
+/// Execute the `traps` instruction. Sets `state->bail` if the internal function threw.
+void POVFPU_NativeTrapS(FunctionNativeState *state, unsigned int k, unsigned int sp, FUNCTION fn);
+/// Grow the data stack by at least `k` entries. Sets `state->bail` on failure.
+void POVFPU_NativeGrow(FunctionNativeState *state, unsigned int k);
+
+/// @}
+
+#endif // TRY_OPTIMIZED_FUNCTIONS
+
 class FunctionVM : public GenericFunctionContextFactory
 {
         friend void POVFPU_Exception(FPUContext *, FUNCTION, const char *);
         friend DBL POVFPU_RunDefault(FPUContext *, FUNCTION);
+        friend bool POVFPU_RunBounds(FPUContext *, FUNCTION, const FunctionInterval *, unsigned int, FunctionInterval&);
+        friend bool POVFPU_RunBatch(FPUContext *, FUNCTION, const DBL *, unsigned int, unsigned int, DBL *);
+        #ifdef TRY_OPTIMIZED_FUNCTIONS
+        friend DBL POVFPU_RunOptimized(FPUContext *, FUNCTION);
+        #endif
 
     public:
 
@@ -271,8 +359,11 @@ class FunctionVM : public GenericFunctionContextFactory
                 virtual void InitArguments(GenericFunctionContextPtr pContext) override;
                 virtual void PushArgument(GenericFunctionContextPtr pContext, DBL arg) override;
                 virtual DBL Execute(GenericFunctionContextPtr pContext) override;
+                virtual bool ExecuteBounds(GenericFunctionContextPtr pContext, const FunctionInterval* args, unsigned int argCount, FunctionInterval& result) override;
+                virtual void ExecuteBatch(GenericFunctionContextPtr pContext, const DBL* args, unsigned int argCount, unsigned int count, DBL* results) override;
                 virtual GenericScalarFunctionPtr Clone() const override;
                 virtual const CustomFunctionSourceInfo* GetSourceInfo() const override;
+                virtual bool GetFingerprint(POV_UINT64& fingerprint) const override;
             protected:
                 boost::intrusive_ptr<FunctionVM> mpVm;
                 FUNCTION_PTR mpFn;
@@ -298,6 +389,12 @@ class FunctionVM : public GenericFunctionContextFactory
         FUNCTION_PTR CopyFunction(FUNCTION_PTR pK);
         void DestroyFunction(FUNCTION_PTR pK);
 
+        /// Compute a fingerprint of a function's code, including the constants it uses and the
+        /// functions it calls, which identifies the function across parses.
+        /// @return `false` if the function depends on data other than its code, e.g. a pattern,
+        ///         or accesses global variables.
+        bool GetFingerprint(FUNCTION fn, POV_UINT64& fingerprint, unsigned int level = 0);
+
         virtual GenericFunctionContextPtr CreateFunctionContext(TraceThreadData* pTd) override;
 
     private:
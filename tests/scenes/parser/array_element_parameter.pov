@@ -0,0 +1,60 @@
+//    Persistence of Vision Raytracer Scene Description File
+//    File: array_element_parameter.pov
+//    Description: Regression test for macro parameters passed elements of float,
+//     uv and vector arrays by reference, and redefined through the parameter.
+//     The elements of such arrays may be held in contiguous storage, which must
+//     not be freed when an element is replaced.
+//
+//    Parse only; the scene reports an error if any element has a wrong value:
+//     povray +Iarray_element_parameter.pov -D -F +W16 +H16
+//
+//*******************************************
+
+#version 3.8;
+global_settings { assumed_gamma 1.0 }
+
+#macro SetVector(Param) #local Param = <1,2,3>; #end
+#macro SetUV(Param)     #local Param = <4,5>;   #end
+#macro SetFloat(Param)  #local Param = 6;       #end
+#macro SetFloatTwice(Param) SetFloat(Param) #local Param = Param + 1; #end
+
+#macro Check(Value, Expected)
+  #if (vlength(Value - Expected) != 0)
+    #error concat("Array element has the wrong value; expected ", vstr(3, Expected, ",", 0, 1), ".\n")
+  #end
+#end
+
+#declare VectorArray = array[2] { <0,0,0>, <1,1,1> }
+SetVector(VectorArray[0])
+Check(VectorArray[0], <1,2,3>)
+Check(VectorArray[1], <1,1,1>)
+#declare VectorArray[1] = <7,8,9>;
+Check(VectorArray[1], <7,8,9>)
+
+#declare UVArray = array[2] { <0,0>, <1,1> }
+SetUV(UVArray[1])
+Check(<UVArray[0].u, UVArray[0].v, 0>, <0,0,0>)
+Check(<UVArray[1].u, UVArray[1].v, 0>, <4,5,0>)
+
+#declare FloatArray = array[3] { 0, 1, 2 }
+SetFloat(FloatArray[2])
+Check(FloatArray[2], 6)
+SetFloatTwice(FloatArray[0])
+Check(FloatArray[0], 7)
+Check(FloatArray[1], 1)
+
+// copies of an array hold their own elements
+#declare FloatCopy = FloatArray;
+SetFloat(FloatCopy[1])
+Check(FloatCopy[1], 6)
+Check(FloatArray[1], 1)
+
+#declare FloatArray2 = array[2] { 0, 1 }
+#declare FloatCopy2 = FloatArray2;
+SetFloat(FloatCopy2[0])
+Check(FloatCopy2[0], 6)
+Check(FloatArray2[0], 0)
+
+#debug "Array element parameters OK.\n"
+
+camera { location <0,0,-5> look_at <0,0,0> }
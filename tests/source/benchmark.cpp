@@ -0,0 +1,153 @@
+//******************************************************************************
+///
+/// @file tests/source/benchmark.cpp
+///
+/// Common infrastructure for POV-Ray micro-benchmarks.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+// configcore.h must always be the first POV file included within core *.cpp files;
+// benchmark.h must follow suite.
+#include "core/configcore.h"
+#include "benchmark.h"
+
+#include "base/version.h"
+
+#include "core/material/noise.h"
+#include "core/material/pattern.h"
+#include "core/scene/scenedata.h"
+#include "core/scene/tracethreaddata.h"
+
+// this must be the last file included
+#include "base/povdebug.h"
+
+namespace pov_benchmark
+{
+
+static std::vector<Result> gResults;
+static volatile double gSink = 0.0;
+
+void Report(const Result& result)
+{
+    BOOST_TEST_MESSAGE(result.group << "/" << result.name << ": "
+                       << (result.seconds * 1.0e9 / result.iterations) << " ns/op");
+    gResults.push_back(result);
+}
+
+void Consume(double value)
+{
+    gSink = gSink + value;
+}
+
+std::shared_ptr<pov::TraceThreadData> CreateThreadData()
+{
+    std::shared_ptr<pov::SceneData> sceneData(new pov::SceneData());
+    return std::shared_ptr<pov::TraceThreadData>(new pov::TraceThreadData(sceneData, 0));
+}
+
+/// Write a string as a JSON string literal.
+static void WriteString(std::FILE *f, const std::string& s)
+{
+    std::fputc('"', f);
+    for (char c : s)
+    {
+        if ((c == '"') || (c == '\\'))
+            std::fputc('\\', f);
+        if (static_cast<unsigned char>(c) >= 0x20)
+            std::fputc(c, f);
+    }
+    std::fputc('"', f);
+}
+
+/// Write all results.
+///
+/// The schema is versioned so that results can be compared across builds; any incompatible
+/// change to it must bump `schema_version`.
+///
+static void WriteResults(const char *filename)
+{
+    std::FILE *f = std::fopen(filename, "w");
+    if (f == nullptr)
+    {
+        BOOST_TEST_MESSAGE("Cannot write benchmark results to " << filename);
+        return;
+    }
+
+    std::fprintf(f, "{\n");
+    std::fprintf(f, "  \"schema\": \"povray-microbenchmark\",\n");
+    std::fprintf(f, "  \"schema_version\": 1,\n");
+    std::fprintf(f, "  \"povray_version\": ");
+    WriteString(f, POV_RAY_FULL_VERSION);
+    std::fprintf(f, ",\n  \"results\": [");
+    for (size_t i = 0; i < gResults.size(); ++i)
+    {
+        const Result& r = gResults[i];
+        std::fprintf(f, "%s\n    { \"group\": ", (i == 0 ? "" : ","));
+        WriteString(f, r.group);
+        std::fprintf(f, ", \"name\": ");
+        WriteString(f, r.name);
+        std::fprintf(f, ", \"iterations\": %llu, \"seconds\": %.6f, \"ns_per_op\": %.3f }",
+                     static_cast<unsigned long long>(r.iterations), r.seconds,
+                     r.seconds * 1.0e9 / r.iterations);
+    }
+    std::fprintf(f, "\n  ]\n}\n");
+    std::fclose(f);
+}
+
+/// Global set-up and tear-down for the micro-benchmarks.
+struct BenchmarkFixture final
+{
+    BenchmarkFixture()
+    {
+        pov::Initialize_Noise();
+        pov::InitializePatternGenerators();
+    }
+
+    ~BenchmarkFixture()
+    {
+        if (gResults.empty())
+            return;
+        const char *filename = std::getenv("POV_BENCHMARK_FILE");
+        WriteResults((filename != nullptr) ? filename : "benchmark.json");
+    }
+};
+
+BOOST_GLOBAL_FIXTURE( BenchmarkFixture );
+
+// the benchmarks themselves are added to this suite by the individual benchmark files
+BOOST_AUTO_TEST_SUITE( Benchmark, POV_BENCHMARK_SUITE )
+BOOST_AUTO_TEST_SUITE_END()
+
+}
+// end of namespace pov_benchmark
@@ -0,0 +1,128 @@
+//******************************************************************************
+///
+/// @file tests/source/benchmark.h
+///
+/// Common declarations for POV-Ray micro-benchmarks.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+#ifndef POVRAY_BENCHMARK_H
+#define POVRAY_BENCHMARK_H
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include "tests.h"
+
+#include "core/coretypes.h"
+
+/// Decorator for the micro-benchmark test suite.
+///
+/// Micro-benchmarks take a while to run, so they are disabled by default; run them explicitly
+/// with `--run_test=Benchmark`. The results are written to the file named by the
+/// `POV_BENCHMARK_FILE` environment variable, or `benchmark.json` if it is not set.
+///
+/// @note
+///     Boost.Test refuses to apply this decorator to the same suite more than once, so it is
+///     only used in `benchmark.cpp`; the individual benchmark files re-open the `Benchmark`
+///     suite without it.
+///
+#define POV_BENCHMARK_SUITE * boost::unit_test::disabled()
+
+namespace pov_benchmark
+{
+
+/// Minimum time a single benchmark is run for, in seconds.
+const double kMinSeconds = 0.2;
+
+/// Maximum number of iterations a single benchmark is run for.
+const POV_ULONG kMaxIterations = 1000000000;
+
+/// Result of a single benchmark.
+struct Result final
+{
+    std::string group;      ///< Group the benchmark belongs to, e.g. `shape`.
+    std::string name;       ///< Name of the benchmark within its group.
+    POV_ULONG   iterations; ///< Number of operations timed.
+    double      seconds;    ///< Total time taken.
+};
+
+/// Record the result of a benchmark, to be written when all benchmarks have completed.
+void Report(const Result& result);
+
+/// Keep the compiler from optimizing away a value, along with the computations leading to it.
+void Consume(double value);
+
+/// Time an operation.
+///
+/// The operation is run with a growing number of iterations until a run takes at least
+/// @ref kMinSeconds, and the final run is reported.
+///
+/// @param  group   Group the benchmark belongs to, e.g. `shape`.
+/// @param  name    Name of the benchmark within its group.
+/// @param  op      Callable taking an iteration count, running the operation that many times,
+///                 and returning a value computed from the results of the operations.
+///
+template<typename OP>
+void Measure(const std::string& group, const std::string& name, OP op)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    POV_ULONG iterations = 1;
+
+    while (true)
+    {
+        Clock::time_point start = Clock::now();
+        Consume(op(iterations));
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        if ((seconds >= kMinSeconds) || (iterations >= kMaxIterations))
+        {
+            Report(Result{ group, name, iterations, seconds });
+            return;
+        }
+
+        // aim a bit beyond the minimum time, but grow by at most tenfold per run
+        POV_ULONG next = iterations * 10;
+        if (seconds > 0.0)
+            next = std::min(next, static_cast<POV_ULONG>(iterations * kMinSeconds * 1.2 / seconds) + 1);
+        iterations = std::min(std::max(next, iterations + 1), kMaxIterations);
+    }
+}
+
+/// Create thread data for an empty scene with default settings.
+std::shared_ptr<pov::TraceThreadData> CreateThreadData();
+
+}
+// end of namespace pov_benchmark
+
+#endif // POVRAY_BENCHMARK_H
@@ -0,0 +1,219 @@
+//******************************************************************************
+///
+/// @file tests/source/benchmark_bbox.cpp
+///
+/// POV-Ray micro-benchmarks for the bounding box hierarchy (@ref core/bounding/boundingbox.cpp).
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+#include <memory>
+#include <random>
+#include <vector>
+
+// configcore.h must always be the first POV file included within core *.cpp files;
+// benchmark.h must follow suite.
+#include "core/configcore.h"
+#include "benchmark.h"
+
+#include "core/bounding/boundingbox.h"
+#include "core/render/ray.h"
+#include "core/render/trace.h"
+#include "core/scene/tracethreaddata.h"
+#include "core/shape/sphere.h"
+
+// this must be the last file included
+#include "base/povdebug.h"
+
+using namespace pov;
+
+namespace pov_benchmark
+{
+
+/// Number of distinct rays shot at the boxes or scene.
+const size_t kBBoxRays = 1024;
+
+/// Number of boxes per slab test, matching the maximum number of children of a bounding tree node.
+const unsigned int kBBoxGroup = 4;
+
+/// Number of box groups.
+const size_t kBBoxGroups = 256;
+
+/// Number of spheres in the traversal scene.
+const size_t kBBoxSpheres = 10000;
+
+/// Random rays from points around the unit cube towards points inside it.
+static std::vector<BasicRay> MakeRays(std::mt19937& rng)
+{
+    std::uniform_real_distribution<DBL> uniform(-1.0, 1.0);
+    std::vector<BasicRay> rays;
+    for (size_t i = 0; i < kBBoxRays; ++i)
+    {
+        Vector3d target(uniform(rng), uniform(rng), uniform(rng));
+        Vector3d origin(uniform(rng), uniform(rng), uniform(rng));
+        if (origin.IsNearNull(EPSILON))
+            origin = Vector3d(0.0, 0.0, 1.0);
+        origin = origin.normalized() * 5.0;
+        rays.push_back(BasicRay(origin, (target - origin).normalized()));
+    }
+    return rays;
+}
+
+/// Test groups of boxes against rays, once box by box and once with each optimized kernel.
+static void MeasureSlabs()
+{
+    std::shared_ptr<TraceThreadData> threadData(CreateThreadData());
+
+    std::mt19937 rng(4711);
+    std::uniform_real_distribution<DBL> position(-1.0, 1.0);
+    std::uniform_real_distribution<DBL> extent(0.05, 0.5);
+
+    std::vector<BoundingBox> boxes(kBBoxGroups * kBBoxGroup);
+    for (BoundingBox& box : boxes)
+        Make_BBox(box, position(rng), position(rng), position(rng), extent(rng), extent(rng), extent(rng));
+
+    std::vector<Rayinfo> rayinfos;
+    for (const BasicRay& ray : MakeRays(rng))
+        rayinfos.push_back(Rayinfo(ray));
+
+    Measure("bbox", "slabs/portable", [&](POV_ULONG iterations)
+    {
+        DBL sum = 0.0;
+        DBL dmin;
+        for (POV_ULONG i = 0; i < iterations; ++i)
+        {
+            const Rayinfo& rayinfo = rayinfos[i % kBBoxRays];
+            const BoundingBox *group = &boxes[(i % kBBoxGroups) * kBBoxGroup];
+            for (unsigned int j = 0; j < kBBoxGroup; ++j)
+                if (Intersect_BBox_Slabs(&group[j], &rayinfo, dmin, threadData->Stats()))
+                    sum += dmin;
+        }
+        return sum;
+    });
+
+#ifdef TRY_OPTIMIZED_BBOX
+    std::vector<const BoundingBox*> pointers;
+    for (const BoundingBox& box : boxes)
+        pointers.push_back(&box);
+
+    for (const OptimizedBBoxInfo* info = gaOptimizedBBoxInfo; info->name != nullptr; ++info)
+    {
+        if ((info->enabled != nullptr) && !*info->enabled)
+            continue;
+        if ((info->supported != nullptr) && !info->supported())
+            continue;
+        Measure("bbox", std::string("slabs/") + info->name, [&](POV_ULONG iterations)
+        {
+            DBL sum = 0.0;
+            DBL dmin[kMaxOptimizedBBoxes];
+            for (POV_ULONG i = 0; i < iterations; ++i)
+            {
+                const Rayinfo& rayinfo = rayinfos[i % kBBoxRays];
+                unsigned int hits = info->intersect(&pointers[(i % kBBoxGroups) * kBBoxGroup], kBBoxGroup, rayinfo, dmin);
+                for (unsigned int j = 0; j < kBBoxGroup; ++j)
+                    if (hits & (1u << j))
+                        sum += dmin[j];
+            }
+            return sum;
+        });
+    }
+#endif
+}
+
+/// Find the closest intersection of rays with a cloud of small spheres through the whole
+/// bounding hierarchy.
+static void MeasureTraversal()
+{
+    std::shared_ptr<TraceThreadData> threadData(CreateThreadData());
+
+    std::mt19937 rng(4711);
+    std::uniform_real_distribution<DBL> position(-1.0, 1.0);
+    std::uniform_real_distribution<DBL> radius(0.005, 0.02);
+
+    std::vector<ObjectPtr> objects;
+    for (size_t i = 0; i < kBBoxSpheres; ++i)
+    {
+        Sphere *sphere = new Sphere();
+        sphere->Center = Vector3d(position(rng), position(rng), position(rng));
+        sphere->Radius = radius(rng);
+        sphere->Compute_BBox();
+        objects.push_back(sphere);
+    }
+
+    BBOX_TREE *root = nullptr;
+    unsigned int numberOfFiniteObjects, numberOfInfiniteObjects, numberOfLightSources;
+    Build_Bounding_Slabs(&root, objects, numberOfFiniteObjects, numberOfInfiniteObjects, numberOfLightSources);
+
+    std::vector<BasicRay> rays(MakeRays(rng));
+    BBoxPriorityQueue pqueue;
+    TraceTicket ticket(5, 0.0);
+    Ray ray(ticket);
+    POV_ULONG hits = 0;
+
+    Measure("bbox", "traversal", [&](POV_ULONG iterations)
+    {
+        DBL depths = 0.0;
+        for (POV_ULONG i = 0; i < iterations; ++i)
+        {
+            const BasicRay& r = rays[i % kBBoxRays];
+            ray.Origin = r.Origin;
+            ray.Direction = r.Direction;
+            Intersection best;
+            if (Intersect_BBox_Tree(pqueue, root, ray, &best, threadData.get()))
+            {
+                depths += best.Depth;
+                ++hits;
+            }
+        }
+        return depths;
+    });
+
+    BOOST_CHECK_MESSAGE( hits > 0, "Sphere cloud was never hit." );
+
+    Destroy_BBox_Tree(root);
+    for (ObjectPtr object : objects)
+        delete object;
+}
+
+BOOST_AUTO_TEST_SUITE( Benchmark )
+
+    BOOST_AUTO_TEST_CASE( BBoxSlabs )
+    {
+        MeasureSlabs();
+    }
+
+    BOOST_AUTO_TEST_CASE( BBoxTraversal )
+    {
+        MeasureTraversal();
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
+// end of namespace pov_benchmark
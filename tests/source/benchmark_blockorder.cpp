@@ -0,0 +1,181 @@
+//******************************************************************************
+///
+/// @file tests/source/benchmark_blockorder.cpp
+///
+/// POV-Ray micro-benchmarks for the render patterns (@ref backend/scene/view.cpp).
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+// configcore.h must always be the first POV file included within core *.cpp files;
+// benchmark.h must follow suite.
+#include "core/configcore.h"
+#include "benchmark.h"
+
+#include "base/timer.h"
+
+#include "core/bounding/boundingbox.h"
+#include "core/render/ray.h"
+#include "core/render/trace.h"
+#include "core/scene/tracethreaddata.h"
+#include "core/shape/sphere.h"
+
+#include "backend/scene/view.h"
+
+// this must be the last file included
+#include "base/povdebug.h"
+
+using namespace pov;
+
+namespace pov_benchmark
+{
+
+/// Number of spheres in the scene; enough for the bounding hierarchy to exceed the caches.
+const size_t kOrderSpheres = 100000;
+
+/// Width and height of the image, in pixels.
+const unsigned int kOrderImageSize = 512;
+
+/// Width and height of a block, in pixels, matching the default render block size.
+const unsigned int kOrderBlockSize = 32;
+
+/// Trace the primary rays of an image in the order given by a render pattern.
+///
+/// Each iteration traces all primary rays of the image through the bounding hierarchy of a large
+/// cloud of small spheres, visiting the blocks in the given order and the pixels of each block row
+/// by row. Besides the time per image, the last level cache misses per ray are reported where the
+/// platform can count them.
+///
+static void MeasureBlockOrder(const std::string& name, const std::vector<unsigned int>& blockOrder,
+                              BBOX_TREE *root, TraceThreadData *threadData)
+{
+    const unsigned int blocks = kOrderImageSize / kOrderBlockSize;
+
+    std::vector<unsigned int> pixels;
+    pixels.reserve(kOrderImageSize * kOrderImageSize);
+    for (unsigned int block : blockOrder)
+    {
+        unsigned int left = (block % blocks) * kOrderBlockSize;
+        unsigned int top  = (block / blocks) * kOrderBlockSize;
+        for (unsigned int y = top; y < top + kOrderBlockSize; ++y)
+            for (unsigned int x = left; x < left + kOrderBlockSize; ++x)
+                pixels.push_back(y * kOrderImageSize + x);
+    }
+    BOOST_REQUIRE_EQUAL( pixels.size(), kOrderImageSize * kOrderImageSize );
+
+    BBoxPriorityQueue pqueue;
+    TraceTicket ticket(5, 0.0);
+    Ray ray(ticket);
+    ray.Origin = Vector3d(0.0, 0.0, -4.0);
+
+    auto trace = [&](POV_ULONG iterations)
+    {
+        DBL depths = 0.0;
+        for (POV_ULONG i = 0; i < iterations * pixels.size(); ++i)
+        {
+            unsigned int pixel = pixels[i % pixels.size()];
+            DBL u = ((pixel % kOrderImageSize) + 0.5) / kOrderImageSize - 0.5;
+            DBL v = ((pixel / kOrderImageSize) + 0.5) / kOrderImageSize - 0.5;
+            ray.Direction = Vector3d(u * 0.6, v * 0.6, 1.0).normalized();
+            Intersection best;
+            if (Intersect_BBox_Tree(pqueue, root, ray, &best, threadData))
+                depths += best.Depth;
+        }
+        return depths;
+    };
+
+    Measure("blockorder", name, trace);
+
+    PerformanceCounters counters;
+    Consume(trace(1));
+    POV_LONG misses = counters.Elapsed().count[PerformanceCounts::kCacheMisses];
+    if (misses >= 0)
+        BOOST_TEST_MESSAGE( "blockorder/" << name << ": " << (double)misses / pixels.size() << " cache misses per ray" );
+}
+
+/// Compare the render patterns that visit the image blocks in different orders.
+static void MeasureBlockOrders()
+{
+    std::shared_ptr<TraceThreadData> threadData(CreateThreadData());
+
+    std::mt19937 rng(4711);
+    std::uniform_real_distribution<DBL> position(-1.0, 1.0);
+    std::uniform_real_distribution<DBL> radius(0.002, 0.008);
+
+    std::vector<ObjectPtr> objects;
+    for (size_t i = 0; i < kOrderSpheres; ++i)
+    {
+        Sphere *sphere = new Sphere();
+        sphere->Center = Vector3d(position(rng), position(rng), position(rng));
+        sphere->Radius = radius(rng);
+        sphere->Compute_BBox();
+        objects.push_back(sphere);
+    }
+
+    BBOX_TREE *root = nullptr;
+    unsigned int numberOfFiniteObjects, numberOfInfiniteObjects, numberOfLightSources;
+    Build_Bounding_Slabs(&root, objects, numberOfFiniteObjects, numberOfInfiniteObjects, numberOfLightSources);
+
+    const unsigned int blocks = kOrderImageSize / kOrderBlockSize;
+    std::vector<unsigned int> order;
+
+    // render pattern 0
+    for (unsigned int i = 0; i < blocks * blocks; ++i)
+        order.push_back(i);
+    MeasureBlockOrder("rows", order, root, threadData.get());
+
+    // render pattern 8
+    GetHilbertBlockOrder(blocks, blocks, order);
+    MeasureBlockOrder("hilbert", order, root, threadData.get());
+
+    // render pattern 9
+    GetMortonBlockOrder(blocks, blocks, order);
+    MeasureBlockOrder("morton", order, root, threadData.get());
+
+    Destroy_BBox_Tree(root);
+    for (ObjectPtr object : objects)
+        delete object;
+}
+
+BOOST_AUTO_TEST_SUITE( Benchmark )
+
+    BOOST_AUTO_TEST_CASE( BlockOrder )
+    {
+        MeasureBlockOrders();
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
+// end of namespace pov_benchmark
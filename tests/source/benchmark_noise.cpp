@@ -0,0 +1,117 @@
+//******************************************************************************
+///
+/// @file tests/source/benchmark_noise.cpp
+///
+/// POV-Ray micro-benchmarks for the noise generator implementations.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+#include <random>
+#include <string>
+#include <vector>
+
+// configcore.h must always be the first POV file included within core *.cpp files;
+// benchmark.h must follow suite.
+#include "core/configcore.h"
+#include "benchmark.h"
+
+#include "core/material/noise.h"
+
+// this must be the last file included
+#include "base/povdebug.h"
+
+using namespace pov;
+
+namespace pov_benchmark
+{
+
+/// Number of distinct points at which the noise is evaluated.
+const size_t kNoisePoints = 1024;
+
+typedef DBL(*NoiseFn) (const Vector3d& EPoint, int noise_generator);
+typedef void(*DNoiseFn) (Vector3d& result, const Vector3d& EPoint);
+
+/// Benchmark one noise generator implementation.
+static void MeasureNoise(const std::string& name, NoiseFn noise, DNoiseFn dNoise)
+{
+    std::mt19937 rng(4711);
+    std::uniform_real_distribution<DBL> uniform(-100.0, 100.0);
+    std::vector<Vector3d> points;
+    for (size_t i = 0; i < kNoisePoints; ++i)
+        points.push_back(Vector3d(uniform(rng), uniform(rng), uniform(rng)));
+
+    for (int generator = kNoiseGen_Min; generator <= kNoiseGen_Max; ++generator)
+    {
+        Measure("noise", name + "/noise" + std::to_string(generator), [&](POV_ULONG iterations)
+        {
+            DBL sum = 0.0;
+            for (POV_ULONG i = 0; i < iterations; ++i)
+                sum += noise(points[i % kNoisePoints], generator);
+            return sum;
+        });
+    }
+
+    Measure("noise", name + "/dnoise", [&](POV_ULONG iterations)
+    {
+        Vector3d sum(0.0);
+        Vector3d result;
+        for (POV_ULONG i = 0; i < iterations; ++i)
+        {
+            dNoise(result, points[i % kNoisePoints]);
+            sum += result;
+        }
+        return sum.x() + sum.y() + sum.z();
+    });
+}
+
+BOOST_AUTO_TEST_SUITE( Benchmark )
+
+    BOOST_AUTO_TEST_CASE( Noise )
+    {
+        MeasureNoise("portable", PortableNoise, PortableDNoise);
+
+#ifdef TRY_OPTIMIZED_NOISE
+        for (const OptimizedNoiseInfo* info = gaOptimizedNoiseInfo; info->name != nullptr; ++info)
+        {
+            if ((info->enabled != nullptr) && !*info->enabled)
+                continue;
+            if ((info->supported != nullptr) && !info->supported())
+                continue;
+            if (info->init != nullptr)
+                info->init();
+            MeasureNoise(info->name, info->noise, info->dNoise);
+        }
+#endif
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
+// end of namespace pov_benchmark
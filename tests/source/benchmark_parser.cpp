@@ -0,0 +1,149 @@
+//******************************************************************************
+///
+/// @file tests/source/benchmark_parser.cpp
+///
+/// POV-Ray micro-benchmarks for the parser.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+// configparser.h must always be the first POV file included within parser *.cpp files;
+// benchmark.h must follow suite.
+#include "parser/configparser.h"
+#include "benchmark.h"
+
+#include "base/fileinputoutput.h"
+#include "parser/rawtokenizer.h"
+
+// this must be the last file included
+#include "base/povdebug.h"
+
+using namespace pov_base;
+using namespace pov_parser;
+
+namespace pov_benchmark
+{
+
+/// Number of distinct float literals used.
+const size_t kLiterals = 4096;
+
+/// Generate float literals as typically found in scene files and exported meshes.
+static std::vector<std::string> MakeFloatLiterals()
+{
+    std::mt19937 rng(4711);
+    std::uniform_real_distribution<double> uniform(-100.0, 100.0);
+    std::vector<std::string> literals;
+    char buffer[32];
+    for (size_t i = 0; i < kLiterals; ++i)
+    {
+        switch (i % 4)
+        {
+            case 0:  std::snprintf(buffer, sizeof(buffer), "%d", int(uniform(rng)) & 0xFF); break;
+            case 1:  std::snprintf(buffer, sizeof(buffer), "%.3f", fabs(uniform(rng))); break;
+            case 2:  std::snprintf(buffer, sizeof(buffer), "%.6f", fabs(uniform(rng))); break;
+            default: std::snprintf(buffer, sizeof(buffer), "%.9e", fabs(uniform(rng))); break;
+        }
+        literals.push_back(buffer);
+    }
+    return literals;
+}
+
+BOOST_AUTO_TEST_SUITE( Benchmark )
+
+    BOOST_AUTO_TEST_CASE( FloatLiterals )
+    {
+        std::vector<std::string> literals = MakeFloatLiterals();
+
+        Measure("parser", "float_literal", [&](POV_ULONG iterations)
+        {
+            double sum = 0.0;
+            for (POV_ULONG i = 0; i < iterations; ++i)
+            {
+                double value;
+                if (FastFloatLiteralToDouble(literals[i % kLiterals], value))
+                    sum += value;
+            }
+            return sum;
+        });
+
+        Measure("parser", "float_literal/sscanf", [&](POV_ULONG iterations)
+        {
+            double sum = 0.0;
+            for (POV_ULONG i = 0; i < iterations; ++i)
+            {
+                double value;
+                if (std::sscanf(literals[i % kLiterals].c_str(), "%lf", &value) == 1)
+                    sum += value;
+            }
+            return sum;
+        });
+    }
+
+    // raw tokenizer throughput on a list of vectors, as found in exported meshes;
+    // one iteration is one token
+    BOOST_AUTO_TEST_CASE( Tokenizer )
+    {
+        std::vector<std::string> literals = MakeFloatLiterals();
+        std::string text;
+        for (size_t i = 0; i + 2 < kLiterals; i += 3)
+            text += "<" + literals[i] + ", " + literals[i + 1] + ", " + literals[i + 2] + ">,\n";
+        const unsigned char* data = reinterpret_cast<const unsigned char*>(text.data());
+
+        Measure("parser", "tokenize", [&](POV_ULONG iterations)
+        {
+            double sum = 0.0;
+            RawTokenizer tokenizer;
+            RawToken token;
+            for (POV_ULONG i = 0; i < iterations; ++i)
+            {
+                if (!tokenizer.GetNextToken(token))
+                {
+                    // start over; a stream not starting at offset 0 bypasses the token cache,
+                    // so that the input is scanned afresh each time
+                    tokenizer.SetInputStream(std::make_shared<IMemStream>(data, text.size(), "benchmark.inc", 1));
+                    (void)tokenizer.GetNextToken(token);
+                }
+                if (token.lexeme.category == Lexeme::kFloatLiteral)
+                    sum += token.floatValue;
+            }
+            return sum;
+        });
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
+// end of namespace pov_benchmark
@@ -0,0 +1,119 @@
+//******************************************************************************
+///
+/// @file tests/source/benchmark_patterns.cpp
+///
+/// POV-Ray micro-benchmarks for pattern evaluation.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+#include <memory>
+#include <random>
+#include <vector>
+
+// configcore.h must always be the first POV file included within core *.cpp files;
+// benchmark.h must follow suite.
+#include "core/configcore.h"
+#include "benchmark.h"
+
+#include "core/material/pattern.h"
+#include "core/scene/tracethreaddata.h"
+
+// this must be the last file included
+#include "base/povdebug.h"
+
+using namespace pov;
+
+namespace pov_benchmark
+{
+
+/// Number of distinct points at which each pattern is evaluated.
+const size_t kPatternPoints = 1024;
+
+/// Evaluate a pattern at random points, without any warps.
+static void MeasurePattern(const char *name, const PatternPtr& pattern)
+{
+    std::shared_ptr<TraceThreadData> threadData(CreateThreadData());
+
+    BOOST_CHECK_MESSAGE( pattern->Precompute(), name << " failed to precompute." );
+
+    std::mt19937 rng(4711);
+    std::uniform_real_distribution<DBL> uniform(-2.0, 2.0);
+    std::vector<Vector3d> points;
+    for (size_t i = 0; i < kPatternPoints; ++i)
+        points.push_back(Vector3d(uniform(rng), uniform(rng), uniform(rng)));
+
+    Measure("pattern", name, [&](POV_ULONG iterations)
+    {
+        DBL sum = 0.0;
+        for (POV_ULONG i = 0; i < iterations; ++i)
+            sum += pattern->Evaluate(points[i % kPatternPoints], nullptr, nullptr, threadData.get());
+        return sum;
+    });
+}
+
+BOOST_AUTO_TEST_SUITE( Benchmark )
+
+    BOOST_AUTO_TEST_CASE( Patterns )
+    {
+        MeasurePattern("boxed",         std::make_shared<BoxedPattern>());
+        MeasurePattern("bozo",          std::make_shared<BozoPattern>());
+        MeasurePattern("brick",         std::make_shared<BrickPattern>());
+        MeasurePattern("bumps",         std::make_shared<BumpsPattern>());
+        MeasurePattern("cells",         std::make_shared<CellsPattern>());
+        MeasurePattern("checker",       std::make_shared<CheckerPattern>());
+        MeasurePattern("crackle",       std::make_shared<CracklePattern>());
+        MeasurePattern("cylindrical",   std::make_shared<CylindricalPattern>());
+        MeasurePattern("dents",         std::make_shared<DentsPattern>());
+        MeasurePattern("granite",       std::make_shared<GranitePattern>());
+        MeasurePattern("hexagon",       std::make_shared<HexagonPattern>());
+        MeasurePattern("leopard",       std::make_shared<LeopardPattern>());
+        MeasurePattern("marble",        std::make_shared<MarblePattern>());
+        MeasurePattern("onion",         std::make_shared<OnionPattern>());
+        MeasurePattern("planar",        std::make_shared<PlanarPattern>());
+        MeasurePattern("quilted",       std::make_shared<QuiltedPattern>());
+        MeasurePattern("radial",        std::make_shared<RadialPattern>());
+        MeasurePattern("ripples",       std::make_shared<RipplesPattern>());
+        MeasurePattern("spherical",     std::make_shared<SphericalPattern>());
+        MeasurePattern("spotted",       std::make_shared<SpottedPattern>());
+        MeasurePattern("square",        std::make_shared<SquarePattern>());
+        MeasurePattern("triangular",    std::make_shared<TriangularPattern>());
+        MeasurePattern("waves",         std::make_shared<WavesPattern>());
+        MeasurePattern("wood",          std::make_shared<WoodPattern>());
+        MeasurePattern("wrinkles",      std::make_shared<WrinklesPattern>());
+
+        std::shared_ptr<GradientPattern> gradient(std::make_shared<GradientPattern>());
+        gradient->gradient = Vector3d(0.0, 1.0, 0.0);
+        MeasurePattern("gradient", gradient);
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
+// end of namespace pov_benchmark
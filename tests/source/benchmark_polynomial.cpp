@@ -0,0 +1,168 @@
+//******************************************************************************
+///
+/// @file tests/source/benchmark_polynomial.cpp
+///
+/// POV-Ray micro-benchmarks for the polynomial solver.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+// configcore.h must always be the first POV file included within core *.cpp files;
+// benchmark.h must follow suite.
+#include "core/configcore.h"
+#include "benchmark.h"
+
+#include "core/math/polynomialsolver.h"
+#include "core/support/statistics.h"
+
+// this must be the last file included
+#include "base/povdebug.h"
+
+using namespace pov;
+
+namespace pov_benchmark
+{
+
+/// Number of distinct polynomials solved per order.
+const size_t kPolynomials = 256;
+
+/// Number of polynomials solved per call in the batched benchmarks.
+const size_t kBatchSize = 16;
+
+/// Generate the coefficients of @ref kPolynomials polynomials of a given order.
+///
+/// Half of the polynomials are built from real roots in [-2,2], the other half have random
+/// coefficients, so that both the root isolation and the root refinement are exercised.
+///
+static std::vector<DBL> MakePolynomials(int order)
+{
+    std::mt19937 rng(4711);
+    std::uniform_real_distribution<DBL> uniform(-2.0, 2.0);
+    std::vector<DBL> coeffs;
+    for (size_t i = 0; i < kPolynomials; ++i)
+    {
+        std::vector<DBL> c(order + 1, 0.0);
+        c[0] = 1.0;
+        if (i % 2 == 0)
+        {
+            // multiply by (x - root) for each root in turn
+            for (int n = 1; n <= order; ++n)
+            {
+                DBL root = uniform(rng);
+                for (int k = n; k > 0; --k)
+                    c[k] -= root * c[k - 1];
+            }
+        }
+        else
+        {
+            for (int k = 1; k <= order; ++k)
+                c[k] = uniform(rng);
+        }
+        coeffs.insert(coeffs.end(), c.begin(), c.end());
+    }
+    return coeffs;
+}
+
+/// Solve polynomials of a given order one at a time.
+static void MeasurePolynomial(int order, bool sturm)
+{
+    std::vector<DBL> coeffs = MakePolynomials(order);
+
+    RenderStatistics stats;
+    std::string name = "order" + std::to_string(order) + (sturm ? "/sturm" : "");
+    Measure("polynomial", name, [&](POV_ULONG iterations)
+    {
+        DBL roots[MAX_ORDER];
+        DBL sum = 0.0;
+        for (POV_ULONG i = 0; i < iterations; ++i)
+        {
+            int n = Solve_Polynomial(order, &coeffs[(i % kPolynomials) * (order + 1)], roots, sturm, 1.0e-10, stats);
+            for (int k = 0; k < n; ++k)
+                sum += roots[k];
+        }
+        return sum;
+    });
+}
+
+/// Solve polynomials of a given order in batches of @ref kBatchSize.
+///
+/// Each iteration is still a single polynomial, so the results compare directly to those of
+/// @ref MeasurePolynomial().
+///
+static void MeasurePolynomialBatch(int order, bool sturm)
+{
+    std::vector<DBL> coeffs = MakePolynomials(order);
+
+    RenderStatistics stats;
+    std::string name = "order" + std::to_string(order) + (sturm ? "/sturm" : "") + "/batch" + std::to_string(kBatchSize);
+    Measure("polynomial", name, [&](POV_ULONG iterations)
+    {
+        DBL roots[MAX_ORDER * kBatchSize];
+        int numRoots[kBatchSize];
+        DBL sum = 0.0;
+        for (POV_ULONG i = 0; i < iterations; )
+        {
+            size_t first = i % kPolynomials;
+            unsigned int count = (unsigned int)std::min<POV_ULONG>(std::min(kBatchSize, kPolynomials - first), iterations - i);
+            Solve_Polynomials(order, count, &coeffs[first * (order + 1)], roots, numRoots, sturm, 1.0e-10, stats);
+            for (unsigned int j = 0; j < count; ++j)
+                for (int k = 0; k < numRoots[j]; ++k)
+                    sum += roots[j * order + k];
+            i += count;
+        }
+        return sum;
+    });
+}
+
+BOOST_AUTO_TEST_SUITE( Benchmark )
+
+    BOOST_AUTO_TEST_CASE( Polynomials )
+    {
+        for (int order = 2; order <= 4; ++order)
+            MeasurePolynomial(order, false);
+        for (int order = 3; order <= 8; ++order)
+            MeasurePolynomial(order, true);
+    }
+
+    BOOST_AUTO_TEST_CASE( PolynomialBatches )
+    {
+        // quadratics take the batched path, the others fall back to solving one at a time
+        MeasurePolynomialBatch(2, true);
+        MeasurePolynomialBatch(4, true);
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
+// end of namespace pov_benchmark
@@ -0,0 +1,178 @@
+//******************************************************************************
+///
+/// @file tests/source/benchmark_shapes.cpp
+///
+/// POV-Ray micro-benchmarks for ray-shape intersection tests.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+#include <memory>
+#include <random>
+#include <vector>
+
+// configcore.h must always be the first POV file included within core *.cpp files;
+// benchmark.h must follow suite.
+#include "core/configcore.h"
+#include "benchmark.h"
+
+#include "core/render/ray.h"
+#include "core/render/trace.h"
+#include "core/scene/tracethreaddata.h"
+#include "core/shape/box.h"
+#include "core/shape/cone.h"
+#include "core/shape/disc.h"
+#include "core/shape/plane.h"
+#include "core/shape/sphere.h"
+#include "core/shape/superellipsoid.h"
+#include "core/shape/torus.h"
+#include "core/shape/triangle.h"
+
+// this must be the last file included
+#include "base/povdebug.h"
+
+using namespace pov;
+
+namespace pov_benchmark
+{
+
+/// Number of distinct rays shot at each shape.
+const size_t kShapeRays = 1024;
+
+/// Shoot rays at a shape, from random points around it towards random points inside its
+/// bounding region, so that roughly half of the rays hit.
+static void MeasureShape(const char *name, ObjectPtr shape)
+{
+    std::unique_ptr<ObjectBase> owner(shape);
+    std::shared_ptr<TraceThreadData> threadData(CreateThreadData());
+
+    std::mt19937 rng(4711);
+    std::uniform_real_distribution<DBL> uniform(-1.0, 1.0);
+    std::vector<BasicRay> rays;
+    for (size_t i = 0; i < kShapeRays; ++i)
+    {
+        Vector3d target(uniform(rng), uniform(rng), uniform(rng));
+        Vector3d origin(uniform(rng), uniform(rng), uniform(rng));
+        if (origin.IsNearNull(EPSILON))
+            origin = Vector3d(0.0, 0.0, 1.0);
+        origin = origin.normalized() * 5.0;
+        rays.push_back(BasicRay(origin, (target * 1.5 - origin).normalized()));
+    }
+
+    TraceTicket ticket(5, 0.0);
+    Ray ray(ticket);
+    POV_ULONG hits = 0;
+
+    Measure("shape", name, [&](POV_ULONG iterations)
+    {
+        IStack depthstack(threadData->stackPool);
+        DBL depths = 0.0;
+        for (POV_ULONG i = 0; i < iterations; ++i)
+        {
+            const BasicRay& r = rays[i % kShapeRays];
+            ray.Origin = r.Origin;
+            ray.Direction = r.Direction;
+            if (shape->All_Intersections(ray, depthstack, threadData.get()))
+                ++hits;
+            while (!depthstack->empty())
+            {
+                depths += depthstack->top().Depth;
+                depthstack->pop();
+            }
+        }
+        return depths;
+    });
+
+    BOOST_CHECK_MESSAGE( hits > 0, name << " was never hit." );
+}
+
+BOOST_AUTO_TEST_SUITE( Benchmark )
+
+    BOOST_AUTO_TEST_CASE( Shapes )
+    {
+        MeasureShape("box", new Box());
+
+        Cone *cone = new Cone();
+        cone->apex_radius = 0.0;
+        cone->base_radius = 1.0;
+        cone->apex = Vector3d(0.0,  1.0, 0.0);
+        cone->base = Vector3d(0.0, -1.0, 0.0);
+        cone->Compute_Cone_Data();
+        cone->Compute_BBox();
+        MeasureShape("cone", cone);
+
+        Cone *cylinder = new Cone();
+        cylinder->Cylinder();
+        cylinder->apex = Vector3d(0.0,  1.0, 0.0);
+        cylinder->base = Vector3d(0.0, -1.0, 0.0);
+        cylinder->apex_radius = cylinder->base_radius = 1.0;
+        cylinder->Compute_Cylinder_Data();
+        cylinder->Compute_BBox();
+        MeasureShape("cylinder", cylinder);
+
+        Disc *disc = new Disc();
+        disc->normal = Vector3d(0.0, 1.0, 0.0);
+        disc->Compute_Disc();
+        MeasureShape("disc", disc);
+
+        MeasureShape("plane", new Plane());
+
+        Sphere *sphere = new Sphere();
+        sphere->Compute_BBox();
+        MeasureShape("sphere", sphere);
+
+        Superellipsoid *superellipsoid = new Superellipsoid();
+        superellipsoid->Power = Vector3d(2.0 / 0.25, 0.25 / 0.25, 2.0 / 0.25);
+        superellipsoid->Compute_BBox();
+        MeasureShape("superellipsoid", superellipsoid);
+
+        Superellipsoid *superellipsoidNewton = new Superellipsoid();
+        superellipsoidNewton->Power = Vector3d(2.0 / 0.25, 0.25 / 0.25, 2.0 / 0.25);
+        superellipsoidNewton->Method = 2;
+        superellipsoidNewton->Compute_BBox();
+        MeasureShape("superellipsoid_newton", superellipsoidNewton);
+
+        Torus *torus = new Torus();
+        torus->MajorRadius = 0.75;
+        torus->MinorRadius = 0.25;
+        torus->Compute_BBox();
+        MeasureShape("torus", torus);
+
+        Triangle *triangle = new Triangle();
+        triangle->P1 = Vector3d(-1.0, -1.0, 0.0);
+        triangle->P2 = Vector3d( 1.0, -1.0, 0.0);
+        triangle->P3 = Vector3d( 0.0,  1.0, 0.0);
+        triangle->Compute_Triangle();
+        MeasureShape("triangle", triangle);
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
+// end of namespace pov_benchmark
@@ -0,0 +1,248 @@
+//******************************************************************************
+///
+/// @file tests/source/benchmark_vm.cpp
+///
+/// POV-Ray micro-benchmarks for the user-defined function virtual machine.
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+// configcore.h must always be the first POV file included within core *.cpp files;
+// benchmark.h must follow suite.
+#include "core/configcore.h"
+#include "benchmark.h"
+
+#include "base/pov_mem.h"
+
+#include "core/scene/tracethreaddata.h"
+
+#include "vm/fnpovfpu.h"
+
+// this must be the last file included
+#include "base/povdebug.h"
+
+using namespace pov;
+
+namespace pov_benchmark
+{
+
+/// Number of distinct argument sets the functions are run with.
+const size_t kFunctionArguments = 1024;
+
+/// Number of times the body of each test program is repeated.
+const int kProgramRepeat = 16;
+
+/// Hand-assembled function program, taking `x`, `y` and `z` and returning its result in `r0`.
+///
+/// The prologue follows the code generated by the function compiler, loading the arguments into
+/// `r2`, `r3` and `r4`; `r0` starts out as `x`. All arguments are in the range [0.5, 1.5].
+///
+class Program final
+{
+    public:
+        Program()
+        {
+            Emit(OPCODE_GROW, 0, 0, 3);
+            Emit(OPCODE_LOAD, 1, 2, 0);
+            Emit(OPCODE_LOAD, 1, 3, 1);
+            Emit(OPCODE_LOAD, 1, 4, 2);
+            Emit(OPCODE_MOVE, 2, 0);
+        }
+
+        void Emit(unsigned int op, unsigned int rs, unsigned int rd, unsigned int k = 0)
+        {
+            code.push_back(MAKE_INSTRUCTION(op | (rs << 3) | rd, k));
+        }
+
+        unsigned int Position() const { return code.size(); }
+
+        FUNCTION_PTR Add(FunctionVM *vm, const char *name)
+        {
+            Emit(OPCODE_RTS, 0, 0);
+
+            FunctionCode f;
+            f.program = reinterpret_cast<Instruction *>(POV_MALLOC(sizeof(Instruction) * code.size(), "fn: program"));
+            std::memcpy(f.program, code.data(), sizeof(Instruction) * code.size());
+            f.program_size = code.size();
+            f.return_size = 0; // zero implies return in register r0
+            f.parameter_cnt = 3;
+            f.localvar_cnt = 0;
+            for (int i = 0; i < MAX_FUNCTION_PARAMETER_LIST; i++)
+            {
+                f.localvar_pos[i] = 0;
+                f.localvar[i] = nullptr;
+                f.parameter[i] = nullptr;
+            }
+            f.sourceInfo.name = name;
+            f.flags = 0;
+            f.private_copy_method = nullptr;
+            f.private_destroy_method = nullptr;
+            f.private_data = nullptr;
+
+            return new FUNCTION(vm->AddFunction(&f));
+        }
+
+    private:
+        std::vector<Instruction> code;
+};
+
+/// Run a function with random arguments, both one argument set at a time and in batches.
+static void MeasureFunction(const char *name, FunctionVM *vm, Program& program)
+{
+    std::shared_ptr<TraceThreadData> threadData(CreateThreadData());
+    FunctionVM::CustomFunction function(vm, program.Add(vm, name));
+    GenericFunctionContextPtr context = function.AcquireContext(threadData.get());
+
+    std::mt19937 rng(4711);
+    std::uniform_real_distribution<DBL> uniform(0.5, 1.5);
+    std::vector<DBL> args;
+    for (size_t i = 0; i < kFunctionArguments * 3; ++i)
+        args.push_back(uniform(rng));
+
+    Measure("function", name, [&](POV_ULONG iterations)
+    {
+        DBL sum = 0.0;
+        for (POV_ULONG i = 0; i < iterations; ++i)
+        {
+            const DBL *arg = &args[(i % kFunctionArguments) * 3];
+            function.InitArguments(context);
+            function.PushArgument(context, arg[0]);
+            function.PushArgument(context, arg[1]);
+            function.PushArgument(context, arg[2]);
+            sum += function.Execute(context);
+        }
+        return sum;
+    });
+
+    Measure("function", std::string(name) + "/batch", [&](POV_ULONG iterations)
+    {
+        const unsigned int count = FUNCTION_BATCH_LANES;
+        DBL results[FUNCTION_BATCH_LANES];
+        DBL sum = 0.0;
+        for (POV_ULONG i = 0; i < iterations; i += count)
+        {
+            function.ExecuteBatch(context, &args[(i % (kFunctionArguments - count)) * 3], 3, count, results);
+            for (unsigned int k = 0; k < count; ++k)
+                sum += results[k];
+        }
+        return sum;
+    });
+
+    function.ReleaseContext(context);
+}
+
+BOOST_AUTO_TEST_SUITE( Benchmark )
+
+    BOOST_AUTO_TEST_CASE( Functions )
+    {
+        boost::intrusive_ptr<FunctionVM> vm(new FunctionVM());
+        unsigned int kHalf = vm->AddConstant(0.5);
+
+        // r0 = r0 * y + z - x
+        Program arith;
+        for (int i = 0; i < kProgramRepeat; ++i)
+        {
+            arith.Emit(OPCODE_MUL, 3, 0);
+            arith.Emit(OPCODE_ADD, 4, 0);
+            arith.Emit(OPCODE_SUB, 2, 0);
+        }
+        MeasureFunction("arith", vm.get(), arith);
+
+        // r0 = r0 * 0.5 + 1.0
+        Program immediate;
+        for (int i = 0; i < kProgramRepeat; ++i)
+        {
+            immediate.Emit(OPCODE_MULI, 0, 0, kHalf);
+            immediate.Emit(OPCODE_ADDI, 0, 0, 1); // constant 1 is always 1.0
+        }
+        MeasureFunction("immediate", vm.get(), immediate);
+
+        // r0 = r0 / y + z
+        Program divide;
+        for (int i = 0; i < kProgramRepeat; ++i)
+        {
+            divide.Emit(OPCODE_DIV, 3, 0);
+            divide.Emit(OPCODE_ADD, 4, 0);
+        }
+        MeasureFunction("divide", vm.get(), divide);
+
+        // r0 = (r0 + (y < r0)) * 0.5
+        Program compare;
+        for (int i = 0; i < kProgramRepeat; ++i)
+        {
+            compare.Emit(OPCODE_CMP, 3, 0);
+            compare.Emit(OPCODE_SGT, 0, 5);
+            compare.Emit(OPCODE_ADD, 5, 0);
+            compare.Emit(OPCODE_MULI, 0, 0, kHalf);
+        }
+        MeasureFunction("compare", vm.get(), compare);
+
+        // r0 = (y > r0 ? r0 : r0 + z) * 0.5
+        Program branch;
+        for (int i = 0; i < kProgramRepeat; ++i)
+        {
+            branch.Emit(OPCODE_CMP, 3, 0);
+            branch.Emit(OPCODE_BLT, 0, 0, branch.Position() + 2);
+            branch.Emit(OPCODE_ADD, 4, 0);
+            branch.Emit(OPCODE_MULI, 0, 0, kHalf);
+        }
+        MeasureFunction("branch", vm.get(), branch);
+
+        // r0 = sin(sqrt(r0) + x) + 2 * y
+        Program sys1;
+        for (int i = 0; i < kProgramRepeat; ++i)
+        {
+            sys1.Emit(OPCODE_SYS1, 0, 0, TRAP_SYS1_SQRT);
+            sys1.Emit(OPCODE_ADD, 2, 0);
+            sys1.Emit(OPCODE_SYS1, 0, 0, TRAP_SYS1_SIN);
+            sys1.Emit(OPCODE_ADD, 3, 0);
+            sys1.Emit(OPCODE_ADD, 3, 0);
+        }
+        MeasureFunction("sys1", vm.get(), sys1);
+
+        // r0 = atan2(r0, y) + z
+        Program sys2;
+        for (int i = 0; i < kProgramRepeat; ++i)
+        {
+            sys2.Emit(OPCODE_MOVE, 3, 1);
+            sys2.Emit(OPCODE_SYS2, 0, 0, TRAP_SYS2_ATAN2);
+            sys2.Emit(OPCODE_ADD, 4, 0);
+        }
+        MeasureFunction("sys2", vm.get(), sys2);
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
+// end of namespace pov_benchmark
@@ -0,0 +1,181 @@
+//******************************************************************************
+///
+/// @file tests/source/tests_encoding.cpp
+///
+/// POV-Ray unit tests for the bulk colour encoding (@ref base/image/encoding.cpp).
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <vector>
+
+// configbase.h must always be the first POV file included within base *.cpp files
+// (and as that's what we're testing, we should consider ourselves part of it);
+// tests.h must follow suite.
+#include "base/configbase.h"
+#include "tests.h"
+
+#include "base/image/colourspace.h"
+#include "base/image/dither.h"
+#include "base/image/encoding.h"
+#include "base/image/image.h"
+
+// this must be the last file included
+#include "base/povdebug.h"
+
+using namespace pov_base;
+
+BOOST_AUTO_TEST_SUITE( Encoding )
+
+    // a smooth gradient with some noise, slightly exceeding the encodable range
+    static Image* CreateTestImage(unsigned int width, unsigned int height)
+    {
+        std::mt19937 rng(4711);
+        std::uniform_real_distribution<float> noise(-0.05f, 0.05f);
+        Image* image = Image::Create(width, height, ImageDataType::RGBFT_Float, false);
+        for (unsigned int y = 0; y < height; ++y)
+            for (unsigned int x = 0; x < width; ++x)
+                image->SetRGBValue(x, y, float(x) / width + noise(rng),
+                                         float(y) / height + noise(rng),
+                                         float(x + y) / (width + height) * 1.1f - 0.05f);
+        return image;
+    }
+
+    static std::vector<unsigned int> EncodeImage(const Image* image, const GammaCurvePtr& gamma, unsigned int max,
+                                                 DitherMethodId method, unsigned int threads, unsigned int rowsPerCall)
+    {
+        unsigned int width  = image->GetWidth();
+        unsigned int height = image->GetHeight();
+        DitherStrategySPtr dither = GetDitherStrategy(method, width);
+        ImageRowEncoder encoder(image, gamma, max, true, false, false, *dither, threads);
+        std::vector<unsigned int> data(std::size_t(width) * height * encoder.Channels());
+        for (unsigned int y = 0; y < height; y += rowsPerCall)
+            encoder.EncodeRows(y, std::min(rowsPerCall, height - y), &data[std::size_t(y) * width * encoder.Channels()]);
+        return data;
+    }
+
+    static std::vector<unsigned int> EncodeImageByPixel(const Image* image, const GammaCurvePtr& gamma, unsigned int max,
+                                                        DitherMethodId method)
+    {
+        unsigned int width  = image->GetWidth();
+        unsigned int height = image->GetHeight();
+        DitherStrategySPtr dither = GetDitherStrategy(method, width);
+        std::vector<unsigned int> data;
+        unsigned int r, g, b;
+        for (unsigned int y = 0; y < height; ++y)
+            for (unsigned int x = 0; x < width; ++x)
+            {
+                GetEncodedRGBValue(image, x, y, gamma, max, r, g, b, *dither);
+                data.push_back(r);
+                data.push_back(g);
+                data.push_back(b);
+            }
+        return data;
+    }
+
+    // the table-driven encoder must quantize just like the generic encoding function,
+    // except for the odd value right at the boundary between two levels; the remaining error
+    // may differ in the last few bits, as optimized builds (-ffast-math) are free to evaluate
+    // `xEff - decoded` differently in the two functions
+    BOOST_AUTO_TEST_CASE( GammaIntEncoderMatchesIntEncode )
+    {
+        std::mt19937 rng(4711);
+        std::uniform_real_distribution<float> value(-0.1f, 1.1f);
+        std::uniform_real_distribution<float> offset(-0.5f, 0.5f);
+        std::uniform_real_distribution<float> error(-0.01f, 0.01f);
+        GammaCurvePtr gamma = SRGBGammaCurve::Get();
+
+        for (unsigned int max : { 15u, 255u, 4095u, 65535u })
+        {
+            GammaIntEncoder encoder(gamma, max);
+            unsigned int mismatches = 0;
+            for (int i = 0; i < 100000; ++i)
+            {
+                float x = value(rng);
+                float qOff = offset(rng);
+                float err = error(rng);
+                float errRef = err;
+                unsigned int v = encoder.Encode(x, qOff, err);
+                unsigned int vRef = IntEncode(gamma, x, max, qOff, errRef);
+                BOOST_CHECK_LE(std::abs(int(v) - int(vRef)), 1);
+                if (v != vRef)
+                    ++mismatches;
+                else
+                    BOOST_CHECK_SMALL(err - errRef, 1e-6f);
+            }
+            BOOST_CHECK_LE(mismatches, 10u);
+        }
+    }
+
+    // stateless dithering must give exactly the same result as pixel-by-pixel encoding
+    BOOST_AUTO_TEST_CASE( RowEncoderOrderedDither )
+    {
+        std::unique_ptr<Image> image(CreateTestImage(100, 60));
+        GammaCurvePtr gamma = PowerLawGammaCurve::GetByEncodingGamma(1.0f/2.2f);
+        std::vector<unsigned int> reference = EncodeImageByPixel(image.get(), gamma, 255, DitherMethodId::kBlueNoiseX);
+        std::vector<unsigned int> data = EncodeImage(image.get(), gamma, 255, DitherMethodId::kBlueNoiseX, 4, 7);
+        BOOST_CHECK(data == reference);
+    }
+
+    // error diffusion must give the same result regardless of the number of threads, and
+    // agree with pixel-by-pixel encoding save for rounding differences
+    BOOST_AUTO_TEST_CASE( RowEncoderErrorDiffusion )
+    {
+        std::unique_ptr<Image> image(CreateTestImage(150, 80));
+        GammaCurvePtr gamma = SRGBGammaCurve::Get();
+
+        for (DitherMethodId method : { DitherMethodId::kDiffusion1D, DitherMethodId::kFloydSteinberg,
+                                       DitherMethodId::kSierraLite, DitherMethodId::kStucki })
+        {
+            std::vector<unsigned int> reference = EncodeImageByPixel(image.get(), gamma, 255, method);
+            std::vector<unsigned int> serial    = EncodeImage(image.get(), gamma, 255, method, 1, 80);
+            for (unsigned int threads : { 2u, 3u, 8u })
+            {
+                BOOST_CHECK(EncodeImage(image.get(), gamma, 255, method, threads, 80) == serial);
+                BOOST_CHECK(EncodeImage(image.get(), gamma, 255, method, threads, 13) == serial);
+            }
+
+            long sum = 0, sumRef = 0;
+            unsigned int mismatches = 0;
+            for (std::size_t i = 0; i < reference.size(); ++i)
+            {
+                sum    += serial[i];
+                sumRef += reference[i];
+                if (serial[i] != reference[i])
+                    ++mismatches;
+            }
+            BOOST_CHECK_LE(mismatches, reference.size() / 20);
+            BOOST_CHECK_LE(std::abs(sum - sumRef), long(reference.size() / 100));
+        }
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
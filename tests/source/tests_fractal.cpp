@@ -0,0 +1,115 @@
+//******************************************************************************
+///
+/// @file tests/source/tests_fractal.cpp
+///
+/// POV-Ray unit tests for the batched fractal iteration (@ref core/math/quaternion.cpp).
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+
+#include <random>
+
+// configcore.h must always be the first POV file included within core *.cpp files;
+// tests.h must follow suite.
+#include "core/configcore.h"
+#include "tests.h"
+
+#include "core/shape/fractal.h"
+
+// this must be the last file included
+#include "base/povdebug.h"
+
+using namespace pov;
+
+BOOST_AUTO_TEST_SUITE( FractalIteration )
+
+    // the batched test must classify each point exactly like the single-point iteration,
+    // regardless of how many points are tested at once
+    static void CheckBatch(int algebra, int subType)
+    {
+        Fractal fractal;
+        fractal.Algebra = algebra;
+        fractal.Sub_Type = subType;
+        fractal.Julia_Parm[X] = -0.083;
+        fractal.Julia_Parm[Y] = 0.0;
+        fractal.Julia_Parm[Z] = -0.83;
+        fractal.Julia_Parm[T] = -0.025;
+        fractal.Num_Iterations = 8;
+        fractal.SetUp_Fractal();
+
+        DBL *iterStack[4] = { nullptr, nullptr, nullptr, nullptr };
+        Fractal::Allocate_Iteration_Stack(iterStack, fractal.Num_Iterations);
+
+        std::mt19937 rng(4711);
+        std::uniform_real_distribution<DBL> uniform(-1.5, 1.5);
+        unsigned int insideCount = 0;
+
+        for (int i = 0; i < 256; ++i)
+        {
+            unsigned int count = 1 + (i % FractalRules::kMaxBatchSize);
+            Vector3d points[FractalRules::kMaxBatchSize];
+            bool inside[FractalRules::kMaxBatchSize];
+
+            for (unsigned int k = 0; k < count; ++k)
+                points[k] = Vector3d(uniform(rng), uniform(rng), uniform(rng));
+
+            fractal.Rules->Iterate(points, count, &fractal, iterStack, inside);
+
+            for (unsigned int k = 0; k < count; ++k)
+            {
+                bool expected = fractal.Rules->Iterate(points[k], &fractal, iterStack);
+                BOOST_CHECK_EQUAL( inside[k], expected );
+                if (expected)
+                    ++insideCount;
+            }
+        }
+
+        // make sure both outcomes have been covered
+        BOOST_CHECK( insideCount > 0 );
+
+        Fractal::Free_Iteration_Stack(iterStack);
+    }
+
+    BOOST_AUTO_TEST_CASE( QuaternionSqr )
+    {
+        CheckBatch(QUATERNION_TYPE, SQR_STYPE);
+    }
+
+    BOOST_AUTO_TEST_CASE( QuaternionCube )
+    {
+        CheckBatch(QUATERNION_TYPE, CUBE_STYPE);
+    }
+
+    BOOST_AUTO_TEST_CASE( HypercomplexSqr )
+    {
+        CheckBatch(HYPERCOMPLEX_TYPE, SQR_STYPE);
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
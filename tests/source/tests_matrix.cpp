@@ -0,0 +1,323 @@
+//******************************************************************************
+///
+/// @file tests/source/tests_matrix.cpp
+///
+/// POV-Ray unit tests for the transformation classes and pool (@ref core/math/matrix.cpp).
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+// configcore.h must always be the first POV file included within core *.cpp files;
+// tests.h must follow suite.
+#include "core/configcore.h"
+#include "tests.h"
+
+#include "core/math/matrix.h"
+
+// this must be the last file included
+#include "base/povdebug.h"
+
+using namespace pov;
+
+BOOST_AUTO_TEST_SUITE( Matrix )
+
+    static TRANSFORM Translation(const Vector3d& v)
+    {
+        TRANSFORM t;
+        Compute_Translation_Transform(&t, v);
+        return t;
+    }
+
+    static TRANSFORM Scaling(const Vector3d& v)
+    {
+        TRANSFORM t;
+        Compute_Scaling_Transform(&t, v);
+        return t;
+    }
+
+    static TRANSFORM Rotation(const Vector3d& v)
+    {
+        TRANSFORM t;
+        Compute_Rotation_Transform(&t, v);
+        return t;
+    }
+
+    BOOST_AUTO_TEST_CASE( Classify )
+    {
+        TRANSFORM t = Translation(Vector3d(1.0, -2.0, 3.5));
+        BOOST_CHECK(t.kind == kTransform_Translation);
+
+        TRANSFORM s = Scaling(Vector3d(2.0, 0.5, -4.0));
+        BOOST_CHECK(s.kind == kTransform_AxisAligned);
+
+        Compose_Transforms(&t, &s);
+        BOOST_CHECK(t.kind == kTransform_AxisAligned);
+
+        TRANSFORM r = Rotation(Vector3d(10.0, 20.0, 30.0));
+        BOOST_CHECK(r.kind == kTransform_General);
+
+        Compose_Transforms(&t, &r);
+        BOOST_CHECK(t.kind == kTransform_General);
+
+        // a translation and its inverse leave the identity, which is a (trivial) translation
+        TRANSFORM u = Translation(Vector3d(0.25, 0.5, 0.75));
+        TRANSFORM v = Translation(Vector3d(-0.25, -0.5, -0.75));
+        Compose_Transforms(&u, &v);
+        BOOST_CHECK(u.kind == kTransform_Translation);
+    }
+
+    // the cheaper paths merely skip multiplications by zero, but the compiler may still fuse the
+    // remaining ones differently
+    static bool Same(const Vector3d& a, const Vector3d& b)
+    {
+        return (a - b).length() <= 1e-12 * (1.0 + b.length());
+    }
+
+    // the cheaper paths must give the same results as the full matrix multiply
+    BOOST_AUTO_TEST_CASE( AxisAlignedPaths )
+    {
+        std::mt19937 rng(4711);
+        std::uniform_real_distribution<DBL> value(-100.0, 100.0);
+
+        TRANSFORM t = Scaling(Vector3d(2.0, 0.5, -4.0));
+        TRANSFORM v = Translation(Vector3d(1.0, -2.0, 3.5));
+        Compose_Transforms(&t, &v);
+
+        for (const TRANSFORM *trans : { &t, &v })
+        {
+            TRANSFORM reference = *trans;
+            reference.kind = kTransform_General;
+
+            for (int i = 0; i < 100; ++i)
+            {
+                Vector3d p(value(rng), value(rng), value(rng));
+                Vector3d a, b;
+
+                MTransPoint(a, p, trans);            MTransPoint(b, p, &reference);
+                BOOST_CHECK(Same(a, b));
+                MInvTransPoint(a, p, trans);         MInvTransPoint(b, p, &reference);
+                BOOST_CHECK(Same(a, b));
+                MTransDirection(a, p, trans);        MTransDirection(b, p, &reference);
+                BOOST_CHECK(Same(a, b));
+                MInvTransDirection(a, p, trans);     MInvTransDirection(b, p, &reference);
+                BOOST_CHECK(Same(a, b));
+                MTransNormal(a, p, trans);           MTransNormal(b, p, &reference);
+                BOOST_CHECK(Same(a, b));
+                MInvTransNormal(a, p, trans);        MInvTransNormal(b, p, &reference);
+                BOOST_CHECK(Same(a, b));
+
+                BasicRay ray(p, Vector3d(value(rng), value(rng), value(rng))), ra, rb;
+                MInvTransRay(ra, ray, trans);        MInvTransRay(rb, ray, &reference);
+                BOOST_CHECK(Same(ra.Origin, rb.Origin));
+                BOOST_CHECK(Same(ra.Direction, rb.Direction));
+            }
+        }
+    }
+
+#ifdef TRY_OPTIMIZED_TRANSFORM
+
+    // reference results, computed the same way as the portable code in matrix.cpp; the tolerance
+    // scales with the magnitude of the individual products, as fused multiply-add may round the
+    // partial sums differently
+    static bool Close(DBL a, DBL b, DBL magnitude)
+    {
+        return std::fabs(a - b) <= 1e-13 * magnitude + 1e-290;
+    }
+
+    static bool ClosePoint(const Vector3d& result, const Vector3d& v, const MATRIX& m, bool translate)
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            DBL expected  = v[X] * m[0][i] + v[Y] * m[1][i] + v[Z] * m[2][i];
+            DBL magnitude = std::fabs(v[X] * m[0][i]) + std::fabs(v[Y] * m[1][i]) + std::fabs(v[Z] * m[2][i]);
+            if (translate)
+            {
+                expected  += m[3][i];
+                magnitude += std::fabs(m[3][i]);
+            }
+            if (!Close(result[i], expected, magnitude))
+                return false;
+        }
+        return true;
+    }
+
+    static bool CloseNormal(const Vector3d& result, const Vector3d& v, const MATRIX& m)
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            DBL expected  = v[X] * m[i][0] + v[Y] * m[i][1] + v[Z] * m[i][2];
+            DBL magnitude = std::fabs(v[X] * m[i][0]) + std::fabs(v[Y] * m[i][1]) + std::fabs(v[Z] * m[i][2]);
+            if (!Close(result[i], expected, magnitude))
+                return false;
+        }
+        return true;
+    }
+
+    // arrays cannot be stored in standard containers directly
+    struct TestMatrix
+    {
+        MATRIX m;
+    };
+
+    // the optimized kernels must match the portable code on random as well as degenerate input
+    BOOST_AUTO_TEST_CASE( OptimizedKernels )
+    {
+        const size_t kCount = 37; // deliberately not a multiple of any vector width
+
+        std::mt19937 rng(815);
+        std::uniform_real_distribution<DBL> value(-100.0, 100.0);
+        std::uniform_real_distribution<DBL> exponent(-150.0, 150.0);
+
+        std::vector<TestMatrix> matrices;
+        TestMatrix t;
+        MZero(t.m);                             matrices.push_back(t);
+        MIdentity(t.m);                         matrices.push_back(t);
+        MIdentity(t.m); t.m[2][2] = 0.0;        matrices.push_back(t);  // singular
+        MIdentity(t.m); t.m[3][0] = 1e150; t.m[3][1] = -1e-150; t.m[3][2] = 0.0;
+                                                matrices.push_back(t);  // extreme translation
+        for (int i = 0; i < 4; i++)
+            for (int j = 0; j < 4; j++)
+                t.m[i][j] = ((i + j) % 2 ? -1.0 : 1.0) * (i + 1);
+                                                matrices.push_back(t);  // rank one
+        for (int k = 0; k < 20; k++)
+        {
+            for (int i = 0; i < 4; i++)
+                for (int j = 0; j < 4; j++)
+                    t.m[i][j] = (k < 10 ? value(rng) : value(rng) * std::pow(10.0, exponent(rng)));
+            matrices.push_back(t);
+        }
+
+        std::vector<Vector3d> vectors;
+        vectors.push_back(Vector3d(0.0));
+        vectors.push_back(Vector3d(-0.0, 0.0, -0.0));
+        vectors.push_back(Vector3d(1.0, 0.0, 0.0));
+        vectors.push_back(Vector3d(0.0, 1.0, 0.0));
+        vectors.push_back(Vector3d(0.0, 0.0, 1.0));
+        vectors.push_back(Vector3d(1e150, -1e-150, 1.0));
+        vectors.push_back(Vector3d(4.9e-324, -2.2e-308, 1e-300));
+        while (vectors.size() < kCount)
+            vectors.push_back(Vector3d(value(rng), value(rng), value(rng)));
+
+        std::vector<BasicRay> rays;
+        for (size_t i = 0; i < kCount; i++)
+            rays.push_back(BasicRay(vectors[i], vectors[kCount - 1 - i]));
+
+        unsigned int tested = 0;
+        for (const OptimizedTransformInfo* info = gaOptimizedTransformInfo; info->name != nullptr; ++info)
+        {
+            if ((info->enabled != nullptr) && !*info->enabled)
+                continue;
+            if ((info->supported != nullptr) && !info->supported())
+            {
+                BOOST_TEST_MESSAGE("Skipping " << info->name << " transformations (not supported by this CPU)");
+                continue;
+            }
+            ++tested;
+
+            for (const TestMatrix& entry : matrices)
+            {
+                const MATRIX& matrix = entry.m;
+                std::vector<Vector3d> result(kCount);
+                std::vector<BasicRay> rayResult(kCount);
+
+                info->transformPoints(result.data(), vectors.data(), kCount, &matrix);
+                for (size_t i = 0; i < kCount; i++)
+                    BOOST_CHECK_MESSAGE(ClosePoint(result[i], vectors[i], matrix, true), info->name << " point " << i);
+
+                info->transformDirections(result.data(), vectors.data(), kCount, &matrix);
+                for (size_t i = 0; i < kCount; i++)
+                    BOOST_CHECK_MESSAGE(ClosePoint(result[i], vectors[i], matrix, false), info->name << " direction " << i);
+
+                info->invTransformNormals(result.data(), vectors.data(), kCount, &matrix);
+                for (size_t i = 0; i < kCount; i++)
+                    BOOST_CHECK_MESSAGE(CloseNormal(result[i], vectors[i], matrix), info->name << " normal " << i);
+
+                info->transformRays(rayResult.data(), rays.data(), kCount, &matrix);
+                for (size_t i = 0; i < kCount; i++)
+                {
+                    BOOST_CHECK_MESSAGE(ClosePoint(rayResult[i].Origin, rays[i].Origin, matrix, true), info->name << " ray origin " << i);
+                    BOOST_CHECK_MESSAGE(ClosePoint(rayResult[i].Direction, rays[i].Direction, matrix, false), info->name << " ray direction " << i);
+                }
+
+                // result and source may be identical
+                result = vectors;
+                info->transformPoints(result.data(), result.data(), kCount, &matrix);
+                for (size_t i = 0; i < kCount; i++)
+                    BOOST_CHECK_MESSAGE(ClosePoint(result[i], vectors[i], matrix, true), info->name << " in-place point " << i);
+            }
+        }
+        if (tested == 0)
+            BOOST_TEST_MESSAGE("No optimized transformations supported by this CPU; skipping");
+    }
+
+#endif // TRY_OPTIMIZED_TRANSFORM
+
+    BOOST_AUTO_TEST_CASE( Pool )
+    {
+        TransformPool pool;
+
+        TRANSFORM *a = Create_Transform();
+        TRANSFORM *b = Create_Transform();
+        TRANSFORM *c = Create_Transform();
+        TRANSFORM s = Scaling(Vector3d(2.0, 3.0, 4.0));
+        TRANSFORM r = Rotation(Vector3d(0.0, 45.0, 0.0));
+        Compose_Transforms(a, &s);
+        Compose_Transforms(b, &s);
+        Compose_Transforms(c, &r);
+
+        TRANSFORM *pa = pool.Intern(a);
+        TRANSFORM *pb = pool.Intern(b);
+        TRANSFORM *pc = pool.Intern(c);
+
+        BOOST_CHECK(pa == a);
+        BOOST_CHECK(pb == pa);
+        BOOST_CHECK(pc == c);
+        BOOST_CHECK(pa->pooled);
+        BOOST_CHECK_EQUAL(pool.size(), 2u);
+        BOOST_CHECK_EQUAL(pool.duplicates(), 1u);
+
+        // interning a pooled transformation again is harmless
+        BOOST_CHECK(pool.Intern(pa) == pa);
+        BOOST_CHECK_EQUAL(pool.duplicates(), 1u);
+        BOOST_CHECK(pool.Intern(nullptr) == nullptr);
+
+        // copies are regular transformations again, and pooled ones survive being destroyed
+        TRANSFORM *copy = Copy_Transform(pa);
+        BOOST_CHECK(!copy->pooled);
+        Compose_Transforms(copy, &r);
+        Destroy_Transform(copy);
+        Destroy_Transform(pa);
+        BOOST_CHECK_EQUAL(pa->matrix[0][0], 2.0);
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
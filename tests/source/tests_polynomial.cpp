@@ -0,0 +1,149 @@
+//******************************************************************************
+///
+/// @file tests/source/tests_polynomial.cpp
+///
+/// POV-Ray unit tests for the polynomial solvers (@ref core/math/polynomialsolver.cpp).
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+// configcore.h must always be the first POV file included within core *.cpp files;
+// tests.h must follow suite.
+#include "core/configcore.h"
+#include "tests.h"
+
+#include "core/math/polynomialsolver.h"
+#include "core/support/statistics.h"
+
+// this must be the last file included
+#include "base/povdebug.h"
+
+using namespace pov;
+
+BOOST_AUTO_TEST_SUITE( PolynomialSolver )
+
+    // polynomials built from well-separated real roots must have exactly those roots
+    // found that lie in [0,1], in ascending order
+    static void CheckUnitInterval(int order)
+    {
+        std::mt19937 rng(4711);
+        std::uniform_real_distribution<DBL> uniform(-1.0, 2.0);
+        RenderStatistics stats;
+        unsigned int rootCount = 0;
+
+        for (int i = 0; i < 256; ++i)
+        {
+            std::vector<DBL> roots;
+            while ((int)roots.size() < order)
+            {
+                DBL root = uniform(rng);
+                bool separate = true;
+                for (DBL other : roots)
+                    separate = separate && (fabs(root - other) > 0.05);
+                if (separate && (fabs(root) > 0.01) && (fabs(root - 1.0) > 0.01))
+                    roots.push_back(root);
+            }
+
+            // multiply by (x - root) for each root in turn
+            std::vector<DBL> c(order + 1, 0.0);
+            c[0] = 1.0;
+            for (int n = 1; n <= order; ++n)
+            {
+                for (int k = n; k > 0; --k)
+                    c[k] -= roots[n - 1] * c[k - 1];
+            }
+
+            std::vector<DBL> expected;
+            for (DBL root : roots)
+            {
+                if ((root >= 0.0) && (root <= 1.0))
+                    expected.push_back(root);
+            }
+            std::sort(expected.begin(), expected.end());
+
+            DBL found[MAX_ORDER];
+            int count = Solve_Polynomial_01(order, c.data(), found, 1.0e-10, stats);
+
+            BOOST_REQUIRE_EQUAL( count, (int)expected.size() );
+            for (int k = 0; k < count; ++k)
+                BOOST_CHECK_CLOSE_FRACTION( found[k], expected[k], 1.0e-6 );
+            rootCount += count;
+        }
+
+        // make sure roots have actually been tested
+        BOOST_CHECK( rootCount > 0 );
+    }
+
+    BOOST_AUTO_TEST_CASE( UnitIntervalQuadratic )
+    {
+        CheckUnitInterval(2);
+    }
+
+    BOOST_AUTO_TEST_CASE( UnitIntervalSextic )
+    {
+        CheckUnitInterval(6);
+    }
+
+    BOOST_AUTO_TEST_CASE( UnitIntervalDecic )
+    {
+        CheckUnitInterval(10);
+    }
+
+    // the batched quadratic solver must agree with solving each polynomial on its own
+    BOOST_AUTO_TEST_CASE( BatchedQuadratics )
+    {
+        std::mt19937 rng(4711);
+        std::uniform_real_distribution<DBL> uniform(-2.0, 2.0);
+        RenderStatistics stats;
+        const unsigned int count = 257;
+
+        std::vector<DBL> c(3 * count), r(2 * count);
+        std::vector<int> n(count);
+        for (DBL& coef : c)
+            coef = uniform(rng);
+        // include a degenerate case
+        c[0] = 0.0;
+
+        Solve_Polynomials(2, count, c.data(), r.data(), n.data(), true, 1.0e-10, stats);
+
+        for (unsigned int k = 0; k < count; ++k)
+        {
+            DBL single[2];
+            int singleCount = Solve_Polynomial(2, &c[3 * k], single, true, 1.0e-10, stats);
+            BOOST_REQUIRE_EQUAL( n[k], singleCount );
+            for (int i = 0; i < singleCount; ++i)
+                BOOST_CHECK_CLOSE_FRACTION( r[2 * k + i], single[i], 1.0e-12 );
+        }
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
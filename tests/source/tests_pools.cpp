@@ -0,0 +1,117 @@
+//******************************************************************************
+///
+/// @file tests/source/tests_pools.cpp
+///
+/// POV-Ray unit tests for the scratch container pools (@ref core/coretypes.h, @ref core/support/simplevector.h).
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+#include <vector>
+
+// configcore.h must always be the first POV file included within core *.cpp files;
+// tests.h must follow suite.
+#include "core/configcore.h"
+#include "tests.h"
+
+#include "core/coretypes.h"
+#include "core/support/simplevector.h"
+
+// this must be the last file included
+#include "base/povdebug.h"
+
+using namespace pov;
+
+BOOST_AUTO_TEST_SUITE( Pools )
+
+    typedef std::vector<int> IntVectorData;
+    typedef RefPool<IntVectorData> IntVectorPool;
+    typedef Ref<IntVectorData, RefClearContainer<IntVectorData>> IntVector;
+
+    // mimic a recursive shading function holding one pooled container per recursion level
+    static void Recurse(IntVectorPool& pool, int depth)
+    {
+        IntVector v(pool);
+        BOOST_CHECK( v->empty() );
+        v->push_back(depth);
+        if (depth > 0)
+            Recurse(pool, depth - 1);
+    }
+
+    BOOST_AUTO_TEST_CASE( RefPoolSteadyState )
+    {
+        IntVectorPool pool;
+
+        Recurse(pool, 7);
+        BOOST_CHECK_EQUAL( pool.GetAllocationCount(), 8u );
+        for (int i = 0; i < 100; ++i)
+            Recurse(pool, i % 8);
+        BOOST_CHECK_EQUAL( pool.GetAllocationCount(), 8u );
+    }
+
+    BOOST_AUTO_TEST_CASE( PooledSimpleVectorSteadyState )
+    {
+        typedef PooledSimpleVector<int, 16> TestVector;
+
+        {
+            TestVector a, b;
+            a.push_back(1);
+            b.push_back(2);
+        }
+        size_t count = TestVector::GetPoolAllocationCount();
+        for (int i = 0; i < 100; ++i)
+        {
+            TestVector a, b;
+            BOOST_CHECK( a.empty() );
+            a.push_back(i);
+            b.push_back(i);
+        }
+        BOOST_CHECK_EQUAL( TestVector::GetPoolAllocationCount(), count );
+    }
+
+    BOOST_AUTO_TEST_CASE( PooledSimpleVectorAssign )
+    {
+        typedef PooledSimpleVector<int, 16> TestVector;
+
+        TestVector a, b, c;
+        a.push_back(1);
+        a.push_back(2);
+        b.push_back(3);
+        c = b = a;
+        BOOST_CHECK_EQUAL( b.size(), 2u );
+        BOOST_CHECK_EQUAL( c.size(), 2u );
+        BOOST_CHECK_EQUAL( c[0], 1 );
+        BOOST_CHECK_EQUAL( c[1], 2 );
+
+        // the copies must be independent of the original
+        a.push_back(4);
+        BOOST_CHECK_EQUAL( b.size(), 2u );
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,146 @@
+//******************************************************************************
+///
+/// @file tests/source/tests_rawtokenizer.cpp
+///
+/// POV-Ray unit tests for the raw tokenizer (@ref parser/rawtokenizer.cpp).
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+
+// configparser.h must always be the first POV file included within parser *.cpp files;
+// tests.h must follow suite.
+#include "parser/configparser.h"
+#include "tests.h"
+
+#include "parser/rawtokenizer.h"
+
+// this must be the last file included
+#include "base/povdebug.h"
+
+using namespace pov_parser;
+
+BOOST_AUTO_TEST_SUITE( RawTokenizer )
+
+    // the fast conversion must give bit-identical results to the C library
+    static bool SameAsStrtod(const std::string& text)
+    {
+        double value;
+        if (!FastFloatLiteralToDouble(text, value))
+            return false;
+        double reference = strtod(text.c_str(), nullptr);
+        BOOST_CHECK_MESSAGE( memcmp(&value, &reference, sizeof(double)) == 0,
+                             text << " converted to " << value << " instead of " << reference );
+        return true;
+    }
+
+    static bool Eligible(const std::string& text)
+    {
+        double value;
+        return FastFloatLiteralToDouble(text, value);
+    }
+
+    BOOST_AUTO_TEST_CASE( FloatLiteralBoundaries )
+    {
+        // mantissa
+        BOOST_CHECK( SameAsStrtod("9007199254740992") );        // 2^53
+        BOOST_CHECK( SameAsStrtod("900719925474099.2e1") );
+        BOOST_CHECK( !Eligible("9007199254740993") );           // 2^53+1 is not exactly representable
+        BOOST_CHECK( !Eligible("90071992547409.93") );
+
+        // exponent
+        BOOST_CHECK( SameAsStrtod("1e22") );
+        BOOST_CHECK( SameAsStrtod("1e-22") );
+        BOOST_CHECK( SameAsStrtod("9007199254740991e22") );
+        BOOST_CHECK( SameAsStrtod("9007199254740991e-22") );
+        BOOST_CHECK( !Eligible("1e23") );
+        BOOST_CHECK( !Eligible("1e-23") );
+        BOOST_CHECK( !Eligible("1e99999999") );
+
+        // number of significant digits
+        BOOST_CHECK( !Eligible("1234567890123456789") );        // 19 digits, but beyond 2^53
+        BOOST_CHECK( !Eligible("12345678901234567890") );       // 20 digits
+        BOOST_CHECK( !Eligible("1.000000000000000000") );       // 19 digits, trailing zeros count
+        BOOST_CHECK( SameAsStrtod("0.1234567890123456") );
+
+        // leading and trailing zeros
+        BOOST_CHECK( SameAsStrtod("000123.4500") );
+        BOOST_CHECK( SameAsStrtod("0.000000000000000000000000000001e10") );
+        BOOST_CHECK( SameAsStrtod("1.50000") );
+        BOOST_CHECK( SameAsStrtod("0") );
+        BOOST_CHECK( SameAsStrtod("0.000") );
+        BOOST_CHECK( SameAsStrtod("0e99999") );
+
+        // abbreviated forms accepted by the scanner
+        BOOST_CHECK( SameAsStrtod("1e") );
+        BOOST_CHECK( SameAsStrtod("1e+") );
+        BOOST_CHECK( SameAsStrtod(".5") );
+        BOOST_CHECK( SameAsStrtod("5.") );
+        BOOST_CHECK( SameAsStrtod("4.35E+3") );
+        BOOST_CHECK( SameAsStrtod("123.456e-5") );
+
+        // anything else is left to the C library
+        BOOST_CHECK( !Eligible("1.5x") );
+        BOOST_CHECK( !Eligible("0x10") );
+    }
+
+    BOOST_AUTO_TEST_CASE( FloatLiteralRandom )
+    {
+        std::mt19937 rng(4711);
+        std::uniform_int_distribution<int> digitCount(1, 17);
+        std::uniform_int_distribution<int> digit(0, 9);
+        std::uniform_int_distribution<int> exponent(-30, 30);
+        unsigned int eligibleCount = 0;
+
+        for (int i = 0; i < 100000; ++i)
+        {
+            std::string text;
+            int n = digitCount(rng);
+            int point = std::uniform_int_distribution<int>(0, n)(rng);
+            for (int k = 0; k < n; ++k)
+            {
+                if (k == point)
+                    text += '.';
+                text += char('0' + digit(rng));
+            }
+            if (i % 2 == 0)
+                text += "e" + std::to_string(exponent(rng));
+            if (SameAsStrtod(text))
+                ++eligibleCount;
+        }
+
+        // most literals should take the fast path
+        BOOST_CHECK( eligibleCount > 50000 );
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
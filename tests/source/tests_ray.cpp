@@ -0,0 +1,82 @@
+//******************************************************************************
+///
+/// @file tests/source/tests_ray.cpp
+///
+/// POV-Ray unit tests for rays (@ref core/render/ray.cpp).
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+// configcore.h must always be the first POV file included within core *.cpp files;
+// tests.h must follow suite.
+#include "core/configcore.h"
+#include "tests.h"
+
+#include "core/coretypes.h"
+#include "core/render/ray.h"
+#include "core/render/trace.h"
+
+// this must be the last file included
+#include "base/povdebug.h"
+
+using namespace pov;
+
+BOOST_AUTO_TEST_SUITE( Rays )
+
+    // shadow rays only take over the interiors of their source ray once they pass through
+    // transparent objects; this must work however often it happens
+    BOOST_AUTO_TEST_CASE( CopyInteriors )
+    {
+        TraceTicket ticket(5, 0.01);
+        Interior water, air;
+        water.hollow = false;
+        air.hollow = true;
+
+        Ray ray(ticket, Vector3d(0.0, 0.0, 0.0), Vector3d(0.0, 0.0, 1.0));
+        ray.AppendInterior(&air);
+        ray.AppendInterior(&water);
+        BOOST_CHECK( !ray.IsHollowRay() );
+
+        Ray shadowRay(ticket, Vector3d(0.0, 0.0, 0.0), Vector3d(0.0, 1.0, 0.0), Ray::OtherRay, true);
+        for (int i = 0; i < 3; ++i)
+        {
+            shadowRay.CopyInteriors(ray);
+            BOOST_CHECK_EQUAL( shadowRay.GetInteriors().size(), 2u );
+            BOOST_CHECK( shadowRay.IsInterior(&water) );
+            BOOST_CHECK( shadowRay.IsInterior(&air) );
+            BOOST_CHECK( !shadowRay.IsHollowRay() );
+
+            // leaving an object must not affect the source ray
+            BOOST_CHECK( shadowRay.RemoveInterior(&water) );
+            BOOST_CHECK( shadowRay.IsHollowRay() );
+            BOOST_CHECK( ray.IsInterior(&water) );
+        }
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
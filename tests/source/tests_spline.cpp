@@ -0,0 +1,124 @@
+//******************************************************************************
+///
+/// @file tests/source/tests_spline.cpp
+///
+/// POV-Ray unit tests for the spline segment lookup (@ref core/math/spline.cpp).
+///
+/// @copyright
+/// @parblock
+///
+/// Persistence of Vision Ray Tracer ('POV-Ray') version 3.8.
+/// Copyright 1991-2019 Persistence of Vision Raytracer Pty. Ltd.
+///
+/// POV-Ray is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU Affero General Public License as
+/// published by the Free Software Foundation, either version 3 of the
+/// License, or (at your option) any later version.
+///
+/// POV-Ray is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU Affero General Public License for more details.
+///
+/// You should have received a copy of the GNU Affero General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// ----------------------------------------------------------------------------
+///
+/// POV-Ray is based on the popular DKB raytracer version 2.12.
+/// DKBTrace was originally written by David K. Buck.
+/// DKBTrace Ver 2.0-2.12 were written by David K. Buck & Aaron A. Collins.
+///
+/// @endparblock
+///
+//******************************************************************************
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+// configcore.h must always be the first POV file included within core *.cpp files;
+// tests.h must follow suite.
+#include "core/configcore.h"
+#include "tests.h"
+
+#include "core/math/spline.h"
+
+// this must be the last file included
+#include "base/povdebug.h"
+
+using namespace pov;
+
+BOOST_AUTO_TEST_SUITE( Spline )
+
+    // entries at irregular parameters, some of them clustered
+    template<typename SPLINE>
+    static SPLINE* CreateTestSpline(unsigned int entries)
+    {
+        std::mt19937 rng(4711);
+        std::uniform_real_distribution<DBL> step(0.01, 1.0);
+        std::uniform_real_distribution<DBL> value(-10.0, 10.0);
+        SPLINE* spline = new SPLINE();
+        DBL par = -3.0;
+        for (unsigned int i = 0; i < entries; ++i)
+        {
+            EXPRESS v;
+            for (int k = 0; k < 5; ++k)
+                v[k] = value(rng);
+            Insert_Spline_Entry(spline, par, v);
+            par += (i % 7 == 3) ? step(rng) * 1.0e-4 : step(rng);
+        }
+        return spline;
+    }
+
+    static std::vector<DBL> TestParameters(const GenericSpline& spline)
+    {
+        std::mt19937 rng(815);
+        DBL first = spline.SplineEntries.front().par;
+        DBL last  = spline.SplineEntries.back().par;
+        std::uniform_real_distribution<DBL> uniform(first - 1.0, last + 1.0);
+        std::vector<DBL> p;
+        for (const SplineEntry& e : spline.SplineEntries)
+            p.push_back(e.par);
+        for (int i = 0; i < 2000; ++i)
+            p.push_back(uniform(rng));
+        return p;
+    }
+
+    static SplineEntryList::size_type ReferenceSegment(const GenericSpline& spline, DBL p)
+    {
+        const SplineEntryList& se = spline.SplineEntries;
+        if (p <= se.front().par)
+            return 0;
+        if (p >= se.back().par)
+            return se.size();
+        return std::lower_bound(se.begin(), se.end(), p, [](const SplineEntry& e, DBL t) { return e.par < t; }) - se.begin();
+    }
+
+    // the segment found must not depend on the lookup table or the order of the queries
+    BOOST_AUTO_TEST_CASE( FindSegment )
+    {
+        for (unsigned int entries : { 2u, 5u, 16u, 17u, 300u })
+        {
+            std::unique_ptr<LinearSpline> spline(CreateTestSpline<LinearSpline>(entries));
+            std::vector<DBL> p = TestParameters(*spline);
+
+            for (int prepared = 0; prepared < 2; ++prepared)
+            {
+                if (prepared)
+                    spline->PrepareLookup();
+                for (DBL t : p)
+                    BOOST_CHECK_EQUAL(spline->FindSegment(t), ReferenceSegment(*spline, t));
+
+                std::vector<DBL> sorted(p);
+                std::sort(sorted.begin(), sorted.end());
+                for (DBL t : sorted)
+                    BOOST_CHECK_EQUAL(spline->FindSegment(t), ReferenceSegment(*spline, t));
+                for (auto it = sorted.rbegin(); it != sorted.rend(); ++it)
+                    BOOST_CHECK_EQUAL(spline->FindSegment(*it), ReferenceSegment(*spline, *it));
+            }
+        }
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
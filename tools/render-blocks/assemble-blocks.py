@@ -0,0 +1,131 @@
+import getopt, struct, sys, zlib
+
+PNG_SIGNATURE = b"\x89PNG\r\n\x1a\n"
+CHANNELS = { 0: 1, 2: 3, 4: 2, 6: 4 }  # samples per pixel by PNG colour type (palettes are not supported)
+
+def printerr(s):
+    sys.stderr.write("%s\n" % s)
+
+def UsageError():
+    printerr("assemble-blocks.py")
+    printerr("    Assemble the partial images of a frame rendered in shares with the")
+    printerr("    Render_Block_Workers and Render_Block_Worker options.")
+    printerr("Usage:")
+    printerr("    python assemble-blocks.py [options] <output> <part> [<part> ...]")
+    printerr("Parameters:")
+    printerr("    <output>:   PNG file to write the assembled image to.")
+    printerr("    <part>:     PNG file written by one share of the render.")
+    printerr("Options:")
+    printerr("    -f          Write the image even if the parts overlap.")
+    sys.exit(2)
+
+def ReadPNG(name):
+    with open(name, "rb") as f:
+        data = f.read()
+    if data[:8] != PNG_SIGNATURE:
+        raise ValueError("%s: not a PNG file" % name)
+    pos = 8
+    header = None
+    idat = []
+    while pos < len(data):
+        length, kind = struct.unpack(">I4s", data[pos:pos+8])
+        chunk = data[pos+8:pos+8+length]
+        pos += 12 + length
+        if kind == b"IHDR":
+            header = struct.unpack(">IIBBBBB", chunk)
+        elif kind == b"IDAT":
+            idat.append(chunk)
+        elif kind == b"IEND":
+            break
+    if header is None:
+        raise ValueError("%s: no image header" % name)
+    width, height, depth, colour, compression, filtering, interlace = header
+    if colour not in CHANNELS or depth not in (8, 16) or interlace != 0:
+        raise ValueError("%s: only non-interlaced 8 or 16 bit grey or RGB images, with or without alpha, are supported" % name)
+    raw = zlib.decompress(b"".join(idat))
+    bpp = CHANNELS[colour] * depth // 8
+    stride = width * bpp
+    rows = []
+    prev = bytearray(stride)
+    for y in range(height):
+        start = y * (stride + 1)
+        kind = raw[start]
+        row = bytearray(raw[start+1:start+1+stride])
+        for i in range(stride):
+            a = row[i-bpp] if i >= bpp else 0
+            b = prev[i]
+            c = prev[i-bpp] if i >= bpp else 0
+            if kind == 1:
+                row[i] = (row[i] + a) & 0xFF
+            elif kind == 2:
+                row[i] = (row[i] + b) & 0xFF
+            elif kind == 3:
+                row[i] = (row[i] + ((a + b) >> 1)) & 0xFF
+            elif kind == 4:
+                p = a + b - c
+                pa, pb, pc = abs(p - a), abs(p - b), abs(p - c)
+                if pa <= pb and pa <= pc:
+                    row[i] = (row[i] + a) & 0xFF
+                elif pb <= pc:
+                    row[i] = (row[i] + b) & 0xFF
+                else:
+                    row[i] = (row[i] + c) & 0xFF
+        rows.append(row)
+        prev = row
+    return (width, height, depth, colour), rows
+
+def WriteChunk(f, kind, chunk):
+    f.write(struct.pack(">I", len(chunk)) + kind + chunk)
+    f.write(struct.pack(">I", zlib.crc32(kind + chunk) & 0xFFFFFFFF))
+
+def WritePNG(name, format, rows):
+    width, height, depth, colour = format
+    with open(name, "wb") as f:
+        f.write(PNG_SIGNATURE)
+        WriteChunk(f, b"IHDR", struct.pack(">IIBBBBB", width, height, depth, colour, 0, 0, 0))
+        WriteChunk(f, b"IDAT", zlib.compress(b"".join(b"\x00" + bytes(row) for row in rows), 9))
+        WriteChunk(f, b"IEND", b"")
+
+def main():
+    try:
+        opts, args = getopt.getopt(sys.argv[1:], "f")
+    except getopt.GetoptError as err:
+        printerr(err)
+        UsageError()
+    force = ("-f", "") in opts
+    if len(args) < 2:
+        UsageError()
+
+    # Each share leaves the pixels of all blocks but its own opaque black, so the parts are assembled by
+    # taking each pixel from the one part where it is anything else.
+    format, result = ReadPNG(args[1])
+    width, height, depth, colour = format
+    bpp = CHANNELS[colour] * depth // 8
+    blank = bytearray(bpp)
+    if colour in (4, 6):
+        blank[bpp - depth // 8:] = b"\xff" * (depth // 8)
+    overlaps = 0
+    for name in args[2:]:
+        partFormat, part = ReadPNG(name)
+        if partFormat != format:
+            raise ValueError("%s: size or pixel format differs from %s" % (name, args[1]))
+        for row, partRow in zip(result, part):
+            for x in range(0, len(row), bpp):
+                pixel = partRow[x:x+bpp]
+                if pixel != blank:
+                    if row[x:x+bpp] != blank:
+                        overlaps += 1
+                    row[x:x+bpp] = pixel
+
+    if overlaps > 0:
+        printerr("%d pixels were rendered by more than one share; check the Render_Block_Worker options." % overlaps)
+        if not force:
+            sys.exit(1)
+    WritePNG(args[0], format, result)
+
+if __name__ == "__main__":
+    try:
+        main()
+    except (IOError, ValueError, zlib.error) as err:
+        printerr(err)
+        sys.exit(1)
@@ -57,6 +57,11 @@ namespace pov_frontend
 
     extern std::shared_ptr<Display> gDisplay;
 
+    /// Number of dirty rectangles beyond which they are merged into their bounding box.
+    static const size_t kMaxDirtyRects = 32;
+    /// Refresh rate assumed when the display does not report one, in Hz.
+    static const int kDefaultRefreshRate = 60;
+
     const UnixOptionsProcessor::Option_Info UnixSDL2Display::Options[] =
     {
         // command line/povray.conf/environment options of this display mode can be added here
@@ -81,6 +86,10 @@ namespace pov_frontend
         m_display_scale = 1.;
         m_screen = nullptr;
         m_window = nullptr;
+        m_renderer = nullptr;
+        m_texture = nullptr;
+        m_PresentInterval = 1000 / kDefaultRefreshRate;
+        m_LastPresent = 0;
     }
 
     UnixSDL2Display::~UnixSDL2Display()
@@ -105,8 +114,9 @@ namespace pov_frontend
       // not used, provided as sample
       if (m_valid)
       {
+        std::lock_guard<std::mutex> lock(m_DirtyMutex);
         SDL_FillRect(m_screen, NULL, (Uint32)0x7F7F7F7F);
-        SDL_UpdateWindowSurface(m_window);
+        MarkAllDirty();
       }
     }
 
@@ -123,11 +133,16 @@ namespace pov_frontend
         m_display_scale = p->m_display_scale;
 		m_window = p->m_window;
 		m_screen = p->m_screen;
+        m_renderer = p->m_renderer;
+        m_texture = p->m_texture;
+        m_PresentInterval = p->m_PresentInterval;
     // protect against Close(), as the resources are transfered and not copied
     p->m_display_scaled=false;
     p->m_display_scale=1;
     p->m_screen = nullptr;
     p->m_window = nullptr;
+    p->m_renderer = nullptr;
+    p->m_texture = nullptr;
 
         if (m_display_scaled)
         {
@@ -141,6 +156,7 @@ namespace pov_frontend
         }
         if (m_screen->pixels)
         {
+          std::lock_guard<std::mutex> lock(m_DirtyMutex);
           if (SDL_MUSTLOCK(m_screen))
             SDL_LockSurface(m_screen);
           Uint8 *p =(Uint8*)m_screen->pixels;
@@ -154,10 +170,7 @@ namespace pov_frontend
           if (SDL_MUSTLOCK(m_screen))
             SDL_UnlockSurface(m_screen);
 
-
-          SDL_UpdateWindowSurface(m_window);
-
-
+          MarkAllDirty();
         }
 
         return true;
@@ -169,8 +182,21 @@ namespace pov_frontend
         return;
 
       m_PxCount.clear();
+      m_DirtyRects.clear();
       m_valid = false;
 
+      if(m_texture)
+      {
+        SDL_DestroyTexture(m_texture);
+        m_texture = nullptr;
+      }
+
+      if(m_renderer)
+      {
+        SDL_DestroyRenderer(m_renderer);
+        m_renderer = nullptr;
+      }
+
       if(m_screen)
       {
         // Deallocate screen surface
@@ -235,6 +261,10 @@ namespace pov_frontend
             return;
           }
 
+          // present no more often than the display can show
+          if (mode.refresh_rate > 0)
+            m_PresentInterval = 1000 / mode.refresh_rate;
+
           // tolerance for border, just hope the Window Manager is not larger than 10
           width = std::min(mode.w - 10, width);
           // tolerance for border and title bar, just hope the Window Manager is not larger than 80
@@ -255,11 +285,12 @@ namespace pov_frontend
           return;
         }
 
-        // Initialize the display
-        m_screen = SDL_GetWindowSurface(m_window);
+        // Initialize the display; drawing goes to a surface of our own, which is streamed
+        // to a texture by UpdateScreen(), so that drawing never waits for the display
+        m_screen = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_ARGB8888);
         if (m_screen == nullptr)
         {
-          SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Couldn't get SDL window surface: %s", SDL_GetError());
+          SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Couldn't create W%d x H%d SDL surface: %s", width, height, SDL_GetError());
           return;
         }
 
@@ -317,7 +348,10 @@ namespace pov_frontend
 
 
         // early drawing, filled of the window, important when photons are used
-        SDL_UpdateWindowSurface(m_window);
+        {
+          std::lock_guard<std::mutex> lock(m_DirtyMutex);
+          MarkAllDirty();
+        }
         SetCaption(false);
       }
       else
@@ -410,10 +444,52 @@ namespace pov_frontend
         ++m_PxCount[ofs];
     }
 
+    void UnixSDL2Display::MarkDirty(const SDL_Rect& rect)
+    {
+        // caller must hold m_DirtyMutex
+        SDL_Rect bounds = { 0, 0, m_screen->w, m_screen->h };
+        SDL_Rect clipped;
+        if (!SDL_IntersectRect(&rect, &bounds, &clipped))
+            return;
+
+        // fold into an overlapping rectangle if there is one
+        for (std::vector<SDL_Rect>::iterator iter = m_DirtyRects.begin(); iter != m_DirtyRects.end(); iter++)
+        {
+            if (SDL_HasIntersection(&(*iter), &clipped))
+            {
+                SDL_UnionRect(&(*iter), &clipped, &(*iter));
+                return;
+            }
+        }
+
+        m_DirtyRects.push_back(clipped);
+
+        // too many small uploads cost more than a single bigger one
+        if (m_DirtyRects.size() > kMaxDirtyRects)
+        {
+            SDL_Rect all = m_DirtyRects.front();
+            for (std::vector<SDL_Rect>::iterator iter = m_DirtyRects.begin() + 1; iter != m_DirtyRects.end(); iter++)
+                SDL_UnionRect(&all, &(*iter), &all);
+            m_DirtyRects.clear();
+            m_DirtyRects.push_back(all);
+        }
+    }
+
+    void UnixSDL2Display::MarkAllDirty()
+    {
+        // caller must hold m_DirtyMutex
+        SDL_Rect all = { 0, 0, m_screen->w, m_screen->h };
+        m_DirtyRects.clear();
+        m_DirtyRects.push_back(all);
+    }
+
     void UnixSDL2Display::DrawPixel(unsigned int x, unsigned int y, const RGBA8& colour)
     {
         if (!m_valid || x >= GetWidth() || y >= GetHeight())
             return;
+
+        std::lock_guard<std::mutex> lock(m_DirtyMutex);
+
         if (SDL_MUSTLOCK(m_screen) && SDL_LockSurface(m_screen) < 0)
             return;
 
@@ -435,7 +511,7 @@ namespace pov_frontend
         rect.y = y * m_display_scale;
         rect.w = 1;
         rect.h = 1;
-        SDL_UpdateWindowSurfaceRects(m_window, &rect, 1);
+        MarkDirty(rect);
     }
 
     void UnixSDL2Display::DrawRectangleFrame(unsigned int x1, unsigned int y1, unsigned int x2, unsigned int y2, const RGBA8& colour)
@@ -448,6 +524,8 @@ namespace pov_frontend
         int iy1 = std::min(y1, GetHeight()-1);
         int iy2 = std::min(y2, GetHeight()-1);
 
+        std::lock_guard<std::mutex> lock(m_DirtyMutex);
+
         if (SDL_MUSTLOCK(m_screen) && SDL_LockSurface(m_screen) < 0)
             return;
 
@@ -489,7 +567,7 @@ namespace pov_frontend
         // DO NOT FACTOR *m_display_scale or you will get holes
         rect.w = uint_least64_t(ix2 * m_display_scale)-uint_least64_t(ix1 * m_display_scale) +1;
         rect.h = uint_least64_t(iy2 * m_display_scale)-uint_least64_t(iy1 * m_display_scale) +1;
-        SDL_UpdateWindowSurfaceRects(m_window, &rect, 1);
+        MarkDirty(rect);
     }
 
     void UnixSDL2Display::DrawFilledRectangle(unsigned int x1, unsigned int y1, unsigned int x2, unsigned int y2, const RGBA8& colour)
@@ -517,46 +595,58 @@ namespace pov_frontend
         tempRect.y = iy1;
         tempRect.w = ix2 - ix1 + 1;
         tempRect.h = iy2 - iy1 + 1;
+
+        std::lock_guard<std::mutex> lock(m_DirtyMutex);
         SDL_FillRect(m_screen, &tempRect, sdl_col);
-        SDL_UpdateWindowSurfaceRects(m_window, &tempRect, 1);
+        MarkDirty(tempRect);
     }
 
     void UnixSDL2Display::DrawPixelBlock(unsigned int x1, unsigned int y1, unsigned int x2, unsigned int y2, const RGBA8 *colour)
     {
-        if (!m_valid)
+        if (!m_valid || x1 >= GetWidth() || y1 >= GetHeight())
             return;
 
-        unsigned int ix1 = std::min(x1, GetWidth()-1);
         unsigned int ix2 = std::min(x2, GetWidth()-1);
-        unsigned int iy1 = std::min(y1, GetHeight()-1);
         unsigned int iy2 = std::min(y2, GetHeight()-1);
+        // the block may extend beyond the image, so step through the source by its own width
+        unsigned int stride = x2 - x1 + 1;
+
+        std::lock_guard<std::mutex> lock(m_DirtyMutex);
 
         if (SDL_MUSTLOCK(m_screen) && SDL_LockSurface(m_screen) < 0)
             return;
 
         if (m_display_scaled)
         {
-            for(unsigned int y = iy1, i = 0; y <= iy2; y++)
-                for(unsigned int x = ix1; x <= ix2; x++, i++)
-                    SetPixelScaled(x, y, colour[i]);
+            for(unsigned int y = y1; y <= iy2; y++)
+            {
+                const RGBA8 *src = colour + (y - y1) * stride;
+                for(unsigned int x = x1; x <= ix2; x++)
+                    SetPixelScaled(x, y, *src++);
+            }
         }
         else
         {
-            for(unsigned int y = y1, i = 0; y <= iy2; y++)
-                for(unsigned int x = ix1; x <= ix2; x++, i++)
-                    SetPixel(x, y, colour[i]);
+            // the surface is ARGB8888, so whole rows can be packed without going through SDL_MapRGBA
+            for(unsigned int y = y1; y <= iy2; y++)
+            {
+                const RGBA8 *src = colour + (y - y1) * stride;
+                Uint32 *dst = (Uint32 *)((Uint8 *) m_screen->pixels + y * m_screen->pitch) + x1;
+                for(unsigned int x = x1; x <= ix2; x++, src++)
+                    *dst++ = (Uint32(src->alpha) << 24) | (Uint32(src->red) << 16) | (Uint32(src->green) << 8) | Uint32(src->blue);
+            }
         }
 
         if (SDL_MUSTLOCK(m_screen))
             SDL_UnlockSurface(m_screen);
-        
+
         SDL_Rect rect;
-        rect.x = ix1 * m_display_scale;
-        rect.y = iy1 * m_display_scale;
+        rect.x = x1 * m_display_scale;
+        rect.y = y1 * m_display_scale;
         // DO NOT FACTOR *m_display_scale or you will get holes
-        rect.w = uint_least64_t(ix2 * m_display_scale)-uint_least64_t(ix1 * m_display_scale) +1;
-        rect.h = uint_least64_t(iy2 * m_display_scale)-uint_least64_t(iy1 * m_display_scale) +1;
-        SDL_UpdateWindowSurfaceRects(m_window, &rect, 1);
+        rect.w = uint_least64_t(ix2 * m_display_scale)-uint_least64_t(x1 * m_display_scale) +1;
+        rect.h = uint_least64_t(iy2 * m_display_scale)-uint_least64_t(y1 * m_display_scale) +1;
+        MarkDirty(rect);
     }
 
     void UnixSDL2Display::UpdateScreen(bool Force = false)
@@ -564,10 +654,52 @@ namespace pov_frontend
         if (!m_valid)
             return;
 
-        if (Force )
-        { // test shows it does nothing... wrong thread ?
-          //SDL_UpdateWindowSurface(m_window);
+        // drawing only records dirty areas; the texture upload and present happen here, in the
+        // thread polling the session, and no more often than the display refreshes
+        Uint32 now = SDL_GetTicks();
+        if (!Force && (now - m_LastPresent < m_PresentInterval))
+            return;
+
+        if (m_renderer == nullptr)
+        {
+            m_renderer = SDL_CreateRenderer(m_window, -1, 0);
+            if (m_renderer == nullptr)
+            {
+                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Couldn't create SDL renderer: %s", SDL_GetError());
+                m_valid = false;
+                return;
+            }
         }
+
+        if (m_texture == nullptr)
+        {
+            m_texture = SDL_CreateTexture(m_renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, m_screen->w, m_screen->h);
+            if (m_texture == nullptr)
+            {
+                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Couldn't create SDL texture: %s", SDL_GetError());
+                m_valid = false;
+                return;
+            }
+            std::lock_guard<std::mutex> lock(m_DirtyMutex);
+            MarkAllDirty();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_DirtyMutex);
+            if (m_DirtyRects.empty())
+                return;
+
+            for (std::vector<SDL_Rect>::const_iterator iter = m_DirtyRects.begin(); iter != m_DirtyRects.end(); iter++)
+            {
+                const Uint8 *src = (const Uint8 *) m_screen->pixels + iter->y * m_screen->pitch + iter->x * sizeof(Uint32);
+                SDL_UpdateTexture(m_texture, &(*iter), src, m_screen->pitch);
+            }
+            m_DirtyRects.clear();
+        }
+
+        SDL_RenderCopy(m_renderer, m_texture, NULL, NULL);
+        SDL_RenderPresent(m_renderer);
+        m_LastPresent = now;
     }
 
     void UnixSDL2Display::PauseWhenDoneNotifyStart()
@@ -606,9 +738,18 @@ namespace pov_frontend
                 case SDL_MOUSEBUTTONDOWN:
                     do_quit = true;
                     break;
+                case SDL_WINDOWEVENT:
+                    if (event.window.event == SDL_WINDOWEVENT_EXPOSED)
+                    {
+                        std::lock_guard<std::mutex> lock(m_DirtyMutex);
+                        MarkAllDirty();
+                    }
+                    break;
             }
         }
 
+        UpdateScreen(false);
+
         return do_quit;
     }
 
@@ -644,6 +785,14 @@ namespace pov_frontend
                         }
                     }
                     break;
+                case SDL_WINDOWEVENT:
+                    // the window content is lost, present everything again
+                    if (event.window.event == SDL_WINDOWEVENT_EXPOSED)
+                    {
+                        std::lock_guard<std::mutex> lock(m_DirtyMutex);
+                        MarkAllDirty();
+                    }
+                    break;
                 case SDL_QUIT:
                     do_quit = true;
                     break;
@@ -46,6 +46,9 @@
 #include "unixoptions.h"
 #include "disp.h"
 
+#include <mutex>
+#include <vector>
+
 #include <SDL2/SDL.h>
 
 namespace pov_frontend
@@ -89,12 +92,25 @@ namespace pov_frontend
                  If the pixel is already filled the color is mixed.
             */
             void SetPixelScaled(unsigned int x, unsigned int y, const RGBA8& colour);
+            /// Records an area of the window that must be uploaded to the texture on the next present.
+            void MarkDirty(const SDL_Rect& rect);
+            /// Records the whole window as dirty.
+            void MarkAllDirty();
 
             bool m_valid;
             bool m_display_scaled;
             float m_display_scale;
             SDL_Window   *m_window;
             SDL_Surface  *m_screen;
+            SDL_Renderer *m_renderer;
+            SDL_Texture  *m_texture;
+            /// areas of @ref m_screen changed since the last present
+            std::vector<SDL_Rect> m_DirtyRects;
+            /// guards @ref m_screen pixels and @ref m_DirtyRects
+            std::mutex m_DirtyMutex;
+            /// minimum delay between two presents, in milliseconds
+            Uint32 m_PresentInterval;
+            Uint32 m_LastPresent;
             /// for mixing colors in scaled down display
             std::vector<unsigned char> m_PxCount;
     };
@@ -93,6 +93,9 @@
         #define HAVE_ASM_AVX2
         #define HAVE_ASM_FMA3
     #endif
+    #if (__INTEL_COMPILER >= 1500) // 15.0
+        #define HAVE_ASM_AVX512F
+    #endif
 #elif defined(__GNUC__)
     // GCC compiler (or yet another compiler imitating GCC)
     #if (__GNUC__ == 4) // 4.x
@@ -106,11 +109,15 @@
             #define HAVE_ASM_AVX2
             #define HAVE_ASM_FMA3
         #endif
+        #if (__GNUC_MINOR__ >= 9) // 4.9 or later
+            #define HAVE_ASM_AVX512F
+        #endif
     #elif (__GNUC__ >= 5) // 5.x or later
         #define HAVE_ASM_AVX
         #define HAVE_ASM_AVX2
         #define HAVE_ASM_FMA3
         #define HAVE_ASM_FMA4
+        #define HAVE_ASM_AVX512F
     #endif
 #endif
 
@@ -132,6 +139,9 @@
     #if !defined (__FMA4__)
         #define DISABLE_FMA4
     #endif
+    #if !defined (__AVX512F__)
+        #define DISABLE_AVX512F
+    #endif
 #endif
 
 // Decide which optimized code to enable.
@@ -159,14 +169,89 @@
 #if defined(HAVE_ASM_AVX2) && defined(HAVE_ASM_FMA3)
     #define TRY_OPTIMIZED_NOISE                 // optimized noise master switch.
     #define TRY_OPTIMIZED_NOISE_AVX2FMA3        // AVX2/FMA3 hand-optimized noise (Intel).
+    #define TRY_OPTIMIZED_BBOX                  // optimized ray/box test master switch.
+    #define TRY_OPTIMIZED_BBOX_AVX2FMA3         // AVX2 ray/box test.
+    #define TRY_OPTIMIZED_TRANSFORM             // optimized vector transformation master switch.
+    #define TRY_OPTIMIZED_TRANSFORM_AVX2FMA3    // AVX2/FMA3 vector transformations.
 #endif
 
 #if defined(DISABLE_AVX2) || defined(DISABLE_FMA3)
     #define DISABLE_OPTIMIZED_NOISE_AVX2FMA3
+    #define DISABLE_OPTIMIZED_BBOX_AVX2FMA3
+    #define DISABLE_OPTIMIZED_TRANSFORM_AVX2FMA3
+#endif
+
+#if defined(HAVE_ASM_AVX512F)
+    #define TRY_OPTIMIZED_NOISE                 // optimized noise master switch.
+    #define TRY_OPTIMIZED_NOISE_AVX512F_PORTABLE // AVX-512 compiler-optimized noise.
+#endif
+
+#if defined(DISABLE_AVX512F)
+    #define DISABLE_OPTIMIZED_NOISE_AVX512F_PORTABLE
+#endif
+
+#if defined(__x86_64__)
+    #define TRY_OPTIMIZED_FUNCTIONS             // native code for user-defined functions.
 #endif
 
 #endif // BUILD_X86
 
+#ifdef BUILD_ARM
+
+#define POV_CPUINFO         CPUInfo::GetFeatures()
+#define POV_CPUINFO_DETAILS CPUInfo::GetDetails()
+#define POV_CPUINFO_H       "cpuid.h"
+
+// Test which enhanced instruction sets the compiler is generally able to support.
+
+#if defined(__GNUC__)
+    // GCC compiler (or yet another compiler imitating GCC)
+    #define HAVE_ASM_NEON                       // NEON is mandatory on AArch64.
+    #if defined(__clang__)
+        #if (__clang_major__ >= 11) // 11.0 or later
+            #define HAVE_ASM_SVE
+        #endif
+    #elif (__GNUC__ >= 8) // 8.x or later
+        #define HAVE_ASM_SVE
+    #endif
+#endif
+
+// Test which enhanced instruction sets are actually enabled.
+
+// NOTE: The following tests may yield different results for individual translation units,
+// most notably platform-specific optimized implementations.
+#if defined (__GNUC__)
+    // GCC compiler (or any compiler imitating GCC)
+    #if !defined (__ARM_NEON)
+        #define DISABLE_NEON
+    #endif
+    #if !defined (__ARM_FEATURE_SVE)
+        #define DISABLE_SVE
+    #endif
+#endif
+
+// Decide which optimized code to enable.
+
+#if defined(HAVE_ASM_NEON)
+    #define TRY_OPTIMIZED_BBOX                  // optimized ray/box test master switch.
+    #define TRY_OPTIMIZED_BBOX_NEON             // NEON ray/box test.
+#endif
+
+#if defined(DISABLE_NEON)
+    #define DISABLE_OPTIMIZED_BBOX_NEON
+#endif
+
+#if defined(HAVE_ASM_SVE)
+    #define TRY_OPTIMIZED_NOISE                 // optimized noise master switch.
+    #define TRY_OPTIMIZED_NOISE_SVE_PORTABLE    // SVE compiler-optimized noise.
+#endif
+
+#if defined(DISABLE_SVE)
+    #define DISABLE_OPTIMIZED_NOISE_SVE_PORTABLE
+#endif
+
+#endif // BUILD_ARM
+
 
 #ifdef HAVE_NAN
     #if defined(HAVE_STD_ISNAN)
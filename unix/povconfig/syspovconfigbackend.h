@@ -46,8 +46,8 @@
 // POV_NEW_LINE_STRING remains undefined, optimizing the code for "\n" as used internally
 #define SYS_DEF_EXT     ""
 
-// On Unix platforms, we don't do anything special at thread startup.
-#define POV_USE_DEFAULT_TASK_INITIALIZE 1
-#define POV_USE_DEFAULT_TASK_CLEANUP    1
+// On Unix platforms, we pin threads to processors at thread startup if requested.
+#define POV_USE_DEFAULT_TASK_INITIALIZE 0
+#define POV_USE_DEFAULT_TASK_CLEANUP    0
 
 #endif // POVRAY_UNIX_SYSPOVCONFIGBACKEND_H
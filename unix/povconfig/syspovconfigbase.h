@@ -74,6 +74,15 @@
     #define POV_USE_DEFAULT_TIMER 1
 #endif
 
+// Our Unix-specific implementation of the PerformanceCounters class relies on Linux's
+// perf_event_open() system call; other flavours of Unix get the default implementation, which
+// does not count anything.
+#if defined(__linux__)
+    #define POV_USE_DEFAULT_PERFORMANCE_COUNTERS 0
+#else
+    #define POV_USE_DEFAULT_PERFORMANCE_COUNTERS 1
+#endif
+
 // The default Path::ParsePathString() suits our needs perfectly.
 #define POV_USE_DEFAULT_PATH_PARSER 1
 
@@ -83,4 +92,7 @@
 // We want to implement a specialized Filesystem::LargeFile.
 #define POV_USE_DEFAULT_LARGEFILE 0
 
+// We want to implement a specialized Filesystem::MappedFile.
+#define POV_USE_DEFAULT_MAPPEDFILE 0
+
 #endif // POVRAY_UNIX_SYSPOVCONFIGBASE_H
@@ -451,6 +451,19 @@ endif
 if BUILD_x86avx2fma3
 ldadd_platformcpu += \$(top_builddir)/platform/libx86avx2fma3.a
 endif
+if BUILD_x86avx512f
+ldadd_platformcpu += \$(top_builddir)/platform/libx86avx512f.a
+endif
+if BUILD_arm
+cppflags_platformcpu += -I\$(top_srcdir)/platform/arm
+ldadd_platformcpu += \$(top_builddir)/platform/libarm.a
+endif
+if BUILD_armneon
+ldadd_platformcpu += \$(top_builddir)/platform/libarmneon.a
+endif
+if BUILD_armsve
+ldadd_platformcpu += \$(top_builddir)/platform/libarmsve.a
+endif
 
 # Include paths for headers.
 AM_CPPFLAGS = \\
@@ -466,9 +479,12 @@ AM_CPPFLAGS = \\
 # Libraries to link with.
 # Beware: order does matter!
 # TODO - Having vfe/libvfe.a twice in this list is a bit of a hackish way to cope with cyclic dependencies.
+# The same goes for source/libpovray.a, which surrounds the separately compiled noise generator.
 LDADD = \\
   \$(top_builddir)/vfe/libvfe.a \\
   \$(top_builddir)/source/libpovray.a \\
+  \$(top_builddir)/source/libpovraynoise.a \\
+  \$(top_builddir)/source/libpovray.a \\
   \$(top_builddir)/vfe/libvfe.a \\
   \$(top_builddir)/platform/libplatform.a \\
   \$(ldadd_platformcpu)
@@ -809,7 +825,8 @@ case "$1" in
   ;;
 
   *)
-  files=`find $dir -name "*.cpp" -or -name "*.h" | sed s,"$dir/",,g | sort`
+  files_noise="core/material/noise.cpp core/material/portablenoise.cpp"
+  files=`find $dir -name "*.cpp" -or -name "*.h" | sed s,"$dir/",,g | grep -v -e '^core/material/noise\.cpp$' -e '^core/material/portablenoise\.cpp$' | sort`
 
   echo "Create $makefile.am"
   cat Makefile.header > $makefile.am
@@ -819,16 +836,24 @@ case "$1" in
 # Please report bugs to $pov_config_bugreport
 
 # Libraries to build.
-noinst_LIBRARIES = libpovray.a
+noinst_LIBRARIES = libpovray.a libpovraynoise.a
 
 # Source files.
 libpovray_a_SOURCES = \\
   `echo $files`
 
+# Noise generator, built with its own floating-point flags (see configure.ac).
+libpovraynoise_a_SOURCES = \\
+  `echo $files_noise`
+libpovraynoise_a_CXXFLAGS = \$(CXXFLAGS) \$(NOISE_CXXFLAGS)
+
 cppflags_platformcpu = 
 if BUILD_x86
 cppflags_platformcpu += -I\$(top_srcdir)/platform/x86
 endif
+if BUILD_arm
+cppflags_platformcpu += -I\$(top_srcdir)/platform/arm
+endif
 
 # Include paths for headers.
 AM_CPPFLAGS = \\
@@ -1367,6 +1392,9 @@ cppflags_platformcpu =
 if BUILD_x86
 cppflags_platformcpu += -I\$(top_srcdir)/platform/x86
 endif
+if BUILD_arm
+cppflags_platformcpu += -I\$(top_srcdir)/platform/arm
+endif
 
 # Include paths for headers.
 AM_CPPFLAGS = \\
@@ -1413,10 +1441,15 @@ case "$1" in
   *)
   files=`find $dir/unix -name "*.cpp" -or -name "*.h" | sed s,"$dir/",,g | sort`
   files_x86=`find $dir/x86 -maxdepth 1 -name "*.cpp" -or -name "*.h" | sed s,"$dir/",,g | sort`
-  for ext in avx avxfma4 avx2fma3; do
+  for ext in avx avxfma4 avx2fma3 avx512f; do
     files_ext=`find $dir/x86/$ext -name "*.cpp" -or -name "*.h" | sed s,"$dir/",,g | sort`
     eval files_x86$ext='$files_ext'
   done
+  files_arm=`find $dir/arm -maxdepth 1 -name "*.cpp" -or -name "*.h" | sed s,"$dir/",,g | sort`
+  for ext in neon sve; do
+    files_ext=`find $dir/arm/$ext -name "*.cpp" -or -name "*.h" | sed s,"$dir/",,g | sort`
+    eval files_arm$ext='$files_ext'
+  done
 
   echo "Create $makefile.am"
   cat Makefile.header > $makefile.am
@@ -1437,17 +1470,38 @@ endif
 if BUILD_x86avx
 libraries_platformcpu += libx86avx.a
 libx86avx_a_SOURCES = `echo $files_x86avx`
-libx86avx_a_CXXFLAGS = \$(CXXFLAGS) -mavx
+libx86avx_a_CXXFLAGS = \$(CXXFLAGS) \$(NOISE_CXXFLAGS) -mavx
 endif
 if BUILD_x86avxfma4
 libraries_platformcpu += libx86avxfma4.a
 libx86avxfma4_a_SOURCES = `echo $files_x86avxfma4`
-libx86avxfma4_a_CXXFLAGS = \$(CXXFLAGS) -mavx -mfma4
+libx86avxfma4_a_CXXFLAGS = \$(CXXFLAGS) \$(NOISE_CXXFLAGS) -mavx -mfma4
 endif
 if BUILD_x86avx2fma3
 libraries_platformcpu += libx86avx2fma3.a
 libx86avx2fma3_a_SOURCES =  `echo $files_x86avx2fma3`
-libx86avx2fma3_a_CXXFLAGS = \$(CXXFLAGS) -mavx2 -mfma
+libx86avx2fma3_a_CXXFLAGS = \$(CXXFLAGS) \$(NOISE_CXXFLAGS) -mavx2 -mfma
+endif
+if BUILD_x86avx512f
+libraries_platformcpu += libx86avx512f.a
+libx86avx512f_a_SOURCES = `echo $files_x86avx512f`
+libx86avx512f_a_CXXFLAGS = \$(CXXFLAGS) \$(NOISE_CXXFLAGS) -mavx512f
+endif
+if BUILD_arm
+cppflags_platformcpu += -I\$(top_srcdir)/platform/arm
+libraries_platformcpu += libarm.a
+libarm_a_SOURCES = `echo $files_arm`
+libarm_a_CXXFLAGS = \$(CXXFLAGS)
+endif
+if BUILD_armneon
+libraries_platformcpu += libarmneon.a
+libarmneon_a_SOURCES = `echo $files_armneon`
+libarmneon_a_CXXFLAGS = \$(CXXFLAGS)
+endif
+if BUILD_armsve
+libraries_platformcpu += libarmsve.a
+libarmsve_a_SOURCES = `echo $files_armsve`
+libarmsve_a_CXXFLAGS = \$(CXXFLAGS) \$(NOISE_CXXFLAGS) -march=armv8-a+sve
 endif
 
 # Libraries to build.
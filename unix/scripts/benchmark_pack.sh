@@ -0,0 +1,76 @@
+#!/bin/sh
+# ==============================================================================
+# POV-Ray v3.8
+# benchmark_pack.sh - render a pack of representative benchmark scenes
+# ==============================================================================
+# This file is part of POV-Ray and subject to the POV-Ray licence
+# see POVLEGAL.DOC for details
+# ------------------------------------------------------------------------------
+# calling conventions:
+#
+#   benchmark_pack.sh [-n runs] [-t threads] [-b block_size] [-d scene_directory] results_file
+#
+# results_file:     file the machine-readable results are appended to, one
+#                   line of JSON per render (see the Results_File option)
+# runs:             number of times each scene is rendered (default 5);
+#                   several runs are needed to tell regressions from noise
+# threads:          number of render threads (default: all available)
+# block_size:       render block size (default: POV-Ray's default)
+# scene_directory:  directory of the distribution scenes (default: the
+#                   scenes directory next to the directory of this script)
+#
+# Each workload stresses a different part of the renderer: the classic
+# benchmark scene, meshes, media, radiosity, photons and isosurfaces, all
+# rendered at 320x240 with antialiasing.  The images are neither displayed nor
+# written.  Compare two results files with compare_results.sh.
+# ==============================================================================
+
+RUNS=5
+THREADS=
+BLOCK_SIZE=
+SCENE_DIR=`dirname "$0"`/../scenes
+
+# workload name and scene (or INI file) relative to the scene directory
+PACK="
+classic:advanced/benchmark/benchmark.ini
+mesh:objects/chesmsh.pov
+media:advanced/mediasky.pov
+radiosity:radiosity/radiosity2.pov
+photons:advanced/optics.pov
+isosurface:advanced/isocacti.pov
+"
+
+# --- specify additional render options here ---
+POV_OPTIONS="-d -f -p -GR -GS +w320 +h240 +a0.3"
+
+while [ $# -gt 1 ] ; do
+  case $1 in
+    -n ) RUNS="$2" ; shift 2 ;;
+    -t ) THREADS="+wt$2" ; shift 2 ;;
+    -b ) BLOCK_SIZE="+bs$2" ; shift 2 ;;
+    -d ) SCENE_DIR="$2" ; shift 2 ;;
+    * ) break ;;
+  esac
+done
+
+if [ $# -ne 1 ] ; then
+  echo "usage: benchmark_pack.sh [-n runs] [-t threads] [-b block_size] [-d scene_directory] results_file"
+  exit 1
+fi
+
+case $1 in
+  /* ) RESULTS_FILE="$1" ;;
+  * ) RESULTS_FILE="`pwd`/$1" ;;
+esac
+
+for WORKLOAD in $PACK ; do
+  NAME=`echo "$WORKLOAD" | cut -d: -f1`
+  SCENE=`echo "$WORKLOAD" | cut -d: -f2`
+  RUN=1
+  while [ $RUN -le $RUNS ] ; do
+    echo "benchmark_pack.sh: $NAME ($SCENE), run $RUN of $RUNS"
+    ( cd "$SCENE_DIR/`dirname $SCENE`" && \
+      povray `basename $SCENE` $POV_OPTIONS $THREADS $BLOCK_SIZE "Results_File=$RESULTS_FILE" ) || exit 1
+    RUN=`expr $RUN + 1`
+  done
+done
@@ -0,0 +1,134 @@
+#!/bin/sh
+# ==============================================================================
+# POV-Ray v3.8
+# compare_results.sh - compare two machine-readable benchmark results files
+# ==============================================================================
+# This file is part of POV-Ray and subject to the POV-Ray licence
+# see POVLEGAL.DOC for details
+# ------------------------------------------------------------------------------
+# calling conventions:
+#
+#   compare_results.sh [-p percent] baseline_file candidate_file
+#
+# baseline_file:    results of the reference build (see the Results_File
+#                   option and benchmark_pack.sh)
+# candidate_file:   results of the build to check
+# percent:          smallest slowdown reported as a regression (default 2)
+#
+# For each scene, the wall-clock time of each phase and in total is averaged
+# over all runs in either file, and the means are compared with Welch's
+# t-test.  A phase is flagged as a regression if it is slower by more than the
+# given percentage and the difference is significant at the 95% level; this
+# needs at least two runs of the scene in each file.  The exit status is 1 if
+# any regression was found.
+# ==============================================================================
+
+PERCENT=2
+
+if [ "$1" = "-p" ] ; then
+  PERCENT="$2"
+  shift 2
+fi
+
+if [ $# -ne 2 ] ; then
+  echo "usage: compare_results.sh [-p percent] baseline_file candidate_file"
+  exit 2
+fi
+
+awk -v percent="$PERCENT" '
+  # extract the value of a field from a single-line JSON object
+  function field(line, key,    start, rest) {
+    start = index(line, "\"" key "\":")
+    if (start == 0)
+      return ""
+    rest = substr(line, start + length(key) + 3)
+    if (substr(rest, 1, 1) == "\"") {
+      rest = substr(rest, 2)
+      return substr(rest, 1, index(rest, "\"") - 1)
+    }
+    match(rest, /^[-+0-9.eE]+/)
+    return substr(rest, 1, RLENGTH)
+  }
+
+  # two-sided 95% critical value of the t distribution
+  function critical(df) {
+    if (df < 1)
+      df = 1
+    if (df > 30)
+      return 1.96
+    return tcrit[int(df)]
+  }
+
+  BEGIN {
+    split("12.71 4.30 3.18 2.78 2.57 2.45 2.36 2.31 2.26 2.23 2.20 2.18 2.16 2.14 2.13 " \
+          "2.12 2.11 2.10 2.09 2.09 2.08 2.07 2.07 2.06 2.06 2.06 2.05 2.05 2.05 2.04", tcrit, " ")
+    nphases = split("parse bounding photon radiosity trace total", phases, " ")
+    regressions = 0
+  }
+
+  FNR == 1 { file++ }
+
+  field($0, "schema") == "povray-results" {
+    scene = field($0, "scene")
+    if (!(scene in known)) {
+      known[scene] = 1
+      scenes[++nscenes] = scene
+    }
+    runs[file, scene]++
+    for (p = 1; p <= nphases; p++) {
+      t = field($0, phases[p] "_seconds") + 0
+      sum[file, scene, p] += t
+      sumsq[file, scene, p] += t * t
+    }
+  }
+
+  END {
+    printf("%-24s %-10s %10s %10s %8s %7s  %s\n", "scene", "phase", "baseline", "candidate", "change", "t", "verdict")
+    for (s = 1; s <= nscenes; s++) {
+      scene = scenes[s]
+      n1 = runs[1, scene]
+      n2 = runs[2, scene]
+      if (n1 == 0 || n2 == 0)
+        continue
+      for (p = 1; p <= nphases; p++) {
+        m1 = sum[1, scene, p] / n1
+        m2 = sum[2, scene, p] / n2
+        # phases the scene does not use take no time in either build
+        if (m1 < 0.001 && m2 < 0.001)
+          continue
+        change = (m1 > 0 ? (m2 - m1) / m1 * 100 : 0)
+        t = 0
+        verdict = "ok"
+        if (n1 < 2 || n2 < 2) {
+          if (change > percent)
+            verdict = "slower (too few runs to tell)"
+        }
+        else {
+          v1 = (sumsq[1, scene, p] - n1 * m1 * m1) / (n1 - 1)
+          v2 = (sumsq[2, scene, p] - n2 * m2 * m2) / (n2 - 1)
+          if (v1 < 0) v1 = 0
+          if (v2 < 0) v2 = 0
+          se = v1 / n1 + v2 / n2
+          if (se > 0) {
+            t = (m2 - m1) / sqrt(se)
+            df = se * se / ((v1 / n1) ^ 2 / (n1 - 1) + (v2 / n2) ^ 2 / (n2 - 1))
+            significant = (t > critical(df) || -t > critical(df))
+          }
+          else
+            significant = (m1 != m2)
+          if (significant && change > percent) {
+            verdict = "REGRESSION"
+            regressions++
+          }
+          else if (significant && -change > percent)
+            verdict = "improved"
+        }
+        printf("%-24s %-10s %9.3fs %9.3fs %+7.1f%% %7.2f  %s\n", scene, phases[p], m1, m2, change, t, verdict)
+      }
+    }
+    if (regressions > 0) {
+      printf("\n%d regression(s) found\n", regressions)
+      exit 1
+    }
+  }
+' "$1" "$2"
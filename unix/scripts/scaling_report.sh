@@ -0,0 +1,149 @@
+#!/bin/sh
+# ==============================================================================
+# POV-Ray v3.8
+# scaling_report.sh - compute thread scaling curves from benchmark results
+# ==============================================================================
+# This file is part of POV-Ray and subject to the POV-Ray licence
+# see POVLEGAL.DOC for details
+# ------------------------------------------------------------------------------
+# calling conventions:
+#
+#   scaling_report.sh [-e efficiency] [-s share] results_file
+#
+# results_file:     results of renders with different thread counts (see the
+#                   Results_File option and scaling_sweep.sh)
+# efficiency:       parallel efficiency below which a phase is flagged as
+#                   having stopped scaling (default 0.5)
+# share:            smallest share of the total time, in percent, a phase
+#                   must take to be flagged at all (default 1)
+#
+# For each scene and block size, the wall-clock time of each phase is averaged
+# over all runs with the same thread count, and compared with the smallest
+# thread count present (normally 1): speedup is the ratio of the times, and
+# efficiency the speedup divided by the ratio of the thread counts.  The tail
+# phases (the time render threads spent waiting for the slowest one at the end
+# of the radiosity pretrace and the trace) are reported as a share of their
+# phase instead, and flagged once they take a quarter of it.
+#
+# The curves are written to standard output as CSV, with the columns
+#
+#   scene,block_size,phase,threads,runs,seconds,speedup,efficiency,verdict
+#
+# ready for plotting; the phases flagged are summarized on standard error.
+# ==============================================================================
+
+EFFICIENCY=0.5
+SHARE=1
+
+while [ $# -gt 1 ] ; do
+  case $1 in
+    -e ) EFFICIENCY="$2" ; shift 2 ;;
+    -s ) SHARE="$2" ; shift 2 ;;
+    * ) break ;;
+  esac
+done
+
+if [ $# -ne 1 ] ; then
+  echo "usage: scaling_report.sh [-e efficiency] [-s share] results_file"
+  exit 2
+fi
+
+awk -v min_efficiency="$EFFICIENCY" -v min_share="$SHARE" '
+  # extract the value of a field from a single-line JSON object
+  function field(line, key,    start, rest) {
+    start = index(line, "\"" key "\":")
+    if (start == 0)
+      return ""
+    rest = substr(line, start + length(key) + 3)
+    if (substr(rest, 1, 1) == "\"") {
+      rest = substr(rest, 2)
+      return substr(rest, 1, index(rest, "\"") - 1)
+    }
+    match(rest, /^[-+0-9.eE]+/)
+    return substr(rest, 1, RLENGTH)
+  }
+
+  BEGIN {
+    nphases = split("parse bounding photon photon_sort radiosity radiosity_tail trace trace_tail total", phases, " ")
+    # the phase each tail phase belongs to
+    parent["radiosity_tail"] = "radiosity"
+    parent["trace_tail"] = "trace"
+    flagged = 0
+  }
+
+  field($0, "schema") == "povray-results" {
+    config = field($0, "scene") SUBSEP (field($0, "block_size") + 0)
+    threads = field($0, "threads") + 0
+    if (!(config in known)) {
+      known[config] = 1
+      configs[++nconfigs] = config
+    }
+    if (!((config, threads) in runs))
+      counts[config, ++ncounts[config]] = threads
+    runs[config, threads]++
+    for (p = 1; p <= nphases; p++)
+      sum[config, threads, phases[p]] += field($0, phases[p] "_seconds") + 0
+  }
+
+  END {
+    print "scene,block_size,phase,threads,runs,seconds,speedup,efficiency,verdict"
+    for (c = 1; c <= nconfigs; c++) {
+      config = configs[c]
+      split(config, parts, SUBSEP)
+      scene = parts[1]
+      block_size = parts[2]
+
+      # sort the thread counts
+      n = ncounts[config]
+      for (i = 1; i <= n; i++)
+        sorted[i] = counts[config, i]
+      for (i = 2; i <= n; i++)
+        for (j = i; j > 1 && sorted[j - 1] > sorted[j]; j--) {
+          t = sorted[j]; sorted[j] = sorted[j - 1]; sorted[j - 1] = t
+        }
+      base = sorted[1]
+
+      for (p = 1; p <= nphases; p++) {
+        phase = phases[p]
+        base_mean = sum[config, base, phase] / runs[config, base]
+        # phases the scene does not use take no time at any thread count
+        if (!(phase in parent) && base_mean < 0.001)
+          continue
+        for (i = 1; i <= n; i++) {
+          threads = sorted[i]
+          mean = sum[config, threads, phase] / runs[config, threads]
+          total = sum[config, threads, "total"] / runs[config, threads]
+          verdict = "ok"
+          if (phase in parent) {
+            whole = sum[config, threads, parent[phase]] / runs[config, threads]
+            if (whole < 0.001)
+              continue
+            speedup = ""
+            efficiency = sprintf("%.3f", mean / whole)
+            if (mean / whole >= 0.25 && whole * 100 >= total * min_share)
+              verdict = "tail-bound"
+          }
+          else {
+            speedup = (mean > 0 ? base_mean / mean : 0)
+            efficiency = speedup * base / threads
+            if (threads > base && efficiency < min_efficiency && mean * 100 >= total * min_share)
+              verdict = "stopped-scaling"
+            speedup = sprintf("%.3f", speedup)
+            efficiency = sprintf("%.3f", efficiency)
+          }
+          printf("\"%s\",%d,%s,%d,%d,%.3f,%s,%s,%s\n", scene, block_size, phase, threads, runs[config, threads],
+                 mean, speedup, efficiency, verdict)
+          # report each phase only at the smallest thread count at which it is flagged
+          if (verdict != "ok" && !((config, phase) in reported)) {
+            reported[config, phase] = 1
+            flagged++
+            printf("%s (block size %d): %s %s at %d threads (%s %s)\n", scene, block_size, phase, verdict, threads,
+                   (phase in parent ? "share of phase" : "efficiency"), efficiency) > "/dev/stderr"
+          }
+        }
+      }
+    }
+    if (flagged == 0)
+      print "all phases scale" > "/dev/stderr"
+  }
+' "$1"
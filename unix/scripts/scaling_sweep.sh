@@ -0,0 +1,73 @@
+#!/bin/sh
+# ==============================================================================
+# POV-Ray v3.8
+# scaling_sweep.sh - render the benchmark pack across thread counts and block sizes
+# ==============================================================================
+# This file is part of POV-Ray and subject to the POV-Ray licence
+# see POVLEGAL.DOC for details
+# ------------------------------------------------------------------------------
+# calling conventions:
+#
+#   scaling_sweep.sh [-n runs] [-t "thread_counts"] [-b "block_sizes"] [-d scene_directory] results_file
+#
+# results_file:     file the machine-readable results are appended to, one
+#                   line of JSON per render (see the Results_File option)
+# runs:             number of times each scene is rendered per configuration
+#                   (default 3)
+# thread_counts:    render thread counts to sweep (default: 1, 2, 4, ... up
+#                   to the number of available processors, plus that number
+#                   itself if it is not a power of two)
+# block_sizes:      render block sizes to sweep (default 32)
+# scene_directory:  directory of the distribution scenes (default: the
+#                   scenes directory next to the directory of this script)
+#
+# Every combination of thread count and block size renders the whole pack of
+# benchmark_pack.sh.  Turn the results into speedup and efficiency curves with
+# scaling_report.sh.
+# ==============================================================================
+
+RUNS=3
+THREAD_COUNTS=
+BLOCK_SIZES=32
+SCENE_DIR=`dirname "$0"`/../scenes
+
+while [ $# -gt 1 ] ; do
+  case $1 in
+    -n ) RUNS="$2" ; shift 2 ;;
+    -t ) THREAD_COUNTS="$2" ; shift 2 ;;
+    -b ) BLOCK_SIZES="$2" ; shift 2 ;;
+    -d ) SCENE_DIR="$2" ; shift 2 ;;
+    * ) break ;;
+  esac
+done
+
+if [ $# -ne 1 ] ; then
+  echo "usage: scaling_sweep.sh [-n runs] [-t \"thread_counts\"] [-b \"block_sizes\"] [-d scene_directory] results_file"
+  exit 1
+fi
+
+case $1 in
+  /* ) RESULTS_FILE="$1" ;;
+  * ) RESULTS_FILE="`pwd`/$1" ;;
+esac
+
+if [ -z "$THREAD_COUNTS" ] ; then
+  CPUS=`getconf _NPROCESSORS_ONLN 2>/dev/null || echo 1`
+  N=1
+  while [ $N -lt $CPUS ] ; do
+    THREAD_COUNTS="$THREAD_COUNTS $N"
+    N=`expr $N \* 2`
+  done
+  THREAD_COUNTS="$THREAD_COUNTS $CPUS"
+fi
+
+PACK_SCRIPT=`dirname "$0"`/benchmark_pack.sh
+
+for BLOCK_SIZE in $BLOCK_SIZES ; do
+  for THREADS in $THREAD_COUNTS ; do
+    echo "scaling_sweep.sh: $THREADS thread(s), block size $BLOCK_SIZE"
+    "$PACK_SCRIPT" -n "$RUNS" -t "$THREADS" -b "$BLOCK_SIZE" -d "$SCENE_DIR" "$RESULTS_FILE" || exit 1
+  done
+done
+
+echo "scaling_sweep.sh: done; run scaling_report.sh $RESULTS_FILE for the scaling curves"
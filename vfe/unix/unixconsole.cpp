@@ -34,14 +34,18 @@
 //******************************************************************************
 
 // C++ variants of C standard header files
+#include <cerrno>
 #include <csignal>
 #include <cstdlib>
+#include <cstring>
 
 // C++ standard header files
+#include <chrono>
 #include <memory>
 #include <mutex>
 #include <string>
 #include <thread>
+#include <vector>
 
 // Boost library files
 #include <boost/algorithm/string.hpp>
@@ -50,6 +54,8 @@
 #include <termios.h>
 #include <unistd.h>
 #include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 
 // from directory "vfe"
 #include "vfe.h"
@@ -395,6 +401,9 @@ static ReturnValue PrepareBenchmark(vfeSession *session, vfeRenderOptions& opts,
             s.erase(0, 2);
             opts.AddLibraryPath(s);
         }
+        // write machine-readable results
+        else if (boost::starts_with(s, "results_file="))
+            opts.AddCommand(*argv);
     }
 
     int benchversion = pov::Get_Benchmark_Version();
@@ -404,7 +413,8 @@ Entering the standard POV-Ray %s benchmark version %x.%02x.\n\n\
 This built-in benchmark requires POV-Ray to be installed on your system\n\
 before running it.  There will be neither display nor file output, and\n\
 any additional command-line option except setting the number of render\n\
-threads (+wtN for N threads) and library paths (+Lpath) will be ignored.\n\
+threads (+wtN for N threads), library paths (+Lpath) and a machine-readable\n\
+results file (Results_File=name) will be ignored.\n\
 To get an accurate benchmark result you might consider running POV-Ray\n\
 with the Unix 'time' command (e.g. 'time povray -benchmark').\n\n\
 The benchmark will run using %d render thread(s).\n\
@@ -486,6 +496,161 @@ static void TerminateSignalHandler(std::thread* sigthread)
 #endif
 }
 
+// Daemon mode: accept render jobs over a Unix domain socket, one at a time, keeping the
+// process (and with it the token, declaration and image caches) warm between jobs.
+//
+// A request consists of one command-line argument per line, terminated by an empty line or
+// end of input; it is rendered as if those arguments had been appended to the daemon's own
+// command line. The reply is a single line, either `OK <seconds>` or `ERROR <message>`.
+
+static bool DaemonReadRequest(int fd, std::vector<std::string>& args)
+{
+    std::string line;
+    char        c;
+
+    args.clear();
+    while (true)
+    {
+        ssize_t n = recv(fd, &c, 1, 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0 || c == '\n')
+        {
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            if (line.empty())
+                return (n > 0) || !args.empty();
+            args.push_back(line);
+            line.clear();
+            if (n <= 0)
+                return true;
+        }
+        else
+            line += c;
+    }
+}
+
+static void DaemonReply(int fd, const std::string& reply)
+{
+#ifdef MSG_NOSIGNAL
+    const int flags = MSG_NOSIGNAL; // a client hanging up must not stop the daemon
+#else
+    const int flags = 0;
+#endif
+    const char *p = reply.c_str();
+    size_t      left = reply.size();
+    while (left > 0)
+    {
+        ssize_t n = send(fd, p, left, flags);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return;
+        p += n;
+        left -= n;
+    }
+}
+
+static ReturnValue RunDaemon(vfeUnixSession *session, const vfeRenderOptions& baseOpts, const std::string& path)
+{
+    sockaddr_un addr;
+    if (path.size() >= sizeof(addr.sun_path))
+    {
+        fprintf(stderr, "%s: daemon socket path too long: %s\n", PACKAGE, path.c_str());
+        return RETURN_ERROR;
+    }
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0)
+    {
+        fprintf(stderr, "%s: cannot create daemon socket: %s\n", PACKAGE, strerror(errno));
+        return RETURN_ERROR;
+    }
+
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::strcpy(addr.sun_path, path.c_str());
+    unlink(path.c_str());
+    if (bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(listener, 16) != 0)
+    {
+        fprintf(stderr, "%s: cannot listen on %s: %s\n", PACKAGE, path.c_str(), strerror(errno));
+        close(listener);
+        return RETURN_ERROR;
+    }
+
+    fprintf(stderr, "%s: serving render jobs on %s\n", PACKAGE, path.c_str());
+
+    while (!gCancelRender)
+    {
+        // wait for a client, polling for signals in between
+        fd_set  readfds;
+        timeval timeout;
+        FD_ZERO(&readfds);
+        FD_SET(listener, &readfds);
+        timeout.tv_sec = 0;
+        timeout.tv_usec = 200000;
+        int ready = select(listener + 1, &readfds, nullptr, nullptr, &timeout);
+        ProcessSignal();
+        if (ready <= 0)
+            continue;
+
+        int client = accept(listener, nullptr, nullptr);
+        if (client < 0)
+            continue;
+
+        std::vector<std::string> args;
+        if (!DaemonReadRequest(client, args))
+        {
+            close(client);
+            continue;
+        }
+
+        vfeRenderOptions opts(baseOpts);
+        for (std::vector<std::string>::const_iterator i = args.begin(); i != args.end(); ++i)
+            opts.AddCommand(*i);
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        session->Clear(false);
+        if (session->SetOptions(opts) != vfeNoError || session->StartRender() != vfeNoError)
+        {
+            PrintStatus(session);
+            DaemonReply(client, std::string("ERROR ") + session->GetErrorString() + "\n");
+            close(client);
+            continue;
+        }
+
+        vfeStatusFlags flags;
+        session->SetEventMask(stBackendStateChanged);
+        while (((flags = session->GetStatus(true, 200)) & stRenderShutdown) == 0)
+        {
+            ProcessSignal();
+            if (gCancelRender)
+            {
+                CancelRender(session);
+                break;
+            }
+            if (flags & stAnyMessage)
+                PrintStatus(session);
+            if (flags & stBackendStateChanged)
+                PrintStatusChanged(session);
+        }
+        PrintStatus(session);
+
+        char reply[64];
+        if (session->Succeeded())
+            std::snprintf(reply, sizeof(reply), "OK %.3f\n",
+                          std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        else
+            std::snprintf(reply, sizeof(reply), "ERROR %s\n", gCancelRender ? "cancelled" : "render failed");
+        DaemonReply(client, reply);
+        close(client);
+    }
+
+    close(listener);
+    unlink(path.c_str());
+    return gCancelRender ? RETURN_USER_ABORT : RETURN_OK;
+}
+
 int main (int argc, char **argv)
 {
     // Debian checks that POV_LONG is 64 bits
@@ -656,6 +821,10 @@ int main (int argc, char **argv)
         }
     }
 
+    std::string daemon_socket;
+    if (!running_benchmark)
+        daemon_socket = session->GetUnixOptions()->QueryOptionString("general", "daemon");
+
     // process INI settings
     if (running_benchmark)
     {
@@ -671,10 +840,27 @@ int main (int argc, char **argv)
         session->GetUnixOptions()->Process_povray_ini(opts);
         if (s != nullptr)
             opts.AddLibraryPath (s);
+        if (!daemon_socket.empty())
+        {
+            // defaults for daemon jobs; the command line and the jobs themselves may override these
+            opts.AddCommand ("Display=off");
+            opts.AddCommand ("Image_Cache_Size=256");
+        }
         while (*++argv)
             opts.AddCommand (*argv);
     }
 
+    if (!daemon_socket.empty())
+    {
+        retval = RunDaemon(session, opts, daemon_socket);
+        session->Shutdown();
+        PrintStatus (session);
+        TerminateSignalHandler(sigthread);
+        delete sigthread;
+        delete session;
+        return retval;
+    }
+
     // display all queued messages in console queue, allow to keep future error message at the end of the flow
     // otherwise the error get displayed before the copyright and in verbose mode the scroll
     // is big enough to loose the interesting part (and nobody looks back that much for error reports)
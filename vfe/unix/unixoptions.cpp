@@ -70,6 +70,7 @@ namespace vfePlatform
         UnixOptionsProcessor::Option_Info("general", "version", "off", false, "--version|-version|--V", "", "display program version"),
         UnixOptionsProcessor::Option_Info("general", "generation", "off", false, "--generation", "", "display program generation (short version number)"),
         UnixOptionsProcessor::Option_Info("general", "benchmark", "off", false, "--benchmark|-benchmark", "", "run the standard POV-Ray benchmark"),
+        UnixOptionsProcessor::Option_Info("general", "daemon", "", true, "--daemon", "", "serve render jobs on the given Unix domain socket"),
         UnixOptionsProcessor::Option_Info("display", "window", "", true, "--preview|-y", "POV_PREVIEW", "choice of handler for preview (x11, sdl, text)"),
         UnixOptionsProcessor::Option_Info("", "", "", false, "", "", "") // has to be last
     };
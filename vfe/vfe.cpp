@@ -45,6 +45,9 @@
 #include <cstdarg>
 #include <cstdio>
 
+#include <algorithm>
+#include <fstream>
+
 #include <boost/bind.hpp>
 #include <boost/format.hpp>
 
@@ -600,6 +603,59 @@ void vfeProcessRenderOptions::WriteError(const char *format, ...)
 //
 ////////////////////////////////////////////////////////////////////////////////////////
 
+// Declare the identifiers describing the image and input file of a scene.
+static void AppendSceneDeclares(POVMS_List& declares, POVMS_Object& opts, const Path& ip)
+{
+  POVMS_Object image_width(kPOVMSType_WildCard);
+  image_width.SetString(kPOVAttrib_Identifier, "image_width");
+  image_width.SetFloat(kPOVAttrib_Value, opts.TryGetInt(kPOVAttrib_Width, 160));
+  declares.Append(image_width);
+
+  POVMS_Object image_height(kPOVMSType_WildCard);
+  image_height.SetString(kPOVAttrib_Identifier, "image_height");
+  image_height.SetFloat(kPOVAttrib_Value, opts.TryGetInt(kPOVAttrib_Height, 120));
+  declares.Append(image_height);
+
+  POVMS_Object input_file_name(kPOVMSType_WildCard);
+  input_file_name.SetString(kPOVAttrib_Identifier, "input_file_name");
+  input_file_name.SetString(kPOVAttrib_Value, UCS2toSysString(ip.GetFile()).c_str());
+  declares.Append(input_file_name);
+}
+
+// Declare the animation identifiers of a still image.
+static void AppendStillDeclares(POVMS_List& declares)
+{
+  POVMS_Object clock_delta(kPOVMSType_WildCard);
+  clock_delta.SetString(kPOVAttrib_Identifier, "clock_delta");
+  clock_delta.SetFloat(kPOVAttrib_Value, 0.0f);
+  declares.Append(clock_delta);
+
+  POVMS_Object final_clock(kPOVMSType_WildCard);
+  final_clock.SetString(kPOVAttrib_Identifier, "final_clock");
+  final_clock.SetFloat(kPOVAttrib_Value, 0.0f);
+  declares.Append(final_clock);
+
+  POVMS_Object final_frame(kPOVMSType_WildCard);
+  final_frame.SetString(kPOVAttrib_Identifier, "final_frame");
+  final_frame.SetFloat(kPOVAttrib_Value, 0.0f);
+  declares.Append(final_frame);
+
+  POVMS_Object frame_number(kPOVMSType_WildCard);
+  frame_number.SetString(kPOVAttrib_Identifier, "frame_number");
+  frame_number.SetFloat(kPOVAttrib_Value, 0.0f);
+  declares.Append(frame_number);
+
+  POVMS_Object initial_clock(kPOVMSType_WildCard);
+  initial_clock.SetString(kPOVAttrib_Identifier, "initial_clock");
+  initial_clock.SetFloat(kPOVAttrib_Value, 0.0f);
+  declares.Append(initial_clock);
+
+  POVMS_Object initial_frame(kPOVMSType_WildCard);
+  initial_frame.SetString(kPOVAttrib_Identifier, "initial_frame");
+  initial_frame.SetFloat(kPOVAttrib_Value, 0.0f);
+  declares.Append(initial_frame);
+}
+
 VirtualFrontEnd::VirtualFrontEnd(vfeSession& session, POVMSContext ctx, POVMSAddress addr, POVMS_Object& msg, POVMS_Object *result, shared_ptr<Console>& console) :
   m_Session(&session), m_PlatformBase(session), renderFrontend (ctx)
 {
@@ -609,6 +665,12 @@ VirtualFrontEnd::VirtualFrontEnd(vfeSession& session, POVMSContext ctx, POVMSAdd
   consoleResult = nullptr;
   displayResult = nullptr;
   m_PauseRequested = m_PausedAfterFrame = false;
+  m_FramesInFlight = 1;
+  m_CameraCount = m_CameraIndex = 0;
+  m_JobListMode = false;
+  m_NextJob = 0;
+  m_ConcurrentJobs = m_JobThreads = 1;
+  m_JobsSucceeded = m_JobsFailed = 0;
   renderFrontend.ConnectToBackend(backendAddress, msg, result, console);
 }
 
@@ -638,59 +700,28 @@ bool VirtualFrontEnd::Start(POVMS_Object& opts)
   shelloutProcessing->SetCancelMessage("Render halted because the %1% shell-out ('%6%') requested POV-Ray to %5%.");
   shelloutProcessing->SetSkipMessage("The %1% shell-out ('%3%') requested POV-Ray to %2%.");
 
+  // frames can only be parsed ahead if nothing needs to run between them
+  m_FramesInFlight = std::max(opts.TryGetInt(kPOVAttrib_FramesInFlight, 1), 1);
+  if (shelloutProcessing->IsSet(ShelloutProcessing::preFrame) || shelloutProcessing->IsSet(ShelloutProcessing::postFrame))
+    m_FramesInFlight = 1;
+  m_FramesAhead.clear();
+
+  // a job list renders its own scenes instead of the one given by the options
+  m_JobListMode = false;
+  if (opts.Exist(kPOVAttrib_JobList))
+    return StartJobs(opts);
+
   POVMS_List declares;
   if(opts.Exist(kPOVAttrib_Declare) == true)
     opts.Get(kPOVAttrib_Declare, declares);
 
-  POVMS_Object image_width(kPOVMSType_WildCard);
-  image_width.SetString(kPOVAttrib_Identifier, "image_width");
-  image_width.SetFloat(kPOVAttrib_Value, opts.TryGetInt(kPOVAttrib_Width, 160));
-  declares.Append(image_width);
-
-  POVMS_Object image_height(kPOVMSType_WildCard);
-  image_height.SetString(kPOVAttrib_Identifier, "image_height");
-  image_height.SetFloat(kPOVAttrib_Value, opts.TryGetInt(kPOVAttrib_Height, 120));
-  declares.Append(image_height);
-
-  POVMS_Object input_file_name(kPOVMSType_WildCard);
-  input_file_name.SetString(kPOVAttrib_Identifier, "input_file_name");
-  input_file_name.SetString(kPOVAttrib_Value, UCS2toSysString(ip.GetFile()).c_str());
-  declares.Append(input_file_name);
+  AppendSceneDeclares(declares, opts, ip);
 
   int initialFrame = opts.TryGetInt (kPOVAttrib_InitialFrame, 0) ;
   int finalFrame = opts.TryGetInt (kPOVAttrib_FinalFrame, 0) ;
   if ((initialFrame == 0 && finalFrame == 0) || (initialFrame == 1 && finalFrame == 1))
   {
-    POVMS_Object clock_delta(kPOVMSType_WildCard);
-    clock_delta.SetString(kPOVAttrib_Identifier, "clock_delta");
-    clock_delta.SetFloat(kPOVAttrib_Value, 0.0f);
-    declares.Append(clock_delta);
-
-    POVMS_Object final_clock(kPOVMSType_WildCard);
-    final_clock.SetString(kPOVAttrib_Identifier, "final_clock");
-    final_clock.SetFloat(kPOVAttrib_Value, 0.0f);
-    declares.Append(final_clock);
-
-    POVMS_Object final_frame(kPOVMSType_WildCard);
-    final_frame.SetString(kPOVAttrib_Identifier, "final_frame");
-    final_frame.SetFloat(kPOVAttrib_Value, 0.0f);
-    declares.Append(final_frame);
-
-    POVMS_Object frame_number(kPOVMSType_WildCard);
-    frame_number.SetString(kPOVAttrib_Identifier, "frame_number");
-    frame_number.SetFloat(kPOVAttrib_Value, 0.0f);
-    declares.Append(frame_number);
-
-    POVMS_Object initial_clock(kPOVMSType_WildCard);
-    initial_clock.SetString(kPOVAttrib_Identifier, "initial_clock");
-    initial_clock.SetFloat(kPOVAttrib_Value, 0.0f);
-    declares.Append(initial_clock);
-
-    POVMS_Object initial_frame(kPOVMSType_WildCard);
-    initial_frame.SetString(kPOVAttrib_Identifier, "initial_frame");
-    initial_frame.SetFloat(kPOVAttrib_Value, 0.0f);
-    declares.Append(initial_frame);
-
+    AppendStillDeclares(declares);
     opts.Set(kPOVAttrib_Declare, declares);
     // optimization: reset imageProcessing now even though the following assign
     // will free the old pointer (if it exists). this can potentially free a
@@ -700,9 +731,6 @@ bool VirtualFrontEnd::Start(POVMS_Object& opts)
     // the same).
     imageProcessing.reset();
 
-    // TODO: update ImageProcessing with the means of accepting and caching
-    // blocks of pixels as opposed to individual ones, with a back-end that
-    // can serialize completed rows to the final image output file.
     options = opts;
 
     if (m_Session->OutputToFileSet())
@@ -748,6 +776,12 @@ bool VirtualFrontEnd::Stop()
 {
   bool result = false;
 
+  if (m_JobListMode)
+  {
+    StopJobs();
+    return true;
+  }
+
   try
   {
     switch(state)
@@ -927,14 +961,427 @@ bool VirtualFrontEnd::HandleShelloutCancel()
   return true;
 }
 
+// Report animation frames that have been written in the background, in order.
+// Returns false if writing a frame has failed.
+bool VirtualFrontEnd::CollectWrittenFrames(bool wait)
+{
+  if (imageProcessing == nullptr)
+    return true;
+  try
+  {
+    UCS2String filename;
+    while (imageProcessing->GetWrittenImage(filename, wait))
+      m_Session->AdviseFrameCompleted();
+  }
+  catch (std::exception& e)
+  {
+    m_Session->SetFailed();
+    m_Session->AppendErrorMessage (e.what()) ;
+    m_Session->AppendStatusMessage (e.what()) ;
+    return false;
+  }
+  return true;
+}
+
+// Parse upcoming animation frames while the current one is being parsed or rendered,
+// so that up to Frames_In_Flight frames are being worked on at any time. Each of them
+// is parsed in a scene of its own; read-only data such as decoded images, scanned
+// tokens and reused declarations are shared between them through the process-wide
+// caches. If a scene cannot be set up, the remaining frames are parsed in turn.
+void VirtualFrontEnd::StartFramesAhead()
+{
+  if ((animationProcessing == nullptr) || (m_FramesInFlight <= 1))
+    return;
+  if (m_FramesAhead.size() + 1 >= size_t(m_FramesInFlight))
+    return;
+
+  AnimationProcessing ahead(*animationProcessing);
+  for (size_t i = 0; i < m_FramesAhead.size(); i++)
+    ahead.ComputeNextFrame();
+
+  while ((m_FramesAhead.size() + 1 < size_t(m_FramesInFlight)) && ahead.MoreFrames())
+  {
+    ahead.ComputeNextFrame();
+    POVMS_Object opts(ahead.GetFrameRenderOptions());
+    if (m_Session->OutputToFileSet())
+      opts.SetUCS2String (kPOVAttrib_OutputFile, imageProcessing->GetOutputFilename (opts, ahead.GetNominalFrameNumber(), ahead.GetFrameNumberDigits()).c_str());
+
+    FrameAhead frame;
+    frame.frameNumber = ahead.GetNominalFrameNumber();
+    try { frame.sceneId = renderFrontend.CreateScene(backendAddress, opts, boost::bind(&vfe::VirtualFrontEnd::CreateConsole, this)); }
+    catch(pov_base::Exception&)
+    {
+      m_FramesInFlight = 1;
+      return;
+    }
+    try { renderFrontend.StartParser(frame.sceneId, opts); }
+    catch(pov_base::Exception&)
+    {
+      try { renderFrontend.CloseScene(frame.sceneId); }
+      catch (pov_base::Exception&) { /* Ignore any error here! */ }
+      m_FramesInFlight = 1;
+      return;
+    }
+    m_FramesAhead.push_back(frame);
+  }
+}
+
+// Take over the scene of the current animation frame if it has been parsed ahead.
+bool VirtualFrontEnd::AdoptFrameAhead()
+{
+  if (animationProcessing == nullptr)
+    return false;
+
+  POVMSInt frameNumber = animationProcessing->GetNominalFrameNumber();
+  while (!m_FramesAhead.empty() && (m_FramesAhead.front().frameNumber < frameNumber))
+  {
+    try { renderFrontend.StopParser(m_FramesAhead.front().sceneId); }
+    catch (pov_base::Exception&) { /* Ignore any error here! */ }
+    try { renderFrontend.CloseScene(m_FramesAhead.front().sceneId); }
+    catch (pov_base::Exception&) { /* Ignore any error here! */ }
+    m_FramesAhead.pop_front();
+  }
+  if (m_FramesAhead.empty() || (m_FramesAhead.front().frameNumber != frameNumber))
+    return false;
+
+  sceneId = m_FramesAhead.front().sceneId;
+  m_FramesAhead.pop_front();
+  return true;
+}
+
+void VirtualFrontEnd::CloseFramesAhead()
+{
+  for (std::deque<FrameAhead>::iterator i = m_FramesAhead.begin(); i != m_FramesAhead.end(); i++)
+  {
+    try { renderFrontend.StopParser(i->sceneId); }
+    catch (pov_base::Exception&) { /* Ignore any error here! */ }
+    try { renderFrontend.CloseScene(i->sceneId); }
+    catch (pov_base::Exception&) { /* Ignore any error here! */ }
+  }
+  m_FramesAhead.clear();
+}
+
+// Select the camera of the next view of a multi-camera scene, and the file its image
+// is written to.
+void VirtualFrontEnd::SetCameraOptions()
+{
+  options.SetInt(kPOVAttrib_CameraIndex, m_CameraIndex);
+  if (!m_CameraOutputFile.empty())
+    options.SetUCS2String(kPOVAttrib_OutputFile, ImageProcessing::GetCameraOutputFilename(m_CameraOutputFile, m_CameraIndex).c_str());
+}
+
+// Write the image of the current camera of a multi-camera scene, and start rendering
+// the next camera as a new view of the same scene. Parsing, bounding and photons are
+// done once for the scene and shared by all of its views.
+// Returns false if the image could not be written or the view could not be started.
+bool VirtualFrontEnd::StartNextCamera()
+{
+  try
+  {
+    if (m_Session->OutputToFileSet())
+      m_Session->AdviseOutputFilename (imageProcessing->WriteImage(options));
+    renderFrontend.CloseView(viewId);
+
+    m_CameraIndex++;
+    SetCameraOptions();
+    viewId = renderFrontend.CreateView(sceneId, options, imageProcessing, boost::bind(&vfe::VirtualFrontEnd::CreateDisplay, this, _1, _2));
+    renderFrontend.StartRender(viewId, options);
+  }
+  catch (pov_base::Exception& e)
+  {
+    m_Session->SetFailed();
+    m_Session->AppendErrorMessage (e.what()) ;
+    m_Session->AppendStatusMessage (e.what()) ;
+    return false;
+  }
+
+  shared_ptr<Display> display(GetDisplay());
+  if (display != nullptr)
+  {
+    vfeDisplay *disp = dynamic_cast<vfeDisplay *>(display.get());
+    if (disp != nullptr)
+      disp->Show () ;
+  }
+  return true;
+}
+
+// Read a job list and prepare to render its scenes, several at a time. Each line of
+// the list holds the command-line switches and INI settings of one job, applied on
+// top of the session's options. The render threads are shared out evenly between
+// the jobs running at the same time; as tasks run on the process-wide thread pool,
+// the threads themselves are reused from one job to the next.
+bool VirtualFrontEnd::StartJobs(POVMS_Object& opts)
+{
+  UCS2String listFile = opts.TryGetUCS2String(kPOVAttrib_JobList, "");
+  if (m_Session->TestAccessAllowed(Path(listFile), false) == false)
+  {
+    string str ("IO Restrictions prohibit read access to '");
+    str += UCS2toSysString(listFile);
+    str += "'";
+    throw POV_EXCEPTION(kCannotOpenFileErr, str);
+  }
+
+  std::ifstream in(UCS2toSysString(listFile).c_str());
+  if (!in)
+    throw POV_EXCEPTION(kCannotOpenFileErr, "Cannot open job list '" + UCS2toSysString(listFile) + "'");
+
+  m_JobCommands.clear();
+  string line;
+  while (std::getline(in, line))
+  {
+    size_t first = line.find_first_not_of(" \t\r");
+    if ((first == string::npos) || (line[first] == ';'))
+      continue;
+    m_JobCommands.push_back(line.substr(first));
+  }
+  if (m_JobCommands.empty())
+    throw POV_EXCEPTION(kParamErr, "Job list '" + UCS2toSysString(listFile) + "' is empty");
+
+  m_ConcurrentJobs = std::max(1, std::min(opts.TryGetInt(kPOVAttrib_ConcurrentJobs, 1), int(m_JobCommands.size())));
+  m_JobThreads = std::max(1, opts.TryGetInt(kPOVAttrib_MaxRenderThreads, 1) / m_ConcurrentJobs);
+  m_NextJob = 0;
+  m_RunningJobs.clear();
+  m_JobsSucceeded = m_JobsFailed = 0;
+  m_JobsTimer.Reset();
+
+  options = opts;
+  imageProcessing.reset();
+  m_JobListMode = true;
+  state = kStarting;
+
+  return true;
+}
+
+// Set up the scene of the next job in the list and start parsing it.
+void VirtualFrontEnd::StartJob()
+{
+  size_t index = m_NextJob++;
+
+  POVMSObject obj = options();
+  vfeProcessRenderOptions parser(m_Session);
+  if (parser.ParseString(m_JobCommands[index].c_str(), &obj) != kNoErr)
+  {
+    POVMSObject_Delete(&obj);
+    FinishJob(index, false, "invalid options '" + m_JobCommands[index] + "'");
+    return;
+  }
+
+  m_RunningJobs.push_back(Job());
+  Job& job = m_RunningJobs.back();
+  job.index = index;
+  job.options = POVMS_Object(obj);
+
+  try
+  {
+    UCS2String inputFile = job.options.TryGetUCS2String(kPOVAttrib_InputFile, "");
+    if (inputFile.empty())
+      throw POV_EXCEPTION(kParamErr, "no input file");
+
+    job.options.SetInt(kPOVAttrib_MaxRenderThreads, m_JobThreads);
+    job.options.SetBool(kPOVAttrib_Display, false);
+
+    POVMS_List declares;
+    if (job.options.Exist(kPOVAttrib_Declare) == true)
+      job.options.Get(kPOVAttrib_Declare, declares);
+    AppendSceneDeclares(declares, job.options, Path(inputFile));
+    AppendStillDeclares(declares);
+    job.options.Set(kPOVAttrib_Declare, declares);
+
+    if (job.options.TryGetBool(kPOVAttrib_OutputToFile, true))
+    {
+      job.imageProcessing = shared_ptr<ImageProcessing> (new ImageProcessing (job.options));
+      UCS2String filename = job.imageProcessing->GetOutputFilename (job.options, 0, 0);
+      if (m_Session->TestAccessAllowed(filename, true) == false)
+        throw POV_EXCEPTION(kCannotOpenFileErr, "IO Restrictions prohibit write access to '" + UCS2toSysString(filename) + "'");
+      job.options.SetUCS2String (kPOVAttrib_OutputFile, filename.c_str());
+    }
+
+    job.sceneId = renderFrontend.CreateScene(backendAddress, job.options, boost::bind(&vfe::VirtualFrontEnd::CreateConsole, this));
+    renderFrontend.StartParser(job.sceneId, job.options);
+  }
+  catch (pov_base::Exception& e)
+  {
+    if (job.sceneId != RenderFrontendBase::SceneId())
+    {
+      try { renderFrontend.CloseScene(job.sceneId); }
+      catch (pov_base::Exception&) { /* Ignore any error here! */ }
+    }
+    m_RunningJobs.pop_back();
+    FinishJob(index, false, e.what());
+  }
+}
+
+// Report the outcome of a job.
+void VirtualFrontEnd::FinishJob(size_t index, bool succeeded, const string& message)
+{
+  if (succeeded)
+  {
+    m_JobsSucceeded++;
+    m_Session->AppendStreamMessage (vfeSession::mInformation, format ("Job %u of %u done: %s") % (index + 1) % m_JobCommands.size() % message);
+  }
+  else
+  {
+    m_JobsFailed++;
+    string str ((format ("Job %u of %u failed: %s") % (index + 1) % m_JobCommands.size() % message).str());
+    m_Session->AppendErrorMessage (str) ;
+    m_Session->AppendStatusMessage (str) ;
+  }
+}
+
+// Stop all jobs in the list; ProcessJobs() waits for the running ones to wind down.
+void VirtualFrontEnd::StopJobs()
+{
+  m_NextJob = m_JobCommands.size();
+  for (std::list<Job>::iterator i = m_RunningJobs.begin(); i != m_RunningJobs.end(); i++)
+  {
+    if (i->viewId != RenderFrontendBase::ViewId())
+    {
+      try { renderFrontend.StopRender(i->viewId); }
+      catch (pov_base::Exception&) { /* Ignore any error here! */ }
+    }
+    else
+    {
+      try { renderFrontend.StopParser(i->sceneId); }
+      catch (pov_base::Exception&) { /* Ignore any error here! */ }
+    }
+  }
+  m_Session->SetFailed();
+  state = kStopping;
+}
+
+State VirtualFrontEnd::ProcessJobs()
+{
+  if (state == kStarting)
+  {
+    m_Session->SetSucceeded (false);
+    state = kRendering;
+  }
+
+  std::list<Job>::iterator i = m_RunningJobs.begin();
+  while (i != m_RunningJobs.end())
+  {
+    bool finished = false;
+    bool succeeded = false;
+    string message;
+
+    if (i->viewId == RenderFrontendBase::ViewId())
+    {
+      switch (renderFrontend.GetSceneState(i->sceneId))
+      {
+        case SceneData::Scene_Failed:
+          finished = true;
+          message = "parse error";
+          break;
+
+        case SceneData::Scene_Ready:
+          if (state == kStopping)
+          {
+            finished = true;
+            message = "stopped";
+            break;
+          }
+          try
+          {
+            i->viewId = renderFrontend.CreateView(i->sceneId, i->options, i->imageProcessing, boost::bind(&vfe::VirtualFrontEnd::CreateDisplay, this, _1, _2));
+            renderFrontend.StartRender(i->viewId, i->options);
+          }
+          catch (pov_base::Exception& e)
+          {
+            finished = true;
+            message = e.what();
+          }
+          break;
+
+        default:
+          break;
+      }
+    }
+    else
+    {
+      switch (renderFrontend.GetViewState(i->viewId))
+      {
+        case ViewData::View_Failed:
+          finished = true;
+          message = "render error";
+          break;
+
+        case ViewData::View_Rendered:
+          finished = true;
+          if (state == kStopping)
+          {
+            message = "stopped";
+            break;
+          }
+          try
+          {
+            UCS2String filename;
+            if (i->imageProcessing != nullptr)
+              filename = i->imageProcessing->WriteImage(i->options);
+            message = (format ("%s in %.3f seconds") % (filename.empty() ? string("rendered") : UCS2toSysString(filename)) % (i->timer.ElapsedRealTime() / 1000.0)).str();
+            succeeded = true;
+          }
+          catch (pov_base::Exception& e)
+          {
+            message = e.what();
+          }
+          break;
+
+        default:
+          break;
+      }
+    }
+
+    if (!finished)
+    {
+      i++;
+      continue;
+    }
+
+    if (i->viewId != RenderFrontendBase::ViewId())
+    {
+      try { renderFrontend.CloseView(i->viewId); }
+      catch (pov_base::Exception&) { /* Ignore any error here! */ }
+    }
+    try { renderFrontend.CloseScene(i->sceneId); }
+    catch (pov_base::Exception&) { /* Ignore any error here! */ }
+    FinishJob(i->index, succeeded, message);
+    i = m_RunningJobs.erase(i);
+  }
+
+  while ((state == kRendering) && (m_RunningJobs.size() < size_t(m_ConcurrentJobs)) && (m_NextJob < m_JobCommands.size()))
+    StartJob();
+
+  if (!m_RunningJobs.empty() || ((state == kRendering) && (m_NextJob < m_JobCommands.size())))
+    return state;
+
+  double seconds = m_JobsTimer.ElapsedRealTime() / 1000.0;
+  string str ((format ("Job list: %u of %u jobs done in %.1f seconds (%.0f jobs/hour)")
+               % m_JobsSucceeded % m_JobCommands.size() % seconds
+               % (seconds > 0.0 ? m_JobsSucceeded * 3600.0 / seconds : 0.0)).str());
+  m_Session->AppendStatusMessage (str) ;
+  m_Session->AppendStreamMessage (vfeSession::mInformation, str.c_str()) ;
+
+  if ((m_JobsFailed > 0) || (state == kStopping))
+    m_Session->SetFailed();
+  else
+    m_Session->SetSucceeded (true);
+  m_JobListMode = false;
+  return state = kStopped;
+}
+
 State VirtualFrontEnd::Process()
 {
   if (state == kReady)
     return kReady;
 
+  if (m_JobListMode && ((state == kStarting) || (state == kRendering) || (state == kStopping)))
+    return ProcessJobs();
+
   switch(state)
   {
     case kStarting:
+      if (!CollectWrittenFrames(false))
+        return state = kFailed;
       try
       {
         m_Session->SetSucceeded (false);
@@ -1051,6 +1498,18 @@ State VirtualFrontEnd::Process()
         }
       }
 
+      // a frame parsed ahead of time is already on its way
+      if (AdoptFrameAhead())
+      {
+        if (m_PauseRequested)
+        {
+          m_PostPauseState = kParsing;
+          m_PauseRequested = false;
+          return state = kPostShelloutPause;
+        }
+        return state = kParsing;
+      }
+
       // now set up the scene in preparation for parsing, then start the parser
       try { sceneId = renderFrontend.CreateScene(backendAddress, options, boost::bind(&vfe::VirtualFrontEnd::CreateConsole, this)); }
       catch(pov_base::Exception& e)
@@ -1078,6 +1537,8 @@ State VirtualFrontEnd::Process()
 
     case kParsing:
     case kPausedParsing:
+      if (state == kParsing)
+        StartFramesAhead();
       switch(renderFrontend.GetSceneState(sceneId))
       {
         case SceneData::Scene_Paused:
@@ -1099,6 +1560,14 @@ State VirtualFrontEnd::Process()
             // case.
             return state;
           }
+          // with Multi_Camera set, each camera declared in the scene is rendered as a view of its own
+          m_CameraCount = renderFrontend.GetSceneCameras(sceneId);
+          m_CameraIndex = 0;
+          if (m_CameraCount > 0)
+          {
+            m_CameraOutputFile = options.TryGetUCS2String(kPOVAttrib_OutputFile, "");
+            SetCameraOptions();
+          }
           try { viewId = renderFrontend.CreateView(sceneId, options, imageProcessing, boost::bind(&vfe::VirtualFrontEnd::CreateDisplay, this, _1, _2)); }
           catch(pov_base::Exception& e)
           {
@@ -1167,6 +1636,10 @@ State VirtualFrontEnd::Process()
 
     case kRendering:
     case kPausedRendering:
+      if (!CollectWrittenFrames(false))
+        return state = kFailed;
+      if (state == kRendering)
+        StartFramesAhead();
       switch(renderFrontend.GetViewState(viewId))
       {
         case ViewData::View_Paused:
@@ -1185,13 +1658,28 @@ State VirtualFrontEnd::Process()
             // it's possible for the renderer to transition to View_Rendered after a successful pause request.
             return kPausedRendering;
           }
+          if (m_CameraIndex + 1 < m_CameraCount)
+          {
+            // more cameras remain; render them from the same scene before any post-frame processing.
+            if (!StartNextCamera())
+              return state = kFailed;
+            return state = kRendering;
+          }
           try
           {
             if (animationProcessing != nullptr)
             {
-              if (m_Session->OutputToFileSet())
-                m_Session->AdviseOutputFilename (imageProcessing->WriteImage(options, animationProcessing->GetNominalFrameNumber(), animationProcessing->GetFrameNumberDigits()));
-              m_Session->AdviseFrameCompleted();
+              // unless a post-frame shellout needs the file right away, write the image in
+              // the background while the next frame is being parsed and rendered; the frame
+              // is reported as completed once it has been written.
+              if (m_Session->OutputToFileSet() && !shelloutProcessing->IsSet(ShelloutProcessing::postFrame) && imageProcessing->CanWriteAsync(options))
+                imageProcessing->WriteImageAsync(options, animationProcessing->GetNominalFrameNumber(), animationProcessing->GetFrameNumberDigits());
+              else
+              {
+                if (m_Session->OutputToFileSet())
+                  m_Session->AdviseOutputFilename (imageProcessing->WriteImage(options, animationProcessing->GetNominalFrameNumber(), animationProcessing->GetFrameNumberDigits()));
+                m_Session->AdviseFrameCompleted();
+              }
             }
             else
               if (m_Session->OutputToFileSet())
@@ -1238,6 +1726,8 @@ State VirtualFrontEnd::Process()
         return state;
       if ((animationProcessing == nullptr) || animationProcessing->MoreFrames() == false)
       {
+        if (!CollectWrittenFrames(true))
+          return state = kFailed;
         m_Session->SetSucceeded (true);
         if (m_PauseRequested)
         {
@@ -1249,6 +1739,8 @@ State VirtualFrontEnd::Process()
       }
       if (shelloutProcessing->SkipAllFrames())
       {
+        if (!CollectWrittenFrames(true))
+          return state = kFailed;
         string str(shelloutProcessing->GetSkipMessage());
         m_Session->SetSucceeded (true);
         m_Session->AppendStatusMessage (str) ;
@@ -1311,6 +1803,9 @@ State VirtualFrontEnd::Process()
       catch (pov_base::Exception&) { /* Ignore any error here! */ }
       try { renderFrontend.CloseScene(sceneId); }
       catch (pov_base::Exception&) { /* Ignore any error here! */ }
+      CloseFramesAhead();
+      // frames already rendered are still written out
+      CollectWrittenFrames(true);
       animationProcessing.reset();
       imageProcessing.reset();
 
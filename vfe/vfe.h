@@ -38,7 +38,10 @@
 #ifndef POVRAY_VFE_VFE_H
 #define POVRAY_VFE_VFE_H
 
+#include <deque>
+#include <list>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "base/platformbase.h"
@@ -212,6 +215,37 @@ namespace vfe
       bool m_VisibleOnCreation;
   };
 
+  ////////////////////////////////////////////////////////////////////////////
+  // class vfeBufferDisplay
+  //
+  // A display writing the rendered pixels straight into a framebuffer owned
+  // by the caller, converting them to the framebuffer's pixel format, and
+  // invoking the framebuffer's block callback (if any) as each rectangle is
+  // completed. Created by vfeSession when a framebuffer has been set via
+  // vfeSession::SetFramebuffer(). Unlike vfeDisplay, no copy of the image is
+  // kept.
+  class vfeBufferDisplay : public vfeDisplay
+  {
+    public:
+      vfeBufferDisplay(unsigned int width, unsigned int height, vfeSession *session, const vfeFramebuffer& framebuffer);
+      virtual ~vfeBufferDisplay() override;
+
+      virtual void Initialise() override;
+      virtual void DrawPixel(unsigned int x, unsigned int y, const RGBA8& colour) override;
+      virtual void DrawFilledRectangle(unsigned int x1, unsigned int y1, unsigned int x2, unsigned int y2, const RGBA8& colour) override;
+      virtual void DrawPixelBlock(unsigned int x1, unsigned int y1, unsigned int x2, unsigned int y2, const RGBA8 *colour) override;
+      virtual void Clear() override;
+
+    protected:
+      vfeFramebuffer m_Framebuffer;
+      unsigned int m_BytesPerPixel;
+
+      void StorePixel(unsigned char *dest, const RGBA8& colour) const;
+      bool ClipRectangle(unsigned int& x1, unsigned int& y1, unsigned int& x2, unsigned int& y2) const;
+      unsigned char *PixelAddress(unsigned int x, unsigned int y) const
+        { return m_Framebuffer.Data + y * m_Framebuffer.Stride + size_t(x) * m_BytesPerPixel; }
+  };
+
   class VirtualFrontEnd
   {
     public:
@@ -239,6 +273,35 @@ namespace vfe
       virtual Display *CreateDisplay(unsigned int width, unsigned int height)
         { return m_Session->CreateDisplay(width, height) ; }
       bool HandleShelloutCancel();
+      bool CollectWrittenFrames(bool wait);
+      void StartFramesAhead();
+      bool AdoptFrameAhead();
+      void CloseFramesAhead();
+      void SetCameraOptions();
+      bool StartNextCamera();
+      bool StartJobs(POVMS_Object& opts);
+      State ProcessJobs();
+      void StartJob();
+      void FinishJob(size_t index, bool succeeded, const std::string& message);
+      void StopJobs();
+
+      /// Animation frame whose scene is parsed ahead of time.
+      struct FrameAhead
+      {
+        POVMSInt frameNumber;
+        RenderFrontendBase::SceneId sceneId;
+      };
+
+      /// Scene of a job list being rendered.
+      struct Job
+      {
+        size_t index;
+        POVMS_Object options;
+        std::shared_ptr<ImageProcessing> imageProcessing;
+        RenderFrontendBase::SceneId sceneId;
+        RenderFrontendBase::ViewId viewId;
+        pov_base::Timer timer;
+      };
 
       RenderFrontend<vfeParserMessageHandler,FileMessageHandler,vfeRenderMessageHandler,ImageMessageHandler> renderFrontend;
       POVMSAddress backendAddress;
@@ -256,6 +319,20 @@ namespace vfe
       bool m_PausedAfterFrame;
       bool m_PauseRequested;
       State m_PostPauseState;
+      int m_FramesInFlight;
+      std::deque<FrameAhead> m_FramesAhead;
+      unsigned int m_CameraCount;
+      unsigned int m_CameraIndex;
+      UCS2String m_CameraOutputFile;
+      bool m_JobListMode;
+      std::vector<std::string> m_JobCommands;
+      size_t m_NextJob;
+      std::list<Job> m_RunningJobs;
+      int m_ConcurrentJobs;
+      int m_JobThreads;
+      size_t m_JobsSucceeded;
+      size_t m_JobsFailed;
+      pov_base::Timer m_JobsTimer;
   };
 }
 // end of namespace vfe
@@ -232,6 +232,15 @@ int vfeSession::SetOptions (vfeRenderOptions& opts)
   if ((err = POVMSUtil_SetInt (&obj, kPOVAttrib_MaxRenderThreads, opts.m_ThreadCount)) != kNoErr)
     return (m_LastError = vfeFailedToSetMaxThreads) ;
 
+  // in-memory files replace those of the previous options, and must be in place
+  // before any INI file is read, as these may be in memory too.
+  UnregisterMemoryFiles();
+  for (std::vector<vfeRenderOptions::MemoryFile>::const_iterator i = opts.m_MemoryFiles.begin(); i != opts.m_MemoryFiles.end(); i++)
+  {
+    RegisterMemoryFile(i->first, i->second);
+    m_RegisteredMemoryFiles.push_back(i->first);
+  }
+
   // we set this here for potential use by the IO permissions path checking code
   m_InputFilename = opts.m_SourceFile;
 
@@ -273,10 +282,17 @@ int vfeSession::SetOptions (vfeRenderOptions& opts)
         m_InputFilename = str;
   }
 
+  // rendering into a caller-owned framebuffer needs the display
+  if (m_Framebuffer.Data != nullptr)
+    if ((err = POVMSUtil_SetBool (&obj, kPOVAttrib_Display, true)) != kNoErr)
+      return (m_LastError = vfeFailedToInitObject);
+
+  // a job list names the input file of each job instead
   int n = sizeof (str) ;
-  if ((err = POVMSUtil_GetUCS2String (&obj, kPOVAttrib_InputFile, str, &n)) != kNoErr)
+  if ((err = POVMSUtil_GetUCS2String (&obj, kPOVAttrib_InputFile, str, &n)) == kNoErr)
+    m_InputFilename = str;
+  else if (POVMSObject_Exist (&obj, kPOVAttrib_JobList) != kNoErr)
     return (m_LastError = vfeNoInputFile);
-  m_InputFilename = str;
 
   POVMSUtil_GetInt (&obj, kPOVAttrib_Width, &m_RenderWidth) ;
   POVMSUtil_GetInt (&obj, kPOVAttrib_Height, &m_RenderHeight) ;
@@ -35,6 +35,10 @@
 ///
 //******************************************************************************
 
+#include <cstring>
+
+#include <algorithm>
+
 #include "vfe.h"
 
 // this must be the last file included
@@ -104,5 +108,126 @@ void vfeDisplay::Clear()
   m_Pixels.clear();
 }
 
+////////////////////////////////////////////////////////////////////////////////////////
+//
+// class vfeBufferDisplay
+//
+////////////////////////////////////////////////////////////////////////////////////////
+
+vfeBufferDisplay::vfeBufferDisplay(unsigned int w, unsigned int h, vfeSession* session, const vfeFramebuffer& framebuffer) :
+  vfeDisplay(w, h, session, false),
+  m_Framebuffer(framebuffer),
+  m_BytesPerPixel(vfeFramebuffer::BytesPerPixel(framebuffer.Format))
+{
+}
+
+vfeBufferDisplay::~vfeBufferDisplay()
+{
+}
+
+// unlike vfeDisplay we don't keep a copy of the image, and the framebuffer
+// contents are left alone until pixels arrive.
+void vfeBufferDisplay::Initialise()
+{
+}
+
+void vfeBufferDisplay::StorePixel(unsigned char *dest, const RGBA8& colour) const
+{
+  switch (m_Framebuffer.Format)
+  {
+    case vfeFramebuffer::pfRGBA8:
+      dest[0] = colour.red;
+      dest[1] = colour.green;
+      dest[2] = colour.blue;
+      dest[3] = colour.alpha;
+      break;
+    case vfeFramebuffer::pfBGRA8:
+      dest[0] = colour.blue;
+      dest[1] = colour.green;
+      dest[2] = colour.red;
+      dest[3] = colour.alpha;
+      break;
+    case vfeFramebuffer::pfRGB8:
+      dest[0] = colour.red;
+      dest[1] = colour.green;
+      dest[2] = colour.blue;
+      break;
+    case vfeFramebuffer::pfBGR8:
+      dest[0] = colour.blue;
+      dest[1] = colour.green;
+      dest[2] = colour.red;
+      break;
+    case vfeFramebuffer::pfGray8:
+      // Rec. 709 luma weights, in 1/256ths
+      dest[0] = (unsigned char) ((colour.red * 54 + colour.green * 183 + colour.blue * 19) >> 8);
+      break;
+  }
+}
+
+// Clips a rectangle (both corners inclusive) to the framebuffer; returns false
+// if nothing of it remains.
+bool vfeBufferDisplay::ClipRectangle(unsigned int& x1, unsigned int& y1, unsigned int& x2, unsigned int& y2) const
+{
+  if (x1 >= m_Framebuffer.Width || y1 >= m_Framebuffer.Height || x1 > x2 || y1 > y2)
+    return false;
+  x2 = std::min(x2, m_Framebuffer.Width - 1);
+  y2 = std::min(y2, m_Framebuffer.Height - 1);
+  return true;
+}
+
+void vfeBufferDisplay::DrawPixel(unsigned int x, unsigned int y, const RGBA8& colour)
+{
+  if (x >= m_Framebuffer.Width || y >= m_Framebuffer.Height)
+    return;
+  StorePixel(PixelAddress(x, y), colour);
+  if (m_Framebuffer.OnBlock)
+    m_Framebuffer.OnBlock(x, y, x, y);
+}
+
+void vfeBufferDisplay::DrawFilledRectangle(unsigned int x1, unsigned int y1, unsigned int x2, unsigned int y2, const RGBA8& colour)
+{
+  if (!ClipRectangle(x1, y1, x2, y2))
+    return;
+  for (unsigned int y = y1; y <= y2; y++)
+  {
+    unsigned char *dest = PixelAddress(x1, y);
+    for (unsigned int x = x1; x <= x2; x++, dest += m_BytesPerPixel)
+      StorePixel(dest, colour);
+  }
+  if (m_Framebuffer.OnBlock)
+    m_Framebuffer.OnBlock(x1, y1, x2, y2);
+}
+
+void vfeBufferDisplay::DrawPixelBlock(unsigned int x1, unsigned int y1, unsigned int x2, unsigned int y2, const RGBA8 *colour)
+{
+  // the colours cover the whole rectangle as requested, even if it gets clipped
+  unsigned int width = x2 - x1 + 1;
+  unsigned int left = x1;
+  unsigned int top = y1;
+
+  if (!ClipRectangle(x1, y1, x2, y2))
+    return;
+  for (unsigned int y = y1; y <= y2; y++)
+  {
+    const RGBA8 *src = colour + size_t(y - top) * width + (x1 - left);
+    unsigned char *dest = PixelAddress(x1, y);
+    if (m_Framebuffer.Format == vfeFramebuffer::pfRGBA8)
+      memcpy(dest, src, size_t(x2 - x1 + 1) * sizeof(RGBA8));
+    else
+      for (unsigned int x = x1; x <= x2; x++, dest += m_BytesPerPixel)
+        StorePixel(dest, *src++);
+  }
+  if (m_Framebuffer.OnBlock)
+    m_Framebuffer.OnBlock(x1, y1, x2, y2);
+}
+
+void vfeBufferDisplay::Clear()
+{
+  unsigned int width = std::min(GetWidth(), m_Framebuffer.Width);
+  unsigned int height = std::min(GetHeight(), m_Framebuffer.Height);
+  for (unsigned int y = 0; y < height; y++)
+    memset(PixelAddress(0, y), 0, size_t(width) * m_BytesPerPixel);
+}
+
 }
 // end of namespace vfe
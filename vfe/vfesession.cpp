@@ -93,6 +93,7 @@ vfeSession::vfeSession(int id)
 vfeSession::~vfeSession()
 {
   // note: shouldn't delete m_Frontend here since it will cause a POVMS context error
+  UnregisterMemoryFiles();
   m_Initialized = false;
   m_CurrentSessionTemporaryHack = nullptr;
 }
@@ -750,6 +751,34 @@ vfeDisplay *vfeSession::DefaultDisplayCreator (unsigned int width, unsigned int
   return new vfeDisplay (width, height, session, visible) ;
 }
 
+vfeDisplay *vfeSession::FramebufferDisplayCreator (unsigned int width, unsigned int height, vfeSession *session, bool visible)
+{
+  return new vfeBufferDisplay (width, height, session, m_Framebuffer) ;
+}
+
+void vfeSession::SetFramebuffer(const vfeFramebuffer& framebuffer)
+{
+  m_Framebuffer = framebuffer;
+  if (m_Framebuffer.Data == nullptr)
+    ClearFramebuffer();
+  else
+    m_DisplayCreator = boost::bind(&vfe::vfeSession::FramebufferDisplayCreator, this, _1, _2, _3, _4);
+}
+
+void vfeSession::ClearFramebuffer()
+{
+  m_Framebuffer = vfeFramebuffer();
+  m_DisplayCreator = boost::bind(&vfe::vfeSession::DefaultDisplayCreator, this, _1, _2, _3, _4);
+}
+
+// Withdraws the in-memory files registered by SetOptions().
+void vfeSession::UnregisterMemoryFiles()
+{
+  for (UCS2StringVector::const_iterator i = m_RegisteredMemoryFiles.begin(); i != m_RegisteredMemoryFiles.end(); i++)
+    UnregisterMemoryFile(*i);
+  m_RegisteredMemoryFiles.clear();
+}
+
 // If a VFE implementation has provided the address of a display creator
 // function via vfeSession::SetDisplayCreator(), this method will call it
 // with the width, height, gamma factor, and default visibility flag (false
@@ -49,6 +49,7 @@
 #include <boost/format.hpp>
 #include <boost/function.hpp>
 
+#include "base/fileinputoutput.h"
 #include "base/stringutilities.h"
 
 #include "frontend/simplefrontend.h"
@@ -147,6 +148,7 @@ namespace vfe
         ClearLibraryPaths();
         ClearINIs();
         ClearCommands();
+        ClearMemoryFiles();
         m_SourceFile.clear();
         m_ThreadCount = 2;
         POVMSObject obj;
@@ -185,6 +187,29 @@ namespace vfe
       // an empty string). Return type is a const reference to a UCS2String.
       const UCS2String& GetSourceFile() const { return m_SourceFile; }
 
+      // Set the source to be parsed from an in-memory buffer rather than a
+      // file. The name is used in messages and to resolve relative include
+      // files, but no file of that name needs to exist; the scene is never
+      // read from or written to the filesystem. See AddMemoryFile().
+      void SetSourceBuffer(const UCS2String& Name, const std::string& Source)
+      {
+        AddMemoryFile(Name, Source);
+        m_SourceFile = Name;
+      }
+
+      // Make the supplied data available to the render under the given file
+      // name (e.g. an include file or INI file referenced by the scene),
+      // taking precedence over any file of that name on disk. The data is
+      // registered when the options are passed to vfeSession::SetOptions()
+      // and withdrawn when the session is given new options or destroyed.
+      void AddMemoryFile(const UCS2String& Name, const std::string& Data)
+      {
+        m_MemoryFiles.push_back(MemoryFile(Name, std::make_shared<const std::string>(Data)));
+      }
+
+      // Clears any in-memory files added via AddMemoryFile() or SetSourceBuffer().
+      void ClearMemoryFiles() { m_MemoryFiles.clear(); }
+
       // Clears the list of INI files.
       void ClearINIs() { m_IniFiles.clear() ; }
 
@@ -239,14 +264,67 @@ namespace vfe
       POVMS_Object& GetOptions() { return m_Options; }
 
     protected:
+      typedef std::pair<UCS2String, MemoryFileData> MemoryFile;
+
       int m_ThreadCount;
       UCS2StringVector m_IniFiles;
       UCS2StringVector m_LibraryPaths;
       StringVector m_Commands;
       UCS2String m_SourceFile;
+      std::vector<MemoryFile> m_MemoryFiles;
       POVMS_Object m_Options;
   } ;
 
+  ////////////////////////////////////////////////////////////////////////////
+  // struct vfeFramebuffer
+  //
+  // Describes a caller-owned framebuffer the rendered image is written to
+  // directly, as an alternative to the render preview or an output file.
+  // See vfeSession::SetFramebuffer().
+  struct vfeFramebuffer
+  {
+    // Layout of a single pixel in the framebuffer; all formats use one byte
+    // per channel, gamma-encoded in the same way as the render preview.
+    typedef enum
+    {
+      pfRGBA8 = 0,
+      pfBGRA8,
+      pfRGB8,
+      pfBGR8,
+      pfGray8
+    } PixelFormat ;
+
+    // Called each time a rectangle of the image (x1, y1)-(x2, y2), both
+    // corners inclusive, has been written to the framebuffer. Note that this
+    // is called from the thread processing the frontend messages, not the
+    // thread that set up the framebuffer.
+    typedef boost::function<void(unsigned int x1, unsigned int y1, unsigned int x2, unsigned int y2)> BlockCallback;
+
+    vfeFramebuffer() : Data(nullptr), Width(0), Height(0), Stride(0), Format(pfRGBA8) {}
+
+    // Returns the number of bytes per pixel of the given format.
+    static unsigned int BytesPerPixel(PixelFormat format)
+    {
+      switch (format)
+      {
+        case pfRGB8:
+        case pfBGR8:
+          return 3;
+        case pfGray8:
+          return 1;
+        default:
+          return 4;
+      }
+    }
+
+    unsigned char *Data;      // first byte of the top row; `nullptr` if no framebuffer is set
+    unsigned int Width;       // width of the framebuffer, in pixels
+    unsigned int Height;      // height of the framebuffer, in pixels
+    size_t Stride;            // distance between the starts of two rows, in bytes
+    PixelFormat Format;
+    BlockCallback OnBlock;    // may be empty
+  } ;
+
   // The integer values which may be returned from any of the VFE methods
   // which return error codes.
   enum
@@ -560,6 +638,24 @@ namespace vfe
       // vfeSession::DefaultDisplayCreator().
       virtual void SetDisplayCreator(DisplayCreator creator) { m_DisplayCreator = creator; }
 
+      // Have the rendered image written straight into a framebuffer owned by
+      // the caller, who is notified as each block is completed (see
+      // vfeFramebuffer). This replaces the display creator with one creating
+      // a vfeBufferDisplay, and makes SetOptions() enable the display. The
+      // framebuffer must remain valid until the render has completed; parts of
+      // the image that fall outside of it are discarded. Combined with
+      // vfeRenderOptions::SetSourceBuffer() and output to file turned off, a
+      // render never touches the filesystem.
+      virtual void SetFramebuffer(const vfeFramebuffer& framebuffer);
+
+      // Returns the framebuffer set via SetFramebuffer(); its Data member is
+      // `nullptr` if none has been set.
+      virtual const vfeFramebuffer& GetFramebuffer() const { return m_Framebuffer; }
+
+      // Stop writing to a framebuffer set via SetFramebuffer(), and revert to
+      // the default display creator.
+      virtual void ClearFramebuffer();
+
       // Returns a pointer to the internal VirtualFrontendInstance used by the session.
       // Generally a client should not need this - if there is some good reason to get
       // at the frontend, it probably means that there is functionality missing from
@@ -1265,7 +1361,13 @@ namespace vfe
       std::shared_ptr<Console> m_Console;
 
       virtual vfeDisplay *DefaultDisplayCreator (unsigned int width, unsigned int height, vfeSession *session, bool visible);
+      virtual vfeDisplay *FramebufferDisplayCreator (unsigned int width, unsigned int height, vfeSession *session, bool visible);
       DisplayCreator m_DisplayCreator;
+      vfeFramebuffer m_Framebuffer;
+
+      // names of the in-memory files registered by SetOptions()
+      UCS2StringVector m_RegisteredMemoryFiles;
+      void UnregisterMemoryFiles();
 
       int m_MaxStatusMessages;
       int m_MaxGenericMessages;
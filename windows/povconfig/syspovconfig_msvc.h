@@ -239,6 +239,14 @@
     // compiler supports AVX2.
     #define TRY_OPTIMIZED_NOISE                 // optimized noise master switch.
     #define TRY_OPTIMIZED_NOISE_AVX2FMA3        // AVX2/FMA3 hand-optimized noise (Intel).
+    #define TRY_OPTIMIZED_BBOX                  // optimized ray/box test master switch.
+    #define TRY_OPTIMIZED_BBOX_AVX2FMA3         // AVX2 ray/box test.
+    #define TRY_OPTIMIZED_TRANSFORM             // optimized vector transformation master switch.
+    #define TRY_OPTIMIZED_TRANSFORM_AVX2FMA3    // AVX2/FMA3 vector transformations.
+#endif
+
+#if defined(_M_X64)
+    #define TRY_OPTIMIZED_FUNCTIONS             // native code for user-defined functions.
 #endif
 
 #define POV_CPUINFO         CPUInfo::GetFeatures()
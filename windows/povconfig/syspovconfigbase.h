@@ -55,12 +55,19 @@
 // Windows provides platform-specific mechanisms to measure both wall-clock and CPU time.
 #define POV_USE_DEFAULT_TIMER 0
 
+// Windows provides a platform-specific mechanism to count the CPU cycles of a thread
+// (but no other hardware events).
+#define POV_USE_DEFAULT_PERFORMANCE_COUNTERS 0
+
 // Windows requires platform-specific parsing of path name strings.
 #define POV_USE_DEFAULT_PATH_PARSER 0
 
 // Windows requires a platform-specific function to delete a file.
 #define POV_USE_DEFAULT_DELETEFILE 0
 
+// Windows requires a platform-specific function to replace a file by renaming another.
+#define POV_USE_DEFAULT_RENAMEFILE 0
+
 // Windows gets a platform-specific implementation of large file handling.
 #define POV_USE_DEFAULT_LARGEFILE 0
 